@@ -50,6 +50,11 @@ static void write_header (int32_t directory_offset, int32_t directory_size)
 	write_int32 (directory_size);
 }
 
+static int compare_entry_names (const void *a, const void *b)
+{
+	return strcmp ((const char *)a, (const char *)b);
+}
+
 int main (int argc, char *argv[])
 {
 	FILE *toc_file = NULL;
@@ -90,30 +95,12 @@ int main (int argc, char *argv[])
 
 	char entry_path[1024] = {0};
 
-	int32_t num_in_files = 0;
+	// read all entry names, the directory is written sorted so the pak
+	// doesn't depend on the toc order and duplicates are caught at build time
+	typedef char entry_name_t[sizeof (((dpackfile_t *)0)->name)];
+	entry_name_t *entry_names = NULL;
+	int32_t		  num_in_files = 0;
 
-	// count the number of lines = num_in_files
-	while (fgets (entry_path, sizeof (entry_path), toc_file))
-	{
-		num_in_files++;
-	}
-	// rewind
-	rewind (toc_file);
-
-	int32_t directory_offset = 12;
-
-	int32_t directory_size = num_in_files * sizeof (dpackfile_t);
-	int32_t file_offset = directory_offset + directory_size;
-
-	write_header (directory_offset, directory_size);
-
-	FILE	*in = NULL;
-	uint8_t *in_buffer = NULL;
-
-	char input_file_path[1024] = {0};
-
-	int file_index = -1;
-	// read each  line
 	while (fgets (entry_path, sizeof (entry_path), toc_file))
 	{
 		// trim leading and trailing whaitespaces:
@@ -131,9 +118,45 @@ int main (int argc, char *argv[])
 			}
 		}
 
-		file_index++;
+		size_t entry_name_len = strlen (entry_path_start);
+		if (entry_name_len == 0)
+			continue;
+		if (entry_name_len >= sizeof (entry_name_t))
+		{
+			fprintf (stderr, "PAK entry path too long (%zu >= %zu): '%s'\n", entry_name_len, sizeof (entry_name_t), entry_path_start);
+			return 1;
+		}
+
+		entry_names = realloc (entry_names, (num_in_files + 1) * sizeof (entry_name_t));
+		memcpy (entry_names[num_in_files++], entry_path_start, entry_name_len + 1);
+	}
+
+	qsort (entry_names, num_in_files, sizeof (entry_name_t), compare_entry_names);
+	for (int file_index = 1; file_index < num_in_files; file_index++)
+	{
+		if (strcmp (entry_names[file_index - 1], entry_names[file_index]) == 0)
+		{
+			fprintf (stderr, "Duplicate PAK entry '%s'\n", entry_names[file_index]);
+			return 1;
+		}
+	}
+
+	int32_t directory_offset = 12;
+
+	int32_t directory_size = num_in_files * sizeof (dpackfile_t);
+	int32_t file_offset = directory_offset + directory_size;
+
+	write_header (directory_offset, directory_size);
+
+	FILE	*in = NULL;
+	uint8_t *in_buffer = NULL;
+
+	char input_file_path[1024] = {0};
+
+	for (int file_index = 0; file_index < num_in_files; file_index++)
+	{
 		// prepend the root dir
-		snprintf (input_file_path, sizeof (input_file_path), "%s/%s", argv[2], entry_path_start);
+		snprintf (input_file_path, sizeof (input_file_path), "%s/%s", argv[2], entry_names[file_index]);
 
 		// Add this input file to the depfile
 		if (dep_file)
@@ -153,18 +176,11 @@ int main (int argc, char *argv[])
 		in_buffer = realloc (in_buffer, in_size);
 		fread (in_buffer, in_size, 1, in);
 
-			dpackfile_t pack_entry;
-			memset (&pack_entry, 0, sizeof (pack_entry));
-			size_t entry_name_len = strlen (entry_path_start);
-			if (entry_name_len >= sizeof (pack_entry.name))
-			{
-				fprintf (stderr, "PAK entry path too long (%zu >= %zu): '%s'\n",
-						entry_name_len, sizeof (pack_entry.name), entry_path_start);
-				return 1;
-			}
-			memcpy (pack_entry.name, entry_path_start, entry_name_len + 1);
-			pack_entry.filelen = (int)in_size;
-			pack_entry.filepos = file_offset;
+		dpackfile_t pack_entry;
+		memset (&pack_entry, 0, sizeof (pack_entry));
+		memcpy (pack_entry.name, entry_names[file_index], sizeof (pack_entry.name));
+		pack_entry.filelen = (int)in_size;
+		pack_entry.filepos = file_offset;
 
 		fseek (out, directory_offset + (file_index * sizeof (dpackfile_t)), SEEK_SET);
 		fwrite (&pack_entry, sizeof (pack_entry), 1, out);
@@ -175,7 +191,7 @@ int main (int argc, char *argv[])
 		file_offset += (int32_t)in_size;
 		fclose (in);
 
-	} // end while
+	} // end for
 
 	if (dep_file)
 	{
@@ -185,6 +201,7 @@ int main (int argc, char *argv[])
 	fclose (out);
 	fclose (toc_file);
 	free (in_buffer);
+	free (entry_names);
 
 	return 0;
 }
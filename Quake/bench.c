@@ -0,0 +1,384 @@
+/*
+ * bench.c -- microbenchmarks of the engine core data structures
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+#include "bench.h"
+#ifdef USE_RMLUI
+#include "ui_manager.h"
+#endif
+
+// Unlike the test_ commands these are built in every configuration, timings of debug builds are of little use.
+// "bench" runs everything, which is also what the meson benchmark() target does through -dedicated.
+
+// bench -json also writes every result to <gamedir>/bench.json, read by scripts/perf-regress.py
+static FILE		  *bench_json;
+static const char *bench_group;
+static int		   bench_json_results;
+
+/*
+====================
+Bench_Report
+====================
+*/
+void Bench_Report (const char *name, int64_t ops, double seconds)
+{
+	if (ops <= 0 || seconds <= 0.0)
+	{
+		Con_Printf ("%-40s        n/a\n", name);
+		return;
+	}
+	Con_Printf ("%-40s %10.1f ns/op %14.0f ops/s\n", name, seconds * 1e9 / (double)ops, (double)ops / seconds);
+	if (bench_json)
+		fprintf (
+			bench_json, "%s\t\t{\"group\": \"%s\", \"name\": \"%s\", \"ops\": %" PRIi64 ", \"seconds\": %.6f, \"ns_per_op\": %.3f}",
+			bench_json_results++ ? ",\n" : "", bench_group, name, ops, seconds, seconds * 1e9 / (double)ops);
+}
+
+/*
+====================
+Bench_FindFile
+
+COM_FileExists goes through COM_FindFile without opening anything
+====================
+*/
+static void Bench_FindFile (void)
+{
+	static const char *const files[] = {"gfx.wad", "progs.dat", "maps/start.bsp", "sound/misc/null.wav", "bench/does_not_exist.xyz"};
+	const int				 NUM_ITERATIONS = 20000;
+
+	for (size_t i = 0; i < countof (files); ++i)
+	{
+		const double start = Sys_DoubleTime ();
+		int			 found = 0;
+		for (int j = 0; j < NUM_ITERATIONS; ++j)
+			found += COM_FileExists (files[i], NULL);
+		Bench_Report (va ("findfile %s (%s)", files[i], found ? "found" : "missing"), NUM_ITERATIONS, Sys_DoubleTime () - start);
+	}
+}
+
+/*
+====================
+Bench_SVMove
+
+Random point and player hull traces across the bounds of the loaded map
+====================
+*/
+static void Bench_SVMove (void)
+{
+	const int	NUM_TRACES = 100000;
+	static const vec3_t player_mins = {-16, -16, -24};
+	static const vec3_t player_maxs = {16, 16, 32};
+	vec3_t		*points;
+	vec3_t		 mins, maxs;
+
+	if (!sv.active || !sv.qcvm.worldmodel)
+	{
+		Con_Printf ("%-40s    skipped, no map loaded\n", "sv_move");
+		return;
+	}
+
+	PR_SwitchQCVM (&sv.qcvm);
+	COM_SeedRand (0);
+	points = Mem_AllocNonZero (sizeof (vec3_t) * 2 * NUM_TRACES);
+	for (int i = 0; i < 2 * NUM_TRACES; ++i)
+		for (int k = 0; k < 3; ++k)
+			points[i][k] = qcvm->worldmodel->mins[k] + (qcvm->worldmodel->maxs[k] - qcvm->worldmodel->mins[k]) * ((float)COM_Rand () / (float)COM_RAND_MAX);
+
+	for (int hull = 0; hull < 2; ++hull)
+	{
+		const double start = Sys_DoubleTime ();
+		int			 hits = 0;
+		VectorCopy (hull ? player_mins : vec3_origin, mins);
+		VectorCopy (hull ? player_maxs : vec3_origin, maxs);
+		for (int i = 0; i < NUM_TRACES; ++i)
+		{
+			const trace_t trace = SV_Move (points[i * 2], mins, maxs, points[i * 2 + 1], MOVE_NORMAL, sv.qcvm.edicts);
+			hits += trace.fraction < 1.0f;
+		}
+		Bench_Report (va ("sv_move %s (%d%% hit)", hull ? "player hull" : "point", hits * 100 / NUM_TRACES), NUM_TRACES, Sys_DoubleTime () - start);
+	}
+
+	Mem_Free (points);
+	PR_SwitchQCVM (NULL);
+}
+
+/*
+====================
+Bench_SpawnBot
+
+What spawnclient and the spawn command do for a client without a connection
+====================
+*/
+static client_t *Bench_SpawnBot (void)
+{
+	for (int i = svs.maxclients; i-- > 0;)
+	{
+		client_t *client = &svs.clients[i];
+		edict_t	 *ent;
+
+		if (client->active)
+			continue;
+		client->netconnection = NULL;
+		SV_ConnectClient (i);
+		client->spawned = true;
+		ent = client->edict;
+		memset (&ent->v, 0, qcvm->progs->entityfields * 4);
+		ent->v.colormap = NUM_FOR_EDICT (ent);
+		ent->v.team = (client->colors & 15) + 1;
+		ent->v.netname = PR_SetEngineString (client->name);
+
+		for (int j = 0; j < NUM_BASIC_SPAWN_PARMS; j++)
+			(&pr_global_struct->parm1)[j] = client->spawn_parms[j];
+		pr_global_struct->time = qcvm->time;
+		pr_global_struct->self = EDICT_TO_PROG (ent);
+		PR_ExecuteProgram (pr_global_struct->ClientConnect);
+		PR_ExecuteProgram (pr_global_struct->PutClientInServer);
+		return client;
+	}
+	return NULL;
+}
+
+/*
+====================
+Bench_ServerLoad
+
+Server frames with bots running in circles through the loaded map, and the
+unreliable datagram (client data and entities) each of them would be sent
+if it was a protocol 15/666/999 client. Bots never get messages, so that
+part is done here the way SV_SendClientDatagram does it.
+====================
+*/
+static void Bench_ServerLoad (void)
+{
+	static const int NUM_BOTS[] = {1, 8, 16};
+	const int		 NUM_FRAMES = 300;
+	static byte		 buf[MAX_DATAGRAM];
+	client_t		*bots[16];
+	client_t		*saved_host_client = host_client;
+	const double	 saved_frametime = sv_frametime;
+	sizebuf_t		 msg;
+	int				 free_slots = 0;
+
+	if (!sv.active || !sv.qcvm.worldmodel)
+	{
+		Con_Printf ("%-40s    skipped, no map loaded\n", "sv_load");
+		return;
+	}
+	for (int i = 0; i < svs.maxclients; ++i)
+		free_slots += !svs.clients[i].active;
+
+	PR_SwitchQCVM (&sv.qcvm);
+	sv_frametime = 1.0 / 72.0;
+	for (size_t n = 0; n < countof (NUM_BOTS); ++n)
+	{
+		const int num_bots = NUM_BOTS[n];
+		double	  frame_time = 0.0, snapshot_time = 0.0;
+		int64_t	  snapshot_bytes = 0;
+
+		if (num_bots > free_slots)
+		{
+			Con_Printf ("%-40s    skipped, %d free client slots\n", va ("sv_load %d bots", num_bots), free_slots);
+			continue;
+		}
+		for (int i = 0; i < num_bots; ++i)
+			bots[i] = Bench_SpawnBot ();
+
+		for (int frame = 0; frame < NUM_FRAMES; ++frame)
+		{
+			double start;
+
+			for (int i = 0; i < num_bots; ++i)
+			{
+				bots[i]->edict->v.v_angle[YAW] = (float)((frame * 3 + i * 45) % 360);
+				bots[i]->cmd.forwardmove = 320.0f;
+			}
+
+			start = Sys_DoubleTime ();
+			Host_ServerFrame ();
+			frame_time += Sys_DoubleTime () - start;
+
+			start = Sys_DoubleTime ();
+			for (int i = 0; i < num_bots; ++i)
+			{
+				host_client = bots[i];
+				sv_player = bots[i]->edict;
+				msg.allowoverflow = true;
+				msg.overflowed = false;
+				msg.data = buf;
+				msg.maxsize = sizeof (buf);
+				msg.cursize = 0;
+				MSG_WriteByte (&msg, svc_time);
+				MSG_WriteFloat (&msg, qcvm->time);
+				SV_WriteClientdataToMessage (bots[i], &msg);
+				SV_WriteEntitiesToClient (bots[i], &msg, sizeof (buf));
+				snapshot_bytes += msg.cursize;
+			}
+			snapshot_time += Sys_DoubleTime () - start;
+		}
+
+		Bench_Report (va ("sv_load %d bots, server frame", num_bots), NUM_FRAMES, frame_time);
+		Bench_Report (va ("sv_load %d bots, datagram", num_bots), (int64_t)NUM_FRAMES * num_bots, snapshot_time);
+		Con_Printf ("%-40s %10d bytes/datagram\n", "", (int)(snapshot_bytes / ((int64_t)NUM_FRAMES * num_bots)));
+
+		for (int i = 0; i < num_bots; ++i)
+		{
+			host_client = bots[i];
+			SV_DropClient (false);
+		}
+	}
+	host_client = saved_host_client;
+	sv_frametime = saved_frametime;
+	PR_SwitchQCVM (NULL);
+}
+
+/*
+====================
+Bench_MapLoad
+
+Respawns the server on the loaded map, which replaces it for everyone, so it
+only runs without clients and comes last. The first load is left out, map
+wads and other caches are warm for the timed ones.
+====================
+*/
+static void Bench_MapLoad (void)
+{
+	const int NUM_LOADS = 5;
+	char	  mapname[MAX_QPATH];
+	double	  start;
+
+	if (!sv.active)
+	{
+		Con_Printf ("%-40s    skipped, no map loaded\n", "map_load");
+		return;
+	}
+	for (int i = 0; i < svs.maxclients; ++i)
+	{
+		if (svs.clients[i].active)
+		{
+			Con_Printf ("%-40s    skipped, clients connected\n", "map_load");
+			return;
+		}
+	}
+
+	q_strlcpy (mapname, sv.name, sizeof (mapname));
+	PR_SwitchQCVM (&sv.qcvm);
+	SV_SpawnServer (mapname);
+	start = Sys_DoubleTime ();
+	for (int i = 0; i < NUM_LOADS && sv.active; ++i)
+		SV_SpawnServer (mapname);
+	Bench_Report (va ("map_load %s", mapname), sv.active ? NUM_LOADS : 0, Sys_DoubleTime () - start);
+	PR_SwitchQCVM (NULL);
+}
+
+#ifdef USE_RMLUI
+/*
+====================
+Bench_FreeListAllocator
+====================
+*/
+static void Bench_FreeListAllocator (void)
+{
+	UI_BenchAllocator (Bench_Report);
+}
+#endif
+
+typedef struct
+{
+	const char *name;
+	void (*func) (void);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] = {
+	{"hash_map", HashMap_Bench},
+#ifndef SERVERONLY
+	{"gl_heap", GL_HeapBench},
+#endif
+	{"tasks", Tasks_Bench},
+	{"findfile", Bench_FindFile},
+	{"sv_move", Bench_SVMove},
+	{"sv_load", Bench_ServerLoad},
+#ifdef USE_RMLUI
+	{"freelist", Bench_FreeListAllocator},
+#endif
+	{"map_load", Bench_MapLoad}, // respawns the server, keep it last
+};
+
+/*
+====================
+Bench_f
+
+bench [-json] [name ...] -- runs the given benchmarks, or all of them
+====================
+*/
+static void Bench_f (void)
+{
+	size_t i;
+	int	   arg, first = 1;
+	char   filename[MAX_OSPATH];
+
+	if (Cmd_Argc () == 2 && !strcmp (Cmd_Argv (1), "list"))
+	{
+		for (i = 0; i < countof (benchmarks); ++i)
+			Con_Printf ("%s\n", benchmarks[i].name);
+		return;
+	}
+
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "-json"))
+	{
+		first = 2;
+		q_snprintf (filename, sizeof (filename), "%s/bench.json", com_gamedir);
+		bench_json = fopen (filename, "w");
+		if (!bench_json)
+			Con_Printf ("ERROR: couldn't create %s\n", filename);
+		else
+			fprintf (bench_json, "{\n\t\"results\": [\n");
+		bench_json_results = 0;
+	}
+
+	for (i = 0; i < countof (benchmarks); ++i)
+	{
+		qboolean selected = Cmd_Argc () <= first;
+		for (arg = first; arg < Cmd_Argc () && !selected; ++arg)
+			selected = !q_strcasecmp (Cmd_Argv (arg), benchmarks[i].name);
+		if (!selected)
+			continue;
+		Con_Printf ("---- %s\n", benchmarks[i].name);
+		bench_group = benchmarks[i].name;
+		benchmarks[i].func ();
+	}
+
+	if (bench_json)
+	{
+		fprintf (bench_json, "\n\t]\n}\n");
+		fclose (bench_json);
+		bench_json = NULL;
+		Con_Printf ("Benchmark results written to %s\n", filename);
+	}
+}
+
+/*
+====================
+Bench_Init
+====================
+*/
+void Bench_Init (void)
+{
+	Cmd_AddCommand ("bench", Bench_f);
+}
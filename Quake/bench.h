@@ -0,0 +1,38 @@
+/*
+ * bench.h -- microbenchmarks of the engine core data structures
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include "q_stdinc.h"
+
+#include <stdint.h>
+
+void Bench_Init (void);
+
+// One result line, the benchmarks of the modules call this for every case they time
+void Bench_Report (const char *name, int64_t ops, double seconds);
+
+// Benchmarks living next to the tests of their modules
+void HashMap_Bench (void);
+void GL_HeapBench (void);
+void Tasks_Bench (void);
+
+#endif
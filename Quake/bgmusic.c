@@ -72,6 +72,50 @@ static music_handler_t *music_handlers = NULL;
 
 static snd_stream_t *bgmstream = NULL;
 
+/* Streams are decoded ahead by BGM_DecodeTask on a worker into bgm_ring and
+ * the mixer only copies from there in BGM_MixRawSamples, so slow codecs never
+ * stall a frame. While bgm_decodetask is in flight it owns bgmstream, the
+ * main thread joins it before touching the stream.
+ */
+#define BGM_RING_SIZE	 (1 << 20) /* bytes, about 6 seconds of 44.1 kHz 16 bit stereo	*/
+#define BGM_DECODE_CHUNK 16384
+
+typedef struct
+{
+	byte			data[BGM_RING_SIZE];
+	atomic_uint32_t head;	 /* advanced by the decode task, whole frames	*/
+	atomic_uint32_t tail;	 /* advanced by the mixer			*/
+	atomic_uint32_t playing; /* the mixer only consumes while set		*/
+	atomic_uint32_t ended;	 /* the decode task hit the end or an error	*/
+	atomic_uint32_t flush;	 /* the mixer drops the queued raw samples	*/
+	atomic_uint32_t volume;	 /* bgmvolume * 256				*/
+	int				rate;	 /* of bgmstream, set before head moves	*/
+	int				width;
+	int				channels;
+} bgmring_t;
+
+/* files to try in order, opened by the first decode task of a track */
+typedef struct
+{
+	int			 count;
+	char		 name[MAX_QPATH]; /* for the error message		*/
+	char		 paths[countof (wanted_handlers)][MAX_QPATH];
+	unsigned int types[countof (wanted_handlers)];
+} bgmopen_t;
+
+static bgmring_t	 bgm_ring;
+static bgmopen_t	 bgm_open;
+static task_handle_t bgm_decodetask = INVALID_TASK_HANDLE;
+static SDL_Mutex	*bgm_mutex; /* held by the mixer while it reads bgm_ring */
+
+static void BGM_WaitDecode (void)
+{
+	if (bgm_decodetask == INVALID_TASK_HANDLE)
+		return;
+	Task_Join (bgm_decodetask, TASK_TIMEOUT_INFINITE);
+	bgm_decodetask = INVALID_TASK_HANDLE;
+}
+
 static void BGM_Play_f (void)
 {
 	if (Cmd_Argc () == 2)
@@ -105,6 +149,7 @@ static void BGM_Loop_f (void)
 		else if (q_strcasecmp (Cmd_Argv (1), "toggle") == 0)
 			bgmloop = !bgmloop;
 
+		BGM_WaitDecode ();
 		if (bgmstream)
 			bgmstream->loop = bgmloop;
 	}
@@ -126,9 +171,11 @@ static void BGM_Jump_f (void)
 	{
 		Con_Printf ("music_jump <ordernum>\n");
 	}
-	else if (bgmstream)
+	else
 	{
-		S_CodecJumpToOrder (bgmstream, atoi (Cmd_Argv (1)));
+		BGM_WaitDecode ();
+		if (bgmstream)
+			S_CodecJumpToOrder (bgmstream, atoi (Cmd_Argv (1)));
 	}
 }
 
@@ -149,6 +196,7 @@ qboolean BGM_Init (void)
 		no_extmusic = true;
 
 	bgmloop = true;
+	bgm_mutex = SDL_CreateMutex ();
 
 	for (i = 0; wanted_handlers[i].type != CODECTYPE_NONE; i++)
 	{
@@ -190,6 +238,122 @@ void BGM_Shutdown (void)
 	music_handlers = NULL;
 }
 
+/*
+==================
+BGM_AddCandidate
+==================
+*/
+static void BGM_AddCandidate (const char *path, unsigned int type)
+{
+	if (bgm_open.count == countof (bgm_open.paths))
+		return;
+	q_strlcpy (bgm_open.paths[bgm_open.count], path, sizeof (bgm_open.paths[0]));
+	bgm_open.types[bgm_open.count] = type;
+	bgm_open.count++;
+}
+
+/*
+==================
+BGM_DecodeTask
+
+Opens the stream for a new track, then decodes until bgm_ring is full
+==================
+*/
+static void BGM_DecodeTask (void *unused)
+{
+	qboolean did_rewind = false;
+	uint32_t head, offset, bytes, framesize;
+	int		 i, res;
+
+	if (bgm_open.count)
+	{
+		for (i = 0; i < bgm_open.count && !bgmstream; i++)
+			bgmstream = S_CodecOpenStreamType (bgm_open.paths[i], bgm_open.types[i], bgmloop);
+		bgm_open.count = 0;
+		if (!bgmstream)
+		{
+			Con_Printf ("Couldn't handle music file %s\n", bgm_open.name);
+			Atomic_StoreUInt32 (&bgm_ring.ended, 1);
+			return;
+		}
+		bgm_ring.rate = bgmstream->info.rate;
+		bgm_ring.width = bgmstream->info.width;
+		bgm_ring.channels = bgmstream->info.channels;
+	}
+
+	framesize = bgm_ring.width * bgm_ring.channels;
+	head = Atomic_LoadUInt32 (&bgm_ring.head);
+	for (;;)
+	{
+		offset = head & (BGM_RING_SIZE - 1);
+		bytes = BGM_RING_SIZE - (head - Atomic_LoadUInt32 (&bgm_ring.tail));
+		bytes = q_min (bytes, BGM_RING_SIZE - offset);
+		bytes = q_min (bytes, BGM_DECODE_CHUNK);
+		bytes -= bytes % framesize;
+		if (!bytes)
+			return;
+
+		res = S_CodecReadStream (bgmstream, bytes, bgm_ring.data + offset);
+		if (res > 0) /* data: publish whole frames */
+		{
+			head += res - (res % framesize);
+			Atomic_StoreUInt32 (&bgm_ring.head, head);
+			did_rewind = false;
+		}
+		else if (res == 0) /* EOF */
+		{
+			if (!bgmloop)
+				break;
+			if (did_rewind)
+			{
+				Con_Printf ("Stream keeps returning EOF.\n");
+				break;
+			}
+
+			res = S_CodecRewindStream (bgmstream);
+			if (res != 0)
+			{
+				Con_Printf ("Stream seek error (%i), stopping.\n", res);
+				break;
+			}
+			did_rewind = true;
+		}
+		else /* res < 0: some read error */
+		{
+			Con_Printf ("Stream read error (%i), stopping.\n", res);
+			break;
+		}
+	}
+
+	/* BGM_Update stops the stream once the mixer has drained the ring */
+	Atomic_StoreUInt32 (&bgm_ring.ended, 1);
+}
+
+/*
+==================
+BGM_StartStream
+
+Starts decoding the bgm_open candidates, returns before the file is opened
+==================
+*/
+static void BGM_StartStream (const char *name)
+{
+	if (!bgm_open.count)
+	{
+		Con_Printf ("Couldn't handle music file %s\n", name);
+		return;
+	}
+	q_strlcpy (bgm_open.name, name, sizeof (bgm_open.name));
+
+	/* BGM_Stop cleared playing, the mixer isn't reading the ring */
+	Atomic_StoreUInt32 (&bgm_ring.head, 0);
+	Atomic_StoreUInt32 (&bgm_ring.tail, 0);
+	Atomic_StoreUInt32 (&bgm_ring.ended, 0);
+	Atomic_StoreUInt32 (&bgm_ring.playing, 1);
+
+	bgm_decodetask = Task_AllocateAssignFuncAndSubmit (BGM_DecodeTask, NULL, 0);
+}
+
 static void BGM_Play_noext (const char *filename, unsigned int allowed_types)
 {
 	char			 tmp[MAX_QPATH];
@@ -215,9 +379,7 @@ static void BGM_Play_noext (const char *filename, unsigned int allowed_types)
 			/* not supported in quake */
 			break;
 		case BGM_STREAMER:
-			bgmstream = S_CodecOpenStreamType (tmp, handler->type, bgmloop);
-			if (bgmstream)
-				return; /* success */
+			BGM_AddCandidate (tmp, handler->type);
 			break;
 		case BGM_NONE:
 		default:
@@ -226,7 +388,7 @@ static void BGM_Play_noext (const char *filename, unsigned int allowed_types)
 		handler = handler->next;
 	}
 
-	Con_Printf ("Couldn't handle music file %s\n", filename);
+	BGM_StartStream (filename);
 }
 
 void BGM_Play (const char *filename)
@@ -272,16 +434,14 @@ void BGM_Play (const char *filename)
 		/* not supported in quake */
 		break;
 	case BGM_STREAMER:
-		bgmstream = S_CodecOpenStreamType (tmp, handler->type, bgmloop);
-		if (bgmstream)
-			return; /* success */
+		BGM_AddCandidate (tmp, handler->type);
 		break;
 	case BGM_NONE:
 	default:
 		break;
 	}
 
-	Con_Printf ("Couldn't handle music file %s\n", filename);
+	BGM_StartStream (filename);
 }
 
 void BGM_PlayCDtrack (byte track, qboolean looping)
@@ -335,20 +495,29 @@ void BGM_PlayCDtrack (byte track, qboolean looping)
 	else
 	{
 		q_snprintf (tmp, sizeof (tmp), "%s/track%02d.%s", MUSIC_DIRNAME, (int)track, ext);
-		bgmstream = S_CodecOpenStreamType (tmp, type, bgmloop);
-		if (!bgmstream)
-			Con_Printf ("Couldn't handle music file %s\n", tmp);
+		BGM_AddCandidate (tmp, type);
+		BGM_StartStream (tmp);
 	}
 }
 
 void BGM_Stop (void)
 {
+	BGM_WaitDecode ();
+	bgm_open.count = 0;
+
+	if (bgm_mutex)
+	{
+		SDL_LockMutex (bgm_mutex);
+		Atomic_StoreUInt32 (&bgm_ring.playing, 0);
+		SDL_UnlockMutex (bgm_mutex);
+	}
+
 	if (bgmstream)
 	{
 		bgmstream->status = STREAM_NONE;
 		S_CodecCloseStream (bgmstream);
 		bgmstream = NULL;
-		s_rawend = 0;
+		Atomic_StoreUInt32 (&bgm_ring.flush, 1);
 	}
 }
 
@@ -357,7 +526,10 @@ void BGM_Pause (void)
 	if (bgmstream)
 	{
 		if (bgmstream->status == STREAM_PLAY)
+		{
 			bgmstream->status = STREAM_PAUSE;
+			Atomic_StoreUInt32 (&bgm_ring.playing, 0);
+		}
 	}
 }
 
@@ -366,97 +538,77 @@ void BGM_Resume (void)
 	if (bgmstream)
 	{
 		if (bgmstream->status == STREAM_PAUSE)
+		{
 			bgmstream->status = STREAM_PLAY;
+			Atomic_StoreUInt32 (&bgm_ring.playing, 1);
+		}
 	}
 }
 
-static void BGM_UpdateStream (void)
+/*
+==================
+BGM_MixRawSamples
+
+Mixer thread, moves decoded music from bgm_ring into s_rawsamples
+==================
+*/
+void BGM_MixRawSamples (void)
 {
-	qboolean did_rewind = false;
-	int		 res; /* Number of bytes read. */
-	int		 bufferSamples;
-	int		 fileSamples;
-	int		 fileBytes;
-	byte	 raw[16384];
+	uint32_t head, tail, offset, bytes, framesize, volume;
+	int		 frames;
 
-	if (bgmstream->status != STREAM_PLAY)
+	if (!bgm_mutex)
 		return;
 
+	SDL_LockMutex (bgm_mutex);
+	if (Atomic_LoadUInt32 (&bgm_ring.flush))
+	{
+		Atomic_StoreUInt32 (&bgm_ring.flush, 0);
+		s_rawend = 0;
+	}
+
 	/* don't bother playing anything if musicvolume is 0 */
-	if (bgmvolume.value <= 0)
+	volume = Atomic_LoadUInt32 (&bgm_ring.volume);
+	if (!Atomic_LoadUInt32 (&bgm_ring.playing) || !volume)
+	{
+		SDL_UnlockMutex (bgm_mutex);
 		return;
+	}
 
 	/* see how many samples should be copied into the raw buffer */
 	if (s_rawend < paintedtime)
 		s_rawend = paintedtime;
 
-	while (s_rawend < paintedtime + MAX_RAW_SAMPLES)
+	head = Atomic_LoadUInt32 (&bgm_ring.head);
+	tail = Atomic_LoadUInt32 (&bgm_ring.tail);
+	framesize = bgm_ring.width * bgm_ring.channels;
+	while (tail != head)
 	{
-		bufferSamples = MAX_RAW_SAMPLES - (s_rawend - paintedtime);
-
-		/* decide how much data needs to be read from the file */
-		fileSamples = bufferSamples * bgmstream->info.rate / shm->speed;
-		if (!fileSamples)
-			return;
-
-		/* our max buffer size */
-		fileBytes = fileSamples * (bgmstream->info.width * bgmstream->info.channels);
-		if (fileBytes > (int)sizeof (raw))
-		{
-			fileBytes = (int)sizeof (raw);
-			fileSamples = fileBytes / (bgmstream->info.width * bgmstream->info.channels);
-		}
-
-		/* Read */
-		res = S_CodecReadStream (bgmstream, fileBytes, raw);
-		if (res < fileBytes)
-		{
-			fileBytes = res;
-			fileSamples = res / (bgmstream->info.width * bgmstream->info.channels);
-		}
+		frames = (MAX_RAW_SAMPLES - (s_rawend - paintedtime)) * bgm_ring.rate / shm->speed;
+		if (frames <= 0)
+			break;
 
-		if (res > 0) /* data: add to raw buffer */
-		{
-			S_RawSamples (fileSamples, bgmstream->info.rate, bgmstream->info.width, bgmstream->info.channels, raw, bgmvolume.value);
-			did_rewind = false;
-		}
-		else if (res == 0) /* EOF */
-		{
-			if (bgmloop)
-			{
-				if (did_rewind)
-				{
-					Con_Printf ("Stream keeps returning EOF.\n");
-					BGM_Stop ();
-					return;
-				}
-
-				res = S_CodecRewindStream (bgmstream);
-				if (res != 0)
-				{
-					Con_Printf ("Stream seek error (%i), stopping.\n", res);
-					BGM_Stop ();
-					return;
-				}
-				did_rewind = true;
-			}
-			else
-			{
-				BGM_Stop ();
-				return;
-			}
-		}
-		else /* res < 0: some read error */
-		{
-			Con_Printf ("Stream read error (%i), stopping.\n", res);
-			BGM_Stop ();
-			return;
-		}
+		offset = tail & (BGM_RING_SIZE - 1);
+		bytes = q_min (head - tail, BGM_RING_SIZE - offset);
+		bytes = q_min (bytes, (uint32_t)frames * framesize);
+		S_RawSamples (bytes / framesize, bgm_ring.rate, bgm_ring.width, bgm_ring.channels, bgm_ring.data + offset, volume / 256.f);
+		tail += bytes;
 	}
+	Atomic_StoreUInt32 (&bgm_ring.tail, tail);
+	SDL_UnlockMutex (bgm_mutex);
 }
 
+/*
+==================
+BGM_Update
+
+Main thread, keeps a decode task running ahead of the mixer
+==================
+*/
 void BGM_Update (void)
 {
+	uint32_t fill;
+
 	if (old_volume != bgmvolume.value)
 	{
 		if (bgmvolume.value < 0)
@@ -465,6 +617,26 @@ void BGM_Update (void)
 			Cvar_SetQuick (&bgmvolume, "1");
 		old_volume = bgmvolume.value;
 	}
-	if (bgmstream)
-		BGM_UpdateStream ();
+	Atomic_StoreUInt32 (&bgm_ring.volume, (uint32_t)(bgmvolume.value * 256));
+
+	if (bgm_decodetask != INVALID_TASK_HANDLE)
+	{
+		if (!Task_Join (bgm_decodetask, 0))
+			return;
+		bgm_decodetask = INVALID_TASK_HANDLE;
+	}
+	if (!bgmstream)
+		return;
+
+	fill = Atomic_LoadUInt32 (&bgm_ring.head) - Atomic_LoadUInt32 (&bgm_ring.tail);
+	if (Atomic_LoadUInt32 (&bgm_ring.ended))
+	{
+		if (!fill)
+			BGM_Stop ();
+		return;
+	}
+
+	/* refill once half of it has been played */
+	if (bgmstream->status == STREAM_PLAY && bgmvolume.value > 0 && fill < BGM_RING_SIZE / 2)
+		bgm_decodetask = Task_AllocateAssignFuncAndSubmit (BGM_DecodeTask, NULL, 0);
 }
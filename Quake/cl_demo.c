@@ -25,6 +25,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "ui_manager.h"
 #endif
 #include "sys.h"
+#include "tasks.h"
+#include "miniz.h"
 
 #include "bgmusic.h"
 
@@ -32,6 +34,117 @@ static void CL_FinishTimeDemo (void);
 
 static char name[MAX_OSPATH];
 
+// playback reads the demo in large chunks instead of several tiny freads per message.
+// positions are file offsets like Sys_ftell, so demos inside a pak work the same way
+#define DEMO_READBUFFER_SIZE (1024 * 1024)
+
+static byte		 *demo_readbuffer;
+static qfileofs_t demo_bufferstart; // file offset of demo_readbuffer[0]
+static int		  demo_bufferpos;
+static int		  demo_buffersize;
+static qfileofs_t demo_fileend; // the demo may be followed by other files in a pak
+
+// with cl_democompress the stream after the cd track line is DEMO_DEFLATE_MAGIC and raw deflate, possibly several streams
+// back to back when recording was resumed. the magic reads as an impossible message length for engines that don't know it.
+// the positions are then offsets in the inflated stream
+#define DEMO_DEFLATE_MAGIC		 (('D' << 0) | ('E' << 8) | ('M' << 16) | ('Z' << 24))
+#define DEMO_DEFLATE_RAW		 -15 // window bits, negative for no zlib header
+#define DEMO_INFLATE_PACKED_SIZE (64 * 1024)
+
+typedef struct
+{
+	tinfl_decompressor decompressor;
+	byte			   window[TINFL_LZ_DICT_SIZE];
+	size_t			   window_ofs;
+	byte			   packed[DEMO_INFLATE_PACKED_SIZE];
+	int				   packedpos;
+	int				   packedsize;
+	qfileofs_t		   streamstart; // file offset of the first stream
+	qfileofs_t		   fileofs;		// of the next packed byte to read
+	qboolean		   done;
+} demoinflate_t;
+
+static demoinflate_t *demo_inflate; // NULL for plain demos
+
+// recording collects the messages in large blocks that a background task writes out, so a slow disk doesn't
+// stall the frame. only a full block waits for the previous one, partial ones go out every DEMO_WRITE_INTERVAL
+#define DEMO_WRITEBLOCK_SIZE (256 * 1024)
+#define DEMO_WRITE_INTERVAL	 1.0
+
+typedef struct
+{
+	FILE *file;
+	byte *data;
+	int	  size;
+} demowrite_t;
+
+static byte				*demo_writebuffers[2];
+static int				 demo_writebuffer; // the one being filled
+static int				 demo_writesize;
+static double			 demo_writetime; // realtime of the last block handed to demo_writetask
+static task_handle_t	 demo_writetask = INVALID_TASK_HANDLE;
+static tdefl_compressor *demo_deflate;	 // while recording with cl_democompress
+static qboolean			 demo_compressed; // the demo being recorded, for CL_Resume_Record
+static qfileofs_t		 demo_resumeofs;	 // compressed demos end with the final svc_disconnect in a stream of its own, resuming overwrites it
+
+// keyframes are taken every DEMO_KEYFRAME_INTERVAL seconds while the demo plays, so a seek
+// restores the closest one and only replays the messages after it
+#define DEMO_KEYFRAME_INTERVAL 10.0
+
+typedef struct
+{
+	char name[MAX_SCOREBOARDNAME];
+	int	 frags;
+	int	 colors;
+} demoscore_t;
+
+typedef struct
+{
+	int			   num;
+	entity_state_t state;
+} demoentity_t;
+
+typedef struct
+{
+	qfileofs_t	  prespawn_end; // cls.demo_prespawn_end, tells apart the maps of a multi-level demo
+	qfileofs_t	  offset;		// first message after the keyframe
+	double		  time;			// cl.mtime[0] when it was taken
+	int			  stats[MAX_CL_STATS];
+	float		  statsf[MAX_CL_STATS];
+	int			  items;
+	int			  intermission;
+	lightstyle_t  lightstyles[MAX_LIGHTSTYLES];
+	char		 *envcommands; // fog and sky set by the server, as in CL_Record_Spawn
+	demoscore_t	 *scores;	   // [cl.maxclients]
+	demoentity_t *ents;	  // replacement deltas only accumulate, the netquake protocol resends everything each frame
+	int			  numents;
+} demokeyframe_t;
+
+static demokeyframe_t *demo_keyframes;
+static int			   demo_numkeyframes;
+static int			   demo_maxkeyframes;
+
+// benchmark <runs> <demo> [<demo> ...] state, every demo is played as a timedemo <runs> times in a row
+#define MAX_BENCHMARK_DEMOS 32
+
+static struct
+{
+	qboolean active;
+	char	 demos[MAX_BENCHMARK_DEMOS][MAX_QPATH];
+	int		 numdemos;
+	int		 runs;
+	int		 demo;	   // current demo and run
+	int		 run;	   //
+	int		 runstart; // first captured frame of the current run, the capture holds all runs of the demo
+	FILE	*file;
+	char	 filename[MAX_OSPATH];
+	char	 saved_maxfps[32];
+	char	 saved_gpuspeeds[32];
+} benchmark;
+
+static void CL_BenchmarkFinishRun (void);
+static void CL_BenchmarkFinish (void);
+
 /*
 ==============================================================================
 
@@ -45,6 +158,331 @@ read from the demo file.
 ==============================================================================
 */
 
+/*
+==============
+CL_DemoResetBuffer
+==============
+*/
+static void CL_DemoResetBuffer (qfileofs_t offset)
+{
+	demo_bufferstart = offset;
+	demo_bufferpos = 0;
+	demo_buffersize = 0;
+}
+
+/*
+==============
+CL_DemoTell
+==============
+*/
+static qfileofs_t CL_DemoTell (void)
+{
+	return demo_bufferstart + demo_bufferpos;
+}
+
+/*
+==============
+CL_DemoRestartInflate
+==============
+*/
+static void CL_DemoRestartInflate (void)
+{
+	Sys_fseek (cls.demofile, demo_inflate->streamstart, SEEK_SET);
+	tinfl_init (&demo_inflate->decompressor);
+	demo_inflate->window_ofs = 0;
+	demo_inflate->packedpos = 0;
+	demo_inflate->packedsize = 0;
+	demo_inflate->fileofs = demo_inflate->streamstart;
+	demo_inflate->done = false;
+	CL_DemoResetBuffer (0);
+}
+
+/*
+==============
+CL_DemoInflate
+
+Refills demo_readbuffer with what follows it in the inflated stream
+==============
+*/
+static void CL_DemoInflate (void)
+{
+	demoinflate_t *inflate = demo_inflate;
+	size_t		   in_bytes, out_bytes;
+	tinfl_status   status;
+
+	CL_DemoResetBuffer (demo_bufferstart + demo_buffersize);
+	while (!inflate->done && demo_buffersize <= DEMO_READBUFFER_SIZE - TINFL_LZ_DICT_SIZE)
+	{
+		if (inflate->packedpos == inflate->packedsize && inflate->fileofs < demo_fileend)
+		{
+			inflate->packedpos = 0;
+			inflate->packedsize = fread (inflate->packed, 1, q_min ((qfileofs_t)DEMO_INFLATE_PACKED_SIZE, demo_fileend - inflate->fileofs), cls.demofile);
+			if (inflate->packedsize <= 0)
+			{
+				inflate->packedsize = 0;
+				inflate->fileofs = demo_fileend;
+			}
+			inflate->fileofs += inflate->packedsize;
+		}
+
+		in_bytes = inflate->packedsize - inflate->packedpos;
+		out_bytes = TINFL_LZ_DICT_SIZE - inflate->window_ofs;
+		status = tinfl_decompress (
+			&inflate->decompressor, inflate->packed + inflate->packedpos, &in_bytes, inflate->window, inflate->window + inflate->window_ofs, &out_bytes,
+			(inflate->fileofs < demo_fileend) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+		inflate->packedpos += in_bytes;
+		memcpy (demo_readbuffer + demo_buffersize, inflate->window + inflate->window_ofs, out_bytes);
+		demo_buffersize += out_bytes;
+		inflate->window_ofs = (inflate->window_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+		if (status == TINFL_STATUS_DONE)
+		{ // a resumed recording goes on in another stream
+			if (inflate->packedpos == inflate->packedsize && inflate->fileofs >= demo_fileend)
+				inflate->done = true;
+			else
+				tinfl_init (&inflate->decompressor);
+		}
+		else if (status < TINFL_STATUS_DONE)
+			inflate->done = true; // truncated or corrupt, the demo ends here
+	}
+}
+
+/*
+==============
+CL_DemoSeek
+==============
+*/
+static void CL_DemoSeek (qfileofs_t offset)
+{
+	if (offset >= demo_bufferstart && offset <= demo_bufferstart + demo_buffersize)
+		demo_bufferpos = offset - demo_bufferstart;
+	else if (demo_inflate)
+	{ // the stream can only be inflated forward, going back starts over
+		if (offset < demo_bufferstart)
+			CL_DemoRestartInflate ();
+		while (offset > demo_bufferstart + demo_buffersize && !demo_inflate->done)
+			CL_DemoInflate ();
+		demo_bufferpos = q_min (offset - demo_bufferstart, (qfileofs_t)demo_buffersize);
+	}
+	else
+	{
+		Sys_fseek (cls.demofile, offset, SEEK_SET);
+		CL_DemoResetBuffer (offset);
+	}
+}
+
+/*
+==============
+CL_DemoRead
+
+Returns false if the demo ends before size bytes could be read
+==============
+*/
+static qboolean CL_DemoRead (void *data, int size)
+{
+	byte *out = (byte *)data;
+	int	  count;
+
+	while (size > 0)
+	{
+		if (demo_bufferpos == demo_buffersize && demo_inflate)
+		{
+			CL_DemoInflate ();
+			if (!demo_buffersize)
+				return false;
+		}
+		else if (demo_bufferpos == demo_buffersize)
+		{
+			qfileofs_t offset = demo_bufferstart + demo_buffersize;
+			if (offset >= demo_fileend)
+				return false;
+			CL_DemoResetBuffer (offset);
+			demo_buffersize = fread (demo_readbuffer, 1, q_min ((qfileofs_t)DEMO_READBUFFER_SIZE, demo_fileend - offset), cls.demofile);
+			if (demo_buffersize <= 0)
+			{
+				demo_buffersize = 0;
+				return false;
+			}
+		}
+		count = q_min (size, demo_buffersize - demo_bufferpos);
+		memcpy (out, demo_readbuffer + demo_bufferpos, count);
+		demo_bufferpos += count;
+		out += count;
+		size -= count;
+	}
+	return true;
+}
+
+/*
+==============
+CL_DemoFreeKeyframes
+==============
+*/
+static void CL_DemoFreeKeyframes (void)
+{
+	int i;
+
+	for (i = 0; i < demo_numkeyframes; i++)
+	{
+		Mem_Free (demo_keyframes[i].envcommands);
+		Mem_Free (demo_keyframes[i].scores);
+		Mem_Free (demo_keyframes[i].ents);
+	}
+	Mem_Free (demo_keyframes);
+	demo_keyframes = NULL;
+	demo_numkeyframes = 0;
+	demo_maxkeyframes = 0;
+}
+
+/*
+==============
+CL_DemoAddKeyframe
+
+Called between messages, when the client state matches everything read so far
+==============
+*/
+static void CL_DemoAddKeyframe (void)
+{
+	demokeyframe_t *last = demo_numkeyframes ? &demo_keyframes[demo_numkeyframes - 1] : NULL;
+	demokeyframe_t *kf;
+	qfileofs_t		offset = CL_DemoTell ();
+	const char	   *fog_cmd, *sky_cmd;
+	char			envcommands[1024];
+	int				i;
+
+	if (!cls.demo_prespawn_end)
+		return;
+	// replaying after a seek goes over ground that's already indexed
+	if (last && offset <= last->offset)
+		return;
+	if (last && last->prespawn_end == cls.demo_prespawn_end && cl.mtime[0] < last->time + DEMO_KEYFRAME_INTERVAL)
+		return;
+
+	if (demo_numkeyframes == demo_maxkeyframes)
+	{
+		demo_maxkeyframes = q_max (demo_maxkeyframes * 2, 64);
+		demo_keyframes = Mem_Realloc (demo_keyframes, sizeof (*demo_keyframes) * demo_maxkeyframes);
+	}
+	kf = &demo_keyframes[demo_numkeyframes++];
+	kf->prespawn_end = cls.demo_prespawn_end;
+	kf->offset = offset;
+	kf->time = cl.mtime[0];
+	memcpy (kf->stats, cl.stats, sizeof (kf->stats));
+	memcpy (kf->statsf, cl.statsf, sizeof (kf->statsf));
+	kf->items = cl.items;
+	kf->intermission = cl.intermission;
+	memcpy (kf->lightstyles, cl_lightstyle, sizeof (kf->lightstyles));
+
+	fog_cmd = Fog_GetFogCommand (false);
+	q_strlcpy (envcommands, fog_cmd ? fog_cmd : "", sizeof (envcommands));
+	sky_cmd = Sky_GetSkyCommand (false);
+	q_strlcat (envcommands, sky_cmd ? sky_cmd : "", sizeof (envcommands));
+	kf->envcommands = q_strdup (envcommands);
+
+	kf->scores = Mem_AllocNonZero (sizeof (*kf->scores) * q_max (cl.maxclients, 1));
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		q_strlcpy (kf->scores[i].name, cl.scores[i].name, sizeof (kf->scores[i].name));
+		kf->scores[i].frags = cl.scores[i].frags;
+		kf->scores[i].colors = cl.scores[i].colors;
+	}
+
+	kf->ents = NULL;
+	kf->numents = 0;
+	if (cl.protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
+	{
+		for (i = 1; i < cl.num_entities; i++)
+			if (cl.entities[i].update_type)
+				kf->numents++;
+		kf->ents = Mem_AllocNonZero (sizeof (*kf->ents) * q_max (kf->numents, 1));
+		kf->numents = 0;
+		for (i = 1; i < cl.num_entities; i++)
+		{
+			if (!cl.entities[i].update_type)
+				continue;
+			kf->ents[kf->numents].num = i;
+			kf->ents[kf->numents].state = cl.entities[i].netstate;
+			kf->numents++;
+		}
+	}
+}
+
+/*
+==============
+CL_DemoFindKeyframe
+
+Latest keyframe of the current map at or before time
+==============
+*/
+static demokeyframe_t *CL_DemoFindKeyframe (double time)
+{
+	demokeyframe_t *best = NULL;
+	int				i;
+
+	for (i = 0; i < demo_numkeyframes; i++)
+	{
+		demokeyframe_t *kf = &demo_keyframes[i];
+		if (kf->prespawn_end == cls.demo_prespawn_end && kf->time <= time)
+			best = kf;
+	}
+	return best;
+}
+
+/*
+==============
+CL_DemoRestoreKeyframe
+
+Puts back the state the stream has built up until the keyframe. Everything the
+next frames resend anyway (entity positions in the netquake protocol, view angles)
+is left to the replay.
+==============
+*/
+static void CL_DemoRestoreKeyframe (const demokeyframe_t *kf)
+{
+	int i;
+
+	CL_DemoSeek (kf->offset);
+	cl.mtime[0] = cl.mtime[1] = cl.time = kf->time;
+
+	memcpy (cl.stats, kf->stats, sizeof (cl.stats));
+	memcpy (cl.statsf, kf->statsf, sizeof (cl.statsf));
+	cl.statsdirty = ~0u;
+	cl.items = kf->items;
+	cl.intermission = kf->intermission;
+	memcpy (cl_lightstyle, kf->lightstyles, sizeof (cl_lightstyle));
+	Cbuf_AddText (kf->envcommands);
+
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		q_strlcpy (cl.scores[i].name, kf->scores[i].name, sizeof (cl.scores[i].name));
+		cl.scores[i].frags = kf->scores[i].frags;
+		if (cl.scores[i].colors != kf->scores[i].colors)
+		{
+			cl.scores[i].colors = kf->scores[i].colors;
+			CL_NewTranslation (i);
+		}
+	}
+
+	if (cl.protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
+	{
+		for (i = 1; i < cl.num_entities; i++)
+		{
+			cl.entities[i].update_type = false;
+			cl.entities[i].model = NULL;
+		}
+		for (i = 0; i < kf->numents; i++)
+		{
+			entity_t *ent = CL_EntityNum (kf->ents[i].num);
+			ent->netstate = kf->ents[i].state;
+			ent->update_type = true;
+			ent->msgtime = 0; // relinked from netstate by the next update
+			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
+			ent->history_count = 0;
+		}
+		InvalidateTraceLineCache ();
+	}
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -65,10 +503,180 @@ void CL_StopPlayback (void)
 	cls.state = ca_disconnected;
 	cls.demo_prespawn_end = 0;
 
+	CL_DemoFreeKeyframes ();
+	Mem_Free (demo_readbuffer);
+	demo_readbuffer = NULL;
+	Mem_Free (demo_inflate);
+	demo_inflate = NULL;
+
 	if (cls.timedemo)
 		CL_FinishTimeDemo ();
 }
 
+/*
+====================
+CL_DemoWriteTask
+====================
+*/
+static void CL_DemoWriteTask (void *payload)
+{
+	demowrite_t *write = (demowrite_t *)payload;
+
+	fwrite (write->data, write->size, 1, write->file);
+	fflush (write->file);
+}
+
+/*
+====================
+CL_DemoWaitWrite
+====================
+*/
+static void CL_DemoWaitWrite (void)
+{
+	if (demo_writetask == INVALID_TASK_HANDLE)
+		return;
+	Task_Join (demo_writetask, TASK_TIMEOUT_INFINITE);
+	demo_writetask = INVALID_TASK_HANDLE;
+}
+
+/*
+====================
+CL_DemoFlushWrite
+
+Hands the block being filled to the writer task, and fills the other one meanwhile
+====================
+*/
+static void CL_DemoFlushWrite (void)
+{
+	demowrite_t write;
+
+	demo_writetime = realtime;
+	if (!demo_writesize)
+		return;
+
+	CL_DemoWaitWrite ();
+	write.file = cls.demofile;
+	write.data = demo_writebuffers[demo_writebuffer];
+	write.size = demo_writesize;
+	demo_writetask = Task_AllocateAssignBackgroundFuncAndSubmit (CL_DemoWriteTask, &write, sizeof (write));
+
+	demo_writebuffer ^= 1;
+	demo_writesize = 0;
+}
+
+/*
+====================
+CL_DemoWriteRaw
+====================
+*/
+static void CL_DemoWriteRaw (const void *data, int size)
+{
+	const byte *in = (const byte *)data;
+	int			count;
+
+	while (size > 0)
+	{
+		if (demo_writesize == DEMO_WRITEBLOCK_SIZE)
+			CL_DemoFlushWrite ();
+		count = q_min (size, DEMO_WRITEBLOCK_SIZE - demo_writesize);
+		memcpy (demo_writebuffers[demo_writebuffer] + demo_writesize, in, count);
+		demo_writesize += count;
+		in += count;
+		size -= count;
+	}
+}
+
+/*
+====================
+CL_DemoDeflate
+
+Compresses straight into the block being filled
+====================
+*/
+static void CL_DemoDeflate (const void *data, int size, tdefl_flush flush)
+{
+	const byte	*in = (const byte *)data;
+	size_t		 in_bytes, out_bytes;
+	tdefl_status status;
+
+	do
+	{
+		if (demo_writesize == DEMO_WRITEBLOCK_SIZE)
+			CL_DemoFlushWrite ();
+		in_bytes = size;
+		out_bytes = DEMO_WRITEBLOCK_SIZE - demo_writesize;
+		status = tdefl_compress (demo_deflate, in, &in_bytes, demo_writebuffers[demo_writebuffer] + demo_writesize, &out_bytes, flush);
+		demo_writesize += out_bytes;
+		in += in_bytes;
+		size -= in_bytes;
+	} while (status == TDEFL_STATUS_OKAY && (size > 0 || demo_deflate->m_output_flush_remaining || demo_writesize == DEMO_WRITEBLOCK_SIZE));
+}
+
+/*
+====================
+CL_DemoStartWrite
+
+Called with the cd track line written, cls.demofile at the end of it or where a
+compressed recording resumes
+====================
+*/
+static void CL_DemoStartWrite (void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+		if (!demo_writebuffers[i])
+			demo_writebuffers[i] = Mem_AllocNonZero (DEMO_WRITEBLOCK_SIZE);
+	demo_writebuffer = 0;
+	demo_writesize = 0;
+	demo_writetime = realtime;
+
+	if (demo_compressed)
+	{
+		if (!demo_deflate)
+			demo_deflate = Mem_AllocNonZero (sizeof (tdefl_compressor));
+		tdefl_init (demo_deflate, NULL, NULL, tdefl_create_comp_flags_from_zip_params (CLAMP (1, (int)cl_democompress.value, 9), DEMO_DEFLATE_RAW, 0));
+	}
+}
+
+/*
+====================
+CL_DemoWrite
+====================
+*/
+static void CL_DemoWrite (const void *data, int size)
+{
+	if (demo_deflate)
+		CL_DemoDeflate (data, size, TDEFL_NO_FLUSH);
+	else
+		CL_DemoWriteRaw (data, size);
+}
+
+/*
+====================
+CL_DemoStopWrite
+
+Writes out everything that is still buffered, cls.demofile can be closed after
+====================
+*/
+static void CL_DemoStopWrite (void)
+{
+	int i;
+
+	if (demo_deflate)
+		CL_DemoDeflate (NULL, 0, TDEFL_FINISH);
+	CL_DemoFlushWrite ();
+	CL_DemoWaitWrite ();
+
+	Mem_Free (demo_deflate);
+	demo_deflate = NULL;
+	for (i = 0; i < 2; i++)
+	{
+		Mem_Free (demo_writebuffers[i]);
+		demo_writebuffers[i] = NULL;
+	}
+}
+
 /*
 ====================
 CL_WriteDemoMessage
@@ -83,26 +691,33 @@ static void CL_WriteDemoMessage (void)
 	float f;
 
 	len = LittleLong (net_message.cursize);
-	fwrite (&len, 4, 1, cls.demofile);
+	CL_DemoWrite (&len, 4);
 	for (i = 0; i < 3; i++)
 	{
 		f = LittleFloat (cl.viewangles[i]);
-		fwrite (&f, 4, 1, cls.demofile);
+		CL_DemoWrite (&f, 4);
+	}
+	CL_DemoWrite (net_message.data, net_message.cursize);
+
+	// so a crash loses little, without waiting on the disk
+	if (realtime - demo_writetime >= DEMO_WRITE_INTERVAL && (demo_writetask == INVALID_TASK_HANDLE || Task_Join (demo_writetask, 0)))
+	{
+		if (demo_deflate)
+			CL_DemoDeflate (NULL, 0, TDEFL_SYNC_FLUSH);
+		CL_DemoFlushWrite ();
 	}
-	fwrite (net_message.data, net_message.cursize, 1, cls.demofile);
-	fflush (cls.demofile);
 }
 
 static int CL_GetDemoMessage (void)
 {
-	int	  r, i;
+	int	  i;
 	float f;
 
 	if (cls.demopaused)
 		return 0;
 
 	if (cls.signon == (SIGNONS - 2))
-		cls.demo_prespawn_end = Sys_ftell (cls.demofile);
+		cls.demo_prespawn_end = CL_DemoTell ();
 	// decide if it is time to grab the next message
 	else if (cls.signon == SIGNONS) // always grab until fully connected
 	{
@@ -114,7 +729,11 @@ static int CL_GetDemoMessage (void)
 			// if this is the second frame, grab the real td_starttime
 			// so the bogus time on the first frame doesn't count
 			if (host_framecount == cls.td_startframe + 1)
+			{
 				cls.td_starttime = realtime;
+				if (benchmark.active)
+					FrameStats_StartCapture (benchmark.run > 0);
+			}
 		}
 		else if (cls.demoseeking)
 		{
@@ -134,8 +753,11 @@ static int CL_GetDemoMessage (void)
 	else if (cls.signon < (SIGNONS - 2))
 		cls.demo_prespawn_end = 0;
 
+	if (cls.signon == SIGNONS)
+		CL_DemoAddKeyframe ();
+
 	// get the next message
-	if (fread (&net_message.cursize, 4, 1, cls.demofile) != 1)
+	if (!CL_DemoRead (&net_message.cursize, 4))
 	{
 		CL_StopPlayback ();
 		return 0;
@@ -143,7 +765,7 @@ static int CL_GetDemoMessage (void)
 	VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
 	for (i = 0; i < 3; i++)
 	{
-		if (fread (&f, 4, 1, cls.demofile) != 1)
+		if (!CL_DemoRead (&f, 4))
 		{
 			CL_StopPlayback ();
 			return 0;
@@ -154,8 +776,7 @@ static int CL_GetDemoMessage (void)
 	net_message.cursize = LittleLong (net_message.cursize);
 	if (net_message.cursize > MAX_MSGLEN)
 		Sys_Error ("Demo message > MAX_MSGLEN");
-	r = fread (net_message.data, net_message.cursize, 1, cls.demofile);
-	if (r != 1)
+	if (!CL_DemoRead (net_message.data, net_message.cursize))
 	{
 		CL_StopPlayback ();
 		return 0;
@@ -206,11 +827,19 @@ void		 CL_Seek_f (void)
 	qboolean relative = offset < 0 || Cmd_Argv (1)[0] == '+';
 	cls.seektime = relative ? cl.time + offset : offset;
 
-	// large positive offsets could benefit from demoseeking, but we'd lose prints etc
-	if ((offset < 0 || (!relative && offset < cl.time)) && cls.demo_prespawn_end)
+	// forward seeks only jump to a keyframe if it saves replaying a good part of the demo, so we usually keep prints etc
+	qboolean		backward = offset < 0 || (!relative && offset < cl.time);
+	demokeyframe_t *kf = CL_DemoFindKeyframe (cls.seektime);
+	if (kf && !backward && kf->time < cl.mtime[0] + DEMO_KEYFRAME_INTERVAL)
+		kf = NULL;
+
+	if ((backward && cls.demo_prespawn_end) || kf)
 	{
-		Sys_fseek (cls.demofile, cls.demo_prespawn_end, SEEK_SET);
-		cl.mtime[0] = cl.time = 0;
+		if (!kf)
+		{
+			CL_DemoSeek (cls.demo_prespawn_end);
+			cl.mtime[0] = cl.time = 0;
+		}
 		cls.demoseeking = true;
 
 		memset (cl_dlights, 0, sizeof (cl_dlights));
@@ -231,9 +860,12 @@ void		 CL_Seek_f (void)
 		}
 		memset (cl.stats, 0, sizeof (cl.stats));
 		memset (cl.statsf, 0, sizeof (cl.statsf));
+		cl.statsdirty = ~0u;
 
-		// replay last signon for stats and lightstyles
-		cls.signon = (SIGNONS - 2);
+		if (kf)
+			CL_DemoRestoreKeyframe (kf);
+		else // replay last signon for stats and lightstyles
+			cls.signon = (SIGNONS - 2);
 		S_StopAllSounds (true, true);
 	}
 	else
@@ -242,6 +874,49 @@ void		 CL_Seek_f (void)
 	scr_clock_off = 2.5f; // show clock for a few seconds after a seek
 }
 
+/*
+====================
+CL_DemoFollow_f
+
+demo_follow [player] : which player a server side demo is watched from, the
+next one with a name if none is given
+====================
+*/
+void CL_DemoFollow_f (void)
+{
+	int i, player;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!cls.demoplayback || !cl.maxclients)
+	{
+		Con_Printf ("Not playing a demo.\n");
+		return;
+	}
+
+	if (Cmd_Argc () > 1)
+		player = atoi (Cmd_Argv (1)) - 1;
+	else
+	{
+		for (i = 1; i <= cl.maxclients; i++)
+		{
+			player = (cl.demofollow - 1 + i) % cl.maxclients;
+			if (cl.scores[player].name[0])
+				break;
+		}
+	}
+
+	if (player < 0 || player >= cl.maxclients)
+	{
+		Con_Printf ("demo_follow <1-%i>\n", cl.maxclients);
+		return;
+	}
+
+	cl.demofollow = player + 1;
+	Con_Printf ("Following %s\n", cl.scores[player].name);
+}
+
 /*
 ====================
 CL_GetMessage
@@ -294,12 +969,22 @@ void CL_Stop_f (void)
 		return;
 	}
 
+	if (demo_deflate)
+	{ // the disconnect goes in a stream of its own, which CL_Resume_Record can overwrite
+		CL_DemoDeflate (NULL, 0, TDEFL_FINISH);
+		CL_DemoFlushWrite ();
+		CL_DemoWaitWrite ();
+		demo_resumeofs = Sys_ftell (cls.demofile);
+		CL_DemoStartWrite ();
+	}
+
 	// write a disconnect message to the demo file
 	SZ_Clear (&net_message);
 	MSG_WriteByte (&net_message, svc_disconnect);
 	CL_WriteDemoMessage ();
 
 	// finish up
+	CL_DemoStopWrite ();
 	fclose (cls.demofile);
 	cls.demofile = NULL;
 	cls.demorecording = false;
@@ -373,6 +1058,7 @@ static void CL_Record_Prespawn (void)
 	}
 
 	// static sounds
+	S_SyncMixer ();
 	for (i = NUM_AMBIENTS; i < total_channels; i++)
 	{
 		channel_t  *ss = &snd_channels[i];
@@ -382,7 +1068,7 @@ static void CL_Record_Prespawn (void)
 			continue;
 		if (ss->entnum || ss->entchannel)
 			continue; // can't have been a static sound
-		sc = S_LoadSound (ss->sfx);
+		sc = S_CachedSound (ss->sfx);
 		if (!sc || sc->loopstart == -1)
 			continue; // can't have been a (valid) static sound
 
@@ -653,6 +1339,11 @@ void CL_Record_f (void)
 	cls.forcetrack = track;
 	fprintf (cls.demofile, "%i\n", cls.forcetrack);
 
+	demo_compressed = cl_democompress.value > 0;
+	if (demo_compressed)
+		fwrite ("DEMZ", 4, 1, cls.demofile); // DEMO_DEFLATE_MAGIC
+	CL_DemoStartWrite ();
+
 	cls.demorecording = true;
 
 	// from ProQuake: initialize the demo file if we're already connected
@@ -676,7 +1367,11 @@ void CL_Resume_Record (qboolean recordsignons)
 		return;
 	}
 	// overwrite svc_disconnect
-	Sys_fseek (cls.demofile, -17, SEEK_END);
+	if (demo_compressed)
+		Sys_fseek (cls.demofile, demo_resumeofs, SEEK_SET);
+	else
+		Sys_fseek (cls.demofile, -17, SEEK_END);
+	CL_DemoStartWrite ();
 	Con_Printf ("Demo recording resumed\n");
 	cls.demorecording = true;
 	if (recordsignons)
@@ -710,13 +1405,14 @@ void CL_PlayDemo_f (void)
 
 	Con_Printf ("Playing demo from %s.\n", name);
 
-	COM_FOpenFile (name, &cls.demofile, NULL);
+	int length = COM_FOpenFile (name, &cls.demofile, NULL);
 	if (!cls.demofile)
 	{
 		Con_Printf ("ERROR: couldn't open %s\n", name);
 		cls.demonum = -1; // stop demo loop
 		return;
 	}
+	demo_fileend = Sys_ftell (cls.demofile) + length;
 
 	// ZOID, fscanf is evil
 	// O.S.: if a space character e.g. 0x20 (' ') follows '\n',
@@ -731,6 +1427,21 @@ void CL_PlayDemo_f (void)
 		return;
 	}
 
+	CL_DemoResetBuffer (Sys_ftell (cls.demofile));
+	if (!demo_readbuffer)
+		demo_readbuffer = Mem_AllocNonZero (DEMO_READBUFFER_SIZE);
+
+	int		   magic;
+	qfileofs_t start = CL_DemoTell ();
+	if (CL_DemoRead (&magic, 4) && LittleLong (magic) == DEMO_DEFLATE_MAGIC)
+	{
+		demo_inflate = Mem_AllocNonZero (sizeof (demoinflate_t));
+		demo_inflate->streamstart = start + 4;
+		CL_DemoRestartInflate ();
+	}
+	else
+		CL_DemoSeek (start);
+
 	cls.demoplayback = true;
 	cls.demopaused = false;
 	cls.demospeed = 1.f;
@@ -765,6 +1476,9 @@ static void CL_FinishTimeDemo (void)
 	if (!time)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames / time);
+
+	if (benchmark.active)
+		CL_BenchmarkFinishRun ();
 }
 
 /*
@@ -787,7 +1501,14 @@ void CL_TimeDemo_f (void)
 
 	CL_PlayDemo_f ();
 	if (!cls.demofile)
+	{
+		if (benchmark.active)
+		{
+			Con_Printf ("Benchmark aborted, %s is incomplete\n", benchmark.filename);
+			CL_BenchmarkFinish ();
+		}
 		return;
+	}
 
 	// cls.td_starttime will be grabbed at the second frame of the demo, so
 	// all the loading time doesn't get counted
@@ -796,3 +1517,149 @@ void CL_TimeDemo_f (void)
 	cls.td_startframe = host_framecount;
 	cls.td_lastframe = -1; // get a new message this frame
 }
+
+/*
+==============================================================================
+
+BENCHMARK
+
+Runs are timedemos with fixed settings, the frames between the second frame
+and the end of each run are captured from the frame stats and summarized into
+benchmark.json: per run, and over all runs of a demo.
+==============================================================================
+*/
+
+/*
+====================
+CL_BenchmarkStartRun
+====================
+*/
+static void CL_BenchmarkStartRun (void)
+{
+	Con_Printf ("Benchmark: %s run %i/%i\n", benchmark.demos[benchmark.demo], benchmark.run + 1, benchmark.runs);
+	Cbuf_InsertText (va ("timedemo \"%s\"\n", benchmark.demos[benchmark.demo]));
+}
+
+/*
+====================
+CL_BenchmarkFinish
+====================
+*/
+static void CL_BenchmarkFinish (void)
+{
+	fclose (benchmark.file);
+	benchmark.file = NULL;
+	benchmark.active = false;
+	FrameStats_FreeCapture ();
+	Cvar_Set ("host_maxfps", benchmark.saved_maxfps);
+	Cvar_Set ("r_gpuspeeds", benchmark.saved_gpuspeeds);
+
+	// -benchmark on the command line is for unattended runs
+	if (COM_CheckParm ("-benchmark"))
+		Cbuf_AddText ("quit\n");
+}
+
+/*
+====================
+CL_BenchmarkFinishRun
+====================
+*/
+static void CL_BenchmarkFinishRun (void)
+{
+	FILE				*f = benchmark.file;
+	const frame_stats_t *frames;
+	int					 count;
+
+	FrameStats_StopCapture ();
+	frames = FrameStats_GetCapture (&count);
+
+	if (benchmark.run == 0)
+		fprintf (f, "%s\t\t{\n\t\t\t\"name\": \"%s\",\n\t\t\t\"runs\": [\n", benchmark.demo ? ",\n" : "", benchmark.demos[benchmark.demo]);
+	fprintf (f, "%s\t\t\t\t{\n\t\t\t\t\t\"run\": %i,\n", benchmark.run ? ",\n" : "", benchmark.run + 1);
+	FrameStats_WriteSummaryJSON (f, frames + benchmark.runstart, count - benchmark.runstart, "\t\t\t\t\t");
+	fprintf (f, "\t\t\t\t}");
+	benchmark.runstart = count;
+
+	if (++benchmark.run == benchmark.runs)
+	{
+		fprintf (f, "\n\t\t\t],\n\t\t\t\"all\": {\n");
+		FrameStats_WriteSummaryJSON (f, frames, count, "\t\t\t\t");
+		fprintf (f, "\t\t\t}\n\t\t}");
+		benchmark.run = 0;
+		benchmark.runstart = 0;
+		if (++benchmark.demo == benchmark.numdemos)
+		{
+			fprintf (f, "\n\t]\n}\n");
+			Con_Printf ("Benchmark results written to %s\n", benchmark.filename);
+			CL_BenchmarkFinish ();
+			return;
+		}
+	}
+
+	CL_BenchmarkStartRun ();
+}
+
+/*
+====================
+CL_Benchmark_f
+
+benchmark <runs> <demo> [<demo> ...]
+====================
+*/
+void CL_Benchmark_f (void)
+{
+	int i;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () < 3 || atoi (Cmd_Argv (1)) < 1)
+	{
+		Con_Printf ("benchmark <runs> <demo> [<demo> ...] : timedemos every demo <runs> times, writes benchmark.json\n");
+		return;
+	}
+	if (benchmark.active)
+	{
+		Con_Printf ("Benchmark already running\n");
+		return;
+	}
+	if (Cmd_Argc () - 2 > MAX_BENCHMARK_DEMOS)
+	{
+		Con_Printf ("At most %i demos per benchmark\n", MAX_BENCHMARK_DEMOS);
+		return;
+	}
+
+	q_snprintf (benchmark.filename, sizeof (benchmark.filename), "%s/benchmark.json", com_gamedir);
+	benchmark.file = fopen (benchmark.filename, "w");
+	if (!benchmark.file)
+	{
+		Con_Printf ("ERROR: couldn't create %s\n", benchmark.filename);
+		return;
+	}
+
+	// don't let a demo that is still playing finish into the first run
+	CL_Disconnect ();
+
+	benchmark.runs = atoi (Cmd_Argv (1));
+	benchmark.numdemos = Cmd_Argc () - 2;
+	for (i = 0; i < benchmark.numdemos; i++)
+		q_strlcpy (benchmark.demos[i], Cmd_Argv (i + 2), sizeof (benchmark.demos[i]));
+	benchmark.demo = 0;
+	benchmark.run = 0;
+	benchmark.runstart = 0;
+
+	// uncapped, and GPU times recorded without printing them every frame
+	q_strlcpy (benchmark.saved_maxfps, Cvar_VariableString ("host_maxfps"), sizeof (benchmark.saved_maxfps));
+	q_strlcpy (benchmark.saved_gpuspeeds, Cvar_VariableString ("r_gpuspeeds"), sizeof (benchmark.saved_gpuspeeds));
+	Cvar_Set ("host_maxfps", "0");
+	if (!Cvar_VariableValue ("r_gpuspeeds"))
+		Cvar_Set ("r_gpuspeeds", "3");
+
+	fprintf (benchmark.file, "{\n\t\"engine\": \"%s\",\n", ENGINE_NAME_AND_VER);
+	fprintf (benchmark.file, "\t\"width\": %i,\n\t\"height\": %i,\n", vid.width, vid.height);
+	fprintf (benchmark.file, "\t\"vsync\": %s,\n", Cvar_VariableValue ("vid_vsync") ? "true" : "false");
+	fprintf (benchmark.file, "\t\"runs\": %i,\n\t\"demos\": [\n", benchmark.runs);
+
+	benchmark.active = true;
+	CL_BenchmarkStartRun ();
+}
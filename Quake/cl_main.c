@@ -36,6 +36,7 @@ cvar_t cl_color = {"_cl_color", "0", CVAR_ARCHIVE};
 
 cvar_t cl_shownet = {"cl_shownet", "0", CVAR_NONE}; // can be 0, 1, or 2
 cvar_t cl_nolerp = {"cl_nolerp", "0", CVAR_NONE};
+cvar_t cl_netbuffer = {"cl_netbuffer", "2", CVAR_ARCHIVE}; // draw the other entities this many times the message jitter in the past, 0 = off
 
 cvar_t cfg_unbindall = {"cfg_unbindall", "1", CVAR_ARCHIVE};
 
@@ -53,6 +54,7 @@ cvar_t cl_maxpitch = {"cl_maxpitch", "90", CVAR_ARCHIVE};  // johnfitz -- variab
 cvar_t cl_minpitch = {"cl_minpitch", "-90", CVAR_ARCHIVE}; // johnfitz -- variable pitch clamping
 
 cvar_t cl_startdemos = {"cl_startdemos", "1", CVAR_ARCHIVE};
+cvar_t cl_democompress = {"cl_democompress", "0", CVAR_ARCHIVE}; // deflate level for recorded demos, 0 = plain demos that other engines can play
 
 client_static_t cls;
 client_state_t	cl;
@@ -118,6 +120,8 @@ void CL_FreeState (void)
 	for (i = 0; i < cl.num_efragallocs; ++i)
 		Mem_Free (cl.efrag_allocs[i]);
 	Mem_Free (cl.efrag_allocs);
+	Mem_Free (cl.static_leafents);
+	Mem_Free (cl.static_visbits);
 	memset (&cl, 0, sizeof (cl));
 }
 
@@ -134,6 +138,7 @@ void CL_ClearState (void)
 
 	// wipe the entire cl structure
 	CL_FreeState ();
+	cl.statsdirty = ~0u; // the UI still shows the last map's stats
 
 	SZ_Clear (&cls.message);
 
@@ -297,6 +302,10 @@ void CL_SignonReply (void)
 	case 3:
 		MSG_WriteByte (&cls.message, clc_stringcmd);
 		MSG_WriteString (&cls.message, "begin");
+#ifdef USE_RMLUI
+		// Still behind the loading plaque, take the HUD's first-use cost here
+		UI_PrewarmHUD ();
+#endif
 		break;
 
 	case 4:
@@ -496,6 +505,122 @@ float CL_LerpPoint (void)
 	return frac;
 }
 
+#define NETBUFFER_MAX_DELAY 0.1
+#define NETBUFFER_EASE_RATE 0.1 // seconds of delay change per second
+
+/*
+===============
+CL_NetBufferMessage
+
+Called when a message with a new server time arrives
+===============
+*/
+void CL_NetBufferMessage (double servertime)
+{
+	// arrival time rather than realtime, which only moves once per frame
+	double transit = (cls.netcon ? NET_QSocketGetPacketTime (cls.netcon) : realtime) - servertime;
+
+	if (cl.netbuffer.messages++)
+		cl.netbuffer.jitter += (fabs (transit - cl.netbuffer.lasttransit) - cl.netbuffer.jitter) / 16.0;
+	cl.netbuffer.lasttransit = transit;
+}
+
+/*
+===============
+CL_UpdateNetBuffer
+
+Advances the time the buffered entities are drawn at, returns false
+if they should be lerped as usual
+===============
+*/
+static qboolean CL_UpdateNetBuffer (void)
+{
+	float  target = 0;
+	float  step = host_frametime * NETBUFFER_EASE_RATE;
+	double error;
+
+	// no jitter to hide over loopback, nor in demos
+	if (!cls.demoplayback && !sv.active && !cl_nolerp.value)
+		target = q_min (cl.netbuffer.jitter * q_max (cl_netbuffer.value, 0.f), NETBUFFER_MAX_DELAY);
+	cl.netbuffer.delay = CLAMP (cl.netbuffer.delay - step, target, cl.netbuffer.delay + step);
+	if (cl.netbuffer.delay < 0.001f)
+	{
+		cl.netbuffer.time = cl.time;
+		return false;
+	}
+
+	// keep running when cl.time stalls for a late message, drift back towards it otherwise
+	cl.netbuffer.time += host_frametime;
+	error = cl.time - cl.netbuffer.delay - cl.netbuffer.time;
+	if (fabs (error) > 0.25)
+		cl.netbuffer.time += error;
+	else
+		cl.netbuffer.time += error * q_min (host_frametime * 2.0, 1.0);
+
+	cl.netbuffer.frames++;
+	if (cl.netbuffer.time > cl.mtime[0])
+		cl.netbuffer.starved++;
+	return true;
+}
+
+/*
+===============
+CL_LerpEntityHistory
+
+Places the entity where it was at cl.netbuffer.time
+===============
+*/
+static qboolean CL_LerpEntityHistory (entity_t *ent, vec3_t org, vec3_t ang)
+{
+	double	 t = cl.netbuffer.time;
+	int		 i, j, newer, older;
+	float	 f, d;
+	qboolean teleported = false;
+
+	newer = ent->history_head;
+	older = newer;
+	for (i = 1; i < ent->history_count && ent->history_times[newer] > t; i++)
+	{
+		older = (newer + MSG_HISTORY - 1) % MSG_HISTORY;
+		if (ent->history_times[older] <= t)
+			break;
+		newer = older;
+	}
+
+	if (older == newer || ent->history_times[older] > t)
+	{ // past the newest update, or before the oldest one
+		VectorCopy (ent->history_origins[newer], org);
+		VectorCopy (ent->history_angles[newer], ang);
+		return false;
+	}
+
+	// a gap means it wasn't sent in between, don't slide it across
+	f = (t - ent->history_times[older]) / (ent->history_times[newer] - ent->history_times[older]);
+	if (ent->history_times[newer] - ent->history_times[older] > 0.2)
+		f = 1;
+	for (j = 0; j < 3; j++)
+	{
+		d = ent->history_origins[newer][j] - ent->history_origins[older][j];
+		if (d > 100 || d < -100)
+		{
+			f = 1;
+			teleported = true;
+		}
+	}
+	for (j = 0; j < 3; j++)
+	{
+		org[j] = ent->history_origins[older][j] + f * (ent->history_origins[newer][j] - ent->history_origins[older][j]);
+
+		d = ent->history_angles[newer][j] - ent->history_angles[older][j];
+		if (d > 180)
+			d -= 360;
+		else if (d < -180)
+			d += 360;
+		ang[j] = ent->history_angles[older][j] + f * d;
+	}
+	return teleported;
+}
+
 static qboolean CL_LerpEntity (entity_t *ent, vec3_t org, vec3_t ang, float frac)
 {
 	float	 f, d, a;
@@ -653,6 +778,69 @@ static void CL_RocketTrail (entity_t *ent, int type)
 	VectorCopy (ent->origin, ent->trailorg);
 }
 
+#define NUM_RELINK_TASKS	     8
+#define RELINK_TASK_MIN_ENTITIES 512
+
+typedef struct
+{
+	float	 frac;
+	qboolean netbuffer;
+} relinkargs_t;
+
+static vec3_t *relink_oldorgs;
+static int	   relink_maxoldorgs;
+
+/*
+===============
+CL_LerpEntityRange
+
+Moves the entities in [start, end) to their interpolated spot. Only writes
+to the entity itself, so slices can run on any worker; everything that
+touches shared state is left to CL_RelinkEntities.
+===============
+*/
+static void CL_LerpEntityRange (int start, int end, const relinkargs_t *args)
+{
+	entity_t *ent;
+	int		  i;
+
+	for (i = start, ent = cl.entities + start; i < end; i++, ent++)
+	{
+		// removed in the serial pass
+		if (!ent->model || ent->msgtime != cl.mtime[0])
+			continue;
+
+		VectorCopy (ent->origin, relink_oldorgs[i]);
+
+		if (args->netbuffer && i != cl.viewentity && !ent->forcelink && !(ent->lerpflags & LERP_MOVESTEP) && ent->history_count)
+		{ // the view entity stays current, delaying it would lag the view behind the input
+			if (CL_LerpEntityHistory (ent, ent->origin, ent->angles))
+				ent->lerpflags |= LERP_RESETMOVE;
+		}
+		else if (CL_LerpEntity (ent, ent->origin, ent->angles, args->frac))
+			ent->lerpflags |= LERP_RESETMOVE;
+
+		if (cl.time < cl.oldtime)
+			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
+	}
+}
+
+/*
+===============
+CL_LerpEntitiesTask
+
+Indexed [0, NUM_RELINK_TASKS)
+===============
+*/
+static void CL_LerpEntitiesTask (int index, void *data)
+{
+	const int slice_size = (cl.num_entities - 1 + NUM_RELINK_TASKS - 1) / NUM_RELINK_TASKS;
+	const int start = 1 + index * slice_size;
+	const int end = q_min (start + slice_size, cl.num_entities);
+
+	CL_LerpEntityRange (start, end, (const relinkargs_t *)data);
+}
+
 /*
 ===============
 CL_RelinkEntities
@@ -660,17 +848,20 @@ CL_RelinkEntities
 */
 void CL_RelinkEntities (void)
 {
-	entity_t *ent;
-	int		  i, j;
-	float	  frac, d;
-	float	  bobjrotate;
-	vec3_t	  oldorg;
-	dlight_t *dl;
-	float	  frametime;
-	int		  modelflags;
+	entity_t	*ent;
+	int			 i, j;
+	float		 frac, d;
+	float		 bobjrotate;
+	vec3_t		 oldorg;
+	dlight_t	*dl;
+	float		 frametime;
+	int			 modelflags;
+	qboolean	 netbuffer;
+	relinkargs_t relinkargs;
 
 	// determine partial update time
 	frac = CL_LerpPoint ();
+	netbuffer = CL_UpdateNetBuffer ();
 
 	frametime = cl.time - cl.oldtime;
 	if (frametime < 0)
@@ -711,6 +902,19 @@ void CL_RelinkEntities (void)
 
 	bobjrotate = anglemod (100 * cl.time);
 
+	// the lerp is spread over the workers, trails, lights and visedicts stay serial
+	if (relink_maxoldorgs < cl.num_entities)
+	{
+		relink_maxoldorgs = cl.max_edicts;
+		relink_oldorgs = Mem_Realloc (relink_oldorgs, sizeof (*relink_oldorgs) * relink_maxoldorgs);
+	}
+	relinkargs.frac = frac;
+	relinkargs.netbuffer = netbuffer;
+	if (cl.num_entities >= RELINK_TASK_MIN_ENTITIES && Tasks_NumWorkers () > 1)
+		Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (CL_LerpEntitiesTask, NUM_RELINK_TASKS, &relinkargs, sizeof (relinkargs)), TASK_TIMEOUT_INFINITE);
+	else if (cl.entities)
+		CL_LerpEntityRange (1, cl.num_entities, &relinkargs);
+
 	// start on the entity after the world
 	ent = (cl.entities != NULL) ? (cl.entities + 1) : NULL;
 	for (i = 1; i < cl.num_entities; i++, ent++)
@@ -732,17 +936,12 @@ void CL_RelinkEntities (void)
 			ent->model = NULL;
 			R_FreeEntityBLAS (ent);
 			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM; // johnfitz -- next time this entity slot is reused, the lerp will need to be reset
+			ent->history_count = 0;
 			InvalidateTraceLineCache ();
 			continue;
 		}
 
-		VectorCopy (ent->origin, oldorg);
-
-		if (CL_LerpEntity (ent, ent->origin, ent->angles, frac))
-			ent->lerpflags |= LERP_RESETMOVE;
-
-		if (cl.time < cl.oldtime)
-			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
+		VectorCopy (relink_oldorgs[i], oldorg);
 
 		if (ent->netstate.tagentity)
 			if (!CL_AttachEntity (ent, frac))
@@ -979,6 +1178,7 @@ int CL_ReadFromServer (void)
 	cl.oldtime = cl.time;
 	cl.time += host_frametime;
 
+	const mem_tag_t tag = Mem_SetTag (MEM_TAG_CLIENT);
 	needs_relink = true;
 	do
 	{
@@ -998,6 +1198,7 @@ int CL_ReadFromServer (void)
 	CL_RelinkEntities ();
 	needs_relink = false;
 	CL_UpdateTEnts ();
+	Mem_SetTag (tag);
 
 	// johnfitz -- devstats
 
@@ -1242,6 +1443,7 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&cl_anglespeedkey);
 	Cvar_RegisterVariable (&cl_shownet);
 	Cvar_RegisterVariable (&cl_nolerp);
+	Cvar_RegisterVariable (&cl_netbuffer);
 	Cvar_RegisterVariable (&lookspring);
 	Cvar_RegisterVariable (&lookstrafe);
 	Cvar_RegisterVariable (&sensitivity);
@@ -1260,6 +1462,7 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&cl_minpitch); // johnfitz -- variable pitch clamping
 
 	Cvar_RegisterVariable (&cl_startdemos);
+	Cvar_RegisterVariable (&cl_democompress);
 
 	Cmd_AddCommand ("entities", CL_PrintEntities_f);
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f);
@@ -1267,7 +1470,9 @@ void CL_Init (void)
 	Cmd_AddCommand ("stop", CL_Stop_f);
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f);
 	Cmd_AddCommand ("timedemo", CL_TimeDemo_f);
+	Cmd_AddCommand ("benchmark", CL_Benchmark_f);
 	Cmd_AddCommand ("seek", CL_Seek_f);
+	Cmd_AddCommand ("demo_follow", CL_DemoFollow_f);
 
 	Cmd_AddCommand ("tracepos", CL_Tracepos_f); // johnfitz
 	Cmd_AddCommand ("viewpos", CL_Viewpos_f);	// johnfitz
@@ -101,6 +101,25 @@ CL_EntityNum
 This error checks and tracks the total number of entities
 ===============
 */
+/*
+===============
+CL_PushEntityHistory
+
+Records the update just parsed into msg_origins[0] for cl_netbuffer
+===============
+*/
+static void CL_PushEntityHistory (entity_t *ent)
+{
+	int head = (ent->history_head + 1) % MSG_HISTORY;
+
+	ent->history_head = head;
+	ent->history_times[head] = ent->msgtime;
+	VectorCopy (ent->msg_origins[0], ent->history_origins[head]);
+	VectorCopy (ent->msg_angles[0], ent->history_angles[head]);
+	if (ent->history_count < MSG_HISTORY)
+		ent->history_count++;
+}
+
 entity_t *CL_EntityNum (int num)
 {
 	// johnfitz -- check minimum number too
@@ -160,7 +179,7 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 	else if (!olds)
 	{
 		/*reset got lost, probably the data will be filled in later - FIXME: we should probably ignore this entity*/
-		if (sv.active)
+		if (sv.active && !Host_ServerFrameRunning ())
 		{ // for extra debug info
 			qcvm_t *old = qcvm;
 			qcvm = NULL;
@@ -486,6 +505,7 @@ static void CL_EntitiesDeltaed (void)
 
 			VectorCopy (ent->netstate.origin, ent->msg_origins[0]);
 			VectorCopy (ent->netstate.angles, ent->msg_angles[0]);
+			CL_PushEntityHistory (ent);
 		}
 		skin = ent->netstate.skin;
 		if (skin != ent->skinnum)
@@ -579,6 +599,7 @@ static void CLFTE_ParseEntitiesUpdate (void)
 	{ // don't mess up lerps if the server is splitting entities into multiple packets.
 		cl.mtime[1] = cl.mtime[0];
 		cl.mtime[0] = newtime;
+		CL_NetBufferMessage (newtime);
 	}
 
 	for (;;)
@@ -634,6 +655,7 @@ static void CLFTE_ParseEntitiesUpdate (void)
 
 			// stupid interpolation junk.
 			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
+			ent->history_count = 0;
 		}
 	}
 
@@ -905,9 +927,23 @@ static void CL_ParseServerInfo (void)
 				Host_Error ("Server returned FTE2 protocol extensions that are not supported (%#x)", cl.protocol_pext2 & ~PEXT2_SUPPORTED_CLIENT);
 			continue;
 		}
+		if (i == PROTOCOL_VKQUAKE_PEXT)
+		{
+			cl.protocol_vkpext = MSG_ReadLong ();
+			if (cl.protocol_vkpext & ~VKPEXT_SUPPORTED_CLIENT)
+				Host_Error ("Server returned vkQuake protocol extensions that are not supported (%#x)", cl.protocol_vkpext & ~VKPEXT_SUPPORTED_CLIENT);
+			continue;
+		}
 		break;
 	}
 
+	// this message was sent as is and primed the server's deflate window, demos are recorded inflated
+	if (!cls.demoplayback)
+	{
+		NET_QSocketSetInflate (cls.netcon, (cl.protocol_vkpext & VKPEXT_DEFLATE) ? net_message.data : NULL, net_message.cursize);
+		NET_QSocketSetReliableWindow (cls.netcon, cl.protocol_vkpext & VKPEXT_RELIABLEWINDOW);
+	}
+
 	// johnfitz -- support multiple protocols
 	if (i != PROTOCOL_NETQUAKE && i != PROTOCOL_FITZQUAKE && i != PROTOCOL_RMQ)
 	{
@@ -1023,20 +1059,25 @@ static void CL_ParseServerInfo (void)
 	// copy the naked name of the map file to the cl structure -- O.S
 	COM_StripExtension (COM_SkipPath (model_precache[1]), cl.mapname, sizeof (cl.mapname));
 
+	// sounds load on worker tasks while the models load here,
+	// both have to be done before R_NewMap builds the lightmaps
+	S_BeginPrecaching ();
+	for (i = 1; i < numsounds; i++)
+	{
+		cl.sound_precache[i] = S_PrecacheSound (sound_precache[i]);
+	}
+	S_EndPrecaching ();
+
 	for (i = 1; i < nummodels; i++)
 	{
 		cl.model_precache[i] = Mod_ForName (model_precache[i], false);
 		if (cl.model_precache[i] == NULL)
 		{
+			S_WaitPrecaching ();
 			Host_Error ("Model %s not found", model_precache[i]);
 		}
 	}
-	S_BeginPrecaching ();
-	for (i = 1; i < numsounds; i++)
-	{
-		cl.sound_precache[i] = S_PrecacheSound (sound_precache[i]);
-	}
-	S_EndPrecaching ();
+	S_WaitPrecaching ();
 
 	// local state
 	cl.entities[0].model = cl.worldmodel = cl.model_precache[1];
@@ -1196,6 +1237,7 @@ static void CL_ParseUpdate (int bits)
 		ent->msg_angles[0][2] = MSG_ReadAngle (cl.protocolflags);
 	else
 		ent->msg_angles[0][2] = ent->baseline.angles[2];
+	CL_PushEntityHistory (ent);
 
 	// johnfitz -- lerping for movetype_step entities
 	if (bits & U_STEP)
@@ -1332,7 +1374,22 @@ static void CL_ParseBaseline (entity_t *ent, int version) // johnfitz -- added a
 	ent->baseline.scale = (bits & B_SCALE) ? MSG_ReadByte () : ENTSCALE_DEFAULT;
 }
 
-#define CL_SetStati(stat, val)	 cl.statsf[stat] = (cl.stats[stat] = val)
+/*
+==================
+CL_SetStatNumeric
+
+Stores a stat, flagging it in cl.statsdirty when it changed
+==================
+*/
+static void CL_SetStatNumeric (int stat, int ival, float fval)
+{
+	if (stat < 32 && (cl.stats[stat] != ival || cl.statsf[stat] != fval))
+		cl.statsdirty |= 1u << stat;
+	cl.stats[stat] = ival;
+	cl.statsf[stat] = fval;
+}
+
+#define CL_SetStati(stat, val)	 CL_SetStatNumeric (stat, val, val)
 #define CL_SetHudStat(stat, val) CL_SetStati (stat, val)
 
 /*
@@ -1512,7 +1569,7 @@ static void CL_ParseStatic (int version) // johnfitz -- added a parameter
 	VectorCopy (ent->baseline.origin, ent->origin);
 	VectorCopy (ent->baseline.angles, ent->angles);
 	if (ent->model)
-		R_AddEfrags (ent);
+		R_AddEfrags (i);
 
 	InvalidateTraceLineCache ();
 }
@@ -1689,8 +1746,7 @@ static void CL_ParseStatNumeric (int stat, int ival, float fval)
 		Con_DWarning ("svc_updatestat: %i is invalid\n", stat);
 		return;
 	}
-	cl.stats[stat] = ival;
-	cl.statsf[stat] = fval;
+	CL_SetStatNumeric (stat, ival, fval);
 	if (stat == STAT_VIEWZOOM)
 		vid.recalc_refdef = true;
 }
@@ -1714,6 +1770,44 @@ static void CL_ParseStatString (int stat, const char *str)
 	// hud doesn't know/care about any of these strings so don't bother invalidating anything.
 }
 
+/*
+=====================
+CL_ParseDemoView
+
+The svcs of one player in a server side demo follow, they are only parsed
+when that player is followed
+=====================
+*/
+static void CL_ParseDemoView (void)
+{
+	vec3_t angles;
+	int	   player, length, i;
+
+	if (!cls.demoplayback)
+		Host_Error ("Received svcvk_demoview outside of a demo");
+
+	player = MSG_ReadByte ();
+	for (i = 0; i < 3; i++)
+		angles[i] = MSG_ReadAngle16 (cl.protocolflags);
+	length = MSG_ReadLong ();
+	if (length < 0 || msg_readcount + length > net_message.cursize)
+	{
+		msg_badread = true;
+		return;
+	}
+
+	if (!cl.demofollow)
+		cl.demofollow = player + 1;
+	if (cl.demofollow != player + 1)
+	{
+		msg_readcount += length;
+		return;
+	}
+
+	VectorCopy (angles, cl.mviewangles[0]);
+	cl.viewentity = player + 1;
+}
+
 /*
 =====================
 CL_ParseServerMessage
@@ -1791,6 +1885,7 @@ void CL_ParseServerMessage (void)
 		case svc_time:
 			cl.mtime[1] = cl.mtime[0];
 			cl.mtime[0] = MSG_ReadFloat ();
+			CL_NetBufferMessage (cl.mtime[0]);
 			if (cl.protocol_pext2 & PEXT2_PREDINFO)
 				MSG_ReadShort (); // input sequence ack.
 			break;
@@ -1966,13 +2061,11 @@ void CL_ParseServerMessage (void)
 			break;
 
 		case svc_killedmonster:
-			cl.stats[STAT_MONSTERS]++;
-			cl.statsf[STAT_MONSTERS] = cl.stats[STAT_MONSTERS];
+			CL_SetStati (STAT_MONSTERS, cl.stats[STAT_MONSTERS] + 1);
 			break;
 
 		case svc_foundsecret:
-			cl.stats[STAT_SECRETS]++;
-			cl.statsf[STAT_SECRETS] = cl.stats[STAT_SECRETS];
+			CL_SetStati (STAT_SECRETS, cl.stats[STAT_SECRETS] + 1);
 			break;
 
 		case svc_updatestat:
@@ -2124,6 +2217,10 @@ void CL_ParseServerMessage (void)
 			// must use CL_EntityNum() to force cl.num_entities up
 			CL_ParseBaseline (CL_EntityNum (i), 6);
 			break;
+		case svcvk_demoview:
+			CL_ParseDemoView ();
+			break;
+
 		// ent updates replace svc_time too
 		case svcfte_updateentities:
 			if (!(cl.protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
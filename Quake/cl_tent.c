@@ -81,6 +81,9 @@ void CL_UpdateBeam (qmodel_t *m, const char *trailname, const char *impactname,
 			b->endtime = cl.time + 0.2;
 			VectorCopy (start, b->start);
 			VectorCopy (end, b->end);
+#ifdef PSET_SCRIPT
+			b->trailname = trailname;
+#endif
 			return;
 		}
 
@@ -94,6 +97,11 @@ void CL_UpdateBeam (qmodel_t *m, const char *trailname, const char *impactname,
 			b->endtime = cl.time + 0.2;
 			VectorCopy (start, b->start);
 			VectorCopy (end, b->end);
+#ifdef PSET_SCRIPT
+			PScript_DelinkTrailstate (&b->trailstate);
+			b->trailname = trailname;
+			b->scripted = false;
+#endif
 			return;
 		}
 	}
@@ -352,6 +360,9 @@ void CL_UpdateTEnts (void)
 	entity_t *ent;
 	float	  yaw, pitch;
 	float	  forward;
+#ifdef PSET_SCRIPT
+	float frametime = CLAMP (0.0, cl.time - cl.oldtime, 0.1);
+#endif
 
 	num_temp_entities = 0;
 
@@ -370,6 +381,18 @@ void CL_UpdateTEnts (void)
 			VectorCopy (cl.entities[cl.viewentity].origin, b->start);
 		}
 
+#ifdef PSET_SCRIPT
+		// when the loaded particle scripts define the beam effect, it is emitted as a single strip
+		// that the particle renderer batches per type, instead of a bolt model every 30 units
+		if (!cl.paused && b->trailname)
+		{
+			const int type = PScript_FindParticleType (b->trailname);
+			b->scripted = type >= 0 && !PScript_ParticleTrail (b->start, b->end, type, frametime, b->entity, NULL, &b->trailstate);
+		}
+		if (b->scripted)
+			continue;
+#endif
+
 		// calculate pitch and yaw
 		VectorSubtract (b->end, b->start, dist);
 
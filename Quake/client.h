@@ -87,6 +87,7 @@ typedef struct
 #ifdef PSET_SCRIPT
 	const char			*trailname;
 	struct trailstate_s *trailstate;
+	qboolean			 scripted; // drawn as a particle script strip instead of model segments
 #endif
 } beam_t;
 
@@ -171,6 +172,8 @@ typedef struct
 	float item_gettime[32]; // cl.time of aquiring item, for blinking
 	float faceanimtime;		// use anim frame if cl.time < this
 
+	unsigned int statsdirty; // bit per stat below 32 that changed since the UI last synced them
+
 	float v_dmg_time, v_dmg_roll, v_dmg_pitch;
 
 	cshift_t cshift_empty;				// can be modified by V_cshift_f ()
@@ -210,6 +213,19 @@ typedef struct
 	int completed_time; // latched at intermission start
 
 	double mtime[2]; // the timestamp of last two messages
+
+	// cl_netbuffer: the other entities are drawn from their update history, enough in the past
+	// for the next update to usually be there already when the server messages arrive unevenly
+	struct
+	{
+		double time;		// when the buffered entities are drawn
+		double lasttransit; // realtime - server time of the last message
+		float  jitter;		// smoothed deviation of the transit times
+		float  delay;		// how far time trails cl.time, eases to jitter * cl_netbuffer
+		int	   messages;
+		int	   frames;
+		int	   starved; // frames where time was past the last message, since the last readout
+	} netbuffer;
 	double time;	 // clients view of time, should be between
 					 // servertime and oldservertime to generate
 					 // a lerp point for other data
@@ -227,6 +243,7 @@ typedef struct
 	char mapname[128];
 	char levelname[128]; // for display on solo scoreboard //johnfitz -- was 40.
 	int	 viewentity;	 // cl_entitites[cl.viewentity] = player
+	int	 demofollow;	 // 1 + the player a server side demo is watched from, 0 for the first one it has
 	int	 maxclients;
 	int	 gametype;
 
@@ -236,6 +253,9 @@ typedef struct
 	int				 num_efrags;
 	struct efrag_s **efrag_allocs;
 	int				 num_efragallocs;
+	int				*static_leafents;	// static entity indices for each leaf, see R_BakeEfrags
+	int				 num_baked_statics; // num_statics when static_leafents was built
+	uint32_t		*static_visbits;	// statics touching a visible leaf this frame
 	entity_t		 viewent; // the gun model
 
 	entity_t *entities; // spike -- moved into here
@@ -255,6 +275,7 @@ typedef struct
 	unsigned protocolflags;
 	unsigned protocol_pext1; // spike -- flag of fte protocol extensions
 	unsigned protocol_pext2; // spike -- flag of fte protocol extensions
+	unsigned protocol_vkpext;
 
 #ifdef PSET_SCRIPT
 	qboolean protocol_particles;
@@ -323,6 +344,7 @@ extern cvar_t m_forward;
 extern cvar_t m_side;
 
 extern cvar_t cl_startdemos;
+extern cvar_t cl_democompress;
 
 #define MAX_TEMP_ENTITIES 256 // johnfitz -- was 64
 
@@ -349,6 +371,7 @@ dlight_t *CL_AllocDlight (int key);
 void	  CL_DecayLights (void);
 
 void CL_RelinkEntities (void);
+void CL_NetBufferMessage (double servertime);
 
 void CL_Init (void);
 
@@ -399,11 +422,13 @@ void CL_ClearTrailStates (void);
 void CL_StopPlayback (void);
 int	 CL_GetMessage (void);
 void CL_Seek_f (void);
+void CL_DemoFollow_f (void);
 
 void CL_Stop_f (void);
 void CL_Record_f (void);
 void CL_PlayDemo_f (void);
 void CL_TimeDemo_f (void);
+void CL_Benchmark_f (void);
 void CL_Resume_Record (qboolean recordsignons);
 
 //
@@ -411,7 +436,8 @@ void CL_Resume_Record (qboolean recordsignons);
 //
 void CL_ParseServerMessage (void);
 void CL_RegisterParticles (void);
-void CL_NewTranslation (int slot);
+void	  CL_NewTranslation (int slot);
+entity_t *CL_EntityNum (int num);
 
 //
 // view
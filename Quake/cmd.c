@@ -30,16 +30,8 @@ cvar_t cmd_warncmd = {"cl_warncmd", "1", CVAR_NONE}; // Spike -- prevent autodet
 													 // protocol (without needing to reconfigure the server. Requires reconnect.
 void   Cmd_ForwardToServer (void);
 
-#define MAX_ALIAS_NAME 32
-
-typedef struct cmdalias_s
-{
-	struct cmdalias_s *next;
-	char			   name[MAX_ALIAS_NAME];
-	char			  *value;
-} cmdalias_t;
-
-cmdalias_t *cmd_alias;
+cmdalias_t		  *cmd_alias;
+static hash_map_t *alias_map; // name ignoring case -> first alias of its hash_next chain
 
 static qboolean cmd_wait;
 
@@ -69,6 +61,9 @@ void Cmd_Wait_f (void)
 
 sizebuf_t cmd_text;
 
+// the threaded server adds commands while the client does
+static SDL_Mutex *cmd_text_mutex;
+
 /*
 ============
 Cbuf_Init
@@ -78,6 +73,7 @@ void Cbuf_Init (void)
 {
 	SZ_Alloc (&cmd_text, 1 << 18); // space for commands and script files. spike -- was 8192, but modern configs can be _HUGE_, at least if they contain lots
 								   // of comments/docs for things.
+	cmd_text_mutex = SDL_CreateMutex ();
 }
 
 /*
@@ -92,24 +88,20 @@ void Cbuf_AddText (const char *text)
 	int l;
 
 	l = strlen (text);
-
-	if (cmd_text.cursize + l >= cmd_text.maxsize)
-	{
-		Con_Printf ("Cbuf_AddText: overflow\n");
-		return;
-	}
-
-	SZ_Write (&cmd_text, text, l);
+	Cbuf_AddTextLen (text, l);
 }
 void Cbuf_AddTextLen (const char *text, int l)
 {
+	SDL_LockMutex (cmd_text_mutex);
 	if (cmd_text.cursize + l >= cmd_text.maxsize)
 	{
+		SDL_UnlockMutex (cmd_text_mutex);
 		Con_Printf ("Cbuf_AddText: overflow\n");
 		return;
 	}
 
 	SZ_Write (&cmd_text, text, l);
+	SDL_UnlockMutex (cmd_text_mutex);
 }
 
 /*
@@ -126,6 +118,8 @@ void Cbuf_InsertText (const char *text)
 	char *temp;
 	int	  templen;
 
+	SDL_LockMutex (cmd_text_mutex);
+
 	// copy off any commands still remaining in the exec buffer
 	templen = cmd_text.cursize;
 	if (templen)
@@ -146,6 +140,8 @@ void Cbuf_InsertText (const char *text)
 		SZ_Write (&cmd_text, temp, templen);
 		Mem_Free (temp);
 	}
+
+	SDL_UnlockMutex (cmd_text_mutex);
 }
 
 // Spike: for renderer/server isolation
@@ -168,6 +164,7 @@ void Cbuf_Execute (void)
 	char  line[1024];
 	int	  quotes, comment;
 
+	SDL_LockMutex (cmd_text_mutex);
 	while (cmd_text.cursize && !cmd_wait)
 	{
 		// find a \n or ; line break
@@ -212,8 +209,11 @@ void Cbuf_Execute (void)
 		}
 
 		// execute the command line
+		SDL_UnlockMutex (cmd_text_mutex);
 		Cmd_ExecuteString (line, src_command);
+		SDL_LockMutex (cmd_text_mutex);
 	}
+	SDL_UnlockMutex (cmd_text_mutex);
 }
 
 /*
@@ -336,6 +336,70 @@ void Cmd_Echo_f (void)
 	Con_Printf ("\n");
 }
 
+/*
+===============
+Cmd_LookupAlias
+
+First alias named name ignoring case, the others follow through hash_next
+===============
+*/
+static cmdalias_t *Cmd_LookupAlias (const char *name)
+{
+	cmdalias_t **a;
+
+	if (!alias_map)
+		return NULL;
+	a = HashMap_Lookup (cmdalias_t *, alias_map, &name);
+	return a ? *a : NULL;
+}
+
+/*
+===============
+Cmd_HashAlias
+
+New aliases go to the front of cmd_alias, so they also become the head of their chain.
+The map key points at the name of the head, it is reinserted whenever the head changes.
+===============
+*/
+static void Cmd_HashAlias (cmdalias_t *a)
+{
+	const char *name = a->name;
+
+	if (!alias_map)
+		alias_map = HashMap_Create (const char *, cmdalias_t *, &HashStrCase, &HashStrCaseCmp);
+
+	a->hash_next = Cmd_LookupAlias (name);
+	if (a->hash_next)
+		HashMap_Erase (alias_map, &name);
+	HashMap_Insert (alias_map, &name, &a);
+}
+
+/*
+===============
+Cmd_UnhashAlias
+===============
+*/
+static void Cmd_UnhashAlias (cmdalias_t *a)
+{
+	cmdalias_t	*head = Cmd_LookupAlias (a->name);
+	cmdalias_t **link;
+
+	if (head == a)
+	{
+		const char *name = a->name;
+		HashMap_Erase (alias_map, &name);
+		if (a->hash_next)
+		{
+			name = a->hash_next->name;
+			HashMap_Insert (alias_map, &name, &a->hash_next);
+		}
+		return;
+	}
+	for (link = &head->hash_next; *link != a; link = &(*link)->hash_next)
+		;
+	*link = a->hash_next;
+}
+
 /*
 ===============
 Cmd_Alias_f -- johnfitz -- rewritten
@@ -361,7 +425,7 @@ void Cmd_Alias_f (void)
 			Con_SafePrintf ("no alias commands found\n");
 		break;
 	case 2: // output current alias string
-		for (a = cmd_alias; a; a = a->next)
+		for (a = Cmd_LookupAlias (Cmd_Argv (1)); a; a = a->hash_next)
 			if (!strcmp (Cmd_Argv (1), a->name))
 				Con_Printf ("   %s: %s", a->name, a->value);
 		break;
@@ -374,7 +438,7 @@ void Cmd_Alias_f (void)
 		}
 
 		// if the alias allready exists, reuse it
-		for (a = cmd_alias; a; a = a->next)
+		for (a = Cmd_LookupAlias (s); a; a = a->hash_next)
 		{
 			if (!strcmp (s, a->name))
 			{
@@ -388,8 +452,9 @@ void Cmd_Alias_f (void)
 			a = (cmdalias_t *)Mem_Alloc (sizeof (cmdalias_t));
 			a->next = cmd_alias;
 			cmd_alias = a;
+			strcpy (a->name, s);
+			Cmd_HashAlias (a);
 		}
-		strcpy (a->name, s);
 
 		// copy the rest of the command line
 		cmd[0] = 0; // start out with a null string
@@ -438,6 +503,7 @@ void Cmd_Unalias_f (void)
 				else
 					cmd_alias = a->next;
 
+				Cmd_UnhashAlias (a);
 				Mem_Free (a->value);
 				Mem_Free (a);
 				return;
@@ -451,13 +517,7 @@ void Cmd_Unalias_f (void)
 
 qboolean Cmd_AliasExists (const char *aliasname)
 {
-	cmdalias_t *a;
-	for (a = cmd_alias; a; a = a->next)
-	{
-		if (!q_strcasecmp (aliasname, a->name))
-			return true;
-	}
-	return false;
+	return Cmd_LookupAlias (aliasname) != NULL;
 }
 
 /*
@@ -476,6 +536,11 @@ void Cmd_Unaliasall_f (void)
 		Mem_Free (cmd_alias);
 		cmd_alias = blah;
 	}
+	if (alias_map)
+	{
+		HashMap_Destroy (alias_map);
+		alias_map = NULL;
+	}
 }
 
 /*
@@ -488,16 +553,19 @@ void Cmd_Unaliasall_f (void)
 
 #define MAX_ARGS 80
 
-static int		   cmd_argc;
-static char		   cmd_argv[MAX_ARGS][1024];
-static char		   cmd_null_string[] = "";
-static const char *cmd_args = NULL;
+// per thread, the threaded server executes the commands of its clients
+static THREAD_LOCAL int			cmd_argc;
+static THREAD_LOCAL char		cmd_argv[MAX_ARGS][1024];
+static char						cmd_null_string[] = "";
+static THREAD_LOCAL const char *cmd_args = NULL;
 
-cmd_source_t cmd_source;
+THREAD_LOCAL cmd_source_t cmd_source;
 
 // johnfitz -- better tab completion
 // static	cmd_function_t	*cmd_functions;		// possible commands to execute
-cmd_function_t *cmd_functions; // possible commands to execute
+cmd_function_t		   *cmd_functions; // possible commands to execute
+static hash_map_t	   *cmd_map;	   // name ignoring case -> first command of its hash_next chain
+static cmd_function_t **cmd_sorted;	   // VEC, cmd_functions as an array for binary searches, NULL when it changed
 // johnfitz
 
 /*
@@ -707,6 +775,95 @@ void Cmd_TokenizeString (const char *text)
 	}
 }
 
+/*
+============
+Cmd_LookupCommand
+
+First command named cmd_name ignoring case, the others follow through hash_next
+============
+*/
+static cmd_function_t *Cmd_LookupCommand (const char *cmd_name)
+{
+	cmd_function_t **cmd;
+
+	if (!cmd_map)
+		return NULL;
+	cmd = HashMap_Lookup (cmd_function_t *, cmd_map, &cmd_name);
+	return cmd ? *cmd : NULL;
+}
+
+/*
+============
+Cmd_SetChainHead
+
+The map key points at the name of the chain head, so it is reinserted whenever the head changes
+============
+*/
+static void Cmd_SetChainHead (cmd_function_t *old_head, cmd_function_t *new_head)
+{
+	if (old_head)
+		HashMap_Erase (cmd_map, &old_head->name);
+	if (new_head)
+		HashMap_Insert (cmd_map, &new_head->name, &new_head);
+}
+
+/*
+============
+Cmd_HashCommand
+
+Chains cmd in cmd_functions order so a lookup finds the same command a list walk would
+============
+*/
+static void Cmd_HashCommand (cmd_function_t *cmd)
+{
+	cmd_function_t  *head, *cursor;
+	cmd_function_t **link;
+
+	if (!cmd_map)
+		cmd_map = HashMap_Create (const char *, cmd_function_t *, &HashStrCase, &HashStrCaseCmp);
+
+	head = Cmd_LookupCommand (cmd->name);
+	if (!head)
+	{
+		cmd->hash_next = NULL;
+		Cmd_SetChainHead (NULL, cmd);
+		return;
+	}
+
+	// first chained command behind cmd in the list
+	for (cursor = cmd->next; cursor && q_strcasecmp (cursor->name, cmd->name); cursor = cursor->next)
+		;
+	cmd->hash_next = cursor;
+	if (cursor == head)
+	{
+		Cmd_SetChainHead (head, cmd);
+		return;
+	}
+	for (link = &head->hash_next; *link != cursor; link = &(*link)->hash_next)
+		;
+	*link = cmd;
+}
+
+/*
+============
+Cmd_UnhashCommand
+============
+*/
+static void Cmd_UnhashCommand (cmd_function_t *cmd)
+{
+	cmd_function_t  *head = Cmd_LookupCommand (cmd->name);
+	cmd_function_t **link;
+
+	if (head == cmd)
+	{
+		Cmd_SetChainHead (cmd, cmd->hash_next);
+		return;
+	}
+	for (link = &head->hash_next; *link != cmd; link = &(*link)->hash_next)
+		;
+	*link = cmd->hash_next;
+}
+
 /*
 ============
 Cmd_AddCommand
@@ -727,7 +884,7 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 	}
 
 	// fail if the command already exists
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_LookupCommand (cmd_name); cmd; cmd = cmd->hash_next)
 	{
 		if (!strcmp (cmd_name, cmd->name) && cmd->srctype == srctype)
 		{
@@ -771,6 +928,8 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 		prev->next = cmd;
 	}
 	// johnfitz
+	Cmd_HashCommand (cmd);
+	VEC_FREE (cmd_sorted);
 
 	if (cmd->dynamic)
 		return cmd;
@@ -784,6 +943,8 @@ void Cmd_RemoveCommand (cmd_function_t *cmd)
 		if (*link == cmd)
 		{
 			*link = cmd->next;
+			Cmd_UnhashCommand (cmd);
+			VEC_FREE (cmd_sorted);
 			Mem_Free (cmd);
 			return;
 		}
@@ -800,7 +961,7 @@ qboolean Cmd_Exists (const char *cmd_name)
 {
 	cmd_function_t *cmd;
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_LookupCommand (cmd_name); cmd; cmd = cmd->hash_next)
 	{
 		if (!strcmp (cmd_name, cmd->name))
 		{
@@ -821,17 +982,30 @@ Cmd_CompleteCommand
 const char *Cmd_CompleteCommand (const char *partial)
 {
 	cmd_function_t *cmd;
-	int				len;
+	size_t			len, lo, hi, mid;
 
 	len = strlen (partial);
 
 	if (!len)
 		return NULL;
 
-	// check functions
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
-		if (!strncmp (partial, cmd->name, len))
-			return cmd->name;
+	// cmd_functions is kept sorted, the first completion is the first name not below partial
+	if (!cmd_sorted)
+		for (cmd = cmd_functions; cmd; cmd = cmd->next)
+			VEC_PUSH (cmd_sorted, cmd);
+
+	lo = 0;
+	hi = VEC_SIZE (cmd_sorted);
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (strcmp (cmd_sorted[mid]->name, partial) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < VEC_SIZE (cmd_sorted) && !strncmp (partial, cmd_sorted[lo]->name, len))
+		return cmd_sorted[lo]->name;
 
 	return NULL;
 }
@@ -841,7 +1015,6 @@ const char *Cmd_CompleteCommand (const char *partial)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 qboolean Cmd_ExecuteString (const char *text, cmd_source_t src)
@@ -857,20 +1030,17 @@ qboolean Cmd_ExecuteString (const char *text, cmd_source_t src)
 		return true; // no tokens
 
 	// check functions
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = Cmd_LookupCommand (cmd_argv[0]); cmd; cmd = cmd->hash_next)
 	{
-		if (!q_strcasecmp (cmd_argv[0], cmd->name))
-		{
-			if (src == src_client && cmd->srctype != src_client)
-				Con_DPrintf ("%s tried to %s\n", host_client->name, text); // src_client only allows client commands
-			else if (src == src_command && cmd->srctype == src_server)
-				continue; // src_command can execute anything but server commands (which it ignores, allowing for alternative behaviour)
-			else if (src == src_server && cmd->srctype != src_server)
-				continue; // src_server may only execute server commands (such commands must be safe to parse within the context of a network message, so no
-						  // disconnect/connect/playdemo/etc)
-			cmd->function ();
-			return true;
-		}
+		if (src == src_client && cmd->srctype != src_client)
+			Con_DPrintf ("%s tried to %s\n", host_client->name, text); // src_client only allows client commands
+		else if (src == src_command && cmd->srctype == src_server)
+			continue; // src_command can execute anything but server commands (which it ignores, allowing for alternative behaviour)
+		else if (src == src_server && cmd->srctype != src_server)
+			continue; // src_server may only execute server commands (such commands must be safe to parse within the context of a network message, so no
+					  // disconnect/connect/playdemo/etc)
+		cmd->function ();
+		return true;
 	}
 
 	if (src == src_client)
@@ -882,13 +1052,11 @@ qboolean Cmd_ExecuteString (const char *text, cmd_source_t src)
 		return false;
 
 	// check alias
-	for (a = cmd_alias; a; a = a->next)
+	a = Cmd_LookupAlias (cmd_argv[0]);
+	if (a)
 	{
-		if (!q_strcasecmp (cmd_argv[0], a->name))
-		{
-			Cbuf_InsertText (a->value);
-			return true;
-		}
+		Cbuf_InsertText (a->value);
+		return true;
 	}
 
 	// check cvars
@@ -938,9 +1106,11 @@ void Cmd_ForwardToServer (void)
 		{ // server asked us for a key+value list of the extensions+attributes we support
 			SZ_Print (
 				&cls.message, va ("pext"
+								  " %#x %#x"
 								  " %#x %#x"
 								  " %#x %#x",
-								  PROTOCOL_FTE_PEXT1, PEXT1_SUPPORTED_CLIENT, PROTOCOL_FTE_PEXT2, PEXT2_SUPPORTED_CLIENT));
+								  PROTOCOL_FTE_PEXT1, PEXT1_SUPPORTED_CLIENT, PROTOCOL_FTE_PEXT2, PEXT2_SUPPORTED_CLIENT, PROTOCOL_VKQUAKE_PEXT,
+								  VKPEXT_SUPPORTED_CLIENT));
 			return;
 		}
 	}
@@ -84,18 +84,32 @@ typedef enum
 	src_command, // from the command buffer
 	src_server	 // from a svc_stufftext
 } cmd_source_t;
-extern cmd_source_t cmd_source;
+extern THREAD_LOCAL cmd_source_t cmd_source;
 
 typedef void (*xcommand_t) (void);
 typedef struct cmd_function_s
 {
 	struct cmd_function_s *next;
+	struct cmd_function_s *hash_next; // next command with the same name ignoring case, in list order
 	const char			  *name;
 	xcommand_t			   function;
 	cmd_source_t		   srctype;
 	qboolean			   dynamic;
 } cmd_function_t;
 
+#define MAX_ALIAS_NAME 32
+
+typedef struct cmdalias_s
+{
+	struct cmdalias_s *next;
+	struct cmdalias_s *hash_next; // next alias with the same name ignoring case, in list order
+	char			   name[MAX_ALIAS_NAME];
+	char			  *value;
+} cmdalias_t;
+
+extern cmd_function_t *cmd_functions;
+extern cmdalias_t	  *cmd_alias;
+
 void Cmd_Init (void);
 
 cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_source_t srctype);
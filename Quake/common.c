@@ -27,6 +27,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "q_ctype.h"
 #include <errno.h>
+#ifndef _WIN32
+#include <dirent.h>
+#else
+#include <windows.h>
+#endif
 
 // Plug our allocators into miniz:
 #define MZ_MALLOC(x)	 Mem_Alloc (x)
@@ -46,6 +51,7 @@ cvar_t registered = {"registered", "1", CVAR_ROM};				 /* set to correct value i
 cvar_t cmdline = {"cmdline", "", CVAR_ROM /*|CVAR_SERVERINFO*/}; /* sending cmdline upon CCREQ_RULE_INFO is evil */
 
 static qboolean com_modified; // set true if using non-id files
+static qboolean com_map_paks;  // memory map pak files instead of reading them through a file handle
 
 qboolean fitzmode;
 qboolean multiuser;
@@ -957,8 +963,8 @@ void MSG_WriteEntity (sizebuf_t *sb, unsigned int entnum, unsigned int pext2)
 //
 // reading functions
 //
-int		 msg_readcount;
-qboolean msg_badread;
+THREAD_LOCAL int		 msg_readcount;
+THREAD_LOCAL qboolean msg_badread;
 
 void MSG_BeginReading (void)
 {
@@ -1775,6 +1781,21 @@ THREAD_LOCAL int file_from_pak; // ZOID: global indicating that file came from a
 searchpath_t *com_searchpaths;
 searchpath_t *com_base_searchpaths;
 
+// guards searchpath_t->missing_files, COM_FindFile can be called from worker threads
+static SDL_Mutex *com_missing_files_mutex;
+
+// loose files handed out by COM_LoadFileView as mappings, so that COM_FreeFileView can unmap them
+typedef struct file_mapping_s
+{
+	const byte			  *data;
+	qfileofs_t			   size;
+	struct file_mapping_s *next;
+} file_mapping_t;
+static file_mapping_t *com_file_mappings;
+static SDL_Mutex	  *com_file_mappings_mutex;
+
+static qboolean FS_OpenLocated (searchpath_t *search, int i, const char *netpath, fshandle_t *fh, unsigned int *path_id);
+
 /*
 ============
 COM_Path_f
@@ -1796,6 +1817,76 @@ static void COM_Path_f (void)
 	}
 }
 
+/*
+============
+COM_IsKnownMissing
+
+Loose directory negative lookup cache, saves a Sys_FileType call per
+searchpath for files that have already been looked for and not found.
+============
+*/
+static qboolean COM_IsKnownMissing (searchpath_t *search, const char *filename)
+{
+	qboolean missing = false;
+	SDL_LockMutex (com_missing_files_mutex);
+	if (search->missing_files)
+		missing = HashMap_Lookup (qboolean, search->missing_files, &filename) != NULL;
+	SDL_UnlockMutex (com_missing_files_mutex);
+	return missing;
+}
+
+/*
+============
+COM_AddKnownMissing
+============
+*/
+static void COM_AddKnownMissing (searchpath_t *search, const char *filename)
+{
+	static const qboolean missing = true;
+	SDL_LockMutex (com_missing_files_mutex);
+	if (!search->missing_files)
+		search->missing_files = HashMap_Create (const char *, qboolean, &HashStr, &HashStrCmp);
+	if (!HashMap_Lookup (qboolean, search->missing_files, &filename))
+	{
+		const char *key = q_strdup (filename);
+		HashMap_Insert (search->missing_files, &key, &missing);
+	}
+	SDL_UnlockMutex (com_missing_files_mutex);
+}
+
+/*
+============
+COM_FreeMissingFiles
+============
+*/
+static void COM_FreeMissingFiles (searchpath_t *search)
+{
+	if (!search->missing_files)
+		return;
+	for (uint32_t i = 0; i < HashMap_Size (search->missing_files); ++i)
+		Mem_Free (*HashMap_GetKey (char *, search->missing_files, i));
+	HashMap_Destroy (search->missing_files);
+	search->missing_files = NULL;
+}
+
+/*
+============
+COM_FlushFileCache
+
+Forgets all negative lookups, so files created since they were
+looked for can be found again.
+============
+*/
+void COM_FlushFileCache (void)
+{
+	searchpath_t *search;
+
+	SDL_LockMutex (com_missing_files_mutex);
+	for (search = com_searchpaths; search; search = search->next)
+		COM_FreeMissingFiles (search);
+	SDL_UnlockMutex (com_missing_files_mutex);
+}
+
 /*
 ============
 COM_WriteFile
@@ -1822,6 +1913,8 @@ void COM_WriteFile (const char *filename, const void *data, int len)
 	Sys_Printf ("COM_WriteFile: %s\n", name);
 	Sys_FileWrite (handle, data, len);
 	Sys_FileClose (handle);
+
+	COM_FlushFileCache ();
 }
 
 /*
@@ -1856,61 +1949,28 @@ qfileofs_t COM_filelength (FILE *f)
 
 /*
 ===========
-COM_FindFile
+COM_LocateFile
 
-Finds the file in the search path.
-Sets com_filesize and one of handle or file
-If neither of file or handle is set, this
-can be used for detecting a file's presence.
+Finds where filename lives in the search path without opening it or
+touching any per-thread globals. For a pak entry *pak_index is set,
+otherwise netpath receives the OS path of the loose file. Only reads
+com_searchpaths, so it is safe to call from worker tasks.
 ===========
 */
-static int COM_FindFile (const char *filename, int *handle, FILE **file, unsigned int *path_id)
+static searchpath_t *COM_LocateFile (const char *filename, int *pak_index, char *netpath, size_t netpath_size)
 {
 	searchpath_t *search;
-	char		  netpath[MAX_OSPATH];
-	pack_t		 *pak;
-	int			  i;
-	qboolean	  is_config = !q_strcasecmp (filename, "config.cfg"), found = false;
-
-	if (file && handle)
-		Sys_Error ("COM_FindFile: both handle and file set");
-
-	file_from_pak = 0;
+	qboolean	  is_config = !q_strcasecmp (filename, "config.cfg");
 
-	//
-	// search through the path, one element at a time
-	//
 	for (search = com_searchpaths; search; search = search->next)
 	{
 		if (search->pack) /* look through all the pak file elements */
 		{
-			pak = search->pack;
-			for (i = 0; i < pak->numfiles; i++)
+			const int *index = HashMap_Lookup (int, search->pack->file_map, &filename);
+			if (index)
 			{
-				if (strcmp (pak->files[i].name, filename) != 0)
-					continue;
-				// found it!
-				com_filesize = pak->files[i].filelen;
-				file_from_pak = 1;
-				if (path_id)
-					*path_id = search->path_id;
-				if (handle)
-				{
-					*handle = pak->handle;
-					Sys_FileSeek (pak->handle, pak->files[i].filepos);
-					return com_filesize;
-				}
-				else if (file)
-				{ /* open a new file on the pakfile */
-					*file = fopen (pak->filename, "rb");
-					if (*file)
-						fseek (*file, pak->files[i].filepos, SEEK_SET);
-					return com_filesize;
-				}
-				else /* for COM_FileExists() */
-				{
-					return com_filesize;
-				}
+				*pak_index = *index;
+				return search;
 			}
 		}
 		else /* check a file in the directory tree */
@@ -1923,36 +1983,120 @@ static int COM_FindFile (const char *filename, int *handle, FILE **file, unsigne
 
 			if (is_config)
 			{
-				q_snprintf (netpath, sizeof (netpath), "%s/" CONFIG_NAME, search->filename);
+				q_snprintf (netpath, netpath_size, "%s/" CONFIG_NAME, search->filename);
 				if (Sys_FileType (netpath) & FS_ENT_FILE)
-					found = true;
+					return search;
 			}
 
-			if (!found)
-			{
-				q_snprintf (netpath, sizeof (netpath), "%s/%s", search->filename, filename);
-				if (!(Sys_FileType (netpath) & FS_ENT_FILE))
-					continue;
-			}
+			if (COM_IsKnownMissing (search, filename))
+				continue;
+			q_snprintf (netpath, netpath_size, "%s/%s", search->filename, filename);
+			if (Sys_FileType (netpath) & FS_ENT_FILE)
+				return search;
+			COM_AddKnownMissing (search, filename);
+		}
+	}
 
-			if (path_id)
-				*path_id = search->path_id;
-			if (handle)
-			{
-				com_filesize = Sys_FileOpenRead (netpath, &i);
-				*handle = i;
-				return com_filesize;
-			}
-			else if (file)
+	return NULL;
+}
+
+static byte *COM_InflatePackEntry (const pack_t *pak, const packfile_t *entry);
+
+/*
+===========
+COM_FindFile
+
+Finds the file in the search path.
+Sets com_filesize and one of handle or file
+If neither of file or handle is set, this
+can be used for detecting a file's presence.
+===========
+*/
+static int COM_FindFile (const char *filename, int *handle, FILE **file, unsigned int *path_id)
+{
+	searchpath_t *search;
+	char		  netpath[MAX_OSPATH];
+	int			  i;
+
+	if (file && handle)
+		Sys_Error ("COM_FindFile: both handle and file set");
+
+	file_from_pak = 0;
+
+	search = COM_LocateFile (filename, &i, netpath, sizeof (netpath));
+	if (search && search->pack)
+	{
+		// found it!
+		pack_t *pak = search->pack;
+		com_filesize = pak->files[i].filelen;
+		file_from_pak = 1;
+		if (path_id)
+			*path_id = search->path_id;
+		if (pak->files[i].packedlen && (handle || file))
+		{ /* deflated pk3 entry, hand out an inflated private copy */
+			byte *data = COM_InflatePackEntry (pak, &pak->files[i]);
+			if (data && handle)
 			{
-				*file = fopen (netpath, "rb");
-				com_filesize = (*file == NULL) ? -1 : COM_filelength (*file);
+				Sys_MemFileOpenReadOwned (data, com_filesize, handle);
 				return com_filesize;
 			}
-			else
+			if (data && file)
 			{
-				return 0; /* dummy valid value for COM_FileExists() */
+				*file = tmpfile ();
+				if (*file && fwrite (data, 1, com_filesize, *file) == (size_t)com_filesize)
+				{
+					rewind (*file);
+					Mem_Free (data);
+					return com_filesize;
+				}
+				if (*file)
+					fclose (*file);
 			}
+			Mem_Free (data);
+			if (handle)
+				*handle = -1;
+			if (file)
+				*file = NULL;
+			com_filesize = -1;
+			return com_filesize;
+		}
+		if (handle)
+		{
+			*handle = pak->handle;
+			Sys_FileSeek (pak->handle, pak->files[i].filepos);
+			return com_filesize;
+		}
+		else if (file)
+		{ /* open a new file on the pakfile */
+			*file = fopen (pak->filename, "rb");
+			if (*file)
+				fseek (*file, pak->files[i].filepos, SEEK_SET);
+			return com_filesize;
+		}
+		else /* for COM_FileExists() */
+		{
+			return com_filesize;
+		}
+	}
+	else if (search)
+	{
+		if (path_id)
+			*path_id = search->path_id;
+		if (handle)
+		{
+			com_filesize = Sys_FileOpenRead (netpath, &i);
+			*handle = i;
+			return com_filesize;
+		}
+		else if (file)
+		{
+			*file = fopen (netpath, "rb");
+			com_filesize = (*file == NULL) ? -1 : COM_filelength (*file);
+			return com_filesize;
+		}
+		else
+		{
+			return 0; /* dummy valid value for COM_FileExists() */
 		}
 	}
 
@@ -2064,6 +2208,111 @@ byte *COM_LoadFile (const char *path, unsigned int *path_id)
 	return buf;
 }
 
+/*
+============
+COM_LoadFileView
+
+Like COM_LoadFile, but files inside memory backed
+paks are returned in place and loose files are memory
+mapped instead of copied, so pages are only read when
+touched. The data is NOT NUL terminated. Free with
+COM_FreeFileView. Does not set com_filesize and is
+thread safe.
+============
+*/
+const byte *COM_LoadFileView (const char *path, unsigned int *path_id, int *len)
+{
+	fshandle_t	  fh;
+	byte		 *buf;
+	char		  netpath[MAX_OSPATH];
+	int			  i;
+	searchpath_t *search;
+
+	// goes through FS_OpenLocated so that it is usable from worker tasks:
+	// no shared pak handle is seeked and no globals are touched
+	search = COM_LocateFile (path, &i, netpath, sizeof (netpath));
+	if (search && !search->pack)
+	{
+		qfileofs_t	size;
+		const byte *data = Sys_MapFileRead (netpath, &size);
+		if (data && (size <= INT_MAX))
+		{
+			file_mapping_t *mapping = (file_mapping_t *)Mem_Alloc (sizeof (file_mapping_t));
+			mapping->data = data;
+			mapping->size = size;
+			SDL_LockMutex (com_file_mappings_mutex);
+			mapping->next = com_file_mappings;
+			com_file_mappings = mapping;
+			SDL_UnlockMutex (com_file_mappings_mutex);
+			if (path_id)
+				*path_id = search->path_id;
+			*len = (int)size;
+			return data;
+		}
+		if (data)
+			Sys_UnmapFile (data, size);
+		// empty or unmappable, read it
+	}
+
+	if (!search || !FS_OpenLocated (search, i, netpath, &fh, path_id))
+	{
+		*len = -1;
+		return NULL;
+	}
+
+	*len = fh.length;
+	if (fh.memory)
+		return fh.memory;
+
+	buf = (byte *)Mem_AllocNonZero (*len + 1);
+	buf[*len] = 0;
+	if (FS_pread (&fh, buf, *len, 0) != (size_t)*len)
+	{
+		Mem_Free (buf);
+		buf = NULL;
+		*len = -1;
+	}
+	FS_fclose (&fh);
+
+	return buf;
+}
+
+/*
+============
+COM_FreeFileView
+============
+*/
+void COM_FreeFileView (const byte *view)
+{
+	searchpath_t *search;
+
+	if (!view)
+		return;
+	for (search = com_searchpaths; search; search = search->next)
+	{
+		const pack_t *pak = search->pack;
+		if (pak && pak->memory && view >= pak->memory && view < pak->memory + pak->memory_size)
+			return;
+	}
+
+	SDL_LockMutex (com_file_mappings_mutex);
+	for (file_mapping_t **link = &com_file_mappings; *link; link = &(*link)->next)
+	{
+		file_mapping_t *mapping = *link;
+		if (mapping->data == view)
+		{
+			*link = mapping->next;
+			SDL_UnlockMutex (com_file_mappings_mutex);
+			Sys_UnmapFile (mapping->data, mapping->size);
+			Mem_Free (mapping);
+			return;
+		}
+	}
+	SDL_UnlockMutex (com_file_mappings_mutex);
+
+	Mem_Free ((void *)view);
+}
+
 byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
 {
 	FILE *f;
@@ -2160,6 +2409,35 @@ size_t COM_SanitizeDescriptionString (char *dst, size_t dstsize, const char *src
 	return dstpos;
 }
 
+/*
+=================
+COM_CreatePack
+
+Takes ownership of files and indexes them by name.
+=================
+*/
+static pack_t *COM_CreatePack (const char *packfile, int packhandle, packfile_t *files, int numfiles)
+{
+	pack_t *pack = (pack_t *)Mem_Alloc (sizeof (pack_t));
+	int		i;
+
+	q_strlcpy (pack->filename, packfile, sizeof (pack->filename));
+	pack->handle = packhandle;
+	pack->numfiles = numfiles;
+	pack->files = files;
+
+	// Reverse insert so duplicate names resolve to the first entry, like the old linear search did
+	pack->file_map = HashMap_Create (const char *, int, &HashStr, &HashStrCmp);
+	HashMap_Reserve (pack->file_map, numfiles);
+	for (i = numfiles - 1; i >= 0; --i)
+	{
+		const char *name = files[i].name;
+		HashMap_Insert (pack->file_map, &name, &i);
+	}
+
+	return pack;
+}
+
 /*
 =================
 COM_LoadPackFile -- johnfitz -- modified based on topaz's tutorial
@@ -2176,7 +2454,6 @@ static pack_t *COM_LoadPackFile (const char *packfile, int packhandle)
 	int			   i;
 	packfile_t	  *newfiles;
 	int			   numpackfiles;
-	pack_t		  *pack;
 	unsigned short crc;
 
 	// use global as temporary to prevent stack consumption,
@@ -2228,14 +2505,126 @@ static pack_t *COM_LoadPackFile (const char *packfile, int packhandle)
 		newfiles[i].filelen = LittleLong (info[i].filelen);
 	}
 
-	pack = (pack_t *)Mem_Alloc (sizeof (pack_t));
-	q_strlcpy (pack->filename, packfile, sizeof (pack->filename));
-	pack->handle = packhandle;
-	pack->numfiles = numpackfiles;
-	pack->files = newfiles;
-
 	// Sys_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
-	return pack;
+	return COM_CreatePack (packfile, packhandle, newfiles, numpackfiles);
+}
+
+typedef struct
+{
+	int		   handle;
+	qfileofs_t size;
+} zip_read_t;
+
+static size_t COM_ZipReadFunc (void *opaque, mz_uint64 ofs, void *buf, size_t n)
+{
+	const zip_read_t *zip = (const zip_read_t *)opaque;
+	if (ofs >= (mz_uint64)zip->size || ofs > INT_MAX)
+		return 0;
+	n = q_min (n, (size_t)(zip->size - ofs));
+	Sys_FileSeek (zip->handle, (int)ofs);
+	return Sys_FileRead (zip->handle, buf, (int)n);
+}
+
+/*
+=================
+COM_LoadZipFile
+
+Parses the central directory of a pk3 once into a pack. filepos points past the
+local header at the entry data, so stored entries are read exactly like pak entries
+and deflated ones are inflated by COM_InflatePackEntry.
+=================
+*/
+static pack_t *COM_LoadZipFile (const char *zipfile, int ziphandle, qfileofs_t zipsize)
+{
+	mz_zip_archive archive;
+	zip_read_t	   zip = {ziphandle, zipsize};
+	packfile_t	  *newfiles;
+	int			   i, numfiles, numzipfiles;
+
+	memset (&archive, 0, sizeof (archive));
+	archive.m_pRead = COM_ZipReadFunc;
+	archive.m_pIO_opaque = &zip;
+	if (zipsize <= 0 || zipsize > INT_MAX || !mz_zip_reader_init (&archive, zipsize, 0))
+	{
+		Sys_Printf ("WARNING: %s is not a valid pk3, ignored\n", zipfile);
+		Sys_FileClose (ziphandle);
+		return NULL;
+	}
+
+	numzipfiles = (int)mz_zip_reader_get_num_files (&archive);
+	newfiles = (packfile_t *)Mem_Alloc (q_max (numzipfiles, 1) * sizeof (packfile_t));
+	numfiles = 0;
+	for (i = 0; i < numzipfiles; i++)
+	{
+		mz_zip_archive_file_stat stat;
+		byte					 local_header[30];
+		packfile_t				*entry = &newfiles[numfiles];
+
+		if (!mz_zip_reader_file_stat (&archive, i, &stat) || stat.m_is_directory || !stat.m_is_supported)
+			continue;
+		if ((stat.m_method != 0 && stat.m_method != MZ_DEFLATED) || strlen (stat.m_filename) >= sizeof (entry->name))
+			continue;
+		if (stat.m_uncomp_size > INT_MAX || stat.m_comp_size > INT_MAX)
+			continue;
+		if (COM_ZipReadFunc (&zip, stat.m_local_header_ofs, local_header, sizeof (local_header)) != sizeof (local_header) ||
+			local_header[0] != 'P' || local_header[1] != 'K' || local_header[2] != 3 || local_header[3] != 4)
+			continue;
+
+		const qfileofs_t filepos = (qfileofs_t)stat.m_local_header_ofs + sizeof (local_header) + (local_header[26] | (local_header[27] << 8)) +
+								   (local_header[28] | (local_header[29] << 8));
+		const qfileofs_t packedlen = (stat.m_method == MZ_DEFLATED) ? (qfileofs_t)stat.m_comp_size : (qfileofs_t)stat.m_uncomp_size;
+		if (filepos + packedlen > zipsize)
+			continue;
+
+		q_strlcpy (entry->name, stat.m_filename, sizeof (entry->name));
+		entry->filepos = (int)filepos;
+		entry->filelen = (int)stat.m_uncomp_size;
+		entry->packedlen = (stat.m_method == MZ_DEFLATED) ? (int)stat.m_comp_size : 0;
+		numfiles++;
+	}
+	mz_zip_reader_end (&archive);
+
+	com_modified = true;
+	return COM_CreatePack (zipfile, ziphandle, newfiles, numfiles);
+}
+
+/*
+=================
+COM_InflatePackEntry
+
+Returns a Mem_Alloc'ed copy of a deflated pk3 entry, or NULL if it is corrupt.
+Doesn't use the shared pak handle, so it is safe to call from worker tasks.
+=================
+*/
+static byte *COM_InflatePackEntry (const pack_t *pak, const packfile_t *entry)
+{
+	const byte *packed = NULL;
+	byte	   *packed_copy = NULL;
+	byte	   *data;
+	size_t		size;
+
+	if (pak->memory)
+		packed = pak->memory + entry->filepos;
+	else
+	{
+		FILE *f = fopen (pak->filename, "rb");
+		packed_copy = (byte *)Mem_AllocNonZero (entry->packedlen);
+		if (f && Sys_FileReadAt (f, packed_copy, entry->packedlen, entry->filepos) == (size_t)entry->packedlen)
+			packed = packed_copy;
+		if (f)
+			fclose (f);
+	}
+
+	data = (byte *)Mem_AllocNonZero (q_max (entry->filelen, 1));
+	size = packed ? tinfl_decompress_mem_to_mem (data, entry->filelen, packed, entry->packedlen, 0) : TINFL_DECOMPRESS_MEM_TO_MEM_FAILED;
+	Mem_Free (packed_copy);
+	if (size != (size_t)entry->filelen)
+	{
+		Sys_Printf ("WARNING: %s in %s is corrupt\n", entry->name, pak->filename);
+		Mem_Free (data);
+		return NULL;
+	}
+	return data;
 }
 
 const char *COM_GetGameNames (qboolean full)
@@ -2290,6 +2679,144 @@ qboolean COM_GameDirMatches (const char *tdirs)
 	return false;
 }
 
+/*
+=================
+COM_OpenPackFile
+
+Opens a pak or pk3, memory mapped if possible. Returns NULL if it doesn't exist.
+=================
+*/
+static pack_t *COM_OpenPackFile (const char *packfile, qboolean zip)
+{
+	const byte *memory = NULL;
+	qfileofs_t	memory_size = 0;
+	qfileofs_t	file_size;
+	pack_t	   *pak;
+	int			packhandle, i;
+
+	if (com_map_paks)
+	{
+		memory = Sys_MapFileRead (packfile, &memory_size);
+		if (memory && memory_size > INT_MAX)
+		{ // memory handles are limited to 32 bit offsets
+			Sys_UnmapFile (memory, memory_size);
+			memory = NULL;
+		}
+	}
+
+	if (memory)
+	{
+		Sys_MemFileOpenRead (memory, (int)memory_size, &packhandle);
+		pak = zip ? COM_LoadZipFile (packfile, packhandle, memory_size) : COM_LoadPackFile (packfile, packhandle);
+		if (!pak)
+		{
+			Sys_UnmapFile (memory, memory_size);
+			return NULL;
+		}
+
+		// views point straight into the mapping, so every entry has to be in range
+		for (i = 0; i < pak->numfiles; i++)
+		{
+			const packfile_t *entry = &pak->files[i];
+			const int		  storedlen = entry->packedlen ? entry->packedlen : entry->filelen;
+			if (entry->filepos < 0 || storedlen < 0 || (qfileofs_t)entry->filepos + storedlen > memory_size)
+				break;
+		}
+		if (i == pak->numfiles)
+		{
+			pak->memory = memory;
+			pak->memory_size = memory_size;
+			pak->mapped = true;
+			return pak;
+		}
+
+		Sys_Printf ("WARNING: %s has entries outside of the file, not mapping it\n", packfile);
+		Sys_FileClose (pak->handle);
+		HashMap_Destroy (pak->file_map);
+		Mem_Free (pak->files);
+		Mem_Free (pak);
+		Sys_UnmapFile (memory, memory_size);
+	}
+
+	file_size = Sys_FileOpenRead (packfile, &packhandle);
+	if (file_size == -1)
+		return NULL;
+	return zip ? COM_LoadZipFile (packfile, packhandle, file_size) : COM_LoadPackFile (packfile, packhandle);
+}
+
+static int COM_ComparePk3Names (const void *a, const void *b)
+{
+	return q_strcasecmp (*(const char *const *)a, *(const char *const *)b);
+}
+
+/*
+=================
+COM_AddPk3Files
+
+Adds the pk3 files in com_gamedir in alphabetical order, so later names override earlier ones
+=================
+*/
+static void COM_AddPk3Files (const char *dir, unsigned int path_id)
+{
+	char		**names = NULL;
+	int			  i, numnames = 0;
+	char		  pakfile[MAX_OSPATH];
+	searchpath_t *search;
+	pack_t		 *pak;
+#ifdef _WIN32
+	WIN32_FIND_DATA fdat;
+	HANDLE			fhnd;
+
+	q_snprintf (pakfile, sizeof (pakfile), "%s/*.pk3", com_gamedir);
+	fhnd = FindFirstFile (pakfile, &fdat);
+	if (fhnd != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			names = (char **)Mem_Realloc (names, (numnames + 1) * sizeof (char *));
+			names[numnames++] = q_strdup (fdat.cFileName);
+		} while (FindNextFile (fhnd, &fdat));
+		FindClose (fhnd);
+	}
+#else
+	DIR			  *dir_p;
+	struct dirent *dir_t;
+
+	dir_p = opendir (com_gamedir);
+	if (dir_p)
+	{
+		while ((dir_t = readdir (dir_p)) != NULL)
+		{
+			if (q_strcasecmp (COM_FileGetExtension (dir_t->d_name), "pk3") != 0)
+				continue;
+			names = (char **)Mem_Realloc (names, (numnames + 1) * sizeof (char *));
+			names[numnames++] = q_strdup (dir_t->d_name);
+		}
+		closedir (dir_p);
+	}
+#endif
+
+	if (numnames > 1)
+		qsort (names, numnames, sizeof (char *), COM_ComparePk3Names);
+	for (i = 0; i < numnames; i++)
+	{
+		q_snprintf (pakfile, sizeof (pakfile), "%s/%s", com_gamedir, names[i]);
+		Mem_Free (names[i]);
+		if (Sys_FileType (pakfile) != FS_ENT_FILE)
+			continue;
+		pak = COM_OpenPackFile (pakfile, true);
+		if (!pak)
+			continue;
+		search = (searchpath_t *)Mem_Alloc (sizeof (searchpath_t));
+		search->path_id = path_id;
+		search->pack = pak;
+		q_strlcpy (search->dir, dir, sizeof (search->dir));
+		search->next = com_searchpaths;
+		com_searchpaths = search;
+	}
+	Mem_Free (names);
+}
+
 /*
 =================
 COM_AddGameDirectory -- johnfitz -- modified based on topaz's tutorial
@@ -2344,9 +2871,9 @@ _add_path:
 	for (i = 0;; i++)
 	{
 		q_snprintf (pakfile, sizeof (pakfile), "%s/pak%i.pak", com_gamedir, i);
-		if (Sys_FileOpenRead (pakfile, &packhandle) == -1)
+		if (Sys_FileType (pakfile) != FS_ENT_FILE)
 			break;
-		pak = COM_LoadPackFile (pakfile, packhandle);
+		pak = COM_OpenPackFile (pakfile, false);
 		if (pak)
 		{
 			search = (searchpath_t *)Mem_Alloc (sizeof (searchpath_t));
@@ -2376,6 +2903,8 @@ _add_path:
 			qboolean pak0_modified = com_modified;
 			Sys_MemFileOpenRead (vkquake_pak_extracted, vkquake_pak_size_extracted, &packhandle);
 			pak = COM_LoadPackFile ("vkquake.pak", packhandle);
+			pak->memory = vkquake_pak_extracted;
+			pak->memory_size = vkquake_pak_size_extracted;
 			search = (searchpath_t *)Mem_Alloc (sizeof (searchpath_t));
 			search->path_id = path_id;
 			search->pack = pak;
@@ -2389,6 +2918,8 @@ _add_path:
 			break;
 	}
 
+	COM_AddPk3Files (dir, path_id);
+
 	if (!been_here && host_parms->userdir != host_parms->basedir)
 	{
 		been_here = true;
@@ -2409,9 +2940,15 @@ void COM_ResetGameDirectories (const char *newdirs)
 		if (com_searchpaths->pack)
 		{
 			Sys_FileClose (com_searchpaths->pack->handle);
+			if (com_searchpaths->pack->mapped)
+				Sys_UnmapFile (com_searchpaths->pack->memory, com_searchpaths->pack->memory_size);
+			HashMap_Destroy (com_searchpaths->pack->file_map);
 			Mem_Free (com_searchpaths->pack->files);
 			Mem_Free (com_searchpaths->pack);
 		}
+		SDL_LockMutex (com_missing_files_mutex);
+		COM_FreeMissingFiles (com_searchpaths);
+		SDL_UnlockMutex (com_missing_files_mutex);
 		search = com_searchpaths->next;
 		Mem_Free (com_searchpaths);
 		com_searchpaths = search;
@@ -2520,10 +3057,12 @@ static void COM_Game_f (void)
 		// Write config file
 		Host_WriteConfiguration ();
 
+		// before the paks go away: models can hold views into them, see COM_LoadFileView
+		Mod_ResetAll ();
+
 		COM_ResetGameDirectories (paths);
 
 		// clear out and reload appropriate data
-		Mod_ResetAll ();
 		Sky_ClearAll ();
 		if (!isDedicated)
 		{
@@ -2564,6 +3103,10 @@ void COM_InitFilesystem (void) // johnfitz -- modified based on topaz's tutorial
 	int			i, j;
 	const char *p;
 
+	com_missing_files_mutex = SDL_CreateMutex ();
+	com_file_mappings_mutex = SDL_CreateMutex ();
+	com_map_paks = !COM_CheckParm ("-nomappaks");
+
 	Cvar_RegisterVariable (&registered);
 	Cvar_RegisterVariable (&cmdline);
 	Cmd_AddCommand ("path", COM_Path_f);
@@ -2643,6 +3186,95 @@ void COM_InitFilesystem (void) // johnfitz -- modified based on topaz's tutorial
  * Allocating and filling in the fshandle_t structure is the users'
  * responsibility when the file is initially opened. */
 
+/*
+===========
+FS_OpenLocated
+
+Opens what COM_LocateFile found: entry i of a pak, or netpath
+===========
+*/
+static qboolean FS_OpenLocated (searchpath_t *search, int i, const char *netpath, fshandle_t *fh, unsigned int *path_id)
+{
+	memset (fh, 0, sizeof (*fh));
+	if (search->pack)
+	{
+		const pack_t *pak = search->pack;
+		fh->pak = true;
+		fh->length = pak->files[i].filelen;
+		if (pak->files[i].packedlen)
+		{
+			fh->memory = COM_InflatePackEntry (pak, &pak->files[i]);
+			if (!fh->memory)
+				return false;
+			fh->owned = true;
+		}
+		else if (pak->memory)
+			fh->memory = pak->memory + pak->files[i].filepos;
+		else
+		{ /* private FILE on the pak, the shared pak->handle is not thread safe */
+			fh->file = fopen (pak->filename, "rb");
+			if (!fh->file)
+				return false;
+			fh->start = pak->files[i].filepos;
+			fseek (fh->file, fh->start, SEEK_SET);
+		}
+	}
+	else
+	{
+		fh->file = fopen (netpath, "rb");
+		if (!fh->file)
+			return false;
+		fh->length = COM_filelength (fh->file);
+	}
+
+	if (path_id)
+		*path_id = search->path_id;
+	return true;
+}
+
+/*
+===========
+FS_Open
+===========
+*/
+qboolean FS_Open (const char *filename, fshandle_t *fh, unsigned int *path_id)
+{
+	char		  netpath[MAX_OSPATH];
+	int			  i;
+	searchpath_t *search = COM_LocateFile (filename, &i, netpath, sizeof (netpath));
+	if (!search)
+	{
+		memset (fh, 0, sizeof (*fh));
+		return false;
+	}
+	return FS_OpenLocated (search, i, netpath, fh, path_id);
+}
+
+/*
+===========
+FS_pread
+===========
+*/
+size_t FS_pread (fshandle_t *fh, void *ptr, size_t size, long offset)
+{
+	if (!fh)
+	{
+		errno = EBADF;
+		return 0;
+	}
+	if (offset < 0 || offset >= fh->length || !size)
+		return 0;
+
+	if (size > (size_t)(fh->length - offset)) /* just read to end */
+		size = fh->length - offset;
+	if (fh->memory)
+	{
+		memcpy (ptr, fh->memory + offset, size);
+		return size;
+	}
+	return Sys_FileReadAt (fh->file, ptr, size, (qfileofs_t)fh->start + offset);
+}
+
 size_t FS_fread (void *ptr, size_t size, size_t nmemb, fshandle_t *fh)
 {
 	long   byte_size;
@@ -2668,7 +3300,13 @@ size_t FS_fread (void *ptr, size_t size, size_t nmemb, fshandle_t *fh)
 	byte_size = nmemb * size;
 	if (byte_size > fh->length - fh->pos) /* just read to end */
 		byte_size = fh->length - fh->pos;
-	bytes_read = fread (ptr, 1, byte_size, fh->file);
+	if (fh->memory)
+	{
+		memcpy (ptr, fh->memory + fh->pos, byte_size);
+		bytes_read = byte_size;
+	}
+	else
+		bytes_read = fread (ptr, 1, byte_size, fh->file);
 	fh->pos += bytes_read;
 
 	/* fread() must return the number of elements read,
@@ -2720,9 +3358,12 @@ int FS_fseek (fshandle_t *fh, long offset, int whence)
 	if (offset > fh->length) /* just seek to end */
 		offset = fh->length;
 
-	ret = fseek (fh->file, fh->start + offset, SEEK_SET);
-	if (ret < 0)
-		return ret;
+	if (!fh->memory)
+	{
+		ret = fseek (fh->file, fh->start + offset, SEEK_SET);
+		if (ret < 0)
+			return ret;
+	}
 
 	fh->pos = offset;
 	return 0;
@@ -2735,6 +3376,10 @@ int FS_fclose (fshandle_t *fh)
 		errno = EBADF;
 		return -1;
 	}
+	if (fh->owned)
+		Mem_Free (fh->memory);
+	if (fh->memory) /* owned by the pak, or freed above */
+		return 0;
 	return fclose (fh->file);
 }
 
@@ -2752,8 +3397,11 @@ void FS_rewind (fshandle_t *fh)
 {
 	if (!fh)
 		return;
-	clearerr (fh->file);
-	fseek (fh->file, fh->start, SEEK_SET);
+	if (!fh->memory)
+	{
+		clearerr (fh->file);
+		fseek (fh->file, fh->start, SEEK_SET);
+	}
 	fh->pos = 0;
 }
 
@@ -2776,6 +3424,8 @@ int FS_ferror (fshandle_t *fh)
 		errno = EBADF;
 		return -1;
 	}
+	if (fh->memory)
+		return 0;
 	return ferror (fh->file);
 }
 
@@ -2789,6 +3439,8 @@ int FS_fgetc (fshandle_t *fh)
 	if (fh->pos >= fh->length)
 		return EOF;
 	fh->pos += 1;
+	if (fh->memory)
+		return fh->memory[fh->pos - 1];
 	return fgetc (fh->file);
 }
 
@@ -2802,6 +3454,17 @@ char *FS_fgets (char *s, int size, fshandle_t *fh)
 	if (size > (fh->length - fh->pos) + 1)
 		size = (fh->length - fh->pos) + 1;
 
+	if (fh->memory)
+	{
+		const byte *src = fh->memory + fh->pos;
+		const byte *end = memchr (src, '\n', size - 1);
+		int			len = end ? (int)(end - src) + 1 : size - 1;
+		memcpy (s, src, len);
+		s[len] = 0;
+		fh->pos += len;
+		return s;
+	}
+
 	ret = fgets (s, size, fh->file);
 	fh->pos = ftell (fh->file) - fh->start;
 
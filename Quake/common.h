@@ -208,8 +208,8 @@ void MSG_WriteStaticOrBaseLine (
 	sizebuf_t *buf, int idx, struct entity_state_s *state, unsigned int protocol_pext2, unsigned int protocol,
 	unsigned int protocolflags); // spike
 
-extern int		msg_readcount;
-extern qboolean msg_badread; // set if a read goes beyond end of message
+extern THREAD_LOCAL int		 msg_readcount;
+extern THREAD_LOCAL qboolean msg_badread; // set if a read goes beyond end of message
 
 void			   MSG_BeginReading (void);
 int				   MSG_ReadChar (void);
@@ -340,14 +340,19 @@ typedef struct
 {
 	char name[MAX_QPATH];
 	int	 filepos, filelen;
+	int	 packedlen; // deflated size of a pk3 entry, 0 if the data is stored
 } packfile_t;
 
 typedef struct pack_s
 {
-	char		filename[MAX_OSPATH];
-	int			handle;
-	int			numfiles;
-	packfile_t *files;
+	char			   filename[MAX_OSPATH];
+	int				   handle;
+	int				   numfiles;
+	packfile_t		  *files;
+	struct hash_map_s *file_map;	// file name -> index into files
+	const byte		  *memory;		// whole pak in memory (mapped or embedded), NULL if read through handle
+	qfileofs_t		   memory_size;	// size of memory
+	qboolean		   mapped;		// memory came from Sys_MapFileRead
 } pack_t;
 
 typedef struct searchpath_s
@@ -358,7 +363,8 @@ typedef struct searchpath_s
 	char				 filename[MAX_OSPATH];
 	pack_t				*pack;			 // only one of filename / pack will be used
 	char				 dir[MAX_QPATH]; // directory name: "id1", "rogue", etc.
-	struct searchpath_s *next;
+	struct hash_map_s	*missing_files;	 // loose directories only: file names known to be absent
+	struct searchpath_s	*next;
 } searchpath_t;
 
 extern searchpath_t *com_searchpaths;
@@ -380,9 +386,18 @@ int		 COM_OpenFile (const char *filename, int *handle, unsigned int *path_id);
 int		 COM_FOpenFile (const char *filename, FILE **file, unsigned int *path_id);
 qboolean COM_FileExists (const char *filename, unsigned int *path_id);
 void	 COM_CloseFile (int h);
+void	 COM_FlushFileCache (void);
 
 byte *COM_LoadFile (const char *path, unsigned int *path_id);
 
+// Read-only alternative to COM_LoadFile. If the file lives in a memory backed pak
+// the returned pointer points straight into it, loose files are memory mapped,
+// otherwise it is a private copy. Views into paks stay valid until the game changes.
+// Unlike COM_LoadFile the data is NOT guaranteed to be '\0'-terminated.
+// Release with COM_FreeFileView. Safe to call from worker tasks.
+const byte *COM_LoadFileView (const char *path, unsigned int *path_id, int *len);
+void		COM_FreeFileView (const byte *view);
+
 // Opens the given path directly, ignoring search paths.
 // Returns NULL on failure, or else a '\0'-terminated malloc'ed buffer.
 // Loads in "t" mode so CRLF to LF translation is performed on Windows.
@@ -424,17 +439,28 @@ size_t COM_SanitizeDescriptionString (char *dst, size_t dstsize, const char *src
  * to perform non-sequential reads on files reopened on pak files
  * because we need the bookkeeping about file start/end positions.
  * Allocating and filling in the fshandle_t structure is the users'
- * responsibility when the file is initially opened. */
+ * responsibility when the file is initially opened, or done by FS_Open. */
 
 typedef struct _fshandle_t
 {
-	FILE	*file;
-	qboolean pak;	 /* is the file read from a pak */
-	long	 start;	 /* file or data start position */
-	long	 length; /* file or data size */
-	long	 pos;	 /* current position relative to start */
+	FILE	   *file;
+	qboolean	pak;	/* is the file read from a pak */
+	long		start;	/* file or data start position */
+	long		length;	/* file or data size */
+	long		pos;	/* current position relative to start */
+	const byte *memory;	/* file data if from a memory backed pak, file is NULL then */
+	qboolean	owned;	/* memory is a private inflated copy of a pk3 entry, freed by FS_fclose */
 } fshandle_t;
 
+/* Opens filename from the search path into *fh. Unlike COM_FOpenFile
+ * this is reentrant: it neither sets com_filesize/file_from_pak nor
+ * uses a shared pak handle, so it may be called from worker tasks.
+ * Files in memory backed paks get fh->memory instead of a FILE. */
+qboolean FS_Open (const char *filename, fshandle_t *fh, unsigned int *path_id);
+/* positional read relative to the file start, fh->pos is not moved.
+ * Several threads may pread the same handle concurrently. */
+size_t	 FS_pread (fshandle_t *fh, void *ptr, size_t size, long offset);
+
 size_t FS_fread (void *ptr, size_t size, size_t nmemb, fshandle_t *fh);
 int	   FS_fseek (fshandle_t *fh, long offset, int whence);
 long   FS_ftell (fshandle_t *fh);
@@ -43,16 +43,37 @@ float con_cursorspeed = 4;
 
 #define CON_TEXTSIZE (1024 * 1024) // ericw -- was 65536. johnfitz -- new default size
 #define CON_MINSIZE	 16384		   // johnfitz -- old default, now the minimum size
+#define CON_MAXLINE	 1024		   // longer lines continue in a new one
 
 int con_buffersize; // johnfitz -- user can now override default
 
 qboolean con_forcedup; // because no entities to refresh
 
-int	  con_totallines; // total lines in console scrollback
-int	  con_backscroll; // lines up from bottom to display
-int	  con_current;	  // where next message will be printed
-int	  con_x;		  // offset in current line for next print
-char *con_text = NULL;
+// The scrollback is a ring of variable length lines in con_text, they are only
+// wrapped to con_linewidth when drawn so a resize doesn't touch the text
+typedef struct
+{
+	int	  start; // offset in con_text, the text wraps around con_buffersize
+	int	  length;
+	float time;	 // realtime the line was started, for the notify lines
+	short width; // con_linewidth rows was counted for, 0 after the line changed
+	short rows;
+} conline_t;
+
+#define CON_LINE(i)			 (&con_lines[(i) % con_maxlines])
+#define CON_CHAR(line, ofs)	 (con_text[((line)->start + (ofs)) % con_buffersize])
+
+int				  con_backscroll; // rows up from bottom to display
+static char		 *con_text = NULL;
+static conline_t *con_lines;
+static int		  con_maxlines;
+static int		  con_firstline;			  // oldest line still in the ring
+static int		  con_current = -1;			  // line the next character goes to
+static int		  con_notifyline;			  // older lines are no notify lines anymore
+static int		  con_textend;				  // offset in con_text of the next character
+static int		  con_textused;				  // characters held by the lines
+static qboolean	  con_newline = true;		  // the next character starts a new line
+static qboolean	  con_carriagereturn = false; // the next character replaces the current line
 
 cvar_t con_notifytime = {"con_notifytime", "3", CVAR_NONE};			// seconds
 cvar_t con_logcenterprint = {"con_logcenterprint", "1", CVAR_NONE}; // johnfitz
@@ -61,9 +82,7 @@ char con_lastcenterstring[1024];				 // johnfitz
 void (*con_redirect_flush) (const char *buffer); // call this to flush the redirection buffer (for rcon)
 char con_redirect_buffer[8192];
 
-#define NUM_CON_TIMES 4
-float con_times[NUM_CON_TIMES]; // realtime time the line was generated
-								// for transparent notify lines
+#define NUM_CON_TIMES 4 // rows of transparent notify lines
 
 int con_vislines;
 
@@ -137,7 +156,7 @@ void Con_ToggleConsole_f (void)
 	}
 
 	SCR_EndLoadingPlaque ();
-	memset (con_times, 0, sizeof (con_times));
+	Con_ClearNotify ();
 }
 
 /*
@@ -147,9 +166,13 @@ Con_Clear_f
 */
 static void Con_Clear_f (void)
 {
-	if (con_text)
-		memset (con_text, ' ', con_buffersize); // johnfitz -- con_buffersize replaces CON_TEXTSIZE
-	con_backscroll = 0;							// johnfitz -- if console is empty, being scrolled up is confusing
+	SDL_LockMutex (con_mutex);
+	con_firstline = con_current + 1;
+	con_textused = 0;
+	con_newline = true;
+	con_carriagereturn = false;
+	con_backscroll = 0; // johnfitz -- if console is empty, being scrolled up is confusing
+	SDL_UnlockMutex (con_mutex);
 }
 
 /*
@@ -159,11 +182,11 @@ Con_Dump_f -- johnfitz -- adapted from quake2 source
 */
 static void Con_Dump_f (void)
 {
-	int			l, x;
-	const char *line;
-	FILE	   *f;
-	char		buffer[1024];
-	char		name[MAX_OSPATH];
+	int		   l, x, length;
+	conline_t *line;
+	FILE	  *f;
+	char	   buffer[CON_MAXLINE + 1];
+	char	   name[MAX_OSPATH];
 
 	q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argc () >= 2 ? Cmd_Argv (1) : "condump.txt");
 	COM_CreatePath (name);
@@ -174,36 +197,34 @@ static void Con_Dump_f (void)
 		return;
 	}
 
+	SDL_LockMutex (con_mutex);
+
 	// skip initial empty lines
-	for (l = con_current - con_totallines + 1; l <= con_current; l++)
+	for (l = con_firstline; l <= con_current; l++)
 	{
-		line = con_text + (l % con_totallines) * con_linewidth;
-		for (x = 0; x < con_linewidth; x++)
-			if (line[x] != ' ')
+		line = CON_LINE (l);
+		for (x = 0; x < line->length; x++)
+			if ((CON_CHAR (line, x) & 0x7f) != ' ')
 				break;
-		if (x != con_linewidth)
+		if (x != line->length)
 			break;
 	}
 
-	// write the remaining lines
-	buffer[con_linewidth] = 0;
+	// write the remaining lines, unwrapped
 	for (; l <= con_current; l++)
 	{
-		line = con_text + (l % con_totallines) * con_linewidth;
-		strncpy (buffer, line, con_linewidth);
-		for (x = con_linewidth - 1; x >= 0; x--)
-		{
-			if (buffer[x] == ' ')
-				buffer[x] = 0;
-			else
-				break;
-		}
-		for (x = 0; buffer[x]; x++)
-			buffer[x] &= 0x7f;
+		line = CON_LINE (l);
+		for (x = 0; x < line->length; x++)
+			buffer[x] = CON_CHAR (line, x) & 0x7f;
+		for (length = line->length; length > 0 && buffer[length - 1] == ' '; length--)
+			;
+		buffer[length] = 0;
 
 		fprintf (f, "%s\n", buffer);
 	}
 
+	SDL_UnlockMutex (con_mutex);
+
 	fclose (f);
 	Con_Printf ("Dumped console text to %s.\n", name);
 }
@@ -215,10 +236,7 @@ Con_ClearNotify
 */
 void Con_ClearNotify (void)
 {
-	int i;
-
-	for (i = 0; i < NUM_CON_TIMES; i++)
-		con_times[i] = 0;
+	con_notifyline = con_current + 1;
 }
 
 /*
@@ -251,54 +269,20 @@ static void Con_MessageMode2_f (void)
 ================
 Con_CheckResize
 
-If the line width has changed, reformat the buffer.
+Lines are wrapped when drawn, a new width only invalidates their row counts.
 ================
 */
 void Con_CheckResize (void)
 {
-	int	  i, j, width, oldwidth, oldtotallines, numlines, numchars;
-	char *tbuf; // johnfitz -- tbuf no longer a static array
-
-	width = (vid.conwidth >> 3) - 2; // johnfitz -- use vid.conwidth instead of vid.width
+	const int width = (vid.conwidth >> 3) - 2; // johnfitz -- use vid.conwidth instead of vid.width
 
 	if (width == con_linewidth)
 		return;
 
 	SDL_LockMutex (con_mutex);
-
-	oldwidth = con_linewidth;
 	con_linewidth = width;
-	oldtotallines = con_totallines;
-	con_totallines = con_buffersize / con_linewidth; // johnfitz -- con_buffersize replaces CON_TEXTSIZE
-	numlines = oldtotallines;
-
-	if (con_totallines < numlines)
-		numlines = con_totallines;
-
-	numchars = oldwidth;
-
-	if (con_linewidth < numchars)
-		numchars = con_linewidth;
-
-	tbuf = (char *)Mem_Alloc (con_buffersize); // johnfitz
-
-	memcpy (tbuf, con_text, con_buffersize); // johnfitz -- con_buffersize replaces CON_TEXTSIZE
-	memset (con_text, ' ', con_buffersize);	 // johnfitz -- con_buffersize replaces CON_TEXTSIZE
-
-	for (i = 0; i < numlines; i++)
-	{
-		for (j = 0; j < numchars; j++)
-		{
-			con_text[(con_totallines - 1 - i) * con_linewidth + j] = tbuf[((con_current - i + oldtotallines) % oldtotallines) * oldwidth + j];
-		}
-	}
-
-	Con_ClearNotify ();
-	Mem_Free (tbuf);
-
 	con_backscroll = 0;
-	con_current = con_totallines - 1;
-
+	Con_ClearNotify ();
 	SDL_UnlockMutex (con_mutex);
 }
 
@@ -322,14 +306,12 @@ void Con_Init (void)
 	// johnfitz
 
 	con_text = (char *)Mem_Alloc (con_buffersize); // johnfitz -- con_buffersize replaces CON_TEXTSIZE
-	memset (con_text, ' ', con_buffersize);		   // johnfitz -- con_buffersize replaces CON_TEXTSIZE
-	con_linewidth = -1;
+	con_maxlines = con_buffersize / 16;
+	con_lines = (conline_t *)Mem_Alloc (con_maxlines * sizeof (conline_t));
 
 	// johnfitz -- no need to run Con_CheckResize here
 	con_linewidth = 50;
-	con_totallines = con_buffersize / con_linewidth; // johnfitz -- con_buffersize replaces CON_TEXTSIZE
 	con_backscroll = 0;
-	con_current = con_totallines - 1;
 	// johnfitz
 
 	Con_Printf ("Console initialized.\n");
@@ -345,6 +327,17 @@ void Con_Init (void)
 	con_initialized = true;
 }
 
+/*
+===============
+Con_DropLine
+===============
+*/
+static void Con_DropLine (void)
+{
+	con_textused -= CON_LINE (con_firstline)->length;
+	con_firstline++;
+}
+
 /*
 ===============
 Con_Linefeed
@@ -352,16 +345,129 @@ Con_Linefeed
 */
 static void Con_Linefeed (void)
 {
-	// johnfitz -- improved scrolling
-	if (con_backscroll)
-		con_backscroll++;
-	if (con_backscroll > con_totallines - (glheight >> 3) - 1)
-		con_backscroll = con_totallines - (glheight >> 3) - 1;
-	// johnfitz
+	conline_t *line;
+
+	if (con_current - con_firstline + 1 >= con_maxlines)
+		Con_DropLine ();
 
-	con_x = 0;
 	con_current++;
-	memset (&con_text[(con_current % con_totallines) * con_linewidth], ' ', con_linewidth);
+	line = CON_LINE (con_current);
+	line->start = con_textend;
+	line->length = 0;
+	line->time = realtime; // mark time for transparent overlay
+	line->width = 0;
+}
+
+/*
+===============
+Con_PutChar
+===============
+*/
+static void Con_PutChar (int c)
+{
+	conline_t *line = CON_LINE (con_current);
+
+	if (line->length >= CON_MAXLINE)
+	{
+		Con_Linefeed ();
+		line = CON_LINE (con_current);
+	}
+
+	// the oldest lines make room, CON_MAXLINE keeps the current one from being dropped
+	while (con_textused >= con_buffersize)
+		Con_DropLine ();
+
+	con_text[con_textend] = c;
+	con_textend = (con_textend + 1) % con_buffersize;
+	con_textused++;
+	line->length++;
+	line->width = 0;
+}
+
+/*
+================
+Con_WrapLine
+
+Breaks a line into rows the way the old fixed grid did: a word that doesn't fit
+moves to the next row, a word longer than a row is split. Fills the offsets of
+up to maxrows rows and returns the number of rows.
+================
+*/
+static int Con_WrapLine (const conline_t *line, int width, int *starts, int maxrows)
+{
+	int		 i, l, x, rows;
+	qboolean boundary;
+
+	rows = 1;
+	if (starts && maxrows > 0)
+		starts[0] = 0;
+
+	boundary = true;
+	for (i = x = 0; i < line->length; i++, x++)
+	{
+		qboolean wrap = (x >= width);
+
+		if ((CON_CHAR (line, i) & 0x7f) <= ' ')
+			boundary = true;
+		else if (boundary)
+		{
+			// count word length
+			for (l = 0; l < width && i + l < line->length; l++)
+				if ((CON_CHAR (line, i + l) & 0x7f) <= ' ')
+					break;
+
+			// word wrap
+			if (l != width && (x + l > width))
+				wrap = true;
+
+			boundary = false;
+		}
+
+		if (wrap && x > 0)
+		{
+			if (starts && rows < maxrows)
+				starts[rows] = i;
+			rows++;
+			x = 0;
+		}
+	}
+
+	return rows;
+}
+
+/*
+================
+Con_LineRows
+================
+*/
+static int Con_LineRows (conline_t *line)
+{
+	if (line->width != con_linewidth)
+	{
+		line->rows = Con_WrapLine (line, con_linewidth, NULL, 0);
+		line->width = con_linewidth;
+	}
+	return line->rows;
+}
+
+/*
+================
+Con_MaxBackscroll
+
+How far the scrollback can go up before the oldest row leaves the top of the console
+================
+*/
+int Con_MaxBackscroll (void)
+{
+	int i, rows = 0;
+
+	SDL_LockMutex (con_mutex);
+	for (i = con_firstline; i <= con_current; i++)
+		rows += Con_LineRows (CON_LINE (i));
+	SDL_UnlockMutex (con_mutex);
+
+	// two rows for the input and version lines, two for the scrollback arrows
+	return q_max (0, rows - ((con_vislines + 7) / 8 - 4));
 }
 
 /*
@@ -375,11 +481,8 @@ If no console is visible, the notify window will pop up.
 */
 static void Con_Print (const char *txt)
 {
-	int		   y;
-	int		   c, l;
-	static int cr;
-	int		   mask;
-	qboolean   boundary;
+	int		 i, c, mask, rows, firstline;
+	qboolean backscroll;
 
 	SDL_LockMutex (con_mutex);
 
@@ -399,75 +502,86 @@ static void Con_Print (const char *txt)
 	else
 		mask = 0;
 
-	boundary = true;
+	// johnfitz -- improved scrolling, new rows push a scrolled back view up so it stays put
+	backscroll = con_backscroll && (con_current >= con_firstline);
+	firstline = con_current;
+	rows = backscroll ? Con_LineRows (CON_LINE (con_current)) : 0;
 
 	while ((c = *txt))
 	{
-		if (c <= ' ')
-		{
-			boundary = true;
-		}
-		else if (boundary)
-		{
-			// count word length
-			for (l = 0; l < con_linewidth; l++)
-				if (txt[l] <= ' ')
-					break;
-
-			// word wrap
-			if (l != con_linewidth && (con_x + l > con_linewidth))
-				con_x = 0;
-
-			boundary = false;
-		}
-
 		txt++;
 
-		if (cr)
+		if (con_newline)
 		{
-			con_current--;
-			cr = false;
-		}
-
-		if (!con_x)
-		{
-			Con_Linefeed ();
-			// mark time for transparent overlay
-			if (con_current >= 0)
-				con_times[con_current % NUM_CON_TIMES] = realtime;
+			if (con_carriagereturn && (con_current >= con_firstline))
+			{
+				conline_t *line = CON_LINE (con_current);
+				con_textused -= line->length;
+				con_textend = line->start;
+				line->length = 0;
+				line->time = realtime;
+				line->width = 0;
+			}
+			else
+				Con_Linefeed ();
+			con_newline = false;
+			con_carriagereturn = false;
 		}
 
 		switch (c)
 		{
 		case '\n':
-			con_x = 0;
+			con_newline = true;
 			break;
 
 		case '\r':
-			con_x = 0;
-			cr = 1;
+			con_newline = true;
+			con_carriagereturn = true;
 			break;
 
 		default: // display character and advance
-			y = con_current % con_totallines;
-			con_text[y * con_linewidth + con_x] = c | mask;
-			con_x++;
-			if (con_x >= con_linewidth)
-				con_x = 0;
+			Con_PutChar (c | mask);
 			break;
 		}
 	}
+
+	if (backscroll)
+	{
+		for (i = q_max (firstline, con_firstline); i <= con_current; i++)
+			rows -= Con_LineRows (CON_LINE (i));
+		con_backscroll = q_max (0, con_backscroll - rows);
+	}
+
 	SDL_UnlockMutex (con_mutex);
 }
 
 // borrowed from uhexen2 by S.A. for new procs, LOG_Init, LOG_Close
 
-static char logfilename[MAX_OSPATH]; // current logfile name
-static int	log_fd = -1;			 // log file descriptor
+static char	  logfilename[MAX_OSPATH]; // current logfile name
+static int	  log_fd = -1;			   // log file descriptor
+static char	  log_buffer[16384];	   // messages not written yet
+static size_t log_buffered;
+static double log_flushtime;
+
+/*
+================
+Con_FlushDebugLog
+================
+*/
+static void Con_FlushDebugLog (void)
+{
+	if (log_buffered && write (log_fd, log_buffer, log_buffered) != log_buffered)
+		log_buffered = 0; // Nonsense to supress warning
+	log_buffered = 0;
+	log_flushtime = Sys_DoubleTime ();
+}
 
 /*
 ================
 Con_DebugLog
+
+Batches the writes, developer spam would otherwise make one syscall per message.
+Nothing stays buffered for longer than a tenth of a second in case the engine dies.
 ================
 */
 void Con_DebugLog (const char *msg)
@@ -476,8 +590,22 @@ void Con_DebugLog (const char *msg)
 		return;
 
 	size_t msg_len = strlen (msg);
-	if (write (log_fd, msg, msg_len) != msg_len)
-		return; // Nonsense to supress warning
+	SDL_LockMutex (con_mutex);
+	if (log_buffered + msg_len > sizeof (log_buffer))
+		Con_FlushDebugLog ();
+	if (msg_len >= sizeof (log_buffer))
+	{
+		if (write (log_fd, msg, msg_len) != msg_len)
+			msg_len = 0; // Nonsense to supress warning
+	}
+	else
+	{
+		memcpy (log_buffer + log_buffered, msg, msg_len);
+		log_buffered += msg_len;
+	}
+	if (Sys_DoubleTime () - log_flushtime > 0.1)
+		Con_FlushDebugLog ();
+	SDL_UnlockMutex (con_mutex);
 }
 
 /*
@@ -523,12 +651,17 @@ void Con_Printf (const char *fmt, ...)
 		// Profiling lines can self-invalidate the HUD every second, skewing ui_speeds.
 		const qboolean is_ui_profile_line = !strncmp (msg, "ui(avg1s)", 9) || !strncmp (msg, "ui(update avg1s)", 16) || !strncmp (msg, "ui ", 3);
 		if (!is_ui_profile_line)
+		{
+			// Serializes the producers of the UI's notify ring
+			SDL_LockMutex (con_mutex);
 			UI_NotifyPrint (msg);
+			SDL_UnlockMutex (con_mutex);
+		}
 	}
 #endif
 
 	// update the screen if the console is displayed
-	if (cls.signon != SIGNONS && !scr_disabled_for_loading && !Tasks_IsWorker ())
+	if (cls.signon != SIGNONS && !scr_disabled_for_loading && !Tasks_IsWorker () && !Host_IsServerThread ())
 	{
 		// protect against infinite loop if something in SCR_UpdateScreen calls
 		// Con_Printd
@@ -757,15 +890,6 @@ tab_t *tablist;
 
 // defs from elsewhere
 extern qboolean		   keydown[256];
-extern cmd_function_t *cmd_functions;
-#define MAX_ALIAS_NAME 32
-typedef struct cmdalias_s
-{
-	struct cmdalias_s *next;
-	char			   name[MAX_ALIAS_NAME];
-	char			  *value;
-} cmdalias_t;
-extern cmdalias_t *cmd_alias;
 
 /*
 ============
@@ -1089,6 +1213,44 @@ DRAWING
 ==============================================================================
 */
 
+/*
+================
+Con_DrawRows
+
+Draws the count newest rows of the scrollback that are skip rows up from the bottom, the top one at y
+================
+*/
+static void Con_DrawRows (cb_context_t *cbx, int y, int count, int skip)
+{
+	int	 i, j, x, rows, end;
+	int	 starts[CON_MAXLINE];
+	char text[CON_MAXLINE + 1];
+
+	y += (count - 1) * 8;
+	for (i = con_current; i >= con_firstline && count > 0; i--)
+	{
+		conline_t *line = CON_LINE (i);
+
+		rows = Con_LineRows (line);
+		if (skip >= rows)
+		{
+			skip -= rows;
+			continue;
+		}
+
+		Con_WrapLine (line, con_linewidth, starts, countof (starts));
+		for (j = rows - 1 - skip; j >= 0 && count > 0; j--, count--, y -= 8)
+		{
+			end = (j + 1 < rows) ? starts[j + 1] : line->length;
+			for (x = starts[j]; x < end; x++)
+				text[x - starts[j]] = CON_CHAR (line, x);
+			text[end - starts[j]] = 0;
+			Draw_String (cbx, 8, y, text);
+		}
+		skip = 0;
+	}
+}
+
 /*
 ================
 Con_DrawNotify
@@ -1098,34 +1260,31 @@ Draws the last few lines of output transparently over the game top
 */
 void Con_DrawNotify (cb_context_t *cbx)
 {
-	int			i, x, v;
-	const char *text;
-	float		time;
+	int			i, v, rows;
+	const float notifytime = con_notifytime.value / (scr_viewsize.value >= 130 ? 4 : 1);
 
 	GL_SetCanvas (cbx, CANVAS_CONSOLE); // johnfitz
 	v = vid.conheight;					// johnfitz
 
-	for (i = con_current - NUM_CON_TIMES + 1; i <= con_current; i++)
+	SDL_LockMutex (con_mutex);
+	rows = 0;
+	for (i = con_current; i >= q_max (con_firstline, con_notifyline) && rows < NUM_CON_TIMES; i--)
 	{
-		if (i < 0)
-			continue;
-		time = con_times[i % NUM_CON_TIMES];
-		if (time == 0)
-			continue;
-		time = realtime - time;
-		if (time > con_notifytime.value / (scr_viewsize.value >= 130 ? 4 : 1))
-			continue;
-		text = con_text + (i % con_totallines) * con_linewidth;
-
-		for (x = 0; x < con_linewidth; x++)
-			Draw_Character (cbx, (x + 1) << 3, v, text[x]);
-
-		v += 8;
+		if (realtime - CON_LINE (i)->time > notifytime)
+			break;
+		rows += Con_LineRows (CON_LINE (i));
 	}
+	rows = q_min (rows, NUM_CON_TIMES);
+	Con_DrawRows (cbx, v, rows, 0);
+	SDL_UnlockMutex (con_mutex);
+	v += rows * 8;
 
 #ifndef USE_RMLUI
 	if (key_dest == key_message)
 	{
+		const char *text;
+		int			x;
+
 		if (chat_team)
 		{
 			Draw_String (cbx, 8, v, "say_team:");
@@ -1199,9 +1358,8 @@ The typing input line at the bottom should only be drawn if typing is allowed
 */
 void Con_DrawConsole (cb_context_t *cbx, int lines, qboolean drawinput)
 {
-	int			i, x, y, j, sb, rows;
-	const char *text;
-	char		ver[32];
+	int	 x, y, sb, rows;
+	char ver[32];
 
 	if (lines <= 0)
 		return;
@@ -1218,16 +1376,11 @@ void Con_DrawConsole (cb_context_t *cbx, int lines, qboolean drawinput)
 	rows -= 2; // for input and version lines
 	sb = (con_backscroll) ? 2 : 0;
 
-	for (i = con_current - rows + 1; i <= con_current - sb; i++, y += 8)
-	{
-		j = i - con_backscroll;
-		if (j < 0)
-			j = 0;
-		text = con_text + (j % con_totallines) * con_linewidth;
-
-		for (x = 0; x < con_linewidth; x++)
-			Draw_Character (cbx, (x + 1) << 3, y, text[x]);
-	}
+	// one batch of quads per row, only the visible lines are wrapped
+	SDL_LockMutex (con_mutex);
+	Con_DrawRows (cbx, y, rows - sb, con_backscroll);
+	SDL_UnlockMutex (con_mutex);
+	y += (rows - sb) * 8;
 
 	// draw scrollback arrows
 	if (con_backscroll)
@@ -1316,6 +1469,7 @@ void LOG_Close (void)
 {
 	if (log_fd == -1)
 		return;
+	Con_FlushDebugLog ();
 	close (log_fd);
 	log_fd = -1;
 }
@@ -26,7 +26,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 //
 // console
 //
-extern int					con_totallines;
 extern int					con_backscroll;
 extern qboolean				con_forcedup; // because no entities to refresh
 extern qboolean				con_initialized;
@@ -46,6 +45,7 @@ void	 Con_DPrintf2 (const char *fmt, ...) FUNC_PRINTF (1, 2); // johnfitz
 void	 Con_SafePrintf (const char *fmt, ...) FUNC_PRINTF (1, 2);
 void	 Con_DrawNotify (cb_context_t *cbx);
 void	 Con_ClearNotify (void);
+int		 Con_MaxBackscroll (void);
 void	 Con_ToggleConsole_f (void);
 qboolean Con_IsRedirected (void); // returns true if its redirected. this generally means that things are a little more verbose.
 void	 Con_Redirect (void (*flush) (const char *text));
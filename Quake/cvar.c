@@ -23,8 +23,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
-static cvar_t *cvar_vars;
-static char	   cvar_null_string[] = "";
+static cvar_t	  *cvar_vars;
+static hash_map_t *cvar_map; // name -> cvar_t *, indexes cvar_vars for Cvar_FindVar
+static uint32_t	   cvar_change_count;
+static char		   cvar_null_string[] = "";
 
 //==============================================================================
 //
@@ -298,15 +300,22 @@ Cvar_FindVar
 */
 cvar_t *Cvar_FindVar (const char *var_name)
 {
-	cvar_t *var;
+	cvar_t **var;
 
-	for (var = cvar_vars; var; var = var->next)
-	{
-		if (!strcmp (var_name, var->name))
-			return var;
-	}
+	if (!cvar_map)
+		return NULL;
+	var = HashMap_Lookup (cvar_t *, cvar_map, &var_name);
+	return var ? *var : NULL;
+}
 
-	return NULL;
+/*
+============
+Cvar_ChangeCount
+============
+*/
+uint32_t Cvar_ChangeCount (void)
+{
+	return cvar_change_count;
 }
 
 cvar_t *Cvar_FindVarAfter (const char *prev_name, unsigned int with_flags)
@@ -432,6 +441,18 @@ void Cvar_Reset (const char *name)
 		Cvar_SetQuick (var, var->default_string);
 }
 
+typedef struct
+{
+	cvar_t	   *var;
+	const char *value;
+} cvar_setcall_t;
+
+static void Cvar_SetQuickCall (void *data)
+{
+	cvar_setcall_t *call = (cvar_setcall_t *)data;
+	Cvar_SetQuick (call->var, call->value);
+}
+
 void Cvar_SetQuick (cvar_t *var, const char *value)
 {
 	if (var->flags & (CVAR_ROM | CVAR_LOCKED))
@@ -439,6 +460,14 @@ void Cvar_SetQuick (cvar_t *var, const char *value)
 	if (!(var->flags & CVAR_REGISTERED))
 		return;
 
+	if (Host_IsServerThread ())
+	{
+		// callbacks and the client read cvars, only the main thread changes them
+		cvar_setcall_t call = {var, value};
+		Host_CallOnMainThread (Cvar_SetQuickCall, &call);
+		return;
+	}
+
 	if (!var->string)
 		var->string = q_strdup (value);
 	else
@@ -459,6 +488,8 @@ void Cvar_SetQuick (cvar_t *var, const char *value)
 	}
 
 	var->value = atof (var->string);
+	++var->change_count;
+	++cvar_change_count;
 
 	// johnfitz -- save initial value for "reset" command
 	if (!var->default_string)
@@ -620,6 +651,9 @@ void Cvar_RegisterVariable (cvar_t *variable)
 		prev->next = variable;
 	}
 	// johnfitz
+	if (!cvar_map)
+		cvar_map = HashMap_Create (const char *, cvar_t *, &HashStr, &HashStrCmp);
+	HashMap_Insert (cvar_map, &variable->name, &variable);
 	variable->flags |= CVAR_REGISTERED;
 
 	// copy the value off, because future sets will Mem_Free it
@@ -92,6 +92,7 @@ typedef struct cvar_s
 	const char	  *default_string; // johnfitz -- remember defaults for reset function
 	cvarcallback_t callback;
 	struct cvar_s *next;
+	uint32_t	   change_count; // bumped whenever the value changes
 } cvar_t;
 
 void Cvar_RegisterVariable (cvar_t *variable);
@@ -138,6 +139,9 @@ void Cvar_WriteVariables (FILE *f);
 cvar_t *Cvar_FindVar (const char *var_name);
 cvar_t *Cvar_FindVarAfter (const char *prev_name, unsigned int with_flags);
 
+uint32_t Cvar_ChangeCount (void);
+// total number of cvar value changes, polled by the UI to sync only what changed
+
 void Cvar_LockVar (const char *var_name);
 void Cvar_UnlockVar (const char *var_name);
 void Cvar_UnlockAll (void);
@@ -0,0 +1,436 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// ded_null.c -- the client, renderer, sound, input and menus of the dedicated server build (vkquake-ded)
+
+// The server code is shared with vkquake, which only reaches most of these once Host_Init
+// has initialized them, and never does with -dedicated. The few that a dedicated server
+// does call behave the way the real ones do before they are initialized.
+
+#include "quakedef.h"
+
+#ifndef SERVERONLY
+#error ded_null.c is only part of the dedicated server build
+#endif
+
+/*
+=============================================================================
+
+CLIENT
+
+=============================================================================
+*/
+
+client_static_t cls;
+client_state_t	cl;
+
+dlight_t cl_dlights[MAX_DLIGHTS];
+beam_t	 cl_beams[MAX_BEAMS];
+entity_t cl_temp_entities[MAX_TEMP_ENTITIES];
+
+cvar_t cl_name = {"_cl_name", "player", CVAR_ARCHIVE};
+cvar_t cl_color = {"_cl_color", "0", CVAR_ARCHIVE};
+cvar_t cl_startdemos = {"cl_startdemos", "1", CVAR_ARCHIVE};
+
+void CL_Init (void) {}
+void CL_EstablishConnection (const char *host) {}
+void CL_NextDemo (void) {}
+void CL_StopPlayback (void) {}
+void CL_Stop_f (void) {}
+void CL_Resume_Record (qboolean recordsignons) {}
+void CL_AccumulateCmd (void) {}
+void CL_SendCmd (void) {}
+void CL_DecayLights (void) {}
+
+int CL_ReadFromServer (void)
+{
+	return 0;
+}
+
+dlight_t *CL_AllocDlight (int key)
+{
+	return &cl_dlights[0];
+}
+
+void CL_UpdateBeam (struct qmodel_s *m, const char *trailname, const char *impactname, int ent, float *start, float *end) {}
+
+/*
+=====================
+CL_Disconnect
+
+There never is a connection, only the state the server side looks at is reset
+=====================
+*/
+void CL_Disconnect (void)
+{
+	cls.demoplayback = cls.timedemo = false;
+	cls.demopaused = false;
+	cls.signon = 0;
+	cls.netcon = NULL;
+	cl.intermission = 0;
+	cl.worldmodel = NULL;
+	cl.sendprespawn = false;
+}
+
+void CL_Disconnect_f (void)
+{
+	CL_Disconnect ();
+	if (sv.active)
+		Host_ShutdownServer (false);
+}
+
+void CL_FreeState (void)
+{
+	memset (&cl, 0, sizeof (cl));
+}
+
+void Chase_Init (void) {}
+
+/*
+==============
+V_CalcRoll
+
+cl_rollangle is never registered on a dedicated server, so there never was any roll
+==============
+*/
+float V_CalcRoll (vec3_t angles, vec3_t velocity)
+{
+	return 0;
+}
+
+void V_Init (void) {}
+void V_ResetBlend (void) {}
+
+/*
+=============================================================================
+
+KEYS, MENUS AND INPUT
+
+=============================================================================
+*/
+
+keydest_t key_dest;
+char	  key_lines[CMDLINES][MAXCMDLINE];
+int		  key_linepos;
+int		  key_insert;
+double	  key_blinktime;
+int		  edit_line;
+int		  history_line;
+qboolean  keydown[MAX_KEYS];
+qboolean  chat_team;
+
+void Key_Init (void) {}
+void Key_UpdateForDest (void) {}
+void Key_BeginInputGrab (void) {}
+void Key_EndInputGrab (void) {}
+void Key_WriteBindings (FILE *f) {}
+void History_Shutdown (void) {}
+
+void Key_GetGrabbedInput (int *lastkey, int *lastchar)
+{
+	if (lastkey)
+		*lastkey = 0;
+	if (lastchar)
+		*lastchar = 0;
+}
+
+const char *Key_GetChatBuffer (void)
+{
+	return "";
+}
+
+int Key_GetChatMsgLen (void)
+{
+	return 0;
+}
+
+enum m_state_e m_state;
+enum m_state_e m_return_state;
+qboolean	   m_return_onerror;
+char		   m_return_reason[32];
+
+void M_Init (void) {}
+void M_NewGame (void) {}
+void M_UpdateMouse () {}
+void M_Menu_Main_f (void) {}
+void M_Menu_Quit_f (void) {}
+
+void IN_Init (void) {}
+void IN_Shutdown (void) {}
+void IN_Commands (void) {}
+void IN_SendKeyEvents (void) {}
+void IN_UpdateInputMode (void) {}
+void IN_MouseMove (usercmd_t *cmd) {}
+void IN_Activate () {}
+void IN_Deactivate (qboolean free_cursor) {}
+
+void PL_ErrorDialog (const char *text) {}
+
+/*
+=============================================================================
+
+VIDEO AND SCREEN
+
+=============================================================================
+*/
+
+viddef_t		vid;
+modestate_t		modestate = MS_UNINIT;
+vulkanglobals_t vulkan_globals;
+int				glwidth, glheight;
+unsigned int	d_8to24table[256];
+
+qboolean scr_disabled_for_loading;
+qboolean in_update_screen;
+cvar_t	 scr_viewsize = {"viewsize", "100", CVAR_ARCHIVE};
+cvar_t	 scr_sbarscale = {"scr_sbarscale", "1", CVAR_ARCHIVE};
+
+void VID_Init (void) {}
+void VID_Shutdown (void) {}
+void VID_Lock (void) {}
+
+qboolean VID_HasMouseOrInputFocus (void)
+{
+	return false;
+}
+
+qboolean VID_IsMinimized (void)
+{
+	return false;
+}
+
+qboolean VID_PaceFrame (void)
+{
+	return false;
+}
+
+void SCR_Init (void) {}
+void SCR_UpdateScreen (qboolean use_tasks) {}
+void SCR_BeginLoadingPlaque (void) {}
+void SCR_EndLoadingPlaque (void) {}
+void SCR_CenterPrintClear (void) {}
+
+gltexture_t *char_texture;
+qpic_t		*pic_ovr, *pic_ins;
+
+void Draw_Init (void) {}
+void Draw_NewGame (void) {}
+void Draw_Character (cb_context_t *cbx, float x, float y, int num) {}
+void Draw_String (cb_context_t *cbx, float x, float y, const char *str) {}
+void Draw_Pic (cb_context_t *cbx, float x, float y, qpic_t *pic, float alpha, qboolean alpha_blend) {}
+void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t *pic, float s1, float t1, float s2, float t2, float *rgb, float alpha) {}
+void Draw_ConsoleBackground (cb_context_t *cbx) {}
+void GL_SetCanvas (cb_context_t *cbx, canvastype newcanvas) {}
+void Draw_FlushBatch (cb_context_t *cbx) {}
+
+basicvertex_t *Draw_BatchVertices (cb_context_t *cbx, vulkan_pipeline_t pipeline, gltexture_t *texture, int num_verts)
+{
+	Sys_Error ("Draw_BatchVertices: no renderer in the dedicated server");
+	return NULL;
+}
+
+qpic_t *Draw_PicFromWad2 (const char *name, unsigned int texflags)
+{
+	return NULL;
+}
+
+qpic_t *Draw_TryCachePic (const char *path, unsigned int texflags)
+{
+	return NULL;
+}
+
+int fragsort[MAX_SCOREBOARD];
+int scoreboardlines;
+
+void Sbar_Init (void) {}
+
+/*
+=============================================================================
+
+RENDERER
+
+=============================================================================
+*/
+
+vec3_t vup, vpn, vright, r_origin;
+int	   r_trace_line_cache_counter;
+
+cvar_t r_novis = {"r_novis", "0", CVAR_ARCHIVE};
+cvar_t r_lerpmove = {"r_lerpmove", "1", CVAR_ARCHIVE};
+cvar_t r_nolerp_list = {
+	"r_nolerp_list",
+	"progs/flame.mdl,progs/flame2.mdl,progs/braztall.mdl,progs/brazshrt.mdl,progs/longtrch.mdl,progs/flame_pyre.mdl,progs/v_saw.mdl,progs/"
+	"v_xfist.mdl,progs/h2stuff/newfire.mdl",
+	CVAR_NONE};
+cvar_t r_fteparticles = {"r_fteparticles", "1", CVAR_ARCHIVE};
+cvar_t r_particledesc = {"r_particledesc", "classic"};
+
+void R_Init (void) {}
+void R_NewGame (void) {}
+void R_TranslateNewPlayerSkin (int playernum) {}
+void R_AddEfrags (int staticnum) {}
+
+/*
+==============
+R_LightPoint
+
+The server has no lightmaps to sample, getlight finds darkness
+==============
+*/
+int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor)
+{
+	(*lightcolor)[0] = (*lightcolor)[1] = (*lightcolor)[2] = 0;
+	return 0;
+}
+
+byte *R_VertexAllocate (int size, VkBuffer *buffer, VkDeviceSize *buffer_offset)
+{
+	Sys_Error ("R_VertexAllocate: no renderer in the dedicated server");
+	return NULL;
+}
+
+void R_ClearParticles (void) {}
+void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count) {}
+void R_ParticleExplosion (vec3_t org) {}
+void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength) {}
+void R_BlobExplosion (vec3_t org) {}
+void R_LavaSplash (vec3_t org) {}
+void R_TeleportSplash (vec3_t org) {}
+
+void PScript_InitParticles (void) {}
+void PScript_ClearParticles (qboolean load) {}
+void PScript_UpdateModelEffects (qmodel_t *mod) {}
+
+int PScript_FindParticleType (const char *fullname)
+{
+	return P_INVALID;
+}
+
+int PScript_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
+{
+	return false;
+}
+
+int PScript_RunParticleEffectState (vec3_t org, vec3_t dir, float count, int typenum, struct trailstate_s **tsk)
+{
+	return 1;
+}
+
+int PScript_RunParticleEffectTypeString (vec3_t org, vec3_t dir, float count, const char *name)
+{
+	return 1;
+}
+
+int PScript_ParticleTrail (vec3_t startpos, vec3_t end, int type, float timeinterval, int dlkey, vec3_t axis[3], struct trailstate_s **tsk)
+{
+	return 1;
+}
+
+void Fog_ResetFade (void) {}
+void Fog_Update (float density, float red, float green, float blue, float time) {}
+
+const char *Fog_GetFogCommand (qboolean always)
+{
+	return NULL;
+}
+
+void Sky_ClearAll (void) {}
+void Sky_LoadSkyBox (const char *name) {}
+void Sky_SetSkyfog (float value) {}
+void Sky_LoadTexture (qmodel_t *mod, texture_t *mt, int tex_index) {}
+void Sky_LoadTextureQ64 (qmodel_t *mod, texture_t *mt, int tex_index) {}
+
+const char *Sky_GetSkyCommand (qboolean always)
+{
+	return NULL;
+}
+
+void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *hdr) {}
+void GLMesh_UploadBuffers (qmodel_t *mod, aliashdr_t *hdr, unsigned short *indexes, byte *vertexes, aliasmesh_t *desc, jointpose_t *joints) {}
+void GLMesh_DeleteMeshBuffers (aliashdr_t *mainhdr) {}
+void GLMesh_DeleteAllMeshBuffers (void) {}
+void GL_DeleteBModelAccelerationStructures (void) {}
+
+/*
+=============================================================================
+
+TEXTURES
+
+=============================================================================
+*/
+
+void TexMgr_Init (void) {}
+void TexMgr_NewGame (void) {}
+void TexMgr_FreeTexturesForOwner (qmodel_t *owner) {}
+
+gltexture_t *TexMgr_LoadImage (
+	qmodel_t *owner, const char *name, int width, int height, enum srcformat format, byte *data, const char *source_file, src_offset_t source_offset,
+	unsigned flags)
+{
+	return NULL;
+}
+
+glheapstats_t *TexMgr_GetHeapStats (void)
+{
+	return NULL;
+}
+
+byte *Image_LoadTextureImage (const char *name, int *width, int *height, enum srcformat *fmt, unsigned int min_path_id)
+{
+	return NULL;
+}
+
+/*
+=============================================================================
+
+SOUND AND MUSIC
+
+=============================================================================
+*/
+
+void S_Init (void) {}
+void S_FinishInit (void) {}
+void S_Shutdown (void) {}
+void S_ClearAll (void) {}
+void S_StopAllSounds (qboolean clear, qboolean keep_statics) {}
+void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation) {}
+void S_StaticSound (sfx_t *sfx, vec3_t origin, int vol, float attenuation) {}
+void S_LocalSound (const char *name) {}
+void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up) {}
+
+sfx_t *S_PrecacheSound (const char *sample)
+{
+	return NULL;
+}
+
+sfxcache_t *S_LoadSound (sfx_t *s)
+{
+	return NULL;
+}
+
+qboolean BGM_Init (void)
+{
+	return false;
+}
+
+void BGM_Shutdown (void) {}
+void BGM_Update (void) {}
@@ -0,0 +1,416 @@
+/*
+ * frame_stats.c -- per frame timing history
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+#include "gl_heap.h"
+
+// The ring always records the last FRAME_STATS_RING_SIZE host frames so a spike
+// can still be dumped after it happened. frame_stats_ring[frame_stats_head] is the
+// record of the frame in progress, it is only committed by FrameStats_EndFrame.
+static frame_stats_t frame_stats_ring[FRAME_STATS_RING_SIZE];
+static uint32_t		 frame_stats_head;
+static uint32_t		 frame_stats_count;
+
+static frame_stats_t *frame_stats_capture;
+static int			  frame_stats_numcaptured;
+static int			  frame_stats_maxcaptured;
+static qboolean		  frame_stats_capturing;
+
+#define FRAME_STATS_HISTOGRAM_BUCKETS 100 // 1 ms each, the last one collects everything slower
+
+/*
+====================
+FrameStats_BeginFrame
+====================
+*/
+frame_stats_t *FrameStats_BeginFrame (void)
+{
+	frame_stats_t *stats = &frame_stats_ring[frame_stats_head];
+	memset (stats, 0, sizeof (*stats));
+	stats->gpu_ms = -1.0f;
+	stats->latency_ms = -1.0f;
+	stats->ui_total_ms = -1.0f;
+	stats->ui_begin_ms = -1.0f;
+	stats->ui_update_ms = -1.0f;
+	stats->ui_update_context_ms = -1.0f;
+	stats->ui_render_ms = -1.0f;
+	stats->ui_end_ms = -1.0f;
+	stats->ui_gpu_ms = -1.0f;
+	stats->ui_overlay_ms = -1.0f;
+	stats->tasks_busy = -1.0f;
+	return stats;
+}
+
+/*
+====================
+FrameStats_Current
+
+Record of the frame in progress. Tasks of the frame may write their own fields,
+the frame is only committed after they were joined.
+====================
+*/
+frame_stats_t *FrameStats_Current (void)
+{
+	return &frame_stats_ring[frame_stats_head];
+}
+
+/*
+====================
+FrameStats_EndFrame
+====================
+*/
+void FrameStats_EndFrame (void)
+{
+	frame_stats_t *stats = &frame_stats_ring[frame_stats_head];
+	stats->framecount = host_framecount;
+	stats->realtime = realtime;
+	stats->frametime_ms = host_frametime * 1000.0;
+	stats->frame_arena_peak_bytes = Mem_FrameTakePeak ();
+	stats->tasks_busy = Tasks_Utilization ();
+
+	static uint64_t last_net_received, last_net_sent;
+	uint64_t		net_received, net_sent;
+	NET_GetByteCounts (&net_received, &net_sent);
+	stats->net_in_bytes = (uint32_t)(net_received - last_net_received);
+	stats->net_out_bytes = (uint32_t)(net_sent - last_net_sent);
+	last_net_received = net_received;
+	last_net_sent = net_sent;
+
+	if (!isDedicated)
+	{
+		glheapstats_t *tex_stats = TexMgr_GetHeapStats ();
+		stats->tex_heap_allocations = tex_stats->num_allocations;
+		stats->tex_heap_bytes = tex_stats->num_bytes_allocated;
+		glheapstats_t *mesh_stats = R_GetMeshHeapStats ();
+		stats->mesh_heap_allocations = mesh_stats->num_allocations;
+		stats->mesh_heap_bytes = mesh_stats->num_bytes_allocated;
+		stats->vram_bytes = Atomic_LoadUInt64 (&total_device_vulkan_allocation_size);
+	}
+
+	if (frame_stats_capturing)
+	{
+		if (frame_stats_numcaptured == frame_stats_maxcaptured)
+		{
+			frame_stats_maxcaptured = q_max (frame_stats_maxcaptured * 2, FRAME_STATS_RING_SIZE);
+			frame_stats_capture = Mem_Realloc (frame_stats_capture, sizeof (*frame_stats_capture) * frame_stats_maxcaptured);
+		}
+		frame_stats_capture[frame_stats_numcaptured++] = *stats;
+	}
+
+	frame_stats_head = (frame_stats_head + 1) % FRAME_STATS_RING_SIZE;
+	frame_stats_count = q_min (frame_stats_count + 1, FRAME_STATS_RING_SIZE);
+}
+
+/*
+====================
+FrameStats_GetSeries
+====================
+*/
+int FrameStats_GetSeries (frame_stats_series_t series, float *values, int count)
+{
+	count = q_min (count, (int)frame_stats_count);
+	const uint32_t first = (frame_stats_head + FRAME_STATS_RING_SIZE - count) % FRAME_STATS_RING_SIZE;
+	for (int i = 0; i < count; ++i)
+	{
+		const frame_stats_t *s = &frame_stats_ring[(first + i) % FRAME_STATS_RING_SIZE];
+		switch (series)
+		{
+		case FRAME_STATS_FRAME_MS:
+			values[i] = s->frametime_ms;
+			break;
+		case FRAME_STATS_HOST_MS:
+			values[i] = s->host_ms;
+			break;
+		case FRAME_STATS_SERVER_MS:
+			values[i] = s->server_ms;
+			break;
+		case FRAME_STATS_RENDER_MS:
+			values[i] = s->render_ms;
+			break;
+		case FRAME_STATS_UI_MS:
+			values[i] = s->ui_total_ms;
+			break;
+		case FRAME_STATS_GPU_MS:
+			values[i] = s->gpu_ms;
+			break;
+		case FRAME_STATS_TASKS_BUSY:
+			values[i] = (s->tasks_busy >= 0.0f) ? (s->tasks_busy * 100.0f) : -1.0f;
+			break;
+		case FRAME_STATS_NET_IN:
+			values[i] = s->net_in_bytes / 1024.0f;
+			break;
+		case FRAME_STATS_NET_OUT:
+			values[i] = s->net_out_bytes / 1024.0f;
+			break;
+		case FRAME_STATS_HEAP_MB:
+			values[i] = (s->tex_heap_bytes + s->mesh_heap_bytes) / (1024.0f * 1024.0f);
+			break;
+		case FRAME_STATS_VRAM_MB:
+			values[i] = s->vram_bytes / (1024.0f * 1024.0f);
+			break;
+		default:
+			values[i] = -1.0f;
+			break;
+		}
+	}
+	return count;
+}
+
+/*
+====================
+FrameStats_StartCapture
+====================
+*/
+void FrameStats_StartCapture (qboolean append)
+{
+	if (!append)
+		frame_stats_numcaptured = 0;
+	frame_stats_capturing = true;
+}
+
+/*
+====================
+FrameStats_StopCapture
+====================
+*/
+void FrameStats_StopCapture (void)
+{
+	frame_stats_capturing = false;
+}
+
+/*
+====================
+FrameStats_GetCapture
+====================
+*/
+const frame_stats_t *FrameStats_GetCapture (int *count)
+{
+	*count = frame_stats_numcaptured;
+	return frame_stats_capture;
+}
+
+/*
+====================
+FrameStats_FreeCapture
+====================
+*/
+void FrameStats_FreeCapture (void)
+{
+	Mem_Free (frame_stats_capture);
+	frame_stats_capture = NULL;
+	frame_stats_numcaptured = 0;
+	frame_stats_maxcaptured = 0;
+	frame_stats_capturing = false;
+}
+
+/*
+====================
+FrameStats_CompareFloat
+====================
+*/
+static int FrameStats_CompareFloat (const void *a, const void *b)
+{
+	const float fa = *(const float *)a;
+	const float fb = *(const float *)b;
+	return (fa > fb) - (fa < fb);
+}
+
+/*
+====================
+FrameStats_PrintPercentiles
+====================
+*/
+static void FrameStats_PrintPercentiles (const char *name, float *values, int count)
+{
+	if (count == 0)
+		return;
+	qsort (values, count, sizeof (float), FrameStats_CompareFloat);
+	Con_Printf (
+		"%-12s p50 %6.2f p95 %6.2f p99 %6.2f max %6.2f ms\n", name, values[count / 2], values[(count * 95) / 100], values[(count * 99) / 100],
+		values[count - 1]);
+}
+
+/*
+====================
+FrameStats_WriteJSONDistribution
+
+Sorts values, the member is followed by a comma
+====================
+*/
+static void FrameStats_WriteJSONDistribution (FILE *f, const char *indent, const char *name, float *values, int count)
+{
+	double sum = 0.0;
+	int	   i;
+
+	if (count == 0)
+	{
+		fprintf (f, "%s\"%s\": null,\n", indent, name);
+		return;
+	}
+	qsort (values, count, sizeof (float), FrameStats_CompareFloat);
+	for (i = 0; i < count; ++i)
+		sum += values[i];
+	fprintf (
+		f, "%s\"%s\": {\"min\": %.3f, \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"p99.9\": %.3f, \"max\": %.3f},\n", indent, name,
+		values[0], sum / count, values[count / 2], values[(count * 95) / 100], values[(count * 99) / 100], values[(int)(((int64_t)count * 999) / 1000)],
+		values[count - 1]);
+}
+
+/*
+====================
+FrameStats_WriteSummaryJSON
+
+Writes the members of a JSON object (without the braces) describing the
+distribution of the frame times and the CPU/GPU split of the given frames
+====================
+*/
+void FrameStats_WriteSummaryJSON (FILE *f, const frame_stats_t *frames, int count, const char *indent)
+{
+	float *values = Mem_AllocNonZero (q_max (count, 1) * sizeof (float));
+	int	   histogram[FRAME_STATS_HISTOGRAM_BUCKETS];
+	double seconds = 0.0;
+	int	   i, num;
+
+	memset (histogram, 0, sizeof (histogram));
+	for (i = 0; i < count; ++i)
+	{
+		values[i] = frames[i].frametime_ms;
+		seconds += frames[i].frametime_ms / 1000.0;
+		histogram[CLAMP (0, (int)frames[i].frametime_ms, FRAME_STATS_HISTOGRAM_BUCKETS - 1)]++;
+	}
+	fprintf (f, "%s\"frames\": %d,\n", indent, count);
+	fprintf (f, "%s\"seconds\": %.3f,\n", indent, seconds);
+	fprintf (f, "%s\"fps\": %.2f,\n", indent, seconds > 0.0 ? count / seconds : 0.0);
+	FrameStats_WriteJSONDistribution (f, indent, "frame_ms", values, count);
+
+	static const struct
+	{
+		const char *name;
+		size_t		offset;
+	} fields[] = {
+		{"host_ms", offsetof (frame_stats_t, host_ms)},
+		{"server_ms", offsetof (frame_stats_t, server_ms)},
+		{"client_ms", offsetof (frame_stats_t, client_parse_ms)},
+		{"render_ms", offsetof (frame_stats_t, render_ms)},
+		{"ui_ms", offsetof (frame_stats_t, ui_total_ms)},
+		{"gpu_ms", offsetof (frame_stats_t, gpu_ms)},
+		{"latency_ms", offsetof (frame_stats_t, latency_ms)},
+	};
+	for (size_t field = 0; field < countof (fields); ++field)
+	{
+		// negative means not measured in that frame
+		for (i = 0, num = 0; i < count; ++i)
+		{
+			const float value = *(const float *)((const byte *)&frames[i] + fields[field].offset);
+			if (value >= 0.0f)
+				values[num++] = value;
+		}
+		FrameStats_WriteJSONDistribution (f, indent, fields[field].name, values, num);
+	}
+
+	fprintf (f, "%s\"histogram\": {\"bucket_ms\": 1, \"counts\": [", indent);
+	for (i = 0; i < FRAME_STATS_HISTOGRAM_BUCKETS; ++i)
+		fprintf (f, "%s%d", i ? ", " : "", histogram[i]);
+	fprintf (f, "]}\n");
+
+	Mem_Free (values);
+}
+
+/*
+====================
+FrameStats_Dump_f
+
+speeds_dump [filename] -- writes the recorded frames as CSV, oldest first
+====================
+*/
+static void FrameStats_Dump_f (void)
+{
+	char filename[MAX_OSPATH];
+	if (Cmd_Argc () >= 2)
+		q_snprintf (filename, sizeof (filename), "%s/%s", com_gamedir, Cmd_Argv (1));
+	else
+		q_snprintf (filename, sizeof (filename), "%s/speeds.csv", com_gamedir);
+	COM_AddExtension (filename, ".csv", sizeof (filename));
+
+	if (frame_stats_count == 0)
+	{
+		Con_Printf ("speeds_dump: no frames recorded\n");
+		return;
+	}
+
+	FILE *f = fopen (filename, "w");
+	if (!f)
+	{
+		Con_Printf ("speeds_dump: couldn't open %s\n", filename);
+		return;
+	}
+
+	fprintf (
+		f, "frame,realtime,frametime_ms,host_ms,input_ms,server_ms,client_parse_ms,render_ms,sound_ms,scr_begin_ms,scr_build_ms,scr_wait_ms,gpu_ms,latency_ms,"
+		   "ui_total_ms,ui_begin_ms,ui_update_ms,ui_update_context_ms,ui_render_ms,ui_end_ms,ui_gpu_ms,ui_overlay_ms,ui_draw_calls,ui_triangles,"
+		   "brush_polys,alias_polys,"
+		   "tex_heap_allocations,tex_heap_bytes,mesh_heap_allocations,mesh_heap_bytes,frame_arena_peak_bytes,"
+		   "dynbuf_vertex_bytes,dynbuf_index_bytes,dynbuf_uniform_bytes,dynbuf_storage_bytes,vram_bytes,net_in_bytes,net_out_bytes,tasks_busy\n");
+
+	float *host_times = Mem_Alloc (frame_stats_count * sizeof (float));
+	float *render_times = Mem_Alloc (frame_stats_count * sizeof (float));
+	float *ui_update_times = Mem_Alloc (frame_stats_count * sizeof (float));
+	int	   num_ui_update_times = 0;
+
+	const uint32_t first = (frame_stats_head + FRAME_STATS_RING_SIZE - frame_stats_count) % FRAME_STATS_RING_SIZE;
+	for (uint32_t i = 0; i < frame_stats_count; ++i)
+	{
+		const frame_stats_t *s = &frame_stats_ring[(first + i) % FRAME_STATS_RING_SIZE];
+		fprintf (
+			f,
+			"%d,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+			"%u,%u,%u,%u,%u,%" SDL_PRIu64 ",%u,%" SDL_PRIu64 ",%" SDL_PRIu64 ",%u,%u,%u,%u,%" SDL_PRIu64 ",%u,%u,%.3f\n",
+			s->framecount, s->realtime, s->frametime_ms, s->host_ms, s->input_ms, s->server_ms, s->client_parse_ms, s->render_ms, s->sound_ms, s->scr_begin_ms,
+			s->scr_build_ms, s->scr_wait_ms, s->gpu_ms, s->latency_ms, s->ui_total_ms, s->ui_begin_ms, s->ui_update_ms, s->ui_update_context_ms,
+			s->ui_render_ms, s->ui_end_ms, s->ui_gpu_ms, s->ui_overlay_ms, s->ui_draw_calls, s->ui_triangles, s->brush_polys, s->alias_polys,
+			s->tex_heap_allocations, s->tex_heap_bytes, s->mesh_heap_allocations, s->mesh_heap_bytes, s->frame_arena_peak_bytes, s->dynbuf_bytes[0],
+			s->dynbuf_bytes[1], s->dynbuf_bytes[2], s->dynbuf_bytes[3], s->vram_bytes, s->net_in_bytes, s->net_out_bytes, s->tasks_busy);
+		host_times[i] = s->host_ms;
+		render_times[i] = s->render_ms;
+		if (s->ui_update_ms >= 0.0f)
+			ui_update_times[num_ui_update_times++] = s->ui_update_ms;
+	}
+	fclose (f);
+
+	Con_Printf ("Wrote %u frames to %s\n", frame_stats_count, filename);
+	FrameStats_PrintPercentiles ("host", host_times, frame_stats_count);
+	FrameStats_PrintPercentiles ("render", render_times, frame_stats_count);
+	FrameStats_PrintPercentiles ("ui update", ui_update_times, num_ui_update_times);
+
+	Mem_Free (ui_update_times);
+	Mem_Free (render_times);
+	Mem_Free (host_times);
+}
+
+/*
+====================
+FrameStats_Init
+====================
+*/
+void FrameStats_Init (void)
+{
+	Cmd_AddCommand ("speeds_dump", FrameStats_Dump_f);
+	FrameStats_BeginFrame ();
+}
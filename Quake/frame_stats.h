@@ -0,0 +1,104 @@
+/*
+ * frame_stats.h -- per frame timing history
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __FRAME_STATS_H
+#define __FRAME_STATS_H
+
+#include "q_stdinc.h"
+
+#include <stdint.h>
+
+#define FRAME_STATS_RING_SIZE 4096
+
+// One record per host frame, all times are CPU wall clock milliseconds unless noted.
+// Fields that were not measured in a frame are left negative (times) or zero (counters).
+typedef struct frame_stats_s
+{
+	int		 framecount;
+	double	 realtime;
+	float	 frametime_ms; // simulation step (host_frametime)
+	float	 host_ms;
+	float	 input_ms; // events, console commands, net poll
+	float	 server_ms;
+	float	 client_parse_ms;
+	float	 render_ms; // SCR_UpdateScreen + particles
+	float	 sound_ms;
+	float	 scr_begin_ms; // GL_BeginRendering
+	float	 scr_build_ms; // task graph submit, or view + gui when serial
+	float	 scr_wait_ms;  // waiting for the draw tasks, or end rendering when serial
+	float	 gpu_ms;	   // GPU frame time of an earlier frame, needs r_gpuspeeds
+	float	 latency_ms;   // input sample to photon of an earlier frame, needs vid_lowlatency and VK_KHR_present_wait
+	float	 ui_total_ms;
+	float	 ui_begin_ms;
+	float	 ui_update_ms;
+	float	 ui_update_context_ms;
+	float	 ui_render_ms;
+	float	 ui_end_ms;
+	float	 ui_gpu_ms;
+	float	 ui_overlay_ms; // performance overlay, part of ui_update_ms and ui_render_ms
+	uint32_t ui_draw_calls;
+	uint32_t ui_triangles;
+	uint32_t brush_polys; // needs r_speeds
+	uint32_t alias_polys; // needs r_speeds
+	uint32_t tex_heap_allocations;
+	uint32_t mesh_heap_allocations;
+	uint64_t tex_heap_bytes;
+	uint64_t mesh_heap_bytes;
+	uint64_t frame_arena_peak_bytes; // largest single thread frame arena, see Mem_FrameAlloc
+	uint32_t dynbuf_bytes[4];		 // dynamic vertex, index, uniform and storage ring use of an earlier frame
+	uint64_t vram_bytes;			 // device local Vulkan allocations
+	uint32_t net_in_bytes;			 // non-loopback message payload
+	uint32_t net_out_bytes;
+	float	 tasks_busy; // fraction of worker time spent running tasks
+} frame_stats_t;
+
+// Values FrameStats_GetSeries can copy out, mirrored in the UI's engine_bridge.h
+typedef enum
+{
+	FRAME_STATS_FRAME_MS,
+	FRAME_STATS_HOST_MS,
+	FRAME_STATS_SERVER_MS,
+	FRAME_STATS_RENDER_MS,
+	FRAME_STATS_UI_MS,
+	FRAME_STATS_GPU_MS,
+	FRAME_STATS_TASKS_BUSY, // percent
+	FRAME_STATS_NET_IN,		// KiB
+	FRAME_STATS_NET_OUT,	// KiB
+	FRAME_STATS_HEAP_MB,	// texture and mesh heaps
+	FRAME_STATS_VRAM_MB,
+	FRAME_STATS_NUM_SERIES
+} frame_stats_series_t;
+
+void		   FrameStats_Init (void);
+frame_stats_t *FrameStats_BeginFrame (void);
+frame_stats_t *FrameStats_Current (void);
+void		   FrameStats_EndFrame (void);
+// Copies series of the last count committed frames to values, oldest first, and returns how
+// many there were. Values not measured in a frame are negative. Main thread or frame tasks.
+int FrameStats_GetSeries (frame_stats_series_t series, float *values, int count);
+
+// Unbounded copy of the committed frames for benchmarks, in addition to the ring
+void				 FrameStats_StartCapture (qboolean append);
+void				 FrameStats_StopCapture (void);
+const frame_stats_t *FrameStats_GetCapture (int *count);
+void				 FrameStats_FreeCapture (void);
+void				 FrameStats_WriteSummaryJSON (FILE *f, const frame_stats_t *frames, int count, const char *indent);
+
+#endif
@@ -453,6 +453,64 @@ void Draw_Init (void)
 //
 //==============================================================================
 
+#define MAX_DRAW_BATCH_VERTS (6 * 1024)
+
+/*
+================
+Draw_FlushBatch
+
+Records the batched quads as one draw
+================
+*/
+void Draw_FlushBatch (cb_context_t *cbx)
+{
+	const int num_verts = cbx->num_draw_batch_verts;
+
+	if (!num_verts)
+		return;
+	cbx->num_draw_batch_verts = 0;
+
+	VkBuffer	   buffer;
+	VkDeviceSize   buffer_offset;
+	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (num_verts * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	memcpy (vertices, cbx->draw_batch, num_verts * sizeof (basicvertex_t));
+
+	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, cbx->draw_batch_pipeline);
+	if (cbx->draw_batch_descriptor_set != VK_NULL_HANDLE)
+		vulkan_globals.vk_cmd_bind_descriptor_sets (
+			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &cbx->draw_batch_descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_draw (cbx->cb, num_verts, 1, 0, 0);
+}
+
+/*
+================
+Draw_BatchVertices
+
+Room for num_verts (at most a quad's 6) drawn with pipeline and texture, which
+is NULL for the notex pipelines. Consecutive calls with the same state, like
+the characters of the console or the scrap pics of the sbar, share one draw
+================
+*/
+basicvertex_t *Draw_BatchVertices (cb_context_t *cbx, vulkan_pipeline_t pipeline, gltexture_t *texture, int num_verts)
+{
+	const VkDescriptorSet descriptor_set = texture ? texture->descriptor_set : VK_NULL_HANDLE;
+	basicvertex_t		 *vertices;
+
+	if (cbx->num_draw_batch_verts &&
+		((cbx->draw_batch_pipeline.handle != pipeline.handle) || (cbx->draw_batch_descriptor_set != descriptor_set) ||
+		 (cbx->num_draw_batch_verts + num_verts > MAX_DRAW_BATCH_VERTS)))
+		Draw_FlushBatch (cbx);
+
+	if (!cbx->draw_batch)
+		cbx->draw_batch = (basicvertex_t *)Mem_Alloc (MAX_DRAW_BATCH_VERTS * sizeof (basicvertex_t));
+	cbx->draw_batch_pipeline = pipeline;
+	cbx->draw_batch_descriptor_set = descriptor_set;
+	vertices = cbx->draw_batch + cbx->num_draw_batch_verts;
+	cbx->num_draw_batch_verts += num_verts;
+	return vertices;
+}
+
 /*
 ================
 Draw_FillCharacterQuad
@@ -526,17 +584,8 @@ void Draw_Character (cb_context_t *cbx, float x, float y, int num)
 	if (num == 32)
 		return; // don't waste verts on spaces
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
+	basicvertex_t *vertices = Draw_BatchVertices (cbx, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index], char_texture, 6);
 	Draw_FillCharacterQuad (x, y, (char)num, vertices, rotation);
-
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -546,36 +595,16 @@ Draw_String
 */
 void Draw_String (cb_context_t *cbx, float x, float y, const char *str)
 {
-	int			num_verts = 0;
-	int			i;
-	const char *tmp;
-
 	if (y <= -CHARACTER_SIZE)
 		return; // totally off screen
 
-	for (tmp = str; *tmp != 0; ++tmp)
-		if (*tmp != 32)
-			num_verts += 6;
-
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (num_verts * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
-	for (i = 0; *str != 0; ++str)
+	for (; *str != 0; ++str)
 	{
 		if (*str != 32)
-		{
-			Draw_FillCharacterQuad (x, y, *str, vertices + i * 6, 0);
-			i++;
-		}
+			Draw_FillCharacterQuad (
+				x, y, *str, Draw_BatchVertices (cbx, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index], char_texture, 6), 0);
 		x += CHARACTER_SIZE;
 	}
-
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, num_verts, 1, 0, 0);
 }
 
 /*
@@ -592,9 +621,10 @@ void Draw_Pic (cb_context_t *cbx, float x, float y, qpic_t *pic, float alpha, qb
 		Scrap_Upload ();
 	memcpy (&gl, pic->data, sizeof (glpic_t));
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	basicvertex_t *vertices = Draw_BatchVertices (
+		cbx,
+		alpha_blend ? vulkan_globals.basic_blend_pipeline[cbx->render_pass_index] : vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index],
+		gl.gltexture, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
@@ -632,15 +662,6 @@ void Draw_Pic (cb_context_t *cbx, float x, float y, qpic_t *pic, float alpha, qb
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	if (alpha_blend)
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	else
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vkCmdBindDescriptorSets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t *pic, float s1, float t1, float s2, float t2, float *rgb, float alpha)
@@ -668,9 +689,10 @@ void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t
 	}
 	rgba[3] *= alpha;
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	basicvertex_t *vertices = Draw_BatchVertices (
+		cbx,
+		alpha_blend ? vulkan_globals.basic_blend_pipeline[cbx->render_pass_index] : vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index],
+		gl.gltexture, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
@@ -713,15 +735,6 @@ void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	if (alpha_blend)
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	else
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vkCmdBindDescriptorSets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -785,9 +798,7 @@ void Draw_TileClear (cb_context_t *cbx, float x, float y, float w, float h)
 	glpic_t gl;
 	memcpy (&gl, draw_backtile->data, sizeof (glpic_t));
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	basicvertex_t *vertices = Draw_BatchVertices (cbx, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index], gl.gltexture, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
@@ -822,12 +833,6 @@ void Draw_TileClear (cb_context_t *cbx, float x, float y, float w, float h)
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	vkCmdBindDescriptorSets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -842,9 +847,7 @@ void Draw_Fill (cb_context_t *cbx, float x, float y, float w, float h, int c, fl
 	int	  i;
 	byte *pal = (byte *)d_8to24table; // johnfitz -- use d_8to24table instead of host_basepal
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	basicvertex_t *vertices = Draw_BatchVertices (cbx, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index], NULL, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 0, sizeof (corner_verts));
@@ -875,10 +878,6 @@ void Draw_Fill (cb_context_t *cbx, float x, float y, float w, float h, int c, fl
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index]);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -892,9 +891,7 @@ void Draw_FadeScreen (cb_context_t *cbx)
 
 	GL_SetCanvas (cbx, CANVAS_DEFAULT);
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	basicvertex_t *vertices = Draw_BatchVertices (cbx, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index], NULL, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 0, sizeof (corner_verts));
@@ -920,10 +917,6 @@ void Draw_FadeScreen (cb_context_t *cbx)
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index]);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -986,6 +979,8 @@ void GL_SetCanvas (cb_context_t *cbx, canvastype newcanvas)
 	if (newcanvas == cbx->current_canvas)
 		return;
 
+	Draw_FlushBatch (cbx); // with the old matrix and viewport
+
 	extern vrect_t scr_vrect;
 	float		   s, u, v;
 	int			   lines;
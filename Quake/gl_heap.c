@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "gl_heap.h"
+#include "bench.h"
 
 /*
 ================================================================================
@@ -77,6 +78,7 @@ typedef struct glheapsegment_s
 	uint64_t				*free_blocks_skip_bitfields[NUM_BLOCK_SIZE_CLASSES];
 	page_index_t			 small_alloc_free_list_heads[NUM_SMALL_ALLOC_SIZES];
 	page_index_t			 num_pages_allocated;
+	qboolean				 evacuating; // no new allocations while being defragmented
 } glheapsegment_t;
 
 typedef struct glheap_s
@@ -228,6 +230,7 @@ static glheapsegment_t *GL_CreateHeapSegment (glheap_t *heap, atomic_uint32_t *n
 		segment->free_blocks_skip_bitfields[i][0] = 0x1;
 	}
 	segment->num_pages_allocated = 0;
+	segment->evacuating = false;
 	for (int i = 0; i < heap->num_pages_per_segment; ++i)
 		segment->small_alloc_links[i] = EMPTY_SMALL_ALLOC_LINKS;
 	segment->page_hdrs[0].size_in_pages = heap->num_pages_per_segment;
@@ -237,6 +240,25 @@ static glheapsegment_t *GL_CreateHeapSegment (glheap_t *heap, atomic_uint32_t *n
 	return segment;
 }
 
+/*
+===============
+GL_DestroyHeapSegment
+===============
+*/
+static void GL_DestroyHeapSegment (glheapsegment_t *segment, atomic_uint32_t *num_allocations)
+{
+	R_FreeVulkanMemory (&segment->memory, num_allocations);
+	Mem_Free (segment->page_hdrs);
+	Mem_Free (segment->small_alloc_links);
+	Mem_Free (segment->small_alloc_masks);
+	for (int i = 0; i < NUM_BLOCK_SIZE_CLASSES; ++i)
+	{
+		Mem_Free (segment->free_blocks_bitfields[i]);
+		Mem_Free (segment->free_blocks_skip_bitfields[i]);
+	}
+	Mem_Free (segment);
+}
+
 /*
 ===============
 GL_HeapAllocateBlockFromSegment
@@ -624,18 +646,7 @@ GL_HeapDestroy
 void GL_HeapDestroy (glheap_t *heap, atomic_uint32_t *num_allocations)
 {
 	for (uint32_t mask_page_offset = 0; mask_page_offset < heap->num_segments; ++mask_page_offset)
-	{
-		glheapsegment_t *segment = heap->segments[mask_page_offset];
-		R_FreeVulkanMemory (&segment->memory, num_allocations);
-		Mem_Free (segment->page_hdrs);
-		Mem_Free (segment->small_alloc_links);
-		Mem_Free (segment->small_alloc_masks);
-		for (int mask_page_index = 0; mask_page_index < NUM_BLOCK_SIZE_CLASSES; ++mask_page_index)
-		{
-			Mem_Free (segment->free_blocks_bitfields[mask_page_index]);
-			Mem_Free (segment->free_blocks_skip_bitfields[mask_page_index]);
-		}
-	}
+		GL_DestroyHeapSegment (heap->segments[mask_page_offset], num_allocations);
 	Mem_Free (heap->segments);
 }
 
@@ -685,6 +696,8 @@ glheapallocation_t *GL_HeapAllocate (glheap_t *heap, VkDeviceSize size, VkDevice
 				++heap->stats.num_blocks_free;
 				++heap->num_segments;
 			}
+			else if (heap->segments[mask_page_offset]->evacuating)
+				continue;
 
 			const qboolean success = GL_HeapAllocateFromSegment (allocation, heap, heap->segments[mask_page_offset], &alloc_info);
 			if (success)
@@ -814,6 +827,121 @@ glheapstats_t *GL_HeapGetStats (glheap_t *heap)
 	return &heap->stats;
 }
 
+/*
+===============
+GL_HeapCompareSegmentOccupancy
+===============
+*/
+static int GL_HeapCompareSegmentOccupancy (const void *a, const void *b)
+{
+	const glheapsegment_t *segment_a = *(const glheapsegment_t *const *)a;
+	const glheapsegment_t *segment_b = *(const glheapsegment_t *const *)b;
+	return (int)segment_a->num_pages_allocated - (int)segment_b->num_pages_allocated;
+}
+
+/*
+===============
+GL_HeapBeginDefragment
+
+Marks the least occupied segments as evacuating for as long as their pages fit into
+the free pages of the remaining ones. GL_HeapAllocate skips evacuating segments, so
+everything the caller reallocates ends up elsewhere. Empty segments are marked too,
+moving allocations into them gains nothing. Returns the number of non-empty segments
+that were marked.
+===============
+*/
+uint32_t GL_HeapBeginDefragment (glheap_t *heap, float max_occupancy)
+{
+	if (heap->num_segments < 2)
+		return 0;
+
+	TEMP_ALLOC (glheapsegment_t *, sorted_segments, heap->num_segments);
+	memcpy (sorted_segments, heap->segments, heap->num_segments * sizeof (glheapsegment_t *));
+	qsort (sorted_segments, heap->num_segments, sizeof (glheapsegment_t *), GL_HeapCompareSegmentOccupancy);
+
+	uint32_t num_free_pages = 0;
+	for (uint32_t i = 0; i < heap->num_segments; ++i)
+	{
+		glheapsegment_t *segment = sorted_segments[i];
+		if (segment->num_pages_allocated == 0)
+			segment->evacuating = true;
+		else
+			num_free_pages += heap->num_pages_per_segment - segment->num_pages_allocated;
+	}
+
+	const uint32_t max_pages = (uint32_t)(max_occupancy * heap->num_pages_per_segment);
+	uint32_t	   num_evacuated_pages = 0;
+	uint32_t	   num_evacuating = 0;
+	for (uint32_t i = 0; i < heap->num_segments; ++i)
+	{
+		glheapsegment_t *segment = sorted_segments[i];
+		if (segment->evacuating)
+			continue;
+		if (segment->num_pages_allocated > max_pages)
+			break;
+
+		// Free pages of the segment are no longer a destination
+		const uint32_t remaining_free_pages = num_free_pages - (heap->num_pages_per_segment - segment->num_pages_allocated);
+		if ((num_evacuated_pages + segment->num_pages_allocated) > remaining_free_pages)
+			break;
+
+		segment->evacuating = true;
+		num_free_pages = remaining_free_pages;
+		num_evacuated_pages += segment->num_pages_allocated;
+		++num_evacuating;
+	}
+
+	TEMP_FREE (sorted_segments);
+	return num_evacuating;
+}
+
+/*
+===============
+GL_HeapIsAllocationEvacuating
+===============
+*/
+qboolean GL_HeapIsAllocationEvacuating (glheapallocation_t *allocation)
+{
+	return (allocation->alloc_type != ALLOC_TYPE_DEDICATED) && allocation->segment->evacuating;
+}
+
+/*
+===============
+GL_HeapEndDefragment
+
+Clears the evacuation marks and releases the memory of all empty segments. One
+segment is always kept. Returns the number of segments released.
+===============
+*/
+uint32_t GL_HeapEndDefragment (glheap_t *heap, atomic_uint32_t *num_allocations)
+{
+	uint32_t num_used = 0;
+	for (uint32_t i = 0; i < heap->num_segments; ++i)
+	{
+		heap->segments[i]->evacuating = false;
+		if (heap->segments[i]->num_pages_allocated > 0)
+			++num_used;
+	}
+
+	uint32_t num_kept = 0;
+	uint32_t num_released = 0;
+	for (uint32_t i = 0; i < heap->num_segments; ++i)
+	{
+		glheapsegment_t *segment = heap->segments[i];
+		if ((segment->num_pages_allocated == 0) && ((num_used > 0) || (num_kept > 0)))
+		{
+			GL_DestroyHeapSegment (segment, num_allocations);
+			--heap->stats.num_blocks_free;
+			++num_released;
+		}
+		else
+			heap->segments[num_kept++] = segment;
+	}
+	heap->num_segments = num_kept;
+
+	return num_released;
+}
+
 #ifdef _DEBUG
 /*
 =================
@@ -979,6 +1107,73 @@ void GL_HeapTest_f (void)
 		TestHeapConsistency (test_heap);
 		TestHeapCleanState (test_heap);
 	}
+	GL_HeapEndDefragment (test_heap, &num_allocations);
+	HEAP_TEST_ASSERT (test_heap->num_segments == 1, "Empty segments need to be released");
+	TestHeapCleanState (test_heap);
 	GL_HeapDestroy (test_heap, &num_allocations);
 }
 #endif
+
+/*
+=================
+GL_HeapBench
+
+Allocation patterns on a heap without device memory behind it, so this only
+measures the bookkeeping
+=================
+*/
+void GL_HeapBench (void)
+{
+	static const char *const PATTERN_NAMES[] = {
+		"gl_heap small, fill and free in order",
+		"gl_heap mixed, fill and free reversed",
+		"gl_heap mixed, free every other and refill",
+	};
+	const VkDeviceSize BENCH_HEAP_SIZE = 16ull * 1024ull * 1024ull;
+	const VkDeviceSize BENCH_HEAP_PAGE_SIZE = 4096;
+	const int		   NUM_ALLOCS = 2000;
+	const int		   NUM_ROUNDS = 50;
+	const int		   MAX_ALLOC_SIZE = 64 * 1024;
+
+	atomic_uint32_t num_allocations;
+	Atomic_StoreUInt32 (&num_allocations, 0);
+	glheap_t *heap = GL_HeapCreate (BENCH_HEAP_SIZE, BENCH_HEAP_PAGE_SIZE, 0, VULKAN_MEMORY_TYPE_NONE, false, "Bench Heap");
+	TEMP_ALLOC (glheapallocation_t *, allocations, NUM_ALLOCS);
+	TEMP_ALLOC (VkDeviceSize, sizes, NUM_ALLOCS);
+
+	COM_SeedRand (0);
+	for (int i = 0; i < NUM_ALLOCS; ++i)
+		sizes[i] = (VkDeviceSize)((double)(MAX_ALLOC_SIZE - 1) * pow ((double)COM_Rand () / (double)COM_RAND_MAX, 5.0)) + 1;
+
+	for (int pattern = 0; pattern < 3; ++pattern)
+	{
+		double	time = Sys_DoubleTime ();
+		int64_t ops = 0;
+		for (int round = 0; round < NUM_ROUNDS; ++round)
+		{
+			for (int i = 0; i < NUM_ALLOCS; ++i)
+				allocations[i] = GL_HeapAllocate (heap, (pattern == 0) ? 256 : sizes[i], 256, &num_allocations);
+			ops += NUM_ALLOCS;
+			if (pattern == 2)
+			{
+				for (int i = 0; i < NUM_ALLOCS; i += 2)
+					GL_HeapFree (heap, allocations[i], &num_allocations);
+				for (int i = 0; i < NUM_ALLOCS; i += 2)
+					allocations[i] = GL_HeapAllocate (heap, sizes[NUM_ALLOCS - 1 - i], 256, &num_allocations);
+				ops += NUM_ALLOCS;
+			}
+			if (pattern == 1)
+				for (int i = NUM_ALLOCS - 1; i >= 0; --i)
+					GL_HeapFree (heap, allocations[i], &num_allocations);
+			else
+				for (int i = 0; i < NUM_ALLOCS; ++i)
+					GL_HeapFree (heap, allocations[i], &num_allocations);
+			ops += NUM_ALLOCS;
+		}
+		Bench_Report (PATTERN_NAMES[pattern], ops, Sys_DoubleTime () - time);
+	}
+
+	TEMP_FREE (sizes);
+	TEMP_FREE (allocations);
+	GL_HeapDestroy (heap, &num_allocations);
+}
@@ -50,6 +50,12 @@ VkDeviceMemory		GL_HeapGetAllocationMemory (glheapallocation_t *allocation);
 VkDeviceSize		GL_HeapGetAllocationOffset (glheapallocation_t *allocation);
 glheapstats_t	   *GL_HeapGetStats (glheap_t *heap);
 
+// Defragmentation: between Begin and End the caller reallocates and copies everything
+// that GL_HeapIsAllocationEvacuating reports, freeing the old allocations
+uint32_t GL_HeapBeginDefragment (glheap_t *heap, float max_occupancy);
+qboolean GL_HeapIsAllocationEvacuating (glheapallocation_t *allocation);
+uint32_t GL_HeapEndDefragment (glheap_t *heap, atomic_uint32_t *num_allocations);
+
 #ifdef _DEBUG
 void GL_HeapTest_f (void);
 #endif
@@ -38,11 +38,39 @@ ALIAS MODEL DISPLAY LIST GENERATION
 #define MESH_HEAP_PAGE_SIZE 4096
 #define MESH_HEAP_NAME		"Mesh heap"
 
+// All alias geometry is suballocated from a few shared buffers so consecutive draws
+// of different models don't need to rebind. The size stays below the heap segment
+// size so the megabuffers can still be moved by GLMesh_Defragment.
+#define ALIAS_MEGABUFFER_SIZE	   (4 * 1024 * 1024)
+#define ALIAS_MEGABUFFER_ALIGNMENT 64
+#define MAX_ALIAS_MEGABUFFERS	   64
+
 extern cvar_t r_lerpmodels;
 extern cvar_t r_rtshadows;
+extern cvar_t r_rtshadows_blasbudget;
 
 static glheap_t *mesh_buffer_heap;
 
+typedef struct
+{
+	VkDeviceSize offset;
+	VkDeviceSize size;
+} aliasrange_t;
+
+typedef struct
+{
+	VkBuffer			buffer;
+	glheapallocation_t *allocation;
+	VkDeviceAddress		address;
+	VkDeviceSize		size;
+	VkDeviceSize		used;
+	aliasrange_t	   *free_ranges; // sorted by offset, never adjacent
+	int					num_free_ranges;
+	int					max_free_ranges;
+} aliasmegabuffer_t;
+
+static aliasmegabuffer_t alias_megabuffers[MAX_ALIAS_MEGABUFFERS];
+
 typedef struct
 {
 	VkBuffer				  buffer;
@@ -50,6 +78,9 @@ typedef struct
 	glheapallocation_t		 *allocation;
 	VkDescriptorSet			  desc_set;
 	vulkan_desc_set_layout_t *desc_set_layout;
+	aliasmegabuffer_t		 *megabuffer; // if set, only the range is returned to it
+	VkDeviceSize			  offset;
+	VkDeviceSize			  size;
 } buffer_garbage_t;
 
 typedef struct
@@ -83,6 +114,25 @@ static void AddBufferGarbage (
 	garbage->allocation = allocation;
 	garbage->desc_set = desc_set;
 	garbage->desc_set_layout = desc_set_layout;
+	garbage->megabuffer = NULL;
+}
+
+/*
+================
+AddRangeGarbage
+================
+*/
+static void AddRangeGarbage (aliasmegabuffer_t *megabuffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	int				  garbage_index;
+	buffer_garbage_t *garbage;
+
+	garbage_index = num_garbage_buffers[current_garbage_index]++;
+	garbage = &buffer_garbage[garbage_index][current_garbage_index];
+	memset (garbage, 0, sizeof (buffer_garbage_t));
+	garbage->megabuffer = megabuffer;
+	garbage->offset = offset;
+	garbage->size = size;
 }
 
 /*
@@ -102,6 +152,200 @@ static void AddBLASGarbage (VkAccelerationStructureKHR blas, VkBuffer buffer, gl
 	garbage->allocation = allocation;
 }
 
+/*
+================
+GLMesh_MegabufferUsage
+================
+*/
+static VkBufferUsageFlags GLMesh_MegabufferUsage (void)
+{
+	// Transfer source for GLMesh_Defragment
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+							   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	if (vulkan_globals.ray_query)
+		usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+	return usage;
+}
+
+/*
+================
+GLMesh_FindMegabuffer
+================
+*/
+static aliasmegabuffer_t *GLMesh_FindMegabuffer (VkBuffer buffer)
+{
+	for (int i = 0; i < MAX_ALIAS_MEGABUFFERS; ++i)
+		if (alias_megabuffers[i].buffer == buffer)
+			return &alias_megabuffers[i];
+	Sys_Error ("GLMesh_FindMegabuffer: unknown buffer");
+	return NULL;
+}
+
+/*
+================
+GLMesh_CreateMegabuffer
+================
+*/
+static aliasmegabuffer_t *GLMesh_CreateMegabuffer (VkDeviceSize size)
+{
+	aliasmegabuffer_t *megabuffer = NULL;
+	for (int i = 0; i < MAX_ALIAS_MEGABUFFERS; ++i)
+	{
+		if (alias_megabuffers[i].buffer == VK_NULL_HANDLE)
+		{
+			megabuffer = &alias_megabuffers[i];
+			break;
+		}
+	}
+	if (!megabuffer)
+		Sys_Error ("GLMesh_CreateMegabuffer: MAX_ALIAS_MEGABUFFERS exceeded");
+
+	megabuffer->size = size;
+	megabuffer->used = 0;
+	megabuffer->num_free_ranges = 0;
+
+	ZEROED_STRUCT (VkBufferCreateInfo, buffer_create_info);
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size = size;
+	buffer_create_info.usage = GLMesh_MegabufferUsage ();
+	VkResult err = vkCreateBuffer (vulkan_globals.device, &buffer_create_info, NULL, &megabuffer->buffer);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateBuffer failed");
+
+	GL_SetObjectName ((uint64_t)megabuffer->buffer, VK_OBJECT_TYPE_BUFFER, "Alias megabuffer");
+
+	VkMemoryRequirements memory_requirements;
+	vkGetBufferMemoryRequirements (vulkan_globals.device, megabuffer->buffer, &memory_requirements);
+
+	megabuffer->allocation = GL_HeapAllocate (mesh_buffer_heap, memory_requirements.size, memory_requirements.alignment, &num_vulkan_mesh_allocations);
+	err = vkBindBufferMemory (
+		vulkan_globals.device, megabuffer->buffer, GL_HeapGetAllocationMemory (megabuffer->allocation), GL_HeapGetAllocationOffset (megabuffer->allocation));
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindBufferMemory failed");
+
+	megabuffer->address = 0;
+	if (vulkan_globals.ray_query)
+	{
+		ZEROED_STRUCT (VkBufferDeviceAddressInfoKHR, address_info);
+		address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+		address_info.buffer = megabuffer->buffer;
+		megabuffer->address = vulkan_globals.vk_get_buffer_device_address (vulkan_globals.device, &address_info);
+	}
+
+	return megabuffer;
+}
+
+/*
+================
+GLMesh_AllocateRange
+
+First fit over all megabuffers, creates a new one if nothing fits. Models that
+don't fit into ALIAS_MEGABUFFER_SIZE get a megabuffer of their own.
+================
+*/
+static aliasmegabuffer_t *GLMesh_AllocateRange (VkDeviceSize size, VkDeviceSize *offset)
+{
+	size = (size + ALIAS_MEGABUFFER_ALIGNMENT - 1) & ~(VkDeviceSize)(ALIAS_MEGABUFFER_ALIGNMENT - 1);
+
+	for (int i = 0; i < MAX_ALIAS_MEGABUFFERS; ++i)
+	{
+		aliasmegabuffer_t *megabuffer = &alias_megabuffers[i];
+		if (megabuffer->buffer == VK_NULL_HANDLE)
+			continue;
+		for (int j = 0; j < megabuffer->num_free_ranges; ++j)
+		{
+			aliasrange_t *range = &megabuffer->free_ranges[j];
+			if (range->size < size)
+				continue;
+			*offset = range->offset;
+			range->offset += size;
+			range->size -= size;
+			if (range->size == 0)
+			{
+				memmove (range, range + 1, (megabuffer->num_free_ranges - j - 1) * sizeof (aliasrange_t));
+				--megabuffer->num_free_ranges;
+			}
+			megabuffer->used += size;
+			return megabuffer;
+		}
+	}
+
+	aliasmegabuffer_t *megabuffer = GLMesh_CreateMegabuffer (q_max (size, (VkDeviceSize)ALIAS_MEGABUFFER_SIZE));
+	*offset = 0;
+	megabuffer->used = size;
+	if (megabuffer->size > size)
+	{
+		if (megabuffer->max_free_ranges == 0)
+		{
+			megabuffer->max_free_ranges = 16;
+			megabuffer->free_ranges = Mem_Alloc (megabuffer->max_free_ranges * sizeof (aliasrange_t));
+		}
+		megabuffer->free_ranges[0].offset = size;
+		megabuffer->free_ranges[0].size = megabuffer->size - size;
+		megabuffer->num_free_ranges = 1;
+	}
+	return megabuffer;
+}
+
+/*
+================
+GLMesh_FreeRange
+
+The range must no longer be in use by the GPU. Destroys the megabuffer once all of
+its ranges are free.
+================
+*/
+static void GLMesh_FreeRange (aliasmegabuffer_t *megabuffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	size = (size + ALIAS_MEGABUFFER_ALIGNMENT - 1) & ~(VkDeviceSize)(ALIAS_MEGABUFFER_ALIGNMENT - 1);
+	megabuffer->used -= size;
+	if (megabuffer->used == 0)
+	{
+		vkDestroyBuffer (vulkan_globals.device, megabuffer->buffer, NULL);
+		GL_HeapFree (mesh_buffer_heap, megabuffer->allocation, &num_vulkan_mesh_allocations);
+		megabuffer->buffer = VK_NULL_HANDLE;
+		megabuffer->allocation = NULL;
+		megabuffer->num_free_ranges = 0;
+		return;
+	}
+
+	int index = 0;
+	while ((index < megabuffer->num_free_ranges) && (megabuffer->free_ranges[index].offset < offset))
+		++index;
+
+	aliasrange_t *prev = (index > 0) ? &megabuffer->free_ranges[index - 1] : NULL;
+	aliasrange_t *next = (index < megabuffer->num_free_ranges) ? &megabuffer->free_ranges[index] : NULL;
+	const qboolean merge_prev = prev && ((prev->offset + prev->size) == offset);
+	const qboolean merge_next = next && ((offset + size) == next->offset);
+
+	if (merge_prev && merge_next)
+	{
+		prev->size += size + next->size;
+		memmove (next, next + 1, (megabuffer->num_free_ranges - index - 1) * sizeof (aliasrange_t));
+		--megabuffer->num_free_ranges;
+	}
+	else if (merge_prev)
+		prev->size += size;
+	else if (merge_next)
+	{
+		next->offset = offset;
+		next->size += size;
+	}
+	else
+	{
+		if (megabuffer->num_free_ranges == megabuffer->max_free_ranges)
+		{
+			megabuffer->max_free_ranges = q_max (16, megabuffer->max_free_ranges * 2);
+			megabuffer->free_ranges = Mem_Realloc (megabuffer->free_ranges, megabuffer->max_free_ranges * sizeof (aliasrange_t));
+		}
+		aliasrange_t *range = &megabuffer->free_ranges[index];
+		memmove (range + 1, range, (megabuffer->num_free_ranges - index) * sizeof (aliasrange_t));
+		range->offset = offset;
+		range->size = size;
+		++megabuffer->num_free_ranges;
+	}
+}
+
 /*
 ================
 R_InitMeshHeap
@@ -158,6 +402,11 @@ void R_CollectMeshBufferGarbage (void)
 	for (i = 0; i < num; ++i)
 	{
 		garbage = &buffer_garbage[i][current_garbage_index];
+		if (garbage->megabuffer)
+		{
+			GLMesh_FreeRange (garbage->megabuffer, garbage->offset, garbage->size);
+			continue;
+		}
 		vkDestroyBuffer (vulkan_globals.device, garbage->buffer, NULL);
 		GL_HeapFree (mesh_buffer_heap, garbage->allocation, &num_vulkan_mesh_allocations);
 		if (garbage->desc_set != VK_NULL_HANDLE)
@@ -183,13 +432,15 @@ GL_MakeAliasModelDisplayLists
 Original code by MH from RMQEngine
 ================
 */
-static uint32_t AliasMeshHash (const void *const p)
+static inline uint32_t AliasMeshHash (const void *const p)
 {
 	aliasmesh_t *mesh = (aliasmesh_t *)p;
 	uint32_t	 vertindex = mesh->vertindex;
 	return HashCombine (HashInt32 (&vertindex), HashCombine (HashFloat (&mesh->st[0]), HashFloat (&mesh->st[1])));
 }
 
+DEFINE_FLAT_MAP (alias_mesh_map_t, AliasMeshMap, aliasmesh_t, unsigned short, AliasMeshHash, FlatMap_MemCmp)
+
 void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 {
 	assert (paliashdr->poseverttype == PV_QUAKE1);
@@ -209,8 +460,8 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 	// there will always be this number of indexes
 	TEMP_ALLOC_ZEROED (unsigned short, indexes, maxverts_vbo);
 
-	hash_map_t *vertex_to_index_map = HashMap_Create (aliasmesh_t, unsigned short, &AliasMeshHash, NULL);
-	HashMap_Reserve (vertex_to_index_map, maxverts_vbo);
+	alias_mesh_map_t *vertex_to_index_map = AliasMeshMap_Create ();
+	AliasMeshMap_Reserve (vertex_to_index_map, maxverts_vbo);
 
 	ZEROED_STRUCT (aliasmesh_t, mesh);
 	for (int i = 0; i < paliashdr->numtris; i++)
@@ -235,13 +486,13 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 			// Check if this vert already exists
 			unsigned short	index;
 			unsigned short *found_index;
-			if ((found_index = HashMap_Lookup (unsigned short, vertex_to_index_map, &mesh)))
+			if ((found_index = AliasMeshMap_Lookup (vertex_to_index_map, &mesh)))
 				index = *found_index;
 			else
 			{
 				// doesn't exist; emit a new vert and index
 				index = paliashdr->numverts_vbo;
-				HashMap_Insert (vertex_to_index_map, &mesh, &index);
+				AliasMeshMap_Insert (vertex_to_index_map, &mesh, &index);
 				desc[paliashdr->numverts_vbo].vertindex = vertindex;
 				desc[paliashdr->numverts_vbo].st[0] = s;
 				desc[paliashdr->numverts_vbo++].st[1] = t;
@@ -251,7 +502,7 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 		}
 	}
 
-	HashMap_Destroy (vertex_to_index_map);
+	AliasMeshMap_Destroy (vertex_to_index_map);
 
 	// upload immediately
 	paliashdr->poseverttype = PV_QUAKE1;
@@ -265,6 +516,20 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 #define NUMVERTEXNORMALS 162
 extern float r_avertexnormals[NUMVERTEXNORMALS][3];
 
+/*
+================
+GLMesh_VertexDataSize
+
+Same size as in GLMesh_UploadBuffers
+================
+*/
+static VkDeviceSize GLMesh_VertexDataSize (const aliashdr_t *hdr)
+{
+	if (hdr->poseverttype == PV_MD5)
+		return hdr->numverts_vbo * sizeof (md5vert_t);
+	return hdr->vbostofs + (hdr->numverts_vbo * sizeof (meshst_t));
+}
+
 /*
 ================
 GLMesh_DeleteMeshBuffers
@@ -278,10 +543,12 @@ void GLMesh_DeleteMeshBuffers (aliashdr_t *mainhdr)
 		if (!hdr || (hdr->vertex_buffer == VK_NULL_HANDLE))
 			return;
 
+		const VkDeviceSize vertex_size = GLMesh_VertexDataSize (hdr);
+		const VkDeviceSize index_size = hdr->numindexes * sizeof (unsigned short);
 		if (in_update_screen)
 		{
-			AddBufferGarbage (hdr->vertex_buffer, VK_NULL_HANDLE, hdr->vertex_allocation, VK_NULL_HANDLE, NULL);
-			AddBufferGarbage (hdr->index_buffer, VK_NULL_HANDLE, hdr->index_allocation, VK_NULL_HANDLE, NULL);
+			AddRangeGarbage (GLMesh_FindMegabuffer (hdr->vertex_buffer), hdr->vertex_offset, vertex_size);
+			AddRangeGarbage (GLMesh_FindMegabuffer (hdr->index_buffer), hdr->index_offset, index_size);
 			if (hdr->joints_buffer != VK_NULL_HANDLE)
 				AddBufferGarbage (hdr->joints_buffer, VK_NULL_HANDLE, hdr->joints_allocation, hdr->joints_set, &vulkan_globals.joints_buffer_set_layout);
 		}
@@ -289,11 +556,8 @@ void GLMesh_DeleteMeshBuffers (aliashdr_t *mainhdr)
 		{
 			GL_WaitForDeviceIdle ();
 
-			vkDestroyBuffer (vulkan_globals.device, hdr->vertex_buffer, NULL);
-			GL_HeapFree (mesh_buffer_heap, hdr->vertex_allocation, &num_vulkan_mesh_allocations);
-
-			vkDestroyBuffer (vulkan_globals.device, hdr->index_buffer, NULL);
-			GL_HeapFree (mesh_buffer_heap, hdr->index_allocation, &num_vulkan_mesh_allocations);
+			GLMesh_FreeRange (GLMesh_FindMegabuffer (hdr->vertex_buffer), hdr->vertex_offset, vertex_size);
+			GLMesh_FreeRange (GLMesh_FindMegabuffer (hdr->index_buffer), hdr->index_offset, index_size);
 
 			if (hdr->joints_buffer != VK_NULL_HANDLE)
 			{
@@ -304,9 +568,9 @@ void GLMesh_DeleteMeshBuffers (aliashdr_t *mainhdr)
 		}
 
 		hdr->vertex_buffer = VK_NULL_HANDLE;
-		hdr->vertex_allocation = NULL;
+		hdr->vertex_offset = 0;
 		hdr->index_buffer = VK_NULL_HANDLE;
-		hdr->index_allocation = NULL;
+		hdr->index_offset = 0;
 		hdr->joints_buffer = VK_NULL_HANDLE;
 		hdr->joints_allocation = NULL;
 		hdr->joints_set = VK_NULL_HANDLE;
@@ -315,6 +579,19 @@ void GLMesh_DeleteMeshBuffers (aliashdr_t *mainhdr)
 	}
 }
 
+/*
+================
+GLMesh_JointsBufferUsage
+================
+*/
+static VkBufferUsageFlags GLMesh_JointsBufferUsage (void)
+{
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	if (vulkan_globals.ray_query)
+		usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	return usage;
+}
+
 /*
 ================
 GLMesh_UploadBuffers : Upload data for a single aliashdr_t *hdr (not it's nextsurfaces)
@@ -378,38 +655,11 @@ void GLMesh_UploadBuffers (qmodel_t *mod, aliashdr_t *hdr, unsigned short *index
 	{
 		const size_t totalindexsize = numindexes * sizeof (unsigned short);
 
-		// Allocate index buffer & upload to GPU
-		ZEROED_STRUCT (VkBufferCreateInfo, buffer_create_info);
-		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		buffer_create_info.size = totalindexsize;
-		buffer_create_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-		if (vulkan_globals.ray_query)
-			buffer_create_info.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
-		err = vkCreateBuffer (vulkan_globals.device, &buffer_create_info, NULL, &hdr->index_buffer);
-		if (err != VK_SUCCESS)
-			Sys_Error ("vkCreateBuffer failed");
-
-		GL_SetObjectName ((uint64_t)hdr->index_buffer, VK_OBJECT_TYPE_BUFFER, mod->name);
-
-		VkMemoryRequirements memory_requirements;
-		vkGetBufferMemoryRequirements (vulkan_globals.device, hdr->index_buffer, &memory_requirements);
-
-		hdr->index_allocation = GL_HeapAllocate (mesh_buffer_heap, memory_requirements.size, memory_requirements.alignment, &num_vulkan_mesh_allocations);
-		err = vkBindBufferMemory (
-			vulkan_globals.device, hdr->index_buffer, GL_HeapGetAllocationMemory (hdr->index_allocation), GL_HeapGetAllocationOffset (hdr->index_allocation));
-		if (err != VK_SUCCESS)
-			Sys_Error ("vkBindBufferMemory failed");
-
-		R_StagingUploadBuffer (hdr->index_buffer, totalindexsize, (byte *)indexes);
-
-		// Get device address for ray tracing
-		if (vulkan_globals.ray_query)
-		{
-			ZEROED_STRUCT (VkBufferDeviceAddressInfoKHR, address_info);
-			address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
-			address_info.buffer = hdr->index_buffer;
-			hdr->index_buffer_address = vulkan_globals.vk_get_buffer_device_address (vulkan_globals.device, &address_info);
-		}
+		// Suballocate index range & upload to GPU
+		aliasmegabuffer_t *megabuffer = GLMesh_AllocateRange (totalindexsize, &hdr->index_offset);
+		hdr->index_buffer = megabuffer->buffer;
+		hdr->index_buffer_address = megabuffer->address + hdr->index_offset;
+		R_StagingUploadBufferAt (hdr->index_buffer, hdr->index_offset, totalindexsize, (byte *)indexes);
 	}
 
 	// create the vertex buffer (empty)
@@ -508,40 +758,12 @@ void GLMesh_UploadBuffers (qmodel_t *mod, aliashdr_t *hdr, unsigned short *index
 		}
 	}
 
-	// Allocate vertex buffer & upload to GPU
+	// Suballocate vertex range & upload to GPU
 	{
-		ZEROED_STRUCT (VkBufferCreateInfo, buffer_create_info);
-		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		buffer_create_info.size = totalvbosize;
-		buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-		if (vulkan_globals.ray_query)
-			buffer_create_info.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-		err = vkCreateBuffer (vulkan_globals.device, &buffer_create_info, NULL, &hdr->vertex_buffer);
-		if (err != VK_SUCCESS)
-			Sys_Error ("vkCreateBuffer failed");
-
-		GL_SetObjectName ((uint64_t)hdr->vertex_buffer, VK_OBJECT_TYPE_BUFFER, mod->name);
-
-		VkMemoryRequirements memory_requirements;
-		vkGetBufferMemoryRequirements (vulkan_globals.device, hdr->vertex_buffer, &memory_requirements);
-
-		hdr->vertex_allocation = GL_HeapAllocate (mesh_buffer_heap, memory_requirements.size, memory_requirements.alignment, &num_vulkan_mesh_allocations);
-		err = vkBindBufferMemory (
-			vulkan_globals.device, hdr->vertex_buffer, GL_HeapGetAllocationMemory (hdr->vertex_allocation),
-			GL_HeapGetAllocationOffset (hdr->vertex_allocation));
-		if (err != VK_SUCCESS)
-			Sys_Error ("vkBindBufferMemory failed");
-
-		R_StagingUploadBuffer (hdr->vertex_buffer, totalvbosize, vbodata);
-
-		// Get device address for ray tracing
-		if (vulkan_globals.ray_query)
-		{
-			ZEROED_STRUCT (VkBufferDeviceAddressInfoKHR, address_info);
-			address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
-			address_info.buffer = hdr->vertex_buffer;
-			hdr->vertex_buffer_address = vulkan_globals.vk_get_buffer_device_address (vulkan_globals.device, &address_info);
-		}
+		aliasmegabuffer_t *megabuffer = GLMesh_AllocateRange (totalvbosize, &hdr->vertex_offset);
+		hdr->vertex_buffer = megabuffer->buffer;
+		hdr->vertex_buffer_address = megabuffer->address + hdr->vertex_offset;
+		R_StagingUploadBufferAt (hdr->vertex_buffer, hdr->vertex_offset, totalvbosize, vbodata);
 	}
 
 	// Allocate joints buffer & upload to GPU
@@ -550,9 +772,7 @@ void GLMesh_UploadBuffers (qmodel_t *mod, aliashdr_t *hdr, unsigned short *index
 		ZEROED_STRUCT (VkBufferCreateInfo, buffer_create_info);
 		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		buffer_create_info.size = totaljointssize;
-		buffer_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-		if (vulkan_globals.ray_query)
-			buffer_create_info.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		buffer_create_info.usage = GLMesh_JointsBufferUsage ();
 		err = vkCreateBuffer (vulkan_globals.device, &buffer_create_info, NULL, &hdr->joints_buffer);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateBuffer failed");
@@ -627,6 +847,185 @@ void GLMesh_DeleteAllMeshBuffers (void)
 	}
 }
 
+/*
+================
+GLMesh_RelocateBuffer
+
+Copies the buffer into a new allocation if its current one is being evacuated. The
+copy is recorded into the staging command buffer, the old buffer is returned in
+garbage and must not be destroyed before the copy finished.
+================
+*/
+static qboolean GLMesh_RelocateBuffer (
+	const char *name, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, glheapallocation_t **allocation, VkDeviceAddress *address,
+	buffer_garbage_t *garbage)
+{
+	if ((*buffer == VK_NULL_HANDLE) || !GL_HeapIsAllocationEvacuating (*allocation))
+		return false;
+
+	memset (garbage, 0, sizeof (buffer_garbage_t));
+	garbage->buffer = *buffer;
+	garbage->allocation = *allocation;
+
+	ZEROED_STRUCT (VkBufferCreateInfo, buffer_create_info);
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size = size;
+	buffer_create_info.usage = usage;
+	VkResult err = vkCreateBuffer (vulkan_globals.device, &buffer_create_info, NULL, buffer);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateBuffer failed");
+
+	GL_SetObjectName ((uint64_t)*buffer, VK_OBJECT_TYPE_BUFFER, name);
+
+	VkMemoryRequirements memory_requirements;
+	vkGetBufferMemoryRequirements (vulkan_globals.device, *buffer, &memory_requirements);
+
+	*allocation = GL_HeapAllocate (mesh_buffer_heap, memory_requirements.size, memory_requirements.alignment, &num_vulkan_mesh_allocations);
+	err = vkBindBufferMemory (vulkan_globals.device, *buffer, GL_HeapGetAllocationMemory (*allocation), GL_HeapGetAllocationOffset (*allocation));
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindBufferMemory failed");
+
+	// No staging memory is needed, the byte only makes sure the command buffer gets submitted
+	VkCommandBuffer command_buffer;
+	R_StagingAllocate (1, 1, &command_buffer, NULL, NULL);
+	VkBufferCopy region;
+	region.srcOffset = 0;
+	region.dstOffset = 0;
+	region.size = size;
+	vkCmdCopyBuffer (command_buffer, garbage->buffer, *buffer, 1, &region);
+	R_StagingBeginCopy ();
+	R_StagingEndCopy ();
+
+	if (vulkan_globals.ray_query)
+	{
+		ZEROED_STRUCT (VkBufferDeviceAddressInfoKHR, address_info);
+		address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+		address_info.buffer = *buffer;
+		*address = vulkan_globals.vk_get_buffer_device_address (vulkan_globals.device, &address_info);
+	}
+
+	return true;
+}
+
+/*
+================
+GLMesh_Defragment
+
+Moves the alias megabuffers and the joint buffers of all loaded alias models out of
+mesh heap segments that are at most max_occupancy full and releases the memory of segments that end up empty.
+Entity BLASes are left alone. Only for load screens, it waits for the device twice.
+Returns the number of buffers moved.
+================
+*/
+int GLMesh_Defragment (float max_occupancy)
+{
+	GL_WaitForDeviceIdle ();
+
+	int num_moved = 0;
+	if (GL_HeapBeginDefragment (mesh_buffer_heap, max_occupancy) > 0)
+	{
+		int				  max_garbage = MAX_MODELS + MAX_ALIAS_MEGABUFFERS;
+		buffer_garbage_t *garbage = Mem_Alloc (max_garbage * sizeof (buffer_garbage_t));
+		qmodel_t		 *m;
+
+		// Megabuffers are moved as a whole, the hdrs keep their offsets
+		for (int k = 0; k < MAX_ALIAS_MEGABUFFERS; ++k)
+		{
+			aliasmegabuffer_t *megabuffer = &alias_megabuffers[k];
+			const VkBuffer	   old_buffer = megabuffer->buffer;
+			if (!GLMesh_RelocateBuffer (
+					"Alias megabuffer", megabuffer->size, GLMesh_MegabufferUsage (), &megabuffer->buffer, &megabuffer->allocation, &megabuffer->address,
+					&garbage[num_moved]))
+				continue;
+			++num_moved;
+
+			for (int j = 1; j < MAX_MODELS; j++)
+			{
+				if (!(m = cl.model_precache[j]))
+					break;
+				if (m->type != mod_alias)
+					continue;
+
+				for (int i = 0; i < PV_SIZE; ++i)
+				{
+					for (aliashdr_t *hdr = (aliashdr_t *)m->extradata[i]; hdr && (hdr->vertex_buffer != VK_NULL_HANDLE); hdr = hdr->nextsurface)
+					{
+						if (hdr->vertex_buffer == old_buffer)
+						{
+							hdr->vertex_buffer = megabuffer->buffer;
+							hdr->vertex_buffer_address = megabuffer->address + hdr->vertex_offset;
+						}
+						if (hdr->index_buffer == old_buffer)
+						{
+							hdr->index_buffer = megabuffer->buffer;
+							hdr->index_buffer_address = megabuffer->address + hdr->index_offset;
+						}
+					}
+				}
+			}
+		}
+
+		for (int j = 1; j < MAX_MODELS; j++)
+		{
+			if (!(m = cl.model_precache[j]))
+				break;
+			if (m->type != mod_alias)
+				continue;
+
+			for (int i = 0; i < PV_SIZE; ++i)
+			{
+				for (aliashdr_t *hdr = (aliashdr_t *)m->extradata[i]; hdr && (hdr->vertex_buffer != VK_NULL_HANDLE); hdr = hdr->nextsurface)
+				{
+					if ((num_moved + 1) > max_garbage)
+					{
+						max_garbage *= 2;
+						garbage = Mem_Realloc (garbage, max_garbage * sizeof (buffer_garbage_t));
+					}
+
+					// Same size as in GLMesh_UploadBuffers
+					const VkDeviceSize joints_size = hdr->numframes * hdr->numjoints * sizeof (jointpose_t);
+
+					if (GLMesh_RelocateBuffer (
+							m->name, joints_size, GLMesh_JointsBufferUsage (), &hdr->joints_buffer, &hdr->joints_allocation, &hdr->joints_buffer_address,
+							&garbage[num_moved]))
+					{
+						ZEROED_STRUCT (VkDescriptorBufferInfo, buffer_info);
+						buffer_info.buffer = hdr->joints_buffer;
+						buffer_info.offset = 0;
+						buffer_info.range = VK_WHOLE_SIZE;
+
+						ZEROED_STRUCT (VkWriteDescriptorSet, joints_set_write);
+						joints_set_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+						joints_set_write.dstSet = hdr->joints_set;
+						joints_set_write.dstBinding = 0;
+						joints_set_write.dstArrayElement = 0;
+						joints_set_write.descriptorCount = 1;
+						joints_set_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+						joints_set_write.pBufferInfo = &buffer_info;
+
+						vkUpdateDescriptorSets (vulkan_globals.device, 1, &joints_set_write, 0, NULL);
+						++num_moved;
+					}
+				}
+			}
+		}
+
+		GL_WaitForDeviceIdle ();
+
+		for (int i = 0; i < num_moved; ++i)
+		{
+			vkDestroyBuffer (vulkan_globals.device, garbage[i].buffer, NULL);
+			GL_HeapFree (mesh_buffer_heap, garbage[i].allocation, &num_vulkan_mesh_allocations);
+		}
+		Mem_Free (garbage);
+	}
+	const uint32_t num_released = GL_HeapEndDefragment (mesh_buffer_heap, &num_vulkan_mesh_allocations);
+
+	if (num_moved > 0 || num_released > 0)
+		Con_DPrintf ("Mesh heap: moved %d buffers, released %u segments\n", num_moved, num_released);
+	return num_moved;
+}
+
 /*
 ================
 R_AllocateEntityBLAS
@@ -780,6 +1179,9 @@ R_UpdateAnimatedBLASes
 Update all entity BLASes with animated vertex data.
 This dispatches compute shaders to interpolate/skin vertices into the
 scratch buffer, then builds/updates the BLASes.
+
+BLASes already built for the current pose are left alone, and at most
+r_rtshadows_blasbudget are built per frame. Returns the number built.
 ================
 */
 #define MAX_PENDING_BLAS_BUILDS 256
@@ -789,6 +1191,59 @@ static VkAccelerationStructureBuildGeometryInfoKHR	   pending_build_infos[MAX_PE
 static VkAccelerationStructureBuildRangeInfoKHR		   pending_range_infos[MAX_PENDING_BLAS_BUILDS];
 static const VkAccelerationStructureBuildRangeInfoKHR *pending_range_info_ptrs[MAX_PENDING_BLAS_BUILDS];
 
+// MD5 entities of a batch are skinned by a single dispatch, each job owns a range of its workgroups
+static skinning_job_t pending_skinning_jobs[MAX_PENDING_BLAS_BUILDS];
+static int			  num_pending_skinning_jobs;
+static uint32_t		  num_pending_skinning_groups;
+
+// Entities sharing a model and animation state (e.g. a room full of grunts) use the BLAS
+// of the first one in the TLAS instead of building their own.
+// The blend factor is snapped to BLAS_BLEND_BUCKETS steps so near-identical frames match too.
+#define BLAS_BLEND_BUCKETS 16
+#define MAX_SHARED_BLASES  1024
+// Full rebuild after this many refits, refitting degrades the BVH quality over time
+#define BLAS_MAX_REFITS 32
+
+typedef struct shared_blas_s
+{
+	entity_blas_t *blas_data;
+	int			   pose1;
+	int			   pose2;
+	int			   blend_bucket;
+} shared_blas_t;
+
+static shared_blas_t shared_blases[MAX_SHARED_BLASES];
+
+/*
+================
+R_DispatchPendingSkinning
+================
+*/
+static void R_DispatchPendingSkinning (cb_context_t *cbx)
+{
+	if (num_pending_skinning_jobs == 0)
+		return;
+
+	// 16 bytes because of device address default buffer_reference_align
+	const int		jobs_size = num_pending_skinning_jobs * sizeof (skinning_job_t);
+	VkDeviceAddress jobs_address;
+	byte		   *jobs = R_StorageAllocate (jobs_size + 16, NULL, NULL, &jobs_address);
+	const int		jobs_padding = (int)(q_align (jobs_address, 16) - jobs_address);
+	jobs_address += jobs_padding;
+	memcpy (jobs + jobs_padding, pending_skinning_jobs, jobs_size);
+
+	skinning_push_constants_t pc = {
+		.jobs_address = jobs_address,
+		.num_jobs = num_pending_skinning_jobs,
+	};
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.skinning_pipeline);
+	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (pc), &pc);
+	vulkan_globals.vk_cmd_dispatch (cbx->cb, num_pending_skinning_groups, 1, 1);
+
+	num_pending_skinning_jobs = 0;
+	num_pending_skinning_groups = 0;
+}
+
 /*
 ================
 R_FlushPendingBLASBuilds
@@ -801,6 +1256,8 @@ static void R_FlushPendingBLASBuilds (cb_context_t *cbx, int num_pending, qboole
 	if (num_pending == 0)
 		return;
 
+	R_DispatchPendingSkinning (cbx);
+
 	// Barrier: compute writes -> AS reads
 	ZEROED_STRUCT (VkMemoryBarrier, compute_barrier);
 	compute_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
@@ -835,12 +1292,12 @@ static void R_FlushPendingBLASBuilds (cb_context_t *cbx, int num_pending, qboole
 	}
 }
 
-void R_UpdateAnimatedBLASes (cb_context_t *cbx)
+int R_UpdateAnimatedBLASes (cb_context_t *cbx)
 {
 	if (!vulkan_globals.ray_query)
-		return;
+		return 0;
 	if (vulkan_globals.scratch_buffer == VK_NULL_HANDLE)
-		return;
+		return 0;
 
 	const VkDeviceSize scratch_buffer_size = SCRATCH_BUFFER_SIZE_MB * 1024 * 1024;
 	const VkDeviceSize scratch_alignment = vulkan_globals.physical_device_acceleration_structure_properties.minAccelerationStructureScratchOffsetAlignment;
@@ -849,8 +1306,17 @@ void R_UpdateAnimatedBLASes (cb_context_t *cbx)
 
 	VkDeviceSize scratch_offset = 0;
 	int			 num_pending = 0;
+	int			 num_shared = 0;
+	int			 num_built = 0;
 	int			 entity_index = 0;
 	const int	 total_entities = cl.num_entities + cl.num_statics;
+	const int	 budget = (r_rtshadows_blasbudget.value > 0) ? (int)r_rtshadows_blasbudget.value : INT_MAX;
+
+	// Start where the budget ran out last frame so every entity gets its turn
+	static int first_entity;
+	int		   first_skipped = -1;
+	if (first_entity >= total_entities)
+		first_entity = 0;
 
 	R_BeginDebugUtilsLabel (cbx, "Update Animated BLAS");
 
@@ -859,12 +1325,16 @@ void R_UpdateAnimatedBLASes (cb_context_t *cbx)
 		// Phase 1: Compute - dispatch shaders and collect build info
 		while (entity_index < total_entities && num_pending < MAX_PENDING_BLAS_BUILDS)
 		{
-			entity_t *e = (entity_index < cl.num_entities) ? &cl.entities[entity_index] : cl.static_entities[entity_index - cl.num_entities];
+			const int wrapped_index = (first_entity + entity_index) % total_entities;
+			entity_t *e = (wrapped_index < cl.num_entities) ? &cl.entities[wrapped_index] : cl.static_entities[wrapped_index - cl.num_entities];
 			++entity_index;
 
 			if (!e->model || e->model->needload || e->model->type != mod_alias || !e->blas_data || e->blas_data->blas == VK_NULL_HANDLE)
 				continue;
 
+			entity_blas_t *blas_data = e->blas_data;
+			blas_data->shared = NULL;
+
 			// Skip transparent entities (same as TLAS)
 			if ((e->alpha != ENTALPHA_DEFAULT) && (ENTALPHA_DECODE (e->alpha) < 1.0f))
 				continue;
@@ -874,7 +1344,7 @@ void R_UpdateAnimatedBLASes (cb_context_t *cbx)
 				continue;
 
 			// Skip if BLAS was allocated for a different model/geometry (model changed but entity not visible yet)
-			if (e->blas_data->model != e->model)
+			if (blas_data->model != e->model)
 				continue;
 
 			// Get lerp data for vertex interpolation
@@ -884,114 +1354,159 @@ void R_UpdateAnimatedBLASes (cb_context_t *cbx)
 			int	  pose2 = lerpdata.pose2;
 			float blend = lerpdata.blend;
 
-			// Always use refit after first build. We trace few rays and full updates are expensive.
-			qboolean use_update = !e->blas_data->needs_initial_build;
-			e->blas_data->needs_initial_build = false;
-
-			// Calculate space needed with proper alignments:
-			// - Position buffer needs buffer_alignment (for storage buffer access)
-			// - AS build scratch needs scratch_alignment (for acceleration structure build)
-			const VkDeviceSize vertex_offset = q_align (scratch_offset, buffer_alignment);
-			const VkDeviceSize vertex_size = hdr->numverts_vbo * sizeof (float) * 3;
-			const VkDeviceSize as_scratch_offset = q_align (vertex_offset + vertex_size, scratch_alignment);
-			const VkDeviceSize as_scratch_size = use_update ? e->blas_data->update_scratch_size : e->blas_data->build_scratch_size;
-			const VkDeviceSize total_needed = as_scratch_offset - scratch_offset + as_scratch_size;
-
-			// Check if entity fits in scratch buffer at all
-			if (total_needed > scratch_buffer_size)
-			{
-				Con_DPrintf ("Entity BLAS too large for scratch buffer\n");
-				continue;
-			}
+			const int blend_bucket = (pose1 == pose2) ? 0 : (int)(CLAMP (0.0f, blend, 1.0f) * BLAS_BLEND_BUCKETS + 0.5f);
+			blend = (float)blend_bucket / BLAS_BLEND_BUCKETS;
 
-			// Check if we have space; if not, flush current batch and reset
-			if (scratch_offset + total_needed > scratch_buffer_size)
+			// Reuse the BLAS of an earlier entity with the same model and pose.
+			// The table only holds BLASes that are up to date for this frame.
+			for (int i = 0; i < num_shared; ++i)
 			{
-				// Need to flush - back up entity_index to retry this entity after flush
-				--entity_index;
-				break;
+				const shared_blas_t *entry = &shared_blases[i];
+				if (entry->blas_data->model == e->model && entry->pose1 == pose1 && entry->pose2 == pose2 && entry->blend_bucket == blend_bucket)
+				{
+					blas_data->shared = entry->blas_data;
+					break;
+				}
 			}
+			if (blas_data->shared)
+				continue;
 
-			VkDeviceAddress vertex_output_address = vulkan_globals.scratch_buffer_address + vertex_offset;
-			VkDeviceAddress scratch_address = vulkan_globals.scratch_buffer_address + as_scratch_offset;
-
-			// Dispatch compute shader with push constants containing buffer addresses
-			if (hdr->poseverttype == PV_MD5)
-			{
-				// MD5 skinning
-				skinning_push_constants_t pc = {
-					.input_address = hdr->vertex_buffer_address,
-					.joints_address = hdr->joints_buffer_address,
-					.output_address = vertex_output_address,
-					.joints_offset0 = pose1 * hdr->numjoints,
-					.joints_offset1 = pose2 * hdr->numjoints,
-					.output_offset = 0, // output starts at output_address
-					.num_verts = hdr->numverts_vbo,
-					.blend_factor = blend,
-				};
-				R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.skinning_pipeline);
-				R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (pc), &pc);
-			}
-			else
+			const qboolean up_to_date =
+				!blas_data->needs_initial_build && blas_data->pose1 == pose1 && blas_data->pose2 == pose2 && blas_data->blend_bucket == blend_bucket;
+			if (!up_to_date && num_built >= budget)
 			{
-				// MDL/MD3 interpolation
-				mesh_interpolate_push_constants_t pc = {
-					.input_address = hdr->vertex_buffer_address,
-					.output_address = vertex_output_address,
-					.pose1_offset = pose1 * hdr->numverts_vbo,
-					.pose2_offset = pose2 * hdr->numverts_vbo,
-					.output_offset = 0, // output starts at output_address
-					.num_verts = hdr->numverts_vbo,
-					.blend_factor = blend,
-					.flags = (hdr->poseverttype == PV_QUAKE3) ? 0x4 : 0,
-				};
-				R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.mesh_interpolate_pipeline);
-				R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (pc), &pc);
+				// keep the stale BLAS, next frame starts with this entity
+				if (first_skipped < 0)
+					first_skipped = wrapped_index;
+				continue;
 			}
 
-			uint32_t num_groups = (hdr->numverts_vbo + 63) / 64;
-			vulkan_globals.vk_cmd_dispatch (cbx->cb, num_groups, 1, 1);
-
-			// Store build info for later
-			VkAccelerationStructureGeometryKHR *geom = &pending_geometries[num_pending];
-			memset (geom, 0, sizeof (*geom));
-			geom->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-			geom->geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-			geom->geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-			geom->geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-			geom->geometry.triangles.vertexData.deviceAddress = vertex_output_address;
-			geom->geometry.triangles.vertexStride = sizeof (float) * 3;
-			geom->geometry.triangles.maxVertex = hdr->numverts_vbo;
-			geom->geometry.triangles.indexType = VK_INDEX_TYPE_UINT16;
-			geom->geometry.triangles.indexData.deviceAddress = hdr->index_buffer_address;
-
-			VkAccelerationStructureBuildGeometryInfoKHR *build = &pending_build_infos[num_pending];
-			memset (build, 0, sizeof (*build));
-			build->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-			build->type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-			build->flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
-			if (use_update)
+			if (!up_to_date)
 			{
-				build->mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
-				build->srcAccelerationStructure = e->blas_data->blas; // Required for UPDATE mode
+				// Refit while the animation continues from the last built pose, the BVH stays
+				// reasonable for small deltas. Rebuild on animation changes and every
+				// BLAS_MAX_REFITS updates so the tree doesn't degrade.
+				qboolean use_update = !blas_data->needs_initial_build && (blas_data->num_refits < BLAS_MAX_REFITS) &&
+									  (pose1 == blas_data->pose1 || pose1 == blas_data->pose2 || pose2 == blas_data->pose2);
+
+				// Calculate space needed with proper alignments:
+				// - Position buffer needs buffer_alignment (for storage buffer access)
+				// - AS build scratch needs scratch_alignment (for acceleration structure build)
+				const VkDeviceSize vertex_offset = q_align (scratch_offset, buffer_alignment);
+				const VkDeviceSize vertex_size = hdr->numverts_vbo * sizeof (float) * 3;
+				const VkDeviceSize as_scratch_offset = q_align (vertex_offset + vertex_size, scratch_alignment);
+				const VkDeviceSize as_scratch_size = use_update ? blas_data->update_scratch_size : blas_data->build_scratch_size;
+				const VkDeviceSize total_needed = as_scratch_offset - scratch_offset + as_scratch_size;
+
+				// Check if entity fits in scratch buffer at all
+				if (total_needed > scratch_buffer_size)
+				{
+					Con_DPrintf ("Entity BLAS too large for scratch buffer\n");
+					continue;
+				}
+
+				// Check if we have space; if not, flush current batch and reset
+				if (scratch_offset + total_needed > scratch_buffer_size)
+				{
+					// Need to flush - back up entity_index to retry this entity after flush
+					--entity_index;
+					break;
+				}
+
+				blas_data->needs_initial_build = false;
+				blas_data->num_refits = use_update ? (blas_data->num_refits + 1) : 0;
+				blas_data->pose1 = pose1;
+				blas_data->pose2 = pose2;
+				blas_data->blend_bucket = blend_bucket;
+				++num_built;
+
+				VkDeviceAddress vertex_output_address = vulkan_globals.scratch_buffer_address + vertex_offset;
+				VkDeviceAddress scratch_address = vulkan_globals.scratch_buffer_address + as_scratch_offset;
+
+				uint32_t num_groups = (hdr->numverts_vbo + 63) / 64;
+				if (hdr->poseverttype == PV_MD5)
+				{
+					// MD5 skinning, dispatched for the whole batch by R_FlushPendingBLASBuilds
+					skinning_job_t *job = &pending_skinning_jobs[num_pending_skinning_jobs++];
+					job->input_address = hdr->vertex_buffer_address;
+					job->joints_address = hdr->joints_buffer_address;
+					job->output_address = vertex_output_address;
+					job->joints_offset0 = pose1 * hdr->numjoints;
+					job->joints_offset1 = pose2 * hdr->numjoints;
+					job->num_verts = hdr->numverts_vbo;
+					job->blend_factor = blend;
+					job->first_group = num_pending_skinning_groups;
+					job->padding = 0;
+					num_pending_skinning_groups += num_groups;
+				}
+				else
+				{
+					// MDL/MD3 interpolation
+					mesh_interpolate_push_constants_t pc = {
+						.input_address = hdr->vertex_buffer_address,
+						.output_address = vertex_output_address,
+						.pose1_offset = pose1 * hdr->numverts_vbo,
+						.pose2_offset = pose2 * hdr->numverts_vbo,
+						.output_offset = 0, // output starts at output_address
+						.num_verts = hdr->numverts_vbo,
+						.blend_factor = blend,
+						.flags = (hdr->poseverttype == PV_QUAKE3) ? 0x4 : 0,
+					};
+					R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.mesh_interpolate_pipeline);
+					R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (pc), &pc);
+					vulkan_globals.vk_cmd_dispatch (cbx->cb, num_groups, 1, 1);
+				}
+
+				// Store build info for later
+				VkAccelerationStructureGeometryKHR *geom = &pending_geometries[num_pending];
+				memset (geom, 0, sizeof (*geom));
+				geom->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+				geom->geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+				geom->geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+				geom->geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+				geom->geometry.triangles.vertexData.deviceAddress = vertex_output_address;
+				geom->geometry.triangles.vertexStride = sizeof (float) * 3;
+				geom->geometry.triangles.maxVertex = hdr->numverts_vbo;
+				geom->geometry.triangles.indexType = VK_INDEX_TYPE_UINT16;
+				geom->geometry.triangles.indexData.deviceAddress = hdr->index_buffer_address;
+
+				VkAccelerationStructureBuildGeometryInfoKHR *build = &pending_build_infos[num_pending];
+				memset (build, 0, sizeof (*build));
+				build->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+				build->type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+				build->flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+				if (use_update)
+				{
+					build->mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+					build->srcAccelerationStructure = blas_data->blas; // Required for UPDATE mode
+				}
+				else
+				{
+					build->mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+				}
+				build->dstAccelerationStructure = blas_data->blas;
+				build->geometryCount = 1;
+				build->pGeometries = geom;
+				build->scratchData.deviceAddress = scratch_address;
+
+				VkAccelerationStructureBuildRangeInfoKHR *range = &pending_range_infos[num_pending];
+				memset (range, 0, sizeof (*range));
+				range->primitiveCount = hdr->numtris;
+				pending_range_info_ptrs[num_pending] = range;
+
+				++num_pending;
+
+				scratch_offset += total_needed;
 			}
-			else
+
+			if (num_shared < MAX_SHARED_BLASES)
 			{
-				build->mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+				shared_blas_t *entry = &shared_blases[num_shared++];
+				entry->blas_data = blas_data;
+				entry->pose1 = pose1;
+				entry->pose2 = pose2;
+				entry->blend_bucket = blend_bucket;
 			}
-			build->dstAccelerationStructure = e->blas_data->blas;
-			build->geometryCount = 1;
-			build->pGeometries = geom;
-			build->scratchData.deviceAddress = scratch_address;
-
-			VkAccelerationStructureBuildRangeInfoKHR *range = &pending_range_infos[num_pending];
-			memset (range, 0, sizeof (*range));
-			range->primitiveCount = hdr->numtris;
-			pending_range_info_ptrs[num_pending] = range;
-
-			++num_pending;
-
-			scratch_offset += total_needed;
 		}
 
 		// Phase 2: Build - flush pending builds
@@ -1004,5 +1519,10 @@ void R_UpdateAnimatedBLASes (cb_context_t *cbx)
 		}
 	}
 
+	if (first_skipped >= 0)
+		first_entity = first_skipped;
+
 	R_EndDebugUtilsLabel (cbx);
+
+	return num_built;
 }
@@ -27,7 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 static void		 Mod_LoadSpriteModel (qmodel_t *mod, void *buffer);
-static void		 Mod_LoadBrushModel (qmodel_t *mod, const char *loadname, void *buffer);
+static void		 Mod_LoadBrushModel (qmodel_t *mod, const char *loadname, const void *buffer);
 static void		 Mod_LoadAliasModel (qmodel_t *mod, void *buffer);
 static void		 Mod_LoadMD5MeshModel (qmodel_t *mod, const void *buffer);
 static void		 Mod_LoadMD3Model (qmodel_t *mod, const void *buffer);
@@ -50,15 +50,47 @@ cvar_t r_allow_replacement_md3models = {"r_allow_replacement_md3models", "1", CV
 
 cvar_t r_enhancedmodels = {"r_enhancedmodels", "1", CVAR_ARCHIVE}; // controlled in Menu with Models: enhanced (1) / classic (0)
 
+// Alias models and sprites stay loaded across map changes. They are freed once they haven't
+// been used by the last mod_cache_maps map loads, or sooner, least recently used first, while
+// model memory stays over mod_cache_budget megabytes. The first value must be at least 1 to keep
+// what the outgoing map used.
+cvar_t mod_cache_maps = {"mod_cache_maps", "4", CVAR_ARCHIVE};
+cvar_t mod_cache_budget = {"mod_cache_budget", "256", CVAR_ARCHIVE};
+
+static int mod_map_sequence;
+
 static byte *mod_novis;
 static int	 mod_novis_capacity;
 
 static byte *mod_decompressed;
 static int	 mod_decompressed_capacity;
 
+// Decompressed PVS rows of the most recently used leafs of a worldmodel. Models are shared
+// between the client and the server, so both look up the same rows. The entries are kept
+// on a list in the order they were used, a miss reuses the least recently used one.
+#define PVS_CACHE_BUDGET	  (1024 * 1024)
+#define PVS_CACHE_MIN_ENTRIES 8
+#define PVS_CACHE_MAX_ENTRIES 256
+
+typedef struct mpvscache_s
+{
+	int	  row;		  // bytes of a PVS row
+	int	  row_stride; // row rounded up to 16 bytes
+	int	  numleafs;
+	int	  numentries;
+	int	  head, tail; // most and least recently used entry
+	int	 *leafentry;  // [numleafs + 1], -1 if the leaf isn't cached
+	int	 *entryleaf;  // [numentries], -1 if the entry is unused
+	int	 *prev, *next;
+	byte *rows;
+} mpvscache_t;
+
 qmodel_t mod_known[MAX_MODELS];
 int		 mod_numknown;
 
+// name -> index into mod_known, keys point at mod_known[i].name
+static hash_map_t *mod_known_map;
+
 texture_t *r_notexture_mip;	 // johnfitz -- moved here from r_main.c
 texture_t *r_notexture_mip2; // johnfitz -- used for non-lightmapped surfs with a missing texture
 
@@ -79,7 +111,7 @@ static short ReadShortUnaligned (byte *ptr)
 ReadLongUnaligned
 ===============
 */
-static int ReadLongUnaligned (byte *ptr)
+static int ReadLongUnaligned (const byte *ptr)
 {
 	int temp;
 	memcpy (&temp, ptr, sizeof (int));
@@ -124,6 +156,8 @@ void Mod_Init (void)
 	Cvar_RegisterVariable (&r_allow_replacement_md3models);
 	Cvar_RegisterVariable (&r_enhancedmodels);
 	Cvar_SetCallback (&r_enhancedmodels, Mod_RefreshSkins_f);
+	Cvar_RegisterVariable (&mod_cache_maps);
+	Cvar_RegisterVariable (&mod_cache_budget);
 
 	// johnfitz -- create notexture miptex
 	r_notexture_mip = (texture_t *)Mem_Alloc (sizeof (texture_t));
@@ -257,26 +291,17 @@ mleaf_t *Mod_PointInLeaf (float *p, qmodel_t *model)
 
 /*
 ===================
-Mod_DecompressVis
+Mod_DecompressVisRow
 ===================
 */
-byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+static void Mod_DecompressVisRow (byte *in, qmodel_t *model, byte *decompressed, int row)
 {
 	int	  c;
 	byte *out;
 	byte *outend;
-	int	  row;
 
-	row = (model->numleafs + 31) / 8;
-	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
-	{
-		mod_decompressed_capacity = row;
-		mod_decompressed = (byte *)Mem_Realloc (mod_decompressed, mod_decompressed_capacity);
-		if (!mod_decompressed)
-			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
-	}
-	out = mod_decompressed;
-	outend = mod_decompressed + row;
+	out = decompressed;
+	outend = decompressed + row;
 
 	if (!in)
 	{ // no vis info, so make all visible
@@ -285,7 +310,7 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 			*out++ = 0xff;
 			row--;
 		}
-		return mod_decompressed;
+		return;
 	}
 
 	do
@@ -298,10 +323,10 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 
 		c = in[1];
 		in += 2;
-		if (c > row - (out - mod_decompressed))
+		if (c > row - (out - decompressed))
 			c = row -
 				(out -
-				 mod_decompressed); // now that we're dynamically allocating pvs buffers, we have to be more careful to avoid heap overflows with buggy maps.
+				 decompressed); // now that we're dynamically allocating pvs buffers, we have to be more careful to avoid heap overflows with buggy maps.
 		while (c)
 		{
 			if (out == outend)
@@ -311,26 +336,173 @@ byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 					model->viswarn = true;
 					Con_Warning ("Mod_DecompressVis: output overrun on model \"%s\"\n", model->name);
 				}
-				return mod_decompressed;
+				return;
 			}
 			*out++ = 0;
 			c--;
 		}
-	} while (out - mod_decompressed < row);
+	} while (out - decompressed < row);
+}
 
+/*
+===================
+Mod_DecompressVis
+===================
+*/
+byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+{
+	int row;
+
+	row = (model->numleafs + 31) / 8;
+	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
+	{
+		mod_decompressed_capacity = row;
+		mod_decompressed = (byte *)Mem_Realloc (mod_decompressed, mod_decompressed_capacity);
+		if (!mod_decompressed)
+			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
+	}
+
+	Mod_DecompressVisRow (in, model, mod_decompressed, row);
 	return mod_decompressed;
 }
 
+/*
+===================
+Mod_CreatePVSCache
+===================
+*/
+static void Mod_CreatePVSCache (qmodel_t *mod)
+{
+	mpvscache_t *cache;
+	const int	 row = (mod->numleafs + 31) / 8;
+	const int	 row_stride = (row + 15) & ~15;
+	const int	 numentries = CLAMP (PVS_CACHE_MIN_ENTRIES, PVS_CACHE_BUDGET / row_stride, PVS_CACHE_MAX_ENTRIES);
+
+	cache = (mpvscache_t *)Mem_Alloc (sizeof (mpvscache_t));
+	cache->rows = (byte *)Mem_Alloc ((size_t)numentries * row_stride);
+	cache->leafentry = (int *)Mem_Alloc ((mod->numleafs + 1) * sizeof (int));
+	cache->entryleaf = (int *)Mem_Alloc (numentries * 3 * sizeof (int));
+	cache->prev = cache->entryleaf + numentries;
+	cache->next = cache->prev + numentries;
+	cache->row = row;
+	cache->row_stride = row_stride;
+	cache->numleafs = mod->numleafs;
+	cache->numentries = numentries;
+
+	for (int i = 0; i <= mod->numleafs; ++i)
+		cache->leafentry[i] = -1;
+	for (int i = 0; i < numentries; ++i)
+	{
+		cache->entryleaf[i] = -1;
+		cache->prev[i] = i - 1;
+		cache->next[i] = (i + 1 < numentries) ? (i + 1) : -1;
+	}
+	cache->head = 0;
+	cache->tail = numentries - 1;
+
+	mod->pvscache = cache;
+}
+
+/*
+===================
+Mod_FreePVSCache
+===================
+*/
+static void Mod_FreePVSCache (qmodel_t *mod)
+{
+	mpvscache_t *cache = mod->pvscache;
+	if (!cache)
+		return;
+	SAFE_FREE (cache->rows);
+	SAFE_FREE (cache->leafentry);
+	SAFE_FREE (cache->entryleaf);
+	SAFE_FREE (mod->pvscache);
+}
+
+/*
+===================
+Mod_CachedPVSRow
+
+Row of leafnum, decompressed on a miss into the least recently used entry
+===================
+*/
+static const byte *Mod_CachedPVSRow (mpvscache_t *cache, int leafnum, qmodel_t *model)
+{
+	int entry = cache->leafentry[leafnum];
+	if (entry < 0)
+	{
+		entry = cache->tail;
+		if (cache->entryleaf[entry] >= 0)
+			cache->leafentry[cache->entryleaf[entry]] = -1;
+		Mod_DecompressVisRow (model->leafs[leafnum].compressed_vis, model, cache->rows + (size_t)entry * cache->row_stride, cache->row);
+		cache->entryleaf[entry] = leafnum;
+		cache->leafentry[leafnum] = entry;
+	}
+
+	if (entry != cache->head)
+	{
+		// unlink
+		cache->next[cache->prev[entry]] = cache->next[entry];
+		if (cache->next[entry] >= 0)
+			cache->prev[cache->next[entry]] = cache->prev[entry];
+		else
+			cache->tail = cache->prev[entry];
+		// make it the most recently used one
+		cache->prev[entry] = -1;
+		cache->next[entry] = cache->head;
+		cache->prev[cache->head] = entry;
+		cache->head = entry;
+	}
+
+	return cache->rows + (size_t)entry * cache->row_stride;
+}
+
+/*
+===================
+Mod_CachedLeafPVS
+
+Like Mod_LeafPVS, but returns the cached row itself. It must not be written to and is
+only valid until the next PVS lookup.
+===================
+*/
+const byte *Mod_CachedLeafPVS (mleaf_t *leaf, qmodel_t *model)
+{
+	mpvscache_t *cache = model->pvscache;
+	const int	 leafnum = leaf - model->leafs;
+
+	if (leafnum == 0)
+		return Mod_NoVisPVS (model);
+	if (!cache || leafnum > cache->numleafs || cache->numleafs != model->numleafs)
+		return Mod_DecompressVis (leaf->compressed_vis, model);
+	return Mod_CachedPVSRow (cache, leafnum, model);
+}
+
 /*
 ===================
 Mod_LeafPVS
+
+Returned row may be modified by the caller
 ===================
 */
 byte *Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model)
 {
-	if (leaf == model->leafs)
+	mpvscache_t *cache = model->pvscache;
+	const int	 leafnum = leaf - model->leafs;
+
+	if (leafnum == 0)
 		return Mod_NoVisPVS (model);
-	return Mod_DecompressVis (leaf->compressed_vis, model);
+	if (!cache || leafnum > cache->numleafs || cache->numleafs != model->numleafs)
+		return Mod_DecompressVis (leaf->compressed_vis, model);
+
+	if (mod_decompressed == NULL || cache->row > mod_decompressed_capacity)
+	{
+		mod_decompressed_capacity = cache->row;
+		mod_decompressed = (byte *)Mem_Realloc (mod_decompressed, mod_decompressed_capacity);
+		if (!mod_decompressed)
+			Sys_Error ("Mod_LeafPVS: realloc() failed on %d bytes", mod_decompressed_capacity);
+	}
+	memcpy (mod_decompressed, Mod_CachedPVSRow (cache, leafnum, model), cache->row);
+	return mod_decompressed;
 }
 
 /*
@@ -397,6 +569,7 @@ static void Mod_FreeModelMemory (qmodel_t *mod)
 		for (int i = 0; i < mod->numsurfaces; ++i)
 			SAFE_FREE (mod->surfaces[i].polys);
 		SAFE_FREE (mod->hulls[0].clipnodes);
+		SAFE_FREE (mod->hulls[0].packednodes);
 		SAFE_FREE (mod->submodels);
 		mod->numsubmodels = 0;
 		SAFE_FREE (mod->planes);
@@ -416,15 +589,31 @@ static void Mod_FreeModelMemory (qmodel_t *mod)
 		SAFE_FREE (mod->surfedges);
 		mod->numsurfedges = 0;
 		SAFE_FREE (mod->clipnodes);
+		SAFE_FREE (mod->hulls[1].packednodes); // shared with hull 2
 		mod->numclipnodes = 0;
 		SAFE_FREE (mod->marksurfaces);
 		mod->nummarksurfaces = 0;
+		SAFE_FREE (mod->turbmarksurfaces);
 		SAFE_FREE (mod->soa_leafbounds);
 		SAFE_FREE (mod->surfvis);
+		SAFE_FREE (mod->leafvis);
 		SAFE_FREE (mod->soa_surfplanes);
 		SAFE_FREE (mod->textures);
 		mod->numtextures = 0;
+		if (mod->visdata_view)
+		{
+			COM_FreeFileView (mod->visdata_view);
+			mod->visdata_view = NULL;
+			mod->visdata = NULL;
+		}
 		SAFE_FREE (mod->visdata);
+		Mod_FreePVSCache (mod);
+		if (mod->lightdata_view)
+		{
+			COM_FreeFileView (mod->lightdata_view);
+			mod->lightdata_view = NULL;
+			mod->lightdata = NULL;
+		}
 		SAFE_FREE (mod->lightdata);
 		SAFE_FREE (mod->entities);
 		for (int i = 0; i < PV_SIZE; ++i)
@@ -440,9 +629,36 @@ static void Mod_FreeModelMemory (qmodel_t *mod)
 		TexMgr_FreeTexturesForOwner (mod);
 }
 
+/*
+===================
+Mod_EvictModel
+===================
+*/
+static void Mod_EvictModel (qmodel_t *mod)
+{
+	if (mod->type == mod_alias)
+		for (int i = 0; i < PV_SIZE; ++i)
+			GLMesh_DeleteMeshBuffers ((aliashdr_t *)mod->extradata[i]);
+	mod->needload = true;
+	Mod_FreeModelMemory (mod);
+}
+
+/*
+===================
+Mod_IsCached
+===================
+*/
+static qboolean Mod_IsCached (const qmodel_t *mod)
+{
+	return !mod->needload && (mod->type == mod_alias || mod->type == mod_sprite);
+}
+
 /*
 ===================
 Mod_ClearAll
+
+Called between maps. Brush models always go, cached models only when mod_cache_maps
+or mod_cache_budget says so.
 ===================
 */
 void Mod_ClearAll (void)
@@ -451,13 +667,30 @@ void Mod_ClearAll (void)
 	qmodel_t *mod;
 	GL_DeleteBModelAccelerationStructures ();
 
+	++mod_map_sequence;
+	const int max_age = q_max (1, (int)mod_cache_maps.value);
 	for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
 	{
-		if (mod->type != mod_alias)
-		{
-			mod->needload = true;
-			Mod_FreeModelMemory (mod); // johnfitz
-		}
+		if (!Mod_IsCached (mod) || (mod_map_sequence - mod->last_used_map) > max_age)
+			Mod_EvictModel (mod); // johnfitz
+	}
+	W_TrimWadCache (max_age);
+
+	// Brush models are gone now, so what's left on the tag is the cache itself
+	const uint64_t budget = (uint64_t)q_max (0.0f, mod_cache_budget.value) * 1024 * 1024;
+	uint64_t	   bytes, peak_bytes, allocations;
+	Mem_GetTagStats (MEM_TAG_MODELS, &bytes, &peak_bytes, &allocations);
+	while (bytes > budget)
+	{
+		qmodel_t *oldest = NULL;
+		for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
+			if (Mod_IsCached (mod) && (mod_map_sequence - mod->last_used_map) > 0 && (!oldest || mod->last_used_map < oldest->last_used_map))
+				oldest = mod;
+		if (!oldest)
+			break;
+		Con_DPrintf ("Mod_ClearAll: evicting %s, model memory over mod_cache_budget\n", oldest->name);
+		Mod_EvictModel (oldest);
+		Mem_GetTagStats (MEM_TAG_MODELS, &bytes, &peak_bytes, &allocations);
 	}
 
 	InvalidateTraceLineCache ();
@@ -485,6 +718,12 @@ void Mod_ResetAll (void)
 		memset (mod, 0, sizeof (qmodel_t));
 	}
 	mod_numknown = 0;
+	if (mod_known_map)
+	{
+		HashMap_Destroy (mod_known_map);
+		mod_known_map = NULL;
+	}
+	W_FlushWadCache ();
 
 	InvalidateTraceLineCache ();
 }
@@ -506,19 +745,26 @@ qmodel_t *Mod_FindName (const char *name)
 	//
 	// search the currently loaded models
 	//
-	for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
-		if (!strcmp (mod->name, name))
-			break;
-
-	if (i == mod_numknown)
-	{
-		if (mod_numknown == MAX_MODELS)
-			Sys_Error ("mod_numknown == MAX_MODELS");
-		q_strlcpy (mod->name, name, MAX_QPATH);
-		mod->needload = true;
-		mod_numknown++;
-		InvalidateTraceLineCache ();
-	}
+	if (!mod_known_map)
+		mod_known_map = HashMap_Create (const char *, int, &HashStr, &HashStrCmp);
+	int *index = HashMap_Lookup (int, mod_known_map, &name);
+	if (index)
+	{
+		mod_known[*index].last_used_map = mod_map_sequence;
+		return &mod_known[*index];
+	}
+
+	if (mod_numknown == MAX_MODELS)
+		Sys_Error ("mod_numknown == MAX_MODELS");
+	i = mod_numknown;
+	mod = &mod_known[i];
+	q_strlcpy (mod->name, name, MAX_QPATH);
+	mod->needload = true;
+	mod->last_used_map = mod_map_sequence;
+	mod_numknown++;
+	const char *key = mod->name;
+	HashMap_Insert (mod_known_map, &key, &i);
+	InvalidateTraceLineCache ();
 
 	return mod;
 }
@@ -549,6 +795,7 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 		return mod;
 
 	InvalidateTraceLineCache ();
+	const mem_tag_t tag = Mem_SetTag (MEM_TAG_MODELS);
 
 	if (mod->type == mod_alias)
 	{
@@ -563,17 +810,29 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 	unsigned int md5_enhanced_path_id = 0;
 	unsigned int md3_enhanced_path_id = 0;
 
-	byte *buf = NULL;
+	byte		  *buf = NULL;
+	const byte	  *view = NULL;
+	int			   view_len = 0;
+	const qboolean mod_is_bsp = (strcmp (COM_FileGetExtension (mod->name), "bsp") == 0);
 
 	char md3_name[MAX_QPATH], md5_name[MAX_QPATH];
 
 	// 1. Load the original model buffer:
-	buf = COM_LoadFile (mod->name, &mod->path_id);
+	// Brush model loading never writes to its input, so those can read straight
+	// out of a memory mapped pak. The other loaders patch their buffer in place.
+	if (mod_is_bsp)
+	{
+		view = COM_LoadFileView (mod->name, &mod->path_id, &view_len);
+		buf = (byte *)view;
+	}
+	else
+		buf = COM_LoadFile (mod->name, &mod->path_id);
 
 	if (!buf)
 	{
 		if (crash)
 			Host_Error ("Mod_LoadModel: %s not found", mod->name); // johnfitz -- was "Mod_NumForName"
+		Mem_SetTag (tag);
 		return NULL;
 	}
 
@@ -654,6 +913,14 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 	mod->needload = false;
 
 	mod_type = (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24));
+	if (view && (mod_type == IDPOLYHEADER || mod_type == IDSPRITEHEADER))
+	{
+		// not a brush model after all, give the in-place loaders a private copy
+		buf = (byte *)Mem_AllocNonZero (view_len);
+		memcpy (buf, view, view_len);
+		COM_FreeFileView (view);
+		view = NULL;
+	}
 	switch (mod_type)
 	{
 	case IDPOLYHEADER:
@@ -686,12 +953,17 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 	{
 		char loadname[MAX_QPATH];
 		COM_FileBase (mod->name, loadname, sizeof (loadname));
+		mod->bsp_checksum = view ? Com_BlockChecksum ((void *)view, view_len) : 0;
 		Mod_LoadBrushModel (mod, loadname, buf);
 	}
 	break;
 	}
 
-	Mem_Free (buf);
+	if (view)
+		COM_FreeFileView (view);
+	else
+		Mem_Free (buf);
+	Mem_SetTag (tag);
 	return mod;
 }
 
@@ -702,10 +974,31 @@ Mod_ForName
 Loads in a model for the given name
 ==================
 */
+typedef struct
+{
+	const char *name;
+	qboolean	crash;
+	qmodel_t   *mod;
+} mod_fornamecall_t;
+
+static void Mod_ForNameCall (void *data)
+{
+	mod_fornamecall_t *call = (mod_fornamecall_t *)data;
+	call->mod = Mod_ForName (call->name, call->crash);
+}
+
 qmodel_t *Mod_ForName (const char *name, qboolean crash)
 {
 	qmodel_t *mod;
 
+	if (Host_IsServerThread ())
+	{
+		// late precaches of the threaded server, loading uploads to the gpu
+		mod_fornamecall_t call = {name, crash, NULL};
+		Host_CallOnMainThread (Mod_ForNameCall, &call);
+		return call.mod;
+	}
+
 	mod = Mod_FindName (name);
 
 	return Mod_LoadModel (mod, crash);
@@ -726,7 +1019,7 @@ Mod_LoadWadFiles
 load all of the wads listed in the worldspawn "wad" field
 =============
 */
-static wad_t *Mod_LoadWadFiles (qmodel_t *mod)
+static wadlist_t *Mod_LoadWadFiles (qmodel_t *mod)
 {
 	char		key[128], value[4096];
 	const char *data;
@@ -776,7 +1069,7 @@ Mod_LoadWadTexture
 look for an external texture in any of the loaded map wads
 =================
 */
-static texture_t *Mod_LoadWadTexture (qmodel_t *mod, wad_t *wads, const char *name)
+static texture_t *Mod_LoadWadTexture (qmodel_t *mod, wadlist_t *wads, const char *name)
 {
 	int			   i, pixels;
 	lumpinfo_t	  *info;
@@ -796,9 +1089,14 @@ static texture_t *Mod_LoadWadTexture (qmodel_t *mod, wad_t *wads, const char *na
 		return NULL;
 	}
 
+	if (info->size < (int)sizeof (miptex_t))
+	{
+		Con_Warning ("Truncated texture %s in %s!\n", name, wad->name);
+		return NULL;
+	}
+
 	// override the texture from the bsp file
-	FS_fseek (&wad->fh, info->filepos, SEEK_SET);
-	FS_fread (&mt, 1, sizeof (miptex_t), &wad->fh);
+	memcpy (&mt, wad->data + info->filepos, sizeof (miptex_t));
 
 	mt.width = LittleLong (mt.width);
 	mt.height = LittleLong (mt.height);
@@ -821,8 +1119,7 @@ static texture_t *Mod_LoadWadTexture (qmodel_t *mod, wad_t *wads, const char *na
 		{
 			// the palette is basically garunteed to be 256 colors but,
 			// we might as well use the value since it *does* exist
-			FS_fseek (&wad->fh, info->filepos + pixels, SEEK_SET);
-			FS_fread (&colors, 1, 2, &wad->fh);
+			memcpy (&colors, wad->data + info->filepos + pixels, 2);
 			colors = LittleShort (colors);
 			// add space for the color palette
 			pixels += colors * 3;
@@ -840,10 +1137,10 @@ static texture_t *Mod_LoadWadTexture (qmodel_t *mod, wad_t *wads, const char *na
 	// the pixels immediately follow the structures
 
 	// check for pixels extending past the end of the lump
-	if (pixels > info->size)
+	if (pixels > info->size - (int)sizeof (miptex_t))
 	{
 		Con_DPrintf ("Texture %s extends past end of lump\n", mt.name);
-		pixels = info->size;
+		pixels = info->size - (int)sizeof (miptex_t);
 	}
 	tx->source_file[0] = 0;
 	tx->source_offset = (src_offset_t)(tx + 1);
@@ -854,8 +1151,7 @@ static texture_t *Mod_LoadWadTexture (qmodel_t *mod, wad_t *wads, const char *na
 	tx->shift = 0;								  // Q64 only
 	tx->palette = pal;
 
-	FS_fseek (&wad->fh, info->filepos + sizeof (miptex_t), SEEK_SET);
-	FS_fread (tx + 1, 1, pixels, &wad->fh);
+	memcpy (tx + 1, wad->data + info->filepos + sizeof (miptex_t), pixels);
 
 	return tx;
 }
@@ -942,11 +1238,11 @@ static void Mod_LoadTextureTask (int i, qmodel_t **ppmod)
 		COM_StripExtension (mod->name + 5, mapname, sizeof (mapname));
 		q_snprintf (filename, sizeof (filename), "textures/%s/#%s", mapname, tx->name + 1); // this also replaces the '*' with a '#'
 		enum srcformat fmt = SRC_RGBA;
-		data = Image_LoadImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
+		data = Image_LoadTextureImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
 		if (!data)
 		{
 			q_snprintf (filename, sizeof (filename), "textures/#%s", tx->name + 1);
-			data = Image_LoadImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
+			data = Image_LoadTextureImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
 		}
 
 		// now load whatever we found
@@ -983,11 +1279,11 @@ static void Mod_LoadTextureTask (int i, qmodel_t **ppmod)
 		COM_StripExtension (mod->name + 5, mapname, sizeof (mapname));
 		q_snprintf (filename, sizeof (filename), "textures/%s/%s", mapname, tx->name);
 		enum srcformat fmt = SRC_RGBA;
-		data = Image_LoadImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
+		data = Image_LoadTextureImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
 		if (!data)
 		{
 			q_snprintf (filename, sizeof (filename), "textures/%s", tx->name);
-			data = Image_LoadImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
+			data = Image_LoadTextureImage (filename, &fwidth, &fheight, &fmt, mod->path_id);
 		}
 
 		// now load whatever we found
@@ -1000,11 +1296,11 @@ static void Mod_LoadTextureTask (int i, qmodel_t **ppmod)
 
 			// now try to load glow/luma image from the same place
 			q_snprintf (filename2, sizeof (filename2), "%s_glow", filename);
-			data = Image_LoadImage (filename2, &fwidth, &fheight, &fmt, mod->path_id);
+			data = Image_LoadTextureImage (filename2, &fwidth, &fheight, &fmt, mod->path_id);
 			if (!data)
 			{
 				q_snprintf (filename2, sizeof (filename2), "%s_luma", filename);
-				data = Image_LoadImage (filename2, &fwidth, &fheight, &fmt, mod->path_id);
+				data = Image_LoadTextureImage (filename2, &fwidth, &fheight, &fmt, mod->path_id);
 			}
 
 			if (data)
@@ -1059,7 +1355,7 @@ static void Mod_LoadTextures (qmodel_t *mod, byte *mod_base, lump_t *l)
 	byte	  *pixels_p;
 	int		   nummiptex;
 	int		   dataofs;
-	wad_t	  *wads;
+	wadlist_t *wads;
 #ifdef BSP29_VALVE
 	qboolean	   pal;
 	unsigned short colors;
@@ -1188,7 +1484,8 @@ static void Mod_LoadTextures (qmodel_t *mod, byte *mod_base, lump_t *l)
 	{
 		if (!Tasks_IsWorker () && (nummiptex > 1))
 		{
-			task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)Mod_LoadTextureTask, nummiptex, &mod, sizeof (mod));
+			// background, so a map load doesn't delay the frame work of the workers
+			task_handle_t task = Task_AllocateAssignBackgroundIndexedFuncAndSubmit ((task_indexed_func_t)Mod_LoadTextureTask, nummiptex, &mod, sizeof (mod));
 			Task_Join (task, TASK_TIMEOUT_INFINITE);
 		}
 		else
@@ -1299,47 +1596,72 @@ static void Mod_LoadTextures (qmodel_t *mod, byte *mod_base, lump_t *l)
 	}
 }
 
+// external .lit/.ent file looked up by a worker task during Mod_LoadBrushModel
+typedef struct
+{
+	qmodel_t	*mod;
+	byte		*mod_base;
+	lump_t		*lump;
+	char		 filename[MAX_QPATH];
+	const byte	*data; // COM_LoadFileView result, NULL if not found
+	int			 len;
+	unsigned int path_id;
+	qboolean	 versioned;
+} mod_external_file_t;
+
+/*
+=================
+Mod_FindLightingExternalTask
+
+Runs on a worker while the bsp lumps load, see Mod_LoadBrushModel
+=================
+*/
+static void Mod_FindLightingExternalTask (mod_external_file_t **pfile)
+{
+	mod_external_file_t *file = *pfile;
+
+	// LordHavoc: check for a .lit file
+	q_strlcpy (file->filename, file->mod->name, sizeof (file->filename));
+	COM_StripExtension (file->filename, file->filename, sizeof (file->filename));
+	q_strlcat (file->filename, ".lit", sizeof (file->filename));
+	file->data = COM_LoadFileView (file->filename, &file->path_id, &file->len);
+}
+
 /*
 =================
 Mod_LoadLighting -- johnfitz -- replaced with lit support code via lordhavoc
 =================
 */
-static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l)
+static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l, mod_external_file_t *lit)
 {
-	int			 i;
-	byte		*in, *out, *data;
-	byte		 d, q64_b0, q64_b1;
-	char		 litfilename[MAX_OSPATH];
-	unsigned int path_id;
+	int			i;
+	byte	   *in, *out;
+	const byte *data = lit->data;
+	byte		d, q64_b0, q64_b1;
 
 	mod->lightdata = NULL;
-	// LordHavoc: check for a .lit file
-	q_strlcpy (litfilename, mod->name, sizeof (litfilename));
-	COM_StripExtension (litfilename, litfilename, sizeof (litfilename));
-	q_strlcat (litfilename, ".lit", sizeof (litfilename));
-	data = (byte *)COM_LoadFile (litfilename, &path_id);
 	if (data)
 	{
 		// use lit file only from the same gamedir as the map
 		// itself or from a searchpath with higher priority.
-		if (path_id < mod->path_id)
+		if (lit->path_id < mod->path_id)
 		{
-			Con_DPrintf ("ignored %s from a gamedir with lower priority\n", litfilename);
+			Con_DPrintf ("ignored %s from a gamedir with lower priority\n", lit->filename);
 		}
-		else if (data[0] == 'Q' && data[1] == 'L' && data[2] == 'I' && data[3] == 'T')
+		else if (lit->len >= 8 && data[0] == 'Q' && data[1] == 'L' && data[2] == 'I' && data[3] == 'T')
 		{
 			i = ReadLongUnaligned (data + sizeof (int));
 			if (i == 1)
 			{
-				if (8 + l->filelen * 3 == com_filesize)
+				if (8 + l->filelen * 3 == lit->len)
 				{
-					Con_DPrintf2 ("%s loaded\n", litfilename);
-					mod->lightdata = (byte *)Mem_AllocNonZero (l->filelen * 3);
-					memcpy (mod->lightdata, data + 8, l->filelen * 3);
-					Mem_Free (data);
+					Con_DPrintf2 ("%s loaded\n", lit->filename);
+					// used in place, the lighting is never written to
+					mod->lightdata_view = data;
+					mod->lightdata = (byte *)data + 8;
 					return;
 				}
-				Con_Printf ("Outdated .lit file (%s should be %u bytes, not %" SDL_PRIs64 ")\n", litfilename, 8 + l->filelen * 3, com_filesize);
+				Con_Printf ("Outdated .lit file (%s should be %u bytes, not %d)\n", lit->filename, 8 + l->filelen * 3, lit->len);
 			}
 			else
 			{
@@ -1351,7 +1673,7 @@ static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l)
 			Con_Printf ("Corrupt .lit file (old version?), ignoring\n");
 		}
 
-		Mem_Free (data);
+		COM_FreeFileView (data);
 	}
 	// LordHavoc: no .lit found, expand the white lighting data to color
 	if (!l->filelen)
@@ -1421,59 +1743,67 @@ static void Mod_LoadVisibility (qmodel_t *mod, byte *mod_base, lump_t *l)
 
 /*
 =================
-Mod_LoadEntities
+Mod_FindEntitiesExternalTask
+
+Runs on a worker while the bsp lumps load, see Mod_LoadBrushModel
 =================
 */
-static void Mod_LoadEntities (qmodel_t *mod, byte *mod_base, lump_t *l)
+static void Mod_FindEntitiesExternalTask (mod_external_file_t **pfile)
 {
-	char		 basemapname[MAX_QPATH];
-	char		 entfilename[MAX_QPATH];
-	char		*ents = NULL;
-	unsigned int path_id;
-	unsigned int crc = 0;
-	qboolean	 versioned = true;
+	mod_external_file_t *file = *pfile;
+	char				 basemapname[MAX_QPATH];
+	unsigned int		 crc = 0;
 
-	if (!external_ents.value)
-		goto _load_embedded;
-
-	if (l->filelen > 0)
+	if (file->lump->filelen > 0)
 	{
-		crc = CRC_Block (mod_base + l->fileofs, l->filelen - 1);
+		crc = CRC_Block (file->mod_base + file->lump->fileofs, file->lump->filelen - 1);
 	}
 
-	q_strlcpy (basemapname, mod->name, sizeof (basemapname));
+	q_strlcpy (basemapname, file->mod->name, sizeof (basemapname));
 	COM_StripExtension (basemapname, basemapname, sizeof (basemapname));
 
-	q_snprintf (entfilename, sizeof (entfilename), "%s@%04x.ent", basemapname, crc);
-	Con_DPrintf2 ("trying to load %s\n", entfilename);
-	ents = (char *)COM_LoadFile (entfilename, &path_id);
+	q_snprintf (file->filename, sizeof (file->filename), "%s@%04x.ent", basemapname, crc);
+	Con_DPrintf2 ("trying to load %s\n", file->filename);
+	file->data = COM_LoadFileView (file->filename, &file->path_id, &file->len);
+	file->versioned = true;
 
-	if (!ents)
+	if (!file->data)
 	{
-		q_snprintf (entfilename, sizeof (entfilename), "%s.ent", basemapname);
-		Con_DPrintf2 ("trying to load %s\n", entfilename);
-		ents = (char *)COM_LoadFile (entfilename, &path_id);
-		versioned = false;
+		q_snprintf (file->filename, sizeof (file->filename), "%s.ent", basemapname);
+		Con_DPrintf2 ("trying to load %s\n", file->filename);
+		file->data = COM_LoadFileView (file->filename, &file->path_id, &file->len);
+		file->versioned = false;
 	}
+}
 
-	if (ents)
+/*
+=================
+Mod_LoadEntities
+=================
+*/
+static void Mod_LoadEntities (qmodel_t *mod, byte *mod_base, lump_t *l, mod_external_file_t *ent)
+{
+	if (ent->data)
 	{
 		// use ent file only from the same gamedir as the map
 		// itself or from a searchpath with higher priority
 		// unless we got a CRC match
-		if (versioned == false && path_id < mod->path_id)
+		if (ent->versioned == false && ent->path_id < mod->path_id)
 		{
-			Con_DPrintf ("ignored %s from a gamedir with lower priority\n", entfilename);
+			Con_DPrintf ("ignored %s from a gamedir with lower priority\n", ent->filename);
+			COM_FreeFileView (ent->data);
 		}
 		else
 		{
-			mod->entities = ents;
-			Con_DPrintf ("Loaded external entity file %s\n", entfilename);
+			mod->entities = (char *)Mem_AllocNonZero (ent->len + 1);
+			memcpy (mod->entities, ent->data, ent->len);
+			mod->entities[ent->len] = 0;
+			COM_FreeFileView (ent->data);
+			Con_DPrintf ("Loaded external entity file %s\n", ent->filename);
 			return;
 		}
 	}
 
-_load_embedded:
 	if (!l->filelen)
 	{
 		Mem_Free (mod->entities);
@@ -1482,7 +1812,6 @@ _load_embedded:
 	}
 	mod->entities = (char *)Mem_Alloc (l->filelen);
 	memcpy (mod->entities, mod_base + l->fileofs, l->filelen);
-	Mem_Free (ents);
 }
 
 /*
@@ -1727,194 +2056,214 @@ static void Mod_PolyForUnlitSurface (qmodel_t *mod, msurface_t *fa)
 	}
 }
 
-/*
-================
-Mod_CalcSurfaceExtents
-================
-*/
-static void Mod_CalcSurfaceExtentsTask (int surfnum, qmodel_t **mod_ptr)
+#define FACES_PER_TASK 256
+
+typedef struct
 {
-	qmodel_t *mod = *mod_ptr;
-	CalcSurfaceExtents (mod, &mod->surfaces[surfnum]);
-}
+	qmodel_t *mod;
+	byte	 *in;
+	int		  count;
+	qboolean  bsp2;
+} load_faces_task_args_t;
 
 /*
 =================
-Mod_LoadFaces
+Mod_LoadFace
 =================
 */
-static void Mod_LoadFaces (qmodel_t *mod, byte *mod_base, lump_t *l, qboolean bsp2)
+static void Mod_LoadFace (qmodel_t *mod, msurface_t *out, byte *in, qboolean bsp2)
 {
-	byte	   *ins;
-	byte	   *inl;
-	msurface_t *out;
-	int			i, count, surfnum, lofs;
-	int			planenum, side, texinfon;
+	int i, lofs;
+	int planenum, side, texinfon;
 
 	if (bsp2)
 	{
-		ins = NULL;
-		inl = mod_base + l->fileofs;
-		if (l->filelen % sizeof (dlface_t))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
-		count = l->filelen / sizeof (dlface_t);
-	}
-	else
-	{
-		ins = mod_base + l->fileofs;
-		inl = NULL;
-		if (l->filelen % sizeof (dsface_t))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
-		count = l->filelen / sizeof (dsface_t);
-	}
-	out = (msurface_t *)Mem_AllocNonZero (count * sizeof (*out));
-
-	// johnfitz -- warn mappers about exceeding old limits
-	if (count > 32767 && !bsp2)
-		Con_DWarning ("%i faces exceeds standard limit of 32767.\n", count);
-	// johnfitz
-
-	mod->surfaces = out;
-	mod->numsurfaces = count;
-
-	for (surfnum = 0; surfnum < count; surfnum++, out++)
-	{
-		if (bsp2)
+		out->firstedge = ReadLongUnaligned (in + offsetof (dlface_t, firstedge));
+		out->numedges = ReadLongUnaligned (in + offsetof (dlface_t, numedges));
+		planenum = ReadLongUnaligned (in + offsetof (dlface_t, planenum));
+		side = ReadLongUnaligned (in + offsetof (dlface_t, side));
+		texinfon = ReadLongUnaligned (in + offsetof (dlface_t, texinfo));
+		for (i = 0; i < MAXLIGHTMAPS; i++)
 		{
-			out->firstedge = ReadLongUnaligned (inl + offsetof (dlface_t, firstedge));
-			out->numedges = ReadLongUnaligned (inl + offsetof (dlface_t, numedges));
-			planenum = ReadLongUnaligned (inl + offsetof (dlface_t, planenum));
-			side = ReadLongUnaligned (inl + offsetof (dlface_t, side));
-			texinfon = ReadLongUnaligned (inl + offsetof (dlface_t, texinfo));
-			for (i = 0; i < MAXLIGHTMAPS; i++)
+			out->styles[i] = *(in + offsetof (dlface_t, styles[i]));
+			if (out->styles[i] >= MAX_LIGHTSTYLES && out->styles[i] != 255)
 			{
-				out->styles[i] = *(inl + offsetof (dlface_t, styles[i]));
-				if (out->styles[i] >= MAX_LIGHTSTYLES && out->styles[i] != 255)
-				{
-					Con_Warning ("Invalid lightstyle %d\n", out->styles[i]);
-					out->styles[i] = 0;
-				}
-				byte j = out->styles[i];
-				if (j < 255)
-					out->styles_bitmap |= 1 << (j < 16 ? j : j % 16 + 16);
+				Con_Warning ("Invalid lightstyle %d\n", out->styles[i]);
+				out->styles[i] = 0;
 			}
-			lofs = ReadLongUnaligned (inl + offsetof (dlface_t, lightofs));
-			inl += sizeof (dlface_t);
+			byte j = out->styles[i];
+			if (j < 255)
+				out->styles_bitmap |= 1 << (j < 16 ? j : j % 16 + 16);
 		}
-		else
+		lofs = ReadLongUnaligned (in + offsetof (dlface_t, lightofs));
+	}
+	else
+	{
+		out->firstedge = ReadLongUnaligned (in + offsetof (dsface_t, firstedge));
+		out->numedges = ReadShortUnaligned (in + offsetof (dsface_t, numedges));
+		planenum = ReadShortUnaligned (in + offsetof (dsface_t, planenum));
+		side = ReadShortUnaligned (in + offsetof (dsface_t, side));
+		texinfon = ReadShortUnaligned (in + offsetof (dsface_t, texinfo));
+		for (i = 0; i < MAXLIGHTMAPS; i++)
 		{
-			out->firstedge = ReadLongUnaligned (ins + offsetof (dsface_t, firstedge));
-			out->numedges = ReadShortUnaligned (ins + offsetof (dsface_t, numedges));
-			planenum = ReadShortUnaligned (ins + offsetof (dsface_t, planenum));
-			side = ReadShortUnaligned (ins + offsetof (dsface_t, side));
-			texinfon = ReadShortUnaligned (ins + offsetof (dsface_t, texinfo));
-			for (i = 0; i < MAXLIGHTMAPS; i++)
+			out->styles[i] = *(in + offsetof (dsface_t, styles[i]));
+			if (out->styles[i] >= MAX_LIGHTSTYLES && out->styles[i] != 255)
 			{
-				out->styles[i] = *(ins + offsetof (dsface_t, styles[i]));
-				if (out->styles[i] >= MAX_LIGHTSTYLES && out->styles[i] != 255)
-				{
-					Con_Warning ("Invalid lightstyle %d\n", out->styles[i]);
-					out->styles[i] = 0;
-				}
-				byte j = out->styles[i];
-				if (j < 255)
-					out->styles_bitmap |= 1 << (j < 16 ? j : j % 16 + 16);
+				Con_Warning ("Invalid lightstyle %d\n", out->styles[i]);
+				out->styles[i] = 0;
 			}
-			lofs = ReadLongUnaligned (ins + offsetof (dsface_t, lightofs));
-			ins += sizeof (dsface_t);
+			byte j = out->styles[i];
+			if (j < 255)
+				out->styles_bitmap |= 1 << (j < 16 ? j : j % 16 + 16);
 		}
+		lofs = ReadLongUnaligned (in + offsetof (dsface_t, lightofs));
+	}
 
-		if (!out->styles_bitmap)
-			out->styles_bitmap = 1;
+	if (!out->styles_bitmap)
+		out->styles_bitmap = 1;
 
-		out->flags = 0;
-		out->polys = NULL;
+	out->flags = 0;
+	out->polys = NULL;
 
-		if (side)
-			out->flags |= SURF_PLANEBACK;
+	if (side)
+		out->flags |= SURF_PLANEBACK;
 
-		out->plane = mod->planes + planenum;
+	out->plane = mod->planes + planenum;
 
-		out->texinfo = mod->texinfo + texinfon;
+	out->texinfo = mod->texinfo + texinfon;
 
-		// lighting info
-		if (mod->bspversion == BSPVERSION_QUAKE64)
-			lofs /= 2; // Q64 samples are 16bits instead 8 in normal Quake
+	// lighting info
+	if (mod->bspversion == BSPVERSION_QUAKE64)
+		lofs /= 2; // Q64 samples are 16bits instead 8 in normal Quake
 
-		if (lofs == -1)
-			out->samples = NULL;
+	if (lofs == -1)
+		out->samples = NULL;
 #ifdef BSP29_VALVE
-		else if (mod->bspversion == BSPVERSION_VALVE)
-			out->samples = mod->lightdata + lofs; // accounts for RGB light data
+	else if (mod->bspversion == BSPVERSION_VALVE)
+		out->samples = mod->lightdata + lofs; // accounts for RGB light data
 #endif
+	else
+		out->samples = mod->lightdata + (lofs * 3); // johnfitz -- lit support via lordhavoc (was "+ i")
+
+	// johnfitz -- this section rewritten
+	out->lightmaptexturenum = -1;
+	if (!q_strncasecmp (out->texinfo->texture->name, "sky", 3)) // sky surface //also note -- was strncmp, changed to match qbsp
+	{
+		out->flags |= (SURF_DRAWSKY | SURF_DRAWTILED);
+		Mod_PolyForUnlitSurface (mod, out); // no more subdivision
+	}
+	else if (out->texinfo->texture->name[0] == '*' || out->texinfo->texture->name[0] == '!') // warp surface
+	{
+		out->flags |= SURF_DRAWTURB;
+
+		if (out->texinfo->flags & TEX_SPECIAL)
+			out->flags |= SURF_DRAWTILED; // unlit water
+
+		// detect special liquid types
+		if (!strncmp (out->texinfo->texture->name, "*lava", 5) || !strncmp (out->texinfo->texture->name, "!lava", 5))
+			out->flags |= SURF_DRAWLAVA;
+		else if (!strncmp (out->texinfo->texture->name, "*slime", 6) || !strncmp (out->texinfo->texture->name, "!slime", 6))
+			out->flags |= SURF_DRAWSLIME;
+		else if (!strncmp (out->texinfo->texture->name, "*tele", 5) || !strncmp (out->texinfo->texture->name, "!tele", 5))
+			out->flags |= SURF_DRAWTELE;
 		else
-			out->samples = mod->lightdata + (lofs * 3); // johnfitz -- lit support via lordhavoc (was "+ i")
+			out->flags |= SURF_DRAWWATER;
 
-		// johnfitz -- this section rewritten
-		out->lightmaptexturenum = -1;
-		if (!q_strncasecmp (out->texinfo->texture->name, "sky", 3)) // sky surface //also note -- was strncmp, changed to match qbsp
+		if (out->flags & SURF_DRAWTILED)
+			Mod_PolyForUnlitSurface (mod, out);
+	}
+	else if (out->texinfo->texture->name[0] == '{') // ericw -- fence textures
+	{
+		out->flags |= SURF_DRAWFENCE;
+	}
+	else if (out->texinfo->flags & TEX_MISSING) // texture is missing from bsp
+	{
+		out->flags |= SURF_NOTEXTURE;
+		qboolean missing_samples = !out->samples && out->styles[0] != 255;
+		qboolean unlit_texture = out->texinfo->flags & TEX_SPECIAL;
+
+		if (!unlit_texture && missing_samples)
 		{
-			out->flags |= (SURF_DRAWSKY | SURF_DRAWTILED);
-			Mod_PolyForUnlitSurface (mod, out); // no more subdivision
+			// unlit surf in a lit texture (mod->numtextures - 2: r_notexture_mip instead of r_notexture_mip2)
+			Con_Warning ("Mod_LoadFaces: TEX_MISSING without TEX_SPECIAL missing lightmap samples");
+			out->lightmaptexturenum = 0; // set a lightmaptexturenum to at least avoid a crash
 		}
-		else if (out->texinfo->texture->name[0] == '*' || out->texinfo->texture->name[0] == '!') // warp surface
-		{
-			out->flags |= SURF_DRAWTURB;
-
-			if (out->texinfo->flags & TEX_SPECIAL)
-				out->flags |= SURF_DRAWTILED; // unlit water
-
-			// detect special liquid types
-			if (!strncmp (out->texinfo->texture->name, "*lava", 5) || !strncmp (out->texinfo->texture->name, "!lava", 5))
-				out->flags |= SURF_DRAWLAVA;
-			else if (!strncmp (out->texinfo->texture->name, "*slime", 6) || !strncmp (out->texinfo->texture->name, "!slime", 6))
-				out->flags |= SURF_DRAWSLIME;
-			else if (!strncmp (out->texinfo->texture->name, "*tele", 5) || !strncmp (out->texinfo->texture->name, "!tele", 5))
-				out->flags |= SURF_DRAWTELE;
-			else
-				out->flags |= SURF_DRAWWATER;
 
-			if (out->flags & SURF_DRAWTILED)
-				Mod_PolyForUnlitSurface (mod, out);
-		}
-		else if (out->texinfo->texture->name[0] == '{') // ericw -- fence textures
+		if (unlit_texture || missing_samples) // not lightmapped
 		{
-			out->flags |= SURF_DRAWFENCE;
+			out->flags |= SURF_DRAWTILED;
+			Mod_PolyForUnlitSurface (mod, out);
 		}
-		else if (out->texinfo->flags & TEX_MISSING) // texture is missing from bsp
-		{
-			out->flags |= SURF_NOTEXTURE;
-			qboolean missing_samples = !out->samples && out->styles[0] != 255;
-			qboolean unlit_texture = out->texinfo->flags & TEX_SPECIAL;
+	}
+	// johnfitz
+}
 
-			if (!unlit_texture && missing_samples)
-			{
-				// unlit surf in a lit texture (mod->numtextures - 2: r_notexture_mip instead of r_notexture_mip2)
-				Con_Warning ("Mod_LoadFaces: TEX_MISSING without TEX_SPECIAL missing lightmap samples");
-				out->lightmaptexturenum = 0; // set a lightmaptexturenum to at least avoid a crash
-			}
+/*
+=================
+Mod_LoadFacesTask
 
-			if (unlit_texture || missing_samples) // not lightmapped
-			{
-				out->flags |= SURF_DRAWTILED;
-				Mod_PolyForUnlitSurface (mod, out);
-			}
-		}
-		// johnfitz
+Converts a batch of FACES_PER_TASK faces. The surface extents only depend on
+the face itself and the geometry lumps, so they are calculated right away too.
+=================
+*/
+static void Mod_LoadFacesTask (int batch, load_faces_task_args_t *args)
+{
+	const size_t face_size = args->bsp2 ? sizeof (dlface_t) : sizeof (dsface_t);
+	const int	 first = batch * FACES_PER_TASK;
+	const int	 last = q_min (first + FACES_PER_TASK, args->count);
+	for (int i = first; i < last; ++i)
+	{
+		msurface_t *out = &args->mod->surfaces[i];
+		Mod_LoadFace (args->mod, out, args->in + (i * face_size), args->bsp2);
+		if (!isDedicated)
+			CalcSurfaceExtents (args->mod, out);
 	}
+}
 
-	if (!isDedicated)
+/*
+=================
+Mod_LoadFaces
+=================
+*/
+static void Mod_LoadFaces (qmodel_t *mod, byte *mod_base, lump_t *l, qboolean bsp2)
+{
+	byte	   *in = mod_base + l->fileofs;
+	msurface_t *out;
+	int			i, count;
+
+	if (bsp2)
 	{
-		if (!Tasks_IsWorker () && (count > 1))
-		{
-			task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)Mod_CalcSurfaceExtentsTask, count, &mod, sizeof (qmodel_t *));
-			Task_Join (task, TASK_TIMEOUT_INFINITE);
-		}
-		else
-		{
-			for (i = 0; i < count; i++)
-				Mod_CalcSurfaceExtentsTask (i, &mod);
-		}
+		if (l->filelen % sizeof (dlface_t))
+			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
+		count = l->filelen / sizeof (dlface_t);
+	}
+	else
+	{
+		if (l->filelen % sizeof (dsface_t))
+			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
+		count = l->filelen / sizeof (dsface_t);
+	}
+	out = (msurface_t *)Mem_AllocNonZero (count * sizeof (*out));
+
+	// johnfitz -- warn mappers about exceeding old limits
+	if (count > 32767 && !bsp2)
+		Con_DWarning ("%i faces exceeds standard limit of 32767.\n", count);
+	// johnfitz
+
+	mod->surfaces = out;
+	mod->numsurfaces = count;
+
+	load_faces_task_args_t args = {mod, in, count, bsp2};
+	const int			   num_batches = (count + FACES_PER_TASK - 1) / FACES_PER_TASK;
+	if (num_batches > 1)
+	{
+		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)Mod_LoadFacesTask, num_batches, &args, sizeof (args));
+		Task_Join (task, TASK_TIMEOUT_INFINITE);
+	}
+	else
+	{
+		for (i = 0; i < num_batches; i++)
+			Mod_LoadFacesTask (i, &args);
 	}
 }
 
@@ -2349,6 +2698,31 @@ static void Mod_CheckWaterVis (qmodel_t *mod)
 	mod->contentstransparent = contenttransparent | (~contentfound & (SURF_DRAWWATER | SURF_DRAWTELE | SURF_DRAWSLIME | SURF_DRAWLAVA));
 }
 
+/*
+=================
+Mod_PackClipnodes
+
+Copies the planes into the clipnodes, so a trace touches a single contiguous
+array instead of chasing into the plane lump at every node.
+=================
+*/
+static mpackedclipnode_t *Mod_PackClipnodes (mclipnode_t *in, int count, mplane_t *planes)
+{
+	mpackedclipnode_t *out = (mpackedclipnode_t *)Mem_Alloc (count * sizeof (*out));
+
+	for (int i = 0; i < count; i++)
+	{
+		mplane_t *plane = planes + in[i].planenum;
+		VectorCopy (plane->normal, out[i].normal);
+		out[i].dist = plane->dist;
+		out[i].type = plane->type;
+		out[i].children[0] = in[i].children[0];
+		out[i].children[1] = in[i].children[1];
+	}
+
+	return out;
+}
+
 /*
 =================
 Mod_LoadClipnodes
@@ -2453,6 +2827,8 @@ static void Mod_LoadClipnodes (qmodel_t *mod, byte *mod_base, lump_t *l, qboolea
 			// johnfitz
 		}
 	}
+
+	mod->hulls[1].packednodes = mod->hulls[2].packednodes = Mod_PackClipnodes (mod->clipnodes, count, mod->planes);
 }
 
 /*
@@ -2492,6 +2868,8 @@ static void Mod_MakeHull0 (qmodel_t *mod)
 				out->children[j] = child - mod->nodes;
 		}
 	}
+
+	hull->packednodes = Mod_PackClipnodes (hull->clipnodes, count, mod->planes);
 }
 
 /*
@@ -2742,23 +3120,34 @@ typedef struct vispatch_s
 } vispatch_t;
 #define VISPATCH_HEADER_LEN 36
 
-static FILE *Mod_FindVisibilityExternal (qmodel_t *mod, const char *loadname)
+/*
+=================
+Mod_FindVisibilityExternal
+
+Returns a view of the whole vispatch file and sets *entry and *entry_end
+to the data following the header of this map's entry. Nothing is copied,
+a mapped file only pages in the entries that are walked and read.
+=================
+*/
+static const byte *Mod_FindVisibilityExternal (qmodel_t *mod, const char *loadname, const byte **entry, const byte **entry_end)
 {
 	vispatch_t	 header;
 	char		 visfilename[MAX_QPATH];
 	const char	*shortname;
 	unsigned int path_id;
-	FILE		*f;
-	long		 pos;
-	size_t		 r;
+	const byte	*view;
+	int			 len;
+	size_t		 pos;
 
 	q_snprintf (visfilename, sizeof (visfilename), "maps/%s.vis", loadname);
-	if (COM_FOpenFile (visfilename, &f, &path_id) < 0)
+	view = COM_LoadFileView (visfilename, &path_id, &len);
+	if (!view)
 	{
 		Con_DPrintf ("%s not found, trying ", visfilename);
 		q_snprintf (visfilename, sizeof (visfilename), "%s.vis", COM_SkipPath (com_gamedir));
 		Con_DPrintf ("%s\n", visfilename);
-		if (COM_FOpenFile (visfilename, &f, &path_id) < 0)
+		view = COM_LoadFileView (visfilename, &path_id, &len);
+		if (!view)
 		{
 			Con_DPrintf ("external vis not found\n");
 			return NULL;
@@ -2766,7 +3155,7 @@ static FILE *Mod_FindVisibilityExternal (qmodel_t *mod, const char *loadname)
 	}
 	if (path_id < mod->path_id)
 	{
-		fclose (f);
+		COM_FreeFileView (view);
 		Con_DPrintf ("ignored %s from a gamedir with lower priority\n", visfilename);
 		return NULL;
 	}
@@ -2775,63 +3164,74 @@ static FILE *Mod_FindVisibilityExternal (qmodel_t *mod, const char *loadname)
 
 	shortname = COM_SkipPath (mod->name);
 	pos = 0;
-	while ((r = fread (&header, 1, VISPATCH_HEADER_LEN, f)) == VISPATCH_HEADER_LEN)
+	while (pos + VISPATCH_HEADER_LEN <= (size_t)len)
 	{
+		memcpy (&header, view + pos, VISPATCH_HEADER_LEN);
+		header.mapname[sizeof (header.mapname) - 1] = 0;
 		header.filelen = LittleLong (header.filelen);
 		if (header.filelen <= 0)
 		{ /* bad entry -- don't trust the rest. */
-			fclose (f);
+			COM_FreeFileView (view);
 			return NULL;
 		}
+		pos += VISPATCH_HEADER_LEN;
 		if (!q_strcasecmp (header.mapname, shortname))
-			break;
-		pos += header.filelen + VISPATCH_HEADER_LEN;
-		fseek (f, pos, SEEK_SET);
-	}
-	if (r != VISPATCH_HEADER_LEN)
-	{
-		fclose (f);
-		Con_DPrintf ("%s not found in %s\n", shortname, visfilename);
-		return NULL;
+		{
+			*entry = view + pos;
+			*entry_end = view + q_min ((size_t)len, pos + header.filelen);
+			return view;
+		}
+		pos += header.filelen;
 	}
 
-	return f;
+	COM_FreeFileView (view);
+	Con_DPrintf ("%s not found in %s\n", shortname, visfilename);
+	return NULL;
 }
 
-static byte *Mod_LoadVisibilityExternal (FILE *f)
+/*
+=================
+Mod_ReadExternalLump
+
+Returns the length prefixed block at *in and advances past it, NULL if it doesn't fit
+=================
+*/
+static const byte *Mod_ReadExternalLump (const byte **in, const byte *end, int *filelen)
 {
-	int	  filelen;
-	byte *visdata;
+	const byte *data;
 
-	filelen = 0;
-	if (fread (&filelen, 1, 4, f) != 4)
+	if (end - *in < 4)
 		return NULL;
-	filelen = LittleLong (filelen);
-	if (filelen <= 0)
+	*filelen = ReadLongUnaligned (*in);
+	data = *in + 4;
+	if (*filelen <= 0 || end - data < *filelen)
 		return NULL;
+	*in = data + *filelen;
+	return data;
+}
+
+static qboolean Mod_LoadVisibilityExternal (qmodel_t *mod, const byte **in, const byte *end)
+{
+	int			filelen;
+	const byte *data = Mod_ReadExternalLump (in, end, &filelen);
+
+	if (!data)
+		return false;
 	Con_DPrintf ("...%d bytes visibility data\n", filelen);
-	visdata = (byte *)Mem_Alloc (filelen);
-	if (fread (visdata, filelen, 1, f) != 1)
-		return NULL;
-	return visdata;
+	// used in place, compressed rows are only ever read by Mod_DecompressVisRow
+	mod->visdata = (byte *)data;
+	return true;
 }
 
-static void Mod_LoadLeafsExternal (qmodel_t *mod, FILE *f)
+static void Mod_LoadLeafsExternal (qmodel_t *mod, const byte **in, const byte *end)
 {
-	int	  filelen;
-	void *in;
-
-	filelen = 0;
-	if (fread (&filelen, 1, 4, f) != 4)
-		Sys_Error ("Invalid leaf");
-	filelen = LittleLong (filelen);
-	if (filelen <= 0)
+	int			filelen;
+	const byte *data = Mod_ReadExternalLump (in, end, &filelen);
+
+	if (!data)
 		return;
 	Con_DPrintf ("...%d bytes leaf data\n", filelen);
-	in = Mem_Alloc (filelen);
-	if (fread (in, filelen, 1, f) != 1)
-		return;
-	Mod_ProcessLeafs_S (mod, (byte *)in, filelen);
+	Mod_ProcessLeafs_S (mod, (byte *)data, filelen);
 }
 
 /*
@@ -2966,20 +3366,62 @@ static void Mod_SetupSubmodels (qmodel_t *mod)
 	}
 }
 
+typedef struct
+{
+	qmodel_t *mod;
+	byte	 *mod_base;
+	int		  bsp2;
+	lump_t	  vertexes;
+	lump_t	  edges;
+	lump_t	  surfedges;
+	lump_t	  planes;
+} load_geometry_task_args_t;
+
+/*
+=================
+Mod_LoadGeometryTask
+
+The geometry lumps don't depend on anything else in the bsp and only
+Sys_Error on bad data, so they load on the workers while the main thread
+does the entities, textures and lighting.
+=================
+*/
+static void Mod_LoadGeometryTask (int i, load_geometry_task_args_t **pargs)
+{
+	load_geometry_task_args_t *args = *pargs;
+	switch (i)
+	{
+	case 0:
+		Mod_LoadVertexes (args->mod, args->mod_base, &args->vertexes);
+		break;
+	case 1:
+		Mod_LoadEdges (args->mod, args->mod_base, &args->edges, args->bsp2);
+		break;
+	case 2:
+		Mod_LoadSurfedges (args->mod, args->mod_base, &args->surfedges);
+		break;
+	case 3:
+		Mod_LoadPlanes (args->mod, args->mod_base, &args->planes);
+		break;
+	}
+}
+
 /*
 =================
 Mod_LoadBrushModel
 =================
 */
-static void Mod_LoadBrushModel (qmodel_t *mod, const char *loadname, void *buffer)
+static void Mod_LoadBrushModel (qmodel_t *mod, const char *loadname, const void *buffer)
 {
 	int		   i;
 	int		   bsp2;
-	dheader_t *header;
+	dheader_t  header_swapped;
+	dheader_t *header = &header_swapped;
 
 	mod->type = mod_brush;
 
-	header = (dheader_t *)buffer;
+	// buffer may be a read-only view into a mapped pak, swap a copy of the header
+	memcpy (header, buffer, sizeof (dheader_t));
 
 	mod->bspversion = LittleLong (header->version);
 
@@ -3008,45 +3450,89 @@ static void Mod_LoadBrushModel (qmodel_t *mod, const char *loadname, void *buffe
 	}
 
 	// swap all the lumps
-	byte *mod_base = (byte *)header;
+	// the lump loaders only ever read from mod_base
+	byte *mod_base = (byte *)buffer;
 
 	for (i = 0; i < (int)sizeof (dheader_t) / 4; i++)
 		((int *)header)[i] = LittleLong (((int *)header)[i]);
 
+	// look up the external .ent and .lit files on worker tasks while the first lumps load.
+	// they live on the heap so that a Host_Error can't leave the tasks writing into a dead frame
+	mod_external_file_t *ent_file = (mod_external_file_t *)Mem_Alloc (sizeof (mod_external_file_t));
+	mod_external_file_t *lit_file = (mod_external_file_t *)Mem_Alloc (sizeof (mod_external_file_t));
+	task_handle_t		 ent_task = INVALID_TASK_HANDLE;
+	task_handle_t		 lit_task = INVALID_TASK_HANDLE;
+	ent_file->mod = lit_file->mod = mod;
+	ent_file->mod_base = lit_file->mod_base = mod_base;
+	ent_file->lump = &header->lumps[LUMP_ENTITIES];
+	lit_file->lump = &header->lumps[LUMP_LIGHTING];
+	if (!Tasks_IsWorker ())
+	{
+		if (external_ents.value)
+			ent_task = Task_AllocateAssignFuncAndSubmit ((task_func_t)Mod_FindEntitiesExternalTask, &ent_file, sizeof (ent_file));
+		lit_task = Task_AllocateAssignFuncAndSubmit ((task_func_t)Mod_FindLightingExternalTask, &lit_file, sizeof (lit_file));
+	}
+	else
+	{
+		if (external_ents.value)
+			Mod_FindEntitiesExternalTask (&ent_file);
+		Mod_FindLightingExternalTask (&lit_file);
+	}
+
 	// load into heap
 
-	Mod_LoadVertexes (mod, mod_base, &header->lumps[LUMP_VERTEXES]);
-	Mod_LoadEdges (mod, mod_base, &header->lumps[LUMP_EDGES], bsp2);
-	Mod_LoadSurfedges (mod, mod_base, &header->lumps[LUMP_SURFEDGES]);
-	Mod_LoadEntities (mod, mod_base, &header->lumps[LUMP_ENTITIES]);
+	// same as the external files, heap args so a Host_Error on the main thread can't pull them away
+	load_geometry_task_args_t *geometry_args = (load_geometry_task_args_t *)Mem_Alloc (sizeof (load_geometry_task_args_t));
+	geometry_args->mod = mod;
+	geometry_args->mod_base = mod_base;
+	geometry_args->bsp2 = bsp2;
+	geometry_args->vertexes = header->lumps[LUMP_VERTEXES];
+	geometry_args->edges = header->lumps[LUMP_EDGES];
+	geometry_args->surfedges = header->lumps[LUMP_SURFEDGES];
+	geometry_args->planes = header->lumps[LUMP_PLANES];
+	task_handle_t geometry_task =
+		Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)Mod_LoadGeometryTask, 4, &geometry_args, sizeof (geometry_args));
+
+	if (ent_task != INVALID_TASK_HANDLE)
+		Task_Join (ent_task, TASK_TIMEOUT_INFINITE);
+	Mod_LoadEntities (mod, mod_base, &header->lumps[LUMP_ENTITIES], ent_file);
 	Mod_LoadTextures (mod, mod_base, &header->lumps[LUMP_TEXTURES]);
-	Mod_LoadLighting (mod, mod_base, &header->lumps[LUMP_LIGHTING]);
-	Mod_LoadPlanes (mod, mod_base, &header->lumps[LUMP_PLANES]);
+	if (lit_task != INVALID_TASK_HANDLE)
+		Task_Join (lit_task, TASK_TIMEOUT_INFINITE);
+	Mod_LoadLighting (mod, mod_base, &header->lumps[LUMP_LIGHTING], lit_file);
+	Mem_Free (ent_file);
+	Mem_Free (lit_file);
 	Mod_LoadTexinfo (mod, mod_base, &header->lumps[LUMP_TEXINFO]);
+	Task_Join (geometry_task, TASK_TIMEOUT_INFINITE);
+	Mem_Free (geometry_args);
 	Mod_LoadFaces (mod, mod_base, &header->lumps[LUMP_FACES], bsp2);
 	Mod_LoadMarksurfaces (mod, mod_base, &header->lumps[LUMP_MARKSURFACES], bsp2);
 
 	if (mod->bspversion == BSPVERSION && external_vis.value && sv.modelname[0] && !q_strcasecmp (loadname, sv.name))
 	{
-		FILE *fvis;
+		const byte *vis_entry, *vis_end;
 		Con_DPrintf ("trying to open external vis file\n");
-		fvis = Mod_FindVisibilityExternal (mod, loadname);
-		if (fvis)
+		// owned by the model right away so that a Host_Error in Mod_ProcessLeafs_S doesn't leak it
+		mod->visdata_view = Mod_FindVisibilityExternal (mod, loadname, &vis_entry, &vis_end);
+		if (mod->visdata_view)
 		{
 			mod->leafs = NULL;
 			mod->numleafs = 0;
 			Con_DPrintf ("found valid external .vis file for map\n");
-			mod->visdata = Mod_LoadVisibilityExternal (fvis);
-			if (mod->visdata)
+			if (Mod_LoadVisibilityExternal (mod, &vis_entry, vis_end))
 			{
-				Mod_LoadLeafsExternal (mod, fvis);
+				Mod_LoadLeafsExternal (mod, &vis_entry, vis_end);
 			}
-			fclose (fvis);
 			if (mod->visdata && mod->leafs && mod->numleafs)
 			{
 				goto visdone;
 			}
 			Con_DPrintf ("External VIS data failed, using standard vis.\n");
+			SAFE_FREE (mod->leafs);
+			mod->numleafs = 0;
+			mod->visdata = NULL;
+			COM_FreeFileView (mod->visdata_view);
+			mod->visdata_view = NULL;
 		}
 	}
 
@@ -3063,6 +3549,10 @@ visdone:
 
 	Mod_CheckWaterVis (mod);
 	Mod_SetupSubmodels (mod);
+
+	// after Mod_SetupSubmodels so that numleafs is the visleafs of the world and the
+	// submodels don't share the cache
+	Mod_CreatePVSCache (mod);
 }
 
 /*
@@ -3369,17 +3859,17 @@ static void Mod_LoadSkinTask (int i, load_skin_task_args_t *args)
 			enum srcformat fmt = SRC_INDEXED;
 
 			if (!data)
-				data = Image_LoadImage (va ("%s_%i", mod->name, i), (int *)&fwidth, (int *)&fheight, &fmt, mod->path_id);
+				data = Image_LoadTextureImage (va ("%s_%i", mod->name, i), (int *)&fwidth, (int *)&fheight, &fmt, mod->path_id);
 
 			if (!data)
-				data = Image_LoadImage (va ("progs/%s_%i", mod->name, i), (int *)&fwidth, (int *)&fheight, &fmt, mod->path_id);
+				data = Image_LoadTextureImage (va ("progs/%s_%i", mod->name, i), (int *)&fwidth, (int *)&fheight, &fmt, mod->path_id);
 
 			if (!data)
-				data = Image_LoadImage (va ("textures/%s_%i", mod->name, i), (int *)&fwidth, (int *)&fheight, &fmt, mod->path_id);
+				data = Image_LoadTextureImage (va ("textures/%s_%i", mod->name, i), (int *)&fwidth, (int *)&fheight, &fmt, mod->path_id);
 
 			if (data)
 			{
-				if (fmt == SRC_RGBA)
+				if ((fmt == SRC_RGBA) || (fmt == SRC_COMPRESSED))
 				{
 					pheader->gltextures[i][0] = TexMgr_LoadImage (
 						mod, va ("%s_%i", mod->name, i), fwidth, fheight, fmt, data, va ("%s_%i", mod->name, i), 0, TEXPREF_ALPHA | TEXPREF_MIPMAP);
@@ -3521,7 +4011,8 @@ void *Mod_LoadAllSkins (aliashdr_t *pheader, qmodel_t *mod, byte *mod_base, int
 		.mod_base = mod_base,
 		.ppskintypes = ppskintypes,
 	};
-	if (!Tasks_IsWorker () && (numskins > 1))
+	// workers keep running other tasks while they join, so this can fan out from a worker too
+	if (numskins > 1)
 	{
 		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)Mod_LoadSkinTask, numskins, &args, sizeof (args));
 		Task_Join (task, TASK_TIMEOUT_INFINITE);
@@ -95,6 +95,9 @@ typedef struct texture_s
 	struct gltexture_s *fullbright;				  // johnfitz -- fullbright mask texture
 	struct gltexture_s *warpimage;				  // johnfitz -- for water animation
 	atomic_uint32_t		update_warp;			  // johnfitz -- update warp this frame
+	double				warp_time;				  // cl.time warpimage was last rendered at
+	VkImage				warp_image;				  // warpimage->image that render went into
+	uint32_t			warp_generation;		  // warp_generation in gl_warp.c at that render
 	struct msurface_s  *texturechains[chain_num]; // for texture chains
 	uint32_t			chain_size[chain_num];	  // for texture chains
 	int					anim_total;				  // total tenths in sequence ( 0 = no)
@@ -200,11 +203,15 @@ typedef struct mleaf_s
 
 	// leaf specific
 	int		 nummarksurfaces;
+	int		 numturbmarksurfaces;
 	int		 combined_deps; // contains index into brush_deps_data[] with used warp and lightmap textures
 	byte	 ambient_sound_level[NUM_AMBIENTS];
 	byte	*compressed_vis;
 	int		*firstmarksurface;
+	int		*firstturbmarksurface; // SURF_DRAWTURB subset of firstmarksurface, only set up for indirect
 	efrag_t *efrags;
+	int		 firststatic; // baked from efrags into cl.static_leafents
+	int		 numstatics;
 } mleaf_t;
 
 // johnfitz -- for clipnodes>32k
@@ -215,15 +222,26 @@ typedef struct mclipnode_s
 } mclipnode_t;
 // johnfitz
 
+// clipnode with its plane stored inline, built by Mod_PackClipnodes for tracing
+typedef struct mpackedclipnode_s
+{
+	vec3_t normal;
+	float  dist;
+	int	   type;		// plane type, < 3 is axial
+	int	   children[2]; // negative numbers are contents
+	int	   pad;
+} mpackedclipnode_t;
+
 // !!! if this is changed, it must be changed in asm_i386.h too !!!
 typedef struct
 {
-	mclipnode_t *clipnodes; // johnfitz -- was dclipnode_t
-	mplane_t	*planes;
-	int			 firstclipnode;
-	int			 lastclipnode;
-	vec3_t		 clip_mins;
-	vec3_t		 clip_maxs;
+	mclipnode_t		  *clipnodes; // johnfitz -- was dclipnode_t
+	mplane_t		  *planes;
+	mpackedclipnode_t *packednodes; // same numbering as clipnodes
+	int				   firstclipnode;
+	int				   lastclipnode;
+	vec3_t			   clip_mins;
+	vec3_t			   clip_maxs;
 } hull_t;
 
 typedef float soa_aabb_t[2 * 3 * 8]; // 8 AABB's in SoA form
@@ -358,13 +376,13 @@ typedef struct aliashdr_s
 	struct gltexture_s *gltextures[MAX_SKINS][MAX_FRAMEGROUPS]; // johnfitz
 	struct gltexture_s *fbtextures[MAX_SKINS][MAX_FRAMEGROUPS]; // johnfitz
 	byte			   *texels[MAX_SKINS];						// only for player skins
-	VkBuffer			vertex_buffer;
-	glheapallocation_t *vertex_allocation;
-	VkDeviceAddress		vertex_buffer_address;
+	VkBuffer			vertex_buffer; // shared alias megabuffer, see gl_mesh.c
+	VkDeviceSize		vertex_offset;
+	VkDeviceAddress		vertex_buffer_address; // address of the data at vertex_offset
 	VkBuffer			index_buffer;
-	glheapallocation_t *index_allocation;
+	VkDeviceSize		index_offset;
 	VkDeviceAddress		index_buffer_address;
-	int					vbostofs; // offset in vbo of hdr->numverts_vbo meshst_t
+	int					vbostofs; // offset in vbo of hdr->numverts_vbo meshst_t, relative to vertex_offset
 	VkBuffer			joints_buffer;
 	glheapallocation_t *joints_allocation;
 	VkDeviceAddress		joints_buffer_address;
@@ -577,7 +595,8 @@ typedef struct qmodel_s
 	char		 name[MAX_QPATH];
 	unsigned int path_id;  // path id of the game directory
 						   // that this model came from
-	qboolean	 needload; // bmodels and sprites don't cache normally
+	qboolean	 needload; // bmodels don't cache normally
+	int			 last_used_map; // mod_map_sequence when this model was last looked up
 
 	modtype_t  type;
 	int		   numframes;
@@ -643,9 +662,11 @@ typedef struct qmodel_s
 
 	int	 nummarksurfaces;
 	int *marksurfaces;
+	int *turbmarksurfaces;
 
 	soa_aabb_t	*soa_leafbounds;
 	byte		*surfvis;
+	byte		*leafvis; // frustum culled leafs for the GPU marking (indirect_mark)
 	soa_plane_t *soa_surfplanes;
 
 	hull_t hulls[MAX_MAP_HULLS];
@@ -653,12 +674,16 @@ typedef struct qmodel_s
 	int			numtextures;
 	texture_t **textures;
 
-	byte *visdata;
-	byte *lightdata;
-	char *entities;
+	byte			   *visdata;
+	const byte		   *visdata_view; // external .vis file visdata points into, see COM_LoadFileView()
+	struct mpvscache_s *pvscache;	  // worldmodel only: decompressed PVS rows, see Mod_CachedLeafPVS()
+	byte			   *lightdata;
+	const byte		   *lightdata_view; // .lit file lightdata points into
+	char			   *entities;
 
-	qboolean viswarn;	 // for Mod_DecompressVis()
-	qboolean bogus_tree; // BSP node tree doesn't visit nummodelsurfaces surfaces
+	unsigned bsp_checksum; // Com_BlockChecksum of the BSP file, keys the world cache, 0 if unknown
+	qboolean viswarn;	   // for Mod_DecompressVis()
+	qboolean bogus_tree;   // BSP node tree doesn't visit nummodelsurfaces surfaces
 
 	int bspversion;
 	int contentstransparent; // spike -- added this so we can disable glitchy wateralpha where its not supported.
@@ -695,6 +720,7 @@ void	  Mod_RefreshSkins_f (cvar_t *var);
 mleaf_t *Mod_PointInLeaf (float *p, qmodel_t *model);
 byte	*Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model);
 byte	*Mod_NoVisPVS (qmodel_t *model);
+const byte *Mod_CachedLeafPVS (mleaf_t *leaf, qmodel_t *model);
 
 void Mod_SetExtraFlags (qmodel_t *mod);
 
@@ -39,14 +39,17 @@ Now, efrags are just a linked list for each leaf of the static
 entities that touch that leaf. The efrags are hunk-allocated so there is no
 fixed limit.
 
+The lists are only walked by R_BakeEfrags, which flattens them into one
+array of static entity indices so marking a leaf visible is a linear scan.
+
 This is inspired by MH's tutorial, and code from RMQEngine.
 http://forums.insideqc.com/viewtopic.php?t=1930
 
 ===============================================================================
 */
 
-static vec3_t	 r_emins, r_emaxs;
-static entity_t *r_addent;
+static vec3_t r_emins, r_emaxs;
+static int	  r_addstatic;
 
 #define EXTRA_EFRAGS 128
 
@@ -115,7 +118,7 @@ void R_SplitEntityOnNode (mnode_t *node)
 
 		// grab an efrag off the free list
 		ef = R_GetEfrag ();
-		ef->entity = r_addent;
+		ef->staticnum = r_addstatic;
 
 		// set the leaf links
 		ef->leafnext = leaf->efrags;
@@ -167,15 +170,16 @@ void R_CheckEfrags (void)
 R_AddEfrags
 ===========
 */
-void R_AddEfrags (entity_t *ent)
+void R_AddEfrags (int staticnum)
 {
+	entity_t *ent = cl.static_entities[staticnum];
 	qmodel_t *entmodel;
 	vec_t	  scalefactor;
 
 	if (!ent->model)
 		return;
 
-	r_addent = ent;
+	r_addstatic = staticnum;
 
 	r_pefragtopnode = NULL;
 
@@ -202,19 +206,78 @@ void R_AddEfrags (entity_t *ent)
 
 /*
 ================
-R_StoreEfrags -- johnfitz -- pointless switch statement removed.
+R_BakeEfrags
+
+Flattens the per-leaf efrag lists into cl.static_leafents. Statics can arrive
+at any time, so this runs again whenever the static count has changed.
+================
+*/
+void R_BakeEfrags (void)
+{
+	int		 i, total;
+	mleaf_t *leaf;
+	efrag_t *ef;
+
+	total = 0;
+	for (i = 1; i <= cl.worldmodel->numleafs; i++)
+	{
+		leaf = &cl.worldmodel->leafs[i];
+		leaf->firststatic = total;
+		leaf->numstatics = 0;
+		for (ef = leaf->efrags; ef; ef = ef->leafnext)
+			++leaf->numstatics;
+		total += leaf->numstatics;
+	}
+
+	cl.static_leafents = (int *)Mem_Realloc (cl.static_leafents, q_max (total, 1) * sizeof (int));
+	cl.static_visbits = (uint32_t *)Mem_Realloc (cl.static_visbits, q_max ((cl.num_statics + 31) / 32, 1) * sizeof (uint32_t));
+
+	for (i = 1; i <= cl.worldmodel->numleafs; i++)
+	{
+		leaf = &cl.worldmodel->leafs[i];
+		total = leaf->firststatic;
+		for (ef = leaf->efrags; ef; ef = ef->leafnext)
+			cl.static_leafents[total++] = ef->staticnum;
+	}
+
+	cl.num_baked_statics = cl.num_statics;
+}
+
+/*
+================
+R_MarkLeafStatics -- flags the statics touching a visible leaf, may run on any worker
+================
+*/
+void R_MarkLeafStatics (mleaf_t *leaf)
+{
+	const int		*staticnums = cl.static_leafents + leaf->firststatic;
+	atomic_uint32_t *visbits = (atomic_uint32_t *)cl.static_visbits;
+	int				 i;
+
+	for (i = 0; i < leaf->numstatics; i++)
+		Atomic_OrUInt32_Relaxed (&visbits[staticnums[i] / 32], 1u << (staticnums[i] % 32));
+}
+
+/*
+================
+R_StoreStaticEntities -- johnfitz -- pointless switch statement removed.
+
+Adds every static flagged by R_MarkLeafStatics to the visedicts once.
 ================
 */
-void R_StoreEfrags (efrag_t **ppefrag)
+void R_StoreStaticEntities (void)
 {
 	entity_t *pent;
-	efrag_t	 *pefrag;
+	int		  i;
 
-	while ((pefrag = *ppefrag) != NULL)
+	for (i = 0; i < cl.num_statics; i += 32)
 	{
-		pent = pefrag->entity;
-		if ((pent->visframe != r_framecount) && (cl_numvisedicts < cl_maxvisedicts))
+		uint32_t mask = cl.static_visbits[i / 32];
+		while (mask != 0 && cl_numvisedicts < cl_maxvisedicts)
 		{
+			const int j = FindFirstBitNonZero (mask);
+			mask &= ~(1u << j);
+			pent = cl.static_entities[i + j];
 #ifdef PSET_SCRIPT
 			if (pent->netstate.emiteffectnum > 0)
 			{
@@ -261,6 +324,5 @@ void R_StoreEfrags (efrag_t **ppefrag)
 				R_UpdateEntityMoveState (pent);
 			}
 		}
-		ppefrag = &pefrag->leafnext;
 	}
 }
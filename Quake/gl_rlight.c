@@ -25,6 +25,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 int r_dlightframecount;
 
+// bumped every R_AnimateLight, lightstyle_generations[j] is the generation style j last changed value at.
+// R_LightPoint only resamples the lightmap if one of the styles of the cached surface changed.
+static int lightstyle_generation;
+static int lightstyle_generations[MAX_LIGHTSTYLES];
+
 extern cvar_t r_flatlightstyles; // johnfitz
 extern cvar_t r_lerplightstyles;
 extern cvar_t r_gpulightmapupdate;
@@ -36,9 +41,11 @@ R_AnimateLight
 */
 void R_AnimateLight (void)
 {
-	int	   i, j, k, n;
+	int	   i, j, k, n, value;
 	double f;
 
+	++lightstyle_generation;
+
 	//
 	// light animations
 	// 'm' is normal light, 'a' is no light, 'z' is double bright
@@ -47,7 +54,12 @@ void R_AnimateLight (void)
 	{
 		if (!cl_lightstyle[j].length)
 		{
-			d_lightstylevalue[j] = 256; // should be 264 ?
+			value = 256; // should be 264 ?
+			if (d_lightstylevalue[j] != value)
+			{
+				d_lightstylevalue[j] = value;
+				lightstyle_generations[j] = lightstyle_generation;
+			}
 			continue;
 		}
 		// johnfitz -- r_flatlightstyles
@@ -62,8 +74,13 @@ void R_AnimateLight (void)
 		}
 		if (!r_gpulightmapupdate.value || !r_lerplightstyles.value || (r_lerplightstyles.value < 2 && abs (n - k) >= ('m' - 'a') / 2))
 			n = k;
-		d_lightstylevalue[j] = (k + (n - k) * (f - i)) * 22;
+		value = (k + (n - k) * (f - i)) * 22;
 		// johnfitz
+		if (d_lightstylevalue[j] != value)
+		{
+			d_lightstylevalue[j] = value;
+			lightstyle_generations[j] = lightstyle_generation;
+		}
 	}
 }
 
@@ -152,6 +169,113 @@ start:
 		R_MarkLights (light, num, node->children[1]);
 }
 
+/*
+=============================================================================
+
+DYNAMIC LIGHT GRID
+
+=============================================================================
+*/
+
+// Uniform grid over the world bounds holding the live dlights of the frame, one bit per
+// cl_dlights index. It is stored separably: every axis has its own row of cells with the
+// lights whose bounds overlap that slab. ANDing the three rows of a box tests all lights
+// against it at once. Built by R_BuildDlightGrid before anything is marked or drawn and
+// only read after that, from any worker.
+#define DLIGHT_GRID_CELLS 64
+COMPILE_TIME_ASSERT (dlight_grid, MAX_DLIGHTS <= 64);
+
+static uint64_t dlight_grid[3][DLIGHT_GRID_CELLS];
+static uint64_t dlight_grid_lights; // every light in the grid
+static vec3_t	dlight_grid_mins;
+static vec3_t	dlight_grid_scale; // cells per unit
+
+/*
+=============
+R_DlightGridCell
+
+Points outside the world end up in the border cells, which keeps the tests conservative
+=============
+*/
+static inline int R_DlightGridCell (int axis, float v)
+{
+	const float cell = (v - dlight_grid_mins[axis]) * dlight_grid_scale[axis];
+	if (!(cell > 0.0f))
+		return 0;
+	if (cell >= DLIGHT_GRID_CELLS - 1)
+		return DLIGHT_GRID_CELLS - 1;
+	return (int)cell;
+}
+
+/*
+=============
+R_BuildDlightGrid
+=============
+*/
+void R_BuildDlightGrid (void)
+{
+	int i, j, k;
+
+	memset (dlight_grid, 0, sizeof (dlight_grid));
+	dlight_grid_lights = 0;
+	if (!cl.worldmodel)
+		return;
+
+	for (i = 0; i < 3; i++)
+	{
+		const float extent = cl.worldmodel->maxs[i] - cl.worldmodel->mins[i];
+		dlight_grid_mins[i] = cl.worldmodel->mins[i];
+		dlight_grid_scale[i] = (extent > 0.0f) ? (DLIGHT_GRID_CELLS / extent) : 0.0f;
+	}
+
+	for (i = 0; i < MAX_DLIGHTS; i++)
+	{
+		const dlight_t *l = &cl_dlights[i];
+		if (l->die < cl.time || l->radius <= 0.0f)
+			continue;
+		const uint64_t bit = 1ull << i;
+		for (j = 0; j < 3; j++)
+		{
+			const int last = R_DlightGridCell (j, l->origin[j] + l->radius);
+			for (k = R_DlightGridCell (j, l->origin[j] - l->radius); k <= last; k++)
+				dlight_grid[j][k] |= bit;
+		}
+		dlight_grid_lights |= bit;
+	}
+}
+
+/*
+=============
+R_DlightsInBox
+
+Conservative: the lights returned may still miss the box, every other one does
+=============
+*/
+uint64_t R_DlightsInBox (const float mins[3], const float maxs[3])
+{
+	uint64_t lights = dlight_grid_lights;
+	for (int i = 0; i < 3 && lights; i++)
+	{
+		uint64_t axis_lights = 0;
+		const int last = R_DlightGridCell (i, maxs[i]);
+		for (int j = R_DlightGridCell (i, mins[i]); j <= last && (axis_lights & lights) != lights; j++)
+			axis_lights |= dlight_grid[i][j];
+		lights &= axis_lights;
+	}
+	return lights;
+}
+
+/*
+=============
+R_DlightsAtPoint
+=============
+*/
+uint64_t R_DlightsAtPoint (const vec3_t p)
+{
+	return dlight_grid_lights & dlight_grid[0][R_DlightGridCell (0, p[0])] & dlight_grid[1][R_DlightGridCell (1, p[1])] &
+		   dlight_grid[2][R_DlightGridCell (2, p[2])];
+}
+
 /*
 =============
 R_PushDlights
@@ -359,17 +483,33 @@ int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor)
 
 	(*lightcolor)[0] = (*lightcolor)[1] = (*lightcolor)[2] = 0;
 
-	if (cache->surfidx <= 0 // no cache or pitch black
+	if (cache->surfidx == 0 // no cache
 		|| cache->surfidx > cl.worldmodel->numsurfaces || fabsf (cache->pos[0] - p[0]) >= 1.f || fabsf (cache->pos[1] - p[1]) >= 1.f ||
 		fabsf (cache->pos[2] - p[2]) >= 1.f)
 	{
 		cache->surfidx = 0;
+		cache->generation = -1;
 		VectorCopy (p, cache->pos);
 		RecursiveLightPoint (cache, cl.worldmodel->nodes, start, start, end, &maxdist);
+		// remember misses too, a stationary entity in the dark doesn't need to trace again
+		if (cache->surfidx == 0)
+			cache->surfidx = -1;
 	}
 
-	if (cache && cache->surfidx > 0)
-		InterpolateLightmap (*lightcolor, cl.worldmodel->surfaces + cache->surfidx - 1, cache->ds, cache->dt);
+	if (cache->surfidx > 0)
+	{
+		msurface_t *surf = cl.worldmodel->surfaces + cache->surfidx - 1;
+		qboolean	resample = (cache->generation < 0);
+		for (int maps = 0; !resample && maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+			resample = (lightstyle_generations[surf->styles[maps]] > cache->generation);
+
+		if (resample)
+		{
+			InterpolateLightmap (cache->color, surf, cache->ds, cache->dt);
+			cache->generation = lightstyle_generation;
+		}
+		VectorCopy (cache->color, *lightcolor);
+	}
 
 	return (((*lightcolor)[0] + (*lightcolor)[1] + (*lightcolor)[2]) * (1.0f / 3.0f));
 }
@@ -35,6 +35,7 @@ mplane_t frustum[4];
 
 qboolean render_warp;
 int		 render_scale;
+float	 render_resolution = 1.0f; // r_dynamicscale, fraction of the screen the 3D view is rendered at
 
 // johnfitz -- rendering statistics
 atomic_uint32_t rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
@@ -90,6 +91,7 @@ cvar_t r_showtris = {"r_showtris", "0", CVAR_NONE};
 cvar_t r_showbboxes = {"r_showbboxes", "0", CVAR_NONE};
 cvar_t r_showbboxes_filter = {"r_showbboxes_filter", "", CVAR_NONE};
 cvar_t r_lerpmodels = {"r_lerpmodels", "1", CVAR_ARCHIVE};
+cvar_t r_alias_instancing = {"r_alias_instancing", "1", CVAR_NONE};
 cvar_t r_lerpmove = {"r_lerpmove", "1", CVAR_ARCHIVE};
 cvar_t r_lerpturn = {"r_lerpturn", "1", CVAR_ARCHIVE};
 cvar_t r_nolerp_list = {
@@ -116,10 +118,15 @@ cvar_t r_scale = {"r_scale", "1", CVAR_ARCHIVE};
 
 cvar_t r_gpulightmapupdate = {"r_gpulightmapupdate", "1", CVAR_NONE};
 cvar_t r_rtshadows = {"r_rtshadows", "1", CVAR_ARCHIVE};
+cvar_t r_rtshadows_blasbudget = {"r_rtshadows_blasbudget", "128", CVAR_ARCHIVE};
+cvar_t r_rtshadows_rate = {"r_rtshadows_rate", "1", CVAR_ARCHIVE};
 
 cvar_t r_tasks = {"r_tasks", "1", CVAR_NONE};
 
 cvar_t			r_indirect = {"r_indirect", "1", CVAR_NONE};
+cvar_t			r_gpumarksurfaces = {"r_gpumarksurfaces", "1", CVAR_NONE};
+extern cvar_t	r_occlusioncull;
+extern cvar_t	r_gpualiascull;
 extern qboolean indirect_ready;
 
 extern SDL_Mutex *draw_qcvm_mutex;
@@ -153,13 +160,12 @@ qboolean R_CullBox (vec3_t emins, vec3_t emaxs)
 }
 /*
 ===============
-R_CullModelForEntity -- johnfitz -- uses correct bounds based on rotation
+R_EntityBounds -- johnfitz -- uses correct bounds based on rotation
 ===============
 */
-qboolean R_CullModelForEntity (entity_t *e)
+void R_EntityBounds (entity_t *e, vec3_t mins, vec3_t maxs)
 {
-	vec3_t mins, maxs;
-	vec_t  scalefactor, *minbounds, *maxbounds;
+	vec_t scalefactor, *minbounds, *maxbounds;
 
 	if (e->angles[0] || e->angles[2]) // pitch or roll
 	{
@@ -188,8 +194,20 @@ qboolean R_CullModelForEntity (entity_t *e)
 		VectorAdd (e->origin, minbounds, mins);
 		VectorAdd (e->origin, maxbounds, maxs);
 	}
+}
 
-	return R_CullBox (mins, maxs);
+/*
+===============
+R_CullModelForEntity
+===============
+*/
+qboolean R_CullModelForEntity (entity_t *e)
+{
+	vec3_t mins, maxs;
+	R_EntityBounds (e, mins, maxs);
+	if (R_CullBox (mins, maxs))
+		return true;
+	return occlusion_cull && (e != &cl.viewent) && R_OccludedBox (mins, maxs, true);
 }
 
 /*
@@ -354,9 +372,26 @@ static void R_SetupMatrices ()
 R_SetupContext
 =============
 */
+/*
+=============
+R_SceneViewport
+
+The 3D view is scaled towards the top left corner by render_resolution
+=============
+*/
+static void R_SceneViewport (cb_context_t *cbx, float min_depth, float max_depth)
+{
+	const float s = render_resolution;
+	const float x = floorf (r_refdef.vrect.x * s);
+	const float y = floorf (r_refdef.vrect.y * s);
+	const float width = floorf ((r_refdef.vrect.x + r_refdef.vrect.width) * s) - x;
+	const float height = floorf ((r_refdef.vrect.y + r_refdef.vrect.height) * s) - y;
+	GL_Viewport (cbx, x, glheight - y - height, width, height, min_depth, max_depth);
+}
+
 static void R_SetupContext (cb_context_t *cbx)
 {
-	GL_Viewport (cbx, r_refdef.vrect.x, glheight - r_refdef.vrect.y - r_refdef.vrect.height, r_refdef.vrect.width, r_refdef.vrect.height, 0.0f, 1.0f);
+	R_SceneViewport (cbx, 0.0f, 1.0f);
 	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
 	R_PushConstants (cbx, VK_SHADER_STAGE_ALL_GRAPHICS, 0, 16 * sizeof (float), vulkan_globals.view_projection_matrix);
 }
@@ -369,6 +404,7 @@ R_SetupViewBeforeMark
 static void R_SetupViewBeforeMark (void *unused)
 {
 	// Need to do those early because we now update dynamic light maps during R_MarkSurfaces
+	R_BuildDlightGrid ();
 	if (!r_gpulightmapupdate.value)
 		R_PushDlights ();
 	R_AnimateLight ();
@@ -389,6 +425,7 @@ static void R_SetupViewBeforeMark (void *unused)
 	r_fovy = r_refdef.fov_y;
 	render_warp = false;
 	render_scale = (int)r_scale.value;
+	render_resolution = GL_DynamicScale ();
 
 	if (r_waterwarp.value)
 	{
@@ -410,6 +447,8 @@ static void R_SetupViewBeforeMark (void *unused)
 
 	R_SetFrustum (r_fovx, r_fovy); // johnfitz -- use r_fov* vars
 	R_SetupMatrices ();
+	if (occlusion_cull)
+		R_OcclusionSetupView ();
 
 	// johnfitz -- cheat-protect some draw modes
 	r_fullbright_cheatsafe = false;
@@ -477,6 +516,12 @@ void R_DrawEntitiesOnList (cb_context_t *cbx, int alphapass, int chain, qboolean
 	const int		 total = !alphapass ? cl_numvisedicts : alphapass == 1 ? cl_numvisedicts_alpha_overwater : cl_numvisedicts_alpha_underwater;
 	entity_t **const list = !alphapass ? cl_visedicts : alphapass == 1 ? cl_visedicts_alpha : cl_visedicts_alpha + cl_numvisedicts_alpha_overwater;
 
+	// alpha entities are sorted back to front, only batch the opaque ones
+	aliasqueue_t  local_queue;
+	aliasqueue_t *queue = (!alphapass && r_alias_instancing.value) ? &local_queue : NULL;
+	if (queue)
+		queue->num_entries = 0;
+
 	R_BeginDebugUtilsLabel (cbx, alphapass ? "Entities Alpha Pass" : "Entities");
 #ifdef USE_RMLUI
 	const qboolean suppress_viewmodel = UI_IsMainMenuStartupPending ();
@@ -521,7 +566,7 @@ void R_DrawEntitiesOnList (cb_context_t *cbx, int alphapass, int chain, qboolean
 		switch (currententity->model->type)
 		{
 		case mod_alias:
-			R_DrawAliasModel (cbx, currententity, &aliaspolys);
+			R_DrawAliasModel (cbx, currententity, &aliaspolys, queue);
 			++aliaspasses;
 			break;
 		case mod_brush:
@@ -535,6 +580,8 @@ void R_DrawEntitiesOnList (cb_context_t *cbx, int alphapass, int chain, qboolean
 			break;
 		}
 	}
+	if (queue)
+		R_FlushAliasInstances (cbx, queue);
 	R_EndDebugUtilsLabel (cbx);
 
 	Atomic_AddUInt32 (&rs_brushpolys, brushpolys);
@@ -574,16 +621,16 @@ void R_DrawViewModel (cb_context_t *cbx)
 	R_BeginDebugUtilsLabel (cbx, "View Model");
 
 	// hack the depth range to prevent view model from poking into walls
-	GL_Viewport (cbx, r_refdef.vrect.x, glheight - r_refdef.vrect.y - r_refdef.vrect.height, r_refdef.vrect.width, r_refdef.vrect.height, 0.7f, 1.0f);
+	R_SceneViewport (cbx, 0.7f, 1.0f);
 
 	int			aliaspolys = 0;
 	aliashdr_t *paliashdr = (aliashdr_t *)Mod_Extradata (currententity->model);
 	R_UpdateEntityAnimState (currententity, paliashdr);
-	R_DrawAliasModel (cbx, currententity, &aliaspolys);
+	R_DrawAliasModel (cbx, currententity, &aliaspolys, NULL);
 	Atomic_AddUInt32 (&rs_aliaspolys, aliaspolys);
 	Atomic_IncrementUInt32 (&rs_aliaspasses);
 
-	GL_Viewport (cbx, r_refdef.vrect.x, glheight - r_refdef.vrect.y - r_refdef.vrect.height, r_refdef.vrect.width, r_refdef.vrect.height, 0.0f, 1.0f);
+	R_SceneViewport (cbx, 0.0f, 1.0f);
 
 	R_EndDebugUtilsLabel (cbx);
 }
@@ -694,7 +741,7 @@ static void R_ShowBoundingBoxes (cb_context_t *cbx)
 	edict_t		   *ed;
 	int				i, pass;
 
-	if (!r_showbboxes.value || cl.maxclients > 1 || !r_drawentities.value || !sv.active)
+	if (!r_showbboxes.value || cl.maxclients > 1 || !r_drawentities.value || !sv.active || Host_ServerFrameRunning ())
 		return;
 
 	R_BeginDebugUtilsLabel (cbx, "show bboxes");
@@ -885,16 +932,9 @@ R_SortAlphaEntitiesTask
 */
 static void R_SortAlphaEntitiesTask (void *unused)
 {
-	typedef struct
-	{
-		int		 visedict;
-		unsigned sortkey;
-	} transp_sort;
+	static sortbuffer_t sort_buffer;
 	cl_numvisedicts_alpha_overwater = cl_numvisedicts_alpha_underwater = 0;
-	TEMP_ALLOC_COND (transp_sort, edicts, cl_numvisedicts * 2, r_alphasort.value);
-	int sort_bins[3][128];
-	if (r_alphasort.value)
-		memset (sort_bins, 0, sizeof (sort_bins));
+	sortkey_t *edicts = r_alphasort.value ? R_SortBufferReserve (&sort_buffer, cl_numvisedicts) : NULL;
 	for (int i = 0; i < cl_numvisedicts; ++i)
 	{
 		entity_t *currententity = cl_visedicts[i];
@@ -936,14 +976,9 @@ static void R_SortAlphaEntitiesTask (void *unused)
 			memcpy (currententity->contentscache_origin, center, sizeof (vec3_t));
 		}
 		const qboolean underwater = contents == CONTENTS_WATER || contents == CONTENTS_SLIME || contents == CONTENTS_LAVA;
-		const unsigned dist = sqrtf (dist_squared) * 2.0f;
-		const unsigned sortkey = !underwater << 20 | q_min (dist, (1 << 20) - 1);
-		sort_bins[2][(sortkey >> 14)] += 1;
-		sort_bins[1][(sortkey >> 7) % 128] += 1;
-		sort_bins[0][(sortkey >> 0) % 128] += 1;
-		transp_sort *const edict = &edicts[cl_numvisedicts_alpha_overwater + cl_numvisedicts_alpha_underwater];
-		edict->visedict = i;
-		edict->sortkey = sortkey;
+		sortkey_t	  *const edict = &edicts[cl_numvisedicts_alpha_overwater + cl_numvisedicts_alpha_underwater];
+		edict->key = (underwater ? 0u : 0x80000000u) | R_DepthSortKey (dist_squared);
+		edict->index = i;
 		if (underwater)
 			++cl_numvisedicts_alpha_underwater;
 		else
@@ -953,25 +988,11 @@ static void R_SortAlphaEntitiesTask (void *unused)
 	if (!r_alphasort.value)
 		return;
 
-	const int highest = cl_numvisedicts_alpha_underwater + cl_numvisedicts_alpha_overwater - 1;
-	for (int pass = 0; pass < 3; ++pass)
-	{
-		transp_sort *from = pass % 2 ? edicts + cl_numvisedicts : edicts;
-		transp_sort *to = pass % 2 ? edicts : edicts + cl_numvisedicts;
-		for (int i = 1; i < 128; ++i)
-			sort_bins[pass][i] += sort_bins[pass][i - 1];
-		for (int i = highest; i >= 0; --i)
-		{
-			int key = (from[i].sortkey >> 7 * pass) % 128;
-			sort_bins[pass][key] -= 1;
-			if (pass < 2)
-				to[sort_bins[pass][key]] = from[i];
-			else
-				cl_visedicts_alpha[highest - sort_bins[pass][key]] = cl_visedicts[from[i].visedict];
-		}
-	}
-
-	TEMP_FREE (edicts);
+	// over water entities first, then far to near
+	const int num_edicts = cl_numvisedicts_alpha_underwater + cl_numvisedicts_alpha_overwater;
+	R_RadixSort (edicts, num_edicts);
+	for (int i = 0; i < num_edicts; ++i)
+		cl_visedicts_alpha[num_edicts - 1 - i] = cl_visedicts[edicts[i].index];
 }
 
 /*
@@ -1048,7 +1069,12 @@ static void R_PrintStats (double time1)
 					 ? (double)Atomic_LoadUInt32 (&rs_dynamiclightmaps) / (LMBLOCK_HEIGHT / LM_CULL_BLOCK_H * LMBLOCK_WIDTH / LM_CULL_BLOCK_W)
 					 : Atomic_LoadUInt32 (&rs_dynamiclightmaps);
 	if (r_speeds.value)
+	{
 		time2 = Sys_DoubleTime ();
+		frame_stats_t *stats = FrameStats_Current ();
+		stats->brush_polys = Atomic_LoadUInt32 (&rs_brushpolys);
+		stats->alias_polys = Atomic_LoadUInt32 (&rs_aliaspolys);
+	}
 	if (r_pos.value)
 		Con_Printf (
 			"x %i y %i z %i (pitch %i yaw %i roll %i)\n", (int)cl.entities[cl.viewentity].origin[0], (int)cl.entities[cl.viewentity].origin[1],
@@ -1073,6 +1099,9 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 	double			time1;
 
 	indirect = r_indirect.value && indirect_ready && r_gpulightmapupdate.value && !r_speeds.value;
+	indirect_mark = indirect && r_gpumarksurfaces.value;
+	occlusion_cull = r_occlusioncull.value && vulkan_globals.sampled_depth;
+	alias_gpu_cull = r_gpualiascull.value && r_gpulightmapupdate.value && !r_speeds.value && R_InitAliasCull ();
 
 	if (!cl.worldmodel)
 		Sys_Error ("R_RenderView: NULL worldmodel");
@@ -1104,6 +1133,8 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 	{
 		task_handle_t before_mark = Task_AllocateAndAssignFunc (R_SetupViewBeforeMark, NULL, 0);
 		Task_AddDependency (setup_frame_task, before_mark);
+		if (occlusion_cull)
+			Task_AddDependency (begin_rendering_task, before_mark); // occlusion grid is read back after the frame fence
 
 		task_handle_t store_efrags = INVALID_TASK_HANDLE;
 		task_handle_t cull_surfaces = INVALID_TASK_HANDLE;
@@ -1151,8 +1182,14 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 		Task_AddDependency (sort_transparents, draw_alpha_entities_task);
 		Task_AddDependency (begin_rendering_task, draw_alpha_entities_task);
 
+		// particle update runs alongside the world, only the particle draw waits for it
+		task_handle_t prepare_particles_task = Task_AllocateAndAssignFunc (R_PrepareParticles, NULL, 0);
+		task_handle_t update_particles_task = Task_AllocateAndAssignIndexedFunc (R_UpdateParticles, NUM_PARTICLE_UPDATE_TASKS, NULL, 0);
+		Task_AddDependency (prepare_particles_task, update_particles_task);
+
 		task_handle_t draw_particles_task = Task_AllocateAndAssignFunc (R_DrawParticlesTask, NULL, 0);
 		Task_AddDependency (before_mark, draw_particles_task);
+		Task_AddDependency (update_particles_task, draw_particles_task);
 		Task_AddDependency (begin_rendering_task, draw_particles_task);
 		Task_AddDependency (draw_particles_task, draw_done_task);
 
@@ -1165,6 +1202,7 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 		Task_AddDependency (cull_surfaces, update_lightmaps_task);
 		Task_AddDependency (draw_entities_task, update_lightmaps_task);
 		Task_AddDependency (draw_alpha_entities_task, update_lightmaps_task);
+		Task_AddDependency (build_tlas_task, update_lightmaps_task); // reduced rate shadows check if the TLAS changed
 		Task_AddDependency (update_lightmaps_task, draw_done_task);
 
 		if (r_showtris.value)
@@ -1174,15 +1212,16 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 
 			Task_AddDependency (draw_entities_task, draw_view_model_task);		 // not dependent, but mutually exclusive
 			Task_AddDependency (draw_alpha_entities_task, draw_view_model_task); // not dependent, but mutually exclusive
+			Task_AddDependency (update_particles_task, draw_view_model_task);	 // particle tris read the pool
 
 #ifdef PSET_SCRIPT
 			Task_AddDependency (draw_particles_task, draw_view_model_task); // only scriptable particles are dependent
 #endif
 		}
 
-		task_handle_t tasks[] = {before_mark,		  store_efrags,	   update_warp_textures, draw_world_task,	 sort_transparents,
-								 draw_sky_task,		  draw_water_task, draw_view_model_task, draw_entities_task, draw_alpha_entities_task,
-								 draw_particles_task, build_tlas_task, update_lightmaps_task};
+		task_handle_t tasks[] = {before_mark,			 store_efrags,			update_warp_textures, draw_world_task,	  sort_transparents,
+								 draw_sky_task,			 draw_water_task,		draw_view_model_task, draw_entities_task, draw_alpha_entities_task,
+								 prepare_particles_task, update_particles_task,	draw_particles_task,  build_tlas_task,	  update_lightmaps_task};
 		Tasks_Submit ((sizeof (tasks) / sizeof (task_handle_t)), tasks);
 		if (cull_surfaces != chain_surfaces)
 		{
@@ -1201,6 +1240,9 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 		R_DrawEntitiesTask (0, NULL);
 		R_SortAlphaEntitiesTask (NULL);
 		R_DrawAlphaEntitiesTask (0, NULL);
+		R_PrepareParticles (NULL);
+		for (int i = 0; i < NUM_PARTICLE_UPDATE_TASKS; ++i)
+			R_UpdateParticles (i, NULL);
 		R_DrawParticlesTask (NULL);
 		R_DrawViewModelTask (NULL);
 		if (r_gpulightmapupdate.value)
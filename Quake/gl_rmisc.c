@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "gl_heap.h"
+#include "miniz.h"
 #include <float.h>
 
 cvar_t r_lodbias = {"r_lodbias", "1", CVAR_ARCHIVE};
@@ -40,12 +41,14 @@ extern cvar_t gl_farclip;
 extern cvar_t r_waterquality;
 extern cvar_t r_waterwarp;
 extern cvar_t r_waterwarpcompute;
+extern cvar_t r_waterwarprate;
 extern cvar_t r_oldskyleaf;
 extern cvar_t r_drawworld;
 extern cvar_t r_showtris;
 extern cvar_t r_showbboxes;
 extern cvar_t r_showbboxes_filter;
 extern cvar_t r_lerpmodels;
+extern cvar_t r_alias_instancing;
 extern cvar_t r_lerpmove;
 extern cvar_t r_lerpturn;
 extern cvar_t r_nolerp_list;
@@ -55,7 +58,15 @@ extern cvar_t r_alphasort;
 
 extern cvar_t r_gpulightmapupdate;
 extern cvar_t r_rtshadows;
+extern cvar_t r_rtshadows_blasbudget;
+extern cvar_t r_rtshadows_rate;
 extern cvar_t r_indirect;
+extern cvar_t r_gpumarksurfaces;
+extern cvar_t r_gpualiascull;
+extern cvar_t r_occlusioncull;
+extern cvar_t r_occlusionstats;
+extern cvar_t r_worldcache;
+extern cvar_t r_lightmapcompression;
 extern cvar_t r_tasks;
 extern cvar_t r_parallelmark;
 extern cvar_t r_usesops;
@@ -74,6 +85,7 @@ atomic_uint32_t num_vulkan_bmodel_allocations;
 atomic_uint32_t num_vulkan_mesh_allocations;
 atomic_uint32_t num_vulkan_misc_allocations;
 atomic_uint32_t num_vulkan_dynbuf_allocations;
+atomic_uint32_t num_vulkan_ui_allocations;
 atomic_uint32_t num_vulkan_combined_image_samplers;
 atomic_uint32_t num_vulkan_ubos_dynamic;
 atomic_uint32_t num_vulkan_ubos;
@@ -126,6 +138,8 @@ Dynamic vertex/index & uniform buffer
 #define INITIAL_DYNAMIC_INDEX_BUFFER_SIZE_KB   1024
 #define INITIAL_DYNAMIC_UNIFORM_BUFFER_SIZE_KB 256
 #define NUM_DYNAMIC_BUFFERS					   2
+#define DYNAMIC_BUFFER_GROW_PERCENT			   75 // grow at the frame boundary once a frame used more than this
+#define MAX_DYNAMIC_BUFFER_PROFILE_SIZE_MB	   256
 #define GARBAGE_FRAME_COUNT					   3
 #define MAX_UNIFORM_ALLOC					   2048
 
@@ -152,6 +166,51 @@ static dynbuffer_t	   dyn_uniform_buffers[NUM_DYNAMIC_BUFFERS];
 static dynbuffer_t	   dyn_storage_buffers[NUM_DYNAMIC_BUFFERS];
 static int			   current_dyn_buffer_index = 0;
 static VkDescriptorSet ubo_descriptor_sets[2];
+static uint32_t		   dyn_storage_profile_size; // storage buffers are created lazily, at least this large
+
+static void R_InitDynamicVertexBuffers (void);
+static void R_InitDynamicIndexBuffers (void);
+static void R_InitDynamicUniformBuffers (void);
+static void R_InitDynamicStorageBuffers (void);
+static void R_AddDynamicBufferGarbage (vulkan_memory_t memory, dynbuffer_t *buffers, VkDescriptorSet *descriptor_sets);
+
+typedef enum
+{
+	DYNBUF_VERTEX,
+	DYNBUF_INDEX,
+	DYNBUF_UNIFORM,
+	DYNBUF_STORAGE,
+	NUM_DYNBUF_TYPES,
+} dynbuf_type_t;
+
+typedef struct
+{
+	const char		*name;
+	dynbuffer_t		*buffers;
+	vulkan_memory_t *memory;
+	uint32_t		*current_size;
+	VkDescriptorSet *descriptor_sets;
+	void (*init_func) (void);
+	uint32_t last_frame_used;
+	uint32_t high_water; // largest last_frame_used this session
+} dynbuf_info_t;
+
+static dynbuf_info_t dynbuf_infos[NUM_DYNBUF_TYPES] = {
+	{"vertex", dyn_vertex_buffers, &dyn_vertex_buffer_memory, &current_dyn_vertex_buffer_size, NULL, &R_InitDynamicVertexBuffers},
+	{"index", dyn_index_buffers, &dyn_index_buffer_memory, &current_dyn_index_buffer_size, NULL, &R_InitDynamicIndexBuffers},
+	{"uniform", dyn_uniform_buffers, &dyn_uniform_buffer_memory, &current_dyn_uniform_buffer_size, ubo_descriptor_sets, &R_InitDynamicUniformBuffers},
+	{"storage", dyn_storage_buffers, &dyn_storage_buffer_memory, &current_dyn_storage_buffer_size, NULL, &R_InitDynamicStorageBuffers},
+};
+
+// The profile file holds the sizes the last session would have needed, so the
+// rings start out large enough instead of growing during the first maps
+typedef struct dynbuf_profile_s
+{
+	char	 magic[4];
+	uint32_t sizes[NUM_DYNBUF_TYPES];
+} dynbuf_profile_t;
+
+#define DYNBUF_PROFILE_MAGIC "VKDB"
 
 static int				current_garbage_index = 0;
 static int				num_device_memory_garbage[GARBAGE_FRAME_COUNT];
@@ -393,6 +452,17 @@ static void R_SetRTShadows_f (cvar_t *var)
 	GL_UpdateLightmapDescriptorSets ();
 }
 
+/*
+====================
+R_SetRTShadowsRate_f
+====================
+*/
+static void R_SetRTShadowsRate_f (cvar_t *var)
+{
+	if (cl.worldmodel)
+		GL_UpdateLightmapDescriptorSets ();
+}
+
 /*
 ====================
 GL_WaterAlphaForSurfface -- ericw
@@ -410,6 +480,70 @@ float GL_WaterAlphaForSurface (msurface_t *fa)
 		return map_wateralpha;
 }
 
+/*
+====================
+R_SortBufferReserve
+
+Grows the buffer to hold count keys and the scratch space R_RadixSort needs. The
+memory is kept for the next frames.
+====================
+*/
+sortkey_t *R_SortBufferReserve (sortbuffer_t *buffer, int count)
+{
+	if (count > buffer->capacity)
+	{
+		buffer->capacity = q_max (count, buffer->capacity * 2);
+		buffer->keys = (sortkey_t *)Mem_Realloc (buffer->keys, 2 * buffer->capacity * sizeof (sortkey_t));
+	}
+	return buffer->keys;
+}
+
+/*
+====================
+R_RadixSort
+
+Stable sort by ascending key, 8 bits per pass. A pass is skipped if all keys have the
+same digit, which is common for the high bits. keys needs room for 2 * count.
+====================
+*/
+void R_RadixSort (sortkey_t *keys, int count)
+{
+	if (count < 2)
+		return;
+
+	int bins[4][256];
+	memset (bins, 0, sizeof (bins));
+	for (int i = 0; i < count; ++i)
+		for (int pass = 0; pass < 4; ++pass)
+			bins[pass][(keys[i].key >> (pass * 8)) & 0xFF] += 1;
+
+	sortkey_t *from = keys;
+	sortkey_t *to = keys + count;
+	for (int pass = 0; pass < 4; ++pass)
+	{
+		const int shift = pass * 8;
+		if (bins[pass][(from[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		int offset = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			const int num = bins[pass][i];
+			bins[pass][i] = offset;
+			offset += num;
+		}
+		for (int i = 0; i < count; ++i)
+			to[bins[pass][(from[i].key >> shift) & 0xFF]++] = from[i];
+
+		sortkey_t *temp = from;
+		from = to;
+		to = temp;
+	}
+
+	if (from != keys)
+		memcpy (keys, from, count * sizeof (sortkey_t));
+}
+
 /*
 ===============
 R_CreateStagingBuffers
@@ -714,6 +848,16 @@ R_StagingUploadBuffer
 ===============
 */
 void R_StagingUploadBuffer (const VkBuffer buffer, const size_t size, const byte *data)
+{
+	R_StagingUploadBufferAt (buffer, 0, size, data);
+}
+
+/*
+===============
+R_StagingUploadBufferAt
+===============
+*/
+void R_StagingUploadBufferAt (const VkBuffer buffer, const VkDeviceSize offset, const size_t size, const byte *data)
 {
 	size_t remaining_size = size;
 	size_t copy_offset = 0;
@@ -728,7 +872,7 @@ void R_StagingUploadBuffer (const VkBuffer buffer, const size_t size, const byte
 
 		VkBufferCopy region;
 		region.srcOffset = staging_offset;
-		region.dstOffset = copy_offset;
+		region.dstOffset = offset + copy_offset;
 		region.size = size_to_copy;
 		vkCmdCopyBuffer (command_buffer, staging_buffer, buffer, 1, &region);
 
@@ -899,6 +1043,7 @@ static void R_InitDynamicStorageBuffers (void)
 		get_device_address = true;
 	}
 
+	current_dyn_storage_buffer_size = q_max (current_dyn_storage_buffer_size, dyn_storage_profile_size);
 	R_InitDynamicBuffers (dyn_storage_buffers, &dyn_storage_buffer_memory, &current_dyn_storage_buffer_size, usage_flags, get_device_address, "storage buffer");
 }
 
@@ -974,6 +1119,24 @@ R_SwapDynamicBuffers
 */
 void R_SwapDynamicBuffers (void)
 {
+	// Record what the frame that just finished used and grow before the next one runs out,
+	// growing inside R_DynBufferAllocate stalls the allocating thread mid-frame
+	frame_stats_t *stats = FrameStats_Current ();
+	for (int i = 0; i < NUM_DYNBUF_TYPES; ++i)
+	{
+		dynbuf_info_t *info = &dynbuf_infos[i];
+		info->last_frame_used = info->buffers[current_dyn_buffer_index].current_offset;
+		info->high_water = q_max (info->high_water, info->last_frame_used);
+		stats->dynbuf_bytes[i] = info->last_frame_used;
+
+		if ((info->memory->handle != VK_NULL_HANDLE) && ((uint64_t)info->last_frame_used * 100 > (uint64_t)*info->current_size * DYNAMIC_BUFFER_GROW_PERCENT))
+		{
+			R_AddDynamicBufferGarbage (*info->memory, info->buffers, info->descriptor_sets);
+			*info->current_size *= 2;
+			info->init_func ();
+		}
+	}
+
 	current_dyn_buffer_index = (current_dyn_buffer_index + 1) % NUM_DYNAMIC_BUFFERS;
 	dyn_vertex_buffers[current_dyn_buffer_index].current_offset = 0;
 	dyn_index_buffers[current_dyn_buffer_index].current_offset = 0;
@@ -1197,6 +1360,69 @@ byte *R_UniformAllocate (int size, VkBuffer *buffer, uint32_t *buffer_offset, Vk
 	return data;
 }
 
+/*
+===============
+R_DynamicBufferProfilePath
+===============
+*/
+static void R_DynamicBufferProfilePath (char *path, size_t path_size)
+{
+	q_snprintf (path, path_size, "%s/dynbuffers.cache", host_parms->userdir);
+}
+
+/*
+===============
+R_LoadDynamicBufferProfile
+===============
+*/
+static void R_LoadDynamicBufferProfile (void)
+{
+	char path[MAX_OSPATH];
+	R_DynamicBufferProfilePath (path, sizeof (path));
+
+	dynbuf_profile_t profile;
+	FILE			*f = fopen (path, "rb");
+	qboolean		 valid = f && (fread (&profile, sizeof (profile), 1, f) == 1) && !memcmp (profile.magic, DYNBUF_PROFILE_MAGIC, sizeof (profile.magic));
+	if (f)
+		fclose (f);
+	if (!valid)
+		return;
+
+	for (int i = 0; i < NUM_DYNBUF_TYPES; ++i)
+	{
+		const uint32_t size = Q_nextPow2 (q_min (profile.sizes[i], MAX_DYNAMIC_BUFFER_PROFILE_SIZE_MB * 1024 * 1024));
+		if (i == DYNBUF_STORAGE)
+			dyn_storage_profile_size = size;
+		else
+			*dynbuf_infos[i].current_size = q_max (*dynbuf_infos[i].current_size, size);
+	}
+	Con_DPrintf ("Loaded dynamic buffer profile %s\n", path);
+}
+
+/*
+===============
+R_SaveDynamicBufferProfile
+
+Stores sizes that would have held the session's largest frames below the
+growth threshold
+===============
+*/
+void R_SaveDynamicBufferProfile (void)
+{
+	dynbuf_profile_t profile;
+	memcpy (profile.magic, DYNBUF_PROFILE_MAGIC, sizeof (profile.magic));
+	for (int i = 0; i < NUM_DYNBUF_TYPES; ++i)
+		profile.sizes[i] = (uint32_t)q_min ((uint64_t)dynbuf_infos[i].high_water * 100 / DYNAMIC_BUFFER_GROW_PERCENT, UINT32_MAX);
+
+	char path[MAX_OSPATH];
+	R_DynamicBufferProfilePath (path, sizeof (path));
+	FILE *f = fopen (path, "wb");
+	if (!f)
+		return;
+	fwrite (&profile, sizeof (profile), 1, f);
+	fclose (f);
+}
+
 /*
 ===============
 R_InitGPUBuffers
@@ -1204,10 +1430,12 @@ R_InitGPUBuffers
 */
 void R_InitGPUBuffers (void)
 {
+	R_LoadDynamicBufferProfile ();
 	R_InitDynamicVertexBuffers ();
 	R_InitDynamicIndexBuffers ();
 	R_InitDynamicUniformBuffers ();
 	R_InitFanIndexBuffer ();
+	R_InitOcclusion ();
 
 	// Initialize scratch buffer for animated AS building
 	if (vulkan_globals.ray_query)
@@ -1374,7 +1602,7 @@ void R_CreateDescriptorSetLayouts ()
 
 	{
 		int num_descriptors = 0;
-		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, lightmap_compute_layout_bindings, 9);
+		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, lightmap_compute_layout_bindings, 10);
 		lightmap_compute_layout_bindings[0].binding = num_descriptors++;
 		lightmap_compute_layout_bindings[0].descriptorCount = 1;
 		lightmap_compute_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
@@ -1428,11 +1656,15 @@ void R_CreateDescriptorSetLayouts ()
 			lightmap_compute_layout_bindings[8].descriptorCount = 1;
 			lightmap_compute_layout_bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
 			lightmap_compute_layout_bindings[8].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			lightmap_compute_layout_bindings[9].binding = num_descriptors++;
+			lightmap_compute_layout_bindings[9].descriptorCount = 1;
+			lightmap_compute_layout_bindings[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			lightmap_compute_layout_bindings[9].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 			descriptor_set_layout_create_info.bindingCount = num_descriptors;
 
 			vulkan_globals.lightmap_compute_rt_set_layout.num_storage_images = 1;
 			vulkan_globals.lightmap_compute_rt_set_layout.num_sampled_images = 1 + MAXLIGHTMAPS * 3 / 4;
-			vulkan_globals.lightmap_compute_rt_set_layout.num_storage_buffers = 3;
+			vulkan_globals.lightmap_compute_rt_set_layout.num_storage_buffers = 4;
 			vulkan_globals.lightmap_compute_rt_set_layout.num_ubos_dynamic = 2;
 			vulkan_globals.lightmap_compute_rt_set_layout.num_acceleration_structures = 1;
 
@@ -1445,7 +1677,7 @@ void R_CreateDescriptorSetLayouts ()
 	}
 
 	{
-		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, indirect_compute_layout_bindings, 4);
+		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, indirect_compute_layout_bindings, 9);
 		indirect_compute_layout_bindings[0].binding = 0;
 		indirect_compute_layout_bindings[0].descriptorCount = 1;
 		indirect_compute_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -1462,12 +1694,32 @@ void R_CreateDescriptorSetLayouts ()
 		indirect_compute_layout_bindings[3].descriptorCount = 1;
 		indirect_compute_layout_bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		indirect_compute_layout_bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		indirect_compute_layout_bindings[4].binding = 4;
+		indirect_compute_layout_bindings[4].descriptorCount = 1;
+		indirect_compute_layout_bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		indirect_compute_layout_bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		indirect_compute_layout_bindings[5].binding = 5;
+		indirect_compute_layout_bindings[5].descriptorCount = 1;
+		indirect_compute_layout_bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		indirect_compute_layout_bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		indirect_compute_layout_bindings[6].binding = 6;
+		indirect_compute_layout_bindings[6].descriptorCount = 1;
+		indirect_compute_layout_bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		indirect_compute_layout_bindings[6].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		indirect_compute_layout_bindings[7].binding = 7;
+		indirect_compute_layout_bindings[7].descriptorCount = 1;
+		indirect_compute_layout_bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		indirect_compute_layout_bindings[7].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		indirect_compute_layout_bindings[8].binding = 8;
+		indirect_compute_layout_bindings[8].descriptorCount = 1;
+		indirect_compute_layout_bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		indirect_compute_layout_bindings[8].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 		descriptor_set_layout_create_info.bindingCount = countof (indirect_compute_layout_bindings);
 		descriptor_set_layout_create_info.pBindings = indirect_compute_layout_bindings;
 
 		memset (&vulkan_globals.indirect_compute_set_layout, 0, sizeof (vulkan_globals.indirect_compute_set_layout));
-		vulkan_globals.indirect_compute_set_layout.num_storage_buffers = 4;
+		vulkan_globals.indirect_compute_set_layout.num_storage_buffers = 9;
 
 		err = vkCreateDescriptorSetLayout (vulkan_globals.device, &descriptor_set_layout_create_info, NULL, &vulkan_globals.indirect_compute_set_layout.handle);
 		if (err != VK_SUCCESS)
@@ -1475,6 +1727,100 @@ void R_CreateDescriptorSetLayouts ()
 		GL_SetObjectName ((uint64_t)vulkan_globals.indirect_compute_set_layout.handle, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, "indirect compute");
 	}
 
+	{
+		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, alias_cull_layout_bindings, 3);
+		for (int i = 0; i < 3; ++i)
+		{
+			alias_cull_layout_bindings[i].binding = i;
+			alias_cull_layout_bindings[i].descriptorCount = 1;
+			alias_cull_layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			alias_cull_layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		descriptor_set_layout_create_info.bindingCount = countof (alias_cull_layout_bindings);
+		descriptor_set_layout_create_info.pBindings = alias_cull_layout_bindings;
+
+		memset (&vulkan_globals.alias_cull_set_layout, 0, sizeof (vulkan_globals.alias_cull_set_layout));
+		vulkan_globals.alias_cull_set_layout.num_storage_buffers = 3;
+
+		err = vkCreateDescriptorSetLayout (vulkan_globals.device, &descriptor_set_layout_create_info, NULL, &vulkan_globals.alias_cull_set_layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateDescriptorSetLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.alias_cull_set_layout.handle, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, "alias cull");
+	}
+
+	{
+		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, bmodel_transforms_layout_bindings, 2);
+		bmodel_transforms_layout_bindings[0].binding = 0;
+		bmodel_transforms_layout_bindings[0].descriptorCount = 1;
+		bmodel_transforms_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bmodel_transforms_layout_bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		bmodel_transforms_layout_bindings[1].binding = 1;
+		bmodel_transforms_layout_bindings[1].descriptorCount = 1;
+		bmodel_transforms_layout_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bmodel_transforms_layout_bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		descriptor_set_layout_create_info.bindingCount = countof (bmodel_transforms_layout_bindings);
+		descriptor_set_layout_create_info.pBindings = bmodel_transforms_layout_bindings;
+
+		memset (&vulkan_globals.bmodel_transforms_set_layout, 0, sizeof (vulkan_globals.bmodel_transforms_set_layout));
+		vulkan_globals.bmodel_transforms_set_layout.num_storage_buffers = 2;
+
+		err = vkCreateDescriptorSetLayout (
+			vulkan_globals.device, &descriptor_set_layout_create_info, NULL, &vulkan_globals.bmodel_transforms_set_layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateDescriptorSetLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.bmodel_transforms_set_layout.handle, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, "bmodel transforms");
+	}
+
+	{
+		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, occlusion_depth_layout_bindings, 2);
+		occlusion_depth_layout_bindings[0].binding = 0;
+		occlusion_depth_layout_bindings[0].descriptorCount = 1;
+		occlusion_depth_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		occlusion_depth_layout_bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		occlusion_depth_layout_bindings[1].binding = 1;
+		occlusion_depth_layout_bindings[1].descriptorCount = 1;
+		occlusion_depth_layout_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		occlusion_depth_layout_bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		descriptor_set_layout_create_info.bindingCount = countof (occlusion_depth_layout_bindings);
+		descriptor_set_layout_create_info.pBindings = occlusion_depth_layout_bindings;
+
+		memset (&vulkan_globals.occlusion_depth_set_layout, 0, sizeof (vulkan_globals.occlusion_depth_set_layout));
+		vulkan_globals.occlusion_depth_set_layout.num_combined_image_samplers = 1;
+		vulkan_globals.occlusion_depth_set_layout.num_storage_buffers = 1;
+
+		err = vkCreateDescriptorSetLayout (vulkan_globals.device, &descriptor_set_layout_create_info, NULL, &vulkan_globals.occlusion_depth_set_layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateDescriptorSetLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.occlusion_depth_set_layout.handle, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, "occlusion depth");
+	}
+
+	{
+		ZEROED_STRUCT_ARRAY (VkDescriptorSetLayoutBinding, shading_rate_layout_bindings, 2);
+		shading_rate_layout_bindings[0].binding = 0;
+		shading_rate_layout_bindings[0].descriptorCount = 1;
+		shading_rate_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		shading_rate_layout_bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		shading_rate_layout_bindings[1].binding = 1;
+		shading_rate_layout_bindings[1].descriptorCount = 1;
+		shading_rate_layout_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		shading_rate_layout_bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		descriptor_set_layout_create_info.bindingCount = countof (shading_rate_layout_bindings);
+		descriptor_set_layout_create_info.pBindings = shading_rate_layout_bindings;
+
+		memset (&vulkan_globals.shading_rate_set_layout, 0, sizeof (vulkan_globals.shading_rate_set_layout));
+		vulkan_globals.shading_rate_set_layout.num_combined_image_samplers = 1;
+		vulkan_globals.shading_rate_set_layout.num_storage_images = 1;
+
+		err = vkCreateDescriptorSetLayout (vulkan_globals.device, &descriptor_set_layout_create_info, NULL, &vulkan_globals.shading_rate_set_layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateDescriptorSetLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.shading_rate_set_layout.handle, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, "shading rate");
+	}
+
 #if defined(_DEBUG)
 	if (vulkan_globals.ray_query)
 	{
@@ -1578,6 +1924,30 @@ void R_CreatePipelineLayouts ()
 		vulkan_globals.basic_pipeline_layout.push_constant_range = push_constant_range;
 	}
 
+	{
+		// Particles evaluated on the GPU: texture + per frame UBO
+		VkDescriptorSetLayout particles_gpu_descriptor_set_layouts[2] = {
+			vulkan_globals.single_texture_set_layout.handle, vulkan_globals.ubo_set_layout.handle};
+
+		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
+		push_constant_range.offset = 0;
+		push_constant_range.size = 21 * sizeof (float);
+		push_constant_range.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 2;
+		pipeline_layout_create_info.pSetLayouts = particles_gpu_descriptor_set_layouts;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.particle_gpu_pipeline.layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.particle_gpu_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "particles_gpu_pipeline_layout");
+		vulkan_globals.particle_gpu_pipeline.layout.push_constant_range = push_constant_range;
+	}
+
 	{
 		// World
 		VkDescriptorSetLayout world_descriptor_set_layouts[3] = {
@@ -1600,6 +1970,20 @@ void R_CreatePipelineLayouts ()
 			Sys_Error ("vkCreatePipelineLayout failed");
 		GL_SetObjectName ((uint64_t)vulkan_globals.world_pipeline_layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "world_pipeline_layout");
 		vulkan_globals.world_pipeline_layout.push_constant_range = push_constant_range;
+
+		// Indirect world, same push constants so they survive switching between both
+		VkDescriptorSetLayout world_indirect_descriptor_set_layouts[4] = {
+			vulkan_globals.single_texture_set_layout.handle, vulkan_globals.single_texture_set_layout.handle, vulkan_globals.single_texture_set_layout.handle,
+			vulkan_globals.bmodel_transforms_set_layout.handle};
+
+		pipeline_layout_create_info.setLayoutCount = 4;
+		pipeline_layout_create_info.pSetLayouts = world_indirect_descriptor_set_layouts;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.world_indirect_pipeline_layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.world_indirect_pipeline_layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "world_indirect_pipeline_layout");
+		vulkan_globals.world_indirect_pipeline_layout.push_constant_range = push_constant_range;
 	}
 
 	{
@@ -1686,6 +2070,33 @@ void R_CreatePipelineLayouts ()
 		vulkan_globals.sky_pipeline_layout[1].push_constant_range = push_constant_range;
 	}
 
+	{
+		// Sky cache: both sky layers, cube map faces as storage image array
+		VkDescriptorSetLayout sky_cache_descriptor_set_layouts[3] = {
+			vulkan_globals.single_texture_set_layout.handle,
+			vulkan_globals.single_texture_set_layout.handle,
+			vulkan_globals.single_texture_cs_write_set_layout.handle,
+		};
+
+		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
+		push_constant_range.offset = 0;
+		push_constant_range.size = 3 * sizeof (float);
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 3;
+		pipeline_layout_create_info.pSetLayouts = sky_cache_descriptor_set_layouts;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.sky_cache_pipeline.layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.sky_cache_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "sky_cache_pipeline_layout");
+		vulkan_globals.sky_cache_pipeline.layout.push_constant_range = push_constant_range;
+	}
+
 	{
 		// Postprocess: set 0 = game texture, set 1 = UI texture
 		VkDescriptorSetLayout postprocess_descriptor_set_layouts[2] = {
@@ -1695,7 +2106,7 @@ void R_CreatePipelineLayouts ()
 
 		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
 		push_constant_range.offset = 0;
-		push_constant_range.size = 10 * sizeof (float);
+		push_constant_range.size = 18 * sizeof (float);
 		push_constant_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
@@ -1791,7 +2202,7 @@ void R_CreatePipelineLayouts ()
 
 		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
 		push_constant_range.offset = 0;
-		push_constant_range.size = 7 * sizeof (uint32_t);
+		push_constant_range.size = 10 * sizeof (uint32_t);
 		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
@@ -1817,7 +2228,7 @@ void R_CreatePipelineLayouts ()
 
 		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
 		push_constant_range.offset = 0;
-		push_constant_range.size = 7 * sizeof (uint32_t);
+		push_constant_range.size = 10 * sizeof (uint32_t);
 		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
@@ -1841,9 +2252,10 @@ void R_CreatePipelineLayouts ()
 			vulkan_globals.indirect_compute_set_layout.handle,
 		};
 
+		// indirect.comp: num_draws, first_draw, vieworg, transforms_base, padding, 4 frustum planes
 		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
 		push_constant_range.offset = 0;
-		push_constant_range.size = 6 * sizeof (uint32_t);
+		push_constant_range.size = 24 * sizeof (uint32_t);
 		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
@@ -1859,11 +2271,93 @@ void R_CreatePipelineLayouts ()
 		GL_SetObjectName ((uint64_t)vulkan_globals.indirect_draw_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "indirect_draw_pipeline_layout");
 		vulkan_globals.indirect_draw_pipeline.layout.push_constant_range = push_constant_range;
 
+		push_constant_range.size = 5 * sizeof (uint32_t);
 		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.indirect_clear_pipeline.layout.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreatePipelineLayout failed");
 		GL_SetObjectName ((uint64_t)vulkan_globals.indirect_clear_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "indirect_clear_pipeline_layout");
 		vulkan_globals.indirect_clear_pipeline.layout.push_constant_range = push_constant_range;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.indirect_mark_pipeline.layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.indirect_mark_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "indirect_mark_pipeline_layout");
+		vulkan_globals.indirect_mark_pipeline.layout.push_constant_range = push_constant_range;
+	}
+
+	{
+		// Alias cull
+		VkDescriptorSetLayout alias_cull_descriptor_set_layouts[1] = {
+			vulkan_globals.alias_cull_set_layout.handle,
+		};
+
+		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
+		push_constant_range.offset = 0;
+		push_constant_range.size = 20 * sizeof (uint32_t);
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 1;
+		pipeline_layout_create_info.pSetLayouts = alias_cull_descriptor_set_layouts;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.alias_cull_pipeline.layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.alias_cull_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "alias_cull_pipeline_layout");
+		vulkan_globals.alias_cull_pipeline.layout.push_constant_range = push_constant_range;
+	}
+
+	{
+		// Occlusion depth
+		VkDescriptorSetLayout occlusion_depth_descriptor_set_layouts[1] = {
+			vulkan_globals.occlusion_depth_set_layout.handle,
+		};
+
+		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
+		push_constant_range.offset = 0;
+		push_constant_range.size = 6 * sizeof (uint32_t);
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 1;
+		pipeline_layout_create_info.pSetLayouts = occlusion_depth_descriptor_set_layouts;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.occlusion_depth_pipeline.layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.occlusion_depth_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "occlusion_depth_pipeline_layout");
+		vulkan_globals.occlusion_depth_pipeline.layout.push_constant_range = push_constant_range;
+	}
+
+	{
+		// Shading rate
+		VkDescriptorSetLayout shading_rate_descriptor_set_layouts[1] = {
+			vulkan_globals.shading_rate_set_layout.handle,
+		};
+
+		ZEROED_STRUCT (VkPushConstantRange, push_constant_range);
+		push_constant_range.offset = 0;
+		push_constant_range.size = 8 * sizeof (float);
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		ZEROED_STRUCT (VkPipelineLayoutCreateInfo, pipeline_layout_create_info);
+		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount = 1;
+		pipeline_layout_create_info.pSetLayouts = shading_rate_descriptor_set_layouts;
+		pipeline_layout_create_info.pushConstantRangeCount = 1;
+		pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+		err = vkCreatePipelineLayout (vulkan_globals.device, &pipeline_layout_create_info, NULL, &vulkan_globals.shading_rate_pipeline.layout.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreatePipelineLayout failed");
+		GL_SetObjectName ((uint64_t)vulkan_globals.shading_rate_pipeline.layout.handle, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "shading_rate_pipeline_layout");
+		vulkan_globals.shading_rate_pipeline.layout.push_constant_range = push_constant_range;
 	}
 
 	if (vulkan_globals.ray_query)
@@ -2109,19 +2603,20 @@ static VkShaderModule R_CreateShaderModule (const byte *code, const int size, co
 
 typedef struct pipeline_create_infos_s
 {
-	VkPipelineShaderStageCreateInfo		   shader_stages[2];
-	VkPipelineDynamicStateCreateInfo	   dynamic_state;
-	VkDynamicState						   dynamic_states[3];
-	VkPipelineVertexInputStateCreateInfo   vertex_input_state;
-	VkPipelineInputAssemblyStateCreateInfo input_assembly_state;
-	VkPipelineViewportStateCreateInfo	   viewport_state;
-	VkPipelineRasterizationStateCreateInfo rasterization_state;
-	VkPipelineMultisampleStateCreateInfo   multisample_state;
-	VkPipelineDepthStencilStateCreateInfo  depth_stencil_state;
-	VkPipelineColorBlendStateCreateInfo	   color_blend_state;
-	VkPipelineColorBlendAttachmentState	   blend_attachment_state;
-	VkGraphicsPipelineCreateInfo		   graphics_pipeline;
-	VkComputePipelineCreateInfo			   compute_pipeline;
+	VkPipelineShaderStageCreateInfo					shader_stages[2];
+	VkPipelineDynamicStateCreateInfo				dynamic_state;
+	VkDynamicState									dynamic_states[3];
+	VkPipelineVertexInputStateCreateInfo			vertex_input_state;
+	VkPipelineInputAssemblyStateCreateInfo			input_assembly_state;
+	VkPipelineViewportStateCreateInfo				viewport_state;
+	VkPipelineRasterizationStateCreateInfo			rasterization_state;
+	VkPipelineMultisampleStateCreateInfo			multisample_state;
+	VkPipelineDepthStencilStateCreateInfo			depth_stencil_state;
+	VkPipelineColorBlendStateCreateInfo				color_blend_state;
+	VkPipelineColorBlendAttachmentState				blend_attachment_state;
+	VkGraphicsPipelineCreateInfo					graphics_pipeline;
+	VkComputePipelineCreateInfo						compute_pipeline;
+	VkPipelineFragmentShadingRateStateCreateInfoKHR	shading_rate_state;
 } pipeline_create_infos_t;
 
 static VkVertexInputAttributeDescription basic_vertex_input_attribute_descriptions[3];
@@ -2130,20 +2625,16 @@ static VkVertexInputAttributeDescription world_vertex_input_attribute_descriptio
 static VkVertexInputBindingDescription	 world_vertex_binding_description;
 static VkVertexInputAttributeDescription alias_vertex_input_attribute_descriptions[5];
 static VkVertexInputBindingDescription	 alias_vertex_binding_descriptions[3];
+static VkVertexInputAttributeDescription alias_instanced_vertex_input_attribute_descriptions[11];
+static VkVertexInputBindingDescription	 alias_instanced_vertex_binding_descriptions[4];
 static VkVertexInputAttributeDescription md5_vertex_input_attribute_descriptions[5];
 static VkVertexInputBindingDescription	 md5_vertex_binding_description;
+static VkVertexInputAttributeDescription particles_gpu_vertex_input_attribute_descriptions[5];
+static VkVertexInputBindingDescription	 particles_gpu_vertex_binding_description;
 
 #define DECLARE_SHADER_MODULE(name) static VkShaderModule name##_module
-#define CREATE_SHADER_MODULE(name)                                                 \
-	do                                                                             \
-	{                                                                              \
-		name##_module = R_CreateShaderModule (name##_spv, name##_spv_size, #name); \
-	} while (0)
-#define CREATE_SHADER_MODULE_COND(name, cond)                                                              \
-	do                                                                                                     \
-	{                                                                                                      \
-		name##_module = cond ? R_CreateShaderModule (name##_spv, name##_spv_size, #name) : VK_NULL_HANDLE; \
-	} while (0)
+#define CREATE_SHADER_MODULE(name)			  {&name##_module, name##_spv, name##_spv_size, name##_spv_decompressed_size, #name, true}
+#define CREATE_SHADER_MODULE_COND(name, cond) {&name##_module, name##_spv, name##_spv_size, name##_spv_decompressed_size, #name, cond}
 #define DESTROY_SHADER_MODULE(name)                                             \
 	do                                                                          \
 	{                                                                           \
@@ -2158,26 +2649,33 @@ DECLARE_SHADER_MODULE (basic_alphatest_frag);
 DECLARE_SHADER_MODULE (basic_notex_frag);
 DECLARE_SHADER_MODULE (world_vert);
 DECLARE_SHADER_MODULE (world_frag);
+DECLARE_SHADER_MODULE (world_indirect_vert);
 DECLARE_SHADER_MODULE (alias_vert);
+DECLARE_SHADER_MODULE (alias_instanced_vert);
+DECLARE_SHADER_MODULE (alias_cull_comp);
 DECLARE_SHADER_MODULE (alias_frag);
 DECLARE_SHADER_MODULE (alias_alphatest_frag);
 DECLARE_SHADER_MODULE (md5_vert);
+DECLARE_SHADER_MODULE (particles_gpu_vert);
 DECLARE_SHADER_MODULE (sky_layer_vert);
 DECLARE_SHADER_MODULE (sky_layer_frag);
 DECLARE_SHADER_MODULE (sky_box_frag);
 DECLARE_SHADER_MODULE (sky_cube_vert);
 DECLARE_SHADER_MODULE (sky_cube_frag);
+DECLARE_SHADER_MODULE (sky_cache_comp);
 DECLARE_SHADER_MODULE (postprocess_vert);
 DECLARE_SHADER_MODULE (postprocess_frag);
 DECLARE_SHADER_MODULE (screen_effects_8bit_comp);
-DECLARE_SHADER_MODULE (screen_effects_8bit_scale_comp);
 DECLARE_SHADER_MODULE (screen_effects_8bit_scale_sops_comp);
 DECLARE_SHADER_MODULE (screen_effects_10bit_comp);
-DECLARE_SHADER_MODULE (screen_effects_10bit_scale_comp);
 DECLARE_SHADER_MODULE (screen_effects_10bit_scale_sops_comp);
 DECLARE_SHADER_MODULE (cs_tex_warp_comp);
 DECLARE_SHADER_MODULE (indirect_comp);
 DECLARE_SHADER_MODULE (indirect_clear_comp);
+DECLARE_SHADER_MODULE (indirect_mark_comp);
+DECLARE_SHADER_MODULE (occlusion_depth_comp);
+DECLARE_SHADER_MODULE (occlusion_depth_ms_comp);
+DECLARE_SHADER_MODULE (shading_rate_comp);
 DECLARE_SHADER_MODULE (showtris_vert);
 DECLARE_SHADER_MODULE (showtris_frag);
 DECLARE_SHADER_MODULE (update_lightmap_8bit_comp);
@@ -2264,6 +2762,23 @@ static void R_InitVertexAttributes ()
 		alias_vertex_binding_descriptions[2].binding = 2;
 		alias_vertex_binding_descriptions[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		alias_vertex_binding_descriptions[2].stride = 12;
+
+		// Same as alias plus the per instance model matrix (4 x vec4), shade vector + blend and light color, see aliasinstance_t
+		memcpy (
+			alias_instanced_vertex_input_attribute_descriptions, alias_vertex_input_attribute_descriptions, sizeof (alias_vertex_input_attribute_descriptions));
+		for (int i = 5; i < 11; ++i)
+		{
+			alias_instanced_vertex_input_attribute_descriptions[i].binding = 3;
+			alias_instanced_vertex_input_attribute_descriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			alias_instanced_vertex_input_attribute_descriptions[i].location = i;
+			alias_instanced_vertex_input_attribute_descriptions[i].offset = (i - 5) * 16;
+		}
+		alias_instanced_vertex_input_attribute_descriptions[10].format = VK_FORMAT_R32G32B32_SFLOAT;
+
+		memcpy (alias_instanced_vertex_binding_descriptions, alias_vertex_binding_descriptions, sizeof (alias_vertex_binding_descriptions));
+		alias_instanced_vertex_binding_descriptions[3].binding = 3;
+		alias_instanced_vertex_binding_descriptions[3].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		alias_instanced_vertex_binding_descriptions[3].stride = 96;
 	}
 
 	{
@@ -2293,6 +2808,34 @@ static void R_InitVertexAttributes ()
 		md5_vertex_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		md5_vertex_binding_description.stride = 40;
 	}
+
+	{
+		// Per instance, matches gpuparticle_t
+		particles_gpu_vertex_input_attribute_descriptions[0].binding = 0;
+		particles_gpu_vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		particles_gpu_vertex_input_attribute_descriptions[0].location = 0;
+		particles_gpu_vertex_input_attribute_descriptions[0].offset = 0;
+		particles_gpu_vertex_input_attribute_descriptions[1].binding = 0;
+		particles_gpu_vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		particles_gpu_vertex_input_attribute_descriptions[1].location = 1;
+		particles_gpu_vertex_input_attribute_descriptions[1].offset = 16;
+		particles_gpu_vertex_input_attribute_descriptions[2].binding = 0;
+		particles_gpu_vertex_input_attribute_descriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+		particles_gpu_vertex_input_attribute_descriptions[2].location = 2;
+		particles_gpu_vertex_input_attribute_descriptions[2].offset = 32;
+		particles_gpu_vertex_input_attribute_descriptions[3].binding = 0;
+		particles_gpu_vertex_input_attribute_descriptions[3].format = VK_FORMAT_R32_UINT;
+		particles_gpu_vertex_input_attribute_descriptions[3].location = 3;
+		particles_gpu_vertex_input_attribute_descriptions[3].offset = 36;
+		particles_gpu_vertex_input_attribute_descriptions[4].binding = 0;
+		particles_gpu_vertex_input_attribute_descriptions[4].format = VK_FORMAT_R32_SFLOAT;
+		particles_gpu_vertex_input_attribute_descriptions[4].location = 4;
+		particles_gpu_vertex_input_attribute_descriptions[4].offset = 40;
+
+		particles_gpu_vertex_binding_description.binding = 0;
+		particles_gpu_vertex_binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		particles_gpu_vertex_binding_description.stride = 48;
+	}
 }
 
 /*
@@ -2385,6 +2928,17 @@ static void R_InitDefaultStates (pipeline_create_infos_t *infos)
 	infos->graphics_pipeline.pDynamicState = &infos->dynamic_state;
 	infos->graphics_pipeline.layout = vulkan_globals.basic_pipeline_layout.handle;
 	infos->graphics_pipeline.renderPass = vulkan_globals.secondary_cb_contexts[SCBX_WORLD][0].render_pass;
+
+	// Without this the attachment of the main render pass would be ignored, passes without one shade at 1x1
+	if (vulkan_globals.fragment_shading_rate)
+	{
+		infos->shading_rate_state.sType = VK_STRUCTURE_TYPE_PIPELINE_FRAGMENT_SHADING_RATE_STATE_CREATE_INFO_KHR;
+		infos->shading_rate_state.fragmentSize.width = 1;
+		infos->shading_rate_state.fragmentSize.height = 1;
+		infos->shading_rate_state.combinerOps[0] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR;
+		infos->shading_rate_state.combinerOps[1] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_REPLACE_KHR;
+		infos->graphics_pipeline.pNext = &infos->shading_rate_state;
+	}
 }
 
 /*
@@ -2410,7 +2964,8 @@ static void R_CreateBasicPipelines ()
 
 		assert (vulkan_globals.basic_alphatest_pipeline[render_pass].handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.basic_alphatest_pipeline[render_pass].handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL,
+			&vulkan_globals.basic_alphatest_pipeline[render_pass].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		vulkan_globals.basic_alphatest_pipeline[render_pass].layout = vulkan_globals.basic_pipeline_layout;
@@ -2427,7 +2982,8 @@ static void R_CreateBasicPipelines ()
 
 		assert (vulkan_globals.basic_notex_blend_pipeline[render_pass].handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.basic_notex_blend_pipeline[render_pass].handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL,
+			&vulkan_globals.basic_notex_blend_pipeline[render_pass].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		vulkan_globals.basic_notex_blend_pipeline[render_pass].layout = vulkan_globals.basic_pipeline_layout;
@@ -2447,7 +3003,7 @@ static void R_CreateBasicPipelines ()
 
 		assert (vulkan_globals.basic_blend_pipeline[render_pass].handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.basic_blend_pipeline[render_pass].handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.basic_blend_pipeline[render_pass].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		vulkan_globals.basic_blend_pipeline[render_pass].layout = vulkan_globals.basic_pipeline_layout;
@@ -2480,7 +3036,8 @@ static void R_CreateWarpPipelines ()
 	infos.graphics_pipeline.renderPass = vulkan_globals.warp_render_pass;
 
 	assert (vulkan_globals.raster_tex_warp_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.raster_tex_warp_pipeline.handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.raster_tex_warp_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (raster_tex_warp_pipeline)");
 	vulkan_globals.raster_tex_warp_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -2498,7 +3055,8 @@ static void R_CreateWarpPipelines ()
 	infos.compute_pipeline.layout = vulkan_globals.cs_tex_warp_pipeline.layout.handle;
 
 	assert (vulkan_globals.cs_tex_warp_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.cs_tex_warp_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.cs_tex_warp_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (cs_tex_warp_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.cs_tex_warp_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "cs_tex_warp");
@@ -2523,11 +3081,26 @@ static void R_CreateParticlesPipelines ()
 	infos.blend_attachment_state.blendEnable = VK_TRUE;
 
 	assert (vulkan_globals.particle_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.particle_pipeline.handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.particle_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed");
 	vulkan_globals.particle_pipeline.layout = vulkan_globals.basic_pipeline_layout;
 	GL_SetObjectName ((uint64_t)vulkan_globals.particle_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "particles");
+
+	infos.vertex_input_state.vertexAttributeDescriptionCount = 5;
+	infos.vertex_input_state.pVertexAttributeDescriptions = particles_gpu_vertex_input_attribute_descriptions;
+	infos.vertex_input_state.vertexBindingDescriptionCount = 1;
+	infos.vertex_input_state.pVertexBindingDescriptions = &particles_gpu_vertex_binding_description;
+	infos.shader_stages[0].module = particles_gpu_vert_module;
+	infos.graphics_pipeline.layout = vulkan_globals.particle_gpu_pipeline.layout.handle;
+
+	assert (vulkan_globals.particle_gpu_pipeline.handle == VK_NULL_HANDLE);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.particle_gpu_pipeline.handle);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateGraphicsPipelines failed");
+	GL_SetObjectName ((uint64_t)vulkan_globals.particle_gpu_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "particles_gpu");
 }
 
 /*
@@ -2557,7 +3130,8 @@ static void R_CreateRayDebugPipelines ()
 	infos.compute_pipeline.layout = vulkan_globals.ray_debug_pipeline.layout.handle;
 
 	assert (vulkan_globals.ray_debug_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.ray_debug_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.ray_debug_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (ray_debug_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.ray_debug_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "ray_debug_pipeline");
@@ -2590,7 +3164,8 @@ static void R_CreateAnimComputePipelines ()
 	infos.compute_pipeline.layout = vulkan_globals.mesh_interpolate_pipeline.layout.handle;
 
 	assert (vulkan_globals.mesh_interpolate_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.mesh_interpolate_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.mesh_interpolate_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (mesh_interpolate_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.mesh_interpolate_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "mesh_interpolate_pipeline");
@@ -2600,7 +3175,8 @@ static void R_CreateAnimComputePipelines ()
 	infos.compute_pipeline.layout = vulkan_globals.skinning_pipeline.layout.handle;
 
 	assert (vulkan_globals.skinning_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.skinning_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.skinning_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (skinning_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.skinning_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "skinning_pipeline");
@@ -2680,7 +3256,7 @@ static void R_CreateFTEParticlesPipelines ()
 
 		assert (vulkan_globals.fte_particle_pipelines[i].handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.fte_particle_pipelines[i].handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.fte_particle_pipelines[i].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (fte_particle_pipelines[%d]", i);
 		vulkan_globals.fte_particle_pipelines[i].layout = vulkan_globals.basic_pipeline_layout;
@@ -2693,7 +3269,7 @@ static void R_CreateFTEParticlesPipelines ()
 
 			assert (vulkan_globals.fte_particle_pipelines[i + 8].handle == VK_NULL_HANDLE);
 			err = vkCreateGraphicsPipelines (
-				vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.fte_particle_pipelines[i + 8].handle);
+				vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.fte_particle_pipelines[i + 8].handle);
 			if (err != VK_SUCCESS)
 				Sys_Error ("vkCreateGraphicsPipelines failed (vulkan_globals.fte_particle_pipelines[%d])", i + 8);
 			vulkan_globals.fte_particle_pipelines[i + 8].layout = vulkan_globals.basic_pipeline_layout;
@@ -2723,7 +3299,8 @@ static void R_CreateSpritesPipelines ()
 	infos.dynamic_states[infos.dynamic_state.dynamicStateCount++] = VK_DYNAMIC_STATE_DEPTH_BIAS;
 
 	assert (vulkan_globals.sprite_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sprite_pipeline.handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sprite_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (sprite_pipeline)");
 	vulkan_globals.sprite_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -2773,7 +3350,7 @@ static void R_CreateSkyPipelines ()
 
 		assert (vulkan_globals.sky_stencil_pipeline[i].handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_stencil_pipeline[i].handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_stencil_pipeline[i].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (sky_stencil_pipeline)");
 		vulkan_globals.sky_stencil_pipeline[i].layout = vulkan_globals.sky_pipeline_layout[0];
@@ -2786,8 +3363,8 @@ static void R_CreateSkyPipelines ()
 		infos.shader_stages[1].module = basic_notex_frag_module;
 
 		assert (vulkan_globals.sky_color_pipeline[i].handle == VK_NULL_HANDLE);
-		err =
-			vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_color_pipeline[i].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_color_pipeline[i].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (sky_color_pipeline)");
 		vulkan_globals.sky_color_pipeline[i].layout = vulkan_globals.sky_pipeline_layout[0];
@@ -2796,7 +3373,8 @@ static void R_CreateSkyPipelines ()
 		infos.shader_stages[0].module = sky_cube_vert_module;
 		infos.shader_stages[1].module = sky_cube_frag_module;
 		assert (vulkan_globals.sky_cube_pipeline[i].handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_cube_pipeline[i].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_cube_pipeline[i].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (sky_cube_pipeline)");
 		GL_SetObjectName ((uint64_t)vulkan_globals.sky_cube_pipeline[i].handle, VK_OBJECT_TYPE_PIPELINE, i ? "sky_cube_indirect" : "sky_cube");
@@ -2806,8 +3384,8 @@ static void R_CreateSkyPipelines ()
 		infos.shader_stages[1].module = sky_layer_frag_module;
 		infos.graphics_pipeline.layout = vulkan_globals.sky_pipeline_layout[1].handle;
 		assert (vulkan_globals.sky_layer_pipeline[i].handle == VK_NULL_HANDLE);
-		err =
-			vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_layer_pipeline[i].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_layer_pipeline[i].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (sky_layer_pipeline)");
 		GL_SetObjectName ((uint64_t)vulkan_globals.sky_layer_pipeline[i].handle, VK_OBJECT_TYPE_PIPELINE, i ? "sky_layer_indirect" : "sky_layer");
@@ -2831,13 +3409,35 @@ static void R_CreateSkyPipelines ()
 		infos.graphics_pipeline.layout = vulkan_globals.sky_pipeline_layout[0].handle;
 
 		assert (vulkan_globals.sky_box_pipeline.handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_box_pipeline.handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.sky_box_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (sky_box_pipeline)");
 		GL_SetObjectName ((uint64_t)vulkan_globals.sky_box_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "sky_box");
 
 		vulkan_globals.sky_box_pipeline.layout = vulkan_globals.sky_pipeline_layout[0];
 	}
+
+	VkResult				err;
+	pipeline_create_infos_t infos;
+	R_InitDefaultStates (&infos);
+
+	ZEROED_STRUCT (VkPipelineShaderStageCreateInfo, compute_shader_stage);
+	compute_shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compute_shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compute_shader_stage.module = sky_cache_comp_module;
+	compute_shader_stage.pName = "main";
+
+	memset (&infos.compute_pipeline, 0, sizeof (infos.compute_pipeline));
+	infos.compute_pipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	infos.compute_pipeline.stage = compute_shader_stage;
+	infos.compute_pipeline.layout = vulkan_globals.sky_cache_pipeline.layout.handle;
+
+	assert (vulkan_globals.sky_cache_pipeline.handle == VK_NULL_HANDLE);
+	err = vkCreateComputePipelines (vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.sky_cache_pipeline.handle);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateComputePipelines failed (sky_cache_pipeline)");
+	GL_SetObjectName ((uint64_t)vulkan_globals.sky_cache_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "sky_cache");
 }
 
 /*
@@ -2881,7 +3481,8 @@ static void R_CreateShowTrisPipelines ()
 		infos.graphics_pipeline.layout = vulkan_globals.basic_pipeline_layout.handle;
 
 		assert (vulkan_globals.showtris_pipeline.handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_pipeline.handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (showtris_pipeline)");
 		vulkan_globals.showtris_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -2894,7 +3495,7 @@ static void R_CreateShowTrisPipelines ()
 
 		assert (vulkan_globals.showtris_depth_test_pipeline.handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_depth_test_pipeline.handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_depth_test_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (showtris_depth_test_pipeline)");
 		vulkan_globals.showtris_depth_test_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -2905,7 +3506,8 @@ static void R_CreateShowTrisPipelines ()
 		infos.rasterization_state.depthBiasEnable = VK_FALSE;
 		infos.input_assembly_state.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
 		assert (vulkan_globals.showbboxes_pipeline.handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showbboxes_pipeline.handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showbboxes_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (showtris_depth_test)");
 		vulkan_globals.showbboxes_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -2920,7 +3522,7 @@ static void R_CreateShowTrisPipelines ()
 
 		assert (vulkan_globals.showtris_indirect_pipeline.handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_indirect_pipeline.handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_indirect_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (showtris_indirect_pipeline)");
 		vulkan_globals.showtris_indirect_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -2931,7 +3533,8 @@ static void R_CreateShowTrisPipelines ()
 
 		assert (vulkan_globals.showtris_indirect_depth_test_pipeline.handle == VK_NULL_HANDLE);
 		err = vkCreateGraphicsPipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.showtris_indirect_depth_test_pipeline.handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL,
+			&vulkan_globals.showtris_indirect_depth_test_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed (showtris_indirect_depth_test_pipeline)");
 		vulkan_globals.showtris_indirect_depth_test_pipeline.layout = vulkan_globals.basic_pipeline_layout;
@@ -3030,7 +3633,8 @@ static void R_CreateWorldPipelines ()
 
 					assert (vulkan_globals.world_pipelines[pipeline_index].handle == VK_NULL_HANDLE);
 					err = vkCreateGraphicsPipelines (
-						vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.world_pipelines[pipeline_index].handle);
+						vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL,
+						&vulkan_globals.world_pipelines[pipeline_index].handle);
 					if (err != VK_SUCCESS)
 						Sys_Error ("vkCreateGraphicsPipelines failed (world_pipelines[%d])", pipeline_index);
 					GL_SetObjectName (
@@ -3040,10 +3644,39 @@ static void R_CreateWorldPipelines ()
 			}
 		}
 	}
-}
 
-/*
-===============
+	// Indirect draws, which hold the brush entities that were only moved or rotated
+	infos.graphics_pipeline.layout = vulkan_globals.world_indirect_pipeline_layout.handle;
+	infos.graphics_pipeline.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+	infos.graphics_pipeline.basePipelineHandle = vulkan_globals.world_pipelines[0].handle;
+	infos.graphics_pipeline.basePipelineIndex = -1;
+	infos.shader_stages[0].module = world_indirect_vert_module;
+
+	for (int pipeline_index = 0; pipeline_index < WORLD_PIPELINE_COUNT; ++pipeline_index)
+	{
+		alpha_blend = (pipeline_index & 4) != 0;
+		specialization_data[0] = (pipeline_index & 1) != 0;
+		specialization_data[1] = (pipeline_index & 2) != 0;
+		specialization_data[2] = alpha_blend;
+		specialization_data[3] = (pipeline_index & 8) != 0;
+
+		infos.blend_attachment_state.blendEnable = alpha_blend ? VK_TRUE : VK_FALSE;
+		infos.depth_stencil_state.depthWriteEnable = alpha_blend ? VK_FALSE : VK_TRUE;
+
+		assert (vulkan_globals.world_indirect_pipelines[pipeline_index].handle == VK_NULL_HANDLE);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL,
+			&vulkan_globals.world_indirect_pipelines[pipeline_index].handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateGraphicsPipelines failed (world_indirect_pipelines[%d])", pipeline_index);
+		GL_SetObjectName (
+			(uint64_t)vulkan_globals.world_indirect_pipelines[pipeline_index].handle, VK_OBJECT_TYPE_PIPELINE, va ("world indirect %d", pipeline_index));
+		vulkan_globals.world_indirect_pipelines[pipeline_index].layout = vulkan_globals.world_indirect_pipeline_layout;
+	}
+}
+
+/*
+===============
 R_CreateAliasPipelines
 ===============
 */
@@ -3070,7 +3703,8 @@ static void R_CreateAliasPipelines ()
 	infos.graphics_pipeline.layout = vulkan_globals.alias_pipelines[0].layout.handle;
 
 	assert (vulkan_globals.alias_pipelines[0].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[0].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[0].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (alias_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.alias_pipelines[0].handle, VK_OBJECT_TYPE_PIPELINE, "alias");
@@ -3078,7 +3712,8 @@ static void R_CreateAliasPipelines ()
 	infos.shader_stages[1].module = alias_alphatest_frag_module;
 
 	assert (vulkan_globals.alias_pipelines[1].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[1].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[1].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (alias_alphatest_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.alias_pipelines[1].handle, VK_OBJECT_TYPE_PIPELINE, "alias_alphatest");
@@ -3089,7 +3724,8 @@ static void R_CreateAliasPipelines ()
 	infos.shader_stages[1].module = alias_frag_module;
 
 	assert (vulkan_globals.alias_pipelines[2].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[2].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[2].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (alias_blend_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.alias_pipelines[2].handle, VK_OBJECT_TYPE_PIPELINE, "alias_blend");
@@ -3098,7 +3734,8 @@ static void R_CreateAliasPipelines ()
 	infos.shader_stages[1].module = alias_alphatest_frag_module;
 
 	assert (vulkan_globals.alias_pipelines[3].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[3].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[3].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed");
 	GL_SetObjectName ((uint64_t)vulkan_globals.alias_pipelines[3].handle, VK_OBJECT_TYPE_PIPELINE, "alias_alphatest_blend");
@@ -3119,7 +3756,8 @@ static void R_CreateAliasPipelines ()
 		infos.graphics_pipeline.layout = vulkan_globals.alias_pipelines[0].layout.handle;
 
 		assert (vulkan_globals.alias_pipelines[4].handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[4].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[4].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		GL_SetObjectName ((uint64_t)vulkan_globals.alias_pipelines[4].handle, VK_OBJECT_TYPE_PIPELINE, "alias_showtris");
@@ -3131,7 +3769,8 @@ static void R_CreateAliasPipelines ()
 		infos.rasterization_state.depthBiasSlopeFactor = 0.0f;
 
 		assert (vulkan_globals.alias_pipelines[5].handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[5].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_pipelines[5].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		GL_SetObjectName ((uint64_t)vulkan_globals.alias_pipelines[5].handle, VK_OBJECT_TYPE_PIPELINE, "alias_showtris_depth_test");
@@ -3139,6 +3778,54 @@ static void R_CreateAliasPipelines ()
 	}
 }
 
+/*
+===============
+R_CreateAliasInstancedPipelines
+
+Same as alias pipelines 0-3 (opaque/alphatest, with and without blending),
+but with a per instance vertex binding. There are no showtris variants,
+R_DrawAliasModel_ShowTris doesn't batch.
+===============
+*/
+static void R_CreateAliasInstancedPipelines ()
+{
+	VkResult				err;
+	pipeline_create_infos_t infos;
+	R_InitDefaultStates (&infos);
+
+	static const char *pipeline_names[4] = {"alias_instanced", "alias_instanced_alphatest", "alias_instanced_blend", "alias_instanced_alphatest_blend"};
+
+	infos.depth_stencil_state.depthTestEnable = VK_TRUE;
+	infos.rasterization_state.depthBiasEnable = VK_FALSE;
+	infos.shader_stages[1].pSpecializationInfo = NULL;
+
+	infos.vertex_input_state.vertexAttributeDescriptionCount = 11;
+	infos.vertex_input_state.pVertexAttributeDescriptions = alias_instanced_vertex_input_attribute_descriptions;
+	infos.vertex_input_state.vertexBindingDescriptionCount = 4;
+	infos.vertex_input_state.pVertexBindingDescriptions = alias_instanced_vertex_binding_descriptions;
+
+	infos.shader_stages[0].module = alias_instanced_vert_module;
+
+	infos.graphics_pipeline.layout = vulkan_globals.alias_pipelines[0].layout.handle;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		const qboolean blend = i >= 2;
+		const qboolean alphatest = (i & 1) != 0;
+		infos.depth_stencil_state.depthWriteEnable = blend ? VK_FALSE : VK_TRUE;
+		infos.blend_attachment_state.blendEnable = blend ? VK_TRUE : VK_FALSE;
+		infos.shader_stages[1].module = alphatest ? alias_alphatest_frag_module : alias_frag_module;
+
+		assert (vulkan_globals.alias_instanced_pipelines[i].handle == VK_NULL_HANDLE);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.alias_instanced_pipelines[i].handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateGraphicsPipelines failed (%s)", pipeline_names[i]);
+		GL_SetObjectName ((uint64_t)vulkan_globals.alias_instanced_pipelines[i].handle, VK_OBJECT_TYPE_PIPELINE, pipeline_names[i]);
+		vulkan_globals.alias_instanced_pipelines[i].layout = vulkan_globals.alias_pipelines[0].layout;
+	}
+}
+
 /*
 ===============
 R_CreateMD5Pipelines
@@ -3167,7 +3854,8 @@ static void R_CreateMD5Pipelines ()
 	infos.graphics_pipeline.layout = vulkan_globals.md5_pipelines[0].layout.handle;
 
 	assert (vulkan_globals.md5_pipelines[0].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[0].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[0].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (md5_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.md5_pipelines[0].handle, VK_OBJECT_TYPE_PIPELINE, "md5");
@@ -3175,7 +3863,8 @@ static void R_CreateMD5Pipelines ()
 	infos.shader_stages[1].module = alias_alphatest_frag_module;
 
 	assert (vulkan_globals.md5_pipelines[1].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[1].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[1].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (md5_alphatest_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.md5_pipelines[1].handle, VK_OBJECT_TYPE_PIPELINE, "md5_alphatest");
@@ -3186,7 +3875,8 @@ static void R_CreateMD5Pipelines ()
 	infos.shader_stages[1].module = alias_frag_module;
 
 	assert (vulkan_globals.md5_pipelines[2].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[2].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[2].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (md5_blend_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.md5_pipelines[2].handle, VK_OBJECT_TYPE_PIPELINE, "md5_blend");
@@ -3195,7 +3885,8 @@ static void R_CreateMD5Pipelines ()
 	infos.shader_stages[1].module = alias_alphatest_frag_module;
 
 	assert (vulkan_globals.md5_pipelines[3].handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[3].handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[3].handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed");
 	GL_SetObjectName ((uint64_t)vulkan_globals.md5_pipelines[3].handle, VK_OBJECT_TYPE_PIPELINE, "md5_alphatest_blend");
@@ -3216,7 +3907,8 @@ static void R_CreateMD5Pipelines ()
 		infos.graphics_pipeline.layout = vulkan_globals.md5_pipelines[0].layout.handle;
 
 		assert (vulkan_globals.md5_pipelines[4].handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[4].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[4].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		GL_SetObjectName ((uint64_t)vulkan_globals.md5_pipelines[4].handle, VK_OBJECT_TYPE_PIPELINE, "md5_showtris");
@@ -3228,7 +3920,8 @@ static void R_CreateMD5Pipelines ()
 		infos.rasterization_state.depthBiasSlopeFactor = 0.0f;
 
 		assert (vulkan_globals.md5_pipelines[5].handle == VK_NULL_HANDLE);
-		err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[5].handle);
+		err = vkCreateGraphicsPipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.md5_pipelines[5].handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateGraphicsPipelines failed");
 		GL_SetObjectName ((uint64_t)vulkan_globals.md5_pipelines[5].handle, VK_OBJECT_TYPE_PIPELINE, "md5_showtris_depth_test");
@@ -3268,7 +3961,8 @@ static void R_CreatePostprocessPipelines ()
 	infos.graphics_pipeline.subpass = 0;
 
 	assert (vulkan_globals.postprocess_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateGraphicsPipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.postprocess_pipeline.handle);
+	err = vkCreateGraphicsPipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.graphics_pipeline, NULL, &vulkan_globals.postprocess_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateGraphicsPipelines failed (postprocess_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.postprocess_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "postprocess");
@@ -3298,17 +3992,29 @@ static void R_CreateScreenEffectsPipelines ()
 	infos.compute_pipeline.layout = vulkan_globals.screen_effects_pipeline.layout.handle;
 
 	assert (vulkan_globals.screen_effects_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.screen_effects_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.screen_effects_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (screen_effects_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.screen_effects_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "screen_effects");
 
-	compute_shader_stage.module =
-		(vulkan_globals.color_format == VK_FORMAT_A2B10G10R10_UNORM_PACK32) ? screen_effects_10bit_scale_comp_module : screen_effects_8bit_scale_comp_module;
+	// Same module, the scaling code paths are enabled with a specialization constant
+	VkSpecializationMapEntry specialization_entry;
+	specialization_entry.constantID = 0;
+	specialization_entry.offset = 0;
+	specialization_entry.size = 4;
+	uint32_t			 specialization_data = VK_TRUE; // scaling
+	VkSpecializationInfo specialization_info;
+	specialization_info.mapEntryCount = 1;
+	specialization_info.pMapEntries = &specialization_entry;
+	specialization_info.dataSize = 4;
+	specialization_info.pData = &specialization_data;
+
+	compute_shader_stage.pSpecializationInfo = &specialization_info;
 	infos.compute_pipeline.stage = compute_shader_stage;
 	assert (vulkan_globals.screen_effects_scale_pipeline.handle == VK_NULL_HANDLE);
 	err = vkCreateComputePipelines (
-		vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.screen_effects_scale_pipeline.handle);
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.screen_effects_scale_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (screen_effects_scale_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.screen_effects_scale_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "screen_effects_scale");
@@ -3319,10 +4025,11 @@ static void R_CreateScreenEffectsPipelines ()
 																										  : screen_effects_8bit_scale_sops_comp_module;
 		compute_shader_stage.flags =
 			VK_PIPELINE_SHADER_STAGE_CREATE_ALLOW_VARYING_SUBGROUP_SIZE_BIT_EXT | VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT_EXT;
+		compute_shader_stage.pSpecializationInfo = NULL;
 		infos.compute_pipeline.stage = compute_shader_stage;
 		assert (vulkan_globals.screen_effects_scale_sops_pipeline.handle == VK_NULL_HANDLE);
 		err = vkCreateComputePipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.screen_effects_scale_sops_pipeline.handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.screen_effects_scale_sops_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateComputePipelines failed (screen_effects_scale_sops_pipeline)");
 		GL_SetObjectName ((uint64_t)vulkan_globals.screen_effects_scale_sops_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "screen_effects_scale_sops");
@@ -3333,9 +4040,11 @@ static void R_CreateScreenEffectsPipelines ()
 /*
 ===============
 R_CreateUpdateLightmapPipelines
+
+rt selects the ray query variant, which is only used with r_rtshadows
 ===============
 */
-static void R_CreateUpdateLightmapPipelines ()
+static void R_CreateUpdateLightmapPipelines (qboolean rt)
 {
 	VkResult				err;
 	pipeline_create_infos_t infos;
@@ -3365,13 +4074,16 @@ static void R_CreateUpdateLightmapPipelines ()
 	infos.compute_pipeline.stage = compute_shader_stage;
 	infos.compute_pipeline.layout = vulkan_globals.update_lightmap_pipeline.layout.handle;
 
-	assert (vulkan_globals.update_lightmap_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.update_lightmap_pipeline.handle);
-	if (err != VK_SUCCESS)
-		Sys_Error ("vkCreateComputePipelines failed (update_lightmap_pipeline)");
-	GL_SetObjectName ((uint64_t)vulkan_globals.update_lightmap_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "update_lightmap");
-
-	if (vulkan_globals.ray_query)
+	if (!rt)
+	{
+		assert (vulkan_globals.update_lightmap_pipeline.handle == VK_NULL_HANDLE);
+		err = vkCreateComputePipelines (
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.update_lightmap_pipeline.handle);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateComputePipelines failed (update_lightmap_pipeline)");
+		GL_SetObjectName ((uint64_t)vulkan_globals.update_lightmap_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "update_lightmap");
+	}
+	else if (vulkan_globals.ray_query)
 	{
 		compute_shader_stage.module =
 			(vulkan_globals.color_format == VK_FORMAT_A2B10G10R10_UNORM_PACK32) ? update_lightmap_10bit_rt_comp_module : update_lightmap_8bit_rt_comp_module;
@@ -3379,7 +4091,7 @@ static void R_CreateUpdateLightmapPipelines ()
 		infos.compute_pipeline.layout = vulkan_globals.update_lightmap_rt_pipeline.layout.handle;
 		assert (vulkan_globals.update_lightmap_rt_pipeline.handle == VK_NULL_HANDLE);
 		err = vkCreateComputePipelines (
-			vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.update_lightmap_rt_pipeline.handle);
+			vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.update_lightmap_rt_pipeline.handle);
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateComputePipelines failed (update_lightmap_rt_pipeline)");
 		GL_SetObjectName ((uint64_t)vulkan_globals.update_lightmap_rt_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "update_lightmap_rt");
@@ -3409,7 +4121,8 @@ static void R_CreateIndirectComputePipelines ()
 	infos.compute_pipeline.layout = vulkan_globals.indirect_draw_pipeline.layout.handle;
 
 	assert (vulkan_globals.indirect_draw_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.indirect_draw_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.indirect_draw_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (indirect_draw_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.indirect_draw_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "indirect_draw");
@@ -3418,56 +4131,212 @@ static void R_CreateIndirectComputePipelines ()
 	infos.compute_pipeline.stage = compute_shader_stage;
 
 	assert (vulkan_globals.indirect_clear_pipeline.handle == VK_NULL_HANDLE);
-	err = vkCreateComputePipelines (vulkan_globals.device, VK_NULL_HANDLE, 1, &infos.compute_pipeline, NULL, &vulkan_globals.indirect_clear_pipeline.handle);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.indirect_clear_pipeline.handle);
 	if (err != VK_SUCCESS)
 		Sys_Error ("vkCreateComputePipelines failed (indirect_clear_pipeline)");
 	GL_SetObjectName ((uint64_t)vulkan_globals.indirect_clear_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "indirect_clear");
+
+	compute_shader_stage.module = indirect_mark_comp_module;
+	infos.compute_pipeline.stage = compute_shader_stage;
+	infos.compute_pipeline.layout = vulkan_globals.indirect_mark_pipeline.layout.handle;
+
+	assert (vulkan_globals.indirect_mark_pipeline.handle == VK_NULL_HANDLE);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.indirect_mark_pipeline.handle);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateComputePipelines failed (indirect_mark_pipeline)");
+	GL_SetObjectName ((uint64_t)vulkan_globals.indirect_mark_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "indirect_mark");
+}
+
+/*
+===============
+R_CreateOcclusionDepthPipeline
+===============
+*/
+static void R_CreateOcclusionDepthPipeline ()
+{
+	if (!vulkan_globals.sampled_depth)
+		return;
+
+	VkResult				err;
+	pipeline_create_infos_t infos;
+	R_InitDefaultStates (&infos);
+
+	ZEROED_STRUCT (VkPipelineShaderStageCreateInfo, compute_shader_stage);
+	compute_shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compute_shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compute_shader_stage.module = (vulkan_globals.sample_count != VK_SAMPLE_COUNT_1_BIT) ? occlusion_depth_ms_comp_module : occlusion_depth_comp_module;
+	compute_shader_stage.pName = "main";
+
+	memset (&infos.compute_pipeline, 0, sizeof (infos.compute_pipeline));
+	infos.compute_pipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	infos.compute_pipeline.stage = compute_shader_stage;
+	infos.compute_pipeline.layout = vulkan_globals.occlusion_depth_pipeline.layout.handle;
+
+	assert (vulkan_globals.occlusion_depth_pipeline.handle == VK_NULL_HANDLE);
+	err = vkCreateComputePipelines (
+		vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.occlusion_depth_pipeline.handle);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateComputePipelines failed (occlusion_depth_pipeline)");
+	GL_SetObjectName ((uint64_t)vulkan_globals.occlusion_depth_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "occlusion_depth");
+}
+
+/*
+===============
+R_CreateShadingRatePipeline
+===============
+*/
+static void R_CreateShadingRatePipeline ()
+{
+	if (!vulkan_globals.fragment_shading_rate)
+		return;
+
+	VkResult				err;
+	pipeline_create_infos_t infos;
+	R_InitDefaultStates (&infos);
+
+	ZEROED_STRUCT (VkPipelineShaderStageCreateInfo, compute_shader_stage);
+	compute_shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compute_shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compute_shader_stage.module = shading_rate_comp_module;
+	compute_shader_stage.pName = "main";
+
+	memset (&infos.compute_pipeline, 0, sizeof (infos.compute_pipeline));
+	infos.compute_pipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	infos.compute_pipeline.stage = compute_shader_stage;
+	infos.compute_pipeline.layout = vulkan_globals.shading_rate_pipeline.layout.handle;
+
+	assert (vulkan_globals.shading_rate_pipeline.handle == VK_NULL_HANDLE);
+	err = vkCreateComputePipelines (vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.shading_rate_pipeline.handle);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateComputePipelines failed (shading_rate_pipeline)");
+	GL_SetObjectName ((uint64_t)vulkan_globals.shading_rate_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "shading_rate");
+}
+
+/*
+===============
+R_CreateAliasCullPipeline
+===============
+*/
+static void R_CreateAliasCullPipeline ()
+{
+	VkResult				err;
+	pipeline_create_infos_t infos;
+	R_InitDefaultStates (&infos);
+
+	ZEROED_STRUCT (VkPipelineShaderStageCreateInfo, compute_shader_stage);
+	compute_shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compute_shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compute_shader_stage.module = alias_cull_comp_module;
+	compute_shader_stage.pName = "main";
+
+	memset (&infos.compute_pipeline, 0, sizeof (infos.compute_pipeline));
+	infos.compute_pipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	infos.compute_pipeline.stage = compute_shader_stage;
+	infos.compute_pipeline.layout = vulkan_globals.alias_cull_pipeline.layout.handle;
+
+	assert (vulkan_globals.alias_cull_pipeline.handle == VK_NULL_HANDLE);
+	err = vkCreateComputePipelines (vulkan_globals.device, vulkan_globals.pipeline_cache, 1, &infos.compute_pipeline, NULL, &vulkan_globals.alias_cull_pipeline.handle);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateComputePipelines failed (alias_cull_pipeline)");
+	GL_SetObjectName ((uint64_t)vulkan_globals.alias_cull_pipeline.handle, VK_OBJECT_TYPE_PIPELINE, "alias_cull");
+}
+
+typedef struct
+{
+	VkShaderModule		*module;
+	const unsigned char *code;
+	int					 size;
+	int					 decompressed_size;
+	const char			*name;
+	qboolean			 create;
+} shader_module_create_t;
+
+/*
+===============
+R_CreateShaderModuleTask
+
+Modules that are not created are never inflated
+===============
+*/
+static void R_CreateShaderModuleTask (int index, shader_module_create_t **modules)
+{
+	shader_module_create_t *module = &(*modules)[index];
+	if (!module->create)
+	{
+		*module->module = VK_NULL_HANDLE;
+		return;
+	}
+
+	byte		*spirv = (byte *)Mem_AllocNonZero (module->decompressed_size);
+	const size_t size = tinfl_decompress_mem_to_mem (spirv, module->decompressed_size, module->code, module->size, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+	if (size != (size_t)module->decompressed_size)
+		Sys_Error ("Failed to decompress shader %s", module->name);
+	*module->module = R_CreateShaderModule (spirv, module->decompressed_size, module->name);
+	Mem_Free (spirv);
 }
 
 /*
 ===============
 R_CreateShaderModules
+
+vkCreateShaderModule is thread safe and some drivers already compile in it, so the modules are created in parallel
 ===============
 */
 static void R_CreateShaderModules ()
 {
-	CREATE_SHADER_MODULE (basic_vert);
-	CREATE_SHADER_MODULE (basic_frag);
-	CREATE_SHADER_MODULE (basic_alphatest_frag);
-	CREATE_SHADER_MODULE (basic_notex_frag);
-	CREATE_SHADER_MODULE (world_vert);
-	CREATE_SHADER_MODULE (world_frag);
-	CREATE_SHADER_MODULE (alias_vert);
-	CREATE_SHADER_MODULE (alias_frag);
-	CREATE_SHADER_MODULE (alias_alphatest_frag);
-	CREATE_SHADER_MODULE (md5_vert);
-	CREATE_SHADER_MODULE (sky_layer_vert);
-	CREATE_SHADER_MODULE (sky_layer_frag);
-	CREATE_SHADER_MODULE (sky_box_frag);
-	CREATE_SHADER_MODULE (sky_cube_vert);
-	CREATE_SHADER_MODULE (sky_cube_frag);
-	CREATE_SHADER_MODULE (postprocess_vert);
-	CREATE_SHADER_MODULE (postprocess_frag);
-	CREATE_SHADER_MODULE (screen_effects_8bit_comp);
-	CREATE_SHADER_MODULE (screen_effects_8bit_scale_comp);
-	CREATE_SHADER_MODULE_COND (screen_effects_8bit_scale_sops_comp, vulkan_globals.screen_effects_sops);
-	CREATE_SHADER_MODULE (screen_effects_10bit_comp);
-	CREATE_SHADER_MODULE (screen_effects_10bit_scale_comp);
-	CREATE_SHADER_MODULE_COND (screen_effects_10bit_scale_sops_comp, vulkan_globals.screen_effects_sops);
-	CREATE_SHADER_MODULE (cs_tex_warp_comp);
-	CREATE_SHADER_MODULE (indirect_comp);
-	CREATE_SHADER_MODULE (indirect_clear_comp);
-	CREATE_SHADER_MODULE (showtris_vert);
-	CREATE_SHADER_MODULE (showtris_frag);
-	CREATE_SHADER_MODULE (update_lightmap_8bit_comp);
-	CREATE_SHADER_MODULE (update_lightmap_10bit_comp);
-	CREATE_SHADER_MODULE_COND (update_lightmap_8bit_rt_comp, vulkan_globals.ray_query);
-	CREATE_SHADER_MODULE_COND (update_lightmap_10bit_rt_comp, vulkan_globals.ray_query);
+	shader_module_create_t modules[] = {
+		CREATE_SHADER_MODULE (basic_vert),
+		CREATE_SHADER_MODULE (basic_frag),
+		CREATE_SHADER_MODULE (basic_alphatest_frag),
+		CREATE_SHADER_MODULE (basic_notex_frag),
+		CREATE_SHADER_MODULE (world_vert),
+		CREATE_SHADER_MODULE (world_frag),
+		CREATE_SHADER_MODULE (world_indirect_vert),
+		CREATE_SHADER_MODULE (alias_vert),
+		CREATE_SHADER_MODULE (alias_instanced_vert),
+		CREATE_SHADER_MODULE (alias_cull_comp),
+		CREATE_SHADER_MODULE (alias_frag),
+		CREATE_SHADER_MODULE (alias_alphatest_frag),
+		CREATE_SHADER_MODULE (md5_vert),
+		CREATE_SHADER_MODULE (particles_gpu_vert),
+		CREATE_SHADER_MODULE (sky_layer_vert),
+		CREATE_SHADER_MODULE (sky_layer_frag),
+		CREATE_SHADER_MODULE (sky_box_frag),
+		CREATE_SHADER_MODULE (sky_cube_vert),
+		CREATE_SHADER_MODULE (sky_cube_frag),
+		CREATE_SHADER_MODULE (sky_cache_comp),
+		CREATE_SHADER_MODULE (postprocess_vert),
+		CREATE_SHADER_MODULE (postprocess_frag),
+		CREATE_SHADER_MODULE (screen_effects_8bit_comp),
+		CREATE_SHADER_MODULE_COND (screen_effects_8bit_scale_sops_comp, vulkan_globals.screen_effects_sops),
+		CREATE_SHADER_MODULE (screen_effects_10bit_comp),
+		CREATE_SHADER_MODULE_COND (screen_effects_10bit_scale_sops_comp, vulkan_globals.screen_effects_sops),
+		CREATE_SHADER_MODULE (cs_tex_warp_comp),
+		CREATE_SHADER_MODULE (indirect_comp),
+		CREATE_SHADER_MODULE (indirect_clear_comp),
+		CREATE_SHADER_MODULE (indirect_mark_comp),
+		CREATE_SHADER_MODULE_COND (occlusion_depth_comp, vulkan_globals.sampled_depth),
+		CREATE_SHADER_MODULE_COND (occlusion_depth_ms_comp, vulkan_globals.sampled_depth),
+		CREATE_SHADER_MODULE_COND (shading_rate_comp, vulkan_globals.fragment_shading_rate),
+		CREATE_SHADER_MODULE (showtris_vert),
+		CREATE_SHADER_MODULE (showtris_frag),
+		CREATE_SHADER_MODULE (update_lightmap_8bit_comp),
+		CREATE_SHADER_MODULE (update_lightmap_10bit_comp),
+		CREATE_SHADER_MODULE_COND (update_lightmap_8bit_rt_comp, vulkan_globals.ray_query),
+		CREATE_SHADER_MODULE_COND (update_lightmap_10bit_rt_comp, vulkan_globals.ray_query),
 #ifdef _DEBUG
-	CREATE_SHADER_MODULE_COND (ray_debug_comp, vulkan_globals.ray_query);
+		CREATE_SHADER_MODULE_COND (ray_debug_comp, vulkan_globals.ray_query),
 #endif
-	CREATE_SHADER_MODULE_COND (mesh_interpolate_comp, vulkan_globals.ray_query);
-	CREATE_SHADER_MODULE_COND (skinning_comp, vulkan_globals.ray_query);
+		CREATE_SHADER_MODULE_COND (mesh_interpolate_comp, vulkan_globals.ray_query),
+		CREATE_SHADER_MODULE_COND (skinning_comp, vulkan_globals.ray_query),
+	};
+	shader_module_create_t *modules_ptr = modules;
+
+	task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit (
+		(task_indexed_func_t)R_CreateShaderModuleTask, countof (modules), &modules_ptr, sizeof (modules_ptr));
+	Task_Join (task, TASK_TIMEOUT_INFINITE);
 }
 
 /*
@@ -3483,26 +4352,33 @@ static void R_DestroyShaderModules ()
 	DESTROY_SHADER_MODULE (basic_notex_frag);
 	DESTROY_SHADER_MODULE (world_vert);
 	DESTROY_SHADER_MODULE (world_frag);
+	DESTROY_SHADER_MODULE (world_indirect_vert);
 	DESTROY_SHADER_MODULE (alias_vert);
+	DESTROY_SHADER_MODULE (alias_instanced_vert);
+	DESTROY_SHADER_MODULE (alias_cull_comp);
 	DESTROY_SHADER_MODULE (alias_frag);
 	DESTROY_SHADER_MODULE (alias_alphatest_frag);
 	DESTROY_SHADER_MODULE (md5_vert);
+	DESTROY_SHADER_MODULE (particles_gpu_vert);
 	DESTROY_SHADER_MODULE (sky_layer_vert);
 	DESTROY_SHADER_MODULE (sky_layer_frag);
 	DESTROY_SHADER_MODULE (sky_box_frag);
 	DESTROY_SHADER_MODULE (sky_cube_vert);
 	DESTROY_SHADER_MODULE (sky_cube_frag);
+	DESTROY_SHADER_MODULE (sky_cache_comp);
 	DESTROY_SHADER_MODULE (postprocess_vert);
 	DESTROY_SHADER_MODULE (postprocess_frag);
 	DESTROY_SHADER_MODULE (screen_effects_8bit_comp);
-	DESTROY_SHADER_MODULE (screen_effects_8bit_scale_comp);
 	DESTROY_SHADER_MODULE (screen_effects_8bit_scale_sops_comp);
 	DESTROY_SHADER_MODULE (screen_effects_10bit_comp);
-	DESTROY_SHADER_MODULE (screen_effects_10bit_scale_comp);
 	DESTROY_SHADER_MODULE (screen_effects_10bit_scale_sops_comp);
 	DESTROY_SHADER_MODULE (cs_tex_warp_comp);
 	DESTROY_SHADER_MODULE (indirect_comp);
 	DESTROY_SHADER_MODULE (indirect_clear_comp);
+	DESTROY_SHADER_MODULE (indirect_mark_comp);
+	DESTROY_SHADER_MODULE (occlusion_depth_comp);
+	DESTROY_SHADER_MODULE (occlusion_depth_ms_comp);
+	DESTROY_SHADER_MODULE (shading_rate_comp);
 	DESTROY_SHADER_MODULE (showtris_vert);
 	DESTROY_SHADER_MODULE (showtris_frag);
 	DESTROY_SHADER_MODULE (update_lightmap_8bit_comp);
@@ -3514,6 +4390,155 @@ static void R_DestroyShaderModules ()
 	DESTROY_SHADER_MODULE (skinning_comp);
 }
 
+// The pipeline cache file starts with this header, data_size bytes of
+// vkGetPipelineCacheData follow. Everything before data_size has to match the device.
+typedef struct pipeline_cache_header_s
+{
+	char	 magic[4];
+	uint32_t vendor_id;
+	uint32_t device_id;
+	uint32_t driver_version;
+	uint8_t	 uuid[VK_UUID_SIZE]; // VkPhysicalDeviceProperties::pipelineCacheUUID
+	uint32_t data_size;
+} pipeline_cache_header_t;
+
+#define PIPELINE_CACHE_MAGIC	"VKPC"
+#define MAX_PIPELINE_CACHE_SIZE (64 * 1024 * 1024)
+
+static size_t pipeline_cache_saved_size;
+
+// Rarely used pipelines are compiled on a worker once R_CreatePipelines returns,
+// the shader modules are kept until R_UpdateDeferredPipelines joined it
+static task_handle_t deferred_pipelines_task = INVALID_TASK_HANDLE;
+
+/*
+===============
+R_PipelineCacheHeader
+===============
+*/
+static void R_PipelineCacheHeader (pipeline_cache_header_t *header, char *path, size_t path_size)
+{
+	memset (header, 0, sizeof (*header));
+	memcpy (header->magic, PIPELINE_CACHE_MAGIC, sizeof (header->magic));
+	header->vendor_id = vulkan_globals.device_properties.vendorID;
+	header->device_id = vulkan_globals.device_properties.deviceID;
+	header->driver_version = vulkan_globals.device_properties.driverVersion;
+	memcpy (header->uuid, vulkan_globals.device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+	q_snprintf (path, path_size, "%s/pipeline.cache", host_parms->userdir);
+}
+
+/*
+===============
+R_InitPipelineCache
+
+Creates vulkan_globals.pipeline_cache from the cache file of the last run if it was
+written by the same device and driver. -nopipelinecache starts with an empty cache
+and never writes the file.
+===============
+*/
+void R_InitPipelineCache (void)
+{
+	void  *data = NULL;
+	size_t data_size = 0;
+
+	if (!COM_CheckParm ("-nopipelinecache"))
+	{
+		pipeline_cache_header_t header, file_header;
+		char					path[MAX_OSPATH];
+		R_PipelineCacheHeader (&header, path, sizeof (path));
+
+		FILE	*f = fopen (path, "rb");
+		qboolean valid = f && (fread (&file_header, sizeof (file_header), 1, f) == 1);
+		valid = valid && (memcmp (&file_header, &header, offsetof (pipeline_cache_header_t, data_size)) == 0);
+		valid = valid && (file_header.data_size > 0) && (file_header.data_size <= MAX_PIPELINE_CACHE_SIZE);
+		if (valid)
+		{
+			data = Mem_AllocNonZero (file_header.data_size);
+			valid = fread (data, file_header.data_size, 1, f) == 1;
+		}
+		if (f)
+			fclose (f);
+
+		if (valid)
+		{
+			data_size = file_header.data_size;
+			Con_DPrintf ("Loaded pipeline cache %s (%u bytes)\n", path, (unsigned int)data_size);
+		}
+		else
+		{
+			Mem_Free (data);
+			data = NULL;
+			if (f)
+				Con_DPrintf ("Ignoring stale pipeline cache %s\n", path);
+		}
+	}
+
+	ZEROED_STRUCT (VkPipelineCacheCreateInfo, pipeline_cache_create_info);
+	pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipeline_cache_create_info.initialDataSize = data_size;
+	pipeline_cache_create_info.pInitialData = data;
+	VkResult err = vkCreatePipelineCache (vulkan_globals.device, &pipeline_cache_create_info, NULL, &vulkan_globals.pipeline_cache);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreatePipelineCache failed");
+	GL_SetObjectName ((uint64_t)vulkan_globals.pipeline_cache, VK_OBJECT_TYPE_PIPELINE_CACHE, "Pipeline cache");
+
+	pipeline_cache_saved_size = data_size;
+	Mem_Free (data);
+}
+
+/*
+===============
+R_SavePipelineCache
+
+Writes the cache file if creating pipelines added to the cache since it was loaded
+or saved
+===============
+*/
+static void R_SavePipelineCache (void)
+{
+	if (COM_CheckParm ("-nopipelinecache"))
+		return;
+
+	size_t data_size = 0;
+	if ((vkGetPipelineCacheData (vulkan_globals.device, vulkan_globals.pipeline_cache, &data_size, NULL) != VK_SUCCESS) || (data_size == 0) ||
+		(data_size == pipeline_cache_saved_size) || (data_size > MAX_PIPELINE_CACHE_SIZE))
+		return;
+
+	void *data = Mem_AllocNonZero (data_size);
+	if (vkGetPipelineCacheData (vulkan_globals.device, vulkan_globals.pipeline_cache, &data_size, data) == VK_SUCCESS)
+	{
+		pipeline_cache_header_t header;
+		char					path[MAX_OSPATH];
+		R_PipelineCacheHeader (&header, path, sizeof (path));
+		header.data_size = data_size;
+
+		FILE *f = fopen (path, "wb");
+		if (f)
+		{
+			fwrite (&header, sizeof (header), 1, f);
+			fwrite (data, data_size, 1, f);
+			fclose (f);
+			pipeline_cache_saved_size = data_size;
+			Con_DPrintf ("Wrote pipeline cache %s (%u bytes)\n", path, (unsigned int)data_size);
+		}
+		else
+			Con_DPrintf ("Couldn't write pipeline cache %s\n", path);
+	}
+	Mem_Free (data);
+}
+
+/*
+===============
+R_CreateDeferredPipelines
+===============
+*/
+static void R_CreateDeferredPipelines (void *unused)
+{
+	R_CreateShowTrisPipelines ();
+	R_CreateUpdateLightmapPipelines (true);
+	R_CreateRayDebugPipelines ();
+}
+
 /*
 ===============
 R_CreatePipelines
@@ -3532,18 +4557,41 @@ void R_CreatePipelines ()
 	R_CreateFTEParticlesPipelines ();
 	R_CreateSpritesPipelines ();
 	R_CreateSkyPipelines ();
-	R_CreateShowTrisPipelines ();
 	R_CreateWorldPipelines ();
 	R_CreateAliasPipelines ();
+	R_CreateAliasInstancedPipelines ();
 	R_CreateMD5Pipelines ();
 	R_CreatePostprocessPipelines ();
 	R_CreateScreenEffectsPipelines ();
-	R_CreateUpdateLightmapPipelines ();
+	R_CreateUpdateLightmapPipelines (false);
 	R_CreateIndirectComputePipelines ();
-	R_CreateRayDebugPipelines ();
+	R_CreateOcclusionDepthPipeline ();
+	R_CreateShadingRatePipeline ();
+	R_CreateAliasCullPipeline ();
 	R_CreateAnimComputePipelines ();
 
+	assert (deferred_pipelines_task == INVALID_TASK_HANDLE);
+	deferred_pipelines_task = Task_AllocateAssignFuncAndSubmit (R_CreateDeferredPipelines, NULL, 0);
+}
+
+/*
+===============
+R_UpdateDeferredPipelines
+
+Finishes the pipelines of R_CreateDeferredPipelines if they are done, or waits for
+them if wait is set. Has to be called with wait before any of them is used.
+===============
+*/
+void R_UpdateDeferredPipelines (qboolean wait)
+{
+	if (deferred_pipelines_task == INVALID_TASK_HANDLE)
+		return;
+	if (!Task_Join (deferred_pipelines_task, wait ? TASK_TIMEOUT_INFINITE : 0))
+		return;
+	deferred_pipelines_task = INVALID_TASK_HANDLE;
+
 	R_DestroyShaderModules ();
+	R_SavePipelineCache ();
 }
 
 /*
@@ -3553,6 +4601,8 @@ R_DestroyPipelines
 */
 void R_DestroyPipelines (void)
 {
+	R_UpdateDeferredPipelines (true);
+
 	int i;
 	for (i = 0; i < 2; ++i)
 	{
@@ -3567,11 +4617,15 @@ void R_DestroyPipelines (void)
 	{
 		vkDestroyPipeline (vulkan_globals.device, vulkan_globals.world_pipelines[i].handle, NULL);
 		vulkan_globals.world_pipelines[i].handle = VK_NULL_HANDLE;
+		vkDestroyPipeline (vulkan_globals.device, vulkan_globals.world_indirect_pipelines[i].handle, NULL);
+		vulkan_globals.world_indirect_pipelines[i].handle = VK_NULL_HANDLE;
 	}
 	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.raster_tex_warp_pipeline.handle, NULL);
 	vulkan_globals.raster_tex_warp_pipeline.handle = VK_NULL_HANDLE;
 	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.particle_pipeline.handle, NULL);
 	vulkan_globals.particle_pipeline.handle = VK_NULL_HANDLE;
+	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.particle_gpu_pipeline.handle, NULL);
+	vulkan_globals.particle_gpu_pipeline.handle = VK_NULL_HANDLE;
 #ifdef PSET_SCRIPT
 	for (i = 0; i < 8; ++i)
 	{
@@ -3600,6 +4654,8 @@ void R_DestroyPipelines (void)
 	}
 	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.sky_box_pipeline.handle, NULL);
 	vulkan_globals.sky_box_pipeline.handle = VK_NULL_HANDLE;
+	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.sky_cache_pipeline.handle, NULL);
+	vulkan_globals.sky_cache_pipeline.handle = VK_NULL_HANDLE;
 	for (i = 0; i < MODEL_PIPELINE_COUNT; ++i)
 	{
 		if (vulkan_globals.alias_pipelines[i].handle != VK_NULL_HANDLE)
@@ -3607,6 +4663,11 @@ void R_DestroyPipelines (void)
 			vkDestroyPipeline (vulkan_globals.device, vulkan_globals.alias_pipelines[i].handle, NULL);
 			vulkan_globals.alias_pipelines[i].handle = VK_NULL_HANDLE;
 		}
+		if (vulkan_globals.alias_instanced_pipelines[i].handle != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline (vulkan_globals.device, vulkan_globals.alias_instanced_pipelines[i].handle, NULL);
+			vulkan_globals.alias_instanced_pipelines[i].handle = VK_NULL_HANDLE;
+		}
 		if (vulkan_globals.md5_pipelines[i].handle != VK_NULL_HANDLE)
 		{
 			vkDestroyPipeline (vulkan_globals.device, vulkan_globals.md5_pipelines[i].handle, NULL);
@@ -3665,6 +4726,20 @@ void R_DestroyPipelines (void)
 	vulkan_globals.indirect_draw_pipeline.handle = VK_NULL_HANDLE;
 	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.indirect_clear_pipeline.handle, NULL);
 	vulkan_globals.indirect_clear_pipeline.handle = VK_NULL_HANDLE;
+	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.indirect_mark_pipeline.handle, NULL);
+	vulkan_globals.indirect_mark_pipeline.handle = VK_NULL_HANDLE;
+	vkDestroyPipeline (vulkan_globals.device, vulkan_globals.alias_cull_pipeline.handle, NULL);
+	vulkan_globals.alias_cull_pipeline.handle = VK_NULL_HANDLE;
+	if (vulkan_globals.occlusion_depth_pipeline.handle != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline (vulkan_globals.device, vulkan_globals.occlusion_depth_pipeline.handle, NULL);
+		vulkan_globals.occlusion_depth_pipeline.handle = VK_NULL_HANDLE;
+	}
+	if (vulkan_globals.shading_rate_pipeline.handle != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline (vulkan_globals.device, vulkan_globals.shading_rate_pipeline.handle, NULL);
+		vulkan_globals.shading_rate_pipeline.handle = VK_NULL_HANDLE;
+	}
 }
 
 /*
@@ -3716,6 +4791,7 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_waterquality);
 	Cvar_RegisterVariable (&r_waterwarp);
 	Cvar_RegisterVariable (&r_waterwarpcompute);
+	Cvar_RegisterVariable (&r_waterwarprate);
 	Cvar_RegisterVariable (&r_flatlightstyles);
 	Cvar_RegisterVariable (&r_lerplightstyles);
 	Cvar_RegisterVariable (&r_oldskyleaf);
@@ -3728,6 +4804,7 @@ void R_Init (void)
 	Cvar_RegisterVariable (&gl_fullbrights);
 	Cvar_SetCallback (&gl_fullbrights, GL_Fullbrights_f);
 	Cvar_RegisterVariable (&r_lerpmodels);
+	Cvar_RegisterVariable (&r_alias_instancing);
 	Cvar_RegisterVariable (&r_lerpmove);
 	Cvar_RegisterVariable (&r_lerpturn);
 	Cvar_RegisterVariable (&r_nolerp_list);
@@ -3751,7 +4828,16 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_gpulightmapupdate);
 	Cvar_RegisterVariable (&r_rtshadows);
 	Cvar_SetCallback (&r_rtshadows, R_SetRTShadows_f);
+	Cvar_RegisterVariable (&r_rtshadows_blasbudget);
+	Cvar_RegisterVariable (&r_rtshadows_rate);
+	Cvar_SetCallback (&r_rtshadows_rate, R_SetRTShadowsRate_f);
 	Cvar_RegisterVariable (&r_indirect);
+	Cvar_RegisterVariable (&r_gpumarksurfaces);
+	Cvar_RegisterVariable (&r_gpualiascull);
+	Cvar_RegisterVariable (&r_occlusioncull);
+	Cvar_RegisterVariable (&r_occlusionstats);
+	Cvar_RegisterVariable (&r_worldcache);
+	Cvar_RegisterVariable (&r_lightmapcompression);
 	Cvar_RegisterVariable (&r_tasks);
 	Cvar_RegisterVariable (&r_parallelmark);
 	Cvar_RegisterVariable (&r_usesops);
@@ -3817,21 +4903,44 @@ void R_FreeDescriptorSet (VkDescriptorSet desc_set, vulkan_desc_set_layout_t *la
 	Atomic_SubUInt32 (&num_acceleration_structures, layout->num_acceleration_structures);
 }
 
+// what each playertextures slot was looked up by, the texture may be gone after a map change
+static qmodel_t *playertexture_owners[MAX_SCOREBOARD];
+static char		 playertexture_names[MAX_SCOREBOARD][64];
+
 /*
 ===============
-R_TranslatePlayerSkin -- johnfitz -- rewritten.  also, only handles new colors, not new skins
+R_ReleasePlayerTexture
+
+Drops the player's reference, and the texture itself once no other player shares it
 ===============
 */
-void R_TranslatePlayerSkin (int playernum)
+static void R_ReleasePlayerTexture (int playernum)
 {
-	int top, bottom;
+	gltexture_t *glt = playertextures[playernum];
+	int			 i;
 
-	top = (cl.scores[playernum].colors & 0xf0) >> 4;
-	bottom = cl.scores[playernum].colors & 15;
+	if (!glt)
+		return;
+	playertextures[playernum] = NULL;
+
+	for (i = 0; i < MAX_SCOREBOARD; i++)
+		if (playertextures[i] == glt)
+			return;
+
+	// the owner frees its textures when it gets evicted, only free it if it's still there
+	if (TexMgr_FindTexture (playertexture_owners[playernum], playertexture_names[playernum]) == glt)
+		TexMgr_FreeTexture (glt);
+}
 
+/*
+===============
+R_TranslatePlayerSkin -- johnfitz -- rewritten.  also, only handles new colors, not new skins
+===============
+*/
+void R_TranslatePlayerSkin (int playernum)
+{
 	if (!gl_nocolors.value)
-		if (playertextures[playernum])
-			TexMgr_ReloadImage (playertextures[playernum], top, bottom);
+		R_TranslateNewPlayerSkin (playernum);
 }
 
 /*
@@ -3839,14 +4948,18 @@ void R_TranslatePlayerSkin (int playernum)
 R_TranslateNewPlayerSkin -- johnfitz -- split off of TranslatePlayerSkin -- this is called when
 the skin or model actually changes, instead of just new colors
 added bug fix from bengt jardup
+
+Players with the same skin and colors share one texture, named after both, so a
+color change or a new player only uploads when nobody has that combination yet.
 ===============
 */
 void R_TranslateNewPlayerSkin (int playernum)
 {
-	char		name[64];
-	byte	   *pixels;
-	aliashdr_t *paliashdr;
-	int			skinnum;
+	char		 name[64];
+	byte		*pixels;
+	aliashdr_t	*paliashdr;
+	int			 skinnum, top, bottom;
+	gltexture_t *glt;
 
 	// get correct texture pixels
 	entity_t *currententity = &cl.entities[1 + playernum];
@@ -3873,18 +4986,27 @@ void R_TranslateNewPlayerSkin (int playernum)
 			warned = true;
 			Con_Warning ("can't recolor non-indexed player skin\n");
 		}
-		playertextures[playernum] = NULL;
+		R_ReleasePlayerTexture (playernum);
 		return;
 	}
 
-	// upload new image
-	q_snprintf (name, sizeof (name), "player_%i", playernum);
-	playertextures[playernum] = TexMgr_LoadImage (
-		currententity->model, name, paliashdr->skinwidth, paliashdr->skinheight, SRC_INDEXED, pixels, paliashdr->gltextures[skinnum][0]->source_file,
-		paliashdr->gltextures[skinnum][0]->source_offset, TEXPREF_PAD | TEXPREF_OVERWRITE);
+	top = (cl.scores[playernum].colors & 0xf0) >> 4;
+	bottom = cl.scores[playernum].colors & 15;
+
+	// upload new image, already recolored, unless another player has it
+	q_snprintf (name, sizeof (name), "player_%i_%i_%i", skinnum, top, bottom);
+	glt = TexMgr_FindTexture (currententity->model, name);
+	if (!glt)
+		glt = TexMgr_LoadColormappedImage (
+			currententity->model, name, paliashdr->skinwidth, paliashdr->skinheight, pixels, paliashdr->gltextures[skinnum][0]->source_file,
+			paliashdr->gltextures[skinnum][0]->source_offset, TEXPREF_PAD, top, bottom);
+	if (glt == playertextures[playernum])
+		return;
 
-	// now recolor it
-	R_TranslatePlayerSkin (playernum);
+	R_ReleasePlayerTexture (playernum);
+	playertextures[playernum] = glt;
+	playertexture_owners[playernum] = currententity->model;
+	q_strlcpy (playertexture_names[playernum], name, sizeof (playertexture_names[playernum]));
 }
 
 /*
@@ -3956,6 +5078,9 @@ static void R_ParseWorldspawn (void)
 	}
 }
 
+// Heap segments that are at most half full get emptied on map load
+#define HEAP_DEFRAG_MAX_OCCUPANCY 0.5f
+
 /*
 ===============
 R_NewMap
@@ -3968,10 +5093,20 @@ void R_NewMap (void)
 	for (i = 0; i < MAX_LIGHTSTYLES; i++)
 		d_lightstylevalue[i] = 264; // normal light value
 
+	// the player entities start over, so do their textures
+	for (i = 0; i < MAX_SCOREBOARD; i++)
+		R_ReleasePlayerTexture (i);
+
+	R_SaveWorldHints (); // of the previous map
+	R_LoadWorldHints ();
+
 	// clear out efrags in case the level hasn't been reloaded
-	// FIXME: is this one short?
-	for (i = 0; i < cl.worldmodel->numleafs; i++)
+	// leafs[0] is the shared solid leaf, so there are numleafs + 1 of them
+	for (i = 0; i <= cl.worldmodel->numleafs; i++)
+	{
 		cl.worldmodel->leafs[i].efrags = NULL;
+		cl.worldmodel->leafs[i].numstatics = 0;
+	}
 
 	r_viewleaf = NULL;
 	R_ClearParticles ();
@@ -3981,6 +5116,9 @@ void R_NewMap (void)
 	GL_DeleteBModelVertexBuffer ();
 
 	GL_BuildLightmaps ();
+	// Old maps leave the heaps sparse, compact them before the lightmap descriptors are written
+	TexMgr_Defragment (HEAP_DEFRAG_MAX_OCCUPANCY);
+	GLMesh_Defragment (HEAP_DEFRAG_MAX_OCCUPANCY);
 	GL_BuildBModelVertexBuffer ();
 	GL_BuildBModelAccelerationStructures ();
 	GL_PrepareSIMDAndParallelData ();
@@ -4034,6 +5172,43 @@ void R_TimeRefresh_f (void)
 	Con_Printf ("%f seconds (%f fps)\n", time, 128 / time);
 }
 
+/*
+====================
+R_AllocateUIMemory
+
+Device memory for the UI renderer's buffer and image pools, counted like the
+engine's own allocations
+====================
+*/
+VkDeviceMemory R_AllocateUIMemory (VkDeviceSize size, uint32_t memory_type_index, qboolean host)
+{
+	ZEROED_STRUCT (VkMemoryAllocateInfo, memory_allocate_info);
+	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.allocationSize = size;
+	memory_allocate_info.memoryTypeIndex = memory_type_index;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory (vulkan_globals.device, &memory_allocate_info, NULL, &memory) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	Atomic_IncrementUInt32 (&num_vulkan_ui_allocations);
+	Atomic_AddUInt64 (host ? &total_host_vulkan_allocation_size : &total_device_vulkan_allocation_size, size);
+	return memory;
+}
+
+/*
+====================
+R_FreeUIMemory
+====================
+*/
+void R_FreeUIMemory (VkDeviceMemory memory, VkDeviceSize size, qboolean host)
+{
+	if (memory == VK_NULL_HANDLE)
+		return;
+	vkFreeMemory (vulkan_globals.device, memory, NULL);
+	Atomic_DecrementUInt32 (&num_vulkan_ui_allocations);
+	Atomic_SubUInt64 (host ? &total_host_vulkan_allocation_size : &total_device_vulkan_allocation_size, size);
+}
+
 /*
 ====================
 R_AllocateVulkanMemory
@@ -4328,19 +5503,31 @@ void R_VulkanMemStats_f (void)
 	const uint32_t num_mesh_allocations = Atomic_LoadUInt32 (&num_vulkan_mesh_allocations);
 	const uint32_t num_misc_allocations = Atomic_LoadUInt32 (&num_vulkan_misc_allocations);
 	const uint32_t num_dynbuf_allocations = Atomic_LoadUInt32 (&num_vulkan_dynbuf_allocations);
+	const uint32_t num_ui_allocations = Atomic_LoadUInt32 (&num_vulkan_ui_allocations);
 
 	Con_Printf (
 		"Vulkan allocations: %" SDL_PRIu32 "\n",
-		num_tex_allocations + num_bmodel_allocations + num_mesh_allocations + num_misc_allocations + num_dynbuf_allocations);
+		num_tex_allocations + num_bmodel_allocations + num_mesh_allocations + num_misc_allocations + num_dynbuf_allocations + num_ui_allocations);
 	Con_Printf (" Tex:    %" SDL_PRIu32 "\n", num_tex_allocations);
 	Con_Printf (" BModel: %" SDL_PRIu32 "\n", num_bmodel_allocations);
 	Con_Printf (" Mesh:   %" SDL_PRIu32 "\n", num_mesh_allocations);
 	Con_Printf (" Misc:   %" SDL_PRIu32 "\n", num_misc_allocations);
 	Con_Printf (" DynBuf: %" SDL_PRIu32 "\n", num_dynbuf_allocations);
+	Con_Printf (" UI:     %" SDL_PRIu32 "\n", num_ui_allocations);
+
+	Con_Printf ("Dynamic buffers (size, last frame, high water KB):\n");
+	for (int i = 0; i < NUM_DYNBUF_TYPES; ++i)
+		Con_Printf (
+			" %-8s %6" SDL_PRIu32 " %6" SDL_PRIu32 " %6" SDL_PRIu32 "\n", dynbuf_infos[i].name, *dynbuf_infos[i].current_size / 1024,
+			dynbuf_infos[i].last_frame_used / 1024, dynbuf_infos[i].high_water / 1024);
+
+	uint64_t	   ui_image_bytes;
+	const uint32_t num_ui_images = TexMgr_GetExternalAllocations (&ui_image_bytes);
 
 	Con_Printf ("Heaps:\n");
 	R_PrintHeapStats ("Tex", TexMgr_GetHeapStats ());
 	R_PrintHeapStats ("Mesh", R_GetMeshHeapStats ());
+	Con_Printf (" UI images in Tex: %" SDL_PRIu32 " (%" SDL_PRIu64 " KB)\n", num_ui_images, ui_image_bytes / 1024);
 
 	Con_Printf ("Descriptors:\n");
 	Con_Printf (" Combined image samplers: %" SDL_PRIu32 "\n", Atomic_LoadUInt32 (&num_vulkan_combined_image_samplers));
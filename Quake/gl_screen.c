@@ -95,6 +95,7 @@ cvar_t scr_conscale = {"scr_conscale", "1", CVAR_ARCHIVE};
 cvar_t scr_crosshairscale = {"scr_crosshairscale", "1", CVAR_ARCHIVE};
 cvar_t scr_showfps = {"scr_showfps", "0", CVAR_ARCHIVE};
 cvar_t scr_clock = {"scr_clock", "0", CVAR_NONE};
+cvar_t scr_shownetbuffer = {"scr_shownetbuffer", "0", CVAR_NONE}; // cl_netbuffer health
 cvar_t scr_autoclock = {"scr_autoclock", "1", CVAR_ARCHIVE};
 cvar_t scr_usekfont = {"scr_usekfont", "0", CVAR_NONE}; // 2021 re-release
 cvar_t scr_style = {"scr_style", "0", CVAR_ARCHIVE};
@@ -103,6 +104,14 @@ cvar_t scr_fontscale = {"scr_fontscale", "1", CVAR_ARCHIVE};
 cvar_t scr_dpiscale = {"scr_dpiscale", "1", CVAR_ROM};
 #ifdef USE_RMLUI
 cvar_t ui_speeds = {"ui_speeds", "0", CVAR_NONE};
+cvar_t ui_layer_cache = {"ui_layer_cache", "1", CVAR_NONE};
+cvar_t ui_lua_budget = {"ui_lua_budget", "2", CVAR_NONE};
+cvar_t ui_lua_gc_budget = {"ui_lua_gc_budget", "0.5", CVAR_NONE};
+cvar_t ui_trace_threshold = {"ui_trace_threshold", "0", CVAR_NONE};
+cvar_t ui_tickrate = {"ui_tickrate", "0", CVAR_ARCHIVE};
+cvar_t ui_menuidle = {"ui_menuidle", "2", CVAR_ARCHIVE}; // seconds without input before an open menu stops updating, 0 never
+cvar_t ui_hot_reload = {"ui_hot_reload", "0", CVAR_NONE};
+cvar_t ui_perfoverlay = {"ui_perfoverlay", "0", CVAR_NONE}; // frame time graphs from the frame stats ring
 #endif
 
 cvar_t scr_viewsize = {"viewsize", "100", CVAR_ARCHIVE};
@@ -619,6 +628,7 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_crosshairscale);
 	Cvar_RegisterVariable (&scr_showfps);
 	Cvar_RegisterVariable (&scr_clock);
+	Cvar_RegisterVariable (&scr_shownetbuffer);
 	Cvar_RegisterVariable (&scr_autoclock);
 	// johnfitz
 	Cvar_RegisterVariable (&scr_usekfont); // 2021 re-release
@@ -645,6 +655,14 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_dpiscale);
 #ifdef USE_RMLUI
 	Cvar_RegisterVariable (&ui_speeds);
+	Cvar_RegisterVariable (&ui_layer_cache);
+	Cvar_RegisterVariable (&ui_lua_budget);
+	Cvar_RegisterVariable (&ui_lua_gc_budget);
+	Cvar_RegisterVariable (&ui_trace_threshold);
+	Cvar_RegisterVariable (&ui_tickrate);
+	Cvar_RegisterVariable (&ui_menuidle);
+	Cvar_RegisterVariable (&ui_hot_reload);
+	Cvar_RegisterVariable (&ui_perfoverlay);
 #endif
 	Cvar_RegisterVariable (&cl_gun_fovscale);
 
@@ -830,6 +848,53 @@ static void SCR_DrawDevStats (cb_context_t *cbx)
 	Draw_String (cbx, x, (y++) * CHARACTER_SIZE - x, str);
 }
 
+/*
+==============
+SCR_DrawNetBuffer
+
+How far ahead of the drawn entities the server messages are, and how
+often they ran out
+==============
+*/
+static void SCR_DrawNetBuffer (cb_context_t *cbx)
+{
+	static double oldtime = 0;
+	static float  starved = 0;
+	char		  str[40];
+	int			  y = 25 - 5 - (devstats.value ? 9 : 0);
+	int			  x = 0;
+
+	if (!scr_shownetbuffer.value || cls.state != ca_connected)
+		return;
+
+	// update the ratio every second
+	if (realtime - oldtime > 1.0 || realtime < oldtime)
+	{
+		starved = cl.netbuffer.frames ? 100.f * cl.netbuffer.starved / cl.netbuffer.frames : 0.f;
+		cl.netbuffer.frames = cl.netbuffer.starved = 0;
+		oldtime = realtime;
+	}
+
+	GL_SetCanvas (cbx, CANVAS_BOTTOMLEFT);
+
+	Draw_Fill (cbx, x, y * CHARACTER_SIZE, 19 * CHARACTER_SIZE, 5 * CHARACTER_SIZE, 0, 0.5); // dark rectangle
+
+	q_snprintf (str, sizeof (str), "netbuffer|     ms");
+	Draw_String (cbx, x, (y++) * CHARACTER_SIZE - x, str);
+
+	q_snprintf (str, sizeof (str), "Jitter   |%7.1f", cl.netbuffer.jitter * 1000.f);
+	Draw_String (cbx, x, (y++) * CHARACTER_SIZE - x, str);
+
+	q_snprintf (str, sizeof (str), "Delay    |%7.1f", cl.netbuffer.delay * 1000.f);
+	Draw_String (cbx, x, (y++) * CHARACTER_SIZE - x, str);
+
+	q_snprintf (str, sizeof (str), "Buffered |%7.1f", cl.netbuffer.delay ? (cl.mtime[0] - cl.netbuffer.time) * 1000.f : 0.f);
+	Draw_String (cbx, x, (y++) * CHARACTER_SIZE - x, str);
+
+	q_snprintf (str, sizeof (str), "Starved  |%6.1f%%", starved);
+	Draw_String (cbx, x, (y++) * CHARACTER_SIZE - x, str);
+}
+
 /*
 ==============
 SCR_DrawTurtle
@@ -1236,17 +1301,13 @@ static void SCR_DrawGUI (void *unused)
 	}
 	else if (cl.intermission == 1 && key_dest == key_game) // end of level
 	{
-#ifdef USE_RMLUI
-		UI_SyncGameState (cl.stats, MAX_CL_STATS, cl.items, cl.intermission, cl.gametype, cl.maxclients, cl.levelname, cl.mapname, cl.time);
-#else
+#ifndef USE_RMLUI
 		Sbar_IntermissionOverlay (cbx);
 #endif
 	}
 	else if (cl.intermission == 2 && key_dest == key_game) // end of episode
 	{
-#ifdef USE_RMLUI
-		UI_SyncGameState (cl.stats, MAX_CL_STATS, cl.items, cl.intermission, cl.gametype, cl.maxclients, cl.levelname, cl.mapname, cl.time);
-#else
+#ifndef USE_RMLUI
 		Sbar_FinaleOverlay (cbx);
 		SCR_CheckDrawCenterString (cbx);
 #endif
@@ -1269,6 +1330,7 @@ static void SCR_DrawGUI (void *unused)
 			SCR_CheckDrawCenterString (cbx);
 			Sbar_Draw (cbx);
 			SCR_DrawDevStats (cbx); // johnfitz
+			SCR_DrawNetBuffer (cbx);
 			SCR_DrawFPS (cbx);		// johnfitz
 			SCR_DrawClock (cbx);	// johnfitz
 			SCR_DrawConsole (cbx);
@@ -1279,17 +1341,107 @@ static void SCR_DrawGUI (void *unused)
 	if (use_mutex)
 		SDL_UnlockMutex (draw_qcvm_mutex);
 
+	Draw_FlushBatch (cbx);
+	R_EndDebugUtilsLabel (cbx);
+}
+
 #ifdef USE_RMLUI
-	/* Render RmlUI overlay on top of Quake GUI */
+static qboolean ui_prepared; // SCR_PrepareUI recorded the layer SCR_DrawUI composites
+
+/*
+==================
+SCR_SyncUI
+
+Pushes the state the GUI branches of SCR_DrawGUI would show into RmlUI. The one place game
+state reaches the UI, at most once per frame and with the stats changed since the last time.
+==================
+*/
+static void SCR_SyncUI (void)
+{
+	qboolean sync_game_state = false;
+
+	UI_SetPerfOverlay (ui_perfoverlay.value != 0);
+
+	if (scr_drawdialog)
+	{
+		if (!con_forcedup)
+			sync_game_state = Sbar_SyncUI ();
+	}
+	else if (scr_drawloading)
+		sync_game_state = Sbar_SyncUI ();
+	else if ((cl.intermission == 1 || cl.intermission == 2) && key_dest == key_game)
+		sync_game_state = true;
+	else if (!UI_IsMainMenuStartupPending ())
+		sync_game_state = Sbar_SyncUI ();
+
+	if (sync_game_state)
+	{
+		UI_SyncGameState (cl.stats, MAX_CL_STATS, cl.statsdirty, cl.items, cl.intermission, cl.gametype, cl.maxclients, cl.levelname, cl.mapname, cl.time);
+		cl.statsdirty = 0;
+	}
+}
+
+/*
+==================
+SCR_PrepareUI
+
+Syncs and updates RmlUI and, with the layer cache, records its draws into the layer.
+Only needs the frame begun, so it runs alongside the world and the Quake GUI.
+==================
+*/
+static void SCR_PrepareUI (void *unused)
+{
+	SCR_SyncUI ();
+	ui_prepared = UI_BeginLayerFrame (vid.width, vid.height);
+	if (ui_prepared)
+	{
+		UI_Update (host_frametime);
+		UI_Render ();
+		UI_EndFrame ();
+	}
+}
+
+/*
+==================
+SCR_DrawUI
+
+Draws RmlUI on top of the Quake GUI, composites the layer SCR_PrepareUI recorded or
+draws the whole UI when it could not use one
+==================
+*/
+static void SCR_DrawUI (void *unused)
+{
+	cb_context_t *cbx = vulkan_globals.secondary_cb_contexts[SCBX_GUI];
+
+	Draw_FlushBatch (cbx); // RmlUI records straight into cbx->cb
 	R_BeginDebugUtilsLabel (cbx, "RmlUI");
-	UI_BeginFrame (cbx->cb, vid.width, vid.height);
-	UI_Update (host_frametime);
-	UI_Render ();
-	UI_EndFrame ();
+	if (ui_prepared)
+		UI_CompositeLayer (cbx->cb);
+	else
+	{
+		UI_BeginFrame (cbx->cb, vid.width, vid.height);
+		UI_Update (host_frametime);
+		UI_Render ();
+		UI_EndFrame ();
+	}
+
+	ui_perf_stats_t stats;
+	UI_GetPerfStats (&stats);
+
+	frame_stats_t *frame_stats = FrameStats_Current ();
+	frame_stats->ui_total_ms = stats.total_ms;
+	frame_stats->ui_begin_ms = stats.begin_ms;
+	frame_stats->ui_update_ms = stats.update_ms;
+	frame_stats->ui_update_context_ms = stats.update_context_ms;
+	frame_stats->ui_render_ms = stats.render_ms;
+	frame_stats->ui_end_ms = stats.end_ms;
+	frame_stats->ui_gpu_ms = stats.gpu_ms;
+	frame_stats->ui_overlay_ms = stats.overlay_ms;
+	frame_stats->ui_draw_calls = stats.draw_calls;
+	frame_stats->ui_triangles = stats.triangles;
+
 	if (ui_speeds.value)
 	{
-		ui_perf_stats_t stats;
-		UI_GetPerfStats (&stats);
 
 		if (ui_speeds.value >= 2)
 		{
@@ -1417,6 +1569,7 @@ static void SCR_DrawGUI (void *unused)
 						"ui(update avg1s) dp %.2f model %.2f lua %.2f hud %.2f notify %.2f context %.2f post %.2f\n", sum_update_dp * inv,
 						sum_update_model * inv, sum_update_lua * inv, sum_update_hud_logic * inv, sum_update_notify * inv, sum_update_context * inv,
 						sum_update_post * inv);
+					UI_PrintLuaCallbackStats (frame_count);
 				}
 
 				window_start = realtime;
@@ -1460,11 +1613,9 @@ static void SCR_DrawGUI (void *unused)
 				stats.render_ms, stats.end_ms, stats.gpu_ms, stats.draw_calls, stats.triangles);
 		}
 	}
-	R_EndDebugUtilsLabel (cbx);
-#endif
-
 	R_EndDebugUtilsLabel (cbx);
 }
+#endif
 
 /*
 ==================
@@ -1543,6 +1694,12 @@ void SCR_UpdateScreen (qboolean use_tasks)
 	// decide on the height of the console
 	con_forcedup = !cl.worldmodel || cls.signon != SIGNONS;
 
+	// before any rendering task can bind the textures it reloads
+	TexMgr_UpdateResidency ();
+
+	frame_stats_t *stats = FrameStats_Current ();
+	double		   time1 = Sys_DoubleTime ();
+
 	task_handle_t begin_rendering_task = INVALID_TASK_HANDLE;
 	if (!GL_BeginRendering (use_tasks, &begin_rendering_task, &glwidth, &glheight))
 	{
@@ -1550,6 +1707,9 @@ void SCR_UpdateScreen (qboolean use_tasks)
 		return;
 	}
 
+	double time2 = Sys_DoubleTime ();
+	stats->scr_begin_ms = (time2 - time1) * 1000;
+
 	if (use_tasks)
 	{
 		if (prev_end_rendering_task != INVALID_TASK_HANDLE)
@@ -1566,28 +1726,59 @@ void SCR_UpdateScreen (qboolean use_tasks)
 
 		Task_AddDependency (begin_rendering_task, draw_gui_task);
 		Task_AddDependency (setup_frame_task, draw_gui_task);
-		Task_AddDependency (draw_gui_task, draw_done_task);
 		Task_AddDependency (draw_done_task, end_rendering_task);
 
+#ifdef USE_RMLUI
+		// RmlUI is updated and recorded next to the world and the Quake GUI, only
+		// compositing it has to wait for the GUI. Begin rendering collected the UI
+		// garbage of this frame's slot.
+		task_handle_t prepare_ui_task = Task_AllocateAndAssignFunc (SCR_PrepareUI, NULL, 0);
+		task_handle_t draw_ui_task = Task_AllocateAndAssignFunc (SCR_DrawUI, NULL, 0);
+		Task_AddDependency (begin_rendering_task, prepare_ui_task);
+		Task_AddDependency (setup_frame_task, prepare_ui_task);
+		Task_AddDependency (prepare_ui_task, draw_ui_task);
+		Task_AddDependency (draw_gui_task, draw_ui_task);
+		Task_AddDependency (draw_ui_task, draw_done_task);
+
+		task_handle_t tasks[] = {begin_rendering_task, setup_frame_task, draw_done_task, draw_gui_task, prepare_ui_task, draw_ui_task, end_rendering_task};
+#else
+		Task_AddDependency (draw_gui_task, draw_done_task);
+
 		task_handle_t tasks[] = {begin_rendering_task, setup_frame_task, draw_done_task, draw_gui_task, end_rendering_task};
+#endif
 		Tasks_Submit (sizeof (tasks) / sizeof (task_handle_t), tasks);
 
+		time1 = Sys_DoubleTime ();
+		stats->scr_build_ms = (time1 - time2) * 1000;
+
 		while (!Task_Join (draw_done_task, 10))
 			S_ExtraUpdate ();
 		prev_end_rendering_task = end_rendering_task;
+
+		stats->scr_wait_ms = (Sys_DoubleTime () - time1) * 1000;
 	}
 	else
 	{
 		GL_SynchronizeEndRenderingTask ();
 		SCR_SetupFrame (NULL);
 #ifdef USE_RMLUI
+		SCR_PrepareUI (NULL);
 		if (!(suppress_startup_world && UI_StartupBlackoutAlpha () >= 1.0))
 #endif
 			V_RenderView (use_tasks, INVALID_TASK_HANDLE, INVALID_TASK_HANDLE, INVALID_TASK_HANDLE);
 		S_ExtraUpdate ();
 		SCR_DrawGUI (NULL);
+#ifdef USE_RMLUI
+		SCR_DrawUI (NULL);
+#endif
+
+		time1 = Sys_DoubleTime ();
+		stats->scr_build_ms = (time1 - time2) * 1000;
+
 		SCR_DrawDone (NULL);
 		GL_EndRendering (false, true);
+
+		stats->scr_wait_ms = (Sys_DoubleTime () - time1) * 1000;
 	}
 
 	in_update_screen = false;
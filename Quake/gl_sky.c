@@ -40,6 +40,8 @@ cvar_t		  r_sky_quality = {"r_sky_quality", "12", CVAR_NONE};
 cvar_t		  r_skyalpha = {"r_skyalpha", "1", CVAR_NONE};
 cvar_t		  r_skyfog = {"r_skyfog", "0.5", CVAR_NONE};
 cvar_t		  r_skywind = {"r_skywind", "1", CVAR_ARCHIVE};
+cvar_t		  r_skycache = {"r_skycache", "0", CVAR_ARCHIVE};
+cvar_t		  r_skycacherate = {"r_skycacherate", "30", CVAR_ARCHIVE};
 
 static const int skytexorder[6] = {0, 2, 1, 3, 4, 5}; // for skybox
 
@@ -83,6 +85,26 @@ typedef struct skybox_s
 
 static skybox_t skybox;
 
+// r_skycache bakes the scrolling layers into a cube map, sky surfaces then only do one lookup in sky_cube.frag.
+// The image is created on first use and kept, its descriptor is read by the sky task while the warp task bakes.
+#define SKY_CACHE_SIZE 512
+
+typedef struct
+{
+	VkImage			image;
+	vulkan_memory_t memory;
+	VkImageView		cube_view;
+	VkImageView		layers_view;
+	VkDescriptorSet descriptor_set;
+	VkDescriptorSet storage_descriptor_set;
+	gltexture_t	   *baked_solid;
+	gltexture_t	   *baked_alpha;
+	double			baked_time;
+	float			baked_alpha_value;
+} sky_cache_t;
+
+static sky_cache_t sky_cache;
+
 //==============================================================================
 //
 //  INIT
@@ -442,13 +464,33 @@ static void Skywind_f (void)
 		skybox.wind_pitch = fmod (atof (Cmd_Argv (4)) + 90.0, 180.0) - 90.0;
 }
 
+static const char *const suf[6] = {"rt", "bk", "lf", "ft", "up", "dn"};
+
+typedef struct load_skybox_task_args_s
+{
+	int			   *width;
+	int			   *height;
+	enum srcformat *fmt;
+	char (*filename)[MAX_OSPATH];
+	byte		 **data;
+	unsigned int	path_id;
+} load_skybox_task_args_t;
+
+/*
+=================
+Sky_LoadSkyBoxFaceTask
+=================
+*/
+static void Sky_LoadSkyBoxFaceTask (int i, load_skybox_task_args_t *args)
+{
+	args->data[i] = Image_LoadImage (args->filename[i], &args->width[i], &args->height[i], &args->fmt[i], args->path_id);
+}
+
 /*
 ==================
 Sky_LoadSkyBox
 ==================
 */
-static const char *const suf[6] = {"rt", "bk", "lf", "ft", "up", "dn"};
-
 void Sky_LoadSkyBox (const char *name)
 {
 	int			   i, width[6], height[6];
@@ -478,11 +520,30 @@ void Sky_LoadSkyBox (const char *name)
 		return;
 	}
 
-	// load textures
+	// load textures, the faces are decoded in parallel
 	for (i = 0; i < 6; i++)
-	{
 		q_snprintf (filename[i], sizeof (filename[i]), "gfx/env/%s%s", name, suf[i]);
-		if ((data[i] = Image_LoadImage (filename[i], &width[i], &height[i], &fmt[i], (cl.worldmodel ? cl.worldmodel->path_id : 0))))
+	load_skybox_task_args_t args = {
+		.width = width,
+		.height = height,
+		.fmt = fmt,
+		.filename = filename,
+		.data = data,
+		.path_id = cl.worldmodel ? cl.worldmodel->path_id : 0,
+	};
+	if (!Tasks_IsWorker ())
+	{
+		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)Sky_LoadSkyBoxFaceTask, 6, &args, sizeof (args));
+		Task_Join (task, TASK_TIMEOUT_INFINITE);
+	}
+	else
+	{
+		for (i = 0; i < 6; i++)
+			Sky_LoadSkyBoxFaceTask (i, &args);
+	}
+	for (i = 0; i < 6; i++)
+	{
+		if (data[i])
 			nonefound = false;
 		if (!data[i] || (width[i] != height[i]) || (width[i] != width[0]) || (fmt[i] != SRC_RGBA))
 			cubemap = false;
@@ -526,6 +587,122 @@ void Sky_LoadSkyBox (const char *name)
 	Skywind_Load_f ();
 }
 
+/*
+=============
+Sky_CreateCache
+=============
+*/
+static void Sky_CreateCache (void)
+{
+	if (sky_cache.image != VK_NULL_HANDLE)
+		return;
+
+	VkResult err;
+
+	ZEROED_STRUCT (VkImageCreateInfo, image_create_info);
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_create_info.extent.width = SKY_CACHE_SIZE;
+	image_create_info.extent.height = SKY_CACHE_SIZE;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 6;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	err = vkCreateImage (vulkan_globals.device, &image_create_info, NULL, &sky_cache.image);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImage failed");
+	GL_SetObjectName ((uint64_t)sky_cache.image, VK_OBJECT_TYPE_IMAGE, "Sky Cache");
+
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements (vulkan_globals.device, sky_cache.image, &memory_requirements);
+
+	ZEROED_STRUCT (VkMemoryAllocateInfo, memory_allocate_info);
+	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.allocationSize = memory_requirements.size;
+	memory_allocate_info.memoryTypeIndex = GL_MemoryTypeFromProperties (memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+
+	R_AllocateVulkanMemory (&sky_cache.memory, &memory_allocate_info, VULKAN_MEMORY_TYPE_DEVICE, &num_vulkan_misc_allocations);
+	GL_SetObjectName ((uint64_t)sky_cache.memory.handle, VK_OBJECT_TYPE_DEVICE_MEMORY, "Sky Cache");
+
+	err = vkBindImageMemory (vulkan_globals.device, sky_cache.image, sky_cache.memory.handle, 0);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindImageMemory failed");
+
+	ZEROED_STRUCT (VkImageViewCreateInfo, image_view_create_info);
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.image = sky_cache.image;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+	image_view_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_view_create_info.subresourceRange.baseMipLevel = 0;
+	image_view_create_info.subresourceRange.levelCount = 1;
+	image_view_create_info.subresourceRange.baseArrayLayer = 0;
+	image_view_create_info.subresourceRange.layerCount = 6;
+
+	err = vkCreateImageView (vulkan_globals.device, &image_view_create_info, NULL, &sky_cache.cube_view);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImageView failed");
+	GL_SetObjectName ((uint64_t)sky_cache.cube_view, VK_OBJECT_TYPE_IMAGE_VIEW, "Sky Cache Cube View");
+
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	err = vkCreateImageView (vulkan_globals.device, &image_view_create_info, NULL, &sky_cache.layers_view);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImageView failed");
+	GL_SetObjectName ((uint64_t)sky_cache.layers_view, VK_OBJECT_TYPE_IMAGE_VIEW, "Sky Cache Layers View");
+
+	sky_cache.descriptor_set = R_AllocateDescriptorSet (&vulkan_globals.single_texture_set_layout);
+	GL_SetObjectName ((uint64_t)sky_cache.descriptor_set, VK_OBJECT_TYPE_DESCRIPTOR_SET, "Sky Cache");
+	sky_cache.storage_descriptor_set = R_AllocateDescriptorSet (&vulkan_globals.single_texture_cs_write_set_layout);
+	GL_SetObjectName ((uint64_t)sky_cache.storage_descriptor_set, VK_OBJECT_TYPE_DESCRIPTOR_SET, "Sky Cache Storage");
+
+	ZEROED_STRUCT (VkDescriptorImageInfo, cube_image_info);
+	cube_image_info.imageView = sky_cache.cube_view;
+	cube_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	cube_image_info.sampler = vulkan_globals.linear_sampler;
+
+	ZEROED_STRUCT (VkDescriptorImageInfo, layers_image_info);
+	layers_image_info.imageView = sky_cache.layers_view;
+	layers_image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, descriptor_writes, 2);
+	descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[0].dstBinding = 0;
+	descriptor_writes[0].dstArrayElement = 0;
+	descriptor_writes[0].descriptorCount = 1;
+	descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_writes[0].dstSet = sky_cache.descriptor_set;
+	descriptor_writes[0].pImageInfo = &cube_image_info;
+	descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_writes[1].dstBinding = 0;
+	descriptor_writes[1].dstArrayElement = 0;
+	descriptor_writes[1].descriptorCount = 1;
+	descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	descriptor_writes[1].dstSet = sky_cache.storage_descriptor_set;
+	descriptor_writes[1].pImageInfo = &layers_image_info;
+	vkUpdateDescriptorSets (vulkan_globals.device, 2, descriptor_writes, 0, NULL);
+
+	sky_cache.baked_solid = NULL;
+	sky_cache.baked_alpha = NULL;
+}
+
+/*
+====================
+R_SkyCache_f
+====================
+*/
+static void R_SkyCache_f (cvar_t *var)
+{
+	if (var->value && (vulkan_globals.device != VK_NULL_HANDLE))
+		Sky_CreateCache ();
+}
+
 /*
 =================
 Sky_GetSkyCommand
@@ -571,6 +748,8 @@ void Sky_ClearAll (void)
 	solidskytexture = NULL;
 	alphaskytexture = NULL;
 	max_skytexture_index = -1;
+	sky_cache.baked_solid = NULL;
+	sky_cache.baked_alpha = NULL;
 	Cvar_SetQuick (&r_skyfog, r_skyfog.default_string);
 }
 
@@ -586,6 +765,9 @@ void Sky_NewMap (void)
 
 	skyfog = r_skyfog.value;
 
+	if (r_skycache.value)
+		Sky_CreateCache ();
+
 	//
 	// read worldspawn (this is so ugly, and shouldn't it be done on the server?)
 	//
@@ -693,6 +875,9 @@ void Sky_Init (void)
 	Cvar_RegisterVariable (&r_skyfog);
 	Cvar_SetCallback (&r_skyfog, R_SetSkyfog_f);
 	Cvar_RegisterVariable (&r_skywind);
+	Cvar_RegisterVariable (&r_skycache);
+	Cvar_SetCallback (&r_skycache, R_SkyCache_f);
+	Cvar_RegisterVariable (&r_skycacherate);
 
 	Cmd_AddCommand ("sky", Sky_SkyCommand_f);
 	Cmd_AddCommand ("skywind", Skywind_f);
@@ -1197,6 +1382,81 @@ static void Skywind_UpdateParams (float *wind_phase, vec3_t wind_dir)
 	}
 }
 
+/*
+==============
+Sky_UseCache
+
+Both the warp task that bakes and the sky task that samples decide this each frame
+==============
+*/
+static qboolean Sky_UseCache (void)
+{
+	const qboolean flat_color = r_fastsky.value || (Fog_GetDensity () > 0 && skyfog >= 1);
+	return r_skycache.value && (sky_cache.image != VK_NULL_HANDLE) && !r_lightmap_cheatsafe && !flat_color && !skybox.name[0] && solidskytexture &&
+		   alphaskytexture;
+}
+
+/*
+==============
+Sky_UpdateCache
+
+called once per frame from R_UpdateWarpTextures, before the render passes sample the cube map
+==============
+*/
+void Sky_UpdateCache (cb_context_t *cbx)
+{
+	if (!Sky_UseCache ())
+		return;
+
+	// Scrolling is slow enough that r_skycacherate updates are not visible as steps
+	const double min_interval = (r_skycacherate.value > 0.0f) ? (1.0 / r_skycacherate.value) : 0.0;
+	if ((sky_cache.baked_solid == solidskytexture) && (sky_cache.baked_alpha == alphaskytexture) && (sky_cache.baked_alpha_value == r_skyalpha.value) &&
+		((cl.time == sky_cache.baked_time) || ((cl.time > sky_cache.baked_time) && ((cl.time - sky_cache.baked_time) < min_interval))))
+		return;
+
+	R_BeginDebugUtilsLabel (cbx, "Sky Cache");
+
+	ZEROED_STRUCT (VkImageMemoryBarrier, image_barrier);
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.srcAccessMask = 0;
+	image_barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image = sky_cache.image;
+	image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.baseArrayLayer = 0;
+	image_barrier.subresourceRange.layerCount = 6;
+	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_barrier);
+
+	const float constant_values[3] = {
+		cl.time - (int)cl.time / 16 * 16,
+		r_skyalpha.value,
+		1.0f / SKY_CACHE_SIZE,
+	};
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.sky_cache_pipeline);
+	VkDescriptorSet descriptor_sets[3] = {solidskytexture->descriptor_set, alphaskytexture->descriptor_set, sky_cache.storage_descriptor_set};
+	vkCmdBindDescriptorSets (cbx->cb, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.sky_cache_pipeline.layout.handle, 0, 3, descriptor_sets, 0, NULL);
+	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (constant_values), constant_values);
+	vkCmdDispatch (cbx->cb, SKY_CACHE_SIZE / 8, SKY_CACHE_SIZE / 8, 6);
+
+	image_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_barrier);
+
+	R_EndDebugUtilsLabel (cbx);
+
+	sky_cache.baked_solid = solidskytexture;
+	sky_cache.baked_alpha = alphaskytexture;
+	sky_cache.baked_alpha_value = r_skyalpha.value;
+	sky_cache.baked_time = cl.time;
+}
+
 /*
 ==============
 Sky_DrawSky
@@ -1214,6 +1474,7 @@ void Sky_DrawSky (cb_context_t *cbx)
 	R_BeginDebugUtilsLabel (cbx, "Sky");
 
 	const qboolean flat_color = r_fastsky.value || (Fog_GetDensity () > 0 && skyfog >= 1);
+	const qboolean use_cache = Sky_UseCache ();
 	need_bounds = Sky_NeedStencil ();
 
 	//
@@ -1260,6 +1521,16 @@ void Sky_DrawSky (cb_context_t *cbx)
 
 		R_PushConstants (cbx, VK_SHADER_STAGE_ALL_GRAPHICS, 0, 27 * sizeof (float), constant_values);
 	}
+	else if (use_cache)
+	{
+		// Same as a cubemap skybox without wind
+		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_cube_pipeline[indirect]);
+		vkCmdBindDescriptorSets (
+			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_cube_pipeline[indirect].layout.handle, 0, 1, &sky_cache.descriptor_set, 0, NULL);
+		memcpy (&constant_values[20], r_refdef.vieworg, sizeof (r_refdef.vieworg));
+		memset (&constant_values[23], 0, 4 * sizeof (float));
+		R_PushConstants (cbx, VK_SHADER_STAGE_ALL_GRAPHICS, 0, 27 * sizeof (float), constant_values);
+	}
 	else if (!skybox.name[0])
 	{
 		if (!solidskytexture || !alphaskytexture)
@@ -1295,7 +1566,7 @@ void Sky_DrawSky (cb_context_t *cbx)
 		vkCmdBindIndexBuffer (cbx->cb, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 		if (flat_color)
 			R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_color_pipeline[0]);
-		else if (skybox.cubemap)
+		else if (skybox.cubemap || use_cache)
 			R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_cube_pipeline[0]);
 		else if (!skybox.name[0])
 			R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_layer_pipeline[0]);
@@ -51,11 +51,25 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 static cvar_t gl_max_size = {"gl_max_size", "0", CVAR_NONE};
 static cvar_t gl_picmip = {"gl_picmip", "0", CVAR_NONE};
+static cvar_t gl_texture_gpumips = {"gl_texture_gpumips", "1", CVAR_ARCHIVE};
+static cvar_t gl_texture_budget = {"gl_texture_budget", "0", CVAR_ARCHIVE}; // MB, 0: only the VK_EXT_memory_budget one
+static cvar_t gl_texture_evictframes = {"gl_texture_evictframes", "600", CVAR_ARCHIVE};
 
 extern cvar_t vid_filter;
 extern cvar_t vid_anisotropic;
 
 #define MAX_MIPS 16
+
+// Mipmapped RGBA textures with at least this many texels only upload level 0 and blit the rest
+#define GPU_MIPS_MIN_TEXELS (256 * 256)
+
+// Evicted textures keep a mip chain up to this size
+#define EVICTED_TEXTURE_SIZE 32
+// Reloads per frame, evicting and restoring read the source again
+#define MAX_EVICTIONS_PER_FRAME	   8
+#define MAX_RESTORATIONS_PER_FRAME 4
+
+uint32_t texmgr_frame;
 static int			numgltextures;
 static gltexture_t *active_gltextures, *free_gltextures;
 gltexture_t		   *notexture, *nulltexture, *whitetexture, *greytexture, *greylightmap, *bluenoisetexture;
@@ -72,8 +86,19 @@ unsigned int d_8to24table_conchars[256];
 #define TEXTURE_HEAP_PAGE_SIZE		16384
 
 static glheap_t	 *texmgr_heap;
+static uint32_t	  texmgr_heap_memory_type_index;
 static SDL_Mutex *texmgr_mutex;
 
+// Images of the UI renderer in texmgr_heap, guarded by texmgr_mutex
+static uint32_t num_external_allocations;
+static uint64_t num_external_bytes;
+
+// (owner, name) hash -> first gltexture_t in the hash_next chain. Guarded by its own
+// mutex that is only held for the lookup so that finds don't wait on GPU uploads
+// holding texmgr_mutex. Lock order is texmgr_mutex, then texmgr_names_mutex.
+static hash_map_t *texmgr_names;
+static SDL_Mutex  *texmgr_names_mutex;
+
 static byte bluenoise_data[4096] = {
 	0x27, 0x62, 0x08, 0x4C, 0xDE, 0xBA, 0x05, 0xEF, 0x2A, 0xA1, 0xF7, 0x4A, 0x5F, 0x29, 0xE8, 0x34, 0xA9, 0xCB, 0x40, 0x60, 0xD5, 0x87, 0x70, 0xD0, 0x61, 0x8A,
 	0xDF, 0xB2, 0xD8, 0xFA, 0x07, 0x74, 0x31, 0x56, 0x1A, 0x4B, 0xAA, 0x36, 0xD4, 0x16, 0x95, 0x2F, 0x68, 0x8E, 0x77, 0x25, 0x49, 0xE3, 0x12, 0x6C, 0x9F, 0xD7,
@@ -333,22 +358,87 @@ static void TexMgr_Imagelist_f (void)
 TexMgr_FindTexture
 ================
 */
-gltexture_t *TexMgr_FindTexture (qmodel_t *owner, const char *name)
+/*
+================
+TexMgr_NameHash
+================
+*/
+static uint32_t TexMgr_NameHash (qmodel_t *owner, const char *name)
 {
-	SDL_LockMutex (texmgr_mutex);
-	gltexture_t *glt = NULL;
+	return HashCombine (HashPtr (&owner), HashStr (&name));
+}
 
-	if (name)
+/*
+================
+TexMgr_LinkName
+================
+*/
+static void TexMgr_LinkName (gltexture_t *glt)
+{
+	const uint32_t hash = TexMgr_NameHash (glt->owner, glt->name);
+	SDL_LockMutex (texmgr_names_mutex);
+	gltexture_t **head = HashMap_Lookup (gltexture_t *, texmgr_names, &hash);
+	glt->hash_next = head ? *head : NULL;
+	HashMap_Insert (texmgr_names, &hash, &glt);
+	SDL_UnlockMutex (texmgr_names_mutex);
+}
+
+/*
+================
+TexMgr_UnlinkName
+================
+*/
+static void TexMgr_UnlinkName (gltexture_t *kill)
+{
+	const uint32_t hash = TexMgr_NameHash (kill->owner, kill->name);
+	SDL_LockMutex (texmgr_names_mutex);
+	gltexture_t **head = HashMap_Lookup (gltexture_t *, texmgr_names, &hash);
+	if (head)
 	{
-		for (glt = active_gltextures; glt; glt = glt->next)
+		if (*head == kill)
 		{
-			if (glt->owner == owner && !strcmp (glt->name, name))
-				goto unlock_mutex;
+			if (kill->hash_next)
+				*head = kill->hash_next;
+			else
+				HashMap_Erase (texmgr_names, &hash);
+		}
+		else
+		{
+			for (gltexture_t *glt = *head; glt->hash_next; glt = glt->hash_next)
+			{
+				if (glt->hash_next == kill)
+				{
+					glt->hash_next = kill->hash_next;
+					break;
+				}
+			}
 		}
 	}
+	kill->hash_next = NULL;
+	SDL_UnlockMutex (texmgr_names_mutex);
+}
 
-unlock_mutex:
-	SDL_UnlockMutex (texmgr_mutex);
+/*
+================
+TexMgr_FindTexture
+================
+*/
+gltexture_t *TexMgr_FindTexture (qmodel_t *owner, const char *name)
+{
+	gltexture_t *glt = NULL;
+
+	if (!name)
+		return NULL;
+
+	const uint32_t hash = TexMgr_NameHash (owner, name);
+	SDL_LockMutex (texmgr_names_mutex);
+	gltexture_t **head = HashMap_Lookup (gltexture_t *, texmgr_names, &hash);
+	for (glt = head ? *head : NULL; glt; glt = glt->hash_next)
+	{
+		if (glt->owner == owner && !strcmp (glt->name, name))
+			break;
+	}
+	SDL_UnlockMutex (texmgr_names_mutex);
 	return glt;
 }
 
@@ -392,6 +482,7 @@ void TexMgr_FreeTexture (gltexture_t *kill)
 
 	if (active_gltextures == kill)
 	{
+		TexMgr_UnlinkName (kill);
 		active_gltextures = kill->next;
 		kill->next = free_gltextures;
 		free_gltextures = kill;
@@ -405,6 +496,7 @@ void TexMgr_FreeTexture (gltexture_t *kill)
 	{
 		if (glt->next == kill)
 		{
+			TexMgr_UnlinkName (kill);
 			glt->next = kill->next;
 			kill->next = free_gltextures;
 			free_gltextures = kill;
@@ -517,6 +609,7 @@ void TexMgr_InitHeap ()
 
 	const VkDeviceSize heap_memory_size = TEXTURE_HEAP_MEMORY_SIZE_MB * (VkDeviceSize)1024 * (VkDeviceSize)1024;
 	texmgr_heap = GL_HeapCreate (heap_memory_size, TEXTURE_HEAP_PAGE_SIZE, memory_type_index, VULKAN_MEMORY_TYPE_DEVICE, false, "Texture Heap");
+	texmgr_heap_memory_type_index = memory_type_index;
 
 	vkDestroyImage (vulkan_globals.device, dummy_image, NULL);
 }
@@ -702,6 +795,8 @@ void TexMgr_Init (void)
 	extern texture_t *r_notexture_mip, *r_notexture_mip2;
 
 	texmgr_mutex = SDL_CreateMutex ();
+	texmgr_names_mutex = SDL_CreateMutex ();
+	texmgr_names = HashMap_Create (uint32_t, gltexture_t *, &HashInt32, NULL);
 
 	// init texture list
 	free_gltextures = (gltexture_t *)Mem_Alloc (MAX_GLTEXTURES * sizeof (gltexture_t));
@@ -716,6 +811,11 @@ void TexMgr_Init (void)
 
 	Cvar_RegisterVariable (&gl_max_size);
 	Cvar_RegisterVariable (&gl_picmip);
+	Cvar_RegisterVariable (&gl_texture_gpumips);
+	Cvar_RegisterVariable (&gl_texture_budget);
+	Cvar_RegisterVariable (&gl_texture_evictframes);
+	Cvar_RegisterVariable (&gl_texture_compression);
+	Cvar_RegisterVariable (&gl_texture_cache);
 	Cmd_AddCommand ("imagelist", &TexMgr_Imagelist_f);
 
 	// load notexture images
@@ -960,6 +1060,8 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 	int maxsize = (int)(is_cube ? vulkan_globals.device_properties.limits.maxImageDimensionCube : vulkan_globals.device_properties.limits.maxImageDimension2D);
 	if (!(glt->flags & TEXPREF_NOPICMIP) && gl_max_size.value)
 		maxsize = q_min (q_max ((int)gl_max_size.value, 1), maxsize);
+	if (glt->evicted)
+		maxsize = q_min (EVICTED_TEXTURE_SIZE, maxsize);
 	if ((mipwidth > maxsize) || (mipheight > maxsize))
 	{
 		if (mipwidth >= mipheight)
@@ -1022,6 +1124,11 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 
 	const VkFormat format = surface_indices ? VK_FORMAT_R32_UINT : ten_bit ? VK_FORMAT_A2B10G10R10_UNORM_PACK32 : VK_FORMAT_R8G8B8A8_UNORM;
 
+	// R8G8B8A8_UNORM always supports linear blits. The blits filter bilinearly instead of
+	// the CPU's stbir_resize, which is only worth it for large textures.
+	const qboolean gpu_mips = data && (num_mips > 1) && !warp_image && !is_cube && (format == VK_FORMAT_R8G8B8A8_UNORM) && gl_texture_gpumips.value &&
+							  ((glt->width * glt->height) >= GPU_MIPS_MIN_TEXELS);
+
 	ZEROED_STRUCT (VkImageCreateInfo, image_create_info);
 	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	image_create_info.imageType = VK_IMAGE_TYPE_2D;
@@ -1039,8 +1146,8 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 			 VK_IMAGE_USAGE_STORAGE_BIT);
 	else if (lightmap)
 		image_create_info.usage = (VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
-	else
-		image_create_info.usage = (VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+	else // TexMgr_Defragment copies from the image
+		image_create_info.usage = (VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 
 	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1153,7 +1260,7 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 	// Upload
 	ZEROED_STRUCT_ARRAY (VkBufferImageCopy, regions, MAX_MIPS);
 
-	int staging_size = (glt->flags & TEXPREF_MIPMAP) ? TexMgr_DeriveStagingSize (mipwidth, mipheight) : (mipwidth * mipheight * 4);
+	int staging_size = ((glt->flags & TEXPREF_MIPMAP) && !gpu_mips) ? TexMgr_DeriveStagingSize (mipwidth, mipheight) : (mipwidth * mipheight * 4);
 	if (is_cube)
 		staging_size *= 6;
 
@@ -1164,7 +1271,7 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 
 	int num_regions = 0;
 
-	if (glt->flags & TEXPREF_MIPMAP)
+	if ((glt->flags & TEXPREF_MIPMAP) && !gpu_mips)
 	{
 		int mip_offset = 0;
 		mipwidth = glt->width;
@@ -1223,22 +1330,68 @@ static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
 	image_memory_barrier.subresourceRange.baseArrayLayer = 0;
 	image_memory_barrier.subresourceRange.layerCount = is_cube ? 6 : 1;
 
-	image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	image_memory_barrier.srcAccessMask = 0;
-	image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
-
-	vkCmdCopyBufferToImage (command_buffer, staging_buffer, glt->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, num_mips * (is_cube ? 6 : 1), regions);
+	if (gpu_mips)
+	{
+		// Like the warp images: the whole chain in GENERAL, each level blitted from the one above
+		image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		image_memory_barrier.srcAccessMask = 0;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+
+		vkCmdCopyBufferToImage (command_buffer, staging_buffer, glt->image, VK_IMAGE_LAYOUT_GENERAL, 1, regions);
+
+		ZEROED_STRUCT (VkMemoryBarrier, memory_barrier);
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		for (int mip = 1; mip < num_mips; ++mip)
+		{
+			vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+
+			ZEROED_STRUCT (VkImageBlit, region);
+			region.srcOffsets[1].x = q_max (glt->width >> (mip - 1), 1);
+			region.srcOffsets[1].y = q_max (glt->height >> (mip - 1), 1);
+			region.srcOffsets[1].z = 1;
+			region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.srcSubresource.layerCount = 1;
+			region.srcSubresource.mipLevel = mip - 1;
+			region.dstOffsets[1].x = q_max (glt->width >> mip, 1);
+			region.dstOffsets[1].y = q_max (glt->height >> mip, 1);
+			region.dstOffsets[1].z = 1;
+			region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.dstSubresource.layerCount = 1;
+			region.dstSubresource.mipLevel = mip;
+			vkCmdBlitImage (command_buffer, glt->image, VK_IMAGE_LAYOUT_GENERAL, glt->image, VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_LINEAR);
+		}
 
-	image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+		image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier (
+			command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+	}
+	else
+	{
+		image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_memory_barrier.srcAccessMask = 0;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+
+		vkCmdCopyBufferToImage (command_buffer, staging_buffer, glt->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, num_mips * (is_cube ? 6 : 1), regions);
+
+		image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier (
+			command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+	}
 
 	R_StagingBeginCopy ();
-	if (glt->flags & TEXPREF_MIPMAP)
+	if ((glt->flags & TEXPREF_MIPMAP) && !gpu_mips)
 	{
 		int mip_offset = 0;
 		mipwidth = glt->width;
@@ -1379,6 +1532,160 @@ static void TexMgr_LoadImage8Valve (gltexture_t *glt, byte *data)
 	TEMP_FREE (usepal);
 }
 
+/*
+================
+TexMgr_LoadImageCompressed -- handles block compressed source data
+
+The mips come from the file, gl_picmip and gl_max_size skip the largest ones.
+================
+*/
+static void TexMgr_LoadImageCompressed (gltexture_t *glt, compressed_image_t *image)
+{
+	GL_DeleteTexture (glt);
+
+	int first_mip = (glt->flags & TEXPREF_NOPICMIP) ? 0 : q_max ((int)gl_picmip.value, 0);
+	int maxsize = (int)vulkan_globals.device_properties.limits.maxImageDimension2D;
+	if (!(glt->flags & TEXPREF_NOPICMIP) && gl_max_size.value)
+		maxsize = q_min (q_max ((int)gl_max_size.value, 1), maxsize);
+	if (glt->evicted)
+		maxsize = q_min (EVICTED_TEXTURE_SIZE, maxsize);
+	while ((((image->width >> first_mip) > maxsize) || ((image->height >> first_mip) > maxsize)) && (first_mip + 1 < image->num_mips))
+		++first_mip;
+	first_mip = q_min (first_mip, image->num_mips - 1);
+
+	const int num_mips = (glt->flags & TEXPREF_MIPMAP) ? (image->num_mips - first_mip) : 1;
+	glt->width = q_max (image->width >> first_mip, 1);
+	glt->height = q_max (image->height >> first_mip, 1);
+
+	// Only BC1 is known to be opaque, everything else might need blending
+	if ((image->format != VK_FORMAT_BC1_RGB_UNORM_BLOCK) && (image->format != VK_FORMAT_BC1_RGBA_UNORM_BLOCK))
+		glt->flags |= TEXPREF_ALPHAPIXELS;
+
+	SDL_LockMutex (texmgr_mutex);
+
+	VkResult err;
+
+	ZEROED_STRUCT (VkImageCreateInfo, image_create_info);
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = image->format;
+	image_create_info.extent.width = glt->width;
+	image_create_info.extent.height = glt->height;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = num_mips;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = (VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	err = vkCreateImage (vulkan_globals.device, &image_create_info, NULL, &glt->image);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImage failed");
+	GL_SetObjectName ((uint64_t)glt->image, VK_OBJECT_TYPE_IMAGE, va ("%s image", glt->name));
+
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements (vulkan_globals.device, glt->image, &memory_requirements);
+
+	glt->allocation = GL_HeapAllocate (texmgr_heap, memory_requirements.size, memory_requirements.alignment, &num_vulkan_tex_allocations);
+	err = vkBindImageMemory (vulkan_globals.device, glt->image, GL_HeapGetAllocationMemory (glt->allocation), GL_HeapGetAllocationOffset (glt->allocation));
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindImageMemory failed");
+
+	ZEROED_STRUCT (VkImageViewCreateInfo, image_view_create_info);
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.image = glt->image;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	image_view_create_info.format = image->format;
+	image_view_create_info.components.r = VK_COMPONENT_SWIZZLE_R;
+	image_view_create_info.components.g = VK_COMPONENT_SWIZZLE_G;
+	image_view_create_info.components.b = VK_COMPONENT_SWIZZLE_B;
+	image_view_create_info.components.a = VK_COMPONENT_SWIZZLE_A;
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_view_create_info.subresourceRange.baseMipLevel = 0;
+	image_view_create_info.subresourceRange.levelCount = num_mips;
+	image_view_create_info.subresourceRange.baseArrayLayer = 0;
+	image_view_create_info.subresourceRange.layerCount = 1;
+
+	err = vkCreateImageView (vulkan_globals.device, &image_view_create_info, NULL, &glt->image_view);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImageView failed");
+	GL_SetObjectName ((uint64_t)glt->image_view, VK_OBJECT_TYPE_IMAGE_VIEW, va ("%s image view", glt->name));
+
+	// Allocate and update descriptor for this texture
+	glt->descriptor_set = R_AllocateDescriptorSet (&vulkan_globals.single_texture_set_layout);
+	GL_SetObjectName ((uint64_t)glt->descriptor_set, VK_OBJECT_TYPE_DESCRIPTOR_SET, va ("%s desc set", glt->name));
+
+	TexMgr_SetFilterModes (glt);
+
+	glt->target_image_view = VK_NULL_HANDLE;
+	glt->storage_descriptor_set = VK_NULL_HANDLE;
+	glt->frame_buffer = VK_NULL_HANDLE;
+
+	SDL_UnlockMutex (texmgr_mutex);
+
+	// Upload, mip sizes are multiples of the block size so every mip stays aligned
+	ZEROED_STRUCT_ARRAY (VkBufferImageCopy, regions, MAX_MIPS);
+
+	int staging_size = 0;
+	for (int i = 0; i < num_mips; ++i)
+		staging_size += Image_CompressedMipSize (image, first_mip + i);
+
+	VkBuffer		staging_buffer;
+	VkCommandBuffer command_buffer;
+	int				staging_offset;
+	unsigned char  *staging_memory = R_StagingAllocate (staging_size, 16, &command_buffer, &staging_buffer, &staging_offset);
+
+	int mip_offset = 0;
+	for (int i = 0; i < num_mips; ++i)
+	{
+		regions[i].bufferOffset = staging_offset + mip_offset;
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.layerCount = 1;
+		regions[i].imageSubresource.mipLevel = i;
+		regions[i].imageExtent.width = q_max (glt->width >> i, 1);
+		regions[i].imageExtent.height = q_max (glt->height >> i, 1);
+		regions[i].imageExtent.depth = 1;
+		mip_offset += Image_CompressedMipSize (image, first_mip + i);
+	}
+
+	ZEROED_STRUCT (VkImageMemoryBarrier, image_memory_barrier);
+	image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_memory_barrier.image = glt->image;
+	image_memory_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_memory_barrier.subresourceRange.baseMipLevel = 0;
+	image_memory_barrier.subresourceRange.levelCount = num_mips;
+	image_memory_barrier.subresourceRange.baseArrayLayer = 0;
+	image_memory_barrier.subresourceRange.layerCount = 1;
+
+	image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_memory_barrier.srcAccessMask = 0;
+	image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+
+	vkCmdCopyBufferToImage (command_buffer, staging_buffer, glt->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, num_mips, regions);
+
+	image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+
+	R_StagingBeginCopy ();
+	mip_offset = 0;
+	for (int i = 0; i < num_mips; ++i)
+	{
+		const uint32_t size = Image_CompressedMipSize (image, first_mip + i);
+		memcpy (staging_memory + mip_offset, image->data + image->mip_offsets[first_mip + i], size);
+		mip_offset += size;
+	}
+	R_StagingEndCopy ();
+}
+
 /*
 ================
 TexMgr_LoadImage -- the one entry point for loading all textures
@@ -1411,10 +1718,12 @@ gltexture_t *TexMgr_LoadImage (
 		default: /* not reachable but avoids compiler warnings */
 			crc = 0;
 		}
+	qboolean overwrite = false;
 	if ((flags & TEXPREF_OVERWRITE) && (glt = TexMgr_FindTexture (owner, name)))
 	{
 		if (glt->source_crc == crc)
 			return glt;
+		overwrite = true; // already linked under the same (owner, name)
 	}
 	else
 		glt = TexMgr_NewTexture ();
@@ -1422,6 +1731,8 @@ gltexture_t *TexMgr_LoadImage (
 	// copy data
 	glt->owner = owner;
 	q_strlcpy (glt->name, name, sizeof (glt->name));
+	if (!overwrite)
+		TexMgr_LinkName (glt);
 	glt->path_id = (glt->owner ? glt->owner->path_id : 0);
 	glt->width = width;
 	glt->height = height;
@@ -1434,8 +1745,11 @@ gltexture_t *TexMgr_LoadImage (
 	glt->source_width = width;
 	glt->source_height = height;
 	glt->source_crc = crc;
+	glt->evicted = false;
+	Atomic_StoreUInt32 (&glt->last_used_frame, texmgr_frame);
 
 	// upload it
+	const mem_tag_t tag = Mem_SetTag (MEM_TAG_TEXTURES);
 	switch (glt->source_format)
 	{
 	case SRC_INDEXED:
@@ -1452,7 +1766,11 @@ gltexture_t *TexMgr_LoadImage (
 	case SRC_INDEXED_PALETTE:
 		TexMgr_LoadImage8Valve (glt, data);
 		break;
+	case SRC_COMPRESSED:
+		TexMgr_LoadImageCompressed (glt, (compressed_image_t *)data);
+		break;
 	}
+	Mem_SetTag (tag);
 
 	return glt;
 }
@@ -1465,6 +1783,80 @@ gltexture_t *TexMgr_LoadImage (
 ================================================================================
 */
 
+/*
+================
+TexMgr_BuildTranslation -- palette remap that moves the shirt and pants ranges to the given colors
+================
+*/
+static void TexMgr_BuildTranslation (byte *translation, int shirt, int pants)
+{
+	int i;
+
+	for (i = 0; i < 256; i++)
+		translation[i] = i;
+
+	shirt *= 16;
+	if (shirt < 128)
+	{
+		for (i = 0; i < 16; i++)
+			translation[TOP_RANGE + i] = shirt + i;
+	}
+	else
+	{
+		for (i = 0; i < 16; i++)
+			translation[TOP_RANGE + i] = shirt + 15 - i;
+	}
+
+	pants *= 16;
+	if (pants < 128)
+	{
+		for (i = 0; i < 16; i++)
+			translation[BOTTOM_RANGE + i] = pants + i;
+	}
+	else
+	{
+		for (i = 0; i < 16; i++)
+			translation[BOTTOM_RANGE + i] = pants + 15 - i;
+	}
+}
+
+/*
+================
+TexMgr_LoadColormappedImage -- loads an indexed image with shirt and pants already applied
+
+Uploads once instead of TexMgr_LoadImage followed by TexMgr_ReloadImage. The source
+stays the untranslated image, reloads colormap it again from shirt and pants.
+================
+*/
+gltexture_t *TexMgr_LoadColormappedImage (
+	qmodel_t *owner, const char *name, int width, int height, byte *data, const char *source_file, src_offset_t source_offset, unsigned flags, int shirt,
+	int pants)
+{
+	byte		 translation[256];
+	byte		*translated;
+	gltexture_t *glt;
+	int			 size, i;
+
+	if (isDedicated)
+		return NULL;
+
+	TexMgr_BuildTranslation (translation, shirt, pants);
+	size = width * height;
+	translated = (byte *)Mem_Alloc (size);
+	for (i = 0; i < size; i++)
+		translated[i] = translation[data[i]];
+
+	glt = TexMgr_LoadImage (owner, name, width, height, SRC_INDEXED, translated, source_file, source_offset, flags);
+	if (glt)
+	{
+		glt->shirt = shirt;
+		glt->pants = pants;
+	}
+
+	Mem_Free (translated);
+	return glt;
+}
+
 /*
 ================
 TexMgr_ReloadImage -- reloads a texture, and colormaps it if needed
@@ -1502,6 +1894,11 @@ void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants)
 			goto invalid;
 		fclose (f);
 	}
+	else if (glt->source_file[0] && !glt->source_offset && glt->source_format == SRC_COMPRESSED)
+	{
+		allocated = data = Image_LoadTextureImage (
+			glt->source_file, (int *)&glt->source_width, (int *)&glt->source_height, &glt->source_format, glt->path_id); // replacement texture
+	}
 	else if (glt->source_file[0] && !glt->source_offset)
 	{
 		allocated = data =
@@ -1538,32 +1935,7 @@ void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants)
 	if (glt->shirt > -1 && glt->pants > -1)
 	{
 		// create new translation table
-		for (i = 0; i < 256; i++)
-			translation[i] = i;
-
-		shirt = glt->shirt * 16;
-		if (shirt < 128)
-		{
-			for (i = 0; i < 16; i++)
-				translation[TOP_RANGE + i] = shirt + i;
-		}
-		else
-		{
-			for (i = 0; i < 16; i++)
-				translation[TOP_RANGE + i] = shirt + 15 - i;
-		}
-
-		pants = glt->pants * 16;
-		if (pants < 128)
-		{
-			for (i = 0; i < 16; i++)
-				translation[BOTTOM_RANGE + i] = pants + i;
-		}
-		else
-		{
-			for (i = 0; i < 16; i++)
-				translation[BOTTOM_RANGE + i] = pants + 15 - i;
-		}
+		TexMgr_BuildTranslation (translation, glt->shirt, glt->pants);
 
 		// translate texture
 		size = glt->width * glt->height;
@@ -1594,6 +1966,9 @@ void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants)
 	case SRC_INDEXED_PALETTE:
 		TexMgr_LoadImage8Valve (glt, data);
 		break;
+	case SRC_COMPRESSED:
+		TexMgr_LoadImageCompressed (glt, (compressed_image_t *)data);
+		break;
 	}
 
 	Mem_Free (translated);
@@ -1614,6 +1989,94 @@ void TexMgr_ReloadNobrightImages (void)
 			TexMgr_ReloadImage (glt, -1, -1);
 }
 
+/*
+================================================================================
+
+	RESIDENCY
+
+================================================================================
+*/
+
+/*
+================
+TexMgr_IsEvictable
+
+Alias model skins are cached across maps and pile up in hub campaigns, they are the
+only textures that get evicted. TexMgr_ReloadImage has to be able to rebuild them.
+================
+*/
+static qboolean TexMgr_IsEvictable (gltexture_t *glt)
+{
+	return glt->owner && (glt->owner->type == mod_alias) && glt->source_file[0] && (glt->flags & TEXPREF_MIPMAP) && !(glt->flags & TEXPREF_PERSIST) &&
+		   glt->image_view;
+}
+
+/*
+================
+TexMgr_CompareLastUsed
+================
+*/
+static int TexMgr_CompareLastUsed (const void *a, const void *b)
+{
+	const uint32_t frame_a = Atomic_LoadUInt32 (&(*(gltexture_t **)a)->last_used_frame);
+	const uint32_t frame_b = Atomic_LoadUInt32 (&(*(gltexture_t **)b)->last_used_frame);
+	return (frame_a < frame_b) ? -1 : (frame_a > frame_b) ? 1 : 0;
+}
+
+/*
+================
+TexMgr_UpdateResidency
+
+Called once per frame before any rendering tasks run. Evicted textures that were
+drawn again are reloaded at full size. While texture memory is over gl_texture_budget, or
+the device local heaps are over their VK_EXT_memory_budget budget, the least recently
+drawn skins that weren't drawn for gl_texture_evictframes frames are reloaded at
+EVICTED_TEXTURE_SIZE. GL_DeleteTexture defers the destruction of the old images to
+TexMgr_CollectGarbage.
+================
+*/
+void TexMgr_UpdateResidency (void)
+{
+	const uint32_t frame = texmgr_frame++;
+	const uint32_t min_unused_frames = q_max ((int)gl_texture_evictframes.value, 1);
+
+	int num_restored = 0;
+	for (gltexture_t *glt = active_gltextures; glt && (num_restored < MAX_RESTORATIONS_PER_FRAME); glt = glt->next)
+	{
+		if (glt->evicted && ((frame - Atomic_LoadUInt32 (&glt->last_used_frame)) < min_unused_frames))
+		{
+			glt->evicted = false;
+			TexMgr_ReloadImage (glt, -1, -1);
+			++num_restored;
+		}
+	}
+
+	const uint64_t budget = (uint64_t)q_max (gl_texture_budget.value, 0.0f) * 1024 * 1024;
+	uint64_t	   device_usage, device_budget;
+	const qboolean device_over_budget = GL_GetDeviceMemoryBudget (&device_usage, &device_budget) && (device_usage > device_budget);
+	SDL_LockMutex (texmgr_mutex);
+	const uint64_t texture_usage = GL_HeapGetStats (texmgr_heap)->num_bytes_allocated;
+	SDL_UnlockMutex (texmgr_mutex);
+	if (!device_over_budget && (!budget || (texture_usage <= budget)))
+		return;
+
+	int num_candidates = 0;
+	TEMP_ALLOC (gltexture_t *, candidates, numgltextures);
+	for (gltexture_t *glt = active_gltextures; glt; glt = glt->next)
+		if (!glt->evicted && TexMgr_IsEvictable (glt) && ((frame - Atomic_LoadUInt32 (&glt->last_used_frame)) >= min_unused_frames))
+			candidates[num_candidates++] = glt;
+	qsort (candidates, num_candidates, sizeof (gltexture_t *), TexMgr_CompareLastUsed);
+
+	// Heap stats only change once the garbage is collected, evict a batch per frame
+	for (int i = 0; (i < num_candidates) && (i < MAX_EVICTIONS_PER_FRAME); ++i)
+	{
+		Con_DPrintf ("Evicting texture %s\n", candidates[i]->name);
+		candidates[i]->evicted = true;
+		TexMgr_ReloadImage (candidates[i], -1, -1);
+	}
+	TEMP_FREE (candidates);
+}
+
 /*
 ================================================================================
 
@@ -1726,7 +2189,238 @@ mutex_unlock:
 	SDL_UnlockMutex (texmgr_mutex);
 }
 
+/*
+================
+TexMgr_AllocateExternal
+
+Memory for an image created outside of the texture manager, the UI renderer's
+textures, from the texture heap. Returns NULL if the memory type of the heap
+doesn't fit. TexMgr_Defragment doesn't move these, segments they are in are
+released once they are freed.
+================
+*/
+glheapallocation_t *TexMgr_AllocateExternal (const VkMemoryRequirements *memory_requirements, VkDeviceMemory *memory, VkDeviceSize *offset)
+{
+	if (!texmgr_heap || !(memory_requirements->memoryTypeBits & (1u << texmgr_heap_memory_type_index)))
+		return NULL;
+
+	SDL_LockMutex (texmgr_mutex);
+	glheapallocation_t *allocation =
+		GL_HeapAllocate (texmgr_heap, memory_requirements->size, memory_requirements->alignment, &num_vulkan_tex_allocations);
+	++num_external_allocations;
+	num_external_bytes += memory_requirements->size;
+	SDL_UnlockMutex (texmgr_mutex);
+
+	*memory = GL_HeapGetAllocationMemory (allocation);
+	*offset = GL_HeapGetAllocationOffset (allocation);
+	return allocation;
+}
+
+/*
+================
+TexMgr_FreeExternal
+
+The GPU has to be done with the image
+================
+*/
+void TexMgr_FreeExternal (glheapallocation_t *allocation, VkDeviceSize size)
+{
+	SDL_LockMutex (texmgr_mutex);
+	GL_HeapFree (texmgr_heap, allocation, &num_vulkan_tex_allocations);
+	--num_external_allocations;
+	num_external_bytes -= size;
+	SDL_UnlockMutex (texmgr_mutex);
+}
+
+/*
+================
+TexMgr_GetExternalAllocations
+================
+*/
+uint32_t TexMgr_GetExternalAllocations (uint64_t *bytes)
+{
+	SDL_LockMutex (texmgr_mutex);
+	const uint32_t num = num_external_allocations;
+	*bytes = num_external_bytes;
+	SDL_UnlockMutex (texmgr_mutex);
+	return num;
+}
+
 glheapstats_t *TexMgr_GetHeapStats (void)
 {
-	return GL_HeapGetStats (texmgr_heap);
+	// TexMgr_CollectGarbage frees from the begin rendering task
+	SDL_LockMutex (texmgr_mutex);
+	glheapstats_t *stats = GL_HeapGetStats (texmgr_heap);
+	SDL_UnlockMutex (texmgr_mutex);
+	return stats;
+}
+
+/*
+================
+TexMgr_RelocateTexture
+
+Moves the image into a new allocation. The GPU copy is recorded into the staging
+command buffer, the old objects are returned in garbage and must not be destroyed
+before the copy finished.
+================
+*/
+static void TexMgr_RelocateTexture (gltexture_t *glt, texture_garbage_t *garbage)
+{
+	const qboolean is_cube = glt->source_format == SRC_RGBA_CUBEMAP;
+	const int	   num_layers = is_cube ? 6 : 1;
+	const int	   num_mips = (glt->flags & TEXPREF_MIPMAP) ? TexMgr_DeriveNumMips (glt->width, glt->height) : 1;
+	VkResult	   err;
+
+	memset (garbage, 0, sizeof (texture_garbage_t));
+	garbage->image = glt->image;
+	garbage->image_view = glt->image_view;
+	garbage->allocation = glt->allocation;
+
+	ZEROED_STRUCT (VkImageCreateInfo, image_create_info);
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_create_info.extent.width = glt->width;
+	image_create_info.extent.height = glt->height;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = num_mips;
+	image_create_info.arrayLayers = num_layers;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = (VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (is_cube)
+		image_create_info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+
+	err = vkCreateImage (vulkan_globals.device, &image_create_info, NULL, &glt->image);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImage failed");
+	GL_SetObjectName ((uint64_t)glt->image, VK_OBJECT_TYPE_IMAGE, va ("%s image", glt->name));
+
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements (vulkan_globals.device, glt->image, &memory_requirements);
+
+	glt->allocation = GL_HeapAllocate (texmgr_heap, memory_requirements.size, memory_requirements.alignment, &num_vulkan_tex_allocations);
+	err = vkBindImageMemory (vulkan_globals.device, glt->image, GL_HeapGetAllocationMemory (glt->allocation), GL_HeapGetAllocationOffset (glt->allocation));
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindImageMemory failed");
+
+	ZEROED_STRUCT (VkImageViewCreateInfo, image_view_create_info);
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.image = glt->image;
+	image_view_create_info.viewType = is_cube ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
+	image_view_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_view_create_info.components.r = VK_COMPONENT_SWIZZLE_R;
+	image_view_create_info.components.g = VK_COMPONENT_SWIZZLE_G;
+	image_view_create_info.components.b = VK_COMPONENT_SWIZZLE_B;
+	image_view_create_info.components.a = VK_COMPONENT_SWIZZLE_A;
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_view_create_info.subresourceRange.levelCount = num_mips;
+	image_view_create_info.subresourceRange.layerCount = num_layers;
+
+	err = vkCreateImageView (vulkan_globals.device, &image_view_create_info, NULL, &glt->image_view);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImageView failed");
+	GL_SetObjectName ((uint64_t)glt->image_view, VK_OBJECT_TYPE_IMAGE_VIEW, va ("%s image view", glt->name));
+
+	// No staging memory is needed, the byte only makes sure the command buffer gets submitted
+	VkCommandBuffer command_buffer;
+	R_StagingAllocate (1, 1, &command_buffer, NULL, NULL);
+
+	ZEROED_STRUCT_ARRAY (VkImageMemoryBarrier, image_memory_barriers, 2);
+	for (int i = 0; i < 2; ++i)
+	{
+		image_memory_barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_memory_barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_memory_barriers[i].subresourceRange.levelCount = num_mips;
+		image_memory_barriers[i].subresourceRange.layerCount = num_layers;
+	}
+	image_memory_barriers[0].image = garbage->image;
+	image_memory_barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	image_memory_barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	image_memory_barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	image_memory_barriers[1].image = glt->image;
+	image_memory_barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_memory_barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_memory_barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, image_memory_barriers);
+
+	ZEROED_STRUCT_ARRAY (VkImageCopy, regions, MAX_MIPS);
+	for (int i = 0; i < num_mips; ++i)
+	{
+		regions[i].srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].srcSubresource.mipLevel = i;
+		regions[i].srcSubresource.layerCount = num_layers;
+		regions[i].dstSubresource = regions[i].srcSubresource;
+		regions[i].extent.width = q_max (glt->width >> i, 1);
+		regions[i].extent.height = q_max (glt->height >> i, 1);
+		regions[i].extent.depth = 1;
+	}
+	vkCmdCopyImage (
+		command_buffer, garbage->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, glt->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, num_mips, regions);
+
+	image_memory_barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	image_memory_barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	image_memory_barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_memory_barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier (
+		command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barriers[1]);
+
+	R_StagingBeginCopy ();
+	R_StagingEndCopy ();
+}
+
+/*
+================
+TexMgr_Defragment
+
+Moves textures out of texture heap segments that are at most max_occupancy full
+and releases the memory of segments that end up empty. Only for load screens, it
+waits for the device twice. Lightmaps, surface indices, compressed textures, warp
+images and bluenoisetexture stay where they are. The lightstyle textures of the lightmaps are
+moved, GL_UpdateLightmapDescriptorSets has to run afterwards. Returns the number
+of textures moved.
+================
+*/
+int TexMgr_Defragment (float max_occupancy)
+{
+	GL_WaitForDeviceIdle ();
+	SDL_LockMutex (texmgr_mutex);
+
+	int num_moved = 0;
+	if (GL_HeapBeginDefragment (texmgr_heap, max_occupancy) > 0)
+	{
+		TEMP_ALLOC (texture_garbage_t, garbage, numgltextures);
+		for (gltexture_t *glt = active_gltextures; glt; glt = glt->next)
+		{
+			if (!glt->allocation || !GL_HeapIsAllocationEvacuating (glt->allocation))
+				continue;
+			if ((glt->source_format == SRC_LIGHTMAP) || (glt->source_format == SRC_SURF_INDICES) || (glt->source_format == SRC_COMPRESSED) ||
+				(glt->flags & TEXPREF_WARPIMAGE) || (glt == bluenoisetexture))
+				continue;
+			TexMgr_RelocateTexture (glt, &garbage[num_moved++]);
+		}
+
+		GL_WaitForDeviceIdle ();
+
+		for (int i = 0; i < num_moved; ++i)
+		{
+			vkDestroyImageView (vulkan_globals.device, garbage[i].image_view, NULL);
+			vkDestroyImage (vulkan_globals.device, garbage[i].image, NULL);
+			GL_HeapFree (texmgr_heap, garbage[i].allocation, &num_vulkan_tex_allocations);
+		}
+		TEMP_FREE (garbage);
+
+		TexMgr_UpdateTextureDescriptorSets ();
+	}
+	const uint32_t num_released = GL_HeapEndDefragment (texmgr_heap, &num_vulkan_tex_allocations);
+
+	SDL_UnlockMutex (texmgr_mutex);
+
+	if (num_moved > 0 || num_released > 0)
+		Con_DPrintf ("Texture heap: moved %d textures, released %u segments\n", num_moved, num_released);
+	return num_moved;
 }
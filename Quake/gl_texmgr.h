@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define _GL_TEXMAN_H
 
 #include "tasks.h"
+#include "atomics.h"
 
 // gl_texmgr.h -- fitzquake's texture manager. manages opengl texture images
 
@@ -57,6 +58,7 @@ enum srcformat
 	SRC_SURF_INDICES,
 	SRC_RGBA_CUBEMAP,
 	SRC_INDEXED_PALETTE,
+	SRC_COMPRESSED, // compressed_image_t from Image_LoadTextureImage
 };
 
 typedef struct glheapallocation_s glheapallocation_t;
@@ -65,6 +67,7 @@ typedef struct gltexture_s
 {
 	// managed by texture manager
 	struct gltexture_s *next;
+	struct gltexture_s *hash_next; // next texture with the same (owner, name) hash
 	qmodel_t		   *owner;
 	// managed by image loading
 	char				name[64];
@@ -89,6 +92,9 @@ typedef struct gltexture_s
 	VkDescriptorSet		descriptor_set;
 	VkFramebuffer		frame_buffer;
 	VkDescriptorSet		storage_descriptor_set;
+	// residency
+	atomic_uint32_t		last_used_frame; // texmgr_frame of the last draw, see TexMgr_MarkUsed
+	qboolean			evicted;		 // reloaded at EVICTED_TEXTURE_SIZE to stay under gl_texture_budget
 } gltexture_t;
 
 extern gltexture_t *notexture;
@@ -121,12 +127,32 @@ void		 TexMgr_LoadPalette (void);
 gltexture_t *TexMgr_LoadImage (
 	qmodel_t *owner, const char *name, int width, int height, enum srcformat format, byte *data, const char *source_file, src_offset_t source_offset,
 	unsigned flags);
+gltexture_t *TexMgr_LoadColormappedImage (
+	qmodel_t *owner, const char *name, int width, int height, byte *data, const char *source_file, src_offset_t source_offset, unsigned flags, int shirt,
+	int pants);
 void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants);
 void TexMgr_ReloadNobrightImages (void);
 
 void TexMgr_UpdateTextureDescriptorSets (void);
+int	 TexMgr_Defragment (float max_occupancy);
+
+// RESIDENCY
+extern uint32_t texmgr_frame;
+
+void TexMgr_UpdateResidency (void);
+
+static inline void TexMgr_MarkUsed (gltexture_t *glt)
+{
+	if (glt && (Atomic_LoadUInt32 (&glt->last_used_frame) != texmgr_frame))
+		Atomic_StoreUInt32_Relaxed (&glt->last_used_frame, texmgr_frame);
+}
 
 typedef struct glheapstats_s glheapstats_t;
 glheapstats_t				*TexMgr_GetHeapStats (void);
 
+// Images of the UI renderer share the texture heap
+glheapallocation_t *TexMgr_AllocateExternal (const VkMemoryRequirements *memory_requirements, VkDeviceMemory *memory, VkDeviceSize *offset);
+void				TexMgr_FreeExternal (glheapallocation_t *allocation, VkDeviceSize size);
+uint32_t			TexMgr_GetExternalAllocations (uint64_t *bytes);
+
 #endif /* _GL_TEXMAN_H */
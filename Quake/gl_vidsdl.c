@@ -98,6 +98,9 @@ static void GL_InitInstance (void);
 static void GL_InitDevice (void);
 static void GL_CreateFrameBuffers (void);
 static void GL_DestroyRenderResources (void);
+static void GL_DestroyRenderPasses (void);
+static void VID_CaptureStart_f (void);
+static void VID_CaptureStop_f (void);
 
 viddef_t		vid; // global video state
 modestate_t		modestate = MS_UNINIT;
@@ -113,6 +116,7 @@ static cvar_t vid_width = {"vid_width", "1280", CVAR_ARCHIVE};		  // QuakeSpasm,
 static cvar_t vid_height = {"vid_height", "720", CVAR_ARCHIVE};		  // QuakeSpasm, was 480
 static cvar_t vid_refreshrate = {"vid_refreshrate", "60", CVAR_ARCHIVE};
 static cvar_t vid_vsync = {"vid_vsync", "0", CVAR_ARCHIVE};
+static cvar_t vid_lowlatency = {"vid_lowlatency", "0", CVAR_ARCHIVE};
 static cvar_t vid_desktopfullscreen = {"vid_desktopfullscreen", "0", CVAR_ARCHIVE}; // QuakeSpasm
 static cvar_t vid_borderless = {"vid_borderless", "0", CVAR_ARCHIVE};				// QuakeSpasm
 cvar_t		  vid_palettize = {"vid_palettize", "0", CVAR_ARCHIVE};
@@ -128,10 +132,22 @@ cvar_t		  r_ui_echo = {"r_ui_echo", "0", CVAR_NONE};
 cvar_t		  r_ui_echo_scale = {"r_ui_echo_scale", "1", CVAR_NONE};
 cvar_t		  r_ui_additive = {"r_ui_additive", "0", CVAR_NONE};
 cvar_t		  r_usesops = {"r_usesops", "1", CVAR_ARCHIVE}; // johnfitz
+static cvar_t r_gpuspeeds = {"r_gpuspeeds", "0", CVAR_NONE};
+static cvar_t r_dynamicscale = {"r_dynamicscale", "0", CVAR_ARCHIVE};
+static cvar_t r_dynamicscale_target = {"r_dynamicscale_target", "16.6", CVAR_ARCHIVE}; // gpu frame time in ms
+static cvar_t r_dynamicscale_min = {"r_dynamicscale_min", "0.5", CVAR_ARCHIVE};
+static cvar_t r_dynamicscale_max = {"r_dynamicscale_max", "1", CVAR_ARCHIVE};
+static cvar_t r_asynccompute = {"r_asynccompute", "0", CVAR_ARCHIVE};
+static cvar_t r_vrs = {"r_vrs", "0", CVAR_ARCHIVE};
 #if defined(_DEBUG)
 static cvar_t r_raydebug = {"r_raydebug", "0", 0};
 #endif
 
+extern cvar_t r_showtris;
+extern cvar_t r_showbboxes;
+extern cvar_t r_rtshadows;
+extern cvar_t host_framerate;
+
 static VkInstance				vulkan_instance;
 static VkPhysicalDevice			vulkan_physical_device;
 static VkSurfaceKHR				vulkan_surface;
@@ -140,6 +156,7 @@ static VkSwapchainKHR			vulkan_swapchain;
 
 static uint32_t			num_swap_chain_images;
 static qboolean			render_resources_created = false;
+static qboolean			render_passes_created = false;
 static uint32_t			current_cb_index;
 static VkCommandPool	primary_command_pools[PCBX_NUM];
 static VkCommandPool   *secondary_command_pools[SCBX_NUM];
@@ -148,6 +165,41 @@ static VkCommandBuffer	primary_command_buffers[PCBX_NUM][DOUBLE_BUFFERED];
 static VkCommandBuffer *secondary_command_buffers[SCBX_NUM][DOUBLE_BUFFERED];
 static VkFence			command_buffer_fences[DOUBLE_BUFFERED];
 static qboolean			frame_submitted[DOUBLE_BUFFERED];
+
+// r_asynccompute: the primary CBs before PCBX_RENDER_PASSES (acceleration structures, lightmaps,
+// warp) go to vulkan_globals.async_queue. A prologue CB on the graphics queue resets the GPU scope
+// queries and signals async_start, which orders the async work after everything submitted before
+// it, the previous frame still samples the lightmaps and warp images. PCBX_RENDER_PASSES waits for
+// async_done only at the stages that read what the async work wrote.
+static uint32_t		   gfx_queue_count;
+static VkCommandPool   async_command_pool;
+static VkCommandBuffer async_prologue_command_buffers[DOUBLE_BUFFERED];
+static VkSemaphore	   async_start_semaphores[DOUBLE_BUFFERED];
+static VkSemaphore	   async_done_semaphores[DOUBLE_BUFFERED];
+static qboolean		   async_compute_frame[DOUBLE_BUFFERED];
+
+// r_vrs: shading rate attachment of the main render pass, 2x2 where the UI layer of the
+// previous frame hid the 3D view. The contents persist across frames.
+typedef enum
+{
+	SHADING_RATE_UNDEFINED,
+	SHADING_RATE_FULL,	 // cleared to 1x1
+	SHADING_RATE_COARSE, // written by shading_rate.comp
+} shading_rate_contents_t;
+
+static VkImage				   shading_rate_image;
+static vulkan_memory_t		   shading_rate_image_memory;
+static VkImageView			   shading_rate_image_view;
+static shading_rate_contents_t shading_rate_contents;
+
+// Low latency pacing, see VID_PaceFrame. Written by the end rendering task, read after it was joined.
+#define PRESENT_HISTORY		 4
+#define PACING_SAFETY_MARGIN 0.002
+static uint64_t present_id; // last id passed to vkQueuePresentKHR, restarts with the swap chain
+static double	present_input_time[PRESENT_HISTORY];
+static double	present_interval = 1.0 / 60.0;
+static double	pacing_input_time; // input sample time of the frame being built, 0 if not pacing
+static double	pacing_frame_cost; // moving average of input sample to present, in seconds
 static VkFramebuffer	main_framebuffers[NUM_COLOR_BUFFERS];
 static VkSemaphore		image_aquired_semaphores[DOUBLE_BUFFERED];
 // Per-swapchain-image "render finished" semaphores, following Khronos guidance
@@ -157,6 +209,11 @@ static VkSemaphore		image_aquired_semaphores[DOUBLE_BUFFERED];
 static VkSemaphore		draw_complete_semaphores[MAX_SWAP_CHAIN_IMAGES];
 static VkFramebuffer	ui_framebuffers[MAX_SWAP_CHAIN_IMAGES];
 static uint32_t			gfx_timestamp_valid_bits;
+static VkQueryPool		gpu_scope_query_pools[DOUBLE_BUFFERED];
+static qboolean			gpu_scopes_recorded[DOUBLE_BUFFERED];
+static qboolean			gpu_scopes_active;
+static double			gpu_scope_times[GPU_SCOPE_NUM];
+static float			dynamic_scale = 1.0f;
 static VkFramebuffer	postprocess_framebuffers[MAX_SWAP_CHAIN_IMAGES];
 static VkSampler		postprocess_sampler;
 static VkImage			swapchain_images[MAX_SWAP_CHAIN_IMAGES];
@@ -187,9 +244,13 @@ static PFN_vkDestroySwapchainKHR					  fpDestroySwapchainKHR;
 static PFN_vkGetSwapchainImagesKHR					  fpGetSwapchainImagesKHR;
 static PFN_vkAcquireNextImageKHR					  fpAcquireNextImageKHR;
 static PFN_vkQueuePresentKHR						  fpQueuePresentKHR;
+#if defined(VK_KHR_present_wait)
+static PFN_vkWaitForPresentKHR fpWaitForPresentKHR;
+#endif
 static PFN_vkEnumerateInstanceVersion				  fpEnumerateInstanceVersion;
 static PFN_vkGetPhysicalDeviceFeatures2				  fpGetPhysicalDeviceFeatures2;
 static PFN_vkGetPhysicalDeviceProperties2			  fpGetPhysicalDeviceProperties2;
+static PFN_vkGetPhysicalDeviceMemoryProperties2		  fpGetPhysicalDeviceMemoryProperties2;
 #if defined(VK_EXT_full_screen_exclusive)
 static PFN_vkAcquireFullScreenExclusiveModeEXT fpAcquireFullScreenExclusiveModeEXT;
 static PFN_vkReleaseFullScreenExclusiveModeEXT fpReleaseFullScreenExclusiveModeEXT;
@@ -219,6 +280,46 @@ static char screenshot_ext[4];
 char		screenshot_imagename[MAX_OSPATH]; // johnfitz -- was [80]
 int			screenshot_quality;
 
+// Screenshots and movie frames are read back through a ring of host visible buffers and encoded on workers
+#define NUM_CAPTURE_SLOTS 4
+
+typedef enum
+{
+	CAPTURE_SLOT_FREE,
+	CAPTURE_SLOT_RECORDING, // the copy is in this frame's command buffer
+	CAPTURE_SLOT_COPYING,	// the GPU copy is in flight
+	CAPTURE_SLOT_QUEUED,  // waiting for an encoder
+	CAPTURE_SLOT_ENCODING,
+	CAPTURE_SLOT_DONE, // written, not reported yet
+} capture_slot_state_t;
+
+typedef struct
+{
+	atomic_uint32_t state;
+	VkBuffer		buffer;
+	vulkan_memory_t memory;
+	VkFence			fence;
+	byte		   *data;
+	int				width;
+	int				height;
+	int				quality;
+	qboolean		bgra;
+	qboolean		movie;
+	qboolean		ok;
+	char			ext[4];
+	char			name[MAX_OSPATH];
+} capture_slot_t;
+
+static capture_slot_t capture_slots[NUM_CAPTURE_SLOTS];
+
+// capture_start
+static qboolean capture_movie;
+static char		capture_dir[MAX_OSPATH];
+static char		capture_ext[4];
+static int		capture_quality;
+static int		capture_frame;
+static float	capture_old_framerate;
+
 task_handle_t prev_end_rendering_task = INVALID_TASK_HANDLE;
 
 #define GET_INSTANCE_PROC_ADDR(entrypoint)                                                              \
@@ -803,6 +904,55 @@ void GL_SetObjectName (uint64_t object, VkObjectType object_type, const char *na
 #endif
 }
 
+/*
+===============
+GL_CompressedFormatSupported
+===============
+*/
+qboolean GL_CompressedFormatSupported (VkFormat format)
+{
+	const qboolean astc = (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK) && (format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK);
+	if (astc ? !vulkan_globals.texture_compression_astc : !vulkan_globals.texture_compression_bc)
+		return false;
+
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties (vulkan_physical_device, format, &format_properties);
+	return (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) ? true : false;
+}
+
+/*
+===============
+GL_GetDeviceMemoryBudget
+
+Usage and budget of the device local heaps from VK_EXT_memory_budget, false if
+the extension isn't available
+===============
+*/
+qboolean GL_GetDeviceMemoryBudget (uint64_t *usage, uint64_t *budget)
+{
+	if (!vulkan_globals.memory_budget)
+		return false;
+
+	ZEROED_STRUCT (VkPhysicalDeviceMemoryBudgetPropertiesEXT, memory_budget_properties);
+	memory_budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	ZEROED_STRUCT (VkPhysicalDeviceMemoryProperties2, memory_properties_2);
+	memory_properties_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memory_properties_2.pNext = &memory_budget_properties;
+	fpGetPhysicalDeviceMemoryProperties2 (vulkan_physical_device, &memory_properties_2);
+
+	*usage = 0;
+	*budget = 0;
+	for (uint32_t i = 0; i < memory_properties_2.memoryProperties.memoryHeapCount; ++i)
+	{
+		if (memory_properties_2.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			*usage += memory_budget_properties.heapUsage[i];
+			*budget += memory_budget_properties.heapBudget[i];
+		}
+	}
+	return true;
+}
+
 /*
 ===============
 GL_InitInstance
@@ -929,6 +1079,7 @@ static void GL_InitInstance (void)
 	{
 		GET_INSTANCE_PROC_ADDR (GetPhysicalDeviceProperties2);
 		GET_INSTANCE_PROC_ADDR (GetPhysicalDeviceFeatures2);
+		GET_INSTANCE_PROC_ADDR (GetPhysicalDeviceMemoryProperties2);
 	}
 
 	if (vulkan_globals.get_surface_capabilities_2)
@@ -1112,6 +1263,12 @@ static void GL_InitDevice (void)
 	vulkan_globals.ray_query = false;
 	vulkan_globals.synchronization_2 = false;
 	vulkan_globals.dynamic_rendering = false;
+	vulkan_globals.descriptor_indexing = false;
+	vulkan_globals.memory_budget = false;
+	vulkan_globals.present_wait = false;
+	vulkan_globals.fragment_shading_rate = false;
+	qboolean present_id_available = false;
+	qboolean create_renderpass_2_available = false;
 
 	vkGetPhysicalDeviceMemoryProperties (vulkan_physical_device, &vulkan_globals.memory_properties);
 	vkGetPhysicalDeviceProperties (vulkan_physical_device, &vulkan_globals.device_properties);
@@ -1145,6 +1302,20 @@ static void GL_InitDevice (void)
 				vulkan_globals.synchronization_2 = true;
 			if (strcmp (VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
 				vulkan_globals.dynamic_rendering = true;
+			if (strcmp (VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
+				vulkan_globals.descriptor_indexing = true;
+			if (vulkan_globals.get_physical_device_properties_2 && strcmp (VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
+				vulkan_globals.memory_budget = true;
+			if (strcmp (VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
+				vulkan_globals.fragment_shading_rate = true;
+			if (strcmp (VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
+				create_renderpass_2_available = true;
+#if defined(VK_KHR_present_wait)
+			if (vulkan_globals.get_physical_device_properties_2 && strcmp (VK_KHR_PRESENT_ID_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
+				present_id_available = true;
+			if (vulkan_globals.get_physical_device_properties_2 && strcmp (VK_KHR_PRESENT_WAIT_EXTENSION_NAME, device_extensions[i].extensionName) == 0)
+				vulkan_globals.present_wait = true;
+#endif
 		}
 
 		Mem_Free (device_extensions);
@@ -1209,7 +1380,10 @@ static void GL_InitDevice (void)
 
 	gfx_timestamp_valid_bits = 0;
 	if (found_graphics_queue)
+	{
 		gfx_timestamp_valid_bits = queue_family_properties[vulkan_globals.gfx_queue_family_index].timestampValidBits;
+		gfx_queue_count = q_min (queue_family_properties[vulkan_globals.gfx_queue_family_index].queueCount, 2u);
+	}
 
 	Mem_Free (queue_supports_present);
 	Mem_Free (queue_family_properties);
@@ -1217,11 +1391,11 @@ static void GL_InitDevice (void)
 	if (!found_graphics_queue)
 		Sys_Error ("Couldn't find graphics queue");
 
-	float queue_priorities[] = {0.0};
+	float queue_priorities[] = {0.0, 0.0};
 	ZEROED_STRUCT (VkDeviceQueueCreateInfo, queue_create_info);
 	queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 	queue_create_info.queueFamilyIndex = vulkan_globals.gfx_queue_family_index;
-	queue_create_info.queueCount = 1;
+	queue_create_info.queueCount = gfx_queue_count;
 	queue_create_info.pQueuePriorities = queue_priorities;
 
 	ZEROED_STRUCT (VkPhysicalDeviceSubgroupProperties, physical_device_subgroup_properties);
@@ -1232,6 +1406,13 @@ static void GL_InitDevice (void)
 	ZEROED_STRUCT (VkPhysicalDeviceRayQueryFeaturesKHR, ray_query_features);
 	ZEROED_STRUCT (VkPhysicalDeviceSynchronization2FeaturesKHR, synchronization_2_features);
 	ZEROED_STRUCT (VkPhysicalDeviceDynamicRenderingFeaturesKHR, dynamic_rendering_features);
+	ZEROED_STRUCT (VkPhysicalDeviceDescriptorIndexingFeaturesEXT, descriptor_indexing_features);
+	ZEROED_STRUCT (VkPhysicalDeviceFragmentShadingRateFeaturesKHR, fragment_shading_rate_features);
+	ZEROED_STRUCT (VkPhysicalDeviceFragmentShadingRatePropertiesKHR, fragment_shading_rate_properties);
+#if defined(VK_KHR_present_wait)
+	ZEROED_STRUCT (VkPhysicalDevicePresentIdFeaturesKHR, present_id_features);
+	ZEROED_STRUCT (VkPhysicalDevicePresentWaitFeaturesKHR, present_wait_features);
+#endif
 	memset (&vulkan_globals.physical_device_acceleration_structure_properties, 0, sizeof (vulkan_globals.physical_device_acceleration_structure_properties));
 	if (vulkan_globals.vulkan_1_1_available)
 	{
@@ -1251,6 +1432,11 @@ static void GL_InitDevice (void)
 			vulkan_globals.physical_device_acceleration_structure_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
 			CHAIN_PNEXT (device_properties_next, vulkan_globals.physical_device_acceleration_structure_properties);
 		}
+		if (vulkan_globals.fragment_shading_rate)
+		{
+			fragment_shading_rate_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_PROPERTIES_KHR;
+			CHAIN_PNEXT (device_properties_next, fragment_shading_rate_properties);
+		}
 
 		fpGetPhysicalDeviceProperties2 (vulkan_physical_device, &physical_device_properties_2);
 
@@ -1282,6 +1468,25 @@ static void GL_InitDevice (void)
 			dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
 			CHAIN_PNEXT (device_features_next, dynamic_rendering_features);
 		}
+		if (vulkan_globals.descriptor_indexing)
+		{
+			descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+			CHAIN_PNEXT (device_features_next, descriptor_indexing_features);
+		}
+		if (vulkan_globals.fragment_shading_rate)
+		{
+			fragment_shading_rate_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR;
+			CHAIN_PNEXT (device_features_next, fragment_shading_rate_features);
+		}
+#if defined(VK_KHR_present_wait)
+		if (vulkan_globals.present_wait && present_id_available)
+		{
+			present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+			CHAIN_PNEXT (device_features_next, present_id_features);
+			present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+			CHAIN_PNEXT (device_features_next, present_wait_features);
+		}
+#endif
 
 		fpGetPhysicalDeviceFeatures2 (vulkan_physical_device, &physical_device_features_2);
 		vulkan_globals.device_features = physical_device_features_2.features;
@@ -1316,6 +1521,44 @@ static void GL_InitDevice (void)
 	if (vulkan_globals.dynamic_rendering)
 		Con_Printf ("Using VK_KHR_dynamic_rendering\n");
 
+	// Only what the bindless UI texture array needs. The extension depends on VK_KHR_maintenance3 which is core in 1.1
+	vulkan_globals.descriptor_indexing =
+		vulkan_globals.vulkan_1_1_available && (vulkan_globals.device_properties.apiVersion >= VK_MAKE_VERSION (1, 1, 0)) && vulkan_globals.descriptor_indexing &&
+		vulkan_globals.device_features.shaderSampledImageArrayDynamicIndexing && descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind &&
+		descriptor_indexing_features.descriptorBindingPartiallyBound && descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending;
+	if (vulkan_globals.descriptor_indexing)
+		Con_Printf ("Using VK_EXT_descriptor_indexing\n");
+	if (vulkan_globals.memory_budget)
+		Con_Printf ("Using VK_EXT_memory_budget\n");
+
+	// r_vrs only uses the attachment rate, written by shading_rate.comp as r8ui storage
+	if (vulkan_globals.fragment_shading_rate)
+	{
+		VkFormatProperties		   rate_format_properties;
+		const VkFormatFeatureFlags rate_format_features = VK_FORMAT_FEATURE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+		vkGetPhysicalDeviceFormatProperties (vulkan_physical_device, VK_FORMAT_R8_UINT, &rate_format_properties);
+
+		const VkExtent2D min_texel_size = fragment_shading_rate_properties.minFragmentShadingRateAttachmentTexelSize;
+		const VkExtent2D max_texel_size = fragment_shading_rate_properties.maxFragmentShadingRateAttachmentTexelSize;
+		const uint32_t	 texel_size_min = q_max (min_texel_size.width, min_texel_size.height);
+		const uint32_t	 texel_size_max = q_min (max_texel_size.width, max_texel_size.height);
+		vulkan_globals.shading_rate_texel_size = q_max (texel_size_min, q_min (16u, texel_size_max));
+
+		vulkan_globals.fragment_shading_rate =
+			create_renderpass_2_available && (vulkan_globals.device_properties.apiVersion >= VK_MAKE_VERSION (1, 1, 0)) &&
+			fragment_shading_rate_features.attachmentFragmentShadingRate && vulkan_globals.device_features.shaderStorageImageExtendedFormats &&
+			((rate_format_properties.optimalTilingFeatures & rate_format_features) == rate_format_features) && (texel_size_min <= texel_size_max);
+	}
+	if (vulkan_globals.fragment_shading_rate)
+		Con_Printf ("Using VK_KHR_fragment_shading_rate (%ux%u texels)\n", vulkan_globals.shading_rate_texel_size, vulkan_globals.shading_rate_texel_size);
+#if defined(VK_KHR_present_wait)
+	// Both are needed for vid_lowlatency pacing, the features stay zeroed if they weren't queried
+	vulkan_globals.present_wait =
+		vulkan_globals.present_wait && present_id_available && present_id_features.presentId && present_wait_features.presentWait;
+	if (vulkan_globals.present_wait)
+		Con_Printf ("Using VK_KHR_present_wait\n");
+#endif
+
 	const char *device_extensions[32] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 	uint32_t	numEnabledExtensions = 1;
 	if (vulkan_globals.dedicated_allocation)
@@ -1344,6 +1587,22 @@ static void GL_InitDevice (void)
 		device_extensions[numEnabledExtensions++] = VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME;
 	if (vulkan_globals.dynamic_rendering)
 		device_extensions[numEnabledExtensions++] = VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+	if (vulkan_globals.descriptor_indexing && !vulkan_globals.ray_query) // ray queries already enable it
+		device_extensions[numEnabledExtensions++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+	if (vulkan_globals.memory_budget)
+		device_extensions[numEnabledExtensions++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+	if (vulkan_globals.fragment_shading_rate)
+	{
+		device_extensions[numEnabledExtensions++] = VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME;
+		device_extensions[numEnabledExtensions++] = VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME;
+	}
+#if defined(VK_KHR_present_wait)
+	if (vulkan_globals.present_wait)
+	{
+		device_extensions[numEnabledExtensions++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+		device_extensions[numEnabledExtensions++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+	}
+#endif
 
 	const VkBool32 extended_format_support = vulkan_globals.device_features.shaderStorageImageExtendedFormats;
 	const VkBool32 sampler_anisotropic = vulkan_globals.device_features.samplerAnisotropy;
@@ -1354,9 +1613,14 @@ static void GL_InitDevice (void)
 	device_features.sampleRateShading = vulkan_globals.device_features.sampleRateShading;
 	device_features.fillModeNonSolid = vulkan_globals.device_features.fillModeNonSolid;
 	device_features.multiDrawIndirect = vulkan_globals.device_features.multiDrawIndirect;
+	device_features.textureCompressionBC = vulkan_globals.device_features.textureCompressionBC;
+	device_features.textureCompressionASTC_LDR = vulkan_globals.device_features.textureCompressionASTC_LDR;
+	device_features.shaderSampledImageArrayDynamicIndexing = vulkan_globals.descriptor_indexing;
 
 	vulkan_globals.non_solid_fill = (device_features.fillModeNonSolid == VK_TRUE) ? true : false;
 	vulkan_globals.multi_draw_indirect = (device_features.multiDrawIndirect == VK_TRUE) ? true : false;
+	vulkan_globals.texture_compression_bc = (device_features.textureCompressionBC == VK_TRUE) ? true : false;
+	vulkan_globals.texture_compression_astc = (device_features.textureCompressionASTC_LDR == VK_TRUE) ? true : false;
 
 	ZEROED_STRUCT (VkDeviceCreateInfo, device_create_info);
 	device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -1373,6 +1637,23 @@ static void GL_InitDevice (void)
 		CHAIN_PNEXT (device_create_info_next, synchronization_2_features);
 	if (vulkan_globals.dynamic_rendering)
 		CHAIN_PNEXT (device_create_info_next, dynamic_rendering_features);
+	if (vulkan_globals.descriptor_indexing)
+		CHAIN_PNEXT (device_create_info_next, descriptor_indexing_features);
+	if (vulkan_globals.fragment_shading_rate)
+	{
+		// Only the attachment rate is used
+		fragment_shading_rate_features.pipelineFragmentShadingRate = VK_FALSE;
+		fragment_shading_rate_features.primitiveFragmentShadingRate = VK_FALSE;
+		fragment_shading_rate_features.pNext = NULL;
+		CHAIN_PNEXT (device_create_info_next, fragment_shading_rate_features);
+	}
+#if defined(VK_KHR_present_wait)
+	if (vulkan_globals.present_wait)
+	{
+		CHAIN_PNEXT (device_create_info_next, present_id_features);
+		CHAIN_PNEXT (device_create_info_next, present_wait_features);
+	}
+#endif
 	device_create_info.queueCreateInfoCount = 1;
 	device_create_info.pQueueCreateInfos = &queue_create_info;
 	device_create_info.enabledExtensionCount = numEnabledExtensions;
@@ -1388,6 +1669,10 @@ static void GL_InitDevice (void)
 	GET_DEVICE_PROC_ADDR (GetSwapchainImagesKHR);
 	GET_DEVICE_PROC_ADDR (AcquireNextImageKHR);
 	GET_DEVICE_PROC_ADDR (QueuePresentKHR);
+#if defined(VK_KHR_present_wait)
+	if (vulkan_globals.present_wait)
+		GET_DEVICE_PROC_ADDR (WaitForPresentKHR);
+#endif
 
 	Con_Printf ("Device extensions:\n");
 	for (i = 0; i < numEnabledExtensions; ++i)
@@ -1418,6 +1703,8 @@ static void GL_InitDevice (void)
 		GET_GLOBAL_DEVICE_PROC_ADDR (vk_cmd_begin_rendering, vkCmdBeginRenderingKHR);
 		GET_GLOBAL_DEVICE_PROC_ADDR (vk_cmd_end_rendering, vkCmdEndRenderingKHR);
 	}
+	if (vulkan_globals.fragment_shading_rate)
+		GET_GLOBAL_DEVICE_PROC_ADDR (vk_create_render_pass_2, vkCreateRenderPass2KHR);
 #ifdef _DEBUG
 	if (vulkan_globals.debug_utils)
 	{
@@ -1428,6 +1715,12 @@ static void GL_InitDevice (void)
 #endif
 
 	vkGetDeviceQueue (vulkan_globals.device, vulkan_globals.gfx_queue_family_index, 0, &vulkan_globals.queue);
+	vulkan_globals.async_queue = VK_NULL_HANDLE;
+	if (gfx_queue_count > 1)
+	{
+		vkGetDeviceQueue (vulkan_globals.device, vulkan_globals.gfx_queue_family_index, 1, &vulkan_globals.async_queue);
+		Con_Printf ("Async compute queue available\n");
+	}
 
 	VkFormatProperties format_properties;
 
@@ -1469,6 +1762,10 @@ static void GL_InitDevice (void)
 		Sys_Error ("Cannot find VK_FORMAT_D24_UNORM_S8_UINT or VK_FORMAT_D32_SFLOAT_S8_UINT depth buffer format");
 	}
 
+	// Occlusion culling reads the depth buffer back
+	vkGetPhysicalDeviceFormatProperties (vulkan_physical_device, vulkan_globals.depth_format, &format_properties);
+	vulkan_globals.sampled_depth = (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+
 	Con_Printf ("\n");
 
 	GET_GLOBAL_DEVICE_PROC_ADDR (vk_cmd_bind_pipeline, vkCmdBindPipeline);
@@ -1570,7 +1867,171 @@ static void GL_InitCommandBuffers (void)
 		if (err != VK_SUCCESS)
 			Sys_Error ("vkCreateFence failed");
 	}
+
+	if ((gfx_timestamp_valid_bits > 0) && (vulkan_globals.device_properties.limits.timestampPeriod > 0.0f))
+	{
+		ZEROED_STRUCT (VkQueryPoolCreateInfo, query_pool_create_info);
+		query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		query_pool_create_info.queryCount = GPU_SCOPE_NUM * 2;
+
+		for (int i = 0; i < DOUBLE_BUFFERED; ++i)
+		{
+			err = vkCreateQueryPool (vulkan_globals.device, &query_pool_create_info, NULL, &gpu_scope_query_pools[i]);
+			if (err != VK_SUCCESS)
+			{
+				Con_Warning ("vkCreateQueryPool failed, r_gpuspeeds disabled\n");
+				for (int j = 0; j < i; ++j)
+					vkDestroyQueryPool (vulkan_globals.device, gpu_scope_query_pools[j], NULL);
+				memset (gpu_scope_query_pools, 0, sizeof (gpu_scope_query_pools));
+				break;
+			}
+			GL_SetObjectName ((uint64_t)gpu_scope_query_pools[i], VK_OBJECT_TYPE_QUERY_POOL, va ("GPU scopes cb_index: %d", i));
+		}
+	}
 	// Note: draw_complete_semaphores are now created per-swapchain-image in GL_CreateSwapChain
+
+	if (vulkan_globals.async_queue != VK_NULL_HANDLE)
+	{
+		err = vkCreateCommandPool (vulkan_globals.device, &command_pool_create_info, NULL, &async_command_pool);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkCreateCommandPool failed");
+
+		ZEROED_STRUCT (VkCommandBufferAllocateInfo, command_buffer_allocate_info);
+		command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_allocate_info.commandPool = async_command_pool;
+		command_buffer_allocate_info.commandBufferCount = DOUBLE_BUFFERED;
+		err = vkAllocateCommandBuffers (vulkan_globals.device, &command_buffer_allocate_info, async_prologue_command_buffers);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkAllocateCommandBuffers failed");
+
+		ZEROED_STRUCT (VkSemaphoreCreateInfo, semaphore_create_info);
+		semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		for (int i = 0; i < DOUBLE_BUFFERED; ++i)
+		{
+			if ((vkCreateSemaphore (vulkan_globals.device, &semaphore_create_info, NULL, &async_start_semaphores[i]) != VK_SUCCESS) ||
+				(vkCreateSemaphore (vulkan_globals.device, &semaphore_create_info, NULL, &async_done_semaphores[i]) != VK_SUCCESS))
+				Sys_Error ("vkCreateSemaphore failed");
+		}
+	}
+}
+
+/*
+====================
+GL_AttachmentReference2
+====================
+*/
+static VkAttachmentReference2KHR GL_AttachmentReference2 (const VkAttachmentReference *reference)
+{
+	ZEROED_STRUCT (VkAttachmentReference2KHR, reference_2);
+	reference_2.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2_KHR;
+	reference_2.attachment = reference->attachment;
+	reference_2.layout = reference->layout;
+	return reference_2;
+}
+
+/*
+====================
+GL_CreateMainRenderPass
+
+With r_vrs support the main render pass is recreated through VK_KHR_create_renderpass2, which
+is the only way to attach the shading rate image. It is always the last attachment.
+====================
+*/
+static VkResult GL_CreateMainRenderPass (const VkRenderPassCreateInfo *render_pass_create_info, VkRenderPass *render_pass)
+{
+	if (!vulkan_globals.fragment_shading_rate)
+		return vkCreateRenderPass (vulkan_globals.device, render_pass_create_info, NULL, render_pass);
+
+	const VkSubpassDescription *subpass = render_pass_create_info->pSubpasses;
+	assert ((render_pass_create_info->subpassCount == 1) && (render_pass_create_info->attachmentCount < 4) && (subpass->colorAttachmentCount == 1));
+	assert (render_pass_create_info->dependencyCount <= 1);
+
+	ZEROED_STRUCT_ARRAY (VkAttachmentDescription2KHR, attachments, 4);
+	for (uint32_t i = 0; i < render_pass_create_info->attachmentCount; ++i)
+	{
+		const VkAttachmentDescription *attachment = &render_pass_create_info->pAttachments[i];
+		attachments[i].sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2_KHR;
+		attachments[i].flags = attachment->flags;
+		attachments[i].format = attachment->format;
+		attachments[i].samples = attachment->samples;
+		attachments[i].loadOp = attachment->loadOp;
+		attachments[i].storeOp = attachment->storeOp;
+		attachments[i].stencilLoadOp = attachment->stencilLoadOp;
+		attachments[i].stencilStoreOp = attachment->stencilStoreOp;
+		attachments[i].initialLayout = attachment->initialLayout;
+		attachments[i].finalLayout = attachment->finalLayout;
+	}
+
+	// Kept across frames while r_vrs is off, so it has to be stored
+	const uint32_t shading_rate_index = render_pass_create_info->attachmentCount;
+	attachments[shading_rate_index].sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2_KHR;
+	attachments[shading_rate_index].format = VK_FORMAT_R8_UINT;
+	attachments[shading_rate_index].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[shading_rate_index].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[shading_rate_index].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[shading_rate_index].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[shading_rate_index].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[shading_rate_index].initialLayout = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+	attachments[shading_rate_index].finalLayout = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+
+	ZEROED_STRUCT (VkAttachmentReference2KHR, shading_rate_reference);
+	shading_rate_reference.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2_KHR;
+	shading_rate_reference.attachment = shading_rate_index;
+	shading_rate_reference.layout = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+
+	ZEROED_STRUCT (VkFragmentShadingRateAttachmentInfoKHR, shading_rate_attachment_info);
+	shading_rate_attachment_info.sType = VK_STRUCTURE_TYPE_FRAGMENT_SHADING_RATE_ATTACHMENT_INFO_KHR;
+	shading_rate_attachment_info.pFragmentShadingRateAttachment = &shading_rate_reference;
+	shading_rate_attachment_info.shadingRateAttachmentTexelSize.width = vulkan_globals.shading_rate_texel_size;
+	shading_rate_attachment_info.shadingRateAttachmentTexelSize.height = vulkan_globals.shading_rate_texel_size;
+
+	const VkAttachmentReference2KHR color_reference = GL_AttachmentReference2 (&subpass->pColorAttachments[0]);
+	VkAttachmentReference2KHR		depth_reference;
+	VkAttachmentReference2KHR		resolve_reference;
+
+	ZEROED_STRUCT (VkSubpassDescription2KHR, subpass_2);
+	subpass_2.sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2_KHR;
+	subpass_2.pNext = &shading_rate_attachment_info;
+	subpass_2.flags = subpass->flags;
+	subpass_2.pipelineBindPoint = subpass->pipelineBindPoint;
+	subpass_2.colorAttachmentCount = 1;
+	subpass_2.pColorAttachments = &color_reference;
+	if (subpass->pDepthStencilAttachment)
+	{
+		depth_reference = GL_AttachmentReference2 (subpass->pDepthStencilAttachment);
+		subpass_2.pDepthStencilAttachment = &depth_reference;
+	}
+	if (subpass->pResolveAttachments)
+	{
+		resolve_reference = GL_AttachmentReference2 (&subpass->pResolveAttachments[0]);
+		subpass_2.pResolveAttachments = &resolve_reference;
+	}
+
+	ZEROED_STRUCT (VkSubpassDependency2KHR, dependency_2);
+	if (render_pass_create_info->dependencyCount)
+	{
+		const VkSubpassDependency *dependency = render_pass_create_info->pDependencies;
+		dependency_2.sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2_KHR;
+		dependency_2.srcSubpass = dependency->srcSubpass;
+		dependency_2.dstSubpass = dependency->dstSubpass;
+		dependency_2.srcStageMask = dependency->srcStageMask;
+		dependency_2.dstStageMask = dependency->dstStageMask;
+		dependency_2.srcAccessMask = dependency->srcAccessMask;
+		dependency_2.dstAccessMask = dependency->dstAccessMask;
+		dependency_2.dependencyFlags = dependency->dependencyFlags;
+	}
+
+	ZEROED_STRUCT (VkRenderPassCreateInfo2KHR, render_pass_create_info_2);
+	render_pass_create_info_2.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2_KHR;
+	render_pass_create_info_2.attachmentCount = render_pass_create_info->attachmentCount + 1;
+	render_pass_create_info_2.pAttachments = attachments;
+	render_pass_create_info_2.subpassCount = 1;
+	render_pass_create_info_2.pSubpasses = &subpass_2;
+	render_pass_create_info_2.dependencyCount = render_pass_create_info->dependencyCount;
+	render_pass_create_info_2.pDependencies = &dependency_2;
+
+	return vulkan_globals.vk_create_render_pass_2 (vulkan_globals.device, &render_pass_create_info_2, NULL, render_pass);
 }
 
 /*
@@ -1602,7 +2063,7 @@ static void GL_CreateRenderPasses ()
 		attachment_descriptions[1].samples = vulkan_globals.sample_count;
 		attachment_descriptions[1].format = vulkan_globals.depth_format;
 		attachment_descriptions[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachment_descriptions[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment_descriptions[1].storeOp = vulkan_globals.sampled_depth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		attachment_descriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		attachment_descriptions[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
@@ -1661,13 +2122,13 @@ static void GL_CreateRenderPasses ()
 				assert (vulkan_globals.secondary_cb_contexts[scbx_index][i].render_pass == VK_NULL_HANDLE);
 		}
 
-		err = vkCreateRenderPass (vulkan_globals.device, &render_pass_create_info, NULL, &vulkan_globals.main_render_pass[0]);
+		err = GL_CreateMainRenderPass (&render_pass_create_info, &vulkan_globals.main_render_pass[0]);
 		if (err != VK_SUCCESS)
 			Sys_Error ("Couldn't create Vulkan render pass");
 		GL_SetObjectName ((uint64_t)vulkan_globals.main_render_pass[0], VK_OBJECT_TYPE_RENDER_PASS, "main");
 
 		attachment_descriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		err = vkCreateRenderPass (vulkan_globals.device, &render_pass_create_info, NULL, &vulkan_globals.main_render_pass[1]);
+		err = GL_CreateMainRenderPass (&render_pass_create_info, &vulkan_globals.main_render_pass[1]);
 		if (err != VK_SUCCESS)
 			Sys_Error ("Couldn't create Vulkan render pass");
 		GL_SetObjectName ((uint64_t)vulkan_globals.main_render_pass[1], VK_OBJECT_TYPE_RENDER_PASS, "main_no_stencil");
@@ -1859,6 +2320,8 @@ static void GL_CreateDepthBuffer (void)
 	image_create_info.samples = vulkan_globals.sample_count;
 	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
 	image_create_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (vulkan_globals.sampled_depth)
+		image_create_info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; // occlusion_depth.comp
 
 	assert (depth_buffer == VK_NULL_HANDLE);
 	err = vkCreateImage (vulkan_globals.device, &image_create_info, NULL, &depth_buffer);
@@ -1910,6 +2373,77 @@ static void GL_CreateDepthBuffer (void)
 	GL_SetObjectName ((uint64_t)depth_buffer_view, VK_OBJECT_TYPE_IMAGE_VIEW, "Depth Buffer View");
 }
 
+/*
+===============
+GL_CreateShadingRateImage
+===============
+*/
+static void GL_CreateShadingRateImage (void)
+{
+	if (!vulkan_globals.fragment_shading_rate)
+		return;
+
+	Sys_Printf ("Creating shading rate image\n");
+
+	VkResult err;
+
+	ZEROED_STRUCT (VkImageCreateInfo, image_create_info);
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = VK_FORMAT_R8_UINT;
+	image_create_info.extent.width = (vid.width + vulkan_globals.shading_rate_texel_size - 1) / vulkan_globals.shading_rate_texel_size;
+	image_create_info.extent.height = (vid.height + vulkan_globals.shading_rate_texel_size - 1) / vulkan_globals.shading_rate_texel_size;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	assert (shading_rate_image == VK_NULL_HANDLE);
+	err = vkCreateImage (vulkan_globals.device, &image_create_info, NULL, &shading_rate_image);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImage failed");
+
+	GL_SetObjectName ((uint64_t)shading_rate_image, VK_OBJECT_TYPE_IMAGE, "Shading Rate Image");
+
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements (vulkan_globals.device, shading_rate_image, &memory_requirements);
+
+	ZEROED_STRUCT (VkMemoryAllocateInfo, memory_allocate_info);
+	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.allocationSize = memory_requirements.size;
+	memory_allocate_info.memoryTypeIndex = GL_MemoryTypeFromProperties (memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+
+	assert (shading_rate_image_memory.handle == VK_NULL_HANDLE);
+	R_AllocateVulkanMemory (&shading_rate_image_memory, &memory_allocate_info, VULKAN_MEMORY_TYPE_DEVICE, &num_vulkan_misc_allocations);
+	GL_SetObjectName ((uint64_t)shading_rate_image_memory.handle, VK_OBJECT_TYPE_DEVICE_MEMORY, "Shading Rate Image");
+
+	err = vkBindImageMemory (vulkan_globals.device, shading_rate_image, shading_rate_image_memory.handle, 0);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindImageMemory failed");
+
+	ZEROED_STRUCT (VkImageViewCreateInfo, image_view_create_info);
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.format = VK_FORMAT_R8_UINT;
+	image_view_create_info.image = shading_rate_image;
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_view_create_info.subresourceRange.baseMipLevel = 0;
+	image_view_create_info.subresourceRange.levelCount = 1;
+	image_view_create_info.subresourceRange.baseArrayLayer = 0;
+	image_view_create_info.subresourceRange.layerCount = 1;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+	assert (shading_rate_image_view == VK_NULL_HANDLE);
+	err = vkCreateImageView (vulkan_globals.device, &image_view_create_info, NULL, &shading_rate_image_view);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateImageView failed");
+
+	GL_SetObjectName ((uint64_t)shading_rate_image_view, VK_OBJECT_TYPE_IMAGE_VIEW, "Shading Rate Image View");
+
+	shading_rate_contents = SHADING_RATE_UNDEFINED;
+}
+
 /*
 ===============
 GL_CreateColorBuffer
@@ -2207,6 +2741,77 @@ void GL_UpdateDescriptorSets (void)
 
 	vkUpdateDescriptorSets (vulkan_globals.device, countof (screen_effects_writes), screen_effects_writes, 0, NULL);
 
+	if (vulkan_globals.sampled_depth)
+	{
+		if (vulkan_globals.occlusion_depth_desc_set != VK_NULL_HANDLE)
+			R_FreeDescriptorSet (vulkan_globals.occlusion_depth_desc_set, &vulkan_globals.occlusion_depth_set_layout);
+		vulkan_globals.occlusion_depth_desc_set = R_AllocateDescriptorSet (&vulkan_globals.occlusion_depth_set_layout);
+
+		ZEROED_STRUCT (VkDescriptorImageInfo, depth_image_info);
+		depth_image_info.imageView = depth_buffer_view;
+		depth_image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depth_image_info.sampler = vulkan_globals.point_sampler;
+
+		ZEROED_STRUCT (VkDescriptorBufferInfo, grid_buffer_info);
+		grid_buffer_info.buffer = R_GetOcclusionBuffer ();
+		grid_buffer_info.offset = 0;
+		grid_buffer_info.range = VK_WHOLE_SIZE;
+
+		ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, occlusion_depth_writes, 2);
+		occlusion_depth_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		occlusion_depth_writes[0].dstBinding = 0;
+		occlusion_depth_writes[0].dstArrayElement = 0;
+		occlusion_depth_writes[0].descriptorCount = 1;
+		occlusion_depth_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		occlusion_depth_writes[0].dstSet = vulkan_globals.occlusion_depth_desc_set;
+		occlusion_depth_writes[0].pImageInfo = &depth_image_info;
+
+		occlusion_depth_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		occlusion_depth_writes[1].dstBinding = 1;
+		occlusion_depth_writes[1].dstArrayElement = 0;
+		occlusion_depth_writes[1].descriptorCount = 1;
+		occlusion_depth_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		occlusion_depth_writes[1].dstSet = vulkan_globals.occlusion_depth_desc_set;
+		occlusion_depth_writes[1].pBufferInfo = &grid_buffer_info;
+
+		vkUpdateDescriptorSets (vulkan_globals.device, countof (occlusion_depth_writes), occlusion_depth_writes, 0, NULL);
+	}
+
+	if (vulkan_globals.fragment_shading_rate)
+	{
+		if (vulkan_globals.shading_rate_desc_set != VK_NULL_HANDLE)
+			R_FreeDescriptorSet (vulkan_globals.shading_rate_desc_set, &vulkan_globals.shading_rate_set_layout);
+		vulkan_globals.shading_rate_desc_set = R_AllocateDescriptorSet (&vulkan_globals.shading_rate_set_layout);
+
+		ZEROED_STRUCT (VkDescriptorImageInfo, ui_image_info);
+		ui_image_info.imageView = color_buffers_view[1];
+		ui_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		ui_image_info.sampler = postprocess_sampler;
+
+		ZEROED_STRUCT (VkDescriptorImageInfo, rate_image_info);
+		rate_image_info.imageView = shading_rate_image_view;
+		rate_image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, shading_rate_writes, 2);
+		shading_rate_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		shading_rate_writes[0].dstBinding = 0;
+		shading_rate_writes[0].dstArrayElement = 0;
+		shading_rate_writes[0].descriptorCount = 1;
+		shading_rate_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		shading_rate_writes[0].dstSet = vulkan_globals.shading_rate_desc_set;
+		shading_rate_writes[0].pImageInfo = &ui_image_info;
+
+		shading_rate_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		shading_rate_writes[1].dstBinding = 1;
+		shading_rate_writes[1].dstArrayElement = 0;
+		shading_rate_writes[1].descriptorCount = 1;
+		shading_rate_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		shading_rate_writes[1].dstSet = vulkan_globals.shading_rate_desc_set;
+		shading_rate_writes[1].pImageInfo = &rate_image_info;
+
+		vkUpdateDescriptorSets (vulkan_globals.device, countof (shading_rate_writes), shading_rate_writes, 0, NULL);
+	}
+
 #if defined(_DEBUG)
 	if (vulkan_globals.ray_query && bmodel_tlas)
 	{
@@ -2453,6 +3058,8 @@ static qboolean GL_CreateSwapChain (void)
 		}
 	}
 	num_images_acquired = 0;
+	present_id = 0;
+	present_interval = 1.0 / q_max (VID_GetCurrentRefreshRate (), 1);
 
 	for (i = 0; i < num_swap_chain_images; ++i)
 		assert (swapchain_images[i] == VK_NULL_HANDLE);
@@ -2541,7 +3148,9 @@ static void GL_CreateFrameBuffers (void)
 		framebuffer_create_info.height = vid.height;
 		framebuffer_create_info.layers = 1;
 
-		VkImageView attachments[3] = {color_buffers_view[i], depth_buffer_view, msaa_color_buffer_view};
+		VkImageView attachments[4] = {color_buffers_view[i], depth_buffer_view, msaa_color_buffer_view, VK_NULL_HANDLE};
+		if (vulkan_globals.fragment_shading_rate)
+			attachments[framebuffer_create_info.attachmentCount++] = shading_rate_image_view;
 		framebuffer_create_info.pAttachments = attachments;
 
 		assert (main_framebuffers[i] == VK_NULL_HANDLE);
@@ -2591,6 +3200,24 @@ static void GL_CreateFrameBuffers (void)
 	}
 }
 
+/*
+===============
+GL_RenderPassesMatch
+
+Render passes and pipelines only depend on the formats and the sample
+count, not on the size of the swap chain
+===============
+*/
+static VkSampleCountFlagBits render_pass_sample_count;
+static qboolean				 render_pass_supersampling;
+static VkFormat				 render_pass_swap_chain_format;
+
+static qboolean GL_RenderPassesMatch (void)
+{
+	return (render_pass_sample_count == vulkan_globals.sample_count) && (render_pass_supersampling == vulkan_globals.supersampling) &&
+		   (render_pass_swap_chain_format == vulkan_globals.swap_chain_format);
+}
+
 /*
 ===============
 GL_CreateRenderResources
@@ -2609,9 +3236,22 @@ static void GL_CreateRenderResources (void)
 
 	GL_CreateColorBuffer ();
 	GL_CreateDepthBuffer ();
-	GL_CreateRenderPasses ();
+	GL_CreateShadingRateImage ();
+
+	// Resizes and vsync changes keep the render passes and pipelines
+	if (render_passes_created && !GL_RenderPassesMatch ())
+		GL_DestroyRenderPasses ();
+	const qboolean render_passes_changed = !render_passes_created;
+	if (render_passes_changed)
+	{
+		GL_CreateRenderPasses ();
+		R_CreatePipelines ();
+		render_pass_sample_count = vulkan_globals.sample_count;
+		render_pass_supersampling = vulkan_globals.supersampling;
+		render_pass_swap_chain_format = vulkan_globals.swap_chain_format;
+		render_passes_created = true;
+	}
 	GL_CreateFrameBuffers ();
-	R_CreatePipelines ();
 
 	render_resources_created = true;
 
@@ -2635,6 +3275,10 @@ static void GL_CreateRenderResources (void)
 
 	GL_UpdateDescriptorSets ();
 
+	// The lod bias follows the sample count
+	if (render_passes_changed)
+		R_InitSamplers ();
+
 #ifdef USE_RMLUI
 	/* Initialize/reinitialize RmlUI Vulkan renderer with current render passes.
 	 * This is called every time render resources are created/recreated to ensure
@@ -2656,6 +3300,7 @@ static void GL_CreateRenderResources (void)
 		rmlui_config.sync2_available = vulkan_globals.synchronization_2;
 		rmlui_config.cmd_pipeline_barrier_2 = vulkan_globals.synchronization_2 ? vulkan_globals.vk_cmd_pipeline_barrier_2 : NULL;
 		rmlui_config.dynamic_rendering = vulkan_globals.dynamic_rendering;
+		rmlui_config.descriptor_indexing = vulkan_globals.descriptor_indexing;
 		rmlui_config.cmd_bind_pipeline = vulkan_globals.vk_cmd_bind_pipeline;
 		rmlui_config.cmd_bind_descriptor_sets = vulkan_globals.vk_cmd_bind_descriptor_sets;
 		rmlui_config.cmd_bind_vertex_buffers = vkCmdBindVertexBuffers;
@@ -2665,15 +3310,53 @@ static void GL_CreateRenderResources (void)
 		rmlui_config.cmd_push_constants = vulkan_globals.vk_cmd_push_constants;
 		rmlui_config.cmd_set_scissor = vkCmdSetScissor;
 		rmlui_config.cmd_set_viewport = vkCmdSetViewport;
+		rmlui_config.cmd_begin_rendering = vulkan_globals.dynamic_rendering ? vulkan_globals.vk_cmd_begin_rendering : NULL;
+		rmlui_config.cmd_end_rendering = vulkan_globals.dynamic_rendering ? vulkan_globals.vk_cmd_end_rendering : NULL;
 		UI_InitializeVulkan (&rmlui_config);
 		UI_SetPixelRatio (VID_GetPixelRatio ());
 	}
 #endif
 }
 
+/*
+===============
+GL_DestroyRenderPasses
+===============
+*/
+static void GL_DestroyRenderPasses (void)
+{
+	render_passes_created = false;
+
+	GL_WaitForDeviceIdle ();
+
+	R_DestroyPipelines ();
+
+	if (vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].render_pass != VK_NULL_HANDLE)
+	{
+		vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].render_pass, NULL);
+		for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[SCBX_GUI]; ++i)
+			vulkan_globals.secondary_cb_contexts[SCBX_GUI][i].render_pass = VK_NULL_HANDLE;
+	}
+
+	vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.postprocess_render_pass, NULL);
+	vulkan_globals.postprocess_render_pass = VK_NULL_HANDLE;
+	for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[SCBX_POST_PROCESS]; ++i)
+		vulkan_globals.secondary_cb_contexts[SCBX_POST_PROCESS][i].render_pass = VK_NULL_HANDLE;
+	vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.main_render_pass[0], NULL);
+	vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.main_render_pass[1], NULL);
+	vulkan_globals.main_render_pass[0] = VK_NULL_HANDLE;
+	vulkan_globals.main_render_pass[1] = VK_NULL_HANDLE;
+	for (int scbx_index = SCBX_WORLD; scbx_index <= SCBX_VIEW_MODEL; ++scbx_index)
+		for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[scbx_index]; ++i)
+			vulkan_globals.secondary_cb_contexts[scbx_index][i].render_pass = VK_NULL_HANDLE;
+}
+
 /*
 ===============
 GL_DestroyRenderResources
+
+Only destroys what depends on the swap chain, GL_CreateRenderResources
+replaces the render passes and pipelines if they don't match anymore
 ===============
 */
 static void GL_DestroyRenderResources (void)
@@ -2682,8 +3365,6 @@ static void GL_DestroyRenderResources (void)
 
 	GL_WaitForDeviceIdle ();
 
-	R_DestroyPipelines ();
-
 	R_FreeDescriptorSet (postprocess_descriptor_set, &vulkan_globals.single_texture_set_layout);
 	postprocess_descriptor_set = VK_NULL_HANDLE;
 	R_FreeDescriptorSet (postprocess_ui_descriptor_set, &vulkan_globals.single_texture_set_layout);
@@ -2692,6 +3373,18 @@ static void GL_DestroyRenderResources (void)
 	R_FreeDescriptorSet (vulkan_globals.screen_effects_desc_set, &vulkan_globals.screen_effects_set_layout);
 	vulkan_globals.screen_effects_desc_set = VK_NULL_HANDLE;
 
+	if (vulkan_globals.occlusion_depth_desc_set != VK_NULL_HANDLE)
+	{
+		R_FreeDescriptorSet (vulkan_globals.occlusion_depth_desc_set, &vulkan_globals.occlusion_depth_set_layout);
+		vulkan_globals.occlusion_depth_desc_set = VK_NULL_HANDLE;
+	}
+
+	if (vulkan_globals.shading_rate_desc_set != VK_NULL_HANDLE)
+	{
+		R_FreeDescriptorSet (vulkan_globals.shading_rate_desc_set, &vulkan_globals.shading_rate_set_layout);
+		vulkan_globals.shading_rate_desc_set = VK_NULL_HANDLE;
+	}
+
 	if (msaa_color_buffer)
 	{
 		vkDestroyImageView (vulkan_globals.device, msaa_color_buffer_view, NULL);
@@ -2719,6 +3412,16 @@ static void GL_DestroyRenderResources (void)
 	depth_buffer_view = VK_NULL_HANDLE;
 	depth_buffer = VK_NULL_HANDLE;
 
+	if (shading_rate_image)
+	{
+		vkDestroyImageView (vulkan_globals.device, shading_rate_image_view, NULL);
+		vkDestroyImage (vulkan_globals.device, shading_rate_image, NULL);
+		R_FreeVulkanMemory (&shading_rate_image_memory, &num_vulkan_misc_allocations);
+
+		shading_rate_image_view = VK_NULL_HANDLE;
+		shading_rate_image = VK_NULL_HANDLE;
+	}
+
 	for (int i = 0; i < NUM_COLOR_BUFFERS; ++i)
 	{
 		vkDestroyFramebuffer (vulkan_globals.device, main_framebuffers[i], NULL);
@@ -2756,52 +3459,223 @@ static void GL_DestroyRenderResources (void)
 
 	fpDestroySwapchainKHR (vulkan_globals.device, vulkan_swapchain, NULL);
 	vulkan_swapchain = VK_NULL_HANDLE;
+}
 
-	if (vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].render_pass != VK_NULL_HANDLE)
-	{
-		vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].render_pass, NULL);
-		for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[SCBX_GUI]; ++i)
-			vulkan_globals.secondary_cb_contexts[SCBX_GUI][i].render_pass = VK_NULL_HANDLE;
-	}
-
-	vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.postprocess_render_pass, NULL);
-	vulkan_globals.postprocess_render_pass = VK_NULL_HANDLE;
-	for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[SCBX_POST_PROCESS]; ++i)
-		vulkan_globals.secondary_cb_contexts[SCBX_POST_PROCESS][i].render_pass = VK_NULL_HANDLE;
-	vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.main_render_pass[0], NULL);
-	vkDestroyRenderPass (vulkan_globals.device, vulkan_globals.main_render_pass[1], NULL);
-	vulkan_globals.main_render_pass[0] = VK_NULL_HANDLE;
-	vulkan_globals.main_render_pass[1] = VK_NULL_HANDLE;
-	for (int scbx_index = SCBX_WORLD; scbx_index <= SCBX_VIEW_MODEL; ++scbx_index)
-		for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[scbx_index]; ++i)
-			vulkan_globals.secondary_cb_contexts[scbx_index][i].render_pass = VK_NULL_HANDLE;
-
-	if (postprocess_sampler != VK_NULL_HANDLE)
-	{
-		vkDestroySampler (vulkan_globals.device, postprocess_sampler, NULL);
-		postprocess_sampler = VK_NULL_HANDLE;
-	}
+/*
+=================
+R_BeginGpuScope
+=================
+*/
+void R_BeginGpuScope (cb_context_t *cbx, gpu_scope_t scope)
+{
+	if (gpu_scopes_active)
+		vkCmdWriteTimestamp (cbx->cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpu_scope_query_pools[current_cb_index], scope * 2);
 }
 
 /*
 =================
-GL_BeginRenderingTask
+R_EndGpuScope
 =================
 */
-void GL_BeginRenderingTask (void *unused)
+void R_EndGpuScope (cb_context_t *cbx, gpu_scope_t scope)
 {
-	VkResult err;
+	if (gpu_scopes_active)
+		vkCmdWriteTimestamp (cbx->cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpu_scope_query_pools[current_cb_index], (scope * 2) + 1);
+}
 
-	if (frame_submitted[current_cb_index])
-	{
-		err = vkWaitForFences (vulkan_globals.device, 1, &command_buffer_fences[current_cb_index], VK_TRUE, UINT64_MAX);
-		if (err != VK_SUCCESS)
-			Sys_Error ("vkWaitForFences failed");
-	}
+static const gpu_scope_t SECONDARY_CB_GPU_SCOPES[SCBX_NUM] = {
+	GPU_SCOPE_WORLD,					   // SCBX_WORLD,
+	GPU_SCOPE_ENTITIES,					   // SCBX_ENTITIES,
+	GPU_SCOPE_SKY,						   // SCBX_SKY,
+	GPU_SCOPE_ALPHA_ENTITIES_ACROSS_WATER, // SCBX_ALPHA_ENTITIES_ACROSS_WATER,
+	GPU_SCOPE_WATER,					   // SCBX_WATER,
+	GPU_SCOPE_ALPHA_ENTITIES,			   // SCBX_ALPHA_ENTITIES,
+	GPU_SCOPE_PARTICLES,				   // SCBX_PARTICLES,
+	GPU_SCOPE_VIEW_MODEL,				   // SCBX_VIEW_MODEL,
+	GPU_SCOPE_GUI,						   // SCBX_GUI,
+	GPU_SCOPE_POST_PROCESS,				   // SCBX_POST_PROCESS,
+};
 
-	err = vkResetFences (vulkan_globals.device, 1, &command_buffer_fences[current_cb_index]);
-	if (err != VK_SUCCESS)
-		Sys_Error ("vkResetFences failed");
+static const char *GPU_SCOPE_NAMES[GPU_SCOPE_NUM] = {
+	"frame", "lightmaps", "warp", "world", "ents", "sky", "alpha_uw", "water", "alpha", "particles", "viewmodel", "effects", "gui", "post",
+};
+
+/*
+=================
+GL_ReadGpuScopes
+
+Reads back the timestamps of the frame that last used cb_index. Scopes that
+were not recorded in that frame are reported as negative.
+=================
+*/
+static void GL_ReadGpuScopes (int cb_index)
+{
+	uint64_t results[GPU_SCOPE_NUM * 2][2];
+	VkResult err = vkGetQueryPoolResults (
+		vulkan_globals.device, gpu_scope_query_pools[cb_index], 0, GPU_SCOPE_NUM * 2, sizeof (results), results, sizeof (results[0]),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if ((err != VK_SUCCESS) && (err != VK_NOT_READY))
+		return;
+
+	const uint64_t mask = (gfx_timestamp_valid_bits >= 64) ? UINT64_MAX : ((1ULL << gfx_timestamp_valid_bits) - 1);
+	const double   ms_per_tick = (double)vulkan_globals.device_properties.limits.timestampPeriod / 1e6;
+	for (int scope = 0; scope < GPU_SCOPE_NUM; ++scope)
+	{
+		const uint64_t *begin = results[scope * 2];
+		const uint64_t *end = results[(scope * 2) + 1];
+		if (begin[1] && end[1])
+			gpu_scope_times[scope] = (double)((end[0] - begin[0]) & mask) * ms_per_tick;
+		else
+			gpu_scope_times[scope] = -1.0;
+	}
+	FrameStats_Current ()->gpu_ms = gpu_scope_times[GPU_SCOPE_FRAME];
+}
+
+/*
+=================
+GL_PrintGpuSpeeds
+
+r_gpuspeeds 1 prints every frame, r_gpuspeeds 2 prints one second averages,
+r_gpuspeeds 3 only records the frame time for the benchmark and speeds_dump.
+"interval" is the CPU time between frames, a GPU frame time close to it
+means the frame is GPU bound.
+=================
+*/
+static void GL_PrintGpuSpeeds (void)
+{
+	static double last_time = 0.0;
+	static double window_start = 0.0;
+	static int	  frame_count = 0;
+	static double sum_interval = 0.0;
+	static double sum_times[GPU_SCOPE_NUM];
+	static int	  num_times[GPU_SCOPE_NUM];
+	static double worst_frame = 0.0;
+
+	const double time = Sys_DoubleTime ();
+	const double interval = (last_time > 0.0) ? (time - last_time) * 1000.0 : 0.0;
+	last_time = time;
+
+	char buf[512];
+	int	 len = 0;
+	if (r_gpuspeeds.value >= 2)
+	{
+		if (window_start == 0.0)
+			window_start = time;
+
+		frame_count++;
+		sum_interval += interval;
+		for (int scope = 0; scope < GPU_SCOPE_NUM; ++scope)
+		{
+			if (gpu_scope_times[scope] < 0.0)
+				continue;
+			sum_times[scope] += gpu_scope_times[scope];
+			num_times[scope] += 1;
+		}
+		worst_frame = q_max (worst_frame, gpu_scope_times[GPU_SCOPE_FRAME]);
+
+		if (time - window_start < 1.0)
+			return;
+
+		const double inv = 1.0 / frame_count;
+		const double avg_frame = num_times[GPU_SCOPE_FRAME] ? sum_times[GPU_SCOPE_FRAME] / num_times[GPU_SCOPE_FRAME] : 0.0;
+		len = q_snprintf (buf, sizeof (buf), "gpu(avg1s) %5.2f ms worst %5.2f interval %5.2f", avg_frame, worst_frame, sum_interval * inv);
+		for (int scope = GPU_SCOPE_FRAME + 1; scope < GPU_SCOPE_NUM; ++scope)
+			if (num_times[scope] && (len < (int)sizeof (buf)))
+				len += q_snprintf (buf + len, sizeof (buf) - len, " %s %4.2f", GPU_SCOPE_NAMES[scope], sum_times[scope] / num_times[scope]);
+
+		window_start = time;
+		frame_count = 0;
+		sum_interval = 0.0;
+		memset (sum_times, 0, sizeof (sum_times));
+		memset (num_times, 0, sizeof (num_times));
+		worst_frame = 0.0;
+	}
+	else
+	{
+		len = q_snprintf (buf, sizeof (buf), "gpu %5.2f ms interval %5.2f", q_max (gpu_scope_times[GPU_SCOPE_FRAME], 0.0), interval);
+		for (int scope = GPU_SCOPE_FRAME + 1; scope < GPU_SCOPE_NUM; ++scope)
+			if ((gpu_scope_times[scope] >= 0.0) && (len < (int)sizeof (buf)))
+				len += q_snprintf (buf + len, sizeof (buf) - len, " %s %4.2f", GPU_SCOPE_NAMES[scope], gpu_scope_times[scope]);
+	}
+	Con_Printf ("%s\n", buf);
+}
+
+/*
+=================
+GL_UpdateDynamicScale
+
+r_dynamicscale steers the 3D view resolution so that the GPU frame time stays
+under r_dynamicscale_target ms. The cost roughly follows the pixel count, so
+the scale moves with the square root of the time ratio, faster down than up.
+=================
+*/
+static void GL_UpdateDynamicScale (void)
+{
+	const double gpu_ms = gpu_scope_times[GPU_SCOPE_FRAME];
+	if (!r_dynamicscale.value || (r_dynamicscale_target.value <= 0.0f))
+	{
+		dynamic_scale = 1.0f;
+		return;
+	}
+
+	const float min_scale = CLAMP (0.25f, r_dynamicscale_min.value, 1.0f);
+	const float max_scale = CLAMP (min_scale, r_dynamicscale_max.value, 1.0f);
+	if (gpu_ms > 0.0)
+	{
+		// hold while a little under the target so the resolution doesn't hunt
+		const double ratio = r_dynamicscale_target.value / gpu_ms;
+		if ((ratio < 1.0) || (ratio > 1.1))
+		{
+			const float desired = dynamic_scale * (float)sqrt (ratio);
+			dynamic_scale += (desired - dynamic_scale) * ((ratio < 1.0) ? 0.5f : 0.1f);
+		}
+	}
+	dynamic_scale = CLAMP (min_scale, dynamic_scale, max_scale);
+}
+
+/*
+=================
+GL_DynamicScale
+=================
+*/
+float GL_DynamicScale (void)
+{
+	return dynamic_scale;
+}
+
+/*
+=================
+GL_BeginRenderingTask
+=================
+*/
+void GL_BeginRenderingTask (void *unused)
+{
+	VkResult err;
+
+	if (frame_submitted[current_cb_index])
+	{
+		err = vkWaitForFences (vulkan_globals.device, 1, &command_buffer_fences[current_cb_index], VK_TRUE, UINT64_MAX);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkWaitForFences failed");
+	}
+
+	err = vkResetFences (vulkan_globals.device, 1, &command_buffer_fences[current_cb_index]);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkResetFences failed");
+
+	R_OcclusionBeginFrame (current_cb_index);
+	R_AliasCullBeginFrame (current_cb_index);
+	R_IndirectBeginFrame (current_cb_index);
+
+	if (frame_submitted[current_cb_index] && gpu_scopes_recorded[current_cb_index])
+	{
+		GL_ReadGpuScopes (current_cb_index);
+		if (r_gpuspeeds.value && r_gpuspeeds.value < 3)
+			GL_PrintGpuSpeeds ();
+	}
+	GL_UpdateDynamicScale ();
+	gpu_scopes_active = (r_gpuspeeds.value || r_dynamicscale.value) && (gpu_scope_query_pools[current_cb_index] != VK_NULL_HANDLE);
+	gpu_scopes_recorded[current_cb_index] = gpu_scopes_active;
 
 	R_CollectDynamicBufferGarbage ();
 	R_CollectMeshBufferGarbage ();
@@ -2810,6 +3684,30 @@ void GL_BeginRenderingTask (void *unused)
 	UI_CollectGarbage ();
 #endif
 
+	const qboolean async_compute = (vulkan_globals.async_queue != VK_NULL_HANDLE) && r_asynccompute.value;
+	async_compute_frame[current_cb_index] = async_compute;
+	if (async_compute)
+	{
+		cb_context_t prologue_cbx;
+		memset (&prologue_cbx, 0, sizeof (prologue_cbx));
+		prologue_cbx.cb = async_prologue_command_buffers[current_cb_index];
+
+		ZEROED_STRUCT (VkCommandBufferBeginInfo, command_buffer_begin_info);
+		command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		err = vkBeginCommandBuffer (prologue_cbx.cb, &command_buffer_begin_info);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkBeginCommandBuffer failed");
+		if (gpu_scopes_active)
+		{
+			vkCmdResetQueryPool (prologue_cbx.cb, gpu_scope_query_pools[current_cb_index], 0, GPU_SCOPE_NUM * 2);
+			R_BeginGpuScope (&prologue_cbx, GPU_SCOPE_FRAME);
+		}
+		err = vkEndCommandBuffer (prologue_cbx.cb);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkEndCommandBuffer failed");
+	}
+
 	for (int pcbx_index = 0; pcbx_index < PCBX_NUM; ++pcbx_index)
 	{
 		cb_context_t *cbx = &vulkan_globals.primary_cb_contexts[pcbx_index];
@@ -2826,6 +3724,13 @@ void GL_BeginRenderingTask (void *unused)
 			Sys_Error ("vkBeginCommandBuffer failed");
 
 		R_BeginDebugUtilsLabel (cbx, "Primary CB");
+
+		// First primary CB in the submission, the scope queries are reset here before any other CB writes them
+		if ((pcbx_index == 0) && gpu_scopes_active && !async_compute)
+		{
+			vkCmdResetQueryPool (cbx->cb, gpu_scope_query_pools[current_cb_index], 0, GPU_SCOPE_NUM * 2);
+			R_BeginGpuScope (cbx, GPU_SCOPE_FRAME);
+		}
 	}
 
 	for (int scbx_index = 0; scbx_index < SCBX_NUM; ++scbx_index)
@@ -2869,6 +3774,8 @@ void GL_BeginRenderingTask (void *unused)
 				Sys_Error ("vkBeginCommandBuffer failed");
 
 			R_BeginDebugUtilsLabel (cbx, va ("CBX %d", scbx_index));
+			if (i == 0)
+				R_BeginGpuScope (cbx, SECONDARY_CB_GPU_SCOPES[scbx_index]);
 
 			VkRect2D render_area;
 			render_area.offset.x = 0;
@@ -2915,6 +3822,66 @@ void GL_SynchronizeEndRenderingTask (void)
 	}
 }
 
+/*
+=================
+VID_PaceFrame
+
+vid_lowlatency, called right before the input of a frame is sampled. Keeps at most one frame
+queued for presentation and with VK_KHR_present_wait delays the input sample until the frame
+just makes the next refresh. Returns true if the frame is paced.
+=================
+*/
+qboolean VID_PaceFrame (void)
+{
+	pacing_input_time = 0.0;
+	if (!vid_lowlatency.value || !render_resources_created || VID_IsMinimized ())
+		return false;
+
+	// The previous present has to be submitted before waiting on it
+	GL_SynchronizeEndRenderingTask ();
+
+#if defined(VK_KHR_present_wait)
+	if (vulkan_globals.present_wait && (vulkan_swapchain != VK_NULL_HANDLE) && (present_id > 1))
+	{
+		// The last frame stays queued, wait until the one before it is on screen
+		const uint64_t wait_id = present_id - 1;
+		const double   wait_start = Sys_DoubleTime ();
+		const VkResult err = fpWaitForPresentKHR (vulkan_globals.device, vulkan_swapchain, wait_id, 100 * 1000 * 1000);
+		const double   displayed = Sys_DoubleTime ();
+
+		// Only a wait that blocked tells when the refresh happened
+		if ((err == VK_SUCCESS) && ((displayed - wait_start) > 0.0005))
+		{
+			const double input_time = present_input_time[wait_id % PRESENT_HISTORY];
+			if (input_time > 0.0)
+				FrameStats_Current ()->latency_ms = (displayed - input_time) * 1000;
+
+			// The queued frame goes out with the next refresh, this one has to be submitted before that
+			const double wake_time = displayed + present_interval - pacing_frame_cost - PACING_SAFETY_MARGIN;
+			while ((wake_time - Sys_DoubleTime ()) > 0.002)
+				SDL_Delay (1);
+			while (Sys_DoubleTime () < wake_time)
+				;
+		}
+
+		pacing_input_time = Sys_DoubleTime ();
+		return true;
+	}
+#endif
+
+	// Without present ids only the GPU queue can be drained, the display latency is unknown
+	const uint32_t prev_cb_index = (current_cb_index + DOUBLE_BUFFERED - 1) % DOUBLE_BUFFERED;
+	if (frame_submitted[prev_cb_index])
+	{
+		const VkResult err = vkWaitForFences (vulkan_globals.device, 1, &command_buffer_fences[prev_cb_index], VK_TRUE, UINT64_MAX);
+		if (err != VK_SUCCESS)
+			Sys_Error ("vkWaitForFences failed");
+	}
+
+	pacing_input_time = Sys_DoubleTime ();
+	return true;
+}
+
 /*
 =================
 GL_BeginRendering
@@ -2941,6 +3908,14 @@ qboolean GL_BeginRendering (qboolean use_tasks, task_handle_t *begin_rendering_t
 		}
 	}
 
+	// The showtris, ray debug and RT lightmap pipelines are compiled in the background,
+	// only wait for them once they are needed
+	qboolean deferred_pipelines_needed = r_showtris.value || r_showbboxes.value || (r_rtshadows.value && cl.worldmodel);
+#if defined(_DEBUG)
+	deferred_pipelines_needed = deferred_pipelines_needed || r_raydebug.value;
+#endif
+	R_UpdateDeferredPipelines (deferred_pipelines_needed);
+
 	*width = vid.width;
 	*height = vid.height;
 
@@ -3042,6 +4017,40 @@ typedef struct ray_debug_constants_s
 	float down_z;
 } ray_debug_constants_t;
 
+typedef struct postprocess_constants_s
+{
+	float	 gamma;
+	float	 contrast;
+	float	 warp_strength;
+	float	 chromatic_strength;
+	float	 ui_offset_x;
+	float	 ui_offset_y;
+	float	 ui_opacity;
+	float	 echo_strength;
+	float	 echo_scale;
+	float	 ui_additive;
+	float	 scene_scale;
+	uint32_t effect_flags;
+	float	 time;
+	float	 aspect_ratio;
+	float	 poly_blend_r;
+	float	 poly_blend_g;
+	float	 poly_blend_b;
+	float	 poly_blend_a;
+} postprocess_constants_t;
+
+typedef struct shading_rate_constants_s
+{
+	float scene_size_rcp_x;
+	float scene_size_rcp_y;
+	float texel_size;
+	float margin;
+	float warp_strength;
+	float ui_offset_x;
+	float ui_offset_y;
+	float coverage_scale;
+} shading_rate_constants_t;
+
 typedef struct end_rendering_parms_s
 {
 	uint32_t vid_width	   : 20;
@@ -3052,6 +4061,7 @@ typedef struct end_rendering_parms_s
 	qboolean ray_debug	   : 1;
 	uint32_t render_scale  : 4;
 	uint32_t vid_height	   : 20;
+	float	 render_resolution;
 	float	 time;
 	uint8_t	 v_blend[4];
 	vec3_t	 origin;
@@ -3068,50 +4078,273 @@ typedef struct end_rendering_parms_s
 #define SCREEN_EFFECT_FLAG_PALETTIZE  0x8
 #define SCREEN_EFFECT_FLAG_MENU		  0x10
 
+// Color buffers of the end of frame passes. The tracker derives the barriers between the passes from what each one reads and writes.
+typedef enum
+{
+	FRAME_IMAGE_SCENE, // color_buffers[0]: 3D view, or the screen effects output
+	FRAME_IMAGE_UI,	   // color_buffers[1]: 3D view before screen effects, then the UI layer
+	FRAME_IMAGE_SHADING_RATE,
+	FRAME_IMAGE_COUNT
+} frame_image_id_t;
+
+typedef struct
+{
+	VkImage				 image;
+	VkImageLayout		 layout;
+	VkPipelineStageFlags write_stages;
+	VkAccessFlags		 write_access;
+	VkPipelineStageFlags read_stages;
+	VkPipelineStageFlags visible_stages; // Stages the last write was made visible to
+} frame_image_state_t;
+
+typedef struct
+{
+	frame_image_state_t	 images[FRAME_IMAGE_COUNT];
+	int					 num_barriers;
+	VkImageMemoryBarrier barriers[FRAME_IMAGE_COUNT];
+	VkPipelineStageFlags src_stages[FRAME_IMAGE_COUNT];
+	VkPipelineStageFlags dst_stages[FRAME_IMAGE_COUNT];
+} frame_images_t;
+
+#define FRAME_IMAGE_WRITE_ACCESS                                                                                                                      \
+	(VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)
+
+/*
+===============
+GL_FrameImagesInit
+
+The previous frame's post process pass and compute passes are the last readers of the color buffers.
+The shading rate image keeps its contents and layout once it was initialized.
+===============
+*/
+static void GL_FrameImagesInit (frame_images_t *images)
+{
+	memset (images, 0, sizeof (*images));
+	for (int i = 0; i < NUM_COLOR_BUFFERS; ++i)
+	{
+		frame_image_state_t *state = &images->images[i];
+		state->image = vulkan_globals.color_buffers[i];
+		state->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		state->read_stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	}
+
+	frame_image_state_t *shading_rate = &images->images[FRAME_IMAGE_SHADING_RATE];
+	shading_rate->image = shading_rate_image;
+	shading_rate->layout =
+		(shading_rate_contents == SHADING_RATE_UNDEFINED) ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+	shading_rate->read_stages = VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+}
+
+/*
+===============
+GL_FrameImageWritten
+
+Records a write that did its own synchronization, e.g. a render pass with a final layout
+===============
+*/
+static void GL_FrameImageWritten (frame_images_t *images, frame_image_id_t id, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access)
+{
+	frame_image_state_t *state = &images->images[id];
+	state->layout = layout;
+	state->write_stages = stages;
+	state->write_access = access & FRAME_IMAGE_WRITE_ACCESS;
+	state->read_stages = 0;
+	state->visible_stages = 0;
+}
+
+/*
+===============
+GL_FrameImageUse
+
+Declares an access by the next pass and queues the barrier it needs, if any. Reads of an image
+already visible in the right layout need none. discard allows the old contents to be dropped.
+===============
+*/
+static void GL_FrameImageUse (
+	frame_images_t *images, frame_image_id_t id, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout, qboolean discard)
+{
+	frame_image_state_t *state = &images->images[id];
+	const qboolean		 write = (access & FRAME_IMAGE_WRITE_ACCESS) != 0;
+	const qboolean		 transition = layout != state->layout;
+
+	if (!write && !transition && (!state->write_access || (state->visible_stages & stages) == stages))
+	{
+		state->read_stages |= stages;
+		return;
+	}
+
+	// Writes and layout transitions also have to wait for the reads since the last write
+	VkPipelineStageFlags src_stages = state->write_stages;
+	if (write || transition)
+		src_stages |= state->read_stages;
+	if (!src_stages)
+		src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+	assert (images->num_barriers < FRAME_IMAGE_COUNT);
+	const int			  index = images->num_barriers++;
+	VkImageMemoryBarrier *barrier = &images->barriers[index];
+	memset (barrier, 0, sizeof (*barrier));
+	barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier->srcAccessMask = state->write_access;
+	barrier->dstAccessMask = access;
+	barrier->oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state->layout;
+	barrier->newLayout = layout;
+	barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier->image = state->image;
+	barrier->subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier->subresourceRange.baseMipLevel = 0;
+	barrier->subresourceRange.levelCount = 1;
+	barrier->subresourceRange.baseArrayLayer = 0;
+	barrier->subresourceRange.layerCount = 1;
+	images->src_stages[index] = src_stages;
+	images->dst_stages[index] = stages;
+
+	state->layout = layout;
+	if (write)
+	{
+		state->write_stages = stages;
+		state->write_access = access & FRAME_IMAGE_WRITE_ACCESS;
+		state->read_stages = 0;
+		state->visible_stages = 0;
+	}
+	else
+	{
+		state->read_stages = stages;
+		state->visible_stages = transition ? stages : (state->visible_stages | stages);
+	}
+}
+
+/*
+===============
+GL_FrameImagesFlush
+
+Issues the queued barriers in a single call, with per image stages when synchronization2 is available
+===============
+*/
+static void GL_FrameImagesFlush (VkCommandBuffer cb, frame_images_t *images)
+{
+	if (!images->num_barriers)
+		return;
+
+	if (vulkan_globals.synchronization_2)
+	{
+		VkImageMemoryBarrier2KHR barriers[FRAME_IMAGE_COUNT];
+		for (int i = 0; i < images->num_barriers; ++i)
+		{
+			const VkImageMemoryBarrier *barrier = &images->barriers[i];
+			memset (&barriers[i], 0, sizeof (barriers[i]));
+			barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+			barriers[i].srcStageMask = images->src_stages[i];
+			barriers[i].srcAccessMask = barrier->srcAccessMask;
+			barriers[i].dstStageMask = images->dst_stages[i];
+			barriers[i].dstAccessMask = barrier->dstAccessMask;
+			barriers[i].oldLayout = barrier->oldLayout;
+			barriers[i].newLayout = barrier->newLayout;
+			barriers[i].srcQueueFamilyIndex = barrier->srcQueueFamilyIndex;
+			barriers[i].dstQueueFamilyIndex = barrier->dstQueueFamilyIndex;
+			barriers[i].image = barrier->image;
+			barriers[i].subresourceRange = barrier->subresourceRange;
+		}
+
+		ZEROED_STRUCT (VkDependencyInfoKHR, dependency_info);
+		dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+		dependency_info.imageMemoryBarrierCount = images->num_barriers;
+		dependency_info.pImageMemoryBarriers = barriers;
+		vulkan_globals.vk_cmd_pipeline_barrier_2 (cb, &dependency_info);
+	}
+	else
+	{
+		VkPipelineStageFlags src_stages = 0;
+		VkPipelineStageFlags dst_stages = 0;
+		for (int i = 0; i < images->num_barriers; ++i)
+		{
+			src_stages |= images->src_stages[i];
+			dst_stages |= images->dst_stages[i];
+		}
+		vkCmdPipelineBarrier (cb, src_stages, dst_stages, 0, 0, NULL, 0, NULL, images->num_barriers, images->barriers);
+	}
+
+	images->num_barriers = 0;
+}
+
+/*
+===============
+GL_OcclusionDepth
+
+Reduces the depth of the 3D view to the grid R_OccludedBox tests against
+===============
+*/
+static void GL_OcclusionDepth (cb_context_t *cbx, int cb_index)
+{
+	uint32_t push_constants[6];
+	if (!vulkan_globals.sampled_depth || !R_OcclusionPendingDispatch (cb_index, push_constants))
+		return;
+
+	R_BeginDebugUtilsLabel (cbx, "Occlusion Depth");
+
+	ZEROED_STRUCT (VkImageMemoryBarrier, image_barrier);
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image = depth_buffer;
+	image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.baseArrayLayer = 0;
+	image_barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_barrier);
+
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.occlusion_depth_pipeline);
+	vkCmdBindDescriptorSets (
+		cbx->cb, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.occlusion_depth_pipeline.layout.handle, 0, 1, &vulkan_globals.occlusion_depth_desc_set, 0,
+		NULL);
+	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (push_constants), push_constants);
+	vkCmdDispatch (cbx->cb, OCCLUSION_GRID_WIDTH / 8, OCCLUSION_GRID_HEIGHT / 8, 1);
+
+	// Back to the final layout of the main render pass, the next depth clear has to wait for the reads
+	image_barrier.srcAccessMask = 0;
+	image_barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	vkCmdPipelineBarrier (
+		cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, NULL, 0,
+		NULL, 1, &image_barrier);
+
+	// The grid is read on the host after the frame fence
+	ZEROED_STRUCT (VkMemoryBarrier, memory_barrier);
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+
+	R_EndDebugUtilsLabel (cbx);
+}
+
 /*
 ===============
 GL_ScreenEffects
 ===============
 */
-static void GL_ScreenEffects (cb_context_t *cbx, qboolean enabled, end_rendering_parms_t *parms)
+static void GL_ScreenEffects (cb_context_t *cbx, qboolean enabled, end_rendering_parms_t *parms, frame_images_t *images)
 {
 	if (enabled)
 	{
-		R_BeginDebugUtilsLabel (cbx, "Screen Effects");
+		// The 3D view fills the top left at render_resolution, the post process pass upscales it
+		const uint32_t scene_width = q_max (1, (int)(parms->vid_width * parms->render_resolution));
+		const uint32_t scene_height = q_max (1, (int)(parms->vid_height * parms->render_resolution));
 
-		VkImageMemoryBarrier image_barriers[2];
-		image_barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		image_barriers[0].pNext = NULL;
-		image_barriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		image_barriers[0].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		image_barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
-		image_barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barriers[0].image = vulkan_globals.color_buffers[0];
-		image_barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		image_barriers[0].subresourceRange.baseMipLevel = 0;
-		image_barriers[0].subresourceRange.levelCount = 1;
-		image_barriers[0].subresourceRange.baseArrayLayer = 0;
-		image_barriers[0].subresourceRange.layerCount = 1;
-
-		image_barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		image_barriers[1].pNext = NULL;
-		image_barriers[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		image_barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		image_barriers[1].oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		image_barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		image_barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barriers[1].image = vulkan_globals.color_buffers[1];
-		image_barriers[1].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		image_barriers[1].subresourceRange.baseMipLevel = 0;
-		image_barriers[1].subresourceRange.levelCount = 1;
-		image_barriers[1].subresourceRange.baseArrayLayer = 0;
-		image_barriers[1].subresourceRange.layerCount = 1;
+		R_BeginDebugUtilsLabel (cbx, "Screen Effects");
 
-		vkCmdPipelineBarrier (
-			cbx->cb, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 2, image_barriers);
+		// The dispatch samples the 3D view in color_buffers[1] and overwrites color_buffers[0]
+		GL_FrameImageUse (images, FRAME_IMAGE_SCENE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true);
+		GL_FrameImageUse (
+			images, FRAME_IMAGE_UI, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+		GL_FrameImagesFlush (cbx->cb, images);
 
 		GL_SetCanvas (cbx, CANVAS_NONE); // Invalidate canvas so push constants get set later
 
@@ -3156,11 +4389,11 @@ static void GL_ScreenEffects (cb_context_t *cbx, qboolean enabled, end_rendering
 				screen_effect_flags |= SCREEN_EFFECT_FLAG_MENU;
 
 			const screen_effect_constants_t push_constants = {
-				parms->vid_width - 1,
-				parms->vid_height - 1,
-				1.0f / (float)parms->vid_width,
-				1.0f / (float)parms->vid_height,
-				(float)parms->vid_width / (float)parms->vid_height,
+				scene_width - 1,
+				scene_height - 1,
+				1.0f / (float)scene_width,
+				1.0f / (float)scene_height,
+				(float)scene_width / (float)scene_height,
 				parms->time,
 				screen_effect_flags,
 				(float)parms->v_blend[0] / 255.0f,
@@ -3176,9 +4409,9 @@ static void GL_ScreenEffects (cb_context_t *cbx, qboolean enabled, end_rendering
 			vkCmdBindDescriptorSets (cbx->cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->layout.handle, 0, 1, &vulkan_globals.ray_debug_desc_set, 0, NULL);
 
 			const ray_debug_constants_t push_constants = {
-				1.0f / (float)parms->vid_width,
-				1.0f / (float)parms->vid_height,
-				(float)parms->vid_width / (float)parms->vid_height,
+				1.0f / (float)scene_width,
+				1.0f / (float)scene_height,
+				(float)scene_width / (float)scene_height,
 				parms->origin[0],
 				parms->origin[1],
 				parms->origin[2],
@@ -3196,25 +4429,7 @@ static void GL_ScreenEffects (cb_context_t *cbx, qboolean enabled, end_rendering
 		}
 #endif
 
-		vkCmdDispatch (cbx->cb, (parms->vid_width + 7) / 8, (parms->vid_height + 7) / 8, 1);
-
-		image_barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		image_barriers[0].pNext = NULL;
-		image_barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		image_barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-		image_barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		image_barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barriers[0].image = vulkan_globals.color_buffers[0];
-		image_barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		image_barriers[0].subresourceRange.baseMipLevel = 0;
-		image_barriers[0].subresourceRange.levelCount = 1;
-		image_barriers[0].subresourceRange.baseArrayLayer = 0;
-		image_barriers[0].subresourceRange.layerCount = 1;
-
-		vkCmdPipelineBarrier (
-			cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, image_barriers);
+		vkCmdDispatch (cbx->cb, (scene_width + 7) / 8, (scene_height + 7) / 8, 1);
 
 		R_EndDebugUtilsLabel (cbx);
 	}
@@ -3231,11 +4446,272 @@ static void GL_ScreenEffects (cb_context_t *cbx, qboolean enabled, end_rendering
 	}
 }
 
-void ScheduleScreenshotCopy (VkCommandBuffer command_buffer, VkBuffer *buffer, vulkan_memory_t *memory)
+/*
+===============
+GL_PrepareShadingRate
+
+Resets the attachment to full rate when it is new or r_vrs stopped writing it
+===============
+*/
+static void GL_PrepareShadingRate (VkCommandBuffer cb, frame_images_t *images, qboolean coarse_shading)
 {
-	R_CreateBuffer (
-		buffer, memory, glwidth * glheight * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, NULL,
-		NULL, "Screenshot");
+	if (!vulkan_globals.fragment_shading_rate)
+		return;
+	if (!((shading_rate_contents == SHADING_RATE_UNDEFINED) || ((shading_rate_contents == SHADING_RATE_COARSE) && !coarse_shading)))
+		return;
+
+	GL_FrameImageUse (images, FRAME_IMAGE_SHADING_RATE, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true);
+	GL_FrameImagesFlush (cb, images);
+
+	VkClearColorValue clear_value;
+	memset (&clear_value, 0, sizeof (clear_value));
+	VkImageSubresourceRange range;
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+	vkCmdClearColorImage (cb, shading_rate_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_value, 1, &range);
+
+	GL_FrameImageUse (
+		images, FRAME_IMAGE_SHADING_RATE, VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR, VK_ACCESS_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR,
+		VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR, false);
+	GL_FrameImagesFlush (cb, images);
+
+	shading_rate_contents = SHADING_RATE_FULL;
+}
+
+/*
+===============
+GL_UpdateShadingRate
+
+Derives the next frame's attachment from the UI layer the post process pass just composited
+===============
+*/
+static void GL_UpdateShadingRate (cb_context_t *cbx, frame_images_t *images, end_rendering_parms_t *parms, float coverage_scale)
+{
+	const uint32_t scene_width = q_max (1, (int)(parms->vid_width * parms->render_resolution));
+	const uint32_t scene_height = q_max (1, (int)(parms->vid_height * parms->render_resolution));
+	const uint32_t texel_size = vulkan_globals.shading_rate_texel_size;
+	const uint32_t texels_x = (scene_width + texel_size - 1) / texel_size;
+	const uint32_t texels_y = (scene_height + texel_size - 1) / texel_size;
+
+	R_BeginDebugUtilsLabel (cbx, "Shading Rate");
+
+	GL_FrameImageUse (images, FRAME_IMAGE_UI, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+	GL_FrameImageUse (images, FRAME_IMAGE_SHADING_RATE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true);
+	GL_FrameImagesFlush (cbx->cb, images);
+
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.shading_rate_pipeline);
+	vkCmdBindDescriptorSets (
+		cbx->cb, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.shading_rate_pipeline.layout.handle, 0, 1, &vulkan_globals.shading_rate_desc_set, 0, NULL);
+
+	// The water warp of the post process pass moves the scene by up to 1/300 of the view
+	const shading_rate_constants_t push_constants = {
+		1.0f / (float)scene_width,
+		1.0f / (float)scene_height,
+		(float)texel_size,
+		parms->render_warp ? (float)(scene_width / 300 + 1) : 1.0f,
+		r_ui_warp.value,
+		v_hud_offset_x,
+		v_hud_offset_y,
+		coverage_scale,
+	};
+	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (push_constants), &push_constants);
+	vkCmdDispatch (cbx->cb, (texels_x + 7) / 8, (texels_y + 7) / 8, 1);
+
+	GL_FrameImageUse (
+		images, FRAME_IMAGE_SHADING_RATE, VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR, VK_ACCESS_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR,
+		VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR, false);
+	GL_FrameImagesFlush (cbx->cb, images);
+
+	R_EndDebugUtilsLabel (cbx);
+
+	shading_rate_contents = SHADING_RATE_COARSE;
+}
+
+/*
+=================
+VID_CaptureFormatSupported
+=================
+*/
+static qboolean VID_CaptureFormatSupported (void)
+{
+	return (vulkan_globals.swap_chain_format == VK_FORMAT_B8G8R8A8_UNORM) || (vulkan_globals.swap_chain_format == VK_FORMAT_B8G8R8A8_SRGB) ||
+		   (vulkan_globals.swap_chain_format == VK_FORMAT_R8G8B8A8_UNORM) || (vulkan_globals.swap_chain_format == VK_FORMAT_R8G8B8A8_SRGB);
+}
+
+/*
+=================
+VID_EncodeCapture
+
+Runs on a worker, unless the render task needs the slot back and takes the encode over
+=================
+*/
+static void VID_EncodeCapture (capture_slot_t *slot)
+{
+	uint32_t expected = CAPTURE_SLOT_QUEUED;
+	if (!Atomic_CompareExchangeUInt32 (&slot->state, &expected, CAPTURE_SLOT_ENCODING))
+		return;
+
+	if (slot->bgra)
+	{
+		byte	 *data = slot->data;
+		const int size = slot->width * slot->height * 4;
+		for (int i = 0; i < size; i += 4)
+		{
+			const byte temp = data[i];
+			data[i] = data[i + 2];
+			data[i + 2] = temp;
+		}
+	}
+
+	if (!q_strncasecmp (slot->ext, "png", sizeof (slot->ext)))
+		slot->ok = Image_WritePNG (slot->name, slot->data, slot->width, slot->height, 32, true);
+	else if (!q_strncasecmp (slot->ext, "tga", sizeof (slot->ext)))
+		slot->ok = Image_WriteTGA (slot->name, slot->data, slot->width, slot->height, 32, true);
+	else if (!q_strncasecmp (slot->ext, "jpg", sizeof (slot->ext)))
+		slot->ok = Image_WriteJPG (slot->name, slot->data, slot->width, slot->height, 32, slot->quality, true);
+	else
+		slot->ok = false;
+
+	Atomic_StoreUInt32 (&slot->state, CAPTURE_SLOT_DONE);
+}
+
+/*
+=================
+VID_EncodeCaptureTask
+=================
+*/
+static void VID_EncodeCaptureTask (capture_slot_t **slot)
+{
+	VID_EncodeCapture (*slot);
+}
+
+/*
+=================
+VID_UpdateCaptures
+
+Hands finished GPU copies to the encoder and reports encoded files. With wait it blocks
+on the copies and encodes one queued slot itself, so a full ring always makes progress.
+=================
+*/
+static void VID_UpdateCaptures (qboolean wait)
+{
+	capture_slot_t *queued = NULL;
+
+	for (int i = 0; i < NUM_CAPTURE_SLOTS; ++i)
+	{
+		capture_slot_t *slot = &capture_slots[i];
+		switch (Atomic_LoadUInt32 (&slot->state))
+		{
+		case CAPTURE_SLOT_COPYING:
+			if (wait)
+				vkWaitForFences (vulkan_globals.device, 1, &slot->fence, VK_TRUE, UINT64_MAX);
+			else if (vkGetFenceStatus (vulkan_globals.device, slot->fence) != VK_SUCCESS)
+				break;
+			vkResetFences (vulkan_globals.device, 1, &slot->fence);
+
+			ZEROED_STRUCT (VkMappedMemoryRange, range);
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = slot->memory.handle;
+			range.size = VK_WHOLE_SIZE;
+			vkInvalidateMappedMemoryRanges (vulkan_globals.device, 1, &range);
+
+			Atomic_StoreUInt32 (&slot->state, CAPTURE_SLOT_QUEUED);
+			Task_AllocateAssignBackgroundFuncAndSubmit ((task_func_t)VID_EncodeCaptureTask, &slot, sizeof (slot));
+			queued = slot;
+			break;
+		case CAPTURE_SLOT_QUEUED:
+			queued = slot;
+			break;
+		case CAPTURE_SLOT_DONE:
+			if (!slot->ok)
+				Con_Printf ("Couldn't create %s\n", slot->name);
+			else if (!slot->movie)
+				Con_Printf ("Wrote %s\n", slot->name);
+			Atomic_StoreUInt32 (&slot->state, CAPTURE_SLOT_FREE);
+			break;
+		}
+	}
+
+	if (wait)
+	{
+		if (queued)
+			VID_EncodeCapture (queued);
+		else
+			SDL_Delay (1);
+	}
+}
+
+/*
+=================
+VID_AcquireCaptureSlot
+=================
+*/
+static capture_slot_t *VID_AcquireCaptureSlot (void)
+{
+	for (;;)
+	{
+		VID_UpdateCaptures (false);
+		for (int i = 0; i < NUM_CAPTURE_SLOTS; ++i)
+			if (Atomic_LoadUInt32 (&capture_slots[i].state) == CAPTURE_SLOT_FREE)
+				return &capture_slots[i];
+		// Movies can't drop frames, the frame waits for the oldest capture instead
+		VID_UpdateCaptures (true);
+	}
+}
+
+/*
+=================
+VID_ScheduleCapture
+
+Records the copy of the swapchain image into a free slot of the capture ring
+=================
+*/
+static capture_slot_t *VID_ScheduleCapture (VkCommandBuffer command_buffer, qboolean movie)
+{
+	capture_slot_t *slot = VID_AcquireCaptureSlot ();
+
+	if ((slot->buffer == VK_NULL_HANDLE) || (slot->width != glwidth) || (slot->height != glheight))
+	{
+		if (slot->buffer != VK_NULL_HANDLE)
+		{
+			vkUnmapMemory (vulkan_globals.device, slot->memory.handle);
+			R_FreeBuffer (slot->buffer, &slot->memory, NULL);
+		}
+		else
+		{
+			ZEROED_STRUCT (VkFenceCreateInfo, fence_create_info);
+			fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			if (vkCreateFence (vulkan_globals.device, &fence_create_info, NULL, &slot->fence) != VK_SUCCESS)
+				Sys_Error ("vkCreateFence failed");
+		}
+
+		slot->width = glwidth;
+		slot->height = glheight;
+		R_CreateBuffer (
+			&slot->buffer, &slot->memory, slot->width * slot->height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			VK_MEMORY_PROPERTY_HOST_CACHED_BIT, NULL, NULL, "Capture");
+		if (vkMapMemory (vulkan_globals.device, slot->memory.handle, 0, VK_WHOLE_SIZE, 0, (void **)&slot->data) != VK_SUCCESS)
+			Sys_Error ("vkMapMemory failed");
+	}
+
+	Atomic_StoreUInt32 (&slot->state, CAPTURE_SLOT_RECORDING);
+	slot->movie = movie;
+	slot->bgra = (vulkan_globals.swap_chain_format == VK_FORMAT_B8G8R8A8_UNORM) || (vulkan_globals.swap_chain_format == VK_FORMAT_B8G8R8A8_SRGB);
+	if (movie)
+	{
+		memcpy (slot->ext, capture_ext, sizeof (slot->ext));
+		slot->quality = capture_quality;
+		q_snprintf (slot->name, sizeof (slot->name), "%s/%06d.%s", capture_dir, capture_frame++, capture_ext);
+	}
+	else
+	{
+		memcpy (slot->ext, screenshot_ext, sizeof (slot->ext));
+		slot->quality = screenshot_quality;
+		q_strlcpy (slot->name, screenshot_imagename, sizeof (slot->name));
+	}
 
 	{
 		ZEROED_STRUCT (VkImageMemoryBarrier, image_barrier);
@@ -3246,7 +4722,7 @@ void ScheduleScreenshotCopy (VkCommandBuffer command_buffer, VkBuffer *buffer, v
 		image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 		image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barrier.image = swapchain_images[current_cb_index];
+		image_barrier.image = swapchain_images[current_swapchain_buffer];
 		image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		image_barrier.subresourceRange.baseMipLevel = 0;
 		image_barrier.subresourceRange.levelCount = 1;
@@ -3259,15 +4735,15 @@ void ScheduleScreenshotCopy (VkCommandBuffer command_buffer, VkBuffer *buffer, v
 
 	ZEROED_STRUCT (VkBufferImageCopy, image_copy);
 	image_copy.bufferOffset = 0;
-	image_copy.bufferRowLength = glwidth;
-	image_copy.bufferImageHeight = glheight;
+	image_copy.bufferRowLength = slot->width;
+	image_copy.bufferImageHeight = slot->height;
 	image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	image_copy.imageSubresource.layerCount = 1;
-	image_copy.imageExtent.width = glwidth;
-	image_copy.imageExtent.height = glheight;
+	image_copy.imageExtent.width = slot->width;
+	image_copy.imageExtent.height = slot->height;
 	image_copy.imageExtent.depth = 1;
 
-	vkCmdCopyImageToBuffer (command_buffer, swapchain_images[current_cb_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *buffer, 1, &image_copy);
+	vkCmdCopyImageToBuffer (command_buffer, swapchain_images[current_swapchain_buffer], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &image_copy);
 
 	{
 		ZEROED_STRUCT (VkImageMemoryBarrier, image_barrier);
@@ -3278,7 +4754,7 @@ void ScheduleScreenshotCopy (VkCommandBuffer command_buffer, VkBuffer *buffer, v
 		image_barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 		image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		image_barrier.image = swapchain_images[current_cb_index];
+		image_barrier.image = swapchain_images[current_swapchain_buffer];
 		image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		image_barrier.subresourceRange.baseMipLevel = 0;
 		image_barrier.subresourceRange.levelCount = 1;
@@ -3287,52 +4763,54 @@ void ScheduleScreenshotCopy (VkCommandBuffer command_buffer, VkBuffer *buffer, v
 
 		vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &image_barrier);
 	}
-}
-
-void WriteScreenshot (VkBuffer buffer, vulkan_memory_t memory)
-{
-
-	vkDeviceWaitIdle (vulkan_globals.device);
-	vulkan_globals.device_idle = true;
-
-	void *buffer_ptr;
-	vkMapMemory (vulkan_globals.device, memory.handle, 0, glwidth * glheight * 4, 0, &buffer_ptr);
 
-	ZEROED_STRUCT (VkMappedMemoryRange, range);
-	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-	range.memory = memory.handle;
-	range.size = VK_WHOLE_SIZE;
-	vkInvalidateMappedMemoryRanges (vulkan_globals.device, 1, &range);
-
-	qboolean bgra = (vulkan_globals.swap_chain_format == VK_FORMAT_B8G8R8A8_UNORM) || (vulkan_globals.swap_chain_format == VK_FORMAT_B8G8R8A8_SRGB);
-	if (bgra)
 	{
-		byte	 *data = (byte *)buffer_ptr;
-		const int size = glwidth * glheight * 4;
-		for (int i = 0; i < size; i += 4)
-		{
-			const byte temp = data[i];
-			data[i] = data[i + 2];
-			data[i + 2] = temp;
-		}
+		// The encoder reads the buffer on the host once the capture fence signals
+		ZEROED_STRUCT (VkMemoryBarrier, memory_barrier);
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
 	}
 
-	qboolean ok;
-	if (!q_strncasecmp (screenshot_ext, "png", sizeof (screenshot_ext)))
-		ok = Image_WritePNG (screenshot_imagename, buffer_ptr, glwidth, glheight, 32, true);
-	else if (!q_strncasecmp (screenshot_ext, "tga", sizeof (screenshot_ext)))
-		ok = Image_WriteTGA (screenshot_imagename, buffer_ptr, glwidth, glheight, 32, true);
-	else if (!q_strncasecmp (screenshot_ext, "jpg", sizeof (screenshot_ext)))
-		ok = Image_WriteJPG (screenshot_imagename, buffer_ptr, glwidth, glheight, 32, screenshot_quality, true);
-	else
-		ok = false;
+	return slot;
+}
 
-	if (ok)
-		Con_Printf ("Wrote %s\n", screenshot_imagename);
-	else
-		Con_Printf ("SCR_ScreenShot_f: Couldn't create %s\n", screenshot_imagename);
+/*
+=================
+VID_SubmitCapture
 
-	R_FreeBuffer (buffer, &memory, NULL);
+The copy went out with the frame, an empty submit signals the slot fence after it
+=================
+*/
+static void VID_SubmitCapture (capture_slot_t *slot)
+{
+	if (vkQueueSubmit (vulkan_globals.queue, 0, NULL, slot->fence) != VK_SUCCESS)
+		Sys_Error ("vkQueueSubmit failed");
+	Atomic_StoreUInt32 (&slot->state, CAPTURE_SLOT_COPYING);
+}
+
+/*
+=================
+VID_FlushCaptures
+
+Waits until every capture is written, main thread only
+=================
+*/
+static void VID_FlushCaptures (void)
+{
+	GL_SynchronizeEndRenderingTask ();
+	for (;;)
+	{
+		int busy = 0;
+		VID_UpdateCaptures (false);
+		for (int i = 0; i < NUM_CAPTURE_SLOTS; ++i)
+			if (Atomic_LoadUInt32 (&capture_slots[i].state) != CAPTURE_SLOT_FREE)
+				++busy;
+		if (!busy)
+			return;
+		VID_UpdateCaptures (true);
+	}
 }
 
 /*
@@ -3348,25 +4826,54 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 	VkResult err;
 	int		 cb_index = current_cb_index;
 
+	// Water warp, poly blend and the menu fade only need their own pixel, so the post process pass applies them while it composites the UI.
+	// Scaling and palettization read neighbouring pixels and still need the compute pass.
+	const qboolean screen_effects = (parms->render_scale >= 2) || parms->vid_palettize || parms->ray_debug;
+	const qboolean fused_effects = !screen_effects && (parms->render_warp || (gl_polyblend.value && parms->v_blend[3]) || parms->menu);
+
+	// r_vrs shades the 3D view at 2x2 where the last frame's UI hides it, only when the UI composites fully opaque
+	const float	   coverage_scale = CLAMP (0.1f, scr_sbaralpha.value, 1.0f) * (1.0f - CLAMP (0.0f, r_ui_additive.value, 1.0f));
+	const qboolean coarse_shading =
+		vulkan_globals.fragment_shading_rate && (r_vrs.value != 0.0f) && !screen_effects && !vulkan_globals.supersampling && (coverage_scale >= 0.99f);
+
 	qboolean swapchain_acquired = parms->swapchain && GL_AcquireNextSwapChainImage ();
 	if (swapchain_acquired == true)
 	{
 		cb_context_t *cbx = vulkan_globals.secondary_cb_contexts[SCBX_POST_PROCESS];
 
+		uint32_t effect_flags = 0;
+		if (fused_effects && parms->render_warp)
+			effect_flags |= SCREEN_EFFECT_FLAG_WATER_WARP;
+		if (fused_effects && parms->menu)
+			effect_flags |= SCREEN_EFFECT_FLAG_MENU;
+
 		// Render post process
 		GL_Viewport (cbx, 0, 0, vid.width, vid.height, 0.0f, 1.0f);
-		float postprocess_values[10] = {
-			vid_gamma.value,	   q_min (2.0f, q_max (1.0f, vid_contrast.value)),
-			r_ui_warp.value,	   r_ui_chromatic.value * (1080.0f / (float)vid.height),
-			v_hud_offset_x,		   v_hud_offset_y,
-			scr_sbaralpha.value,   r_ui_echo.value,
-			r_ui_echo_scale.value, r_ui_additive.value,
+		const postprocess_constants_t push_constants = {
+			vid_gamma.value,
+			q_min (2.0f, q_max (1.0f, vid_contrast.value)),
+			r_ui_warp.value,
+			r_ui_chromatic.value * (1080.0f / (float)vid.height),
+			v_hud_offset_x,
+			v_hud_offset_y,
+			scr_sbaralpha.value,
+			r_ui_echo.value,
+			r_ui_echo_scale.value,
+			r_ui_additive.value,
+			parms->render_resolution,
+			effect_flags,
+			parms->time,
+			(float)parms->vid_width / (float)parms->vid_height,
+			(float)parms->v_blend[0] / 255.0f,
+			(float)parms->v_blend[1] / 255.0f,
+			(float)parms->v_blend[2] / 255.0f,
+			fused_effects ? ((float)parms->v_blend[3] / 255.0f) : 0.0f,
 		};
 
 		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.postprocess_pipeline);
 		VkDescriptorSet pp_sets[2] = {postprocess_descriptor_set, postprocess_ui_descriptor_set};
 		vkCmdBindDescriptorSets (cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.postprocess_pipeline.layout.handle, 0, 2, pp_sets, 0, NULL);
-		R_PushConstants (cbx, VK_SHADER_STAGE_FRAGMENT_BIT, 0, 10 * sizeof (float), postprocess_values);
+		R_PushConstants (cbx, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof (push_constants), &push_constants);
 		vkCmdDraw (cbx->cb, 3, 1, 0, 0);
 	}
 
@@ -3375,6 +4882,9 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 		for (int i = 0; i < SECONDARY_CB_MULTIPLICITY[scbx_index]; ++i)
 		{
 			cb_context_t *cbx = &vulkan_globals.secondary_cb_contexts[scbx_index][i];
+			Draw_FlushBatch (cbx);
+			if (i == (SECONDARY_CB_MULTIPLICITY[scbx_index] - 1))
+				R_EndGpuScope (cbx, SECONDARY_CB_GPU_SCOPES[scbx_index]);
 			R_EndDebugUtilsLabel (cbx);
 			err = vkEndCommandBuffer (cbx->cb);
 			if (err != VK_SUCCESS)
@@ -3399,8 +4909,10 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 	clear_values[1] = depth_clear_value;
 	clear_values[2] = vulkan_globals.color_clear_value;
 
-	const qboolean screen_effects = parms->render_warp || (parms->render_scale >= 2) || parms->vid_palettize || (gl_polyblend.value && parms->v_blend[3]) ||
-									parms->menu || parms->ray_debug;
+	frame_images_t frame_images;
+	GL_FrameImagesInit (&frame_images);
+	GL_PrepareShadingRate (render_passes_cb, &frame_images, coarse_shading);
+
 	{
 		const qboolean resolve = (vulkan_globals.sample_count != VK_SAMPLE_COUNT_1_BIT);
 		ZEROED_STRUCT (VkRenderPassBeginInfo, render_pass_begin_info);
@@ -3419,32 +4931,34 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 		vkCmdEndRenderPass (render_passes_cb);
 	}
 
-	GL_ScreenEffects (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], screen_effects, parms);
+	GL_FrameImageWritten (
+		&frame_images, screen_effects ? FRAME_IMAGE_UI : FRAME_IMAGE_SCENE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+	GL_OcclusionDepth (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], cb_index);
+
+	R_BeginGpuScope (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], GPU_SCOPE_SCREEN_EFFECTS);
+	GL_ScreenEffects (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], screen_effects, parms, &frame_images);
+	R_EndGpuScope (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], GPU_SCOPE_SCREEN_EFFECTS);
 
 	{
 #ifdef USE_RMLUI
 		UI_WriteBeginTimestamp (render_passes_cb);
+
+		// Renders the cached RmlUI layer the GUI pass composites, NULL while it is unchanged
+		VkCommandBuffer ui_layer_cb = (VkCommandBuffer)UI_TakeLayerCommandBuffer ();
+		if (ui_layer_cb != VK_NULL_HANDLE)
+			vkCmdExecuteCommands (render_passes_cb, 1, &ui_layer_cb);
 #endif
+		// The GUI pass clears color_buffers[1], screen effects may still be sampling it
+		GL_FrameImageUse (
+			&frame_images, FRAME_IMAGE_UI, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+		GL_FrameImagesFlush (render_passes_cb, &frame_images);
+
 		if (vulkan_globals.dynamic_rendering)
 		{
-			// Dynamic rendering path: explicit barriers + vkCmdBeginRenderingKHR
-			ZEROED_STRUCT (VkImageMemoryBarrier, ui_pre_barrier);
-			ui_pre_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			ui_pre_barrier.srcAccessMask = 0;
-			ui_pre_barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			ui_pre_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			ui_pre_barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-			ui_pre_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			ui_pre_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			ui_pre_barrier.image = vulkan_globals.color_buffers[1];
-			ui_pre_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			ui_pre_barrier.subresourceRange.baseMipLevel = 0;
-			ui_pre_barrier.subresourceRange.levelCount = 1;
-			ui_pre_barrier.subresourceRange.baseArrayLayer = 0;
-			ui_pre_barrier.subresourceRange.layerCount = 1;
-			vkCmdPipelineBarrier (
-				render_passes_cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &ui_pre_barrier);
-
+			// Dynamic rendering path: vkCmdBeginRenderingKHR, the tracker handles the layouts
 			VkClearValue ui_clear_value;
 			ui_clear_value.color.float32[0] = 0.0f;
 			ui_clear_value.color.float32[1] = 0.0f;
@@ -3470,25 +4984,6 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 			vulkan_globals.vk_cmd_begin_rendering (render_passes_cb, &rendering_info);
 			vkCmdExecuteCommands (render_passes_cb, 1, &vulkan_globals.secondary_cb_contexts[SCBX_GUI]->cb);
 			vulkan_globals.vk_cmd_end_rendering (render_passes_cb);
-
-			// Transition to SHADER_READ_ONLY for post-process sampling
-			ZEROED_STRUCT (VkImageMemoryBarrier, ui_post_barrier);
-			ui_post_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			ui_post_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			ui_post_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			ui_post_barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-			ui_post_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			ui_post_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			ui_post_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			ui_post_barrier.image = vulkan_globals.color_buffers[1];
-			ui_post_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			ui_post_barrier.subresourceRange.baseMipLevel = 0;
-			ui_post_barrier.subresourceRange.levelCount = 1;
-			ui_post_barrier.subresourceRange.baseArrayLayer = 0;
-			ui_post_barrier.subresourceRange.layerCount = 1;
-			vkCmdPipelineBarrier (
-				render_passes_cb, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1,
-				&ui_post_barrier);
 		}
 		else
 		{
@@ -3509,32 +5004,21 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 			vkCmdBeginRenderPass (render_passes_cb, &ui_rp_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 			vkCmdExecuteCommands (render_passes_cb, 1, &vulkan_globals.secondary_cb_contexts[SCBX_GUI]->cb);
 			vkCmdEndRenderPass (render_passes_cb);
+			GL_FrameImageWritten (
+				&frame_images, FRAME_IMAGE_UI, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
 		}
 #ifdef USE_RMLUI
 		UI_WriteEndTimestamp (render_passes_cb);
 #endif
 	}
 
-	{
-		// Transition color_buffers[0] from COLOR_ATTACHMENT_OPTIMAL to SHADER_READ_ONLY_OPTIMAL
-		// so the post-process pass can sample it as a texture
-		ZEROED_STRUCT (VkImageMemoryBarrier, game_barrier);
-		game_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		game_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		game_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		game_barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		game_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		game_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		game_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		game_barrier.image = vulkan_globals.color_buffers[0];
-		game_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		game_barrier.subresourceRange.baseMipLevel = 0;
-		game_barrier.subresourceRange.levelCount = 1;
-		game_barrier.subresourceRange.baseArrayLayer = 0;
-		game_barrier.subresourceRange.layerCount = 1;
-		vkCmdPipelineBarrier (
-			render_passes_cb, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &game_barrier);
-	}
+	// The post process pass samples both buffers, one batch covers the 3D view and the UI layer
+	GL_FrameImageUse (
+		&frame_images, FRAME_IMAGE_SCENE, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+	GL_FrameImageUse (
+		&frame_images, FRAME_IMAGE_UI, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+	GL_FrameImagesFlush (render_passes_cb, &frame_images);
 
 	{
 		// Post-Process Render Pass (samples color_buffers[0] + color_buffers[1], outputs to swapchain)
@@ -3549,14 +5033,22 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 		vkCmdEndRenderPass (render_passes_cb);
 	}
 
-	VkBuffer screenshot_buffer = VK_NULL_HANDLE;
-	ZEROED_STRUCT (vulkan_memory_t, screenshot_memory);
-	if (take_screenshot)
+	if (coarse_shading)
+		GL_UpdateShadingRate (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], &frame_images, parms, coverage_scale);
+
+	capture_slot_t *screenshot_slot = NULL;
+	capture_slot_t *movie_slot = NULL;
+	if (swapchain_acquired)
 	{
-		ScheduleScreenshotCopy (render_passes_cb, &screenshot_buffer, &screenshot_memory);
+		if (take_screenshot)
+			screenshot_slot = VID_ScheduleCapture (render_passes_cb, false);
+		if (capture_movie)
+			movie_slot = VID_ScheduleCapture (render_passes_cb, true);
 	}
 
 	{
+		R_EndGpuScope (&vulkan_globals.primary_cb_contexts[PCBX_RENDER_PASSES], GPU_SCOPE_FRAME);
+
 		VkCommandBuffer submit_cbs[PCBX_NUM];
 		for (int pcbx_index = 0; pcbx_index < PCBX_NUM; ++pcbx_index)
 		{
@@ -3567,20 +5059,63 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 				Sys_Error ("vkEndCommandBuffer failed");
 		}
 
-		ZEROED_STRUCT (VkSubmitInfo, submit_info);
-		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit_info.commandBufferCount = PCBX_NUM;
-		submit_info.pCommandBuffers = submit_cbs;
-		submit_info.waitSemaphoreCount = swapchain_acquired ? 1 : 0;
-		submit_info.pWaitSemaphores = &image_aquired_semaphores[cb_index];
-		submit_info.signalSemaphoreCount = swapchain_acquired ? 1 : 0;
-		submit_info.pSignalSemaphores = &draw_complete_semaphores[current_swapchain_buffer];
+		int					 num_wait_semaphores = 0;
+		VkSemaphore			 wait_semaphores[2];
+		VkPipelineStageFlags wait_dst_stage_masks[2];
+		int					 first_gfx_pcbx = 0;
+		if (async_compute_frame[cb_index])
+		{
+			ZEROED_STRUCT (VkSubmitInfo, prologue_submit_info);
+			prologue_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			prologue_submit_info.commandBufferCount = 1;
+			prologue_submit_info.pCommandBuffers = &async_prologue_command_buffers[cb_index];
+			prologue_submit_info.signalSemaphoreCount = 1;
+			prologue_submit_info.pSignalSemaphores = &async_start_semaphores[cb_index];
+			err = vkQueueSubmit (vulkan_globals.queue, 1, &prologue_submit_info, VK_NULL_HANDLE);
+			if (err != VK_SUCCESS)
+				Sys_Error ("vkQueueSubmit failed");
+
+			const VkPipelineStageFlags async_wait_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			ZEROED_STRUCT (VkSubmitInfo, async_submit_info);
+			async_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			async_submit_info.commandBufferCount = PCBX_RENDER_PASSES;
+			async_submit_info.pCommandBuffers = submit_cbs;
+			async_submit_info.waitSemaphoreCount = 1;
+			async_submit_info.pWaitSemaphores = &async_start_semaphores[cb_index];
+			async_submit_info.pWaitDstStageMask = &async_wait_stage_mask;
+			async_submit_info.signalSemaphoreCount = 1;
+			async_submit_info.pSignalSemaphores = &async_done_semaphores[cb_index];
+			err = vkQueueSubmit (vulkan_globals.async_queue, 1, &async_submit_info, VK_NULL_HANDLE);
+			if (err != VK_SUCCESS)
+				Sys_Error ("vkQueueSubmit failed");
+
+			// Lightmaps and warp images are sampled, the indirect draws and index buffers read and
+			// the TLAS traced. Clears, copies and anything else in front of those don't wait.
+			wait_semaphores[num_wait_semaphores] = async_done_semaphores[cb_index];
+			wait_dst_stage_masks[num_wait_semaphores++] = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+														  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+														  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			first_gfx_pcbx = PCBX_RENDER_PASSES;
+		}
 		// Wait at COLOR_ATTACHMENT_OUTPUT: world and UI render to off-screen color
 		// buffers (not the swapchain image), so they can proceed in parallel with
 		// image acquisition. Only the post-process pass writes to the swapchain
 		// image as a color attachment, making this the precise first-use stage.
-		VkPipelineStageFlags wait_dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		submit_info.pWaitDstStageMask = &wait_dst_stage_mask;
+		if (swapchain_acquired)
+		{
+			wait_semaphores[num_wait_semaphores] = image_aquired_semaphores[cb_index];
+			wait_dst_stage_masks[num_wait_semaphores++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+
+		ZEROED_STRUCT (VkSubmitInfo, submit_info);
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = PCBX_NUM - first_gfx_pcbx;
+		submit_info.pCommandBuffers = submit_cbs + first_gfx_pcbx;
+		submit_info.waitSemaphoreCount = num_wait_semaphores;
+		submit_info.pWaitSemaphores = wait_semaphores;
+		submit_info.pWaitDstStageMask = wait_dst_stage_masks;
+		submit_info.signalSemaphoreCount = swapchain_acquired ? 1 : 0;
+		submit_info.pSignalSemaphores = &draw_complete_semaphores[current_swapchain_buffer];
 
 		err = vkQueueSubmit (vulkan_globals.queue, 1, &submit_info, command_buffer_fences[cb_index]);
 		if (err != VK_SUCCESS)
@@ -3589,11 +5124,13 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 
 	vulkan_globals.device_idle = false;
 
-	if (take_screenshot && (screenshot_buffer != VK_NULL_HANDLE))
+	if (screenshot_slot)
 	{
-		WriteScreenshot (screenshot_buffer, screenshot_memory);
+		VID_SubmitCapture (screenshot_slot);
+		take_screenshot = false;
 	}
-	take_screenshot = false;
+	if (movie_slot)
+		VID_SubmitCapture (movie_slot);
 
 	if (swapchain_acquired == true)
 	{
@@ -3603,6 +5140,24 @@ static void GL_EndRenderingTask (end_rendering_parms_t *parms)
 		present_info.pSwapchains = &vulkan_swapchain, present_info.pImageIndices = &current_swapchain_buffer;
 		present_info.waitSemaphoreCount = 1;
 		present_info.pWaitSemaphores = &draw_complete_semaphores[current_swapchain_buffer];
+#if defined(VK_KHR_present_wait)
+		// Every present gets an id so pacing can wait on it, even before vid_lowlatency is turned on
+		ZEROED_STRUCT (VkPresentIdKHR, present_id_info);
+		if (vulkan_globals.present_wait)
+		{
+			present_id += 1;
+			present_input_time[present_id % PRESENT_HISTORY] = pacing_input_time;
+			present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+			present_id_info.swapchainCount = 1;
+			present_id_info.pPresentIds = &present_id;
+			present_info.pNext = &present_id_info;
+		}
+#endif
+		if (pacing_input_time > 0.0)
+		{
+			const double frame_cost = Sys_DoubleTime () - pacing_input_time;
+			pacing_frame_cost = (pacing_frame_cost > 0.0) ? (pacing_frame_cost + (frame_cost - pacing_frame_cost) * 0.1) : frame_cost;
+		}
 		err = fpQueuePresentKHR (vulkan_globals.queue, &present_info);
 #if defined(VK_EXT_full_screen_exclusive)
 		if ((err == VK_ERROR_OUT_OF_DATE_KHR) || (err == VK_ERROR_SURFACE_LOST_KHR) || (err == VK_SUBOPTIMAL_KHR) ||
@@ -3644,6 +5199,7 @@ task_handle_t GL_EndRendering (qboolean use_tasks, qboolean swapchain)
 		.ray_debug = r_raydebug.value && (bmodel_tlas != VK_NULL_HANDLE),
 #endif
 		.render_scale = CLAMP (0, render_scale, 8),
+		.render_resolution = render_resolution,
 		.vid_width = vid.width,
 		.vid_height = vid.height,
 		.time = fmod (cl.time, 2.0 * M_PI),
@@ -3711,6 +5267,11 @@ void VID_Shutdown (void)
 {
 	if (vid_initialized)
 	{
+		if (capture_movie)
+			VID_CaptureStop_f ();
+		VID_FlushCaptures ();
+		R_SaveDynamicBufferProfile ();
+		R_SaveWorldHints ();
 		SDL_QuitSubSystem (SDL_INIT_VIDEO);
 		draw_context = NULL;
 		PL_VID_Shutdown ();
@@ -3861,19 +5422,25 @@ static void R_CreatePaletteOctreeBuffers (uint32_t *colors, int num_colors, pale
 		countof (buffer_create_infos), buffer_create_infos, &memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_misc_allocations, "Palette");
 
 	{
+		// The tables are compiled in (see CreatePaletteOctree_f), so both go up through a single staging allocation
 		VkBuffer		staging_buffer;
 		VkCommandBuffer command_buffer;
 		int				staging_offset;
-		uint32_t	   *staging_memory = (uint32_t *)R_StagingAllocate (colors_size, 1, &command_buffer, &staging_buffer, &staging_offset);
-
-		VkBufferCopy region;
-		region.srcOffset = staging_offset;
-		region.dstOffset = 0;
-		region.size = colors_size;
-		vkCmdCopyBuffer (command_buffer, staging_buffer, palette_colors_buffer, 1, &region);
+		byte		   *staging_memory = R_StagingAllocate (colors_size + nodes_size, 1, &command_buffer, &staging_buffer, &staging_offset);
+
+		VkBufferCopy regions[2];
+		regions[0].srcOffset = staging_offset;
+		regions[0].dstOffset = 0;
+		regions[0].size = colors_size;
+		vkCmdCopyBuffer (command_buffer, staging_buffer, palette_colors_buffer, 1, &regions[0]);
+		regions[1].srcOffset = staging_offset + colors_size;
+		regions[1].dstOffset = 0;
+		regions[1].size = nodes_size;
+		vkCmdCopyBuffer (command_buffer, staging_buffer, palette_octree_buffer, 1, &regions[1]);
 
 		R_StagingBeginCopy ();
 		memcpy (staging_memory, colors, colors_size);
+		memcpy (staging_memory + colors_size, nodes, nodes_size);
 		R_StagingEndCopy ();
 
 		ZEROED_STRUCT (VkBufferViewCreateInfo, buffer_view_create_info);
@@ -3886,23 +5453,6 @@ static void R_CreatePaletteOctreeBuffers (uint32_t *colors, int num_colors, pale
 			Sys_Error ("vkCreateBufferView failed");
 		GL_SetObjectName ((uint64_t)palette_buffer_view, VK_OBJECT_TYPE_BUFFER_VIEW, "Palette colors");
 	}
-
-	{
-		VkBuffer		staging_buffer;
-		VkCommandBuffer command_buffer;
-		int				staging_offset;
-		uint32_t	   *staging_memory = (uint32_t *)R_StagingAllocate (nodes_size, 1, &command_buffer, &staging_buffer, &staging_offset);
-
-		VkBufferCopy region;
-		region.srcOffset = staging_offset;
-		region.dstOffset = 0;
-		region.size = nodes_size;
-		vkCmdCopyBuffer (command_buffer, staging_buffer, palette_octree_buffer, 1, &region);
-
-		R_StagingBeginCopy ();
-		memcpy (staging_memory, nodes, nodes_size);
-		R_StagingEndCopy ();
-	}
 }
 
 /*
@@ -3960,6 +5510,7 @@ void VID_Init (void)
 	Cvar_RegisterVariable (&vid_height);	  // johnfitz
 	Cvar_RegisterVariable (&vid_refreshrate); // johnfitz
 	Cvar_RegisterVariable (&vid_vsync);		  // johnfitz
+	Cvar_RegisterVariable (&vid_lowlatency);
 	Cvar_RegisterVariable (&vid_filter);
 	Cvar_RegisterVariable (&vid_anisotropic);
 	Cvar_RegisterVariable (&vid_fsaamode);
@@ -3967,6 +5518,13 @@ void VID_Init (void)
 	Cvar_RegisterVariable (&vid_desktopfullscreen); // QuakeSpasm
 	Cvar_RegisterVariable (&vid_borderless);		// QuakeSpasm
 	Cvar_RegisterVariable (&vid_palettize);
+	Cvar_RegisterVariable (&r_gpuspeeds);
+	Cvar_RegisterVariable (&r_dynamicscale);
+	Cvar_RegisterVariable (&r_dynamicscale_target);
+	Cvar_RegisterVariable (&r_dynamicscale_min);
+	Cvar_RegisterVariable (&r_dynamicscale_max);
+	Cvar_RegisterVariable (&r_asynccompute);
+	Cvar_RegisterVariable (&r_vrs);
 #if defined(_DEBUG)
 	Cvar_RegisterVariable (&r_raydebug);
 #endif
@@ -3989,6 +5547,8 @@ void VID_Init (void)
 	Cmd_AddCommand ("vid_describemodes", VID_DescribeModes_f);
 	Cmd_AddCommand ("vid_nextmode", VID_NextMode_f);
 	Cmd_AddCommand ("vid_prevmode", VID_PrevMode_f);
+	Cmd_AddCommand ("capture_start", VID_CaptureStart_f);
+	Cmd_AddCommand ("capture_stop", VID_CaptureStop_f);
 	Cmd_AddCommand ("vid_nextrate", VID_NextRate_f);
 	Cmd_AddCommand ("vid_prevrate", VID_PrevRate_f);
 	Cmd_AddCommand ("vid_nextfullscreen", VID_NextFullScreen_f);
@@ -4123,6 +5683,7 @@ void VID_Init (void)
 	TexMgr_InitHeap ();
 	R_InitSamplers ();
 	R_CreatePipelineLayouts ();
+	R_InitPipelineCache ();
 	R_CreatePaletteOctreeBuffers (palette_octree_colors, NUM_PALETTE_OCTREE_COLORS, palette_octree_nodes, NUM_PALETTE_OCTREE_NODES);
 	// GL_CreateRenderResources ();
 	// Note: RmlUI Vulkan init moved to GL_CreateRenderResources() after render passes exist
@@ -4201,8 +5762,6 @@ static void VID_Restart (qboolean set_mode)
 			IN_HideCursor ();
 	}
 
-	R_InitSamplers ();
-
 	SCR_UpdateRelativeScale ();
 
 	scr_initialized = true;
@@ -4781,8 +6340,7 @@ SCR_ScreenShot_f -- johnfitz
 */
 void SCR_ScreenShot_f (void)
 {
-	if ((vulkan_globals.swap_chain_format != VK_FORMAT_B8G8R8A8_UNORM) && (vulkan_globals.swap_chain_format != VK_FORMAT_B8G8R8A8_SRGB) &&
-		(vulkan_globals.swap_chain_format != VK_FORMAT_R8G8B8A8_UNORM) && (vulkan_globals.swap_chain_format != VK_FORMAT_R8G8B8A8_SRGB))
+	if (!VID_CaptureFormatSupported ())
 	{
 		Con_Printf ("SCR_ScreenShot_f: Unsupported surface format\n");
 		return;
@@ -4813,13 +6371,6 @@ void SCR_ScreenShot_f (void)
 		return;
 	}
 
-	if ((vulkan_globals.swap_chain_format != VK_FORMAT_B8G8R8A8_UNORM) && (vulkan_globals.swap_chain_format != VK_FORMAT_B8G8R8A8_SRGB) &&
-		(vulkan_globals.swap_chain_format != VK_FORMAT_R8G8B8A8_UNORM) && (vulkan_globals.swap_chain_format != VK_FORMAT_R8G8B8A8_SRGB))
-	{
-		Con_Printf ("SCR_ScreenShot_f: Unsupported surface format\n");
-		return;
-	}
-
 	// find a file name to save it to
 	int i;
 
@@ -4856,6 +6407,89 @@ void SCR_ScreenShot_f (void)
 	take_screenshot = true;
 }
 
+/*
+==================
+VID_CaptureStart_f
+
+Writes every frame to capture/<map>-<date>/ and steps the game at a fixed rate meanwhile,
+the frames are independent of how fast they can be rendered and encoded
+==================
+*/
+static void VID_CaptureStart_f (void)
+{
+	int fps = 30;
+
+	if (capture_movie)
+	{
+		Con_Printf ("Already capturing to %s\n", capture_dir);
+		return;
+	}
+	if (!VID_CaptureFormatSupported ())
+	{
+		Con_Printf ("VID_CaptureStart_f: Unsupported surface format\n");
+		return;
+	}
+
+	memcpy (capture_ext, "tga", sizeof (capture_ext));
+	capture_quality = 90;
+	if (Cmd_Argc () >= 2)
+		fps = atoi (Cmd_Argv (1));
+	if (Cmd_Argc () >= 3)
+	{
+		const char *requested_ext = Cmd_Argv (2);
+		if (q_strcasecmp ("png", requested_ext) && q_strcasecmp ("tga", requested_ext) && q_strcasecmp ("jpg", requested_ext))
+			fps = 0;
+		else
+			memcpy (capture_ext, requested_ext, sizeof (capture_ext));
+	}
+	if (Cmd_Argc () >= 4)
+		capture_quality = atoi (Cmd_Argv (3));
+	if (fps < 1 || fps > 1000 || capture_quality < 1 || capture_quality > 100)
+	{
+		Con_Printf ("usage: capture_start [fps] [format] [quality]\n");
+		Con_Printf ("   fps defaults to 30\n");
+		Con_Printf ("   format must be \"tga\" (default), \"png\" or \"jpg\"\n");
+		Con_Printf ("   quality must be 1-100\n");
+		return;
+	}
+
+	time_t now;
+	time (&now);
+	struct tm *lt = localtime (&now);
+	q_snprintf (
+		capture_dir, sizeof (capture_dir), "capture/%s-%04d%02d%02d-%02d%02d%02d", cl.mapname[0] ? cl.mapname : "nomap", lt->tm_year + 1900, lt->tm_mon + 1,
+		lt->tm_mday, lt->tm_hour, lt->tm_min, lt->tm_sec);
+	Sys_mkdir (com_gamedir);
+	Sys_mkdir (va ("%s/capture", com_gamedir));
+	Sys_mkdir (va ("%s/%s", com_gamedir, capture_dir));
+
+	capture_frame = 0;
+	capture_old_framerate = host_framerate.value;
+	Cvar_SetValueQuick (&host_framerate, 1.0f / fps);
+	capture_movie = true;
+	Con_Printf ("Capturing %d fps %s frames to %s\n", fps, capture_ext, capture_dir);
+}
+
+/*
+==================
+VID_CaptureStop_f
+==================
+*/
+static void VID_CaptureStop_f (void)
+{
+	if (!capture_movie)
+	{
+		Con_Printf ("Not capturing\n");
+		return;
+	}
+
+	GL_SynchronizeEndRenderingTask ();
+	capture_movie = false;
+	VID_FlushCaptures ();
+	Cvar_SetValueQuick (&host_framerate, capture_old_framerate);
+	Con_Printf ("Wrote %d frames to %s\n", capture_frame, capture_dir);
+}
+
 void VID_FocusGained (void)
 {
 	has_focus = true;
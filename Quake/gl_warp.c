@@ -28,6 +28,12 @@ extern cvar_t r_drawflat;
 cvar_t r_waterquality = {"r_waterquality", "8", CVAR_NONE};
 cvar_t r_waterwarp = {"r_waterwarp", "1", CVAR_ARCHIVE};
 cvar_t r_waterwarpcompute = {"r_waterwarpcompute", "1", CVAR_ARCHIVE};
+cvar_t r_waterwarprate = {"r_waterwarprate", "0", CVAR_ARCHIVE}; // max warp updates per second of game time, 0 for every frame
+
+// Bumped when settings that change the warp output change, so every warpimage gets redrawn
+static uint32_t warp_generation = 1;
+static float	warp_last_tess;
+static int		warp_last_compute;
 
 float turbsin[] = {
 #include "gl_warp_sin.h"
@@ -143,6 +149,9 @@ void R_UpdateWarpTextures (void *unused)
 	cb_context_t *cbx = &vulkan_globals.primary_cb_contexts[PCBX_UPDATE_WARP];
 	GL_SetCanvas (cbx, CANVAS_NONE); // Invalidate canvas so push constants get set later
 
+	// Also baked while paused, the sky task may sample it for the first time this frame
+	Sky_UpdateCache (cbx);
+
 	texture_t *tx;
 	int		   i, mip;
 	float	   warptess;
@@ -151,8 +160,16 @@ void R_UpdateWarpTextures (void *unused)
 		return;
 
 	R_BeginDebugUtilsLabel (cbx, "Update Warp Textures");
+	R_BeginGpuScope (cbx, GPU_SCOPE_WARP);
 
 	warptess = 128.0 / CLAMP (3.0, floor (r_waterquality.value), 64.0);
+	if ((warptess != warp_last_tess) || ((int)r_waterwarpcompute.value != warp_last_compute))
+	{
+		warp_last_tess = warptess;
+		warp_last_compute = (int)r_waterwarpcompute.value;
+		++warp_generation;
+	}
+	const double min_interval = (r_waterwarprate.value > 0.0f) ? (1.0 / r_waterwarprate.value) : 0.0;
 
 	int num_warp_textures = 0;
 
@@ -176,6 +193,14 @@ void R_UpdateWarpTextures (void *unused)
 			if (!Atomic_LoadUInt32 (&tx->update_warp))
 				continue;
 
+			// Visible, but the image from an earlier frame is still current enough
+			if ((tx->warp_generation == warp_generation) && (tx->warp_image == tx->warpimage->image) &&
+				((cl.time == tx->warp_time) || ((cl.time > tx->warp_time) && ((cl.time - tx->warp_time) < min_interval))))
+			{
+				Atomic_StoreUInt32 (&tx->update_warp, false);
+				continue;
+			}
+
 			if (r_waterwarpcompute.value)
 			{
 				VkImageMemoryBarrier *image_barrier = &warp_image_barriers[num_warp_textures];
@@ -305,10 +330,14 @@ void R_UpdateWarpTextures (void *unused)
 		image_barrier->subresourceRange.layerCount = 1;
 
 		Atomic_StoreUInt32 (&tx->update_warp, false);
+		tx->warp_time = cl.time;
+		tx->warp_image = tx->warpimage->image;
+		tx->warp_generation = warp_generation;
 	}
 
 	vkCmdPipelineBarrier (
 		cbx->cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, num_warp_textures, warp_image_barriers);
 
+	R_EndGpuScope (cbx, GPU_SCOPE_WARP);
 	R_EndDebugUtilsLabel (cbx);
 }
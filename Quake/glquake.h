@@ -33,7 +33,10 @@ qboolean	  GL_BeginRendering (qboolean use_tasks, task_handle_t *begin_rendering
 qboolean	  GL_AcquireNextSwapChainImage (void);
 task_handle_t GL_EndRendering (qboolean use_tasks, qboolean use_swapchain);
 void		  GL_SynchronizeEndRenderingTask (void);
+float		  GL_DynamicScale (void);
 void		  GL_UpdateDescriptorSets (void);
+qboolean	  GL_CompressedFormatSupported (VkFormat format);
+qboolean	  GL_GetDeviceMemoryBudget (uint64_t *usage, uint64_t *budget);
 
 extern int glwidth, glheight;
 
@@ -83,17 +86,15 @@ typedef enum
 } ptype_t;
 
 // !!! if this is changed, it must be changed in d_ifacea.h too !!!
+// spawn state of a classic particle, r_part.c keeps the live ones as structure of arrays
 typedef struct particle_s
 {
-	// driver-usable fields
-	vec3_t			   org;
-	float			   color;
-	// drivers never touch the following fields
-	struct particle_s *next;
-	vec3_t			   vel;
-	float			   ramp;
-	float			   die;
-	ptype_t			   type;
+	vec3_t	org;
+	float	color;
+	vec3_t	vel;
+	float	ramp;
+	float	die;
+	ptype_t type;
 } particle_t;
 
 #define P_INVALID -1
@@ -220,6 +221,26 @@ static const int SECONDARY_CB_MULTIPLICITY[SCBX_NUM] = {
 	1,				  // SCBX_POST_PROCESS,
 };
 
+// GPU timestamp scopes, one begin/end query pair each per frame in flight
+typedef enum
+{
+	GPU_SCOPE_FRAME,
+	GPU_SCOPE_LIGHTMAPS,
+	GPU_SCOPE_WARP,
+	GPU_SCOPE_WORLD,
+	GPU_SCOPE_ENTITIES,
+	GPU_SCOPE_SKY,
+	GPU_SCOPE_ALPHA_ENTITIES_ACROSS_WATER,
+	GPU_SCOPE_WATER,
+	GPU_SCOPE_ALPHA_ENTITIES,
+	GPU_SCOPE_PARTICLES,
+	GPU_SCOPE_VIEW_MODEL,
+	GPU_SCOPE_SCREEN_EFFECTS,
+	GPU_SCOPE_GUI,
+	GPU_SCOPE_POST_PROCESS,
+	GPU_SCOPE_NUM,
+} gpu_scope_t;
+
 typedef struct cb_context_s
 {
 	VkCommandBuffer	  cb;
@@ -230,6 +251,11 @@ typedef struct cb_context_s
 	vulkan_pipeline_t current_pipeline;
 	uint32_t		  vbo_indices[MAX_BATCH_SIZE];
 	unsigned int	  num_vbo_indices;
+	// 2D quads of the same pipeline and texture waiting for Draw_FlushBatch, allocated on first use
+	struct basicvertex_s *draw_batch;
+	int					  num_draw_batch_verts;
+	vulkan_pipeline_t	  draw_batch_pipeline;
+	VkDescriptorSet		  draw_batch_descriptor_set; // VK_NULL_HANDLE for the notex pipelines
 } cb_context_t;
 
 typedef struct
@@ -239,6 +265,8 @@ typedef struct
 	qboolean						 validation;
 	qboolean						 debug_utils;
 	VkQueue							 queue;
+	VkQueue							 async_queue; // second queue of the graphics family, VK_NULL_HANDLE if it only has one
+	VkPipelineCache					 pipeline_cache;
 	cb_context_t					 primary_cb_contexts[PCBX_NUM];
 	cb_context_t					*secondary_cb_contexts[SCBX_NUM];
 	VkClearValue					 color_clear_value;
@@ -256,7 +284,11 @@ typedef struct
 	qboolean						 supersampling;
 	qboolean						 non_solid_fill;
 	qboolean						 multi_draw_indirect;
+	qboolean						 texture_compression_bc;
+	qboolean						 texture_compression_astc;
+	qboolean						 memory_budget;
 	qboolean						 screen_effects_sops;
+	qboolean						 sampled_depth;
 
 	// Instance extensions
 	qboolean get_surface_capabilities_2;
@@ -269,6 +301,10 @@ typedef struct
 	qboolean ray_query;
 	qboolean synchronization_2;
 	qboolean dynamic_rendering;
+	qboolean descriptor_indexing;
+	qboolean present_wait;
+	qboolean fragment_shading_rate;
+	uint32_t shading_rate_texel_size; // Pixels per texel of the shading rate attachment, square
 
 	// Buffers
 	VkImage color_buffers[NUM_COLOR_BUFFERS];
@@ -291,8 +327,11 @@ typedef struct
 	vulkan_pipeline_layout_t basic_pipeline_layout;
 	vulkan_pipeline_t		 world_pipelines[WORLD_PIPELINE_COUNT];
 	vulkan_pipeline_layout_t world_pipeline_layout;
+	vulkan_pipeline_t		 world_indirect_pipelines[WORLD_PIPELINE_COUNT];
+	vulkan_pipeline_layout_t world_indirect_pipeline_layout;
 	vulkan_pipeline_t		 raster_tex_warp_pipeline;
 	vulkan_pipeline_t		 particle_pipeline;
+	vulkan_pipeline_t		 particle_gpu_pipeline;
 	vulkan_pipeline_t		 sprite_pipeline;
 	vulkan_pipeline_layout_t sky_pipeline_layout[2]; // one texture (cubemap-like), two textures (animated layers)
 	vulkan_pipeline_t		 sky_stencil_pipeline[2];
@@ -300,7 +339,9 @@ typedef struct
 	vulkan_pipeline_t		 sky_box_pipeline;
 	vulkan_pipeline_t		 sky_cube_pipeline[2];
 	vulkan_pipeline_t		 sky_layer_pipeline[2];
+	vulkan_pipeline_t		 sky_cache_pipeline;
 	vulkan_pipeline_t		 alias_pipelines[MODEL_PIPELINE_COUNT];
+	vulkan_pipeline_t		 alias_instanced_pipelines[MODEL_PIPELINE_COUNT];
 	vulkan_pipeline_t		 md5_pipelines[MODEL_PIPELINE_COUNT];
 	vulkan_pipeline_t		 postprocess_pipeline;
 	vulkan_pipeline_t		 screen_effects_pipeline;
@@ -316,6 +357,10 @@ typedef struct
 	vulkan_pipeline_t		 update_lightmap_rt_pipeline;
 	vulkan_pipeline_t		 indirect_draw_pipeline;
 	vulkan_pipeline_t		 indirect_clear_pipeline;
+	vulkan_pipeline_t		 indirect_mark_pipeline;
+	vulkan_pipeline_t		 alias_cull_pipeline;
+	vulkan_pipeline_t		 occlusion_depth_pipeline;
+	vulkan_pipeline_t		 shading_rate_pipeline;
 	vulkan_pipeline_t		 ray_debug_pipeline;
 	vulkan_pipeline_t		 mesh_interpolate_pipeline;
 	vulkan_pipeline_t		 skinning_pipeline;
@@ -334,9 +379,15 @@ typedef struct
 	vulkan_desc_set_layout_t lightmap_compute_set_layout;
 	VkDescriptorSet			 indirect_compute_desc_set;
 	vulkan_desc_set_layout_t indirect_compute_set_layout;
+	vulkan_desc_set_layout_t alias_cull_set_layout;
+	vulkan_desc_set_layout_t bmodel_transforms_set_layout;
 	vulkan_desc_set_layout_t lightmap_compute_rt_set_layout;
 	VkDescriptorSet			 ray_debug_desc_set;
 	vulkan_desc_set_layout_t ray_debug_set_layout;
+	VkDescriptorSet			 occlusion_depth_desc_set;
+	vulkan_desc_set_layout_t occlusion_depth_set_layout;
+	VkDescriptorSet			 shading_rate_desc_set;
+	vulkan_desc_set_layout_t shading_rate_set_layout;
 	vulkan_desc_set_layout_t joints_buffer_set_layout;
 
 	// Scratch buffer for animated AS building (vertex positions + AS build scratch)
@@ -380,6 +431,9 @@ typedef struct
 	PFN_vkCmdBeginRenderingKHR vk_cmd_begin_rendering;
 	PFN_vkCmdEndRenderingKHR   vk_cmd_end_rendering;
 
+	// VK_KHR_fragment_shading_rate, the attachment needs render passes from VK_KHR_create_renderpass2
+	PFN_vkCreateRenderPass2KHR vk_create_render_pass_2;
+
 	PFN_vkGetAccelerationStructureBuildSizesKHR		   vk_get_acceleration_structure_build_sizes;
 	PFN_vkCreateAccelerationStructureKHR			   vk_create_acceleration_structure;
 	PFN_vkDestroyAccelerationStructureKHR			   vk_destroy_acceleration_structure;
@@ -395,6 +449,8 @@ typedef struct
 
 extern vulkanglobals_t vulkan_globals;
 extern qboolean		   indirect;
+extern qboolean		   indirect_mark;
+extern qboolean		   occlusion_cull;
 
 //====================================================
 
@@ -405,6 +461,7 @@ extern qboolean render_warp;
 extern qboolean in_update_screen;
 extern qboolean use_simd;
 extern int		render_scale;
+extern float	render_resolution;
 
 //
 // view origin
@@ -476,13 +533,17 @@ typedef struct
 extern overflowtimes_t dev_overflows; // this stores the last time overflow messages were displayed, not the last time overflows occured
 #define CONSOLE_RESPAM_TIME 3		  // seconds between repeated warning messages
 
-typedef struct
+typedef struct basicvertex_s
 {
 	float position[3];
 	float texcoord[2];
 	byte  color[4];
 } basicvertex_t;
 
+// gl_draw.c 2D batch, flushed on a pipeline, texture or canvas change and before anything else records into cbx
+basicvertex_t *Draw_BatchVertices (cb_context_t *cbx, vulkan_pipeline_t pipeline, gltexture_t *texture, int num_verts);
+void		   Draw_FlushBatch (cb_context_t *cbx);
+
 // johnfitz -- moved here from r_brush.c
 extern int gl_lightmap_format;
 
@@ -494,6 +555,10 @@ extern int gl_lightmap_format;
 
 #define LM_CULL_BLOCK_W 128
 #define LM_CULL_BLOCK_H 256
+#define LM_CULL_BLOCKS_X (LMBLOCK_WIDTH / LM_CULL_BLOCK_W)
+#define LM_CULL_BLOCKS_Y (LMBLOCK_HEIGHT / LM_CULL_BLOCK_H)
+#define LM_CULL_BLOCK_BIT(x, y) (1u << ((y) * LM_CULL_BLOCKS_X + (x)))
+COMPILE_TIME_ASSERT (lm_cull_blocks, LM_CULL_BLOCKS_X * LM_CULL_BLOCKS_Y <= 32);
 
 typedef struct lm_compute_workgroup_bounds_s
 {
@@ -522,10 +587,12 @@ struct lightmap_s
 	glRect_t	rectchange;
 	glMaxUsed_t lightstyle_rectused[1 + MAXLIGHTMAPS * 3 / 4]; // [0]: surface_indices; [1,2,3]: lightstyle_textures[0,1,2]
 
-	lm_compute_workgroup_bounds_t global_bounds[LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W];
-	byte						  active_dlights[LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W];
-	byte						  num_used_lightstyles[LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W];
-	byte						  used_lightstyles[LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W][MAX_LIGHTSTYLES];
+	lm_compute_workgroup_bounds_t global_bounds[LM_CULL_BLOCKS_Y][LM_CULL_BLOCKS_X];
+	uint32_t					  active_dlight_blocks;				// LM_CULL_BLOCK_BIT of the blocks lit by the last update
+	uint32_t					  lightstyle_blocks[MAX_LIGHTSTYLES]; // LM_CULL_BLOCK_BIT of the blocks using each style
+	byte						  num_lightstyles;
+	qboolean					  fourth_style; // some surface uses the alpha of lightstyle_textures
+	byte						  lightstyles[MAX_LIGHTSTYLES]; // styles with any lightstyle_blocks
 	int							  cached_light[MAX_LIGHTSTYLES];
 	int							  cached_framecount;
 
@@ -563,18 +630,58 @@ void R_NewGame (void);
 
 void R_AnimateLight (void);
 void R_BuildTopLevelAccelerationStructure (void *unused);
-void R_UpdateAnimatedBLASes (cb_context_t *cbx);
+int	 R_UpdateAnimatedBLASes (cb_context_t *cbx);
 void R_UpdateLightmapsAndIndirect (void *unused);
 void R_MarkSurfaces (qboolean use_tasks, task_handle_t before_mark, task_handle_t *store_efrags, task_handle_t *cull_surfaces, task_handle_t *chain_surfaces);
 qboolean R_CullBox (vec3_t emins, vec3_t emaxs);
-void	 R_StoreEfrags (efrag_t **ppefrag);
+
+typedef struct
+{
+	uint32_t key;
+	uint32_t index;
+} sortkey_t;
+
+typedef struct
+{
+	sortkey_t *keys; // 2 * capacity, the second half is scratch space for R_RadixSort
+	int		   capacity;
+} sortbuffer_t;
+
+sortkey_t *R_SortBufferReserve (sortbuffer_t *buffer, int count);
+void	   R_RadixSort (sortkey_t *keys, int count);
+
+// The bits of a non-negative float sort like its value
+static inline uint32_t R_DepthSortKey (float depth)
+{
+	uint32_t key;
+	memcpy (&key, &depth, sizeof (key));
+	return key;
+}
+void	 R_BakeEfrags (void);
+void	 R_MarkLeafStatics (mleaf_t *leaf);
+void	 R_StoreStaticEntities (void);
+void	 R_EntityBounds (entity_t *e, vec3_t mins, vec3_t maxs);
 qboolean R_CullModelForEntity (entity_t *e);
 void	 R_RotateForEntity (float matrix[16], vec3_t origin, vec3_t angles, unsigned char scale);
 void	 R_MarkLights (dlight_t *light, int num, mnode_t *node);
 
+// Size of the depth grid occlusion_depth.comp writes
+#define OCCLUSION_GRID_WIDTH  128
+#define OCCLUSION_GRID_HEIGHT 64
+
+void	 R_InitOcclusion (void);
+VkBuffer R_GetOcclusionBuffer (void);
+void	 R_OcclusionBeginFrame (int cb_index);
+void	 R_OcclusionSetupView (void);
+qboolean R_OcclusionPendingDispatch (int cb_index, uint32_t push_constants[6]);
+qboolean R_OccludedBox (const vec3_t mins, const vec3_t maxs, qboolean entity);
+
+#define NUM_PARTICLE_UPDATE_TASKS 8
+
 void R_InitParticles (void);
 void R_DrawParticles (cb_context_t *cbx);
-void CL_RunParticles (void);
+void R_PrepareParticles (void *unused);
+void R_UpdateParticles (int index, void *unused);
 void R_ClearParticles (void);
 
 void R_TranslatePlayerSkin (int playernum);
@@ -584,8 +691,11 @@ void R_UpdateWarpTextures (void *unused);
 void R_MarkDeps (int combined_deps, int worker_index);
 
 qboolean R_IndirectBrush (entity_t *e);
+void	 R_IndirectBeginFrame (int cb_index);
 
 void R_DrawWorld (cb_context_t *cbx, int index);
+void R_LoadWorldHints (void);
+void R_SaveWorldHints (void);
 
 // johnfitz -- struct for passing lerp information to drawing functions
 typedef struct
@@ -598,11 +708,51 @@ typedef struct
 } lerpdata_t;
 // johnfitz
 
+// opaque MDL/MD3 surfaces queued by R_DrawAliasModel, drawn instanced by R_FlushAliasInstances
+#define MAX_QUEUED_ALIAS_INSTANCES 128
+
+typedef struct
+{
+	float model_matrix[16];
+	float shade_vector[3];
+	float blend_factor;
+	float light_color[3];
+	float padding;
+} aliasinstance_t;
+
+typedef struct
+{
+	aliashdr_t	   *hdr;
+	gltexture_t	   *tx;
+	gltexture_t	   *fb;
+	int				pose1;
+	int				pose2;
+	qboolean		alphatest;
+	aliasinstance_t instance;
+	float			mins[3], maxs[3]; // world space bounds for R_AliasCullAllocate
+} aliasqueueentry_t;
+
+typedef struct
+{
+	int				  num_entries;
+	aliasqueueentry_t entries[MAX_QUEUED_ALIAS_INSTANCES];
+} aliasqueue_t;
+
+extern qboolean alias_gpu_cull;
+
+qboolean R_InitAliasCull (void);
+void	 R_AliasCullBeginFrame (int cb_index);
+qboolean R_AliasCullAllocate (
+	aliashdr_t *hdr, const aliasqueueentry_t *entries, int count, VkBuffer *instance_buffer, VkDeviceSize *instance_offset, VkBuffer *draw_buffer,
+	VkDeviceSize *draw_offset);
+void R_AliasCullDispatch (cb_context_t *cbx);
+
 void R_UpdateEntityAnimState (entity_t *e, aliashdr_t *paliashdr);
 void R_UpdateEntityMoveState (entity_t *e);
 void R_GetEntityLerpedTransform (entity_t *e, vec3_t out_origin, vec3_t out_angles);
 void R_SetupAliasFrame (entity_t *e, aliashdr_t *paliashdr, int frame, lerpdata_t *lerpdata);
-void R_DrawAliasModel (cb_context_t *cbx, entity_t *e, int *aliaspolys);
+void R_DrawAliasModel (cb_context_t *cbx, entity_t *e, int *aliaspolys, aliasqueue_t *queue);
+void R_FlushAliasInstances (cb_context_t *cbx, aliasqueue_t *queue);
 void R_DrawBrushModel (cb_context_t *cbx, entity_t *e, int chain, int *brushpolys, qboolean sort, qboolean water_opaque_only, qboolean water_transparent_only);
 void R_DrawSpriteModel (cb_context_t *cbx, entity_t *e);
 void R_DrawIndirectBrushes (cb_context_t *cbx, qboolean draw_water, qboolean transparent_water, qboolean draw_sky, int index);
@@ -621,6 +771,7 @@ void GL_BuildBModelAccelerationStructures (void);
 void GL_PrepareSIMDAndParallelData (void);
 void GLMesh_UploadBuffers (qmodel_t *mod, aliashdr_t *hdr, unsigned short *indexes, byte *vertexes, aliasmesh_t *desc, jointpose_t *joints);
 void GLMesh_DeleteAllMeshBuffers (void);
+int	 GLMesh_Defragment (float max_occupancy);
 void R_AllocateEntityBLAS (entity_t *e);
 void R_FreeEntityBLAS (entity_t *e);
 void R_FreeAllEntityBLASes (void);
@@ -646,6 +797,7 @@ void		Sky_ClearAll (void);
 void		Sky_DrawSky (cb_context_t *cbx);
 qboolean	Sky_NeedStencil ();
 void		Sky_NewMap (void);
+void		Sky_UpdateCache (cb_context_t *cbx);
 void		Sky_LoadTexture (qmodel_t *mod, texture_t *mt, int tex_index);
 void		Sky_LoadTextureQ64 (qmodel_t *mod, texture_t *mt, int tex_index);
 void		Sky_LoadSkyBox (const char *name);
@@ -665,7 +817,9 @@ void R_CreateDescriptorPool ();
 void R_CreateDescriptorSetLayouts ();
 void R_InitSamplers ();
 void R_CreatePipelineLayouts ();
+void R_InitPipelineCache (void);
 void R_CreatePipelines ();
+void R_UpdateDeferredPipelines (qboolean wait);
 void R_DestroyPipelines ();
 
 #define MAX_PUSH_CONSTANT_SIZE 128 // Vulkan guaranteed minimum maxPushConstantsSize
@@ -714,6 +868,9 @@ static inline void R_EndDebugUtilsLabel (cb_context_t *cbx)
 
 void R_AllocateVulkanMemory (vulkan_memory_t *memory, VkMemoryAllocateInfo *memory_allocate_info, vulkan_memory_type_t type, atomic_uint32_t *num_allocations);
 void R_FreeVulkanMemory (vulkan_memory_t *memory, atomic_uint32_t *num_allocations);
+// For the UI renderer, which keeps VkDeviceMemory handles
+VkDeviceMemory R_AllocateUIMemory (VkDeviceSize size, uint32_t memory_type_index, qboolean host);
+void		   R_FreeUIMemory (VkDeviceMemory memory, VkDeviceSize size, qboolean host);
 
 void R_CreateBuffer (
 	VkBuffer *buffer, vulkan_memory_t *memory, const size_t size, VkBufferUsageFlags usage, const VkFlags mem_requirements_mask,
@@ -744,11 +901,13 @@ byte *R_StagingAllocate (int size, int alignment, VkCommandBuffer *cb_context, V
 void  R_StagingBeginCopy (void);
 void  R_StagingEndCopy (void);
 void  R_StagingUploadBuffer (const VkBuffer buffer, const size_t size, const byte *data);
+void  R_StagingUploadBufferAt (const VkBuffer buffer, const VkDeviceSize offset, const size_t size, const byte *data);
 
 void		   R_InitGPUBuffers (void);
 void		   R_InitMeshHeap (void);
 glheapstats_t *R_GetMeshHeapStats (void);
 void		   R_SwapDynamicBuffers (void);
+void		   R_SaveDynamicBufferProfile (void);
 void		   R_FlushDynamicBuffers (void);
 void		   R_CollectDynamicBufferGarbage (void);
 void		   R_CollectMeshBufferGarbage (void);
@@ -760,5 +919,7 @@ byte		  *R_StorageAllocate (int size, VkBuffer *buffer, VkDeviceSize *buffer_off
 void R_AllocateLightmapComputeBuffers ();
 
 void GL_SetObjectName (uint64_t object, VkObjectType object_type, const char *name);
+void R_BeginGpuScope (cb_context_t *cbx, gpu_scope_t scope);
+void R_EndGpuScope (cb_context_t *cbx, gpu_scope_t scope);
 
 #endif /* GLQUAKE_H */
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "quakedef.h"
+#include "bench.h"
 
 #define MIN_KEY_VALUE_STORAGE_SIZE 16
 #define MIN_HASH_SIZE			   32
@@ -291,7 +292,11 @@ uint32_t HashMap_Size (hash_map_t *map)
 	return map->num_entries;
 }
 
+DEFINE_FLAT_MAP (flat_map_bench_t, FlatMapBench, int64_t, int32_t, HashInt64, FlatMap_MemCmp)
+
 #ifdef _DEBUG
+DEFINE_FLAT_MAP_UINT32 (flat_map_test_t, FlatMapTest, int64_t)
+
 /*
 =================
 HashMap_TestAssert
@@ -372,6 +377,74 @@ static void HashMap_StressTest (void)
 	TEMP_FREE (keys);
 }
 
+/*
+=================
+FlatMap_BasicTest
+=================
+*/
+static void FlatMap_BasicTest (const qboolean reserve)
+{
+	const int		 TEST_SIZE = 1000;
+	flat_map_test_t	*map = FlatMapTest_Create ();
+	if (reserve)
+		FlatMapTest_Reserve (map, TEST_SIZE);
+	for (uint32_t i = 0; i < TEST_SIZE; ++i)
+	{
+		int64_t value = i;
+		HashMap_TestAssert (!FlatMapTest_Insert (map, &i, &value), va ("%d should not be overwritten\n", i));
+	}
+	for (uint32_t i = 0; i < TEST_SIZE; ++i)
+		HashMap_TestAssert (*FlatMapTest_Lookup (map, &i) == i, va ("Wrong lookup for %d\n", i));
+	for (uint32_t i = 0; i < TEST_SIZE; i += 2)
+		FlatMapTest_Erase (map, &i);
+	for (uint32_t i = 1; i < TEST_SIZE; i += 2)
+		HashMap_TestAssert (*FlatMapTest_Lookup (map, &i) == i, va ("Wrong lookup for %d\n", i));
+	for (uint32_t i = 0; i < TEST_SIZE; i += 2)
+		HashMap_TestAssert (FlatMapTest_Lookup (map, &i) == NULL, va ("Wrong lookup for %d\n", i));
+	for (uint32_t i = 0; i < TEST_SIZE; ++i)
+		FlatMapTest_Erase (map, &i);
+	HashMap_TestAssert (FlatMapTest_Size (map) == 0, "Map is not empty");
+	for (uint32_t i = 0; i < TEST_SIZE; ++i)
+		HashMap_TestAssert (FlatMapTest_Lookup (map, &i) == NULL, va ("Wrong lookup for %d\n", i));
+	FlatMapTest_Destroy (map);
+}
+
+/*
+=================
+FlatMap_StressTest
+
+Repeated fill and drain, so most inserts land on tombstones
+=================
+*/
+static void FlatMap_StressTest (void)
+{
+	COM_SeedRand (0);
+	const int TEST_SIZE = 10000;
+	TEMP_ALLOC (int64_t, keys, TEST_SIZE);
+	flat_map_bench_t *map = FlatMapBench_Create ();
+	for (int j = 0; j < 10; ++j)
+	{
+		for (int i = 0; i < TEST_SIZE; ++i)
+			keys[i] = i;
+		for (int i = TEST_SIZE - 1; i > 0; --i)
+		{
+			const int swap_index = COM_Rand () % (i + 1);
+			const int temp = keys[swap_index];
+			keys[swap_index] = keys[i];
+			keys[i] = temp;
+		}
+		for (int i = 0; i < TEST_SIZE; ++i)
+			FlatMapBench_Insert (map, &keys[i], &i);
+		for (int i = 0; i < TEST_SIZE; ++i)
+			HashMap_TestAssert (*FlatMapBench_Lookup (map, &keys[i]) == i, va ("Wrong lookup for %d\n", i));
+		for (int i = TEST_SIZE - 1; i >= 0; --i)
+			FlatMapBench_Erase (map, &keys[i]);
+		HashMap_TestAssert (FlatMapBench_Size (map) == 0, "Map is not empty");
+	}
+	FlatMapBench_Destroy (map);
+	TEMP_FREE (keys);
+}
+
 /*
 =================
 TestHashMap_f
@@ -382,5 +455,108 @@ void TestHashMap_f (void)
 	HashMap_BasicTest (false);
 	HashMap_BasicTest (true);
 	HashMap_StressTest ();
+	FlatMap_BasicTest (false);
+	FlatMap_BasicTest (true);
+	FlatMap_StressTest ();
 }
 #endif
+
+/*
+=================
+HashMap_Bench
+
+Throughput at a fixed number of buckets, by filling to different load factors
+(the map rehashes at 0.8), against the flat map at the same capacity
+=================
+*/
+void HashMap_Bench (void)
+{
+	static const float LOAD_FACTORS[] = {0.1f, 0.25f, 0.5f, 0.75f};
+	const int		   HASH_SIZE = 1 << 16;
+	const int		   NUM_ROUNDS = 20;
+
+	TEMP_ALLOC (int64_t, keys, HASH_SIZE);
+	for (size_t load = 0; load < countof (LOAD_FACTORS); ++load)
+	{
+		const int count = (int)(HASH_SIZE * LOAD_FACTORS[load]);
+		double	  insert_time = 0.0, hit_time = 0.0, miss_time = 0.0, erase_time = 0.0;
+		double	  flat_insert_time = 0.0, flat_hit_time = 0.0, flat_miss_time = 0.0, flat_erase_time = 0.0;
+		int		  found = 0;
+
+		COM_SeedRand (0);
+		for (int i = 0; i < count; ++i)
+			keys[i] = ((int64_t)COM_Rand () << 24) | COM_Rand ();
+
+		for (int round = 0; round < NUM_ROUNDS; ++round)
+		{
+			hash_map_t *map = HashMap_Create (int64_t, int32_t, &HashInt64, NULL);
+			HashMap_Reserve (map, (HASH_SIZE * 4) / 5);
+
+			double time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+				HashMap_Insert (map, &keys[i], &i);
+			insert_time += Sys_DoubleTime () - time;
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+				found += HashMap_Lookup (int32_t, map, &keys[i]) != NULL;
+			hit_time += Sys_DoubleTime () - time;
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+			{
+				const int64_t missing_key = ~keys[i];
+				found += HashMap_Lookup (int32_t, map, &missing_key) != NULL;
+			}
+			miss_time += Sys_DoubleTime () - time;
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+				HashMap_Erase (map, &keys[i]);
+			erase_time += Sys_DoubleTime () - time;
+
+			HashMap_Destroy (map);
+
+			flat_map_bench_t *flat_map = FlatMapBench_Create ();
+			FlatMapBench_Reserve (flat_map, (HASH_SIZE * 7) / 8);
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+				FlatMapBench_Insert (flat_map, &keys[i], &i);
+			flat_insert_time += Sys_DoubleTime () - time;
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+				found += FlatMapBench_Lookup (flat_map, &keys[i]) != NULL;
+			flat_hit_time += Sys_DoubleTime () - time;
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+			{
+				const int64_t missing_key = ~keys[i];
+				found += FlatMapBench_Lookup (flat_map, &missing_key) != NULL;
+			}
+			flat_miss_time += Sys_DoubleTime () - time;
+
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < count; ++i)
+				FlatMapBench_Erase (flat_map, &keys[i]);
+			flat_erase_time += Sys_DoubleTime () - time;
+
+			FlatMapBench_Destroy (flat_map);
+		}
+
+		const int64_t ops = (int64_t)count * NUM_ROUNDS;
+		Bench_Report (va ("hash_map insert, load %.2f", LOAD_FACTORS[load]), ops, insert_time);
+		Bench_Report (va ("hash_map lookup hit, load %.2f", LOAD_FACTORS[load]), ops, hit_time);
+		Bench_Report (va ("hash_map lookup miss, load %.2f", LOAD_FACTORS[load]), ops, miss_time);
+		Bench_Report (va ("hash_map erase, load %.2f", LOAD_FACTORS[load]), ops, erase_time);
+		Bench_Report (va ("flat_map insert, load %.2f", LOAD_FACTORS[load]), ops, flat_insert_time);
+		Bench_Report (va ("flat_map lookup hit, load %.2f", LOAD_FACTORS[load]), ops, flat_hit_time);
+		Bench_Report (va ("flat_map lookup miss, load %.2f", LOAD_FACTORS[load]), ops, flat_miss_time);
+		Bench_Report (va ("flat_map erase, load %.2f", LOAD_FACTORS[load]), ops, flat_erase_time);
+		if (found != count * NUM_ROUNDS * 2)
+			Con_Printf ("hash_map: %d lookups found the wrong result\n", abs (found - count * NUM_ROUNDS * 2));
+	}
+	TEMP_FREE (keys);
+}
@@ -102,10 +102,10 @@ static inline uint32_t HashVec3 (const void *const val)
 	return HashCombine (HashFloat (&(*vec)[0]), HashCombine (HashFloat (&(*vec)[1]), HashFloat (&(*vec)[2])));
 }
 
-// FNV-1a hash
-static inline uint32_t HashStr (const void *const val)
+// FNV-1a hash of a string stored in place, e.g. a char[MAX_QPATH] key
+static inline uint32_t HashFixedStr (const void *const val)
 {
-	const unsigned char	 *str = *(const unsigned char **)val;
+	const unsigned char	 *str = (const unsigned char *)val;
 	static const uint32_t FNV_32_PRIME = 0x01000193;
 
 	uint32_t hval = 0;
@@ -119,6 +119,17 @@ static inline uint32_t HashStr (const void *const val)
 	return hval;
 }
 
+static inline qboolean HashFixedStrCmp (const void *const a, const void *const b)
+{
+	return strcmp ((const char *)a, (const char *)b) == 0;
+}
+
+// FNV-1a hash
+static inline uint32_t HashStr (const void *const val)
+{
+	return HashFixedStr (*(const char **)val);
+}
+
 static inline qboolean HashStrCmp (const void *const a, const void *const b)
 {
 	const char *str_a = *(const char **)a;
@@ -126,6 +137,248 @@ static inline qboolean HashStrCmp (const void *const a, const void *const b)
 	return strcmp (str_a, str_b) == 0;
 }
 
+// FNV-1a hash of the ASCII lower case string, pair with HashStrCaseCmp
+static inline uint32_t HashStrCase (const void *const val)
+{
+	const unsigned char	 *str = *(const unsigned char **)val;
+	static const uint32_t FNV_32_PRIME = 0x01000193;
+
+	uint32_t hval = 0;
+	while (*str)
+	{
+		const uint32_t c = *str;
+		hval ^= (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+		hval *= FNV_32_PRIME;
+		++str;
+	}
+
+	return hval;
+}
+
+static inline qboolean HashStrCaseCmp (const void *const a, const void *const b)
+{
+	const char *str_a = *(const char **)a;
+	const char *str_b = *(const char **)b;
+	return q_strcasecmp (str_a, str_b) == 0;
+}
+
+/*
+=================
+Flat maps
+
+Open addressing variant of hash_map_t (Swiss table). Slots are split into groups of
+16 control bytes that hold the low 7 bits of the hash of full slots, or EMPTY/DELETED,
+and a whole group is compared at once. The first group is mirrored past the end so a
+group can start at any slot. DEFINE_FLAT_MAP generates a map type and functions for one
+key/value type, hasher and comparison so lookups inline everything instead of calling
+through function pointers. Keys and values are not stored densely, so there is no
+index based iteration. comp can be FlatMap_MemCmp for plain old data keys.
+=================
+*/
+#define FLAT_MAP_GROUP_SIZE 16
+#define FLAT_MAP_EMPTY		0x80
+#define FLAT_MAP_DELETED	0xFE
+
+#define FlatMap_MemCmp(a, b) (memcmp ((a), (b), sizeof (*(a))) == 0)
+
+// Bit i is set if control byte i of the group equals value
+static inline uint32_t FlatMap_MatchGroup (const byte *ctrl, const byte value)
+{
+#if defined(USE_SSE2)
+	return (uint32_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)ctrl), _mm_set1_epi8 ((char)value)));
+#elif defined(USE_NEON)
+	static const uint8_t bits[FLAT_MAP_GROUP_SIZE] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	const uint8x16_t	 matches = vandq_u8 (vceqq_u8 (vld1q_u8 (ctrl), vdupq_n_u8 (value)), vld1q_u8 (bits));
+	return (uint32_t)vaddv_u8 (vget_low_u8 (matches)) | ((uint32_t)vaddv_u8 (vget_high_u8 (matches)) << 8);
+#else
+	uint32_t matches = 0;
+	for (int i = 0; i < FLAT_MAP_GROUP_SIZE; ++i)
+		matches |= (uint32_t)(ctrl[i] == value) << i;
+	return matches;
+#endif
+}
+
+// Bit i is set if slot i of the group is EMPTY or DELETED (high bit set)
+static inline uint32_t FlatMap_MatchFree (const byte *ctrl)
+{
+#if defined(USE_SSE2)
+	return (uint32_t)_mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *)ctrl));
+#elif defined(USE_NEON)
+	static const uint8_t bits[FLAT_MAP_GROUP_SIZE] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	const uint8x16_t	 matches = vandq_u8 (vtstq_u8 (vld1q_u8 (ctrl), vdupq_n_u8 (0x80)), vld1q_u8 (bits));
+	return (uint32_t)vaddv_u8 (vget_low_u8 (matches)) | ((uint32_t)vaddv_u8 (vget_high_u8 (matches)) << 8);
+#else
+	uint32_t matches = 0;
+	for (int i = 0; i < FLAT_MAP_GROUP_SIZE; ++i)
+		matches |= (uint32_t)(ctrl[i] >> 7) << i;
+	return matches;
+#endif
+}
+
+// Smallest power of two capacity that holds count entries at a load factor of 7/8
+static inline uint32_t FlatMap_CapacityFor (uint32_t count)
+{
+	uint32_t capacity = FLAT_MAP_GROUP_SIZE;
+	while ((capacity - (capacity / 8)) < count)
+		capacity *= 2;
+	return capacity;
+}
+
+#define DEFINE_FLAT_MAP(type_name, prefix, key_type, value_type, hasher, comp)                                            \
+	typedef struct                                                                                                        \
+	{                                                                                                                     \
+		uint32_t	num_entries;                                                                                          \
+		uint32_t	growth_left;                                                                                          \
+		uint32_t	capacity_mask;                                                                                        \
+		byte	   *ctrl;                                                                                                 \
+		key_type   *keys;                                                                                                 \
+		value_type *values;                                                                                               \
+	} type_name;                                                                                                          \
+                                                                                                                          \
+	static inline type_name *prefix##_Create (void)                                                                       \
+	{                                                                                                                     \
+		return (type_name *)Mem_Alloc (sizeof (type_name));                                                               \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline void prefix##_Destroy (type_name *map)                                                                  \
+	{                                                                                                                     \
+		Mem_Free (map->ctrl);                                                                                             \
+		Mem_Free (map->keys);                                                                                             \
+		Mem_Free (map->values);                                                                                           \
+		Mem_Free (map);                                                                                                   \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline uint32_t prefix##_Size (type_name *map)                                                                 \
+	{                                                                                                                     \
+		return map->num_entries;                                                                                          \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline void prefix##_SetCtrl (type_name *map, const uint32_t index, const byte ctrl)                           \
+	{                                                                                                                     \
+		map->ctrl[index] = ctrl;                                                                                          \
+		map->ctrl[((index - FLAT_MAP_GROUP_SIZE) & map->capacity_mask) + FLAT_MAP_GROUP_SIZE] = ctrl;                     \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline uint32_t prefix##_FindFree (type_name *map, const uint32_t hash)                                        \
+	{                                                                                                                     \
+		uint32_t pos = (hash >> 7) & map->capacity_mask;                                                                  \
+		for (uint32_t step = FLAT_MAP_GROUP_SIZE;; step += FLAT_MAP_GROUP_SIZE)                                           \
+		{                                                                                                                 \
+			const uint32_t free_slots = FlatMap_MatchFree (map->ctrl + pos);                                              \
+			if (free_slots)                                                                                               \
+				return (pos + FindFirstBitNonZero (free_slots)) & map->capacity_mask;                                     \
+			pos = (pos + step) & map->capacity_mask;                                                                      \
+		}                                                                                                                 \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline uint32_t prefix##_Find (type_name *map, const key_type *const key, const uint32_t hash)                 \
+	{                                                                                                                     \
+		uint32_t pos = (hash >> 7) & map->capacity_mask;                                                                  \
+		for (uint32_t step = FLAT_MAP_GROUP_SIZE;; step += FLAT_MAP_GROUP_SIZE)                                           \
+		{                                                                                                                 \
+			const byte *group = map->ctrl + pos;                                                                          \
+			for (uint32_t matches = FlatMap_MatchGroup (group, hash & 0x7F); matches != 0; matches &= matches - 1)        \
+			{                                                                                                             \
+				const uint32_t index = (pos + FindFirstBitNonZero (matches)) & map->capacity_mask;                        \
+				if (comp (&map->keys[index], key))                                                                        \
+					return index;                                                                                         \
+			}                                                                                                             \
+			if (FlatMap_MatchGroup (group, FLAT_MAP_EMPTY))                                                               \
+				return UINT32_MAX;                                                                                        \
+			pos = (pos + step) & map->capacity_mask;                                                                      \
+		}                                                                                                                 \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline void prefix##_Rehash (type_name *map, const uint32_t capacity)                                          \
+	{                                                                                                                     \
+		const uint32_t old_capacity = map->ctrl ? (map->capacity_mask + 1) : 0;                                           \
+		byte		  *old_ctrl = map->ctrl;                                                                              \
+		key_type	  *old_keys = map->keys;                                                                              \
+		value_type	  *old_values = map->values;                                                                          \
+		map->capacity_mask = capacity - 1;                                                                                \
+		map->growth_left = capacity - (capacity / 8) - map->num_entries;                                                  \
+		map->ctrl = (byte *)Mem_AllocNonZero (capacity + FLAT_MAP_GROUP_SIZE);                                            \
+		map->keys = (key_type *)Mem_AllocNonZero (capacity * sizeof (key_type));                                          \
+		map->values = (value_type *)Mem_AllocNonZero (capacity * sizeof (value_type));                                    \
+		memset (map->ctrl, FLAT_MAP_EMPTY, capacity + FLAT_MAP_GROUP_SIZE);                                               \
+		for (uint32_t i = 0; i < old_capacity; ++i)                                                                       \
+		{                                                                                                                 \
+			if (old_ctrl[i] & 0x80)                                                                                       \
+				continue;                                                                                                 \
+			const uint32_t hash = hasher (&old_keys[i]);                                                                  \
+			const uint32_t index = prefix##_FindFree (map, hash);                                                         \
+			prefix##_SetCtrl (map, index, hash & 0x7F);                                                                   \
+			memcpy (&map->keys[index], &old_keys[i], sizeof (key_type));                                                  \
+			memcpy (&map->values[index], &old_values[i], sizeof (value_type));                                            \
+		}                                                                                                                 \
+		Mem_Free (old_ctrl);                                                                                              \
+		Mem_Free (old_keys);                                                                                              \
+		Mem_Free (old_values);                                                                                            \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline void prefix##_Reserve (type_name *map, int count)                                                       \
+	{                                                                                                                     \
+		const uint32_t capacity = FlatMap_CapacityFor (count);                                                            \
+		if (!map->ctrl || (capacity > (map->capacity_mask + 1)))                                                          \
+			prefix##_Rehash (map, capacity);                                                                              \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline value_type *prefix##_Lookup (type_name *map, const key_type *const key)                                 \
+	{                                                                                                                     \
+		if (!map->ctrl)                                                                                                   \
+			return NULL;                                                                                                  \
+		const uint32_t index = prefix##_Find (map, key, hasher (key));                                                    \
+		return (index != UINT32_MAX) ? &map->values[index] : NULL;                                                        \
+	}                                                                                                                     \
+                                                                                                                          \
+	/* Returns true if an existing value was overwritten, like HashMap_Insert */                                          \
+	static inline qboolean prefix##_Insert (type_name *map, const key_type *const key, const value_type *const value)     \
+	{                                                                                                                     \
+		const uint32_t hash = hasher (key);                                                                               \
+		uint32_t	   index = map->ctrl ? prefix##_Find (map, key, hash) : UINT32_MAX;                                   \
+		if (index != UINT32_MAX)                                                                                          \
+		{                                                                                                                 \
+			memcpy (&map->values[index], value, sizeof (value_type));                                                     \
+			return true;                                                                                                  \
+		}                                                                                                                 \
+		if (!map->ctrl)                                                                                                   \
+			prefix##_Rehash (map, FLAT_MAP_GROUP_SIZE);                                                                   \
+		index = prefix##_FindFree (map, hash);                                                                            \
+		if ((map->ctrl[index] == FLAT_MAP_EMPTY) && (map->growth_left == 0))                                              \
+		{                                                                                                                 \
+			/* Out of EMPTY slots: drop the tombstones, and only grow if they weren't worth at least half the capacity */ \
+			const uint32_t capacity = map->capacity_mask + 1;                                                             \
+			prefix##_Rehash (map, (map->num_entries < (capacity / 2)) ? capacity : (capacity * 2));                       \
+			index = prefix##_FindFree (map, hash);                                                                        \
+		}                                                                                                                 \
+		if (map->ctrl[index] == FLAT_MAP_EMPTY)                                                                           \
+			--map->growth_left;                                                                                           \
+		prefix##_SetCtrl (map, index, hash & 0x7F);                                                                       \
+		memcpy (&map->keys[index], key, sizeof (key_type));                                                               \
+		memcpy (&map->values[index], value, sizeof (value_type));                                                         \
+		++map->num_entries;                                                                                               \
+		return false;                                                                                                     \
+	}                                                                                                                     \
+                                                                                                                          \
+	static inline qboolean prefix##_Erase (type_name *map, const key_type *const key)                                     \
+	{                                                                                                                     \
+		if (!map->ctrl)                                                                                                   \
+			return false;                                                                                                 \
+		const uint32_t index = prefix##_Find (map, key, hasher (key));                                                    \
+		if (index == UINT32_MAX)                                                                                          \
+			return false;                                                                                                 \
+		prefix##_SetCtrl (map, index, FLAT_MAP_DELETED);                                                                  \
+		--map->num_entries;                                                                                               \
+		return true;                                                                                                      \
+	}
+
+#define DEFINE_FLAT_MAP_UINT32(type_name, prefix, value_type) DEFINE_FLAT_MAP (type_name, prefix, uint32_t, value_type, HashInt32, FlatMap_MemCmp)
+#define DEFINE_FLAT_MAP_PTR(type_name, prefix, value_type)	  DEFINE_FLAT_MAP (type_name, prefix, void *, value_type, HashPtr, FlatMap_MemCmp)
+#define DEFINE_FLAT_MAP_STR(type_name, prefix, value_type)	  DEFINE_FLAT_MAP (type_name, prefix, const char *, value_type, HashStr, HashStrCmp)
+// key_type must be a char array typedef, the string is copied into the map
+#define DEFINE_FLAT_MAP_FIXED_STR(type_name, prefix, key_type, value_type) \
+	DEFINE_FLAT_MAP (type_name, prefix, key_type, value_type, HashFixedStr, HashFixedStrCmp)
+
 #ifdef _DEBUG
 void TestHashMap_f (void);
 #endif
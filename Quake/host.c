@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 #include "bgmusic.h"
 #include "tasks.h"
+#include "bench.h"
 #include <setjmp.h>
 #ifdef _DEBUG
 #include "gl_heap.h"
@@ -118,6 +119,22 @@ static void UI_LuaTest_f (void)
 	UI_RunLuaTests ();
 }
 
+static void UI_TraceDump_f (void)
+{
+	UI_DumpSpikeTraces ();
+}
+
+/* ui_bench [frames] [rows] [document ...] */
+static void UI_Bench_f (void)
+{
+	const char *documents[64];
+	int			i, num_documents = 0;
+
+	for (i = 3; i < Cmd_Argc () && num_documents < (int)countof (documents); i++)
+		documents[num_documents++] = Cmd_Argv (i);
+	UI_BenchDocuments (Cmd_Argc () > 1 ? atoi (Cmd_Argv (1)) : 0, Cmd_Argc () > 2 ? atoi (Cmd_Argv (2)) : 0, documents, num_documents);
+}
+
 /* Open an RmlUI menu - sets key_dest and captures mouse */
 static void UI_Menu_f (void)
 {
@@ -359,6 +376,7 @@ cvar_t max_edicts = {"max_edicts", "32000", CVAR_NONE};		// vso -- changed from
 cvar_t cl_nocsqc = {"cl_nocsqc", "0", CVAR_NONE};			// spike -- blocks the loading of any csqc modules
 
 cvar_t sys_ticrate = {"sys_ticrate", "0.025", CVAR_NONE}; // dedicated server
+cvar_t host_threadedserver = {"host_threadedserver", "0", CVAR_ARCHIVE}; // run the single player server tick on its own thread
 cvar_t serverprofile = {"serverprofile", "0", CVAR_NONE};
 
 cvar_t fraglimit = {"fraglimit", "0", CVAR_NOTIFY | CVAR_SERVERINFO};
@@ -389,6 +407,22 @@ cvar_t sv_cheats = {"sv_cheats", "0", CVAR_NONE}; // for the 2021 rerelease
 devstats_t		dev_stats, dev_peakstats;
 overflowtimes_t dev_overflows; // this stores the last time overflow messages were displayed, not the last time overflows occured
 
+// host_threadedserver: the server tick overlaps the client frame, the main thread picks up its results with Host_FinishServerFrame
+static SDL_Thread			*sv_thread;
+static SDL_Semaphore		*sv_thread_start, *sv_thread_done, *sv_thread_resume;
+static atomic_uint32_t		 sv_thread_quit;
+static qboolean				 sv_thread_running; // main thread only
+static double				 sv_thread_frametime, sv_thread_ms;
+static int					 sv_thread_abort; // 1 = Host_Error, 2 = Host_EndGame
+static char					 sv_thread_message[1024];
+static jmp_buf				 sv_thread_abortframe;
+static THREAD_LOCAL qboolean host_serverthread;
+static void (*sv_thread_call) (void *data); // Host_CallOnMainThread
+static void	   *sv_thread_calldata;
+static qboolean sv_thread_incall, sv_thread_callfailed; // main thread only
+
+static qboolean Host_FinishServerFrame (qboolean wait, qboolean raise);
+
 /*
 ================
 Max_Edicts_f -- johnfitz
@@ -469,12 +503,23 @@ void Host_EndGame (const char *message, ...)
 	va_list argptr;
 	char	string[1024];
 
+	if (host_serverthread)
+	{
+		// unwind the tick, the main thread ends the game
+		va_start (argptr, message);
+		q_vsnprintf (sv_thread_message, sizeof (sv_thread_message), message, argptr);
+		va_end (argptr);
+		sv_thread_abort = 2;
+		longjmp (sv_thread_abortframe, 1);
+	}
+
 	va_start (argptr, message);
 	q_vsnprintf (string, sizeof (string), message, argptr);
 	va_end (argptr);
 	Con_DPrintf ("Host_EndGame: %s\n", string);
 
 	PR_SwitchQCVM (NULL);
+	Host_FinishServerFrame (true, false);
 
 	if (sv.active)
 		Host_ShutdownServer (false);
@@ -504,11 +549,22 @@ void Host_Error (const char *error, ...)
 	char			string[1024];
 	static qboolean inerror = false;
 
+	if (host_serverthread)
+	{
+		// unwind the tick, the main thread raises the error
+		va_start (argptr, error);
+		q_vsnprintf (sv_thread_message, sizeof (sv_thread_message), error, argptr);
+		va_end (argptr);
+		sv_thread_abort = 1;
+		longjmp (sv_thread_abortframe, 1);
+	}
+
 	if (inerror)
 		Sys_Error ("Host_Error: recursively entered");
 	inerror = true;
 
 	PR_SwitchQCVM (NULL);
+	Host_FinishServerFrame (true, false);
 
 	SCR_EndLoadingPlaque (); // reenable screen updates
 
@@ -612,6 +668,10 @@ Host_InitLocal
 void Host_InitLocal (void)
 {
 	Cmd_AddCommand ("version", Host_Version_f);
+	Cmd_AddCommand ("tasks_trace", Tasks_Trace_f);
+	Tasks_InitCvars ();
+	Cmd_AddCommand ("memstats", Mem_Stats_f);
+	FrameStats_Init ();
 
 	Host_InitCommands ();
 
@@ -630,6 +690,7 @@ void Host_InitLocal (void)
 	Cvar_RegisterVariable (&devstats); // johnfitz
 
 	Cvar_RegisterVariable (&sys_ticrate);
+	Cvar_RegisterVariable (&host_threadedserver);
 	Cvar_RegisterVariable (&serverprofile);
 
 	Cvar_RegisterVariable (&fraglimit);
@@ -858,9 +919,12 @@ void Host_ShutdownServer (qboolean crash)
 	byte	  message[4];
 	double	  start;
 
+	Host_WaitServerFrame ();
+
 	if (!sv.active)
 		return;
 
+	SV_DemoStop ();
 	sv.active = false;
 
 	// stop all client sounds immediately
@@ -935,6 +999,7 @@ void Host_ClearMemory (void)
 	}
 
 	Con_DPrintf ("Clearing memory\n");
+	COM_FlushFileCache ();
 	Mod_ClearAll ();
 	Sky_ClearAll ();
 	if (!isDedicated)
@@ -1037,8 +1102,10 @@ void Host_ServerFrame (void)
 	int		 i, active; // johnfitz
 	edict_t *ent;		// johnfitz
 
+	const mem_tag_t tag = Mem_SetTag (MEM_TAG_SERVER);
+
 	// run the world state
-	pr_global_struct->frametime = host_frametime;
+	pr_global_struct->frametime = sv_frametime;
 
 	// set the time and clear the general datagram
 	SV_ClearDatagram ();
@@ -1072,6 +1139,200 @@ void Host_ServerFrame (void)
 
 	// send all messages to the clients
 	SV_SendClientMessages ();
+
+	Mem_SetTag (tag);
+}
+
+/*
+==================
+Host_ServerThread
+==================
+*/
+static int Host_ServerThread (void *unused)
+{
+	host_serverthread = true;
+	SZ_Alloc (&net_message, NET_MAXMESSAGE);
+
+	for (;;)
+	{
+		SDL_WaitSemaphore (sv_thread_start);
+		if (Atomic_LoadUInt32 (&sv_thread_quit))
+			break;
+
+		const double start = Sys_DoubleTime ();
+		if (!setjmp (sv_thread_abortframe))
+		{
+			sv_frametime = sv_thread_frametime;
+			PR_SwitchQCVM (&sv.qcvm);
+			Host_ServerFrame ();
+		}
+		PR_SwitchQCVM (NULL);
+		Mem_SetTag (MEM_TAG_MISC); // in case the frame was aborted
+		sv_thread_ms = (Sys_DoubleTime () - start) * 1000;
+		SDL_SignalSemaphore (sv_thread_done);
+	}
+
+	SZ_Free (&net_message);
+	return 0;
+}
+
+/*
+==================
+Host_StartServerThread
+==================
+*/
+static void Host_StartServerThread (void)
+{
+	sv_thread_start = SDL_CreateSemaphore (0);
+	sv_thread_done = SDL_CreateSemaphore (0);
+	sv_thread_resume = SDL_CreateSemaphore (0);
+	Atomic_StoreUInt32 (&sv_thread_quit, 0);
+	sv_thread = SDL_CreateThread (Host_ServerThread, "Server", NULL);
+	if (!sv_thread)
+		Con_Printf ("Couldn't create the server thread, host_threadedserver is unavailable\n");
+}
+
+/*
+==================
+Host_StopServerThread
+==================
+*/
+static void Host_StopServerThread (void)
+{
+	if (!sv_thread || host_serverthread)
+		return; // Sys_Error on the server thread
+
+	Host_WaitServerFrame ();
+	Atomic_StoreUInt32 (&sv_thread_quit, 1);
+	SDL_SignalSemaphore (sv_thread_start);
+	SDL_WaitThread (sv_thread, NULL);
+	sv_thread = NULL;
+	SDL_DestroySemaphore (sv_thread_start);
+	SDL_DestroySemaphore (sv_thread_done);
+	SDL_DestroySemaphore (sv_thread_resume);
+}
+
+/*
+==================
+Host_ServerThreaded
+
+Only a plain single player game, csqc shares SV_Physics with the server
+==================
+*/
+static qboolean Host_ServerThreaded (void)
+{
+	return sv_thread && host_threadedserver.value && !isDedicated && sv.active && svs.maxclients == 1 && !listening && cls.state == ca_connected &&
+		   cls.signon == SIGNONS && host_netinterval && !cls.timedemo && !cl.qcvm.progs;
+}
+
+/*
+==================
+Host_FinishServerFrame
+
+Returns false if the tick is still running and wait is false. Runs the calls
+the tick needs on the main thread, raise forwards the errors of the tick.
+==================
+*/
+static qboolean Host_FinishServerFrame (qboolean wait, qboolean raise)
+{
+	if (!sv_thread_running || host_serverthread)
+		return true;
+
+	if (sv_thread_incall)
+	{
+		// the call errored out, abort the tick that is waiting for it
+		sv_thread_incall = false;
+		sv_thread_callfailed = true;
+		SDL_SignalSemaphore (sv_thread_resume);
+	}
+
+	for (;;)
+	{
+		if (wait)
+			SDL_WaitSemaphore (sv_thread_done);
+		else if (!SDL_TryWaitSemaphore (sv_thread_done))
+			return false;
+		if (!sv_thread_call)
+			break;
+
+		void (*func) (void *data) = sv_thread_call;
+		sv_thread_call = NULL;
+		sv_thread_incall = true;
+		func (sv_thread_calldata);
+		sv_thread_incall = false;
+		SDL_SignalSemaphore (sv_thread_resume);
+	}
+
+	sv_thread_running = false;
+	Cbuf_Waited ();
+	FrameStats_Current ()->server_ms += sv_thread_ms;
+
+	const int abort = sv_thread_abort;
+	sv_thread_abort = 0;
+	if (raise && abort == 1)
+		Host_Error ("%s", sv_thread_message);
+	else if (raise && abort == 2)
+		Host_EndGame ("%s", sv_thread_message);
+
+	return true;
+}
+
+/*
+==================
+Host_WaitServerFrame
+
+Everything that touches the server from the main thread waits for the tick first
+==================
+*/
+void Host_WaitServerFrame (void)
+{
+	Host_FinishServerFrame (true, false);
+}
+
+/*
+==================
+Host_ServerFrameRunning
+==================
+*/
+qboolean Host_ServerFrameRunning (void)
+{
+	return sv_thread_running;
+}
+
+/*
+==================
+Host_IsServerThread
+==================
+*/
+qboolean Host_IsServerThread (void)
+{
+	return host_serverthread;
+}
+
+/*
+==================
+Host_CallOnMainThread
+
+The tick blocks until the main thread ran func, for what is not safe to do beside the client
+==================
+*/
+void Host_CallOnMainThread (void (*func) (void *data), void *data)
+{
+	if (!host_serverthread)
+	{
+		func (data);
+		return;
+	}
+
+	sv_thread_call = func;
+	sv_thread_calldata = data;
+	SDL_SignalSemaphore (sv_thread_done);
+	SDL_WaitSemaphore (sv_thread_resume);
+	if (sv_thread_callfailed)
+	{
+		sv_thread_callfailed = false;
+		longjmp (sv_thread_abortframe, 1);
+	}
 }
 
 static void CL_LoadCSProgs (void)
@@ -1154,13 +1415,14 @@ Runs all active servers
 void _Host_Frame (double time)
 {
 	static double accumtime = 0;
-	static double time1 = 0;
-	static double time2 = 0;
-	static double time3 = 0;
+	double		  time1, time2, time3, time4;
 	double		  pass1, pass2, pass3;
 
 	if (setjmp (host_abortserver))
-		return; // something bad happened, or the server disconnected
+	{
+		Mem_SetTag (MEM_TAG_MISC); // the error may have unwound a tagged scope
+		return;					   // something bad happened, or the server disconnected
+	}
 
 	// keep the random time dependent
 	COM_Rand ();
@@ -1170,8 +1432,15 @@ void _Host_Frame (double time)
 	if (!Host_FilterTime (time))
 		return; // don't run too fast, or packets will flood out
 
-	if (host_speeds.value)
-		time3 = Sys_DoubleTime ();
+	Mem_FrameReset ();
+	frame_stats_t *stats = FrameStats_BeginFrame ();
+
+	// a threaded server tick that is still running holds off everything touching the server
+	const qboolean server_busy = !Host_FinishServerFrame (false, true);
+
+	// vid_lowlatency samples the input as late as the display allows
+	const qboolean paced = !isDedicated && VID_PaceFrame ();
+	time3 = Sys_DoubleTime ();
 
 	if (!isDedicated)
 	{
@@ -1187,8 +1456,12 @@ void _Host_Frame (double time)
 	// check the stdin for commands (dedicated servers)
 	Host_GetConsoleCommands ();
 
+	// report a binary save once its task wrote it
+	SV_FinishSave (false);
+
 	// process console commands
-	Cbuf_Execute ();
+	if (!server_busy)
+		Cbuf_Execute ();
 
 	NET_Poll ();
 
@@ -1205,8 +1478,11 @@ void _Host_Frame (double time)
 	CL_AccumulateCmd ();
 	M_UpdateMouse ();
 
+	time4 = Sys_DoubleTime ();
+	stats->input_ms = (time4 - time3) * 1000;
+
 	// Run the server+networking (client->server->client), at a different rate from everyt
-	while ((host_netinterval == 0) || (accumtime >= host_netinterval))
+	while (!server_busy && ((host_netinterval == 0) || (accumtime >= host_netinterval)))
 	{
 		double realframetime = host_frametime;
 		if (host_netinterval && isDedicated == 0)
@@ -1235,11 +1511,23 @@ void _Host_Frame (double time)
 		}
 
 		CL_SendCmd ();
-		if (sv.active)
+		if (Host_ServerThreaded ())
+		{
+			// the tick runs beside the rendering below, the client reads its messages next frame
+			sv_thread_frametime = host_frametime;
+			sv_thread_running = true;
+			SDL_SignalSemaphore (sv_thread_start);
+			host_frametime = realframetime;
+			break;
+		}
+		else if (sv.active)
 		{
+			const double server_start = Sys_DoubleTime ();
+			sv_frametime = host_frametime;
 			PR_SwitchQCVM (&sv.qcvm);
 			Host_ServerFrame ();
 			PR_SwitchQCVM (NULL);
+			stats->server_ms += (Sys_DoubleTime () - server_start) * 1000;
 		}
 		host_frametime = realframetime;
 		Cbuf_Waited ();
@@ -1251,6 +1539,7 @@ void _Host_Frame (double time)
 	if (cl.qcvm.progs)
 	{
 		PR_SwitchQCVM (&cl.qcvm);
+		sv_frametime = host_frametime;
 		pr_global_struct->frametime = host_frametime;
 		SV_Physics ();
 		PR_SwitchQCVM (NULL);
@@ -1258,22 +1547,29 @@ void _Host_Frame (double time)
 
 	// fetch results from server
 	if (cls.state == ca_connected)
+	{
+		const double parse_start = Sys_DoubleTime ();
 		CL_ReadFromServer ();
+		stats->client_parse_ms = (Sys_DoubleTime () - parse_start) * 1000;
+	}
 
 #ifdef USE_RMLUI
 	UI_TickStartup ();
 #endif
 
 	// update video
-	if (host_speeds.value)
-		time1 = Sys_DoubleTime ();
+	time1 = Sys_DoubleTime ();
 
-	SCR_UpdateScreen (true);
+	// pick up the mouse motion that arrived during the server frame, it goes out with the next command
+	if (paced && (cls.signon == SIGNONS))
+	{
+		Sys_SendKeyEvents ();
+		IN_MouseMove (&cl.pendingcmd);
+	}
 
-	CL_RunParticles (); // johnfitz -- seperated from rendering
+	SCR_UpdateScreen (true);
 
-	if (host_speeds.value)
-		time2 = Sys_DoubleTime ();
+	time2 = Sys_DoubleTime ();
 
 	// update audio
 	BGM_Update (); // adds music raw samples and/or advances midi driver
@@ -1287,14 +1583,19 @@ void _Host_Frame (double time)
 
 	CDAudio_Update ();
 
+	pass1 = (time1 - time3) * 1000;
+	time3 = Sys_DoubleTime ();
+	pass2 = (time2 - time1) * 1000;
+	pass3 = (time3 - time2) * 1000;
 	if (host_speeds.value)
-	{
-		pass1 = (time1 - time3) * 1000;
-		time3 = Sys_DoubleTime ();
-		pass2 = (time2 - time1) * 1000;
-		pass3 = (time3 - time2) * 1000;
 		Con_Printf ("%5.2f tot %5.2f server %5.2f gfx %5.2f snd\n", pass1 + pass2 + pass3, pass1, pass2, pass3);
-	}
+
+	stats->host_ms = pass1 + pass2 + pass3;
+	stats->render_ms = pass2;
+	stats->sound_ms = pass3;
+	FrameStats_EndFrame ();
+
+	Tasks_TraceFrame ();
 
 	host_framecount++;
 }
@@ -1349,6 +1650,62 @@ static void Tests_Init ()
 #endif
 }
 
+// -startupprofile timeline of Host_Init
+#define MAX_STARTUP_STEPS 64
+
+typedef struct
+{
+	const char *name;
+	double		start;
+	double		duration;
+} startup_step_t;
+
+static startup_step_t startup_steps[MAX_STARTUP_STEPS];
+static int			  num_startup_steps;
+
+#define STARTUP(call)                                        \
+	do                                                       \
+	{                                                        \
+		const double startup_step_start = Sys_DoubleTime (); \
+		call;                                                \
+		Host_StartupStep (#call, startup_step_start);        \
+	} while (0)
+
+/*
+====================
+Host_StartupStep
+====================
+*/
+static void Host_StartupStep (const char *name, double start)
+{
+	if (num_startup_steps == MAX_STARTUP_STEPS)
+		return;
+	startup_steps[num_startup_steps].name = name;
+	startup_steps[num_startup_steps].start = start;
+	startup_steps[num_startup_steps].duration = Sys_DoubleTime () - start;
+	++num_startup_steps;
+}
+
+/*
+====================
+Host_PrintStartupProfile
+====================
+*/
+static void Host_PrintStartupProfile (double begin)
+{
+	int i;
+
+	Con_Printf ("\nStartup profile:\n");
+	Con_Printf ("   start    time  step\n");
+	for (i = 0; i < num_startup_steps; ++i)
+	{
+		const startup_step_t *step = &startup_steps[i];
+		Con_Printf (
+			"%8.1f %7.1f  %.*s\n", (step->start - begin) * 1000.0, step->duration * 1000.0, (int)strcspn (step->name, " ("), step->name);
+	}
+	Con_Printf ("   total %7.1f ms\n\n", (Sys_DoubleTime () - begin) * 1000.0);
+}
+
 /*
 ====================
 Host_Init
@@ -1356,28 +1713,31 @@ Host_Init
 */
 void Host_Init (void)
 {
+	const double startup_begin = Sys_DoubleTime ();
+
 	com_argc = host_parms->argc;
 	com_argv = host_parms->argv;
 
-	Mem_Init ();
-	Tasks_Init ();
-	Cbuf_Init ();
-	Cmd_Init ();
-	LOG_Init (host_parms);
-	Cvar_Init (); // johnfitz
-	COM_Init ();
-	COM_InitFilesystem ();
-	Host_InitLocal ();
-	W_LoadWadFile (); // johnfitz -- filename is now hard-coded for honesty
+	STARTUP (Mem_Init ());
+	STARTUP (Tasks_Init ());
+	STARTUP (Cbuf_Init ());
+	STARTUP (Cmd_Init ());
+	STARTUP (LOG_Init (host_parms));
+	STARTUP (Cvar_Init ()); // johnfitz
+	STARTUP (COM_Init ());
+	STARTUP (COM_InitFilesystem ());
+	STARTUP (Host_InitLocal ());
+	STARTUP (W_LoadWadFile ()); // johnfitz -- filename is now hard-coded for honesty
 	if (cls.state != ca_dedicated)
 	{
-		Key_Init ();
-		Con_Init ();
+		STARTUP (Key_Init ());
+		STARTUP (Con_Init ());
 	}
-	PR_Init ();
-	Mod_Init ();
-	NET_Init ();
-	SV_Init ();
+	STARTUP (PR_Init ());
+	STARTUP (Mod_Init ());
+	STARTUP (NET_Init ());
+	STARTUP (SV_Init ());
+	STARTUP (Bench_Init ());
 
 	Con_Printf ("Exe: " __TIME__ " " __DATE__ "\n");
 
@@ -1387,17 +1747,17 @@ void Host_Init (void)
 		if (!host_colormap)
 			Sys_Error ("Couldn't load gfx/colormap.lmp");
 
-		V_Init ();
-		Chase_Init ();
-		M_Init ();
-		ExtraMaps_Init (); // johnfitz
-		Modlist_Init ();   // johnfitz
-		DemoList_Init ();  // ericw
-		SaveList_Init ();
+		STARTUP (V_Init ());
+		STARTUP (Chase_Init ());
+		STARTUP (M_Init ());
+		STARTUP (ExtraMaps_Init ()); // johnfitz
+		STARTUP (Modlist_Init ());	 // johnfitz
+		STARTUP (DemoList_Init ());	 // ericw
+		STARTUP (SaveList_Init ());
 #ifdef USE_RMLUI
 		/* Initialize RmlUI core BEFORE VID_Init so the render interface exists
 		 * when UI_InitializeVulkan is called from GL_InitDevice */
-		UI_Init (1280, 720, com_basedir); /* Initial size, will resize after VID_Init */
+		STARTUP (UI_Init (1280, 720, com_basedir)); /* Initial size, will resize after VID_Init */
 		/* Register cvars and console commands for RmlUI */
 		Cvar_SetCallback (&ui_use_rmlui, UI_UseRmluiChanged_f);
 		Cvar_RegisterVariable (&ui_use_rmlui);
@@ -1412,33 +1772,40 @@ void Host_Init (void)
 		Cmd_AddCommand ("ui_reload", UI_Reload_f);
 		Cmd_AddCommand ("ui_reload_css", UI_ReloadCSS_f);
 		Cmd_AddCommand ("lua_test", UI_LuaTest_f);
+		Cmd_AddCommand ("ui_trace_dump", UI_TraceDump_f);
+		Cmd_AddCommand ("ui_bench", UI_Bench_f);
 		ui_startup.phase = STARTUP_AUTO_DETECT;
 		ui_startup.auto_detect_after = realtime + UI_AUTO_MENU_DELAY;
 #endif
-		VID_Init ();
+		STARTUP (VID_Init ());
 #ifdef USE_RMLUI
 		/* Resize RmlUI context to actual window size */
 		UI_Resize (vid.width, vid.height);
 #endif
-		IN_Init ();
-		TexMgr_Init (); // johnfitz
-		Draw_Init ();
-		SCR_Init ();
-		R_Init ();
-		S_Init ();
-		CDAudio_Init ();
-		BGM_Init ();
-		Sbar_Init ();
-		CL_Init ();
+		STARTUP (IN_Init ());
+		// the audio device opens on a worker while the renderer starts up
+		STARTUP (S_Init ());
+		STARTUP (TexMgr_Init ()); // johnfitz
+		STARTUP (Draw_Init ());
+		STARTUP (SCR_Init ());
+		STARTUP (R_Init ());
+		STARTUP (S_FinishInit ());
+		STARTUP (CDAudio_Init ());
+		STARTUP (BGM_Init ());
+		STARTUP (Sbar_Init ());
+		STARTUP (CL_Init ());
 		Tests_Init ();
+		STARTUP (Host_StartServerThread ());
 	}
 
 #ifdef PSET_SCRIPT
-	PScript_InitParticles ();
+	STARTUP (PScript_InitParticles ());
 #endif
-	LOC_Init (); // for 2021 rerelease support.
+	STARTUP (LOC_Init ()); // for 2021 rerelease support.
 
 	host_initialized = true;
+	if (COM_CheckParm ("-startupprofile"))
+		Host_PrintStartupProfile (startup_begin);
 	Con_Printf ("\n========= Quake Initialized =========\n\n");
 
 	if (cls.state != ca_dedicated)
@@ -1482,6 +1849,9 @@ void Host_Shutdown (void)
 	// keep Con_Printf from trying to update the screen
 	scr_disabled_for_loading = true;
 
+	Host_StopServerThread ();
+	SV_FinishSave (true);
+
 	Host_WriteConfiguration ();
 
 	NET_Shutdown ();
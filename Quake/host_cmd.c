@@ -1088,123 +1088,318 @@ LOAD / SAVE GAME
 
 /*
 ===============
-Host_SavegameComment
+Save index
 
-Writes a SAVEGAME_COMMENT_LENGTH character comment describing the current
+The save menus show the comment of every slot. Instead of reading them from each save every time a
+menu opens they are kept in a saves.idx next to the saves, with the file time of the save they were
+read from. An entry is only read again from its save once that time changed, saving updates it.
 ===============
 */
-static void Host_SavegameComment (char text[SAVEGAME_COMMENT_LENGTH + 1])
+
+#define SAVEINDEX_NAME	  "saves.idx"
+#define SAVEINDEX_VERSION 1
+
+typedef struct
 {
-	int	 i;
-	char kills[20];
+	char		dir[MAX_OSPATH];
+	saveinfo_t *entries; // VEC
+	qboolean	dirty;
+} saveindex_t;
 
-	for (i = 0; i < SAVEGAME_COMMENT_LENGTH; i++)
-		text[i] = ' ';
-	text[SAVEGAME_COMMENT_LENGTH] = '\0';
+static saveindex_t *saveindexes; // VEC, one per save directory
 
-	// Remove CR/LFs from level name to avoid broken saves, e.g. with autumn_sp map:
-	// sanitize Level name:
-	char cleanname[sizeof (cl.levelname)];
-	COM_SanitizeDescriptionString (cleanname, sizeof (cleanname), cl.levelname, true);
+/*
+===============
+SaveIndex_ForPath
 
-	i = (int)strlen (cleanname);
-	if (i > 22)
-		i = 22;
-	memcpy (text, cleanname, (size_t)i);
+Returns the index of the directory of path, loaded from its saves.idx the first time
+===============
+*/
+static saveindex_t *SaveIndex_ForPath (const char *path, const char **name)
+{
+	char		dir[MAX_OSPATH];
+	const char *c;
+	size_t		i;
+
+	*name = path;
+	for (c = path; *c; c++)
+		if (*c == '/' || *c == '\\')
+			*name = c + 1;
+	if (*name == path)
+		q_strlcpy (dir, ".", sizeof (dir));
+	else
+		q_strlcpy (dir, path, q_min (sizeof (dir), (size_t)(*name - path)));
 
-	sprintf (kills, "kills:%3i/%3i", cl.stats[STAT_MONSTERS], cl.stats[STAT_TOTALMONSTERS]);
-	memcpy (text + 22, kills, strlen (kills));
+	for (i = 0; i < VEC_SIZE (saveindexes); i++)
+	{
+		if (!strcmp (saveindexes[i].dir, dir))
+			return &saveindexes[i];
+	}
 
-	// convert space to _ to make stdio happy
-	for (i = 0; i < SAVEGAME_COMMENT_LENGTH; i++)
+	saveindex_t index;
+	memset (&index, 0, sizeof (index));
+	q_strlcpy (index.dir, dir, sizeof (index.dir));
+
+	char index_path[MAX_OSPATH];
+	q_snprintf (index_path, sizeof (index_path), "%s/%s", dir, SAVEINDEX_NAME);
+	FILE *f = fopen (index_path, "r");
+	if (f)
 	{
-		if (text[i] == ' ')
-			text[i] = '_';
+		saveinfo_t info;
+		long long  mtime;
+		int		   version;
+		memset (&info, 0, sizeof (info));
+		if (fscanf (f, "%i\n", &version) == 1 && version == SAVEINDEX_VERSION)
+		{
+			while (fscanf (f, "%63s %lld %39s %63s %lf\n", info.name, &mtime, info.comment, info.mapname, &info.time) == 5)
+			{
+				info.mtime = mtime;
+				if (!strcmp (info.mapname, "-"))
+					info.mapname[0] = 0;
+				VEC_PUSH (index.entries, info);
+			}
+		}
+		fclose (f);
 	}
+
+	VEC_PUSH (saveindexes, index);
+	return &saveindexes[VEC_SIZE (saveindexes) - 1];
 }
 
 /*
 ===============
-Host_Savegame_f
+SaveIndex_Find
 ===============
 */
-static void Host_Savegame_f (void)
+static saveinfo_t *SaveIndex_Find (saveindex_t *index, const char *name)
 {
-	char  name[MAX_OSPATH];
-	FILE *f;
-	int	  i;
-	char  comment[SAVEGAME_COMMENT_LENGTH + 1];
-
-	if (cmd_source != src_command)
-		return;
-
-	if (!sv.active)
+	for (size_t i = 0; i < VEC_SIZE (index->entries); i++)
 	{
-		Con_Printf ("Not playing a local game.\n");
-		return;
+		if (!strcmp (index->entries[i].name, name))
+			return &index->entries[i];
 	}
+	return NULL;
+}
 
-	if (sv.nomonsters)
+/*
+===============
+SaveIndex_Remove
+===============
+*/
+static void SaveIndex_Remove (saveindex_t *index, saveinfo_t *info)
+{
+	*info = index->entries[VEC_SIZE (index->entries) - 1];
+	VEC_HEADER (index->entries).size--;
+	index->dirty = true;
+}
+
+/*
+===============
+SaveIndex_ReadSave
+
+Reads the comment, map and time of a text or binary save
+===============
+*/
+static qboolean SaveIndex_ReadSave (const char *path, saveinfo_t *info)
+{
+	char  comment[80];
+	int	  version, i;
+	float value;
+
+	FILE *f = fopen (path, "r");
+	if (!f)
+		return false;
+	if (fscanf (f, "%i\n", &version) != 1 || fscanf (f, "%79s\n", comment) != 1)
 	{
-		Con_Printf ("Can't save when using \"nomonsters\".\n");
-		return;
+		fclose (f);
+		return false;
 	}
+	q_strlcpy (info->comment, comment, sizeof (info->comment));
+	info->mapname[0] = 0;
+	info->time = 0.0;
 
-	if (cl.intermission)
+	if (version == SAVEGAME_VERSION)
 	{
-		Con_Printf ("Can't save in intermission.\n");
-		return;
+		// the spawn parms and the skill come first
+		for (i = 0; i < NUM_BASIC_SPAWN_PARMS + 1 && fscanf (f, "%f\n", &value) == 1; i++)
+			;
+		if (i == NUM_BASIC_SPAWN_PARMS + 1 && fscanf (f, "%63s\n", info->mapname) == 1 && fscanf (f, "%f\n", &value) == 1)
+			info->time = value;
 	}
+	fclose (f);
 
-	if (svs.maxclients != 1)
+	if (version != SAVEGAME_VERSION)
+		SV_BinarySaveInfo (path, info->mapname, &info->time);
+	return true;
+}
+
+/*
+===============
+SaveList_GetInfo
+
+Returns the metadata of the save at path, NULL if it's missing or unreadable.
+Only valid until the next SaveList_GetInfo or SaveList_UpdateInfo.
+===============
+*/
+const saveinfo_t *SaveList_GetInfo (const char *path)
+{
+	const char	*name;
+	saveindex_t *index = SaveIndex_ForPath (path, &name);
+	saveinfo_t	*info = SaveIndex_Find (index, name);
+	int64_t		 mtime = Sys_FileTime (path);
+
+	if (info && mtime != -1 && info->mtime == mtime)
+		return info;
+
+	saveinfo_t read;
+	memset (&read, 0, sizeof (read));
+	if (mtime == -1 || !SaveIndex_ReadSave (path, &read))
 	{
-		Con_Printf ("Can't save multiplayer games.\n");
-		return;
+		if (info)
+			SaveIndex_Remove (index, info);
+		return NULL;
 	}
+	q_strlcpy (read.name, name, sizeof (read.name));
+	read.mtime = mtime;
 
-	if (Cmd_Argc () != 2)
+	if (!info)
 	{
-		Con_Printf ("save <savename> : save a game\n");
-		return;
+		VEC_PUSH (index->entries, read);
+		info = &index->entries[VEC_SIZE (index->entries) - 1];
 	}
+	else
+		*info = read;
+	index->dirty = true;
+	return info;
+}
 
-	if (strstr (Cmd_Argv (1), ".."))
+/*
+===============
+SaveList_UpdateInfo
+
+Records a save that was just written
+===============
+*/
+void SaveList_UpdateInfo (const char *path, const char *comment, const char *mapname, double time)
+{
+	const char	*name;
+	saveindex_t *index = SaveIndex_ForPath (path, &name);
+	saveinfo_t	*info = SaveIndex_Find (index, name);
+
+	if (!info)
 	{
-		Con_Printf ("Relative pathnames are not allowed.\n");
-		return;
+		saveinfo_t new_info;
+		memset (&new_info, 0, sizeof (new_info));
+		q_strlcpy (new_info.name, name, sizeof (new_info.name));
+		VEC_PUSH (index->entries, new_info);
+		info = &index->entries[VEC_SIZE (index->entries) - 1];
 	}
+	info->mtime = Sys_FileTime (path);
+	q_strlcpy (info->comment, comment, sizeof (info->comment));
+	q_strlcpy (info->mapname, mapname, sizeof (info->mapname));
+	info->time = time;
+	index->dirty = true;
 
-	for (i = 0; i < svs.maxclients; i++)
+	SaveList_WriteIndex ();
+}
+
+/*
+===============
+SaveList_WriteIndex
+
+Writes the saves.idx of every directory whose entries changed
+===============
+*/
+void SaveList_WriteIndex (void)
+{
+	char path[MAX_OSPATH];
+	char temp_path[MAX_OSPATH];
+
+	for (size_t i = 0; i < VEC_SIZE (saveindexes); i++)
 	{
-		if (svs.clients[i].active && (svs.clients[i].edict->v.health <= 0))
+		saveindex_t *index = &saveindexes[i];
+		if (!index->dirty)
+			continue;
+		index->dirty = false;
+
+		q_snprintf (path, sizeof (path), "%s/%s", index->dir, SAVEINDEX_NAME);
+		q_snprintf (temp_path, sizeof (temp_path), "%s.tmp", path);
+		FILE *f = fopen (temp_path, "w");
+		if (!f)
+			continue;
+
+		fprintf (f, "%i\n", SAVEINDEX_VERSION);
+		for (size_t j = 0; j < VEC_SIZE (index->entries); j++)
 		{
-			Con_Printf ("Can't savegame with a dead player\n");
-			return;
+			const saveinfo_t *info = &index->entries[j];
+			// the fields are whitespace separated, such names are simply read from their save every time
+			if (strpbrk (info->name, " \t\r\n") || !info->comment[0] || strpbrk (info->comment, " \t\r\n") || strpbrk (info->mapname, " \t\r\n"))
+				continue;
+			fprintf (f, "%s %lld %s %s %f\n", info->name, (long long)info->mtime, info->comment, info->mapname[0] ? info->mapname : "-", info->time);
 		}
+		const qboolean written = !ferror (f);
+		fclose (f);
+		remove (path);
+		if (!written || rename (temp_path, path) != 0)
+			remove (temp_path);
 	}
+}
 
-	if (multiuser)
+/*
+===============
+Host_SavegameComment
+
+Writes a SAVEGAME_COMMENT_LENGTH character comment describing the current
+===============
+*/
+static void Host_SavegameComment (char text[SAVEGAME_COMMENT_LENGTH + 1])
+{
+	int	 i;
+	char kills[20];
+
+	for (i = 0; i < SAVEGAME_COMMENT_LENGTH; i++)
+		text[i] = ' ';
+	text[SAVEGAME_COMMENT_LENGTH] = '\0';
+
+	// Remove CR/LFs from level name to avoid broken saves, e.g. with autumn_sp map:
+	// sanitize Level name:
+	char cleanname[sizeof (cl.levelname)];
+	COM_SanitizeDescriptionString (cleanname, sizeof (cleanname), cl.levelname, true);
+
+	i = (int)strlen (cleanname);
+	if (i > 22)
+		i = 22;
+	memcpy (text, cleanname, (size_t)i);
+
+	sprintf (kills, "kills:%3i/%3i", cl.stats[STAT_MONSTERS], cl.stats[STAT_TOTALMONSTERS]);
+	memcpy (text + 22, kills, strlen (kills));
+
+	// convert space to _ to make stdio happy
+	for (i = 0; i < SAVEGAME_COMMENT_LENGTH; i++)
 	{
-		char *save_path = SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true));
-		q_snprintf (name, sizeof (name), "%s%s", save_path, Cmd_Argv (1));
-		SDL_free (save_path);
+		if (text[i] == ' ')
+			text[i] = '_';
 	}
-	else
-		q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argv (1));
-	COM_AddExtension (name, ".sav", sizeof (name));
+}
+
+/*
+===============
+Host_WriteTextSave
+===============
+*/
+static qboolean Host_WriteTextSave (const char *name, const char *comment)
+{
+	FILE *f;
+	int	  i;
 
-	Con_Printf ("Saving game to %s...\n", name);
 	f = fopen (name, "w");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
-		return;
+		return false;
 	}
 
-	PR_SwitchQCVM (&sv.qcvm);
-
 	fprintf (f, "%i\n", SAVEGAME_VERSION);
-	Host_SavegameComment (comment);
 	fprintf (f, "%s\n", comment);
 	for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
 		fprintf (f, "%f\n", svs.clients->spawn_parms[i]);
@@ -1274,13 +1469,98 @@ static void Host_Savegame_f (void)
 	fclose (f);
 
 	Con_Printf ("done.\n");
+	SaveList_UpdateInfo (name, comment, sv.name, qcvm->time);
+	SaveList_Rebuild ();
+	return true;
+}
+
+/*
+===============
+Host_Savegame_f
+===============
+*/
+static void Host_Savegame_f (void)
+{
+	char name[MAX_OSPATH];
+	int	 i;
+	char comment[SAVEGAME_COMMENT_LENGTH + 1];
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not playing a local game.\n");
+		return;
+	}
+
+	if (sv.nomonsters)
+	{
+		Con_Printf ("Can't save when using \"nomonsters\".\n");
+		return;
+	}
+
+	if (cl.intermission)
+	{
+		Con_Printf ("Can't save in intermission.\n");
+		return;
+	}
+
+	if (svs.maxclients != 1)
+	{
+		Con_Printf ("Can't save multiplayer games.\n");
+		return;
+	}
+
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("save <savename> : save a game\n");
+		return;
+	}
+
+	if (strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	for (i = 0; i < svs.maxclients; i++)
+	{
+		if (svs.clients[i].active && (svs.clients[i].edict->v.health <= 0))
+		{
+			Con_Printf ("Can't savegame with a dead player\n");
+			return;
+		}
+	}
+
+	if (multiuser)
+	{
+		char *save_path = SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true));
+		q_snprintf (name, sizeof (name), "%s%s", save_path, Cmd_Argv (1));
+		SDL_free (save_path);
+	}
+	else
+		q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argv (1));
+	COM_AddExtension (name, ".sav", sizeof (name));
+
+	Con_Printf ("Saving game to %s...\n", name);
+
+	PR_SwitchQCVM (&sv.qcvm);
+
+	Host_SavegameComment (comment);
+	if (sv_savebinary.value)
+		SV_WriteBinarySave (name, comment); // "done." once the task has written it
+	else if (!Host_WriteTextSave (name, comment))
+	{
+		PR_SwitchQCVM (NULL);
+		return;
+	}
 
 	// Take the occasion to rebuild the free list
 	// since saving is a long operation anyway
 	ED_RebuildFreeList (false);
 
 	PR_SwitchQCVM (NULL);
-	SaveList_Rebuild ();
 
 	if (strlen (Cmd_Argv (1)) < sizeof (sv.lastsave) - 1)
 		strcpy (sv.lastsave, Cmd_Argv (1));
@@ -1366,154 +1646,16 @@ static void Send_Spawn_Info (client_t *c, qboolean loadgame)
 
 /*
 ===============
-Host_Loadgame_f
+Host_LoadTextSave
+
+Reads the light styles, globals and edicts following the header of a text save, returns the number of edicts
 ===============
 */
-static void Host_Loadgame_f (void)
+static int Host_LoadTextSave (const char *data, float spawn_parms[NUM_TOTAL_SPAWN_PARMS], qboolean fastload)
 {
-	static char *start;
-
-	char		name[MAX_OSPATH];
-	char		mapname[MAX_QPATH];
-	float		time, tfloat;
-	const char *data;
-	int			i;
-	edict_t	   *ent;
-	int			entnum;
-	int			version;
-	float		spawn_parms[NUM_TOTAL_SPAWN_PARMS];
-	qboolean	was_recording = cls.demorecording;
-	int			old_skill = current_skill;
-	qboolean	fastload = !!strstr (Cmd_Argv (0), "fast") || autofastload.value;
-
-	if (cmd_source != src_command)
-		return;
-
-	if (Cmd_Argc () != 2)
-	{
-		Con_Printf ("%s <savename> : load a game\n", Cmd_Argv (0));
-		return;
-	}
-
-	if (strstr (Cmd_Argv (1), ".."))
-	{
-		Con_Printf ("Relative pathnames are not allowed.\n");
-		return;
-	}
-
-	if (nomonsters.value)
-	{
-		Con_Warning ("\"%s\" disabled automatically.\n", nomonsters.name);
-		Cvar_SetValueQuick (&nomonsters, 0.f);
-	}
-
-	cls.demonum = -1; // stop demo loop in case this fails
-
-	char	*save_path = multiuser ? SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true)) : NULL;
-	qboolean loadable = false;
-	for (int j = (multiuser ? 0 : 1); j < 2; ++j)
-	{
-		if (j == 0)
-			q_snprintf (name, sizeof (name), "%s%s", save_path, Cmd_Argv (1));
-		else
-			q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argv (1));
-		COM_AddExtension (name, ".sav", sizeof (name));
-
-		// avoid leaking if the previous Host_Loadgame_f failed with a Host_Error
-		if (start != NULL)
-			Mem_Free (start);
-
-		start = (char *)COM_LoadMallocFile_TextMode_OSPath (name, NULL);
-		if (start)
-		{
-			loadable = true;
-			break;
-		}
-	}
-	SDL_free (save_path);
-
-	if (!loadable)
-	{
-		SCR_EndLoadingPlaque ();
-		Con_Printf ("ERROR: couldn't open.\n");
-		return;
-	}
-
-	// we can't call SCR_BeginLoadingPlaque, because too much stack space has
-	// been used.  The menu calls it before stuffing loadgame command
-	//	SCR_BeginLoadingPlaque ();
-
-	Con_Printf ("Loading game from %s...\n", name);
-
-	data = start;
-	data = COM_ParseIntNewline (data, &version);
-	if (version != SAVEGAME_VERSION)
-	{
-		Mem_Free (start);
-		start = NULL;
-		Host_Error ("Savegame is version %i, not %i", version, SAVEGAME_VERSION);
-		return;
-	}
-	data = COM_ParseStringNewline (data);
-	for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
-		data = COM_ParseFloatNewline (data, &spawn_parms[i]);
-	for (; i < NUM_TOTAL_SPAWN_PARMS; i++)
-		spawn_parms[i] = 0;
-	// this silliness is so we can load 1.06 save files, which have float skill values
-	data = COM_ParseFloatNewline (data, &tfloat);
-	current_skill = (int)(tfloat + 0.1);
-	Cvar_SetValue ("skill", (float)current_skill);
-
-	data = COM_ParseStringNewline (data);
-	q_strlcpy (mapname, com_token, sizeof (mapname));
-	data = COM_ParseFloatNewline (data, &time);
-
-	if (fastload && (!sv.active || cls.signon != SIGNONS || svs.maxclients != 1))
-	{
-		Con_Printf ("Can't fastload (first load, or is a client multiplayer game)\n");
-		fastload = 0;
-	}
-	if (fastload && (strcmp (mapname, sv.name) || current_skill != old_skill))
-	{
-		Con_Printf ("Can't fastload (%s skill %d vs %s skill %d)\n", mapname, current_skill, sv.name, old_skill);
-		fastload = 0;
-	}
-	if (fastload && cl.intermission)
-	{
-		// we could if we reset cl.intermission and the music, but some mods still struggle
-		Con_Printf ("Can't fastload during an intermission\n");
-		fastload = 0;
-	}
-
-	if (!fastload)
-		CL_Disconnect_f ();
-	else if (cls.demorecording) // demo playback can't deal with backward timestamps, so record a map change
-		CL_Stop_f ();
-
-	PR_SwitchQCVM (&sv.qcvm);
-
-	if (!fastload)
-		SV_SpawnServer (mapname);
-
-	if (!sv.active)
-	{
-		PR_SwitchQCVM (NULL);
-		Mem_Free (start);
-		start = NULL;
-		SCR_EndLoadingPlaque ();
-		Con_Printf ("Couldn't load map\n");
-		return;
-	}
-	if (!fastload)
-	{
-		sv.paused = true; // pause until all clients connect
-		sv.loadgame = true;
-	}
-	else
-		S_StopAllSounds (true, true); // do this before parsing the edicts, since that may take a while
-
-	if (was_recording)
-		CL_Resume_Record (fastload);
+	int		 i;
+	edict_t *ent;
+	int		 entnum;
 
 	// load the light styles
 	for (i = 0; i < MAX_LIGHTSTYLES; i++)
@@ -1672,6 +1814,174 @@ static void Host_Loadgame_f (void)
 		entnum++;
 	}
 
+	return entnum;
+}
+
+/*
+===============
+Host_Loadgame_f
+===============
+*/
+static void Host_Loadgame_f (void)
+{
+	static char *start;
+
+	char		name[MAX_OSPATH];
+	char		mapname[MAX_QPATH];
+	double		time;
+	float		tfloat;
+	const char *data = NULL;
+	int			i;
+	int			entnum;
+	int			version;
+	float		spawn_parms[NUM_TOTAL_SPAWN_PARMS];
+	size_t		binary_size = 0;
+	qboolean	was_recording = cls.demorecording;
+	int			old_skill = current_skill;
+	qboolean	fastload = !!strstr (Cmd_Argv (0), "fast") || autofastload.value;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("%s <savename> : load a game\n", Cmd_Argv (0));
+		return;
+	}
+
+	if (strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	if (nomonsters.value)
+	{
+		Con_Warning ("\"%s\" disabled automatically.\n", nomonsters.name);
+		Cvar_SetValueQuick (&nomonsters, 0.f);
+	}
+
+	cls.demonum = -1; // stop demo loop in case this fails
+
+	char	*save_path = multiuser ? SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true)) : NULL;
+	qboolean loadable = false;
+	for (int j = (multiuser ? 0 : 1); j < 2; ++j)
+	{
+		if (j == 0)
+			q_snprintf (name, sizeof (name), "%s%s", save_path, Cmd_Argv (1));
+		else
+			q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argv (1));
+		COM_AddExtension (name, ".sav", sizeof (name));
+
+		// avoid leaking if the previous Host_Loadgame_f failed with a Host_Error
+		if (start != NULL)
+			Mem_Free (start);
+
+		start = (char *)SV_LoadBinarySave (name, &binary_size);
+		if (!start)
+			start = (char *)COM_LoadMallocFile_TextMode_OSPath (name, NULL);
+		if (start)
+		{
+			loadable = true;
+			break;
+		}
+	}
+	SDL_free (save_path);
+
+	if (!loadable)
+	{
+		SCR_EndLoadingPlaque ();
+		Con_Printf ("ERROR: couldn't open.\n");
+		return;
+	}
+
+	// we can't call SCR_BeginLoadingPlaque, because too much stack space has
+	// been used.  The menu calls it before stuffing loadgame command
+	//	SCR_BeginLoadingPlaque ();
+
+	Con_Printf ("Loading game from %s...\n", name);
+
+	if (binary_size)
+		SV_ReadBinarySaveHeader ((const byte *)start, spawn_parms, &current_skill, mapname, &time);
+	else
+	{
+		data = start;
+		data = COM_ParseIntNewline (data, &version);
+		if (version != SAVEGAME_VERSION)
+		{
+			Mem_Free (start);
+			start = NULL;
+			Host_Error ("Savegame is version %i, not %i", version, SAVEGAME_VERSION);
+			return;
+		}
+		data = COM_ParseStringNewline (data);
+		for (i = 0; i < NUM_BASIC_SPAWN_PARMS; i++)
+			data = COM_ParseFloatNewline (data, &spawn_parms[i]);
+		for (; i < NUM_TOTAL_SPAWN_PARMS; i++)
+			spawn_parms[i] = 0;
+		// this silliness is so we can load 1.06 save files, which have float skill values
+		data = COM_ParseFloatNewline (data, &tfloat);
+		current_skill = (int)(tfloat + 0.1);
+
+		data = COM_ParseStringNewline (data);
+		q_strlcpy (mapname, com_token, sizeof (mapname));
+		data = COM_ParseFloatNewline (data, &tfloat);
+		time = tfloat;
+	}
+	Cvar_SetValue ("skill", (float)current_skill);
+
+	if (fastload && (!sv.active || cls.signon != SIGNONS || svs.maxclients != 1))
+	{
+		Con_Printf ("Can't fastload (first load, or is a client multiplayer game)\n");
+		fastload = 0;
+	}
+	if (fastload && (strcmp (mapname, sv.name) || current_skill != old_skill))
+	{
+		Con_Printf ("Can't fastload (%s skill %d vs %s skill %d)\n", mapname, current_skill, sv.name, old_skill);
+		fastload = 0;
+	}
+	if (fastload && cl.intermission)
+	{
+		// we could if we reset cl.intermission and the music, but some mods still struggle
+		Con_Printf ("Can't fastload during an intermission\n");
+		fastload = 0;
+	}
+
+	if (!fastload)
+		CL_Disconnect_f ();
+	else if (cls.demorecording) // demo playback can't deal with backward timestamps, so record a map change
+		CL_Stop_f ();
+
+	PR_SwitchQCVM (&sv.qcvm);
+
+	if (!fastload)
+		SV_SpawnServer (mapname);
+
+	if (!sv.active)
+	{
+		PR_SwitchQCVM (NULL);
+		Mem_Free (start);
+		start = NULL;
+		SCR_EndLoadingPlaque ();
+		Con_Printf ("Couldn't load map\n");
+		return;
+	}
+	if (!fastload)
+	{
+		sv.paused = true; // pause until all clients connect
+		sv.loadgame = true;
+	}
+	else
+		S_StopAllSounds (true, true); // do this before parsing the edicts, since that may take a while
+
+	if (was_recording)
+		CL_Resume_Record (fastload);
+
+	if (binary_size)
+		entnum = SV_ReadBinarySave ((const byte *)start, binary_size, fastload);
+	else
+		entnum = Host_LoadTextSave (data, spawn_parms, fastload);
+
 	qcvm->time = time;
 	for (i = entnum; i < qcvm->num_edicts; i++)
 	{
@@ -28,6 +28,27 @@ enum srcformat;
 
 byte *Image_LoadImage (const char *name, int *width, int *height, enum srcformat *fmt, unsigned int min_path_id);
 
+// image_compressed.c -- DDS/KTX2 block compressed textures
+#define MAX_COMPRESSED_MIPS 16
+
+typedef struct compressed_image_s
+{
+	VkFormat format;
+	int		 width, height;
+	int		 num_mips;
+	int		 block_width, block_height, block_bytes;
+	uint32_t mip_offsets[MAX_COMPRESSED_MIPS]; // into data
+	byte	 data[];							// the whole file
+} compressed_image_t;
+
+extern cvar_t gl_texture_compression;
+extern cvar_t gl_texture_cache;
+
+uint32_t			Image_CompressedMipSize (const compressed_image_t *image, int mip);
+compressed_image_t *Image_LoadCompressedImage (const char *name, unsigned int min_path_id);
+compressed_image_t *Image_CompressOpaqueRGBA (const byte *rgba, int width, int height);
+byte			   *Image_LoadTextureImage (const char *name, int *width, int *height, enum srcformat *fmt, unsigned int min_path_id);
+
 qboolean Image_WriteTGA (const char *name, byte *data, int width, int height, int bpp, qboolean upsidedown);
 qboolean Image_WritePNG (const char *name, byte *data, int width, int height, int bpp, qboolean upsidedown);
 qboolean Image_WriteJPG (const char *name, byte *data, int width, int height, int bpp, int quality, qboolean upsidedown);
@@ -0,0 +1,838 @@
+/*
+ * image_compressed.c -- pre-compressed DDS/KTX2 textures and the BC transcode cache
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+// A replacement texture foo.ktx2 or foo.dds is used in place of foo.png/tga/jpg/pcx and
+// uploaded with the block format and mips of the file. With gl_texture_cache the RGBA
+// replacements are encoded to BC1 (opaque) or BC3 by a task on first load and written to
+// <userdir>/texcache/<game>/foo.dds, the next load uses that file. A cache file is tagged
+// with the size of the file it was encoded from and ignored once that no longer matches.
+
+cvar_t gl_texture_compression = {"gl_texture_compression", "1", CVAR_ARCHIVE};
+cvar_t gl_texture_cache = {"gl_texture_cache", "0", CVAR_ARCHIVE};
+
+#define FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define DDS_MAGIC			 FOURCC ('D', 'D', 'S', ' ')
+#define DDS_HEADER_SIZE		 128 // including the magic
+#define DDS_DX10_HEADER_SIZE 20
+#define DDSD_CAPS			 0x1
+#define DDSD_HEIGHT			 0x2
+#define DDSD_WIDTH			 0x4
+#define DDSD_PIXELFORMAT	 0x1000
+#define DDSD_MIPMAPCOUNT	 0x20000
+#define DDSD_LINEARSIZE		 0x80000
+#define DDPF_FOURCC			 0x4
+#define DDSCAPS_COMPLEX		 0x8
+#define DDSCAPS_TEXTURE		 0x1000
+#define DDSCAPS_MIPMAP		 0x400000
+#define DDSCAPS2_CUBEMAP	 0x200
+#define DDSCAPS2_VOLUME		 0x200000
+#define DDS_RESOURCE_MISC_CUBE 0x4
+
+#define DXGI_FORMAT_BC1_UNORM	   71
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72
+#define DXGI_FORMAT_BC2_UNORM	   74
+#define DXGI_FORMAT_BC2_UNORM_SRGB 75
+#define DXGI_FORMAT_BC3_UNORM	   77
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78
+#define DXGI_FORMAT_BC7_UNORM	   98
+#define DXGI_FORMAT_BC7_UNORM_SRGB 99
+
+#define KTX2_HEADER_SIZE	  80
+#define KTX2_LEVEL_INDEX_SIZE 24
+
+// Stored in dwReserved1 of cache files, followed by the size of the source file
+#define TEXTURE_CACHE_TAG FOURCC ('V', 'K', 'Q', 'C')
+
+static const byte KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+typedef struct block_format_s
+{
+	VkFormat format;
+	VkFormat srgb_format;
+	byte	 block_width;
+	byte	 block_height;
+	byte	 block_bytes;
+} block_format_t;
+
+// Everything is sampled as UNORM like the RGBA8 textures, an sRGB file holds the same
+// values a png would. BC4/BC5 are left out, they don't hold colors.
+static const block_format_t block_formats[] = {
+	{VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK, 4, 4, 8},
+	{VK_FORMAT_BC1_RGBA_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4, 4, 8},
+	{VK_FORMAT_BC2_UNORM_BLOCK, VK_FORMAT_BC2_SRGB_BLOCK, 4, 4, 16},
+	{VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK, 4, 4, 16},
+	{VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, 4, 4, 16},
+	{VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 4, 4, 16},
+	{VK_FORMAT_ASTC_5x4_UNORM_BLOCK, VK_FORMAT_ASTC_5x4_SRGB_BLOCK, 5, 4, 16},
+	{VK_FORMAT_ASTC_5x5_UNORM_BLOCK, VK_FORMAT_ASTC_5x5_SRGB_BLOCK, 5, 5, 16},
+	{VK_FORMAT_ASTC_6x5_UNORM_BLOCK, VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 6, 5, 16},
+	{VK_FORMAT_ASTC_6x6_UNORM_BLOCK, VK_FORMAT_ASTC_6x6_SRGB_BLOCK, 6, 6, 16},
+	{VK_FORMAT_ASTC_8x5_UNORM_BLOCK, VK_FORMAT_ASTC_8x5_SRGB_BLOCK, 8, 5, 16},
+	{VK_FORMAT_ASTC_8x6_UNORM_BLOCK, VK_FORMAT_ASTC_8x6_SRGB_BLOCK, 8, 6, 16},
+	{VK_FORMAT_ASTC_8x8_UNORM_BLOCK, VK_FORMAT_ASTC_8x8_SRGB_BLOCK, 8, 8, 16},
+	{VK_FORMAT_ASTC_10x5_UNORM_BLOCK, VK_FORMAT_ASTC_10x5_SRGB_BLOCK, 10, 5, 16},
+	{VK_FORMAT_ASTC_10x6_UNORM_BLOCK, VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 10, 6, 16},
+	{VK_FORMAT_ASTC_10x8_UNORM_BLOCK, VK_FORMAT_ASTC_10x8_SRGB_BLOCK, 10, 8, 16},
+	{VK_FORMAT_ASTC_10x10_UNORM_BLOCK, VK_FORMAT_ASTC_10x10_SRGB_BLOCK, 10, 10, 16},
+	{VK_FORMAT_ASTC_12x10_UNORM_BLOCK, VK_FORMAT_ASTC_12x10_SRGB_BLOCK, 12, 10, 16},
+	{VK_FORMAT_ASTC_12x12_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 12, 12, 16},
+};
+
+typedef struct texture_cache_job_s
+{
+	char	 path[MAX_OSPATH];
+	byte	*rgba;
+	int		 width;
+	int		 height;
+	uint32_t source_length;
+} texture_cache_job_t;
+
+/*
+============
+Image_ReadU32
+============
+*/
+static inline uint32_t Image_ReadU32 (const byte *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+============
+Image_WriteU32
+============
+*/
+static inline void Image_WriteU32 (byte *p, uint32_t value)
+{
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+	p[2] = (value >> 16) & 0xFF;
+	p[3] = (value >> 24) & 0xFF;
+}
+
+/*
+============
+Image_ReadU64
+
+Offsets and sizes of KTX2 levels, anything beyond 4GB is rejected
+============
+*/
+static inline qboolean Image_ReadU64 (const byte *p, uint32_t *value)
+{
+	*value = Image_ReadU32 (p);
+	return Image_ReadU32 (p + 4) == 0;
+}
+
+/*
+============
+Image_FindBlockFormat
+============
+*/
+static const block_format_t *Image_FindBlockFormat (VkFormat format)
+{
+	for (size_t i = 0; i < countof (block_formats); ++i)
+		if (block_formats[i].format == format || block_formats[i].srgb_format == format)
+			return &block_formats[i];
+	return NULL;
+}
+
+/*
+============
+Image_CompressedMipSize
+============
+*/
+uint32_t Image_CompressedMipSize (const compressed_image_t *image, int mip)
+{
+	const uint32_t width = q_max (image->width >> mip, 1);
+	const uint32_t height = q_max (image->height >> mip, 1);
+	return ((width + image->block_width - 1) / image->block_width) * ((height + image->block_height - 1) / image->block_height) * image->block_bytes;
+}
+
+/*
+============
+Image_AllocCompressedImage
+
+Takes over the file, the mips point into it
+============
+*/
+static compressed_image_t *
+Image_AllocCompressedImage (const block_format_t *block_format, int width, int height, int num_mips, const byte *file, uint32_t length)
+{
+	if (width <= 0 || height <= 0 || width > 16384 || height > 16384)
+		return NULL;
+
+	int max_mips = 1;
+	while (((width | height) >> max_mips) > 0)
+		++max_mips;
+	num_mips = CLAMP (1, num_mips, q_min (max_mips, MAX_COMPRESSED_MIPS));
+
+	compressed_image_t *image = Mem_Alloc (sizeof (compressed_image_t) + length);
+	image->format = block_format->format;
+	image->width = width;
+	image->height = height;
+	image->num_mips = num_mips;
+	image->block_width = block_format->block_width;
+	image->block_height = block_format->block_height;
+	image->block_bytes = block_format->block_bytes;
+	memcpy (image->data, file, length);
+	return image;
+}
+
+/*
+============
+Image_ParseDDS
+============
+*/
+static compressed_image_t *Image_ParseDDS (const byte *file, uint32_t length, uint32_t *cache_source_length)
+{
+	if (length < DDS_HEADER_SIZE || Image_ReadU32 (file) != DDS_MAGIC || Image_ReadU32 (file + 4) != 124)
+		return NULL;
+
+	const uint32_t flags = Image_ReadU32 (file + 8);
+	const int	   height = Image_ReadU32 (file + 12);
+	const int	   width = Image_ReadU32 (file + 16);
+	const int	   num_mips = (flags & DDSD_MIPMAPCOUNT) ? Image_ReadU32 (file + 28) : 1;
+	const uint32_t pixel_format_flags = Image_ReadU32 (file + 80);
+	const uint32_t fourcc = Image_ReadU32 (file + 84);
+	const uint32_t caps2 = Image_ReadU32 (file + 112);
+	if (!(pixel_format_flags & DDPF_FOURCC) || (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)))
+		return NULL;
+
+	if (cache_source_length)
+		*cache_source_length = (Image_ReadU32 (file + 32) == TEXTURE_CACHE_TAG) ? Image_ReadU32 (file + 36) : 0;
+
+	uint32_t data_offset = DDS_HEADER_SIZE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	switch (fourcc)
+	{
+	case FOURCC ('D', 'X', 'T', '1'):
+		format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		break;
+	case FOURCC ('D', 'X', 'T', '2'):
+	case FOURCC ('D', 'X', 'T', '3'):
+		format = VK_FORMAT_BC2_UNORM_BLOCK;
+		break;
+	case FOURCC ('D', 'X', 'T', '4'):
+	case FOURCC ('D', 'X', 'T', '5'):
+		format = VK_FORMAT_BC3_UNORM_BLOCK;
+		break;
+	case FOURCC ('D', 'X', '1', '0'):
+	{
+		if (length < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+			return NULL;
+		const uint32_t dxgi_format = Image_ReadU32 (file + DDS_HEADER_SIZE);
+		const uint32_t misc_flags = Image_ReadU32 (file + DDS_HEADER_SIZE + 8);
+		const uint32_t array_size = Image_ReadU32 (file + DDS_HEADER_SIZE + 12);
+		if ((misc_flags & DDS_RESOURCE_MISC_CUBE) || array_size > 1)
+			return NULL;
+		data_offset += DDS_DX10_HEADER_SIZE;
+		switch (dxgi_format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			break;
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+			format = VK_FORMAT_BC2_UNORM_BLOCK;
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			format = VK_FORMAT_BC3_UNORM_BLOCK;
+			break;
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			format = VK_FORMAT_BC7_UNORM_BLOCK;
+			break;
+		}
+	}
+	break;
+	}
+
+	const block_format_t *block_format = Image_FindBlockFormat (format);
+	if (!block_format)
+		return NULL;
+
+	compressed_image_t *image = Image_AllocCompressedImage (block_format, width, height, num_mips, file, length);
+	if (!image)
+		return NULL;
+
+	// DDS mips follow each other, largest first
+	uint32_t offset = data_offset;
+	for (int i = 0; i < image->num_mips; ++i)
+	{
+		const uint32_t size = Image_CompressedMipSize (image, i);
+		if (size > length - offset)
+		{
+			Mem_Free (image);
+			return NULL;
+		}
+		image->mip_offsets[i] = offset;
+		offset += size;
+	}
+	return image;
+}
+
+/*
+============
+Image_ParseKTX2
+============
+*/
+static compressed_image_t *Image_ParseKTX2 (const byte *file, uint32_t length)
+{
+	if (length < KTX2_HEADER_SIZE || memcmp (file, KTX2_IDENTIFIER, sizeof (KTX2_IDENTIFIER)) != 0)
+		return NULL;
+
+	const VkFormat format = (VkFormat)Image_ReadU32 (file + 12);
+	const int	   width = Image_ReadU32 (file + 20);
+	const int	   height = Image_ReadU32 (file + 24);
+	const uint32_t depth = Image_ReadU32 (file + 28);
+	const uint32_t num_layers = Image_ReadU32 (file + 32);
+	const uint32_t num_faces = Image_ReadU32 (file + 36);
+	const uint32_t num_levels = Image_ReadU32 (file + 40);
+	const uint32_t supercompression = Image_ReadU32 (file + 44);
+
+	// Basis/zstd supercompressed files would need a transcoder
+	const block_format_t *block_format = Image_FindBlockFormat (format);
+	if (!block_format || depth > 1 || num_layers > 1 || num_faces != 1 || supercompression != 0)
+		return NULL;
+
+	compressed_image_t *image = Image_AllocCompressedImage (block_format, width, height, q_max (num_levels, 1u), file, length);
+	if (!image)
+		return NULL;
+	if ((uint64_t)KTX2_HEADER_SIZE + (uint64_t)image->num_mips * KTX2_LEVEL_INDEX_SIZE > length)
+	{
+		Mem_Free (image);
+		return NULL;
+	}
+
+	for (int i = 0; i < image->num_mips; ++i)
+	{
+		const byte *level = file + KTX2_HEADER_SIZE + (i * KTX2_LEVEL_INDEX_SIZE);
+		uint32_t	offset, size;
+		if (!Image_ReadU64 (level, &offset) || !Image_ReadU64 (level + 8, &size) || size < Image_CompressedMipSize (image, i) || offset > length ||
+			size > length - offset)
+		{
+			Mem_Free (image);
+			return NULL;
+		}
+		image->mip_offsets[i] = offset;
+	}
+	return image;
+}
+
+/*
+============
+Image_LoadCompressedImage
+
+Returns a Mem_Alloc allocated image from name.ktx2 or name.dds, NULL if there is
+none or the device can't sample its format.
+============
+*/
+compressed_image_t *Image_LoadCompressedImage (const char *name, unsigned int min_path_id)
+{
+	static const char *const extensions[] = {"ktx2", "dds"};
+	char					 filename[MAX_OSPATH];
+
+	for (size_t i = 0; i < countof (extensions); ++i)
+	{
+		FILE		*f;
+		unsigned int path_id = 0;
+		q_snprintf (filename, sizeof (filename), "%s.%s", name, extensions[i]);
+		const int length = COM_FOpenFile (filename, &f, &path_id);
+		if (!f)
+			continue;
+		if (path_id < min_path_id)
+		{
+			Con_DPrintf ("Image_LoadCompressedImage: ignored %s from a gamedir with lower priority\n", filename);
+			fclose (f);
+			continue;
+		}
+
+		byte *file = Mem_AllocNonZero (length);
+		const qboolean read = fread (file, 1, length, f) == (size_t)length;
+		fclose (f);
+
+		compressed_image_t *image = NULL;
+		if (read)
+			image = (i == 0) ? Image_ParseKTX2 (file, length) : Image_ParseDDS (file, length, NULL);
+		Mem_Free (file);
+
+		if (!image)
+			Con_Warning ("couldn't load %s (unsupported format)\n", filename);
+		else if (!GL_CompressedFormatSupported (image->format))
+		{
+			Con_DPrintf ("%s: format %d not supported by the device\n", filename, (int)image->format);
+			Mem_Free (image);
+		}
+		else
+			return image;
+	}
+
+	return NULL;
+}
+
+/*
+============
+Image_FindSourceFile
+
+Same search as Image_LoadImage for the RGBA formats, returns the file size or 0
+============
+*/
+static uint32_t Image_FindSourceFile (const char *name, unsigned int min_path_id)
+{
+	static const char *const extensions[] = {"png", "tga", "jpg", "pcx"};
+	char					 filename[MAX_OSPATH];
+
+	for (size_t i = 0; i < countof (extensions); ++i)
+	{
+		FILE		*f;
+		unsigned int path_id = 0;
+		q_snprintf (filename, sizeof (filename), "%s.%s", name, extensions[i]);
+		const int length = COM_FOpenFile (filename, &f, &path_id);
+		if (!f)
+			continue;
+		fclose (f);
+		if (path_id >= min_path_id)
+			return length;
+	}
+
+	return 0;
+}
+
+/*
+============
+Image_LoadCachedImage
+============
+*/
+static compressed_image_t *Image_LoadCachedImage (const char *path, uint32_t source_length)
+{
+	FILE *f = fopen (path, "rb");
+	if (!f)
+		return NULL;
+
+	const long length = (long)Sys_filelength (f);
+	byte	  *file = (length > 0) ? Mem_AllocNonZero (length) : NULL;
+	const qboolean read = file && (fread (file, 1, length, f) == (size_t)length);
+	fclose (f);
+
+	uint32_t			cache_source_length = 0;
+	compressed_image_t *image = read ? Image_ParseDDS (file, length, &cache_source_length) : NULL;
+	Mem_Free (file);
+
+	if (image && cache_source_length != source_length)
+	{
+		Con_DPrintf ("%s is out of date\n", path);
+		Mem_Free (image);
+		image = NULL;
+	}
+	return image;
+}
+
+/*
+================================================================================
+
+	BC1/BC3 ENCODER
+
+================================================================================
+*/
+
+/*
+============
+BC_Pack565
+============
+*/
+static uint16_t BC_Pack565 (const float color[3])
+{
+	const int r = CLAMP (0, (int)(color[0] * (31.0f / 255.0f) + 0.5f), 31);
+	const int g = CLAMP (0, (int)(color[1] * (63.0f / 255.0f) + 0.5f), 63);
+	const int b = CLAMP (0, (int)(color[2] * (31.0f / 255.0f) + 0.5f), 31);
+	return (r << 11) | (g << 5) | b;
+}
+
+/*
+============
+BC_Unpack565
+============
+*/
+static void BC_Unpack565 (uint16_t packed, int color[3])
+{
+	const int r = (packed >> 11) & 31;
+	const int g = (packed >> 5) & 63;
+	const int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+/*
+============
+BC_EncodeColorBlock
+
+Endpoints at the ends of the block's principal axis, always the four color mode
+============
+*/
+static void BC_EncodeColorBlock (const byte texels[16][4], byte *out)
+{
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 3; ++c)
+			mean[c] += texels[i][c] * (1.0f / 16.0f);
+
+	float covariance[3][3] = {{0.0f}};
+	for (int i = 0; i < 16; ++i)
+	{
+		const float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2]};
+		for (int a = 0; a < 3; ++a)
+			for (int b = 0; b < 3; ++b)
+				covariance[a][b] += d[a] * d[b];
+	}
+
+	// Power iteration
+	float axis[3] = {1.0f, 1.0f, 1.0f};
+	for (int iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[3];
+		for (int a = 0; a < 3; ++a)
+			next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+		const float scale = q_max (fabsf (next[0]), q_max (fabsf (next[1]), fabsf (next[2])));
+		if (scale < 1e-4f)
+			break;
+		for (int a = 0; a < 3; ++a)
+			axis[a] = next[a] / scale;
+	}
+	const float axis_length_squared = DotProduct (axis, axis);
+
+	float min_t = 0.0f, max_t = 0.0f;
+	for (int i = 0; i < 16; ++i)
+	{
+		const float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2]};
+		const float t = DotProduct (d, axis) / axis_length_squared;
+		min_t = q_min (min_t, t);
+		max_t = q_max (max_t, t);
+	}
+
+	float endpoints[2][3];
+	for (int c = 0; c < 3; ++c)
+	{
+		endpoints[0][c] = mean[c] + max_t * axis[c];
+		endpoints[1][c] = mean[c] + min_t * axis[c];
+	}
+	uint16_t color0 = BC_Pack565 (endpoints[0]);
+	uint16_t color1 = BC_Pack565 (endpoints[1]);
+	if (color0 < color1)
+	{
+		const uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		BC_Unpack565 (color0, palette[0]);
+		BC_Unpack565 (color1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int best_index = 0;
+			int best_distance = INT_MAX;
+			for (int j = 0; j < 4; ++j)
+			{
+				const int dr = texels[i][0] - palette[j][0];
+				const int dg = texels[i][1] - palette[j][1];
+				const int db = texels[i][2] - palette[j][2];
+				const int distance = dr * dr + dg * dg + db * db;
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					best_index = j;
+				}
+			}
+			indices |= (uint32_t)best_index << (i * 2);
+		}
+	}
+
+	out[0] = color0 & 0xFF;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF;
+	out[3] = color1 >> 8;
+	Image_WriteU32 (out + 4, indices);
+}
+
+/*
+============
+BC_EncodeAlphaBlock
+
+BC3 alpha with the block's minimum and maximum as endpoints, eight value mode
+============
+*/
+static void BC_EncodeAlphaBlock (const byte texels[16][4], byte *out)
+{
+	int alpha_min = 255, alpha_max = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		alpha_min = q_min (alpha_min, texels[i][3]);
+		alpha_max = q_max (alpha_max, texels[i][3]);
+	}
+
+	uint64_t indices = 0;
+	if (alpha_max != alpha_min)
+	{
+		// Ramp position 0 is alpha0, 7 is alpha1, the ones in between are indices 2 to 7
+		static const byte ramp_to_index[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+		const int		  range = alpha_max - alpha_min;
+		for (int i = 0; i < 16; ++i)
+		{
+			const int ramp = ((alpha_max - texels[i][3]) * 7 + range / 2) / range;
+			indices |= (uint64_t)ramp_to_index[ramp] << (i * 3);
+		}
+	}
+
+	out[0] = alpha_max;
+	out[1] = alpha_min;
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+/*
+============
+BC_EncodeImage
+
+Returns the number of bytes written, partial blocks at the edges repeat the last texel
+============
+*/
+static uint32_t BC_EncodeImage (const byte *rgba, int width, int height, qboolean alpha, byte *out)
+{
+	byte *start = out;
+	for (int block_y = 0; block_y < height; block_y += 4)
+	{
+		for (int block_x = 0; block_x < width; block_x += 4)
+		{
+			byte texels[16][4];
+			for (int y = 0; y < 4; ++y)
+				for (int x = 0; x < 4; ++x)
+				{
+					const int src_x = q_min (block_x + x, width - 1);
+					const int src_y = q_min (block_y + y, height - 1);
+					memcpy (texels[y * 4 + x], rgba + ((src_y * width + src_x) * 4), 4);
+				}
+
+			if (alpha)
+			{
+				BC_EncodeAlphaBlock (texels, out);
+				out += 8;
+			}
+			BC_EncodeColorBlock (texels, out);
+			out += 8;
+		}
+	}
+	return out - start;
+}
+
+/*
+============
+Image_CompressOpaqueRGBA
+
+Single level BC1 image of data that only exists at load, alpha is dropped
+============
+*/
+compressed_image_t *Image_CompressOpaqueRGBA (const byte *rgba, int width, int height)
+{
+	const uint32_t		size = ((width + 3) / 4) * ((height + 3) / 4) * 8;
+	compressed_image_t *image = Mem_Alloc (sizeof (compressed_image_t) + size);
+	image->format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	image->width = width;
+	image->height = height;
+	image->num_mips = 1;
+	image->block_width = 4;
+	image->block_height = 4;
+	image->block_bytes = 8;
+	image->mip_offsets[0] = 0;
+	BC_EncodeImage (rgba, width, height, false, image->data);
+	return image;
+}
+
+/*
+============
+Image_DownsampleRGBA
+
+Box filter into a q_max (width / 2, 1) x q_max (height / 2, 1) image
+============
+*/
+static void Image_DownsampleRGBA (const byte *in, int width, int height, byte *out)
+{
+	const int out_width = q_max (width / 2, 1);
+	const int out_height = q_max (height / 2, 1);
+	for (int y = 0; y < out_height; ++y)
+	{
+		const int y0 = q_min (y * 2, height - 1);
+		const int y1 = q_min (y * 2 + 1, height - 1);
+		for (int x = 0; x < out_width; ++x)
+		{
+			const int x0 = q_min (x * 2, width - 1);
+			const int x1 = q_min (x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; ++c)
+				out[(y * out_width + x) * 4 + c] =
+					(in[(y0 * width + x0) * 4 + c] + in[(y0 * width + x1) * 4 + c] + in[(y1 * width + x0) * 4 + c] + in[(y1 * width + x1) * 4 + c] + 2) / 4;
+		}
+	}
+}
+
+/*
+============
+Image_EncodeCacheTask
+============
+*/
+static void Image_EncodeCacheTask (void *payload)
+{
+	texture_cache_job_t *job = *(texture_cache_job_t **)payload;
+	const int			 num_pixels = job->width * job->height;
+
+	qboolean alpha = false;
+	for (int i = 0; i < num_pixels && !alpha; ++i)
+		alpha = job->rgba[i * 4 + 3] != 255;
+
+	int num_mips = 1;
+	while (((job->width | job->height) >> num_mips) > 0 && num_mips < MAX_COMPRESSED_MIPS)
+		++num_mips;
+
+	// A mip chain is less than 4/3 of the top level, plus the blocks of the small mips
+	const int block_bytes = alpha ? 16 : 8;
+	size_t	  max_size = DDS_HEADER_SIZE;
+	for (int i = 0; i < num_mips; ++i)
+		max_size += (size_t)((q_max (job->width >> i, 1) + 3) / 4) * ((q_max (job->height >> i, 1) + 3) / 4) * block_bytes;
+	byte *file = Mem_Alloc (max_size);
+
+	Image_WriteU32 (file, DDS_MAGIC);
+	Image_WriteU32 (file + 4, 124);
+	Image_WriteU32 (file + 8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+	Image_WriteU32 (file + 12, job->height);
+	Image_WriteU32 (file + 16, job->width);
+	Image_WriteU32 (file + 20, ((job->width + 3) / 4) * ((job->height + 3) / 4) * block_bytes);
+	Image_WriteU32 (file + 28, num_mips);
+	Image_WriteU32 (file + 32, TEXTURE_CACHE_TAG);
+	Image_WriteU32 (file + 36, job->source_length);
+	Image_WriteU32 (file + 76, 32);
+	Image_WriteU32 (file + 80, DDPF_FOURCC);
+	Image_WriteU32 (file + 84, alpha ? FOURCC ('D', 'X', 'T', '5') : FOURCC ('D', 'X', 'T', '1'));
+	Image_WriteU32 (file + 108, DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX);
+
+	byte	*mip = job->rgba;
+	byte	*next_mip = Mem_Alloc (q_max (job->width / 2, 1) * q_max (job->height / 2, 1) * 4);
+	size_t	 size = DDS_HEADER_SIZE;
+	int		 mip_width = job->width;
+	int		 mip_height = job->height;
+	for (int i = 0; i < num_mips; ++i)
+	{
+		size += BC_EncodeImage (mip, mip_width, mip_height, alpha, file + size);
+		if (i + 1 == num_mips)
+			break;
+
+		Image_DownsampleRGBA (mip, mip_width, mip_height, next_mip);
+		mip_width = q_max (mip_width / 2, 1);
+		mip_height = q_max (mip_height / 2, 1);
+		// The source image isn't needed anymore, reuse it for the next level
+		byte *swap = mip;
+		mip = next_mip;
+		next_mip = swap;
+	}
+	assert (size <= max_size);
+	Mem_Free (next_mip);
+	Mem_Free (mip);
+
+	// Written under a temporary name, a half written file is never picked up
+	char temp_path[MAX_OSPATH];
+	q_snprintf (temp_path, sizeof (temp_path), "%s.tmp", job->path);
+	COM_CreatePath (temp_path);
+	FILE *f = fopen (temp_path, "wb");
+	if (f)
+	{
+		const qboolean written = fwrite (file, 1, size, f) == size;
+		fclose (f);
+		remove (job->path);
+		if (!written || rename (temp_path, job->path) != 0)
+		{
+			remove (temp_path);
+			Con_DPrintf ("couldn't write %s\n", job->path);
+		}
+	}
+	Mem_Free (file);
+	Mem_Free (job);
+}
+
+/*
+============
+Image_LoadTextureImage
+
+Image_LoadImage for replacement textures: prefers a pre-compressed name.ktx2 or
+name.dds (fmt SRC_COMPRESSED, the data is a compressed_image_t) and goes through
+the transcode cache with gl_texture_cache.
+============
+*/
+byte *Image_LoadTextureImage (const char *name, int *width, int *height, enum srcformat *fmt, unsigned int min_path_id)
+{
+	if (!gl_texture_compression.value)
+		return Image_LoadImage (name, width, height, fmt, min_path_id);
+
+	compressed_image_t *image = Image_LoadCompressedImage (name, min_path_id);
+	if (!image && gl_texture_cache.value && GL_CompressedFormatSupported (VK_FORMAT_BC3_UNORM_BLOCK))
+	{
+		const uint32_t source_length = Image_FindSourceFile (name, min_path_id);
+		if (!source_length)
+			return Image_LoadImage (name, width, height, fmt, min_path_id);
+
+		char cache_path[MAX_OSPATH];
+		q_snprintf (cache_path, sizeof (cache_path), "%s/texcache/%s/%s.dds", host_parms->userdir, COM_SkipPath (com_gamedir), name);
+		image = Image_LoadCachedImage (cache_path, source_length);
+		if (!image)
+		{
+			byte *data = Image_LoadImage (name, width, height, fmt, min_path_id);
+			if (data && *fmt == SRC_RGBA)
+			{
+				texture_cache_job_t *job = Mem_Alloc (sizeof (texture_cache_job_t));
+				q_strlcpy (job->path, cache_path, sizeof (job->path));
+				job->rgba = Mem_AllocNonZero (*width * *height * 4);
+				memcpy (job->rgba, data, *width * *height * 4);
+				job->width = *width;
+				job->height = *height;
+				job->source_length = source_length;
+				Task_AllocateAssignBackgroundFuncAndSubmit (Image_EncodeCacheTask, &job, sizeof (job));
+			}
+			return data;
+		}
+	}
+
+	if (!image)
+		return Image_LoadImage (name, width, height, fmt, min_path_id);
+
+	*width = image->width;
+	*height = image->height;
+	*fmt = SRC_COMPRESSED;
+	return (byte *)image;
+}
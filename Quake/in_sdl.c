@@ -227,6 +227,31 @@ void IN_MouseMotion (int dx, int dy)
 	total_dy += dy;
 }
 
+#ifdef USE_RMLUI
+static qboolean ui_move_pending;
+static int		ui_move_x, ui_move_y;
+static int		ui_move_dx, ui_move_dy;
+
+void IN_QueueUIMouseMove (int x, int y, int dx, int dy)
+{
+	ui_move_pending = true;
+	ui_move_x = x;
+	ui_move_y = y;
+	ui_move_dx += dx;
+	ui_move_dy += dy;
+}
+
+void IN_FlushUIMouseMove (void)
+{
+	if (!ui_move_pending)
+		return;
+	ui_move_pending = false;
+	UI_MouseMove (ui_move_x, ui_move_y, ui_move_dx, ui_move_dy);
+	ui_move_dx = 0;
+	ui_move_dy = 0;
+}
+#endif
+
 typedef struct joyaxis_s
 {
 	float x;
@@ -3,6 +3,13 @@ void IN_ShutdownJoystick (void);
 void IN_BeginIgnoringMouseEvents (void);
 void IN_EndIgnoringMouseEvents (void);
 
+#ifdef USE_RMLUI
+// RmlUI hit tests on every mouse move. A high-rate mouse sends dozens of motion events
+// per frame, these pass it only the last position, before any event that depends on it.
+void IN_QueueUIMouseMove (int x, int y, int dx, int dy);
+void IN_FlushUIMouseMove (void);
+#endif
+
 #ifdef USE_SDL3
 extern SDL_Gamepad *joy_active_controller;
 #else
@@ -123,6 +123,10 @@ void IN_SendKeyEvents (void)
 
 	while (SDL_PollEvent (&event))
 	{
+#ifdef USE_RMLUI
+		if (event.type != SDL_MOUSEMOTION)
+			IN_FlushUIMouseMove ();
+#endif
 		switch (event.type)
 		{
 		case SDL_WINDOWEVENT:
@@ -316,7 +320,7 @@ void IN_SendKeyEvents (void)
 		case SDL_MOUSEMOTION:
 #ifdef USE_RMLUI
 			/* Always update RmlUI cursor position for hover effects */
-			UI_MouseMove (event.motion.x, event.motion.y, event.motion.xrel, event.motion.yrel);
+			IN_QueueUIMouseMove (event.motion.x, event.motion.y, event.motion.xrel, event.motion.yrel);
 			/* Don't pass motion to game when RmlUI menu is active */
 			if (UI_WantsInput ())
 				break;
@@ -363,6 +367,9 @@ void IN_SendKeyEvents (void)
 			break;
 		}
 	}
+#ifdef USE_RMLUI
+	IN_FlushUIMouseMove ();
+#endif
 }
 
 static int SDLCALL IN_FilterMouseEvents (const SDL_Event *event)
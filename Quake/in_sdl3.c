@@ -119,6 +119,10 @@ void IN_SendKeyEvents (void)
 
 	while (SDL_PollEvent (&event))
 	{
+#ifdef USE_RMLUI
+		if (event.type != SDL_EVENT_MOUSE_MOTION)
+			IN_FlushUIMouseMove ();
+#endif
 		switch (event.type)
 		{
 		case SDL_EVENT_WINDOW_FOCUS_GAINED:
@@ -281,7 +285,7 @@ void IN_SendKeyEvents (void)
 
 		case SDL_EVENT_MOUSE_MOTION:
 #ifdef USE_RMLUI
-			UI_MouseMove (event.motion.x, event.motion.y, event.motion.xrel, event.motion.yrel);
+			IN_QueueUIMouseMove (event.motion.x, event.motion.y, event.motion.xrel, event.motion.yrel);
 			if (UI_WantsInput ())
 				break;
 #endif
@@ -327,6 +331,9 @@ void IN_SendKeyEvents (void)
 			break;
 		}
 	}
+#ifdef USE_RMLUI
+	IN_FlushUIMouseMove ();
+#endif
 }
 
 static bool SDLCALL IN_FilterMouseEvents (const SDL_Event *event)
@@ -43,6 +43,9 @@ void IN_UpdateInputMode (void);
 void IN_Move (usercmd_t *cmd);
 // add additional movement on top of the keyboard move cmd
 
+void IN_MouseMove (usercmd_t *cmd);
+// only the mouse part of IN_Move, safe to call more than once per frame
+
 void IN_ClearStates (void);
 // restores all button and position states to defaults
 
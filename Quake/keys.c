@@ -207,8 +207,8 @@ Key_Console -- johnfitz -- heavy revision
 Interactive line editing and console scrollback
 ====================
 */
-extern char *con_text, key_tabpartial[MAXCMDLINE];
-extern int	 con_current, con_linewidth, con_vislines;
+extern char key_tabpartial[MAXCMDLINE];
+extern int	con_vislines;
 
 static int GetHistoryPrevLine (int line)
 {
@@ -286,24 +286,7 @@ void Key_Console (int key)
 
 	case K_HOME:
 		if (keydown[K_CTRL])
-		{
-			// skip initial empty lines
-			int	  i, x;
-			char *line;
-
-			for (i = con_current - con_totallines + 1; i <= con_current; i++)
-			{
-				line = con_text + (i % con_totallines) * con_linewidth;
-				for (x = 0; x < con_linewidth; x++)
-				{
-					if (line[x] != ' ')
-						break;
-				}
-				if (x != con_linewidth)
-					break;
-			}
-			con_backscroll = CLAMP (0, con_current - i % con_totallines - 2, con_totallines - (glheight >> 3) - 1);
-		}
+			con_backscroll = Con_MaxBackscroll ();
 		else
 			key_linepos = 1;
 		return;
@@ -317,9 +300,7 @@ void Key_Console (int key)
 
 	case K_PGUP:
 	case K_MWHEELUP:
-		con_backscroll += keydown[K_CTRL] ? ((con_vislines >> 3) - 4) : 2;
-		if (con_backscroll > con_totallines - (vid.height >> 3) - 1)
-			con_backscroll = con_totallines - (vid.height >> 3) - 1;
+		con_backscroll = q_min (con_backscroll + (keydown[K_CTRL] ? ((con_vislines >> 3) - 4) : 2), Con_MaxBackscroll ());
 		return;
 
 	case K_PGDN:
@@ -84,7 +84,11 @@ int main (int argc, char *argv[])
 
 	COM_InitArgv (parms.argc, parms.argv);
 
+#ifdef SERVERONLY
+	isDedicated = true;
+#else
 	isDedicated = (COM_CheckParm ("-dedicated") != 0);
+#endif
 
 	Sys_InitSDL ();
 
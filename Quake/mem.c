@@ -59,9 +59,48 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define THREAD_STACK_RESERVATION (128ll * 1024ll)
 #define MAX_STACK_ALLOC_SIZE	 (512ll * 1024ll)
 
+#define FRAME_ARENA_BLOCK_SIZE (1024ll * 1024ll)
+#define FRAME_ARENA_ALIGNMENT  16
+#define FRAME_ARENA_POISON	   0xCD
+
 size_t THREAD_LOCAL thread_stack_alloc_size = 0;
 size_t				max_thread_stack_alloc_size = 0;
 
+// Blocks after frame_arena_current are unused, their used field is stale
+typedef struct mem_frame_block_s
+{
+	struct mem_frame_block_s *next;
+	size_t					  size;
+	size_t					  used;
+	size_t					  base; // bytes handed out by the blocks before this one
+} mem_frame_block_t;
+
+COMPILE_TIME_ASSERT ("mem_frame_block_t", (sizeof (mem_frame_block_t) % FRAME_ARENA_ALIGNMENT) == 0);
+
+static THREAD_LOCAL mem_frame_block_t *frame_arena_first;
+static THREAD_LOCAL mem_frame_block_t *frame_arena_current;
+static atomic_uint64_t				   frame_arena_peak;
+
+// Every Mem_Alloc block is prefixed with its size and tag, 16 bytes keeps the
+// alignment of the underlying allocator
+typedef struct mem_header_s
+{
+	uint64_t size;
+	uint32_t tag;
+	uint32_t unused;
+} mem_header_t;
+
+COMPILE_TIME_ASSERT ("mem_header_t", sizeof (mem_header_t) == 16);
+
+static THREAD_LOCAL mem_tag_t mem_current_tag = MEM_TAG_MISC;
+static atomic_uint64_t		  mem_tag_bytes[NUM_MEM_TAGS];
+static atomic_uint64_t		  mem_tag_peak_bytes[NUM_MEM_TAGS];
+static atomic_uint64_t		  mem_tag_allocations[NUM_MEM_TAGS];
+
+static const char *mem_tag_names[NUM_MEM_TAGS] = {
+	"misc", "server", "client", "models", "sound", "textures", "ui", "lua", "qc strings",
+};
+
 /*
 ====================
 Mem_Init
@@ -85,52 +124,139 @@ void Mem_Init ()
 
 /*
 ====================
-Mem_Alloc : initialize memory to zero by default.
+Mem_SysAlloc
 ====================
 */
-void *Mem_Alloc (const size_t size)
+static void *Mem_SysAlloc (const size_t size, const qboolean zeroed)
 {
 #if defined(USE_MI_MALLOC)
-	return mi_calloc (1, size);
+	return zeroed ? mi_calloc (1, size) : mi_malloc (size);
 #elif defined(USE_SDL_MALLOC)
-	return SDL_calloc (1, size);
+	return zeroed ? SDL_calloc (1, size) : SDL_malloc (size);
 #elif defined(USE_CRT_MALLOC)
-	return calloc (1, size);
+	return zeroed ? calloc (1, size) : malloc (size);
 #endif
 }
 
 /*
 ====================
-Mem_AllocNonZero
+Mem_SysRealloc
 ====================
 */
-void *Mem_AllocNonZero (const size_t size)
+static void *Mem_SysRealloc (void *ptr, const size_t size)
 {
 #if defined(USE_MI_MALLOC)
-	return mi_malloc (size);
+	return mi_realloc (ptr, size);
 #elif defined(USE_SDL_MALLOC)
-	return SDL_malloc (size);
+	return SDL_realloc (ptr, size);
 #elif defined(USE_CRT_MALLOC)
-	return malloc (size);
+	return realloc (ptr, size);
 #endif
 }
 
 /*
 ====================
-Mem_Realloc
+Mem_SysFree
 ====================
 */
-void *Mem_Realloc (void *ptr, const size_t size)
+static void Mem_SysFree (void *ptr)
 {
 #if defined(USE_MI_MALLOC)
-	return mi_realloc (ptr, size);
+	mi_free (ptr);
 #elif defined(USE_SDL_MALLOC)
-	return SDL_realloc (ptr, size);
+	SDL_free (ptr);
 #elif defined(USE_CRT_MALLOC)
-	return realloc (ptr, size);
+	free (ptr);
 #endif
 }
 
+/*
+====================
+Mem_ChargeTag
+====================
+*/
+static void Mem_ChargeTag (const mem_tag_t tag, const uint64_t bytes)
+{
+	const uint64_t current = Atomic_AddUInt64 (&mem_tag_bytes[tag], bytes) + bytes;
+	uint64_t	   peak = Atomic_LoadUInt64 (&mem_tag_peak_bytes[tag]);
+	while ((current > peak) && !Atomic_CompareExchangeUInt64 (&mem_tag_peak_bytes[tag], &peak, current))
+	{
+	}
+}
+
+/*
+====================
+Mem_TrackedAlloc
+====================
+*/
+static void *Mem_TrackedAlloc (const size_t size, const mem_tag_t tag, const qboolean zeroed)
+{
+	mem_header_t *header = (mem_header_t *)Mem_SysAlloc (sizeof (mem_header_t) + size, zeroed);
+	if (!header)
+		return NULL;
+	header->size = size;
+	header->tag = tag;
+	Atomic_IncrementUInt64 (&mem_tag_allocations[tag]);
+	Mem_ChargeTag (tag, size);
+	return header + 1;
+}
+
+/*
+====================
+Mem_Alloc : initialize memory to zero by default.
+====================
+*/
+void *Mem_Alloc (const size_t size)
+{
+	return Mem_TrackedAlloc (size, mem_current_tag, true);
+}
+
+/*
+====================
+Mem_AllocTagged : zero initialized, charged to tag instead of the current one
+====================
+*/
+void *Mem_AllocTagged (const size_t size, const mem_tag_t tag)
+{
+	return Mem_TrackedAlloc (size, tag, true);
+}
+
+/*
+====================
+Mem_AllocNonZero
+====================
+*/
+void *Mem_AllocNonZero (const size_t size)
+{
+	return Mem_TrackedAlloc (size, mem_current_tag, false);
+}
+
+/*
+====================
+Mem_Realloc
+
+The block keeps the tag it was allocated with
+====================
+*/
+void *Mem_Realloc (void *ptr, const size_t size)
+{
+	if (!ptr)
+		return Mem_AllocNonZero (size);
+
+	mem_header_t  *header = (mem_header_t *)ptr - 1;
+	const uint64_t old_size = header->size;
+	const uint32_t tag = header->tag;
+	header = (mem_header_t *)Mem_SysRealloc (header, sizeof (mem_header_t) + size);
+	if (!header)
+		return NULL;
+	header->size = size;
+	if (size > old_size)
+		Mem_ChargeTag (tag, size - old_size);
+	else
+		Atomic_SubUInt64 (&mem_tag_bytes[tag], old_size - size);
+	return header + 1;
+}
+
 /*
 ====================
 Mem_Free
@@ -138,11 +264,247 @@ Mem_Free
 */
 void Mem_Free (const void *ptr)
 {
-#if defined(USE_MI_MALLOC)
-	mi_free ((void *)ptr);
-#elif defined(USE_SDL_MALLOC)
-	SDL_free ((void *)ptr);
-#elif defined(USE_CRT_MALLOC)
-	free ((void *)ptr);
+	if (!ptr)
+		return;
+
+	mem_header_t *header = (mem_header_t *)ptr - 1;
+	Atomic_SubUInt64 (&mem_tag_bytes[header->tag], header->size);
+	Atomic_SubUInt64 (&mem_tag_allocations[header->tag], 1);
+	Mem_SysFree (header);
+}
+
+/*
+====================
+Mem_SetTag
+
+Allocations of the calling thread are charged to tag from now on, returns
+the previous tag so scopes can restore it
+====================
+*/
+mem_tag_t Mem_SetTag (const mem_tag_t tag)
+{
+	const mem_tag_t previous = mem_current_tag;
+	mem_current_tag = tag;
+	return previous;
+}
+
+/*
+====================
+Mem_LuaAlloc
+
+lua_Alloc compatible, charged to MEM_TAG_LUA.
+ud is NULL or a mem_lua_stats_t for the state.
+====================
+*/
+void *Mem_LuaAlloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	mem_lua_stats_t *stats = (mem_lua_stats_t *)ud;
+
+	// osize is the type of the object for new blocks
+	if (stats)
+	{
+		stats->bytes += nsize - (ptr ? osize : 0);
+		stats->peak_bytes = q_max (stats->peak_bytes, stats->bytes);
+	}
+	if (nsize == 0)
+	{
+		Mem_Free (ptr);
+		return NULL;
+	}
+	if (!ptr)
+		return Mem_TrackedAlloc (nsize, MEM_TAG_LUA, false);
+	return Mem_Realloc (ptr, nsize);
+}
+
+/*
+====================
+Mem_GetTagStats
+====================
+*/
+const char *Mem_GetTagStats (const int tag, uint64_t *bytes, uint64_t *peak_bytes, uint64_t *allocations)
+{
+	if ((tag < 0) || (tag >= NUM_MEM_TAGS))
+		return NULL;
+	*bytes = Atomic_LoadUInt64 (&mem_tag_bytes[tag]);
+	*peak_bytes = Atomic_LoadUInt64 (&mem_tag_peak_bytes[tag]);
+	*allocations = Atomic_LoadUInt64 (&mem_tag_allocations[tag]);
+	return mem_tag_names[tag];
+}
+
+/*
+====================
+Mem_Stats_f
+====================
+*/
+void Mem_Stats_f (void)
+{
+	uint64_t total = 0;
+	uint64_t total_allocations = 0;
+
+	Con_Printf ("%-12s %10s %10s %10s\n", "tag", "KiB", "peak KiB", "blocks");
+	for (int i = 0; i < NUM_MEM_TAGS; ++i)
+	{
+		uint64_t	bytes, peak_bytes, allocations;
+		const char *name = Mem_GetTagStats (i, &bytes, &peak_bytes, &allocations);
+		Con_Printf ("%-12s %10" SDL_PRIu64 " %10" SDL_PRIu64 " %10" SDL_PRIu64 "\n", name, bytes / 1024, peak_bytes / 1024, allocations);
+		total += bytes;
+		total_allocations += allocations;
+	}
+	Con_Printf ("%-12s %10" SDL_PRIu64 " %10s %10" SDL_PRIu64 "\n", "total", total / 1024, "", total_allocations);
+}
+
+/*
+====================
+Mem_FrameFreeBlocks
+====================
+*/
+static void Mem_FrameFreeBlocks (mem_frame_block_t *block)
+{
+	while (block)
+	{
+		mem_frame_block_t *next = block->next;
+		Mem_Free (block);
+		block = next;
+	}
+}
+
+/*
+====================
+Mem_FrameNewBlock
+====================
+*/
+static mem_frame_block_t *Mem_FrameNewBlock (const size_t size)
+{
+	mem_frame_block_t *block = (mem_frame_block_t *)Mem_AllocNonZero (sizeof (mem_frame_block_t) + size);
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	block->base = 0;
+	return block;
+}
+
+/*
+====================
+Mem_FrameAlloc
+
+16 byte aligned, not zeroed. Only valid until the mark taken before it is
+released or the owning thread resets its arena.
+====================
+*/
+void *Mem_FrameAlloc (const size_t size)
+{
+	const size_t	   aligned_size = (size + FRAME_ARENA_ALIGNMENT - 1) & ~(size_t)(FRAME_ARENA_ALIGNMENT - 1);
+	mem_frame_block_t *block = frame_arena_current;
+
+	if (!block || ((block->used + aligned_size) > block->size))
+	{
+		mem_frame_block_t *next = block ? block->next : frame_arena_first;
+		if (next && (next->size < aligned_size))
+		{
+			Mem_FrameFreeBlocks (next);
+			next = NULL;
+		}
+		if (!next)
+		{
+			next = Mem_FrameNewBlock (q_max (aligned_size, (size_t)FRAME_ARENA_BLOCK_SIZE));
+			if (block)
+				block->next = next;
+			else
+				frame_arena_first = next;
+		}
+		next->used = 0;
+		next->base = block ? (block->base + block->used) : 0;
+		frame_arena_current = block = next;
+	}
+
+	void *ptr = (byte *)(block + 1) + block->used;
+	block->used += aligned_size;
+
+	const uint64_t used = block->base + block->used;
+	uint64_t	   peak = Atomic_LoadUInt64 (&frame_arena_peak);
+	while ((used > peak) && !Atomic_CompareExchangeUInt64 (&frame_arena_peak, &peak, used))
+	{
+	}
+
+	return ptr;
+}
+
+/*
+====================
+Mem_FrameMark
+====================
+*/
+mem_frame_mark_t Mem_FrameMark (void)
+{
+	mem_frame_mark_t mark;
+	mark.block = frame_arena_current;
+	mark.used = frame_arena_current ? frame_arena_current->used : 0;
+	return mark;
+}
+
+/*
+====================
+Mem_FrameRelease
+
+Frees everything allocated on this thread since the mark was taken
+====================
+*/
+void Mem_FrameRelease (const mem_frame_mark_t mark)
+{
+	mem_frame_block_t *block = mark.block ? mark.block : frame_arena_first;
+	if (!block)
+		return;
+
+#ifdef _DEBUG
+	for (mem_frame_block_t *poison = block; poison; poison = poison->next)
+	{
+		const size_t from = (poison == block) ? mark.used : 0;
+		assert (poison->used >= from);
+		memset ((byte *)(poison + 1) + from, FRAME_ARENA_POISON, poison->used - from);
+		if (poison == frame_arena_current)
+			break;
+	}
 #endif
+
+	block->used = mark.used;
+	frame_arena_current = block;
+}
+
+/*
+====================
+Mem_FrameReset
+
+Releases the whole arena of this thread. If the frame needed more than one
+block they are merged, so a steady workload ends up with a single block.
+====================
+*/
+void Mem_FrameReset (void)
+{
+	const mem_frame_mark_t start = {NULL, 0};
+	Mem_FrameRelease (start);
+
+	if (frame_arena_first && frame_arena_first->next)
+	{
+		size_t total_size = 0;
+		for (mem_frame_block_t *block = frame_arena_first; block; block = block->next)
+			total_size += block->size;
+		Mem_FrameFreeBlocks (frame_arena_first);
+		frame_arena_first = frame_arena_current = Mem_FrameNewBlock (total_size);
+	}
+}
+
+/*
+====================
+Mem_FrameTakePeak
+
+Highest usage of any single thread's arena since the last call
+====================
+*/
+size_t Mem_FrameTakePeak (void)
+{
+	uint64_t peak = Atomic_LoadUInt64 (&frame_arena_peak);
+	while (!Atomic_CompareExchangeUInt64 (&frame_arena_peak, &peak, 0))
+	{
+	}
+	return (size_t)peak;
 }
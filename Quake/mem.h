@@ -32,6 +32,53 @@ void *Mem_AllocNonZero (const size_t size);
 void *Mem_Realloc (void *ptr, const size_t size);
 void  Mem_Free (const void *ptr);
 
+// Allocations are charged to the calling thread's current tag, subsystems
+// bracket their work with prev = Mem_SetTag (tag) ... Mem_SetTag (prev).
+// The values are mirrored in src/internal/engine_bridge.h.
+typedef enum
+{
+	MEM_TAG_MISC,
+	MEM_TAG_SERVER,
+	MEM_TAG_CLIENT,
+	MEM_TAG_MODELS,
+	MEM_TAG_SOUND,
+	MEM_TAG_TEXTURES,
+	MEM_TAG_UI,
+	MEM_TAG_LUA,
+	MEM_TAG_QC_STRINGS,
+	NUM_MEM_TAGS
+} mem_tag_t;
+
+// Optional Mem_LuaAlloc userdata, the bytes held by one lua_State
+typedef struct mem_lua_stats_s
+{
+	size_t bytes;
+	size_t peak_bytes;
+} mem_lua_stats_t;
+
+mem_tag_t	Mem_SetTag (const mem_tag_t tag);
+void	   *Mem_AllocTagged (const size_t size, const mem_tag_t tag);
+void	   *Mem_LuaAlloc (void *ud, void *ptr, size_t osize, size_t nsize);
+const char *Mem_GetTagStats (const int tag, uint64_t *bytes, uint64_t *peak_bytes, uint64_t *allocations);
+void		Mem_Stats_f (void);
+
+// Per thread linear arena for memory that doesn't outlive the frame. Nested users
+// take a mark and release back to it, the main thread resets its arena every host
+// frame. Workers must release everything they allocate before the task returns.
+// Memory is not zeroed, released memory is poisoned in debug builds.
+
+typedef struct mem_frame_mark_s
+{
+	struct mem_frame_block_s *block;
+	size_t					  used;
+} mem_frame_mark_t;
+
+void			*Mem_FrameAlloc (const size_t size);
+mem_frame_mark_t Mem_FrameMark (void);
+void			 Mem_FrameRelease (const mem_frame_mark_t mark);
+void			 Mem_FrameReset (void);
+size_t			 Mem_FrameTakePeak (void);
+
 // clang-format off
 
 #define SAFE_FREE(ptr)  \
@@ -852,11 +852,10 @@ int	 loadable[MAX_SAVEGAMES];
 
 static void M_ScanSaves (void)
 {
-	int	  i, j, k;
-	char  name[MAX_OSPATH];
-	FILE *f;
-	int	  version;
-	char *save_path = multiuser ? SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true)) : NULL;
+	int				  i, j, k;
+	char			  name[MAX_OSPATH];
+	const saveinfo_t *info;
+	char			 *save_path = multiuser ? SDL_GetPrefPath ("vkQuake", COM_GetGameNames (true)) : NULL;
 
 	for (i = 0; i < MAX_SAVEGAMES; i++)
 	{
@@ -868,14 +867,11 @@ static void M_ScanSaves (void)
 				q_snprintf (name, sizeof (name), "%ss%i.sav", save_path, i);
 			else
 				q_snprintf (name, sizeof (name), "%s/s%i.sav", com_gamedir, i);
-			f = fopen (name, "r");
-			if (!f)
+			// the comments come from the save index, only changed saves are opened
+			info = SaveList_GetInfo (name);
+			if (!info)
 				continue;
-			if (fscanf (f, "%i\n", &version) != 1)
-				continue;
-			if (fscanf (f, "%79s\n", name) != 1)
-				continue;
-			q_strlcpy (m_filenames[i], name, SAVEGAME_COMMENT_LENGTH + 1);
+			q_strlcpy (m_filenames[i], info->comment, SAVEGAME_COMMENT_LENGTH + 1);
 
 			// change _ back to space
 			for (k = 0; k < SAVEGAME_COMMENT_LENGTH; k++)
@@ -884,10 +880,10 @@ static void M_ScanSaves (void)
 					m_filenames[i][k] = ' ';
 			}
 			loadable[i] = true;
-			fclose (f);
 			break;
 		}
 	}
+	SaveList_WriteIndex ();
 
 	SDL_free (save_path);
 }
@@ -3542,9 +3538,8 @@ static void M_Search_Key (int key) {}
 //=============================================================================
 /* SLIST MENU */
 
-static int		slist_cursor;
-static int		slist_first;
-static qboolean slist_sorted;
+static int slist_cursor;
+static int slist_first;
 #define SERVER_LIST_MAX_ON_SCREEN 21
 
 static void M_Menu_ServerList_f (void)
@@ -3557,7 +3552,6 @@ static void M_Menu_ServerList_f (void)
 	slist_first = 0;
 	m_return_onerror = false;
 	m_return_reason[0] = 0;
-	slist_sorted = false;
 }
 
 static void M_ServerList_Draw (cb_context_t *cbx)
@@ -3565,11 +3559,8 @@ static void M_ServerList_Draw (cb_context_t *cbx)
 	size_t	n;
 	qpic_t *p;
 
-	if (!slist_sorted)
-	{
-		slist_sorted = true;
-		NET_SlistSort ();
-	}
+	// only sorts the servers that answered since the last frame
+	NET_SlistSort ();
 
 	if (hostCacheCount > SERVER_LIST_MAX_ON_SCREEN)
 		M_DrawScrollbar (cbx, 0, 40, (float)(slist_first) / (hostCacheCount - SERVER_LIST_MAX_ON_SCREEN), SERVER_LIST_MAX_ON_SCREEN - 2);
@@ -3609,7 +3600,6 @@ static void M_ServerList_Key (int k)
 		S_LocalSound ("misc/menu2.wav");
 		m_return_state = m_state;
 		m_return_onerror = true;
-		slist_sorted = false;
 		IN_Activate ();
 		key_dest = key_game;
 		m_state = m_none;
@@ -40,8 +40,9 @@ extern int net_hostport;
 
 extern cvar_t hostname;
 
-extern double	 net_time;
-extern sizebuf_t net_message;
+// per thread, the threaded server reads its own messages
+extern THREAD_LOCAL double	  net_time;
+extern THREAD_LOCAL sizebuf_t net_message;
 extern int		 net_activeconnections;
 extern qboolean	 listening;
 
@@ -57,12 +58,18 @@ struct qsocket_s *NET_Connect (const char *host);
 // called by client to connect to a host.  Returns -1 if not able to
 
 double		NET_QSocketGetTime (const struct qsocket_s *sock);
+double		NET_QSocketGetPacketTime (const struct qsocket_s *sock);
 const char *NET_QSocketGetTrueAddressString (const struct qsocket_s *sock);
 const char *NET_QSocketGetMaskedAddressString (const struct qsocket_s *sock);
 qboolean	NET_QSocketGetProQuakeAngleHack (const struct qsocket_s *sock);
 int			NET_QSocketGetSequenceIn (const struct qsocket_s *sock);
 int			NET_QSocketGetSequenceOut (const struct qsocket_s *sock);
 void		NET_QSocketSetMSS (struct qsocket_s *s, int mss);
+qboolean	NET_QSocketSetReliableWindow (struct qsocket_s *s, qboolean enable);
+qboolean	NET_QSocketSetDeflate (struct qsocket_s *s, qboolean enable, qboolean unreliable);
+qboolean	NET_QSocketSetInflate (struct qsocket_s *s, const byte *dictionary, int size);
+// vkQuake deflate extension: the server's next reliable message goes out as is and becomes the
+// dictionary both ends prime their window with, the client passes it once it parses it.
 
 qboolean NET_CanSendMessage (struct qsocket_s *sock);
 // Returns true or false if the given qsocket can currently accept a
@@ -88,6 +95,9 @@ int NET_SendUnreliableMessage (struct qsocket_s *sock, sizebuf_t *data);
 // returns 1 if the message was sent properly
 // returns -1 if the connection died
 
+void NET_GetByteCounts (uint64_t *received, uint64_t *sent);
+// payload bytes of the messages received and sent on non-loopback sockets since startup
+
 int NET_SendToAll (sizebuf_t *data, double blocktime);
 // This is a reliable *blocking* send to all attached clients.
 
@@ -102,6 +112,9 @@ void NET_Close (struct qsocket_s *sock);
 
 void NET_Poll (void);
 
+// while on, the lan drivers may queue datagrams and send them together when it is turned off
+void NET_SetBatching (qboolean batch);
+
 // Server list related globals:
 extern qboolean slistInProgress;
 extern qboolean slist_silent;
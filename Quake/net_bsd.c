@@ -62,7 +62,8 @@ net_landriver_t net_landrivers[] = {
 	 UDP4_GetAddrFromName,
 	 UDP_AddrCompare,
 	 UDP_GetSocketPort,
-	 UDP_SetSocketPort},
+	 UDP_SetSocketPort,
+	 UDP_SetBatching},
 	{"UDP6",
 	 false,
 	 0,
@@ -84,6 +85,7 @@ net_landriver_t net_landrivers[] = {
 	 UDP6_GetAddrFromName,
 	 UDP_AddrCompare,
 	 UDP_GetSocketPort,
-	 UDP_SetSocketPort}};
+	 UDP_SetSocketPort,
+	 UDP_SetBatching}};
 
 const int net_numlandrivers = (sizeof (net_landrivers) / sizeof (net_landrivers[0]));
@@ -47,6 +47,8 @@ struct qsockaddr
 #define NET_HEADERSIZE	 (2 * sizeof (unsigned int))
 #define NET_DATAGRAMSIZE (MAX_DATAGRAM + NET_HEADERSIZE)
 
+#define NET_RELIABLE_WINDOW 8 // reliable fragments in flight once the peer negotiated VKPEXT_RELIABLEWINDOW, see NET_QSocketSetReliableWindow
+
 // NetHeader flags
 #define NETFLAG_LENGTH_MASK 0x0000ffff
 #define NETFLAG_DATA		0x00010000
@@ -147,6 +149,7 @@ typedef struct qsocket_s
 	double			  connecttime;
 	double			  lastMessageTime;
 	double			  lastSendTime;
+	double			  packettime; // Sys_DoubleTime the last message arrived at, see NET_QSocketGetPacketTime
 
 	qboolean isvirtual; // qsocket is emulated by the network layer (closing will not close any system sockets).
 	qboolean disconnected;
@@ -164,11 +167,23 @@ typedef struct qsocket_s
 	int			 sendMessageLength;
 	byte		 sendMessage[NET_MAXMESSAGE];
 
+	int			 reliableWindow;					// fragments of the reliable that may be in flight, 1 unless the peer buffers out of order ones
+	unsigned int fragmentAcked;						// selectively acked fragments, bit per sequence % NET_RELIABLE_WINDOW
+	unsigned int fragmentResent;					// resent fragments, their acks are ambiguous and give no rtt sample
+	double		 fragmentTime[NET_RELIABLE_WINDOW];	// when each fragment in flight was last sent
+	double		 rtt;								// smoothed round trip time of the reliable fragments, 0 until the first ack
+	double		 rttvar;
+
 	unsigned int receiveSequence;
 	unsigned int unreliableReceiveSequence;
 	int			 receiveMessageLength;
 	byte		 receiveMessage[NET_MAXMESSAGE * NET_LOOPBACKBUFFERS + NET_LOOPBACKHEADERSIZE];
 
+	unsigned int reorderHeld; // fragments that arrived ahead of receiveSequence, bit per sequence % NET_RELIABLE_WINDOW
+	unsigned int reorderFlags[NET_RELIABLE_WINDOW];
+	int			 reorderLength[NET_RELIABLE_WINDOW];
+	byte		 reorderData[NET_RELIABLE_WINDOW][DATAGRAM_MTU];
+
 	struct qsockaddr addr;
 	char			 trueaddress[NET_NAMELEN];	 // lazy address string
 	char			 maskedaddress[NET_NAMELEN]; // addresses for this player that may be displayed publically
@@ -176,6 +191,10 @@ typedef struct qsocket_s
 	qboolean proquake_angle_hack;  // 1 if we're trying, 2 if the server acked.
 	int		 max_datagram;		   // 32000 for local, 1442 for 666, 1024 for 15. this is for reliable fragments.
 	int		 pending_max_datagram; // don't change the mtu if we're resending, as that would confuse the peer.
+
+	struct netdeflate_s *deflate;			 // sending end of the deflated reliable stream, see NET_QSocketSetDeflate
+	struct netinflate_s *inflate;			 // receiving end, see NET_QSocketSetInflate
+	qboolean			 deflate_unreliable; // large unreliables are deflated on their own too
 } qsocket_t;
 
 extern qsocket_t *net_activeSockets;
@@ -206,6 +225,7 @@ typedef struct
 	int (*AddrCompare) (struct qsockaddr *addr1, struct qsockaddr *addr2);
 	int (*GetSocketPort) (struct qsockaddr *addr);
 	int (*SetSocketPort) (struct qsockaddr *addr, int port);
+	void (*SetBatching) (qboolean batch); // optional: while on, Write may queue datagrams, turning it off sends them
 
 	sys_socket_t listeningSock;
 } net_landriver_t;
@@ -240,7 +260,9 @@ extern const int	net_numdrivers;
 /* Loop driver must always be registered the first */
 #define IS_LOOP_DRIVER(p) ((p) == 0)
 
-extern int net_driverlevel;
+extern THREAD_LOCAL int net_driverlevel;
+
+extern THREAD_LOCAL double net_packettime; // arrival time of the datagram a lan driver Read returned last, net_time if it doesn't know
 
 extern int messagesSent;
 extern int messagesReceived;
@@ -148,12 +148,94 @@ static void NET_Ban_f (void)
 }
 #endif // BAN_TEST
 
-int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
+/*
+===================
+Reliable window
+
+A reliable is split into max_datagram sized fragments, fragment n of what is
+left of it has the sequence ackSequence + n. Up to reliableWindow of them are in
+flight at once, vanilla peers get one at a time. Acks are cumulative, carrying
+the last fragment received in order, and a mask of the ones held beyond the gap
+when there are any. Fragments are resent once they are older than a timeout
+derived from the round trip time, rather than after a fixed second, and at
+that second again if it was lost too.
+===================
+*/
+#define NET_RESEND_MIN 0.1
+#define NET_RESEND_MAX 1.0
+
+static double Datagram_ResendTimeout (const qsocket_t *sock)
+{
+	if (!sock->rtt)
+		return NET_RESEND_MAX;
+	return CLAMP (NET_RESEND_MIN, sock->rtt + 4 * sock->rttvar, NET_RESEND_MAX);
+}
+
+static void Datagram_SampleRTT (qsocket_t *sock, double sample)
+{ // jacobson/karels, as tcp does it
+	if (!sock->rtt)
+	{
+		sock->rtt = sample;
+		sock->rttvar = sample / 2;
+		return;
+	}
+	sock->rttvar += (fabs (sample - sock->rtt) - sock->rttvar) / 4;
+	sock->rtt += (sample - sock->rtt) / 8;
+}
+
+static int SendFragment (qsocket_t *sock, unsigned int sequence)
 {
 	unsigned int packetLen;
 	unsigned int dataLen;
 	unsigned int eom;
+	int			 offset = (sequence - sock->ackSequence) * sock->max_datagram;
+
+	if (sock->sendMessageLength - offset <= sock->max_datagram)
+	{
+		dataLen = sock->sendMessageLength - offset;
+		eom = NETFLAG_EOM;
+	}
+	else
+	{
+		dataLen = sock->max_datagram;
+		eom = 0;
+	}
+	packetLen = NET_HEADERSIZE + dataLen;
+
+	packetBuffer.length = BigLong (packetLen | (NETFLAG_DATA | eom));
+	packetBuffer.sequence = BigLong (sequence);
+	memcpy (packetBuffer.data, sock->sendMessage + offset, dataLen);
+
+	sock->fragmentTime[sequence % NET_RELIABLE_WINDOW] = net_time;
+	sock->lastSendTime = net_time;
 
+	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+		return -1;
+	return 1;
+}
+
+static int SendMessageNext (qsocket_t *sock)
+{
+	unsigned int bit;
+	int			 window = (sock->max_datagram <= DATAGRAM_MTU) ? sock->reliableWindow : 1; // the peer can't hold larger ones
+
+	while (sock->sendNext && (int)(sock->sendSequence - sock->ackSequence) < window)
+	{
+		if ((int)(sock->sendSequence - sock->ackSequence + 1) * sock->max_datagram >= sock->sendMessageLength)
+			sock->sendNext = false; // the eom goes out now
+
+		bit = 1u << (sock->sendSequence % NET_RELIABLE_WINDOW);
+		sock->fragmentAcked &= ~bit;
+		sock->fragmentResent &= ~bit;
+		if (SendFragment (sock, sock->sendSequence++) == -1)
+			return -1;
+		packetsSent++;
+	}
+	return 1;
+}
+
+int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
+{
 #ifdef DEBUG
 	if (data->cursize == 0)
 		Sys_Error ("Datagram_SendMessage: zero length message");
@@ -170,92 +252,171 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	sock->max_datagram = sock->pending_max_datagram; // this can apply only at the start of a reliable, to avoid issues with acks if its resized later.
 
-	if (data->cursize <= sock->max_datagram)
-	{
-		dataLen = data->cursize;
-		eom = NETFLAG_EOM;
-	}
-	else
-	{
-		dataLen = sock->max_datagram;
-		eom = 0;
-	}
-	packetLen = NET_HEADERSIZE + dataLen;
-
-	packetBuffer.length = BigLong (packetLen | (NETFLAG_DATA | eom));
-	packetBuffer.sequence = BigLong (sock->sendSequence++);
-	memcpy (packetBuffer.data, sock->sendMessage, dataLen);
-
 	sock->canSend = false;
+	sock->sendNext = true;
+	return SendMessageNext (sock);
+}
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
-		return -1;
+static int ReSendMessage (qsocket_t *sock)
+{
+	unsigned int sequence;
+	unsigned int bit;
+	double		 timeout = Datagram_ResendTimeout (sock);
 
-	sock->lastSendTime = net_time;
-	packetsSent++;
+	for (sequence = sock->ackSequence; sequence != sock->sendSequence; sequence++)
+	{
+		bit = 1u << (sequence % NET_RELIABLE_WINDOW);
+		if (sock->fragmentAcked & bit)
+			continue;
+		if (net_time - sock->fragmentTime[sequence % NET_RELIABLE_WINDOW] <= ((sock->fragmentResent & bit) ? NET_RESEND_MAX : timeout))
+			continue; // only the first resend is early, in case the link is just congested
+
+		sock->fragmentResent |= bit;
+		if (SendFragment (sock, sequence) == -1)
+			return -1;
+		packetsReSent++;
+	}
 	return 1;
 }
 
-static int SendMessageNext (qsocket_t *sock)
+/*
+===================
+Datagram_ReceiveAck
+
+Retires the fragments that the peer has, and lets the rest of the reliable or
+the next one go out
+===================
+*/
+static void Datagram_ReceiveAck (qsocket_t *sock, unsigned int sequence, unsigned int length)
 {
-	unsigned int packetLen;
-	unsigned int dataLen;
-	unsigned int eom;
+	unsigned int inflight = sock->sendSequence - sock->ackSequence;
+	unsigned int cumulative = sequence - sock->ackSequence; // in order up to this fragment, past inflight when it covers none of them
+	unsigned int held = 0;
+	unsigned int fragment, bit, n;
+	int			 retired;
+
+	if (length >= NET_HEADERSIZE + 4)
+		held = BigLong (*(unsigned int *)packetBuffer.data); // bit n is sequence + 1 + n
+
+	for (n = 0; n < inflight; n++)
+	{
+		fragment = sock->ackSequence + n;
+		if ((cumulative >= inflight || n > cumulative) && (fragment - sequence - 1 >= NET_RELIABLE_WINDOW || !(held & (1u << (fragment - sequence - 1)))))
+			continue; // neither in order nor held past the gap
+		bit = 1u << (fragment % NET_RELIABLE_WINDOW);
+		if (sock->fragmentAcked & bit)
+			continue;
+		sock->fragmentAcked |= bit;
+		if (!(sock->fragmentResent & bit))
+			Datagram_SampleRTT (sock, net_time - sock->fragmentTime[fragment % NET_RELIABLE_WINDOW]);
+	}
 
-	if (sock->sendMessageLength <= sock->max_datagram)
+	if (cumulative >= inflight)
 	{
-		dataLen = sock->sendMessageLength;
-		eom = NETFLAG_EOM;
+		Con_DPrintf ("Stale ACK received\n");
+		return;
 	}
+
+	for (n = 0; n <= cumulative; n++)
+		sock->fragmentAcked &= ~(1u << ((sock->ackSequence + n) % NET_RELIABLE_WINDOW));
+	sock->ackSequence = sequence + 1;
+
+	retired = (cumulative + 1) * sock->max_datagram;
+	sock->sendMessageLength -= retired;
+	if (sock->sendMessageLength > 0)
+		memmove (sock->sendMessage, sock->sendMessage + retired, sock->sendMessageLength);
 	else
 	{
-		dataLen = sock->max_datagram;
-		eom = 0;
+		sock->sendMessageLength = 0;
+		sock->sendNext = false;
+		sock->canSend = true;
 	}
-	packetLen = NET_HEADERSIZE + dataLen;
+}
 
-	packetBuffer.length = BigLong (packetLen | (NETFLAG_DATA | eom));
-	packetBuffer.sequence = BigLong (sock->sendSequence++);
-	memcpy (packetBuffer.data, sock->sendMessage, dataLen);
+static void Datagram_SendAck (qsocket_t *sock, struct qsockaddr *addr)
+{
+	unsigned int packetLen = NET_HEADERSIZE;
+	unsigned int held = 0;
+	unsigned int n;
+
+	for (n = 1; n < NET_RELIABLE_WINDOW; n++)
+		if (sock->reorderHeld & (1u << ((sock->receiveSequence + n) % NET_RELIABLE_WINDOW)))
+			held |= 1u << n;
+
+	packetBuffer.sequence = BigLong (sock->receiveSequence - 1);
+	if (held)
+	{ // only windowed senders get fragments ahead of the gap, older peers never see the mask
+		*(unsigned int *)packetBuffer.data = BigLong (held);
+		packetLen += 4;
+	}
+	packetBuffer.length = BigLong (packetLen | NETFLAG_ACK);
+	sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, addr);
+}
 
-	sock->sendNext = false;
+static int Datagram_AppendFragment (qsocket_t *sock, unsigned int flags, const byte *data, unsigned int length)
+{
+	sock->receiveSequence++;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
-		return -1;
+	if (flags & NETFLAG_EOM)
+	{
+		if (sock->receiveMessageLength + length > (unsigned int)net_message.maxsize)
+		{
+			Con_Printf ("Over-sized reliable\n");
+			return -1;
+		}
+		SZ_Clear (&net_message);
+		SZ_Write (&net_message, sock->receiveMessage, sock->receiveMessageLength);
+		SZ_Write (&net_message, data, length);
+		sock->receiveMessageLength = 0;
+		return 1;
+	}
 
-	sock->lastSendTime = net_time;
-	packetsSent++;
-	return 1;
+	if (sock->receiveMessageLength + length > sizeof (sock->receiveMessage))
+	{
+		Con_Printf ("Over-sized reliable\n");
+		return -1;
+	}
+	memcpy (sock->receiveMessage + sock->receiveMessageLength, data, length);
+	sock->receiveMessageLength += length;
+	return 0;
 }
 
-static int ReSendMessage (qsocket_t *sock)
+/*
+===================
+Datagram_ReceiveData
+
+Fragments that arrive ahead of a lost one are held until it is resent, the
+window never spans two reliables so they can't run past its eom.
+Returns 1 when net_message holds a complete reliable, -1 when it was too big
+===================
+*/
+static int Datagram_ReceiveData (qsocket_t *sock, unsigned int sequence, unsigned int flags, unsigned int length, struct qsockaddr *addr)
 {
-	unsigned int packetLen;
-	unsigned int dataLen;
-	unsigned int eom;
+	unsigned int ahead = sequence - sock->receiveSequence;
+	unsigned int slot = sequence % NET_RELIABLE_WINDOW;
+	int			 ret = 0;
 
-	if (sock->sendMessageLength <= sock->max_datagram)
+	if (!ahead)
 	{
-		dataLen = sock->sendMessageLength;
-		eom = NETFLAG_EOM;
+		ret = Datagram_AppendFragment (sock, flags, packetBuffer.data, length);
+		while (!ret && (sock->reorderHeld & (1u << (slot = sock->receiveSequence % NET_RELIABLE_WINDOW))))
+		{
+			sock->reorderHeld &= ~(1u << slot);
+			ret = Datagram_AppendFragment (sock, sock->reorderFlags[slot], sock->reorderData[slot], sock->reorderLength[slot]);
+		}
 	}
-	else
+	else if (ahead < NET_RELIABLE_WINDOW && length <= DATAGRAM_MTU && !(sock->reorderHeld & (1u << slot)))
 	{
-		dataLen = sock->max_datagram;
-		eom = 0;
+		sock->reorderHeld |= 1u << slot;
+		sock->reorderFlags[slot] = flags;
+		sock->reorderLength[slot] = length;
+		memcpy (sock->reorderData[slot], packetBuffer.data, length);
 	}
-	packetLen = NET_HEADERSIZE + dataLen;
-
-	packetBuffer.length = BigLong (packetLen | (NETFLAG_DATA | eom));
-	packetBuffer.sequence = BigLong (sock->sendSequence - 1);
-	memcpy (packetBuffer.data, sock->sendMessage, dataLen);
-
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
-		return -1;
+	else
+		receivedDuplicateCount++;
 
-	sock->lastSendTime = net_time;
-	packetsReSent++;
-	return 1;
+	Datagram_SendAck (sock, addr);
+	return ret;
 }
 
 qboolean Datagram_CanSendMessage (qsocket_t *sock)
@@ -351,75 +512,22 @@ qboolean Datagram_ProcessPacket (unsigned int length, qsocket_t *sock)
 
 	if (flags & NETFLAG_ACK)
 	{
-		if (sequence != (sock->sendSequence - 1))
-		{
-			Con_DPrintf ("Stale ACK received\n");
-			return false;
-		}
-		if (sequence == sock->ackSequence)
-		{
-			sock->ackSequence++;
-			if (sock->ackSequence != sock->sendSequence)
-				Con_DPrintf ("ack sequencing error\n");
-		}
-		else
-		{
-			Con_DPrintf ("Duplicate ACK received\n");
-			return false;
-		}
-		sock->sendMessageLength -= sock->max_datagram;
-		if (sock->sendMessageLength > 0)
-		{
-			memmove (sock->sendMessage, sock->sendMessage + sock->max_datagram, sock->sendMessageLength);
-			sock->sendNext = true;
-		}
-		else
-		{
-			sock->sendMessageLength = 0;
-			sock->canSend = true;
-		}
+		Datagram_ReceiveAck (sock, sequence, length);
 		return false;
 	}
 
 	if (flags & NETFLAG_DATA)
 	{
-		packetBuffer.length = BigLong (NET_HEADERSIZE | NETFLAG_ACK);
-		packetBuffer.sequence = BigLong (sequence);
-		sfunc.Write (sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &sock->addr);
-
-		if (sequence != sock->receiveSequence)
-		{
-			receivedDuplicateCount++;
-			return false;
-		}
-		sock->receiveSequence++;
-
-		length -= NET_HEADERSIZE;
-
-		if (flags & NETFLAG_EOM)
+		switch (Datagram_ReceiveData (sock, sequence, flags, length - NET_HEADERSIZE, &sock->addr))
 		{
-			if (sock->receiveMessageLength + length > (unsigned int)net_message.maxsize)
-			{
-				Con_Printf ("Over-sized reliable\n");
-				return true;
-			}
-			SZ_Clear (&net_message);
-			SZ_Write (&net_message, sock->receiveMessage, sock->receiveMessageLength);
-			SZ_Write (&net_message, packetBuffer.data, length);
-			sock->receiveMessageLength = 0;
-
+		case 1:
 			messagesReceived++;
 			return true; // parse this reliable!
-		}
-
-		if (sock->receiveMessageLength + length > sizeof (sock->receiveMessage))
-		{
-			Con_Printf ("Over-sized reliable\n");
+		case -1:
 			return true;
+		default:
+			return false; // still waiting for the eom
 		}
-		memcpy (sock->receiveMessage + sock->receiveMessageLength, packetBuffer.data, length);
-		sock->receiveMessageLength += length;
-		return false; // still watiting for the eom
 	}
 	// unknown flags
 	Con_DPrintf ("Unknown packet flags\n");
@@ -472,6 +580,7 @@ qsocket_t *Datagram_GetAnyMessage (void)
 					if (Datagram_ProcessPacket (length, s))
 					{
 						s->lastMessageTime = net_time;
+						s->packettime = net_packettime;
 						return s; // the server needs to parse that packet.
 					}
 				}
@@ -489,8 +598,7 @@ qsocket_t *Datagram_GetAnyMessage (void)
 		if (s->sendNext)
 			SendMessageNext (s);
 		if (!s->canSend)
-			if ((net_time - s->lastSendTime) > 1.0)
-				ReSendMessage (s);
+			ReSendMessage (s);
 
 		if (net_time - s->lastMessageTime > ((!s->ackSequence) ? net_connecttimeout.value : net_messagetimeout.value))
 		{ // timed out, kick them
@@ -521,8 +629,7 @@ int Datagram_GetMessage (qsocket_t *sock)
 	unsigned int	 count;
 
 	if (!sock->canSend)
-		if ((net_time - sock->lastSendTime) > 1.0)
-			ReSendMessage (sock);
+		ReSendMessage (sock);
 
 	while (1)
 	{
@@ -591,81 +698,25 @@ int Datagram_GetMessage (qsocket_t *sock)
 
 		if (flags & NETFLAG_ACK)
 		{
-			if (sequence != (sock->sendSequence - 1))
-			{
-				Con_DPrintf ("Stale ACK received\n");
-				continue;
-			}
-			if (sequence == sock->ackSequence)
-			{
-				sock->ackSequence++;
-				if (sock->ackSequence != sock->sendSequence)
-					Con_DPrintf ("ack sequencing error\n");
-			}
-			else
-			{
-				Con_DPrintf ("Duplicate ACK received\n");
-				continue;
-			}
-			sock->sendMessageLength -= sock->max_datagram;
-			if (sock->sendMessageLength > 0)
-			{
-				memmove (sock->sendMessage, sock->sendMessage + sock->max_datagram, sock->sendMessageLength);
-				sock->sendNext = true;
-			}
-			else
-			{
-				sock->sendMessageLength = 0;
-				sock->canSend = true;
-			}
+			Datagram_ReceiveAck (sock, sequence, length);
 			continue;
 		}
 
 		if (flags & NETFLAG_DATA)
 		{
-			packetBuffer.length = BigLong (NET_HEADERSIZE | NETFLAG_ACK);
-			packetBuffer.sequence = BigLong (sequence);
-			sfunc.Write (sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &readaddr);
-
-			if (sequence != sock->receiveSequence)
-			{
-				receivedDuplicateCount++;
-				continue;
-			}
-			sock->receiveSequence++;
-
-			length -= NET_HEADERSIZE;
-
-			if (flags & NETFLAG_EOM)
-			{
-				if (sock->receiveMessageLength + length > (unsigned int)net_message.maxsize)
-				{
-					Con_Printf ("Over-sized reliable\n");
-					return -1;
-				}
-				SZ_Clear (&net_message);
-				SZ_Write (&net_message, sock->receiveMessage, sock->receiveMessageLength);
-				SZ_Write (&net_message, packetBuffer.data, length);
-				sock->receiveMessageLength = 0;
-
-				ret = 1;
-				break;
-			}
-
-			if (sock->receiveMessageLength + length > sizeof (sock->receiveMessage))
-			{
-				Con_Printf ("Over-sized reliable\n");
+			ret = Datagram_ReceiveData (sock, sequence, flags, length - NET_HEADERSIZE, &readaddr);
+			if (ret == -1)
 				return -1;
-			}
-			memcpy (sock->receiveMessage + sock->receiveMessageLength, packetBuffer.data, length);
-			sock->receiveMessageLength += length;
-			continue;
+			if (ret)
+				break;
 		}
 	}
 
 	if (sock->sendNext)
 		SendMessageNext (sock);
 
+	if (ret > 0)
+		sock->packettime = net_packettime;
 	return ret;
 }
 
@@ -1641,25 +1692,64 @@ static struct
 }		   *hostlist;
 size_t		hostlist_count;
 size_t		hostlist_max;
+
+// open addressing index into hostlist, entries are index + 1 and 0 is free.
+// master servers list thousands of addresses, this keeps each lookup constant.
+static size_t *hostlist_hash;
+static size_t  hostlist_hash_size; // power of two, at least twice hostlist_max
+
+static size_t _Datagram_HostHash (const struct qsockaddr *addr, int driver)
+{
+	const byte *data = (const byte *)addr;
+	uint32_t	hash = 2166136261u ^ (uint32_t)driver; // FNV-1a
+	size_t		i;
+	for (i = 0; i < sizeof (*addr); i++)
+		hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+static void _Datagram_InsertHostHash (size_t index)
+{
+	size_t slot = _Datagram_HostHash (&hostlist[index].addr, hostlist[index].driver) & (hostlist_hash_size - 1);
+	while (hostlist_hash[slot])
+		slot = (slot + 1) & (hostlist_hash_size - 1);
+	hostlist_hash[slot] = index + 1;
+}
+
 static void _Datagram_AddPossibleHost (struct qsockaddr *addr, qboolean master)
 {
 	size_t u;
-	for (u = 0; u < hostlist_count; u++)
+	size_t slot;
+
+	if (hostlist_hash_size)
 	{
-		if (!memcmp (&hostlist[u].addr, addr, sizeof (struct qsockaddr)) && hostlist[u].driver == net_landriverlevel)
-		{ // we already know about it. it must have come from some other master. don't respam.
-			return;
+		for (slot = _Datagram_HostHash (addr, net_landriverlevel) & (hostlist_hash_size - 1); hostlist_hash[slot];
+			 slot = (slot + 1) & (hostlist_hash_size - 1))
+		{
+			u = hostlist_hash[slot] - 1;
+			if (!memcmp (&hostlist[u].addr, addr, sizeof (struct qsockaddr)) && hostlist[u].driver == net_landriverlevel)
+			{ // we already know about it. it must have come from some other master. don't respam.
+				return;
+			}
 		}
 	}
 	if (hostlist_count == hostlist_max)
 	{
-		hostlist_max = hostlist_count + 16;
+		hostlist_max = q_max (hostlist_count * 2, (size_t)16);
 		hostlist = Mem_Realloc (hostlist, sizeof (*hostlist) * hostlist_max);
+
+		Mem_Free (hostlist_hash);
+		for (hostlist_hash_size = 32; hostlist_hash_size < hostlist_max * 2;)
+			hostlist_hash_size *= 2;
+		hostlist_hash = Mem_Alloc (sizeof (*hostlist_hash) * hostlist_hash_size);
+		for (u = 0; u < hostlist_count; u++)
+			_Datagram_InsertHostHash (u);
 	}
 	hostlist[hostlist_count].addr = *addr;
 	hostlist[hostlist_count].requery = true;
 	hostlist[hostlist_count].master = master;
 	hostlist[hostlist_count].driver = net_landriverlevel;
+	_Datagram_InsertHostHash (hostlist_count);
 	hostlist_count++;
 }
 
@@ -30,10 +30,15 @@ static qboolean	  localconnectpending = false;
 static qsocket_t *loop_client = NULL;
 static qsocket_t *loop_server = NULL;
 
+// the threaded server reads and writes its end of the loopback next to the client
+static SDL_Mutex *loop_mutex;
+
 int Loop_Init (void)
 {
 	if (cls.state == ca_dedicated)
 		return -1;
+	if (!loop_mutex)
+		loop_mutex = SDL_CreateMutex ();
 	return 0;
 }
 
@@ -122,7 +127,7 @@ static int IntAlign (int value)
 	return (value + (sizeof (int) - 1)) & (~(sizeof (int) - 1));
 }
 
-int Loop_GetMessage (qsocket_t *sock)
+static int Loop_ReadMessage (qsocket_t *sock)
 {
 	int ret;
 	int length;
@@ -159,6 +164,16 @@ int Loop_GetMessage (qsocket_t *sock)
 	return ret;
 }
 
+int Loop_GetMessage (qsocket_t *sock)
+{
+	int ret;
+
+	SDL_LockMutex (loop_mutex);
+	ret = Loop_ReadMessage (sock);
+	SDL_UnlockMutex (loop_mutex);
+	return ret;
+}
+
 qsocket_t *Loop_GetAnyMessage (void)
 {
 	if (loop_server)
@@ -169,7 +184,7 @@ qsocket_t *Loop_GetAnyMessage (void)
 	return NULL;
 }
 
-int Loop_SendMessage (qsocket_t *sock, sizebuf_t *data)
+static int Loop_WriteMessage (qsocket_t *sock, sizebuf_t *data)
 {
 	byte *buffer;
 	int	 *bufferLength;
@@ -202,7 +217,17 @@ int Loop_SendMessage (qsocket_t *sock, sizebuf_t *data)
 	return 1;
 }
 
-int Loop_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+int Loop_SendMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	int ret;
+
+	SDL_LockMutex (loop_mutex);
+	ret = Loop_WriteMessage (sock, data);
+	SDL_UnlockMutex (loop_mutex);
+	return ret;
+}
+
+static int Loop_WriteUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 {
 	byte *buffer;
 	int	 *bufferLength;
@@ -240,6 +265,16 @@ int Loop_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	return 1;
 }
 
+int Loop_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	int ret;
+
+	SDL_LockMutex (loop_mutex);
+	ret = Loop_WriteUnreliableMessage (sock, data);
+	SDL_UnlockMutex (loop_mutex);
+	return ret;
+}
+
 qboolean Loop_CanSendMessage (qsocket_t *sock)
 {
 	if (!sock->driverdata)
@@ -254,6 +289,7 @@ qboolean Loop_CanSendUnreliableMessage (qsocket_t *sock)
 
 void Loop_Close (qsocket_t *sock)
 {
+	SDL_LockMutex (loop_mutex);
 	if (sock->driverdata)
 		((qsocket_t *)sock->driverdata)->driverdata = NULL;
 	sock->receiveMessageLength = 0;
@@ -263,4 +299,5 @@ void Loop_Close (qsocket_t *sock)
 		loop_client = NULL;
 	else
 		loop_server = NULL;
+	SDL_UnlockMutex (loop_mutex);
 }
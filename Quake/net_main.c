@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "arch_def.h"
 #include "net_sys.h"
 #include "net_defs.h"
+#include "miniz.h"
 
 qsocket_t *net_activeSockets = NULL;
 qsocket_t *net_freeSockets = NULL;
@@ -48,20 +49,25 @@ enum slistScope_e slist_scope = SLIST_LOOP;
 static double	  slistStartTime;
 static double	  slistActiveTime;
 static int		  slistLastShown;
+static size_t	  slistSortedCount; // hostcache entries NET_SlistSort already put in order
 
 static void			 Slist_Send (void *);
 static void			 Slist_Poll (void *);
 static PollProcedure slistSendProcedure = {NULL, 0.0, Slist_Send};
 static PollProcedure slistPollProcedure = {NULL, 0.0, Slist_Poll};
 
-sizebuf_t net_message;
-int		  net_activeconnections = 0;
+THREAD_LOCAL sizebuf_t net_message;
+int					  net_activeconnections = 0;
 
 int messagesSent = 0;
 int messagesReceived = 0;
 int unreliableMessagesSent = 0;
 int unreliableMessagesReceived = 0;
 
+// payload bytes of non-loopback messages, the server thread sends too
+static atomic_uint64_t net_bytes_received;
+static atomic_uint64_t net_bytes_sent;
+
 cvar_t net_messagetimeout = {"net_messagetimeout", "300", CVAR_NONE};
 cvar_t net_connecttimeout = {"net_connecttimeout", "10", CVAR_NONE}; // this might be a little brief, but we don't have a way to protect against smurf attacks.
 cvar_t hostname = {"hostname", "UNNAMED", CVAR_SERVERINFO};
@@ -70,9 +76,10 @@ cvar_t hostname = {"hostname", "UNNAMED", CVAR_SERVERINFO};
 #define sfunc net_drivers[sock->driver]
 #define dfunc net_drivers[net_driverlevel]
 
-int net_driverlevel;
+THREAD_LOCAL int net_driverlevel;
 
-double net_time;
+THREAD_LOCAL double net_time;
+THREAD_LOCAL double net_packettime;
 
 double SetNetTime (void)
 {
@@ -121,11 +128,18 @@ qsocket_t *NET_NewQSocket (void)
 	sock->sendSequence = 0;
 	sock->unreliableSendSequence = 0;
 	sock->sendMessageLength = 0;
+	sock->reliableWindow = 1;
+	sock->fragmentAcked = 0;
+	sock->fragmentResent = 0;
+	sock->rtt = 0;
+	sock->rttvar = 0;
 	sock->receiveSequence = 0;
 	sock->unreliableReceiveSequence = 0;
 	sock->receiveMessageLength = 0;
+	sock->reorderHeld = 0;
 	sock->pending_max_datagram = 1024;
 	sock->proquake_angle_hack = false;
+	sock->deflate_unreliable = false;
 
 	return sock;
 }
@@ -152,6 +166,9 @@ void NET_FreeQSocket (qsocket_t *sock)
 			Sys_Error ("NET_FreeQSocket: not active");
 	}
 
+	NET_QSocketSetDeflate (sock, false, false);
+	NET_QSocketSetInflate (sock, NULL, 0);
+
 	// add it to free list
 	sock->next = net_freeSockets;
 	net_freeSockets = sock;
@@ -170,6 +187,10 @@ double NET_QSocketGetTime (const qsocket_t *s)
 {
 	return s->connecttime;
 }
+double NET_QSocketGetPacketTime (const qsocket_t *s)
+{ // when the last message was received, more accurate than net_time when the network thread timestamped it
+	return s->packettime;
+}
 
 const char *NET_QSocketGetTrueAddressString (const qsocket_t *s)
 {
@@ -191,6 +212,272 @@ void NET_QSocketSetMSS (qsocket_t *s, int mss)
 	s->pending_max_datagram = mss;
 }
 
+/*
+===================
+NET_QSocketSetReliableWindow
+
+Lets several fragments of a reliable be in flight at once. Only for peers that
+negotiated VKPEXT_RELIABLEWINDOW, older ones ack fragments that they then drop
+because they arrived out of order. Our receiving end always holds those and
+acks cumulatively, so this only changes how we send
+===================
+*/
+qboolean NET_QSocketSetReliableWindow (qsocket_t *s, qboolean enable)
+{
+	if (!s)
+		return false;
+	if (!enable || IS_LOOP_DRIVER (s->driver))
+	{ // loopback has no fragments
+		s->reliableWindow = 1;
+		return false;
+	}
+	s->reliableWindow = NET_RELIABLE_WINDOW;
+	return true;
+}
+
+/*
+===================
+Deflated messages
+
+Reliable messages are one raw deflate stream per connection, flushed at the end
+of each message so that they can be inflated as they arrive, with the message
+that carried svc_serverinfo and so the precache names as the initial window.
+Unreliables can be lost, each one is a complete stream of its own.
+Messages that are too short to gain anything are sent as they are, they don't
+go through the stream on either end.
+===================
+*/
+#define NET_DEFLATE_MIN_RELIABLE   64
+#define NET_DEFLATE_MIN_UNRELIABLE 256
+#define NET_DEFLATE_MAX			   (NET_MAXMESSAGE - 1024) // leaves room for the stored blocks of incompressible data
+#define NET_DEFLATE_RAW			   -15					   // window bits, negative for no zlib header
+
+typedef struct netdeflate_s
+{
+	tdefl_compressor compressor;
+	qboolean		 primed;
+} netdeflate_t;
+
+typedef struct netinflate_s
+{
+	tinfl_decompressor decompressor;
+	byte			   window[TINFL_LZ_DICT_SIZE];
+	size_t			   window_ofs;
+} netinflate_t;
+
+static byte			 net_deflatebuf[NET_MAXMESSAGE];
+static tdefl_compressor *net_unreliable_compressor;
+
+/*
+===================
+NET_DeflateFlush
+
+Returns the compressed size, -1 if the compressor could not take it all
+===================
+*/
+static int NET_DeflateFlush (tdefl_compressor *compressor, const byte *data, int size, byte *out, int outsize, tdefl_flush flush)
+{
+	size_t in_bytes = size;
+	size_t out_bytes = outsize;
+
+	if (tdefl_compress (compressor, data, &in_bytes, out, &out_bytes, flush) < TDEFL_STATUS_OKAY || in_bytes != (size_t)size ||
+		compressor->m_output_flush_remaining)
+		return -1;
+	return (int)out_bytes;
+}
+
+/*
+===================
+NET_QSocketSetDeflate
+
+Called by the server when it sends svc_serverinfo, restarts the reliable stream
+===================
+*/
+qboolean NET_QSocketSetDeflate (qsocket_t *s, qboolean enable, qboolean unreliable)
+{
+	if (!s)
+		return false;
+	if (!enable || IS_LOOP_DRIVER (s->driver))
+	{ // nothing to gain over loopback
+		Mem_Free (s->deflate);
+		s->deflate = NULL;
+		s->deflate_unreliable = false;
+		return false;
+	}
+
+	if (!s->deflate)
+		s->deflate = Mem_AllocNonZero (sizeof (netdeflate_t));
+	tdefl_init (&s->deflate->compressor, NULL, NULL, tdefl_create_comp_flags_from_zip_params (6, NET_DEFLATE_RAW, 0));
+	s->deflate->primed = false;
+	s->deflate_unreliable = unreliable;
+	return true;
+}
+
+/*
+===================
+NET_InflateStream
+
+Runs the input through the reliable stream, the output goes to out unless it is
+NULL. Returns the inflated size, -1 on corrupt input or if out is too small
+===================
+*/
+static int NET_InflateStream (netinflate_t *inflate, const byte *in, size_t insize, byte *out, size_t outsize)
+{
+	size_t		 total = 0;
+	size_t		 in_bytes, out_bytes;
+	tinfl_status status;
+
+	do
+	{
+		in_bytes = insize;
+		out_bytes = TINFL_LZ_DICT_SIZE - inflate->window_ofs;
+		status = tinfl_decompress (
+			&inflate->decompressor, in, &in_bytes, inflate->window, inflate->window + inflate->window_ofs, &out_bytes, TINFL_FLAG_HAS_MORE_INPUT);
+		if (status < TINFL_STATUS_DONE)
+			return -1;
+		if (out)
+		{
+			if (total + out_bytes > outsize)
+				return -1;
+			memcpy (out + total, inflate->window + inflate->window_ofs, out_bytes);
+		}
+		in += in_bytes;
+		insize -= in_bytes;
+		total += out_bytes;
+		inflate->window_ofs = (inflate->window_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+	} while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+	return (int)total;
+}
+
+/*
+===================
+NET_DeflateMessage
+
+Returns the message to send in place of data
+===================
+*/
+static sizebuf_t *NET_DeflateMessage (qsocket_t *sock, sizebuf_t *data, sizebuf_t *deflated, qboolean reliable)
+{
+	int size;
+
+	if (reliable)
+	{
+		if (!sock->deflate->primed)
+		{ // sent as is for the client to prime its window with, only the end of it can be matched against
+			size = q_min (data->cursize, TDEFL_LZ_DICT_SIZE);
+			if (NET_DeflateFlush (
+					&sock->deflate->compressor, data->data + data->cursize - size, size, net_deflatebuf, sizeof (net_deflatebuf), TDEFL_SYNC_FLUSH) < 0)
+				return NULL;
+			sock->deflate->primed = true;
+			return data;
+		}
+		if (data->cursize < NET_DEFLATE_MIN_RELIABLE || data->cursize > NET_DEFLATE_MAX)
+			return data;
+		// once the stream has taken it, the message has to go out deflated
+		size = NET_DeflateFlush (&sock->deflate->compressor, data->data, data->cursize, net_deflatebuf + 1, sizeof (net_deflatebuf) - 1, TDEFL_SYNC_FLUSH);
+		if (size < 0)
+			return NULL;
+		net_deflatebuf[0] = svcvk_deflated;
+	}
+	else
+	{
+		if (data->cursize < NET_DEFLATE_MIN_UNRELIABLE || data->cursize > NET_DEFLATE_MAX)
+			return data;
+		if (!net_unreliable_compressor)
+			net_unreliable_compressor = Mem_AllocNonZero (sizeof (tdefl_compressor));
+		tdefl_init (
+			net_unreliable_compressor, NULL, NULL,
+			tdefl_create_comp_flags_from_zip_params (1, NET_DEFLATE_RAW, 0) | TDEFL_NONDETERMINISTIC_PARSING_FLAG);
+		size = NET_DeflateFlush (net_unreliable_compressor, data->data, data->cursize, net_deflatebuf + 1, sizeof (net_deflatebuf) - 1, TDEFL_FINISH);
+		if (size < 0 || size + 1 >= data->cursize)
+			return data;
+		net_deflatebuf[0] = svcvk_deflateddatagram;
+	}
+
+	memset (deflated, 0, sizeof (*deflated));
+	deflated->data = net_deflatebuf;
+	deflated->maxsize = sizeof (net_deflatebuf);
+	deflated->cursize = size + 1;
+	return deflated;
+}
+
+/*
+===================
+NET_InflateMessage
+
+Replaces a deflated net_message with its contents, returns false if it's corrupt
+===================
+*/
+static qboolean NET_InflateMessage (qsocket_t *sock, int type)
+{
+	static byte inflated[NET_MAXMESSAGE];
+	int			size;
+
+	if (!net_message.cursize)
+		return true;
+	if (type == 1 && net_message.data[0] == svcvk_deflated)
+		size = NET_InflateStream (sock->inflate, net_message.data + 1, net_message.cursize - 1, inflated, sizeof (inflated));
+	else if (type == 2 && net_message.data[0] == svcvk_deflateddatagram)
+	{
+		size_t result = tinfl_decompress_mem_to_mem (inflated, sizeof (inflated), net_message.data + 1, net_message.cursize - 1, 0);
+		size = (result == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED) ? -1 : (int)result;
+	}
+	else
+		return true;
+
+	if (size < 0 || size > net_message.maxsize)
+		return false;
+	memcpy (net_message.data, inflated, size);
+	net_message.cursize = size;
+	return true;
+}
+
+/*
+===================
+NET_QSocketSetInflate
+
+Called by the client with the message that carried svc_serverinfo, or NULL
+if the server didn't enable the extension
+===================
+*/
+qboolean NET_QSocketSetInflate (qsocket_t *s, const byte *dictionary, int size)
+{
+	byte header[5];
+	int	 i, len;
+
+	if (!s)
+		return false;
+	if (!dictionary)
+	{
+		Mem_Free (s->inflate);
+		s->inflate = NULL;
+		return false;
+	}
+
+	if (!s->inflate)
+		s->inflate = Mem_AllocNonZero (sizeof (netinflate_t));
+	tinfl_init (&s->inflate->decompressor);
+	s->inflate->window_ofs = 0;
+
+	// tinfl has no way to preset a dictionary, so it gets the one the server compressed as stored blocks instead
+	for (i = 0; i < size; i += len)
+	{
+		len = q_min (size - i, 0xffff);
+		header[0] = 0; // not final, stored
+		header[1] = len & 0xff;
+		header[2] = len >> 8;
+		header[3] = ~len & 0xff;
+		header[4] = (~len >> 8) & 0xff;
+		if (NET_InflateStream (s->inflate, header, sizeof (header), NULL, 0) < 0 || NET_InflateStream (s->inflate, dictionary + i, len, NULL, 0) != len)
+		{
+			NET_QSocketSetInflate (s, NULL, 0);
+			return false;
+		}
+	}
+	return true;
+}
+
 static void NET_Listen_f (void)
 {
 	if (Cmd_Argc () != 2)
@@ -322,27 +609,35 @@ void NET_Slist_f (void)
 	SchedulePollProcedure (&slistPollProcedure, 0.1);
 
 	hostCacheCount = 0;
+	slistSortedCount = 0;
 }
 
+/*
+===================
+NET_SlistSort
+
+Servers are only ever appended to the cache, so each call insertion sorts the ones that
+answered since the last call into the sorted front. Cheap enough to call every frame.
+===================
+*/
 void NET_SlistSort (void)
 {
-	if (hostCacheCount > 1)
+	size_t		i, j;
+	hostcache_t temp;
+
+	if (slistSortedCount > hostCacheCount)
+		slistSortedCount = hostCacheCount;
+	for (i = q_max (slistSortedCount, (size_t)1); i < hostCacheCount; i++)
 	{
-		size_t		i, j;
-		hostcache_t temp;
-		for (i = 0; i < hostCacheCount; i++)
-		{
-			for (j = i + 1; j < hostCacheCount; j++)
-			{
-				if (strcmp (hostcache[j].name, hostcache[i].name) < 0)
-				{
-					memcpy (&temp, &hostcache[j], sizeof (hostcache_t));
-					memcpy (&hostcache[j], &hostcache[i], sizeof (hostcache_t));
-					memcpy (&hostcache[i], &temp, sizeof (hostcache_t));
-				}
-			}
-		}
+		for (j = i; j > 0 && strcmp (hostcache[i].name, hostcache[j - 1].name) < 0; j--)
+			;
+		if (j == i)
+			continue;
+		memcpy (&temp, &hostcache[i], sizeof (hostcache_t));
+		memmove (&hostcache[j + 1], &hostcache[j], (i - j) * sizeof (hostcache_t));
+		memcpy (&hostcache[j], &temp, sizeof (hostcache_t));
 	}
+	slistSortedCount = hostCacheCount;
 }
 
 const char *NET_SlistPrintServer (size_t idx)
@@ -576,8 +871,15 @@ int NET_GetMessage (qsocket_t *sock)
 	}
 
 	SetNetTime ();
+	net_packettime = net_time;
 
 	ret = sfunc.QGetMessage (sock);
+	if (ret > 0 && sock->inflate && !NET_InflateMessage (sock, ret))
+	{
+		Con_Printf ("NET_GetMessage: corrupt deflated message\n");
+		NET_Close (sock);
+		return -1;
+	}
 
 	// see if this connection has timed out
 	if (ret == 0 && !IS_LOOP_DRIVER (sock->driver))
@@ -594,11 +896,14 @@ int NET_GetMessage (qsocket_t *sock)
 		if (!IS_LOOP_DRIVER (sock->driver))
 		{
 			sock->lastMessageTime = net_time;
+			Atomic_AddUInt64 (&net_bytes_received, net_message.cursize);
 			if (ret == 1)
 				messagesReceived++;
 			else if (ret == 2)
 				unreliableMessagesReceived++;
 		}
+		else
+			sock->packettime = net_time;
 	}
 
 	return ret;
@@ -616,6 +921,7 @@ returns the qsocket that the message was meant to be for.
 qsocket_t *NET_GetServerMessage (void)
 {
 	qsocket_t *s;
+	net_packettime = net_time;
 	for (net_driverlevel = 0; net_driverlevel < net_numdrivers; net_driverlevel++)
 	{
 		if (!net_drivers[net_driverlevel].initialized)
@@ -657,7 +963,8 @@ returns -1 if the connection died
 */
 int NET_SendMessage (qsocket_t *sock, sizebuf_t *data)
 {
-	int r;
+	int		  r;
+	sizebuf_t deflated;
 
 	if (!sock)
 		return -1;
@@ -669,16 +976,25 @@ int NET_SendMessage (qsocket_t *sock, sizebuf_t *data)
 	}
 
 	SetNetTime ();
+	if (sock->deflate && !(data = NET_DeflateMessage (sock, data, &deflated, true)))
+	{
+		Con_Printf ("NET_SendMessage: deflate failed\n");
+		return -1;
+	}
 	r = sfunc.QSendMessage (sock, data);
 	if (r == 1 && !IS_LOOP_DRIVER (sock->driver))
+	{
 		messagesSent++;
+		Atomic_AddUInt64 (&net_bytes_sent, data->cursize);
+	}
 
 	return r;
 }
 
 int NET_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 {
-	int r;
+	int		  r;
+	sizebuf_t deflated;
 
 	if (!sock)
 		return -1;
@@ -690,13 +1006,31 @@ int NET_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	}
 
 	SetNetTime ();
+	if (sock->deflate_unreliable && sock->deflate->primed)
+		data = NET_DeflateMessage (sock, data, &deflated, false);
 	r = sfunc.SendUnreliableMessage (sock, data);
 	if (r == 1 && !IS_LOOP_DRIVER (sock->driver))
+	{
 		unreliableMessagesSent++;
+		Atomic_AddUInt64 (&net_bytes_sent, data->cursize);
+	}
 
 	return r;
 }
 
+/*
+==================
+NET_GetByteCounts
+
+Totals since startup, see the frame stats
+==================
+*/
+void NET_GetByteCounts (uint64_t *received, uint64_t *sent)
+{
+	*received = Atomic_LoadUInt64 (&net_bytes_received);
+	*sent = Atomic_LoadUInt64 (&net_bytes_sent);
+}
+
 /*
 ==================
 NET_CanSendMessage
@@ -910,6 +1244,17 @@ void NET_Shutdown (void)
 	}
 }
 
+void NET_SetBatching (qboolean batch)
+{
+	int i;
+
+	for (i = 0; i < net_numlandrivers; i++)
+	{
+		if (net_landrivers[i].initialized && net_landrivers[i].SetBatching)
+			net_landrivers[i].SetBatching (batch);
+	}
+}
+
 static PollProcedure *pollProcedureList = NULL;
 
 void NET_Poll (void)
@@ -26,6 +26,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 #include "net_defs.h"
 
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define UDP_BATCHING // recvmmsg/sendmmsg
+#endif
+
 static sys_socket_t		  net_acceptsocket4 = INVALID_SOCKET; // socket for fielding new connections
 static sys_socket_t		  net_controlsocket4;
 static sys_socket_t		  net_broadcastsocket4 = INVALID_SOCKET;
@@ -40,6 +44,10 @@ static struct in6_addr myAddrv6;
 
 #include "net_udp.h"
 
+static qboolean udp_threaded; // sockets are drained by UDP_IOThread, -nonetthread reads them from the frame
+static void		UDP_AddQueue (sys_socket_t socketid);
+static void		UDP_RemoveQueue (sys_socket_t socketid);
+
 //=============================================================================
 
 sys_socket_t UDP4_Init (void)
@@ -50,6 +58,8 @@ sys_socket_t UDP4_Init (void)
 	if (COM_CheckParm ("-noudp") || COM_CheckParm ("-noudp4"))
 		return INVALID_SOCKET;
 
+	udp_threaded = !COM_CheckParm ("-nonetthread");
+
 	myAddr4 = htonl (INADDR_LOOPBACK);
 #ifdef __linux__
 	// gethostbyname(gethostname()) is only supported if the hostname can be looked up on an actual name server
@@ -176,7 +186,10 @@ sys_socket_t UDP4_OpenSocket (int port)
 	address.sin_addr.s_addr = INADDR_ANY;
 	address.sin_port = htons ((unsigned short)port);
 	if (bind (newsocket, (struct sockaddr *)&address, sizeof (address)) == 0)
+	{
+		UDP_AddQueue (newsocket);
 		return newsocket;
+	}
 
 ErrorReturn:
 	err = SOCKETERRNO;
@@ -187,8 +200,12 @@ ErrorReturn:
 
 //=============================================================================
 
+static void UDP_DropBatches (sys_socket_t socketid);
+
 int UDP_CloseSocket (sys_socket_t socketid)
 {
+	UDP_RemoveQueue (socketid);
+	UDP_DropBatches (socketid);
 	if (socketid == net_broadcastsocket4)
 		net_broadcastsocket4 = INVALID_SOCKET;
 	return closesocket (socketid);
@@ -282,10 +299,449 @@ sys_socket_t UDP4_CheckNewConnections (void)
 
 //=============================================================================
 
+#ifdef UDP_BATCHING
+#define UDP_RECV_BATCH		32
+#define UDP_SEND_BATCH		64
+#define UDP_SEND_BATCH_SIZE (256 * 1024)
+
+// datagrams received by the last recvmmsg, handed out by UDP_Read one by one
+static sys_socket_t		udp_recvsocket = INVALID_SOCKET;
+static int				udp_recvcount;
+static int				udp_recvnext;
+static struct mmsghdr	udp_recvmsgs[UDP_RECV_BATCH];
+static struct iovec		udp_recviov[UDP_RECV_BATCH];
+static struct qsockaddr udp_recvaddrs[UDP_RECV_BATCH];
+static byte				udp_recvbufs[UDP_RECV_BATCH][NET_DATAGRAMSIZE];
+
+// datagrams queued by UDP_Write while batching, all to the same socket
+static qboolean			udp_batching;
+static sys_socket_t		udp_sendsocket = INVALID_SOCKET;
+static int				udp_sendcount;
+static int				udp_sendsize;
+static struct mmsghdr	udp_sendmsgs[UDP_SEND_BATCH];
+static struct iovec		udp_sendiov[UDP_SEND_BATCH];
+static struct qsockaddr udp_sendaddrs[UDP_SEND_BATCH];
+static byte				udp_sendbuf[UDP_SEND_BATCH_SIZE];
+
+/*
+============
+UDP_FlushSends
+============
+*/
+static void UDP_FlushSends (void)
+{
+	int sent = 0;
+
+	while (sent < udp_sendcount)
+	{
+		int ret = sendmmsg (udp_sendsocket, udp_sendmsgs + sent, udp_sendcount - sent, 0);
+		if (ret <= 0)
+		{
+			int err = SOCKETERRNO;
+			if (ret == SOCKET_ERROR && err != NET_EWOULDBLOCK)
+				Con_SafePrintf ("UDP_Write, sendmmsg: %s (%s)\n", socketerror (err), UDP_AddrToString (&udp_sendaddrs[sent], false));
+			// drop it, like a lost packet, and carry on with the rest
+			ret = 1;
+		}
+		sent += ret;
+	}
+
+	udp_sendcount = 0;
+	udp_sendsize = 0;
+}
+
+/*
+============
+UDP_QueueSend
+============
+*/
+static int UDP_QueueSend (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr, socklen_t addrsize)
+{
+	if (socketid != udp_sendsocket || udp_sendcount == UDP_SEND_BATCH || udp_sendsize + len > UDP_SEND_BATCH_SIZE)
+		UDP_FlushSends ();
+	if (len > UDP_SEND_BATCH_SIZE)
+		return -1; // can't happen with NET_DATAGRAMSIZE, let sendto deal with it
+
+	udp_sendsocket = socketid;
+	memcpy (udp_sendbuf + udp_sendsize, buf, len);
+	memcpy (&udp_sendaddrs[udp_sendcount], addr, addrsize);
+	udp_sendiov[udp_sendcount].iov_base = udp_sendbuf + udp_sendsize;
+	udp_sendiov[udp_sendcount].iov_len = len;
+	memset (&udp_sendmsgs[udp_sendcount], 0, sizeof (udp_sendmsgs[udp_sendcount]));
+	udp_sendmsgs[udp_sendcount].msg_hdr.msg_name = &udp_sendaddrs[udp_sendcount];
+	udp_sendmsgs[udp_sendcount].msg_hdr.msg_namelen = addrsize;
+	udp_sendmsgs[udp_sendcount].msg_hdr.msg_iov = &udp_sendiov[udp_sendcount];
+	udp_sendmsgs[udp_sendcount].msg_hdr.msg_iovlen = 1;
+	udp_sendcount++;
+	udp_sendsize += len;
+	return len;
+}
+
+/*
+============
+UDP_ReadBatch
+
+Drains up to UDP_RECV_BATCH datagrams from the socket with a single call
+============
+*/
+static int UDP_ReadBatch (sys_socket_t socketid)
+{
+	int i, ret;
+
+	for (i = 0; i < UDP_RECV_BATCH; i++)
+	{
+		udp_recviov[i].iov_base = udp_recvbufs[i];
+		udp_recviov[i].iov_len = sizeof (udp_recvbufs[i]);
+		memset (&udp_recvmsgs[i], 0, sizeof (udp_recvmsgs[i]));
+		udp_recvmsgs[i].msg_hdr.msg_name = &udp_recvaddrs[i];
+		udp_recvmsgs[i].msg_hdr.msg_namelen = sizeof (udp_recvaddrs[i]);
+		udp_recvmsgs[i].msg_hdr.msg_iov = &udp_recviov[i];
+		udp_recvmsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	udp_recvsocket = socketid;
+	udp_recvnext = 0;
+	udp_recvcount = 0;
+	ret = recvmmsg (socketid, udp_recvmsgs, UDP_RECV_BATCH, MSG_DONTWAIT, NULL);
+	if (ret == SOCKET_ERROR)
+	{
+		int err = SOCKETERRNO;
+		if (err == NET_EWOULDBLOCK || err == NET_ECONNREFUSED)
+			return 0;
+		Con_SafePrintf ("UDP_Read, recvmmsg: %s\n", socketerror (err));
+		return -1;
+	}
+	udp_recvcount = ret;
+	return ret;
+}
+#endif
+
+/*
+=============================================================================
+
+NETWORK I/O THREAD
+
+Every socket the drivers open is drained by a thread of its own that sleeps in
+select, so datagrams are timestamped when they arrive instead of when the next
+frame gets around to reading them. UDP_Read consumes them from a per socket
+ring that needs no lock, having a single writer and a single reader.
+
+=============================================================================
+*/
+
+#define UDP_QUEUE_SIZE		 (512 * 1024) // bytes, power of two
+#define UDP_MAX_QUEUES		 8			  // more sockets than that are read from the frame
+#define UDP_POLL_TIMEOUT	 10			  // ms, how late the thread may notice it has to stop
+#define UDP_RECORD_ALIGN(x)	 (((x) + 7) & ~7)
+#define UDP_RECORD_HEADER	 UDP_RECORD_ALIGN (sizeof (udprecord_t))
+#define UDP_RECORD_SIZE(len) (UDP_RECORD_HEADER + UDP_RECORD_ALIGN (len))
+
+// a queued datagram, its payload follows the header
+typedef struct
+{
+	double			 time;	 // Sys_DoubleTime it was received at
+	int				 length; // -1 skips to the start of the ring
+	int				 addrlen;
+	struct qsockaddr addr;
+} udprecord_t;
+
+typedef struct
+{
+	sys_socket_t	socket;
+	atomic_uint32_t head; // bytes written, only advanced by the thread
+	atomic_uint32_t tail; // bytes consumed, only advanced by UDP_Read
+	byte		   *ring;
+} udpqueue_t;
+
+// only changed while the thread is stopped
+static udpqueue_t udp_queues[UDP_MAX_QUEUES];
+static int		  udp_numqueues;
+
+static SDL_Thread	  *udp_thread;
+static atomic_uint32_t udp_threadquit;
+static byte			   udp_threadbuf[NET_DATAGRAMSIZE];
+
+/*
+============
+UDP_QueuePush
+
+Returns false if the ring is full, the datagram is then lost like any other
+============
+*/
+static qboolean UDP_QueuePush (udpqueue_t *q, int length, struct qsockaddr *addr, socklen_t addrlen, double time)
+{
+	const uint32_t head = Atomic_LoadUInt32 (&q->head);
+	const uint32_t tail = Atomic_LoadUInt32 (&q->tail);
+	const uint32_t size = UDP_RECORD_SIZE (length);
+	uint32_t	   ofs = head & (UDP_QUEUE_SIZE - 1);
+	uint32_t	   pad = 0;
+	udprecord_t	  *record;
+
+	// records are never split at the end of the ring
+	if (ofs + size > UDP_QUEUE_SIZE)
+		pad = UDP_QUEUE_SIZE - ofs;
+	if ((head - tail) + pad + size > UDP_QUEUE_SIZE)
+		return false;
+	if (pad >= UDP_RECORD_HEADER)
+		((udprecord_t *)(q->ring + ofs))->length = -1;
+
+	ofs = (head + pad) & (UDP_QUEUE_SIZE - 1);
+	record = (udprecord_t *)(q->ring + ofs);
+	record->time = time;
+	record->length = length;
+	record->addrlen = q_min ((int)addrlen, (int)sizeof (struct qsockaddr));
+	memcpy (&record->addr, addr, record->addrlen);
+	memcpy (q->ring + ofs + UDP_RECORD_HEADER, udp_threadbuf, length);
+
+	Atomic_StoreUInt32 (&q->head, head + pad + size);
+	return true;
+}
+
+/*
+============
+UDP_QueuePop
+============
+*/
+static int UDP_QueuePop (udpqueue_t *q, byte *buf, int len, struct qsockaddr *addr)
+{
+	const uint32_t head = Atomic_LoadUInt32 (&q->head);
+	uint32_t	   tail = Atomic_LoadUInt32 (&q->tail);
+
+	while (tail != head)
+	{
+		const uint32_t ofs = tail & (UDP_QUEUE_SIZE - 1);
+		udprecord_t	  *record = (udprecord_t *)(q->ring + ofs);
+		int			   ret;
+
+		if (UDP_QUEUE_SIZE - ofs < UDP_RECORD_HEADER || record->length < 0)
+		{
+			tail += UDP_QUEUE_SIZE - ofs;
+			continue;
+		}
+
+		ret = q_min (record->length, len);
+		memcpy (buf, q->ring + ofs + UDP_RECORD_HEADER, ret);
+		memcpy (addr, &record->addr, record->addrlen);
+		net_packettime = record->time;
+		Atomic_StoreUInt32 (&q->tail, tail + UDP_RECORD_SIZE (record->length));
+		return ret;
+	}
+
+	Atomic_StoreUInt32 (&q->tail, tail);
+	return 0;
+}
+
+/*
+============
+UDP_IOThread
+============
+*/
+static int UDP_IOThread (void *unused)
+{
+	while (!Atomic_LoadUInt32 (&udp_threadquit))
+	{
+		fd_set		   readable;
+		struct timeval timeout;
+		sys_socket_t   maxsocket = 0;
+		int			   i;
+
+		FD_ZERO (&readable);
+		for (i = 0; i < udp_numqueues; i++)
+		{
+			FD_SET (udp_queues[i].socket, &readable);
+			maxsocket = q_max (maxsocket, udp_queues[i].socket);
+		}
+		timeout.tv_sec = 0;
+		timeout.tv_usec = UDP_POLL_TIMEOUT * 1000;
+		if (select (maxsocket + 1, &readable, NULL, NULL, &timeout) <= 0)
+			continue;
+
+		for (i = 0; i < udp_numqueues; i++)
+		{
+			udpqueue_t *q = &udp_queues[i];
+
+			if (!FD_ISSET (q->socket, &readable))
+				continue;
+			while (1)
+			{
+				struct qsockaddr addr;
+				socklen_t		 addrlen = sizeof (addr);
+				int				 ret = recvfrom (q->socket, udp_threadbuf, sizeof (udp_threadbuf), 0, (struct sockaddr *)&addr, &addrlen);
+
+				// would block, or an error the connection timeouts take care of
+				if (ret == SOCKET_ERROR)
+					break;
+				UDP_QueuePush (q, ret, &addr, addrlen, Sys_DoubleTime ());
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+============
+UDP_StopThread
+============
+*/
+static void UDP_StopThread (void)
+{
+	if (!udp_thread)
+		return;
+	Atomic_StoreUInt32 (&udp_threadquit, 1);
+	SDL_WaitThread (udp_thread, NULL);
+	udp_thread = NULL;
+}
+
+/*
+============
+UDP_StartThread
+============
+*/
+static void UDP_StartThread (void)
+{
+	if (udp_thread || !udp_numqueues || !udp_threaded)
+		return;
+	Atomic_StoreUInt32 (&udp_threadquit, 0);
+	udp_thread = SDL_CreateThread (UDP_IOThread, "UDP_IOThread", NULL);
+	if (!udp_thread)
+	{
+		Con_SafePrintf ("UDP: unable to create the network thread, %s\n", SDL_GetError ());
+		udp_threaded = false;
+		while (udp_numqueues)
+			UDP_RemoveQueue (udp_queues[0].socket);
+	}
+}
+
+/*
+============
+UDP_FindQueue
+============
+*/
+static udpqueue_t *UDP_FindQueue (sys_socket_t socketid)
+{
+	int i;
+
+	for (i = 0; i < udp_numqueues; i++)
+		if (udp_queues[i].socket == socketid)
+			return &udp_queues[i];
+	return NULL;
+}
+
+/*
+============
+UDP_AddQueue
+
+Sockets are only opened and closed when connecting, listening or searching,
+restarting the thread around that keeps it from ever needing a lock
+============
+*/
+static void UDP_AddQueue (sys_socket_t socketid)
+{
+	udpqueue_t *q;
+
+	if (!udp_threaded || udp_numqueues == UDP_MAX_QUEUES)
+		return;
+#ifndef PLATFORM_WINDOWS
+	if (socketid >= FD_SETSIZE)
+		return;
+#endif
+
+	UDP_StopThread ();
+	q = &udp_queues[udp_numqueues++];
+	q->socket = socketid;
+	Atomic_StoreUInt32 (&q->head, 0);
+	Atomic_StoreUInt32 (&q->tail, 0);
+	q->ring = (byte *)Mem_AllocNonZero (UDP_QUEUE_SIZE);
+	UDP_StartThread ();
+}
+
+/*
+============
+UDP_RemoveQueue
+============
+*/
+static void UDP_RemoveQueue (sys_socket_t socketid)
+{
+	udpqueue_t *q = UDP_FindQueue (socketid);
+
+	if (!q)
+		return;
+
+	UDP_StopThread ();
+	Mem_Free (q->ring);
+	*q = udp_queues[--udp_numqueues];
+	UDP_StartThread ();
+}
+
+//=============================================================================
+
+/*
+============
+UDP_DropBatches
+
+Forgets anything batched for a socket that is going away
+============
+*/
+static void UDP_DropBatches (sys_socket_t socketid)
+{
+#ifdef UDP_BATCHING
+	if (socketid == udp_sendsocket)
+	{
+		UDP_FlushSends ();
+		udp_sendsocket = INVALID_SOCKET;
+	}
+	if (socketid == udp_recvsocket)
+	{
+		udp_recvsocket = INVALID_SOCKET;
+		udp_recvcount = udp_recvnext = 0;
+	}
+#endif
+}
+
+/*
+============
+UDP_SetBatching
+
+Shared by the UDP and UDP6 drivers, turning it on or off twice is harmless
+============
+*/
+void UDP_SetBatching (qboolean batch)
+{
+#ifdef UDP_BATCHING
+	if (!batch)
+		UDP_FlushSends ();
+	udp_batching = batch;
+#endif
+}
+
 int UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 {
-	socklen_t addrlen = sizeof (struct qsockaddr);
-	int		  ret;
+	socklen_t	addrlen = sizeof (struct qsockaddr);
+	udpqueue_t *q = UDP_FindQueue (socketid);
+	int			ret;
+
+	if (q)
+		return UDP_QueuePop (q, buf, len, addr);
+
+#ifdef UDP_BATCHING
+	// the batch is only refilled once empty, another socket read meanwhile goes through recvfrom
+	if (socketid == udp_recvsocket || udp_recvnext == udp_recvcount)
+	{
+		if (udp_recvnext == udp_recvcount)
+		{
+			ret = UDP_ReadBatch (socketid);
+			if (ret <= 0)
+				return ret;
+		}
+
+		const int i = udp_recvnext++;
+		ret = q_min ((int)udp_recvmsgs[i].msg_len, len);
+		memcpy (buf, udp_recvbufs[i], ret);
+		memcpy (addr, &udp_recvaddrs[i], q_min (udp_recvmsgs[i].msg_hdr.msg_namelen, sizeof (struct qsockaddr)));
+		return ret;
+	}
+#endif
 
 	ret = recvfrom (socketid, buf, len, 0, (struct sockaddr *)addr, &addrlen);
 	if (ret == SOCKET_ERROR)
@@ -354,6 +810,15 @@ int UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr
 		return -1; // some kind of error. a few systems get pissy if the size doesn't exactly match the address family
 	}
 
+#ifdef UDP_BATCHING
+	if (udp_batching)
+	{
+		ret = UDP_QueueSend (socketid, buf, len, addr, addrsize);
+		if (ret >= 0)
+			return ret;
+	}
+#endif
+
 	ret = sendto (socketid, buf, len, 0, (struct sockaddr *)addr, addrsize);
 	if (!hdr->qsa_family)
 		Con_SafePrintf ("UDP_Write: family was cleared\n");
@@ -574,6 +1039,8 @@ sys_socket_t UDP6_Init (void)
 	if (COM_CheckParm ("-noudp") || COM_CheckParm ("-noudp6"))
 		return INVALID_SOCKET;
 
+	udp_threaded = !COM_CheckParm ("-nonetthread");
+
 	// TODO: determine my name & address
 
 	if ((net_controlsocket6 = UDP6_OpenSocket (0)) == INVALID_SOCKET)
@@ -663,6 +1130,7 @@ sys_socket_t UDP6_OpenSocket (int port)
 		req.ipv6mr_interface = 0;
 		setsockopt (newsocket, IPPROTO_IPV6, IPV6_JOIN_GROUP, (char *)&req, sizeof (req));
 
+		UDP_AddQueue (newsocket);
 		return newsocket;
 	}
 
@@ -31,6 +31,7 @@ int			 UDP_Connect (sys_socket_t socketid, struct qsockaddr *addr);
 sys_socket_t UDP4_CheckNewConnections (void);
 int			 UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 int			 UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+void		 UDP_SetBatching (qboolean batch);
 int			 UDP4_Broadcast (sys_socket_t socketid, byte *buf, int len);
 const char	*UDP_AddrToString (struct qsockaddr *addr, qboolean masked);
 int			 UDP4_StringToAddr (const char *string, struct qsockaddr *addr);
@@ -18,7 +18,7 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
-/* crc.c */
+/* palette.c */
 
 #include "quakedef.h"
 #include "palette.h"
@@ -1021,35 +1021,53 @@ end_loops:
 
 /*
 =================
-MakeColorsLUT
+MakeColorsLUTSliceTask
+
+Fills one blue slice of the LUT, slices are independent
 =================
 */
-static void MakeColorsLUT (unsigned int *colors)
+static void MakeColorsLUTSliceTask (int b, unsigned int **colors)
 {
-	for (int b = 0; b < 256; ++b)
+	for (int g = 0; g < 256; ++g)
 	{
-		for (int g = 0; g < 256; ++g)
+		for (int r = 0; r < 256; ++r)
 		{
-			for (int r = 0; r < 256; ++r)
+			unsigned best_color = 0;
+			int		 best_dist_sq = INT_MAX;
+			for (int i = 0; i < 256; ++i)
 			{
-				unsigned best_color = 0;
-				int		 best_dist_sq = INT_MAX;
-				for (int i = 0; i < 256; ++i)
+				byte	 *c = (byte *)(&d_8to24table[i]);
+				const int dist_sq = (((int)c[0] - r) * ((int)c[0] - r)) + (((int)c[1] - g) * ((int)c[1] - g)) + (((int)c[2] - b) * ((int)c[2] - b));
+				if (dist_sq < best_dist_sq)
 				{
-					byte	 *c = (byte *)(&d_8to24table[i]);
-					const int dist_sq = (((int)c[0] - r) * ((int)c[0] - r)) + (((int)c[1] - g) * ((int)c[1] - g)) + (((int)c[2] - b) * ((int)c[2] - b));
-					if (dist_sq < best_dist_sq)
-					{
-						best_dist_sq = dist_sq;
-						best_color = d_8to24table[i];
-					}
+					best_dist_sq = dist_sq;
+					best_color = d_8to24table[i];
 				}
-				colors[r + (g * 256ull) + (b * 256ull * 256ull)] = best_color;
 			}
+			(*colors)[r + (g * 256ull) + (b * 256ull * 256ull)] = best_color;
 		}
 	}
 }
 
+/*
+=================
+MakeColorsLUT
+=================
+*/
+static void MakeColorsLUT (unsigned int *colors)
+{
+	if (!Tasks_IsWorker ())
+	{
+		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)MakeColorsLUTSliceTask, 256, &colors, sizeof (colors));
+		Task_Join (task, TASK_TIMEOUT_INFINITE);
+	}
+	else
+	{
+		for (int b = 0; b < 256; ++b)
+			MakeColorsLUTSliceTask (b, &colors);
+	}
+}
+
 /*
 =================
 CreatePaletteOctree_f
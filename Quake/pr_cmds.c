@@ -24,12 +24,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 // #define	STRINGTEMP_BUFFERS		16
 // #define	STRINGTEMP_LENGTH		1024
-static char pr_string_temp[STRINGTEMP_BUFFERS][STRINGTEMP_LENGTH];
-static byte pr_string_tempindex = 0;
-
 char *PR_GetTempString (void)
 {
-	return pr_string_temp[(STRINGTEMP_BUFFERS - 1) & ++pr_string_tempindex];
+	if (!qcvm->tempstrings)
+		qcvm->tempstrings = Mem_Alloc (STRINGTEMP_BUFFERS * STRINGTEMP_LENGTH);
+	return qcvm->tempstrings[(STRINGTEMP_BUFFERS - 1) & ++qcvm->tempstring_index];
 }
 
 #define RETURN_EDICT(e) (((int *)qcvm->globals)[OFS_RETURN] = EDICT_TO_PROG (e))
@@ -53,10 +52,10 @@ static const char *PF_GetStringArg (int idx, void *userdata)
 
 char *PF_VarString (int first)
 {
-	int			i;
-	static char out[1024];
-	const char *format;
-	size_t		s;
+	int						 i;
+	static THREAD_LOCAL char out[1024];
+	const char				*format;
+	size_t					 s;
 
 	out[0] = 0;
 	s = 0;
@@ -745,12 +744,12 @@ static int	 checkpvs_capacity;
 
 static int PF_newcheckclient (int check)
 {
-	int		 i;
-	byte	*pvs;
-	edict_t *ent;
-	mleaf_t *leaf;
-	vec3_t	 org;
-	int		 pvsbytes;
+	int			i;
+	const byte *pvs;
+	edict_t	   *ent;
+	mleaf_t	   *leaf;
+	vec3_t		org;
+	int			pvsbytes;
 
 	// cycle to the next one
 
@@ -788,7 +787,7 @@ static int PF_newcheckclient (int check)
 	// get the PVS for the entity
 	VectorAdd (ent->v.origin, ent->v.view_ofs, org);
 	leaf = Mod_PointInLeaf (org, qcvm->worldmodel);
-	pvs = Mod_LeafPVS (leaf, qcvm->worldmodel);
+	pvs = Mod_CachedLeafPVS (leaf, qcvm->worldmodel);
 
 	pvsbytes = (qcvm->worldmodel->numleafs + 31) >> 3;
 	if (checkpvs == NULL || pvsbytes > checkpvs_capacity)
@@ -947,6 +946,234 @@ static void PF_cvar_set (void)
 	Cvar_Set (var, val);
 }
 
+/*
+===============================================================================
+
+	FIELD MARKS
+
+===============================================================================
+*/
+
+const unsigned char pr_fieldmarks[sizeof (entvars_t) / 4] = {
+	[offsetof (entvars_t, origin) / 4 + 0] = ED_MARK_MOVED,	  [offsetof (entvars_t, origin) / 4 + 1] = ED_MARK_MOVED,
+	[offsetof (entvars_t, origin) / 4 + 2] = ED_MARK_MOVED,	  [offsetof (entvars_t, mins) / 4 + 0] = ED_MARK_MOVED,
+	[offsetof (entvars_t, mins) / 4 + 1] = ED_MARK_MOVED,	  [offsetof (entvars_t, mins) / 4 + 2] = ED_MARK_MOVED,
+	[offsetof (entvars_t, maxs) / 4 + 0] = ED_MARK_MOVED,	  [offsetof (entvars_t, maxs) / 4 + 1] = ED_MARK_MOVED,
+	[offsetof (entvars_t, maxs) / 4 + 2] = ED_MARK_MOVED,	  [offsetof (entvars_t, solid) / 4] = ED_MARK_MOVED,
+	[offsetof (entvars_t, classname) / 4] = ED_MARK_FIND (0), [offsetof (entvars_t, targetname) / 4] = ED_MARK_FIND (1),
+	[offsetof (entvars_t, target) / 4] = ED_MARK_FIND (2),
+};
+
+static const int pr_findfields[NUM_FIND_INDICES] = {
+	offsetof (entvars_t, classname) / 4,
+	offsetof (entvars_t, targetname) / 4,
+	offsetof (entvars_t, target) / 4,
+};
+
+/*
+=================
+PR_AppendEdictNum
+=================
+*/
+static void PR_AppendEdictNum (int **nums, int *count, int *max, int num)
+{
+	if (*count == *max)
+	{
+		*max = q_max (*max * 2, 64);
+		*nums = (int *)Mem_Realloc (*nums, *max * sizeof (int));
+	}
+	(*nums)[(*count)++] = num;
+}
+
+/*
+=================
+PR_CompactMovedEdicts
+
+Drops the edicts linked since they were marked, and those PF_InRadius skips
+until a write marks them again
+=================
+*/
+static void PR_CompactMovedEdicts (void)
+{
+	int		 i, j;
+	edict_t *ent;
+
+	for (i = j = 0; i < qcvm->num_moved_edicts; i++)
+	{
+		if (qcvm->moved_edicts[i] >= qcvm->num_edicts)
+			continue;
+		ent = EDICT_NUM (qcvm->moved_edicts[i]);
+		if (!(ent->fieldmarks & ED_MARK_MOVED))
+			continue;
+		if (ent->free || ent->v.solid == SOLID_NOT)
+		{
+			ent->fieldmarks &= ~ED_MARK_MOVED;
+			continue;
+		}
+		qcvm->moved_edicts[j++] = qcvm->moved_edicts[i];
+	}
+	qcvm->num_moved_edicts = j;
+}
+
+/*
+=================
+PR_FieldsWritten
+
+Called before fields with pr_fieldmarks bits change without SV_LinkEdict, or
+before string fields with a PF_Find index change, so the next query looks at
+the edict itself
+=================
+*/
+void PR_FieldsWritten (edict_t *ed, unsigned int marks)
+{
+	int			 i;
+	findindex_t *index;
+
+	if (ed == qcvm->edicts)
+		return; // never found
+	marks &= ~ed->fieldmarks;
+	if (marks & ED_MARK_MOVED)
+	{
+		if (qcvm->num_moved_edicts == qcvm->max_moved_edicts)
+			PR_CompactMovedEdicts (); // also bounds the list when nothing calls PF_findradius
+		PR_AppendEdictNum (&qcvm->moved_edicts, &qcvm->num_moved_edicts, &qcvm->max_moved_edicts, NUM_FOR_EDICT (ed));
+		ed->fieldmarks |= ED_MARK_MOVED;
+	}
+	for (i = 0; i < NUM_FIND_INDICES; i++)
+	{
+		index = &qcvm->findindices[i];
+		if (!(marks & ED_MARK_FIND (i)) || !index->valid)
+			continue; // nothing to keep up to date until a PF_Find builds it
+		PR_AppendEdictNum (&index->dirty, &index->num_dirty, &index->max_dirty, NUM_FOR_EDICT (ed));
+		ed->fieldmarks |= ED_MARK_FIND (i);
+	}
+}
+
+/*
+=================
+PR_ResetFieldMarks
+
+For a new set of edicts
+=================
+*/
+void PR_ResetFieldMarks (void)
+{
+	int		 i;
+	edict_t *ed;
+
+	qcvm->num_moved_edicts = 0;
+	for (i = 0; i < NUM_FIND_INDICES; i++)
+	{
+		qcvm->findindices[i].valid = false;
+		qcvm->findindices[i].num_dirty = 0;
+	}
+	for (i = 0, ed = qcvm->edicts; i < qcvm->num_edicts; i++, ed = NEXT_EDICT (ed))
+		ed->fieldmarks = 0;
+}
+
+/*
+=================
+PR_FreeFindIndices
+=================
+*/
+void PR_FreeFindIndices (void)
+{
+	int i;
+
+	SAFE_FREE (qcvm->moved_edicts);
+	qcvm->num_moved_edicts = qcvm->max_moved_edicts = 0;
+	for (i = 0; i < NUM_FIND_INDICES; i++)
+	{
+		SAFE_FREE (qcvm->findindices[i].entries);
+		SAFE_FREE (qcvm->findindices[i].dirty);
+		memset (&qcvm->findindices[i], 0, sizeof (findindex_t));
+	}
+}
+
+static int PR_CompareEdictNums (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+=================
+PF_InRadius
+=================
+*/
+static qboolean PF_InRadius (edict_t *ent, const float *org, float radsq)
+{
+	float d, lensq;
+
+	if (ent->free)
+		return false;
+	if (ent->v.solid == SOLID_NOT)
+		return false;
+
+	d = org[0] - (ent->v.origin[0] + (ent->v.mins[0] + ent->v.maxs[0]) * 0.5);
+	lensq = d * d;
+	if (lensq > radsq)
+		return false;
+	d = org[1] - (ent->v.origin[1] + (ent->v.mins[1] + ent->v.maxs[1]) * 0.5);
+	lensq += d * d;
+	if (lensq > radsq)
+		return false;
+	d = org[2] - (ent->v.origin[2] + (ent->v.mins[2] + ent->v.maxs[2]) * 0.5);
+	lensq += d * d;
+	if (lensq > radsq)
+		return false;
+
+	return true;
+}
+
+/*
+=================
+PF_FindRadiusGrid
+
+The linked edicts near org from the server's area grid, and those moved since
+they were linked. Same chain as the full scan, returns false if org or rad
+would let entities pass from anywhere
+=================
+*/
+static qboolean PF_FindRadiusGrid (const float *org, float rad, edict_t **chain)
+{
+	vec3_t	 mins, maxs;
+	int		 i, count;
+	edict_t *ent;
+
+	rad = fabsf (rad);
+	if (!(rad < FLT_MAX && fabsf (org[0]) < FLT_MAX && fabsf (org[1]) < FLT_MAX && fabsf (org[2]) < FLT_MAX))
+		return false; // infinities and NaNs
+	for (i = 0; i < 3; i++)
+	{
+		// the entity center is inside its linked box, 1 unit of slack for the rounding
+		mins[i] = org[i] - rad - 1.0f;
+		maxs[i] = org[i] + rad + 1.0f;
+	}
+
+	PR_CompactMovedEdicts ();
+	count = SV_AreaGridEdicts (mins, maxs, NULL) + qcvm->num_moved_edicts;
+	TEMP_ALLOC (int, nums, count);
+	count = SV_AreaGridEdicts (mins, maxs, nums);
+	memcpy (nums + count, qcvm->moved_edicts, qcvm->num_moved_edicts * sizeof (int));
+	count += qcvm->num_moved_edicts;
+	qsort (nums, count, sizeof (int), PR_CompareEdictNums);
+
+	rad *= rad;
+	for (i = 0; i < count; i++)
+	{
+		if (i > 0 && nums[i] == nums[i - 1])
+			continue;
+		ent = EDICT_NUM (nums[i]);
+		if (!PF_InRadius (ent, org, rad))
+			continue;
+		ent->v.chain = EDICT_TO_PROG (*chain);
+		*chain = ent;
+	}
+
+	TEMP_FREE (nums);
+	return true;
+}
+
 /*
 =================
 PF_findradius
@@ -967,28 +1194,20 @@ static void PF_findradius (void)
 
 	org = G_VECTOR (OFS_PARM0);
 	rad = G_FLOAT (OFS_PARM1);
+
+	// moved edicts are only tracked through the server's physics
+	if (qcvm == &sv.qcvm && qcvm->areagrid && PF_FindRadiusGrid (org, rad, &chain))
+	{
+		RETURN_EDICT (chain);
+		return;
+	}
+
 	rad *= rad;
 
 	ent = NEXT_EDICT (qcvm->edicts);
 	for (i = 1; i < qcvm->num_edicts; i++, ent = NEXT_EDICT (ent))
 	{
-		float d, lensq;
-		if (ent->free)
-			continue;
-		if (ent->v.solid == SOLID_NOT)
-			continue;
-
-		d = org[0] - (ent->v.origin[0] + (ent->v.mins[0] + ent->v.maxs[0]) * 0.5);
-		lensq = d * d;
-		if (lensq > rad)
-			continue;
-		d = org[1] - (ent->v.origin[1] + (ent->v.mins[1] + ent->v.maxs[1]) * 0.5);
-		lensq += d * d;
-		if (lensq > rad)
-			continue;
-		d = org[2] - (ent->v.origin[2] + (ent->v.mins[2] + ent->v.maxs[2]) * 0.5);
-		lensq += d * d;
-		if (lensq > rad)
+		if (!PF_InRadius (ent, org, rad))
 			continue;
 
 		ent->v.chain = EDICT_TO_PROG (chain);
@@ -1055,10 +1274,127 @@ static void PF_Remove (void)
 	ED_Free (ed);
 }
 
+static int PF_CompareFindEntries (const void *a, const void *b)
+{
+	const findentry_t *ea = (const findentry_t *)a;
+	const findentry_t *eb = (const findentry_t *)b;
+
+	if (ea->hash != eb->hash)
+		return (ea->hash < eb->hash) ? -1 : 1;
+	return ea->edict - eb->edict;
+}
+
+/*
+=================
+PF_BuildFindIndex
+
+Strings that aren't from the progs or allocated can change behind the field's
+back, like the temp strings, those edicts stay in the dirty list
+=================
+*/
+static void PF_BuildFindIndex (int i)
+{
+	findindex_t *index = &qcvm->findindices[i];
+	int			 field = pr_findfields[i];
+	int			 e;
+	string_t	 str;
+	edict_t		*ed;
+
+	index->num_entries = 0;
+	index->num_dirty = 0;
+	if (index->max_entries < qcvm->num_edicts)
+	{
+		index->max_entries = qcvm->max_edicts;
+		index->entries = (findentry_t *)Mem_Realloc (index->entries, index->max_entries * sizeof (findentry_t));
+	}
+
+	for (e = 1, ed = NEXT_EDICT (qcvm->edicts); e < qcvm->num_edicts; e++, ed = NEXT_EDICT (ed))
+	{
+		ed->fieldmarks &= ~ED_MARK_FIND (i);
+		if (ed->free)
+			continue;
+		str = E_INT (ed, field);
+		if ((str >= 0 && str < qcvm->stringssize) || (str < 0 && str >= -qcvm->numknownstrings && qcvm->knownstringsowned[-1 - str]))
+		{
+			index->entries[index->num_entries].hash = COM_HashString (PR_GetString (str));
+			index->entries[index->num_entries++].edict = e;
+		}
+		else
+		{
+			PR_AppendEdictNum (&index->dirty, &index->num_dirty, &index->max_dirty, e);
+			ed->fieldmarks |= ED_MARK_FIND (i);
+		}
+	}
+	qsort (index->entries, index->num_entries, sizeof (findentry_t), PF_CompareFindEntries);
+	index->valid = true;
+}
+
+/*
+=================
+PF_FindMatches
+=================
+*/
+static qboolean PF_FindMatches (int e, int field, const char *s)
+{
+	edict_t *ed;
+
+	if (e >= qcvm->num_edicts)
+		return false;
+	ed = EDICT_NUM (e);
+	return !ed->free && !strcmp (E_STRING (ed, field), s);
+}
+
+/*
+=================
+PF_FindIndexed
+
+The first edict after start, from the hash matches in the index and the dirty
+edicts. Returns num_edicts if there is none
+=================
+*/
+static int PF_FindIndexed (int i, int start, const char *s)
+{
+	findindex_t *index = &qcvm->findindices[i];
+	int			 field = pr_findfields[i];
+	unsigned int hash = COM_HashString (s);
+	int			 lo, hi, mid, j;
+	int			 best = qcvm->num_edicts;
+
+	if (!index->valid || index->num_dirty > 32 + index->num_entries / 8)
+		PF_BuildFindIndex (i);
+
+	lo = 0;
+	hi = index->num_entries;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (index->entries[mid].hash < hash || (index->entries[mid].hash == hash && index->entries[mid].edict <= start))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (j = lo; j < index->num_entries && index->entries[j].hash == hash; j++)
+	{
+		if (PF_FindMatches (index->entries[j].edict, field, s))
+		{
+			best = index->entries[j].edict;
+			break;
+		}
+	}
+
+	for (j = 0; j < index->num_dirty; j++)
+	{
+		if (index->dirty[j] > start && index->dirty[j] < best && PF_FindMatches (index->dirty[j], field, s))
+			best = index->dirty[j];
+	}
+
+	return best;
+}
+
 // entity (entity start, .string field, string match) find = #5;
 static void PF_Find (void)
 {
-	int			e;
+	int			e, i;
 	int			f;
 	const char *s, *t;
 	edict_t	   *ed;
@@ -1069,6 +1405,21 @@ static void PF_Find (void)
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
 
+	// empty strings are left to the scan: the engine clears fields without marking them
+	if (*s)
+	{
+		for (i = 0; i < NUM_FIND_INDICES; i++)
+		{
+			if (f == pr_findfields[i])
+			{
+				e = PF_FindIndexed (i, e, s);
+				ed = (e < qcvm->num_edicts) ? EDICT_NUM (e) : qcvm->edicts;
+				RETURN_EDICT (ed);
+				return;
+			}
+		}
+	}
+
 	for (e++; e < qcvm->num_edicts; e++)
 	{
 		ed = EDICT_NUM (e);
@@ -1852,7 +2203,7 @@ static void PF_cl_makestatic (void)
 	VectorCopy (ent->baseline.origin, stat->origin);
 	VectorCopy (ent->baseline.angles, stat->angles);
 	if (stat->model)
-		R_AddEfrags (stat);
+		R_AddEfrags (i);
 
 	// throw the entity away now
 	ED_Free (ent);
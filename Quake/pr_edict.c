@@ -62,22 +62,15 @@ angles and bad trails.
 edict_t *ED_Alloc (void)
 {
 	// get head of FIFO, if not empty
-	edict_t *e = (qcvm->free_list.size > 0) ? qcvm->free_list.circular_buffer[qcvm->free_list.head_index] : NULL;
+	edict_t *e = qcvm->free_list.head;
 
 	if (e && ((e->freetime < MAX_EDICT_FREETIME_ALWAYS_REUSE) || (qcvm->time - e->freetime) > MIN_EDICT_AGE_FOR_REUSE))
 	{
 		assert (e->free);
+		ED_RemoveFromFreeList (e);
 		memset (&e->v, 0, qcvm->progs->entityfields * 4);
 		e->free = false;
 
-		// pop HEAD
-		qcvm->free_list.head_index = (qcvm->free_list.head_index + 1) % MAX_EDICTS;
-		qcvm->free_list.size -= 1;
-
-		// no real need, but easier for debugging...
-		if (qcvm->free_list.size == 0)
-			qcvm->free_list.head_index = 0;
-
 		return e;
 	}
 
@@ -104,11 +97,16 @@ edict_t *ED_Alloc (void)
 ED_AddToFreeList
 =================
 */
-static void ED_AddToFreeList (edict_t *ed)
+static void ED_AddToFreeList (freelist_t *list, edict_t *ed)
 {
-	size_t add_index = (qcvm->free_list.head_index + qcvm->free_list.size) % MAX_EDICTS;
-	qcvm->free_list.circular_buffer[add_index] = ed;
-	qcvm->free_list.size += 1;
+	ed->free_prev = list->tail;
+	ed->free_next = NULL;
+	if (list->tail)
+		list->tail->free_next = ed;
+	else
+		list->head = ed;
+	list->tail = ed;
+	list->size += 1;
 }
 
 /*
@@ -124,7 +122,7 @@ void ED_Free (edict_t *ed)
 	if (ed->free)
 	{
 		// Assert that this isn't linked to any area
-		assert (!ed->area.prev);
+		assert (!ed->area.prev && !ed->areacell);
 		return;
 	}
 
@@ -145,7 +143,7 @@ void ED_Free (edict_t *ed)
 
 	ed->freetime = qcvm->time;
 
-	ED_AddToFreeList (ed);
+	ED_AddToFreeList (&qcvm->free_list, ed);
 }
 
 /*
@@ -157,70 +155,71 @@ void ED_RemoveFromFreeList (edict_t *ed)
 {
 	if (ed->free)
 	{
-		// find the index where ed is...
-		for (size_t i = 0; i < qcvm->free_list.size; i++)
-		{
-			const size_t found_index = (qcvm->free_list.head_index + i) % MAX_EDICTS;
-
-			if (qcvm->free_list.circular_buffer[found_index] == ed)
-			{
-				// overwrite found_index with head data, advance head.
-				qcvm->free_list.circular_buffer[found_index] = qcvm->free_list.circular_buffer[qcvm->free_list.head_index];
-				qcvm->free_list.head_index = (qcvm->free_list.head_index + 1) % MAX_EDICTS;
-				qcvm->free_list.size -= 1;
-				break;
-			}
-		}
+		if (ed->free_prev)
+			ed->free_prev->free_next = ed->free_next;
+		else
+			qcvm->free_list.head = ed->free_next;
+		if (ed->free_next)
+			ed->free_next->free_prev = ed->free_prev;
+		else
+			qcvm->free_list.tail = ed->free_prev;
+		ed->free_prev = ed->free_next = NULL;
+		qcvm->free_list.size -= 1;
 	}
 }
 
-static int ED_freetime_compare_func (const void *first, const void *second)
-{
-	int firstInt = *(const int *)first;
-	int secondInt = *(const int *)second;
-	return (int)copysign (1.0, EDICT_NUM (firstInt)->freetime - EDICT_NUM (secondInt)->freetime);
-}
+#define FREELIST_AGE_BUCKETS 16
 
 /*
 =================
 ED_RebuildFreeList
 Rebuild the entire free list, ordering the free edicts
-by the smallest freetime to maximize chance of reuse in ED_Alloc
+by the smallest freetime to maximize chance of reuse in ED_Alloc.
+Edicts that can already be reused go first in any order, the
+recently freed ones are bucketed by age, which keeps the FIFO
+sorted to within MIN_EDICT_AGE_FOR_REUSE / FREELIST_AGE_BUCKETS.
 =================
 */
 void ED_RebuildFreeList (bool force_free_reuse)
 {
-	int *free_edicts_table = (int *)Mem_Alloc (qcvm->num_edicts * sizeof (int));
-
-	int nb_free_edicts = 0;
+	freelist_t buckets[FREELIST_AGE_BUCKETS + 1]; // reusable, then oldest to newest
+	int		   i, b;
+	edict_t	  *ed;
 
-	// 1. Enumerate free edict numebers aand put it in free_edicts_table
-	for (int i = 0; i < qcvm->num_edicts; i++)
+	memset (buckets, 0, sizeof (buckets));
+	for (i = 0; i < qcvm->num_edicts; i++)
 	{
-		if (EDICT_NUM (i)->free)
-		{
-			if (force_free_reuse)
-				EDICT_NUM (i)->freetime = 0.0f;
+		ed = EDICT_NUM (i);
+		if (!ed->free)
+			continue;
 
-			free_edicts_table[nb_free_edicts++] = i;
-		}
-	}
+		if (force_free_reuse)
+			ed->freetime = 0.0f;
 
-	if (!force_free_reuse)
-	{
-		// 2.2 Sort free_edicts_table by their corrsponding edict freetime
-		qsort (free_edicts_table, nb_free_edicts, sizeof (int), ED_freetime_compare_func);
+		const double age = qcvm->time - ed->freetime;
+		if ((ed->freetime < MAX_EDICT_FREETIME_ALWAYS_REUSE) || age > MIN_EDICT_AGE_FOR_REUSE)
+			b = 0;
+		else
+			b = FREELIST_AGE_BUCKETS - CLAMP (0, (int)(age * FREELIST_AGE_BUCKETS / MIN_EDICT_AGE_FOR_REUSE), FREELIST_AGE_BUCKETS - 1);
+
+		ED_AddToFreeList (&buckets[b], ed);
 	}
 
-	// 3. Reset freelist and insert by free_edicts_table order
+	// concatenate the buckets into the new FIFO
 	memset (&(qcvm->free_list), 0x0, sizeof (freelist_t));
-
-	for (int j = 0; j < nb_free_edicts; j++)
+	for (b = 0; b <= FREELIST_AGE_BUCKETS; b++)
 	{
-		ED_AddToFreeList (EDICT_NUM (free_edicts_table[j]));
-	}
+		if (!buckets[b].head)
+			continue;
 
-	Mem_Free (free_edicts_table);
+		if (qcvm->free_list.tail)
+			qcvm->free_list.tail->free_next = buckets[b].head;
+		else
+			qcvm->free_list.head = buckets[b].head;
+		buckets[b].head->free_prev = qcvm->free_list.tail;
+		qcvm->free_list.tail = buckets[b].tail;
+		qcvm->free_list.size += buckets[b].size;
+	}
 }
 
 //===========================================================================
@@ -365,12 +364,12 @@ Returns a string describing *data in a type specific manner
 */
 static const char *PR_ValueString (int type, eval_t *val)
 {
-	static char	 line[512];
-	char		 fmt[64];
-	const char	*str;
-	ddef_t		*def;
-	dfunction_t *f;
-	edict_t		*ed;
+	static THREAD_LOCAL char line[512];
+	char					 fmt[64];
+	const char				*str;
+	ddef_t					*def;
+	dfunction_t				*f;
+	edict_t					*ed;
 
 	type &= ~DEF_SAVEGLOBAL;
 
@@ -443,9 +442,9 @@ Easier to parse than PR_ValueString
 */
 const char *PR_UglyValueString (int type, eval_t *val)
 {
-	static char	 line[1024];
-	ddef_t		*def;
-	dfunction_t *f;
+	static THREAD_LOCAL char line[1024];
+	ddef_t					*def;
+	dfunction_t				*f;
 
 	type &= ~DEF_SAVEGLOBAL;
 
@@ -507,12 +506,12 @@ padded to 20 field width
 */
 const char *PR_GlobalString (int ofs)
 {
-	static char		 line[512];
-	static const int lastchari = countof (line) - 2;
-	const char		*s;
-	int				 i;
-	ddef_t			*def;
-	void			*val;
+	static THREAD_LOCAL char line[512];
+	static const int		 lastchari = countof (line) - 2;
+	const char				*s;
+	int						 i;
+	ddef_t					*def;
+	void					*val;
 
 	val = (void *)&qcvm->globals[ofs];
 	def = ED_GlobalAtOfs (ofs);
@@ -538,10 +537,10 @@ const char *PR_GlobalString (int ofs)
 
 const char *PR_GlobalStringNoContents (int ofs)
 {
-	static char		 line[512];
-	static const int lastchari = countof (line) - 2;
-	int				 i;
-	ddef_t			*def;
+	static THREAD_LOCAL char line[512];
+	static const int		 lastchari = countof (line) - 2;
+	int						 i;
+	ddef_t					*def;
 
 	def = ED_GlobalAtOfs (ofs);
 	if (!def)
@@ -615,9 +614,9 @@ ED_FieldValueString
 */
 static const char *ED_FieldValueString (edict_t *ed, ddef_t *d)
 {
-	static char str[1024];
-	int			ofs = d->ofs * 4;
-	eval_t	   *val = (eval_t *)((char *)&ed->v + ofs);
+	static THREAD_LOCAL char str[1024];
+	int						 ofs = d->ofs * 4;
+	eval_t					*val = (eval_t *)((char *)&ed->v + ofs);
 
 	// .movetype
 	if (ofs == offsetof (entvars_t, movetype) && val->_float == (int)val->_float)
@@ -906,16 +905,10 @@ void ED_PrintEdicts (void)
 
 	Con_Printf ("\nFree-list:\n");
 
-	size_t current_index = qcvm->free_list.head_index;
-
-	for (size_t j = 0; j < qcvm->free_list.size; j++)
+	for (edict_t *e = qcvm->free_list.head; e; e = e->free_next)
 	{
-		edict_t *e = qcvm->free_list.circular_buffer[current_index];
-
 		ED_Print (e);
 		free_list_count++;
-
-		current_index = (current_index + 1) % MAX_EDICTS;
 	}
 
 	assert (free_list_count == free_edicts_count);
@@ -962,7 +955,10 @@ static void ED_PrintEdict_f (void)
 					"Edict %u.%s==%s\n", i, PR_GetString (def->s_name),
 					PR_UglyValueString (def->type & ~DEF_SAVEGLOBAL, (eval_t *)((char *)&EDICT_NUM (i)->v + def->ofs * 4)));
 			else
+			{
+				PR_FieldsWritten (EDICT_NUM (i), ED_MARK_MOVED | ED_MARK_FIND_ALL);
 				ED_ParseEpair ((void *)&EDICT_NUM (i)->v, def, Cmd_Argv (3), false);
+			}
 		}
 	}
 	PR_SwitchQCVM (NULL);
@@ -1159,7 +1155,7 @@ static void ED_RezoneString (string_t *ref, const char *str)
 		// initialised with
 	}
 
-	buf = Mem_Alloc (len);
+	buf = Mem_AllocTagged (len, MEM_TAG_QC_STRINGS);
 	memcpy (buf, str, len);
 	id = -1 - (*ref = PR_SetEngineString (buf));
 	// make sure its flagged as zoned so we can clean up properly after.
@@ -1281,6 +1277,81 @@ qboolean ED_ParseEpair (void *base, ddef_t *key, const char *s, qboolean zoned)
 	return true;
 }
 
+/*
+====================
+ED_ParseToken
+
+COM_Parse for entity text, the token is returned as a span of data instead of being copied to
+com_token, which is most of the work for entity lumps with thousands of entities.
+Returns NULL at the end of the data.
+====================
+*/
+static const char *ED_ParseToken (const char *data, const char **token, int *length)
+{
+	const char *end;
+	int			c;
+
+	if (!data)
+		return NULL;
+
+// skip whitespace
+skipwhite:
+	while ((c = *data) <= ' ')
+	{
+		if (c == 0)
+			return NULL; // end of file
+		data++;
+	}
+
+	// skip // comments
+	if (c == '/' && data[1] == '/')
+	{
+		data = strchr (data, '\n');
+		if (!data)
+			return NULL;
+		goto skipwhite;
+	}
+
+	// skip /*..*/ comments
+	if (c == '/' && data[1] == '*')
+	{
+		end = strstr (data + 2, "*/");
+		data = end ? end + 2 : data + strlen (data);
+		goto skipwhite;
+	}
+
+	// handle quoted strings specially
+	if (c == '\"')
+	{
+		*token = data + 1;
+		end = strchr (*token, '\"');
+		if (!end)
+		{
+			*length = strlen (*token);
+			return *token + *length;
+		}
+		*length = end - *token;
+		return end + 1;
+	}
+
+	// parse single characters
+	*token = data;
+	if (c == '{' || c == '}' || c == '(' || c == ')' || c == '\'' || c == ':')
+	{
+		*length = 1;
+		return data + 1;
+	}
+
+	// parse a regular word
+	do
+	{
+		data++;
+		c = *data;
+	} while (c > 32 && c != '{' && c != '}' && c != '(' && c != ')' && c != '\'');
+	*length = data - *token;
+	return data;
+}
+
 /*
 ====================
 ED_ParseEdict
@@ -1292,42 +1363,44 @@ Used for initial level load and for savegames.
 */
 const char *ED_ParseEdict (const char *data, edict_t *ent)
 {
-	ddef_t	*key;
-	char	 keyname[256];
-	qboolean anglehack, init;
-	int		 n;
+	ddef_t	   *key;
+	char		keyname[256];
+	char		value[COM_PARSE_MAX_TOKEN_SIZE];
+	const char *token;
+	int			length;
+	qboolean	anglehack, init;
+	int			n;
 
 	init = false;
 
 	// clear it
 	if (ent != qcvm->edicts) // hack
 		memset (&ent->v, 0, qcvm->progs->entityfields * 4);
+	PR_FieldsWritten (ent, ED_MARK_MOVED | ED_MARK_FIND_ALL);
 
 	// go through all the dictionary pairs
 	while (1)
 	{
 		// parse key
-		data = COM_Parse (data);
-		if (com_token[0] == '}')
-			break;
+		data = ED_ParseToken (data, &token, &length);
 		if (!data)
 			Host_Error ("ED_ParseEntity: EOF without closing brace");
+		if (length && token[0] == '}')
+			break;
+
+		n = q_min (length, (int)sizeof (keyname) - 1);
+		memcpy (keyname, token, n);
+		keyname[n] = 0;
 
 		// anglehack is to allow QuakeEd to write single scalar angles
 		// and allow them to be turned into vectors. (FIXME...)
-		if (!strcmp (com_token, "angle"))
-		{
-			strcpy (com_token, "angles");
-			anglehack = true;
-		}
-		else
-			anglehack = false;
+		anglehack = !strcmp (keyname, "angle");
+		if (anglehack)
+			strcpy (keyname, "angles");
 
 		// FIXME: change light to _light to get rid of this hack
-		if (!strcmp (com_token, "light"))
-			strcpy (com_token, "light_lev"); // hack for single light def
-
-		q_strlcpy (keyname, com_token, sizeof (keyname));
+		if (!strcmp (keyname, "light"))
+			strcpy (keyname, "light_lev"); // hack for single light def
 
 		// another hack to fix keynames with trailing spaces
 		n = strlen (keyname);
@@ -1338,14 +1411,22 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 		}
 
 		// parse value
-		// HACK: we allow truncation when reading the wad field,
-		// otherwise maps using lots of wads with absolute paths
-		// could cause a parse error
-		data = COM_ParseEx (data, !strcmp (keyname, "wad") ? CPE_ALLOWTRUNC : CPE_NOTRUNC);
+		data = ED_ParseToken (data, &token, &length);
 		if (!data)
 			Host_Error ("ED_ParseEntity: EOF without closing brace");
+		if (length >= (int)sizeof (value))
+		{
+			// HACK: we allow truncation when reading the wad field,
+			// otherwise maps using lots of wads with absolute paths
+			// could cause a parse error
+			if (strcmp (keyname, "wad"))
+				Host_Error ("ED_ParseEntity: value of \"%s\" is too long", keyname);
+			length = sizeof (value) - 1;
+		}
+		memcpy (value, token, length);
+		value[length] = 0;
 
-		if (com_token[0] == '}')
+		if (value[0] == '}')
 			Host_Error ("ED_ParseEntity: closing brace without data");
 
 		init = true;
@@ -1358,9 +1439,9 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 			if (qcvm == &sv.qcvm)
 			{
 				if (!strcmp (keyname, "_precache_model") && sv.state == ss_loading)
-					SV_Precache_Model (PR_GetString (ED_NewString (com_token)));
+					SV_Precache_Model (PR_GetString (ED_NewString (value)));
 				else if (!strcmp (keyname, "_precache_sound") && sv.state == ss_loading)
-					SV_Precache_Sound (PR_GetString (ED_NewString (com_token)));
+					SV_Precache_Sound (PR_GetString (ED_NewString (value)));
 			}
 			// spike
 			continue;
@@ -1368,7 +1449,7 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 
 		// johnfitz -- hack to support .alpha even when progs.dat doesn't know about it
 		if (!strcmp (keyname, "alpha"))
-			ent->alpha = ENTALPHA_ENCODE (atof (com_token));
+			ent->alpha = ENTALPHA_ENCODE (atof (value));
 		// johnfitz
 
 		key = ED_FindField (keyname);
@@ -1379,12 +1460,12 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 			if (!strcmp (keyname, "traileffect") && qcvm == &sv.qcvm && sv.state == ss_loading)
 			{
 				if ((val = GetEdictFieldValue (ent, qcvm->extfields.traileffectnum)))
-					val->_float = PF_SV_ForceParticlePrecache (com_token);
+					val->_float = PF_SV_ForceParticlePrecache (value);
 			}
 			else if (!strcmp (keyname, "emiteffect") && qcvm == &sv.qcvm && sv.state == ss_loading)
 			{
 				if ((val = GetEdictFieldValue (ent, qcvm->extfields.emiteffectnum)))
-					val->_float = PF_SV_ForceParticlePrecache (com_token);
+					val->_float = PF_SV_ForceParticlePrecache (value);
 			}
 			// johnfitz -- HACK -- suppress error becuase fog/sky/alpha fields might not be mentioned in defs.qc
 			else
@@ -1397,11 +1478,11 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 		if (anglehack)
 		{
 			char temp[32];
-			strcpy (temp, com_token);
-			q_snprintf (com_token, sizeof (temp), "0 %s 0", temp);
+			q_strlcpy (temp, value, sizeof (temp));
+			q_snprintf (value, sizeof (value), "0 %s 0", temp);
 		}
 
-		if (!ED_ParseEpair ((void *)&ent->v, key, com_token, qcvm != &sv.qcvm))
+		if (!ED_ParseEpair ((void *)&ent->v, key, value, qcvm != &sv.qcvm))
 			Host_Error ("ED_ParseEdict: parse error");
 	}
 
@@ -1439,11 +1520,13 @@ void ED_LoadFromFile (const char *data)
 	while (1)
 	{
 		// parse the opening brace
-		data = COM_Parse (data);
+		const char *token;
+		int			length;
+		data = ED_ParseToken (data, &token, &length);
 		if (!data)
 			break;
-		if (com_token[0] != '{')
-			Host_Error ("ED_LoadFromFile: found %s when expecting {", com_token);
+		if (length != 1 || token[0] != '{')
+			Host_Error ("ED_LoadFromFile: found %.*s when expecting {", length, token);
 
 		if (!ent)
 			ent = EDICT_NUM (0);
@@ -1522,8 +1605,8 @@ void ED_LoadFromFile (const char *data)
 }
 
 #ifndef PR_SwitchQCVM
-qcvm_t		 *qcvm;
-globalvars_t *pr_global_struct;
+THREAD_LOCAL qcvm_t		 *qcvm;
+THREAD_LOCAL globalvars_t *pr_global_struct;
 void		  PR_SwitchQCVM (qcvm_t *nvm)
 {
 	if (qcvm && nvm)
@@ -1553,10 +1636,20 @@ void PR_ClearProgs (qcvm_t *vm)
 		Mem_Free ((void *)qcvm->knownstrings);
 		Mem_Free (qcvm->knownstringsowned);
 	}
+	if (qcvm->knownstrings_map)
+		HashMap_Destroy (qcvm->knownstrings_map);
+	Mem_Free (qcvm->decoded_statements);
+	Mem_Free (qcvm->profile_nodes);
+	Mem_Free (qcvm->tempstrings);
+	SV_FreeAreaGrid ();
+	PR_FreeFindIndices ();
 	Mem_Free (qcvm->edicts); // ericw -- sv.edicts switched to use malloc()
-	if (qcvm->fielddefs != (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_fielddefs))
+	if (qcvm->fielddefs != (ddef_t *)(qcvm->progsfile + qcvm->progs->ofs_fielddefs))
 		Mem_Free (qcvm->fielddefs);
+	Mem_Free (qcvm->functions);
+	Mem_Free (qcvm->globals);
 	Mem_Free (qcvm->progs); // spike -- pr_progs switched to use malloc (so menuqc doesn't end up stuck on the early hunk nor wiped on every map change)
+	COM_FreeFileView (qcvm->progsfile);
 	HashMap_Destroy (qcvm->function_map);
 	HashMap_Destroy (qcvm->fielddefs_map);
 	HashMap_Destroy (qcvm->globaldefs_map);
@@ -1622,7 +1715,7 @@ static void PR_MergeEngineFieldDefs (void)
 		ddef_t *olddefs = qcvm->fielddefs;
 		qcvm->fielddefs = Mem_Alloc (maxdefs * sizeof (*qcvm->fielddefs));
 		memcpy (qcvm->fielddefs, olddefs, qcvm->progs->numfielddefs * sizeof (*qcvm->fielddefs));
-		if (olddefs != (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_fielddefs))
+		if (olddefs != (ddef_t *)(qcvm->progsfile + qcvm->progs->ofs_fielddefs))
 			Mem_Free (olddefs);
 
 		// allocate the extra defs
@@ -1722,6 +1815,21 @@ static void PR_PatchRereleaseBuiltins (void)
 	}
 }
 
+/*
+===============
+PR_UnloadProgsFile
+
+For loads that fail before anything points into the file
+===============
+*/
+static void PR_UnloadProgsFile (void)
+{
+	Mem_Free (qcvm->progs);
+	qcvm->progs = NULL;
+	COM_FreeFileView (qcvm->progsfile);
+	qcvm->progsfile = NULL;
+}
+
 /*
 ===============
 PR_LoadProgs
@@ -1729,21 +1837,41 @@ PR_LoadProgs
 */
 qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcrc, const builtin_t *builtins, size_t numbuiltins)
 {
-	int i;
+	int			   i;
+	int			   len;
+	const qboolean swap = LittleLong (1) != 1;
 
 	PR_ClearProgs (qcvm); // just in case.
 
-	qcvm->progs = (dprograms_t *)COM_LoadFile (filename, NULL);
-	if (!qcvm->progs)
+	// statements, strings and defs are used straight from the file view. Loose files and paks are
+	// mapped, so every server process running the same progs shares those pages. Only the header,
+	// functions and globals, which the vm writes to, get copies.
+	qcvm->progsfile = COM_LoadFileView (filename, NULL, &len);
+	if (!qcvm->progsfile)
+		return false;
+	if (len < (int)sizeof (*qcvm->progs))
+	{
+		PR_UnloadProgsFile ();
+		Con_Printf ("%s is truncated\n", filename);
 		return false;
+	}
+	if (swap)
+	{ // the lumps are swapped in place
+		byte *copy = (byte *)Mem_AllocNonZero (len);
+		memcpy (copy, qcvm->progsfile, len);
+		COM_FreeFileView (qcvm->progsfile);
+		qcvm->progsfile = copy;
+	}
 
-	qcvm->progssize = com_filesize;
+	qcvm->progssize = len;
 	CRC_Init (&qcvm->progscrc);
-	for (i = 0; i < com_filesize; i++)
-		CRC_ProcessByte (&qcvm->progscrc, ((byte *)qcvm->progs)[i]);
-	qcvm->progshash = Com_BlockChecksum (qcvm->progs, com_filesize);
+	for (i = 0; i < len; i++)
+		CRC_ProcessByte (&qcvm->progscrc, qcvm->progsfile[i]);
+	qcvm->progshash = Com_BlockChecksum ((void *)qcvm->progsfile, len);
 
 	// byte swap the header
+	qcvm->progs = (dprograms_t *)Mem_AllocNonZero (sizeof (*qcvm->progs));
+	memcpy (qcvm->progs, qcvm->progsfile, sizeof (*qcvm->progs));
 	for (i = 0; i < (int)sizeof (*qcvm->progs) / 4; i++)
 		((int *)qcvm->progs)[i] = LittleLong (((int *)qcvm->progs)[i]);
 
@@ -1754,7 +1882,7 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 		else
 		{
 			Con_Printf ("%s ABI set not supported\n", filename);
-			qcvm->progs = NULL;
+			PR_UnloadProgsFile ();
 			return false;
 		}
 	}
@@ -1791,28 +1919,35 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 				Con_Printf ("%s system vars are not supported\n", filename);
 				break;
 			}
-			qcvm->progs = NULL;
+			PR_UnloadProgsFile ();
 			return false;
 		}
 	}
-	Con_DPrintf ("%s occupies %uK.\n", filename, (unsigned)(com_filesize / 1024u));
+	Con_DPrintf ("%s occupies %uK.\n", filename, (unsigned)(len / 1024u));
 
-	qcvm->functions = (dfunction_t *)((byte *)qcvm->progs + qcvm->progs->ofs_functions);
-	qcvm->strings = (char *)qcvm->progs + qcvm->progs->ofs_strings;
-	if (qcvm->progs->ofs_strings + qcvm->progs->numstrings >= com_filesize)
+	qcvm->strings = (char *)qcvm->progsfile + qcvm->progs->ofs_strings;
+	if (qcvm->progs->ofs_strings + qcvm->progs->numstrings >= len)
 		Host_Error ("%s strings go past end of file\n", filename);
-
-	qcvm->globaldefs = (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_globaldefs);
-	qcvm->fielddefs = (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_fielddefs);
-	qcvm->statements = (dstatement_t *)((byte *)qcvm->progs + qcvm->progs->ofs_statements);
-
-	qcvm->globals = (float *)((byte *)qcvm->progs + qcvm->progs->ofs_globals);
+	if ((size_t)(unsigned)qcvm->progs->ofs_functions + (size_t)(unsigned)qcvm->progs->numfunctions * sizeof (dfunction_t) > (size_t)len ||
+		(size_t)(unsigned)qcvm->progs->ofs_globals + (size_t)(unsigned)qcvm->progs->numglobals * 4 > (size_t)len)
+		Host_Error ("%s functions or globals go past end of file\n", filename);
+
+	// the vm writes these: profile counts, rerelease builtin patches, its global state
+	qcvm->functions = (dfunction_t *)Mem_AllocNonZero (qcvm->progs->numfunctions * sizeof (dfunction_t));
+	memcpy (qcvm->functions, qcvm->progsfile + qcvm->progs->ofs_functions, qcvm->progs->numfunctions * sizeof (dfunction_t));
+	qcvm->globals = (float *)Mem_AllocNonZero (qcvm->progs->numglobals * 4);
+	memcpy (qcvm->globals, qcvm->progsfile + qcvm->progs->ofs_globals, qcvm->progs->numglobals * 4);
 	pr_global_struct = (globalvars_t *)qcvm->globals;
 
+	// never written, unless swapped on a big endian copy
+	qcvm->globaldefs = (ddef_t *)(qcvm->progsfile + qcvm->progs->ofs_globaldefs);
+	qcvm->fielddefs = (ddef_t *)(qcvm->progsfile + qcvm->progs->ofs_fielddefs);
+	qcvm->statements = (dstatement_t *)(qcvm->progsfile + qcvm->progs->ofs_statements);
+
 	qcvm->stringssize = qcvm->progs->numstrings;
 
 	// byte swap the lumps
-	for (i = 0; i < qcvm->progs->numstatements; i++)
+	for (i = 0; swap && i < qcvm->progs->numstatements; i++)
 	{
 		qcvm->statements[i].op = LittleShort (qcvm->statements[i].op);
 		qcvm->statements[i].a = LittleShort (qcvm->statements[i].a);
@@ -1840,7 +1975,7 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 		HashMap_Insert (qcvm->function_map, &func_name, &func_ptr);
 	}
 
-	for (i = 0; i < qcvm->progs->numglobaldefs; i++)
+	for (i = 0; swap && i < qcvm->progs->numglobaldefs; i++)
 	{
 		qcvm->globaldefs[i].type = LittleShort (qcvm->globaldefs[i].type);
 		qcvm->globaldefs[i].ofs = LittleShort (qcvm->globaldefs[i].ofs);
@@ -1857,11 +1992,14 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 
 	for (i = 0; i < qcvm->progs->numfielddefs; i++)
 	{
-		qcvm->fielddefs[i].type = LittleShort (qcvm->fielddefs[i].type);
+		if (swap)
+		{
+			qcvm->fielddefs[i].type = LittleShort (qcvm->fielddefs[i].type);
+			qcvm->fielddefs[i].ofs = LittleShort (qcvm->fielddefs[i].ofs);
+			qcvm->fielddefs[i].s_name = LittleLong (qcvm->fielddefs[i].s_name);
+		}
 		if (qcvm->fielddefs[i].type & DEF_SAVEGLOBAL)
 			Host_Error ("PR_LoadProgs: pr_fielddefs[i].type & DEF_SAVEGLOBAL");
-		qcvm->fielddefs[i].ofs = LittleShort (qcvm->fielddefs[i].ofs);
-		qcvm->fielddefs[i].s_name = LittleLong (qcvm->fielddefs[i].s_name);
 	}
 	qcvm->fielddefs_map = HashMap_Create (const char *, ddef_t *, &HashStr, &HashStrCmp);
 	HashMap_Reserve (
@@ -1898,6 +2036,7 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 	PR_EnableExtensions (qcvm->globaldefs);
 	PR_PatchRereleaseBuiltins ();
 	PR_FindSupportedEffects ();
+	PR_DecodeStatements ();
 
 	qcvm->progsstrings = qcvm->numknownstrings;
 	return true;
@@ -1925,9 +2064,11 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("profile_export", PR_ProfileExport_f);
 	Cmd_AddCommand ("pr_dumpplatform", PR_DumpPlatform_f);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_SetCallback (&nomonsters, ED_Nomonsters_f);
+	Cvar_RegisterVariable (&pr_profile);
 	Cvar_RegisterVariable (&gamecfg);
 	Cvar_RegisterVariable (&scratch1);
 	Cvar_RegisterVariable (&scratch2);
@@ -1967,10 +2108,31 @@ int NUM_FOR_EDICT (edict_t *e)
 
 static void PR_AllocStringSlots (void)
 {
+	const mem_tag_t tag = Mem_SetTag (MEM_TAG_QC_STRINGS);
 	qcvm->maxknownstrings += PR_STRING_ALLOCSLOTS;
 	Con_DPrintf2 ("PR_AllocStringSlots: realloc'ing for %d slots\n", qcvm->maxknownstrings);
 	qcvm->knownstrings = (const char **)Mem_Realloc ((void *)qcvm->knownstrings, qcvm->maxknownstrings * sizeof (char *));
 	qcvm->knownstringsowned = (qboolean *)Mem_Realloc ((void *)qcvm->knownstringsowned, qcvm->maxknownstrings * sizeof (qboolean));
+	if (!qcvm->knownstrings_map)
+		qcvm->knownstrings_map = HashMap_Create (const char *, int, &HashPtr, NULL);
+	Mem_SetTag (tag);
+}
+
+/*
+==============
+PR_SetKnownString
+
+Fills a slot and keeps knownstrings_map in sync, NULL clears it.
+==============
+*/
+static void PR_SetKnownString (int i, const char *s, qboolean owned)
+{
+	if (qcvm->knownstrings[i])
+		HashMap_Erase (qcvm->knownstrings_map, &qcvm->knownstrings[i]);
+	qcvm->knownstrings[i] = s;
+	qcvm->knownstringsowned[i] = owned;
+	if (s)
+		HashMap_Insert (qcvm->knownstrings_map, &s, &i);
 }
 
 const char *PR_GetString (int num)
@@ -2001,13 +2163,17 @@ void PR_ClearEngineString (int num)
 		num = -1 - num;
 		if (qcvm->knownstringsowned[num])
 		{
-			SAFE_FREE (qcvm->knownstrings[num]);
-			qcvm->knownstringsowned[num] = false;
+			void *s = (void *)qcvm->knownstrings[num];
+			PR_SetKnownString (num, NULL, false);
+			Mem_Free (s);
 		}
 		else
-			qcvm->knownstrings[num] = NULL;
+			PR_SetKnownString (num, NULL, false);
 		if (qcvm->freeknownstrings > num)
 			qcvm->freeknownstrings = num;
+		// the slot can come back with other contents
+		for (int i = 0; i < NUM_FIND_INDICES; i++)
+			qcvm->findindices[i].valid = false;
 	}
 }
 
@@ -2024,10 +2190,11 @@ int PR_SetEngineString (const char *s)
 	if (s >= qcvm->strings && s <= qcvm->strings + qcvm->stringssize - 2)
 		return (int)(s - qcvm->strings);
 #endif
-	for (i = 0; i < qcvm->numknownstrings; i++)
+	if (qcvm->knownstrings_map)
 	{
-		if (qcvm->knownstrings[i] == s)
-			return -1 - i;
+		int *known = HashMap_Lookup (int, qcvm->knownstrings_map, &s);
+		if (known)
+			return -1 - *known;
 	}
 	// new unknown engine string
 	// Con_DPrintf ("PR_SetEngineString: new engine string %p\n", s);
@@ -2047,8 +2214,7 @@ int PR_SetEngineString (const char *s)
 		break;
 	}
 	qcvm->freeknownstrings = i + 1;
-	qcvm->knownstrings[i] = s;
-	qcvm->knownstringsowned[i] = false;
+	PR_SetKnownString (i, s, false);
 	return -1 - i;
 }
 
@@ -2075,8 +2241,7 @@ int PR_AllocString (int size, char **ptr)
 		break;
 	}
 	qcvm->freeknownstrings = i + 1;
-	qcvm->knownstrings[i] = (char *)Mem_Alloc (size);
-	qcvm->knownstringsowned[i] = true;
+	PR_SetKnownString (i, (char *)Mem_AllocTagged (size, MEM_TAG_QC_STRINGS), true);
 	if (ptr)
 		*ptr = (char *)qcvm->knownstrings[i];
 	return -1 - i;
@@ -2087,8 +2252,9 @@ void PR_ClearEdictStrings ()
 	for (int i = qcvm->progsstrings; i < qcvm->numknownstrings; ++i)
 		if (qcvm->knownstringsowned[i])
 		{
-			SAFE_FREE (qcvm->knownstrings[i]);
-			qcvm->knownstringsowned[i] = false;
+			void *s = (void *)qcvm->knownstrings[i];
+			PR_SetKnownString (i, NULL, false);
+			Mem_Free (s);
 		}
 
 #ifndef _DEBUG
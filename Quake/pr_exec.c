@@ -21,6 +21,41 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+cvar_t pr_profile = {"pr_profile", "0", CVAR_NONE};
+
+// Opcodes that only exist in the decoded statements
+enum
+{
+	OP_BAD = OP_BITOR + 1, // anything PR_ExecuteDecoded doesn't know
+	// comparison fused with the OP_IF/OP_IFNOT on its result that follows, jump is relative to the comparison
+	OP_EQ_F_IF,
+	OP_EQ_F_IFNOT,
+	OP_NE_F_IF,
+	OP_NE_F_IFNOT,
+	OP_EQ_E_IF,
+	OP_EQ_E_IFNOT,
+	OP_NE_E_IF,
+	OP_NE_E_IFNOT,
+	OP_LE_IF,
+	OP_LE_IFNOT,
+	OP_GE_IF,
+	OP_GE_IFNOT,
+	OP_LT_IF,
+	OP_LT_IFNOT,
+	OP_GT_IF,
+	OP_GT_IFNOT,
+	OP_NOT_F_IF,
+	OP_NOT_F_IFNOT,
+	OP_NOT_ENT_IF,
+	OP_NOT_ENT_IFNOT,
+	NUM_DECODED_OPS
+};
+
+static const int pr_fusedbranches[][2] = {
+	{OP_EQ_F, OP_EQ_F_IF}, {OP_NE_F, OP_NE_F_IF}, {OP_EQ_E, OP_EQ_E_IF}, {OP_NE_E, OP_NE_E_IF}, {OP_LE, OP_LE_IF},
+	{OP_GE, OP_GE_IF},	   {OP_LT, OP_LT_IF},	  {OP_GT, OP_GT_IF},	 {OP_NOT_F, OP_NOT_F_IF}, {OP_NOT_ENT, OP_NOT_ENT_IF},
+};
+
 static const char *const pr_opnames[] = {"DONE",
 
 										 "MUL_F",	 "MUL_V",	 "MUL_FV",	 "MUL_VF",
@@ -137,45 +172,250 @@ static void PR_StackTrace (void)
 	}
 }
 
+/*
+============
+PR_ProfileEnter
+
+Makes the node of fnum called from the running function the running one
+============
+*/
+static void PR_ProfileEnter (int fnum)
+{
+	prprofilenode_t *node;
+	int				 i;
+
+	if (!qcvm->profile_nodes)
+	{
+		qcvm->max_profile_nodes = 1024;
+		qcvm->profile_nodes = (prprofilenode_t *)Mem_Alloc (qcvm->max_profile_nodes * sizeof (prprofilenode_t));
+		qcvm->num_profile_nodes = 1;
+		qcvm->profile_node = 0;
+	}
+
+	for (i = qcvm->profile_nodes[qcvm->profile_node].child; i; i = qcvm->profile_nodes[i].sibling)
+		if (qcvm->profile_nodes[i].function == fnum)
+			break;
+
+	if (!i)
+	{
+		if (qcvm->num_profile_nodes == qcvm->max_profile_nodes)
+		{
+			qcvm->max_profile_nodes *= 2;
+			qcvm->profile_nodes = (prprofilenode_t *)Mem_Realloc (qcvm->profile_nodes, qcvm->max_profile_nodes * sizeof (prprofilenode_t));
+		}
+		i = qcvm->num_profile_nodes++;
+		node = &qcvm->profile_nodes[i];
+		memset (node, 0, sizeof (*node));
+		node->function = fnum;
+		node->parent = qcvm->profile_node;
+		node->sibling = qcvm->profile_nodes[qcvm->profile_node].child;
+		qcvm->profile_nodes[qcvm->profile_node].child = i;
+	}
+
+	node = &qcvm->profile_nodes[i];
+	node->calls++;
+	node->start = Sys_DoubleTime ();
+	qcvm->profile_node = i;
+}
+
+/*
+============
+PR_ProfileLeave
+============
+*/
+static void PR_ProfileLeave (void)
+{
+	prprofilenode_t *node = &qcvm->profile_nodes[qcvm->profile_node];
+
+	node->time += Sys_DoubleTime () - node->start;
+	qcvm->profile_node = node->parent;
+}
+
+typedef struct
+{
+	int		 function;
+	int		 calls;
+	uint64_t self_statements, statements;
+	double	 self_time, time;
+} prfunctionprofile_t;
+
+/*
+============
+PR_ProfileSum
+
+Adds the subtree of node to the per function sums, returns its inclusive statement count.
+Inclusive counts are only added by the outermost node of a recursive function.
+============
+*/
+static uint64_t PR_ProfileSum (int node, prfunctionprofile_t *sums, int *active)
+{
+	prprofilenode_t		*n = &qcvm->profile_nodes[node];
+	prfunctionprofile_t *sum = &sums[n->function];
+	uint64_t			 statements = n->statements;
+	double				 children_time = 0.0;
+	int					 i;
+
+	active[n->function]++;
+	for (i = n->child; i; i = qcvm->profile_nodes[i].sibling)
+	{
+		statements += PR_ProfileSum (i, sums, active);
+		children_time += qcvm->profile_nodes[i].time;
+	}
+	active[n->function]--;
+
+	sum->calls += n->calls;
+	sum->self_statements += n->statements;
+	sum->self_time += n->time - children_time;
+	if (!active[n->function])
+	{
+		sum->statements += statements;
+		sum->time += n->time;
+	}
+	return statements;
+}
+
+static int PR_CompareFunctionProfiles (const void *a, const void *b)
+{
+	const prfunctionprofile_t *pa = (const prfunctionprofile_t *)a;
+	const prfunctionprofile_t *pb = (const prfunctionprofile_t *)b;
+
+	if (pa->self_time != pb->self_time)
+		return (pa->self_time < pb->self_time) ? 1 : -1;
+	return (pa->self_statements < pb->self_statements) ? 1 : (pa->self_statements > pb->self_statements) ? -1 : 0;
+}
+
 /*
 ============
 PR_Profile_f
 
+Prints the functions with the most exclusive time since the last call, builtins are listed on their own
 ============
 */
 void PR_Profile_f (void)
 {
-	int			 i, num;
-	int			 pmax;
-	dfunction_t *f, *best;
+	int					 i;
+	int					*active;
+	prfunctionprofile_t *sums;
+	dfunction_t			*f;
 
 	if (!sv.active)
 		return;
 
 	PR_SwitchQCVM (&sv.qcvm);
 
-	num = 0;
-	do
+	if (qcvm->num_profile_nodes <= 1)
 	{
-		pmax = 0;
-		best = NULL;
-		for (i = 0; i < qcvm->progs->numfunctions; i++)
-		{
-			f = &qcvm->functions[i];
-			if (f->profile > pmax)
-			{
-				pmax = f->profile;
-				best = f;
-			}
-		}
-		if (best)
-		{
-			if (num < 10)
-				Con_Printf ("%7i %s\n", best->profile, PR_GetString (best->s_name));
-			num++;
-			best->profile = 0;
-		}
-	} while (best);
+		if (!pr_profile.value)
+			Con_Printf ("set pr_profile 1 to record a profile\n");
+		PR_SwitchQCVM (NULL);
+		return;
+	}
+
+	sums = (prfunctionprofile_t *)Mem_Alloc (qcvm->progs->numfunctions * sizeof (prfunctionprofile_t));
+	active = (int *)Mem_Alloc (qcvm->progs->numfunctions * sizeof (int));
+	for (i = 0; i < qcvm->progs->numfunctions; i++)
+		sums[i].function = i;
+	for (i = qcvm->profile_nodes[0].child; i; i = qcvm->profile_nodes[i].sibling)
+		PR_ProfileSum (i, sums, active);
+	qsort (sums, qcvm->progs->numfunctions, sizeof (prfunctionprofile_t), PR_CompareFunctionProfiles);
+
+	Con_Printf ("  self ms  total ms  self stmts total stmts    calls function\n");
+	for (i = 0; i < 10 && i < qcvm->progs->numfunctions && sums[i].calls; i++)
+	{
+		f = &qcvm->functions[sums[i].function];
+		Con_Printf (
+			"%9.2f %9.2f %11" PRIu64 " %11" PRIu64 " %8i %s%s\n", sums[i].self_time * 1000.0, sums[i].time * 1000.0, sums[i].self_statements,
+			sums[i].statements, sums[i].calls, PR_GetString (f->s_name), (f->first_statement < 0) ? " (builtin)" : "");
+	}
+
+	Mem_Free (active);
+	Mem_Free (sums);
+
+	// start over
+	qcvm->num_profile_nodes = 1;
+	memset (&qcvm->profile_nodes[0], 0, sizeof (prprofilenode_t));
+	qcvm->profile_node = 0;
+	for (i = 0; i < qcvm->progs->numfunctions; i++)
+		qcvm->functions[i].profile = 0;
+
+	PR_SwitchQCVM (NULL);
+}
+
+/*
+============
+PR_ProfileExportNode
+
+Writes one collapsed stack line per node, weighted with its exclusive time in microseconds
+============
+*/
+static void PR_ProfileExportNode (FILE *f, int node, char *stack, size_t stacksize, size_t length)
+{
+	prprofilenode_t *n = &qcvm->profile_nodes[node];
+	dfunction_t		*func = &qcvm->functions[n->function];
+	double			 self_time = n->time;
+	int				 i;
+
+	if (length)
+		length += q_snprintf (stack + length, stacksize - length, ";");
+	length = q_min (length, stacksize - 1);
+	length += q_snprintf (stack + length, stacksize - length, "%s%s", PR_GetString (func->s_name), (func->first_statement < 0) ? " (builtin)" : "");
+	length = q_min (length, stacksize - 1);
+
+	for (i = n->child; i; i = qcvm->profile_nodes[i].sibling)
+		self_time -= qcvm->profile_nodes[i].time;
+	if (self_time * 1000000.0 >= 1.0)
+		fprintf (f, "%s %.0f\n", stack, self_time * 1000000.0);
+
+	for (i = n->child; i; i = qcvm->profile_nodes[i].sibling)
+	{
+		PR_ProfileExportNode (f, i, stack, stacksize, length);
+		stack[length] = 0;
+	}
+}
+
+/*
+============
+PR_ProfileExport_f
+
+Writes the recorded call stacks in the collapsed format of flamegraph.pl
+============
+*/
+void PR_ProfileExport_f (void)
+{
+	FILE *f;
+	char  name[MAX_OSPATH];
+	char  stack[4096];
+	int	  i;
+
+	if (!sv.active)
+		return;
+
+	PR_SwitchQCVM (&sv.qcvm);
+
+	if (qcvm->num_profile_nodes <= 1)
+	{
+		Con_Printf ("no profile recorded, set pr_profile 1\n");
+		PR_SwitchQCVM (NULL);
+		return;
+	}
+
+	q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argc () >= 2 ? Cmd_Argv (1) : "qcprofile.txt");
+	COM_CreatePath (name);
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open file %s.\n", name);
+		PR_SwitchQCVM (NULL);
+		return;
+	}
+
+	for (i = qcvm->profile_nodes[0].child; i; i = qcvm->profile_nodes[i].sibling)
+	{
+		stack[0] = 0;
+		PR_ProfileExportNode (f, i, stack, sizeof (stack), 0);
+	}
+	fclose (f);
+	Con_Printf ("Wrote %s\n", name);
 
 	PR_SwitchQCVM (NULL);
 }
@@ -291,41 +531,77 @@ static int PR_LeaveFunction (void)
 
 /*
 ====================
-PR_ExecuteProgram
+PR_DecodeStatements
 
-The interpretation main loop
+Resolves the operands of the loaded statements to global pointers for PR_ExecuteDecoded
+and fuses comparisons with the branch on their result
 ====================
 */
-#define OPA ((eval_t *)&qcvm->globals[(unsigned short)st->a])
-#define OPB ((eval_t *)&qcvm->globals[(unsigned short)st->b])
-#define OPC ((eval_t *)&qcvm->globals[(unsigned short)st->c])
-
-void PR_ExecuteProgram (func_t fnum)
+void PR_DecodeStatements (void)
 {
-	eval_t		 *ptr;
-	dstatement_t *st;
-	dfunction_t	 *f, *newf;
-	int			  profile, startprofile;
-	edict_t		 *ed;
-	int			  exitdepth;
+	int			   i, j;
+	dstatement_t  *st;
+	prstatement_t *out;
 
-	if (!fnum || fnum >= (func_t)qcvm->progs->numfunctions)
+	qcvm->decoded_statements = (prstatement_t *)Mem_Alloc (qcvm->progs->numstatements * sizeof (prstatement_t));
+	for (i = 0; i < qcvm->progs->numstatements; i++)
 	{
-		if (pr_global_struct->self)
-			ED_Print (PROG_TO_EDICT (pr_global_struct->self));
-		Host_Error ("PR_ExecuteProgram: NULL function");
+		st = &qcvm->statements[i];
+		out = &qcvm->decoded_statements[i];
+		out->op = (st->op <= OP_BITOR) ? st->op : OP_BAD;
+		out->a = (eval_t *)&qcvm->globals[(unsigned short)st->a];
+		out->b = (eval_t *)&qcvm->globals[(unsigned short)st->b];
+		out->c = (eval_t *)&qcvm->globals[(unsigned short)st->c];
+		if (st->op == OP_GOTO)
+		{
+			out->a = NULL;
+			out->jump = st->a;
+		}
+		else if (st->op == OP_IF || st->op == OP_IFNOT)
+		{
+			out->b = NULL;
+			out->jump = st->b;
+		}
 	}
 
-	f = &qcvm->functions[fnum];
+	// the branch itself stays in place for any jump that lands on it
+	for (i = 0; i < qcvm->progs->numstatements - 1; i++)
+	{
+		st = &qcvm->statements[i];
+		if ((st[1].op != OP_IF && st[1].op != OP_IFNOT) || (unsigned short)st[1].a != (unsigned short)st->c)
+			continue;
+		for (j = 0; j < (int)countof (pr_fusedbranches); j++)
+		{
+			if (st->op == pr_fusedbranches[j][0])
+			{
+				out = &qcvm->decoded_statements[i];
+				out->op = pr_fusedbranches[j][1] + ((st[1].op == OP_IFNOT) ? 1 : 0);
+				out->jump = st[1].b + 1;
+				break;
+			}
+		}
+	}
+}
 
-	// FIXME: if this is a builtin, then we're going to crash.
+/*
+====================
+PR_ExecuteStatements
 
-	qcvm->trace = false;
+The interpretation main loop with tracing and profiling, runs from the statement after st until the stack is back at exitdepth.
+With profiling the calls are recorded in the profile_nodes, the running function has to be entered by the caller.
+====================
+*/
+#define OPA ((eval_t *)&qcvm->globals[(unsigned short)st->a])
+#define OPB ((eval_t *)&qcvm->globals[(unsigned short)st->b])
+#define OPC ((eval_t *)&qcvm->globals[(unsigned short)st->c])
 
-	// make a stack frame
-	exitdepth = qcvm->depth;
+static void PR_ExecuteStatements (dstatement_t *st, int exitdepth, qboolean profiling)
+{
+	eval_t		*ptr;
+	dfunction_t *newf;
+	int			 profile, startprofile;
+	edict_t		*ed;
 
-	st = &qcvm->statements[PR_EnterFunction (f)];
 	startprofile = profile = 0;
 
 	while (1)
@@ -496,6 +772,7 @@ void PR_ExecuteProgram (func_t fnum)
 				PR_RunError ("assignment to world entity");
 			}
 			OPC->_int = (byte *)((int *)&ed->v + OPB->_int) - (byte *)qcvm->edicts;
+			PR_FieldAddressed (ed, OPB->_int);
 			break;
 
 		case OP_LOAD_F:
@@ -545,18 +822,24 @@ void PR_ExecuteProgram (func_t fnum)
 		case OP_CALL7:
 		case OP_CALL8:
 			qcvm->xfunction->profile += profile - startprofile;
+			if (profiling)
+				qcvm->profile_nodes[qcvm->profile_node].statements += profile - startprofile;
 			startprofile = profile;
 			qcvm->xstatement = st - qcvm->statements;
 			qcvm->argc = st->op - OP_CALL0;
 			if (!OPA->function)
 				PR_RunError ("NULL function");
 			newf = &qcvm->functions[OPA->function];
+			if (profiling)
+				PR_ProfileEnter (OPA->function);
 			if (newf->first_statement < 0)
 			{ // Built-in function
 				int i = -newf->first_statement;
 				if (i >= qcvm->numbuiltins)
 					i = 0; // just invoke the fixme builtin.
 				qcvm->builtins[i]();
+				if (profiling)
+					PR_ProfileLeave ();
 				break;
 			}
 			// Normal function
@@ -566,12 +849,16 @@ void PR_ExecuteProgram (func_t fnum)
 		case OP_DONE:
 		case OP_RETURN:
 			qcvm->xfunction->profile += profile - startprofile;
+			if (profiling)
+				qcvm->profile_nodes[qcvm->profile_node].statements += profile - startprofile;
 			startprofile = profile;
 			qcvm->xstatement = st - qcvm->statements;
 			qcvm->globals[OFS_RETURN] = qcvm->globals[(unsigned short)st->a];
 			qcvm->globals[OFS_RETURN + 1] = qcvm->globals[(unsigned short)st->a + 1];
 			qcvm->globals[OFS_RETURN + 2] = qcvm->globals[(unsigned short)st->a + 2];
 			st = &qcvm->statements[PR_LeaveFunction ()];
+			if (profiling)
+				PR_ProfileLeave ();
 			if (qcvm->depth == exitdepth)
 			{ // Done
 				return;
@@ -594,3 +881,471 @@ void PR_ExecuteProgram (func_t fnum)
 #undef OPA
 #undef OPB
 #undef OPC
+
+/*
+====================
+PR_ExecuteDecoded
+
+The interpretation main loop on the decoded statements, dispatched with computed gotos where available.
+Profiling isn't counted and runaway loops are only caught on backward jumps, tracing switches to PR_ExecuteStatements.
+====================
+*/
+#define OPA (st->a)
+#define OPB (st->b)
+#define OPC (st->c)
+
+// the result is still stored for whoever else reads it
+#define PR_FUSED_BRANCH(op, expr)  \
+	PR_OP (op##_IF) :              \
+		OPC->_float = (expr);      \
+		if (OPC->_int)             \
+			goto jump;             \
+		st++;                      \
+		PR_NEXT;                   \
+	PR_OP (op##_IFNOT) :           \
+		OPC->_float = (expr);      \
+		if (!OPC->_int)            \
+			goto jump;             \
+		st++;                      \
+		PR_NEXT
+
+#ifdef __GNUC__
+#define PR_OP(op)		  op_##op
+#define PR_NEXT			  goto *dispatch[(++st)->op]
+#define PR_DISPATCH_BEGIN PR_NEXT;
+#define PR_DISPATCH_END
+#else
+#define PR_OP(op)		  case op
+#define PR_NEXT			  continue
+#define PR_DISPATCH_BEGIN \
+	while (1)             \
+	{                     \
+		++st;             \
+		switch (st->op)   \
+		{
+#define PR_DISPATCH_END \
+	}                   \
+	}
+#endif
+
+static void PR_ExecuteDecoded (int statement, int exitdepth)
+{
+	eval_t		  *ptr;
+	prstatement_t *st;
+	dfunction_t	  *newf;
+	edict_t		  *ed;
+	int			   runaway;
+
+#ifdef __GNUC__
+	static const void *const dispatch[NUM_DECODED_OPS] = {
+		[OP_DONE] = &&op_OP_DONE,
+		[OP_MUL_F] = &&op_OP_MUL_F,
+		[OP_MUL_V] = &&op_OP_MUL_V,
+		[OP_MUL_FV] = &&op_OP_MUL_FV,
+		[OP_MUL_VF] = &&op_OP_MUL_VF,
+		[OP_DIV_F] = &&op_OP_DIV_F,
+		[OP_ADD_F] = &&op_OP_ADD_F,
+		[OP_ADD_V] = &&op_OP_ADD_V,
+		[OP_SUB_F] = &&op_OP_SUB_F,
+		[OP_SUB_V] = &&op_OP_SUB_V,
+		[OP_EQ_F] = &&op_OP_EQ_F,
+		[OP_EQ_V] = &&op_OP_EQ_V,
+		[OP_EQ_S] = &&op_OP_EQ_S,
+		[OP_EQ_E] = &&op_OP_EQ_E,
+		[OP_EQ_FNC] = &&op_OP_EQ_FNC,
+		[OP_NE_F] = &&op_OP_NE_F,
+		[OP_NE_V] = &&op_OP_NE_V,
+		[OP_NE_S] = &&op_OP_NE_S,
+		[OP_NE_E] = &&op_OP_NE_E,
+		[OP_NE_FNC] = &&op_OP_NE_FNC,
+		[OP_LE] = &&op_OP_LE,
+		[OP_GE] = &&op_OP_GE,
+		[OP_LT] = &&op_OP_LT,
+		[OP_GT] = &&op_OP_GT,
+		[OP_LOAD_F] = &&op_OP_LOAD_F,
+		[OP_LOAD_V] = &&op_OP_LOAD_V,
+		[OP_LOAD_S] = &&op_OP_LOAD_S,
+		[OP_LOAD_ENT] = &&op_OP_LOAD_ENT,
+		[OP_LOAD_FLD] = &&op_OP_LOAD_FLD,
+		[OP_LOAD_FNC] = &&op_OP_LOAD_FNC,
+		[OP_ADDRESS] = &&op_OP_ADDRESS,
+		[OP_STORE_F] = &&op_OP_STORE_F,
+		[OP_STORE_V] = &&op_OP_STORE_V,
+		[OP_STORE_S] = &&op_OP_STORE_S,
+		[OP_STORE_ENT] = &&op_OP_STORE_ENT,
+		[OP_STORE_FLD] = &&op_OP_STORE_FLD,
+		[OP_STORE_FNC] = &&op_OP_STORE_FNC,
+		[OP_STOREP_F] = &&op_OP_STOREP_F,
+		[OP_STOREP_V] = &&op_OP_STOREP_V,
+		[OP_STOREP_S] = &&op_OP_STOREP_S,
+		[OP_STOREP_ENT] = &&op_OP_STOREP_ENT,
+		[OP_STOREP_FLD] = &&op_OP_STOREP_FLD,
+		[OP_STOREP_FNC] = &&op_OP_STOREP_FNC,
+		[OP_RETURN] = &&op_OP_RETURN,
+		[OP_NOT_F] = &&op_OP_NOT_F,
+		[OP_NOT_V] = &&op_OP_NOT_V,
+		[OP_NOT_S] = &&op_OP_NOT_S,
+		[OP_NOT_ENT] = &&op_OP_NOT_ENT,
+		[OP_NOT_FNC] = &&op_OP_NOT_FNC,
+		[OP_IF] = &&op_OP_IF,
+		[OP_IFNOT] = &&op_OP_IFNOT,
+		[OP_CALL0] = &&op_OP_CALL0,
+		[OP_CALL1] = &&op_OP_CALL1,
+		[OP_CALL2] = &&op_OP_CALL2,
+		[OP_CALL3] = &&op_OP_CALL3,
+		[OP_CALL4] = &&op_OP_CALL4,
+		[OP_CALL5] = &&op_OP_CALL5,
+		[OP_CALL6] = &&op_OP_CALL6,
+		[OP_CALL7] = &&op_OP_CALL7,
+		[OP_CALL8] = &&op_OP_CALL8,
+		[OP_STATE] = &&op_OP_STATE,
+		[OP_GOTO] = &&op_OP_GOTO,
+		[OP_AND] = &&op_OP_AND,
+		[OP_OR] = &&op_OP_OR,
+		[OP_BITAND] = &&op_OP_BITAND,
+		[OP_BITOR] = &&op_OP_BITOR,
+		[OP_BAD] = &&op_OP_BAD,
+		[OP_EQ_F_IF] = &&op_OP_EQ_F_IF,
+		[OP_EQ_F_IFNOT] = &&op_OP_EQ_F_IFNOT,
+		[OP_NE_F_IF] = &&op_OP_NE_F_IF,
+		[OP_NE_F_IFNOT] = &&op_OP_NE_F_IFNOT,
+		[OP_EQ_E_IF] = &&op_OP_EQ_E_IF,
+		[OP_EQ_E_IFNOT] = &&op_OP_EQ_E_IFNOT,
+		[OP_NE_E_IF] = &&op_OP_NE_E_IF,
+		[OP_NE_E_IFNOT] = &&op_OP_NE_E_IFNOT,
+		[OP_LE_IF] = &&op_OP_LE_IF,
+		[OP_LE_IFNOT] = &&op_OP_LE_IFNOT,
+		[OP_GE_IF] = &&op_OP_GE_IF,
+		[OP_GE_IFNOT] = &&op_OP_GE_IFNOT,
+		[OP_LT_IF] = &&op_OP_LT_IF,
+		[OP_LT_IFNOT] = &&op_OP_LT_IFNOT,
+		[OP_GT_IF] = &&op_OP_GT_IF,
+		[OP_GT_IFNOT] = &&op_OP_GT_IFNOT,
+		[OP_NOT_F_IF] = &&op_OP_NOT_F_IF,
+		[OP_NOT_F_IFNOT] = &&op_OP_NOT_F_IFNOT,
+		[OP_NOT_ENT_IF] = &&op_OP_NOT_ENT_IF,
+		[OP_NOT_ENT_IFNOT] = &&op_OP_NOT_ENT_IFNOT,
+	};
+#endif
+
+	st = &qcvm->decoded_statements[statement];
+	runaway = 0;
+
+	PR_DISPATCH_BEGIN
+
+	PR_OP (OP_ADD_F) :
+		OPC->_float = OPA->_float + OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_ADD_V) :
+		OPC->vector[0] = OPA->vector[0] + OPB->vector[0];
+		OPC->vector[1] = OPA->vector[1] + OPB->vector[1];
+		OPC->vector[2] = OPA->vector[2] + OPB->vector[2];
+		PR_NEXT;
+
+	PR_OP (OP_SUB_F) :
+		OPC->_float = OPA->_float - OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_SUB_V) :
+		OPC->vector[0] = OPA->vector[0] - OPB->vector[0];
+		OPC->vector[1] = OPA->vector[1] - OPB->vector[1];
+		OPC->vector[2] = OPA->vector[2] - OPB->vector[2];
+		PR_NEXT;
+
+	PR_OP (OP_MUL_F) :
+		OPC->_float = OPA->_float * OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_MUL_V) :
+		OPC->_float = OPA->vector[0] * OPB->vector[0] + OPA->vector[1] * OPB->vector[1] + OPA->vector[2] * OPB->vector[2];
+		PR_NEXT;
+	PR_OP (OP_MUL_FV) :
+		OPC->vector[0] = OPA->_float * OPB->vector[0];
+		OPC->vector[1] = OPA->_float * OPB->vector[1];
+		OPC->vector[2] = OPA->_float * OPB->vector[2];
+		PR_NEXT;
+	PR_OP (OP_MUL_VF) :
+		OPC->vector[0] = OPB->_float * OPA->vector[0];
+		OPC->vector[1] = OPB->_float * OPA->vector[1];
+		OPC->vector[2] = OPB->_float * OPA->vector[2];
+		PR_NEXT;
+
+	PR_OP (OP_DIV_F) :
+		OPC->_float = OPA->_float / OPB->_float;
+		PR_NEXT;
+
+	PR_OP (OP_BITAND) :
+		OPC->_float = (int)OPA->_float & (int)OPB->_float;
+		PR_NEXT;
+
+	PR_OP (OP_BITOR) :
+		OPC->_float = (int)OPA->_float | (int)OPB->_float;
+		PR_NEXT;
+
+	PR_OP (OP_GE) :
+		OPC->_float = OPA->_float >= OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_LE) :
+		OPC->_float = OPA->_float <= OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_GT) :
+		OPC->_float = OPA->_float > OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_LT) :
+		OPC->_float = OPA->_float < OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_AND) :
+		OPC->_float = OPA->_float && OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_OR) :
+		OPC->_float = OPA->_float || OPB->_float;
+		PR_NEXT;
+
+	PR_OP (OP_NOT_F) :
+		OPC->_float = !OPA->_float;
+		PR_NEXT;
+	PR_OP (OP_NOT_V) :
+		OPC->_float = !OPA->vector[0] && !OPA->vector[1] && !OPA->vector[2];
+		PR_NEXT;
+	PR_OP (OP_NOT_S) :
+		OPC->_float = !OPA->string || !*PR_GetString (OPA->string);
+		PR_NEXT;
+	PR_OP (OP_NOT_FNC) :
+		OPC->_float = !OPA->function;
+		PR_NEXT;
+	PR_OP (OP_NOT_ENT) :
+		OPC->_float = (PROG_TO_EDICT (OPA->edict) == qcvm->edicts);
+		PR_NEXT;
+
+	PR_OP (OP_EQ_F) :
+		OPC->_float = OPA->_float == OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_EQ_V) :
+		OPC->_float = (OPA->vector[0] == OPB->vector[0]) && (OPA->vector[1] == OPB->vector[1]) && (OPA->vector[2] == OPB->vector[2]);
+		PR_NEXT;
+	PR_OP (OP_EQ_S) :
+		OPC->_float = !strcmp (PR_GetString (OPA->string), PR_GetString (OPB->string));
+		PR_NEXT;
+	PR_OP (OP_EQ_E) :
+		OPC->_float = OPA->_int == OPB->_int;
+		PR_NEXT;
+	PR_OP (OP_EQ_FNC) :
+		OPC->_float = OPA->function == OPB->function;
+		PR_NEXT;
+
+	PR_OP (OP_NE_F) :
+		OPC->_float = OPA->_float != OPB->_float;
+		PR_NEXT;
+	PR_OP (OP_NE_V) :
+		OPC->_float = (OPA->vector[0] != OPB->vector[0]) || (OPA->vector[1] != OPB->vector[1]) || (OPA->vector[2] != OPB->vector[2]);
+		PR_NEXT;
+	PR_OP (OP_NE_S) :
+		OPC->_float = strcmp (PR_GetString (OPA->string), PR_GetString (OPB->string));
+		PR_NEXT;
+	PR_OP (OP_NE_E) :
+		OPC->_float = OPA->_int != OPB->_int;
+		PR_NEXT;
+	PR_OP (OP_NE_FNC) :
+		OPC->_float = OPA->function != OPB->function;
+		PR_NEXT;
+
+	PR_OP (OP_STORE_F) :
+	PR_OP (OP_STORE_ENT) :
+	PR_OP (OP_STORE_FLD) : // integers
+	PR_OP (OP_STORE_S) :
+	PR_OP (OP_STORE_FNC) : // pointers
+		OPB->_int = OPA->_int;
+		PR_NEXT;
+	PR_OP (OP_STORE_V) :
+		OPB->vector[0] = OPA->vector[0];
+		OPB->vector[1] = OPA->vector[1];
+		OPB->vector[2] = OPA->vector[2];
+		PR_NEXT;
+
+	PR_OP (OP_STOREP_F) :
+	PR_OP (OP_STOREP_ENT) :
+	PR_OP (OP_STOREP_FLD) : // integers
+	PR_OP (OP_STOREP_S) :
+	PR_OP (OP_STOREP_FNC) : // pointers
+		ptr = (eval_t *)((byte *)qcvm->edicts + OPB->_int);
+		ptr->_int = OPA->_int;
+		PR_NEXT;
+	PR_OP (OP_STOREP_V) :
+		ptr = (eval_t *)((byte *)qcvm->edicts + OPB->_int);
+		ptr->vector[0] = OPA->vector[0];
+		ptr->vector[1] = OPA->vector[1];
+		ptr->vector[2] = OPA->vector[2];
+		PR_NEXT;
+
+	PR_OP (OP_ADDRESS) :
+		ed = PROG_TO_EDICT (OPA->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT (ed); // Make sure it's in range
+#endif
+		if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+		{
+			qcvm->xstatement = st - qcvm->decoded_statements;
+			PR_RunError ("assignment to world entity");
+		}
+		OPC->_int = (byte *)((int *)&ed->v + OPB->_int) - (byte *)qcvm->edicts;
+		PR_FieldAddressed (ed, OPB->_int);
+		PR_NEXT;
+
+	PR_OP (OP_LOAD_F) :
+	PR_OP (OP_LOAD_FLD) :
+	PR_OP (OP_LOAD_ENT) :
+	PR_OP (OP_LOAD_S) :
+	PR_OP (OP_LOAD_FNC) :
+		ed = PROG_TO_EDICT (OPA->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT (ed); // Make sure it's in range
+#endif
+		OPC->_int = ((eval_t *)((int *)&ed->v + OPB->_int))->_int;
+		PR_NEXT;
+
+	PR_OP (OP_LOAD_V) :
+		ed = PROG_TO_EDICT (OPA->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT (ed); // Make sure it's in range
+#endif
+		ptr = (eval_t *)((int *)&ed->v + OPB->_int);
+		OPC->vector[0] = ptr->vector[0];
+		OPC->vector[1] = ptr->vector[1];
+		OPC->vector[2] = ptr->vector[2];
+		PR_NEXT;
+
+	PR_OP (OP_IFNOT) :
+		if (!OPA->_int)
+			goto jump;
+		PR_NEXT;
+
+	PR_OP (OP_IF) :
+		if (OPA->_int)
+			goto jump;
+		PR_NEXT;
+
+	PR_OP (OP_GOTO) :
+	jump:
+		// only loops can run away, so only count the statements jumped back over
+		if (st->jump < 0 && (runaway -= st->jump) > 0x1000000)
+		{
+			qcvm->xstatement = st - qcvm->decoded_statements;
+			PR_RunError ("runaway loop error");
+		}
+		st += st->jump - 1; /* -1 to offset the st++ */
+		PR_NEXT;
+
+	PR_OP (OP_CALL0) :
+	PR_OP (OP_CALL1) :
+	PR_OP (OP_CALL2) :
+	PR_OP (OP_CALL3) :
+	PR_OP (OP_CALL4) :
+	PR_OP (OP_CALL5) :
+	PR_OP (OP_CALL6) :
+	PR_OP (OP_CALL7) :
+	PR_OP (OP_CALL8) :
+		qcvm->xstatement = st - qcvm->decoded_statements;
+		qcvm->argc = st->op - OP_CALL0;
+		if (!OPA->function)
+			PR_RunError ("NULL function");
+		newf = &qcvm->functions[OPA->function];
+		if (newf->first_statement < 0)
+		{ // Built-in function
+			int i = -newf->first_statement;
+			if (i >= qcvm->numbuiltins)
+				i = 0; // just invoke the fixme builtin.
+			qcvm->builtins[i]();
+			if (qcvm->trace)
+			{ // traceon, continue on the slow path
+				PR_ExecuteStatements (&qcvm->statements[st - qcvm->decoded_statements], exitdepth, false);
+				return;
+			}
+			PR_NEXT;
+		}
+		// Normal function
+		st = &qcvm->decoded_statements[PR_EnterFunction (newf)];
+		PR_NEXT;
+
+	PR_OP (OP_DONE) :
+	PR_OP (OP_RETURN) :
+		qcvm->xstatement = st - qcvm->decoded_statements;
+		qcvm->globals[OFS_RETURN] = OPA->vector[0];
+		qcvm->globals[OFS_RETURN + 1] = OPA->vector[1];
+		qcvm->globals[OFS_RETURN + 2] = OPA->vector[2];
+		st = &qcvm->decoded_statements[PR_LeaveFunction ()];
+		if (qcvm->depth == exitdepth)
+		{ // Done
+			return;
+		}
+		PR_NEXT;
+
+	PR_OP (OP_STATE) :
+		ed = PROG_TO_EDICT (pr_global_struct->self);
+		ed->v.nextthink = pr_global_struct->time + 0.1;
+		ed->v.frame = OPA->_float;
+		ed->v.think = OPB->function;
+		PR_NEXT;
+
+	PR_FUSED_BRANCH (OP_EQ_F, OPA->_float == OPB->_float);
+	PR_FUSED_BRANCH (OP_NE_F, OPA->_float != OPB->_float);
+	PR_FUSED_BRANCH (OP_EQ_E, OPA->_int == OPB->_int);
+	PR_FUSED_BRANCH (OP_NE_E, OPA->_int != OPB->_int);
+	PR_FUSED_BRANCH (OP_LE, OPA->_float <= OPB->_float);
+	PR_FUSED_BRANCH (OP_GE, OPA->_float >= OPB->_float);
+	PR_FUSED_BRANCH (OP_LT, OPA->_float < OPB->_float);
+	PR_FUSED_BRANCH (OP_GT, OPA->_float > OPB->_float);
+	PR_FUSED_BRANCH (OP_NOT_F, !OPA->_float);
+	PR_FUSED_BRANCH (OP_NOT_ENT, PROG_TO_EDICT (OPA->edict) == qcvm->edicts);
+
+	PR_OP (OP_BAD) :
+		qcvm->xstatement = st - qcvm->decoded_statements;
+		PR_RunError ("Bad opcode %i", qcvm->statements[qcvm->xstatement].op);
+
+	PR_DISPATCH_END
+}
+#undef OPA
+#undef OPB
+#undef OPC
+#undef PR_FUSED_BRANCH
+#undef PR_OP
+#undef PR_NEXT
+#undef PR_DISPATCH_BEGIN
+#undef PR_DISPATCH_END
+
+/*
+====================
+PR_ExecuteProgram
+====================
+*/
+void PR_ExecuteProgram (func_t fnum)
+{
+	dfunction_t *f;
+	int			 exitdepth, statement;
+
+	if (!fnum || fnum >= (func_t)qcvm->progs->numfunctions)
+	{
+		if (pr_global_struct->self)
+			ED_Print (PROG_TO_EDICT (pr_global_struct->self));
+		Host_Error ("PR_ExecuteProgram: NULL function");
+	}
+
+	f = &qcvm->functions[fnum];
+
+	// FIXME: if this is a builtin, then we're going to crash.
+
+	qcvm->trace = false;
+
+	// make a stack frame
+	exitdepth = qcvm->depth;
+
+	statement = PR_EnterFunction (f);
+	if (pr_profile.value)
+	{
+		if (!exitdepth)
+			qcvm->profile_node = 0; // in case an error left functions open
+		PR_ProfileEnter (fnum);
+		PR_ExecuteStatements (&qcvm->statements[statement], exitdepth, true);
+	}
+	else if (!qcvm->decoded_statements)
+		PR_ExecuteStatements (&qcvm->statements[statement], exitdepth, false);
+	else
+		PR_ExecuteDecoded (statement, exitdepth);
+}
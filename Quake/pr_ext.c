@@ -489,7 +489,7 @@ static void PF_strzone (void)
 	}
 	len++; /*for the null*/
 
-	buf = Mem_Alloc (len);
+	buf = Mem_AllocTagged (len, MEM_TAG_QC_STRINGS);
 	G_INT (OFS_RETURN) = PR_SetEngineString (buf);
 	id = -1 - G_INT (OFS_RETURN);
 	if (id >= qcvm->knownzonesize)
@@ -1021,8 +1021,8 @@ static void PF_sprintf_internal (const char *s, int firstarg, char *outbuf, int
 	static float dummyvec[3] = {0, 0, 0};
 
 	// temporary for PF_sprintf_internal as global to prevent big stack usage
-	// fine because only called from the main loop (PR_ExecuteProgram)
-	static char quotedbuf[65536];
+	// per thread because the server and the csqc vms can be executing at the same time
+	static THREAD_LOCAL char quotedbuf[65536];
 
 #define PRINTF_ALTERNATE	 1
 #define PRINTF_ZEROPAD		 2
@@ -1489,41 +1489,32 @@ static void PF_sprintf (void)
 }
 
 // string tokenizing (gah)
-#define MAXQCTOKENS 64
-static struct
-{
-	char		*token;
-	unsigned int start;
-	unsigned int end;
-} qctoken[MAXQCTOKENS];
-static unsigned int qctoken_count;
-
 static void tokenize_flush (void)
 {
-	while (qctoken_count > 0)
+	while (qcvm->numqctokens > 0)
 	{
-		qctoken_count--;
-		Mem_Free (qctoken[qctoken_count].token);
+		qcvm->numqctokens--;
+		Mem_Free (qcvm->qctokens[qcvm->numqctokens].token);
 	}
-	qctoken_count = 0;
+	qcvm->numqctokens = 0;
 }
 
 static void PF_ArgC (void)
 {
-	G_FLOAT (OFS_RETURN) = qctoken_count;
+	G_FLOAT (OFS_RETURN) = qcvm->numqctokens;
 }
 
 static int tokenizeqc (const char *str, qboolean dpfuckage)
 {
 	// FIXME: if dpfuckage, then we should handle punctuation specially, as well as /*.
 	const char *start = str;
-	while (qctoken_count > 0)
+	while (qcvm->numqctokens > 0)
 	{
-		qctoken_count--;
-		Mem_Free (qctoken[qctoken_count].token);
+		qcvm->numqctokens--;
+		Mem_Free (qcvm->qctokens[qcvm->numqctokens].token);
 	}
-	qctoken_count = 0;
-	while (qctoken_count < MAXQCTOKENS)
+	qcvm->numqctokens = 0;
+	while (qcvm->numqctokens < MAXQCTOKENS)
 	{
 		/*skip whitespace here so the token's start is accurate*/
 		while (*str && *(const unsigned char *)str <= ' ')
@@ -1532,7 +1523,7 @@ static int tokenizeqc (const char *str, qboolean dpfuckage)
 		if (!*str)
 			break;
 
-		qctoken[qctoken_count].start = str - start;
+		qcvm->qctokens[qcvm->numqctokens].start = str - start;
 		//		if (dpfuckage)
 		//			str = COM_ParseDPFuckage(str);
 		//		else
@@ -1540,12 +1531,12 @@ static int tokenizeqc (const char *str, qboolean dpfuckage)
 		if (!str)
 			break;
 
-		qctoken[qctoken_count].token = q_strdup (com_token);
+		qcvm->qctokens[qcvm->numqctokens].token = q_strdup (com_token);
 
-		qctoken[qctoken_count].end = str - start;
-		qctoken_count++;
+		qcvm->qctokens[qcvm->numqctokens].end = str - start;
+		qcvm->numqctokens++;
 	}
-	return qctoken_count;
+	return qcvm->numqctokens;
 }
 
 /*KRIMZON_SV_PARSECLIENTCOMMAND added these two - note that for compatibility with DP, this tokenize builtin is veeery vauge and doesn't match the console*/
@@ -1578,7 +1569,7 @@ static void PF_tokenizebyseparator (void)
 
 	tokenize_flush ();
 
-	qctoken[qctoken_count].start = 0;
+	qcvm->qctokens[qcvm->numqctokens].start = 0;
 	if (*str)
 		for (;;)
 		{
@@ -1586,7 +1577,7 @@ static void PF_tokenizebyseparator (void)
 			/*see if its a separator*/
 			if (!*str)
 			{
-				qctoken[qctoken_count].end = str - start;
+				qcvm->qctokens[qcvm->numqctokens].end = str - start;
 				found = true;
 			}
 			else
@@ -1595,7 +1586,7 @@ static void PF_tokenizebyseparator (void)
 				{
 					if (!strncmp (str, sep[s], seplen[s]))
 					{
-						qctoken[qctoken_count].end = str - start;
+						qcvm->qctokens[qcvm->numqctokens].end = str - start;
 						str += seplen[s];
 						found = true;
 						break;
@@ -1605,21 +1596,21 @@ static void PF_tokenizebyseparator (void)
 			/*it was, split it out*/
 			if (found)
 			{
-				tlen = qctoken[qctoken_count].end - qctoken[qctoken_count].start;
-				qctoken[qctoken_count].token = Mem_Alloc (tlen + 1);
-				memcpy (qctoken[qctoken_count].token, start + qctoken[qctoken_count].start, tlen);
-				qctoken[qctoken_count].token[tlen] = 0;
+				tlen = qcvm->qctokens[qcvm->numqctokens].end - qcvm->qctokens[qcvm->numqctokens].start;
+				qcvm->qctokens[qcvm->numqctokens].token = Mem_Alloc (tlen + 1);
+				memcpy (qcvm->qctokens[qcvm->numqctokens].token, start + qcvm->qctokens[qcvm->numqctokens].start, tlen);
+				qcvm->qctokens[qcvm->numqctokens].token[tlen] = 0;
 
-				qctoken_count++;
+				qcvm->numqctokens++;
 
-				if (*str && qctoken_count < MAXQCTOKENS)
-					qctoken[qctoken_count].start = str - start;
+				if (*str && qcvm->numqctokens < MAXQCTOKENS)
+					qcvm->qctokens[qcvm->numqctokens].start = str - start;
 				else
 					break;
 			}
 			str++;
 		}
-	G_FLOAT (OFS_RETURN) = qctoken_count;
+	G_FLOAT (OFS_RETURN) = qcvm->numqctokens;
 }
 
 static void PF_argv_start_index (void)
@@ -1628,12 +1619,12 @@ static void PF_argv_start_index (void)
 
 	/*negative indexes are relative to the end*/
 	if (idx < 0)
-		idx += qctoken_count;
+		idx += qcvm->numqctokens;
 
-	if ((unsigned int)idx >= qctoken_count)
+	if ((unsigned int)idx >= qcvm->numqctokens)
 		G_FLOAT (OFS_RETURN) = -1;
 	else
-		G_FLOAT (OFS_RETURN) = qctoken[idx].start;
+		G_FLOAT (OFS_RETURN) = qcvm->qctokens[idx].start;
 }
 
 static void PF_argv_end_index (void)
@@ -1642,12 +1633,12 @@ static void PF_argv_end_index (void)
 
 	/*negative indexes are relative to the end*/
 	if (idx < 0)
-		idx += qctoken_count;
+		idx += qcvm->numqctokens;
 
-	if ((unsigned int)idx >= qctoken_count)
+	if ((unsigned int)idx >= qcvm->numqctokens)
 		G_FLOAT (OFS_RETURN) = -1;
 	else
-		G_FLOAT (OFS_RETURN) = qctoken[idx].end;
+		G_FLOAT (OFS_RETURN) = qcvm->qctokens[idx].end;
 }
 
 static void PF_ArgV (void)
@@ -1656,14 +1647,14 @@ static void PF_ArgV (void)
 
 	/*negative indexes are relative to the end*/
 	if (idx < 0)
-		idx += qctoken_count;
+		idx += qcvm->numqctokens;
 
-	if ((unsigned int)idx >= qctoken_count)
+	if ((unsigned int)idx >= qcvm->numqctokens)
 		G_INT (OFS_RETURN) = 0;
 	else
 	{
 		char *ret = PR_GetTempString ();
-		q_strlcpy (ret, qctoken[idx].token, STRINGTEMP_LENGTH);
+		q_strlcpy (ret, qcvm->qctokens[idx].token, STRINGTEMP_LENGTH);
 		G_INT (OFS_RETURN) = PR_SetEngineString (ret);
 	}
 }
@@ -1872,6 +1863,90 @@ static void PF_TraceToss (void)
 		pr_global_struct->trace_ent = EDICT_TO_PROG (qcvm->edicts);
 }
 
+
+// batched traces, queued by tracebox_queue and run together by tracebox_flush
+#define MAX_TRACE_QUEUE 65536
+static void PF_tracebox_queue (void)
+{
+	svmove_t *move;
+	float	 *v1, *v2;
+
+	if (qcvm->tracequeue_flushed)
+	{
+		qcvm->numtracequeue = 0;
+		qcvm->tracequeue_flushed = false;
+	}
+	if (qcvm->numtracequeue == MAX_TRACE_QUEUE)
+	{
+		G_FLOAT (OFS_RETURN) = -1;
+		return;
+	}
+	if (qcvm->numtracequeue == qcvm->maxtracequeue)
+	{
+		qcvm->maxtracequeue = q_max (qcvm->maxtracequeue * 2, 64);
+		qcvm->tracequeue = (svmove_t *)Mem_Realloc (qcvm->tracequeue, qcvm->maxtracequeue * sizeof (svmove_t));
+	}
+
+	move = &qcvm->tracequeue[qcvm->numtracequeue];
+	v1 = G_VECTOR (OFS_PARM0);
+	v2 = G_VECTOR (OFS_PARM3);
+	if (IS_NAN (v1[0]) || IS_NAN (v1[1]) || IS_NAN (v1[2]))
+		VectorCopy (vec3_origin, move->start);
+	else
+		VectorCopy (v1, move->start);
+	if (IS_NAN (v2[0]) || IS_NAN (v2[1]) || IS_NAN (v2[2]))
+		VectorCopy (vec3_origin, move->end);
+	else
+		VectorCopy (v2, move->end);
+	VectorCopy (G_VECTOR (OFS_PARM1), move->mins);
+	VectorCopy (G_VECTOR (OFS_PARM2), move->maxs);
+	move->type = G_FLOAT (OFS_PARM4);
+	move->passedict = G_EDICT (OFS_PARM5);
+
+	G_FLOAT (OFS_RETURN) = qcvm->numtracequeue++;
+}
+static void PF_tracebox_flush (void)
+{
+	if (!qcvm->tracequeue_flushed)
+	{
+		SV_MoveBatch (qcvm->tracequeue, qcvm->numtracequeue);
+		qcvm->tracequeue_flushed = true;
+	}
+	G_FLOAT (OFS_RETURN) = qcvm->numtracequeue;
+}
+static void PF_tracebox_result (void)
+{
+	int		 index = G_FLOAT (OFS_PARM0);
+	trace_t *trace;
+
+	if (!qcvm->tracequeue_flushed || index < 0 || index >= qcvm->numtracequeue)
+	{
+		PR_RunWarning ("tracebox_result: no flushed trace %i\n", index);
+		return;
+	}
+
+	trace = &qcvm->tracequeue[index].trace;
+	pr_global_struct->trace_allsolid = trace->allsolid;
+	pr_global_struct->trace_startsolid = trace->startsolid;
+	pr_global_struct->trace_fraction = trace->fraction;
+	pr_global_struct->trace_inwater = trace->inwater;
+	pr_global_struct->trace_inopen = trace->inopen;
+	VectorCopy (trace->endpos, pr_global_struct->trace_endpos);
+	VectorCopy (trace->plane.normal, pr_global_struct->trace_plane_normal);
+	pr_global_struct->trace_plane_dist = trace->plane.dist;
+	if (trace->ent)
+		pr_global_struct->trace_ent = EDICT_TO_PROG (trace->ent);
+	else
+		pr_global_struct->trace_ent = EDICT_TO_PROG (qcvm->edicts);
+}
+static void PF_tracebox_shutdown (void)
+{
+	Mem_Free (qcvm->tracequeue);
+	qcvm->tracequeue = NULL;
+	qcvm->numtracequeue = qcvm->maxtracequeue = 0;
+	qcvm->tracequeue_flushed = false;
+}
+
 // model stuff
 void		SetMinMaxSize (edict_t *e, float *minvec, float *maxvec, qboolean rotate);
 static void PF_sv_setmodelindex (void)
@@ -2169,7 +2244,7 @@ static void PF_getsurfacenearpoint (void)
 		return;
 
 	bestdist = NEARSURFACE_MAXDIST;
-	cacheable = ent->v.modelindex == 1;
+	cacheable = ent->v.modelindex == 1 && qcvm == &sv.qcvm; // one cache, so only for the server's world
 
 	// all polies, we can skip parts. special case.
 	surf = model->surfaces + model->firstmodelsurface;
@@ -2350,18 +2425,22 @@ static void PF_getsurfacepointattribute (void)
 }
 static void PF_sv_getlight (void)
 {
-	qmodel_t		   *om = cl.worldmodel;
-	float			   *point = G_VECTOR (OFS_PARM0);
-	static lightcache_t lc;
+	qmodel_t						*om = cl.worldmodel;
+	float							*point = G_VECTOR (OFS_PARM0);
+	static THREAD_LOCAL lightcache_t lc;
 
-	cl.worldmodel = qcvm->worldmodel; // R_LightPoint is really clientside, so if its called from ssqc then try to make things work regardless
-									  // FIXME: d_lightstylevalue isn't set on dedicated servers
+	// R_LightPoint is really clientside, so if its called from ssqc then try to make things work regardless
+	// FIXME: d_lightstylevalue isn't set on dedicated servers
+	// only swapped when it differs, the threaded server must not write it while the client renders the same map
+	if (om != qcvm->worldmodel)
+		cl.worldmodel = qcvm->worldmodel;
 
 	// FIXME: seems like quakespasm doesn't do lits for model lighting, so we won't either.
 	vec3_t lightcolor;
 	G_FLOAT (OFS_RETURN + 0) = G_FLOAT (OFS_RETURN + 1) = G_FLOAT (OFS_RETURN + 2) = R_LightPoint (point, 0.f, &lc, &lightcolor) / 255.0;
 
-	cl.worldmodel = om;
+	if (cl.worldmodel != om)
+		cl.worldmodel = om;
 }
 #define PF_cl_getlight PF_sv_getlight
 
@@ -3040,7 +3119,8 @@ struct strbuf
 
 #define BUFSTRBASE	  1
 #define NUMSTRINGBUFS 64u
-static struct strbuf strbuflist[NUMSTRINGBUFS];
+static struct strbuf strbuflist[NUMSTRINGBUFS]; // shared by the vms, each only sees its own
+static SDL_Mutex	*strbuflist_mutex;			 // taking and returning slots
 
 static void PF_buf_shutdown (void)
 {
@@ -3055,10 +3135,12 @@ static void PF_buf_shutdown (void)
 			Mem_Free (strbuflist[bufno].strings[i]);
 		Mem_Free (strbuflist[bufno].strings);
 
-		strbuflist[bufno].owningvm = NULL;
 		strbuflist[bufno].strings = NULL;
 		strbuflist[bufno].used = 0;
 		strbuflist[bufno].allocated = 0;
+		SDL_LockMutex (strbuflist_mutex);
+		strbuflist[bufno].owningvm = NULL;
+		SDL_UnlockMutex (strbuflist_mutex);
 	}
 }
 
@@ -3080,6 +3162,8 @@ static void PF_buf_create (void)
 
 	// flags&1 == saved. apparently.
 
+	G_FLOAT (OFS_RETURN) = -1;
+	SDL_LockMutex (strbuflist_mutex);
 	for (i = 0; i < NUMSTRINGBUFS; i++)
 	{
 		if (!strbuflist[i].owningvm)
@@ -3089,10 +3173,10 @@ static void PF_buf_create (void)
 			strbuflist[i].allocated = 0;
 			strbuflist[i].strings = NULL;
 			G_FLOAT (OFS_RETURN) = i + BUFSTRBASE;
-			return;
+			break;
 		}
 	}
-	G_FLOAT (OFS_RETURN) = -1;
+	SDL_UnlockMutex (strbuflist_mutex);
 }
 // #441 void(float bufhandle) buf_del (DP_QC_STRINGBUFFERS)
 static void PF_buf_del (void)
@@ -3102,7 +3186,7 @@ static void PF_buf_del (void)
 
 	if (bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	for (i = 0; i < strbuflist[bufno].used; i++)
@@ -3116,7 +3200,9 @@ static void PF_buf_del (void)
 	strbuflist[bufno].used = 0;
 	strbuflist[bufno].allocated = 0;
 
+	SDL_LockMutex (strbuflist_mutex);
 	strbuflist[bufno].owningvm = NULL;
+	SDL_UnlockMutex (strbuflist_mutex);
 }
 // #442 float(float bufhandle) buf_getsize (DP_QC_STRINGBUFFERS)
 static void PF_buf_getsize (void)
@@ -3125,7 +3211,7 @@ static void PF_buf_getsize (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	G_FLOAT (OFS_RETURN) = strbuflist[bufno].used;
@@ -3141,11 +3227,11 @@ static void PF_buf_copy (void)
 		return;
 	if (buffrom >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[buffrom].owningvm)
+	if (strbuflist[buffrom].owningvm != qcvm)
 		return;
 	if (bufto >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufto].owningvm)
+	if (strbuflist[bufto].owningvm != qcvm)
 		return;
 
 	// obliterate any and all existing data.
@@ -3160,7 +3246,7 @@ static void PF_buf_copy (void)
 	for (i = 0; i < strbuflist[buffrom].used; i++)
 		strbuflist[bufto].strings[i] = strbuflist[buffrom].strings[i] ? q_strdup (strbuflist[buffrom].strings[i]) : NULL;
 }
-static int PF_buf_sort_sortprefixlen;
+static THREAD_LOCAL int PF_buf_sort_sortprefixlen;
 static int PF_buf_sort_ascending (const void *a, const void *b)
 {
 	return strncmp (*(char *const *)a, *(char *const *)b, PF_buf_sort_sortprefixlen);
@@ -3180,7 +3266,7 @@ static void PF_buf_sort (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	if (sortprefixlen <= 0)
@@ -3217,7 +3303,7 @@ static void PF_buf_implode (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	// count neededlength
@@ -3277,7 +3363,7 @@ static void PF_bufstr_get (void)
 		G_INT (OFS_RETURN) = 0;
 		return;
 	}
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 	{
 		G_INT (OFS_RETURN) = 0;
 		return;
@@ -3308,7 +3394,7 @@ static void PF_bufstr_set (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	if (index >= strbuflist[bufno].allocated)
@@ -3374,7 +3460,7 @@ static void PF_bufstr_add (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	G_FLOAT (OFS_RETURN) = PF_bufstr_add_internal (bufno, string, ordered);
@@ -3387,7 +3473,7 @@ static void PF_bufstr_free (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	if (index >= strbuflist[bufno].used)
@@ -3410,7 +3496,7 @@ static void PF_buf_cvarlist (void)
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
-	if (!strbuflist[bufno].owningvm)
+	if (strbuflist[bufno].owningvm != qcvm)
 		return;
 
 	// obliterate any and all existing data.
@@ -3446,6 +3532,7 @@ static void PF_copyentity (void)
 	edict_t *dst = (qcvm->argc < 2) ? ED_Alloc () : G_EDICT (OFS_PARM1);
 	if (src->free || dst->free)
 		Con_Printf ("PF_copyentity: entity is free\n");
+	PR_FieldsWritten (dst, ED_MARK_MOVED | ED_MARK_FIND_ALL);
 	memcpy (&dst->v, &src->v, qcvm->edict_size - sizeof (entvars_t));
 	dst->alpha = src->alpha;
 	dst->sendinterval = src->sendinterval;
@@ -3659,7 +3746,10 @@ static void PF_putentfldstr (void)
 	edict_t		*ent = G_EDICT (OFS_PARM1);
 	const char	*value = G_STRING (OFS_PARM2);
 	if (fldidx < (unsigned int)qcvm->progs->numfielddefs)
+	{
+		PR_FieldsWritten (ent, ED_MARK_MOVED | ED_MARK_FIND_ALL);
 		G_FLOAT (OFS_RETURN) = ED_ParseEpair ((void *)&ent->v, qcvm->fielddefs + fldidx, value, true);
+	}
 	else
 		G_FLOAT (OFS_RETURN) = false;
 }
@@ -4117,6 +4207,7 @@ static void PF_setattachment (void)
 static struct svcustomstat_s *PR_CustomStat (int idx, int type)
 {
 	size_t i;
+	int	   j;
 	if (idx < 0 || idx >= MAX_CL_STATS)
 		return NULL;
 	switch (type)
@@ -4138,6 +4229,9 @@ static struct svcustomstat_s *PR_CustomStat (int idx, int type)
 	}
 	if (i == sv.numcustomstats)
 		sv.numcustomstats++;
+	// bits are never cleared until the next map, a stale one only costs a zero compare
+	for (j = idx; j < idx + (type == ev_vector ? 3 : 1) && j < MAX_CL_STATS; j++)
+		sv.customstats_mask[j / 32] |= 1u << (j & 31);
 	sv.customstats[i].idx = idx;
 	sv.customstats[i].type = type;
 	sv.customstats[i].fld = 0;
@@ -4549,9 +4643,9 @@ static void			DrawQC_CharacterQuad (cb_context_t *cbx, float x, float y, int num
 	qboolean alpha_blend = alpha < 1.0f;
 	size = 0.0624; // avoid rounding errors...
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	basicvertex_t *vertices = Draw_BatchVertices (
+		cbx, alpha_blend ? vulkan_globals.basic_blend_pipeline[cbx->render_pass_index] : vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index],
+		char_texture, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
@@ -4594,15 +4688,6 @@ static void			DrawQC_CharacterQuad (cb_context_t *cbx, float x, float y, int num
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	if (alpha_blend)
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	else
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, 6, 1, 0, 0);
 }
 static void PF_cl_drawcharacter (void)
 {
@@ -4701,7 +4786,10 @@ static void PF_cl_drawsetclip (void)
 	render_area.offset.y = y;
 	render_area.extent.width = w;
 	render_area.extent.height = h;
+#ifndef SERVERONLY // csqc never runs in the dedicated server build
+	Draw_FlushBatch (vulkan_globals.secondary_cb_contexts[SCBX_GUI]);
 	vkCmdSetScissor (vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].cb, 0, 1, &render_area);
+#endif
 }
 static void PF_cl_drawresetclip (void)
 {
@@ -4710,7 +4798,10 @@ static void PF_cl_drawresetclip (void)
 	render_area.offset.y = 0;
 	render_area.extent.width = vid.width;
 	render_area.extent.height = vid.height;
+#ifndef SERVERONLY // csqc never runs in the dedicated server build
+	Draw_FlushBatch (vulkan_globals.secondary_cb_contexts[SCBX_GUI]);
 	vkCmdSetScissor (vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].cb, 0, 1, &render_area);
+#endif
 }
 
 static void PF_cl_precachepic (void)
@@ -4776,9 +4867,8 @@ static void PF_cl_drawfill (void)
 	float *rgb = G_VECTOR (OFS_PARM2);
 	float  alpha = G_FLOAT (OFS_PARM3);
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	cb_context_t  *cbx = vulkan_globals.secondary_cb_contexts[SCBX_GUI];
+	basicvertex_t *vertices = Draw_BatchVertices (cbx, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index], NULL, 6);
 
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
@@ -4813,13 +4903,6 @@ static void PF_cl_drawfill (void)
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	cb_context_t *cbx = vulkan_globals.secondary_cb_contexts[SCBX_GUI];
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, 6, 1, 0, 0);
 }
 
 void PF_cl_playerkey_internal (int player, const char *key, qboolean retfloat)
@@ -4977,7 +5060,7 @@ static void PF_checkpvs (void)
 	edict_t *ed = G_EDICT (OFS_PARM1);
 
 	mleaf_t		*leaf = Mod_PointInLeaf (org, qcvm->worldmodel);
-	byte		*pvs = Mod_LeafPVS (leaf, qcvm->worldmodel); // johnfitz -- worldmodel as a parameter
+	const byte	*pvs = Mod_CachedLeafPVS (leaf, qcvm->worldmodel); // johnfitz -- worldmodel as a parameter
 	unsigned int i;
 
 	for (i = 0; i < ed->num_leafs; i++)
@@ -5029,6 +5112,9 @@ static struct
 	{"multicast",					PF_multicast,					PF_NoCSQC,						82,		D("#define unicast(pl,reli) do{msg_entity = pl; multicast('0 0 0', reli?MULITCAST_ONE_R:MULTICAST_ONE);}while(0)\n"
 																											"void(vector where, float set)", "Once the MSG_MULTICAST network message buffer has been filled with data, this builtin is used to dispatch it to the given target, filtering by pvs for reduced network bandwidth.")},	//82
 	{"tracebox",					PF_tracebox,					PF_tracebox,					90,		D("void(vector start, vector mins, vector maxs, vector end, float nomonsters, entity ent)", "Exactly like traceline, but a box instead of a uselessly thin point. Acceptable sizes are limited by bsp format, q1bsp has strict acceptable size values.")},
+	{"tracebox_queue",				PF_tracebox_queue,				PF_tracebox_queue,				0,		D("float(vector start, vector mins, vector maxs, vector end, float nomonsters, entity ent)", "Queues a tracebox for tracebox_flush and returns its index, or -1 if the queue is full. The first call after a flush starts a new queue.")},
+	{"tracebox_flush",				PF_tracebox_flush,				PF_tracebox_flush,				0,		D("float()", "Runs all queued traces at once, in parallel when there are enough of them, and returns how many there were. They all see the entities as they are now.")},
+	{"tracebox_result",				PF_tracebox_result,				PF_tracebox_result,				0,		D("void(float index)", "Sets the trace_* globals to the result of a flushed trace, exactly as tracebox would have.")},
 	{"randomvec",					PF_randomvector,				PF_randomvector,				91,		D("vector()", "Returns a vector with random values. Each axis is independantly a value between -1 and 1 inclusive.")},
 	{"getlight",					PF_sv_getlight,					PF_cl_getlight,					92,		"vector(vector org)"},// (DP_QC_GETLIGHT),
 	{"registercvar",				PF_registercvar,				PF_registercvar,				93,		D("float(string cvarname, string defaultvalue)", "Creates a new cvar on the fly. If it does not already exist, it will be given the specified value. If it does exist, this is a no-op.\nThis builtin has the limitation that it does not apply to configs or commandlines. Such configs will need to use the set or seta command causing this builtin to be a noop.\nIn engines that support it, you will generally find the autocvar feature easier and more efficient to use.")},
@@ -5361,6 +5447,7 @@ static struct
 	{"FTE_SV_POINTPARTICLES", PR_Can_Particles},
 #endif
 	{"KRIMZON_SV_PARSECLIENTCOMMAND"},
+	{"VKQUAKE_QC_TRACEBATCH"},
 	{"ZQ_QC_STRINGS"},
 };
 
@@ -5545,6 +5632,7 @@ void PR_ShutdownExtensions (void)
 {
 	PR_UnzoneAll ();
 	PF_buf_shutdown ();
+	PF_tracebox_shutdown ();
 	tokenize_flush ();
 	pr_ext_warned_particleeffectnum = 0;
 }
@@ -5600,6 +5688,8 @@ void PR_AutoCvarChanged (cvar_t *var)
 void PR_InitExtensions (void)
 {
 	size_t i, g, m;
+	strbuflist_mutex = SDL_CreateMutex ();
+
 	// this only needs to be done once. because we're evil.
 	// it should help slightly with the 'documentation' above at least.
 	g = m = countof (qcvm->builtins);
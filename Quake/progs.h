@@ -43,10 +43,13 @@ typedef union eval_s
 #define MAX_ENT_LEAFS 32
 typedef struct edict_s
 {
-	link_t area; /* linked to a division node or leaf */
+	link_t area;	 /* linked to a division node or leaf */
+	int	   areacell; /* sv_areagrid: 1 + index into qcvm->areacells if linked */
+	int	   areaslot; /* sv_areagrid: index in the arrays of that cell */
 
 	unsigned int num_leafs;
 	int			 leafnums[MAX_ENT_LEAFS];
+	int			 leafslots[MAX_ENT_LEAFS]; /* index in qcvm->leafedicts[leafnums[i]] */
 
 	entity_state_t baseline;
 	unsigned char  alpha;		 /* johnfitz -- hack to support alpha since it's not part of entvars_t */
@@ -56,8 +59,11 @@ typedef struct edict_s
 	vec3_t		   predthinkpos; /* expected edict origin once its nextthink arrives (sv_smoothplatformlerps) */
 	float		   lastthink;	 /* time when predthinkpos was updated, or 0 if not valid (sv_smoothplatformlerps) */
 
-	float	 freetime; /* sv.time when the object was freed */
-	qboolean free;
+	float			freetime; /* sv.time when the object was freed */
+	qboolean		free;
+	unsigned char	fieldmarks; /* ED_MARK_* bits, see PR_FieldsWritten */
+	struct edict_s *free_prev; /* qcvm->free_list links, in the order edicts were freed */
+	struct edict_s *free_next;
 
 	entvars_t v; /* C exported fields from progs */
 
@@ -66,6 +72,12 @@ typedef struct edict_s
 
 #define EDICT_FROM_AREA(l) STRUCT_FROM_LINK (l, edict_t, area)
 
+// edict_t fieldmarks, what was written since SV_LinkEdict or since the PF_Find index was built
+#define ED_MARK_MOVED		1 // origin, mins, maxs or solid
+#define ED_MARK_FIND(i)		(2 << (i))
+#define ED_MARK_FIND_ALL	(ED_MARK_FIND (0) | ED_MARK_FIND (1) | ED_MARK_FIND (2))
+#define NUM_FIND_INDICES	3 // classname, targetname, target
+
 //============================================================================
 
 typedef void (*builtin_t) (void);
@@ -75,9 +87,12 @@ typedef struct qcvm_s qcvm_t;
 void PR_Init (void);
 
 void	 PR_ExecuteProgram (func_t fnum);
+void	 PR_DecodeStatements (void);
 void	 PR_ClearProgs (qcvm_t *vm);
 qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcrc, const builtin_t *builtins, size_t numbuiltins);
 
+extern cvar_t pr_profile; // count statements per function for the "profile" command, uses the slower interpreter
+
 // from pr_ext.c
 void   PR_InitExtensions (void);
 void   PR_EnableExtensions (ddef_t *pr_globaldefs); // adds in the extra builtins etc
@@ -106,12 +121,26 @@ void		PR_ClearEdictStrings ();
 void		PR_ClearEngineString (int num);
 
 void PR_Profile_f (void);
+void PR_ProfileExport_f (void);
 
 edict_t *ED_Alloc (void);
 void	 ED_Free (edict_t *ed);
 void	 ED_RemoveFromFreeList (edict_t *ed);
 void	 ED_RebuildFreeList (bool force_free_reuse);
 
+void PR_FieldsWritten (edict_t *ed, unsigned int marks);
+void PR_ResetFieldMarks (void);
+void PR_FreeFindIndices (void);
+
+// ED_MARK_* bits per entvars_t field, for OP_ADDRESS
+extern const unsigned char pr_fieldmarks[sizeof (entvars_t) / 4];
+#define PR_FieldAddressed(ed, ofs)                                                                       \
+	do                                                                                                   \
+	{                                                                                                    \
+		if ((unsigned int)(ofs) < countof (pr_fieldmarks) && (pr_fieldmarks[(ofs)] & ~(ed)->fieldmarks)) \
+			PR_FieldsWritten ((ed), pr_fieldmarks[(ofs)]);                                               \
+	} while (0)
+
 void		ED_Print (edict_t *ed);
 void		ED_Write (FILE *f, edict_t *ed);
 const char *ED_ParseEdict (const char *data, edict_t *ent);
@@ -181,6 +210,15 @@ char	  *PF_VarString (int first);
 #define STRINGTEMP_LENGTH  1024
 void PF_Fixme (void); // the 'unimplemented' builtin. woot.
 
+// string tokenizing, pr_ext
+#define MAXQCTOKENS 64
+typedef struct
+{
+	char		*token;
+	unsigned int start;
+	unsigned int end;
+} qctoken_t;
+
 // clang-format off
 struct pr_extfuncs_s
 {
@@ -309,6 +347,25 @@ typedef struct
 	dfunction_t *f;
 } prstack_t;
 
+// dstatement_t with its operands resolved to globals, built by PR_DecodeStatements
+typedef struct
+{
+	eval_t *a, *b, *c;
+	int		op;	  // OP_BAD for anything unknown
+	int		jump; // statement offset of OP_IF, OP_IFNOT and OP_GOTO
+} prstatement_t;
+
+// calling context tree node of the pr_profile interpreter, one per distinct call stack
+typedef struct
+{
+	int		 function; // index into functions, builtins get their own nodes
+	int		 parent, child, sibling;
+	int		 calls;
+	uint64_t statements; // executed in this function itself
+	double	 time;		 // inclusive
+	double	 start;
+} prprofilenode_t;
+
 typedef struct areanode_s
 {
 	int				   axis; // -1 = leaf node
@@ -321,25 +378,66 @@ typedef struct areanode_s
 #define MAX_AREA_DEPTH	   9
 #define AREA_NODES		   (2 << MAX_AREA_DEPTH)
 
+// sv_areagrid: cell of the loose grid, holds the entities whose center is in it and that are no larger than a cell
+typedef struct
+{
+	int		  num_edicts;
+	int		  max_edicts;
+	edict_t	**edicts;
+	float	 *absmin[3]; // copied at link time, so queries only touch the cell's arrays
+	float	 *absmax[3];
+} areacell_t;
+#define AREA_GRID_SIZE		64	// at most, per axis
+#define AREA_GRID_MIN_CELL	256 // smallest cell size
+#define AREA_SOLID_EDICTS	0
+#define AREA_TRIGGER_EDICTS 1
+
+// PF_Find: the edicts sorted by the hash of one string field, the edicts written since then are in dirty
+typedef struct
+{
+	unsigned int hash;
+	int			 edict;
+} findentry_t;
+typedef struct
+{
+	qboolean	 valid;
+	findentry_t *entries;
+	int			 num_entries;
+	int			 max_entries;
+	int			*dirty; // ED_MARK_FIND, or strings that can change behind the field's back
+	int			 num_dirty;
+	int			 max_dirty;
+} findindex_t;
+
 typedef struct hash_map_s hash_map_t;
 
-// the free-list of edicts, as a FIFO made of a circular buffer.
+// the linked edicts touching a world leaf, in no particular order
+typedef struct
+{
+	int			  num_edicts;
+	int			  max_edicts;
+	unsigned int *edicts; // edict number * MAX_ENT_LEAFS + index into its leafnums
+} leafedicts_t;
+
+// the free-list of edicts, as a FIFO linked through the edicts.
 typedef struct freelist_s
 {
-	size_t	 size;		 // current nb of edicts
-	size_t	 head_index; // index of the first valid element (head of FIFO)
-	edict_t *circular_buffer[MAX_EDICTS];
+	size_t	 size; // current nb of edicts
+	edict_t *head; // oldest free edict, next to be reused
+	edict_t *tail;
 } freelist_t;
 
 struct qcvm_s
 {
-	dprograms_t	 *progs;
-	dfunction_t	 *functions;
-	hash_map_t	 *function_map;
-	dstatement_t *statements;
-	float		 *globals;	 /* same as pr_global_struct */
-	ddef_t		 *fielddefs; // yay reflection.
-	hash_map_t	 *fielddefs_map;
+	dprograms_t	  *progs;			   // copy of the header
+	const byte	  *progsfile;		   // COM_LoadFileView, lumps the vm never writes point into it
+	dfunction_t	  *functions;
+	hash_map_t	  *function_map;
+	dstatement_t  *statements;
+	prstatement_t *decoded_statements; // same indices as statements
+	float		  *globals;			   /* same as pr_global_struct */
+	ddef_t		  *fielddefs;		   // yay reflection.
+	hash_map_t	  *fielddefs_map;
 
 	int edict_size; /* in bytes */
 
@@ -365,6 +463,7 @@ struct qcvm_s
 	int			 stringssize;
 	const char **knownstrings;
 	qboolean	*knownstringsowned;
+	hash_map_t	*knownstrings_map; // pointer -> index, for PR_SetEngineString
 	int			 maxknownstrings;
 	int			 numknownstrings;
 	int			 progsstrings; // allocated by PR_MergeEngineFieldDefs (), not tied to edicts
@@ -384,6 +483,25 @@ struct qcvm_s
 	int localstack[LOCALSTACK_SIZE];
 	int localstack_used;
 
+	// builtin scratch state, per vm so that the threaded server and the csqc hud
+	// drawn by a render task can run at the same time
+	char (*tempstrings)[STRINGTEMP_LENGTH]; // PR_GetTempString ring, allocated on first use
+	unsigned int tempstring_index;
+	qctoken_t	 qctokens[MAXQCTOKENS]; // tokenize, argv
+	unsigned int numqctokens;
+
+	// recorded with pr_profile 1, node 0 is the root
+	prprofilenode_t *profile_nodes;
+	int				 num_profile_nodes;
+	int				 max_profile_nodes;
+	int				 profile_node; // of the running function
+
+	// tracebox_queue, results are valid once flushed
+	struct svmove_s *tracequeue;
+	int				 numtracequeue;
+	int				 maxtracequeue;
+	qboolean		 tracequeue_flushed;
+
 	// originally part of the sv_state_t struct
 	// FIXME: put worldmodel in here too.
 	double			 time;
@@ -398,11 +516,39 @@ struct qcvm_s
 	// originally from world.c
 	areanode_t areanodes[AREA_NODES];
 	int		   numareanodes;
+
+	// sv_areagrid, replaces areanodes when set at SV_ClearWorld
+	qboolean	areagrid;
+	areacell_t *areacells;			// solid cells, then trigger cells, each followed by the cell for the entities larger than a cell
+	int			numareacells;		// per list, including the large cell
+	int			areagrid_size[2];	// cells per axis
+	float		areagrid_origin[2];	// of cell 0
+	float		areagrid_cellsize;
+
+	// set up at SV_ClearWorld, maintained by SV_LinkEdict for the PVS scans
+	leafedicts_t *leafedicts; // per leaf number, as in edict_t leafnums
+	int			  numleafedicts;
+
+	// PF_findradius, edicts with ED_MARK_MOVED: the area grid doesn't know where they are
+	int		   *moved_edicts;
+	int			num_moved_edicts;
+	int			max_moved_edicts;
+	findindex_t findindices[NUM_FIND_INDICES];
 };
-extern globalvars_t *pr_global_struct;
+/*
+The active vm is per thread: the threaded server runs sv.qcvm next to the csqc hud in the gui
+render task. Two threads must never run the same vm. Different vms can run at the same time:
+- the interpreter, edicts, temp strings and tokenize/argv state are all inside qcvm_t
+- debug strings (PR_ValueString, PR_GlobalString, PF_VarString, sprintf) use per thread buffers
+- string buffers come from one pool under a mutex, each vm only sees its own
+- getsurfacenearpoint only caches for the server vm
+Not safe next to another vm: builtins that write engine state, e.g. cvar_set, localcmd, the
+sound and particle builtins, and getlight when the server's world differs from the client's.
+*/
+extern THREAD_LOCAL globalvars_t *pr_global_struct;
 
-extern qcvm_t *qcvm;
-void		   PR_SwitchQCVM (qcvm_t *nvm);
+extern THREAD_LOCAL qcvm_t *qcvm;
+void						PR_SwitchQCVM (qcvm_t *nvm);
 
 extern const builtin_t pr_ssqcbuiltins[];
 extern const int	   pr_ssqcnumbuiltins;
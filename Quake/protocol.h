@@ -32,6 +32,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 	(('F' << 0) + ('T' << 8) + ('E' << 16) + ('X' << 24)) // fte extensions, provides extensions to the underlying base protocol (like 666 or even 15).
 #define PROTOCOL_FTE_PEXT2 \
 	(('F' << 0) + ('T' << 8) + ('E' << 16) + ('2' << 24)) // fte extensions, provides extensions to the underlying base protocol (like 666 or even 15).
+#define PROTOCOL_VKQUAKE_PEXT \
+	(('V' << 0) + ('K' << 8) + ('Q' << 16) + ('1' << 24)) // vkquake extensions, negotiated along with the fte ones.
 
 // PROTOCOL_RMQ protocol flags
 #define PRFL_SHORTANGLE			(1 << 1)
@@ -55,6 +57,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define PEXT2_SUPPORTED_CLIENT	(PEXT2_REPLACEMENTDELTAS | PEXT2_PREDINFO) // pext2 flags that we understand+support
 #define PEXT2_SUPPORTED_SERVER	(PEXT2_REPLACEMENTDELTAS | PEXT2_PREDINFO)
 #define PEXT2_ACCEPTED_CLIENT	(PEXT2_SUPPORTED_CLIENT | PEXT2_PRYDONCURSOR | PEXT2_VOICECHAT) // pext2 flags that we can parse, but don't want to advertise
+// PROTOCOL_VKQUAKE_PEXT flags
+#define VKPEXT_DEFLATE			0x00000001 // reliable stream (and optionally large unreliables) deflated, see NET_QSocketSetDeflate
+#define VKPEXT_RELIABLEWINDOW	0x00000002 // several reliable fragments in flight both ways, see NET_QSocketSetReliableWindow
+#define VKPEXT_SUPPORTED_CLIENT (VKPEXT_DEFLATE | VKPEXT_RELIABLEWINDOW)
+#define VKPEXT_SUPPORTED_SERVER (VKPEXT_DEFLATE | VKPEXT_RELIABLEWINDOW)
 
 // if the high bit of the servercmd is set, the low bits are fast update flags:
 #define U_MOREBITS (1 << 0)
@@ -333,6 +340,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define svcfte_updateentities	86
 // spike -- end
 
+// server side demos only: byte player, 3 angle16 view angles, long size of the player's own svcs that follow
+#define svcvk_demoview 125
+
+// VKPEXT_DEFLATE, in place of the first svc of a deflated message. the parser only sees the inflated one
+#define svcvk_deflated		   126
+#define svcvk_deflateddatagram 127
+
 //
 // client to server
 //
@@ -25,6 +25,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef __QUAKE_SOUND__
 #define __QUAKE_SOUND__
 
+#include "atomics.h"
+
 /* !!! if this is changed, it must be changed in asm_i386.h too !!! */
 typedef struct
 {
@@ -45,8 +47,10 @@ typedef struct
 
 typedef struct sfx_s
 {
-	char		name[MAX_QPATH];
-	sfxcache_t *cache;
+	char			name[MAX_QPATH];
+	sfxcache_t	   *cache;
+	atomic_uint32_t lastused; /* S_CacheTime of the last S_MarkUsed or load	*/
+	atomic_uint32_t loading;  /* an S_LoadSoundAsync task is loading it		*/
 } sfx_t;
 
 typedef struct
@@ -75,6 +79,10 @@ typedef struct
 	vec3_t origin;	   /* origin of sound effect			*/
 	vec_t  dist_mult;  /* distance multiplier (attenuation/clipK)	*/
 	int	   master_vol; /* 0-255 master volume				*/
+	int	   pending;	   /* sfx is still loading, plays once it is cached	*/
+	int	   itd;		   /* snd_hrtf: far ear delay in samples, > 0 for the left ear	*/
+	int	   shadow;	   /* snd_hrtf: 0-256 head shadow lowpass of the far ear	*/
+	int	   shadowstate; /* snd_hrtf: last far ear sample				*/
 } channel_t;
 
 #define WAV_FORMAT_PCM 1
@@ -90,6 +98,7 @@ typedef struct
 } wavinfo_t;
 
 void S_Init (void);
+void S_FinishInit (void);
 void S_Startup (void);
 void S_Shutdown (void);
 void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation);
@@ -109,9 +118,15 @@ void   S_TouchSound (const char *sample);
 void   S_ClearPrecache (void);
 void   S_BeginPrecaching (void);
 void   S_EndPrecaching (void);
-void   S_PaintChannels (int endtime);
+void   S_WaitPrecaching (void);
+void   S_PaintChannels (int endtime, qboolean pause_loops);
 void   S_InitPaintChannels (void);
 
+/* the mixer thread owns snd_channels, this waits for it to execute the commands pushed so far */
+void S_SyncMixer (void);
+/* called by the audio callback once it has consumed part of the DMA buffer */
+void S_WakeMixer (void);
+
 /* picks a channel based on priorities, empty slots, number of channels */
 channel_t *SND_PickChannel (int entnum, int entchannel);
 
@@ -174,6 +189,10 @@ extern cvar_t snd_mixspeed;
 extern cvar_t snd_filterquality;
 extern cvar_t sfxvolume;
 extern cvar_t loadas8bit;
+extern cvar_t snd_cachesize;
+extern cvar_t snd_hrtf;
+extern cvar_t snd_virtualvolume;
+extern cvar_t snd_maxvoices;
 
 #define MAX_RAW_SAMPLES 8192
 extern portable_samplepair_t s_rawsamples[MAX_RAW_SAMPLES];
@@ -182,6 +201,17 @@ extern cvar_t bgmvolume;
 
 void		S_LocalSound (const char *name);
 sfxcache_t *S_LoadSound (sfx_t *s);
+sfxcache_t *S_CachedSound (sfx_t *s);
+
+/* sound cache budget, see snd_cachesize */
+#define SND_CACHE_MINAGE 2000 /* ms since the last use before a sound may be evicted */
+
+void	 S_LoadSoundAsync (sfx_t *s);
+void	 S_WaitAsyncLoads (void);
+void	 S_MarkUsed (sfx_t *s);
+void	 S_FreeCache (sfx_t *s);
+uint32_t S_CacheTime (void);
+uint64_t S_CacheBytes (void);
 
 wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
 
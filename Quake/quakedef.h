@@ -57,10 +57,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define SDL_WaitCondition						SDL_CondWait
 #define SDL_WaitConditionTimeout(cond, mtx, ms) (SDL_CondWaitTimeout (cond, mtx, ms) == 0)
 
-#define SDL_SignalSemaphore		  SDL_SemPost
-#define SDL_Semaphore			  SDL_sem
-#define SDL_TryWaitSemaphore(sem) (SDL_SemTryWait (sem) == 0)
-#define SDL_WaitSemaphore		  SDL_SemWait
+#define SDL_SignalSemaphore				  SDL_SemPost
+#define SDL_Semaphore					  SDL_sem
+#define SDL_TryWaitSemaphore(sem)		  (SDL_SemTryWait (sem) == 0)
+#define SDL_WaitSemaphore				  SDL_SemWait
+#define SDL_WaitSemaphoreTimeout(sem, ms) (SDL_SemWaitTimeout (sem, ms) == 0)
 
 #define SDL_GetNumLogicalCPUCores SDL_GetCPUCount
 #endif
@@ -332,6 +333,7 @@ static inline int FindLastBitNonZero64 (const uint64_t mask)
 #include "tasks.h"
 #include "atomics.h"
 #include "hash_map.h"
+#include "frame_stats.h"
 
 //=============================================================================
 
@@ -371,6 +373,10 @@ extern filelist_item_t *savelist;
 
 void			   Host_ClearMemory (void);
 void			   Host_ServerFrame (void);
+void			   Host_WaitServerFrame (void);
+qboolean		   Host_ServerFrameRunning (void);
+qboolean		   Host_IsServerThread (void);
+void			   Host_CallOnMainThread (void (*func) (void *data), void *data);
 void			   Host_InitCommands (void);
 void			   Host_Init (void);
 void			   Host_Shutdown (void);
@@ -393,6 +399,19 @@ void ExtraMaps_NewGame (void);
 void DemoList_Rebuild (void);
 void SaveList_Rebuild (void);
 
+typedef struct
+{
+	char	name[MAX_QPATH]; // file name in the save directory
+	int64_t mtime;
+	char	comment[SAVEGAME_COMMENT_LENGTH + 1];
+	char	mapname[MAX_QPATH];
+	double	time;
+} saveinfo_t;
+
+const saveinfo_t *SaveList_GetInfo (const char *path);
+void			  SaveList_UpdateInfo (const char *path, const char *comment, const char *mapname, double time);
+void			  SaveList_WriteIndex (void);
+
 extern int current_skill; // skill level for currently loaded level (in case
 						  //  the user changes the cvar while the level is
 						  //  running, this reflects the level actually in use)
@@ -406,6 +425,7 @@ extern atomic_uint32_t num_vulkan_bmodel_allocations;
 extern atomic_uint32_t num_vulkan_mesh_allocations;
 extern atomic_uint32_t num_vulkan_misc_allocations;
 extern atomic_uint32_t num_vulkan_dynbuf_allocations;
+extern atomic_uint32_t num_vulkan_ui_allocations;
 extern atomic_uint32_t num_vulkan_combined_image_samplers;
 extern atomic_uint32_t num_vulkan_ubos_dynamic;
 extern atomic_uint32_t num_vulkan_input_attachments;
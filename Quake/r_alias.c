@@ -66,14 +66,14 @@ typedef struct
 =============
 GLARB_GetXYZOffset
 
-Returns the offset of the first vertex's meshxyz_t.xyz in the vbo for the given
-model and pose.
+Returns the offset of the first vertex's meshxyz_t.xyz in the alias megabuffer for
+the given model and pose.
 =============
 */
 static VkDeviceSize GLARB_GetXYZOffset (entity_t *e, aliashdr_t *hdr, int pose)
 {
 	const int xyzoffs = offsetof (meshxyz_t, xyz);
-	return hdr->numverts_vbo * pose * sizeof (meshxyz_t) + xyzoffs;
+	return hdr->vertex_offset + hdr->numverts_vbo * pose * sizeof (meshxyz_t) + xyzoffs;
 }
 
 /*
@@ -161,6 +161,9 @@ static void GL_DrawAliasFrame (
 
 	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
+	TexMgr_MarkUsed (tx);
+	TexMgr_MarkUsed (fb);
+
 	float blend;
 
 	if (lerpdata.pose1 != lerpdata.pose2)
@@ -198,11 +201,12 @@ static void GL_DrawAliasFrame (
 
 		VkBuffer	 vertex_buffers[3] = {paliashdr->vertex_buffer, paliashdr->vertex_buffer, paliashdr->vertex_buffer};
 		VkDeviceSize vertex_offsets[3] = {
-			(unsigned)paliashdr->vbostofs, GLARB_GetXYZOffset (e, paliashdr, lerpdata.pose1), GLARB_GetXYZOffset (e, paliashdr, lerpdata.pose2)};
+			paliashdr->vertex_offset + paliashdr->vbostofs, GLARB_GetXYZOffset (e, paliashdr, lerpdata.pose1),
+			GLARB_GetXYZOffset (e, paliashdr, lerpdata.pose2)};
 		vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 3, vertex_buffers, vertex_offsets);
 		vulkan_globals.vk_cmd_bind_index_buffer (cbx->cb, paliashdr->index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
-		vulkan_globals.vk_cmd_draw_indexed (cbx->cb, paliashdr->numindexes, 1, 0, 0, 0);
+		vulkan_globals.vk_cmd_draw_indexed (cbx->cb, paliashdr->numindexes, 1, paliashdr->index_offset / sizeof (unsigned short), 0, 0);
 		break;
 	}
 	case PV_MD5:
@@ -228,12 +232,12 @@ static void GL_DrawAliasFrame (
 			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout.handle, 0, 4, descriptor_sets, 1, &uniform_offset);
 
 		VkBuffer	 vertex_buffers[1] = {paliashdr->vertex_buffer};
-		VkDeviceSize vertex_offsets[1] = {0};
+		VkDeviceSize vertex_offsets[1] = {paliashdr->vertex_offset};
 		vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, vertex_buffers, vertex_offsets);
 		vulkan_globals.vk_cmd_bind_index_buffer (cbx->cb, paliashdr->index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
 		//
-		vulkan_globals.vk_cmd_draw_indexed (cbx->cb, paliashdr->numindexes, 1, 0, 0, 0);
+		vulkan_globals.vk_cmd_draw_indexed (cbx->cb, paliashdr->numindexes, 1, paliashdr->index_offset / sizeof (unsigned short), 0, 0);
 		break;
 	}
 	default:
@@ -241,6 +245,162 @@ static void GL_DrawAliasFrame (
 	}
 }
 
+/*
+=============
+R_CompareAliasQueueEntries
+
+Groups surfaces that can share one instanced draw
+=============
+*/
+static int R_CompareAliasQueueEntries (const void *a, const void *b)
+{
+	const aliasqueueentry_t *entry_a = (const aliasqueueentry_t *)a;
+	const aliasqueueentry_t *entry_b = (const aliasqueueentry_t *)b;
+
+	// Models sharing an alias megabuffer next to each other keep the index buffer bound
+	if (entry_a->hdr->index_buffer != entry_b->hdr->index_buffer)
+		return ((uint64_t)entry_a->hdr->index_buffer < (uint64_t)entry_b->hdr->index_buffer) ? -1 : 1;
+	if (entry_a->hdr != entry_b->hdr)
+		return ((uintptr_t)entry_a->hdr < (uintptr_t)entry_b->hdr) ? -1 : 1;
+	if (entry_a->tx != entry_b->tx)
+		return ((uintptr_t)entry_a->tx < (uintptr_t)entry_b->tx) ? -1 : 1;
+	if (entry_a->fb != entry_b->fb)
+		return ((uintptr_t)entry_a->fb < (uintptr_t)entry_b->fb) ? -1 : 1;
+	if (entry_a->pose1 != entry_b->pose1)
+		return entry_a->pose1 - entry_b->pose1;
+	if (entry_a->pose2 != entry_b->pose2)
+		return entry_a->pose2 - entry_b->pose2;
+	return entry_a->alphatest - entry_b->alphatest;
+}
+
+/*
+=============
+R_FlushAliasInstances
+
+Sorts the queued surfaces by (model, skin, pose pair) and draws each group
+with a single instanced draw. Transform, lerp and lighting are per instance
+vertex attributes, see alias_instanced.vert.
+=============
+*/
+void R_FlushAliasInstances (cb_context_t *cbx, aliasqueue_t *queue)
+{
+	if (queue->num_entries == 0)
+		return;
+
+	qsort (queue->entries, queue->num_entries, sizeof (aliasqueueentry_t), R_CompareAliasQueueEntries);
+
+	VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+	int		 first = 0;
+	while (first < queue->num_entries)
+	{
+		const aliasqueueentry_t *entry = &queue->entries[first];
+		int						 count = 1;
+		while ((first + count < queue->num_entries) && (R_CompareAliasQueueEntries (entry, &queue->entries[first + count]) == 0))
+			++count;
+
+		aliashdr_t	*hdr = entry->hdr;
+		gltexture_t *tx = entry->tx;
+		gltexture_t *fb = entry->fb;
+
+		// entalpha is always 1 here, only the texture can make it blend
+		const int				pipeline_index = ((tx->flags & TEXPREF_ALPHAPIXELS) ? 2 : 0) + (entry->alphatest ? 1 : 0);
+		const vulkan_pipeline_t pipeline = vulkan_globals.alias_instanced_pipelines[pipeline_index];
+		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+		TexMgr_MarkUsed (tx);
+		TexMgr_MarkUsed (fb);
+
+		VkBuffer		uniform_buffer;
+		uint32_t		uniform_offset;
+		VkDescriptorSet ubo_set;
+		aliasubo_t	   *ubo = (aliasubo_t *)R_UniformAllocate (sizeof (aliasubo_t), &uniform_buffer, &uniform_offset, &ubo_set);
+		memset (ubo, 0, sizeof (aliasubo_t));
+		ubo->flags = (fb != NULL) ? 0x1 : 0x0;
+		if (r_fullbright_cheatsafe || (r_lightmap_cheatsafe && r_fullbright.value))
+			ubo->flags |= 0x2;
+		if (hdr->poseverttype == PV_QUAKE3)
+			ubo->flags |= 0x4;
+		ubo->entalpha = 1.0f;
+
+		// With r_gpualiascull the instances are unculled, alias_cull.comp writes the visible ones and the draw
+		VkBuffer	 instance_buffer;
+		VkDeviceSize instance_buffer_offset;
+		VkBuffer	 draw_buffer = VK_NULL_HANDLE;
+		VkDeviceSize draw_offset = 0;
+		int			 num_instances = count;
+		if (!alias_gpu_cull || !R_AliasCullAllocate (hdr, entry, count, &instance_buffer, &instance_buffer_offset, &draw_buffer, &draw_offset))
+		{
+			aliasinstance_t *instances = (aliasinstance_t *)R_VertexAllocate (count * sizeof (aliasinstance_t), &instance_buffer, &instance_buffer_offset);
+			num_instances = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				aliasqueueentry_t *other = &queue->entries[first + i];
+				if (!alias_gpu_cull || !R_CullBox (other->mins, other->maxs))
+					instances[num_instances++] = other->instance;
+			}
+		}
+		if (num_instances == 0)
+		{
+			first += count;
+			continue;
+		}
+
+		VkDescriptorSet descriptor_sets[3] = {tx->descriptor_set, (fb != NULL) ? fb->descriptor_set : tx->descriptor_set, ubo_set};
+		vulkan_globals.vk_cmd_bind_descriptor_sets (
+			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout.handle, 0, 3, descriptor_sets, 1, &uniform_offset);
+
+		VkBuffer	 vertex_buffers[4] = {hdr->vertex_buffer, hdr->vertex_buffer, hdr->vertex_buffer, instance_buffer};
+		VkDeviceSize vertex_offsets[4] = {
+			hdr->vertex_offset + hdr->vbostofs, GLARB_GetXYZOffset (NULL, hdr, entry->pose1), GLARB_GetXYZOffset (NULL, hdr, entry->pose2),
+			instance_buffer_offset};
+		vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 4, vertex_buffers, vertex_offsets);
+		if (hdr->index_buffer != bound_index_buffer)
+		{
+			vulkan_globals.vk_cmd_bind_index_buffer (cbx->cb, hdr->index_buffer, 0, VK_INDEX_TYPE_UINT16);
+			bound_index_buffer = hdr->index_buffer;
+		}
+
+		if (draw_buffer != VK_NULL_HANDLE)
+			vulkan_globals.vk_cmd_draw_indexed_indirect (cbx->cb, draw_buffer, draw_offset, 1, sizeof (VkDrawIndexedIndirectCommand));
+		else
+			vulkan_globals.vk_cmd_draw_indexed (cbx->cb, hdr->numindexes, num_instances, hdr->index_offset / sizeof (unsigned short), 0, 0);
+
+		first += count;
+	}
+
+	queue->num_entries = 0;
+}
+
+/*
+=============
+R_QueueAliasInstance
+=============
+*/
+static void R_QueueAliasInstance (
+	cb_context_t *cbx, aliasqueue_t *queue, aliashdr_t *hdr, lerpdata_t lerpdata, gltexture_t *tx, gltexture_t *fb, float model_matrix[16],
+	qboolean alphatest, vec3_t shadevector, vec3_t lightcolor, vec3_t mins, vec3_t maxs)
+{
+	if (queue->num_entries == MAX_QUEUED_ALIAS_INSTANCES)
+		R_FlushAliasInstances (cbx, queue);
+
+	aliasqueueentry_t *entry = &queue->entries[queue->num_entries++];
+	entry->hdr = hdr;
+	entry->tx = tx;
+	entry->fb = fb;
+	entry->pose1 = lerpdata.pose1;
+	entry->pose2 = lerpdata.pose2;
+	entry->alphatest = alphatest;
+
+	memcpy (entry->instance.model_matrix, model_matrix, 16 * sizeof (float));
+	memcpy (entry->instance.shade_vector, shadevector, 3 * sizeof (float));
+	// see GL_DrawAliasFrame
+	entry->instance.blend_factor = (lerpdata.pose1 != lerpdata.pose2) ? lerpdata.blend : 0.0f;
+	memcpy (entry->instance.light_color, lightcolor, 3 * sizeof (float));
+	entry->instance.padding = 0.0f;
+	VectorCopy (mins, entry->mins);
+	VectorCopy (maxs, entry->maxs);
+}
+
 /*
 =================
 R_UpdateEntityAnimState
@@ -463,19 +623,17 @@ static void R_SetupAliasLighting (entity_t *e, vec3_t *shadevector, vec3_t *ligh
 	// if the initial trace is completely black, try again from above
 	// this helps with models whose origin is slightly below ground level
 	// (e.g. some of the candles in the DOTM start map)
-	if (!R_LightPoint (e->origin, 0.f, &e->lightcache, lightcolor))
-		R_LightPoint (e->origin, e->model->maxs[2] * 0.5f, &e->lightcache, lightcolor);
+	if (!R_LightPoint (e->origin, 0.f, &e->lightcache[0], lightcolor))
+		R_LightPoint (e->origin, e->model->maxs[2] * 0.5f, &e->lightcache[1], lightcolor);
 
 	// add dlights
-	for (i = 0; i < MAX_DLIGHTS; i++)
+	for (uint64_t lights = R_DlightsAtPoint (e->origin); lights; lights &= lights - 1)
 	{
-		if (cl_dlights[i].die >= cl.time)
-		{
-			VectorSubtract (e->origin, cl_dlights[i].origin, dist);
-			add = cl_dlights[i].radius - VectorLength (dist);
-			if (add > 0)
-				VectorMA (*lightcolor, add, cl_dlights[i].color, *lightcolor);
-		}
+		i = FindFirstBitNonZero64 (lights);
+		VectorSubtract (e->origin, cl_dlights[i].origin, dist);
+		add = cl_dlights[i].radius - VectorLength (dist);
+		if (add > 0)
+			VectorMA (*lightcolor, add, cl_dlights[i].color, *lightcolor);
 	}
 
 	// minimum light value on gun (24)
@@ -526,7 +684,7 @@ static void R_SetupAliasLighting (entity_t *e, vec3_t *shadevector, vec3_t *ligh
 R_DrawAliasModel -- johnfitz -- almost completely rewritten
 =================
 */
-void R_DrawAliasModel (cb_context_t *cbx, entity_t *e, int *aliaspolys)
+void R_DrawAliasModel (cb_context_t *cbx, entity_t *e, int *aliaspolys, aliasqueue_t *queue)
 {
 	aliashdr_t	*paliashdr;
 	int			 anim, skinnum = e->skinnum;
@@ -544,9 +702,14 @@ void R_DrawAliasModel (cb_context_t *cbx, entity_t *e, int *aliaspolys)
 	R_GetEntityLerpedTransform (e, lerpdata.origin, lerpdata.angles);
 
 	//
-	// cull it
+	// cull it, with r_gpualiascull the frustum test of instanced surfaces is left to alias_cull.comp
 	//
-	if (R_CullModelForEntity (e))
+	vec3_t	 mins, maxs;
+	qboolean gpu_cull = alias_gpu_cull && queue && (e != &cl.viewent) && (r_lightmap_cheatsafe || (ENTALPHA_DECODE (e->alpha) == 1.0f));
+	R_EntityBounds (e, mins, maxs);
+	if (!gpu_cull && R_CullBox (mins, maxs))
+		return;
+	if (occlusion_cull && (e != &cl.viewent) && R_OccludedBox (mins, maxs, true))
 		return;
 
 	//
@@ -637,9 +800,12 @@ void R_DrawAliasModel (cb_context_t *cbx, entity_t *e, int *aliaspolys)
 		}
 
 		//
-		// draw it
+		// draw it, or queue it for an instanced draw if it's opaque MDL/MD3
 		//
-		GL_DrawAliasFrame (cbx, e, hdr, lerpdata, tx, fb, model_matrix, entalpha, alphatest, shadevector, lightcolor, false);
+		if (queue && (entalpha == 1.0f) && (hdr->poseverttype != PV_MD5))
+			R_QueueAliasInstance (cbx, queue, hdr, lerpdata, tx, fb, model_matrix, alphatest, shadevector, lightcolor, mins, maxs);
+		else if (!gpu_cull || !R_CullBox (mins, maxs))
+			GL_DrawAliasFrame (cbx, e, hdr, lerpdata, tx, fb, model_matrix, entalpha, alphatest, shadevector, lightcolor, false);
 
 		// update polycounts
 		*aliaspolys += hdr->numtris;
@@ -0,0 +1,242 @@
+/*
+ * r_aliascull.c -- frustum culling of instanced alias surfaces on the GPU
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+// With r_gpualiascull R_DrawAliasModel skips the frustum test of the entities it queues
+// for instanced drawing. R_FlushAliasInstances writes an indirect draw with no instances
+// for every group and one candidate per queued surface with its world space bounds.
+// alias_cull.comp runs in the lightmap update command buffer, which is submitted before
+// the render passes. It tests the candidates against the frustum of the view and appends
+// the visible ones to the instances of their draw. The draws and candidates are in host
+// visible memory and there is one slot per command buffer, written again once its fence
+// was waited on. Entities are still lit on the CPU before their visibility is known, so
+// this only pays off if draw submission costs more than lighting, hence off by default.
+
+cvar_t r_gpualiascull = {"r_gpualiascull", "0", CVAR_ARCHIVE};
+
+qboolean alias_gpu_cull;
+
+#define MAX_ALIAS_CULL_DRAWS	  4096
+#define MAX_ALIAS_CULL_CANDIDATES 16384
+
+typedef struct
+{
+	aliasinstance_t instance;
+	float			mins[3];
+	uint32_t		draw;
+	float			maxs[3];
+	uint32_t		first_instance;
+} aliascullcandidate_t;
+
+#define ALIAS_CULL_DRAWS_SIZE	   (MAX_ALIAS_CULL_DRAWS * sizeof (VkDrawIndexedIndirectCommand))
+#define ALIAS_CULL_CANDIDATES_SIZE (MAX_ALIAS_CULL_CANDIDATES * sizeof (aliascullcandidate_t))
+#define ALIAS_CULL_SLOT_SIZE	   (ALIAS_CULL_DRAWS_SIZE + ALIAS_CULL_CANDIDATES_SIZE)
+#define ALIAS_CULL_INSTANCES_SIZE  (MAX_ALIAS_CULL_CANDIDATES * sizeof (aliasinstance_t))
+
+static VkBuffer		   alias_cull_buffer;
+static vulkan_memory_t alias_cull_memory;
+static byte			  *alias_cull_mapped;
+static VkBuffer		   alias_cull_instance_buffer;
+static vulkan_memory_t alias_cull_instance_memory;
+static VkDescriptorSet alias_cull_desc_sets[DOUBLE_BUFFERED];
+
+static int			   alias_cull_slot;
+static atomic_uint64_t alias_cull_used; // draws << 32 | candidates of the current slot
+static uint32_t		   alias_cull_first_pending;
+
+/*
+===============
+R_InitAliasCull
+
+Creates the buffers on first use
+===============
+*/
+qboolean R_InitAliasCull (void)
+{
+	if (alias_cull_buffer != VK_NULL_HANDLE)
+		return true;
+	if (vulkan_globals.alias_cull_pipeline.handle == VK_NULL_HANDLE)
+		return false;
+
+	buffer_create_info_t buffer_create_info = {
+		.buffer = &alias_cull_buffer,
+		.size = DOUBLE_BUFFERED * ALIAS_CULL_SLOT_SIZE,
+		.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		.mapped = (void **)&alias_cull_mapped,
+		.name = "Alias cull draws",
+	};
+	R_CreateBuffers (
+		1, &buffer_create_info, &alias_cull_memory, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0,
+		&num_vulkan_misc_allocations, "Alias cull draws");
+
+	buffer_create_info_t instance_buffer_create_info = {
+		.buffer = &alias_cull_instance_buffer,
+		.size = DOUBLE_BUFFERED * ALIAS_CULL_INSTANCES_SIZE,
+		.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		.name = "Alias cull instances",
+	};
+	R_CreateBuffers (
+		1, &instance_buffer_create_info, &alias_cull_instance_memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_misc_allocations,
+		"Alias cull instances");
+
+	for (int i = 0; i < DOUBLE_BUFFERED; ++i)
+	{
+		alias_cull_desc_sets[i] = R_AllocateDescriptorSet (&vulkan_globals.alias_cull_set_layout);
+
+		ZEROED_STRUCT_ARRAY (VkDescriptorBufferInfo, buffer_infos, 3);
+		buffer_infos[0].buffer = alias_cull_buffer;
+		buffer_infos[0].offset = i * ALIAS_CULL_SLOT_SIZE;
+		buffer_infos[0].range = ALIAS_CULL_DRAWS_SIZE;
+		buffer_infos[1].buffer = alias_cull_buffer;
+		buffer_infos[1].offset = (i * ALIAS_CULL_SLOT_SIZE) + ALIAS_CULL_DRAWS_SIZE;
+		buffer_infos[1].range = ALIAS_CULL_CANDIDATES_SIZE;
+		buffer_infos[2].buffer = alias_cull_instance_buffer;
+		buffer_infos[2].offset = i * ALIAS_CULL_INSTANCES_SIZE;
+		buffer_infos[2].range = ALIAS_CULL_INSTANCES_SIZE;
+
+		ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, writes, 3);
+		for (int j = 0; j < 3; ++j)
+		{
+			writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[j].dstBinding = j;
+			writes[j].dstArrayElement = 0;
+			writes[j].descriptorCount = 1;
+			writes[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[j].dstSet = alias_cull_desc_sets[i];
+			writes[j].pBufferInfo = &buffer_infos[j];
+		}
+		vkUpdateDescriptorSets (vulkan_globals.device, countof (writes), writes, 0, NULL);
+	}
+
+	return true;
+}
+
+/*
+===============
+R_AliasCullBeginFrame
+
+Called once the fence of cb_index was waited on, the draws of that slot can be reused.
+===============
+*/
+void R_AliasCullBeginFrame (int cb_index)
+{
+	alias_cull_slot = cb_index;
+	Atomic_StoreUInt64 (&alias_cull_used, 0);
+	alias_cull_first_pending = 0;
+}
+
+/*
+===============
+R_AliasCullAllocate
+
+Writes an indirect draw for the count entries of hdr and their candidates. Returns false
+if the slot is full, in which case the caller has to draw them itself.
+===============
+*/
+qboolean R_AliasCullAllocate (
+	aliashdr_t *hdr, const aliasqueueentry_t *entries, int count, VkBuffer *instance_buffer, VkDeviceSize *instance_offset, VkBuffer *draw_buffer,
+	VkDeviceSize *draw_offset)
+{
+	uint64_t used = Atomic_LoadUInt64 (&alias_cull_used);
+	uint32_t draw, first_candidate;
+	do
+	{
+		draw = (uint32_t)(used >> 32);
+		first_candidate = (uint32_t)used;
+		if ((draw == MAX_ALIAS_CULL_DRAWS) || (first_candidate + count > MAX_ALIAS_CULL_CANDIDATES))
+			return false;
+	} while (!Atomic_CompareExchangeUInt64 (&alias_cull_used, &used, used + (1ull << 32) + count));
+
+	byte						 *slot = alias_cull_mapped + (alias_cull_slot * ALIAS_CULL_SLOT_SIZE);
+	VkDrawIndexedIndirectCommand *command = (VkDrawIndexedIndirectCommand *)slot + draw;
+	command->indexCount = hdr->numindexes;
+	command->instanceCount = 0;
+	command->firstIndex = hdr->index_offset / sizeof (unsigned short);
+	command->vertexOffset = 0;
+	command->firstInstance = 0;
+
+	aliascullcandidate_t *candidates = (aliascullcandidate_t *)(slot + ALIAS_CULL_DRAWS_SIZE) + first_candidate;
+	for (int i = 0; i < count; ++i)
+	{
+		candidates[i].instance = entries[i].instance;
+		VectorCopy (entries[i].mins, candidates[i].mins);
+		VectorCopy (entries[i].maxs, candidates[i].maxs);
+		candidates[i].draw = draw;
+		candidates[i].first_instance = first_candidate;
+	}
+
+	*instance_buffer = alias_cull_instance_buffer;
+	*instance_offset = (alias_cull_slot * ALIAS_CULL_INSTANCES_SIZE) + (first_candidate * sizeof (aliasinstance_t));
+	*draw_buffer = alias_cull_buffer;
+	*draw_offset = (alias_cull_slot * ALIAS_CULL_SLOT_SIZE) + (draw * sizeof (VkDrawIndexedIndirectCommand));
+	return true;
+}
+
+/*
+===============
+R_AliasCullDispatch
+
+Records alias_cull.comp for the candidates written since the last dispatch. Has to run
+after all entities of the view were drawn, since it uses the current frustum.
+===============
+*/
+void R_AliasCullDispatch (cb_context_t *cbx)
+{
+	if (alias_cull_buffer == VK_NULL_HANDLE)
+		return;
+
+	const uint32_t num_candidates = (uint32_t)Atomic_LoadUInt64 (&alias_cull_used);
+	if (num_candidates == alias_cull_first_pending)
+		return;
+
+	R_BeginDebugUtilsLabel (cbx, "Alias Cull");
+
+	uint32_t push_constants[20];
+	push_constants[0] = alias_cull_first_pending;
+	push_constants[1] = num_candidates - alias_cull_first_pending;
+	push_constants[2] = 0;
+	push_constants[3] = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		memcpy (&push_constants[4 + (i * 4)], frustum[i].normal, 3 * sizeof (float));
+		memcpy (&push_constants[7 + (i * 4)], &frustum[i].dist, sizeof (float));
+	}
+
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.alias_cull_pipeline);
+	vkCmdBindDescriptorSets (
+		cbx->cb, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.alias_cull_pipeline.layout.handle, 0, 1, &alias_cull_desc_sets[alias_cull_slot], 0,
+		NULL);
+	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (push_constants), push_constants);
+	vkCmdDispatch (cbx->cb, (push_constants[1] + 63) / 64, 1, 1);
+
+	VkMemoryBarrier memory_barrier;
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.pNext = NULL;
+	memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier (
+		cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memory_barrier,
+		0, NULL, 0, NULL);
+
+	alias_cull_first_pending = num_candidates;
+
+	R_EndDebugUtilsLabel (cbx);
+}
@@ -25,7 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
-extern cvar_t gl_fullbrights, r_drawflat, r_gpulightmapupdate, r_rtshadows;
+extern cvar_t gl_fullbrights, r_drawflat, r_gpulightmapupdate, r_rtshadows, r_rtshadows_rate;
 
 int gl_lightmap_format;
 
@@ -50,6 +50,7 @@ int				   rows[LM_BINS];
 unsigned blocklights[256 * 256 * 3 + 1]; // johnfitz -- was 18*18, added lit support (*3) and loosened surface extents maximum
 
 qboolean indirect = true;
+qboolean indirect_mark = true;
 qboolean indirect_ready = false;
 
 typedef struct
@@ -105,6 +106,16 @@ static VkBuffer			   bmodel_scratch_buffer;
 static VkDeviceAddress	   bmodel_scratch_address;
 static vulkan_memory_t	   bmodel_as_device_memory;
 
+// Instances of the last TLAS build, the TLAS is only rebuilt if these or any BLAS changed
+static VkAccelerationStructureInstanceKHR *last_tlas_instances;
+static int								  last_tlas_num_instances = -1;
+static uint32_t							  tlas_generation; // incremented on every rebuild
+
+// Shadowed dlight light per lightmap texel when r_rtshadows_rate spreads the shadow samples over several updates
+static VkBuffer		   rt_history_buffer;
+static vulkan_memory_t rt_history_memory;
+static qboolean		   rt_history_reset;
+
 extern cvar_t r_showtris;
 extern cvar_t r_simd;
 typedef struct lm_compute_surface_data_s
@@ -119,6 +130,17 @@ typedef struct lm_compute_surface_data_s
 } lm_compute_surface_data_t;
 COMPILE_TIME_ASSERT (lm_compute_surface_data_t, sizeof (lm_compute_surface_data_t) == 64);
 
+// Bounds of INDIRECT_CLUSTER_SIZE consecutive world surfaces, one indirect.comp workgroup
+#define INDIRECT_CLUSTER_SIZE 64
+typedef struct surface_cluster_s
+{
+	vec3_t center;
+	float  radius;
+	vec3_t cone_axis;
+	float  cone_cutoff; // sine of the widest angle between the axis and a surface normal, 2 if the cone can't cull
+} surface_cluster_t;
+COMPILE_TIME_ASSERT (surface_cluster_t, sizeof (surface_cluster_t) == 32);
+
 typedef struct lm_compute_light_s
 {
 	vec3_t origin;
@@ -136,12 +158,19 @@ static vulkan_memory_t	   workgroup_bounds_buffer_memory;
 static vulkan_memory_t	   indirect_buffer_memory;
 static vulkan_memory_t	   indirect_index_buffer_memory;
 static vulkan_memory_t	   dyn_visibility_buffer_memory;
+static vulkan_memory_t	   visibility_buffer_memory;
+static vulkan_memory_t	   leaf_marksurfaces_buffer_memory;
+static vulkan_memory_t	   surface_clusters_buffer_memory;
 static VkBuffer			   surface_data_buffer;
 static int				   num_surfaces;
 static VkBuffer			   indirect_buffer;
 static VkBuffer			   indirect_index_buffer;
 static VkBuffer			   dyn_visibility_buffer;
 static uint32_t			   dyn_visibility_offset; // for double-buffering
+static VkBuffer			   visibility_buffer;
+static uint32_t			   visibility_buffer_size; // also where the leaf bits start in each half of dyn_visibility_buffer
+static VkBuffer			   leaf_marksurfaces_buffer;
+static VkBuffer			   surface_clusters_buffer;
 static unsigned char	  *dyn_visibility_view;
 static VkBuffer			   lightstyles_scales_buffer;
 static VkBuffer			   lights_buffer;
@@ -150,6 +179,23 @@ static lm_compute_light_t *lights_buffer_mapped;
 
 static int current_compute_buffer_index;
 
+// Brush entities that were only moved or rotated stay in the indirect draws. Every vertex
+// knows its submodel, world_indirect.vert and indirect.comp transform it by the submodel's
+// 3x4 matrix of the frame. The transforms are written per command buffer slot, after its
+// fence was waited on.
+static vulkan_memory_t	vertex_submodels_buffer_memory;
+static vulkan_memory_t	bmodel_transforms_buffer_memory;
+static VkBuffer			vertex_submodels_buffer;
+static VkBuffer			bmodel_transforms_buffer;
+static vec4_t		   *bmodel_transforms_mapped;
+static uint32_t			bmodel_transforms_stride; // vec4s per slot, BMODEL_TRANSFORM_VEC4S per submodel
+static int				bmodel_transforms_count;  // worldmodel submodels, 0 is the world itself
+static int				bmodel_transforms_slot;
+static atomic_uint32_t *bmodel_transforms_claims; // frame << 1 | moved, see R_ClaimIndirectBrush
+static VkDescriptorSet	bmodel_transforms_desc_sets[DOUBLE_BUFFERED];
+
+#define BMODEL_TRANSFORM_VEC4S 3 // rows of the model matrix, a mat3x4 in the shaders
+
 /*
 ================
 SizeToBin
@@ -433,6 +479,82 @@ qboolean R_IndirectBrush (entity_t *e)
 						 (WATER_FIXED_ORDER && brush_deps_data[e->model->combined_deps].water_count != 0));
 }
 
+/*
+=================
+R_IndirectMovedBrush
+
+Brush entities that only differ from R_IndirectBrush by their origin and angles. Scaled
+ones are left out, indirect.comp takes the transposed rotation as the inverse. Sky and
+water surfaces are drawn by other pipelines, which don't know about the transforms.
+=================
+*/
+static qboolean R_IndirectMovedBrush (entity_t *e)
+{
+	return indirect && bmodel_transforms_mapped &&
+		   !(ENTSCALE_DECODE (e->netstate.scale) != 1.0f || ENTALPHA_DECODE (e->alpha) != 1.0f || e->frame != 0 || e->model->name[0] != '*' ||
+			 (e->model->used_specials & SURF_DRAWSKY) || brush_deps_data[e->model->combined_deps].water_count != 0);
+}
+
+/*
+=================
+R_BrushModelMatrix
+=================
+*/
+static void R_BrushModelMatrix (entity_t *e, float model_matrix[16])
+{
+	vec3_t e_angles;
+	VectorCopy (e->angles, e_angles);
+	e_angles[0] = -e_angles[0]; // stupid quake bug
+	IdentityMatrix (model_matrix);
+	R_RotateForEntity (model_matrix, e->origin, e_angles, e->netstate.scale);
+}
+
+/*
+=================
+R_IndirectBeginFrame
+=================
+*/
+void R_IndirectBeginFrame (int cb_index)
+{
+	bmodel_transforms_slot = cb_index;
+}
+
+/*
+=================
+R_ClaimIndirectBrush
+
+The surfaces of a submodel are only once in the indirect draws, so all entities marking
+them in a frame need the same transform. The first one sets it. Untransformed entities
+can share it, any other loses and is drawn by R_DrawBrushModel like a scaled one.
+=================
+*/
+static qboolean R_ClaimIndirectBrush (entity_t *e, qboolean moved)
+{
+	const int submodel = atoi (e->model->name + 1);
+	if (!bmodel_transforms_mapped)
+		return !moved;
+	if (submodel <= 0 || submodel >= bmodel_transforms_count)
+		return false;
+
+	atomic_uint32_t *claim = &bmodel_transforms_claims[submodel];
+	const uint32_t	 desired = ((uint32_t)r_framecount << 1) | (moved ? 1 : 0);
+	uint32_t		 expected = Atomic_LoadUInt32 (claim);
+	while ((expected >> 1) != (desired >> 1))
+	{
+		if (Atomic_CompareExchangeUInt32 (claim, &expected, desired))
+		{
+			vec4_t *rows = &bmodel_transforms_mapped[bmodel_transforms_slot * bmodel_transforms_stride + submodel * BMODEL_TRANSFORM_VEC4S];
+			float	model_matrix[16];
+			R_BrushModelMatrix (e, model_matrix);
+			for (int i = 0; i < BMODEL_TRANSFORM_VEC4S; ++i)
+				for (int j = 0; j < 4; ++j)
+					rows[i][j] = model_matrix[j * 4 + i];
+			return true;
+		}
+	}
+	return !moved && !(expected & 1);
+}
+
 /*
 =================
 R_DrawBrushModel
@@ -452,7 +574,8 @@ void R_DrawBrushModel (cb_context_t *cbx, entity_t *e, int chain, int *brushpoly
 
 	clmodel = e->model;
 
-	if (R_IndirectBrush (e))
+	const qboolean moved = !R_IndirectBrush (e);
+	if ((!moved || R_IndirectMovedBrush (e)) && R_ClaimIndirectBrush (e, moved))
 	{
 		// indirect mark
 		int				 start = clmodel->firstmodelsurface;
@@ -493,21 +616,16 @@ void R_DrawBrushModel (cb_context_t *cbx, entity_t *e, int chain, int *brushpoly
 	// instanced model
 	if (!r_gpulightmapupdate.value && clmodel->firstmodelsurface != 0)
 	{
-		for (k = 0; k < MAX_DLIGHTS; k++)
+		// R_MarkLights tests the untransformed nodes, so do the grid
+		for (uint64_t lights = R_DlightsInBox (clmodel->mins, clmodel->maxs); lights; lights &= lights - 1)
 		{
-			if ((cl_dlights[k].die < cl.time) || (!cl_dlights[k].radius))
-				continue;
-
+			k = FindFirstBitNonZero64 (lights);
 			R_MarkLights (&cl_dlights[k], k, clmodel->nodes + clmodel->hulls[0].firstclipnode);
 		}
 	}
 
-	vec3_t e_angles;
-	VectorCopy (e->angles, e_angles);
-	e_angles[0] = -e_angles[0]; // stupid quake bug
 	float model_matrix[16];
-	IdentityMatrix (model_matrix);
-	R_RotateForEntity (model_matrix, e->origin, e_angles, e->netstate.scale);
+	R_BrushModelMatrix (e, model_matrix);
 
 	float mvp[16];
 	memcpy (mvp, vulkan_globals.view_projection_matrix, 16 * sizeof (float));
@@ -640,10 +758,13 @@ void R_DrawIndirectBrushes (cb_context_t *cbx, qboolean draw_water, qboolean tra
 	if (!draw_sky)
 	{
 		vulkan_globals.vk_cmd_bind_descriptor_sets (
-			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 2, 1, &nulltexture->descriptor_set, 0, NULL);
+			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipeline_layout.handle, 3, 1,
+			&bmodel_transforms_desc_sets[bmodel_transforms_slot], 0, NULL);
+		vulkan_globals.vk_cmd_bind_descriptor_sets (
+			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipeline_layout.handle, 2, 1, &nulltexture->descriptor_set, 0, NULL);
 		if (r_lightmap_cheatsafe)
 			vulkan_globals.vk_cmd_bind_descriptor_sets (
-				cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &greytexture->descriptor_set, 0, NULL);
+				cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipeline_layout.handle, 0, 1, &greytexture->descriptor_set, 0, NULL);
 	}
 
 	gltexture_t *lastfullbright = NULL;
@@ -672,7 +793,7 @@ void R_DrawIndirectBrushes (cb_context_t *cbx, qboolean draw_water, qboolean tra
 		if (!draw_sky && !r_lightmap_cheatsafe && lasttexture != gl_texture)
 		{
 			vulkan_globals.vk_cmd_bind_descriptor_sets (
-				cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &gl_texture->descriptor_set, 0, NULL);
+				cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipeline_layout.handle, 0, 1, &gl_texture->descriptor_set, 0, NULL);
 			lasttexture = gl_texture;
 		}
 
@@ -715,7 +836,7 @@ void R_DrawIndirectBrushes (cb_context_t *cbx, qboolean draw_water, qboolean tra
 			if (lastfullbright != fullbright)
 			{
 				vulkan_globals.vk_cmd_bind_descriptor_sets (
-					cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 2, 1, &fullbright->descriptor_set, 0, NULL);
+					cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipeline_layout.handle, 2, 1, &fullbright->descriptor_set, 0, NULL);
 				lastfullbright = fullbright;
 			}
 		}
@@ -726,7 +847,7 @@ void R_DrawIndirectBrushes (cb_context_t *cbx, qboolean draw_water, qboolean tra
 			const qboolean alpha_blend = alpha < 1.0f;
 			int			   pipeline_index =
 				(fullbright_enabled ? 1 : 0) + (alpha_test ? 2 : 0) + (alpha_blend ? 4 : 0) + (vid_filter.value != 0 && vid_palettize.value != 0 ? 8 : 0);
-			R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipelines[pipeline_index]);
+			R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipelines[pipeline_index]);
 
 			qboolean use_zbias = INDIRECT_ZBIAS && gl_zfix.value && indirect_draws[i].is_bmodel;
 			float	 constant_factor = 0.0f, slope_factor = 0.0f;
@@ -754,7 +875,7 @@ void R_DrawIndirectBrushes (cb_context_t *cbx, qboolean draw_water, qboolean tra
 			if (lastlightmap != lightmap_texture)
 			{
 				vulkan_globals.vk_cmd_bind_descriptor_sets (
-					cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 1, 1, &lightmap_texture->descriptor_set, 0, NULL);
+					cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_indirect_pipeline_layout.handle, 1, 1, &lightmap_texture->descriptor_set, 0, NULL);
 				lastlightmap = lightmap_texture;
 			}
 		}
@@ -850,6 +971,44 @@ void R_RenderDynamicLightmaps (msurface_t *fa)
 	}
 }
 
+/*
+========================
+GL_AddLightmap
+========================
+*/
+static void GL_AddLightmap (void)
+{
+	int i, j, k, l;
+	int texnum = lightmap_count++;
+
+	lightmaps = (struct lightmap_s *)Mem_Realloc (lightmaps, sizeof (*lightmaps) * lightmap_count);
+	memset (&lightmaps[texnum], 0, sizeof (lightmaps[texnum]));
+	lightmaps[texnum].data = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+	for (i = 0; i < MAXLIGHTMAPS * 3 / 4; ++i)
+		lightmaps[texnum].lightstyle_data[i] = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+	lightmaps[texnum].surface_indices = (uint32_t *)Mem_Alloc (sizeof (uint32_t) * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+	memset (lightmaps[texnum].surface_indices, 0xFF, 4 * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+	lightmaps[texnum].workgroup_bounds = (lm_compute_workgroup_bounds_t *)Mem_Alloc (WORKGROUP_BOUNDS_BUFFER_SIZE);
+	for (i = 0; i < (LMBLOCK_WIDTH / 8) * (LMBLOCK_HEIGHT / 8); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			lightmaps[texnum].workgroup_bounds[i].mins[j] = FLT_MAX;
+			lightmaps[texnum].workgroup_bounds[i].maxs[j] = -FLT_MAX;
+		}
+	}
+	for (l = 0; l < LMBLOCK_HEIGHT / LM_CULL_BLOCK_H; l++)
+		for (k = 0; k < LMBLOCK_WIDTH / LM_CULL_BLOCK_W; k++)
+			for (j = 0; j < 3; ++j)
+			{
+				lightmaps[texnum].global_bounds[l][k].mins[j] = FLT_MAX;
+				lightmaps[texnum].global_bounds[l][k].maxs[j] = -FLT_MAX;
+			}
+	memset (lightmaps[texnum].cached_light, -1, sizeof (lightmaps[texnum].cached_light));
+	memset (used_columns[texnum], 0, sizeof (used_columns[texnum]));
+	last_lightmap_allocated = texnum;
+}
+
 /*
 ========================
 AllocBlock -- returns a texture number and the position inside it
@@ -857,41 +1016,13 @@ AllocBlock -- returns a texture number and the position inside it
 */
 static int AllocBlock (int w, int h, int *x, int *y)
 {
-	int i, j, k, l;
+	int i;
 	int texnum;
 
 	for (texnum = last_lightmap_allocated; texnum < MAX_SANITY_LIGHTMAPS; texnum++)
 	{
 		if (texnum == lightmap_count)
-		{
-			lightmap_count++;
-			lightmaps = (struct lightmap_s *)Mem_Realloc (lightmaps, sizeof (*lightmaps) * lightmap_count);
-			memset (&lightmaps[texnum], 0, sizeof (lightmaps[texnum]));
-			lightmaps[texnum].data = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			for (i = 0; i < MAXLIGHTMAPS * 3 / 4; ++i)
-				lightmaps[texnum].lightstyle_data[i] = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			lightmaps[texnum].surface_indices = (uint32_t *)Mem_Alloc (sizeof (uint32_t) * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			memset (lightmaps[texnum].surface_indices, 0xFF, 4 * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			lightmaps[texnum].workgroup_bounds = (lm_compute_workgroup_bounds_t *)Mem_Alloc (WORKGROUP_BOUNDS_BUFFER_SIZE);
-			for (i = 0; i < (LMBLOCK_WIDTH / 8) * (LMBLOCK_HEIGHT / 8); ++i)
-			{
-				for (j = 0; j < 3; ++j)
-				{
-					lightmaps[texnum].workgroup_bounds[i].mins[j] = FLT_MAX;
-					lightmaps[texnum].workgroup_bounds[i].maxs[j] = -FLT_MAX;
-				}
-			}
-			for (l = 0; l < LMBLOCK_HEIGHT / LM_CULL_BLOCK_H; l++)
-				for (k = 0; k < LMBLOCK_WIDTH / LM_CULL_BLOCK_W; k++)
-					for (j = 0; j < 3; ++j)
-					{
-						lightmaps[texnum].global_bounds[l][k].mins[j] = FLT_MAX;
-						lightmaps[texnum].global_bounds[l][k].maxs[j] = -FLT_MAX;
-					}
-			memset (lightmaps[texnum].cached_light, -1, sizeof (lightmaps[texnum].cached_light));
-			memset (used_columns[texnum], 0, sizeof (used_columns[texnum]));
-			last_lightmap_allocated = texnum;
-		}
+			GL_AddLightmap ();
 
 		i = SizeToBin (w);
 		if (columns[i] < 0 || rows[i] + h - shelf_idx[i] * SHELF_HEIGHT > SHELF_HEIGHT) // need another shelf
@@ -970,8 +1101,8 @@ static void R_FillLightstyleTextures (msurface_t *surf, byte **lightstyles, int
 		{
 			for (int s = 0; s < smax; s += CLAMP (1, smax - s - 1, 8))
 				for (int t = 0; t < tmax; t += CLAMP (1, tmax - t - 1, 8))
-					lightmaps[surf->lightmaptexturenum]
-						.used_lightstyles[(surf->light_t + t) / LM_CULL_BLOCK_H][(surf->light_s + s) / LM_CULL_BLOCK_W][surf->styles[maps]] = true;
+					lightmaps[surf->lightmaptexturenum].lightstyle_blocks[surf->styles[maps]] |=
+						LM_CULL_BLOCK_BIT ((surf->light_s + s) / LM_CULL_BLOCK_W, (surf->light_t + t) / LM_CULL_BLOCK_H);
 			if (maps % 4 != 3)
 			{
 				byte *outptr = lightstyles[maps / 4 * 3 + maps % 4];
@@ -991,6 +1122,7 @@ static void R_FillLightstyleTextures (msurface_t *surf, byte **lightstyles, int
 			}
 			else
 			{
+				lightmaps[surf->lightmaptexturenum].fourth_style = true;
 				for (int height = 0; height < tmax; ++height)
 					for (int i = 0; i < smax; i++)
 					{
@@ -1399,19 +1531,28 @@ static void R_InitIndirectIndexBuffer (uint32_t size)
 
 /*
 ===============
-R_InitVisibilityBuffers (one bit per surface)
+R_InitVisibilityBuffers (one bit per surface and per leaf)
+
+Each half of the dynamic buffer holds the surfaces marked on the CPU followed by the
+frustum culled leafs. The surface bits are copied to the device local buffer, which
+indirect_mark.comp adds the surfaces of the leafs to and indirect.comp reads.
 ===============
 */
-static void R_InitVisibilityBuffers (uint32_t size)
+static void R_InitVisibilityBuffers (uint32_t surf_size, uint32_t leaf_size)
 {
 	R_FreeBuffer (dyn_visibility_buffer, &dyn_visibility_buffer_memory, &num_vulkan_bmodel_allocations);
+	R_FreeBuffer (visibility_buffer, &visibility_buffer_memory, &num_vulkan_bmodel_allocations);
 
-	size = (size + 255) / 256 * 256 * 2;
+	visibility_buffer_size = (surf_size + 255) / 256 * 256;
+	uint32_t size = (visibility_buffer_size + leaf_size + 255) / 256 * 256 * 2;
 
-	Sys_Printf ("Allocating visibility buffers (%u KB)\n", size / 1024);
+	Sys_Printf ("Allocating visibility buffers (%u KB)\n", (size + visibility_buffer_size) / 1024);
+	R_CreateBuffer (
+		&dyn_visibility_buffer, &dyn_visibility_buffer_memory, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &num_vulkan_bmodel_allocations, NULL, "Dynamic visibility");
 	R_CreateBuffer (
-		&dyn_visibility_buffer, &dyn_visibility_buffer_memory, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-		VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &num_vulkan_bmodel_allocations, NULL, "Dynamic visibility");
+		&visibility_buffer, &visibility_buffer_memory, visibility_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_bmodel_allocations, NULL, "Visibility");
 
 	void	*data;
 	VkResult err = vkMapMemory (vulkan_globals.device, dyn_visibility_buffer_memory.handle, 0, size, 0, &data);
@@ -1427,12 +1568,15 @@ static void R_InitVisibilityBuffers (uint32_t size)
 R_UploadVisibility
 ===============
 */
-static void R_UploadVisibility (byte *data, uint32_t size)
+static void R_UploadVisibility (void)
 {
 	// TODO: do we really need a read barrier for surfvis uploading ?
 	Atomic_ReadBarrier ();
 
-	memcpy (dyn_visibility_view + current_compute_buffer_index * dyn_visibility_offset, data, size);
+	unsigned char *dest = dyn_visibility_view + current_compute_buffer_index * dyn_visibility_offset;
+	memcpy (dest, cl.worldmodel->surfvis, (cl.worldmodel->numsurfaces + 31) / 8);
+	if (indirect_mark)
+		memcpy (dest + visibility_buffer_size, cl.worldmodel->leafvis, (cl.worldmodel->numleafs + 31) / 8);
 	ZEROED_STRUCT (VkMappedMemoryRange, range);
 	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 	range.memory = dyn_visibility_buffer_memory.handle;
@@ -1548,6 +1692,283 @@ static void GL_SortSurfaces (void)
 	TEMP_FREE (surfs);
 }
 
+/*
+==============================================================================
+
+WORLD CACHE
+
+r_worldcache 1 stores the lightmap packing of GL_SortSurfaces and the vertices of
+BuildSurfaceDisplayList in <gamedir>/worldcache/<map>.wcache. Loads of the same brush
+models skip the sort and the packing and upload the cached vertices as they are. The
+lightmap texels are still built from the BSP since .lit files and dynamic lights feed
+into them.
+
+==============================================================================
+*/
+
+cvar_t r_worldcache = {"r_worldcache", "0", CVAR_ARCHIVE};
+
+#define WORLD_CACHE_MAGIC	("VKWC")
+#define WORLD_CACHE_VERSION 1
+
+typedef struct
+{
+	char	 magic[4];
+	uint32_t version;
+	uint32_t engine_version;
+	uint32_t lmblock_width;
+	uint32_t lmblock_height;
+	uint32_t vertex_size;
+	uint32_t num_models;
+	uint32_t num_surfaces;
+	uint32_t num_verts;
+	uint32_t num_lightmaps;
+} world_cache_header_t;
+
+typedef struct
+{
+	uint32_t bsp_checksum;
+	uint32_t textures_checksum; // sizes of the textures, they scale the texture coordinates
+	uint32_t num_surfaces;
+} world_cache_model_t;
+
+typedef struct
+{
+	int32_t lightmaptexturenum;
+	int32_t light_s;
+	int32_t light_t;
+} world_cache_surface_t;
+
+// vertices of the last loaded cache, consumed by GL_BuildBModelVertexBuffer
+static float   *world_cache_verts;
+static uint32_t world_cache_numverts;
+
+/*
+==================
+GL_WorldCacheModels
+
+Fills the cache header and the model records of the loaded brush models. Returns false
+if they can't be cached.
+==================
+*/
+static qboolean GL_WorldCacheModels (world_cache_header_t *header, world_cache_model_t *models)
+{
+	memset (header, 0, sizeof (*header));
+	memcpy (header->magic, WORLD_CACHE_MAGIC, sizeof (header->magic));
+	header->version = WORLD_CACHE_VERSION;
+	header->engine_version = (VKQUAKE_VERSION_MAJOR << 16) | (VKQUAKE_VERSION_MINOR << 8) | VKQUAKE_VER_PATCH;
+	header->lmblock_width = LMBLOCK_WIDTH;
+	header->lmblock_height = LMBLOCK_HEIGHT;
+	header->vertex_size = VERTEXSIZE;
+
+	for (int j = 1; j < MAX_MODELS; j++)
+	{
+		qmodel_t *m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*' || m->type != mod_brush)
+			continue;
+		if (m->bsp_checksum == 0)
+			return false;
+
+		world_cache_model_t *model = &models[header->num_models++];
+		model->bsp_checksum = m->bsp_checksum;
+		model->num_surfaces = m->numsurfaces;
+
+		TEMP_ALLOC_ZEROED (uint32_t, texture_sizes, q_max (m->numtextures, 1) * 3);
+		for (int i = 0; i < m->numtextures; ++i)
+		{
+			if (!m->textures[i])
+				continue;
+			texture_sizes[i * 3 + 0] = m->textures[i]->width;
+			texture_sizes[i * 3 + 1] = m->textures[i]->height;
+			texture_sizes[i * 3 + 2] = m->textures[i]->shift;
+		}
+		model->textures_checksum = Com_BlockChecksum (texture_sizes, q_max (m->numtextures, 1) * 3 * sizeof (uint32_t));
+		TEMP_FREE (texture_sizes);
+
+		header->num_surfaces += m->numsurfaces;
+		for (int i = 0; i < m->numsurfaces; i++)
+			header->num_verts += m->surfaces[i].numedges;
+	}
+	return true;
+}
+
+/*
+==================
+GL_WorldCachePath
+==================
+*/
+static void GL_WorldCachePath (char *path, size_t size)
+{
+	char mapname[MAX_QPATH];
+	COM_FileBase (cl.worldmodel->name, mapname, sizeof (mapname));
+	q_snprintf (path, size, "%s/worldcache/%s.wcache", com_gamedir, mapname);
+}
+
+/*
+==================
+GL_LoadWorldCache
+
+Restores the lightmap packing of all surfaces and keeps the cached vertices in
+world_cache_verts. Returns false if there is no matching cache.
+==================
+*/
+static qboolean GL_LoadWorldCache (void)
+{
+	if (!r_worldcache.value)
+		return false;
+
+	world_cache_header_t header, file_header;
+	TEMP_ALLOC (world_cache_model_t, models, MAX_MODELS);
+	TEMP_ALLOC (world_cache_model_t, file_models, MAX_MODELS);
+	qboolean valid = GL_WorldCacheModels (&header, models);
+
+	char path[MAX_OSPATH];
+	GL_WorldCachePath (path, sizeof (path));
+	FILE *f = valid ? fopen (path, "rb") : NULL;
+	valid = f && (fread (&file_header, sizeof (file_header), 1, f) == 1);
+	valid = valid && (file_header.num_lightmaps > 0) && (file_header.num_lightmaps <= MAX_SANITY_LIGHTMAPS);
+	valid = valid && (memcmp (&file_header, &header, offsetof (world_cache_header_t, num_lightmaps)) == 0);
+	valid = valid && (fread (file_models, sizeof (world_cache_model_t), header.num_models, f) == header.num_models);
+	valid = valid && (memcmp (file_models, models, header.num_models * sizeof (world_cache_model_t)) == 0);
+	TEMP_FREE (file_models);
+	TEMP_FREE (models);
+	if (!valid)
+	{
+		if (f)
+			fclose (f);
+		return false;
+	}
+
+	TEMP_ALLOC (glMaxUsed_t, rectused, file_header.num_lightmaps * countof (lightmaps[0].lightstyle_rectused));
+	TEMP_ALLOC (world_cache_surface_t, surfaces, q_max (header.num_surfaces, 1));
+	float *verts = Mem_AllocNonZero (q_max (header.num_verts, 1) * VERTEXSIZE * sizeof (float));
+	valid = fread (rectused, sizeof (glMaxUsed_t) * countof (lightmaps[0].lightstyle_rectused), file_header.num_lightmaps, f) == file_header.num_lightmaps;
+	valid = valid && (fread (surfaces, sizeof (world_cache_surface_t), header.num_surfaces, f) == header.num_surfaces);
+	valid = valid && (fread (verts, VERTEXSIZE * sizeof (float), header.num_verts, f) == header.num_verts);
+	fclose (f);
+
+	for (uint32_t i = 0; valid && i < header.num_surfaces; ++i)
+		valid = (surfaces[i].lightmaptexturenum >= 0) && ((uint32_t)surfaces[i].lightmaptexturenum < file_header.num_lightmaps);
+
+	if (valid)
+	{
+		for (uint32_t i = 0; i < file_header.num_lightmaps; ++i)
+		{
+			GL_AddLightmap ();
+			memcpy (
+				lightmaps[i].lightstyle_rectused, rectused + i * countof (lightmaps[0].lightstyle_rectused), sizeof (lightmaps[0].lightstyle_rectused));
+		}
+
+		int surface_index = 0;
+		for (int j = 1; j < MAX_MODELS; j++)
+		{
+			qmodel_t *m = cl.model_precache[j];
+			if (!m)
+				break;
+			if (m->name[0] == '*' || m->type != mod_brush)
+				continue;
+			for (int i = 0; i < m->numsurfaces; ++i, ++surface_index)
+			{
+				msurface_t *surf = &m->surfaces[i];
+				if (surf->flags & SURF_DRAWTILED)
+					continue;
+				surf->lightmaptexturenum = surfaces[surface_index].lightmaptexturenum;
+				surf->light_s = surfaces[surface_index].light_s;
+				surf->light_t = surfaces[surface_index].light_t;
+			}
+		}
+		world_cache_verts = verts;
+		world_cache_numverts = header.num_verts;
+		Con_DPrintf ("Loaded world cache %s\n", path);
+	}
+	else
+	{
+		Mem_Free (verts);
+		Con_DPrintf ("Ignoring broken world cache %s\n", path);
+	}
+
+	TEMP_FREE (surfaces);
+	TEMP_FREE (rectused);
+	return valid;
+}
+
+/*
+==================
+GL_SaveWorldCache
+==================
+*/
+static void GL_SaveWorldCache (const float *verts)
+{
+	if (!r_worldcache.value)
+		return;
+
+	world_cache_header_t header;
+	TEMP_ALLOC (world_cache_model_t, models, MAX_MODELS);
+	if (!GL_WorldCacheModels (&header, models) || header.num_verts != bmodel_numverts)
+	{
+		TEMP_FREE (models);
+		return;
+	}
+	header.num_lightmaps = lightmap_count;
+
+	char path[MAX_OSPATH];
+	GL_WorldCachePath (path, sizeof (path));
+	COM_CreatePath (path);
+	FILE *f = fopen (path, "wb");
+	if (!f)
+	{
+		Con_DPrintf ("Couldn't write world cache %s\n", path);
+		TEMP_FREE (models);
+		return;
+	}
+
+	fwrite (&header, sizeof (header), 1, f);
+	fwrite (models, sizeof (world_cache_model_t), header.num_models, f);
+	for (int i = 0; i < lightmap_count; ++i)
+		fwrite (lightmaps[i].lightstyle_rectused, sizeof (lightmaps[i].lightstyle_rectused), 1, f);
+	for (int j = 1; j < MAX_MODELS; j++)
+	{
+		qmodel_t *m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*' || m->type != mod_brush)
+			continue;
+		for (int i = 0; i < m->numsurfaces; ++i)
+		{
+			const msurface_t	 *surf = &m->surfaces[i];
+			world_cache_surface_t surface = {0, 0, 0};
+			if (!(surf->flags & SURF_DRAWTILED))
+			{
+				surface.lightmaptexturenum = surf->lightmaptexturenum;
+				surface.light_s = surf->light_s;
+				surface.light_t = surf->light_t;
+			}
+			fwrite (&surface, sizeof (surface), 1, f);
+		}
+	}
+	fwrite (verts, VERTEXSIZE * sizeof (float), header.num_verts, f);
+	if (fclose (f) != 0)
+		Con_DPrintf ("Couldn't write world cache %s\n", path);
+
+	TEMP_FREE (models);
+}
+
+/*
+================
+GL_CachedSurfaceDisplayList -- BuildSurfaceDisplayList with the vertices from the world cache
+================
+*/
+static void GL_CachedSurfaceDisplayList (msurface_t *fa, const float *verts)
+{
+	glpoly_t *poly = (glpoly_t *)Mem_Alloc (sizeof (glpoly_t) + (fa->numedges - 4) * VERTEXSIZE * sizeof (float));
+	poly->next = fa->polys;
+	fa->polys = poly;
+	poly->numverts = fa->numedges;
+	memcpy (poly->verts, verts, fa->numedges * VERTEXSIZE * sizeof (float));
+}
+
 /*
 ==================
 GL_BuildLightmaps -- called at level load time
@@ -1603,7 +2024,9 @@ void GL_BuildLightmaps (void)
 		num_surfaces += m->numsurfaces; // note: allocates unused space for SURF_DRAWTILED surfs
 	}
 
-	GL_SortSurfaces ();
+	SAFE_FREE (world_cache_verts);
+	if (!GL_LoadWorldCache ())
+		GL_SortSurfaces ();
 
 	surface_data = GL_AllocateSurfaceDataBuffer ();
 
@@ -1625,7 +2048,10 @@ void GL_BuildLightmaps (void)
 			{
 				const qboolean no_dlights = j > 1;
 				GL_CreateSurfaceLightmap (surf, surface_index | 0x80000000 * no_dlights);
-				BuildSurfaceDisplayList (surf);
+				if (world_cache_verts)
+					GL_CachedSurfaceDisplayList (surf, world_cache_verts + (size_t)varray_index * VERTEXSIZE);
+				else
+					BuildSurfaceDisplayList (surf);
 				if (!no_dlights)
 					R_AssignWorkgroupBounds (surf);
 			}
@@ -1658,6 +2084,55 @@ void GL_BuildLightmaps (void)
 	R_StagingEndCopy ();
 }
 
+/*
+==================
+GL_SetupLeafMarkSurfaces
+
+Uploads the table indirect_mark.comp expands the visible leafs with: a (first, count)
+pair per leaf pointing into the marksurfaces that follow. Also collects the SURF_DRAWTURB
+marksurfaces of each leaf, the CPU keeps marking those for the water texture chains.
+==================
+*/
+static void GL_SetupLeafMarkSurfaces (void)
+{
+	qmodel_t	*world = cl.worldmodel;
+	const size_t buffer_size = (2 * world->numleafs + world->nummarksurfaces) * sizeof (uint32_t);
+
+	R_FreeBuffer (leaf_marksurfaces_buffer, &leaf_marksurfaces_buffer_memory, &num_vulkan_bmodel_allocations);
+
+	Sys_Printf ("Allocating leaf marksurfaces (%u KB)\n", (int)buffer_size / 1024);
+	R_CreateBuffer (
+		&leaf_marksurfaces_buffer, &leaf_marksurfaces_buffer_memory, buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_bmodel_allocations, NULL, "Leaf marksurfaces");
+
+	int num_leaf_marksurfaces = 0;
+	for (int i = 0; i < world->numleafs; ++i)
+		num_leaf_marksurfaces += world->leafs[i + 1].nummarksurfaces; // leafs may share marksurfaces
+
+	SAFE_FREE (world->turbmarksurfaces);
+	world->turbmarksurfaces = Mem_Alloc (q_max (num_leaf_marksurfaces, 1) * sizeof (int));
+
+	uint32_t *leaf_data = Mem_Alloc (buffer_size);
+	int		 *turbmarksurfaces = world->turbmarksurfaces;
+	for (int i = 0; i < world->numleafs; ++i)
+	{
+		mleaf_t *leaf = &world->leafs[i + 1]; // worldmodel->leafs is 1-based
+		leaf_data[i * 2] = 2 * world->numleafs + (leaf->firstmarksurface - world->marksurfaces);
+		leaf_data[i * 2 + 1] = leaf->nummarksurfaces;
+
+		leaf->firstturbmarksurface = turbmarksurfaces;
+		leaf->numturbmarksurfaces = 0;
+		for (int j = 0; j < leaf->nummarksurfaces; ++j)
+			if (world->surfaces[leaf->firstmarksurface[j]].flags & SURF_DRAWTURB)
+				leaf->firstturbmarksurface[leaf->numturbmarksurfaces++] = leaf->firstmarksurface[j];
+		turbmarksurfaces += leaf->numturbmarksurfaces;
+	}
+	memcpy (leaf_data + 2 * world->numleafs, world->marksurfaces, world->nummarksurfaces * sizeof (int));
+
+	R_StagingUploadBuffer (leaf_marksurfaces_buffer, buffer_size, (byte *)leaf_data);
+	Mem_Free (leaf_data);
+}
+
 /*
 ==================
 GL_SetupIndirectDraws
@@ -1679,7 +2154,8 @@ void GL_SetupIndirectDraws ()
 	R_StagingEndCopy ();
 
 	R_InitIndirectIndexBuffer ((initial_indirect_buffer[used_indirect_draws - 1].firstIndex + indirect_draws[used_indirect_draws - 1].max_indices) * 4);
-	R_InitVisibilityBuffers ((cl.worldmodel->numsurfaces + 31) / 8);
+	R_InitVisibilityBuffers ((cl.worldmodel->numsurfaces + 31) / 8, (cl.worldmodel->numleafs + 31) / 8);
+	GL_SetupLeafMarkSurfaces ();
 
 	if (vulkan_globals.indirect_compute_desc_set != VK_NULL_HANDLE)
 		R_FreeDescriptorSet (vulkan_globals.indirect_compute_desc_set, &vulkan_globals.indirect_compute_set_layout);
@@ -1696,7 +2172,7 @@ void GL_SetupIndirectDraws ()
 	surfaces_buffer_info.range = num_surfaces * sizeof (lm_compute_surface_data_t);
 
 	ZEROED_STRUCT (VkDescriptorBufferInfo, visibility_buffer_info);
-	visibility_buffer_info.buffer = dyn_visibility_buffer;
+	visibility_buffer_info.buffer = visibility_buffer;
 	visibility_buffer_info.offset = 0;
 	visibility_buffer_info.range = VK_WHOLE_SIZE;
 
@@ -1705,7 +2181,32 @@ void GL_SetupIndirectDraws ()
 	index_buffer_info.offset = 0;
 	index_buffer_info.range = VK_WHOLE_SIZE;
 
-	ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, indirect_d, 4);
+	ZEROED_STRUCT (VkDescriptorBufferInfo, leaf_visibility_buffer_info);
+	leaf_visibility_buffer_info.buffer = dyn_visibility_buffer;
+	leaf_visibility_buffer_info.offset = 0;
+	leaf_visibility_buffer_info.range = VK_WHOLE_SIZE;
+
+	ZEROED_STRUCT (VkDescriptorBufferInfo, leaf_marksurfaces_buffer_info);
+	leaf_marksurfaces_buffer_info.buffer = leaf_marksurfaces_buffer;
+	leaf_marksurfaces_buffer_info.offset = 0;
+	leaf_marksurfaces_buffer_info.range = VK_WHOLE_SIZE;
+
+	ZEROED_STRUCT (VkDescriptorBufferInfo, surface_clusters_buffer_info);
+	surface_clusters_buffer_info.buffer = surface_clusters_buffer;
+	surface_clusters_buffer_info.offset = 0;
+	surface_clusters_buffer_info.range = VK_WHOLE_SIZE;
+
+	ZEROED_STRUCT (VkDescriptorBufferInfo, vertex_submodels_buffer_info);
+	vertex_submodels_buffer_info.buffer = vertex_submodels_buffer;
+	vertex_submodels_buffer_info.offset = 0;
+	vertex_submodels_buffer_info.range = VK_WHOLE_SIZE;
+
+	ZEROED_STRUCT (VkDescriptorBufferInfo, bmodel_transforms_buffer_info);
+	bmodel_transforms_buffer_info.buffer = bmodel_transforms_buffer;
+	bmodel_transforms_buffer_info.offset = 0;
+	bmodel_transforms_buffer_info.range = VK_WHOLE_SIZE;
+
+	ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, indirect_d, 9);
 
 	indirect_d[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	indirect_d[0].dstBinding = 0;
@@ -1739,6 +2240,46 @@ void GL_SetupIndirectDraws ()
 	indirect_d[3].dstSet = vulkan_globals.indirect_compute_desc_set;
 	indirect_d[3].pBufferInfo = &index_buffer_info;
 
+	indirect_d[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	indirect_d[4].dstBinding = 4;
+	indirect_d[4].dstArrayElement = 0;
+	indirect_d[4].descriptorCount = 1;
+	indirect_d[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	indirect_d[4].dstSet = vulkan_globals.indirect_compute_desc_set;
+	indirect_d[4].pBufferInfo = &leaf_visibility_buffer_info;
+
+	indirect_d[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	indirect_d[5].dstBinding = 5;
+	indirect_d[5].dstArrayElement = 0;
+	indirect_d[5].descriptorCount = 1;
+	indirect_d[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	indirect_d[5].dstSet = vulkan_globals.indirect_compute_desc_set;
+	indirect_d[5].pBufferInfo = &leaf_marksurfaces_buffer_info;
+
+	indirect_d[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	indirect_d[6].dstBinding = 6;
+	indirect_d[6].dstArrayElement = 0;
+	indirect_d[6].descriptorCount = 1;
+	indirect_d[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	indirect_d[6].dstSet = vulkan_globals.indirect_compute_desc_set;
+	indirect_d[6].pBufferInfo = &surface_clusters_buffer_info;
+
+	indirect_d[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	indirect_d[7].dstBinding = 7;
+	indirect_d[7].dstArrayElement = 0;
+	indirect_d[7].descriptorCount = 1;
+	indirect_d[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	indirect_d[7].dstSet = vulkan_globals.indirect_compute_desc_set;
+	indirect_d[7].pBufferInfo = &vertex_submodels_buffer_info;
+
+	indirect_d[8].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	indirect_d[8].dstBinding = 8;
+	indirect_d[8].dstArrayElement = 0;
+	indirect_d[8].descriptorCount = 1;
+	indirect_d[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	indirect_d[8].dstSet = vulkan_globals.indirect_compute_desc_set;
+	indirect_d[8].pBufferInfo = &bmodel_transforms_buffer_info;
+
 	vkUpdateDescriptorSets (vulkan_globals.device, countof (indirect_d), indirect_d, 0, NULL);
 
 	for (int i = 0; i < cl.worldmodel->numleafs; i++)
@@ -1754,6 +2295,33 @@ void GL_SetupIndirectDraws ()
 	}
 }
 
+/*
+==================
+R_ShadowSamples
+==================
+*/
+static uint32_t R_ShadowSamples (void)
+{
+	return (r_rtshadows.value > 0) ? (1 << ((int)r_rtshadows.value + 1)) : 0;
+}
+
+/*
+==================
+R_ShadowRate
+
+Number of updates the shadow samples are spread over, a power of two so that each
+update traces the same number of them
+==================
+*/
+static uint32_t R_ShadowRate (void)
+{
+	const uint32_t shadow_samples = R_ShadowSamples ();
+	uint32_t	   rate = 1;
+	while ((rate * 2 <= r_rtshadows_rate.value) && (rate * 2 <= shadow_samples))
+		rate *= 2;
+	return rate;
+}
+
 /*
 ==================
 GL_UpdateLightmapDescriptorSets
@@ -1769,6 +2337,22 @@ void GL_UpdateLightmapDescriptorSets (void)
 	if (lightmap_count && !lightmaps[0].texture->target_image_view)
 		return;
 
+	// Without reduced rate shadows the shader never touches the history, but it needs a valid binding
+	const size_t   rt_history_lightmap_size = LMBLOCK_WIDTH * LMBLOCK_HEIGHT * 2 * sizeof (uint32_t);
+	const qboolean history = rt && (R_ShadowRate () > 1) && (lightmap_count > 0);
+	R_FreeBuffer (rt_history_buffer, &rt_history_memory, &num_vulkan_bmodel_allocations);
+	rt_history_buffer = VK_NULL_HANDLE;
+	if (rt)
+	{
+		const size_t buffer_size = history ? (lightmap_count * rt_history_lightmap_size) : (2 * sizeof (uint32_t));
+		if (history)
+			Sys_Printf ("Allocating ray traced shadow history (%u KB)\n", (int)(buffer_size / 1024));
+		R_CreateBuffer (
+			&rt_history_buffer, &rt_history_memory, buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+			&num_vulkan_bmodel_allocations, NULL, "RT shadow history");
+		rt_history_reset = true;
+	}
+
 	for (int i = 0; i < lightmap_count; i++)
 	{
 		struct lightmap_s *lm = &lightmaps[i];
@@ -1817,8 +2401,13 @@ void GL_UpdateLightmapDescriptorSets (void)
 		world_vertex_buffer_info.offset = 0;
 		world_vertex_buffer_info.range = VK_WHOLE_SIZE;
 
+		ZEROED_STRUCT (VkDescriptorBufferInfo, rt_history_buffer_info);
+		rt_history_buffer_info.buffer = rt_history_buffer;
+		rt_history_buffer_info.offset = history ? (i * rt_history_lightmap_size) : 0;
+		rt_history_buffer_info.range = history ? rt_history_lightmap_size : VK_WHOLE_SIZE;
+
 		int num_writes = 0;
-		ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, writes, 9);
+		ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, writes, 10);
 		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		writes[0].dstBinding = num_writes++;
 		writes[0].dstArrayElement = 0;
@@ -1896,12 +2485,44 @@ void GL_UpdateLightmapDescriptorSets (void)
 			writes[8].descriptorCount = 1;
 			writes[8].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
 			writes[8].dstSet = lm->descriptor_set;
+
+			writes[9].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[9].dstBinding = num_writes++;
+			writes[9].dstArrayElement = 0;
+			writes[9].descriptorCount = 1;
+			writes[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[9].dstSet = lm->descriptor_set;
+			writes[9].pBufferInfo = &rt_history_buffer_info;
 		}
 
 		vkUpdateDescriptorSets (vulkan_globals.device, num_writes, writes, 0, NULL);
 	}
 }
 
+// With r_lightmapcompression the lightstyle textures of pages without fourth styles are BC1.
+// They only hold the static texels the lightmap compute shader adds up, the pages it writes
+// with the animated styles and dynamic lights stay uncompressed storage images.
+cvar_t r_lightmapcompression = {"r_lightmapcompression", "0", CVAR_ARCHIVE};
+
+typedef struct
+{
+	int					lightmap;
+	int					style;
+	int					width, height;
+	compressed_image_t *image;
+} lightstyle_compress_job_t;
+
+/*
+==================
+GL_CompressLightstyleTask
+==================
+*/
+static void GL_CompressLightstyleTask (int index, lightstyle_compress_job_t **jobs)
+{
+	lightstyle_compress_job_t *job = &(*jobs)[index];
+	job->image = Image_CompressOpaqueRGBA (lightmaps[job->lightmap].lightstyle_data[job->style], job->width, job->height);
+}
+
 /*
 ==================
 GL_SetupLightmapCompute
@@ -1911,6 +2532,10 @@ void GL_SetupLightmapCompute (void)
 {
 	GL_AllocateWorkgroupBoundsBuffers ();
 
+	const qboolean compress = r_lightmapcompression.value && GL_CompressedFormatSupported (VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+	TEMP_ALLOC_ZEROED (lightstyle_compress_job_t, jobs, q_max (lightmap_count * MAXLIGHTMAPS * 3 / 4, 1));
+	int num_jobs = 0;
+
 	//
 	// upload all lightmaps that were filled
 	//
@@ -1943,6 +2568,12 @@ void GL_SetupLightmapCompute (void)
 				if (size_w < LMBLOCK_WIDTH) // this is not common and is easier than handling variable strides in TexMgr_LoadImage
 					for (int row = 1; row < size_h; row++)
 						memmove (lm->lightstyle_data[j] + size_w * row * 4, lm->lightstyle_data[j] + LMBLOCK_WIDTH * row * 4, size_w * 4);
+				if (compress && !lm->fourth_style)
+				{
+					// loaded once all of them are encoded
+					jobs[num_jobs++] = (lightstyle_compress_job_t){.lightmap = i, .style = j, .width = size_w, .height = size_h};
+					continue;
+				}
 				lm->lightstyle_textures[j] = TexMgr_LoadImage (
 					cl.worldmodel, name, size_w, size_h, SRC_RGBA, lm->lightstyle_data[j], "", (src_offset_t)lm->data, TEXPREF_NEAREST | TEXPREF_NOPICMIP);
 			}
@@ -1962,13 +2593,37 @@ void GL_SetupLightmapCompute (void)
 			TEXPREF_NEAREST | TEXPREF_NOPICMIP);
 		SAFE_FREE (lm->surface_indices);
 
-		for (int y = 0; y < LMBLOCK_HEIGHT / LM_CULL_BLOCK_H; y++)
-			for (int x = 0; x < LMBLOCK_WIDTH / LM_CULL_BLOCK_W; x++)
-				for (int l = 0; l < MAX_LIGHTSTYLES; l++)
-					if (lightmaps[i].used_lightstyles[y][x][l])
-						lightmaps[i].used_lightstyles[y][x][lightmaps[i].num_used_lightstyles[y][x]++] = l;
+		for (int l = 0; l < MAX_LIGHTSTYLES; l++)
+			if (lm->lightstyle_blocks[l])
+				lm->lightstyles[lm->num_lightstyles++] = l;
 	}
 
+	if (num_jobs > 0)
+	{
+		if (!Tasks_IsWorker () && (num_jobs > 1))
+		{
+			task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)GL_CompressLightstyleTask, num_jobs, &jobs, sizeof (jobs));
+			Task_Join (task, TASK_TIMEOUT_INFINITE);
+		}
+		else
+			for (int i = 0; i < num_jobs; ++i)
+				GL_CompressLightstyleTask (i, &jobs);
+
+		for (int i = 0; i < num_jobs; ++i)
+		{
+			struct lightmap_s *lm = &lightmaps[jobs[i].lightmap];
+			char			   name[32];
+			q_snprintf (name, sizeof (name), "lightstyle%d_%07i", jobs[i].style, jobs[i].lightmap);
+			lm->lightstyle_textures[jobs[i].style] = TexMgr_LoadImage (
+				cl.worldmodel, name, jobs[i].width, jobs[i].height, SRC_COMPRESSED, (byte *)jobs[i].image, "", (src_offset_t)jobs[i].image,
+				TEXPREF_NEAREST | TEXPREF_NOPICMIP);
+			Mem_Free (jobs[i].image);
+			SAFE_FREE (lm->lightstyle_data[jobs[i].style]);
+		}
+		Con_DPrintf ("%d lightstyle textures compressed to BC1\n", num_jobs);
+	}
+	TEMP_FREE (jobs);
+
 	for (int i = 0; i < lightmap_count; i++)
 	{
 		struct lightmap_s *lm = &lightmaps[i];
@@ -2016,6 +2671,205 @@ void GL_DeleteBModelVertexBuffer (void)
 {
 	GL_WaitForDeviceIdle ();
 	R_FreeBuffer (bmodel_vertex_buffer, &bmodel_memory, &num_vulkan_bmodel_allocations);
+	R_FreeBuffer (surface_clusters_buffer, &surface_clusters_buffer_memory, &num_vulkan_bmodel_allocations);
+	surface_clusters_buffer = VK_NULL_HANDLE;
+	R_FreeBuffer (vertex_submodels_buffer, &vertex_submodels_buffer_memory, &num_vulkan_bmodel_allocations);
+	vertex_submodels_buffer = VK_NULL_HANDLE;
+	R_FreeBuffer (bmodel_transforms_buffer, &bmodel_transforms_buffer_memory, &num_vulkan_bmodel_allocations);
+	bmodel_transforms_buffer = VK_NULL_HANDLE;
+	bmodel_transforms_mapped = NULL;
+	for (int i = 0; i < DOUBLE_BUFFERED; ++i)
+	{
+		if (bmodel_transforms_desc_sets[i] != VK_NULL_HANDLE)
+			R_FreeDescriptorSet (bmodel_transforms_desc_sets[i], &vulkan_globals.bmodel_transforms_set_layout);
+		bmodel_transforms_desc_sets[i] = VK_NULL_HANDLE;
+	}
+	SAFE_FREE (bmodel_transforms_claims);
+}
+
+/*
+==================
+GL_BuildSurfaceClusters
+
+Bounding sphere and normal cone of every INDIRECT_CLUSTER_SIZE world surfaces, which
+is what a workgroup of indirect.comp processes. The cone is built from the facing
+normals, so it culls exactly what the per surface backface test would for every
+surface of the cluster.
+==================
+*/
+static void GL_BuildSurfaceClusters (void)
+{
+	qmodel_t	*world = cl.worldmodel;
+	const int	 num_clusters = q_max ((world->numsurfaces + INDIRECT_CLUSTER_SIZE - 1) / INDIRECT_CLUSTER_SIZE, 1);
+	const size_t buffer_size = num_clusters * sizeof (surface_cluster_t);
+
+	surface_cluster_t *clusters = Mem_Alloc (buffer_size);
+	for (int c = 0; c < num_clusters; ++c)
+	{
+		surface_cluster_t *cluster = &clusters[c];
+		const int		   first = c * INDIRECT_CLUSTER_SIZE;
+		const int		   last = q_min (first + INDIRECT_CLUSTER_SIZE, world->numsurfaces);
+		vec3_t			   mins = {FLT_MAX, FLT_MAX, FLT_MAX};
+		vec3_t			   maxs = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+		vec3_t			   normal_sum = {0.0f, 0.0f, 0.0f};
+
+		cluster->cone_cutoff = 2.0f;
+		if (first >= last)
+			continue;
+		if ((uint32_t)last > indirect_bmodel_start)
+		{
+			cluster->radius = -1.0f; // brush entities move, only the visibility is tested
+			continue;
+		}
+
+		for (int i = first; i < last; ++i)
+		{
+			const msurface_t *s = &world->surfaces[i];
+			const float		 *v = s->polys->verts[0];
+			for (int j = 0; j < s->numedges; ++j, v += VERTEXSIZE)
+				for (int k = 0; k < 3; ++k)
+				{
+					mins[k] = q_min (mins[k], v[k]);
+					maxs[k] = q_max (maxs[k], v[k]);
+				}
+			if (s->flags & SURF_PLANEBACK)
+				VectorSubtract (normal_sum, s->plane->normal, normal_sum);
+			else
+				VectorAdd (normal_sum, s->plane->normal, normal_sum);
+		}
+
+		float radius_squared = 0.0f;
+		for (int k = 0; k < 3; ++k)
+			cluster->center[k] = (mins[k] + maxs[k]) * 0.5f;
+		for (int i = first; i < last; ++i)
+		{
+			const msurface_t *s = &world->surfaces[i];
+			const float		 *v = s->polys->verts[0];
+			for (int j = 0; j < s->numedges; ++j, v += VERTEXSIZE)
+			{
+				vec3_t offset;
+				VectorSubtract (v, cluster->center, offset);
+				radius_squared = q_max (radius_squared, DotProduct (offset, offset));
+			}
+		}
+		cluster->radius = sqrtf (radius_squared);
+
+		if (VectorNormalize (normal_sum) == 0.0f)
+			continue;
+		float min_dot = 1.0f;
+		for (int i = first; i < last; ++i)
+		{
+			const msurface_t *s = &world->surfaces[i];
+			const float		  dot = DotProduct (normal_sum, s->plane->normal);
+			min_dot = q_min (min_dot, (s->flags & SURF_PLANEBACK) ? -dot : dot);
+		}
+		VectorCopy (normal_sum, cluster->cone_axis);
+		if (min_dot > 0.0f)
+			cluster->cone_cutoff = sqrtf (1.0f - min_dot * min_dot);
+	}
+
+	Sys_Printf ("Allocating surface clusters (%u KB)\n", (int)buffer_size / 1024);
+	R_CreateBuffer (
+		&surface_clusters_buffer, &surface_clusters_buffer_memory, buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_bmodel_allocations, NULL, "Surface clusters");
+	R_StagingUploadBuffer (surface_clusters_buffer, buffer_size, (byte *)clusters);
+	Mem_Free (clusters);
+}
+
+/*
+==================
+GL_BuildBModelTransforms
+
+Submodel of every vertex and the double-buffered transforms R_ClaimIndirectBrush writes,
+see world_indirect.vert.
+==================
+*/
+static void GL_BuildBModelTransforms (void)
+{
+	qmodel_t	*world = cl.worldmodel;
+	const size_t vertex_submodels_size = q_max (bmodel_numverts, 1u) * sizeof (uint32_t);
+
+	uint32_t *vertex_submodels = Mem_Alloc (vertex_submodels_size);
+	for (int j = 2; j < MAX_MODELS; j++)
+	{
+		qmodel_t *m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] != '*')
+			continue;
+		const uint32_t submodel = atoi (m->name + 1);
+		for (int i = m->firstmodelsurface; i < m->firstmodelsurface + m->nummodelsurfaces; i++)
+		{
+			const msurface_t *s = &world->surfaces[i];
+			for (int k = 0; k < s->numedges; ++k)
+				vertex_submodels[s->vbo_firstvert + k] = submodel;
+		}
+	}
+
+	R_CreateBuffer (
+		&vertex_submodels_buffer, &vertex_submodels_buffer_memory, vertex_submodels_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_bmodel_allocations, NULL, "Vertex submodels");
+	R_StagingUploadBuffer (vertex_submodels_buffer, vertex_submodels_size, (byte *)vertex_submodels);
+	Mem_Free (vertex_submodels);
+
+	const VkDeviceSize alignment = q_max (vulkan_globals.device_properties.limits.minStorageBufferOffsetAlignment, (VkDeviceSize)sizeof (vec4_t));
+	bmodel_transforms_count = q_max (world->numsubmodels, 1);
+	// a multiple of the alignment and of a whole transform, indirect.comp indexes the transforms of a slot
+	bmodel_transforms_stride = BMODEL_TRANSFORM_VEC4S * q_align (bmodel_transforms_count * sizeof (vec4_t), alignment) / sizeof (vec4_t);
+	const size_t slot_size = bmodel_transforms_stride * sizeof (vec4_t);
+
+	buffer_create_info_t buffer_create_info = {
+		.buffer = &bmodel_transforms_buffer,
+		.size = DOUBLE_BUFFERED * slot_size,
+		.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		.mapped = (void **)&bmodel_transforms_mapped,
+		.name = "BModel transforms",
+	};
+	R_CreateBuffers (
+		1, &buffer_create_info, &bmodel_transforms_buffer_memory, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &num_vulkan_bmodel_allocations, "BModel transforms");
+	// identity for the world and every submodel that hasn't been claimed yet
+	memset (bmodel_transforms_mapped, 0, DOUBLE_BUFFERED * slot_size);
+	for (int i = 0; i < DOUBLE_BUFFERED; ++i)
+		for (int j = 0; j < bmodel_transforms_count; ++j)
+			for (int k = 0; k < BMODEL_TRANSFORM_VEC4S; ++k)
+				bmodel_transforms_mapped[i * bmodel_transforms_stride + j * BMODEL_TRANSFORM_VEC4S + k][k] = 1.0f;
+	bmodel_transforms_claims = Mem_Alloc (bmodel_transforms_count * sizeof (atomic_uint32_t));
+
+	ZEROED_STRUCT (VkDescriptorBufferInfo, vertex_submodels_buffer_info);
+	vertex_submodels_buffer_info.buffer = vertex_submodels_buffer;
+	vertex_submodels_buffer_info.offset = 0;
+	vertex_submodels_buffer_info.range = VK_WHOLE_SIZE;
+
+	for (int i = 0; i < DOUBLE_BUFFERED; ++i)
+	{
+		bmodel_transforms_desc_sets[i] = R_AllocateDescriptorSet (&vulkan_globals.bmodel_transforms_set_layout);
+		GL_SetObjectName ((uint64_t)bmodel_transforms_desc_sets[i], VK_OBJECT_TYPE_DESCRIPTOR_SET, va ("bmodel transforms %d desc set", i));
+
+		ZEROED_STRUCT (VkDescriptorBufferInfo, transforms_buffer_info);
+		transforms_buffer_info.buffer = bmodel_transforms_buffer;
+		transforms_buffer_info.offset = i * slot_size;
+		transforms_buffer_info.range = slot_size;
+
+		ZEROED_STRUCT_ARRAY (VkWriteDescriptorSet, writes, 2);
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstBinding = 0;
+		writes[0].dstArrayElement = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[0].dstSet = bmodel_transforms_desc_sets[i];
+		writes[0].pBufferInfo = &vertex_submodels_buffer_info;
+
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstBinding = 1;
+		writes[1].dstArrayElement = 0;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].dstSet = bmodel_transforms_desc_sets[i];
+		writes[1].pBufferInfo = &transforms_buffer_info;
+
+		vkUpdateDescriptorSets (vulkan_globals.device, countof (writes), writes, 0, NULL);
+	}
 }
 
 /*
@@ -2058,6 +2912,7 @@ void GL_DeleteBModelAccelerationStructures (void)
 	bmodel_indices_device_address = 0;
 	bmodel_scratch_buffer = VK_NULL_HANDLE;
 	bmodel_scratch_address = 0;
+	last_tlas_num_instances = -1;
 	TEMP_FREE (buffers);
 }
 
@@ -2089,21 +2944,26 @@ void GL_BuildBModelVertexBuffer (void)
 		}
 	}
 
-	// build vertex array
+	// build vertex array, the world cache already holds it
 	varray_bytes = VERTEXSIZE * sizeof (float) * bmodel_numverts;
-	TEMP_ALLOC_ZEROED (float, varray, varray_bytes / sizeof (float));
-
-	for (j = 1; j < MAX_MODELS; j++)
+	float *varray = (world_cache_numverts == bmodel_numverts) ? world_cache_verts : NULL;
+	if (!varray)
 	{
-		m = cl.model_precache[j];
-		if (!m || m->name[0] == '*' || m->type != mod_brush)
-			continue;
-
-		for (i = 0; i < m->numsurfaces; i++)
+		SAFE_FREE (world_cache_verts);
+		varray = Mem_Alloc (varray_bytes);
+		for (j = 1; j < MAX_MODELS; j++)
 		{
-			msurface_t *s = &m->surfaces[i];
-			memcpy (&varray[VERTEXSIZE * s->vbo_firstvert], s->polys->verts, VERTEXSIZE * sizeof (float) * s->numedges);
+			m = cl.model_precache[j];
+			if (!m || m->name[0] == '*' || m->type != mod_brush)
+				continue;
+
+			for (i = 0; i < m->numsurfaces; i++)
+			{
+				msurface_t *s = &m->surfaces[i];
+				memcpy (&varray[VERTEXSIZE * s->vbo_firstvert], s->polys->verts, VERTEXSIZE * sizeof (float) * s->numedges);
+			}
 		}
+		GL_SaveWorldCache (varray);
 	}
 
 	VkImageUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
@@ -2115,7 +2975,11 @@ void GL_BuildBModelVertexBuffer (void)
 		&bmodel_vertex_buffer, &bmodel_memory, varray_bytes, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &num_vulkan_bmodel_allocations,
 		&bmodel_vertex_buffer_device_address, "BModel vertices");
 	R_StagingUploadBuffer (bmodel_vertex_buffer, varray_bytes, (byte *)varray);
-	TEMP_FREE (varray);
+	Mem_Free (varray);
+	world_cache_verts = NULL;
+
+	GL_BuildSurfaceClusters ();
+	GL_BuildBModelTransforms ();
 }
 
 /*
@@ -2392,7 +3256,7 @@ void R_BuildTopLevelAccelerationStructure (void *unused)
 	cb_context_t *cbx = &vulkan_globals.primary_cb_contexts[PCBX_BUILD_ACCELERATION_STRUCTURES];
 
 	// Update animated entity BLASes first
-	R_UpdateAnimatedBLASes (cbx);
+	const int num_blases_built = R_UpdateAnimatedBLASes (cbx);
 
 	R_BeginDebugUtilsLabel (cbx, "Build TLAS");
 
@@ -2412,9 +3276,7 @@ void R_BuildTopLevelAccelerationStructure (void *unused)
 			++num_instances;
 	}
 
-	VkDeviceAddress						instances_device_address;
-	VkAccelerationStructureInstanceKHR *instances = (VkAccelerationStructureInstanceKHR *)R_StorageAllocate (
-		num_instances * sizeof (VkAccelerationStructureInstanceKHR), NULL, NULL, &instances_device_address);
+	TEMP_ALLOC (VkAccelerationStructureInstanceKHR, instances, q_max (num_instances, 1));
 
 	num_instances = 0;
 	for (int i = 0; i < cl.num_entities + cl.num_statics; ++i)
@@ -2434,7 +3296,7 @@ void R_BuildTopLevelAccelerationStructure (void *unused)
 		}
 		else if (e->model->type == mod_alias && e->blas_data && e->blas_data->blas != VK_NULL_HANDLE && e->blas_data->model == e->model)
 		{
-			address = e->blas_data->address;
+			address = e->blas_data->shared ? e->blas_data->shared->address : e->blas_data->address;
 			is_alias = true;
 		}
 		else
@@ -2495,6 +3357,25 @@ void R_BuildTopLevelAccelerationStructure (void *unused)
 		++num_instances;
 	}
 
+	// Nothing moved and no BLAS changed: the TLAS from last frame is still valid
+	const size_t instances_size = num_instances * sizeof (VkAccelerationStructureInstanceKHR);
+	if ((num_blases_built == 0) && (num_instances == last_tlas_num_instances) && (memcmp (instances, last_tlas_instances, instances_size) == 0))
+	{
+		TEMP_FREE (instances);
+		R_EndDebugUtilsLabel (cbx);
+		return;
+	}
+	last_tlas_instances = Mem_Realloc (last_tlas_instances, q_max (instances_size, 1));
+	memcpy (last_tlas_instances, instances, instances_size);
+	last_tlas_num_instances = num_instances;
+	++tlas_generation;
+
+	VkDeviceAddress						instances_device_address;
+	VkAccelerationStructureInstanceKHR *instances_storage = (VkAccelerationStructureInstanceKHR *)R_StorageAllocate (
+		instances_size, NULL, NULL, &instances_device_address);
+	memcpy (instances_storage, instances, instances_size);
+	TEMP_FREE (instances);
+
 	ZEROED_STRUCT (VkAccelerationStructureGeometryKHR, tlas_geometry);
 	tlas_geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
 	tlas_geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
@@ -2567,6 +3448,7 @@ GL_PrepareSIMDData
 void GL_PrepareSIMDAndParallelData (void)
 {
 	cl.worldmodel->surfvis = Mem_Alloc (((cl.worldmodel->numsurfaces + 31) / 8));
+	cl.worldmodel->leafvis = Mem_Alloc (((cl.worldmodel->numleafs + 31) / 8));
 #ifdef USE_SIMD
 	int i;
 
@@ -2646,7 +3528,85 @@ void R_AddDynamicLights (msurface_t *surf)
 			td = local[1] - t * 16;
 			if (td < 0)
 				td = -td;
-			for (s = 0; s < smax; s++)
+			s = 0;
+#if defined(USE_SIMD)
+			// 4 texels at once, same integer distance and truncation as the loop below
+			if (use_simd)
+			{
+#if defined(USE_SSE2)
+				const __m128i vtd = _mm_set1_epi32 (td);
+				const __m128  vminlight = _mm_set1_ps (minlight);
+				const __m128  vrad = _mm_set1_ps (rad);
+				const __m128  vcred = _mm_set1_ps (cred);
+				const __m128  vcgreen = _mm_set1_ps (cgreen);
+				const __m128  vcblue = _mm_set1_ps (cblue);
+				const __m128  vlocal = _mm_set1_ps (local[0]);
+				const __m128  offsets = _mm_setr_ps (0.0f, 16.0f, 32.0f, 48.0f);
+				for (; s + 4 <= smax; s += 4, bl += 12)
+				{
+					__m128i vsd = _mm_cvttps_epi32 (_mm_sub_ps (vlocal, _mm_add_ps (_mm_set1_ps (s * 16), offsets)));
+					__m128i sign = _mm_srai_epi32 (vsd, 31);
+					vsd = _mm_sub_epi32 (_mm_xor_si128 (vsd, sign), sign);
+
+					const __m128i sd_greater = _mm_cmpgt_epi32 (vsd, vtd);
+					const __m128i vmax = _mm_or_si128 (_mm_and_si128 (sd_greater, vsd), _mm_andnot_si128 (sd_greater, vtd));
+					const __m128i vmin = _mm_or_si128 (_mm_and_si128 (sd_greater, vtd), _mm_andnot_si128 (sd_greater, vsd));
+					const __m128  vdist = _mm_cvtepi32_ps (_mm_add_epi32 (vmax, _mm_srai_epi32 (vmin, 1)));
+					const __m128  lit = _mm_cmplt_ps (vdist, vminlight);
+					if (_mm_movemask_ps (lit) == 0)
+						continue;
+
+					const __m128  vbrightness = _mm_and_ps (_mm_sub_ps (vrad, vdist), lit);
+					const __m128  r = _mm_castsi128_ps (_mm_cvttps_epi32 (_mm_mul_ps (vbrightness, vcred)));
+					const __m128  g = _mm_castsi128_ps (_mm_cvttps_epi32 (_mm_mul_ps (vbrightness, vcgreen)));
+					const __m128  b = _mm_castsi128_ps (_mm_cvttps_epi32 (_mm_mul_ps (vbrightness, vcblue)));
+
+					// interleave to r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+					const __m128 rg_lo = _mm_unpacklo_ps (r, g);
+					const __m128 rg_hi = _mm_unpackhi_ps (r, g);
+					const __m128 b0r1 = _mm_shuffle_ps (b, rg_lo, _MM_SHUFFLE (2, 2, 0, 0));
+					const __m128 g1b1 = _mm_shuffle_ps (rg_lo, b, _MM_SHUFFLE (1, 1, 3, 3));
+					const __m128 b2r3 = _mm_shuffle_ps (b, rg_hi, _MM_SHUFFLE (2, 2, 2, 2));
+					const __m128 g3b3 = _mm_shuffle_ps (rg_hi, b, _MM_SHUFFLE (3, 3, 3, 3));
+					const __m128 add[3] = {
+						_mm_shuffle_ps (rg_lo, b0r1, _MM_SHUFFLE (2, 0, 1, 0)),
+						_mm_shuffle_ps (g1b1, rg_hi, _MM_SHUFFLE (1, 0, 2, 0)),
+						_mm_shuffle_ps (b2r3, g3b3, _MM_SHUFFLE (2, 0, 2, 0)),
+					};
+					for (i = 0; i < 3; i++)
+					{
+						__m128i v = _mm_loadu_si128 ((const __m128i *)(bl + i * 4));
+						v = _mm_add_epi32 (v, _mm_castps_si128 (add[i]));
+						_mm_storeu_si128 ((__m128i *)(bl + i * 4), v);
+					}
+				}
+#elif defined(USE_NEON)
+				const int32x4_t	  vtd = vdupq_n_s32 (td);
+				const float32x4_t vminlight = vdupq_n_f32 (minlight);
+				const float32x4_t vrad = vdupq_n_f32 (rad);
+				const float32x4_t vlocal = vdupq_n_f32 (local[0]);
+				const float32x4_t offsets = {0.0f, 16.0f, 32.0f, 48.0f};
+				for (; s + 4 <= smax; s += 4, bl += 12)
+				{
+					const int32x4_t vsd = vabsq_s32 (vcvtq_s32_f32 (vsubq_f32 (vlocal, vaddq_f32 (vdupq_n_f32 (s * 16), offsets))));
+
+					const int32x4_t	  vdist_int = vaddq_s32 (vmaxq_s32 (vsd, vtd), vshrq_n_s32 (vminq_s32 (vsd, vtd), 1));
+					const float32x4_t vdist = vcvtq_f32_s32 (vdist_int);
+					const uint32x4_t  lit = vcltq_f32 (vdist, vminlight);
+					if (vmaxvq_u32 (lit) == 0)
+						continue;
+
+					const float32x4_t vbrightness = vreinterpretq_f32_u32 (vandq_u32 (vreinterpretq_u32_f32 (vsubq_f32 (vrad, vdist)), lit));
+					uint32x4x3_t	  rgb = vld3q_u32 (bl);
+					rgb.val[0] = vaddq_u32 (rgb.val[0], vreinterpretq_u32_s32 (vcvtq_s32_f32 (vmulq_n_f32 (vbrightness, cred))));
+					rgb.val[1] = vaddq_u32 (rgb.val[1], vreinterpretq_u32_s32 (vcvtq_s32_f32 (vmulq_n_f32 (vbrightness, cgreen))));
+					rgb.val[2] = vaddq_u32 (rgb.val[2], vreinterpretq_u32_s32 (vcvtq_s32_f32 (vmulq_n_f32 (vbrightness, cblue))));
+					vst3q_u32 (bl, rgb);
+				}
+#endif
+			}
+#endif
+			for (; s < smax; s++)
 			{
 				sd = local[0] - s * 16;
 				if (sd < 0)
@@ -2953,19 +3913,31 @@ static void R_UploadLightmap (int lmap, gltexture_t *lightmap_tex)
 /*
 =============
 R_FlushUpdateLightmaps
+
+history_valid tells per lightmap if the shadow history of its texels can be used, see
+r_rtshadows_rate
 =============
 */
 #define UPDATE_LIGHTMAP_BATCH_SIZE 64
 void R_FlushUpdateLightmaps (
 	cb_context_t *cbx, int num_batch_lightmaps, VkImageMemoryBarrier *pre_barriers, VkImageMemoryBarrier *post_barriers, int *lightmap_indexes,
-	byte lightmap_regions[UPDATE_LIGHTMAP_BATCH_SIZE][LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W], int current_dlights,
-	int cached_dlights)
+	byte lightmap_regions[UPDATE_LIGHTMAP_BATCH_SIZE][LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W], qboolean *history_valid,
+	int current_dlights, int cached_dlights)
 {
-	vulkan_pipeline_t *pipeline =
-		(r_rtshadows.value && (bmodel_tlas != VK_NULL_HANDLE)) ? &vulkan_globals.update_lightmap_rt_pipeline : &vulkan_globals.update_lightmap_pipeline;
+	const qboolean	   rt = r_rtshadows.value && (bmodel_tlas != VK_NULL_HANDLE);
+	vulkan_pipeline_t *pipeline = rt ? &vulkan_globals.update_lightmap_rt_pipeline : &vulkan_globals.update_lightmap_pipeline;
+	const uint32_t	   shadow_samples = R_ShadowSamples ();
+	const uint32_t	   shadow_rate = rt ? R_ShadowRate () : 1;
 
+	// the shadow history written by the last update is read again
+	VkMemoryBarrier memory_barrier;
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.pNext = NULL;
+	memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 	vkCmdPipelineBarrier (
-		cbx->cb, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, num_batch_lightmaps, pre_barriers);
+		cbx->cb, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, (shadow_rate > 1) ? 1 : 0, &memory_barrier, 0, NULL,
+		num_batch_lightmaps, pre_barriers);
 	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, *pipeline);
 	uint32_t offsets[2] = {
 		current_compute_buffer_index * MAX_LIGHTSTYLES * sizeof (float), current_compute_buffer_index * MAX_DLIGHTS * 2 * sizeof (lm_compute_light_t)};
@@ -3003,10 +3975,10 @@ void R_FlushUpdateLightmaps (
 							lightmap_regions[j][y + h][i] = false;
 						h += 1;
 					}
-					uint32_t shadow_samples = (r_rtshadows.value > 0) ? (1 << ((int)r_rtshadows.value + 1)) : 0;
-					uint32_t push_constants[7] = {current_dlights, LMBLOCK_WIDTH,  x * LM_CULL_BLOCK_W / 8, y * LM_CULL_BLOCK_H / 8,
-												  type == 1,	   cached_dlights, shadow_samples};
-					R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, 7 * sizeof (uint32_t), push_constants);
+					uint32_t push_constants[10] = {
+						current_dlights, LMBLOCK_WIDTH, x * LM_CULL_BLOCK_W / 8, y * LM_CULL_BLOCK_H / 8, type == 1, cached_dlights, shadow_samples,
+						shadow_rate, r_framecount, history_valid[j]};
+					R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, 10 * sizeof (uint32_t), push_constants);
 					w = q_min (lightmaps[lightmap_indexes[j]].lightstyle_rectused[0].w / 8 - x * LM_CULL_BLOCK_W / 8, w * LM_CULL_BLOCK_W / 8);
 					h = q_min (lightmaps[lightmap_indexes[j]].lightstyle_rectused[0].h / 8 - y * LM_CULL_BLOCK_H / 8, h * LM_CULL_BLOCK_H / 8);
 					vkCmdDispatch (cbx->cb, w, h, 1);
@@ -3029,7 +4001,25 @@ static void R_IndirectComputeDispatch (cb_context_t *cbx)
 
 	R_BeginDebugUtilsLabel (cbx, "Indirect Compute");
 
-	R_UploadVisibility (cl.worldmodel->surfvis, (cl.worldmodel->numsurfaces + 31) / 8);
+	R_UploadVisibility ();
+
+	// the last frame's indirect.comp must be done reading the visibility before it is replaced
+	VkMemoryBarrier memory_barrier;
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.pNext = NULL;
+	memory_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+
+	VkBufferCopy region;
+	region.srcOffset = current_compute_buffer_index * dyn_visibility_offset;
+	region.dstOffset = 0;
+	region.size = visibility_buffer_size;
+	vkCmdCopyBuffer (cbx->cb, dyn_visibility_buffer, visibility_buffer, 1, &region);
+
+	memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
 
 	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.indirect_clear_pipeline);
 	VkDescriptorSet sets[1] = {vulkan_globals.indirect_compute_desc_set};
@@ -3038,7 +4028,15 @@ static void R_IndirectComputeDispatch (cb_context_t *cbx)
 
 	vkCmdDispatch (cbx->cb, (used_indirect_draws + 63) / 64, 1, 1);
 
-	VkMemoryBarrier memory_barrier;
+	if (indirect_mark)
+	{
+		// surfaces of the leafs R_MarkSurfaces culled, on top of the copied CPU marks
+		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.indirect_mark_pipeline);
+		const uint32_t mark_push_constants[2] = {cl.worldmodel->numleafs, (current_compute_buffer_index * dyn_visibility_offset + visibility_buffer_size) / 4};
+		R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, 2 * sizeof (uint32_t), mark_push_constants);
+		vkCmdDispatch (cbx->cb, (cl.worldmodel->numleafs + 63) / 64, 1, 1);
+	}
+
 	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
 	memory_barrier.pNext = NULL;
 	memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
@@ -3046,13 +4044,18 @@ static void R_IndirectComputeDispatch (cb_context_t *cbx)
 	vkCmdPipelineBarrier (cbx->cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
 
 	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.indirect_draw_pipeline);
-	char push_constants[6 * 4];
+	char push_constants[24 * 4];
+	memset (push_constants, 0, sizeof (push_constants));
 	memcpy (push_constants, &cl.model_precache[1]->numsurfaces, sizeof (int));
-	memset (push_constants + 4, 0, sizeof (uint32_t));
-	uint32_t offset = current_compute_buffer_index * dyn_visibility_offset / 4;
-	memcpy (push_constants + 8, &offset, sizeof (uint32_t));
-	memcpy (push_constants + 12, r_refdef.vieworg, sizeof (vec3_t));
-	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, 6 * 4, push_constants);
+	memcpy (push_constants + 8, r_refdef.vieworg, sizeof (vec3_t));
+	const uint32_t transforms_base = bmodel_transforms_slot * bmodel_transforms_stride / BMODEL_TRANSFORM_VEC4S;
+	memcpy (push_constants + 20, &transforms_base, sizeof (uint32_t));
+	for (int i = 0; i < 4; ++i)
+	{
+		memcpy (push_constants + 32 + i * 16, frustum[i].normal, sizeof (vec3_t));
+		memcpy (push_constants + 44 + i * 16, &frustum[i].dist, sizeof (float));
+	}
+	R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (push_constants), push_constants);
 	const uint32_t num_workgroups = (cl.worldmodel->numsurfaces + 63) / 64;
 	const uint32_t max_dispatch = vulkan_globals.device_properties.limits.maxComputeWorkGroupCount[0];
 	uint32_t	   start_workgroup = 0;
@@ -3062,7 +4065,7 @@ static void R_IndirectComputeDispatch (cb_context_t *cbx)
 		start_workgroup += max_dispatch;
 		if (start_workgroup >= num_workgroups)
 			break;
-		const uint32_t start_offset = start_workgroup * 64;
+		const uint32_t start_offset = start_workgroup * INDIRECT_CLUSTER_SIZE;
 		R_PushConstants (cbx, VK_SHADER_STAGE_COMPUTE_BIT, 4, sizeof (uint32_t), &start_offset);
 	}
 
@@ -3086,6 +4089,7 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 {
 	cb_context_t *cbx = &vulkan_globals.primary_cb_contexts[PCBX_UPDATE_LIGHTMAPS];
 	R_BeginDebugUtilsLabel (cbx, "Update Lightmaps");
+	R_BeginGpuScope (cbx, GPU_SCOPE_LIGHTMAPS);
 
 	for (int i = 0; i < MAX_LIGHTSTYLES; ++i)
 	{
@@ -3095,14 +4099,16 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 
 	static lm_compute_light_t cached_dlights[MAX_DLIGHTS];
 	static int				  num_cached_dlights;
+	lm_compute_light_t		  previous_dlights[MAX_DLIGHTS];
 
 	memcpy (
 		lights_buffer_mapped + (current_compute_buffer_index * MAX_DLIGHTS * 2) + MAX_DLIGHTS, cached_dlights,
 		sizeof (lm_compute_light_t) * num_cached_dlights);
+	memcpy (previous_dlights, cached_dlights, sizeof (lm_compute_light_t) * num_cached_dlights);
 
-	int	  num_used_dlights = 0;
-	int	  used_dlights[MAX_DLIGHTS];
-	float squared_radius[MAX_DLIGHTS];
+	int		 num_used_dlights = 0;
+	uint64_t used_dlights = 0;
+	float	 squared_radius[MAX_DLIGHTS]; // by cl_dlights index
 	for (int i = 0; i < MAX_DLIGHTS; ++i)
 	{
 		lm_compute_light_t *light = &cached_dlights[num_used_dlights];
@@ -3112,15 +4118,24 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 		light->radius = cl_dlights[i].radius;
 		VectorCopy (cl_dlights[i].color, light->color);
 		light->minlight = cl_dlights[i].minlight;
-		squared_radius[num_used_dlights] = cl_dlights[i].radius * cl_dlights[i].radius;
-		used_dlights[num_used_dlights++] = i;
+		squared_radius[i] = cl_dlights[i].radius * cl_dlights[i].radius;
+		used_dlights |= 1ull << i;
+		++num_used_dlights;
 	}
 	memcpy (lights_buffer_mapped + (current_compute_buffer_index * MAX_DLIGHTS * 2), cached_dlights, sizeof (lm_compute_light_t) * num_used_dlights);
 
+	// The shadows of the last updates stay valid as long as the lights and the TLAS are the same
+	static uint32_t history_tlas_generation;
+	const qboolean	rt_history_valid = !rt_history_reset && (tlas_generation == history_tlas_generation) && (num_used_dlights == num_cached_dlights) &&
+									  (memcmp (previous_dlights, cached_dlights, sizeof (lm_compute_light_t) * num_used_dlights) == 0);
+	history_tlas_generation = tlas_generation;
+	rt_history_reset = false;
+
 	int					 num_lightmaps = 0;
 	int					 num_batch_lightmaps = 0;
 	VkImageMemoryBarrier pre_lm_image_barriers[UPDATE_LIGHTMAP_BATCH_SIZE];
 	VkImageMemoryBarrier post_lm_image_barriers[UPDATE_LIGHTMAP_BATCH_SIZE];
+	qboolean			 lightmap_history_valid[UPDATE_LIGHTMAP_BATCH_SIZE];
 	int					 lightmap_indexes[UPDATE_LIGHTMAP_BATCH_SIZE];
 	byte				 lightmap_regions[UPDATE_LIGHTMAP_BATCH_SIZE][LMBLOCK_HEIGHT / LM_CULL_BLOCK_H][LMBLOCK_WIDTH / LM_CULL_BLOCK_W];
 
@@ -3138,80 +4153,83 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 		if (modified == 0)
 			continue;
 
-		qboolean any_needs_dlight_update = false;
-		uint32_t used_lightstyles = 0;
-		int		 num_blocks = 0;
-		for (int y = 0; y < LMBLOCK_HEIGHT / LM_CULL_BLOCK_H; y++)
-			for (int x = 0; x < LMBLOCK_WIDTH / LM_CULL_BLOCK_W; x++)
+		// only the styles this lightmap uses, their blocks need a full update if the value
+		// changed since the last update of the lightmap
+		uint32_t style_blocks = 0;
+		uint32_t changed_lightstyles = 0;
+		for (int i = 0; i < lm->num_lightstyles; i++)
+		{
+			const int l = lm->lightstyles[i];
+			if (lm->cached_light[l] != d_lightstylevalue[l])
 			{
-				qboolean needs_update = false;
-				for (int i = 0; i < num_used_dlights; i++)
+				style_blocks |= lm->lightstyle_blocks[l];
+				changed_lightstyles |= 1 << (l < 16 ? l : l % 16 + 16);
+			}
+		}
+
+		// blocks lit by a dlight now or in the last update
+		uint32_t lit_blocks = 0;
+		if (num_used_dlights > 0)
+			for (int y = 0; y < LM_CULL_BLOCKS_Y; y++)
+				for (int x = 0; x < LM_CULL_BLOCKS_X; x++)
 				{
-					float sq_dist = 0.0f;
-					for (int j = 0; j < 3; j++)
+					// empty blocks have inverted bounds and get no lights
+					const lm_compute_workgroup_bounds_t *bounds = &lm->global_bounds[y][x];
+					for (uint64_t lights = R_DlightsInBox (bounds->mins, bounds->maxs) & used_dlights; lights; lights &= lights - 1)
 					{
-						float v = cl_dlights[used_dlights[i]].origin[j];
-						float mins = lm->global_bounds[y][x].mins[j];
-						float maxs = lm->global_bounds[y][x].maxs[j];
+						const int i = FindFirstBitNonZero64 (lights);
+						float	  sq_dist = 0.0f;
+						for (int j = 0; j < 3; j++)
+						{
+							float v = cl_dlights[i].origin[j];
+							float mins = bounds->mins[j];
+							float maxs = bounds->maxs[j];
 
-						if (v < mins)
-							sq_dist += (mins - v) * (mins - v);
-						if (v > maxs)
-							sq_dist += (v - maxs) * (v - maxs);
+							if (v < mins)
+								sq_dist += (mins - v) * (mins - v);
+							if (v > maxs)
+								sq_dist += (v - maxs) * (v - maxs);
 
-						if (sq_dist > squared_radius[i])
-							break;
-					}
+							if (sq_dist > squared_radius[i])
+								break;
+						}
 
-					if (sq_dist <= squared_radius[i])
-					{
-						lm->active_dlights[y][x] = true;
-						needs_update = true;
-					}
-				}
-				if (!needs_update && lm->active_dlights[y][x])
-				{
-					lm->active_dlights[y][x] = false;
-					needs_update = true;
-				}
-				if (needs_update)
-				{
-					any_needs_dlight_update = true;
-					if (lm->cached_framecount == r_framecount - 1)
-						regions[y][x] = 1;
-					else
-						regions[y][x] = 2;
-					num_blocks += 1;
-				}
-				if (regions[y][x] != 2)
-					for (int i = 0; i < lm->num_used_lightstyles[y][x]; i++)
-					{
-						int l = lm->used_lightstyles[y][x][i];
-						if (lm->cached_light[l] != d_lightstylevalue[l])
+						if (sq_dist <= squared_radius[i])
 						{
-							if (regions[y][x] == 0)
-								num_blocks += 1;
-							regions[y][x] = 2;
-							if (!any_needs_dlight_update)
-								used_lightstyles |= 1 << (l < 16 ? l : l % 16 + 16);
-							else
-								break;
+							lit_blocks |= LM_CULL_BLOCK_BIT (x, y);
+							break;
 						}
 					}
-			}
-		if (!any_needs_dlight_update && !(used_lightstyles & modified))
+				}
+		const uint32_t dlight_blocks = lit_blocks | lm->active_dlight_blocks;
+		lm->active_dlight_blocks = lit_blocks;
+
+		if (!dlight_blocks && !(changed_lightstyles & modified))
 			continue;
-		else
-		{
-			for (int i = 0; i < MAX_LIGHTSTYLES; i++)
-				lm->cached_light[i] = d_lightstylevalue[i];
-			lm->cached_framecount = r_framecount;
-			num_lightmaps += num_blocks;
-		}
+
+		const byte dlight_region = (lm->cached_framecount == r_framecount - 1) ? 1 : 2;
+		int		   num_blocks = 0;
+		for (int y = 0; y < LM_CULL_BLOCKS_Y; y++)
+			for (int x = 0; x < LM_CULL_BLOCKS_X; x++)
+			{
+				const uint32_t bit = LM_CULL_BLOCK_BIT (x, y);
+				if (style_blocks & bit)
+					regions[y][x] = 2;
+				else if (dlight_blocks & bit)
+					regions[y][x] = dlight_region;
+				if (regions[y][x])
+					num_blocks += 1;
+			}
+		for (int i = 0; i < lm->num_lightstyles; i++)
+			lm->cached_light[lm->lightstyles[i]] = d_lightstylevalue[lm->lightstyles[i]];
+		lm->cached_framecount = r_framecount;
+		num_lightmaps += num_blocks;
 
 		int batch_index = num_batch_lightmaps++;
 		lightmap_indexes[batch_index] = lightmap_index;
 		memcpy (lightmap_regions[batch_index], regions, sizeof (regions));
+		// texels lit by the same lights were written by the last update if there was one last frame
+		lightmap_history_valid[batch_index] = rt_history_valid && (dlight_region == 1);
 
 		VkImageMemoryBarrier *pre_barrier = &pre_lm_image_barriers[batch_index];
 		pre_barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -3248,15 +4266,16 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 		if (num_batch_lightmaps == UPDATE_LIGHTMAP_BATCH_SIZE)
 		{
 			R_FlushUpdateLightmaps (
-				cbx, num_batch_lightmaps, pre_lm_image_barriers, post_lm_image_barriers, lightmap_indexes, lightmap_regions, num_used_dlights,
-				num_cached_dlights);
+				cbx, num_batch_lightmaps, pre_lm_image_barriers, post_lm_image_barriers, lightmap_indexes, lightmap_regions, lightmap_history_valid,
+				num_used_dlights, num_cached_dlights);
 			num_batch_lightmaps = 0;
 		}
 	}
 
 	if (num_batch_lightmaps > 0)
 		R_FlushUpdateLightmaps (
-			cbx, num_batch_lightmaps, pre_lm_image_barriers, post_lm_image_barriers, lightmap_indexes, lightmap_regions, num_used_dlights, num_cached_dlights);
+			cbx, num_batch_lightmaps, pre_lm_image_barriers, post_lm_image_barriers, lightmap_indexes, lightmap_regions, lightmap_history_valid,
+			num_used_dlights, num_cached_dlights);
 
 	num_cached_dlights = num_used_dlights;
 
@@ -3265,6 +4284,8 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 	R_EndDebugUtilsLabel (cbx);
 
 	R_IndirectComputeDispatch (cbx);
+	R_AliasCullDispatch (cbx);
+	R_EndGpuScope (cbx, GPU_SCOPE_LIGHTMAPS);
 
 	current_compute_buffer_index = (current_compute_buffer_index + 1) % 2;
 }
@@ -0,0 +1,235 @@
+/*
+ * r_occlusion.c -- occlusion culling against an earlier frame's depth
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+// occlusion_depth.comp reduces the depth buffer of the 3D view to a coarse grid after
+// the main render pass. Every cell holds the farthest depth over its tile, which is the
+// smallest value with reversed Z. The grid of a command buffer slot is read back once
+// the slot's fence was waited on, so the tests of a frame use the depth of the frame
+// before the previous one. A box is occluded if its nearest projected corner is
+// farther than the farthest depth of every cell it covers. Everything that can't be
+// decided, like boxes crossing the near plane or outside of the old view, is visible.
+
+cvar_t r_occlusioncull = {"r_occlusioncull", "0", CVAR_ARCHIVE};
+cvar_t r_occlusionstats = {"r_occlusionstats", "0", CVAR_NONE};
+
+qboolean occlusion_cull;
+
+// Don't trust the old depth after the view jumped, e.g. when teleporting
+#define OCCLUSION_MAX_VIEW_MOVE 64.0f
+
+typedef struct occlusion_view_s
+{
+	float	 view_projection_matrix[16];
+	vec3_t	 origin;
+	int		 x, y, width, height; // 3D view in pixels, y down
+	qboolean pending;			  // occlusion_depth.comp has to be recorded for this slot
+	qboolean written;			  // the slot's grid holds the depth of this view
+} occlusion_view_t;
+
+static VkBuffer		   occlusion_buffer;
+static vulkan_memory_t occlusion_memory;
+static float		  *occlusion_mapped;
+
+static occlusion_view_t occlusion_views[DOUBLE_BUFFERED];
+static int				occlusion_slot;
+
+// The grid and view the boxes of the current frame are tested against
+static float			occlusion_grid[OCCLUSION_GRID_WIDTH * OCCLUSION_GRID_HEIGHT];
+static occlusion_view_t occlusion_test_view;
+static qboolean			occlusion_test_valid;
+
+static atomic_uint32_t occlusion_leafs_tested, occlusion_leafs_culled;
+static atomic_uint32_t occlusion_entities_tested, occlusion_entities_culled;
+
+/*
+===============
+R_InitOcclusion
+===============
+*/
+void R_InitOcclusion (void)
+{
+	if (!vulkan_globals.sampled_depth)
+		return;
+
+	buffer_create_info_t buffer_create_info = {
+		.buffer = &occlusion_buffer,
+		.size = DOUBLE_BUFFERED * OCCLUSION_GRID_WIDTH * OCCLUSION_GRID_HEIGHT * sizeof (float),
+		.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		.mapped = (void **)&occlusion_mapped,
+		.name = "Occlusion depth",
+	};
+	R_CreateBuffers (
+		1, &buffer_create_info, &occlusion_memory, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &num_vulkan_misc_allocations, "Occlusion depth");
+}
+
+/*
+===============
+R_GetOcclusionBuffer
+===============
+*/
+VkBuffer R_GetOcclusionBuffer (void)
+{
+	return occlusion_buffer;
+}
+
+/*
+===============
+R_OcclusionBeginFrame
+
+Called once the fence of cb_index was waited on, picks up the grid the GPU wrote into
+that slot two frames ago.
+===============
+*/
+void R_OcclusionBeginFrame (int cb_index)
+{
+	occlusion_view_t *view = &occlusion_views[cb_index];
+
+	occlusion_slot = cb_index;
+	occlusion_test_valid = view->written;
+	if (view->written)
+	{
+		memcpy (occlusion_grid, occlusion_mapped + (cb_index * OCCLUSION_GRID_WIDTH * OCCLUSION_GRID_HEIGHT), sizeof (occlusion_grid));
+		occlusion_test_view = *view;
+		view->written = false;
+	}
+}
+
+/*
+===============
+R_OcclusionSetupView
+
+Called after the view matrices were set up. Prints the stats of the previous frame and
+remembers the view occlusion_depth.comp will record the depth of.
+===============
+*/
+void R_OcclusionSetupView (void)
+{
+	if (r_occlusionstats.value)
+	{
+		Con_Printf (
+			"%4u/%4u leafs %4u/%4u entities occluded\n", Atomic_LoadUInt32 (&occlusion_leafs_culled), Atomic_LoadUInt32 (&occlusion_leafs_tested),
+			Atomic_LoadUInt32 (&occlusion_entities_culled), Atomic_LoadUInt32 (&occlusion_entities_tested));
+		Atomic_StoreUInt32 (&occlusion_leafs_tested, 0u);
+		Atomic_StoreUInt32 (&occlusion_leafs_culled, 0u);
+		Atomic_StoreUInt32 (&occlusion_entities_tested, 0u);
+		Atomic_StoreUInt32 (&occlusion_entities_culled, 0u);
+	}
+
+	vec3_t view_move;
+	VectorSubtract (r_refdef.vieworg, occlusion_test_view.origin, view_move);
+	if (VectorLength (view_move) > OCCLUSION_MAX_VIEW_MOVE)
+		occlusion_test_valid = false;
+
+	occlusion_view_t *view = &occlusion_views[occlusion_slot];
+	memcpy (view->view_projection_matrix, vulkan_globals.view_projection_matrix, sizeof (view->view_projection_matrix));
+	VectorCopy (r_refdef.vieworg, view->origin);
+	view->x = r_refdef.vrect.x * render_resolution;
+	view->y = r_refdef.vrect.y * render_resolution;
+	view->width = q_max (1, (int)(r_refdef.vrect.width * render_resolution));
+	view->height = q_max (1, (int)(r_refdef.vrect.height * render_resolution));
+	view->pending = true;
+	view->written = false;
+}
+
+/*
+===============
+R_OcclusionPendingDispatch
+
+Fills the occlusion_depth.comp push constants if the view of cb_index needs its depth
+reduced this frame.
+===============
+*/
+qboolean R_OcclusionPendingDispatch (int cb_index, uint32_t push_constants[6])
+{
+	occlusion_view_t *view = &occlusion_views[cb_index];
+	if (!view->pending)
+		return false;
+
+	view->pending = false;
+	view->written = true;
+	push_constants[0] = view->x;
+	push_constants[1] = view->y;
+	push_constants[2] = view->width;
+	push_constants[3] = view->height;
+	push_constants[4] = cb_index * OCCLUSION_GRID_WIDTH * OCCLUSION_GRID_HEIGHT;
+	push_constants[5] = vulkan_globals.sample_count;
+	return true;
+}
+
+/*
+===============
+R_OccludedBox
+===============
+*/
+qboolean R_OccludedBox (const vec3_t mins, const vec3_t maxs, qboolean entity)
+{
+	if (!occlusion_test_valid)
+		return false;
+
+	if (r_occlusionstats.value)
+		Atomic_IncrementUInt32 (entity ? &occlusion_entities_tested : &occlusion_leafs_tested);
+
+	const float *m = occlusion_test_view.view_projection_matrix;
+	float		 min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+	float		 nearest = 0.0f;
+	for (int i = 0; i < 8; ++i)
+	{
+		const float x = (i & 1) ? maxs[0] : mins[0];
+		const float y = (i & 2) ? maxs[1] : mins[1];
+		const float z = (i & 4) ? maxs[2] : mins[2];
+		const float clip_w = m[3] * x + m[7] * y + m[11] * z + m[15];
+		if (clip_w <= 0.0f)
+			return false; // behind the old view
+		const float inv_w = 1.0f / clip_w;
+		const float ndc_x = (m[0] * x + m[4] * y + m[8] * z + m[12]) * inv_w;
+		const float ndc_y = (m[1] * x + m[5] * y + m[9] * z + m[13]) * inv_w;
+		const float depth = (m[2] * x + m[6] * y + m[10] * z + m[14]) * inv_w;
+		min_x = q_min (min_x, ndc_x);
+		max_x = q_max (max_x, ndc_x);
+		min_y = q_min (min_y, ndc_y);
+		max_y = q_max (max_y, ndc_y);
+		nearest = q_max (nearest, depth);
+	}
+
+	// Grid cells, widened by a pixel to cover the integer tile bounds of the shader
+	const float pixel_x = 2.0f / q_max (occlusion_test_view.width, 1);
+	const float pixel_y = 2.0f / q_max (occlusion_test_view.height, 1);
+	const int	cell_x0 = (int)floorf ((min_x - pixel_x) * 0.5f * OCCLUSION_GRID_WIDTH + 0.5f * OCCLUSION_GRID_WIDTH);
+	const int	cell_x1 = (int)floorf ((max_x + pixel_x) * 0.5f * OCCLUSION_GRID_WIDTH + 0.5f * OCCLUSION_GRID_WIDTH);
+	const int	cell_y0 = (int)floorf ((min_y - pixel_y) * 0.5f * OCCLUSION_GRID_HEIGHT + 0.5f * OCCLUSION_GRID_HEIGHT);
+	const int	cell_y1 = (int)floorf ((max_y + pixel_y) * 0.5f * OCCLUSION_GRID_HEIGHT + 0.5f * OCCLUSION_GRID_HEIGHT);
+	if (cell_x0 < 0 || cell_y0 < 0 || cell_x1 >= OCCLUSION_GRID_WIDTH || cell_y1 >= OCCLUSION_GRID_HEIGHT)
+		return false; // not entirely inside the old view
+
+	for (int cell_y = cell_y0; cell_y <= cell_y1; ++cell_y)
+	{
+		const float *row = &occlusion_grid[cell_y * OCCLUSION_GRID_WIDTH];
+		for (int cell_x = cell_x0; cell_x <= cell_x1; ++cell_x)
+			if (nearest >= row[cell_x])
+				return false;
+	}
+
+	if (r_occlusionstats.value)
+		Atomic_IncrementUInt32 (entity ? &occlusion_entities_culled : &occlusion_leafs_culled);
+	return true;
+}
@@ -35,7 +35,45 @@ static const int ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 static const int ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 static const int ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
-static particle_t *active_particles, *free_particles, *particles;
+// Live particles as structure of arrays so R_UpdateParticles can step 4 at a time. [0, num_particles) is in use,
+// removal swaps the last particle in. Arrays are padded to a multiple of 4.
+typedef struct
+{
+	int	   num_particles;
+	int	   num_simulated; // particles appended by R_PrepareParticles are drawn once before their first step
+	float *org[3];
+	float *vel[3];
+	float *die;
+	float *ramp;
+	float *ramp_rate;		// per second
+	float *ramp_limit;		// dies when ramp reaches it
+	float *horizontal_rate;	// vel[0,1] += vel[0,1] * rate * frametime
+	float *vertical_rate;	// vel[2] += vel[2] * rate * frametime
+	float *gravity_scale;	// vel[2] += gravity * scale * frametime
+	byte  *color;
+	byte  *type;
+} particlepool_t;
+
+static particlepool_t particle_pool;
+
+// Spawned since the last R_PrepareParticles, the spawn functions still fill a particle_t
+static particle_t *spawned_particles;
+static int		   num_spawned_particles;
+
+static double particle_update_time;
+static float  particle_frametime;
+
+// Indexed by ptype_t: horizontal rate, vertical rate, gravity scale, ramp rate, ramp limit
+static const float particle_type_constants[8][5] = {
+	{0.0f, 0.0f, 0.0f, 0.0f, FLT_MAX},	 // pt_static
+	{0.0f, 0.0f, -1.0f, 0.0f, FLT_MAX},	 // pt_grav
+	{0.0f, 0.0f, -1.0f, 0.0f, FLT_MAX},	 // pt_slowgrav
+	{0.0f, 0.0f, 1.0f, 5.0f, 6.0f},		 // pt_fire
+	{4.0f, 4.0f, -1.0f, 10.0f, 8.0f},	 // pt_explode
+	{-1.0f, -1.0f, -1.0f, 15.0f, 8.0f},	 // pt_explode2
+	{4.0f, 4.0f, -1.0f, 0.0f, FLT_MAX},	 // pt_blob
+	{-4.0f, 0.0f, -1.0f, 0.0f, FLT_MAX}, // pt_blob2
+};
 
 // beware: different from the r_part_fte.c r_numparticles one, this is for classic particles,
 // set by "-particles" command line.
@@ -46,11 +84,46 @@ static float texturescalefactor; // johnfitz -- compensate for apparent size of
 
 cvar_t		  r_particles = {"r_particles", "1", CVAR_ARCHIVE};			// johnfitz
 static cvar_t r_quadparticles = {"r_quadparticles", "1", CVAR_ARCHIVE}; // johnfitz
+static cvar_t r_gpuparticles = {"r_gpuparticles", "1", CVAR_ARCHIVE};
 
 extern cvar_t r_showtris;
 
 static VkBuffer particle_index_buffer;
 
+// Particles evaluated by particles_gpu.vert. Spawned particles are moved from the linked list into
+// a ring of spawn states once per frame, the vertex shader integrates them in closed form.
+typedef struct gpuparticle_s
+{
+	float	 org[3];
+	float	 spawn_time; // relative to particle_ring_time_base
+	float	 vel[3];
+	float	 die; // relative to particle_ring_time_base
+	uint32_t color;
+	uint32_t type;
+	float	 ramp;
+	float	 padding;
+} gpuparticle_t;
+
+typedef struct
+{
+	float	 up[3];
+	float	 texcoord_scale;
+	float	 right[3];
+	float	 time;
+	float	 origin[3];
+	float	 gravity;
+	float	 forward[3];
+	float	 scale_factor;
+	uint32_t ramp_colors[24];
+	uint32_t quads;
+} gpuparticleubo_t;
+
+static VkBuffer particle_ring_buffer;
+static int		particle_ring_head;
+static int		particle_ring_used;
+static double	particle_ring_time_base;
+static double	particle_ring_max_die;
+
 /*
 ===============
 R_ParticleTextureLookup -- johnfitz -- generate nice antialiased 32x32 circle for particles
@@ -220,6 +293,50 @@ void R_InitParticleIndexBuffer (void)
 	R_StagingEndCopy ();
 }
 
+/*
+===============
+R_InitParticleRingBuffer
+===============
+*/
+static void R_InitParticleRingBuffer (void)
+{
+	VkResult err;
+
+	ZEROED_STRUCT (VkBufferCreateInfo, buffer_create_info);
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size = r_numparticles * sizeof (gpuparticle_t);
+	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	err = vkCreateBuffer (vulkan_globals.device, &buffer_create_info, NULL, &particle_ring_buffer);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkCreateBuffer failed");
+
+	GL_SetObjectName ((uint64_t)particle_ring_buffer, VK_OBJECT_TYPE_BUFFER, "Particle ring buffer");
+
+	VkMemoryRequirements memory_requirements;
+	vkGetBufferMemoryRequirements (vulkan_globals.device, particle_ring_buffer, &memory_requirements);
+
+	const int aligned_size = q_align (memory_requirements.size, memory_requirements.alignment);
+
+	ZEROED_STRUCT (VkMemoryAllocateInfo, memory_allocate_info);
+	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.allocationSize = aligned_size;
+	memory_allocate_info.memoryTypeIndex = GL_MemoryTypeFromProperties (memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+
+	Atomic_IncrementUInt32 (&num_vulkan_dynbuf_allocations);
+	VkDeviceMemory particle_ring_buffer_memory;
+	Atomic_AddUInt64 (&total_device_vulkan_allocation_size, memory_requirements.size);
+	err = vkAllocateMemory (vulkan_globals.device, &memory_allocate_info, NULL, &particle_ring_buffer_memory);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkAllocateMemory failed");
+
+	GL_SetObjectName ((uint64_t)particle_ring_buffer_memory, VK_OBJECT_TYPE_DEVICE_MEMORY, "Particle ring buffer");
+
+	err = vkBindBufferMemory (vulkan_globals.device, particle_ring_buffer, particle_ring_buffer_memory, 0);
+	if (err != VK_SUCCESS)
+		Sys_Error ("vkBindBufferMemory failed");
+}
+
 /*
 ===============
 R_InitParticles
@@ -242,14 +359,48 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)Mem_Alloc (r_numparticles * sizeof (particle_t));
+	const int pool_size = q_align (r_numparticles, 4);
+	for (i = 0; i < 3; ++i)
+	{
+		particle_pool.org[i] = (float *)Mem_Alloc (pool_size * sizeof (float));
+		particle_pool.vel[i] = (float *)Mem_Alloc (pool_size * sizeof (float));
+	}
+	particle_pool.die = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.ramp = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.ramp_rate = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.ramp_limit = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.horizontal_rate = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.vertical_rate = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.gravity_scale = (float *)Mem_Alloc (pool_size * sizeof (float));
+	particle_pool.color = (byte *)Mem_Alloc (pool_size);
+	particle_pool.type = (byte *)Mem_Alloc (pool_size);
+	spawned_particles = (particle_t *)Mem_Alloc (r_numparticles * sizeof (particle_t));
 
 	Cvar_RegisterVariable (&r_particles); // johnfitz
 	Cvar_SetCallback (&r_particles, R_SetParticleTexture_f);
 	Cvar_RegisterVariable (&r_quadparticles); // johnfitz
+	Cvar_RegisterVariable (&r_gpuparticles);
 
 	R_InitParticleTextures (); // johnfitz
 	R_InitParticleIndexBuffer ();
+	R_InitParticleRingBuffer ();
+}
+
+/*
+===============
+R_AllocParticle
+
+Queues a particle for R_PrepareParticles, NULL once the pool is full
+===============
+*/
+static particle_t *R_AllocParticle (void)
+{
+	if ((particle_pool.num_particles + num_spawned_particles) >= r_numparticles)
+		return NULL;
+
+	particle_t *p = &spawned_particles[num_spawned_particles++];
+	memset (p, 0, sizeof (particle_t));
+	return p;
 }
 
 /*
@@ -305,12 +456,9 @@ void R_EntityParticles (entity_t *ent)
 		forward[1] = cp * sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 0.01;
 		p->color = 0x6f;
@@ -329,14 +477,15 @@ R_ClearParticles
 */
 void R_ClearParticles (void)
 {
-	int i;
-
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i = 0; i < r_numparticles; i++)
-		particles[i].next = &particles[i + 1];
-	particles[r_numparticles - 1].next = NULL;
+	particle_pool.num_particles = 0;
+	particle_pool.num_simulated = 0;
+	num_spawned_particles = 0;
+	particle_update_time = cl.time;
+
+	particle_ring_head = 0;
+	particle_ring_used = 0;
+	particle_ring_time_base = cl.time;
+	particle_ring_max_die = -1.0;
 }
 
 /*
@@ -375,15 +524,12 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = 99999;
 		p->color = (-c) & 15;
@@ -435,12 +581,9 @@ void R_ParticleExplosion (vec3_t org)
 
 	for (i = 0; i < 1024; i++)
 	{
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 5;
 		p->color = ramp1[0];
@@ -479,12 +622,9 @@ void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 
 	for (i = 0; i < 512; i++)
 	{
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 0.3;
 		p->color = colorStart + (colorMod % colorLength);
@@ -511,12 +651,9 @@ void R_BlobExplosion (vec3_t org)
 
 	for (i = 0; i < 1024; i++)
 	{
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 1 + (COM_Rand () & 8) * 0.05;
 
@@ -555,12 +692,9 @@ void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		if (count == 1024)
 		{ // rocket explosion
@@ -616,12 +750,9 @@ void R_LavaSplash (vec3_t org)
 		for (j = -16; j < 16; j++)
 			for (k = 0; k < 1; k++)
 			{
-				if (!free_particles)
+				p = R_AllocParticle ();
+				if (!p)
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
 
 				p->die = cl.time + 2 + (COM_Rand () & 31) * 0.02;
 				p->color = 224 + (COM_Rand () & 7);
@@ -657,12 +788,9 @@ void R_TeleportSplash (vec3_t org)
 		for (j = -16; j < 16; j += 4)
 			for (k = -24; k < 32; k += 4)
 			{
-				if (!free_particles)
+				p = R_AllocParticle ();
+				if (!p)
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
 
 				p->die = cl.time + 0.2 + (COM_Rand () & 7) * 0.02;
 				p->color = 7 + (COM_Rand () & 7);
@@ -712,12 +840,9 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		p = R_AllocParticle ();
+		if (!p)
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		VectorCopy (vec3_origin, p->vel);
 		p->die = cl.time + 2;
@@ -794,107 +919,164 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 
 /*
 ===============
-CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+R_RemoveParticle
 ===============
 */
-void CL_RunParticles (void)
+static void R_RemoveParticle (int i)
 {
-	particle_t	 *p, *kill;
-	int			  i;
-	float		  time1, time2, time3, dvel, frametime, grav;
-	extern cvar_t sv_gravity;
-
-	frametime = q_max (0.0, cl.time - cl.oldtime);
-	time3 = frametime * 15;
-	time2 = frametime * 10;
-	time1 = frametime * 5;
-	grav = frametime * sv_gravity.value * 0.05;
-	dvel = 4 * frametime;
+	particlepool_t *pool = &particle_pool;
+	const int		last = --pool->num_particles;
 
-	for (;;)
+	for (int j = 0; j < 3; ++j)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
-		}
-		break;
+		pool->org[j][i] = pool->org[j][last];
+		pool->vel[j][i] = pool->vel[j][last];
 	}
+	pool->die[i] = pool->die[last];
+	pool->ramp[i] = pool->ramp[last];
+	pool->ramp_rate[i] = pool->ramp_rate[last];
+	pool->ramp_limit[i] = pool->ramp_limit[last];
+	pool->horizontal_rate[i] = pool->horizontal_rate[last];
+	pool->vertical_rate[i] = pool->vertical_rate[last];
+	pool->gravity_scale[i] = pool->gravity_scale[last];
+	pool->color[i] = pool->color[last];
+	pool->type[i] = pool->type[last];
+}
 
-	for (p = active_particles; p; p = p->next)
+/*
+===============
+R_PrepareParticles -- removes dead particles and appends the spawned ones, runs before R_UpdateParticles
+===============
+*/
+void R_PrepareParticles (void *unused)
+{
+	particlepool_t *pool = &particle_pool;
+
+	particle_frametime = q_max (0.0, cl.time - particle_update_time);
+	particle_update_time = cl.time;
+
+	for (int i = 0; i < pool->num_particles;)
 	{
-		for (;;)
-		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
-		}
+		if (pool->die[i] < cl.time)
+			R_RemoveParticle (i);
+		else
+			++i;
+	}
 
-		p->org[0] += p->vel[0] * frametime;
-		p->org[1] += p->vel[1] * frametime;
-		p->org[2] += p->vel[2] * frametime;
+	pool->num_simulated = pool->num_particles;
+	for (int i = 0; i < num_spawned_particles; ++i)
+	{
+		const particle_t *p = &spawned_particles[i];
+		const float		 *constants = particle_type_constants[p->type];
+		const int		  j = pool->num_particles++;
 
-		switch (p->type)
+		for (int k = 0; k < 3; ++k)
 		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
+			pool->org[k][j] = p->org[k];
+			pool->vel[k][j] = p->vel[k];
+		}
+		pool->die[j] = p->die;
+		pool->ramp[j] = p->ramp;
+		pool->horizontal_rate[j] = constants[0];
+		pool->vertical_rate[j] = constants[1];
+		pool->gravity_scale[j] = constants[2];
+		pool->ramp_rate[j] = constants[3];
+		pool->ramp_limit[j] = constants[4];
+		pool->color[j] = (byte)p->color;
+		pool->type[j] = p->type;
+	}
+	num_spawned_particles = 0;
+}
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+/*
+===============
+R_UpdateParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
-			break;
+Steps one slice of the pool, indexed [0, NUM_PARTICLE_UPDATE_TASKS)
+===============
+*/
+void R_UpdateParticles (int index, void *unused)
+{
+	extern cvar_t	sv_gravity;
+	particlepool_t *pool = &particle_pool;
 
-		case pt_blob:
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	// the GPU path integrates particles in closed form from their spawn state
+	if (r_gpuparticles.value)
+		return;
 
-		case pt_blob2:
-			for (i = 0; i < 2; i++)
-				p->vel[i] -= p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	const int	slice_size = q_align ((pool->num_simulated + NUM_PARTICLE_UPDATE_TASKS - 1) / NUM_PARTICLE_UPDATE_TASKS, 4);
+	const int	start = index * slice_size;
+	const int	end = q_min (start + slice_size, q_align (pool->num_simulated, 4));
+	const float frametime = particle_frametime;
+	const float grav = frametime * sv_gravity.value * 0.05f;
+
+	// Slices are rounded up to a multiple of 4, stepping the padding or a particle appended this frame is harmless
+#if defined(USE_SSE2)
+	const __m128 dt = _mm_set1_ps (frametime);
+	const __m128 g = _mm_set1_ps (grav);
+	const __m128 dead = _mm_set1_ps (-1.0f);
+	for (int i = start; i < end; i += 4)
+	{
+		__m128 vx = _mm_loadu_ps (pool->vel[0] + i);
+		__m128 vy = _mm_loadu_ps (pool->vel[1] + i);
+		__m128 vz = _mm_loadu_ps (pool->vel[2] + i);
+
+		_mm_storeu_ps (pool->org[0] + i, _mm_add_ps (_mm_loadu_ps (pool->org[0] + i), _mm_mul_ps (vx, dt)));
+		_mm_storeu_ps (pool->org[1] + i, _mm_add_ps (_mm_loadu_ps (pool->org[1] + i), _mm_mul_ps (vy, dt)));
+		_mm_storeu_ps (pool->org[2] + i, _mm_add_ps (_mm_loadu_ps (pool->org[2] + i), _mm_mul_ps (vz, dt)));
+
+		const __m128 horizontal = _mm_mul_ps (_mm_loadu_ps (pool->horizontal_rate + i), dt);
+		const __m128 vertical = _mm_mul_ps (_mm_loadu_ps (pool->vertical_rate + i), dt);
+		vx = _mm_add_ps (vx, _mm_mul_ps (vx, horizontal));
+		vy = _mm_add_ps (vy, _mm_mul_ps (vy, horizontal));
+		vz = _mm_add_ps (vz, _mm_mul_ps (vz, vertical));
+		vz = _mm_add_ps (vz, _mm_mul_ps (_mm_loadu_ps (pool->gravity_scale + i), g));
+		_mm_storeu_ps (pool->vel[0] + i, vx);
+		_mm_storeu_ps (pool->vel[1] + i, vy);
+		_mm_storeu_ps (pool->vel[2] + i, vz);
+
+		const __m128 ramp = _mm_add_ps (_mm_loadu_ps (pool->ramp + i), _mm_mul_ps (_mm_loadu_ps (pool->ramp_rate + i), dt));
+		const __m128 ramp_done = _mm_cmpge_ps (ramp, _mm_loadu_ps (pool->ramp_limit + i));
+		const __m128 die = _mm_or_ps (_mm_and_ps (ramp_done, dead), _mm_andnot_ps (ramp_done, _mm_loadu_ps (pool->die + i)));
+		_mm_storeu_ps (pool->ramp + i, ramp);
+		_mm_storeu_ps (pool->die + i, die);
+	}
+#else
+	for (int i = start; i < end; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			pool->org[j][i] += pool->vel[j][i] * frametime;
+
+		const float horizontal = pool->horizontal_rate[i] * frametime;
+		pool->vel[0][i] += pool->vel[0][i] * horizontal;
+		pool->vel[1][i] += pool->vel[1][i] * horizontal;
+		pool->vel[2][i] += pool->vel[2][i] * pool->vertical_rate[i] * frametime;
+		pool->vel[2][i] += pool->gravity_scale[i] * grav;
+
+		pool->ramp[i] += pool->ramp_rate[i] * frametime;
+		if (pool->ramp[i] >= pool->ramp_limit[i])
+			pool->die[i] = -1;
+	}
+#endif
+}
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
-		}
+/*
+===============
+R_ParticleColor -- palette index, ramped types derive it from their ramp
+===============
+*/
+static inline int R_ParticleColor (int i)
+{
+	switch (particle_pool.type[i])
+	{
+	case pt_fire:
+		return ramp3[(int)particle_pool.ramp[i]];
+	case pt_explode:
+		return ramp1[(int)particle_pool.ramp[i]];
+	case pt_explode2:
+		return ramp2[(int)particle_pool.ramp[i]];
+	default:
+		return particle_pool.color[i];
 	}
 }
 
@@ -905,17 +1087,14 @@ R_DrawParticlesFaces
 */
 static void R_DrawParticlesFaces (cb_context_t *cbx)
 {
-	particle_t	 *p;
-	float		  scale, texcoord_scale;
-	vec3_t		  up, right, up_right, p_up, p_right, p_up_right;
-	extern cvar_t r_particles; // johnfitz
+	particlepool_t *pool = &particle_pool;
+	float			scale, texcoord_scale;
+	vec3_t			org, up, right, up_right, p_up, p_right, p_up_right;
+	extern cvar_t	r_particles; // johnfitz
 
 	if (!r_particles.value)
 		return;
 
-	if (!active_particles)
-		return;
-
 	if (r_quadparticles.value)
 	{
 		VectorScale (vup, 0.75, up);
@@ -932,9 +1111,13 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 	for (int i = 0; i < 3; ++i)
 		up_right[i] = up[i] + right[i];
 
+	// particles whose ramp ran out in R_UpdateParticles are only removed next frame
 	int num_particles = 0;
-	for (p = active_particles; p; p = p->next)
-		num_particles += 1;
+	for (int i = 0; i < pool->num_particles; ++i)
+		if (pool->die[i] >= cl.time)
+			num_particles += 1;
+	if (!num_particles)
+		return;
 	Atomic_AddUInt32 (&rs_particles, num_particles);
 
 	VkBuffer	   vertex_buffer;
@@ -946,10 +1129,17 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 		vertices = (basicvertex_t *)R_VertexAllocate (num_particles * 3 * sizeof (basicvertex_t), &vertex_buffer, &vertex_buffer_offset);
 
 	int current_vertex = 0;
-	for (p = active_particles; p; p = p->next)
+	for (int i = 0; i < pool->num_particles; ++i)
 	{
+		if (pool->die[i] < cl.time)
+			continue;
+
+		org[0] = pool->org[0][i];
+		org[1] = pool->org[1][i];
+		org[2] = pool->org[2][i];
+
 		// hack a scale up to keep particles from disapearing
-		scale = (p->org[0] - r_origin[0]) * vpn[0] + (p->org[1] - r_origin[1]) * vpn[1] + (p->org[2] - r_origin[2]) * vpn[2];
+		scale = (org[0] - r_origin[0]) * vpn[0] + (org[1] - r_origin[1]) * vpn[1] + (org[2] - r_origin[2]) * vpn[2];
 		if (scale < 20)
 			scale = 1 + 0.08; // johnfitz -- added .08 to be consistent
 		else
@@ -957,11 +1147,11 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 
 		scale *= texturescalefactor; // johnfitz -- compensate for apparent size of different particle textures
 
-		byte *c = (byte *)&d_8to24table[(int)p->color];
+		byte *c = (byte *)&d_8to24table[R_ParticleColor (i)];
 
-		vertices[current_vertex].position[0] = p->org[0];
-		vertices[current_vertex].position[1] = p->org[1];
-		vertices[current_vertex].position[2] = p->org[2];
+		vertices[current_vertex].position[0] = org[0];
+		vertices[current_vertex].position[1] = org[1];
+		vertices[current_vertex].position[2] = org[2];
 		vertices[current_vertex].texcoord[0] = 0.0f;
 		vertices[current_vertex].texcoord[1] = 0.0f;
 		vertices[current_vertex].color[0] = c[0];
@@ -970,7 +1160,7 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 		vertices[current_vertex].color[3] = 255;
 		current_vertex++;
 
-		VectorMA (p->org, scale, up, p_up);
+		VectorMA (org, scale, up, p_up);
 		vertices[current_vertex].position[0] = p_up[0];
 		vertices[current_vertex].position[1] = p_up[1];
 		vertices[current_vertex].position[2] = p_up[2];
@@ -984,7 +1174,7 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 
 		if (r_quadparticles.value)
 		{
-			VectorMA (p->org, scale, up_right, p_up_right);
+			VectorMA (org, scale, up_right, p_up_right);
 			vertices[current_vertex].position[0] = p_up_right[0];
 			vertices[current_vertex].position[1] = p_up_right[1];
 			vertices[current_vertex].position[2] = p_up_right[2];
@@ -997,7 +1187,7 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 			current_vertex++;
 		}
 
-		VectorMA (p->org, scale, right, p_right);
+		VectorMA (org, scale, right, p_right);
 		vertices[current_vertex].position[0] = p_right[0];
 		vertices[current_vertex].position[1] = p_right[1];
 		vertices[current_vertex].position[2] = p_right[2];
@@ -1022,12 +1212,141 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 
 /*
 ===============
-R_DrawParticles -- johnfitz -- moved all non-drawing code to CL_RunParticles
+R_UploadGPUParticles
+
+Moves all live particles of the pool to the ring, overwriting the oldest ones once it is full
+===============
+*/
+static void R_UploadGPUParticles (void)
+{
+	particlepool_t *pool = &particle_pool;
+	int				num_particles = 0;
+
+	for (int i = 0; i < pool->num_particles; ++i)
+		if (pool->die[i] >= cl.time)
+			num_particles += 1;
+
+	if (num_particles > 0)
+	{
+		VkBuffer		staging_buffer;
+		VkCommandBuffer command_buffer;
+		int				staging_offset;
+		gpuparticle_t  *staging_particles =
+			(gpuparticle_t *)R_StagingAllocate (num_particles * sizeof (gpuparticle_t), 16, &command_buffer, &staging_buffer, &staging_offset);
+
+		// The overwritten slots may still be read by the previous frame
+		vkCmdPipelineBarrier (command_buffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0, NULL);
+
+		const int	 num_before_wrap = q_min (num_particles, r_numparticles - particle_ring_head);
+		VkBufferCopy regions[2];
+		regions[0].srcOffset = staging_offset;
+		regions[0].dstOffset = particle_ring_head * sizeof (gpuparticle_t);
+		regions[0].size = num_before_wrap * sizeof (gpuparticle_t);
+		regions[1].srcOffset = staging_offset + num_before_wrap * sizeof (gpuparticle_t);
+		regions[1].dstOffset = 0;
+		regions[1].size = (num_particles - num_before_wrap) * sizeof (gpuparticle_t);
+		vkCmdCopyBuffer (command_buffer, staging_buffer, particle_ring_buffer, (num_particles > num_before_wrap) ? 2 : 1, regions);
+
+		R_StagingBeginCopy ();
+		const float spawn_time = cl.time - particle_ring_time_base;
+		int			current_particle = 0;
+		for (int i = 0; i < pool->num_particles; ++i)
+		{
+			if (pool->die[i] < cl.time)
+				continue;
+
+			gpuparticle_t *gpu_particle = &staging_particles[current_particle++];
+			for (int j = 0; j < 3; ++j)
+			{
+				gpu_particle->org[j] = pool->org[j][i];
+				gpu_particle->vel[j] = pool->vel[j][i];
+			}
+			gpu_particle->spawn_time = spawn_time;
+			gpu_particle->die = pool->die[i] - particle_ring_time_base;
+			gpu_particle->color = d_8to24table[R_ParticleColor (i)];
+			((byte *)&gpu_particle->color)[3] = 255;
+			gpu_particle->type = pool->type[i];
+			gpu_particle->ramp = pool->ramp[i];
+			gpu_particle->padding = 0.0f;
+			particle_ring_max_die = q_max (particle_ring_max_die, pool->die[i]);
+		}
+		R_StagingEndCopy ();
+
+		particle_ring_head = (particle_ring_head + num_particles) % r_numparticles;
+		particle_ring_used = q_min (particle_ring_used + num_particles, r_numparticles);
+	}
+
+	pool->num_particles = 0;
+	pool->num_simulated = 0;
+}
+
+/*
+===============
+R_DrawGPUParticles
+===============
+*/
+static void R_DrawGPUParticles (cb_context_t *cbx)
+{
+	extern cvar_t sv_gravity;
+
+	if (!r_particles.value)
+		return;
+
+	// every particle in the ring is dead already
+	if (!particle_ring_used || (particle_ring_max_die < cl.time))
+		return;
+
+	VkBuffer		  uniform_buffer;
+	uint32_t		  uniform_offset;
+	VkDescriptorSet	  ubo_set;
+	gpuparticleubo_t *ubo = (gpuparticleubo_t *)R_UniformAllocate (sizeof (gpuparticleubo_t), &uniform_buffer, &uniform_offset, &ubo_set);
+
+	const float size = r_quadparticles.value ? 0.75f : 1.5f;
+	VectorScale (vup, size, ubo->up);
+	VectorScale (vright, size, ubo->right);
+	VectorCopy (r_origin, ubo->origin);
+	VectorCopy (vpn, ubo->forward);
+	ubo->texcoord_scale = r_quadparticles.value ? 0.5f : 1.0f;
+	ubo->time = cl.time - particle_ring_time_base;
+	ubo->gravity = sv_gravity.value * 0.05f;
+	ubo->scale_factor = texturescalefactor;
+	for (int i = 0; i < 8; ++i)
+	{
+		ubo->ramp_colors[i] = d_8to24table[ramp1[i]];
+		ubo->ramp_colors[8 + i] = d_8to24table[ramp2[i]];
+		ubo->ramp_colors[16 + i] = d_8to24table[ramp3[i]];
+	}
+	ubo->quads = r_quadparticles.value ? 1 : 0;
+
+	// upper bound, dead particles are only culled in the vertex shader
+	Atomic_AddUInt32 (&rs_particles, particle_ring_used);
+
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.particle_gpu_pipeline);
+	VkDescriptorSet descriptor_sets[2] = {particletexture->descriptor_set, ubo_set};
+	vulkan_globals.vk_cmd_bind_descriptor_sets (
+		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.particle_gpu_pipeline.layout.handle, 0, 2, descriptor_sets, 1, &uniform_offset);
+
+	VkDeviceSize ring_buffer_offset = 0;
+	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &particle_ring_buffer, &ring_buffer_offset);
+	vulkan_globals.vk_cmd_draw (cbx->cb, r_quadparticles.value ? 6 : 3, particle_ring_used, 0, 0);
+}
+
+/*
+===============
+R_DrawParticles -- johnfitz -- moved all non-drawing code to R_UpdateParticles
 ===============
 */
 void R_DrawParticles (cb_context_t *cbx)
 {
 	R_BeginDebugUtilsLabel (cbx, "Particles");
+	if (r_gpuparticles.value)
+	{
+		R_UploadGPUParticles ();
+		R_DrawGPUParticles (cbx);
+		R_EndDebugUtilsLabel (cbx);
+		return;
+	}
+
 	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.particle_pipeline);
 	vulkan_globals.vk_cmd_bind_descriptor_sets (
 		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &particletexture->descriptor_set, 0, NULL);
@@ -1043,6 +1362,10 @@ R_DrawParticles_ShowTris -- johnfitz
 */
 void R_DrawParticles_ShowTris (cb_context_t *cbx)
 {
+	// R_DrawParticles moves the pool to the GPU ring concurrently
+	if (r_gpuparticles.value)
+		return;
+
 	if (r_showtris.value == 1)
 		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.showtris_pipeline);
 	else
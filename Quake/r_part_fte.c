@@ -27,6 +27,7 @@ The engine has a few builtins.
 */
 
 #include "quakedef.h"
+#include "q_ctype.h"
 
 cvar_t r_fteparticles = {"r_fteparticles", "1", CVAR_ARCHIVE};
 
@@ -534,9 +535,8 @@ static qboolean Q1BSP_RecursiveHullCheck (hull_t *hull, int num, float p1f, floa
 	struct rhtctx_s ctx;
 	VectorCopy (p1, ctx.start);
 	VectorCopy (p2, ctx.end);
-	ctx.clipnodes = hull->clipnodes;
+	ctx.nodes = hull->packednodes;
 	ctx.hitcontents = CONTENTMASK_FROMQ1 (CONTENTS_SOLID);
-	ctx.planes = hull->planes;
 
 	return Q1BSP_RecursiveHullTrace (&ctx, num, p1f, p2f, p1, p2, trace) != rht_impact;
 }
@@ -632,6 +632,12 @@ static int			numparticletypes;
 static part_type_t *part_type;
 static part_type_t *part_run_list;
 
+// part_type by name, P_ResetToDefaults clears the types so the chains are kept apart.
+// Only the name is hashed, lookups without a namespace walk the types of all configs.
+#define PART_HASH_SIZE 1024
+static int	part_hash[PART_HASH_SIZE];
+static int *part_hashnext;
+
 static struct
 {
 	char *oldn;
@@ -796,6 +802,25 @@ void PScript_UpdateModelEffects (qmodel_t *mod)
 	}
 }
 
+static unsigned int P_HashTypeName (const char *name)
+{
+	unsigned int hash = 0x811c9dc5u;
+	while (*name)
+	{
+		hash ^= (unsigned char)q_tolower (*name++);
+		hash *= 0x01000193u;
+	}
+	return hash & (PART_HASH_SIZE - 1);
+}
+
+static void P_ClearTypeHash (void)
+{
+	for (int i = 0; i < PART_HASH_SIZE; i++)
+		part_hash[i] = P_INVALID;
+	Mem_Free (part_hashnext);
+	part_hashnext = NULL;
+}
+
 static part_type_t *P_GetParticleType (const char *config, const char *name)
 {
 	int			 i;
@@ -819,7 +844,8 @@ static part_type_t *P_GetParticleType (const char *config, const char *name)
 			break;
 		}
 	}
-	for (i = 0; i < numparticletypes; i++)
+	const unsigned int hash = P_HashTypeName (name);
+	for (i = part_hash[hash]; i != P_INVALID; i = part_hashnext[i])
 	{
 		ptype = &part_type[i];
 		if (!q_strcasecmp (ptype->name, name))
@@ -827,6 +853,9 @@ static part_type_t *P_GetParticleType (const char *config, const char *name)
 				return ptype;
 	}
 	part_type = Mem_Realloc (part_type, sizeof (part_type_t) * (numparticletypes + 1));
+	part_hashnext = Mem_Realloc (part_hashnext, sizeof (int) * (numparticletypes + 1));
+	part_hashnext[numparticletypes] = part_hash[hash];
+	part_hash[hash] = numparticletypes;
 	ptype = &part_type[numparticletypes++];
 	memset (ptype, 0, sizeof (*ptype));
 	q_strlcpy (ptype->name, name, sizeof (ptype->name));
@@ -948,9 +977,10 @@ int PScript_FindParticleType (const char *fullname)
 		}
 	}
 
+	// The chains run from the newest type to the oldest
 	if (*cfg)
 	{ // favour the namespace if one is specified
-		for (i = 0; i < numparticletypes; i++)
+		for (i = part_hash[P_HashTypeName (name)]; i != P_INVALID; i = part_hashnext[i])
 		{
 			if (!q_strcasecmp (part_type[i].name, name))
 			{
@@ -965,15 +995,20 @@ int PScript_FindParticleType (const char *fullname)
 	else
 	{
 		// but be prepared to load it from any namespace if its not got a namespace specified.
-		for (i = 0; i < numparticletypes; i++)
+		// The oldest loaded one wins, or the newest one if none are loaded
+		part_type_t *loaded = NULL;
+		for (i = part_hash[P_HashTypeName (name)]; i != P_INVALID; i = part_hashnext[i])
 		{
 			if (!q_strcasecmp (part_type[i].name, name))
 			{
-				ptype = &part_type[i];
-				if (ptype->loaded) //(mostly) ignore ones that are not currently loaded
-					break;
+				if (!ptype)
+					ptype = &part_type[i];
+				if (part_type[i].loaded) //(mostly) ignore ones that are not currently loaded
+					loaded = &part_type[i];
 			}
 		}
+		if (loaded)
+			ptype = loaded;
 	}
 	if (!ptype || !ptype->loaded)
 	{
@@ -993,7 +1028,7 @@ int PScript_FindParticleType (const char *fullname)
 
 		return P_INVALID;
 	}
-	return i;
+	return ptype - part_type;
 }
 
 static int CheckAssosiation (const char *config, const char *name, int from)
@@ -3151,6 +3186,8 @@ void PScript_InitParticles (void)
 	Cvar_RegisterVariable (&r_part_maxdecals);
 	Cvar_RegisterVariable (&r_lightflicker);
 
+	P_ClearTypeHash ();
+
 	Cmd_AddCommand ("r_partredirect", P_PartRedirect_f);
 
 	// #if _DEBUG
@@ -3209,6 +3246,7 @@ void PScript_Shutdown (void)
 	Mem_Free (part_type);
 	part_type = NULL;
 	part_run_list = NULL;
+	P_ClearTypeHash ();
 
 	Mem_Free (particles);
 	particles = NULL;
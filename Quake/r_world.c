@@ -49,6 +49,32 @@ extern VkBuffer bmodel_vertex_buffer;
 static int		world_texstart[NUM_WORLD_CBX];
 static int		world_texend[NUM_WORLD_CBX];
 
+// Recording cost per surface of every world texture, relative to each other. Learned from
+// how long the R_DrawWorld ranges took against their estimate and kept per map across
+// runs by R_SaveWorldHints, so the ranges start out balanced.
+#define WORLD_HINTS_MAGIC	 ("VKWH")
+#define WORLD_HINTS_VERSION	 1
+#define WORLD_TEX_COST_RATE	 0.05f
+#define WORLD_TEX_COST_MIN	 0.1f
+#define WORLD_TEX_COST_MAX	 10.0f
+#define WORLD_TEX_COST_WRITE 0.01f // change since the load that is worth a write
+
+typedef struct
+{
+	char	 magic[4];
+	uint32_t version;
+	uint32_t bsp_checksum;
+	uint32_t num_textures;
+} world_hints_header_t;
+
+static float	*world_tex_costs;
+static int		 world_tex_costs_count;
+static float	 world_tex_costs_change;
+static uint32_t	 world_hints_checksum;
+static char		 world_hints_map[MAX_QPATH];
+static float	 world_cbx_loads[NUM_WORLD_CBX]; // estimate of every range of the frame
+static uint64_t	 world_cbx_ticks[NUM_WORLD_CBX]; // measured by R_DrawWorld
+
 /*
 ===============
 mark_surfaces_state_t
@@ -143,17 +169,145 @@ static inline qboolean R_BackFaceCull (msurface_t *surf)
 	return false;
 }
 
+/*
+===============
+R_WorldHintsPath
+===============
+*/
+static void R_WorldHintsPath (const char *map, char *path, size_t path_size)
+{
+	q_snprintf (path, path_size, "%s/worldhints/%s.cache", host_parms->userdir, map);
+}
+
+/*
+===============
+R_SaveWorldHints
+
+Writes the learned costs of the current map if they moved since they were loaded
+===============
+*/
+void R_SaveWorldHints (void)
+{
+	if (!world_tex_costs || !world_hints_map[0] || world_tex_costs_change < WORLD_TEX_COST_WRITE)
+		return;
+
+	world_hints_header_t header;
+	memcpy (header.magic, WORLD_HINTS_MAGIC, sizeof (header.magic));
+	header.version = WORLD_HINTS_VERSION;
+	header.bsp_checksum = world_hints_checksum;
+	header.num_textures = world_tex_costs_count;
+
+	char path[MAX_OSPATH];
+	R_WorldHintsPath (world_hints_map, path, sizeof (path));
+	COM_CreatePath (path);
+	FILE *f = fopen (path, "wb");
+	if (!f)
+		return;
+	fwrite (&header, sizeof (header), 1, f);
+	fwrite (world_tex_costs, sizeof (float), world_tex_costs_count, f);
+	if (fclose (f) == 0)
+		world_tex_costs_change = 0.0f;
+}
+
+/*
+===============
+R_LoadWorldHints
+
+Starts the costs of the new map from the last run, or even
+===============
+*/
+void R_LoadWorldHints (void)
+{
+	SAFE_FREE (world_tex_costs);
+	world_tex_costs_count = cl.worldmodel->numtextures;
+	world_tex_costs_change = 0.0f;
+	world_tex_costs = Mem_AllocNonZero (q_max (world_tex_costs_count, 1) * sizeof (float));
+	for (int i = 0; i < world_tex_costs_count; ++i)
+		world_tex_costs[i] = 1.0f;
+	memset (world_cbx_loads, 0, sizeof (world_cbx_loads));
+	memset (world_cbx_ticks, 0, sizeof (world_cbx_ticks));
+
+	world_hints_checksum = cl.worldmodel->bsp_checksum;
+	COM_FileBase (cl.worldmodel->name, world_hints_map, sizeof (world_hints_map));
+	if (world_hints_checksum == 0)
+	{
+		world_hints_map[0] = 0; // can't tell versions of the map apart
+		return;
+	}
+
+	char path[MAX_OSPATH];
+	R_WorldHintsPath (world_hints_map, path, sizeof (path));
+	world_hints_header_t header;
+	FILE				*f = fopen (path, "rb");
+	qboolean			 valid = f && (fread (&header, sizeof (header), 1, f) == 1);
+	valid = valid && !memcmp (header.magic, WORLD_HINTS_MAGIC, sizeof (header.magic)) && (header.version == WORLD_HINTS_VERSION);
+	valid = valid && (header.bsp_checksum == world_hints_checksum) && (header.num_textures == (uint32_t)world_tex_costs_count);
+	TEMP_ALLOC (float, costs, q_max (world_tex_costs_count, 1));
+	valid = valid && (fread (costs, sizeof (float), world_tex_costs_count, f) == (size_t)world_tex_costs_count);
+	if (f)
+		fclose (f);
+	for (int i = 0; valid && i < world_tex_costs_count; ++i)
+		valid = (costs[i] >= WORLD_TEX_COST_MIN) && (costs[i] <= WORLD_TEX_COST_MAX);
+	if (valid)
+	{
+		memcpy (world_tex_costs, costs, world_tex_costs_count * sizeof (float));
+		Con_DPrintf ("Loaded world hints %s\n", path);
+	}
+	TEMP_FREE (costs);
+}
+
+/*
+===============
+R_UpdateWorldTexCosts
+
+Moves the costs of the textures of every range of the last frame towards what it took
+compared to the others
+===============
+*/
+static void R_UpdateWorldTexCosts (void)
+{
+	double total_load = 0.0;
+	double total_ticks = 0.0;
+	for (int i = 0; i < NUM_WORLD_CBX; ++i)
+	{
+		total_load += world_cbx_loads[i];
+		total_ticks += world_cbx_ticks[i];
+	}
+	if (total_load > 0.0 && total_ticks > 0.0)
+	{
+		const double ticks_per_load = total_ticks / total_load;
+		for (int i = 0; i < NUM_WORLD_CBX; ++i)
+		{
+			if (world_cbx_loads[i] <= 0.0f || world_cbx_ticks[i] == 0)
+				continue;
+			const float error = (float)(world_cbx_ticks[i] / (world_cbx_loads[i] * ticks_per_load)); // > 1 if slower than estimated
+			const float rate = 1.0f + WORLD_TEX_COST_RATE * (error - 1.0f);
+			world_tex_costs_change += fabsf (rate - 1.0f);
+			for (int j = world_texstart[i]; j < q_min (world_texend[i], world_tex_costs_count); ++j)
+				world_tex_costs[j] = CLAMP (WORLD_TEX_COST_MIN, world_tex_costs[j] * rate, WORLD_TEX_COST_MAX);
+		}
+	}
+	memset (world_cbx_loads, 0, sizeof (world_cbx_loads));
+	memset (world_cbx_ticks, 0, sizeof (world_cbx_ticks));
+}
+
 /*
 ===============
 R_SetupWorldCBXTexRanges
+
+Splits the world textures into NUM_WORLD_CBX ranges of about the same estimated cost
 ===============
 */
 void R_SetupWorldCBXTexRanges (qboolean use_tasks)
 {
+	const int num_textures = cl.worldmodel->numtextures;
+	const int num_costs = world_tex_costs ? world_tex_costs_count : 0;
+	if (use_tasks && num_costs)
+		R_UpdateWorldTexCosts ();
+
 	memset (world_texstart, 0, sizeof (world_texstart));
 	memset (world_texend, 0, sizeof (world_texend));
 
-	const int num_textures = cl.worldmodel->numtextures;
 	if (!use_tasks)
 	{
 		world_texstart[0] = 0;
@@ -161,34 +315,33 @@ void R_SetupWorldCBXTexRanges (qboolean use_tasks)
 		return;
 	}
 
-	int total_world_surfs = 0;
+	float total_world_cost = 0.0f;
 	for (int i = 0; i < num_textures; ++i)
 	{
 		texture_t *t = cl.worldmodel->textures[i];
 		if (!t || !t->texturechains[chain_world] || t->texturechains[chain_world]->flags & (SURF_DRAWTURB | SURF_DRAWTILED))
 			continue;
-		total_world_surfs += t->chain_size[chain_world];
+		total_world_cost += t->chain_size[chain_world] * ((i < num_costs) ? world_tex_costs[i] : 1.0f);
 	}
 
-	const int num_surfs_per_cbx = (total_world_surfs + NUM_WORLD_CBX - 1) / NUM_WORLD_CBX;
-	int		  current_cbx = 0;
-	int		  num_assigned_to_cbx = 0;
+	const float cost_per_cbx = total_world_cost / NUM_WORLD_CBX;
+	int			current_cbx = 0;
+	float		cost_assigned_to_cbx = 0.0f;
 	for (int i = 0; i < num_textures; ++i)
 	{
 		texture_t *t = cl.worldmodel->textures[i];
 		if (!t || !t->texturechains[chain_world] || t->texturechains[chain_world]->flags & (SURF_DRAWTURB | SURF_DRAWTILED))
 			continue;
-		assert (current_cbx < NUM_WORLD_CBX);
+		const float cost = t->chain_size[chain_world] * ((i < num_costs) ? world_tex_costs[i] : 1.0f);
 		world_texend[current_cbx] = i + 1;
-		num_assigned_to_cbx += t->chain_size[chain_world];
-		if (num_assigned_to_cbx >= num_surfs_per_cbx)
+		world_cbx_loads[current_cbx] += cost;
+		cost_assigned_to_cbx += cost;
+		// the last range takes whatever rounding left over
+		if (cost_assigned_to_cbx >= cost_per_cbx && current_cbx < NUM_WORLD_CBX - 1)
 		{
 			current_cbx += 1;
-			if (current_cbx < NUM_WORLD_CBX)
-			{
-				world_texstart[current_cbx] = i + 1;
-			}
-			num_assigned_to_cbx = 0;
+			world_texstart[current_cbx] = i + 1;
+			cost_assigned_to_cbx = 0.0f;
 		}
 	}
 }
@@ -367,6 +520,7 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 	unsigned int numsurfaces = cl.worldmodel->numsurfaces;
 	uint32_t	*vis = (uint32_t *)mark_surfaces_state.vis;
 	uint32_t	*surfvis = (uint32_t *)cl.worldmodel->surfvis;
+	uint32_t	*leafvis = (uint32_t *)cl.worldmodel->leafvis;
 	soa_aabb_t	*leafbounds = cl.worldmodel->soa_leafbounds;
 
 	int current_combined_dep_index = INT_MAX;
@@ -385,10 +539,20 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 			mask &= ~(1u << j);
 
 			mleaf_t *leaf = &cl.worldmodel->leafs[1 + i + j];
+			if (occlusion_cull && R_OccludedBox (leaf->minmaxs, leaf->minmaxs + 3, false))
+				continue;
+
 			if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
 			{
 				unsigned int nummarksurfaces = leaf->nummarksurfaces;
 				int			*marksurfaces = leaf->firstmarksurface;
+				if (indirect_mark)
+				{
+					// indirect_mark.comp marks the rest
+					leafvis[i / 32] |= 1u << j;
+					nummarksurfaces = leaf->numturbmarksurfaces;
+					marksurfaces = leaf->firstturbmarksurface;
+				}
 				for (k = 0; k < nummarksurfaces; ++k)
 				{
 					unsigned int index = marksurfaces[k];
@@ -403,10 +567,11 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 			}
 
 			// add static models
-			if (leaf->efrags)
-				R_StoreEfrags (&leaf->efrags);
+			if (leaf->numstatics)
+				R_MarkLeafStatics (leaf);
 		}
 	}
+	R_StoreStaticEntities ();
 
 	if (indirect)
 		return;
@@ -452,6 +617,7 @@ void R_MarkLeafsSIMD (int index, void *unused)
 	atomic_uint32_t *surfvis = (atomic_uint32_t *)cl.worldmodel->surfvis;
 	soa_aabb_t		*leafbounds = cl.worldmodel->soa_leafbounds;
 	uint32_t		*vis = (uint32_t *)mark_surfaces_state.vis;
+	uint32_t		*leafvis = (uint32_t *)cl.worldmodel->leafvis;
 
 	uint32_t *mask = &vis[index];
 	if (*mask == 0)
@@ -464,17 +630,33 @@ void R_MarkLeafsSIMD (int index, void *unused)
 	unsigned int current_surfvis_index_written = 0;
 	uint32_t	 current_surfvis_written = 0;
 	int			 current_combined_dep_index = INT_MAX;
+	uint32_t	 leafvis_written = 0;
 
 	while (mask_iter != 0)
 	{
 		const int i = FindFirstBitNonZero (mask_iter);
 
-		mleaf_t *leaf = &cl.worldmodel->leafs[1 + first_leaf + i];
+		mleaf_t		  *leaf = &cl.worldmodel->leafs[1 + first_leaf + i];
+		const uint32_t bit_mask = ~(1u << i);
+		mask_iter &= bit_mask;
+
+		if (occlusion_cull && R_OccludedBox (leaf->minmaxs, leaf->minmaxs + 3, false))
+		{
+			*mask &= bit_mask;
+			continue;
+		}
 
 		if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
 		{
 			unsigned int nummarksurfaces = leaf->nummarksurfaces;
 			int			*marksurfaces = leaf->firstmarksurface;
+			if (indirect_mark)
+			{
+				// indirect_mark.comp marks the rest
+				leafvis_written |= 1u << i;
+				nummarksurfaces = leaf->numturbmarksurfaces;
+				marksurfaces = leaf->firstturbmarksurface;
+			}
 
 			for (j = 0; j < nummarksurfaces; ++j)
 			{
@@ -495,15 +677,13 @@ void R_MarkLeafsSIMD (int index, void *unused)
 				current_combined_dep_index = leaf->combined_deps;
 			}
 		}
-		const uint32_t bit_mask = ~(1u << i);
-		if (!leaf->efrags)
-		{
-			*mask &= bit_mask;
-		}
-		mask_iter &= bit_mask;
+		if (leaf->numstatics)
+			R_MarkLeafStatics (leaf);
 	}
 	if (current_surfvis_written != 0)
 		Atomic_OrUInt32_Relaxed (&surfvis[current_surfvis_index_written], current_surfvis_written);
+	if (indirect_mark)
+		leafvis[index] = leafvis_written;
 }
 
 /*
@@ -547,20 +727,7 @@ R_StoreLeafEFrags
 */
 void R_StoreLeafEFrags (void *unused)
 {
-	unsigned int i;
-	unsigned int numleafs = cl.worldmodel->numleafs;
-	uint32_t	*vis = (uint32_t *)mark_surfaces_state.vis;
-	for (i = 0; i < numleafs; i += 32)
-	{
-		uint32_t mask = vis[i / 32];
-		while (mask != 0)
-		{
-			const int j = FindFirstBitNonZero (mask);
-			mask &= ~(1u << j);
-			mleaf_t *leaf = &cl.worldmodel->leafs[1 + i + j];
-			R_StoreEfrags (&leaf->efrags);
-		}
-	}
+	R_StoreStaticEntities ();
 }
 
 /*
@@ -641,18 +808,47 @@ static void R_PrepareTransparentWaterSurfList ()
 /*
 ===============
 R_ChainVisSurfaces_TransparentWater
+
+Each texture chain is drawn in order, so the surfaces are chained near to far, which
+R_ChainSurface reverses
 ===============
 */
 static void R_ChainVisSurfaces_TransparentWater ()
 {
+	static sortbuffer_t sort_buffer;
 	R_PrepareTransparentWaterSurfList ();
-	uint32_t *surfvis = (uint32_t *)cl.worldmodel->surfvis;
+	uint32_t  *surfvis = (uint32_t *)cl.worldmodel->surfvis;
+	sortkey_t *surfs = R_SortBufferReserve (&sort_buffer, cl.worldmodel->used_water_surfs);
+	int		   num_surfs = 0;
 	for (int i = 0; i < cl.worldmodel->used_water_surfs; i++)
 	{
-		int j = cl.worldmodel->water_surfs[i];
-		if (surfvis[j / 32] & 1 << j % 32 && !R_BackFaceCull (&cl.worldmodel->surfaces[j]))
-			R_ChainSurface (&cl.worldmodel->surfaces[j], chain_world);
+		int			j = cl.worldmodel->water_surfs[i];
+		msurface_t *surf = &cl.worldmodel->surfaces[j];
+		if (!(surfvis[j / 32] & 1 << j % 32) || R_BackFaceCull (surf))
+			continue;
+		// distance to the bounds of the polygon
+		vec3_t mins = {FLT_MAX, FLT_MAX, FLT_MAX};
+		vec3_t maxs = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+		for (glpoly_t *p = surf->polys; p; p = p->next)
+			for (int v = 0; v < p->numverts; ++v)
+				for (int k = 0; k < 3; ++k)
+				{
+					mins[k] = q_min (mins[k], p->verts[v][k]);
+					maxs[k] = q_max (maxs[k], p->verts[v][k]);
+				}
+		float dist_squared = 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			const float dist = q_max (0.0f, q_max (mins[k] - r_refdef.vieworg[k], r_refdef.vieworg[k] - maxs[k]));
+			dist_squared += dist * dist;
+		}
+		surfs[num_surfs].key = R_DepthSortKey (dist_squared);
+		surfs[num_surfs].index = j;
+		++num_surfs;
 	}
+	R_RadixSort (surfs, num_surfs);
+	for (int i = 0; i < num_surfs; i++)
+		R_ChainSurface (&cl.worldmodel->surfaces[surfs[i].index], chain_world);
 }
 
 /*
@@ -672,6 +868,7 @@ void R_MarkLeafsParallel (int index, void *unused)
 	unsigned int current_surfvis_index_written = 0;
 	uint32_t	 current_surfvis_written = 0;
 	int			 current_combined_dep_index = INT_MAX;
+	uint32_t	 leafvis_written = 0;
 
 	while (mask_iter != 0)
 	{
@@ -679,17 +876,24 @@ void R_MarkLeafsParallel (int index, void *unused)
 		const uint32_t bit_mask = ~(1u << i);
 		mask_iter &= bit_mask;
 		leaf = &cl.worldmodel->leafs[first_leaf + i];
-		if (R_CullBox (leaf->minmaxs, leaf->minmaxs + 3))
+		if (R_CullBox (leaf->minmaxs, leaf->minmaxs + 3) || (occlusion_cull && R_OccludedBox (leaf->minmaxs, leaf->minmaxs + 3, false)))
 		{
 			*mask &= bit_mask;
 			continue;
 		}
-		if (!leaf->efrags)
-			*mask &= bit_mask;
+		if (leaf->numstatics)
+			R_MarkLeafStatics (leaf);
 		if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
 		{
 			unsigned int nummarksurfaces = leaf->nummarksurfaces;
 			int			*marksurfaces = leaf->firstmarksurface;
+			if (indirect_mark)
+			{
+				// indirect_mark.comp marks the rest
+				leafvis_written |= 1u << i;
+				nummarksurfaces = leaf->numturbmarksurfaces;
+				marksurfaces = leaf->firstturbmarksurface;
+			}
 
 			for (unsigned int j = 0; j < nummarksurfaces; ++j)
 			{
@@ -713,6 +917,8 @@ void R_MarkLeafsParallel (int index, void *unused)
 	}
 	if (current_surfvis_written != 0)
 		Atomic_OrUInt32_Relaxed (&surfvis[current_surfvis_index_written], current_surfvis_written);
+	if (indirect_mark)
+		((uint32_t *)cl.worldmodel->leafvis)[index] = leafvis_written;
 }
 
 /*
@@ -771,7 +977,7 @@ void R_MarkVisSurfaces (qboolean *use_tasks)
 	{
 		if (vis[i / 32] & (1u << (i % 32)))
 		{
-			if (R_CullBox (leaf->minmaxs, leaf->minmaxs + 3))
+			if (R_CullBox (leaf->minmaxs, leaf->minmaxs + 3) || (occlusion_cull && R_OccludedBox (leaf->minmaxs, leaf->minmaxs + 3, false)))
 				continue;
 
 			if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
@@ -782,38 +988,52 @@ void R_MarkVisSurfaces (qboolean *use_tasks)
 					current_combined_dep_index = leaf->combined_deps;
 				}
 
-				for (j = 0; j < leaf->nummarksurfaces; j++)
+				if (indirect_mark)
 				{
-					if (indirect)
+					// indirect_mark.comp marks the rest
+					((uint32_t *)cl.worldmodel->leafvis)[i / 32] |= 1u << (i % 32);
+					for (j = 0; j < leaf->numturbmarksurfaces; j++)
 					{
-						unsigned int surf_index = leaf->firstmarksurface[j];
+						unsigned int surf_index = leaf->firstturbmarksurface[j];
 						surfvis[surf_index / 32] |= 1u << (surf_index % 32);
-						continue;
 					}
-					surf = &cl.worldmodel->surfaces[leaf->firstmarksurface[j]];
-					if (surf->visframe != r_visframecount)
+				}
+				else
+				{
+					for (j = 0; j < leaf->nummarksurfaces; j++)
 					{
-						surf->visframe = r_visframecount;
-						if (!R_BackFaceCull (surf))
+						if (indirect)
 						{
-							++brushpolys;
-							R_ChainSurface (surf, chain_world);
-							if (!r_gpulightmapupdate.value)
-								R_RenderDynamicLightmaps (surf);
-							else if (surf->lightmaptexturenum >= 0)
-								lightmaps[surf->lightmaptexturenum].modified[0] |= surf->styles_bitmap;
-							if (surf->texinfo->texture->warpimage)
-								Atomic_StoreUInt32_Relaxed (&surf->texinfo->texture->update_warp, true);
+							unsigned int surf_index = leaf->firstmarksurface[j];
+							surfvis[surf_index / 32] |= 1u << (surf_index % 32);
+							continue;
+						}
+						surf = &cl.worldmodel->surfaces[leaf->firstmarksurface[j]];
+						if (surf->visframe != r_visframecount)
+						{
+							surf->visframe = r_visframecount;
+							if (!R_BackFaceCull (surf))
+							{
+								++brushpolys;
+								R_ChainSurface (surf, chain_world);
+								if (!r_gpulightmapupdate.value)
+									R_RenderDynamicLightmaps (surf);
+								else if (surf->lightmaptexturenum >= 0)
+									lightmaps[surf->lightmaptexturenum].modified[0] |= surf->styles_bitmap;
+								if (surf->texinfo->texture->warpimage)
+									Atomic_StoreUInt32_Relaxed (&surf->texinfo->texture->update_warp, true);
+							}
 						}
 					}
 				}
 			}
 
 			// add static models
-			if (leaf->efrags)
-				R_StoreEfrags (&leaf->efrags);
+			if (leaf->numstatics)
+				R_MarkLeafStatics (leaf);
 		}
 	}
+	R_StoreStaticEntities ();
 
 	if (indirect)
 		return;
@@ -852,6 +1072,11 @@ static void R_MarkSurfacesPrepare (void *unused)
 	if ((numleafs % 32) != 0)
 		vis[numleafs / 32] &= (1u << (numleafs % 32)) - 1;
 
+	if (indirect_mark)
+		memset (cl.worldmodel->leafvis, 0, (numleafs + 31) / 8);
+	if (cl.static_visbits)
+		memset (cl.static_visbits, 0, ((cl.num_statics + 31) / 32) * sizeof (uint32_t));
+
 	r_visframecount++;
 
 	// set all chains to null
@@ -917,6 +1142,9 @@ R_MarkSurfaces -- johnfitz -- mark surfaces based on PVS and rebuild texture cha
 */
 void R_MarkSurfaces (qboolean use_tasks, task_handle_t before_mark, task_handle_t *store_efrags, task_handle_t *cull_surfaces, task_handle_t *chain_surfaces)
 {
+	if (cl.num_baked_statics != cl.num_statics)
+		R_BakeEfrags ();
+
 	if (use_tasks)
 	{
 		task_handle_t prepare_mark = Task_AllocateAndAssignFunc (R_MarkSurfacesPrepare, NULL, 0);
@@ -1288,19 +1516,45 @@ void R_DrawTextureChains_Multitexture (cb_context_t *cbx, qmodel_t *model, entit
 			vulkan_globals.vk_cmd_bind_descriptor_sets (
 				cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &gl_texture->descriptor_set, 0, NULL);
 
-		for (s = t->texturechains[chain]; s; s = s->texturechains[chain])
+		if (alpha_blend)
 		{
-			if (s->lightmaptexturenum != lastlightmap)
+			// blended surfaces keep the chain order
+			for (s = t->texturechains[chain]; s; s = s->texturechains[chain])
 			{
-				R_FlushBatch (cbx, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
-				lightmap_texture = lightmaps[s->lightmaptexturenum].texture;
+				if (s->lightmaptexturenum != lastlightmap)
+				{
+					R_FlushBatch (cbx, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
+					lightmap_texture = lightmaps[s->lightmaptexturenum].texture;
+				}
+
+				lastlightmap = s->lightmaptexturenum;
+				R_BatchSurface (cbx, s, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
 			}
 
-			lastlightmap = s->lightmaptexturenum;
-			R_BatchSurface (cbx, s, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
+			R_FlushBatch (cbx, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
+			continue;
 		}
 
-		R_FlushBatch (cbx, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
+		// Opaque surfaces go one lightmap at a time, in ascending order, so a chain that
+		// alternates between lightmaps still draws once per lightmap instead of per switch.
+		// Chains rarely span more than a few lightmaps, so rewalking them is cheap.
+		int nextlightmap = INT_MAX;
+		for (s = t->texturechains[chain]; s; s = s->texturechains[chain])
+			nextlightmap = q_min (nextlightmap, s->lightmaptexturenum);
+		while (nextlightmap != INT_MAX)
+		{
+			lastlightmap = nextlightmap;
+			nextlightmap = INT_MAX;
+			lightmap_texture = lightmaps[lastlightmap].texture;
+			for (s = t->texturechains[chain]; s; s = s->texturechains[chain])
+			{
+				if (s->lightmaptexturenum == lastlightmap)
+					R_BatchSurface (cbx, s, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
+				else if (s->lightmaptexturenum > lastlightmap)
+					nextlightmap = q_min (nextlightmap, s->lightmaptexturenum);
+			}
+			R_FlushBatch (cbx, fullbright_enabled, alpha_test, alpha_blend, use_zbias, lightmap_texture, &brushpasses);
+		}
 	}
 
 	Atomic_AddUInt32 (&rs_brushpasses, brushpasses);
@@ -1338,7 +1592,9 @@ void R_DrawWorld (cb_context_t *cbx, int index)
 	R_BeginDebugUtilsLabel (cbx, "World");
 	if (!r_gpulightmapupdate.value)
 		R_UploadLightmaps ();
+	const uint64_t start = SDL_GetPerformanceCounter ();
 	R_DrawTextureChains_Multitexture (cbx, cl.worldmodel, NULL, chain_world, 1, world_texstart[index], world_texend[index]);
+	world_cbx_ticks[index] = SDL_GetPerformanceCounter () - start;
 	R_EndDebugUtilsLabel (cbx);
 }
 
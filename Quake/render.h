@@ -36,16 +36,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 typedef struct efrag_s
 {
-	struct efrag_s	*leafnext;
-	struct entity_s *entity;
+	struct efrag_s *leafnext;
+	int				staticnum; // index into cl.static_entities
 } efrag_t;
 
 typedef struct lightcache_s
 {
-	int	   surfidx; // < 0: black surface; == 0: no cache; > 0: 1+index of surface
+	int	   surfidx; // < 0: black surface or nothing hit; == 0: no cache; > 0: 1+index of surface
 	vec3_t pos;
 	short  ds;
 	short  dt;
+	int	   generation; // lightstyle generation color was sampled at, -1: not sampled yet
+	vec3_t color;
 } lightcache_t;
 
 // johnfitz -- for lerping
@@ -54,6 +56,8 @@ typedef struct lightcache_s
 #define LERP_RESETANIM2 (1 << 2) // set this and previous flag to disable anim lerping for two anim frames
 #define LERP_RESETMOVE	(1 << 3) // disable movement lerping until next origin/angles change
 #define LERP_FINISH		(1 << 4) // use lerpfinish time from server update instead of assuming interval of 0.1
+
+#define MSG_HISTORY 6 // entity updates kept for cl_netbuffer, enough for its largest delay at 20 updates per second
 // johnfitz
 
 // Separate allocation for RT BLAS state (hot/cold split for cache efficiency)
@@ -67,6 +71,11 @@ typedef struct entity_blas_s
 	VkDeviceSize			   update_scratch_size;
 	struct qmodel_s			  *model;
 	qboolean				   needs_initial_build;
+	int						   pose1; // pose the BLAS was last built for
+	int						   pose2;
+	int						   blend_bucket;
+	int						   num_refits; // updates since the last full build
+	struct entity_blas_s	  *shared;	   // BLAS of another entity with the same model and pose to use this frame, or NULL
 } entity_blas_t;
 
 typedef struct entity_s
@@ -83,6 +92,11 @@ typedef struct entity_s
 	vec3_t			 origin;
 	vec3_t			 msg_angles[2]; // last two updates (0 is newest)
 	vec3_t			 angles;
+	double			 history_times[MSG_HISTORY]; // cl_netbuffer: the last updates, to draw the entity in the past
+	vec3_t			 history_origins[MSG_HISTORY];
+	vec3_t			 history_angles[MSG_HISTORY];
+	int				 history_head; // newest
+	int				 history_count;
 	struct qmodel_s *model; // NULL = no model
 	struct efrag_s	*efrag; // linked list of efrags
 	int				 frame;
@@ -124,7 +138,7 @@ typedef struct entity_s
 	float  traildelay; // time left until next particle trail update
 	vec3_t trailorg;   // previous particle trail point
 
-	lightcache_t lightcache; // alias light trace cache
+	lightcache_t lightcache[2]; // alias light trace cache, [1] is for the retry from above
 
 	int	   contentscache;
 	vec3_t contentscache_origin;
@@ -177,6 +191,7 @@ typedef struct
 	uint32_t		flags;
 } mesh_interpolate_push_constants_t;
 
+// One MD5 entity of a batched skinning.comp dispatch, std430 layout of SkinningJob
 typedef struct
 {
 	VkDeviceAddress input_address;
@@ -184,9 +199,16 @@ typedef struct
 	VkDeviceAddress output_address;
 	uint32_t		joints_offset0;
 	uint32_t		joints_offset1;
-	uint32_t		output_offset;
 	uint32_t		num_verts;
 	float			blend_factor;
+	uint32_t		first_group;
+	uint32_t		padding;
+} skinning_job_t;
+
+typedef struct
+{
+	VkDeviceAddress jobs_address;
+	uint32_t		num_jobs;
 } skinning_push_constants_t;
 
 //
@@ -207,7 +229,7 @@ void R_ViewChanged (vrect_t *pvrect, int lineadj, float aspect);
 // void R_InitSky (struct texture_s *mt);	// called at level load
 
 void R_CheckEfrags (void); // johnfitz
-void R_AddEfrags (entity_t *ent);
+void R_AddEfrags (int staticnum);
 
 void R_NewMap (void);
 
@@ -221,7 +243,10 @@ void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength);
 void R_LavaSplash (vec3_t org);
 void R_TeleportSplash (vec3_t org);
 
-void R_PushDlights (void);
+void	 R_PushDlights (void);
+void	 R_BuildDlightGrid (void);
+uint64_t R_DlightsInBox (const float mins[3], const float maxs[3]);
+uint64_t R_DlightsAtPoint (const vec3_t p);
 
 //
 // surface cache related
@@ -1274,29 +1274,40 @@ static void Sbar_DrawModern (cb_context_t *cbx)
 	}
 }
 
+#ifdef USE_RMLUI
 /*
 ===============
-Sbar_Draw
+Sbar_UIActive
+
+In-game (world loaded, fully signed on, not a demo), the RmlUI HUD replaces the status bar
 ===============
 */
-void Sbar_Draw (cb_context_t *cbx)
+static qboolean Sbar_UIActive (void)
 {
-	float w; // johnfitz
+	return cl.worldmodel && cls.signon == SIGNONS && !cls.demoplayback;
+}
+
+/*
+===============
+Sbar_SyncUI
 
+Shows the RmlUI HUD and pushes the scoreboard into it. Called where Sbar_Draw would be, but
+ahead of the GUI pass so the UI can be updated alongside the world. Returns true when the
+HUD is up and wants the game state, which SCR_SyncUI then syncs.
+===============
+*/
+qboolean Sbar_SyncUI (void)
+{
 	if (scr_con_current == vid.height)
-		return; // console is full screen
+		return false; // console is full screen
 
-#ifdef USE_RMLUI
-	// If we're in-game (world loaded, fully signed on, not a demo), show RmlUI HUD
-	if (cl.worldmodel && cls.signon == SIGNONS && !cls.demoplayback)
+	if (Sbar_UIActive ())
 	{
 		if (!rmlui_hud_shown)
 		{
 			UI_ShowHUD (NULL);
 			rmlui_hud_shown = true;
 		}
-		// Sync game state to RmlUI data model
-		UI_SyncGameState (cl.stats, MAX_CL_STATS, cl.items, cl.intermission, cl.gametype, cl.maxclients, cl.levelname, cl.mapname, cl.time);
 
 		// Sync scoreboard player data in deathmatch or when scoreboard visible
 		if (cl.gametype == GAME_DEATHMATCH || sb_showscores)
@@ -1321,9 +1332,27 @@ void Sbar_Draw (cb_context_t *cbx)
 			}
 			UI_SyncScoreboard (sb_players, sb_count);
 		}
-
-		return;
+		return true;
 	}
+	return false;
+}
+#endif
+
+/*
+===============
+Sbar_Draw
+===============
+*/
+void Sbar_Draw (cb_context_t *cbx)
+{
+	float w; // johnfitz
+
+	if (scr_con_current == vid.height)
+		return; // console is full screen
+
+#ifdef USE_RMLUI
+	if (Sbar_UIActive ())
+		return; // RmlUI draws the HUD, synced by Sbar_SyncUI
 #endif
 
 	if ((scr_style.value < 1.0f) && cl.qcvm.extfuncs.CSQC_DrawHud && !qcvm)
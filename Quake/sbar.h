@@ -34,6 +34,11 @@ void Sbar_LoadPics (void);
 void Sbar_Draw (cb_context_t *cbx);
 // called every frame by screen
 
+#ifdef USE_RMLUI
+qboolean Sbar_SyncUI (void);
+// called every frame by screen before the RmlUI update, true if the HUD shows game state
+#endif
+
 void Sbar_IntermissionOverlay (cb_context_t *cbx);
 // called each frame after the level has been completed
 
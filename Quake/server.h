@@ -103,7 +103,8 @@ typedef struct
 		int		fld;
 		eval_t *ptr;
 	} customstats[MAX_CL_STATS * 2]; // strings or numeric...
-	size_t numcustomstats;
+	size_t		 numcustomstats;
+	unsigned int customstats_mask[MAX_CL_STATS / 32]; // stats written by customstats, the only ones past the first 32 worth computing
 
 	int effectsmask; // only enable colored quad/penta dlights in 2021 release
 } server_t;
@@ -169,11 +170,13 @@ typedef struct client_s
 	qboolean	 pextknown;
 	unsigned int protocol_pext1;
 	unsigned int protocol_pext2;
+	unsigned int protocol_vkpext;
 	unsigned int resendstatsnum[MAX_CL_STATS / 32]; // the stats which need to be resent.
 	unsigned int resendstatsstr[MAX_CL_STATS / 32]; // the stats which need to be resent.
 	int			 oldstats_i[MAX_CL_STATS];			// previous values of stats. if these differ from the current values, reflag resendstats.
 	float		 oldstats_f[MAX_CL_STATS];			// previous values of stats. if these differ from the current values, reflag resendstats.
 	char		*oldstats_s[MAX_CL_STATS];
+	int			 weaponmodel_index; // last SV_ModelIndex of v.weaponmodel, rechecked with a single strcmp
 	struct entity_num_state_s
 	{
 		unsigned int   num; // ascending order, there can be gaps.
@@ -181,9 +184,12 @@ typedef struct client_s
 	}			 *previousentities;
 	size_t		  numpreviousentities;
 	size_t		  maxpreviousentities;
-	unsigned int  snapshotresume;
-	unsigned int *pendingentities_bits; // UF_ flags for each entity
-	size_t		  numpendingentities;	// realloc if too small
+	unsigned int  snapshotresume;			// next entry of this frame's priority order, see SVFTE_PrioritizeEntities
+	unsigned int *pendingentities_bits;		// UF_ flags for each entity
+	float		 *pendingentities_senttime; // qcvm->time each entity was last written, ages the priority of starved entities
+	size_t		  numpendingentities;		// realloc if too small
+	float		  entitybudget;				// bytes of entity updates sv_maxrate still allows
+	double		  entitybudgettime;			// realtime the budget was last refilled
 #define SENDFLAG_PRESENT 0x80000000u	// tracks that we previously sent one of these ents (resulting in a remove if the ent gets remove()d).
 #define SENDFLAG_REMOVE	 0x40000000u	// for packetloss to signal that we need to resend a remove.
 #define SENDFLAG_USABLE	 0x00ffffffu	// SendFlags bits that the qc is actually able to use (don't get confused if the mod uses SendFlags=-1).
@@ -324,6 +330,8 @@ extern client_t *host_client;
 
 extern edict_t *sv_player;
 
+extern THREAD_LOCAL double sv_frametime; // physics step of the qcvm running on this thread
+
 //===========================================================
 
 void SV_Init (void);
@@ -358,6 +366,7 @@ qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
 void SV_WriteClientdataToMessage (client_t *client, sizebuf_t *msg);
+void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflowsize);
 
 void SV_MoveToGoal (void);
 
@@ -367,4 +376,34 @@ void SV_RunClients (void);
 void SV_SaveSpawnparms ();
 void SV_SpawnServer (const char *server);
 
+unsigned int		  MSGFTE_DeltaCalcBits (entity_state_t *from, entity_state_t *to);
+void				  MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state, sizebuf_t *msg, unsigned int pext2, unsigned int protocolflags);
+const entity_state_t *SV_FrameEntityStates (int *numstates);
+qboolean			  SV_SendPrespawnSoundPrecaches (void);
+int					  SV_SendPrespawnParticlePrecaches (int idx);
+int					  SV_SendPrespawnBaselines (int idx);
+int					  SV_SendPrespawnStatics (int idx);
+int					  SV_SendAmbientSounds (int idx);
+
+// sv_demo.c
+qboolean   SV_DemoRecording (void);
+sizebuf_t *SV_DemoDatagram (void);
+void	   SV_DemoSignon (void);
+void	   SV_DemoWriteViews (void);
+void	   SV_DemoWriteReliable (client_t *client, sizebuf_t *message);
+void	   SV_DemoFrame (void);
+void	   SV_DemoStop (void);
+void	   SV_Record_f (void);
+void	   SV_Stop_f (void);
+
+// sv_save.c
+extern cvar_t sv_savebinary;
+
+void	 SV_WriteBinarySave (const char *path, const char *comment);
+void	 SV_FinishSave (qboolean wait);
+byte	*SV_LoadBinarySave (const char *path, size_t *size);
+qboolean SV_BinarySaveInfo (const char *path, char mapname[MAX_QPATH], double *time);
+void	 SV_ReadBinarySaveHeader (const byte *save, float spawn_parms[NUM_TOTAL_SPAWN_PARMS], int *skill, char mapname[MAX_QPATH], double *time);
+int		 SV_ReadBinarySave (const byte *save, size_t size, qboolean fastload);
+
 #endif /* _QUAKE_SERVER_H */
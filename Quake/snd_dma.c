@@ -34,8 +34,10 @@ static void S_SoundList (void);
 static void S_Update_ (void);
 void		S_StopAllSounds (qboolean clear, qboolean keep_statics);
 static void S_StopAllSoundsC (void);
+static void S_StopAllSounds_ (qboolean clear, qboolean keep_statics);
+static void S_ClearBuffer_ (void);
 
-void S_SetUnderwaterIntensity (float intensity);
+void S_SetUnderwaterIntensity (float target, float frametime);
 
 // =======================================================================
 // Internal sound data & structures
@@ -55,8 +57,22 @@ vec3_t listener_forward;
 vec3_t listener_right;
 vec3_t listener_up;
 
+// the mixer's copy of the listener, from the last SND_CMD_LISTENER
+static vec3_t	mix_listener_origin;
+static vec3_t	mix_listener_right;
+static int		mix_viewentity;
+static qboolean mix_pause_loops;
+static qboolean mix_hrtf;
+
 #define sound_nominal_clip_dist 1000.0
 
+// snd_hrtf approximates a spherical head: the far ear hears a source up to
+// SND_HRTF_ITD seconds later and through the head shadow lowpass, so the
+// volumes themselves are panned less than for speakers
+#define SND_HRTF_ITD	0.00066f
+#define SND_HRTF_PAN	0.4f
+#define SND_HRTF_SHADOW 200 // of 256 for a source right beside the listener
+
 int soundtime;	 // sample PAIRS
 int paintedtime; // sample PAIRS
 
@@ -71,10 +87,76 @@ static int	 num_sfx;
 
 static sfx_t *ambient_sfx[NUM_AMBIENTS];
 
+// sounds queued between S_BeginPrecaching and S_EndPrecaching,
+// loaded by precache_task until S_WaitPrecaching
+static sfx_t		*precache_sfx[MAX_SOUNDS];
+static int			 num_precache_sfx;
+static qboolean		 precache_queueing;
+static task_handle_t precache_task = INVALID_TASK_HANDLE;
+
 static qboolean sound_started = false;
 
+// only serializes the loaders publishing an sfx_t cache
 SDL_Mutex *snd_mutex;
 
+// =======================================================================
+// Mixer thread
+// =======================================================================
+
+// S_Update_ runs on snd_thread, woken up whenever the audio callback has consumed part
+// of the DMA buffer. snd_channels, paintedtime and the paint state belong to that thread.
+// The main thread only changes them through commands, the ring has a single writer and
+// a single reader so it needs no lock. -nosoundthread mixes from the frame again, the
+// commands are then executed right away.
+
+#define SND_COMMAND_RING 1024 // power of two
+#define SND_MIX_TIMEOUT	 10	  // ms, commands are still executed while the device is paused
+
+typedef enum
+{
+	SND_CMD_START,
+	SND_CMD_STOP,
+	SND_CMD_STOPALL,
+	SND_CMD_STATIC,
+	SND_CMD_LISTENER,
+	SND_CMD_CLEARBUFFER,
+	SND_CMD_BLOCK,
+	SND_CMD_UNBLOCK,
+	SND_CMD_SCALETABLE,
+	SND_CMD_EVICT,
+} sndcommandtype_t;
+
+typedef struct
+{
+	sndcommandtype_t type;
+	int				 entnum; // view entity for SND_CMD_LISTENER, num_sfx for SND_CMD_EVICT
+	int				 entchannel;
+	sfx_t			*sfx;
+	vec3_t			 origin;
+	vec3_t			 right; // SND_CMD_LISTENER
+	float			 vol;	// 0-1 for SND_CMD_START, 0-255 for SND_CMD_STATIC
+	float			 attenuation;
+	int				 rand;		   // COM_Rand of the main thread for the start offset
+	qboolean		 clear;		   // SND_CMD_STOPALL
+	qboolean		 keep_statics; // SND_CMD_STOPALL
+	qboolean		 pause_loops;  // SND_CMD_LISTENER
+	qboolean		 hrtf;		   // SND_CMD_LISTENER
+	int				 ambients;	   // SND_CMD_LISTENER: -1 keeps the ambient channels, 0 silences them, 1 sets ambient_levels
+	float			 ambient_levels[NUM_AMBIENTS];
+	float			 underwater; // SND_CMD_LISTENER: target intensity, negative keeps it
+	float			 frametime;
+	uint64_t		 cachebudget; // SND_CMD_EVICT: bytes to shrink the sound cache to
+} sndcommand_t;
+
+static sndcommand_t	   snd_commands[SND_COMMAND_RING];
+static atomic_uint32_t snd_commandhead; // only advanced by the main thread
+static atomic_uint32_t snd_commandtail; // only advanced by the mixer
+static SDL_Thread	  *snd_thread;
+static SDL_Semaphore  *snd_mixsemaphore;
+static atomic_uint32_t snd_threadquit;
+static atomic_uint32_t snd_audiblechannels; // for snd_show
+static int			   snd_numstatics;		// main thread view of the static channels, for the limit
+
 cvar_t bgmvolume = {"bgmvolume", "1", CVAR_ARCHIVE};
 cvar_t sfxvolume = {"volume", "0.7", CVAR_ARCHIVE};
 
@@ -88,6 +170,18 @@ cvar_t snd_waterfx = {"snd_waterfx", "1", CVAR_ARCHIVE};
 
 cvar_t snd_pauselooping = {"snd_pauselooping", "1", CVAR_ARCHIVE};
 
+// binaural mixing for headphones, 0 keeps the speaker panning
+cvar_t snd_hrtf = {"snd_hrtf", "0", CVAR_ARCHIVE};
+
+// megabytes of resampled sounds kept around, 0 never evicts
+cvar_t snd_cachesize = {"snd_cachesize", "128", CVAR_ARCHIVE};
+
+// channels quieter than this keep their position without being mixed
+cvar_t snd_virtualvolume = {"snd_virtualvolume", "4", CVAR_ARCHIVE};
+
+// loudest channels mixed per paint, the rest run virtual, 0 mixes them all
+cvar_t snd_maxvoices = {"snd_maxvoices", "0", CVAR_ARCHIVE};
+
 #if defined(_WIN32)
 #define SND_FILTERQUALITY_DEFAULT "5"
 #else
@@ -119,9 +213,12 @@ static void S_SoundInfo_f (void)
 	Con_Printf ("%p dma buffer\n", shm->buffer);
 }
 
+static void S_PushCommand (const sndcommand_t *cmd);
+
 static void SND_Callback_sfxvolume (cvar_t *var)
 {
-	SND_InitScaletable ();
+	sndcommand_t cmd = {SND_CMD_SCALETABLE};
+	S_PushCommand (&cmd);
 }
 
 static void SND_Callback_snd_filterquality (cvar_t *var)
@@ -133,6 +230,204 @@ static void SND_Callback_snd_filterquality (cvar_t *var)
 	}
 }
 
+/*
+================
+S_ExecuteCommand
+
+Runs on the mixer thread
+================
+*/
+static void S_ExecuteStartSound (const sndcommand_t *cmd);
+static void S_ExecuteStaticSound (const sndcommand_t *cmd);
+static void S_ExecuteListener (const sndcommand_t *cmd);
+static void S_ExecuteEvict (const sndcommand_t *cmd);
+static void S_ExecuteCommand (const sndcommand_t *cmd)
+{
+	int i;
+
+	switch (cmd->type)
+	{
+	case SND_CMD_START:
+		S_ExecuteStartSound (cmd);
+		break;
+	case SND_CMD_STOP:
+		for (i = 0; i < MAX_DYNAMIC_CHANNELS; i++)
+		{
+			if (snd_channels[i].entnum == cmd->entnum && snd_channels[i].entchannel == cmd->entchannel)
+			{
+				snd_channels[i].end = 0;
+				snd_channels[i].sfx = NULL;
+				break;
+			}
+		}
+		break;
+	case SND_CMD_STOPALL:
+		S_StopAllSounds_ (cmd->clear, cmd->keep_statics);
+		break;
+	case SND_CMD_STATIC:
+		S_ExecuteStaticSound (cmd);
+		break;
+	case SND_CMD_LISTENER:
+		S_ExecuteListener (cmd);
+		break;
+	case SND_CMD_CLEARBUFFER:
+		S_ClearBuffer_ ();
+		break;
+	case SND_CMD_BLOCK:
+		/* FIXME: do we really need the blocking at the
+		 * driver level?
+		 */
+		if (snd_blocked == 0) /* ++snd_blocked == 1 */
+		{
+			snd_blocked = 1;
+			S_ClearBuffer_ ();
+			if (shm)
+				SNDDMA_BlockSound ();
+		}
+		break;
+	case SND_CMD_UNBLOCK:
+		if (snd_blocked == 1) /* --snd_blocked == 0 */
+		{
+			snd_blocked = 0;
+			SNDDMA_UnblockSound ();
+			S_ClearBuffer_ ();
+		}
+		break;
+	case SND_CMD_SCALETABLE:
+		SND_InitScaletable ();
+		break;
+	case SND_CMD_EVICT:
+		S_ExecuteEvict (cmd);
+		break;
+	}
+}
+
+/*
+================
+S_PushCommand
+
+Main thread only. A full ring waits for the mixer, which drains it every few milliseconds
+================
+*/
+static void S_PushCommand (const sndcommand_t *cmd)
+{
+	uint32_t head;
+
+	if (!snd_thread)
+	{
+		S_ExecuteCommand (cmd);
+		return;
+	}
+
+	head = Atomic_LoadUInt32 (&snd_commandhead);
+	while ((head - Atomic_LoadUInt32 (&snd_commandtail)) >= SND_COMMAND_RING)
+	{
+		SDL_SignalSemaphore (snd_mixsemaphore);
+		SDL_Delay (1);
+	}
+	snd_commands[head & (SND_COMMAND_RING - 1)] = *cmd;
+	Atomic_StoreUInt32 (&snd_commandhead, head + 1);
+}
+
+/*
+================
+S_SyncMixer
+
+Waits until the mixer has executed every command pushed so far
+================
+*/
+void S_SyncMixer (void)
+{
+	const uint32_t head = Atomic_LoadUInt32 (&snd_commandhead);
+
+	if (!snd_thread)
+		return;
+	while (Atomic_LoadUInt32 (&snd_commandtail) != head)
+	{
+		SDL_SignalSemaphore (snd_mixsemaphore);
+		SDL_Delay (1);
+	}
+}
+
+/*
+================
+S_WakeMixer
+
+Called by the audio callback after it consumed part of the DMA buffer
+================
+*/
+void S_WakeMixer (void)
+{
+	if (snd_mixsemaphore)
+		SDL_SignalSemaphore (snd_mixsemaphore);
+}
+
+/*
+================
+S_MixerThread
+================
+*/
+static int S_MixerThread (void *unused)
+{
+	while (!Atomic_LoadUInt32 (&snd_threadquit))
+	{
+		uint32_t head, tail;
+
+		(void)SDL_WaitSemaphoreTimeout (snd_mixsemaphore, SND_MIX_TIMEOUT);
+
+		head = Atomic_LoadUInt32 (&snd_commandhead);
+		for (tail = Atomic_LoadUInt32 (&snd_commandtail); tail != head; ++tail)
+		{
+			S_ExecuteCommand (&snd_commands[tail & (SND_COMMAND_RING - 1)]);
+			Atomic_StoreUInt32 (&snd_commandtail, tail + 1);
+		}
+
+		S_Update_ ();
+	}
+
+	return 0;
+}
+
+/*
+================
+S_StartThread
+================
+*/
+static void S_StartThread (void)
+{
+	if (COM_CheckParm ("-nosoundthread"))
+		return;
+
+	snd_mixsemaphore = SDL_CreateSemaphore (0);
+	Atomic_StoreUInt32 (&snd_threadquit, 0);
+	snd_thread = SDL_CreateThread (S_MixerThread, "Mixer", NULL);
+	if (!snd_thread)
+	{
+		Con_Printf ("Couldn't create the mixer thread, mixing from the main loop\n");
+		SDL_DestroySemaphore (snd_mixsemaphore);
+		snd_mixsemaphore = NULL;
+	}
+}
+
+/*
+================
+S_StopThread
+================
+*/
+static void S_StopThread (void)
+{
+	if (!snd_thread)
+		return;
+
+	S_SyncMixer ();
+	Atomic_StoreUInt32 (&snd_threadquit, 1);
+	SDL_SignalSemaphore (snd_mixsemaphore);
+	SDL_WaitThread (snd_thread, NULL);
+	snd_thread = NULL;
+	SDL_DestroySemaphore (snd_mixsemaphore);
+	snd_mixsemaphore = NULL;
+}
+
 /*
 ================
 S_Startup
@@ -152,12 +447,29 @@ void S_Startup (void)
 	else
 	{
 		Con_Printf ("Audio: %d bit, %s, %d Hz\n", shm->samplebits, (shm->channels == 2) ? "stereo" : "mono", shm->speed);
+		S_StartThread ();
 	}
 }
 
+/*
+================
+S_StartupTask
+
+Opening the audio device can take a while, it overlaps the rest of Host_Init
+================
+*/
+static task_handle_t startup_task = INVALID_TASK_HANDLE;
+
+static void S_StartupTask (void *unused)
+{
+	S_Startup ();
+}
+
 /*
 ================
 S_Init
+
+Registers everything and starts opening the device, S_FinishInit completes it
 ================
 */
 void S_Init (void)
@@ -187,6 +499,10 @@ void S_Init (void)
 	Cvar_RegisterVariable (&snd_filterquality);
 	Cvar_RegisterVariable (&snd_waterfx);
 	Cvar_RegisterVariable (&snd_pauselooping);
+	Cvar_RegisterVariable (&snd_cachesize);
+	Cvar_RegisterVariable (&snd_hrtf);
+	Cvar_RegisterVariable (&snd_virtualvolume);
+	Cvar_RegisterVariable (&snd_maxvoices);
 
 	if (safemode || COM_CheckParm ("-nosound"))
 		return;
@@ -219,7 +535,21 @@ void S_Init (void)
 
 	snd_initialized = true;
 
-	S_Startup ();
+	startup_task = Task_AllocateAssignFuncAndSubmit (S_StartupTask, NULL, 0);
+}
+
+/*
+================
+S_FinishInit
+================
+*/
+void S_FinishInit (void)
+{
+	if (startup_task == INVALID_TASK_HANDLE)
+		return;
+	Task_Join (startup_task, TASK_TIMEOUT_INFINITE);
+	startup_task = INVALID_TASK_HANDLE;
+
 	if (sound_started == 0)
 		return;
 
@@ -240,9 +570,18 @@ void S_Init (void)
 // =======================================================================
 void S_Shutdown (void)
 {
+	if (startup_task != INVALID_TASK_HANDLE)
+	{
+		Task_Join (startup_task, TASK_TIMEOUT_INFINITE);
+		startup_task = INVALID_TASK_HANDLE;
+	}
 	if (!sound_started)
 		return;
 
+	S_WaitPrecaching ();
+	S_WaitAsyncLoads ();
+	S_StopThread ();
+
 	sound_started = 0;
 	snd_blocked = 0;
 
@@ -260,13 +599,25 @@ static void S_FlushOldestSounds (void)
 {
 	assert (num_sfx == countof (known_sfx));
 
+	// precache tasks may still be filling in known_sfx caches, and queued
+	// entries are about to move: those get loaded on first use instead
+	S_WaitPrecaching ();
+	S_WaitAsyncLoads ();
+	num_precache_sfx = 0;
+
+	// the channels point into known_sfx, the mixer must let go of them first
+	S_StopAllSounds (true, false);
+	S_SyncMixer ();
+
 	for (int i = 0; i < MAX_SOUNDS; ++i)
 	{
-		SAFE_FREE (known_sfx[i].cache);
+		S_FreeCache (&known_sfx[i]);
 	}
 
 	// move [MAX_SOUNDS ; 2* MAX_SOUNDS - 1] into [0 ; MAX_SOUNDS - 1]
 	memmove ((void *)&known_sfx[0], (const void *)&known_sfx[MAX_SOUNDS], MAX_SOUNDS * sizeof (sfx_t));
+	// the moved caches must not be shared with the entries handed out next
+	memset ((void *)&known_sfx[MAX_SOUNDS], 0, MAX_SOUNDS * sizeof (sfx_t));
 
 	num_sfx = MAX_SOUNDS;
 }
@@ -342,7 +693,12 @@ sfx_t *S_PrecacheSound (const char *name)
 
 	// cache it in
 	if (precache.value)
-		S_LoadSound (sfx);
+	{
+		if (precache_queueing && num_precache_sfx < MAX_SOUNDS)
+			precache_sfx[num_precache_sfx++] = sfx;
+		else
+			S_LoadSoundAsync (sfx);
+	}
 
 	return sfx;
 }
@@ -375,7 +731,7 @@ channel_t *SND_PickChannel (int entnum, int entchannel)
 		}
 
 		// don't let monster sounds override player sounds
-		if (snd_channels[ch_idx].entnum == cl.viewentity && entnum != cl.viewentity && snd_channels[ch_idx].sfx)
+		if (snd_channels[ch_idx].entnum == mix_viewentity && entnum != mix_viewentity && snd_channels[ch_idx].sfx)
 			continue;
 
 		if (snd_channels[ch_idx].end - paintedtime < life_left)
@@ -401,31 +757,33 @@ SND_Spatialize
 spatializes a channel
 =================
 */
-void SND_Spatialize (channel_t *ch)
+static void SND_SetChannelVolumes (channel_t *ch, float dot, float gain)
 {
-	vec_t  dot;
-	vec_t  dist;
-	vec_t  lscale, rscale, scale;
-	vec3_t source_vec;
+	float lscale, rscale;
+
+	ch->itd = 0;
+	ch->shadow = 0;
 
 	// anything coming from the view entity will always be full volume
-	if (ch->entnum == cl.viewentity)
+	if (ch->entnum == mix_viewentity)
 	{
 		ch->leftvol = ch->master_vol;
 		ch->rightvol = ch->master_vol;
 		return;
 	}
 
-	// calculate stereo seperation and distance attenuation
-	VectorSubtract (ch->origin, listener_origin, source_vec);
-	dist = VectorNormalize (source_vec) * ch->dist_mult;
-	dot = DotProduct (listener_right, source_vec);
-
 	if (shm->channels == 1)
 	{
 		rscale = 1.0;
 		lscale = 1.0;
 	}
+	else if (mix_hrtf)
+	{
+		rscale = 1.0 + SND_HRTF_PAN * dot;
+		lscale = 1.0 - SND_HRTF_PAN * dot;
+		ch->itd = (int)(dot * SND_HRTF_ITD * shm->speed + (dot < 0.f ? -0.5f : 0.5f));
+		ch->shadow = (int)(fabsf (dot) * SND_HRTF_SHADOW);
+	}
 	else
 	{
 		rscale = 1.0 + dot;
@@ -433,17 +791,98 @@ void SND_Spatialize (channel_t *ch)
 	}
 
 	// add in distance effect
-	scale = (1.0 - dist) * rscale;
-	ch->rightvol = (int)(ch->master_vol * scale);
+	ch->rightvol = (int)(ch->master_vol * gain * rscale);
 	if (ch->rightvol < 0)
 		ch->rightvol = 0;
 
-	scale = (1.0 - dist) * lscale;
-	ch->leftvol = (int)(ch->master_vol * scale);
+	ch->leftvol = (int)(ch->master_vol * gain * lscale);
 	if (ch->leftvol < 0)
 		ch->leftvol = 0;
 }
 
+/*
+=================
+SND_SpatializeChannels
+
+Stereo seperation and distance attenuation of many channels at once,
+4 channels per SIMD iteration. The directions are kept in spatial_dot
+so that the volumes and the snd_hrtf parameters come from the same pass.
+=================
+*/
+static float spatial_x[MAX_CHANNELS];
+static float spatial_y[MAX_CHANNELS];
+static float spatial_z[MAX_CHANNELS];
+static float spatial_dist_mult[MAX_CHANNELS];
+static float spatial_dot[MAX_CHANNELS];
+static float spatial_gain[MAX_CHANNELS];
+
+static void SND_SpatializeChannels (channel_t **chans, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		spatial_x[i] = chans[i]->origin[0] - mix_listener_origin[0];
+		spatial_y[i] = chans[i]->origin[1] - mix_listener_origin[1];
+		spatial_z[i] = chans[i]->origin[2] - mix_listener_origin[2];
+		spatial_dist_mult[i] = chans[i]->dist_mult;
+	}
+
+	i = 0;
+#if defined(USE_SSE2)
+	{
+		const __m128 right_x = _mm_set1_ps (mix_listener_right[0]);
+		const __m128 right_y = _mm_set1_ps (mix_listener_right[1]);
+		const __m128 right_z = _mm_set1_ps (mix_listener_right[2]);
+		const __m128 one = _mm_set1_ps (1.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps (spatial_x + i);
+			const __m128 y = _mm_loadu_ps (spatial_y + i);
+			const __m128 z = _mm_loadu_ps (spatial_z + i);
+			const __m128 length = _mm_sqrt_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (x, x), _mm_mul_ps (y, y)), _mm_mul_ps (z, z)));
+			const __m128 proj = _mm_add_ps (_mm_add_ps (_mm_mul_ps (x, right_x), _mm_mul_ps (y, right_y)), _mm_mul_ps (z, right_z));
+			// a source at the listener has no direction, the division of those lanes is masked out
+			const __m128 dot = _mm_and_ps (_mm_div_ps (proj, length), _mm_cmpgt_ps (length, _mm_setzero_ps ()));
+			_mm_storeu_ps (spatial_dot + i, dot);
+			_mm_storeu_ps (spatial_gain + i, _mm_sub_ps (one, _mm_mul_ps (length, _mm_loadu_ps (spatial_dist_mult + i))));
+		}
+	}
+#elif defined(USE_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		const float32x4_t x = vld1q_f32 (spatial_x + i);
+		const float32x4_t y = vld1q_f32 (spatial_y + i);
+		const float32x4_t z = vld1q_f32 (spatial_z + i);
+		const float32x4_t length = vsqrtq_f32 (vmlaq_f32 (vmlaq_f32 (vmulq_f32 (x, x), y, y), z, z));
+		const float32x4_t proj = vmlaq_n_f32 (vmlaq_n_f32 (vmulq_n_f32 (x, mix_listener_right[0]), y, mix_listener_right[1]), z, mix_listener_right[2]);
+		const uint32x4_t  valid = vcgtq_f32 (length, vdupq_n_f32 (0.0f));
+		vst1q_f32 (spatial_dot + i, vreinterpretq_f32_u32 (vandq_u32 (vreinterpretq_u32_f32 (vdivq_f32 (proj, length)), valid)));
+		vst1q_f32 (spatial_gain + i, vmlsq_f32 (vdupq_n_f32 (1.0f), length, vld1q_f32 (spatial_dist_mult + i)));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const float length = sqrtf (spatial_x[i] * spatial_x[i] + spatial_y[i] * spatial_y[i] + spatial_z[i] * spatial_z[i]);
+		const float proj = spatial_x[i] * mix_listener_right[0] + spatial_y[i] * mix_listener_right[1] + spatial_z[i] * mix_listener_right[2];
+		spatial_dot[i] = (length > 0.f) ? (proj / length) : 0.f;
+		spatial_gain[i] = 1.0f - length * spatial_dist_mult[i];
+	}
+
+	for (i = 0; i < count; i++)
+		SND_SetChannelVolumes (chans[i], spatial_dot[i], spatial_gain[i]);
+}
+
+/*
+=================
+SND_Spatialize
+=================
+*/
+void SND_Spatialize (channel_t *ch)
+{
+	SND_SpatializeChannels (&ch, 1);
+}
+
 /*
 =======================================================================
 Start a sound effect
@@ -451,43 +890,64 @@ fvol is in 0.0-1.0f
 =======================================================================
 */
 void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
+{
+	sndcommand_t cmd;
+
+	if (!sound_started || !sfx || nosound.value)
+		return;
+
+	// the mixer never loads, a sound that isn't cached yet is started
+	// as a pending channel and plays once its load task is done
+	S_MarkUsed (sfx);
+	S_LoadSoundAsync (sfx);
+
+	memset (&cmd, 0, sizeof (cmd));
+	cmd.type = SND_CMD_START;
+	cmd.entnum = entnum;
+	cmd.entchannel = entchannel;
+	cmd.sfx = sfx;
+	VectorCopy (origin, cmd.origin);
+	cmd.vol = fvol;
+	cmd.attenuation = attenuation;
+	cmd.rand = COM_Rand ();
+	S_PushCommand (&cmd);
+}
+
+static void S_ExecuteStartSound (const sndcommand_t *cmd)
 {
 	channel_t  *target_chan, *check;
 	sfxcache_t *sc;
 	int			ch_idx;
 	int			skip;
 
-	SDL_LockMutex (snd_mutex);
-	if (!sound_started || !sfx || nosound.value)
-		goto unlock_mutex;
-
 	// pick a channel to play on
-	target_chan = SND_PickChannel (entnum, entchannel);
+	target_chan = SND_PickChannel (cmd->entnum, cmd->entchannel);
 	if (!target_chan)
-		goto unlock_mutex;
+		return;
 
 	// spatialize
 	memset (target_chan, 0, sizeof (*target_chan));
-	VectorCopy (origin, target_chan->origin);
-	target_chan->dist_mult = attenuation / sound_nominal_clip_dist;
-	target_chan->master_vol = (int)(fvol * 255);
-	target_chan->entnum = entnum;
-	target_chan->entchannel = entchannel;
+	VectorCopy (cmd->origin, target_chan->origin);
+	target_chan->dist_mult = cmd->attenuation / sound_nominal_clip_dist;
+	target_chan->master_vol = (int)(cmd->vol * 255);
+	target_chan->entnum = cmd->entnum;
+	target_chan->entchannel = cmd->entchannel;
 	SND_Spatialize (target_chan);
 
 	if (!target_chan->leftvol && !target_chan->rightvol)
-		goto unlock_mutex;
+		return;
 
 	// new channel
-	sc = S_LoadSound (sfx);
+	target_chan->sfx = cmd->sfx;
+	target_chan->pos = 0.0;
+	sc = S_CachedSound (cmd->sfx);
 	if (!sc)
 	{
-		target_chan->sfx = NULL;
-		goto unlock_mutex; // couldn't load the sound's data
+		// S_PaintChannels sets the real end, this one only matters to SND_PickChannel
+		target_chan->pending = true;
+		target_chan->end = paintedtime + shm->speed;
+		return;
 	}
-
-	target_chan->sfx = sfx;
-	target_chan->pos = 0.0;
 	target_chan->end = paintedtime + sc->length;
 
 	// if an identical sound has also been started this frame, offset the pos
@@ -497,7 +957,7 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 	{
 		if (check == target_chan)
 			continue;
-		if (check->sfx == sfx && !check->pos)
+		if (check->sfx == cmd->sfx && !check->pos)
 		{
 			/*
 			skip = COM_Rand () % (int)(0.1 * shm->speed);
@@ -509,68 +969,67 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 			if (skip > sc->length)
 				skip = sc->length;
 			if (skip > 0)
-				skip = COM_Rand () % skip;
+				skip = cmd->rand % skip;
 			target_chan->pos += skip;
 			target_chan->end -= skip;
 			break;
 		}
 	}
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
 }
 
 void S_StopSound (int entnum, int entchannel)
 {
-	int i;
+	sndcommand_t cmd;
 
-	SDL_LockMutex (snd_mutex);
-
-	for (i = 0; i < MAX_DYNAMIC_CHANNELS; i++)
-	{
-		if (snd_channels[i].entnum == entnum && snd_channels[i].entchannel == entchannel)
-		{
-			snd_channels[i].end = 0;
-			snd_channels[i].sfx = NULL;
-			goto unlock_mutex;
-		}
-	}
+	if (!sound_started)
+		return;
 
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+	memset (&cmd, 0, sizeof (cmd));
+	cmd.type = SND_CMD_STOP;
+	cmd.entnum = entnum;
+	cmd.entchannel = entchannel;
+	S_PushCommand (&cmd);
 }
 
 void S_StopAllSounds (qboolean clear, qboolean keep_statics)
 {
-	int i;
+	sndcommand_t cmd;
 
-	if (!snd_initialized)
+	if (!snd_initialized || !sound_started)
 		return;
 
-	SDL_LockMutex (snd_mutex);
-	if (!sound_started)
-		goto unlock_mutex;
+	if (!keep_statics)
+		snd_numstatics = 0;
+
+	memset (&cmd, 0, sizeof (cmd));
+	cmd.type = SND_CMD_STOPALL;
+	cmd.clear = clear;
+	cmd.keep_statics = keep_statics;
+	S_PushCommand (&cmd);
+}
+
+static void S_StopAllSounds_ (qboolean clear, qboolean keep_statics)
+{
+	int			i;
+	sfxcache_t *sc;
 
 	if (!keep_statics)
 		total_channels = MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS; // no statics
 
 	for (i = 0; i < MAX_CHANNELS; i++)
 	{
-		if (!keep_statics || snd_channels[i].entnum || !snd_channels[i].sfx || !S_LoadSound (snd_channels[i].sfx) ||
-			S_LoadSound (snd_channels[i].sfx)->loopstart == -1)
+		sc = snd_channels[i].sfx ? S_CachedSound (snd_channels[i].sfx) : NULL;
+		if (!keep_statics || snd_channels[i].entnum || !sc || sc->loopstart == -1)
 			memset (&snd_channels[i], 0, sizeof (channel_t));
 		else
 		{
 			snd_channels[i].pos = 0;
-			snd_channels[i].end = paintedtime + S_LoadSound (snd_channels[i].sfx)->length;
+			snd_channels[i].end = paintedtime + sc->length;
 		}
 	}
 
 	if (clear)
-		S_ClearBuffer ();
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+		S_ClearBuffer_ ();
 }
 
 static void S_StopAllSoundsC (void)
@@ -580,16 +1039,26 @@ static void S_StopAllSoundsC (void)
 
 void S_ClearBuffer (void)
 {
-	int clear;
+	sndcommand_t cmd = {SND_CMD_CLEARBUFFER};
 
-	SDL_LockMutex (snd_mutex);
+	if (!sound_started)
+		return;
+	S_PushCommand (&cmd);
+}
+
+static void S_ClearBuffer_ (void)
+{
+	int clear;
 
 	if (!sound_started || !shm)
-		goto unlock_mutex;
+		return;
 
 	SNDDMA_LockBuffer ();
 	if (!shm->buffer)
-		goto unlock_mutex;
+	{
+		SNDDMA_Submit ();
+		return;
+	}
 
 	s_rawend = 0;
 
@@ -601,9 +1070,6 @@ void S_ClearBuffer (void)
 	memset (shm->buffer, clear, shm->samples * shm->samplebits / 8);
 
 	SNDDMA_Submit ();
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
 }
 
 /*
@@ -614,43 +1080,62 @@ vol is in 0-255
 */
 void S_StaticSound (sfx_t *sfx, vec3_t origin, int vol, float attenuation)
 {
-	channel_t  *ss;
-	sfxcache_t *sc;
+	sndcommand_t cmd;
+	sfxcache_t	*sc;
+	qboolean	 looped;
 
-	if (!sfx)
+	if (!sfx || !sound_started)
 		return;
 
-	SDL_LockMutex (snd_mutex);
-
-	if (total_channels == MAX_CHANNELS)
+	if (snd_numstatics == MAX_CHANNELS - MAX_DYNAMIC_CHANNELS - NUM_AMBIENTS)
 	{
 		Con_Printf ("total_channels == MAX_CHANNELS\n");
-		goto unlock_mutex;
+		return;
 	}
 
-	ss = &snd_channels[total_channels];
-	total_channels++;
-
-	sc = S_LoadSound (sfx);
-	if (!sc)
-		goto unlock_mutex;
+	S_MarkUsed (sfx);
+	if (!S_LoadSound (sfx))
+		return;
 
-	if (sc->loopstart == -1)
+	// SND_CMD_EVICT frees caches under snd_mutex
+	SDL_LockMutex (snd_mutex);
+	sc = S_CachedSound (sfx);
+	looped = sc && sc->loopstart != -1;
+	SDL_UnlockMutex (snd_mutex);
+	if (!looped)
 	{
 		Con_Printf ("Sound %s not looped\n", sfx->name);
-		goto unlock_mutex;
+		return;
 	}
 
-	ss->sfx = sfx;
-	VectorCopy (origin, ss->origin);
-	ss->master_vol = vol;
-	ss->dist_mult = (attenuation / 64) / sound_nominal_clip_dist;
+	snd_numstatics++;
+	memset (&cmd, 0, sizeof (cmd));
+	cmd.type = SND_CMD_STATIC;
+	cmd.sfx = sfx;
+	VectorCopy (origin, cmd.origin);
+	cmd.vol = vol;
+	cmd.attenuation = attenuation;
+	S_PushCommand (&cmd);
+}
+
+static void S_ExecuteStaticSound (const sndcommand_t *cmd)
+{
+	channel_t  *ss;
+	sfxcache_t *sc = S_CachedSound (cmd->sfx);
+
+	if (!sc || total_channels == MAX_CHANNELS)
+		return;
+
+	ss = &snd_channels[total_channels];
+	total_channels++;
+
+	ss->sfx = cmd->sfx;
+	VectorCopy (cmd->origin, ss->origin);
+	ss->master_vol = (int)cmd->vol;
+	ss->dist_mult = (cmd->attenuation / 64) / sound_nominal_clip_dist;
 	ss->end = paintedtime + sc->length;
 
 	SND_Spatialize (ss);
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
 }
 
 //=============================================================================
@@ -676,40 +1161,46 @@ static float S_UnderwaterIntensityForContents (int contents)
 /*
 ===================
 S_UpdateAmbientSounds
+
+Main thread, fills in the ambient part of a SND_CMD_LISTENER
 ===================
 */
-static void S_UpdateAmbientSounds (void)
+static void S_UpdateAmbientSounds (sndcommand_t *cmd)
 {
 	mleaf_t		*l;
 	int			 ambient_channel;
-	channel_t	*chan;
 	static float vol, levels[NUM_AMBIENTS]; // Spike: fixing ambient levels not changing at high enough framerates due to integer precison.
 
-	SDL_LockMutex (snd_mutex);
+	cmd->ambients = -1;
+	cmd->underwater = -1.f;
 
 	// no ambients when disconnected
 	if (cls.state != ca_connected || cls.signon != SIGNONS)
 	{
-		S_SetUnderwaterIntensity (0.f);
-		goto unlock_mutex;
+		cmd->underwater = 0.f;
+		return;
 	}
 	// calc ambient sound levels
 	if (!cl.worldmodel || cl.worldmodel->needload)
-		goto unlock_mutex;
+		return;
 
 	l = Mod_PointInLeaf (listener_origin, cl.worldmodel);
-	S_SetUnderwaterIntensity (l ? S_UnderwaterIntensityForContents (l->contents) : 0.f);
+	cmd->underwater = l ? S_UnderwaterIntensityForContents (l->contents) : 0.f;
 	if (!l || !ambient_level.value)
 	{
-		for (ambient_channel = 0; ambient_channel < NUM_AMBIENTS; ambient_channel++)
-			snd_channels[ambient_channel].sfx = NULL;
-		goto unlock_mutex;
+		cmd->ambients = 0;
+		return;
 	}
 
+	cmd->ambients = 1;
 	for (ambient_channel = 0; ambient_channel < NUM_AMBIENTS; ambient_channel++)
 	{
-		chan = &snd_channels[ambient_channel];
-		chan->sfx = ambient_sfx[ambient_channel];
+		// reloads them after S_ClearAll or an eviction, the mixer never loads
+		if (ambient_sfx[ambient_channel])
+		{
+			S_MarkUsed (ambient_sfx[ambient_channel]);
+			S_LoadSoundAsync (ambient_sfx[ambient_channel]);
+		}
 
 		vol = (int)(ambient_level.value * l->ambient_sound_level[ambient_channel]);
 		if (vol < 8)
@@ -722,18 +1213,15 @@ static void S_UpdateAmbientSounds (void)
 			if (levels[ambient_channel] > vol)
 				levels[ambient_channel] = vol;
 		}
-		else if (chan->master_vol > vol)
+		else if ((int)levels[ambient_channel] > vol)
 		{
 			levels[ambient_channel] -= (host_frametime * ambient_fade.value);
 			if (levels[ambient_channel] < vol)
 				levels[ambient_channel] = vol;
 		}
 
-		chan->leftvol = chan->rightvol = chan->master_vol = levels[ambient_channel];
+		cmd->ambient_levels[ambient_channel] = levels[ambient_channel];
 	}
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
 }
 
 /*
@@ -821,6 +1309,36 @@ void S_RawSamples (int samples, int rate, int width, int channels, byte *data, f
 	}
 }
 
+/*
+============
+S_UpdateCacheBudget
+
+Main thread, asks the mixer to evict once the sound cache grows past
+snd_cachesize. Only the mixer knows which sounds are still playing.
+============
+*/
+static void S_UpdateCacheBudget (void)
+{
+	static double next_evict;
+	sndcommand_t  cmd;
+	uint64_t	  budget;
+
+	if (snd_cachesize.value <= 0.f || realtime < next_evict)
+		return;
+	budget = (uint64_t)(snd_cachesize.value * 1024.0 * 1024.0);
+	if (S_CacheBytes () <= budget)
+		return;
+
+	// whatever is playing stays, don't ask again every frame
+	next_evict = realtime + 1.0;
+
+	memset (&cmd, 0, sizeof (cmd));
+	cmd.type = SND_CMD_EVICT;
+	cmd.entnum = num_sfx;
+	cmd.cachebudget = budget;
+	S_PushCommand (&cmd);
+}
+
 /*
 ============
 S_Update
@@ -830,32 +1348,151 @@ Called once each time through the main loop
 */
 void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 {
-	int		   i, j;
-	int		   total;
-	channel_t *ch;
-	channel_t *combine;
+	sndcommand_t cmd;
 
-	SDL_LockMutex (snd_mutex);
-	if (!sound_started || (snd_blocked > 0))
-		goto unlock_mutex;
+	if (!sound_started)
+		return;
 
 	VectorCopy (origin, listener_origin);
 	VectorCopy (forward, listener_forward);
 	VectorCopy (right, listener_right);
 	VectorCopy (up, listener_up);
 
+	memset (&cmd, 0, sizeof (cmd));
+	cmd.type = SND_CMD_LISTENER;
+	cmd.entnum = cl.viewentity;
+	VectorCopy (origin, cmd.origin);
+	VectorCopy (right, cmd.right);
+	cmd.pause_loops = snd_pauselooping.value && (cl.paused || (sv.active && svs.maxclients == 1 && key_dest != key_game));
+	cmd.frametime = host_frametime;
+	cmd.hrtf = snd_hrtf.value != 0.f;
+
 	// update general area ambient sound sources
-	S_UpdateAmbientSounds ();
+	S_UpdateAmbientSounds (&cmd);
+
+	S_PushCommand (&cmd);
+
+	S_UpdateCacheBudget ();
+
+	//
+	// debugging output
+	//
+	if (snd_show.value)
+		Con_Printf ("----(%i)----\n", (int)Atomic_LoadUInt32 (&snd_audiblechannels));
+
+	// add raw data from streamed samples
+	//	BGM_Update();	// moved to the main loop just before S_Update ()
+
+	// mix some sound
+	if (snd_thread)
+		SDL_SignalSemaphore (snd_mixsemaphore);
+	else
+		S_Update_ ();
+}
+
+/*
+============
+S_ExecuteEvict
+
+Frees the least recently used caches that no channel plays until the sound
+cache fits into cmd->cachebudget. Sounds used within SND_CACHE_MINAGE are
+kept, the main thread may be about to start them or read their cache.
+============
+*/
+static int S_CompareLastUsed (const void *a, const void *b)
+{
+	uint32_t now = S_CacheTime ();
+	uint32_t age_a = now - Atomic_LoadUInt32 (&(*(sfx_t **)a)->lastused);
+	uint32_t age_b = now - Atomic_LoadUInt32 (&(*(sfx_t **)b)->lastused);
+
+	return (age_a < age_b) - (age_a > age_b);
+}
+
+static void S_ExecuteEvict (const sndcommand_t *cmd)
+{
+	static qboolean playing[countof (known_sfx)];
+	static sfx_t   *candidates[countof (known_sfx)];
+	uint32_t		now = S_CacheTime ();
+	int				i, num_candidates = 0;
+
+	memset (playing, 0, sizeof (playing));
+	for (i = 0; i < MAX_CHANNELS; i++)
+	{
+		if (snd_channels[i].sfx)
+			playing[snd_channels[i].sfx - known_sfx] = true;
+	}
+
+	for (i = 0; i < cmd->entnum; i++)
+	{
+		sfx_t *sfx = &known_sfx[i];
+		if (!playing[i] && S_CachedSound (sfx) && (now - Atomic_LoadUInt32 (&sfx->lastused)) > SND_CACHE_MINAGE)
+			candidates[num_candidates++] = sfx;
+	}
+
+	// oldest first
+	qsort (candidates, num_candidates, sizeof (sfx_t *), S_CompareLastUsed);
+
+	SDL_LockMutex (snd_mutex);
+	for (i = 0; i < num_candidates && S_CacheBytes () > cmd->cachebudget; i++)
+	{
+		// S_MarkUsed may have raced with the scan
+		if ((now - Atomic_LoadUInt32 (&candidates[i]->lastused)) > SND_CACHE_MINAGE)
+			S_FreeCache (candidates[i]);
+	}
+	SDL_UnlockMutex (snd_mutex);
+}
+
+/*
+============
+S_ExecuteListener
+
+Respatializes the channels for the new listener position
+============
+*/
+static void S_ExecuteListener (const sndcommand_t *cmd)
+{
+	static channel_t *active[MAX_CHANNELS];
+	int				  i, j;
+	int				  total;
+	channel_t		 *ch;
+	channel_t		 *combine;
+
+	VectorCopy (cmd->origin, mix_listener_origin);
+	VectorCopy (cmd->right, mix_listener_right);
+	mix_viewentity = cmd->entnum;
+	mix_pause_loops = cmd->pause_loops;
+	mix_hrtf = cmd->hrtf;
+
+	if (cmd->underwater >= 0.f)
+		S_SetUnderwaterIntensity (cmd->underwater, cmd->frametime);
+	for (i = 0; i < NUM_AMBIENTS && cmd->ambients >= 0; i++)
+	{
+		ch = &snd_channels[i];
+		if (cmd->ambients == 0)
+		{
+			ch->sfx = NULL;
+			continue;
+		}
+		ch->sfx = ambient_sfx[i];
+		ch->leftvol = ch->rightvol = ch->master_vol = cmd->ambient_levels[i];
+	}
 
 	combine = NULL;
 
 	// update spatialization for static and dynamic sounds
+	total = 0;
+	for (i = NUM_AMBIENTS; i < total_channels; i++)
+	{
+		if (snd_channels[i].sfx)
+			active[total++] = &snd_channels[i];
+	}
+	SND_SpatializeChannels (active, total);
+
 	ch = snd_channels + NUM_AMBIENTS;
 	for (i = NUM_AMBIENTS; i < total_channels; i++, ch++)
 	{
 		if (!ch->sfx)
 			continue;
-		SND_Spatialize (ch); // respatialize channel
 		if (!ch->leftvol && !ch->rightvol)
 			continue;
 
@@ -897,33 +1534,14 @@ void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 		}
 	}
 
-	//
-	// debugging output
-	//
-	if (snd_show.value)
+	total = 0;
+	ch = snd_channels;
+	for (i = 0; i < total_channels; i++, ch++)
 	{
-		total = 0;
-		ch = snd_channels;
-		for (i = 0; i < total_channels; i++, ch++)
-		{
-			if (ch->sfx && (ch->leftvol || ch->rightvol))
-			{
-				//	Con_Printf ("%3i %3i %s\n", ch->leftvol, ch->rightvol, ch->sfx->name);
-				total++;
-			}
-		}
-
-		Con_Printf ("----(%i)----\n", total);
+		if (ch->sfx && (ch->leftvol || ch->rightvol))
+			total++;
 	}
-
-	// add raw data from streamed samples
-	//	BGM_Update();	// moved to the main loop just before S_Update ()
-
-	// mix some sound
-	S_Update_ ();
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+	Atomic_StoreUInt32 (&snd_audiblechannels, total);
 }
 
 static void GetSoundtime (void)
@@ -947,7 +1565,7 @@ static void GetSoundtime (void)
 		{ // time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			paintedtime = fullsamples;
-			S_StopAllSounds (true, true);
+			S_StopAllSounds_ (true, true);
 		}
 	}
 	oldsamplepos = samplepos;
@@ -959,6 +1577,8 @@ void S_ExtraUpdate (void)
 {
 	if (snd_noextraupdate.value)
 		return; // don't pollute timings
+	if (snd_thread)
+		return; // the mixer thread keeps up on its own
 	S_Update_ ();
 }
 
@@ -967,17 +1587,15 @@ static void S_Update_ (void)
 	unsigned int endtime;
 	int			 samps;
 
-	if (!snd_initialized)
+	if (!snd_initialized || !sound_started || (snd_blocked > 0))
 		return;
 
-	SDL_LockMutex (snd_mutex);
-
-	if (!sound_started || (snd_blocked > 0))
-		goto unlock_mutex;
-
 	SNDDMA_LockBuffer ();
 	if (!shm->buffer)
-		goto unlock_mutex;
+	{
+		SNDDMA_Submit ();
+		return;
+	}
 
 	// Updates DMA time
 	GetSoundtime ();
@@ -994,45 +1612,28 @@ static void S_Update_ (void)
 	samps = shm->samples >> (shm->channels - 1);
 	endtime = q_min (endtime, (unsigned int)(soundtime + samps));
 
-	S_PaintChannels (endtime);
+	// music decoded ahead by the bgmusic tasks
+	BGM_MixRawSamples ();
 
-	SNDDMA_Submit ();
+	S_PaintChannels (endtime, mix_pause_loops);
 
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+	SNDDMA_Submit ();
 }
 
 void S_BlockSound (void)
 {
-	SDL_LockMutex (snd_mutex);
-	/* FIXME: do we really need the blocking at the
-	 * driver level?
-	 */
-	if (sound_started && snd_blocked == 0) /* ++snd_blocked == 1 */
-	{
-		snd_blocked = 1;
-		S_ClearBuffer ();
-		if (shm)
-			SNDDMA_BlockSound ();
-	}
-	SDL_UnlockMutex (snd_mutex);
+	sndcommand_t cmd = {SND_CMD_BLOCK};
+
+	if (sound_started)
+		S_PushCommand (&cmd);
 }
 
 void S_UnblockSound (void)
 {
-	SDL_LockMutex (snd_mutex);
-
-	if (!sound_started || !snd_blocked)
-		goto unlock_mutex;
-	if (snd_blocked == 1) /* --snd_blocked == 0 */
-	{
-		snd_blocked = 0;
-		SNDDMA_UnblockSound ();
-		S_ClearBuffer ();
-	}
+	sndcommand_t cmd = {SND_CMD_UNBLOCK};
 
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+	if (sound_started)
+		S_PushCommand (&cmd);
 }
 
 /*
@@ -1042,11 +1643,16 @@ S_ClearAll
 */
 void S_ClearAll (void)
 {
+	// the caches are about to go, the mixer must not be playing any of them
+	S_StopAllSounds (true, false);
+	S_SyncMixer ();
+	S_WaitAsyncLoads ();
+
 	SDL_LockMutex (snd_mutex);
 
 	for (int i = 0; i < num_sfx; ++i)
 	{
-		SAFE_FREE (known_sfx[i].cache);
+		S_FreeCache (&known_sfx[i]);
 	}
 
 	SDL_UnlockMutex (snd_mutex);
@@ -1111,6 +1717,9 @@ static void S_SoundList (void)
 	sfxcache_t *sc;
 	int			size;
 
+	// SND_CMD_EVICT only runs from commands, none get pushed while this prints
+	S_SyncMixer ();
+
 	size_t total = 0;
 	for (sfx = known_sfx, i = 0; i < num_sfx; i++, sfx++)
 	{
@@ -1126,33 +1735,79 @@ static void S_SoundList (void)
 		Con_SafePrintf ("(%2db) %9i : %s\n", sc->width * 8, size, sfx->name); // johnfitz -- was Con_Printf
 	}
 	Con_Printf ("%i sounds, %lu bytes\n", num_sfx, (unsigned long)total); // johnfitz -- added count
+	if (snd_cachesize.value > 0.f)
+		Con_Printf ("cache %.1f / %.0f MB\n", S_CacheBytes () / (1024.0 * 1024.0), snd_cachesize.value);
 }
 
 void S_LocalSound (const char *name)
 {
 	sfx_t *sfx;
 
-	SDL_LockMutex (snd_mutex);
-
 	if (nosound.value)
-		goto unlock_mutex;
+		return;
 	if (!sound_started)
-		goto unlock_mutex;
+		return;
 
 	sfx = S_PrecacheSound (name);
 	if (!sfx)
 	{
 		Con_Printf ("S_LocalSound: can't cache %s\n", name);
-		goto unlock_mutex;
+		return;
 	}
 	S_StartSound (cl.viewentity, -1, sfx, vec3_origin, 1, 1);
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
 }
 
 void S_ClearPrecache (void) {}
 
-void S_BeginPrecaching (void) {}
+/*
+==================
+S_BeginPrecaching
 
-void S_EndPrecaching (void) {}
+S_PrecacheSound only looks sounds up until S_EndPrecaching,
+the loading itself is then done by worker tasks
+==================
+*/
+void S_BeginPrecaching (void)
+{
+	S_WaitPrecaching ();
+	num_precache_sfx = 0;
+	precache_queueing = true;
+}
+
+/*
+==================
+S_LoadSoundTask
+==================
+*/
+static void S_LoadSoundTask (int index, void *unused)
+{
+	S_LoadSound (precache_sfx[index]);
+}
+
+/*
+==================
+S_EndPrecaching
+
+Starts loading the queued sounds, returns without waiting for them
+==================
+*/
+void S_EndPrecaching (void)
+{
+	precache_queueing = false;
+	if (num_precache_sfx > 0)
+		precache_task = Task_AllocateAssignIndexedFuncAndSubmit (S_LoadSoundTask, num_precache_sfx, NULL, 0);
+}
+
+/*
+==================
+S_WaitPrecaching
+==================
+*/
+void S_WaitPrecaching (void)
+{
+	if (precache_task == INVALID_TASK_HANDLE)
+		return;
+	Task_Join (precache_task, TASK_TIMEOUT_INFINITE);
+	precache_task = INVALID_TASK_HANDLE;
+	num_precache_sfx = 0;
+}
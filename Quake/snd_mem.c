@@ -24,12 +24,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 extern SDL_Mutex *snd_mutex;
 
+// bytes held by all sfx_t caches, kept under snd_cachesize by SND_CMD_EVICT
+static atomic_uint64_t snd_cachebytes;
+// S_LoadSoundAsync tasks that haven't published their sfx_t yet
+static atomic_uint32_t snd_asyncloads;
+
 /*
 ================
 ResampleSfx
 ================
 */
-static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
+static void ResampleSfx (sfxcache_t *sc, int inrate, int inwidth, byte *data)
 {
 	int	  outcount;
 	int	  srcsample;
@@ -37,8 +42,6 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	int	  i;
 	int	  sample, fracstep;
 
-	sfxcache_t *sc = sfx->cache;
-
 	stepscale = (float)inrate / shm->speed; // this is usually 0.5, 1, or 2
 
 	outcount = sc->length / stepscale;
@@ -85,6 +88,80 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 
 //=============================================================================
 
+/*
+==============
+S_CachedSound
+
+Never loads, so it is safe on the mixer thread. The cache is
+only published once it is completely resampled
+==============
+*/
+sfxcache_t *S_CachedSound (sfx_t *s)
+{
+	sfxcache_t *sc = s->cache;
+	Atomic_ReadBarrier ();
+	return sc;
+}
+
+/*
+==============
+S_CacheTime
+
+Milliseconds, the same clock on every thread, wraps around harmlessly
+in unsigned differences
+==============
+*/
+uint32_t S_CacheTime (void)
+{
+	return (uint32_t)(Sys_DoubleTime () * 1000.0);
+}
+
+/*
+==============
+S_MarkUsed
+
+Called on the main thread before a sound is started, eviction skips
+sounds used within the last SND_CACHE_MINAGE
+==============
+*/
+void S_MarkUsed (sfx_t *s)
+{
+	Atomic_StoreUInt32_Relaxed (&s->lastused, S_CacheTime ());
+}
+
+/*
+==============
+S_CacheBytes
+==============
+*/
+uint64_t S_CacheBytes (void)
+{
+	return Atomic_LoadUInt64 (&snd_cachebytes);
+}
+
+static size_t S_CacheSize (const sfxcache_t *sc)
+{
+	return sizeof (sfxcache_t) + (size_t)sc->length * sc->width * sc->stereo;
+}
+
+/*
+==============
+S_FreeCache
+
+With snd_mutex held, no channel may still be playing s
+==============
+*/
+void S_FreeCache (sfx_t *s)
+{
+	sfxcache_t *sc = s->cache;
+
+	if (!sc)
+		return;
+	s->cache = NULL;
+	Atomic_SubUInt64 (&snd_cachebytes, S_CacheSize (sc));
+	Mem_Free (sc);
+}
+
 /*
 ==============
 S_LoadSound
@@ -93,20 +170,20 @@ S_LoadSound
 sfxcache_t *S_LoadSound (sfx_t *s)
 {
 	char		namebuffer[256];
-	byte	   *data = NULL;
+	const byte *data = NULL;
+	int			filelen;
 	wavinfo_t	info;
 	int			len;
 	float		stepscale;
 	sfxcache_t *sc = NULL;
 
-	SDL_LockMutex (snd_mutex);
-
 	// see if still in memory
-	if (s->cache)
-	{
-		sc = s->cache;
-		goto unlock_mutex;
-	}
+	sc = S_CachedSound (s);
+	if (sc)
+		return sc;
+
+	// the file is loaded and resampled without holding snd_mutex so that
+	// precache tasks neither serialize on each other nor stall the mixer
 
 	//	Con_Printf ("S_LoadSound: %x\n", (int)stackbuf);
 
@@ -116,25 +193,26 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 	//	Con_Printf ("loading %s\n",namebuffer);
 
-	data = COM_LoadFile (namebuffer, NULL);
+	data = COM_LoadFileView (namebuffer, NULL, &filelen);
 
 	if (!data)
 	{
 		Con_Printf ("Couldn't load %s\n", namebuffer);
-		goto unlock_mutex;
+		return NULL;
 	}
 
-	info = GetWavinfo (s->name, data, com_filesize);
+	// GetWavinfo and ResampleSfx only read, so a view into a mapped pak is fine
+	info = GetWavinfo (s->name, (byte *)data, filelen);
 	if (info.channels != 1)
 	{
 		Con_Printf ("%s is a stereo sample\n", s->name);
-		goto unlock_mutex;
+		goto free_data;
 	}
 
 	if (info.width != 1 && info.width != 2)
 	{
 		Con_Printf ("%s is not 8 or 16 bit\n", s->name);
-		goto unlock_mutex;
+		goto free_data;
 	}
 
 	stepscale = (float)info.rate / shm->speed;
@@ -145,27 +223,82 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	if (info.samples == 0 || len == 0)
 	{
 		Con_Printf ("%s has zero samples\n", s->name);
-		goto unlock_mutex;
+		goto free_data;
 	}
 
-	sc = (sfxcache_t *)Mem_Alloc (len + sizeof (sfxcache_t));
+	sc = (sfxcache_t *)Mem_AllocTagged (len + sizeof (sfxcache_t), MEM_TAG_SOUND);
 	if (!sc)
-		goto unlock_mutex;
+		goto free_data;
 	sc->length = info.samples;
 	sc->loopstart = info.loopstart;
 	sc->speed = info.rate;
 	sc->width = info.width;
 	sc->stereo = info.channels;
 
-	s->cache = sc;
-	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
+	ResampleSfx (sc, sc->speed, sc->width, (byte *)data + info.dataofs);
 
-unlock_mutex:
-	Mem_Free (data);
+	// only publish fully resampled data, another thread may have won the race
+	SDL_LockMutex (snd_mutex);
+	if (s->cache)
+	{
+		Mem_Free (sc);
+		sc = s->cache;
+	}
+	else
+	{
+		Atomic_AddUInt64 (&snd_cachebytes, S_CacheSize (sc));
+		S_MarkUsed (s);
+		Atomic_WriteBarrier ();
+		s->cache = sc;
+	}
 	SDL_UnlockMutex (snd_mutex);
+
+free_data:
+	COM_FreeFileView (data);
 	return sc;
 }
 
+static void S_LoadSoundAsyncTask (void *payload)
+{
+	sfx_t *s = *(sfx_t **)payload;
+
+	S_LoadSound (s);
+	// cleared after the cache is published, a pending channel reads these in the opposite order
+	Atomic_StoreUInt32 (&s->loading, 0);
+	Atomic_DecrementUInt32 (&snd_asyncloads);
+}
+
+/*
+==============
+S_LoadSoundAsync
+
+Main thread, loads s on a worker unless it is cached or already loading.
+Channels started meanwhile wait for it, see channel_t.pending
+==============
+*/
+void S_LoadSoundAsync (sfx_t *s)
+{
+	uint32_t expected = 0;
+
+	if (S_CachedSound (s) || !Atomic_CompareExchangeUInt32 (&s->loading, &expected, 1))
+		return;
+	Atomic_IncrementUInt32 (&snd_asyncloads);
+	Task_AllocateAssignFuncAndSubmit (S_LoadSoundAsyncTask, &s, sizeof (s));
+}
+
+/*
+==============
+S_WaitAsyncLoads
+
+Main thread, before known_sfx entries are freed or moved
+==============
+*/
+void S_WaitAsyncLoads (void)
+{
+	while (Atomic_LoadUInt32 (&snd_asyncloads))
+		SDL_Delay (1);
+}
+
 /*
 ===============================================================================
 
@@ -174,11 +307,12 @@ WAV loading
 ===============================================================================
 */
 
-static byte *data_p;
-static byte *iff_end;
-static byte *last_chunk;
-static byte *iff_data;
-static int	 iff_chunk_len;
+// parser state is per thread, sounds are loaded from precache tasks
+static THREAD_LOCAL byte *data_p;
+static THREAD_LOCAL byte *iff_end;
+static THREAD_LOCAL byte *last_chunk;
+static THREAD_LOCAL byte *iff_data;
+static THREAD_LOCAL int	  iff_chunk_len;
 
 static short GetLittleShort (void)
 {
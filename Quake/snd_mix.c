@@ -33,10 +33,30 @@ static int snd_vol;
 
 static void Snd_WriteLinearBlastStereo16 (void)
 {
-	int i;
+	int i = 0;
 	int val;
 
-	for (i = 0; i < snd_linear_count; i += 2)
+#if defined(USE_SSE2)
+	for (; i + 8 <= snd_linear_count; i += 8)
+	{
+		__m128i lo = _mm_loadu_si128 ((const __m128i *)(snd_p + i));
+		__m128i hi = _mm_loadu_si128 ((const __m128i *)(snd_p + i + 4));
+		// val / 256 rounds towards zero, packs saturates to SHRT_MIN..SHRT_MAX
+		lo = _mm_srai_epi32 (_mm_add_epi32 (lo, _mm_srli_epi32 (_mm_srai_epi32 (lo, 31), 24)), 8);
+		hi = _mm_srai_epi32 (_mm_add_epi32 (hi, _mm_srli_epi32 (_mm_srai_epi32 (hi, 31), 24)), 8);
+		_mm_storeu_si128 ((__m128i *)(snd_out + i), _mm_packs_epi32 (lo, hi));
+	}
+#elif defined(USE_NEON)
+	for (; i + 8 <= snd_linear_count; i += 8)
+	{
+		int32x4_t lo = vld1q_s32 (snd_p + i);
+		int32x4_t hi = vld1q_s32 (snd_p + i + 4);
+		lo = vshrq_n_s32 (vaddq_s32 (lo, vreinterpretq_s32_u32 (vshrq_n_u32 (vreinterpretq_u32_s32 (vshrq_n_s32 (lo, 31)), 24))), 8);
+		hi = vshrq_n_s32 (vaddq_s32 (hi, vreinterpretq_s32_u32 (vshrq_n_u32 (vreinterpretq_u32_s32 (vshrq_n_s32 (hi, 31)), 24))), 8);
+		vst1q_s16 (snd_out + i, vcombine_s16 (vqmovn_s32 (lo), vqmovn_s32 (hi)));
+	}
+#endif
+	for (; i < snd_linear_count; i += 2)
 	{
 		val = snd_p[i] / 256;
 		if (val > SHRT_MAX)
@@ -196,7 +216,7 @@ static void S_MakeBlackmanWindowKernel (float *kernel, int M, float f_c)
 typedef struct
 {
 	float *memory;	   // kernelsize floats
-	float *kernel;	   // kernelsize floats
+	float *kernel;	   // kernelsize floats, grouped by phase: taps 0, 4, 8..., then 1, 5, 9... and so on
 	int	   kernelsize; // M+1, rounded up to be a multiple of 16
 	int	   M;		   // M value used to make kernel, even
 	int	   parity;	   // 0-3
@@ -221,8 +241,49 @@ static void S_UpdateFilter (filter_t *filter, int M, float f_c)
 		filter->memory = (float *)Mem_Alloc (filter->kernelsize * sizeof (float));
 		filter->kernel = (float *)Mem_Alloc (filter->kernelsize * sizeof (float));
 
-		S_MakeBlackmanWindowKernel (filter->kernel, M, f_c);
+		// only every 4th tap applies to an output sample, keeping those together
+		// lets S_FilterDotProduct run over contiguous taps and samples
+		TEMP_ALLOC_ZEROED (float, kernel, filter->kernelsize);
+		S_MakeBlackmanWindowKernel (kernel, M, f_c);
+		for (int i = 0; i < filter->kernelsize; i++)
+			filter->kernel[(i % 4) * (filter->kernelsize / 4) + (i / 4)] = kernel[i];
+		TEMP_FREE (kernel);
+	}
+}
+
+/*
+==============
+S_FilterDotProduct
+
+count must be a multiple of 4
+==============
+*/
+static FORCE_INLINE float S_FilterDotProduct (const float *taps, const float *samples, int count)
+{
+	int i;
+#if defined(USE_SSE2)
+	__m128 sum = _mm_setzero_ps ();
+	for (i = 0; i < count; i += 4)
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_loadu_ps (taps + i), _mm_loadu_ps (samples + i)));
+	sum = _mm_add_ps (sum, _mm_movehl_ps (sum, sum));
+	sum = _mm_add_ss (sum, _mm_shuffle_ps (sum, sum, _MM_SHUFFLE (1, 1, 1, 1)));
+	return _mm_cvtss_f32 (sum);
+#elif defined(USE_NEON)
+	float32x4_t sum = vdupq_n_f32 (0.0f);
+	for (i = 0; i < count; i += 4)
+		sum = vmlaq_f32 (sum, vld1q_f32 (taps + i), vld1q_f32 (samples + i));
+	return vaddvq_f32 (sum);
+#else
+	float sum[4] = {0, 0, 0, 0};
+	for (i = 0; i < count; i += 4)
+	{
+		sum[0] += taps[i] * samples[i];
+		sum[1] += taps[i + 1] * samples[i + 1];
+		sum[2] += taps[i + 2] * samples[i + 2];
+		sum[3] += taps[i + 3] * samples[i + 3];
 	}
+	return sum[0] + sum[1] + sum[2] + sum[3];
+#endif
 }
 
 /*
@@ -239,10 +300,10 @@ known to be 0 and skip 3/4 of the filter kernel.
 */
 static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
 {
-	int			 i, j;
-	const int	 kernelsize = filter->kernelsize;
-	const float *kernel = filter->kernel;
-	int			 parity;
+	int		  i, j;
+	const int kernelsize = filter->kernelsize;
+	const int phasesize = kernelsize / 4;
+	int		  parity, offset;
 
 	TEMP_ALLOC (float, input, filter->kernelsize + count);
 
@@ -258,31 +319,31 @@ static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
 	// copy out the last filter->kernelsize samples to 'memory' for next time
 	memcpy (filter->memory, input + count, filter->kernelsize * sizeof (float));
 
-	// apply the filter
+	// output sample i uses the taps j = (4 - parity) % 4 + 4n, which always land
+	// on the input samples at offset + 4n, gather just those
 	parity = filter->parity;
+	offset = (4 - parity) % 4;
+
+	TEMP_ALLOC (float, decimated, ((kernelsize + count) / 4) + 1);
+	for (i = offset, j = 0; i < kernelsize + count; i += 4, j++)
+		decimated[j] = input[i];
 
+	// apply the filter
 	for (i = 0; i < count; i++)
 	{
-		const float *input_plus_i = input + i;
-		float		 val[4] = {0, 0, 0, 0};
-
-		for (j = (4 - parity) % 4; j < kernelsize; j += 16)
-		{
-			val[0] += kernel[j] * input_plus_i[j];
-			val[1] += kernel[j + 4] * input_plus_i[j + 4];
-			val[2] += kernel[j + 8] * input_plus_i[j + 8];
-			val[3] += kernel[j + 12] * input_plus_i[j + 12];
-		}
+		const int phase = (4 - parity) % 4;
+		float	  val = S_FilterDotProduct (filter->kernel + (phase * phasesize), decimated + ((i + phase - offset) / 4), phasesize);
 
 		// 4.0 factor is to increase volume by 12 dB; this is to make up the
 		// volume drop caused by the zero-filling this filter does.
-		data[i * stride] = (val[0] + val[1] + val[2] + val[3]) * (32768.0 * 256.0 * 4.0);
+		data[i * stride] = val * (32768.0 * 256.0 * 4.0);
 
 		parity = (parity + 1) % 4;
 	}
 
 	filter->parity = parity;
 
+	TEMP_FREE (decimated);
 	TEMP_FREE (input);
 }
 
@@ -348,17 +409,17 @@ static struct
 
 extern cvar_t snd_waterfx;
 
-void S_SetUnderwaterIntensity (float target)
+void S_SetUnderwaterIntensity (float target, float frametime)
 {
 	target *= CLAMP (0.f, snd_waterfx.value, 2.f);
 	if (underwater.intensity < target)
 	{
-		underwater.intensity += host_frametime * 4.f;
+		underwater.intensity += frametime * 4.f;
 		underwater.intensity = q_min (underwater.intensity, target);
 	}
 	else if (underwater.intensity > target)
 	{
-		underwater.intensity -= host_frametime * 4.f;
+		underwater.intensity -= frametime * 4.f;
 		underwater.intensity = q_max (underwater.intensity, target);
 	}
 	underwater.alpha = exp (-underwater.intensity * log (12.f));
@@ -385,6 +446,49 @@ static void S_UnderwaterFilter (int endtime)
 	}
 }
 
+/*
+==============
+S_ClipPaintBuffer
+
+clip each sample to 0dB, then reduce by 6dB (to leave some headroom for
+the lowpass filter and the music). the lowpass will smooth out the
+clipping
+==============
+*/
+static void S_ClipPaintBuffer (int count)
+{
+	int *samples = (int *)paintbuffer;
+	int	 i = 0;
+
+	count *= 2;
+#if defined(USE_SSE2)
+	const __m128i max = _mm_set1_epi32 (32767 * 256);
+	const __m128i min = _mm_set1_epi32 (-32768 * 256);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(samples + i));
+		__m128i mask = _mm_cmpgt_epi32 (v, max);
+		v = _mm_or_si128 (_mm_and_si128 (mask, max), _mm_andnot_si128 (mask, v));
+		mask = _mm_cmplt_epi32 (v, min);
+		v = _mm_or_si128 (_mm_and_si128 (mask, min), _mm_andnot_si128 (mask, v));
+		// / 2 rounds towards zero
+		v = _mm_srai_epi32 (_mm_sub_epi32 (v, _mm_srai_epi32 (v, 31)), 1);
+		_mm_storeu_si128 ((__m128i *)(samples + i), v);
+	}
+#elif defined(USE_NEON)
+	const int32x4_t max = vdupq_n_s32 (32767 * 256);
+	const int32x4_t min = vdupq_n_s32 (-32768 * 256);
+	for (; i + 4 <= count; i += 4)
+	{
+		int32x4_t v = vmaxq_s32 (vminq_s32 (vld1q_s32 (samples + i), max), min);
+		v = vshrq_n_s32 (vsubq_s32 (v, vshrq_n_s32 (v, 31)), 1);
+		vst1q_s32 (samples + i, v);
+	}
+#endif
+	for (; i < count; i++)
+		samples[i] = CLAMP (-32768 * 256, samples[i], 32767 * 256) / 2;
+}
+
 /*
 ===============================================================================
 
@@ -395,18 +499,60 @@ CHANNEL MIXING
 
 static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
 static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
+static void SND_PaintChannelBinaural (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
 
-extern cvar_t snd_pauselooping;
+static int SND_VoiceScore (const channel_t *ch)
+{
+	return q_min (q_max (ch->leftvol, ch->rightvol), 255);
+}
 
-void S_PaintChannels (int endtime)
+/*
+=================
+SND_VoiceCutoff
+
+Lowest score a channel needs to be mixed this paint. Anything under
+snd_virtualvolume is inaudible anyway. With snd_maxvoices set, a histogram of
+the scores raises the cutoff until only the loudest voices are left; ties at
+the cutoff are all mixed.
+=================
+*/
+static int SND_VoiceCutoff (void)
+{
+	int				 i, cutoff, voices;
+	int				 histogram[256];
+	const channel_t *ch;
+
+	cutoff = q_max ((int)snd_virtualvolume.value, 1);
+	if (snd_maxvoices.value <= 0.f)
+		return cutoff;
+
+	memset (histogram, 0, sizeof (histogram));
+	ch = snd_channels;
+	for (i = 0; i < total_channels; i++, ch++)
+		if (ch->sfx && !ch->pending)
+			histogram[SND_VoiceScore (ch)]++;
+
+	voices = 0;
+	for (i = 255; i > cutoff; i--)
+	{
+		voices += histogram[i];
+		if (voices >= (int)snd_maxvoices.value)
+			return i;
+	}
+	return cutoff;
+}
+
+void S_PaintChannels (int endtime, qboolean pause_loops)
 {
 	int			i;
 	int			end, ltime, count;
+	int			cutoff;
+	qboolean	virtual_voice;
 	channel_t  *ch;
 	sfxcache_t *sc;
-	qboolean	pause_loops = snd_pauselooping.value && (cl.paused || (sv.active && svs.maxclients == 1 && key_dest != key_game));
 
 	snd_vol = sfxvolume.value * 256;
+	cutoff = SND_VoiceCutoff ();
 
 	while (paintedtime < endtime)
 	{
@@ -424,14 +570,30 @@ void S_PaintChannels (int endtime)
 		{
 			if (!ch->sfx)
 				continue;
-			if (!ch->leftvol && !ch->rightvol)
-				continue;
-			sc = S_LoadSound (ch->sfx);
+			if (ch->pending)
+			{
+				// the load task publishes the cache before it clears loading
+				qboolean loading = Atomic_LoadUInt32 (&ch->sfx->loading) != 0;
+				sc = S_CachedSound (ch->sfx);
+				if (!sc)
+				{
+					if (!loading)
+						ch->sfx = NULL; // couldn't load the sound's data
+					continue;
+				}
+				ch->pending = false;
+				ch->end = paintedtime + sc->length;
+			}
+			sc = S_CachedSound (ch->sfx);
 			if (!sc)
 				continue;
 			if (sc->loopstart >= 0 && pause_loops)
 				continue;
 
+			// virtual voices advance through the sound without painting, so
+			// they come back at the right spot once they get loud enough
+			virtual_voice = SND_VoiceScore (ch) < cutoff;
+
 			ltime = paintedtime;
 
 			while (ltime < end)
@@ -445,7 +607,11 @@ void S_PaintChannels (int endtime)
 				{
 					// the last param to SND_PaintChannelFrom is the index
 					// to start painting to in the paintbuffer, usually 0.
-					if (sc->width == 1)
+					if (virtual_voice)
+						ch->pos += count;
+					else if (ch->itd || ch->shadow)
+						SND_PaintChannelBinaural (ch, sc, count, ltime - paintedtime);
+					else if (sc->width == 1)
 						SND_PaintChannelFrom8 (ch, sc, count, ltime - paintedtime);
 					else
 						SND_PaintChannelFrom16 (ch, sc, count, ltime - paintedtime);
@@ -470,14 +636,7 @@ void S_PaintChannels (int endtime)
 			}
 		}
 
-		// clip each sample to 0dB, then reduce by 6dB (to leave some headroom for
-		// the lowpass filter and the music). the lowpass will smooth out the
-		// clipping
-		for (i = 0; i < end - paintedtime; i++)
-		{
-			paintbuffer[i].left = CLAMP (-32768 * 256, paintbuffer[i].left, 32767 * 256) / 2;
-			paintbuffer[i].right = CLAMP (-32768 * 256, paintbuffer[i].right, 32767 * 256) / 2;
-		}
+		S_ClipPaintBuffer (end - paintedtime);
 
 		// apply a lowpass filter
 		if (sndspeed.value == 11025 && shm->speed == 44100)
@@ -543,7 +702,7 @@ static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int
 	int			   data;
 	int			  *lscale, *rscale;
 	unsigned char *sfx;
-	int			   i;
+	int			   i = 0;
 
 	if (ch->leftvol > 255)
 		ch->leftvol = 255;
@@ -554,7 +713,42 @@ static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int
 	rscale = snd_scaletable[ch->rightvol >> 3];
 	sfx = (unsigned char *)sc->data + ch->pos;
 
-	for (i = 0; i < count; i++)
+	// the scale tables hold (signed char)data * scale[1]
+#if defined(USE_SSE2)
+	// (data << 8) * (scale >> 8) + data * (scale & 255) gives the same product
+	// from 16 bit lanes, as computed by _mm_madd_epi16
+	if ((lscale[1] >> 8) >= SHRT_MIN && (lscale[1] >> 8) <= SHRT_MAX && (rscale[1] >> 8) >= SHRT_MIN && (rscale[1] >> 8) <= SHRT_MAX)
+	{
+		const __m128i scale = _mm_setr_epi16 (
+			lscale[1] >> 8, lscale[1] & 255, rscale[1] >> 8, rscale[1] & 255, lscale[1] >> 8, lscale[1] & 255, rscale[1] >> 8, rscale[1] & 255);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i shifted = _mm_unpacklo_epi8 (_mm_setzero_si128 (), _mm_loadl_epi64 ((const __m128i *)(sfx + i)));
+			const __m128i lo = _mm_unpacklo_epi16 (shifted, _mm_srai_epi16 (shifted, 8));
+			const __m128i hi = _mm_unpackhi_epi16 (shifted, _mm_srai_epi16 (shifted, 8));
+			const __m128i pairs[4] = {_mm_unpacklo_epi32 (lo, lo), _mm_unpackhi_epi32 (lo, lo), _mm_unpacklo_epi32 (hi, hi), _mm_unpackhi_epi32 (hi, hi)};
+			for (int j = 0; j < 4; j++)
+			{
+				__m128i *out = (__m128i *)&paintbuffer[paintbufferstart + i + (j * 2)];
+				_mm_storeu_si128 (out, _mm_add_epi32 (_mm_loadu_si128 (out), _mm_madd_epi16 (pairs[j], scale)));
+			}
+		}
+	}
+#elif defined(USE_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		const int16x8_t data16 = vmovl_s8 (vreinterpret_s8_u8 (vld1_u8 (sfx + i)));
+		const int32x4_t data32[2] = {vmovl_s16 (vget_low_s16 (data16)), vmovl_s16 (vget_high_s16 (data16))};
+		for (int j = 0; j < 2; j++)
+		{
+			int32x4x2_t out = vld2q_s32 (&paintbuffer[paintbufferstart + i + (j * 4)].left);
+			out.val[0] = vmlaq_n_s32 (out.val[0], data32[j], lscale[1]);
+			out.val[1] = vmlaq_n_s32 (out.val[1], data32[j], rscale[1]);
+			vst2q_s32 (&paintbuffer[paintbufferstart + i + (j * 4)].left, out);
+		}
+	}
+#endif
+	for (; i < count; i++)
 	{
 		data = sfx[i];
 		paintbuffer[paintbufferstart + i].left += lscale[data];
@@ -570,7 +764,7 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, in
 	int			  left, right;
 	int			  leftvol, rightvol;
 	signed short *sfx;
-	int			  i;
+	int			  i = 0;
 
 	leftvol = ch->leftvol * snd_vol;
 	rightvol = ch->rightvol * snd_vol;
@@ -578,7 +772,37 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, in
 	rightvol /= 256;
 	sfx = (signed short *)sc->data + ch->pos;
 
-	for (i = 0; i < count; i++)
+#if defined(USE_SSE2)
+	// 32 bit products from the low and high halves of 16 bit multiplies, with
+	// every sample duplicated to match the left/right layout of the paintbuffer
+	if (leftvol >= SHRT_MIN && leftvol <= SHRT_MAX && rightvol >= SHRT_MIN && rightvol <= SHRT_MAX)
+	{
+		const __m128i vol = _mm_setr_epi16 (leftvol, rightvol, leftvol, rightvol, leftvol, rightvol, leftvol, rightvol);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i samples = _mm_loadu_si128 ((const __m128i *)(sfx + i));
+			const __m128i pairs[2] = {_mm_unpacklo_epi16 (samples, samples), _mm_unpackhi_epi16 (samples, samples)};
+			for (int j = 0; j < 2; j++)
+			{
+				const __m128i lo = _mm_mullo_epi16 (pairs[j], vol);
+				const __m128i hi = _mm_mulhi_epi16 (pairs[j], vol);
+				__m128i		 *out = (__m128i *)&paintbuffer[paintbufferstart + i + (j * 4)];
+				_mm_storeu_si128 (out, _mm_add_epi32 (_mm_loadu_si128 (out), _mm_unpacklo_epi16 (lo, hi)));
+				_mm_storeu_si128 (out + 1, _mm_add_epi32 (_mm_loadu_si128 (out + 1), _mm_unpackhi_epi16 (lo, hi)));
+			}
+		}
+	}
+#elif defined(USE_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		const int32x4_t samples = vmovl_s16 (vld1_s16 (sfx + i));
+		int32x4x2_t		out = vld2q_s32 (&paintbuffer[paintbufferstart + i].left);
+		out.val[0] = vmlaq_n_s32 (out.val[0], samples, leftvol);
+		out.val[1] = vmlaq_n_s32 (out.val[1], samples, rightvol);
+		vst2q_s32 (&paintbuffer[paintbufferstart + i].left, out);
+	}
+#endif
+	for (; i < count; i++)
 	{
 		data = sfx[i];
 		// this was causing integer overflow as observed in quakespasm
@@ -593,3 +817,61 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, in
 
 	ch->pos += count;
 }
+
+/*
+=================
+SND_BinauralSample
+
+16 bit scale sample at delayed, the position of the far ear. Right after
+a loop restart that ear is still hearing the end of the loop.
+=================
+*/
+static FORCE_INLINE int SND_BinauralSample (const sfxcache_t *sc, int pos, int delayed)
+{
+	if (sc->loopstart >= 0 && pos >= sc->loopstart && delayed < sc->loopstart)
+		delayed += sc->length - sc->loopstart;
+	if (delayed < 0)
+		return 0;
+	if (sc->width == 1)
+		return ((signed char)sc->data[delayed]) * 256;
+	return ((const signed short *)sc->data)[delayed];
+}
+
+/*
+=================
+SND_PaintChannelBinaural
+
+snd_hrtf: the far ear gets the sound ch->itd samples later, through a one
+pole lowpass for the head shadow. Scalar, only spatialized channels of the
+headphone mode pay for it.
+=================
+*/
+static void SND_PaintChannelBinaural (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+{
+	const int delay = abs (ch->itd);
+	const int coef = 256 - ch->shadow;
+	const int leftvol = ch->leftvol * snd_vol / 256;
+	const int rightvol = ch->rightvol * snd_vol / 256;
+	int		  state = ch->shadowstate;
+	int		  i, pos, direct;
+
+	for (i = 0; i < count; i++)
+	{
+		pos = ch->pos + i;
+		direct = SND_BinauralSample (sc, pos, pos);
+		state += ((SND_BinauralSample (sc, pos, pos - delay) - state) * coef) >> 8;
+		if (ch->itd >= 0)
+		{
+			paintbuffer[paintbufferstart + i].left += state * leftvol;
+			paintbuffer[paintbufferstart + i].right += direct * rightvol;
+		}
+		else
+		{
+			paintbuffer[paintbufferstart + i].left += direct * leftvol;
+			paintbuffer[paintbufferstart + i].right += state * rightvol;
+		}
+	}
+
+	ch->shadowstate = state;
+	ch->pos += count;
+}
@@ -65,6 +65,8 @@ static void SDLCALL paint_audio (void *unused, Uint8 *stream, int len)
 
 	if (shm->samplepos >= buffersize)
 		shm->samplepos = 0;
+
+	S_WakeMixer ();
 }
 
 qboolean SNDDMA_Init (dma_t *dma)
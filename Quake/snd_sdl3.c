@@ -63,6 +63,8 @@ static void SDLCALL paint_audio (void *userdata, SDL_AudioStream *stream, int ad
 
 	if (shm->samplepos >= shm->samples)
 		shm->samplepos = 0;
+
+	S_WakeMixer ();
 }
 
 qboolean SNDDMA_Init (dma_t *dma)
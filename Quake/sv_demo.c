@@ -0,0 +1,646 @@
+/*
+ * sv_demo.c -- server side multi-view demos
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+// sv_record writes a regular .dem from the server's point of view instead of a client's. Every frame
+// holds one svcfte_updateentities with the deltas of all the edicts against the previous frame, taken
+// from the states SV_PresendClientDatagrams shares between the clients, so the cost follows the number
+// of edicts and not the number of clients. Sounds and the broadcast datagram are written once.
+//
+// What only one player sees (the clientdata, damage and its reliable messages) goes in an svcvk_demoview
+// block per player, which the client skips unless it follows that player, see demo_follow.
+// The blocks are collected in large buffers that a background task writes out, like client demos.
+
+#define DEMO_WRITEBLOCK_SIZE (256 * 1024)
+#define DEMO_WRITE_INTERVAL	 1.0
+#define DEMO_PEXT2			 PEXT2_REPLACEMENTDELTAS // no PREDINFO, so the views carry plain svc_clientdata
+#define DEMO_MAX_ENTITY_SIZE 128					 // bytes an entity update or a view header can take
+
+typedef struct
+{
+	FILE *file;
+	byte *data;
+	int	  size;
+} svdemowrite_t;
+
+static FILE					*demo_file;
+static byte					*demo_writebuffers[2];
+static int					 demo_writebuffer; // the one being filled
+static int					 demo_writesize;
+static double				 demo_writetime;
+static task_handle_t		 demo_writetask = INVALID_TASK_HANDLE;
+static qboolean				 demo_spawned; // the signon went out, SV_DemoFrame can write frames
+
+// stands in for a client during the signon, so SV_SendPrespawn* write the demo's messages into its reliable buffer
+static client_t				 demo_client;
+static sizebuf_t *const		 demo_msg = &demo_client.message;
+static byte					 demo_datagrambuf[MAX_DATAGRAM];
+static sizebuf_t			 demo_datagram; // events written once for all the views, see SV_DemoDatagram
+
+// the states the demo holds for each edict, the frame deltas go against them
+static entity_state_t		*demo_states;
+static int					 demo_maxstates;
+static int					 demo_numsent; // edicts at and above it have never been sent
+static uint32_t				 demo_sent[(MAX_EDICTS + 31) / 32];
+
+/*
+====================
+SV_DemoWriteTask
+====================
+*/
+static void SV_DemoWriteTask (void *payload)
+{
+	svdemowrite_t *write = (svdemowrite_t *)payload;
+
+	fwrite (write->data, write->size, 1, write->file);
+	fflush (write->file);
+}
+
+/*
+====================
+SV_DemoFlushWrite
+
+Hands the block being filled to the writer task, and fills the other one meanwhile
+====================
+*/
+static void SV_DemoFlushWrite (void)
+{
+	svdemowrite_t write;
+
+	demo_writetime = realtime;
+	if (!demo_writesize)
+		return;
+
+	if (demo_writetask != INVALID_TASK_HANDLE)
+		Task_Join (demo_writetask, TASK_TIMEOUT_INFINITE);
+	write.file = demo_file;
+	write.data = demo_writebuffers[demo_writebuffer];
+	write.size = demo_writesize;
+	demo_writetask = Task_AllocateAssignBackgroundFuncAndSubmit (SV_DemoWriteTask, &write, sizeof (write));
+
+	demo_writebuffer ^= 1;
+	demo_writesize = 0;
+}
+
+/*
+====================
+SV_DemoWriteRaw
+====================
+*/
+static void SV_DemoWriteRaw (const void *data, int size)
+{
+	const byte *in = (const byte *)data;
+	int			count;
+
+	while (size > 0)
+	{
+		if (demo_writesize == DEMO_WRITEBLOCK_SIZE)
+			SV_DemoFlushWrite ();
+		count = q_min (size, DEMO_WRITEBLOCK_SIZE - demo_writesize);
+		memcpy (demo_writebuffers[demo_writebuffer] + demo_writesize, in, count);
+		demo_writesize += count;
+		in += count;
+		size -= count;
+	}
+}
+
+/*
+====================
+SV_DemoEndMessage
+
+Writes out demo_msg as a demo message. The view angles of the message are
+unused, a followed view sets them with its svcvk_demoview
+====================
+*/
+static void SV_DemoEndMessage (void)
+{
+	int	  len;
+	float angles[3] = {0.f, 0.f, 0.f};
+
+	if (!demo_msg->cursize)
+		return;
+
+	len = LittleLong (demo_msg->cursize);
+	SV_DemoWriteRaw (&len, 4);
+	SV_DemoWriteRaw (angles, sizeof (angles));
+	SV_DemoWriteRaw (demo_msg->data, demo_msg->cursize);
+	SZ_Clear (demo_msg);
+}
+
+/*
+====================
+SV_DemoReserve
+
+Starts a new message if size bytes don't fit in the current one
+====================
+*/
+static void SV_DemoReserve (int size)
+{
+	if (demo_msg->cursize + size > demo_msg->maxsize)
+		SV_DemoEndMessage ();
+}
+
+/*
+====================
+SV_DemoRecording
+====================
+*/
+qboolean SV_DemoRecording (void)
+{
+	return demo_file != NULL;
+}
+
+/*
+====================
+SV_DemoDatagram
+
+Where events that every client is sent the same way go to be written once,
+NULL if no demo is being recorded
+====================
+*/
+sizebuf_t *SV_DemoDatagram (void)
+{
+	return demo_spawned ? &demo_datagram : NULL;
+}
+
+/*
+====================
+SV_DemoPrespawn
+
+Runs one of the resumable SV_SendPrespawn* functions until it is done,
+starting a new message each time it fills one
+====================
+*/
+static void SV_DemoPrespawn (int (*send) (int idx))
+{
+	int idx = 0;
+
+	while ((idx = send (idx)) >= 0)
+		SV_DemoEndMessage ();
+}
+
+/*
+====================
+SV_DemoSignon
+
+Writes everything a client is sent before it spawns, for the map that is
+running. A demo that was already going on changes to it
+====================
+*/
+void SV_DemoSignon (void)
+{
+	client_t	*client;
+	client_t	*save_client;
+	const char **s;
+	int			 i;
+
+	if (!demo_file || !sv.active)
+		return;
+
+	demo_spawned = false;
+	SV_DemoEndMessage ();
+	SZ_Clear (&demo_datagram);
+	memset (demo_sent, 0, sizeof (demo_sent));
+	demo_numsent = 0;
+
+	save_client = host_client;
+	host_client = &demo_client;
+	demo_client.protocol_pext2 = DEMO_PEXT2;
+	demo_client.limit_models = MAX_MODELS;
+	demo_client.limit_sounds = MAX_SOUNDS;
+	demo_client.signon_sounds = 1;
+
+	// the sounds follow as svcdp_precache, the way SV_SendServerinfo does when they don't fit
+	MSG_WriteByte (demo_msg, svc_serverinfo);
+	MSG_WriteLong (demo_msg, PROTOCOL_FTE_PEXT2);
+	MSG_WriteLong (demo_msg, DEMO_PEXT2);
+	MSG_WriteLong (demo_msg, sv.protocol);
+	if (sv.protocol == PROTOCOL_RMQ)
+		MSG_WriteLong (demo_msg, sv.protocolflags);
+	MSG_WriteByte (demo_msg, svs.maxclients);
+	if (!coop.value && deathmatch.value)
+		MSG_WriteByte (demo_msg, GAME_DEATHMATCH);
+	else
+		MSG_WriteByte (demo_msg, GAME_COOP);
+	MSG_WriteString (demo_msg, PR_GetString (qcvm->edicts->v.message));
+	for (i = 1, s = sv.model_precache + 1; i < MAX_MODELS && *s; s++, i++)
+		MSG_WriteString (demo_msg, *s);
+	MSG_WriteByte (demo_msg, 0);
+	MSG_WriteByte (demo_msg, 0);
+	MSG_WriteByte (demo_msg, svc_cdtrack);
+	MSG_WriteByte (demo_msg, qcvm->edicts->v.sounds);
+	MSG_WriteByte (demo_msg, qcvm->edicts->v.sounds);
+	MSG_WriteByte (demo_msg, svc_setview);
+	MSG_WriteShort (demo_msg, 1);
+	MSG_WriteByte (demo_msg, svc_signonnum);
+	MSG_WriteByte (demo_msg, 1);
+	if (demo_msg->overflowed)
+	{
+		Con_Printf ("Server demo: the model precaches don't fit in a message, stopping\n");
+		host_client = save_client;
+		SZ_Clear (demo_msg);
+		SV_DemoStop ();
+		return;
+	}
+	SV_DemoEndMessage ();
+
+	// prespawn
+	while (SV_SendPrespawnSoundPrecaches ())
+		SV_DemoEndMessage ();
+	SV_DemoPrespawn (SV_SendPrespawnParticlePrecaches);
+	SV_DemoPrespawn (SV_SendPrespawnBaselines);
+	SV_DemoPrespawn (SV_SendPrespawnStatics);
+	SV_DemoPrespawn (SV_SendAmbientSounds);
+	SV_DemoReserve (sv.signon.cursize + 2);
+	SZ_Write (demo_msg, sv.signon.data, sv.signon.cursize);
+	MSG_WriteByte (demo_msg, svc_signonnum);
+	MSG_WriteByte (demo_msg, 2);
+	SV_DemoEndMessage ();
+	host_client = save_client;
+
+	// spawn
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		SV_DemoReserve (MAX_SCOREBOARDNAME + 16);
+		MSG_WriteByte (demo_msg, svc_updatename);
+		MSG_WriteByte (demo_msg, i);
+		MSG_WriteString (demo_msg, client->name);
+		MSG_WriteByte (demo_msg, svc_updatefrags);
+		MSG_WriteByte (demo_msg, i);
+		MSG_WriteShort (demo_msg, client->active ? client->edict->v.frags : 0);
+		MSG_WriteByte (demo_msg, svc_updatecolors);
+		MSG_WriteByte (demo_msg, i);
+		MSG_WriteByte (demo_msg, client->colors);
+	}
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		if (!sv.lightstyles[i])
+			continue;
+		SV_DemoReserve (strlen (sv.lightstyles[i]) + 3);
+		MSG_WriteByte (demo_msg, svc_lightstyle);
+		MSG_WriteByte (demo_msg, i);
+		MSG_WriteString (demo_msg, sv.lightstyles[i]);
+	}
+	SV_DemoReserve (5);
+	MSG_WriteByte (demo_msg, svc_setview);
+	MSG_WriteShort (demo_msg, 1);
+	MSG_WriteByte (demo_msg, svc_signonnum);
+	MSG_WriteByte (demo_msg, 3);
+	SV_DemoEndMessage ();
+
+	demo_spawned = true;
+}
+
+/*
+====================
+SV_DemoBeginView
+
+Starts the svcvk_demoview block of a player, returns where its length goes
+====================
+*/
+static int SV_DemoBeginView (client_t *client, int size)
+{
+	int i, ofs;
+
+	SV_DemoReserve (size + 12);
+	MSG_WriteByte (demo_msg, svcvk_demoview);
+	MSG_WriteByte (demo_msg, client - svs.clients);
+	for (i = 0; i < 3; i++)
+		MSG_WriteAngle16 (demo_msg, client->edict->v.v_angle[i], sv.protocolflags);
+	ofs = demo_msg->cursize;
+	MSG_WriteLong (demo_msg, 0);
+	return ofs;
+}
+
+static void SV_DemoEndView (int ofs)
+{
+	int len = demo_msg->cursize - ofs - 4;
+
+	demo_msg->data[ofs + 0] = len & 0xff;
+	demo_msg->data[ofs + 1] = (len >> 8) & 0xff;
+	demo_msg->data[ofs + 2] = (len >> 16) & 0xff;
+	demo_msg->data[ofs + 3] = (len >> 24) & 0xff;
+}
+
+/*
+====================
+SV_DemoWriteViews
+
+The clientdata of every spawned player, called before the datagrams are sent
+and the damage is cleared
+====================
+*/
+void SV_DemoWriteViews (void)
+{
+	client_t *client;
+	edict_t	 *other;
+	int		  i, j, ofs;
+
+	if (!demo_spawned)
+		return;
+
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		if (!client->active || !client->spawned)
+			continue;
+
+		ofs = SV_DemoBeginView (client, DEMO_MAX_ENTITY_SIZE);
+		if (client->edict->v.dmg_take || client->edict->v.dmg_save)
+		{ // as SV_WriteDamageToMessage, which clears them once the client's datagram has it
+			other = PROG_TO_EDICT (client->edict->v.dmg_inflictor);
+			MSG_WriteByte (demo_msg, svc_damage);
+			MSG_WriteByte (demo_msg, client->edict->v.dmg_save);
+			MSG_WriteByte (demo_msg, client->edict->v.dmg_take);
+			for (j = 0; j < 3; j++)
+				MSG_WriteCoord (demo_msg, other->v.origin[j] + 0.5 * (other->v.mins[j] + other->v.maxs[j]), sv.protocolflags);
+		}
+		SV_WriteClientdataToMessage (client, demo_msg);
+		SV_DemoEndView (ofs);
+	}
+}
+
+/*
+====================
+SV_DemoWriteReliable
+
+Copies a reliable message of a spawned player as it is sent
+====================
+*/
+void SV_DemoWriteReliable (client_t *client, sizebuf_t *message)
+{
+	int ofs;
+
+	if (!demo_spawned || !message->cursize)
+		return;
+	if (message->cursize + 12 > demo_msg->maxsize)
+	{
+		Con_DPrintf ("Server demo: dropped a %i byte reliable message of %s\n", message->cursize, client->name);
+		return;
+	}
+
+	ofs = SV_DemoBeginView (client, message->cursize);
+	SZ_Write (demo_msg, message->data, message->cursize);
+	SV_DemoEndView (ofs);
+}
+
+/*
+====================
+SV_DemoBeginEntities
+====================
+*/
+static void SV_DemoBeginEntities (void)
+{
+	SV_DemoReserve (7 + DEMO_MAX_ENTITY_SIZE);
+	MSG_WriteByte (demo_msg, svcfte_updateentities);
+	MSG_WriteFloat (demo_msg, qcvm->time);
+}
+
+/*
+====================
+SV_DemoWriteEntities
+
+Deltas every edict against what the demo last had for it, once for all the
+views. An update that doesn't fit goes in a new svcfte_updateentities
+====================
+*/
+static void SV_DemoWriteEntities (void)
+{
+	const entity_state_t *states;
+	entity_state_t		 *state;
+	int					  numstates, e, last;
+	unsigned int		  bits;
+	qboolean			  present, sent;
+
+	states = SV_FrameEntityStates (&numstates);
+	if (!states)
+		return;
+
+	if (numstates > demo_maxstates)
+	{
+		demo_maxstates = numstates;
+		demo_states = Mem_Realloc (demo_states, demo_maxstates * sizeof (entity_state_t));
+	}
+
+	SV_DemoBeginEntities ();
+	last = q_max (numstates, demo_numsent);
+	for (e = 1; e < last; e++)
+	{
+		present = e < numstates && (e <= svs.maxclients || states[e].modelindex);
+		sent = (demo_sent[e / 32] >> (e % 32)) & 1;
+		if (!present && !sent)
+			continue;
+
+		if (demo_msg->cursize + DEMO_MAX_ENTITY_SIZE + 2 > demo_msg->maxsize)
+		{
+			MSG_WriteShort (demo_msg, 0);
+			SV_DemoEndMessage ();
+			SV_DemoBeginEntities ();
+		}
+
+		if (!present)
+		{
+			if (e > 0x3fff)
+			{
+				MSG_WriteShort (demo_msg, 0xc000 | (e & 0x3fff));
+				MSG_WriteByte (demo_msg, e >> 14);
+			}
+			else
+				MSG_WriteShort (demo_msg, 0x8000 | e);
+			demo_sent[e / 32] &= ~(1u << (e % 32));
+			continue;
+		}
+
+		state = &demo_states[e];
+		if (sent)
+			bits = MSGFTE_DeltaCalcBits (state, (entity_state_t *)&states[e]);
+		else
+			bits = UF_RESET | MSGFTE_DeltaCalcBits (&EDICT_NUM (e)->baseline, (entity_state_t *)&states[e]);
+#ifdef LERP_BANDAID
+		bits &= ~UF_UNUSED2;
+#endif
+		if (!bits)
+			continue;
+
+		*state = states[e];
+		if (e >= 0x4000)
+		{
+			MSG_WriteShort (demo_msg, 0x4000 | (e & 0x3fff));
+			MSG_WriteByte (demo_msg, e >> 14);
+		}
+		else
+			MSG_WriteShort (demo_msg, e);
+		MSGFTE_WriteEntityUpdate (bits, state, demo_msg, DEMO_PEXT2, sv.protocolflags);
+		demo_sent[e / 32] |= 1u << (e % 32);
+	}
+	MSG_WriteShort (demo_msg, 0);
+	demo_numsent = numstates;
+}
+
+/*
+====================
+SV_DemoFrame
+
+Called once the clients have been sent the frame. The views are already in
+demo_msg, adds the entities and the events and writes the message
+====================
+*/
+void SV_DemoFrame (void)
+{
+	if (!demo_spawned)
+		return;
+
+	SV_DemoWriteEntities ();
+
+	SV_DemoReserve (demo_datagram.cursize);
+	SZ_Write (demo_msg, demo_datagram.data, demo_datagram.cursize);
+	SZ_Clear (&demo_datagram);
+	if (sv.datagram.cursize <= demo_msg->maxsize)
+	{
+		SV_DemoReserve (sv.datagram.cursize);
+		SZ_Write (demo_msg, sv.datagram.data, sv.datagram.cursize);
+	}
+	SV_DemoEndMessage ();
+
+	// so a crash loses little, without waiting on the disk
+	if (realtime - demo_writetime >= DEMO_WRITE_INTERVAL && (demo_writetask == INVALID_TASK_HANDLE || Task_Join (demo_writetask, 0)))
+		SV_DemoFlushWrite ();
+}
+
+/*
+====================
+SV_DemoStop
+
+Finishes the demo being recorded, if any
+====================
+*/
+void SV_DemoStop (void)
+{
+	int i;
+
+	if (!demo_file)
+		return;
+
+	SZ_Clear (demo_msg);
+	MSG_WriteByte (demo_msg, svc_disconnect);
+	SV_DemoEndMessage ();
+	SV_DemoFlushWrite ();
+	if (demo_writetask != INVALID_TASK_HANDLE)
+		Task_Join (demo_writetask, TASK_TIMEOUT_INFINITE);
+	demo_writetask = INVALID_TASK_HANDLE;
+
+	fclose (demo_file);
+	demo_file = NULL;
+	demo_spawned = false;
+	for (i = 0; i < 2; i++)
+	{
+		Mem_Free (demo_writebuffers[i]);
+		demo_writebuffers[i] = NULL;
+	}
+	Mem_Free (demo_states);
+	demo_states = NULL;
+	demo_maxstates = 0;
+	Con_Printf ("Completed server demo\n");
+
+	DemoList_Rebuild ();
+}
+
+/*
+====================
+SV_Record_f
+
+sv_record <demoname>
+====================
+*/
+void SV_Record_f (void)
+{
+	char name[MAX_OSPATH];
+	int	 i;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("sv_record <demoname>\n");
+		return;
+	}
+
+	if (strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	SV_DemoStop ();
+
+	q_snprintf (name, sizeof (name), "%s/%s", com_gamedir, Cmd_Argv (1));
+	COM_AddExtension (name, ".dem", sizeof (name));
+
+	demo_file = fopen (name, "wb");
+	if (!demo_file)
+	{
+		Con_Printf ("ERROR: couldn't create %s\n", name);
+		return;
+	}
+	Con_Printf ("recording server demo to %s.\n", name);
+	fprintf (demo_file, "%i\n", -1);
+
+	for (i = 0; i < 2; i++)
+		demo_writebuffers[i] = Mem_AllocNonZero (DEMO_WRITEBLOCK_SIZE);
+	demo_writebuffer = 0;
+	demo_writesize = 0;
+	demo_writetime = realtime;
+	demo_client.message.data = demo_client.msgbuf;
+	demo_client.message.maxsize = sizeof (demo_client.msgbuf);
+	demo_client.message.allowoverflow = true;
+	SZ_Clear (demo_msg);
+	demo_datagram.data = demo_datagrambuf;
+	demo_datagram.maxsize = sizeof (demo_datagrambuf);
+
+	PR_SwitchQCVM (&sv.qcvm);
+	SV_DemoSignon ();
+	PR_SwitchQCVM (NULL);
+}
+
+/*
+====================
+SV_Stop_f
+====================
+*/
+void SV_Stop_f (void)
+{
+	if (cmd_source != src_command)
+		return;
+
+	if (!demo_file)
+	{
+		Con_Printf ("Not recording a server demo.\n");
+		return;
+	}
+
+	SV_DemoStop ();
+}
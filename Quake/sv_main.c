@@ -36,6 +36,9 @@ unsigned int sv_protocol_pext2 = PEXT2_SUPPORTED_SERVER; // spike
 
 static cvar_t sv_netsort = {"sv_netsort", "1", CVAR_NONE};
 static cvar_t sv_smoothplatformlerps = {"sv_smoothplatformlerps", "1", CVAR_NONE};
+static cvar_t sv_parallelsnapshots = {"sv_parallelsnapshots", "1", CVAR_ARCHIVE}; // build the snapshots of FTE clients on the workers
+static cvar_t sv_compression = {"sv_compression", "1", CVAR_NONE}; // VKPEXT_DEFLATE: 1 = reliable stream, 2 = large unreliables too
+static cvar_t sv_maxrate = {"sv_maxrate", "0", CVAR_NONE}; // bytes per second of entity updates to each FTE client, 0 = unlimited
 
 extern cvar_t nomonsters;
 
@@ -61,9 +64,39 @@ static qboolean SV_UsePredThinkPos (edict_t *ent)
 
 //============================================================================
 
+/*
+=================
+SV_WeaponModelIndex
+
+v.weaponmodel only changes on weapon switches, so check the last index
+before searching the whole precache list
+=================
+*/
+static unsigned int SV_WeaponModelIndex (client_t *client)
+{
+	const char *name = PR_GetString (client->edict->v.weaponmodel);
+	int			index = client->weaponmodel_index;
+
+	if (!name || !name[0])
+		return 0;
+	if (index <= 0 || index >= MAX_MODELS || !sv.model_precache[index] || strcmp (sv.model_precache[index], name))
+		index = client->weaponmodel_index = SV_ModelIndex (name);
+	if ((unsigned int)index >= client->limit_models)
+		return 0;
+	return index;
+}
+
+/*
+=================
+SV_CalcStats
+
+Only the first 32 stats and those in sv.customstats_mask are written, the rest are left untouched
+=================
+*/
 void SV_CalcStats (client_t *client, int *statsi, float *statsf, const char **statss)
 {
 	size_t	 i;
+	int		 w;
 	edict_t *ent = client->edict;
 	// FIXME: string stats!
 	int		 items;
@@ -73,13 +106,23 @@ void SV_CalcStats (client_t *client, int *statsi, float *statsf, const char **st
 	else
 		items = (int)((uint32_t)ent->v.items | ((uint32_t)pr_global_struct->serverflags << 28));
 
-	memset (statsi, 0, sizeof (*statsi) * MAX_CL_STATS);
-	memset (statsf, 0, sizeof (*statsf) * MAX_CL_STATS);
-	memset ((void *)statss, 0, sizeof (*statss) * MAX_CL_STATS);
+	memset (statsi, 0, sizeof (*statsi) * 32);
+	memset (statsf, 0, sizeof (*statsf) * 32);
+	memset ((void *)statss, 0, sizeof (*statss) * 32);
+	for (w = 1; w < MAX_CL_STATS / 32; w++)
+	{
+		uint32_t mask = sv.customstats_mask[w];
+		while (mask)
+		{
+			const int stat = w * 32 + FindFirstBitNonZero (mask);
+			statsi[stat] = 0;
+			statsf[stat] = 0;
+			statss[stat] = NULL;
+			mask &= mask - 1;
+		}
+	}
 	statsf[STAT_HEALTH] = ent->v.health;
-	statsi[STAT_WEAPON] = SV_ModelIndex (PR_GetString (ent->v.weaponmodel));
-	if ((unsigned int)statsi[STAT_WEAPON] >= client->limit_models)
-		statsi[STAT_WEAPON] = 0;
+	statsi[STAT_WEAPON] = SV_WeaponModelIndex (client);
 	statsf[STAT_AMMO] = ent->v.currentammo;
 	statsf[STAT_ARMOR] = ent->v.armorvalue;
 	statsf[STAT_WEAPONFRAME] = ent->v.weaponframe;
@@ -186,7 +229,7 @@ static unsigned int SVFTE_DeltaPredCalcBits (entity_state_t *from, entity_state_
 	return bits;
 }
 
-static unsigned int MSGFTE_DeltaCalcBits (entity_state_t *from, entity_state_t *to)
+unsigned int MSGFTE_DeltaCalcBits (entity_state_t *from, entity_state_t *to)
 {
 	unsigned int bits = 0;
 
@@ -248,7 +291,7 @@ static unsigned int MSGFTE_DeltaCalcBits (entity_state_t *from, entity_state_t *
 	return bits;
 }
 
-static void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state, sizebuf_t *msg, unsigned int pext2, unsigned int protocolflags)
+void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state, sizebuf_t *msg, unsigned int pext2, unsigned int protocolflags)
 {
 	unsigned int predbits = 0;
 	if (bits & UF_MOVETYPE)
@@ -429,9 +472,10 @@ static void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state,
 #endif
 }
 
-static struct entity_num_state_s *snapshot_entstate;
-static size_t					  snapshot_numents;
-static size_t					  snapshot_maxents;
+// spare snapshot buffer, swapped with the client's previous one, per thread for SV_PresendClientDatagrams
+static THREAD_LOCAL struct entity_num_state_s *snapshot_entstate;
+static THREAD_LOCAL size_t					   snapshot_numents;
+static THREAD_LOCAL size_t					   snapshot_maxents;
 
 void SVFTE_DestroyFrames (client_t *client)
 {
@@ -452,6 +496,9 @@ void SVFTE_DestroyFrames (client_t *client)
 	if (client->pendingentities_bits)
 		Mem_Free (client->pendingentities_bits);
 	client->pendingentities_bits = NULL;
+	if (client->pendingentities_senttime)
+		Mem_Free (client->pendingentities_senttime);
+	client->pendingentities_senttime = NULL;
 	client->numpendingentities = 0;
 
 	while (client->numframes > 0)
@@ -490,6 +537,7 @@ static void SVFTE_SetupFrames (client_t *client)
 
 	client->numpendingentities = qcvm->num_edicts;
 	client->pendingentities_bits = Mem_Alloc (client->numpendingentities * sizeof (*client->pendingentities_bits));
+	client->pendingentities_senttime = Mem_Alloc (client->numpendingentities * sizeof (*client->pendingentities_senttime));
 
 	client->pendingentities_bits[0] = UF_REMOVE;
 }
@@ -546,7 +594,8 @@ static void SVFTE_WriteStats (client_t *client, sizebuf_t *msg)
 	int					 statsi[MAX_CL_STATS];
 	float				 statsf[MAX_CL_STATS];
 	const char			*statss[MAX_CL_STATS];
-	int					 i;
+	int					 i, w;
+	uint32_t			 mask;
 	struct deltaframe_s *frame;
 	int					 sequence = NET_QSocketGetSequenceOut (client->netconnection);
 	int					 maxstats;
@@ -564,78 +613,84 @@ static void SVFTE_WriteStats (client_t *client, sizebuf_t *msg)
 	// figure out the current values in a nice easy way (yay for copying to make arrays easier!)
 	SV_CalcStats (client, statsi, statsf, statss);
 
-	for (i = 0; i < maxstats; i++)
+	// stats outside the first 32 and the custom ones are never written, so they stay zero along with their old values
+	for (w = 0; w < maxstats / 32; w++)
 	{
-		// small cleanup
-		if (!statsi[i])
-			statsi[i] = statsf[i];
-		else
-			statsf[i] = 0; // statsi[i];
-
-		// if it changed flag for sending
-		if (statsi[i] != client->oldstats_i[i] || statsf[i] != client->oldstats_f[i])
+		for (mask = w ? sv.customstats_mask[w] : ~0u; mask; mask &= mask - 1)
 		{
-			client->oldstats_i[i] = statsi[i];
-			client->oldstats_f[i] = statsf[i];
-			client->resendstatsnum[i / 32] |= 1u << (i & 31);
-		}
+			i = w * 32 + FindFirstBitNonZero (mask);
 
-		if (statss[i] || client->oldstats_s[i])
-		{
-			const char *os = client->oldstats_s[i];
-			const char *ns = statss[i];
-			if (!ns)
-				ns = "";
-			if (!os)
-				os = "";
-			if (strcmp (os, ns))
+			// small cleanup
+			if (!statsi[i])
+				statsi[i] = statsf[i];
+			else
+				statsf[i] = 0; // statsi[i];
+
+			// if it changed flag for sending
+			if (statsi[i] != client->oldstats_i[i] || statsf[i] != client->oldstats_f[i])
 			{
-				client->resendstatsstr[i / 32] |= 1u << (i & 31);
-				Mem_Free (client->oldstats_s[i]);
-				client->oldstats_s[i] = q_strdup (ns);
+				client->oldstats_i[i] = statsi[i];
+				client->oldstats_f[i] = statsf[i];
+				client->resendstatsnum[i / 32] |= 1u << (i & 31);
 			}
-		}
-
-		// if its flagged then unflag it, log it, and send it
-		if (client->resendstatsnum[i / 32] & (1u << (i & 31)))
-		{
-			client->resendstatsnum[i / 32] &= ~(1u << (i & 31));
-			frame->resendstatsnum[i / 32] |= 1u << (i & 31);
 
-			if ((double)statsi[i] != statsf[i] && statsf[i])
-			{ // didn't round nicely, so send as a float
-				MSG_WriteByte (msg, svcfte_updatestatfloat);
-				MSG_WriteByte (msg, i);
-				MSG_WriteFloat (msg, statsf[i]);
+			if (statss[i] || client->oldstats_s[i])
+			{
+				const char *os = client->oldstats_s[i];
+				const char *ns = statss[i];
+				if (!ns)
+					ns = "";
+				if (!os)
+					os = "";
+				if (strcmp (os, ns))
+				{
+					client->resendstatsstr[i / 32] |= 1u << (i & 31);
+					Mem_Free (client->oldstats_s[i]);
+					client->oldstats_s[i] = q_strdup (ns);
+				}
 			}
-			else
+
+			// if its flagged then unflag it, log it, and send it
+			if (client->resendstatsnum[i / 32] & (1u << (i & 31)))
 			{
-				if (statsi[i] < 0 || statsi[i] > 255)
-				{ // needs to be big
-					MSG_WriteByte (msg, svc_updatestat);
+				client->resendstatsnum[i / 32] &= ~(1u << (i & 31));
+				frame->resendstatsnum[i / 32] |= 1u << (i & 31);
+
+				if ((double)statsi[i] != statsf[i] && statsf[i])
+				{ // didn't round nicely, so send as a float
+					MSG_WriteByte (msg, svcfte_updatestatfloat);
 					MSG_WriteByte (msg, i);
-					MSG_WriteLong (msg, statsi[i]);
+					MSG_WriteFloat (msg, statsf[i]);
 				}
 				else
-				{ // can be fairly small
-					MSG_WriteByte (msg, svcdp_updatestatbyte);
-					MSG_WriteByte (msg, i);
-					MSG_WriteByte (msg, statsi[i]);
+				{
+					if (statsi[i] < 0 || statsi[i] > 255)
+					{ // needs to be big
+						MSG_WriteByte (msg, svc_updatestat);
+						MSG_WriteByte (msg, i);
+						MSG_WriteLong (msg, statsi[i]);
+					}
+					else
+					{ // can be fairly small
+						MSG_WriteByte (msg, svcdp_updatestatbyte);
+						MSG_WriteByte (msg, i);
+						MSG_WriteByte (msg, statsi[i]);
+					}
 				}
 			}
-		}
-		// if its flagged then unflag it, log it, and send it
-		if (client->resendstatsstr[i / 32] & (1u << (i & 31)))
-		{
-			client->resendstatsstr[i / 32] &= ~(1u << (i & 31));
-			frame->resendstatsstr[i / 32] |= 1u << (i & 31);
+			// if its flagged then unflag it, log it, and send it
+			if (client->resendstatsstr[i / 32] & (1u << (i & 31)))
+			{
+				client->resendstatsstr[i / 32] &= ~(1u << (i & 31));
+				frame->resendstatsstr[i / 32] |= 1u << (i & 31);
 
-			MSG_WriteByte (msg, svcfte_updatestatstring);
-			MSG_WriteByte (msg, i);
-			if (statss[i])
-				MSG_WriteString (msg, statss[i]);
-			else
-				MSG_WriteString (msg, NULL);
+				MSG_WriteByte (msg, svcfte_updatestatstring);
+				MSG_WriteByte (msg, i);
+				if (statss[i])
+					MSG_WriteString (msg, statss[i]);
+				else
+					MSG_WriteString (msg, NULL);
+			}
 		}
 	}
 }
@@ -648,6 +703,10 @@ static void SVFTE_CalcEntityDeltas (client_t *client)
 		int newmax = qcvm->num_edicts + 64;
 		client->pendingentities_bits = Mem_Realloc (client->pendingentities_bits, sizeof (*client->pendingentities_bits) * newmax);
 		memset (client->pendingentities_bits + client->numpendingentities, 0, sizeof (*client->pendingentities_bits) * (newmax - client->numpendingentities));
+		client->pendingentities_senttime = Mem_Realloc (client->pendingentities_senttime, sizeof (*client->pendingentities_senttime) * newmax);
+		memset (
+			client->pendingentities_senttime + client->numpendingentities, 0,
+			sizeof (*client->pendingentities_senttime) * (newmax - client->numpendingentities));
 		client->numpendingentities = newmax;
 	}
 
@@ -707,22 +766,149 @@ static void SVFTE_CalcEntityDeltas (client_t *client)
 	snapshot_numents = 0;
 	snapshot_maxents = (olds != NULL) ? (oldstop - olds) : 0;
 }
-static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflowsize)
+/*
+=============================================================================
+
+Entity update scheduling: when the snapshot doesn't fit in the rate the
+most important deltas go first and the rest stay pending for later frames
+
+=============================================================================
+*/
+
+#define SV_RATE_BURST	   0.1f	 // seconds of sv_maxrate the budget can save up
+#define SV_RATE_MINBURST   1024	 // but always enough for a couple of full entity resets
+#define SV_STARVE_TIME	   0.5f	 // entities pending for longer than this go before anything else
+#define SV_PRIORITY_RANGE  256.0f // distance at which an update is worth half as much
+
+typedef struct
+{
+	unsigned int			   num;
+	float					   priority;
+	struct entity_num_state_s *state; // NULL if the entity isn't in the snapshot
+} sventityorder_t;
+
+// only written and read by SVFTE_WriteEntitiesToClient, which runs on the main thread
+static sventityorder_t *sv_entityorder;
+static size_t			sv_numentityorder;
+static size_t			sv_maxentityorder;
+
+/*
+=================
+SVFTE_EntityPriority
+=================
+*/
+static float SVFTE_EntityPriority (client_t *client, unsigned int entnum, unsigned int entbits, const struct entity_num_state_s *state, const vec3_t vieworg)
+{
+	const float age = qcvm->time - client->pendingentities_senttime[entnum];
+	float		weight;
+	vec3_t		delta;
+
+	if (entnum == 0)
+		return FLT_MAX; // full reset, everything else is relative to it
+	if (age >= SV_STARVE_TIME)
+		return 1e10f + age; // oldest first, so nothing waits forever
+	if ((entbits & UF_REMOVE) || !state)
+		return 1e9f; // tiny, and a stale entity that doesn't exist anymore looks worse than a stale position
+
+	if (entnum <= (unsigned int)svs.maxclients)
+		weight = 4.0f;
+	else
+	{
+		const int movetype = (int)EDICT_NUM (entnum)->v.movetype;
+		if (movetype == MOVETYPE_FLYMISSILE || movetype == MOVETYPE_BOUNCE || movetype == MOVETYPE_TOSS)
+			weight = 3.0f;
+		else
+			weight = 1.0f;
+	}
+	if (entbits & (UF_RESET | UF_RESET2))
+		weight *= 2.0f; // the client has nothing to interpolate from yet
+
+	VectorSubtract (state->state.origin, vieworg, delta);
+	return weight * (1.0f + age * 10.0f) / (1.0f + VectorLength (delta) / SV_PRIORITY_RANGE);
+}
+
+static int SVFTE_CompareEntityOrder (const void *a, const void *b)
+{
+	const sventityorder_t *ea = (const sventityorder_t *)a;
+	const sventityorder_t *eb = (const sventityorder_t *)b;
+	if (ea->priority != eb->priority)
+		return (ea->priority > eb->priority) ? -1 : 1;
+	return (ea->num > eb->num) - (ea->num < eb->num);
+}
+
+/*
+=================
+SVFTE_PrioritizeEntities
+
+Collects the entities with pending bits into sv_entityorder, most important first.
+The client applies the records of an update in any order.
+=================
+*/
+static void SVFTE_PrioritizeEntities (client_t *client)
+{
+	struct entity_num_state_s *state = client->previousentities;
+	struct entity_num_state_s *stateend = state + client->numpreviousentities;
+	unsigned int			   entnum, entbits;
+	vec3_t					   vieworg;
+
+	VectorAdd (client->edict->v.origin, client->edict->v.view_ofs, vieworg);
+
+	sv_numentityorder = 0;
+	for (entnum = 0; entnum < client->numpendingentities; entnum++)
+	{
+		entbits = client->pendingentities_bits[entnum];
+		if (!(entbits & ~UF_RESET2))
+			continue; // nothing to send (if reset2 is still set, then leave it pending until there's more data
+
+		if (sv_numentityorder == sv_maxentityorder)
+		{
+			sv_maxentityorder = q_max (sv_maxentityorder * 2, 256);
+			sv_entityorder = Mem_Realloc (sv_entityorder, sizeof (*sv_entityorder) * sv_maxentityorder);
+		}
+		while (state < stateend && state->num < entnum)
+			state++;
+		sv_entityorder[sv_numentityorder].num = entnum;
+		sv_entityorder[sv_numentityorder].state = (state < stateend && state->num == entnum) ? state : NULL;
+		sv_entityorder[sv_numentityorder].priority = SVFTE_EntityPriority (client, entnum, entbits, sv_entityorder[sv_numentityorder].state, vieworg);
+		sv_numentityorder++;
+	}
+	qsort (sv_entityorder, sv_numentityorder, sizeof (*sv_entityorder), SVFTE_CompareEntityOrder);
+}
+
+/*
+=================
+SVFTE_WriteEntitiesToClient
+
+Returns true when the packet filled up before the budget did and the caller
+should send it and continue in a new one.
+=================
+*/
+static qboolean SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflowsize)
 {
-	struct entity_num_state_s *state, *stateend;
+	struct entity_num_state_s *state;
 	unsigned int			   entbits, logbits, netbits;
-	size_t					   entnum;
+	unsigned int			   entnum;
 	int						   sequence = NET_QSocketGetSequenceOut (client->netconnection);
 	size_t					   origmaxsize = msg->maxsize;
 	size_t					   rollbacksize; // I'm too lazy to figure out sizes (especially if someone updates this for bone states or whatever)
+	qboolean				   more = false;
+	const float				   rate = sv_maxrate.value;
 	struct deltaframe_s		  *frame = &client->frames[sequence & (client->numframes - 1)];
 	frame->sequence = sequence; // so we know that it wasn't stale later.
 	frame->timestamp = qcvm->time;
 
-	msg->maxsize = overflowsize;
+	if (client->snapshotresume == 0)
+	{
+		SVFTE_PrioritizeEntities (client);
+		if (rate > 0)
+		{
+			const float burst = q_max (rate * SV_RATE_BURST, SV_RATE_MINBURST);
+			client->entitybudget = q_min (client->entitybudget + rate * (float)(realtime - client->entitybudgettime), burst);
+		}
+		client->entitybudgettime = realtime;
+	}
 
-	state = client->previousentities;
-	stateend = state + client->numpreviousentities;
+	msg->maxsize = overflowsize;
 
 	MSG_WriteByte (msg, svcfte_updateentities);
 
@@ -730,11 +916,13 @@ static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_
 	if (client->protocol_pext2 & PEXT2_PREDINFO)
 		MSG_WriteShort (msg, (client->lastmovemessage & 0xffff));
 	MSG_WriteFloat (msg, frame->timestamp); // should be the time the last physics frame was run.
-	for (entnum = client->snapshotresume; entnum < client->numpendingentities; entnum++)
+	for (; client->snapshotresume < sv_numentityorder; client->snapshotresume++)
 	{
+		entnum = sv_entityorder[client->snapshotresume].num;
+		state = sv_entityorder[client->snapshotresume].state;
 		entbits = client->pendingentities_bits[entnum];
 		if (!(entbits & ~UF_RESET2))
-			continue; // nothing to send (if reset2 is still set, then leave it pending until there's more data
+			continue;
 
 		rollbacksize = msg->cursize;
 		client->pendingentities_bits[entnum] = 0;
@@ -750,49 +938,58 @@ static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_
 				MSG_WriteShort (msg, 0x8000 | entnum);
 			logbits = UF_REMOVE;
 		}
-		else
+		else if (state)
 		{
-			while (state < stateend && state->num < entnum)
-				state++;
-			if (state < stateend && state->num == entnum)
+			if (entbits & UF_RESET2)
 			{
-				if (entbits & UF_RESET2)
-				{
-					/*if reset2, then this is the second packet sent to the client and should have a forced reset (but which isn't tracked)*/
-					logbits = entbits & ~(UF_RESET | UF_RESET2);
-					netbits = UF_RESET | MSGFTE_DeltaCalcBits (&EDICT_NUM (entnum)->baseline, &state->state);
-					//					Con_Printf("RESET2 %u @ %i\n", (int)entnum, sequence);
-				}
-				else if (entbits & UF_RESET)
-				{
-					/*flag the entity for the next packet, so we always get two resets when it appears, to reduce the effects of packetloss on seeing rockets
-					 * etc*/
-					client->pendingentities_bits[entnum] = UF_RESET2;
-					netbits = UF_RESET | MSGFTE_DeltaCalcBits (&EDICT_NUM (entnum)->baseline, &state->state);
-					logbits = UF_RESET;
-					//					Con_Printf("RESET %u @ %i\n", (int)entnum, sequence);
-				}
-				else
-					logbits = netbits = entbits;
+				/*if reset2, then this is the second packet sent to the client and should have a forced reset (but which isn't tracked)*/
+				logbits = entbits & ~(UF_RESET | UF_RESET2);
+				netbits = UF_RESET | MSGFTE_DeltaCalcBits (&EDICT_NUM (entnum)->baseline, &state->state);
+				//				Con_Printf("RESET2 %u @ %i\n", (int)entnum, sequence);
+			}
+			else if (entbits & UF_RESET)
+			{
+				/*flag the entity for the next packet, so we always get two resets when it appears, to reduce the effects of packetloss on seeing rockets
+				 * etc*/
+				client->pendingentities_bits[entnum] = UF_RESET2;
+				netbits = UF_RESET | MSGFTE_DeltaCalcBits (&EDICT_NUM (entnum)->baseline, &state->state);
+				logbits = UF_RESET;
+				//				Con_Printf("RESET %u @ %i\n", (int)entnum, sequence);
+			}
+			else
+				logbits = netbits = entbits;
 
-				if (entnum >= 0x4000)
-				{
-					MSG_WriteShort (msg, 0x4000 | (entnum & 0x3fff));
-					MSG_WriteByte (msg, entnum >> 14);
-				}
-				else
-					MSG_WriteShort (msg, entnum);
-				//				SV_EmitDeltaEntIndex(msg, j, false, true);
-				MSGFTE_WriteEntityUpdate (netbits, &state->state, msg, client->protocol_pext2, sv.protocolflags);
+			if (entnum >= 0x4000)
+			{
+				MSG_WriteShort (msg, 0x4000 | (entnum & 0x3fff));
+				MSG_WriteByte (msg, entnum >> 14);
 			}
+			else
+				MSG_WriteShort (msg, entnum);
+			//			SV_EmitDeltaEntIndex(msg, j, false, true);
+			MSGFTE_WriteEntityUpdate (netbits, &state->state, msg, client->protocol_pext2, sv.protocolflags);
 		}
 
 		if ((size_t)msg->cursize + 2 > origmaxsize)
 		{
 			msg->cursize = rollbacksize;					// roll back
 			client->pendingentities_bits[entnum] = entbits; // make sure those bits get re-applied later.
+			more = true;
 			break;
 		}
+		if (rate > 0)
+		{
+			if ((float)(msg->cursize - rollbacksize) > client->entitybudget && entnum != 0)
+			{
+				// out of budget, whatever is left waits for the next frame and gains priority meanwhile
+				msg->cursize = rollbacksize;
+				client->pendingentities_bits[entnum] = entbits;
+				client->snapshotresume = sv_numentityorder;
+				break;
+			}
+			client->entitybudget -= msg->cursize - rollbacksize;
+		}
+		client->pendingentities_senttime[entnum] = qcvm->time;
 		if (frame->numents == frame->maxents)
 		{
 			frame->maxents += 64;
@@ -806,13 +1003,12 @@ static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_
 	msg->maxsize = origmaxsize;
 	MSG_WriteShort (msg, 0); // eom
 
-	// remember how far we got, so we can keep things flushed, instead of only updating the first N entities.
-	client->snapshotresume = entnum;
-
 	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
 		Con_DWarning ("%i byte packet exceeds standard limit of 1024.\n", msg->cursize);
 	dev_stats.packetsize = msg->cursize;
 	dev_peakstats.packetsize = q_max (msg->cursize, dev_peakstats.packetsize);
+
+	return more;
 }
 
 /*
@@ -873,13 +1069,128 @@ void SV_BuildEntityState (edict_t *ent, entity_state_t *state)
 #endif
 }
 
+// the fields the per client entity scans look at, mirrored into contiguous arrays once per frame
+static int	  sv_hot_numedicts;
+static float  sv_hot_modelindex[MAX_EDICTS]; // 0 if the edict has no visible model
+static vec3_t sv_hot_absmin[MAX_EDICTS];
+static vec3_t sv_hot_absmax[MAX_EDICTS];
+
+// bitsets over the edict numbers for the PVS scans, the other visible edicts come from qcvm->leafedicts
+#define EDICT_BITSET_WORDS ((MAX_EDICTS + 31) / 32)
+static uint32_t				 sv_hot_manyleafs[EDICT_BITSET_WORDS]; // touching MAX_ENT_LEAFS leafs
+static uint32_t				 sv_hot_noleafs[EDICT_BITSET_WORDS];   // with a visible model but outside of the world
+static THREAD_LOCAL uint32_t sv_visible_edicts[EDICT_BITSET_WORDS];
+
+/*
+=============
+SV_UpdateHotFields
+
+Called once QC is done for the frame, so each client's scan does not have to
+stride across every edict to find the few it may send.
+=============
+*/
+static void SV_UpdateHotFields (void)
+{
+	edict_t *ent;
+	int		 e;
+
+	sv_hot_numedicts = qcvm->num_edicts;
+	memset (sv_hot_manyleafs, 0, ((sv_hot_numedicts + 31) / 32) * sizeof (uint32_t));
+	memset (sv_hot_noleafs, 0, ((sv_hot_numedicts + 31) / 32) * sizeof (uint32_t));
+	for (e = 0, ent = qcvm->edicts; e < sv_hot_numedicts; e++, ent = NEXT_EDICT (ent))
+	{
+		if (ent->v.modelindex && PR_GetString (ent->v.model)[0])
+			sv_hot_modelindex[e] = ent->v.modelindex;
+		else
+			sv_hot_modelindex[e] = 0;
+		VectorCopy (ent->v.absmin, sv_hot_absmin[e]);
+		VectorCopy (ent->v.absmax, sv_hot_absmax[e]);
+
+		// ericw -- if ent->num_leafs == MAX_ENT_LEAFS, the ent is visible from too many leafs
+		// for us to say whether it's in the PVS, so don't try to vis cull it.
+		// this commonly happens with rotators, because they often have huge bboxes
+		// spanning the entire map, or really tall lifts, etc.
+		if (e && sv_hot_modelindex[e])
+		{
+			if (ent->num_leafs == MAX_ENT_LEAFS)
+				sv_hot_manyleafs[e / 32] |= 1u << (e % 32);
+			else if (!ent->num_leafs)
+				sv_hot_noleafs[e / 32] |= 1u << (e % 32);
+		}
+	}
+}
+
+/*
+=============
+SV_MarkVisibleEdicts
+
+Sets the bits of the edicts below maxedict touching a leaf of the pvs in
+sv_visible_edicts, through the leaf lists instead of testing every edict.
+Edicts outside of the world count as visible with noleafs
+=============
+*/
+static void SV_MarkVisibleEdicts (const byte *pvs, unsigned int maxedict, qboolean noleafs)
+{
+	unsigned int		numwords = (maxedict + 31) / 32;
+	unsigned int		i, num, leafnum, bits;
+	const leafedicts_t *leaf;
+
+	memcpy (sv_visible_edicts, sv_hot_manyleafs, numwords * sizeof (uint32_t));
+	if (noleafs)
+		for (i = 0; i < numwords; i++)
+			sv_visible_edicts[i] |= sv_hot_noleafs[i];
+
+	for (i = 0; i < ((unsigned int)qcvm->numleafedicts + 7) / 8; i++)
+	{
+		for (bits = pvs[i]; bits; bits &= bits - 1)
+		{
+			leafnum = i * 8 + FindFirstBitNonZero (bits);
+			if (leafnum >= (unsigned int)qcvm->numleafedicts)
+				break;
+			leaf = &qcvm->leafedicts[leafnum];
+			for (num = 0; num < (unsigned int)leaf->num_edicts; num++)
+			{
+				unsigned int e = leaf->edicts[num] / MAX_ENT_LEAFS;
+				if (e < maxedict)
+					sv_visible_edicts[e / 32] |= 1u << (e % 32);
+			}
+		}
+	}
+
+	if (maxedict % 32)
+		sv_visible_edicts[numwords - 1] &= (1u << (maxedict % 32)) - 1;
+	sv_visible_edicts[0] &= ~1u; // never the world
+}
+
+/*
+=============
+SV_NextVisibleEdict
+
+The first edict from e on marked by SV_MarkVisibleEdicts, or maxedict
+=============
+*/
+static unsigned int SV_NextVisibleEdict (unsigned int e, unsigned int maxedict)
+{
+	unsigned int w = e / 32;
+	uint32_t	 bits;
+
+	if (e >= maxedict)
+		return maxedict;
+	bits = sv_visible_edicts[w] & (~0u << (e % 32));
+	while (!bits)
+	{
+		if (++w >= (maxedict + 31) / 32)
+			return maxedict;
+		bits = sv_visible_edicts[w];
+	}
+	return w * 32 + FindFirstBitNonZero (bits);
+}
+
 byte	   *SV_FatPVS (vec3_t org, qmodel_t *worldmodel);
-static void SVFTE_BuildSnapshotForClient (client_t *client)
+static void SVFTE_BuildSnapshotForClient (client_t *client, const byte *pvs, const entity_state_t *states)
 {
-	unsigned int  e, i;
-	byte		 *pvs;
-	vec3_t		  org;
-	edict_t		 *ent, *parent;
+	unsigned int  e;
+	edict_t		 *ent;
 	unsigned int  maxentities = client->limit_entities;
 	edict_t		 *clent = client->edict;
 	eval_t		 *val;
@@ -890,46 +1201,26 @@ static void SVFTE_BuildSnapshotForClient (client_t *client)
 	size_t					   numents = 0;
 	size_t					   maxents = snapshot_maxents;
 
-	// find the client's PVS
-	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, qcvm->worldmodel);
-
-	if (maxentities > (unsigned int)qcvm->num_edicts)
-		maxentities = (unsigned int)qcvm->num_edicts;
+	if (maxentities > (unsigned int)sv_hot_numedicts)
+		maxentities = (unsigned int)sv_hot_numedicts;
 
-	// send over all entities (excpet the client) that touch the pvs
-	ent = NEXT_EDICT (qcvm->edicts);
-	for (e = 1; e < maxentities; e++, ent = NEXT_EDICT (ent))
+	// send over all entities (excpet the client) that touch the pvs, in edict order for the deltas
+	SV_MarkVisibleEdicts (pvs, maxentities, true);
+	e = NUM_FOR_EDICT (clent);
+	if (e < maxentities)
+		sv_visible_edicts[e / 32] |= 1u << (e % 32); // clent is ALLWAYS sent
+	for (e = SV_NextVisibleEdict (1, maxentities); e < maxentities; e = SV_NextVisibleEdict (e + 1, maxentities))
 	{
+		ent = EDICT_NUM (e);
 		eflags = 0;
-		if (ent != clent) // clent is ALLWAYS sent
+		if (ent != clent)
 		{
 			// ignore ents without visible models
-			if ((!ent->v.modelindex || !PR_GetString (ent->v.model)[0]))
+			if (!sv_hot_modelindex[e])
 			{
 			invisible:
 				continue;
 			}
-
-			// attached entities should use the pvs of the parent rather than the child (because the child will typically be bugging out around '0 0 0', so
-			// won't be useful)
-			parent = ent;
-			if (parent->num_leafs)
-			{
-				// ignore if not touching a PV leaf
-				for (i = 0; i < parent->num_leafs; i++)
-					if (pvs[parent->leafnums[i] >> 3] & (1 << (parent->leafnums[i] & 7)))
-						break;
-
-				// ericw -- added ent->num_leafs < MAX_ENT_LEAFS condition.
-				//
-				// if ent->num_leafs == MAX_ENT_LEAFS, the ent is visible from too many leafs
-				// for us to say whether it's in the PVS, so don't try to vis cull it.
-				// this commonly happens with rotators, because they often have huge bboxes
-				// spanning the entire map, or really tall lifts, etc.
-				if (i == parent->num_leafs && parent->num_leafs < MAX_ENT_LEAFS)
-					goto invisible; // not visible
-			}
 		}
 
 		val = GetEdictFieldValue (ent, qcvm->extfields.nodrawtoclient);
@@ -947,7 +1238,10 @@ static void SVFTE_BuildSnapshotForClient (client_t *client)
 		}
 
 		ents[numents].num = e;
-		SV_BuildEntityState (ent, &ents[numents].state);
+		if (states)
+			ents[numents].state = states[e];
+		else
+			SV_BuildEntityState (ent, &ents[numents].state);
 		if ((unsigned int)ents[numents].state.modelindex >= client->limit_models)
 			ents[numents].state.modelindex = 0;
 		if (ent == clent) // add velocity, but we only care for the local player (should add prediction for other entities some time too).
@@ -1143,6 +1437,7 @@ void SV_Init (void)
 	extern cvar_t sv_gameplayfix_bouncedownslopes;
 	extern cvar_t sv_gameplayfix_elevators;
 	extern cvar_t sv_fastpushmove;
+	extern cvar_t sv_parallelphysics;
 	extern cvar_t sv_friction;
 	extern cvar_t sv_edgefriction;
 	extern cvar_t sv_stopspeed;
@@ -1155,6 +1450,7 @@ void SV_Init (void)
 	// FTE optimized world geometry checks
 	extern cvar_t sv_fte_recursivehullckeck;
 	extern cvar_t sv_fte_createareanode;
+	extern cvar_t sv_areagrid;
 
 	Cvar_RegisterVariable (&sv_maxvelocity);
 	Cvar_RegisterVariable (&sv_gravity);
@@ -1174,16 +1470,24 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_gameplayfix_bouncedownslopes);
 	Cvar_RegisterVariable (&sv_gameplayfix_elevators);
 	Cvar_RegisterVariable (&sv_fastpushmove);
+	Cvar_RegisterVariable (&sv_parallelphysics);
 	Cvar_RegisterVariable (&pr_checkextension);
 	Cvar_RegisterVariable (&sv_altnoclip); // johnfitz
 	Cvar_RegisterVariable (&sv_netsort);
 	Cvar_RegisterVariable (&sv_smoothplatformlerps);
+	Cvar_RegisterVariable (&sv_parallelsnapshots);
+	Cvar_RegisterVariable (&sv_compression);
+	Cvar_RegisterVariable (&sv_maxrate);
+	Cvar_RegisterVariable (&sv_savebinary);
 
 	Cvar_RegisterVariable (&sv_fte_recursivehullckeck);
 	Cvar_RegisterVariable (&sv_fte_createareanode);
+	Cvar_RegisterVariable (&sv_areagrid);
 
 	Cmd_AddCommand ("pext", SV_Pext_f);
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); // johnfitz
+	Cmd_AddCommand ("sv_record", SV_Record_f);
+	Cmd_AddCommand ("sv_stop", SV_Stop_f);
 
 	for (i = 0; i < MAX_MODELS; i++)
 		q_snprintf (localmodels[i], 8, "*%i", i);
@@ -1247,6 +1551,42 @@ void SV_StartParticle (vec3_t org, vec3_t dir, int color, int count)
 	MSG_WriteByte (&sv.datagram, color);
 }
 
+static void SV_WriteSound (
+	sizebuf_t *msg, unsigned int pext2, int field_mask, int volume, float attenuation, unsigned int ent, int channel, unsigned int sound_num, const vec3_t org)
+{
+	int i;
+
+	MSG_WriteByte (msg, svc_sound);
+	MSG_WriteByte (msg, field_mask);
+	if (field_mask & SND_VOLUME)
+		MSG_WriteByte (msg, volume);
+	if (field_mask & SND_ATTENUATION)
+		MSG_WriteByte (msg, attenuation * 64);
+
+	// johnfitz -- PROTOCOL_FITZQUAKE
+	if (field_mask & SND_LARGEENTITY)
+	{
+		if ((pext2 & PEXT2_REPLACEMENTDELTAS) && ent > 0x7fff)
+		{
+			MSG_WriteShort (msg, (ent >> 8) | 0x8000);
+			MSG_WriteByte (msg, ent & 0xff);
+		}
+		else
+			MSG_WriteShort (msg, ent);
+		MSG_WriteByte (msg, channel);
+	}
+	else
+		MSG_WriteShort (msg, (ent << 3) | channel);
+	if (field_mask & SND_LARGESOUND)
+		MSG_WriteShort (msg, sound_num);
+	else
+		MSG_WriteByte (msg, sound_num);
+	// johnfitz
+
+	for (i = 0; i < 3; i++)
+		MSG_WriteCoord (msg, org[i], sv.protocolflags);
+}
+
 /*
 ==================
 SV_StartSound
@@ -1268,6 +1608,8 @@ void SV_StartSound (edict_t *entity, float *origin, int channel, const char *sam
 	int			 i, field_mask;
 	int			 p;
 	client_t	*client;
+	sizebuf_t	*demo;
+	vec3_t		 org;
 
 	if (volume < 0)
 		Host_Error ("SV_StartSound: volume = %i", volume);
@@ -1313,6 +1655,16 @@ void SV_StartSound (edict_t *entity, float *origin, int channel, const char *sam
 		field_mask |= SND_LARGESOUND;
 	// johnfitz
 
+	if (origin)
+		VectorCopy (origin, org);
+	else
+		for (i = 0; i < 3; i++)
+			org[i] = entity->v.origin[i] + 0.5 * (entity->v.mins[i] + entity->v.maxs[i]);
+
+	// PROTOCOL_NETQUAKE do not support more than 256 sounds and/or 8192 entities.
+	if ((field_mask & (SND_LARGEENTITY | SND_LARGESOUND)) && (sv.protocol == PROTOCOL_NETQUAKE))
+		return;
+
 	for (p = 0; p < svs.maxclients; p++)
 	{
 		client = &svs.clients[p];
@@ -1323,49 +1675,17 @@ void SV_StartSound (edict_t *entity, float *origin, int channel, const char *sam
 			continue;
 		if (sound_num >= client->limit_sounds)
 			continue;
-		// PROTOCOL_NETQUAKE do not support more than 256 sounds and/or 8192 entities.
-		if ((field_mask & (SND_LARGEENTITY | SND_LARGESOUND)) && (sv.protocol == PROTOCOL_NETQUAKE))
-			continue;
 
 		if (client->datagram.cursize > client->datagram.maxsize - 22)
 			continue;
 
 		// directed messages go only to the entity the are targeted on
-		MSG_WriteByte (&client->datagram, svc_sound);
-		MSG_WriteByte (&client->datagram, field_mask);
-		if (field_mask & SND_VOLUME)
-			MSG_WriteByte (&client->datagram, volume);
-		if (field_mask & SND_ATTENUATION)
-			MSG_WriteByte (&client->datagram, attenuation * 64);
-
-		// johnfitz -- PROTOCOL_FITZQUAKE
-		if (field_mask & SND_LARGEENTITY)
-		{
-			if ((client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS) && ent > 0x7fff)
-			{
-				MSG_WriteShort (&client->datagram, (ent >> 8) | 0x8000);
-				MSG_WriteByte (&client->datagram, ent & 0xff);
-			}
-			else
-				MSG_WriteShort (&client->datagram, ent);
-			MSG_WriteByte (&client->datagram, channel);
-		}
-		else
-			MSG_WriteShort (&client->datagram, (ent << 3) | channel);
-		if (field_mask & SND_LARGESOUND)
-			MSG_WriteShort (&client->datagram, sound_num);
-		else
-			MSG_WriteByte (&client->datagram, sound_num);
-		// johnfitz
-
-		for (i = 0; i < 3; i++)
-		{
-			if (origin)
-				MSG_WriteCoord (&client->datagram, origin[i], sv.protocolflags);
-			else
-				MSG_WriteCoord (&client->datagram, entity->v.origin[i] + 0.5 * (entity->v.mins[i] + entity->v.maxs[i]), sv.protocolflags);
-		}
+		SV_WriteSound (&client->datagram, client->protocol_pext2, field_mask, volume, attenuation, ent, channel, sound_num, org);
 	}
+
+	// a server side demo hears every sound once, whichever view it is played from
+	if ((demo = SV_DemoDatagram ()) && demo->cursize <= demo->maxsize - 22)
+		SV_WriteSound (demo, PEXT2_REPLACEMENTDELTAS, field_mask, volume, attenuation, ent, channel, sound_num, org);
 }
 
 /*
@@ -1427,6 +1747,7 @@ void SV_SendServerinfo (client_t *client)
 	unsigned int i; // johnfitz
 	qboolean	 cantruncate;
 	qboolean	 truncated = false;
+	unsigned int vkpext;
 
 	client->spawned = false; // need prespawn, spawn, etc
 
@@ -1529,6 +1850,14 @@ void SV_SendServerinfo (client_t *client)
 		}
 	}
 
+	// restarts the stream, so that the message carrying the precaches primes both ends
+	vkpext = 0;
+	if (NET_QSocketSetDeflate (client->netconnection, (client->protocol_vkpext & VKPEXT_DEFLATE) && sv_compression.value, sv_compression.value >= 2))
+		vkpext |= VKPEXT_DEFLATE;
+	// their receiving end holds out of order fragments, so ours can stop waiting on each one
+	if (NET_QSocketSetReliableWindow (client->netconnection, client->protocol_vkpext & VKPEXT_RELIABLEWINDOW))
+		vkpext |= VKPEXT_RELIABLEWINDOW;
+
 	cantruncate = client->message.cursize == 0;
 retry:
 	MSG_WriteByte (&client->message, svc_print);
@@ -1539,6 +1868,11 @@ retry:
 	MSG_WriteString (&client->message, message);
 
 	MSG_WriteByte (&client->message, svc_serverinfo);
+	if (vkpext)
+	{
+		MSG_WriteLong (&client->message, PROTOCOL_VKQUAKE_PEXT);
+		MSG_WriteLong (&client->message, vkpext);
+	}
 	if (client->protocol_pext2)
 	{ // pext stuff takes the form of modifiers to an underlaying protocol
 		MSG_WriteLong (&client->message, PROTOCOL_FTE_PEXT2);
@@ -1646,6 +1980,10 @@ void SV_Pext_f (void)
 			Con_Printf ("  Replacement Entity Deltas\n");
 		if (cl.protocol_pext2 & PEXT2_PREDINFO)
 			Con_Printf ("  Replacement Stats ('predinfo')\n");
+		if (cl.protocol_vkpext & VKPEXT_DEFLATE)
+			Con_Printf ("  Deflated Messages\n");
+		if (cl.protocol_vkpext & VKPEXT_RELIABLEWINDOW)
+			Con_Printf ("  Reliable Window\n");
 		if (cl.protocol == PROTOCOL_NETQUAKE)
 			Con_Printf ("  vanilla(15)\n");
 		else if (cl.protocol == PROTOCOL_FITZQUAKE)
@@ -1669,6 +2007,8 @@ void SV_Pext_f (void)
 
 			if (key == PROTOCOL_FTE_PEXT2)
 				host_client->protocol_pext2 = value & PEXT2_SUPPORTED_SERVER;
+			else if (key == PROTOCOL_VKQUAKE_PEXT)
+				host_client->protocol_vkpext = value & VKPEXT_SUPPORTED_SERVER;
 			// else some other extension that we don't know
 		}
 
@@ -1728,6 +2068,7 @@ void SV_ConnectClient (int clientnum)
 
 	client->pextknown = false;
 	client->protocol_pext2 = 0;
+	client->protocol_vkpext = 0;
 
 	if (sv.loadgame)
 		memcpy (client->spawn_parms, spawn_parms, sizeof (spawn_parms));
@@ -1813,9 +2154,9 @@ static qboolean fatpvs_any;
 
 void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) // johnfitz -- added worldmodel as a parameter
 {
-	int		  i;
-	byte	 *pvs;
-	mplane_t *plane;
+	int			i;
+	const byte *pvs;
+	mplane_t   *plane;
 	float	  d;
 
 	while (1)
@@ -1826,9 +2167,17 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) // johnfit
 			if (node->contents != CONTENTS_SOLID)
 			{
 				fatpvs_any = true;
-				pvs = Mod_LeafPVS ((mleaf_t *)node, worldmodel); // johnfitz -- worldmodel as a parameter
-				for (i = 0; i < fatbytes - 3; i += 4)
-					*(uint32_t *)&fatpvs[i] |= *(uint32_t *)&pvs[i];
+				pvs = Mod_CachedLeafPVS ((mleaf_t *)node, worldmodel); // johnfitz -- worldmodel as a parameter
+				i = 0;
+#if defined(USE_SSE2)
+				for (; i < fatbytes - 15; i += 16)
+					_mm_storeu_si128 ((__m128i *)&fatpvs[i], _mm_or_si128 (_mm_loadu_si128 ((__m128i *)&fatpvs[i]), _mm_loadu_si128 ((const __m128i *)&pvs[i])));
+#elif defined(USE_NEON)
+				for (; i < fatbytes - 15; i += 16)
+					vst1q_u8 (&fatpvs[i], vorrq_u8 (vld1q_u8 (&fatpvs[i]), vld1q_u8 (&pvs[i])));
+#endif
+				for (; i < fatbytes - 3; i += 4)
+					*(uint32_t *)&fatpvs[i] |= *(const uint32_t *)&pvs[i];
 			}
 			return;
 		}
@@ -1933,6 +2282,8 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 
 	if (maxedict > client->limit_entities)
 		maxedict = client->limit_entities;
+	if (maxedict > (unsigned int)sv_hot_numedicts)
+		maxedict = sv_hot_numedicts;
 
 	// find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
@@ -1956,42 +2307,30 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 	numents = 1;
 
 	// add all other entities that touch the pvs
-	ent = NEXT_EDICT (qcvm->edicts);
-	for (e = 1; e < maxedict; e++, ent = NEXT_EDICT (ent))
+	SV_MarkVisibleEdicts (pvs, maxedict, false);
+	for (e = SV_NextVisibleEdict (1, maxedict); e < maxedict; e = SV_NextVisibleEdict (e + 1, maxedict))
 	{
-		if (ent != clent) // clent already added before the loop
-		{
-			// ignore ents without visible models
-			if (!ent->v.modelindex || !(model = PR_GetString (ent->v.model))[0])
-				continue;
-
-			// johnfitz -- don't send model>255 entities if protocol is 15
-			if ((unsigned int)ent->v.modelindex >= client->limit_models)
-				continue;
+		ent = EDICT_NUM (e);
 
-			// ignore if not touching a PV leaf
-			for (i = 0; i < ent->num_leafs; i++)
-				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i] & 7)))
-					break;
+		// ignore ents without visible models
+		if (!sv_hot_modelindex[e])
+			continue;
 
-			// ericw -- added ent->num_leafs < MAX_ENT_LEAFS condition.
-			//
-			// if ent->num_leafs == MAX_ENT_LEAFS, the ent is visible from too many leafs
-			// for us to say whether it's in the PVS, so don't try to vis cull it.
-			// this commonly happens with rotators, because they often have huge bboxes
-			// spanning the entire map, or really tall lifts, etc.
-			if (i == ent->num_leafs && ent->num_leafs < MAX_ENT_LEAFS)
-				continue; // not visible
+		// johnfitz -- don't send model>255 entities if protocol is 15
+		if ((unsigned int)sv_hot_modelindex[e] >= client->limit_models)
+			continue;
 
+		if (ent != clent) // clent already added before the loop
+		{
 			if (sort)
 			{
 				// compute ent bbox size and distance from org to the closest point in ent's bbox
 				dist = size = 0.f;
 				for (i = 0; i < 3; i++)
 				{
-					float delta = CLAMP (ent->v.absmin[i], org[i], ent->v.absmax[i]) - org[i];
+					float delta = CLAMP (sv_hot_absmin[e][i], org[i], sv_hot_absmax[e][i]) - org[i];
 					dist += delta * delta;
-					delta = ent->v.absmax[i] - ent->v.absmin[i];
+					delta = sv_hot_absmax[e][i] - sv_hot_absmin[e][i];
 					size += delta * delta;
 				}
 				size = q_max (1.f, size);
@@ -1999,6 +2338,7 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 				// prioritize point-sized projectiles that do something on impact
 				if (size < 50 && ent->v.touch)
 				{
+					model = PR_GetString (ent->v.model);
 					if (ent->v.movetype == MOVETYPE_FLYMISSILE || ent->v.movetype == MOVETYPE_FLY)
 					{
 						vec3_t to_self;
@@ -2019,7 +2359,7 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 				// compute max distance along forward axis
 				dist = 0.f;
 				for (i = 0; i < 3; i++)
-					dist += ((forward[i] < 0.f ? ent->v.absmin[i] : ent->v.absmax[i]) - org[i]) * forward[i];
+					dist += ((forward[i] < 0.f ? sv_hot_absmin[e][i] : sv_hot_absmax[e][i]) - org[i]) * forward[i];
 				if (dist < 0.f)
 					net_edict_dists[numents] |= 128; // deprioritize entities behind the client
 
@@ -2309,10 +2649,7 @@ void SV_WriteClientdataToMessage (client_t *client, sizebuf_t *msg)
 	int			 i;
 	int			 items;
 	eval_t		*val;
-	unsigned int weaponmodelindex = SV_ModelIndex (PR_GetString (ent->v.weaponmodel));
-
-	if (weaponmodelindex >= client->limit_models)
-		weaponmodelindex = 0;
+	unsigned int weaponmodelindex = SV_WeaponModelIndex (client);
 
 	bits = 0;
 
@@ -2324,7 +2661,7 @@ void SV_WriteClientdataToMessage (client_t *client, sizebuf_t *msg)
 
 	// stuff the sigil bits into the high bits of items for sbar, or else
 	// mix in items2
-	val = GetEdictFieldValue (ent, ED_FindFieldOffset ("items2"));
+	val = GetEdictFieldValue (ent, qcvm->extfields.items2);
 
 	if (val)
 		items = (int)ent->v.items | ((int)val->_float << 23);
@@ -2465,19 +2802,149 @@ void SV_WriteClientdataToMessage (client_t *client, sizebuf_t *msg)
 										 // johnfitz
 }
 
-void SV_PresendClientDatagram (client_t *client)
+static qboolean SV_NeedsSnapshot (client_t *client)
 {
-	if (!client->netconnection)
-		return; // botclient
+	if (!client->active || !client->netconnection)
+		return false; // botclient
 	if (!client->spawned)
-		return; // not ready yet.
+		return false; // not ready yet.
 	if (!(client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS))
-		return; // brute force networking.
-	SVFTE_BuildSnapshotForClient (client);
+		return false; // brute force networking.
+	return true;
+}
+
+#define ENTITY_STATE_TASK_SIZE 256
+
+typedef struct
+{
+	client_t	  **clients;
+	byte		   *pvs; // fat pvs of each client, pvsbytes apart
+	int				pvsbytes;
+	entity_state_t *states; // SV_BuildEntityState of every edict that may be sent, NULL with a single client
+	int				numstates;
+} svpresend_t;
+
+static entity_state_t *sv_entitystates;
+static int			   sv_maxentitystates;
+static int			   sv_numentitystates; // built this frame, 0 if the states weren't shared
+
+static void SV_BuildEntityStatesTask (int index, svpresend_t *presend)
+{
+	int		 e = index * ENTITY_STATE_TASK_SIZE;
+	int		 last = q_min (e + ENTITY_STATE_TASK_SIZE, presend->numstates);
+	edict_t *ent = EDICT_NUM (e);
+
+	for (; e < last; e++, ent = NEXT_EDICT (ent))
+	{
+		// clients can be sent without a model (the client's own entity is)
+		if (sv_hot_modelindex[e] || e <= svs.maxclients)
+			SV_BuildEntityState (ent, &presend->states[e]);
+		else
+			presend->states[e].modelindex = 0; // what SV_FrameEntityStates users go by
+	}
+}
+
+static void SV_PresendClientDatagramTask (int index, svpresend_t *presend)
+{
+	client_t *client = presend->clients[index];
+
+	SVFTE_BuildSnapshotForClient (client, presend->pvs + (size_t)index * presend->pvsbytes, presend->states);
 	SVFTE_CalcEntityDeltas (client);
 	client->snapshotresume = 0;
 }
 
+/*
+=======================
+SV_PresendClientDatagrams
+
+Generates client snapshots (and updates csqc pending flags). The fat PVS goes
+through the shared PVS cache so it is found serially, the entity scans and
+deltas only read the edicts and write their own client, so they can run on
+the workers. With several clients, or a server side demo being recorded, the
+state of each edict is built once instead of once for every client that sees it.
+=======================
+*/
+static void SV_PresendClientDatagrams (void)
+{
+	svpresend_t presend;
+	vec3_t		org;
+	int			i, num_clients = 0;
+
+	TEMP_ALLOC (client_t *, clients, svs.maxclients);
+	for (i = 0; i < svs.maxclients; i++)
+		if (SV_NeedsSnapshot (&svs.clients[i]))
+			clients[num_clients++] = &svs.clients[i];
+
+	presend.clients = clients;
+	presend.states = NULL;
+	presend.numstates = sv_hot_numedicts;
+	if (num_clients > 1 || SV_DemoRecording ())
+	{
+		if (presend.numstates > sv_maxentitystates)
+		{
+			sv_maxentitystates = presend.numstates;
+			sv_entitystates = Mem_Realloc (sv_entitystates, sv_maxentitystates * sizeof (entity_state_t));
+		}
+		presend.states = sv_entitystates;
+	}
+
+	const qboolean parallel = sv_parallelsnapshots.value && presend.states && !Tasks_IsWorker ();
+	sv_numentitystates = 0;
+	if (presend.states)
+	{
+		if (parallel)
+		{
+			const int	  num_state_tasks = (presend.numstates + ENTITY_STATE_TASK_SIZE - 1) / ENTITY_STATE_TASK_SIZE;
+			task_handle_t states_task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)SV_BuildEntityStatesTask, num_state_tasks, &presend, sizeof (presend));
+			Task_Join (states_task, TASK_TIMEOUT_INFINITE);
+		}
+		else
+			for (i = 0; i * ENTITY_STATE_TASK_SIZE < presend.numstates; i++)
+				SV_BuildEntityStatesTask (i, &presend);
+		sv_numentitystates = presend.numstates;
+	}
+
+	if (num_clients)
+	{
+		presend.pvsbytes = (qcvm->worldmodel->numleafs + 31) / 8;
+		const mem_frame_mark_t mark = Mem_FrameMark ();
+		presend.pvs = Mem_FrameAlloc ((size_t)num_clients * presend.pvsbytes);
+		for (i = 0; i < num_clients; i++)
+		{
+			edict_t *clent = clients[i]->edict;
+			VectorAdd (clent->v.origin, clent->v.view_ofs, org);
+			memcpy (presend.pvs + (size_t)i * presend.pvsbytes, SV_FatPVS (org, qcvm->worldmodel), presend.pvsbytes);
+		}
+
+		if (parallel && num_clients > 1)
+		{
+			task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)SV_PresendClientDatagramTask, num_clients, &presend, sizeof (presend));
+			Task_Join (task, TASK_TIMEOUT_INFINITE);
+		}
+		else
+			for (i = 0; i < num_clients; i++)
+				SV_PresendClientDatagramTask (i, &presend);
+
+		Mem_FrameRelease (mark);
+	}
+
+	TEMP_FREE (clients);
+}
+
+/*
+=======================
+SV_FrameEntityStates
+
+The states SV_PresendClientDatagrams shared between the clients this frame, or
+NULL. Edicts past the players with no model in their state weren't built
+=======================
+*/
+const entity_state_t *SV_FrameEntityStates (int *numstates)
+{
+	*numstates = sv_numentitystates;
+	return sv_numentitystates ? sv_entitystates : NULL;
+}
+
 /*
 =======================
 SV_ParticleSize
@@ -2531,21 +2998,24 @@ qboolean SV_SendClientDatagram (client_t *client)
 
 		if (client->protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
 		{
+			qboolean more;
+
 			SV_WriteDamageToMessage (client->edict, &msg);
 			if (!(client->protocol_pext2 & PEXT2_PREDINFO))
 				SV_WriteClientdataToMessage (client, &msg);
 			else
 				SVFTE_WriteStats (client, &msg);
-			SVFTE_WriteEntitiesToClient (client, &msg, sizeof (buf)); // must always write some data, or the stats will break
+			// must always write some data, or the stats will break
+			more = SVFTE_WriteEntitiesToClient (client, &msg, sizeof (buf));
 
 			// this delta protocol doesn't wipe old state just because there's a new packet.
 			// the server isn't required to sync with the client frames either
 			// so we can just spam multiple packets to keep our udp data under the MTU
-			while (client->snapshotresume < client->numpendingentities)
+			while (more)
 			{
 				NET_SendUnreliableMessage (client->netconnection, &msg);
 				SZ_Clear (&msg);
-				SVFTE_WriteEntitiesToClient (client, &msg, sizeof (buf));
+				more = SVFTE_WriteEntitiesToClient (client, &msg, sizeof (buf));
 			}
 		}
 		else
@@ -2828,15 +3298,14 @@ void SV_SendClientMessages (void)
 	// update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
-	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
-	{
-		if (!host_client->active)
-			continue;
+	SV_UpdateHotFields ();
 
-		SV_PresendClientDatagram (host_client); // generates client snapshots (and updates csqc pending flags)
-	}
+	SV_PresendClientDatagrams ();
+
+	SV_DemoWriteViews ();
 
-	// build individual updates
+	// build individual updates, the datagrams for all clients go out together
+	NET_SetBatching (true);
 	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
 	{
 		if (!host_client->active)
@@ -2943,6 +3412,8 @@ void SV_SendClientMessages (void)
 				SV_DropClient (false); // went to another level
 			else
 			{
+				if (host_client->spawned)
+					SV_DemoWriteReliable (host_client, &host_client->message);
 				if (NET_SendMessage (host_client->netconnection, &host_client->message) == -1)
 					SV_DropClient (false); // if the message couldn't send, kick off
 				SZ_Clear (&host_client->message);
@@ -2952,6 +3423,9 @@ void SV_SendClientMessages (void)
 			}
 		}
 	}
+	NET_SetBatching (false);
+
+	SV_DemoFrame ();
 
 	// clear muzzle flashes
 	SV_CleanupEnts ();
@@ -3118,6 +3592,9 @@ void SV_SpawnServer (const char *server)
 	int			i;
 	qcvm_t	   *vm = qcvm;
 
+	Host_WaitServerFrame ();
+	const mem_tag_t tag = Mem_SetTag (MEM_TAG_SERVER);
+
 	// let's not have any servers with no name
 	if (hostname.string[0] == 0)
 		Cvar_Set ("hostname", "UNNAMED");
@@ -3217,6 +3694,7 @@ void SV_SpawnServer (const char *server)
 	{
 		Con_Printf ("Couldn't spawn server %s\n", sv.modelname);
 		sv.active = false;
+		Mem_SetTag (tag);
 		return;
 	}
 	sv.models[1] = qcvm->worldmodel;
@@ -3234,6 +3712,7 @@ void SV_SpawnServer (const char *server)
 	{
 		Con_Printf ("too many inline models %s\n", sv.modelname);
 		sv.active = false;
+		Mem_SetTag (tag);
 		return;
 	}
 	for (i = 1; i < qcvm->worldmodel->numsubmodels; i++)
@@ -3273,7 +3752,7 @@ void SV_SpawnServer (const char *server)
 	sv.state = ss_active;
 
 	// run two frames to allow everything to settle
-	host_frametime = 0.1;
+	sv_frametime = 0.1;
 	SV_Physics ();
 	SV_Physics ();
 
@@ -3293,5 +3772,10 @@ void SV_SpawnServer (const char *server)
 			SV_SendServerinfo (host_client);
 	}
 
+	Mem_SetTag (tag);
+
+	// a server side demo goes on with the new map
+	SV_DemoSignon ();
+
 	Con_DPrintf ("Server spawned.\n");
 }
@@ -50,15 +50,40 @@ cvar_t sv_freezenonclients = {"sv_freezenonclients", "0", CVAR_NONE};
 cvar_t sv_gameplayfix_spawnbeforethinks = {"sv_gameplayfix_spawnbeforethinks", "0", CVAR_NONE};
 cvar_t sv_gameplayfix_bouncedownslopes = {"sv_gameplayfix_bouncedownslopes", "1", CVAR_NONE}; // fixes grenades making horrible noises on slopes.
 cvar_t sv_fastpushmove = {"sv_fastpushmove", "1", CVAR_ARCHIVE};							  // 0=old SV_PushMove processing; 1= faster SV_PushMove, (default)
+cvar_t sv_parallelphysics = {"sv_parallelphysics", "1", CVAR_ARCHIVE};						  // trace toss movement against the world on the workers
+
+THREAD_LOCAL double sv_frametime;
 
 #define MOVE_EPSILON 0.01
 
 static void SV_Physics_Toss (edict_t *ent);
 
 // For usage by SV_PushMove, allocate at max possible size,
-// fine to be static because all SV_phys is only called from the main thread.
-static edict_t *pushable_ent_cache[MAX_EDICTS];
-static int		num_pushable_ent_cache;
+// fine to be static because only one qcvm at a time runs SV_Physics, the threaded server stays serial with csqc.
+// With the area grid it only holds what the grid can't find: non solid and unlinked entities, and those standing on
+// something, which get carried even when their box is elsewhere.
+static edict_t	*pushable_ent_cache[MAX_EDICTS];
+static int		 num_pushable_ent_cache;
+static qboolean	 pushable_ent_cache_grid;
+static int		*push_checks; // SV_PushMoveChecks result
+static int		 max_push_checks;
+
+#define NUM_WORLD_TRACE_TASKS	  8
+#define MIN_PARALLEL_WORLD_TRACES 32
+
+// Toss movement traced against the world before the entities run, see SV_PredictWorldTraces
+typedef struct
+{
+	int		entnum;
+	int		type;
+	vec3_t	start, end, mins, maxs;
+	trace_t trace;
+} worldtrace_t;
+
+static worldtrace_t *world_traces;
+static int			 num_world_traces;
+static int			 max_world_traces;
+static int			 world_trace_index[MAX_EDICTS]; // by edict number, 1 + index into world_traces or 0
 
 /*
 ================
@@ -130,7 +155,7 @@ static qboolean SV_RunThink (edict_t *ent)
 	float thinktime;
 
 	thinktime = ent->v.nextthink;
-	if (thinktime <= 0 || thinktime > qcvm->time + host_frametime)
+	if (thinktime <= 0 || thinktime > qcvm->time + sv_frametime)
 		return true;
 
 	if (thinktime < qcvm->time)
@@ -157,7 +182,7 @@ static qboolean SV_RunThink (edict_t *ent)
 			float pusher_remaining = pusher->v.nextthink - pusher->v.ltime;
 			if (pusher_remaining > 0)
 			{
-				float time = q_min ((int)((ent->v.nextthink - qcvm->time) / host_frametime) * host_frametime, pusher_remaining);
+				float time = q_min ((int)((ent->v.nextthink - qcvm->time) / sv_frametime) * sv_frametime, pusher_remaining);
 				for (int i = 0; i < 3; i++)
 				{
 					ent->predthinkpos[i] = ent->v.origin[i] + pusher->v.velocity[i] * time;
@@ -185,6 +210,9 @@ static void SV_Impact (edict_t *e1, edict_t *e2)
 	old_self = pr_global_struct->self;
 	old_other = pr_global_struct->other;
 
+	// e1 is relinked once its move is over
+	PR_FieldsWritten (e1, ED_MARK_MOVED);
+
 	pr_global_struct->time = qcvm->time;
 	if (e1->v.touch && e1->v.solid != SOLID_NOT)
 	{
@@ -393,18 +421,19 @@ SV_AddGravity
 
 ============
 */
-static void SV_AddGravity (edict_t *ent)
+static float SV_GravityScale (edict_t *ent)
 {
-	float	ent_gravity;
 	eval_t *val;
 
 	val = GetEdictFieldValue (ent, ED_FindFieldOffset ("gravity"));
 	if (val && val->_float)
-		ent_gravity = val->_float;
-	else
-		ent_gravity = 1.0;
+		return val->_float;
+	return 1.0;
+}
 
-	ent->v.velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
+static void SV_AddGravity (edict_t *ent)
+{
+	ent->v.velocity[2] -= SV_GravityScale (ent) * sv_gravity.value * sv_frametime;
 }
 
 /*
@@ -415,6 +444,48 @@ PUSHMOVE
 ===============================================================================
 */
 
+/*
+============
+SV_PushEntityMoveType
+============
+*/
+static int SV_PushEntityMoveType (edict_t *ent)
+{
+	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
+		return MOVE_MISSILE;
+	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+		return MOVE_NOMONSTERS; // only clip against bmodels
+	return MOVE_NORMAL;
+}
+
+/*
+============
+SV_FindWorldTrace
+
+Returns the predicted world trace of ent if it was made for exactly this move, each one is only used once
+============
+*/
+static worldtrace_t *SV_FindWorldTrace (edict_t *ent, vec3_t end, int type)
+{
+	worldtrace_t *wt;
+	int			  entnum;
+
+	if (!num_world_traces)
+		return NULL;
+
+	entnum = NUM_FOR_EDICT (ent);
+	if (!world_trace_index[entnum])
+		return NULL;
+	wt = &world_traces[world_trace_index[entnum] - 1];
+	world_trace_index[entnum] = 0;
+
+	// the world doesn't move, so the trace only depends on these
+	if (wt->type != type || !VectorCompare (wt->start, ent->v.origin) || !VectorCompare (wt->end, end) || !VectorCompare (wt->mins, ent->v.mins) ||
+		!VectorCompare (wt->maxs, ent->v.maxs))
+		return NULL;
+	return wt;
+}
+
 /*
 ============
 SV_PushEntity
@@ -424,18 +495,19 @@ Does not change the entities velocity at all
 */
 static trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 {
-	trace_t trace;
-	vec3_t	end;
+	trace_t		  trace;
+	vec3_t		  end;
+	int			  type;
+	worldtrace_t *wt;
 
 	VectorAdd (ent->v.origin, push, end);
 
-	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
-	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
-		// only clip against bmodels
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
+	type = SV_PushEntityMoveType (ent);
+	wt = SV_FindWorldTrace (ent, end, type);
+	if (wt)
+		trace = SV_MoveFromWorldTrace (&wt->trace, ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
 	else
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
+		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
 
 	VectorCopy (trace.endpos, ent->v.origin);
 	SV_LinkEdict (ent, true);
@@ -446,6 +518,41 @@ static trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 	return trace;
 }
 
+/*
+============
+SV_PushMoveChecks
+
+The entities SV_PushMove has to look at, in edict order: the ones in the area
+grid touching the box the pusher sweeps and the cached ones the grid can't find
+============
+*/
+static int SV_CompareEdictNums (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static int SV_PushMoveChecks (const vec3_t mins, const vec3_t maxs)
+{
+	int i, j, count;
+
+	count = SV_AreaGridEdicts (mins, maxs, NULL) + num_pushable_ent_cache;
+	if (count > max_push_checks)
+	{
+		max_push_checks = q_max (count, max_push_checks * 2);
+		push_checks = Mem_Realloc (push_checks, max_push_checks * sizeof (int));
+	}
+
+	count = SV_AreaGridEdicts (mins, maxs, push_checks);
+	for (i = 0; i < num_pushable_ent_cache; i++)
+		push_checks[count++] = NUM_FOR_EDICT (pushable_ent_cache[i]);
+	qsort (push_checks, count, sizeof (int), SV_CompareEdictNums);
+
+	for (i = j = 0; i < count; i++)
+		if (!j || push_checks[i] != push_checks[j - 1])
+			push_checks[j++] = push_checks[i];
+	return j;
+}
+
 /*
 ============
 SV_PushMove
@@ -461,6 +568,8 @@ static void SV_PushMove (edict_t *pusher, float movetime)
 	vec3_t	 entorig, pushorig;
 	int		 num_moved;
 	float	 solid_backup;
+	vec3_t	 sweepmins, sweepmaxs;
+	int		 num_checks;
 
 	// fine to be a static temporary because SV_PushMove is only called from the main thread,
 	// without consuming stack space.
@@ -478,6 +587,9 @@ static void SV_PushMove (edict_t *pusher, float movetime)
 		move[i] = pusher->v.velocity[i] * movetime;
 		mins[i] = pusher->v.absmin[i] + move[i];
 		maxs[i] = pusher->v.absmax[i] + move[i];
+		// from the start too: entities that landed on it this frame touch it there
+		sweepmins[i] = pusher->v.absmin[i] + q_min (move[i], 0.0f) - 1.0f;
+		sweepmaxs[i] = pusher->v.absmax[i] + q_max (move[i], 0.0f) + 1.0f;
 	}
 
 	VectorCopy (pusher->v.origin, pushorig);
@@ -492,6 +604,9 @@ static void SV_PushMove (edict_t *pusher, float movetime)
 	num_moved = 0;
 
 	const bool fast_pushers = (sv_fastpushmove.value > 0.f);
+	const bool grid_pushers = fast_pushers && pushable_ent_cache_grid && qcvm->areagrid;
+
+	num_checks = grid_pushers ? SV_PushMoveChecks (sweepmins, sweepmaxs) : 0;
 
 	int e = -1;
 
@@ -500,12 +615,16 @@ static void SV_PushMove (edict_t *pusher, float movetime)
 
 	while (true)
 	{
-		if (e >= (fast_pushers ? num_pushable_ent_cache - 1 : qcvm->num_edicts - 1 - 1))
+		if (e >= (grid_pushers ? num_checks - 1 : fast_pushers ? num_pushable_ent_cache - 1 : qcvm->num_edicts - 1 - 1))
 			break;
 
 		e++;
 
-		if (fast_pushers)
+		if (grid_pushers)
+		{
+			check = EDICT_NUM (push_checks[e]);
+		}
+		else if (fast_pushers)
 		{
 			check = pushable_ent_cache[e];
 		}
@@ -592,7 +711,8 @@ static void SV_PushMove (edict_t *pusher, float movetime)
 			}
 
 			// try moving the entity up a bit if it's blocked by the pusher while also standing on it
-			if (riding && block == pusher && (sv_gameplayfix_elevators.value >= 2.f || (sv_gameplayfix_elevators.value && e <= svs.maxclients)))
+			if (riding && block == pusher &&
+				(sv_gameplayfix_elevators.value >= 2.f || (sv_gameplayfix_elevators.value && NUM_FOR_EDICT (check) <= svs.maxclients)))
 			{
 				check->v.origin[2] += DIST_EPSILON;
 				if (!SV_TestEntityPosition (check))
@@ -641,14 +761,14 @@ static void SV_Physics_Pusher (edict_t *ent)
 	oldltime = ent->v.ltime;
 
 	thinktime = ent->v.nextthink;
-	if (thinktime < ent->v.ltime + host_frametime)
+	if (thinktime < ent->v.ltime + sv_frametime)
 	{
 		movetime = thinktime - ent->v.ltime;
 		if (movetime < 0)
 			movetime = 0;
 	}
 	else
-		movetime = host_frametime;
+		movetime = sv_frametime;
 
 	if (movetime)
 	{
@@ -895,7 +1015,7 @@ static void SV_WalkMove (edict_t *ent)
 	VectorCopy (ent->v.origin, oldorg);
 	VectorCopy (ent->v.velocity, oldvel);
 
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
+	clip = SV_FlyMove (ent, sv_frametime, &steptrace);
 
 	if (!(clip & 2))
 		return; // move didn't block on a step
@@ -923,7 +1043,7 @@ static void SV_WalkMove (edict_t *ent)
 	VectorCopy (vec3_origin, upmove);
 	VectorCopy (vec3_origin, downmove);
 	upmove[2] = STEPSIZE;
-	downmove[2] = -STEPSIZE + oldvel[2] * host_frametime;
+	downmove[2] = -STEPSIZE + oldvel[2] * sv_frametime;
 
 	// move up
 	SV_PushEntity (ent, upmove); // FIXME: don't link?
@@ -932,7 +1052,7 @@ static void SV_WalkMove (edict_t *ent)
 	ent->v.velocity[0] = oldvel[0];
 	ent->v.velocity[1] = oldvel[1];
 	ent->v.velocity[2] = 0;
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
+	clip = SV_FlyMove (ent, sv_frametime, &steptrace);
 
 	// check for stuckness, possibly due to the limited precision of floats
 	// in the clipping hulls. Disable when using pr_checkextension to avoid
@@ -1025,13 +1145,13 @@ static void SV_Physics_Client (edict_t *ent, int num)
 	case MOVETYPE_FLY:
 		if (!SV_RunThink (ent))
 			return;
-		SV_FlyMove (ent, host_frametime, NULL);
+		SV_FlyMove (ent, sv_frametime, NULL);
 		break;
 
 	case MOVETYPE_NOCLIP:
 		if (!SV_RunThink (ent))
 			return;
-		VectorMA (ent->v.origin, host_frametime, ent->v.velocity, ent->v.origin);
+		VectorMA (ent->v.origin, sv_frametime, ent->v.velocity, ent->v.origin);
 		break;
 
 	default:
@@ -1076,8 +1196,8 @@ static void SV_Physics_Noclip (edict_t *ent)
 	if (!SV_RunThink (ent))
 		return;
 
-	VectorMA (ent->v.angles, host_frametime, ent->v.avelocity, ent->v.angles);
-	VectorMA (ent->v.origin, host_frametime, ent->v.velocity, ent->v.origin);
+	VectorMA (ent->v.angles, sv_frametime, ent->v.avelocity, ent->v.angles);
+	VectorMA (ent->v.origin, sv_frametime, ent->v.velocity, ent->v.origin);
 
 	SV_LinkEdict (ent, false);
 }
@@ -1157,10 +1277,10 @@ static void SV_Physics_Toss (edict_t *ent)
 		SV_AddGravity (ent);
 
 	// move angles
-	VectorMA (ent->v.angles, host_frametime, ent->v.avelocity, ent->v.angles);
+	VectorMA (ent->v.angles, sv_frametime, ent->v.avelocity, ent->v.angles);
 
 	// move origin
-	VectorScale (ent->v.velocity, host_frametime, move);
+	VectorScale (ent->v.velocity, sv_frametime, move);
 	trace = SV_PushEntity (ent, move);
 	if (trace.fraction == 1)
 		return;
@@ -1224,7 +1344,7 @@ static void SV_Physics_Step (edict_t *ent)
 
 		SV_AddGravity (ent);
 		SV_CheckVelocity (ent);
-		SV_FlyMove (ent, host_frametime, NULL);
+		SV_FlyMove (ent, sv_frametime, NULL);
 		SV_LinkEdict (ent, true);
 
 		if ((int)ent->v.flags & FL_ONGROUND) // just hit ground
@@ -1242,6 +1362,108 @@ static void SV_Physics_Step (edict_t *ent)
 
 //============================================================================
 
+/*
+================
+SV_ClearWorldTraces
+================
+*/
+static void SV_ClearWorldTraces (void)
+{
+	int i;
+
+	for (i = 0; i < num_world_traces; i++)
+		world_trace_index[world_traces[i].entnum] = 0;
+	num_world_traces = 0;
+}
+
+/*
+================
+SV_WorldTraceTask
+================
+*/
+static void SV_WorldTraceTask (int index, void *unused)
+{
+	int			  i, first, last;
+	worldtrace_t *wt;
+
+	first = (num_world_traces * index) / NUM_WORLD_TRACE_TASKS;
+	last = (num_world_traces * (index + 1)) / NUM_WORLD_TRACE_TASKS;
+	for (i = first; i < last; i++)
+	{
+		wt = &world_traces[i];
+		wt->trace = SV_ClipMoveToWorld (wt->start, wt->mins, wt->maxs, wt->end, wt->type);
+	}
+}
+
+/*
+================
+SV_PredictWorldTraces
+
+Traces the move SV_Physics_Toss will make for every tossed entity that won't think this frame
+against the world on the workers. The touch functions run in edict order and can still change
+everything, so SV_PushEntity only uses a trace if the move turned out the same and does the
+part against the other entities itself.
+================
+*/
+static void SV_PredictWorldTraces (int entity_cap)
+{
+	int			  i, first;
+	edict_t		 *ent;
+	worldtrace_t *wt;
+	vec3_t		  velocity, move;
+
+	num_world_traces = 0;
+	if (!sv_parallelphysics.value || Tasks_IsWorker () || qcvm->edicts->v.solid != SOLID_BSP || qcvm->edicts->v.movetype != MOVETYPE_PUSH)
+		return;
+
+	if (max_world_traces < entity_cap)
+	{
+		max_world_traces = entity_cap;
+		world_traces = (worldtrace_t *)Mem_Realloc (world_traces, max_world_traces * sizeof (worldtrace_t));
+	}
+
+	first = (qcvm == &sv.qcvm) ? svs.maxclients + 1 : 1;
+	for (i = first, ent = EDICT_NUM (first); i < entity_cap; i++, ent = NEXT_EDICT (ent))
+	{
+		if (ent->free || ((int)ent->v.flags & FL_ONGROUND))
+			continue;
+		if (ent->v.movetype != MOVETYPE_TOSS && ent->v.movetype != MOVETYPE_GIB && ent->v.movetype != MOVETYPE_BOUNCE &&
+			ent->v.movetype != MOVETYPE_FLY && ent->v.movetype != MOVETYPE_FLYMISSILE)
+			continue;
+		if (ent->v.nextthink > 0 && ent->v.nextthink <= qcvm->time + sv_frametime)
+			continue;
+		if (IS_NAN (ent->v.velocity[0]) || IS_NAN (ent->v.velocity[1]) || IS_NAN (ent->v.velocity[2]) || IS_NAN (ent->v.origin[0]) ||
+			IS_NAN (ent->v.origin[1]) || IS_NAN (ent->v.origin[2]))
+			continue;
+
+		// same steps as SV_Physics_Toss
+		VectorCopy (ent->v.velocity, velocity);
+		velocity[0] = CLAMP (-sv_maxvelocity.value, velocity[0], sv_maxvelocity.value);
+		velocity[1] = CLAMP (-sv_maxvelocity.value, velocity[1], sv_maxvelocity.value);
+		velocity[2] = CLAMP (-sv_maxvelocity.value, velocity[2], sv_maxvelocity.value);
+		if (ent->v.movetype != MOVETYPE_FLY && ent->v.movetype != MOVETYPE_FLYMISSILE)
+			velocity[2] -= SV_GravityScale (ent) * sv_gravity.value * sv_frametime;
+		VectorScale (velocity, sv_frametime, move);
+
+		wt = &world_traces[num_world_traces++];
+		wt->entnum = i;
+		wt->type = SV_PushEntityMoveType (ent);
+		VectorCopy (ent->v.origin, wt->start);
+		VectorAdd (ent->v.origin, move, wt->end);
+		VectorCopy (ent->v.mins, wt->mins);
+		VectorCopy (ent->v.maxs, wt->maxs);
+		world_trace_index[i] = num_world_traces;
+	}
+
+	if (num_world_traces < MIN_PARALLEL_WORLD_TRACES)
+	{
+		SV_ClearWorldTraces ();
+		return;
+	}
+
+	Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (SV_WorldTraceTask, NUM_WORLD_TRACE_TASKS, NULL, 0), TASK_TIMEOUT_INFINITE);
+}
+
 /*
 ================
 SV_Physics
@@ -1263,7 +1485,7 @@ void SV_Physics (void)
 
 	if (!physics_mode)
 	{
-		qcvm->time += host_frametime;
+		qcvm->time += sv_frametime;
 		return;
 	}
 	else if (physics_mode == 1)
@@ -1274,7 +1496,7 @@ void SV_Physics (void)
 				continue;
 			SV_RunThink (ent);
 		}
-		qcvm->time += host_frametime;
+		qcvm->time += sv_frametime;
 		return;
 	}
 
@@ -1303,6 +1525,7 @@ void SV_Physics (void)
 	if (sv_fastpushmove.value > 0.f)
 	{
 		num_pushable_ent_cache = 0;
+		pushable_ent_cache_grid = qcvm->areagrid;
 		// beware, we skip entity 0 here:
 		edict_t *check = NEXT_EDICT (qcvm->edicts);
 		for (int e = 1; e < qcvm->num_edicts; e++, check = NEXT_EDICT (check))
@@ -1311,11 +1534,15 @@ void SV_Physics (void)
 				continue;
 			if (check->v.movetype == MOVETYPE_PUSH || check->v.movetype == MOVETYPE_NONE || check->v.movetype == MOVETYPE_NOCLIP)
 				continue;
+			if (pushable_ent_cache_grid && check->areacell && !(((int)check->v.flags & FL_ONGROUND) && check->v.groundentity))
+				continue; // SV_PushMoveChecks gets it from the grid
 
 			pushable_ent_cache[num_pushable_ent_cache++] = check;
 		}
 	}
 
+	SV_PredictWorldTraces (entity_cap);
+
 	// for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
 	for (i = 0; i < entity_cap; i++, ent = NEXT_EDICT (ent))
 	{
@@ -1358,9 +1585,11 @@ void SV_Physics (void)
 		// johnfitz
 	}
 
+	SV_ClearWorldTraces ();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
 
 	if (!(sv_freezenonclients.value && qcvm == &sv.qcvm))
-		qcvm->time += host_frametime;
+		qcvm->time += sv_frametime;
 }
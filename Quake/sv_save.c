@@ -0,0 +1,708 @@
+/*
+ * sv_save.c -- compressed binary savegames
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+#include "miniz.h"
+
+// With sv_savebinary the save command copies the raw entity fields into a snapshot instead of
+// printing every field with ED_Write. Only the string and entity fields need translating, their
+// offsets are resolved once per save from the field defs. The snapshot is taken on the main thread,
+// compressing and writing the file runs on a task and the result is reported by SV_FinishSave.
+//
+// The file starts with the version and comment lines of the text format, so the save menus read
+// it unchanged, followed by the deflated snapshot. It is only loadable with the same progs.dat.
+// Everything is stored in native byte order, little endian on every supported platform.
+
+cvar_t sv_savebinary = {"sv_savebinary", "0", CVAR_ARCHIVE};
+
+#define BINARYSAVE_VERSION 100 // first line of the file, text saves are SAVEGAME_VERSION
+#define BINARYSAVE_MAGIC   (('V' << 0) | ('K' << 8) | ('S' << 16) | ('V' << 24))
+#define BINARYSAVE_FREE	   0x100 // edict flags, the low byte is the alpha
+
+typedef struct
+{
+	double	 time;
+	uint32_t progscrc;
+	uint32_t entityfields;
+	uint32_t numglobals;
+	uint32_t num_edicts;
+	uint32_t num_globals;
+	uint32_t num_strings;
+	uint32_t strings_offset;
+	int32_t	 skill;
+	int32_t	 serverflags;
+	float	 spawn_parms[NUM_TOTAL_SPAWN_PARMS];
+	char	 mapname[MAX_QPATH];
+} binarysave_header_t;
+
+typedef struct
+{
+	char	 path[MAX_OSPATH];
+	char	 comment[SAVEGAME_COMMENT_LENGTH + 1];
+	char	 mapname[MAX_QPATH];
+	double	 time;
+	byte	*snapshot; // VEC
+	qboolean written;
+} binarysave_job_t;
+
+typedef struct
+{
+	byte	   *data;	 // VEC
+	byte	   *strings; // VEC, the table referenced by string fields that aren't progs strings
+	uint32_t	num_strings;
+	hash_map_t *string_map; // string_t -> table index
+} savewriter_t;
+
+typedef struct
+{
+	const byte *data;
+	size_t		size;
+	size_t		pos;
+} savereader_t;
+
+static binarysave_job_t *save_job;
+static task_handle_t	 save_task = INVALID_TASK_HANDLE;
+
+/*
+===============
+Save_Write / Save_WriteString
+===============
+*/
+static void Save_Write (byte **buf, const void *data, size_t size)
+{
+	Vec_Append ((void **)buf, 1, data, size);
+}
+
+static void Save_WriteInt (byte **buf, int32_t value)
+{
+	Save_Write (buf, &value, sizeof (value));
+}
+
+static void Save_WriteString (byte **buf, const char *s)
+{
+	// the length includes the terminator, 0 is a NULL string
+	const uint32_t len = s ? (uint32_t)strlen (s) + 1 : 0;
+	Save_Write (buf, &len, sizeof (len));
+	Save_Write (buf, s, len);
+}
+
+/*
+===============
+Save_Read / Save_ReadString
+===============
+*/
+static const void *Save_Read (savereader_t *r, size_t size)
+{
+	if (size > r->size - r->pos)
+		Host_Error ("Savegame is truncated");
+	const void *p = r->data + r->pos;
+	r->pos += size;
+	return p;
+}
+
+static int32_t Save_ReadInt (savereader_t *r)
+{
+	int32_t value;
+	memcpy (&value, Save_Read (r, sizeof (value)), sizeof (value));
+	return value;
+}
+
+static const char *Save_ReadString (savereader_t *r)
+{
+	const uint32_t len = (uint32_t)Save_ReadInt (r);
+	if (!len)
+		return NULL;
+	const char *s = (const char *)Save_Read (r, len);
+	if (s[len - 1])
+		Host_Error ("Savegame has a broken string");
+	return s;
+}
+
+/*
+===============
+SV_SaveStringRef
+
+Progs strings are the same in the progs that loads the save, everything else goes to the string table
+===============
+*/
+static int32_t SV_SaveStringRef (savewriter_t *w, string_t s)
+{
+	if (s >= 0 && s < qcvm->stringssize)
+		return s;
+
+	uint32_t *index = HashMap_Lookup (uint32_t, w->string_map, &s);
+	if (index)
+		return -1 - (int32_t)*index;
+
+	const uint32_t new_index = w->num_strings++;
+	HashMap_Insert (w->string_map, &s, &new_index);
+	Save_WriteString (&w->strings, PR_GetString (s));
+	return -1 - (int32_t)new_index;
+}
+
+/*
+===============
+SV_FieldOffsets
+
+Resolves the entity fields that ED_Write would translate, skip fields are the DEF_SAVEGLOBAL
+tagged ones that it leaves out
+===============
+*/
+static void SV_FieldOffsets (int **string_ofs, int **entity_ofs, int **skip_ofs)
+{
+	for (int i = 1; i < qcvm->progs->numfielddefs; i++)
+	{
+		const ddef_t *d = &qcvm->fielddefs[i];
+		const int	  type = d->type & ~DEF_SAVEGLOBAL;
+		const int	  size = (type == ev_vector) ? 3 : 1;
+		if (d->ofs + size > qcvm->progs->entityfields)
+			continue;
+
+		if (d->type & DEF_SAVEGLOBAL)
+		{
+			for (int j = 0; j < size; j++)
+				VEC_PUSH (*skip_ofs, d->ofs + j);
+		}
+		else if (type == ev_string)
+			VEC_PUSH (*string_ofs, d->ofs);
+		else if (type == ev_entity)
+			VEC_PUSH (*entity_ofs, d->ofs);
+	}
+}
+
+/*
+===============
+SV_GlobalSize
+
+Size in words of the global types ED_WriteGlobals saves, 0 for the others
+===============
+*/
+static int SV_GlobalSize (int type)
+{
+	switch (type)
+	{
+	case ev_string:
+	case ev_float:
+	case ev_entity:
+	case ev_ext_integer:
+	case ev_ext_uint32:
+		return 1;
+	case ev_ext_double:
+	case ev_ext_sint64:
+	case ev_ext_uint64:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+/*
+===============
+SV_SnapshotGame
+
+Copies the game state of the current qcvm, returns the snapshot VEC
+===============
+*/
+static byte *SV_SnapshotGame (void)
+{
+	savewriter_t		w;
+	binarysave_header_t header;
+	int					i;
+
+	memset (&w, 0, sizeof (w));
+	memset (&header, 0, sizeof (header));
+	w.string_map = HashMap_Create (string_t, uint32_t, &HashInt32, NULL);
+
+	header.time = qcvm->time;
+	header.progscrc = qcvm->progscrc;
+	header.entityfields = qcvm->progs->entityfields;
+	header.numglobals = qcvm->progs->numglobals;
+	header.num_edicts = qcvm->num_edicts;
+	header.skill = current_skill;
+	header.serverflags = svs.serverflags;
+	memcpy (header.spawn_parms, svs.clients->spawn_parms, sizeof (header.spawn_parms));
+	q_strlcpy (header.mapname, sv.name, sizeof (header.mapname));
+	Save_Write (&w.data, &header, sizeof (header)); // counts and the string table offset are patched at the end
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		Save_WriteString (&w.data, sv.lightstyles[i] ? sv.lightstyles[i] : "m");
+
+	// the same globals as ED_WriteGlobals
+	for (i = 0; i < qcvm->progs->numglobaldefs; i++)
+	{
+		const ddef_t *def = &qcvm->globaldefs[i];
+		const int	  type = def->type & ~DEF_SAVEGLOBAL;
+		if (!(def->type & DEF_SAVEGLOBAL))
+			continue;
+
+		const int size = SV_GlobalSize (type);
+		if (!size || def->ofs + size > qcvm->progs->numglobals)
+			continue;
+
+		int32_t value[2];
+		memcpy (value, &qcvm->globals[def->ofs], size * sizeof (int32_t));
+		if (type == ev_string)
+			value[0] = SV_SaveStringRef (&w, value[0]);
+		else if (type == ev_entity)
+			value[0] /= qcvm->edict_size;
+
+		Save_WriteInt (&w.data, def->ofs);
+		Save_WriteInt (&w.data, type);
+		Save_Write (&w.data, value, size * sizeof (int32_t));
+		header.num_globals++;
+	}
+
+	int *string_ofs = NULL;
+	int *entity_ofs = NULL;
+	int *skip_ofs = NULL;
+	SV_FieldOffsets (&string_ofs, &entity_ofs, &skip_ofs);
+
+	const size_t fields_size = qcvm->progs->entityfields * 4;
+	for (i = 0; i < qcvm->num_edicts; i++)
+	{
+		edict_t *ed = EDICT_NUM (i);
+		Save_WriteInt (&w.data, ed->alpha | (ed->free ? BINARYSAVE_FREE : 0));
+		if (ed->free)
+			continue;
+
+		const int32_t *src = (const int32_t *)&ed->v;
+		const size_t   pos = VEC_SIZE (w.data);
+		Save_Write (&w.data, src, fields_size);
+
+		// the destination isn't aligned, write the translated values with memcpy
+		int32_t *dst = (int32_t *)(w.data + pos);
+		int32_t	 value;
+		for (size_t j = 0; j < VEC_SIZE (string_ofs); j++)
+		{
+			value = src[string_ofs[j]];
+			if (value)
+				value = SV_SaveStringRef (&w, value);
+			memcpy (&dst[string_ofs[j]], &value, sizeof (value));
+		}
+		for (size_t j = 0; j < VEC_SIZE (entity_ofs); j++)
+		{
+			value = src[entity_ofs[j]] / qcvm->edict_size;
+			memcpy (&dst[entity_ofs[j]], &value, sizeof (value));
+		}
+		value = 0;
+		for (size_t j = 0; j < VEC_SIZE (skip_ofs); j++)
+			memcpy (&dst[skip_ofs[j]], &value, sizeof (value));
+	}
+
+	VEC_FREE (string_ofs);
+	VEC_FREE (entity_ofs);
+	VEC_FREE (skip_ofs);
+
+	for (i = 1; i < MAX_MODELS; i++)
+		Save_WriteString (&w.data, sv.model_precache[i]);
+	for (i = 1; i < MAX_SOUNDS; i++)
+		Save_WriteString (&w.data, sv.sound_precache[i]);
+	for (i = 1; i < MAX_PARTICLETYPES; i++)
+		Save_WriteString (&w.data, sv.particle_precache[i]);
+	Save_WriteString (&w.data, Fog_GetFogCommand (true));
+	Save_WriteString (&w.data, Sky_GetSkyCommand (true));
+
+	header.num_strings = w.num_strings;
+	header.strings_offset = VEC_SIZE (w.data);
+	Save_Write (&w.data, w.strings, VEC_SIZE (w.strings));
+	memcpy (w.data, &header, sizeof (header));
+
+	VEC_FREE (w.strings);
+	HashMap_Destroy (w.string_map);
+	return w.data;
+}
+
+/*
+===============
+SV_WriteSaveTask
+
+Deflates the snapshot and writes the file, under a temporary name so that a half written save never replaces a good one
+===============
+*/
+static void SV_WriteSaveTask (void *payload)
+{
+	binarysave_job_t *job = *(binarysave_job_t **)payload;
+	const size_t	  size = VEC_SIZE (job->snapshot);
+	const size_t	  max_packed_size = 128 + size + (size / (31 * 1024) + 1) * 5; // worst case of stored blocks
+	byte			 *packed = Mem_AllocNonZero (max_packed_size);
+	const size_t	  packed_size = tdefl_compress_mem_to_mem (packed, max_packed_size, job->snapshot, size, TDEFL_DEFAULT_MAX_PROBES);
+
+	job->written = false;
+	if (packed_size)
+	{
+		char temp_path[MAX_OSPATH];
+		q_snprintf (temp_path, sizeof (temp_path), "%s.tmp", job->path);
+		FILE *f = fopen (temp_path, "wb");
+		if (f)
+		{
+			const uint32_t prefix[3] = {BINARYSAVE_MAGIC, (uint32_t)size, (uint32_t)packed_size};
+			fprintf (f, "%i\n%s\n", BINARYSAVE_VERSION, job->comment);
+			job->written = fwrite (prefix, sizeof (prefix), 1, f) == 1 && fwrite (packed, 1, packed_size, f) == packed_size;
+			job->written = (fclose (f) == 0) && job->written;
+			remove (job->path);
+			if (!job->written || rename (temp_path, job->path) != 0)
+			{
+				remove (temp_path);
+				job->written = false;
+			}
+		}
+	}
+
+	Mem_Free (packed);
+	VEC_FREE (job->snapshot);
+}
+
+/*
+===============
+SV_FinishSave
+
+Reports a binary save once its task is done, with wait it blocks until then
+===============
+*/
+void SV_FinishSave (qboolean wait)
+{
+	if (save_task == INVALID_TASK_HANDLE)
+		return;
+	if (!Task_Join (save_task, wait ? TASK_TIMEOUT_INFINITE : 0))
+		return;
+	save_task = INVALID_TASK_HANDLE;
+
+	if (save_job->written)
+	{
+		Con_Printf ("done.\n");
+		SaveList_UpdateInfo (save_job->path, save_job->comment, save_job->mapname, save_job->time);
+	}
+	else
+		Con_Printf ("ERROR: couldn't write %s.\n", save_job->path);
+	Mem_Free (save_job);
+	save_job = NULL;
+
+	SaveList_Rebuild ();
+}
+
+/*
+===============
+SV_WriteBinarySave
+
+Snapshots the server qcvm and queues the compression and file write
+===============
+*/
+void SV_WriteBinarySave (const char *path, const char *comment)
+{
+	// one save at a time, the next one may well go to the same file
+	SV_FinishSave (true);
+
+	save_job = Mem_Alloc (sizeof (binarysave_job_t));
+	q_strlcpy (save_job->path, path, sizeof (save_job->path));
+	q_strlcpy (save_job->comment, comment, sizeof (save_job->comment));
+	q_strlcpy (save_job->mapname, sv.name, sizeof (save_job->mapname));
+	save_job->time = qcvm->time;
+	save_job->snapshot = SV_SnapshotGame ();
+	save_task = Task_AllocateAssignBackgroundFuncAndSubmit (SV_WriteSaveTask, &save_job, sizeof (save_job));
+}
+
+/*
+===============
+SV_InflateSave
+
+Returns the inflated snapshot of a binary save, NULL if the file is missing or a text save,
+or with binary set if it is broken
+===============
+*/
+static byte *SV_InflateSave (const char *path, size_t *size, qboolean *binary)
+{
+	char	 line[64];
+	int		 version;
+	uint32_t prefix[3];
+
+	*binary = false;
+	FILE *f = fopen (path, "rb");
+	if (!f)
+		return NULL;
+	if (!fgets (line, sizeof (line), f) || sscanf (line, "%i", &version) != 1 || version != BINARYSAVE_VERSION)
+	{
+		fclose (f);
+		return NULL;
+	}
+	*binary = true;
+
+	byte *packed = NULL;
+	byte *data = NULL;
+	if (fgets (line, sizeof (line), f) && fread (prefix, sizeof (prefix), 1, f) == 1 && prefix[0] == BINARYSAVE_MAGIC &&
+		prefix[1] >= sizeof (binarysave_header_t) && prefix[2] <= (uint32_t)Sys_filelength (f))
+	{
+		packed = Mem_AllocNonZero (prefix[2]);
+		data = Mem_AllocNonZero (prefix[1]);
+		if (fread (packed, 1, prefix[2], f) != prefix[2] || tinfl_decompress_mem_to_mem (data, prefix[1], packed, prefix[2], 0) != prefix[1])
+		{
+			Mem_Free (data);
+			data = NULL;
+		}
+	}
+	fclose (f);
+	Mem_Free (packed);
+
+	*size = data ? prefix[1] : 0;
+	return data;
+}
+
+/*
+===============
+SV_LoadBinarySave
+
+Returns the inflated snapshot of a binary save, NULL if the file is missing or a text save
+===============
+*/
+byte *SV_LoadBinarySave (const char *path, size_t *size)
+{
+	qboolean binary;
+
+	// the save may still be on its way to the disk
+	SV_FinishSave (true);
+
+	byte *data = SV_InflateSave (path, size, &binary);
+	if (binary && !data)
+		Host_Error ("%s is not a valid savegame", path);
+	return data;
+}
+
+/*
+===============
+SV_BinarySaveInfo
+
+The map and time of a binary save for the save list, false if it isn't one
+===============
+*/
+qboolean SV_BinarySaveInfo (const char *path, char mapname[MAX_QPATH], double *time)
+{
+	binarysave_header_t header;
+	qboolean			binary;
+	size_t				size;
+
+	byte *data = SV_InflateSave (path, &size, &binary);
+	if (!data)
+		return false;
+
+	memcpy (&header, data, sizeof (header));
+	q_strlcpy (mapname, header.mapname, MAX_QPATH);
+	*time = header.time;
+	Mem_Free (data);
+	return true;
+}
+
+/*
+===============
+SV_ReadBinarySaveHeader
+
+The part of the save needed before the map is spawned
+===============
+*/
+void SV_ReadBinarySaveHeader (const byte *save, float spawn_parms[NUM_TOTAL_SPAWN_PARMS], int *skill, char mapname[MAX_QPATH], double *time)
+{
+	binarysave_header_t header;
+	memcpy (&header, save, sizeof (header));
+	memcpy (spawn_parms, header.spawn_parms, sizeof (header.spawn_parms));
+	*skill = header.skill;
+	q_strlcpy (mapname, header.mapname, MAX_QPATH);
+	*time = header.time;
+}
+
+/*
+===============
+SV_ApplySaveEnvironment
+
+fastload keeps the client, restores the fog and sky commands of the save like the extended text saves
+===============
+*/
+static void SV_ApplySaveEnvironment (const char *command)
+{
+	while (command && (command = COM_Parse (command)) && com_token[0])
+	{
+		if (!strcmp (com_token, "fog"))
+		{
+			float v[4];
+			for (int i = 0; i < 4; i++)
+			{
+				command = COM_Parse (command);
+				v[i] = atof (com_token);
+			}
+			Fog_Update (v[0], v[1], v[2], v[3], 0.0f);
+		}
+		else if (!strcmp (com_token, "sky"))
+		{
+			command = COM_Parse (command);
+			Sky_LoadSkyBox (com_token);
+		}
+		else if (!strcmp (com_token, "skyfog"))
+		{
+			command = COM_Parse (command);
+			Sky_SetSkyfog (atof (com_token));
+		}
+	}
+}
+
+/*
+===============
+SV_ReadBinarySave
+
+Restores the light styles, precaches, globals and edicts into the spawned map the same way the text
+loader does, returns the number of edicts
+===============
+*/
+int SV_ReadBinarySave (const byte *save, size_t size, qboolean fastload)
+{
+	savereader_t		r = {save, size, 0};
+	binarysave_header_t header;
+	const char		   *s;
+	int					i;
+
+	memcpy (&header, Save_Read (&r, sizeof (header)), sizeof (header));
+	if (header.progscrc != qcvm->progscrc || header.entityfields != (uint32_t)qcvm->progs->entityfields ||
+		header.numglobals != (uint32_t)qcvm->progs->numglobals)
+		Host_Error ("Savegame was made with a different progs.dat");
+	if (header.num_edicts > (uint32_t)qcvm->max_edicts)
+		Host_Error ("Savegame has %u edicts, max is %i", header.num_edicts, qcvm->max_edicts);
+	if (header.strings_offset > size)
+		Host_Error ("Savegame is truncated");
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		sv.lightstyles[i] = (const char *)q_strdup (Save_ReadString (&r));
+
+	if (fastload) // can be done for normal loads too, but keep the previous behavior
+		PR_ClearEdictStrings ();
+
+	// every string of the table is allocated once and shared by all the fields referencing it
+	savereader_t strings_reader = {save, size, header.strings_offset};
+	string_t	*strings = Mem_Alloc (q_max (header.num_strings, 1u) * sizeof (string_t));
+	for (uint32_t j = 0; j < header.num_strings; j++)
+	{
+		char  *p;
+		size_t len;
+		s = Save_ReadString (&strings_reader);
+		len = s ? strlen (s) + 1 : 1;
+		strings[j] = PR_AllocString (len, &p);
+		memcpy (p, s ? s : "", len);
+	}
+
+#define SAVE_STRING(v)	(((v) >= 0 && (v) < qcvm->stringssize) ? (v) : ((v) < 0 && -1 - (v) < (int)header.num_strings) ? strings[-1 - (v)] : 0)
+#define SAVE_ENTITY(v)	((((v) >= 0 && (v) < (int)header.num_edicts) ? (v) : 0) * qcvm->edict_size)
+
+	for (uint32_t j = 0; j < header.num_globals; j++)
+	{
+		const int ofs = Save_ReadInt (&r);
+		const int type = Save_ReadInt (&r);
+		const int size = SV_GlobalSize (type);
+		if (ofs < 0 || !size || ofs + size > qcvm->progs->numglobals)
+			Host_Error ("Savegame has a broken global");
+
+		int32_t value[2];
+		memcpy (value, Save_Read (&r, size * sizeof (int32_t)), size * sizeof (int32_t));
+		if (type == ev_string)
+			value[0] = SAVE_STRING (value[0]);
+		else if (type == ev_entity)
+			value[0] = SAVE_ENTITY (value[0]);
+		memcpy (&qcvm->globals[ofs], value, size * sizeof (int32_t));
+	}
+
+	int *string_ofs = NULL;
+	int *entity_ofs = NULL;
+	int *skip_ofs = NULL;
+	SV_FieldOffsets (&string_ofs, &entity_ofs, &skip_ofs);
+
+	const size_t fields_size = qcvm->progs->entityfields * 4;
+	for (i = 0; i < (int)header.num_edicts; i++)
+	{
+		const int flags = Save_ReadInt (&r);
+		edict_t	 *ent = EDICT_NUM (i);
+		if (i < qcvm->num_edicts)
+		{
+			// Maintain the free-list conststency
+			if (ent->free)
+				ED_RemoveFromFreeList (ent);
+
+			ent->free = false;
+			memset (&ent->v, 0, fields_size);
+		}
+		else
+		{
+			memset (ent, 0, qcvm->edict_size);
+			ent->baseline = nullentitystate;
+		}
+
+		if (flags & BINARYSAVE_FREE)
+		{
+			ED_Free (ent);
+			continue;
+		}
+
+		PR_FieldsWritten (ent, ED_MARK_FIND_ALL);
+		memcpy (&ent->v, Save_Read (&r, fields_size), fields_size);
+		int32_t *v = (int32_t *)&ent->v;
+		for (size_t j = 0; j < VEC_SIZE (string_ofs); j++)
+			v[string_ofs[j]] = SAVE_STRING (v[string_ofs[j]]);
+		for (size_t j = 0; j < VEC_SIZE (entity_ofs); j++)
+			v[entity_ofs[j]] = SAVE_ENTITY (v[entity_ofs[j]]);
+		ent->alpha = flags & 0xff;
+
+		// link it into the bsp tree
+		SV_LinkEdict (ent, false);
+	}
+
+#undef SAVE_STRING
+#undef SAVE_ENTITY
+
+	VEC_FREE (string_ofs);
+	VEC_FREE (entity_ofs);
+	VEC_FREE (skip_ofs);
+	Mem_Free (strings);
+
+	// text saves have these in the extended section after the edicts, keep that order
+	for (i = 1; i < MAX_MODELS; i++)
+	{
+		if ((s = Save_ReadString (&r)))
+		{
+			sv.model_precache[i] = (const char *)q_strdup (s);
+			sv.models[i] = Mod_ForName (sv.model_precache[i], i == 1);
+		}
+	}
+	for (i = 1; i < MAX_SOUNDS; i++)
+	{
+		if ((s = Save_ReadString (&r)))
+			sv.sound_precache[i] = (const char *)q_strdup (s);
+	}
+	for (i = 1; i < MAX_PARTICLETYPES; i++)
+	{
+		if ((s = Save_ReadString (&r)))
+		{
+			Mem_Free (sv.particle_precache[i]);
+			sv.particle_precache[i] = (const char *)q_strdup (s);
+		}
+	}
+	const char *fog_cmd = Save_ReadString (&r);
+	const char *sky_cmd = Save_ReadString (&r);
+	if (fastload)
+	{
+		SV_ApplySaveEnvironment (fog_cmd);
+		SV_ApplySaveEnvironment (sky_cmd);
+	}
+
+	svs.serverflags = header.serverflags;
+	return header.num_edicts;
+}
@@ -41,6 +41,8 @@ qfileofs_t Sys_filelength (FILE *f);
 qfileofs_t Sys_FileOpenRead (const char *path, int *hndl);
 
 void Sys_MemFileOpenRead (const byte *memory, int size, int *hndl);
+// same, but Sys_FileClose Mem_Free's the memory
+void Sys_MemFileOpenReadOwned (byte *memory, int size, int *hndl);
 
 // Returns a file handle
 int Sys_FileOpenWrite (const char *path);
@@ -55,6 +57,21 @@ int Sys_FileType (const char *path);
 /* returns an FS entity type, i.e. FS_ENT_FILE or FS_ENT_DIRECTORY.
  * returns FS_ENT_NONE (0) if no such file or directory is present. */
 
+int64_t Sys_FileTime (const char *path);
+/* returns the modification time of a file in a platform specific unit,
+ * only meant to be compared with other values of it. returns -1 if the
+ * file isn't present. */
+
+const byte *Sys_MapFileRead (const char *path, qfileofs_t *size);
+void		Sys_UnmapFile (const byte *data, qfileofs_t size);
+/* maps a whole file read-only into memory. returns NULL if the file
+ * does not exist or can't be mapped, the caller should then fall back
+ * to regular reads. */
+
+size_t Sys_FileReadAt (FILE *file, void *dest, size_t count, qfileofs_t offset);
+/* reads from an absolute offset without moving the stream position,
+ * so several threads can share one FILE. returns the bytes read. */
+
 //
 // system IO
 //
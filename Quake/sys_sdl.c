@@ -32,9 +32,10 @@ typedef struct file_handle_s
 	const byte *memory;
 	int			pos;
 	int			size;
+	qboolean	owned;
 } file_handle_t;
 
-#define MAX_HANDLES 32 /* johnfitz -- was 10 */
+#define MAX_HANDLES 64 /* johnfitz -- was 10, every pak and pk3 keeps one open */
 static file_handle_t sys_handles[MAX_HANDLES];
 
 static int findhandle (void)
@@ -92,9 +93,16 @@ void Sys_MemFileOpenRead (const byte *memory, int size, int *hndl)
 	sys_handles[i].memory = memory;
 	sys_handles[i].size = size;
 	sys_handles[i].pos = 0;
+	sys_handles[i].owned = false;
 	*hndl = i;
 }
 
+void Sys_MemFileOpenReadOwned (byte *memory, int size, int *hndl)
+{
+	Sys_MemFileOpenRead (memory, size, hndl);
+	sys_handles[*hndl].owned = true;
+}
+
 int Sys_FileOpenWrite (const char *path)
 {
 	FILE *f;
@@ -118,7 +126,12 @@ void Sys_FileClose (int handle)
 		sys_handles[handle].file = NULL;
 	}
 	else
+	{
+		if (sys_handles[handle].owned)
+			Mem_Free ((void *)sys_handles[handle].memory);
 		sys_handles[handle].memory = NULL;
+		sys_handles[handle].owned = false;
+	}
 }
 
 void Sys_FileSeek (int handle, int position)
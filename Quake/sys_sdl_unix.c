@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #endif
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #ifdef DO_USERDIRS
 #include <pwd.h>
@@ -72,6 +73,61 @@ int Sys_FileType (const char *path)
 	return FS_ENT_NONE;
 }
 
+int64_t Sys_FileTime (const char *path)
+{
+	struct stat st;
+
+	if (stat (path, &st) != 0)
+		return -1;
+
+	return (int64_t)st.st_mtime;
+}
+
+const byte *Sys_MapFileRead (const char *path, qfileofs_t *size)
+{
+	struct stat st;
+	void	   *data;
+	int			fd = open (path, O_RDONLY);
+
+	if (fd == -1)
+		return NULL;
+	if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size <= 0)
+	{
+		close (fd);
+		return NULL;
+	}
+
+	data = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd); // the mapping keeps its own reference
+	if (data == MAP_FAILED)
+		return NULL;
+
+	*size = (qfileofs_t)st.st_size;
+	return (const byte *)data;
+}
+
+void Sys_UnmapFile (const byte *data, qfileofs_t size)
+{
+	munmap ((void *)data, (size_t)size);
+}
+
+size_t Sys_FileReadAt (FILE *file, void *dest, size_t count, qfileofs_t offset)
+{
+	size_t total = 0;
+	int	   fd = fileno (file);
+
+	while (total < count)
+	{
+		ssize_t ret = pread (fd, (byte *)dest + total, count - total, (off_t)(offset + total));
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+		total += ret;
+	}
+	return total;
+}
+
 static char cwd[MAX_OSPATH];
 #ifdef DO_USERDIRS
 static char userdir[MAX_OSPATH];
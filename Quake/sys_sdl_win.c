@@ -51,6 +51,72 @@ int Sys_FileType (const char *path)
 	return FS_ENT_FILE;
 }
 
+int64_t Sys_FileTime (const char *path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+
+	if (!GetFileAttributesEx (path, GetFileExInfoStandard, &data))
+		return -1;
+
+	return ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+const byte *Sys_MapFileRead (const char *path, qfileofs_t *size)
+{
+	LARGE_INTEGER file_size;
+	HANDLE		  mapping;
+	void		 *data;
+	HANDLE		  file = CreateFile (path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	if (!GetFileSizeEx (file, &file_size) || file_size.QuadPart <= 0)
+	{
+		CloseHandle (file);
+		return NULL;
+	}
+
+	mapping = CreateFileMapping (file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle (file); // the mapping keeps its own reference
+	if (!mapping)
+		return NULL;
+	data = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle (mapping); // as does the view
+	if (!data)
+		return NULL;
+
+	*size = (qfileofs_t)file_size.QuadPart;
+	return (const byte *)data;
+}
+
+void Sys_UnmapFile (const byte *data, qfileofs_t size)
+{
+	(void)size;
+	UnmapViewOfFile (data);
+}
+
+size_t Sys_FileReadAt (FILE *file, void *dest, size_t count, qfileofs_t offset)
+{
+	HANDLE handle = (HANDLE)_get_osfhandle (_fileno (file));
+	size_t total = 0;
+
+	while (total < count)
+	{
+		OVERLAPPED overlapped;
+		DWORD	   read = 0;
+		DWORD	   chunk = (DWORD)((count - total) > 0x40000000 ? 0x40000000 : (count - total));
+		ULONGLONG  pos = (ULONGLONG)(offset + total);
+
+		memset (&overlapped, 0, sizeof (overlapped));
+		overlapped.Offset = (DWORD)pos;
+		overlapped.OffsetHigh = (DWORD)(pos >> 32);
+		if (!ReadFile (handle, (byte *)dest + total, chunk, &read, &overlapped) || !read)
+			break;
+		total += read;
+	}
+	return total;
+}
+
 static HANDLE hinput, houtput;
 static char	  cwd[1024];
 static double counter_freq;
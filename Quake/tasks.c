@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "atomics.h"
 #include "quakedef.h"
 #include "q_ctype.h"
+#include "bench.h"
 
 // clang-format off
 #if defined(_WIN32)
@@ -57,13 +58,20 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define NUM_INDEX_BITS		 8
 #define MAX_PENDING_TASKS	 (1u << NUM_INDEX_BITS)
 #define MAX_EXECUTABLE_TASKS 256
+#define WORKER_DEQUE_SIZE	 256
 #define MAX_DEPENDENT_TASKS	 16
 #define MAX_PAYLOAD_SIZE	 128
 #define WORKER_HUNK_SIZE	 (1 * 1024 * 1024)
-#define WAIT_SPIN_COUNT		 100
+#define MIN_WAIT_SPIN_COUNT	 16
+#define MAX_WAIT_SPIN_COUNT	 4096
+#define SHORT_PARK_US		 50
+#define TRACE_BUFFER_SIZE	 8192
+#define TRACE_MAIN_BUFFER	 TASKS_MAX_WORKERS
 
 COMPILE_TIME_ASSERT (tasks, MAX_EXECUTABLE_TASKS >= 256);
 COMPILE_TIME_ASSERT (tasks, MAX_PENDING_TASKS >= MAX_EXECUTABLE_TASKS);
+COMPILE_TIME_ASSERT (tasks, (WORKER_DEQUE_SIZE & (WORKER_DEQUE_SIZE - 1)) == 0);
+COMPILE_TIME_ASSERT (tasks, (TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0);
 
 typedef enum
 {
@@ -77,6 +85,7 @@ typedef struct
 	task_type_t		task_type;
 	int				num_dependents;
 	int				indexed_limit;
+	task_priority_t priority;
 	atomic_uint32_t remaining_workers;
 	atomic_uint32_t remaining_dependencies;
 	uint64_t		epoch;
@@ -99,26 +108,110 @@ typedef struct
 	atomic_uint32_t task_indices[1];
 } task_queue_t;
 
+// Chase-Lev style work-stealing deque, one per worker. Only the owning worker
+// pushes and pops at the bottom (LIFO), other workers steal from the top (FIFO).
+// top and bottom only ever increase, the difference is the number of entries.
+typedef struct
+{
+	atomic_uint32_t top;
+	uint32_t		top_padding[15]; // Pad to 64 byte cache line size
+	atomic_uint32_t bottom;
+	uint32_t		bottom_padding[15];
+	atomic_uint32_t task_indices[WORKER_DEQUE_SIZE];
+} task_deque_t;
+
 typedef struct
 {
 	atomic_uint32_t index;
 	uint32_t		limit;
 } task_counter_t;
 
+typedef enum
+{
+	TRACE_EVENT_TASK,  // scalar task, or one counter run of an indexed task
+	TRACE_EVENT_JOIN,  // time blocked in Task_Join
+	TRACE_EVENT_EDGE,  // Task_AddDependency, handle -> dependent
+	TRACE_EVENT_FRAME, // Tasks_TraceFrame
+	TRACE_EVENT_SPIN,  // SpinWaitSemaphore spinning before it got a count or parked
+	TRACE_EVENT_PARK,  // SpinWaitSemaphore blocked in SDL_WaitSemaphore
+} trace_event_type_t;
+
+typedef struct
+{
+	uint64_t		   begin;
+	uint64_t		   end;
+	task_handle_t	   handle;
+	task_handle_t	   dependent;
+	void			  *func;
+	uint32_t		   first_index; // indexed tasks only
+	uint32_t		   last_index;
+	trace_event_type_t type;
+} trace_event_t;
+
+// single producer ring: only the owning thread writes, the dump reads after tracing stopped
+typedef struct
+{
+	atomic_uint32_t count;
+	trace_event_t  *events;
+} trace_buffer_t;
+
+#ifdef _DEBUG
+// written by the owning worker only, read racily by test_tasks
+typedef struct
+{
+	uint32_t local_pops;
+	uint32_t shared_pops;
+	uint32_t steals;
+	uint32_t background_pops;
+	double	 wait_time;
+	uint32_t padding[9];
+} worker_stats_t;
+#endif
+
 static int					 num_workers = 0;
 static task_t				 tasks[MAX_PENDING_TASKS];
 static task_queue_t			*free_task_queue;
 static task_queue_t			*executable_task_queue;
+static task_queue_t			*background_task_queue;
+static task_deque_t			*worker_deques;
+static SDL_Semaphore		*executable_semaphore; // one count per executable entry in any queue or deque
 static task_counter_t		*indexed_task_counters;
 static uint8_t				 steal_worker_indices[TASKS_MAX_WORKERS * 2];
 static THREAD_LOCAL qboolean is_worker = false;
 static THREAD_LOCAL int		 tl_worker_index;
+static THREAD_LOCAL int		 tl_spin_budget = MAX_WAIT_SPIN_COUNT / 16;
+static atomic_uint32_t		 idle_mode = {TASKS_IDLE_ADAPTIVE};
+static uint64_t				 short_park_ticks;
 
 COMPILE_TIME_ASSERT (steal_worker_indices, TASKS_MAX_WORKERS * 2 < UINT8_MAX);
 
+// 0 parks right away, 1 adapts the spin before parking, 2 always spins the maximum
+static cvar_t tasks_idle = {"tasks_idle", "1", CVAR_ARCHIVE};
+
 static int pinned_workers_core_ids[TASKS_MAX_WORKERS];
 static int num_pinned_workers = 0;
 
+#ifdef _DEBUG
+static worker_stats_t worker_stats[TASKS_MAX_WORKERS];
+#endif
+
+// Time workers spent waiting for work in Task_PopExecutable, for Tasks_Utilization.
+// idle_ticks only grows once a wait ended, wait_begin is the start of the current one.
+typedef struct
+{
+	atomic_uint64_t idle_ticks;
+	atomic_uint64_t wait_begin; // 0 while running tasks
+	uint64_t		padding[6];
+} worker_idle_t;
+static worker_idle_t worker_idle[TASKS_MAX_WORKERS];
+
+static trace_buffer_t	trace_buffers[TASKS_MAX_WORKERS + 1]; // workers, then the main thread
+static atomic_uint32_t	trace_active;
+static int				trace_frames_left;
+static uint64_t			trace_start;
+static char				trace_filename[MAX_OSPATH];
+static THREAD_LOCAL int	tl_trace_buffer = -1;
+
 /*
 ====================
 IndexedTaskCounterIndex
@@ -170,6 +263,31 @@ static uint32_t ShuffleIndex (uint32_t i)
 	return (i & ~0xFF) | ((i & 0xF) << 4) | ((i >> 4) & 0xF);
 }
 
+/*
+====================
+Trace_Active
+====================
+*/
+static inline qboolean Trace_Active (void)
+{
+	return Atomic_LoadUInt32 (&trace_active) != 0;
+}
+
+/*
+====================
+Trace_Record
+====================
+*/
+static inline void Trace_Record (const trace_event_t *event)
+{
+	if (tl_trace_buffer < 0)
+		return; // not a worker or the main thread
+	trace_buffer_t *buffer = &trace_buffers[tl_trace_buffer];
+	const uint32_t	count = Atomic_LoadUInt32 (&buffer->count);
+	buffer->events[count & (TRACE_BUFFER_SIZE - 1)] = *event;
+	Atomic_StoreUInt32 (&buffer->count, count + 1);
+}
+
 /*
 ====================
 CPUPause
@@ -187,23 +305,69 @@ static inline void CPUPause ()
 #endif
 }
 
+/*
+====================
+Trace_RecordWait
+====================
+*/
+static inline void Trace_RecordWait (trace_event_type_t type, uint64_t begin, uint64_t end)
+{
+	trace_event_t event;
+	memset (&event, 0, sizeof (event));
+	event.type = type;
+	event.begin = begin;
+	event.end = end;
+	event.handle = INVALID_TASK_HANDLE;
+	event.dependent = INVALID_TASK_HANDLE;
+	Trace_Record (&event);
+}
+
 /*
 ====================
 SpinWaitSemaphore
+
+Spins for a while before parking the thread in the semaphore (futex or
+WaitOnAddress backed in SDL). With tasks_idle 1 every thread learns its
+spin budget from how long it stayed parked: waking up again shortly after
+parking means a bit more spinning would have caught the signal, long
+parks are idle time between frames where spinning only burns power.
 ====================
 */
 static inline void SpinWaitSemaphore (SDL_Semaphore *semaphore)
 {
-	int	 remaining_spins = WAIT_SPIN_COUNT;
-	bool signalled = false;
-	while (!(signalled = SDL_TryWaitSemaphore (semaphore)))
+	if (SDL_TryWaitSemaphore (semaphore))
+		return;
+
+	const uint32_t mode = Atomic_LoadUInt32 (&idle_mode);
+	const int	   budget = (mode == TASKS_IDLE_POWER) ? 0 : (mode == TASKS_IDLE_LATENCY) ? MAX_WAIT_SPIN_COUNT : tl_spin_budget;
+	const qboolean tracing = Trace_Active ();
+	const uint64_t spin_begin = tracing ? SDL_GetPerformanceCounter () : 0;
+	for (int spins = 0; spins < budget; ++spins)
 	{
 		CPUPause ();
-		if (--remaining_spins == 0)
-			break;
+		if (SDL_TryWaitSemaphore (semaphore))
+		{
+			if (tracing)
+				Trace_RecordWait (TRACE_EVENT_SPIN, spin_begin, SDL_GetPerformanceCounter ());
+			return;
+		}
+	}
+
+	const uint64_t park_begin = SDL_GetPerformanceCounter ();
+	if (tracing && (budget > 0))
+		Trace_RecordWait (TRACE_EVENT_SPIN, spin_begin, park_begin);
+	SDL_WaitSemaphore (semaphore);
+	const uint64_t park_end = SDL_GetPerformanceCounter ();
+	if (tracing)
+		Trace_RecordWait (TRACE_EVENT_PARK, park_begin, park_end);
+
+	if (mode == TASKS_IDLE_ADAPTIVE)
+	{
+		if ((park_end - park_begin) < short_park_ticks)
+			tl_spin_budget = q_min (tl_spin_budget * 2, MAX_WAIT_SPIN_COUNT);
+		else
+			tl_spin_budget = q_max (tl_spin_budget / 2, MIN_WAIT_SPIN_COUNT);
 	}
-	if (!signalled)
-		SDL_WaitSemaphore (semaphore);
 }
 
 /*
@@ -249,12 +413,13 @@ static inline void TaskQueuePush (task_queue_t *queue, uint32_t task_index)
 
 /*
 ====================
-TaskQueuePop
+TaskQueuePopSignalled
+
+Caller already took a count from pop_semaphore
 ====================
 */
-static inline uint32_t TaskQueuePop (task_queue_t *queue)
+static inline uint32_t TaskQueuePopSignalled (task_queue_t *queue)
 {
-	SpinWaitSemaphore (queue->pop_semaphore);
 	uint32_t tail = Atomic_LoadUInt32 (&queue->tail);
 	qboolean cas_successful = false;
 	do
@@ -275,12 +440,241 @@ static inline uint32_t TaskQueuePop (task_queue_t *queue)
 	return val;
 }
 
+/*
+====================
+TaskQueuePop
+====================
+*/
+static inline uint32_t TaskQueuePop (task_queue_t *queue)
+{
+	SpinWaitSemaphore (queue->pop_semaphore);
+	return TaskQueuePopSignalled (queue);
+}
+
+/*
+====================
+TaskQueueTryPop
+====================
+*/
+static inline qboolean TaskQueueTryPop (task_queue_t *queue, uint32_t *task_index)
+{
+	if (!SDL_TryWaitSemaphore (queue->pop_semaphore))
+		return false;
+	*task_index = TaskQueuePopSignalled (queue);
+	return true;
+}
+
+/*
+====================
+TaskDequePush
+
+Owner only. Returns false if the deque is full.
+====================
+*/
+static inline qboolean TaskDequePush (task_deque_t *deque, uint32_t task_index)
+{
+	const uint32_t bottom = Atomic_LoadUInt32 (&deque->bottom);
+	const uint32_t top = Atomic_LoadUInt32 (&deque->top);
+	if ((bottom - top) >= WORKER_DEQUE_SIZE)
+		return false;
+	Atomic_StoreUInt32 (&deque->task_indices[bottom & (WORKER_DEQUE_SIZE - 1)], task_index);
+	ANNOTATE_HAPPENS_BEFORE (&deque->task_indices[bottom & (WORKER_DEQUE_SIZE - 1)]);
+	Atomic_StoreUInt32 (&deque->bottom, bottom + 1);
+	return true;
+}
+
+/*
+====================
+TaskDequePop
+
+Owner only, takes the most recently pushed entry.
+====================
+*/
+static inline qboolean TaskDequePop (task_deque_t *deque, uint32_t *task_index)
+{
+	// the interlocked decrement is a full barrier: thieves have to see
+	// the reservation before we read top
+	const uint32_t bottom = Atomic_DecrementUInt32 (&deque->bottom) - 1u;
+	uint32_t	   top = Atomic_LoadUInt32 (&deque->top);
+	if ((int32_t)(bottom - top) < 0)
+	{
+		Atomic_StoreUInt32 (&deque->bottom, top);
+		return false;
+	}
+
+	*task_index = Atomic_LoadUInt32 (&deque->task_indices[bottom & (WORKER_DEQUE_SIZE - 1)]);
+	if (bottom != top)
+	{
+		ANNOTATE_HAPPENS_AFTER (&deque->task_indices[bottom & (WORKER_DEQUE_SIZE - 1)]);
+		return true;
+	}
+
+	// last entry, race against the thieves for it
+	const uint32_t last_top = top;
+	const qboolean won = Atomic_CompareExchangeUInt32 (&deque->top, &top, last_top + 1u);
+	Atomic_StoreUInt32 (&deque->bottom, last_top + 1u);
+	if (won)
+		ANNOTATE_HAPPENS_AFTER (&deque->task_indices[bottom & (WORKER_DEQUE_SIZE - 1)]);
+	return won;
+}
+
+/*
+====================
+TaskDequeSteal
+
+Any thread, takes the oldest entry.
+====================
+*/
+static inline qboolean TaskDequeSteal (task_deque_t *deque, uint32_t *task_index)
+{
+	uint32_t	   top = Atomic_LoadUInt32 (&deque->top);
+	const uint32_t bottom = Atomic_LoadUInt32 (&deque->bottom);
+	if ((int32_t)(bottom - top) <= 0)
+		return false;
+
+	const uint32_t val = Atomic_LoadUInt32 (&deque->task_indices[top & (WORKER_DEQUE_SIZE - 1)]);
+	if (!Atomic_CompareExchangeUInt32 (&deque->top, &top, top + 1u))
+		return false;
+	ANNOTATE_HAPPENS_AFTER (&deque->task_indices[top & (WORKER_DEQUE_SIZE - 1)]);
+	*task_index = val;
+	return true;
+}
+
+/*
+====================
+Task_PushExecutable
+
+Workers keep their own critical submissions local, everyone
+else goes through the shared executable queue. Background
+tasks always go to their own queue so they can't end up in
+front of critical work in a deque.
+====================
+*/
+static inline void Task_PushExecutable (uint32_t task_index, task_priority_t priority)
+{
+	if (priority == TASK_PRIORITY_BACKGROUND)
+		TaskQueuePush (background_task_queue, task_index);
+	else if (!is_worker || !TaskDequePush (&worker_deques[tl_worker_index], task_index))
+		TaskQueuePush (executable_task_queue, task_index);
+	SDL_SignalSemaphore (executable_semaphore);
+}
+
+/*
+====================
+Task_TakeReserved
+
+Caller already took a count from executable_semaphore, which guarantees
+that one entry is reserved for us somewhere: local deque first, then the
+shared queue, then steal from the other workers and only if all of that
+is empty take a background task
+====================
+*/
+static inline uint32_t Task_TakeReserved (int worker_index)
+{
+	uint32_t task_index;
+	while (true)
+	{
+		if (TaskDequePop (&worker_deques[worker_index], &task_index))
+		{
+#ifdef _DEBUG
+			++worker_stats[worker_index].local_pops;
+#endif
+			return task_index;
+		}
+		if (TaskQueueTryPop (executable_task_queue, &task_index))
+		{
+#ifdef _DEBUG
+			++worker_stats[worker_index].shared_pops;
+#endif
+			return task_index;
+		}
+		for (int i = 1; i < num_workers; ++i)
+		{
+			if (TaskDequeSteal (&worker_deques[steal_worker_indices[worker_index + i]], &task_index))
+			{
+#ifdef _DEBUG
+				++worker_stats[worker_index].steals;
+#endif
+				return task_index;
+			}
+		}
+		if (TaskQueueTryPop (background_task_queue, &task_index))
+		{
+#ifdef _DEBUG
+			++worker_stats[worker_index].background_pops;
+#endif
+			return task_index;
+		}
+		CPUPause ();
+	}
+}
+
+/*
+====================
+Task_PopExecutable
+
+Waits for an executable entry
+====================
+*/
+static inline uint32_t Task_PopExecutable (int worker_index)
+{
+#ifdef _DEBUG
+	const double wait_start = Sys_DoubleTime ();
+#endif
+	// only a worker that finds no work right away reads the clock
+	if (!SDL_TryWaitSemaphore (executable_semaphore))
+	{
+		worker_idle_t *idle = &worker_idle[worker_index];
+		const uint64_t begin = SDL_GetPerformanceCounter ();
+		Atomic_StoreUInt64 (&idle->wait_begin, begin);
+		SpinWaitSemaphore (executable_semaphore);
+		Atomic_AddUInt64 (&idle->idle_ticks, SDL_GetPerformanceCounter () - begin);
+		Atomic_StoreUInt64 (&idle->wait_begin, 0);
+	}
+#ifdef _DEBUG
+	worker_stats[worker_index].wait_time += Sys_DoubleTime () - wait_start;
+#endif
+	return Task_TakeReserved (worker_index);
+}
+
+/*
+====================
+Task_TryPopExecutable
+====================
+*/
+static inline qboolean Task_TryPopExecutable (int worker_index, uint32_t *task_index)
+{
+	if (!SDL_TryWaitSemaphore (executable_semaphore))
+		return false;
+	*task_index = Task_TakeReserved (worker_index);
+	return true;
+}
+
+/*
+====================
+Trace_RecordTask
+====================
+*/
+static inline void Trace_RecordTask (task_t *task, uint32_t task_index, uint64_t begin, uint32_t first_index, uint32_t last_index)
+{
+	trace_event_t event;
+	event.type = TRACE_EVENT_TASK;
+	event.begin = begin;
+	event.end = SDL_GetPerformanceCounter ();
+	event.handle = CreateTaskHandle (task_index, task->epoch);
+	event.dependent = INVALID_TASK_HANDLE;
+	event.func = task->func;
+	event.first_index = first_index;
+	event.last_index = last_index;
+	Trace_Record (&event);
+}
+
 /*
 ====================
 Task_ExecuteIndexed
 ====================
 */
-static inline void Task_ExecuteIndexed (int worker_index, task_t *task, uint32_t task_index)
+static inline void Task_ExecuteIndexed (int worker_index, task_t *task, uint32_t task_index, qboolean tracing)
 {
 	for (int i = 0; i < num_workers; ++i)
 	{
@@ -288,13 +682,85 @@ static inline void Task_ExecuteIndexed (int worker_index, task_t *task, uint32_t
 		int				counter_index = IndexedTaskCounterIndex (task_index, steal_worker_index);
 		task_counter_t *counter = &indexed_task_counters[counter_index];
 		uint32_t		index = 0;
+		uint32_t		first_index = UINT32_MAX;
+		uint32_t		last_index = 0;
+		uint64_t		begin = 0;
 		while ((index = Atomic_IncrementUInt32 (&counter->index)) < counter->limit)
 		{
+			if (tracing && first_index == UINT32_MAX)
+			{
+				first_index = index;
+				begin = SDL_GetPerformanceCounter ();
+			}
 			((task_indexed_func_t)task->func) (index, task->payload);
+			last_index = index;
 		}
+		// one event per counter run, so stolen sub-ranges show up separately
+		if (tracing && first_index != UINT32_MAX)
+			Trace_RecordTask (task, task_index, begin, first_index, last_index);
 	}
 }
 
+/*
+====================
+Task_Execute
+
+Runs one executable entry, the last worker to finish a task
+submits its dependents and wakes up everyone joining it
+====================
+*/
+static void Task_Execute (int worker_index, uint32_t task_index)
+{
+	task_t *task = &tasks[task_index];
+	ANNOTATE_HAPPENS_AFTER (task);
+
+	const qboolean tracing = Trace_Active ();
+	if (task->task_type == TASK_TYPE_SCALAR)
+	{
+		const uint64_t begin = tracing ? SDL_GetPerformanceCounter () : 0;
+		((task_func_t)task->func) (task->payload);
+		if (tracing)
+			Trace_RecordTask (task, task_index, begin, 0, 0);
+	}
+	else if (task->task_type == TASK_TYPE_INDEXED)
+	{
+		Task_ExecuteIndexed (worker_index, task, task_index, tracing);
+	}
+
+#if defined(USE_HELGRIND)
+	ANNOTATE_HAPPENS_BEFORE (task);
+	qboolean indexed_task = task->task_type == TASK_TYPE_INDEXED;
+	if (indexed_task)
+	{
+		// Helgrind needs to know about all threads
+		// that participated in an indexed execution
+		SDL_LockMutex (task->epoch_mutex);
+		for (int i = 0; i < task->num_dependents; ++i)
+		{
+			const int task_index = IndexFromTaskHandle (task->dependent_task_handles[i]);
+			task_t	 *dep_task = &tasks[task_index];
+			ANNOTATE_HAPPENS_BEFORE (dep_task);
+		}
+	}
+#endif
+
+	if (Atomic_DecrementUInt32 (&task->remaining_workers) == 1)
+	{
+		SDL_LockMutex (task->epoch_mutex);
+		for (int i = 0; i < task->num_dependents; ++i)
+			Task_Submit (task->dependent_task_handles[i]);
+		task->epoch += 1;
+		SDL_BroadcastCondition (task->epoch_condition);
+		SDL_UnlockMutex (task->epoch_mutex);
+		TaskQueuePush (free_task_queue, task_index);
+	}
+
+#if defined(USE_HELGRIND)
+	if (indexed_task)
+		SDL_UnlockMutex (task->epoch_mutex);
+#endif
+}
+
 static bool Task_Pin_Current_Worker (int pinned_index)
 {
 #if defined(_WIN32)
@@ -356,6 +822,7 @@ static int Task_Worker (void *data)
 
 	const int worker_index = (intptr_t)data;
 	tl_worker_index = worker_index;
+	tl_trace_buffer = worker_index;
 
 	// try to pin workers on different cores, if set
 	if (num_pinned_workers)
@@ -370,53 +837,7 @@ static int Task_Worker (void *data)
 	}
 
 	while (true)
-	{
-		uint32_t task_index = TaskQueuePop (executable_task_queue);
-		task_t	*task = &tasks[task_index];
-		ANNOTATE_HAPPENS_AFTER (task);
-
-		if (task->task_type == TASK_TYPE_SCALAR)
-		{
-			((task_func_t)task->func) (task->payload);
-		}
-		else if (task->task_type == TASK_TYPE_INDEXED)
-		{
-			Task_ExecuteIndexed (worker_index, task, task_index);
-		}
-
-#if defined(USE_HELGRIND)
-		ANNOTATE_HAPPENS_BEFORE (task);
-		qboolean indexed_task = task->task_type == TASK_TYPE_INDEXED;
-		if (indexed_task)
-		{
-			// Helgrind needs to know about all threads
-			// that participated in an indexed execution
-			SDL_LockMutex (task->epoch_mutex);
-			for (int i = 0; i < task->num_dependents; ++i)
-			{
-				const int task_index = IndexFromTaskHandle (task->dependent_task_handles[i]);
-				task_t	 *dep_task = &tasks[task_index];
-				ANNOTATE_HAPPENS_BEFORE (dep_task);
-			}
-		}
-#endif
-
-		if (Atomic_DecrementUInt32 (&task->remaining_workers) == 1)
-		{
-			SDL_LockMutex (task->epoch_mutex);
-			for (int i = 0; i < task->num_dependents; ++i)
-				Task_Submit (task->dependent_task_handles[i]);
-			task->epoch += 1;
-			SDL_BroadcastCondition (task->epoch_condition);
-			SDL_UnlockMutex (task->epoch_mutex);
-			TaskQueuePush (free_task_queue, task_index);
-		}
-
-#if defined(USE_HELGRIND)
-		if (indexed_task)
-			SDL_UnlockMutex (task->epoch_mutex);
-#endif
-	}
+		Task_Execute (worker_index, Task_PopExecutable (worker_index));
 	return 0;
 }
 
@@ -468,6 +889,9 @@ void Tasks_Init (void)
 {
 	free_task_queue = CreateTaskQueue (MAX_PENDING_TASKS);
 	executable_task_queue = CreateTaskQueue (MAX_EXECUTABLE_TASKS);
+	background_task_queue = CreateTaskQueue (MAX_EXECUTABLE_TASKS);
+	tl_trace_buffer = TRACE_MAIN_BUFFER; // Tasks_Init runs on the main thread
+	short_park_ticks = (SDL_GetPerformanceFrequency () * SHORT_PARK_US) / 1000000;
 
 	for (uint32_t task_index = 0; task_index < (MAX_PENDING_TASKS - 1); ++task_index)
 	{
@@ -496,12 +920,38 @@ void Tasks_Init (void)
 	}
 
 	indexed_task_counters = Mem_Alloc (sizeof (task_counter_t) * num_workers * MAX_PENDING_TASKS);
+	worker_deques = Mem_Alloc (sizeof (task_deque_t) * num_workers);
+	executable_semaphore = SDL_CreateSemaphore (0);
 	for (int i = 0; i < num_workers; ++i)
 	{
 		SDL_DetachThread (SDL_CreateThread (Task_Worker, va ("Task_Worker_%d", i), (void *)(intptr_t)i));
 	}
 }
 
+/*
+====================
+Tasks_Idle_f
+====================
+*/
+static void Tasks_Idle_f (cvar_t *var)
+{
+	Atomic_StoreUInt32 (&idle_mode, (uint32_t)CLAMP (TASKS_IDLE_POWER, (int)var->value, TASKS_IDLE_LATENCY));
+}
+
+/*
+====================
+Tasks_InitCvars
+
+Tasks_Init runs before the cvar system is up
+====================
+*/
+void Tasks_InitCvars (void)
+{
+	Cvar_RegisterVariable (&tasks_idle);
+	Cvar_SetCallback (&tasks_idle, Tasks_Idle_f);
+	Tasks_Idle_f (&tasks_idle);
+}
+
 /*
 ====================
 Tasks_NumWorkers
@@ -512,6 +962,41 @@ int Tasks_NumWorkers (void)
 	return num_workers;
 }
 
+/*
+====================
+Tasks_Utilization
+
+Fraction of the worker time since the last call that went into running tasks
+instead of waiting for one, negative on the first call. Main thread only.
+====================
+*/
+float Tasks_Utilization (void)
+{
+	static uint64_t last_time, last_idle;
+	const uint64_t	now = SDL_GetPerformanceCounter ();
+	uint64_t		idle = 0;
+
+	for (int i = 0; i < num_workers; ++i)
+	{
+		// a wait that is still going on counts up to now, its end only adds the rest
+		const uint64_t wait_begin = Atomic_LoadUInt64 (&worker_idle[i].wait_begin);
+		idle += Atomic_LoadUInt64 (&worker_idle[i].idle_ticks);
+		if (wait_begin && (wait_begin < now))
+			idle += now - wait_begin;
+	}
+
+	// a wait that ends between the two loads is counted twice, don't let the next delta wrap
+	float utilization = -1.0f;
+	if (last_time && (now > last_time) && num_workers)
+	{
+		const uint64_t idle_delta = (idle > last_idle) ? (idle - last_idle) : 0;
+		utilization = CLAMP (0.0f, 1.0f - (float)((double)idle_delta / ((double)(now - last_time) * num_workers)), 1.0f);
+	}
+	last_time = now;
+	last_idle = idle;
+	return utilization;
+}
+
 /*
 ====================
 Tasks_IsWorker
@@ -544,6 +1029,7 @@ task_handle_t Task_Allocate (void)
 	task->task_type = TASK_TYPE_NONE;
 	task->num_dependents = 0;
 	task->indexed_limit = 0;
+	task->priority = TASK_PRIORITY_CRITICAL;
 	task->func = NULL;
 	return CreateTaskHandle (task_index, task->epoch);
 }
@@ -590,6 +1076,20 @@ void Task_AssignIndexedFunc (task_handle_t handle, task_indexed_func_t func, uin
 		memcpy (&task->payload, payload, payload_size);
 }
 
+/*
+====================
+Task_SetPriority
+
+Has to happen before the task becomes executable
+====================
+*/
+void Task_SetPriority (task_handle_t handle, task_priority_t priority)
+{
+	task_t *task = &tasks[IndexFromTaskHandle (handle)];
+	assert (task->epoch == EpochFromTaskHandle (handle));
+	task->priority = priority;
+}
+
 /*
 ====================
 Task_Submit
@@ -607,7 +1107,7 @@ void Task_Submit (task_handle_t handle)
 		Atomic_StoreUInt32 (&task->remaining_workers, num_task_workers);
 		for (int i = 0; i < num_task_workers; ++i)
 		{
-			TaskQueuePush (executable_task_queue, task_index);
+			Task_PushExecutable (task_index, task->priority);
 		}
 	}
 }
@@ -649,20 +1149,64 @@ void Task_AddDependency (task_handle_t before, task_handle_t after)
 	before_task->num_dependents += 1;
 	Atomic_IncrementUInt32 (&after_task->remaining_dependencies);
 	SDL_UnlockMutex (before_task->epoch_mutex);
+
+	if (Trace_Active ())
+	{
+		trace_event_t event;
+		memset (&event, 0, sizeof (event));
+		event.type = TRACE_EVENT_EDGE;
+		event.begin = event.end = SDL_GetPerformanceCounter ();
+		event.handle = before;
+		event.dependent = after;
+		Trace_Record (&event);
+	}
 }
 
 /*
 ====================
 Task_Join
+
+A worker that joins doesn't block: it keeps executing other entries until
+the task is done, so tasks can fan out and join sub-tasks without tying up
+the workers those need to run on. Short condition waits only happen when
+there is nothing else to do.
 ====================
 */
 qboolean Task_Join (task_handle_t handle, uint32_t timeout)
 {
 	task_t		  *task = &tasks[IndexFromTaskHandle (handle)];
 	const uint64_t handle_task_epoch = EpochFromTaskHandle (handle);
+	trace_event_t  event;
+	const qboolean tracing = Trace_Active ();
+	memset (&event, 0, sizeof (event));
+	if (tracing)
+	{
+		event.type = TRACE_EVENT_JOIN;
+		event.begin = SDL_GetPerformanceCounter ();
+		event.handle = handle;
+	}
+	const qboolean timed = timeout != (uint32_t)TASK_TIMEOUT_INFINITE;
+	const uint64_t deadline = timed ? (SDL_GetTicks () + timeout) : 0;
 	SDL_LockMutex (task->epoch_mutex);
 	while (task->epoch == handle_task_epoch)
 	{
+		if (is_worker && (timeout != 0))
+		{
+			uint32_t task_index;
+			SDL_UnlockMutex (task->epoch_mutex);
+			const qboolean found = Task_TryPopExecutable (tl_worker_index, &task_index);
+			if (found)
+				Task_Execute (tl_worker_index, task_index);
+			SDL_LockMutex (task->epoch_mutex);
+			if (!found && (task->epoch == handle_task_epoch))
+				(void)SDL_WaitConditionTimeout (task->epoch_condition, task->epoch_mutex, 1);
+			if (timed && (task->epoch == handle_task_epoch) && (SDL_GetTicks () >= deadline))
+			{
+				SDL_UnlockMutex (task->epoch_mutex);
+				return false;
+			}
+			continue;
+		}
 		if (!SDL_WaitConditionTimeout (task->epoch_condition, task->epoch_mutex, timeout))
 		{
 			SDL_UnlockMutex (task->epoch_mutex);
@@ -671,9 +1215,216 @@ qboolean Task_Join (task_handle_t handle, uint32_t timeout)
 	}
 	SDL_UnlockMutex (task->epoch_mutex);
 	ANNOTATE_HAPPENS_AFTER (task);
+	if (tracing)
+	{
+		event.end = SDL_GetPerformanceCounter ();
+		Trace_Record (&event);
+	}
 	return true;
 }
 
+/*
+====================
+Trace_Timestamp
+
+Microseconds since the capture started
+====================
+*/
+static double Trace_Timestamp (uint64_t ticks)
+{
+	return (double)(int64_t)(ticks - trace_start) * 1000000.0 / (double)SDL_GetPerformanceFrequency ();
+}
+
+typedef struct
+{
+	uint64_t first_begin;
+	uint64_t last_end;
+	int		 first_tid;
+	int		 last_tid;
+} trace_task_span_t;
+
+/*
+====================
+Trace_Write
+
+Chrome trace_event JSON, loads in chrome://tracing and ui.perfetto.dev.
+Task names are function addresses, resolve them with addr2line or a map file.
+====================
+*/
+static void Trace_Write (void)
+{
+	FILE *f = fopen (trace_filename, "w");
+	if (!f)
+	{
+		Con_Printf ("tasks_trace: couldn't open %s\n", trace_filename);
+		return;
+	}
+
+	hash_map_t *spans = HashMap_Create (task_handle_t, trace_task_span_t, &HashInt64, NULL);
+	int			num_events = 0;
+	int			num_edges = 0;
+
+	fprintf (f, "{\"traceEvents\":[\n");
+	fprintf (f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" ENGINE_NAME_AND_VER "\"}}");
+	fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Main\"}}", TRACE_MAIN_BUFFER);
+	for (int i = 0; i < num_workers; ++i)
+		fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Task_Worker_%d\"}}", i, i);
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int tid = 0; tid <= TRACE_MAIN_BUFFER; ++tid)
+		{
+			trace_buffer_t *buffer = &trace_buffers[tid];
+			if (!buffer->events)
+				continue;
+			const uint32_t count = Atomic_LoadUInt32 (&buffer->count);
+			// skip the oldest slot of a wrapped ring, a late writer may still be overwriting it
+			const uint32_t first = (count > TRACE_BUFFER_SIZE) ? (count - TRACE_BUFFER_SIZE + 1) : 0;
+			for (uint32_t i = first; i < count; ++i)
+			{
+				const trace_event_t *event = &buffer->events[i & (TRACE_BUFFER_SIZE - 1)];
+				if (pass == 0)
+				{
+					// gather the extent of every task first, dependency edges are drawn between them
+					if (event->type != TRACE_EVENT_TASK)
+						continue;
+					trace_task_span_t *span = HashMap_Lookup (trace_task_span_t, spans, &event->handle);
+					if (!span)
+					{
+						trace_task_span_t new_span = {event->begin, event->end, tid, tid};
+						HashMap_Insert (spans, &event->handle, &new_span);
+						continue;
+					}
+					if ((int64_t)(event->begin - span->first_begin) < 0)
+					{
+						span->first_begin = event->begin;
+						span->first_tid = tid;
+					}
+					if ((int64_t)(event->end - span->last_end) > 0)
+					{
+						span->last_end = event->end;
+						span->last_tid = tid;
+					}
+					continue;
+				}
+
+				const double ts = Trace_Timestamp (event->begin);
+				switch (event->type)
+				{
+				case TRACE_EVENT_TASK:
+					fprintf (
+						f,
+						",\n{\"name\":\"%p\",\"cat\":\"task\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+						"\"args\":{\"handle\":%" SDL_PRIu64 ",\"first\":%u,\"last\":%u}}",
+						event->func, ts, Trace_Timestamp (event->end) - ts, tid, event->handle, event->first_index, event->last_index);
+					++num_events;
+					break;
+				case TRACE_EVENT_JOIN:
+					fprintf (
+						f,
+						",\n{\"name\":\"Task_Join\",\"cat\":\"join\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+						"\"args\":{\"handle\":%" SDL_PRIu64 "}}",
+						ts, Trace_Timestamp (event->end) - ts, tid, event->handle);
+					++num_events;
+					break;
+				case TRACE_EVENT_SPIN:
+				case TRACE_EVENT_PARK:
+					fprintf (
+						f, ",\n{\"name\":\"%s\",\"cat\":\"idle\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+						(event->type == TRACE_EVENT_SPIN) ? "spin" : "park", ts, Trace_Timestamp (event->end) - ts, tid);
+					++num_events;
+					break;
+				case TRACE_EVENT_FRAME:
+					fprintf (f, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", ts, tid);
+					break;
+				case TRACE_EVENT_EDGE:
+				{
+					const trace_task_span_t *before = HashMap_Lookup (trace_task_span_t, spans, &event->handle);
+					const trace_task_span_t *after = HashMap_Lookup (trace_task_span_t, spans, &event->dependent);
+					if (!before || !after)
+						break;
+					// flow arrows bind to the enclosing slice, start just inside the end of the first one
+					fprintf (
+						f, ",\n{\"name\":\"dependency\",\"cat\":\"dependency\",\"ph\":\"s\",\"id\":%d,\"ts\":%.3f,\"pid\":1,\"tid\":%d}", num_edges,
+						Trace_Timestamp (before->last_end) - 0.001, before->last_tid);
+					fprintf (
+						f, ",\n{\"name\":\"dependency\",\"cat\":\"dependency\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%d,\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+						num_edges, Trace_Timestamp (after->first_begin), after->first_tid);
+					++num_edges;
+					break;
+				}
+				}
+			}
+		}
+	}
+
+	fprintf (f, "\n]}\n");
+	fclose (f);
+	HashMap_Destroy (spans);
+	Con_Printf ("tasks_trace: wrote %d events and %d dependencies to %s\n", num_events, num_edges, trace_filename);
+}
+
+/*
+====================
+Tasks_TraceFrame
+
+Called once at the end of every host frame
+====================
+*/
+void Tasks_TraceFrame (void)
+{
+	if (!Trace_Active ())
+		return;
+
+	trace_event_t event;
+	memset (&event, 0, sizeof (event));
+	event.type = TRACE_EVENT_FRAME;
+	event.begin = event.end = SDL_GetPerformanceCounter ();
+	Trace_Record (&event);
+
+	if (--trace_frames_left > 0)
+		return;
+	Atomic_StoreUInt32 (&trace_active, 0);
+	Trace_Write ();
+}
+
+/*
+====================
+Tasks_Trace_f
+
+tasks_trace [frames] [filename]
+====================
+*/
+void Tasks_Trace_f (void)
+{
+	if (Trace_Active ())
+	{
+		Con_Printf ("tasks_trace: already capturing, %d frames left\n", trace_frames_left);
+		return;
+	}
+
+	const int frames = (Cmd_Argc () > 1) ? atoi (Cmd_Argv (1)) : 10;
+	if (frames <= 0)
+	{
+		Con_Printf ("usage: tasks_trace [frames] [filename]\n");
+		return;
+	}
+	q_snprintf (trace_filename, sizeof (trace_filename), "%s/%s", com_gamedir, (Cmd_Argc () > 2) ? Cmd_Argv (2) : "tasks_trace.json");
+
+	// buffers are only allocated once somebody asks for a trace
+	for (int i = 0; i <= TRACE_MAIN_BUFFER; ++i)
+	{
+		if ((i < num_workers || i == TRACE_MAIN_BUFFER) && !trace_buffers[i].events)
+			trace_buffers[i].events = Mem_Alloc (sizeof (trace_event_t) * TRACE_BUFFER_SIZE);
+		Atomic_StoreUInt32 (&trace_buffers[i].count, 0);
+	}
+
+	trace_frames_left = frames;
+	trace_start = SDL_GetPerformanceCounter ();
+	Atomic_StoreUInt32 (&trace_active, 1);
+	Con_Printf ("tasks_trace: capturing %d frames\n", frames);
+}
+
 #ifdef _DEBUG
 /*
 =================
@@ -737,14 +1488,237 @@ static void IndexedTasks ()
 	TEMP_FREE (counters);
 }
 
+/*
+=================
+NestedTasks
+
+Parent tasks submit children from the workers, so those go
+through the worker deques and get stolen by idle workers
+=================
+*/
+typedef struct
+{
+	uint32_t	 *counters;
+	task_handle_t done_task;
+} nested_test_payload_t;
+
+static void NestedChildTestTask (void *payload_ptr)
+{
+	nested_test_payload_t *payload = (nested_test_payload_t *)payload_ptr;
+	++payload->counters[Tasks_GetWorkerIndex ()];
+}
+static void NestedParentTestTask (void *payload_ptr)
+{
+	static const int	   NUM_CHILDREN = 16;
+	nested_test_payload_t *payload = (nested_test_payload_t *)payload_ptr;
+	for (int i = 0; i < NUM_CHILDREN; ++i)
+	{
+		task_handle_t child = Task_AllocateAndAssignFunc (NestedChildTestTask, payload, sizeof (*payload));
+		Task_AddDependency (child, payload->done_task);
+		Task_Submit (child);
+	}
+}
+static void NestedTasks (void)
+{
+	// keeps parents + children well below MAX_PENDING_TASKS,
+	// workers must never block in Task_Allocate
+	static const int NUM_ROUNDS = 1000;
+	static const int NUM_PARENTS = 8;
+	TEMP_ALLOC_ZEROED (uint32_t, counters, TASKS_MAX_WORKERS);
+	for (int round = 0; round < NUM_ROUNDS; ++round)
+	{
+		nested_test_payload_t payload = {counters, Task_Allocate ()};
+		task_handle_t		  parents[NUM_PARENTS];
+		for (int i = 0; i < NUM_PARENTS; ++i)
+		{
+			parents[i] = Task_AllocateAndAssignFunc (NestedParentTestTask, &payload, sizeof (payload));
+			Task_AddDependency (parents[i], payload.done_task);
+		}
+		Tasks_Submit (NUM_PARENTS, parents);
+		Task_Submit (payload.done_task);
+		Task_Join (payload.done_task, TASK_TIMEOUT_INFINITE);
+	}
+	uint32_t counters_sum = 0;
+	for (int i = 0; i < TASKS_MAX_WORKERS; ++i)
+		counters_sum += counters[i];
+	TASKS_TEST_ASSERT (counters_sum == NUM_ROUNDS * NUM_PARENTS * 16, "Wrong counters_sum");
+	TEMP_FREE (counters);
+}
+
+/*
+=================
+JoiningTasks
+
+Many more parents than workers that each wait for their own children,
+with blocking joins every worker would end up waiting and nobody would
+be left to run the children
+=================
+*/
+static void JoiningChildTestTask (void *counters_ptr)
+{
+	uint32_t *counters = *((uint32_t **)counters_ptr);
+	++counters[Tasks_GetWorkerIndex ()];
+}
+static void JoiningParentTestTask (void *counters_ptr)
+{
+	static const int NUM_CHILDREN = 4;
+	task_handle_t	 children[NUM_CHILDREN];
+	for (int i = 0; i < NUM_CHILDREN; ++i)
+		children[i] = Task_AllocateAssignFuncAndSubmit (JoiningChildTestTask, counters_ptr, sizeof (uint32_t *));
+	for (int i = 0; i < NUM_CHILDREN; ++i)
+		Task_Join (children[i], TASK_TIMEOUT_INFINITE);
+}
+static void JoiningTasks (void)
+{
+	static const int NUM_ROUNDS = 100;
+	const int		 num_parents = q_min (num_workers * 4, 32);
+	TEMP_ALLOC_ZEROED (uint32_t, counters, TASKS_MAX_WORKERS);
+	TEMP_ALLOC (task_handle_t, parents, num_parents);
+	for (int round = 0; round < NUM_ROUNDS; ++round)
+	{
+		for (int i = 0; i < num_parents; ++i)
+			parents[i] = Task_AllocateAssignFuncAndSubmit (JoiningParentTestTask, (void *)&counters, sizeof (uint32_t *));
+		for (int i = 0; i < num_parents; ++i)
+			Task_Join (parents[i], TASK_TIMEOUT_INFINITE);
+	}
+	uint32_t counters_sum = 0;
+	for (int i = 0; i < TASKS_MAX_WORKERS; ++i)
+		counters_sum += counters[i];
+	TASKS_TEST_ASSERT (counters_sum == (uint32_t)(NUM_ROUNDS * num_parents * 4), "Wrong counters_sum");
+	TEMP_FREE (parents);
+	TEMP_FREE (counters);
+}
+
+/*
+=================
+BackgroundTasks
+
+Critical tasks that depend on background ones, and critical
+tasks submitted while the background queue is busy
+=================
+*/
+static void BackgroundTasks (void)
+{
+	static const int NUM_ROUNDS = 1000;
+	static const int NUM_BACKGROUND = 16;
+	TEMP_ALLOC_ZEROED (uint32_t, counters, TASKS_MAX_WORKERS);
+	for (int round = 0; round < NUM_ROUNDS; ++round)
+	{
+		task_handle_t done_task = Task_AllocateAndAssignFunc (LotsOfTasksTestTask, (void *)&counters, sizeof (uint32_t *));
+		for (int i = 0; i < NUM_BACKGROUND; ++i)
+		{
+			task_handle_t background = Task_AllocateAndAssignFunc (LotsOfTasksTestTask, (void *)&counters, sizeof (uint32_t *));
+			Task_SetPriority (background, TASK_PRIORITY_BACKGROUND);
+			Task_AddDependency (background, done_task);
+			Task_Submit (background);
+		}
+		Task_Join (Task_AllocateAssignFuncAndSubmit (LotsOfTasksTestTask, (void *)&counters, sizeof (uint32_t *)), TASK_TIMEOUT_INFINITE);
+		Task_Submit (done_task);
+		Task_Join (done_task, TASK_TIMEOUT_INFINITE);
+	}
+	uint32_t counters_sum = 0;
+	for (int i = 0; i < TASKS_MAX_WORKERS; ++i)
+		counters_sum += counters[i];
+	TASKS_TEST_ASSERT (counters_sum == NUM_ROUNDS * (NUM_BACKGROUND + 2), "Wrong counters_sum");
+	TEMP_FREE (counters);
+}
+
+/*
+=================
+PrintWorkerStats
+=================
+*/
+static void PrintWorkerStats (void)
+{
+	worker_stats_t total;
+	memset (&total, 0, sizeof (total));
+	Con_Printf ("worker   local  shared  stolen  backgr  wait ms\n");
+	for (int i = 0; i < num_workers; ++i)
+	{
+		const worker_stats_t *stats = &worker_stats[i];
+		Con_Printf ("%6d %7u %7u %7u %7u %8.2f\n", i, stats->local_pops, stats->shared_pops, stats->steals, stats->background_pops, stats->wait_time * 1000.0);
+		total.local_pops += stats->local_pops;
+		total.shared_pops += stats->shared_pops;
+		total.steals += stats->steals;
+		total.background_pops += stats->background_pops;
+		total.wait_time += stats->wait_time;
+	}
+	Con_Printf (" total %7u %7u %7u %7u %8.2f\n", total.local_pops, total.shared_pops, total.steals, total.background_pops, total.wait_time * 1000.0);
+}
+
 /*
 =================
 TestTasks_f
+
+"test_tasks steal" runs the nested test only and
+reports how the entries were picked up by the workers
 =================
 */
 void TestTasks_f (void)
 {
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "steal"))
+	{
+		memset (worker_stats, 0, sizeof (worker_stats));
+		NestedTasks ();
+		PrintWorkerStats ();
+		return;
+	}
+
 	LotsOfTasks ();
 	IndexedTasks ();
+	NestedTasks ();
+	JoiningTasks ();
+	BackgroundTasks ();
 }
 #endif
+
+/*
+=================
+Tasks_Bench
+
+Scheduling overhead only, the task functions do nothing
+=================
+*/
+static void BenchEmptyTask (void *unused) {}
+static void BenchEmptyIndexedTask (int index, void *unused) {}
+
+void Tasks_Bench (void)
+{
+	static const int INDEXED_LIMITS[] = {1, 16, 256, 4096};
+	static const int FAN_OUT_CHILDREN[] = {4, 16, 64};
+	const int		 NUM_ROUNDS = 10000;
+	int				 dummy = 0;
+
+	double time = Sys_DoubleTime ();
+	for (int round = 0; round < NUM_ROUNDS; ++round)
+		Task_Join (Task_AllocateAssignFuncAndSubmit (BenchEmptyTask, &dummy, sizeof (dummy)), TASK_TIMEOUT_INFINITE);
+	Bench_Report ("tasks submit and join", NUM_ROUNDS, Sys_DoubleTime () - time);
+
+	for (size_t i = 0; i < countof (INDEXED_LIMITS); ++i)
+	{
+		time = Sys_DoubleTime ();
+		for (int round = 0; round < NUM_ROUNDS; ++round)
+			Task_Join (Task_AllocateAssignIndexedFuncAndSubmit (BenchEmptyIndexedTask, INDEXED_LIMITS[i], &dummy, sizeof (dummy)), TASK_TIMEOUT_INFINITE);
+		Bench_Report (va ("tasks indexed %d, submit and join", INDEXED_LIMITS[i]), NUM_ROUNDS, Sys_DoubleTime () - time);
+	}
+
+	// children + done task stay well below MAX_PENDING_TASKS
+	for (size_t i = 0; i < countof (FAN_OUT_CHILDREN); ++i)
+	{
+		task_handle_t children[64];
+		time = Sys_DoubleTime ();
+		for (int round = 0; round < NUM_ROUNDS; ++round)
+		{
+			task_handle_t done_task = Task_Allocate ();
+			for (int j = 0; j < FAN_OUT_CHILDREN[i]; ++j)
+			{
+				children[j] = Task_AllocateAndAssignFunc (BenchEmptyTask, &dummy, sizeof (dummy));
+				Task_AddDependency (children[j], done_task);
+			}
+			Tasks_Submit (FAN_OUT_CHILDREN[i], children);
+			Task_Submit (done_task);
+			Task_Join (done_task, TASK_TIMEOUT_INFINITE);
+		}
+		Bench_Report (va ("tasks fan-out %d, submit and join", FAN_OUT_CHILDREN[i]), NUM_ROUNDS, Sys_DoubleTime () - time);
+	}
+}
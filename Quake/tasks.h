@@ -30,21 +30,44 @@
 #define TASKS_MAX_WORKERS	32
 
 typedef uint64_t task_handle_t;
+
+// Workers only pick up background tasks when no critical task is executable.
+// Running tasks are never interrupted, so background tasks should be short.
+typedef enum
+{
+	TASK_PRIORITY_CRITICAL, // default, frame work that is joined soon
+	TASK_PRIORITY_BACKGROUND,
+} task_priority_t;
+
 typedef void (*task_func_t) (void *);
 typedef void (*task_indexed_func_t) (int, void *);
 
+typedef enum
+{
+	TASKS_IDLE_POWER,
+	TASKS_IDLE_ADAPTIVE,
+	TASKS_IDLE_LATENCY,
+} tasks_idle_mode_t;
+
 void		  Tasks_Init (void);
+void		  Tasks_InitCvars (void);
 int			  Tasks_NumWorkers (void);
+float		  Tasks_Utilization (void);
 qboolean	  Tasks_IsWorker (void);
 int			  Tasks_GetWorkerIndex (void);
 task_handle_t Task_Allocate (void);
 void		  Task_AssignFunc (task_handle_t handle, task_func_t func, void *payload, size_t payload_size);
 void		  Task_AssignIndexedFunc (task_handle_t handle, task_indexed_func_t func, uint32_t limit, void *payload, size_t payload_size);
+void		  Task_SetPriority (task_handle_t handle, task_priority_t priority);
 void		  Task_Submit (task_handle_t handle);
 void		  Tasks_Submit (int num_handles, task_handle_t *handles);
 void		  Task_AddDependency (task_handle_t before, task_handle_t after);
 qboolean	  Task_Join (task_handle_t handle, uint32_t timeout);
 
+// opt-in timeline capture, "tasks_trace" writes Chrome trace_event JSON
+void Tasks_TraceFrame (void);
+void Tasks_Trace_f (void);
+
 static inline task_handle_t Task_AllocateAndAssignFunc (task_func_t func, void *payload, size_t payload_size)
 {
 	task_handle_t handle = Task_Allocate ();
@@ -75,6 +98,24 @@ static inline task_handle_t Task_AllocateAssignIndexedFuncAndSubmit (task_indexe
 	return handle;
 }
 
+static inline task_handle_t Task_AllocateAssignBackgroundFuncAndSubmit (task_func_t func, void *payload, size_t payload_size)
+{
+	task_handle_t handle = Task_Allocate ();
+	Task_AssignFunc (handle, func, payload, payload_size);
+	Task_SetPriority (handle, TASK_PRIORITY_BACKGROUND);
+	Task_Submit (handle);
+	return handle;
+}
+
+static inline task_handle_t Task_AllocateAssignBackgroundIndexedFuncAndSubmit (task_indexed_func_t func, uint32_t limit, void *payload, size_t payload_size)
+{
+	task_handle_t handle = Task_Allocate ();
+	Task_AssignIndexedFunc (handle, func, limit, payload, payload_size);
+	Task_SetPriority (handle, TASK_PRIORITY_BACKGROUND);
+	Task_Submit (handle);
+	return handle;
+}
+
 #ifdef _DEBUG
 void TestTasks_f (void);
 #endif
@@ -90,6 +90,8 @@ float	 VID_GetPixelRatio (void);
 qboolean VID_HasMouseOrInputFocus (void);
 qboolean VID_IsMinimized (void);
 void	 VID_Lock (void);
+qboolean VID_PaceFrame (void);
+// vid_lowlatency: waits for the display before the input of a frame is sampled
 
 void VID_FocusGained (void);
 void VID_FocusLost (void);
@@ -978,6 +978,7 @@ void V_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 	{
 		render_warp = false;
 		render_scale = 1;
+		render_resolution = 1.0f;
 		return;
 	}
 
@@ -171,25 +171,47 @@ void *W_GetLumpName (const char *name, lumpinfo_t **out_info) // Spike: so calle
 }
 
 /*
-=================
-W_OpenWadFile
-=================
+=============================================================================
+
+map wads
+
+Wads listed in the worldspawn "wad" field are kept in wad_cache after the map
+that loaded them is done with them, so that map packs sharing their wads don't
+read and parse them again for every map. The files are memory mapped through
+COM_LoadFileView, only the lumps that are actually used are paged in. Like
+models, wads that were not used for mod_cache_maps maps are dropped by
+W_TrimWadCache and all of them go away with the game directory.
+Only the world model loads wads, so there is never more than one list alive.
+
+=============================================================================
 */
-static qboolean W_OpenWadFile (const char *filename, fshandle_t *fh)
+
+typedef struct
+{
+	char name[16];
+} lumpname_t;
+
+static wad_t *wad_cache;
+static int	  wad_cache_sequence;
+
+static inline uint32_t W_HashLumpName (const void *const val)
 {
-	FILE *f;
-	long  length;
-
-	length = (long)COM_FOpenFile (filename, &f, NULL);
-	if (length == -1)
-		return false;
-
-	fh->file = f;
-	fh->start = ftell (f);
-	fh->pos = 0;
-	fh->length = length;
-	fh->pak = file_from_pak;
-	return true;
+	const unsigned char	 *name = (const unsigned char *)((const lumpname_t *)val)->name;
+	static const uint32_t FNV_32_PRIME = 0x01000193;
+
+	uint32_t hval = 0;
+	for (int i = 0; (i < 16) && name[i]; ++i)
+	{
+		hval ^= (uint32_t)name[i];
+		hval *= FNV_32_PRIME;
+	}
+
+	return hval;
+}
+
+static inline qboolean W_LumpNameCmp (const void *const a, const void *const b)
+{
+	return memcmp (a, b, sizeof (lumpname_t)) == 0;
 }
 
 /*
@@ -197,14 +219,19 @@ static qboolean W_OpenWadFile (const char *filename, fshandle_t *fh)
 W_AddWadFile
 =================
 */
-static wad_t *W_AddWadFile (const char *name, fshandle_t *fh)
+static wad_t *W_AddWadFile (const char *name, const byte *data, int length, unsigned int path_id)
 {
 	int			i, id, numlumps, infotableofs, disksize;
 	wadinfo_t	header;
 	lumpinfo_t *lumps, *info;
 	wad_t	   *wad;
 
-	FS_fread ((void *)&header, 1, sizeof (header), fh);
+	if (length < (int)sizeof (header))
+	{
+		Con_Warning ("%s is not a valid WAD\n", name);
+		return NULL;
+	}
+	memcpy (&header, data, sizeof (header));
 
 	id = LittleLong (header.identification[0] | (header.identification[1] << 8) | (header.identification[2] << 16) | (header.identification[3] << 24));
 	if (id != WADID && id != WADID_VALVE)
@@ -216,7 +243,7 @@ static wad_t *W_AddWadFile (const char *name, fshandle_t *fh)
 	numlumps = LittleLong (header.numlumps);
 	infotableofs = LittleLong (header.infotableofs);
 
-	if (numlumps < 0 || infotableofs < 0)
+	if (numlumps < 0 || infotableofs < 0 || (size_t)infotableofs + (size_t)numlumps * sizeof (lumpinfo_t) > (size_t)length)
 	{
 		Con_Warning ("%s is not a valid WAD (%i lumps, %i info table offset)\n", name, numlumps, infotableofs);
 		return NULL;
@@ -228,9 +255,11 @@ static wad_t *W_AddWadFile (const char *name, fshandle_t *fh)
 	}
 
 	lumps = (lumpinfo_t *)Mem_Alloc (numlumps * sizeof (lumpinfo_t));
+	memcpy (lumps, data + infotableofs, numlumps * sizeof (lumpinfo_t));
 
-	FS_fseek (fh, infotableofs, SEEK_SET);
-	FS_fread (lumps, 1, numlumps * sizeof (lumpinfo_t), fh);
+	wad = (wad_t *)Mem_Alloc (sizeof (wad_t));
+	wad->lump_map = HashMap_Create (lumpname_t, int, &W_HashLumpName, &W_LumpNameCmp);
+	HashMap_Reserve (wad->lump_map, numlumps);
 
 	// parse the directory
 	for (i = 0, info = lumps; i < numlumps; i++, info++)
@@ -240,15 +269,15 @@ static wad_t *W_AddWadFile (const char *name, fshandle_t *fh)
 		info->size = LittleLong (info->size);
 		disksize = LittleLong (info->disksize);
 
-		if (info->filepos + info->size > fh->length && !(info->filepos + disksize > fh->length))
+		if (info->filepos + info->size > length && !(info->filepos + disksize > length))
 			info->size = disksize;
 
 		// ensure lump sanity
-		if (info->filepos < 0 || info->size < 0 || info->filepos + info->size > fh->length)
+		if (info->filepos < 0 || info->size < 0 || info->filepos + info->size > length)
 		{
-			if (info->filepos > fh->length || info->size < 0)
+			if (info->filepos > length || info->size < 0)
 			{
-				Con_Warning ("WAD file %s lump \"%.16s\" begins %li bytes beyond end of WAD\n", name, info->name, info->filepos - fh->length);
+				Con_Warning ("WAD file %s lump \"%.16s\" begins %i bytes beyond end of WAD\n", name, info->name, info->filepos - length);
 
 				info->filepos = 0;
 				info->size = q_max (0, info->size - info->filepos);
@@ -256,18 +285,23 @@ static wad_t *W_AddWadFile (const char *name, fshandle_t *fh)
 			else
 			{
 				Con_Warning (
-					"WAD file %s lump \"%.16s\" extends %li bytes beyond end of WAD (lump size is %i)\n", name, info->name,
-					(info->filepos + info->size) - fh->length, info->size);
+					"WAD file %s lump \"%.16s\" extends %i bytes beyond end of WAD (lump size is %i)\n", name, info->name,
+					(info->filepos + info->size) - length, info->size);
 
 				info->size = q_max (0, info->size - info->filepos);
 			}
 		}
+
+		// the first lump of a name wins, like the linear search did
+		if (!HashMap_Lookup (int, wad->lump_map, (lumpname_t *)info->name))
+			HashMap_Insert (wad->lump_map, (lumpname_t *)info->name, &i);
 	}
 
-	wad = (wad_t *)Mem_Alloc (sizeof (wad_t));
 	q_strlcpy (wad->name, name, sizeof (wad->name));
 	wad->id = id;
-	wad->fh = *fh;
+	wad->data = data;
+	wad->length = length;
+	wad->path_id = path_id;
 	wad->numlumps = numlumps;
 	wad->lumps = lumps;
 
@@ -275,18 +309,75 @@ static wad_t *W_AddWadFile (const char *name, fshandle_t *fh)
 	return wad;
 }
 
+/*
+=================
+W_FreeWadFile
+=================
+*/
+static void W_FreeWadFile (wad_t *wad)
+{
+	HashMap_Destroy (wad->lump_map);
+	COM_FreeFileView (wad->data);
+	Mem_Free (wad->lumps);
+	Mem_Free (wad);
+}
+
+/*
+=================
+W_CachedWadFile
+
+Returns the cached wad for filename, loading it if it isn't cached or the file
+that the search path resolves to has changed since
+=================
+*/
+static wad_t *W_CachedWadFile (const char *filename, fshandle_t *fh, unsigned int path_id)
+{
+	wad_t **link, *wad;
+	int		length;
+
+	for (link = &wad_cache; (wad = *link); link = &wad->next)
+	{
+		if (strcmp (wad->name, filename))
+			continue;
+		if (wad->path_id == path_id && wad->length == fh->length)
+			return wad;
+		if (wad->refcount)
+			break;
+		*link = wad->next;
+		W_FreeWadFile (wad);
+		break;
+	}
+
+	const byte *data = COM_LoadFileView (filename, &path_id, &length);
+	if (!data)
+		return NULL;
+
+	wad = W_AddWadFile (filename, data, length, path_id);
+	if (!wad)
+	{
+		COM_FreeFileView (data);
+		return NULL;
+	}
+
+	wad->next = wad_cache;
+	wad_cache = wad;
+	return wad;
+}
+
 /*
 =================
 W_LoadWadList
 =================
 */
-wad_t *W_LoadWadList (const char *names)
+wadlist_t *W_LoadWadList (const char *names)
 {
-	char	  *newnames = q_strdup (names);
-	char	  *name, *e;
-	wad_t	  *wad, *wads = NULL;
-	char	   filename[MAX_QPATH];
-	fshandle_t fh;
+	char		*newnames = q_strdup (names);
+	char		*name, *e;
+	wad_t		*wad;
+	wadlist_t	*entry, *wads = NULL;
+	char		 filename[MAX_QPATH];
+	fshandle_t	 fh;
+	unsigned int path_id;
 
 	for (name = newnames; name && *name;)
 	{
@@ -298,28 +389,31 @@ wad_t *W_LoadWadList (const char *names)
 		COM_FileBase (name, filename, sizeof (filename));
 		COM_AddExtension (filename, ".wad", sizeof (filename));
 
-		if (!W_OpenWadFile (filename, &fh))
+		if (!FS_Open (filename, &fh, &path_id))
 		{
 			// try the "gfx" directory
 			memmove (filename + 4, filename, sizeof (filename) - 4);
 			memcpy (filename, "gfx/", 4);
 			filename[sizeof (filename) - 1] = 0;
 
-			if (!W_OpenWadFile (filename, &fh))
+			if (!FS_Open (filename, &fh, &path_id))
 			{
 				name = e;
 				continue;
 			}
 		}
 
-		wad = W_AddWadFile (filename, &fh);
+		// the handle only tells which file the search path resolves to now
+		wad = W_CachedWadFile (filename, &fh, path_id);
+		FS_fclose (&fh);
 		if (wad)
 		{
-			wad->next = wads;
-			wads = wad;
+			++wad->refcount;
+			entry = (wadlist_t *)Mem_Alloc (sizeof (wadlist_t));
+			entry->wad = wad;
+			entry->next = wads;
+			wads = entry;
 		}
-		else
-			FS_fclose (&fh);
 
 		name = e;
 	}
@@ -331,16 +425,18 @@ wad_t *W_LoadWadList (const char *names)
 /*
 =================
 W_FreeWadList
+
+The wads stay cached until W_TrimWadCache or W_FlushWadCache
 =================
 */
-void W_FreeWadList (wad_t *wads)
+void W_FreeWadList (wadlist_t *wads)
 {
-	wad_t *next;
+	wadlist_t *next;
 
 	while (wads)
 	{
-		FS_fclose (&wads->fh);
-		Mem_Free (wads->lumps);
+		--wads->wad->refcount;
+		wads->wad->last_used = wad_cache_sequence;
 
 		next = wads->next;
 		Mem_Free (wads);
@@ -348,22 +444,72 @@ void W_FreeWadList (wad_t *wads)
 	}
 }
 
+/*
+=================
+W_TrimWadCache
+
+Called once per map, drops the unused wads that no map needed for more than max_age maps
+=================
+*/
+void W_TrimWadCache (int max_age)
+{
+	wad_t **link, *wad;
+
+	++wad_cache_sequence;
+	for (link = &wad_cache; (wad = *link);)
+	{
+		if (!wad->refcount && (wad_cache_sequence - wad->last_used) > max_age)
+		{
+			*link = wad->next;
+			W_FreeWadFile (wad);
+		}
+		else
+			link = &wad->next;
+	}
+}
+
+/*
+=================
+W_FlushWadCache
+
+Has to be called before the search paths change, the wads are views into them
+=================
+*/
+void W_FlushWadCache (void)
+{
+	wad_t **link, *wad;
+
+	for (link = &wad_cache; (wad = *link);)
+	{
+		if (!wad->refcount)
+		{
+			*link = wad->next;
+			W_FreeWadFile (wad);
+		}
+		else
+			link = &wad->next;
+	}
+}
+
 /*
 =================
 W_GetLumpinfoList
 =================
 */
-lumpinfo_t *W_GetLumpinfoList (wad_t *wads, const char *name, wad_t **out_wad)
+lumpinfo_t *W_GetLumpinfoList (wadlist_t *wads, const char *name, wad_t **out_wad)
 {
-	lumpinfo_t *info;
+	lumpname_t clean;
+	int		  *index;
+
+	W_CleanupName (name, clean.name);
 
 	while (wads)
 	{
-		info = W_GetLumpinfo (wads->lumps, wads->numlumps, name);
-		if (info)
+		index = HashMap_Lookup (int, wads->wad->lump_map, &clean);
+		if (index)
 		{
-			*out_wad = wads;
-			return info;
+			*out_wad = wads->wad;
+			return &wads->wad->lumps[*index];
 		}
 
 		wads = wads->next;
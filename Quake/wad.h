@@ -70,16 +70,28 @@ typedef struct
 	char name[16]; // must be null terminated
 } lumpinfo_t;
 
+// wads loaded for external textures are cached across maps, see W_LoadWadList
 typedef struct wad_s
 {
-	char		  name[MAX_QPATH];
-	int			  id;
-	fshandle_t	  fh;
-	int			  numlumps;
-	lumpinfo_t	 *lumps;
-	struct wad_s *next;
+	char			   name[MAX_QPATH];
+	int				   id;
+	const byte		  *data; // COM_LoadFileView of the whole file
+	int				   length;
+	unsigned int	   path_id;
+	int				   numlumps;
+	lumpinfo_t		  *lumps;
+	struct hash_map_s *lump_map; // cleaned lump name -> index of its first lump
+	int				   refcount;
+	int				   last_used; // wad_cache_sequence when last released
+	struct wad_s	  *next;
 } wad_t;
 
+typedef struct wadlist_s
+{
+	wad_t			 *wad;
+	struct wadlist_s *next;
+} wadlist_t;
+
 extern int		   wad_numlumps;
 extern lumpinfo_t *wad_lumps;
 extern byte		  *wad_base;
@@ -88,9 +100,11 @@ void  W_LoadWadFile (void); // johnfitz -- filename is now hard-coded for honest
 void  W_CleanupName (const char *in, char *out);
 void *W_GetLumpName (const char *name, lumpinfo_t **out_info);
 
-wad_t	   *W_LoadWadList (const char *names);
-void		W_FreeWadList (wad_t *wads);
-lumpinfo_t *W_GetLumpinfoList (wad_t *wads, const char *name, wad_t **out_wad);
+wadlist_t  *W_LoadWadList (const char *names);
+void		W_FreeWadList (wadlist_t *wads);
+lumpinfo_t *W_GetLumpinfoList (wadlist_t *wads, const char *name, wad_t **out_wad);
+void		W_TrimWadCache (int max_age);
+void		W_FlushWadCache (void);
 
 void SwapPic (qpic_t *pic);
 
@@ -34,6 +34,10 @@ cvar_t sv_fte_recursivehullckeck = {"sv_fte_recursivehullckeck", "1", CVAR_ARCHI
 
 cvar_t sv_fte_createareanode = {"sv_fte_createareanode", "1", CVAR_ARCHIVE};
 
+// Loose grid instead of the areanode tree, read at SV_ClearWorld.
+// Entities touch each other in a different order than with the tree, 0 matches the other engines.
+cvar_t sv_areagrid = {"sv_areagrid", "1", CVAR_ARCHIVE};
+
 /*
 
 entities never clip against themselves, or their owner
@@ -62,9 +66,11 @@ HULL BOXES
 ===============================================================================
 */
 
-static hull_t	   box_hull;
-static mclipnode_t box_clipnodes[6]; // johnfitz -- was dclipnode_t
-static mplane_t	   box_planes[6];
+// per thread for SV_MoveBatch
+static THREAD_LOCAL hull_t			  box_hull;
+static THREAD_LOCAL mclipnode_t		  box_clipnodes[6]; // johnfitz -- was dclipnode_t
+static THREAD_LOCAL mplane_t		  box_planes[6];
+static THREAD_LOCAL mpackedclipnode_t box_packednodes[6];
 
 /*
 ===================
@@ -81,6 +87,7 @@ void SV_InitBoxHull (void)
 
 	box_hull.clipnodes = box_clipnodes;
 	box_hull.planes = box_planes;
+	box_hull.packednodes = box_packednodes;
 	box_hull.firstclipnode = 0;
 	box_hull.lastclipnode = 5;
 
@@ -98,6 +105,11 @@ void SV_InitBoxHull (void)
 
 		box_planes[i].type = i >> 1;
 		box_planes[i].normal[i >> 1] = 1;
+
+		box_packednodes[i].type = i >> 1;
+		box_packednodes[i].normal[i >> 1] = 1;
+		box_packednodes[i].children[0] = box_clipnodes[i].children[0];
+		box_packednodes[i].children[1] = box_clipnodes[i].children[1];
 	}
 }
 
@@ -111,6 +123,9 @@ BSP trees instead of being compared directly.
 */
 hull_t *SV_HullForBox (vec3_t mins, vec3_t maxs)
 {
+	if (!box_hull.clipnodes)
+		SV_InitBoxHull (); // first use on this thread
+
 	box_planes[0].dist = maxs[0];
 	box_planes[1].dist = mins[0];
 	box_planes[2].dist = maxs[1];
@@ -118,6 +133,9 @@ hull_t *SV_HullForBox (vec3_t mins, vec3_t maxs)
 	box_planes[4].dist = maxs[2];
 	box_planes[5].dist = mins[2];
 
+	for (int i = 0; i < 6; i++)
+		box_packednodes[i].dist = box_planes[i].dist;
+
 	return &box_hull;
 }
 
@@ -246,6 +264,62 @@ areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+===============
+SV_FreeAreaGrid
+
+===============
+*/
+void SV_FreeAreaGrid (void)
+{
+	int			i, j;
+	areacell_t *cell;
+
+	for (i = 0; i < qcvm->numareacells * 2; i++)
+	{
+		cell = &qcvm->areacells[i];
+		Mem_Free (cell->edicts);
+		for (j = 0; j < 3; j++)
+		{
+			Mem_Free (cell->absmin[j]);
+			Mem_Free (cell->absmax[j]);
+		}
+	}
+	Mem_Free (qcvm->areacells);
+	qcvm->areacells = NULL;
+	qcvm->numareacells = 0;
+	qcvm->areagrid = false;
+
+	for (i = 0; i < qcvm->numleafedicts; i++)
+		Mem_Free (qcvm->leafedicts[i].edicts);
+	Mem_Free (qcvm->leafedicts);
+	qcvm->leafedicts = NULL;
+	qcvm->numleafedicts = 0;
+}
+
+/*
+===============
+SV_CreateAreaGrid
+
+Square cells covering the world model, as small as the grid size allows
+===============
+*/
+static void SV_CreateAreaGrid (vec3_t mins, vec3_t maxs)
+{
+	int	  i;
+	float size = q_max (maxs[0] - mins[0], maxs[1] - mins[1]);
+
+	qcvm->areagrid_cellsize = q_max (ceilf (size / AREA_GRID_SIZE), (float)AREA_GRID_MIN_CELL);
+	for (i = 0; i < 2; i++)
+	{
+		qcvm->areagrid_origin[i] = mins[i];
+		qcvm->areagrid_size[i] = CLAMP (1, (int)ceilf ((maxs[i] - mins[i]) / qcvm->areagrid_cellsize), AREA_GRID_SIZE);
+	}
+	qcvm->numareacells = qcvm->areagrid_size[0] * qcvm->areagrid_size[1] + 1;
+	qcvm->areacells = (areacell_t *)Mem_Alloc (qcvm->numareacells * 2 * sizeof (areacell_t));
+	qcvm->areagrid = true;
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -259,6 +333,134 @@ void SV_ClearWorld (void)
 	memset (qcvm->areanodes, 0, sizeof (qcvm->areanodes));
 	qcvm->numareanodes = 0;
 	SV_CreateAreaNode (0, qcvm->worldmodel->mins, qcvm->worldmodel->maxs);
+
+	SV_FreeAreaGrid ();
+	if (sv_areagrid.value)
+		SV_CreateAreaGrid (qcvm->worldmodel->mins, qcvm->worldmodel->maxs);
+
+	qcvm->numleafedicts = qcvm->worldmodel->numleafs;
+	qcvm->leafedicts = (leafedicts_t *)Mem_Alloc (qcvm->numleafedicts * sizeof (leafedicts_t));
+
+	PR_ResetFieldMarks ();
+}
+
+/*
+===============
+SV_AreaGridCell
+
+Returns the cell the linked ent belongs in, the large cell if it doesn't fit in one
+===============
+*/
+static int SV_AreaGridCell (edict_t *ent)
+{
+	int	  i;
+	float center, cell[2];
+
+	for (i = 0; i < 2; i++)
+	{
+		if (!(ent->v.absmax[i] - ent->v.absmin[i] <= qcvm->areagrid_cellsize))
+			return qcvm->numareacells - 1; // also catches NaNs
+		center = (ent->v.absmin[i] + ent->v.absmax[i]) * 0.5f;
+		cell[i] = floorf ((center - qcvm->areagrid_origin[i]) / qcvm->areagrid_cellsize);
+		if (!(cell[i] >= 0.0f && cell[i] < qcvm->areagrid_size[i]))
+			return qcvm->numareacells - 1;
+	}
+	return (int)cell[1] * qcvm->areagrid_size[0] + (int)cell[0];
+}
+
+/*
+===============
+SV_LinkToAreaGrid
+
+===============
+*/
+static void SV_LinkToAreaGrid (edict_t *ent, int list)
+{
+	int			index = list * qcvm->numareacells + SV_AreaGridCell (ent);
+	areacell_t *cell = &qcvm->areacells[index];
+	int			i;
+
+	if (cell->num_edicts == cell->max_edicts)
+	{
+		cell->max_edicts = q_max (cell->max_edicts * 2, 16);
+		cell->edicts = (edict_t **)Mem_Realloc (cell->edicts, cell->max_edicts * sizeof (edict_t *));
+		for (i = 0; i < 3; i++)
+		{
+			cell->absmin[i] = (float *)Mem_Realloc (cell->absmin[i], cell->max_edicts * sizeof (float));
+			cell->absmax[i] = (float *)Mem_Realloc (cell->absmax[i], cell->max_edicts * sizeof (float));
+		}
+	}
+
+	ent->areacell = index + 1;
+	ent->areaslot = cell->num_edicts++;
+	cell->edicts[ent->areaslot] = ent;
+	for (i = 0; i < 3; i++)
+	{
+		cell->absmin[i][ent->areaslot] = ent->v.absmin[i];
+		cell->absmax[i][ent->areaslot] = ent->v.absmax[i];
+	}
+}
+
+/*
+===============
+SV_UnlinkFromLeafs
+
+Edicts linked before the last SV_ClearWorld are no longer in the lists, the
+slot check skips them
+===============
+*/
+static void SV_UnlinkFromLeafs (edict_t *ent)
+{
+	unsigned int  i, code, moved;
+	int			  last;
+	unsigned int  num = NUM_FOR_EDICT (ent);
+	leafedicts_t *leaf;
+
+	for (i = 0; i < ent->num_leafs; i++)
+	{
+		if (ent->leafnums[i] >= qcvm->numleafedicts)
+			continue;
+		leaf = &qcvm->leafedicts[ent->leafnums[i]];
+		code = num * MAX_ENT_LEAFS + i;
+		if ((unsigned int)ent->leafslots[i] >= (unsigned int)leaf->num_edicts || leaf->edicts[ent->leafslots[i]] != code)
+			continue;
+		// swap the last one of the leaf in
+		last = --leaf->num_edicts;
+		if (ent->leafslots[i] != last)
+		{
+			moved = leaf->edicts[last];
+			leaf->edicts[ent->leafslots[i]] = moved;
+			EDICT_NUM (moved / MAX_ENT_LEAFS)->leafslots[moved % MAX_ENT_LEAFS] = ent->leafslots[i];
+		}
+	}
+	ent->num_leafs = 0;
+}
+
+/*
+===============
+SV_LinkToLeafs
+
+===============
+*/
+static void SV_LinkToLeafs (edict_t *ent)
+{
+	unsigned int  i;
+	unsigned int  num = NUM_FOR_EDICT (ent);
+	leafedicts_t *leaf;
+
+	for (i = 0; i < ent->num_leafs; i++)
+	{
+		if (ent->leafnums[i] >= qcvm->numleafedicts)
+			continue;
+		leaf = &qcvm->leafedicts[ent->leafnums[i]];
+		if (leaf->num_edicts == leaf->max_edicts)
+		{
+			leaf->max_edicts = q_max (leaf->max_edicts * 2, 8);
+			leaf->edicts = (unsigned int *)Mem_Realloc (leaf->edicts, leaf->max_edicts * sizeof (unsigned int));
+		}
+		ent->leafslots[i] = leaf->num_edicts;
+		leaf->edicts[leaf->num_edicts++] = num * MAX_ENT_LEAFS + i;
+	}
 }
 
 /*
@@ -269,12 +471,113 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (edict_t *ent)
 {
+	if (ent->num_leafs)
+		SV_UnlinkFromLeafs (ent);
+
+	if (ent->areacell)
+	{ // swap the last one of the cell in
+		areacell_t *cell = &qcvm->areacells[ent->areacell - 1];
+		int			last = --cell->num_edicts;
+		int			i;
+
+		if (ent->areaslot != last)
+		{
+			cell->edicts[ent->areaslot] = cell->edicts[last];
+			cell->edicts[ent->areaslot]->areaslot = ent->areaslot;
+			for (i = 0; i < 3; i++)
+			{
+				cell->absmin[i][ent->areaslot] = cell->absmin[i][last];
+				cell->absmax[i][ent->areaslot] = cell->absmax[i][last];
+			}
+		}
+		ent->areacell = 0;
+		return;
+	}
+
 	if (!ent->area.prev)
 		return; // not linked in anywhere
 	RemoveLink (&ent->area);
 	ent->area.prev = ent->area.next = NULL;
 }
 
+/*
+===============
+SV_AreaGridCells
+
+The cells that can hold an entity touching the box, without the large cell.
+Returns false if there are none
+===============
+*/
+static qboolean SV_AreaGridCells (const vec3_t mins, const vec3_t maxs, int first[2], int last[2])
+{
+	int	  i;
+	float half = qcvm->areagrid_cellsize * 0.5f;
+	float lo, hi;
+
+	for (i = 0; i < 2; i++)
+	{
+		// entities are at most half a cell outside of their cell
+		lo = floorf ((mins[i] - half - qcvm->areagrid_origin[i]) / qcvm->areagrid_cellsize);
+		hi = floorf ((maxs[i] + half - qcvm->areagrid_origin[i]) / qcvm->areagrid_cellsize);
+		if (!(lo < qcvm->areagrid_size[i] && hi >= 0.0f))
+			return false;
+		first[i] = (int)q_max (lo, 0.0f);
+		last[i] = (int)q_min (hi, (float)(qcvm->areagrid_size[i] - 1));
+	}
+	return true;
+}
+
+/*
+===============
+SV_AreaCellEdicts
+
+===============
+*/
+static int SV_AreaCellEdicts (const areacell_t *cell, const vec3_t mins, const vec3_t maxs, int *nums, int count)
+{
+	int i;
+
+	if (!nums)
+		return count + cell->num_edicts;
+	for (i = 0; i < cell->num_edicts; i++)
+		if (cell->absmin[0][i] <= maxs[0] && cell->absmin[1][i] <= maxs[1] && cell->absmin[2][i] <= maxs[2] && cell->absmax[0][i] >= mins[0] &&
+			cell->absmax[1][i] >= mins[1] && cell->absmax[2][i] >= mins[2])
+			nums[count++] = NUM_FOR_EDICT (cell->edicts[i]);
+	return count;
+}
+
+/*
+===============
+SV_AreaGridEdicts
+
+Fills nums with the solid and trigger edicts whose linked box touches the box,
+returns how many there are. Without nums, counts everything in the cells the
+box reaches, an upper bound
+===============
+*/
+int SV_AreaGridEdicts (const vec3_t mins, const vec3_t maxs, int *nums)
+{
+	int			first[2], last[2];
+	int			list, x, y, count = 0;
+	areacell_t *cells;
+
+	if (!SV_AreaGridCells (mins, maxs, first, last))
+	{
+		first[0] = first[1] = 0;
+		last[0] = last[1] = -1;
+	}
+
+	for (list = 0; list < 2; list++)
+	{
+		cells = &qcvm->areacells[list * qcvm->numareacells];
+		for (y = first[1]; y <= last[1]; y++)
+			for (x = first[0]; x <= last[0]; x++)
+				count = SV_AreaCellEdicts (&cells[y * qcvm->areagrid_size[0] + x], mins, maxs, nums, count);
+		count = SV_AreaCellEdicts (&cells[qcvm->numareacells - 1], mins, maxs, nums, count);
+	}
+	return count;
+}
+
 /*
 ====================
 SV_AreaTriggerEdicts
@@ -283,39 +586,93 @@ Spike -- just builds a list of entities within the area, rather than walking
 them and risking the list getting corrupt.
 ====================
 */
-static void SV_AreaTriggerEdicts (edict_t *ent, areanode_t *node, edict_t **list, int *listcount, const int listspace)
+static qboolean SV_AreaTriggerEdict (edict_t *ent, edict_t *touch, edict_t **list, int *listcount, const int listspace)
 {
-	link_t	*l, *next;
-	edict_t *touch;
+	if (touch == ent)
+		return true;
+	if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+		return true;
+	if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2] ||
+		ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
+		return true;
+
+	if (*listcount == listspace)
+		return false; // should never happen
+
+	list[*listcount] = touch;
+	(*listcount)++;
+	return true;
+}
+
+// returns false if the list filled up
+static qboolean SV_AreaTriggerEdicts (edict_t *ent, areanode_t *node, edict_t **list, int *listcount, const int listspace)
+{
+	link_t *l, *next;
 
 	// touch linked edicts
 	for (l = node->trigger_edicts.next; l != &node->trigger_edicts; l = next)
 	{
 		next = l->next;
-		touch = EDICT_FROM_AREA (l);
-		if (touch == ent)
-			continue;
-		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
-			continue;
-		if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2] ||
-			ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
-			continue;
-
-		if (*listcount == listspace)
-			return; // should never happen
-
-		list[*listcount] = touch;
-		(*listcount)++;
+		if (!SV_AreaTriggerEdict (ent, EDICT_FROM_AREA (l), list, listcount, listspace))
+			return false;
 	}
 
 	// recurse down both sides
 	if (node->axis == -1)
-		return;
+		return true;
+
+	if (ent->v.absmax[node->axis] > node->dist && !SV_AreaTriggerEdicts (ent, node->children[0], list, listcount, listspace))
+		return false;
+	if (ent->v.absmin[node->axis] < node->dist && !SV_AreaTriggerEdicts (ent, node->children[1], list, listcount, listspace))
+		return false;
+	return true;
+}
+
+/*
+====================
+SV_AreaGridTriggerCell
+
+The boxes copied into the cell reject the triggers the entity is nowhere near
+without touching their edicts
+====================
+*/
+static qboolean SV_AreaGridTriggerCell (edict_t *ent, const areacell_t *cell, edict_t **list, int *listcount, const int listspace)
+{
+	int i;
 
-	if (ent->v.absmax[node->axis] > node->dist)
-		SV_AreaTriggerEdicts (ent, node->children[0], list, listcount, listspace);
-	if (ent->v.absmin[node->axis] < node->dist)
-		SV_AreaTriggerEdicts (ent, node->children[1], list, listcount, listspace);
+	for (i = 0; i < cell->num_edicts; i++)
+	{
+		if (ent->v.absmin[0] > cell->absmax[0][i] || ent->v.absmin[1] > cell->absmax[1][i] || ent->v.absmin[2] > cell->absmax[2][i] ||
+			ent->v.absmax[0] < cell->absmin[0][i] || ent->v.absmax[1] < cell->absmin[1][i] || ent->v.absmax[2] < cell->absmin[2][i])
+			continue;
+		if (!SV_AreaTriggerEdict (ent, cell->edicts[i], list, listcount, listspace))
+			return false;
+	}
+	return true;
+}
+
+/*
+====================
+SV_AreaGridTriggerEdicts
+
+SV_AreaTriggerEdicts for sv_areagrid
+====================
+*/
+static qboolean SV_AreaGridTriggerEdicts (edict_t *ent, edict_t **list, int *listcount, const int listspace)
+{
+	areacell_t *cells = &qcvm->areacells[AREA_TRIGGER_EDICTS * qcvm->numareacells];
+	int			first[2], last[2];
+	int			x, y;
+
+	if (SV_AreaGridCells (ent->v.absmin, ent->v.absmax, first, last))
+	{
+		for (y = first[1]; y <= last[1]; y++)
+			for (x = first[0]; x <= last[0]; x++)
+				if (!SV_AreaGridTriggerCell (ent, &cells[y * qcvm->areagrid_size[0] + x], list, listcount, listspace))
+					return false;
+	}
+
+	return SV_AreaGridTriggerCell (ent, &cells[qcvm->numareacells - 1], list, listcount, listspace);
 }
 
 /*
@@ -328,16 +685,33 @@ which could potentially corrupt the list while it's being iterated.
 Based on code from Spike.
 ====================
 */
+#define TOUCH_SCRATCH_EDICTS 32
+
 void SV_TouchLinks (edict_t *ent)
 {
 	edict_t *touch;
 	int		 old_self, old_other;
 	int		 i, listcount;
+	edict_t *scratch[TOUCH_SCRATCH_EDICTS]; // an entity rarely touches more than a few triggers at once
 
-	TEMP_ALLOC (edict_t *, list, qcvm->num_edicts);
+	// touch functions can link other edicts which nests this, so the lists stack in the frame arena when they don't fit
+	const mem_frame_mark_t mark = Mem_FrameMark ();
+	edict_t				 **list = scratch;
 
-	listcount = 0;
-	SV_AreaTriggerEdicts (ent, qcvm->areanodes, list, &listcount, qcvm->num_edicts);
+	for (;;)
+	{
+		const int listspace = (list == scratch) ? TOUCH_SCRATCH_EDICTS : qcvm->num_edicts;
+		qboolean  complete;
+
+		listcount = 0;
+		if (qcvm->areagrid)
+			complete = SV_AreaGridTriggerEdicts (ent, list, &listcount, listspace);
+		else
+			complete = SV_AreaTriggerEdicts (ent, qcvm->areanodes, list, &listcount, listspace);
+		if (complete || list != scratch)
+			break;
+		list = (edict_t **)Mem_FrameAlloc (qcvm->num_edicts * sizeof (edict_t *));
+	}
 
 	for (i = 0; i < listcount; i++)
 	{
@@ -363,7 +737,7 @@ void SV_TouchLinks (edict_t *ent)
 		pr_global_struct->other = old_other;
 	}
 
-	TEMP_FREE (list);
+	Mem_FrameRelease (mark);
 }
 
 /*
@@ -420,8 +794,9 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t *node;
 
-	if (ent->area.prev)
+	if (ent->area.prev || ent->areacell || ent->num_leafs)
 		SV_UnlinkEdict (ent); // unlink from old position
+	ent->fieldmarks &= ~ED_MARK_MOVED;
 
 	if (ent == qcvm->edicts)
 		return; // don't add the world
@@ -481,31 +856,39 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	// link to PVS leafs
 	ent->num_leafs = 0;
 	if (ent->v.modelindex)
+	{
 		SV_FindTouchedLeafs (ent, qcvm->worldmodel->nodes);
+		SV_LinkToLeafs (ent);
+	}
 
 	if (ent->v.solid == SOLID_NOT)
 		return;
 
-	// find the first node that the ent's box crosses
-	node = qcvm->areanodes;
-	while (1)
+	if (qcvm->areagrid)
+		SV_LinkToAreaGrid (ent, (ent->v.solid == SOLID_TRIGGER) ? AREA_TRIGGER_EDICTS : AREA_SOLID_EDICTS);
+	else
 	{
-		if (node->axis == -1)
-			break;
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break; // crosses the node
-	}
+		// find the first node that the ent's box crosses
+		node = qcvm->areanodes;
+		while (1)
+		{
+			if (node->axis == -1)
+				break;
+			if (ent->v.absmin[node->axis] > node->dist)
+				node = node->children[0];
+			else if (ent->v.absmax[node->axis] < node->dist)
+				node = node->children[1];
+			else
+				break; // crosses the node
+		}
 
-	// link it in
+		// link it in
 
-	if (ent->v.solid == SOLID_TRIGGER)
-		InsertLinkBefore (&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore (&ent->area, &node->solid_edicts);
+		if (ent->v.solid == SOLID_TRIGGER)
+			InsertLinkBefore (&ent->area, &node->trigger_edicts);
+		else
+			InsertLinkBefore (&ent->area, &node->solid_edicts);
+	}
 
 	// if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
@@ -528,22 +911,20 @@ SV_HullPointContents
 */
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p)
 {
-	float		 d;
-	mclipnode_t *node; // johnfitz -- was dclipnode_t
-	mplane_t	*plane;
+	float					 d;
+	const mpackedclipnode_t *node;
 
 	while (num >= 0)
 	{
 		if (num < hull->firstclipnode || num > hull->lastclipnode)
 			Sys_Error ("SV_HullPointContents: bad node number");
 
-		node = hull->clipnodes + num;
-		plane = hull->planes + node->planenum;
+		node = hull->packednodes + num;
 
-		if (plane->type < 3)
-			d = p[plane->type] - plane->dist;
+		if (node->type < 3)
+			d = p[node->type] - node->dist;
 		else
-			d = DoublePrecisionDotProduct (plane->normal, p) - plane->dist;
+			d = DoublePrecisionDotProduct (node->normal, p) - node->dist;
 		if (d < 0)
 			num = node->children[1];
 		else
@@ -615,6 +996,20 @@ LINE TESTING IN HULLS
 #define VectorInterpolate(a, bness, b, c) \
 	FloatInterpolate ((a)[0], bness, (b)[0], (c)[0]), FloatInterpolate ((a)[1], bness, (b)[1], (c)[1]), FloatInterpolate ((a)[2], bness, (b)[2], (c)[2])
 
+#define RHT_STACK_SIZE 64
+
+// a node the trace straddles, waiting for its near side to be traced
+typedef struct
+{
+	const mpackedclipnode_t *node;
+	int						 side;
+	qboolean				 farside; // near side done, tracing the far side
+	float					 midf;
+	vec3_t					 mid;
+	float					 p2f;
+	float					*p2;
+} rhtframe_t;
+
 /*
 ==================
 Q1BSP_RecursiveHullTrace
@@ -625,124 +1020,153 @@ This is achieved by recursing at the actual decision points instead of vanilla's
 volume. It also uses itself to test solidity on the other side of the node, which ensures consistent precision. The actual collision point is (still) biased by
 an epsilon, so the end point shouldn't be inside walls either way. FTE's version 'should' be more compatible with vanilla than DP's (which doesn't take care
 with allsolid). ezQuake also has a version of this logic, but I trust mine more.
+The recursion is unrolled onto a small explicit stack over the hull's packed clipnodes, so the common
+straight descents are a plain loop over one contiguous array.
 ==================
 */
 int Q1BSP_RecursiveHullTrace (struct rhtctx_s *ctx, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
 {
-	mclipnode_t *node;
-	mplane_t	*plane;
-	float		 t1, t2;
-	vec3_t		 mid;
-	int			 side;
-	float		 midf;
-	int			 rht;
+	rhtframe_t				 stack[RHT_STACK_SIZE];
+	rhtframe_t				*frame;
+	int						 depth = 0;
+	const mpackedclipnode_t *node;
+	float					 t1, t2;
+	float					 midf;
+	int						 rht;
+
+	for (;;)
+	{
+		/*walk down to a leaf, remembering the nodes the trace crosses*/
+		while (num >= 0 && depth < RHT_STACK_SIZE)
+		{
+			node = ctx->nodes + num;
 
-reenter:
+			if (node->type < 3)
+			{
+				t1 = p1[node->type] - node->dist;
+				t2 = p2[node->type] - node->dist;
+			}
+			else
+			{
+				t1 = DoublePrecisionDotProduct (node->normal, p1) - node->dist;
+				t2 = DoublePrecisionDotProduct (node->normal, p2) - node->dist;
+			}
 
-	if (num < 0)
-	{
-		/*hit a leaf*/
-		trace->contents = num;
-		if (ctx->hitcontents & CONTENTMASK_FROMQ1 (num))
+			/*if its completely on one side, resume on that side*/
+			if (t1 >= 0 && t2 >= 0)
+			{
+				num = node->children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				num = node->children[1];
+				continue;
+			}
+
+			if (node->type < 3)
+			{
+				t1 = ctx->start[node->type] - node->dist;
+				t2 = ctx->end[node->type] - node->dist;
+			}
+			else
+			{
+				t1 = DotProduct (node->normal, ctx->start) - node->dist;
+				t2 = DotProduct (node->normal, ctx->end) - node->dist;
+			}
+
+			frame = &stack[depth++];
+			frame->node = node;
+			frame->side = t1 < 0;
+			frame->farside = false;
+			frame->midf = t1 / (t1 - t2);
+			if (frame->midf < p1f)
+				frame->midf = p1f;
+			if (frame->midf > p2f)
+				frame->midf = p2f;
+			VectorInterpolate (ctx->start, frame->midf, ctx->end, frame->mid);
+			frame->p2f = p2f;
+			frame->p2 = p2;
+
+			/*near side first*/
+			num = node->children[frame->side];
+			p2f = frame->midf;
+			p2 = frame->mid;
+		}
+
+		if (num >= 0)
 		{
-			if (trace->allsolid)
-				trace->startsolid = true;
-			return rht_solid;
+			/*very deep tree, carry on with a fresh stack*/
+			rht = Q1BSP_RecursiveHullTrace (ctx, num, p1f, p2f, p1, p2, trace);
 		}
 		else
 		{
-			trace->allsolid = false;
-			if (num == CONTENTS_EMPTY)
-				trace->inopen = true;
-			else if (num != CONTENTS_SOLID)
-				trace->inwater = true;
-			return rht_empty;
+			/*hit a leaf*/
+			trace->contents = num;
+			if (ctx->hitcontents & CONTENTMASK_FROMQ1 (num))
+			{
+				if (trace->allsolid)
+					trace->startsolid = true;
+				rht = rht_solid;
+			}
+			else
+			{
+				trace->allsolid = false;
+				if (num == CONTENTS_EMPTY)
+					trace->inopen = true;
+				else if (num != CONTENTS_SOLID)
+					trace->inwater = true;
+				rht = rht_empty;
+			}
 		}
-	}
-
-	/*its a node*/
-
-	/*get the node info*/
-	node = ctx->clipnodes + num;
-	plane = ctx->planes + node->planenum;
-
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else
-	{
-		t1 = DoublePrecisionDotProduct (plane->normal, p1) - plane->dist;
-		t2 = DoublePrecisionDotProduct (plane->normal, p2) - plane->dist;
-	}
-
-	/*if its completely on one side, resume on that side*/
-	if (t1 >= 0 && t2 >= 0)
-	{
-		// return Q1BSP_RecursiveHullTrace (hull, node->children[0], p1f, p2f, p1, p2, trace);
-		num = node->children[0];
-		goto reenter;
-	}
-	if (t1 < 0 && t2 < 0)
-	{
-		// return Q1BSP_RecursiveHullTrace (hull, node->children[1], p1f, p2f, p1, p2, trace);
-		num = node->children[1];
-		goto reenter;
-	}
 
-	if (plane->type < 3)
-	{
-		t1 = ctx->start[plane->type] - plane->dist;
-		t2 = ctx->end[plane->type] - plane->dist;
-	}
-	else
-	{
-		t1 = DotProduct (plane->normal, ctx->start) - plane->dist;
-		t2 = DotProduct (plane->normal, ctx->end) - plane->dist;
-	}
+		/*return up the stack until a far side is left to trace*/
+		for (; depth > 0; --depth)
+		{
+			frame = &stack[depth - 1];
+			if (!frame->farside)
+			{
+				if (rht != rht_empty && !trace->allsolid)
+					continue;
+				frame->farside = true;
+				break;
+			}
+			if (rht != rht_solid)
+				continue;
 
-	side = t1 < 0;
+			node = frame->node;
+			if (frame->side)
+			{
+				/*we impacted the back of the node, so flip the plane*/
+				trace->plane.dist = -node->dist;
+				VectorNegate (node->normal, trace->plane.normal);
+			}
+			else
+			{
+				/*we impacted the front of the node*/
+				trace->plane.dist = node->dist;
+				VectorCopy (node->normal, trace->plane.normal);
+			}
 
-	midf = t1 / (t1 - t2);
-	if (midf < p1f)
-		midf = p1f;
-	if (midf > p2f)
-		midf = p2f;
-	VectorInterpolate (ctx->start, midf, ctx->end, mid);
+			t1 = DoublePrecisionDotProduct (trace->plane.normal, ctx->start) - trace->plane.dist;
+			t2 = DoublePrecisionDotProduct (trace->plane.normal, ctx->end) - trace->plane.dist;
+			midf = (t1 - DIST_EPSILON) / (t1 - t2);
+			midf = CLAMP (0, midf, 1);
+			trace->fraction = midf;
+			VectorInterpolate (ctx->start, midf, ctx->end, trace->endpos);
+			rht = rht_impact;
+		}
 
-	rht = Q1BSP_RecursiveHullTrace (ctx, node->children[side], p1f, midf, p1, mid, trace);
-	if (rht != rht_empty && !trace->allsolid)
-		return rht;
-	rht = Q1BSP_RecursiveHullTrace (ctx, node->children[side ^ 1], midf, p2f, mid, p2, trace);
-	if (rht != rht_solid)
-		return rht;
+		if (depth == 0)
+			return rht;
 
-	if (side)
-	{
-		/*we impacted the back of the node, so flip the plane*/
-		trace->plane.dist = -plane->dist;
-		VectorNegate (plane->normal, trace->plane.normal);
-		midf = (t1 + DIST_EPSILON) / (t1 - t2);
+		frame = &stack[depth - 1];
+		num = frame->node->children[frame->side ^ 1];
+		p1f = frame->midf;
+		p1 = frame->mid;
+		p2f = frame->p2f;
+		p2 = frame->p2;
 	}
-	else
-	{
-		/*we impacted the front of the node*/
-		trace->plane.dist = plane->dist;
-		VectorCopy (plane->normal, trace->plane.normal);
-		midf = (t1 - DIST_EPSILON) / (t1 - t2);
-	}
-
-	t1 = DoublePrecisionDotProduct (trace->plane.normal, ctx->start) - trace->plane.dist;
-	t2 = DoublePrecisionDotProduct (trace->plane.normal, ctx->end) - trace->plane.dist;
-	midf = (t1 - DIST_EPSILON) / (t1 - t2);
-
-	midf = CLAMP (0, midf, 1);
-	trace->fraction = midf;
-	VectorCopy (mid, trace->endpos);
-	VectorInterpolate (ctx->start, midf, ctx->end, trace->endpos);
-
-	return rht_impact;
 }
 
 static qboolean SV_SlowRecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
@@ -907,8 +1331,7 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, vec3_t p1, vec3_t p2, trace_t *tra
 		struct rhtctx_s ctx;
 		VectorCopy (p1, ctx.start);
 		VectorCopy (p2, ctx.end);
-		ctx.clipnodes = hull->clipnodes;
-		ctx.planes = hull->planes;
+		ctx.nodes = hull->packednodes;
 		ctx.hitcontents = hitcontents;
 		return Q1BSP_RecursiveHullTrace (&ctx, hull->firstclipnode, 0, 1, p1, p2, trace) != rht_impact;
 	}
@@ -988,77 +1411,83 @@ SV_ClipToLinks
 Mins and maxs enclose the entire area swept by the move
 ====================
 */
-static void SV_ClipToLinks (areanode_t *node, moveclip_t *clip)
+static qboolean SV_ClipToEdict (edict_t *touch, moveclip_t *clip)
 {
-	link_t	*l, *next;
-	edict_t *touch;
-	trace_t	 trace;
+	trace_t trace;
 
-	// touch linked edicts
-	for (l = node->solid_edicts.next; l != &node->solid_edicts; l = next)
-	{
-		next = l->next;
-		touch = EDICT_FROM_AREA (l);
-		if (touch->v.solid == SOLID_NOT)
-			continue;
-		if (touch == clip->passedict)
-			continue;
-		if (touch->v.solid == SOLID_TRIGGER)
-			Sys_Error ("Trigger in clipping list");
+	if (touch->v.solid == SOLID_NOT)
+		return true;
+	if (touch == clip->passedict)
+		return true;
+	if (touch->v.solid == SOLID_TRIGGER)
+		Sys_Error ("Trigger in clipping list");
 
-		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
-			continue;
+	if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		return true;
 
-		if (clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] || clip->boxmins[2] > touch->v.absmax[2] ||
-			clip->boxmaxs[0] < touch->v.absmin[0] || clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2])
-			continue;
+	if (clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] || clip->boxmins[2] > touch->v.absmax[2] ||
+		clip->boxmaxs[0] < touch->v.absmin[0] || clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2])
+		return true;
 
-		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
-			continue; // points never interact
+	if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
+		return true; // points never interact
 
-		// might intersect, so do an exact clip
-		if (clip->trace.allsolid)
-			return;
-		if (clip->passedict)
-		{
-			if (PROG_TO_EDICT (touch->v.owner) == clip->passedict)
-				continue; // don't clip against own missiles
-			if (PROG_TO_EDICT (clip->passedict->v.owner) == touch)
-				continue; // don't clip against owner
-		}
+	// might intersect, so do an exact clip
+	if (clip->trace.allsolid)
+		return false;
+	if (clip->passedict)
+	{
+		if (PROG_TO_EDICT (touch->v.owner) == clip->passedict)
+			return true; // don't clip against own missiles
+		if (PROG_TO_EDICT (clip->passedict->v.owner) == touch)
+			return true; // don't clip against owner
+	}
 
-		if (touch->v.skin < 0)
-		{
-			if (!(clip->hitcontents & (1 << -(int)touch->v.skin)))
-				continue; // not solid, don't bother trying to clip.
-			if ((int)touch->v.flags & FL_MONSTER)
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, ~(1u << -CONTENTS_EMPTY));
-			else
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, ~(1u << -CONTENTS_EMPTY));
-			if (trace.contents != CONTENTS_EMPTY)
-				trace.contents = touch->v.skin;
-		}
+	if (touch->v.skin < 0)
+	{
+		if (!(clip->hitcontents & (1 << -(int)touch->v.skin)))
+			return true; // not solid, don't bother trying to clip.
+		if ((int)touch->v.flags & FL_MONSTER)
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, ~(1u << -CONTENTS_EMPTY));
 		else
-		{
-			if ((int)touch->v.flags & FL_MONSTER)
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip->hitcontents);
-			else
-				trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, clip->hitcontents);
-		}
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, ~(1u << -CONTENTS_EMPTY));
+		if (trace.contents != CONTENTS_EMPTY)
+			trace.contents = touch->v.skin;
+	}
+	else
+	{
+		if ((int)touch->v.flags & FL_MONSTER)
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip->hitcontents);
+		else
+			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end, clip->hitcontents);
+	}
 
-		if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
+	if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
+	{
+		trace.ent = touch;
+		if (clip->trace.startsolid)
 		{
-			trace.ent = touch;
-			if (clip->trace.startsolid)
-			{
-				clip->trace = trace;
-				clip->trace.startsolid = true;
-			}
-			else
-				clip->trace = trace;
-		}
-		else if (trace.startsolid)
+			clip->trace = trace;
 			clip->trace.startsolid = true;
+		}
+		else
+			clip->trace = trace;
+	}
+	else if (trace.startsolid)
+		clip->trace.startsolid = true;
+	return true;
+}
+
+static void SV_ClipToLinks (areanode_t *node, moveclip_t *clip)
+{
+	link_t *l, *next;
+
+	// touch linked edicts
+	for (l = node->solid_edicts.next; l != &node->solid_edicts; l = next)
+	{
+		next = l->next;
+		if (!SV_ClipToEdict (EDICT_FROM_AREA (l), clip))
+			return;
 	}
 
 	// recurse down both sides
@@ -1071,6 +1500,52 @@ static void SV_ClipToLinks (areanode_t *node, moveclip_t *clip)
 		SV_ClipToLinks (node->children[1], clip);
 }
 
+/*
+====================
+SV_ClipToAreaCell
+
+Tests the move box against the bounds arrays of the cell first
+====================
+*/
+static qboolean SV_ClipToAreaCell (areacell_t *cell, moveclip_t *clip)
+{
+	int i;
+
+	for (i = 0; i < cell->num_edicts; i++)
+	{
+		if (clip->boxmins[0] > cell->absmax[0][i] || clip->boxmins[1] > cell->absmax[1][i] || clip->boxmins[2] > cell->absmax[2][i] ||
+			clip->boxmaxs[0] < cell->absmin[0][i] || clip->boxmaxs[1] < cell->absmin[1][i] || clip->boxmaxs[2] < cell->absmin[2][i])
+			continue;
+		if (!SV_ClipToEdict (cell->edicts[i], clip))
+			return false;
+	}
+	return true;
+}
+
+/*
+====================
+SV_ClipToAreaGrid
+
+SV_ClipToLinks for sv_areagrid
+====================
+*/
+static void SV_ClipToAreaGrid (moveclip_t *clip)
+{
+	areacell_t *cells = &qcvm->areacells[AREA_SOLID_EDICTS * qcvm->numareacells];
+	int			first[2], last[2];
+	int			x, y;
+
+	if (SV_AreaGridCells (clip->boxmins, clip->boxmaxs, first, last))
+	{
+		for (y = first[1]; y <= last[1]; y++)
+			for (x = first[0]; x <= last[0]; x++)
+				if (!SV_ClipToAreaCell (&cells[y * qcvm->areagrid_size[0] + x], clip))
+					return;
+	}
+
+	SV_ClipToAreaCell (&cells[qcvm->numareacells - 1], clip);
+}
+
 static void World_ClipToNetwork (moveclip_t *clip)
 {
 	entity_t *touch;
@@ -1249,12 +1724,87 @@ boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
 #endif
 }
 
+/*
+==================
+SV_ClipMoveToWorld
+
+The world part of SV_Move, only reads the world model so it can run on the workers
+==================
+*/
+trace_t SV_ClipMoveToWorld (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type)
+{
+	return SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, (type & MOVE_HITALLCONTENTS) ? ~0u : CONTENTMASK_ANYSOLID);
+}
+
 /*
 ==================
 SV_Move
 ==================
 */
 trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	trace_t worldtrace = SV_ClipMoveToWorld (start, mins, maxs, end, type);
+
+	return SV_MoveFromWorldTrace (&worldtrace, start, mins, maxs, end, type, passedict);
+}
+
+#define MOVE_BATCH_TASK_SIZE 16
+
+typedef struct
+{
+	svmove_t *moves;
+	int		  count;
+} svmovebatch_t;
+
+/*
+==================
+SV_MoveBatchTask
+==================
+*/
+static void SV_MoveBatchTask (int index, svmovebatch_t *batch)
+{
+	int		  i, last;
+	svmove_t *move;
+
+	last = q_min ((index + 1) * MOVE_BATCH_TASK_SIZE, batch->count);
+	for (i = index * MOVE_BATCH_TASK_SIZE; i < last; i++)
+	{
+		move = &batch->moves[i];
+		move->trace = SV_Move (move->start, move->mins, move->maxs, move->end, move->type, move->passedict);
+	}
+}
+
+/*
+==================
+SV_MoveBatch
+==================
+*/
+void SV_MoveBatch (svmove_t *moves, int count)
+{
+	svmovebatch_t batch = {moves, count};
+	int			  num_tasks = (count + MOVE_BATCH_TASK_SIZE - 1) / MOVE_BATCH_TASK_SIZE;
+	int			  i;
+
+	if (num_tasks > 1 && !Tasks_IsWorker ())
+	{
+		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)SV_MoveBatchTask, num_tasks, &batch, sizeof (batch));
+		Task_Join (task, TASK_TIMEOUT_INFINITE);
+	}
+	else
+	{
+		for (i = 0; i < num_tasks; i++)
+			SV_MoveBatchTask (i, &batch);
+	}
+}
+
+/*
+==================
+SV_MoveFromWorldTrace
+
+SV_Move with the result of SV_ClipMoveToWorld for the same move
+==================
+*/
+trace_t SV_MoveFromWorldTrace (const trace_t *worldtrace, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
 	moveclip_t clip;
 	int		   i;
@@ -1267,7 +1817,7 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 		clip.hitcontents = CONTENTMASK_ANYSOLID;
 
 	// clip to world
-	clip.trace = SV_ClipMoveToEntity (qcvm->edicts, start, mins, maxs, end, clip.hitcontents);
+	clip.trace = *worldtrace;
 
 	clip.start = start;
 	clip.end = end;
@@ -1294,7 +1844,10 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 	SV_MoveBounds (start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs);
 
 	// clip to entities
-	SV_ClipToLinks (qcvm->areanodes, &clip);
+	if (qcvm->areagrid)
+		SV_ClipToAreaGrid (&clip);
+	else
+		SV_ClipToLinks (qcvm->areanodes, &clip);
 
 	if (qcvm == &cl.qcvm)
 		World_ClipToNetwork (&clip);
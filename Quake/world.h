@@ -51,6 +51,9 @@ typedef struct
 void SV_ClearWorld (void);
 // called after the world model has been loaded, before linking any entities
 
+void SV_FreeAreaGrid (void);
+// releases the sv_areagrid cells of qcvm
+
 void SV_UnlinkEdict (edict_t *ent);
 // call before removing an entity, and before trying to move one,
 // so it doesn't clip against itself
@@ -62,6 +65,10 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+int SV_AreaGridEdicts (const vec3_t mins, const vec3_t maxs, int *nums);
+// sv_areagrid only: the numbers of the linked solid and trigger edicts
+// touching the box, or an upper bound of their count without nums
+
 int SV_PointContentsAllBsps (vec3_t p, edict_t *forent); // check all SOLID_BSP ents
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
@@ -87,6 +94,23 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+typedef struct svmove_s
+{
+	vec3_t	 start, mins, maxs, end;
+	int		 type;
+	edict_t *passedict;
+	trace_t	 trace; // result
+} svmove_t;
+
+void SV_MoveBatch (svmove_t *moves, int count);
+// SV_Move for every move, on the workers when there are enough of them.
+// Entities can't be linked or moved while it runs, so all moves see the same world
+
+trace_t SV_ClipMoveToWorld (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type);
+trace_t SV_MoveFromWorldTrace (const trace_t *worldtrace, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
+// SV_Move split into the part against the world, which only reads the world model and can run on the workers,
+// and the part against the entities, which has to follow on the main thread
+
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
 
 qboolean SV_RecursiveHullCheck (hull_t *hull, vec3_t p1, vec3_t p2, trace_t *trace, unsigned int hitcontents);
@@ -99,10 +123,9 @@ enum
 };
 struct rhtctx_s
 {
-	unsigned int hitcontents;
-	vec3_t		 start, end;
-	mclipnode_t *clipnodes;
-	mplane_t	*planes;
+	unsigned int			 hitcontents;
+	vec3_t					 start, end;
+	const mpackedclipnode_t *nodes;
 };
 
 int Q1BSP_RecursiveHullTrace (struct rhtctx_s *ctx, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
@@ -0,0 +1,97 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : enable
+
+// Instanced variant of alias.vert: transform, lerp and lighting come from the
+// per-instance vertex binding, the UBO only holds the flags shared by the batch.
+
+layout (push_constant) uniform PushConsts
+{
+	mat4  view_projection_matrix;
+	vec3  fog_color;
+	float fog_density;
+}
+push_constants;
+
+layout (set = 2, binding = 0) uniform UBO
+{
+	mat4  model_matrix;
+	vec3  shade_vector;
+	float blend_factor;
+	vec3  light_color;
+	float entalpha;
+	uint  flags;
+}
+ubo;
+
+layout (location = 0) in vec2 in_texcoord;
+layout (location = 1) in vec4 in_pose1_position;
+layout (location = 2) in vec3 in_pose1_normal;
+layout (location = 3) in vec4 in_pose2_position;
+layout (location = 4) in vec3 in_pose2_normal;
+
+// Per instance, matches aliasinstance_t
+layout (location = 5) in vec4 in_model_matrix0;
+layout (location = 6) in vec4 in_model_matrix1;
+layout (location = 7) in vec4 in_model_matrix2;
+layout (location = 8) in vec4 in_model_matrix3;
+layout (location = 9) in vec4 in_shade_vector_blend;
+layout (location = 10) in vec3 in_light_color;
+
+layout (location = 0) out vec2 out_texcoord;
+layout (location = 1) out vec4 out_color;
+layout (location = 2) out float out_fog_frag_coord;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+float r_avertexnormal_dot (vec3 vertexnormal, vec3 shade_vector) // from MH
+{
+	float dot = dot (vertexnormal, shade_vector);
+	// wtf - this reproduces anorm_dots within as reasonable a degree of tolerance as the >= 0 case
+	if (dot < 0.0)
+		return 1.0 + dot * (13.0 / 44.0);
+	else
+		return 1.0 + dot;
+}
+
+void main ()
+{
+	out_texcoord = in_texcoord;
+
+	const mat4	model_matrix = mat4 (in_model_matrix0, in_model_matrix1, in_model_matrix2, in_model_matrix3);
+	const vec3	shade_vector = in_shade_vector_blend.xyz;
+	const float blend_factor = in_shade_vector_blend.w;
+
+	// default : MDL
+	//  [0; 1] => [0; 255]
+	float to_world_coords_factor = 255.0f;
+	float to_world_coords_shift = 0.0f;
+
+	// MD3 :
+	//  [0; 1] => [-32768; 32767]
+	if ((ubo.flags & 0x4) != 0)
+	{
+		to_world_coords_factor = 65535.0f;
+		to_world_coords_shift = -32768.0f;
+	}
+
+	const vec4 lerped_position =
+		vec4 (mix (in_pose1_position.xyz, in_pose2_position.xyz, blend_factor) * to_world_coords_factor + to_world_coords_shift, 1.0f);
+	const vec4 model_space_position = model_matrix * lerped_position;
+	gl_Position = push_constants.view_projection_matrix * model_space_position;
+
+	if ((ubo.flags & 0x2) == 0)
+	{
+		float dot1 = r_avertexnormal_dot (in_pose1_normal, shade_vector);
+		float dot2 = r_avertexnormal_dot (in_pose2_normal, shade_vector);
+		out_color = vec4 (in_light_color * mix (dot1, dot2, blend_factor), 1.0);
+	}
+	else
+		out_color = vec4 (in_light_color, 1.0f);
+
+	out_fog_frag_coord = gl_Position.w;
+}
@@ -0,0 +1,151 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// Classic particles evaluated on the GPU: every instance is one particle in the ring filled by
+// R_UploadGPUParticles, its position and ramp color are integrated in closed form from the spawn state.
+
+layout (push_constant) uniform PushConsts
+{
+	mat4  mvp;
+	vec3  fog_color;
+	float fog_density;
+}
+push_constants;
+
+layout (set = 1, binding = 0) uniform UBO
+{
+	vec3  up;
+	float texcoord_scale;
+	vec3  right;
+	float time;
+	vec3  origin;
+	float gravity;
+	vec3  forward;
+	float scale_factor;
+	uvec4 ramp_colors[6]; // ramp1, ramp2, ramp3, 8 packed colors each
+	uint  quads;
+}
+ubo;
+
+// Per instance, matches gpuparticle_t
+layout (location = 0) in vec4 in_org_spawn;
+layout (location = 1) in vec4 in_vel_die;
+layout (location = 2) in vec4 in_color;
+layout (location = 3) in uint in_type;
+layout (location = 4) in float in_ramp;
+
+layout (location = 0) out vec4 out_texcoord;
+layout (location = 1) out vec4 out_color;
+layout (location = 2) out float out_fog_frag_coord;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+// Must match ptype_t
+const uint PT_STATIC = 0;
+const uint PT_GRAV = 1;
+const uint PT_SLOWGRAV = 2;
+const uint PT_FIRE = 3;
+const uint PT_EXPLODE = 4;
+const uint PT_EXPLODE2 = 5;
+const uint PT_BLOB = 6;
+const uint PT_BLOB2 = 7;
+
+const uint quad_corners[6] = {0, 1, 2, 0, 2, 3};
+const uint tri_corners[3] = {0, 1, 3};
+
+vec4 ramp_color (uint ramp_table, float ramp)
+{
+	uint index = ramp_table * 8 + uint (ramp);
+	return vec4 (unpackUnorm4x8 (ubo.ramp_colors[index / 4][index % 4]).rgb, 1.0f);
+}
+
+void main ()
+{
+	float t = ubo.time - in_org_spawn.w;
+	vec3  org = in_org_spawn.xyz;
+	vec3  vel = in_vel_die.xyz;
+	float g = ubo.gravity;
+	float ramp = in_ramp;
+	vec4  color = in_color;
+	bool  alive = (t >= 0.0f) && (ubo.time <= in_vel_die.w);
+
+	// Closed form of the per frame Euler steps in CL_RunParticles
+	switch (in_type)
+	{
+	case PT_STATIC:
+		org += vel * t;
+		break;
+	case PT_FIRE:
+		ramp += 5.0f * t;
+		alive = alive && (ramp < 6.0f);
+		color = ramp_color (2, ramp);
+		org += vel * t;
+		org.z += 0.5f * g * t * t;
+		break;
+	case PT_EXPLODE:
+	case PT_BLOB:
+	{
+		if (in_type == PT_EXPLODE)
+		{
+			ramp += 10.0f * t;
+			alive = alive && (ramp < 8.0f);
+			color = ramp_color (0, ramp);
+		}
+		// v' = 4v - g
+		float e = (exp (4.0f * t) - 1.0f) * 0.25f;
+		org.xy += vel.xy * e;
+		org.z += (vel.z - 0.25f * g) * e + 0.25f * g * t;
+		break;
+	}
+	case PT_EXPLODE2:
+	{
+		ramp += 15.0f * t;
+		alive = alive && (ramp < 8.0f);
+		color = ramp_color (1, ramp);
+		// v' = -v - g
+		float e = 1.0f - exp (-t);
+		org.xy += vel.xy * e;
+		org.z += (vel.z + g) * e - g * t;
+		break;
+	}
+	case PT_BLOB2:
+	{
+		float e = (1.0f - exp (-4.0f * t)) * 0.25f;
+		org.xy += vel.xy * e;
+		org.z += vel.z * t - 0.5f * g * t * t;
+		break;
+	}
+	default: // PT_GRAV, PT_SLOWGRAV
+		org += vel * t;
+		org.z -= 0.5f * g * t * t;
+		break;
+	}
+
+	if (!alive)
+	{
+		// Outside of the clip volume, the whole primitive gets culled
+		gl_Position = vec4 (0.0f, 0.0f, 2.0f, 1.0f);
+		out_texcoord = vec4 (0.0f);
+		out_color = vec4 (0.0f);
+		out_fog_frag_coord = 0.0f;
+		return;
+	}
+
+	// hack a scale up to keep particles from disapearing
+	float scale = dot (org - ubo.origin, ubo.forward);
+	scale = (scale < 20.0f) ? (1.0f + 0.08f) : (1.0f + scale * 0.004f);
+	scale *= ubo.scale_factor;
+
+	uint corner = (ubo.quads != 0) ? quad_corners[gl_VertexIndex] : tri_corners[gl_VertexIndex];
+	vec2 uv = vec2 ((corner == 1 || corner == 2) ? 1.0f : 0.0f, (corner >= 2) ? 1.0f : 0.0f);
+	vec3 position = org + scale * (ubo.up * uv.x + ubo.right * uv.y);
+
+	gl_Position = push_constants.mvp * vec4 (position, 1.0f);
+	out_texcoord = vec4 (uv * ubo.texcoord_scale, 0.0f, 0.0f);
+	out_color = color;
+	out_fog_frag_coord = gl_Position.w;
+}
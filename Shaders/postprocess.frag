@@ -14,9 +14,21 @@ layout (push_constant) uniform PushConsts
 	float echo_strength;
 	float echo_scale;
 	float ui_additive;
+	float scene_scale;
+	uint  effect_flags;
+	float time;
+	float aspect_ratio;
+	float poly_blend_r;
+	float poly_blend_g;
+	float poly_blend_b;
+	float poly_blend_a;
 }
 push_constants;
 
+// Same bits as screen_effects.inc, the per pixel effects run here when the compute pass is skipped
+#define SCREEN_EFFECT_FLAG_WATER_WARP 0x4
+#define SCREEN_EFFECT_FLAG_MENU		  0x10
+
 layout (set = 0, binding = 0) uniform sampler2D game_texture;
 layout (set = 1, binding = 0) uniform sampler2D ui_texture;
 
@@ -34,8 +46,25 @@ vec2 barrel_distort (vec2 uv, float strength)
 
 void main ()
 {
-	// Sample game at straight UV (no distortion)
-	vec3 game = texture (game_texture, in_uv).rgb;
+	// Sample game at straight UV (no distortion), upscaled from the top left under r_dynamicscale
+	vec2 scene_uv = in_uv;
+	if ((push_constants.effect_flags & SCREEN_EFFECT_FLAG_WATER_WARP) != 0)
+	{
+		const float cycle_x = 3.14159f * 5.0f;
+		const float cycle_y = cycle_x * push_constants.aspect_ratio;
+		const float amp_x = 1.0f / 300.0f;
+		const float amp_y = amp_x * push_constants.aspect_ratio;
+
+		scene_uv.x = (in_uv.x + (sin (in_uv.y * cycle_x + push_constants.time) * amp_x)) * (1.0f - amp_x * 2.0f) + amp_x;
+		scene_uv.y = (in_uv.y + (sin (in_uv.x * cycle_y + push_constants.time) * amp_y)) * (1.0f - amp_y * 2.0f) + amp_y;
+	}
+	vec2 game_size = vec2 (textureSize (game_texture, 0));
+	vec2 game_uv = min (scene_uv * push_constants.scene_scale, vec2 (push_constants.scene_scale) - 0.5 / game_size);
+	vec3 game = texture (game_texture, game_uv).rgb;
+
+	game = mix (game, vec3 (push_constants.poly_blend_r, push_constants.poly_blend_g, push_constants.poly_blend_b), push_constants.poly_blend_a);
+	if ((push_constants.effect_flags & SCREEN_EFFECT_FLAG_MENU) != 0)
+		game = mix (game, vec3 (game.r * 0.3f + game.g * 0.59f + game.b * 0.11f), 0.5f) * 0.6f;
 
 	// Sample UI with warp + optional chromatic aberration
 	float warp = push_constants.warp_strength;
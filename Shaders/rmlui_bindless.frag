@@ -0,0 +1,24 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// All UI textures in one array, must match RenderInterface_VK::BINDLESS_MAX_TEXTURES
+layout (set = 0, binding = 0) uniform sampler2D textures[1024];
+
+// Shares the vertex shader push constant block, texture_index replaces its padding
+layout (push_constant) uniform PushConsts
+{
+    layout (offset = 72) uint texture_index;
+} push_constants;
+
+layout (location = 0) in vec4 in_color;
+layout (location = 1) in vec2 in_texcoord;
+
+layout (location = 0) out vec4 out_frag_color;
+
+void main()
+{
+    // Index is dynamically uniform, one texture per draw
+    vec4 tex_color = texture(textures[push_constants.texture_index], in_texcoord);
+    out_frag_color = in_color * tex_color;
+}
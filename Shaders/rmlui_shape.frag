@@ -0,0 +1,41 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// Signed distance shapes for the reticle elements, must match RenderInterface_VK::ShapePushConstants
+layout (push_constant) uniform PushConsts
+{
+	layout (offset = 80) vec4 color; // premultiplied
+	vec4 params;
+	vec2 axis;
+	uint shape;
+} push_constants;
+
+layout (location = 0) in vec2 in_local;
+
+layout (location = 0) out vec4 out_frag_color;
+
+void main()
+{
+	vec2  p = in_local;
+	vec4  params = push_constants.params;
+	vec2  axis = push_constants.axis;
+	float len = length(p);
+
+	// Arc: params = (inner radius, outer radius, half sweep), axis points at the middle of the arc.
+	// Rings and filled circles have a half sweep of pi and skip the angular term.
+	float arc_dist = max(len - params.y, params.x - len);
+	float along = dot(p, axis);
+	float angle = acos(clamp(along / max(len, 1e-4), -1.0, 1.0));
+	arc_dist = (params.z < 3.14159) ? max(arc_dist, (angle - params.z) * len) : arc_dist;
+
+	// Box: params = (distance along the axis to the center, half length, half width)
+	vec2  q = abs(vec2(along - params.x, dot(p, vec2(-axis.y, axis.x)))) - params.yz;
+	float box_dist = length(max(q, vec2(0.0))) + min(max(q.x, q.y), 0.0);
+
+	float dist = (push_constants.shape == 0u) ? arc_dist : box_dist;
+
+	// Antialiased over about one pixel, independent of the UI scale and transform
+	float coverage = clamp(0.5 - dist / max(fwidth(dist), 1e-4), 0.0, 1.0);
+	out_frag_color = push_constants.color * coverage;
+}
@@ -0,0 +1,27 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// Same layout as the rmlui.vert push constants, half_size replaces its padding
+layout (push_constant) uniform PushConsts
+{
+	mat4 mvp;
+	vec2 translate;
+	vec2 half_size;
+} push_constants;
+
+// Unit quad corner in [-1, 1], the vertex color and texcoord are not used
+layout (location = 0) in vec2 in_position;
+
+layout (location = 0) out vec2 out_local;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main()
+{
+	out_local = in_position * push_constants.half_size;
+	gl_Position = push_constants.mvp * vec4(out_local + push_constants.translate, 0.0, 1.0);
+}
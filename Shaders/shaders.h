@@ -21,9 +21,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef __SHADERS_H
 #define __SHADERS_H
 
+// The SPIR-V is deflated by bintoc -c, R_CreateShaderModules inflates it
 #define DECLARE_SHADER_SPV(name)             \
 	extern const unsigned char name##_spv[]; \
-	extern const int		   name##_spv_size;
+	extern const int		   name##_spv_size; \
+	extern const int		   name##_spv_decompressed_size;
 
 DECLARE_SHADER_SPV (basic_vert);
 DECLARE_SHADER_SPV (basic_frag);
@@ -31,26 +33,33 @@ DECLARE_SHADER_SPV (basic_alphatest_frag);
 DECLARE_SHADER_SPV (basic_notex_frag);
 DECLARE_SHADER_SPV (world_vert);
 DECLARE_SHADER_SPV (world_frag);
+DECLARE_SHADER_SPV (world_indirect_vert);
 DECLARE_SHADER_SPV (alias_vert);
+DECLARE_SHADER_SPV (alias_instanced_vert);
+DECLARE_SHADER_SPV (alias_cull_comp);
 DECLARE_SHADER_SPV (alias_frag);
 DECLARE_SHADER_SPV (alias_alphatest_frag);
 DECLARE_SHADER_SPV (md5_vert);
+DECLARE_SHADER_SPV (particles_gpu_vert);
 DECLARE_SHADER_SPV (sky_layer_vert);
 DECLARE_SHADER_SPV (sky_layer_frag);
 DECLARE_SHADER_SPV (sky_box_frag);
 DECLARE_SHADER_SPV (sky_cube_vert);
 DECLARE_SHADER_SPV (sky_cube_frag);
+DECLARE_SHADER_SPV (sky_cache_comp);
 DECLARE_SHADER_SPV (postprocess_vert);
 DECLARE_SHADER_SPV (postprocess_frag);
 DECLARE_SHADER_SPV (screen_effects_8bit_comp);
-DECLARE_SHADER_SPV (screen_effects_8bit_scale_comp);
 DECLARE_SHADER_SPV (screen_effects_8bit_scale_sops_comp);
 DECLARE_SHADER_SPV (screen_effects_10bit_comp);
-DECLARE_SHADER_SPV (screen_effects_10bit_scale_comp);
 DECLARE_SHADER_SPV (screen_effects_10bit_scale_sops_comp);
 DECLARE_SHADER_SPV (cs_tex_warp_comp);
 DECLARE_SHADER_SPV (indirect_comp);
 DECLARE_SHADER_SPV (indirect_clear_comp);
+DECLARE_SHADER_SPV (indirect_mark_comp);
+DECLARE_SHADER_SPV (occlusion_depth_comp);
+DECLARE_SHADER_SPV (occlusion_depth_ms_comp);
+DECLARE_SHADER_SPV (shading_rate_comp);
 DECLARE_SHADER_SPV (showtris_vert);
 DECLARE_SHADER_SPV (showtris_frag);
 DECLARE_SHADER_SPV (update_lightmap_8bit_comp);
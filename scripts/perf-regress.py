@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Performance regression check over the bench command and timedemos.
+
+Usage:
+    perf-regress.py --engine <exe> [--basedir <dir>] [--game <dir>] [--runs N]
+                    [--demo-engine <exe> --demos <demo> ...]
+                    [--baseline <file>] [--output <file>] [--update-baseline]
+                    [--threshold 0.05] [--alpha 0.05]
+
+Runs "bench -json" --runs times in a headless server with 16 client slots on
+start (the sv_load bots need them), and optionally "benchmark" over --demos in
+a client window. Every run is one sample of each metric, lower is better:
+
+    bench/<group>/<case>           ns/op of a bench case, including the
+                                   sv_load server frame and map_load times
+    demo/<demo>/<series>.<pct>     frame, host, server and render time
+                                   percentiles of one timedemo run
+
+The samples go to --output. Without a baseline they become the baseline, the
+first run on a machine records it. Otherwise a metric regresses when its median
+is more than --threshold slower than the baseline's and a one-sided exact
+Mann-Whitney U test of the samples is below --alpha. Any regression fails with
+exit code 1, so "meson test --benchmark" fails. Baselines are only comparable
+on the same machine and build type.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+from pathlib import Path
+
+DEMO_SERIES = ("frame_ms", "host_ms", "server_ms", "render_ms")
+DEMO_PERCENTILES = ("p50", "p95", "p99")
+
+
+def run_engine(args: list[str], timeout: int) -> None:
+    result = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=timeout, text=True, errors="replace")
+    if result.returncode != 0:
+        sys.stdout.write(result.stdout)
+        raise RuntimeError(f"{args[0]} exited with code {result.returncode}")
+
+
+def collect_bench(opts: argparse.Namespace, gamedir: Path, metrics: dict[str, list[float]]) -> None:
+    """One headless run of every bench case."""
+    output = gamedir / "bench.json"
+    output.unlink(missing_ok=True)
+    args = [opts.engine, "-basedir", str(opts.basedir), "-dedicated", "16"]
+    if opts.game:
+        args += ["-game", opts.game]
+    run_engine(args + ["+map", "start", "+bench", "-json", "+quit"], opts.timeout)
+    with open(output) as f:
+        for result in json.load(f)["results"]:
+            metrics.setdefault(f"bench/{result['group']}/{result['name']}", []).append(result["ns_per_op"])
+
+
+def collect_demos(opts: argparse.Namespace, gamedir: Path, metrics: dict[str, list[float]]) -> None:
+    """All timedemo runs in one client, see the benchmark command."""
+    output = gamedir / "benchmark.json"
+    output.unlink(missing_ok=True)
+    args = [opts.demo_engine, "-basedir", str(opts.basedir), "-benchmark", "-width", "1280", "-height", "720", "-window"]
+    if opts.game:
+        args += ["-game", opts.game]
+    run_engine(args + ["+wait"] * 20 + ["+benchmark", str(opts.runs)] + opts.demos, opts.timeout)
+    with open(output) as f:
+        for demo in json.load(f)["demos"]:
+            for run in demo["runs"]:
+                for series in DEMO_SERIES:
+                    if run.get(series) is None:
+                        continue
+                    for pct in DEMO_PERCENTILES:
+                        metrics.setdefault(f"demo/{demo['name']}/{series}.{pct}", []).append(run[series][pct])
+
+
+def mann_whitney_greater(new: list[float], base: list[float]) -> float:
+    """Exact one-sided p-value of new being stochastically larger than base.
+
+    Ties count half, U is rounded down so ties never make a result look more
+    significant. Sample counts are small, so the null distribution of U is
+    counted directly instead of using the normal approximation.
+    """
+    n1, n2 = len(new), len(base)
+    u = int(sum(1.0 if x > y else 0.5 if x == y else 0.0 for x in new for y in base))
+    # ways[i][j][k]: orderings of i new and j base samples with U == k
+    ways = [[[0] * (n1 * n2 + 1) for _ in range(n2 + 1)] for _ in range(n1 + 1)]
+    for i in range(n1 + 1):
+        for j in range(n2 + 1):
+            if i == 0 or j == 0:
+                ways[i][j][0] = 1
+                continue
+            for k in range(i * j + 1):
+                # the largest sample is either new (above all j base ones) or base
+                ways[i][j][k] = (ways[i - 1][j][k - j] if k >= j else 0) + ways[i][j - 1][k]
+    total = sum(ways[n1][n2])
+    return sum(ways[n1][n2][u:]) / total
+
+
+def compare(baseline: dict[str, list[float]], current: dict[str, list[float]], threshold: float, alpha: float) -> list[str]:
+    regressions = []
+    print(f"{'metric':<64} {'baseline':>12} {'current':>12} {'change':>8} {'p':>7}")
+    for name in sorted(current):
+        if name not in baseline:
+            print(f"{name:<64} {'':>12} {statistics.median(current[name]):>12.3f}      new")
+            continue
+        base, new = baseline[name], current[name]
+        base_median, new_median = statistics.median(base), statistics.median(new)
+        change = new_median / base_median - 1.0 if base_median > 0.0 else 0.0
+        p = mann_whitney_greater(new, base)
+        regressed = change > threshold and p < alpha
+        flag = "  REGRESSION" if regressed else ""
+        print(f"{name:<64} {base_median:>12.3f} {new_median:>12.3f} {change * 100.0:>+7.1f}% {p:>7.4f}{flag}")
+        if regressed:
+            regressions.append(f"{name}: {base_median:.3f} -> {new_median:.3f} ({change * 100.0:+.1f}%, p={p:.4f})")
+    for name in sorted(set(baseline) - set(current)):
+        print(f"{name:<64} missing from this run")
+    return regressions
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--engine", required=True, help="headless engine, vkquake-ded or vkquake (runs with -dedicated)")
+    parser.add_argument("--basedir", type=Path, default=Path.cwd(), help="directory with id1/")
+    parser.add_argument("--game", help="mod directory passed as -game")
+    parser.add_argument("--runs", type=int, default=5, help="engine runs, each one sample per metric")
+    parser.add_argument("--demo-engine", help="client used for --demos, needs a Vulkan device and a window")
+    parser.add_argument("--demos", nargs="*", default=[], help="demos to timedemo --runs times each")
+    parser.add_argument("--baseline", type=Path, default=Path("perf_baseline.json"))
+    parser.add_argument("--output", type=Path, default=Path("perf_results.json"))
+    parser.add_argument("--update-baseline", action="store_true", help="replace the baseline with this run")
+    parser.add_argument("--threshold", type=float, default=0.05, help="smallest relative slowdown of the median that counts")
+    parser.add_argument("--alpha", type=float, default=0.05, help="significance level of the U test")
+    parser.add_argument("--timeout", type=int, default=600, help="seconds per engine run")
+    opts = parser.parse_args()
+
+    if opts.demos and not opts.demo_engine:
+        parser.error("--demos needs --demo-engine")
+    if opts.runs < 4:
+        # with 3 runs against 3 the smallest one-sided p is 0.05, nothing could ever be flagged
+        parser.error("--runs must be at least 4")
+
+    gamedir = opts.basedir / (opts.game or "id1")
+    metrics: dict[str, list[float]] = {}
+    try:
+        for run in range(opts.runs):
+            print(f"bench run {run + 1}/{opts.runs}", flush=True)
+            collect_bench(opts, gamedir, metrics)
+        if opts.demos:
+            print(f"timedemo {' '.join(opts.demos)}, {opts.runs} runs each", flush=True)
+            collect_demos(opts, gamedir, metrics)
+    except (OSError, RuntimeError, subprocess.TimeoutExpired, KeyError, ValueError) as e:
+        print(f"perf-regress: {e}", file=sys.stderr)
+        return 2
+
+    results = {"engine": os.path.basename(opts.engine), "runs": opts.runs, "metrics": metrics}
+    with open(opts.output, "w") as f:
+        json.dump(results, f, indent="\t")
+        f.write("\n")
+
+    if opts.update_baseline or not opts.baseline.exists():
+        with open(opts.baseline, "w") as f:
+            json.dump(results, f, indent="\t")
+            f.write("\n")
+        print(f"Baseline written to {opts.baseline}")
+        return 0
+
+    with open(opts.baseline) as f:
+        baseline = json.load(f)["metrics"]
+    regressions = compare(baseline, metrics, opts.threshold, opts.alpha)
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) against {opts.baseline}:")
+        for line in regressions:
+            print(f"  {line}")
+        return 1
+    print(f"\nNo regressions against {opts.baseline}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
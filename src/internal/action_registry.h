@@ -4,7 +4,7 @@
  * Single source of truth for all menu action names and their argument
  * types.  Consumed by:
  *   - lua_bridge.cpp    (register Lua globals)
- *   - menu_event_handler.cpp  (validate action names in ExecuteAction)
+ *   - menu_event_handler.cpp  (parse action strings into ActionId)
  */
 
 #ifndef QRMLUI_ACTION_REGISTRY_H
@@ -20,23 +20,52 @@ enum class ActionArgType
 	StringInt // cycle_cvar('x', 1)
 };
 
+// Dispatch ids, action strings are parsed into these once by MenuEventHandler
+enum class ActionId
+{
+	Navigate,
+	Command,
+	CvarChanged,
+	CycleCvar,
+	Close,
+	CloseAll,
+	Quit,
+	NewGame,
+	LoadGame,
+	SaveGame,
+	BindKey,
+	MainMenu,
+	ConnectTo,
+	HostGame,
+	LoadMod,
+	Unknown // not in the registry, e.g. a data model event callback
+};
+
 struct ActionDef
 {
 	const char	 *name;
 	ActionArgType arg_type;
+	ActionId	  id;
 };
 
-// All 15 menu actions supported by MenuEventHandler::ExecuteAction.
+// All 15 menu actions supported by MenuEventHandler::DispatchAction.
 // Order is irrelevant; the array is searched linearly.
 inline constexpr ActionDef kActionRegistry[] = {
-	{"navigate", ActionArgType::String},	 {"command", ActionArgType::String},
-	{"cvar_changed", ActionArgType::String}, {"cycle_cvar", ActionArgType::StringInt},
-	{"close", ActionArgType::None},			 {"close_all", ActionArgType::None},
-	{"quit", ActionArgType::None},			 {"new_game", ActionArgType::None},
-	{"load_game", ActionArgType::String},	 {"save_game", ActionArgType::String},
-	{"bind_key", ActionArgType::String},	 {"main_menu", ActionArgType::None},
-	{"connect_to", ActionArgType::String},	 {"host_game", ActionArgType::String},
-	{"load_mod", ActionArgType::String},
+	{"navigate", ActionArgType::String, ActionId::Navigate},
+	{"command", ActionArgType::String, ActionId::Command},
+	{"cvar_changed", ActionArgType::String, ActionId::CvarChanged},
+	{"cycle_cvar", ActionArgType::StringInt, ActionId::CycleCvar},
+	{"close", ActionArgType::None, ActionId::Close},
+	{"close_all", ActionArgType::None, ActionId::CloseAll},
+	{"quit", ActionArgType::None, ActionId::Quit},
+	{"new_game", ActionArgType::None, ActionId::NewGame},
+	{"load_game", ActionArgType::String, ActionId::LoadGame},
+	{"save_game", ActionArgType::String, ActionId::SaveGame},
+	{"bind_key", ActionArgType::String, ActionId::BindKey},
+	{"main_menu", ActionArgType::None, ActionId::MainMenu},
+	{"connect_to", ActionArgType::String, ActionId::ConnectTo},
+	{"host_game", ActionArgType::String, ActionId::HostGame},
+	{"load_mod", ActionArgType::String, ActionId::LoadMod},
 };
 
 inline constexpr int kActionRegistrySize = sizeof (kActionRegistry) / sizeof (kActionRegistry[0]);
@@ -6,6 +6,7 @@
 
 #include "cvar_binding.h"
 #include "quake_cvar_provider.h"
+#include "spike_trace.h"
 #include "../types/game_state.h"
 
 #include <algorithm>
@@ -37,6 +38,23 @@ struct KeybindDef
 	const char *section;
 };
 
+// Cvars the computed vid_* labels read directly, they are dirtied when their cvar changes
+struct ComputedCvar
+{
+	const char *cvar_name;
+	const char *variable;
+	CvarHandle	cvar;
+	uint32_t	synced_change_count;
+};
+
+static ComputedCvar s_computed_cvars[] = {
+	{"vid_width", "vid_mode_label", nullptr, 0},
+	{"vid_height", "vid_mode_label", nullptr, 0},
+	{"vid_refreshrate", "vid_rate_label", nullptr, 0},
+	{"vid_fullscreen", "vid_fullscreen_label", nullptr, 0},
+	{"vid_vsync", "vid_vsync_label", nullptr, 0},
+};
+
 static const KeybindDef kKeybindDefs[] = {
 	{"+forward", "Move Forward", "Movement"},
 	{"+back", "Move Backward", "Movement"},
@@ -68,8 +86,7 @@ std::unordered_map<std::string, std::unique_ptr<int>>		  CvarBindingManager::s_i
 std::unordered_map<std::string, std::unique_ptr<Rml::String>> CvarBindingManager::s_string_values;
 bool														  CvarBindingManager::s_initialized = false;
 ICvarProvider												 *CvarBindingManager::s_provider = nullptr;
-bool														  CvarBindingManager::s_ignore_ui_changes = false;
-int															  CvarBindingManager::s_ignore_ui_changes_frames = 0;
+uint32_t													  CvarBindingManager::s_synced_change_count = 0;
 
 namespace
 {
@@ -119,11 +136,64 @@ int RepackColor (int packed, int new_half, const std::string &ui_name)
 	return (packed / 16) * 16 + new_half;
 }
 
+// Binding cvars are looked up once and accessed through the cached handle after that.
+// Cvars that aren't registered (yet) keep going through the name based calls.
+CvarHandle ResolveCvar (ICvarProvider *provider, CvarBinding &binding)
+{
+	if (!binding.cvar)
+		binding.cvar = provider->FindCvar (binding.cvar_name);
+	return binding.cvar;
+}
+
+float GetCvarFloat (ICvarProvider *provider, CvarBinding &binding)
+{
+	CvarHandle cvar = ResolveCvar (provider, binding);
+	return cvar ? provider->GetFloat (cvar) : provider->GetFloat (binding.cvar_name);
+}
+
+std::string GetCvarString (ICvarProvider *provider, CvarBinding &binding)
+{
+	CvarHandle cvar = ResolveCvar (provider, binding);
+	return cvar ? provider->GetString (cvar) : provider->GetString (binding.cvar_name);
+}
+
+// Int/Bool/Enum value of the binding's cvar as the UI shows it
+int GetCvarInt (ICvarProvider *provider, CvarBinding &binding)
+{
+	if (IsInvertMouseBinding (binding.ui_name))
+		return GetInvertMouseValue (provider);
+	const int value = static_cast<int> (GetCvarFloat (provider, binding));
+	return IsPackedColorBinding (binding.ui_name) ? UnpackColorHalf (value, binding.ui_name) : value;
+}
+
+void SetCvarFloat (ICvarProvider *provider, CvarBinding &binding, float value)
+{
+	if (CvarHandle cvar = ResolveCvar (provider, binding))
+		provider->SetFloat (cvar, value);
+	else
+		provider->SetFloat (binding.cvar_name, value);
+}
+
+void SetCvarString (ICvarProvider *provider, CvarBinding &binding, const std::string &value)
+{
+	if (CvarHandle cvar = ResolveCvar (provider, binding))
+		provider->SetString (cvar, value);
+	else
+		provider->SetString (binding.cvar_name, value);
+}
+
 } // namespace
 
 void CvarBindingManager::SetProvider (ICvarProvider *provider)
 {
 	s_provider = provider;
+
+	// Handles and change counts belong to the provider that resolved them
+	for (auto &pair : s_bindings)
+		pair.second.cvar = nullptr;
+	for (ComputedCvar &computed : s_computed_cvars)
+		computed.cvar = nullptr;
+	s_synced_change_count = 0;
 }
 
 ICvarProvider *CvarBindingManager::GetProvider ()
@@ -425,7 +495,7 @@ void CvarBindingManager::RegisterAllBindings ()
 					if (arguments.empty ())
 						return;
 					Rml::String ui_name = arguments[0].Get<Rml::String> ();
-					if (ui_name.empty () || ShouldIgnoreUIChange ())
+					if (ui_name.empty ())
 						return;
 					SyncFromUI (std::string (ui_name.c_str ()));
 				});
@@ -532,8 +602,7 @@ void CvarBindingManager::Shutdown ()
 	s_model_handle = Rml::DataModelHandle ();
 	s_context = nullptr;
 	s_initialized = false;
-	s_ignore_ui_changes = false;
-	s_ignore_ui_changes_frames = 0;
+	s_synced_change_count = 0;
 
 	Con_DPrintf ("CvarBindingManager: Shutdown\n");
 }
@@ -798,82 +867,122 @@ void CvarBindingManager::RegisterString (const char *cvar, const char *ui_name)
 	Con_DPrintf ("CvarBindingManager: Registered string '%s' -> '%s'\n", cvar, ui_name);
 }
 
-void CvarBindingManager::SyncToUI ()
+bool CvarBindingManager::PullBinding (CvarBinding &binding)
 {
-	if (!s_initialized)
-		return;
-
-	// Suppress UI change handling for the next two update ticks. Data binding
-	// updates emit "change" events when dirty values are pushed to elements.
-	// SyncToUI is often called from within g_context->Update() (via event
-	// processing), so the dirty data may not be processed until the NEXT
-	// Update() call — requiring two frames of suppression.
-	s_ignore_ui_changes = true;
-	s_ignore_ui_changes_frames = 2;
-
-	for (auto &pair : s_bindings)
+	ICvarProvider *provider = GetProvider ();
+	switch (binding.type)
 	{
-		const CvarBinding &binding = pair.second;
-		const char		  *cvar_name = binding.cvar_name.c_str ();
-
-		switch (binding.type)
+	case CvarType::Float:
+		if (auto it = s_float_values.find (binding.ui_name); it != s_float_values.end () && it->second)
 		{
-		case CvarType::Float:
-			if (auto it = s_float_values.find (binding.ui_name); it != s_float_values.end () && it->second)
+			const float value = GetCvarFloat (provider, binding);
+			if (*(it->second) != value)
 			{
-				*(it->second) = GetProvider ()->GetFloat (cvar_name);
+				*(it->second) = value;
+				return true;
 			}
-			break;
-		case CvarType::Bool:
-		case CvarType::Int:
-		case CvarType::Enum:
-			if (auto it = s_int_values.find (binding.ui_name); it != s_int_values.end () && it->second)
+		}
+		break;
+	case CvarType::Bool:
+	case CvarType::Int:
+	case CvarType::Enum:
+		if (auto it = s_int_values.find (binding.ui_name); it != s_int_values.end () && it->second)
+		{
+			const int value = GetCvarInt (provider, binding);
+			if (*(it->second) != value)
 			{
-				if (IsInvertMouseBinding (binding.ui_name))
-				{
-					*(it->second) = GetInvertMouseValue (GetProvider ());
-				}
-				else if (IsPackedColorBinding (binding.ui_name))
-				{
-					int packed = static_cast<int> (GetProvider ()->GetFloat (cvar_name));
-					*(it->second) = UnpackColorHalf (packed, binding.ui_name);
-				}
-				else
-				{
-					*(it->second) = static_cast<int> (GetProvider ()->GetFloat (cvar_name));
-				}
+				*(it->second) = value;
+				return true;
 			}
-			break;
-		case CvarType::String:
+		}
+		break;
+	case CvarType::String:
+		if (auto it = s_string_values.find (binding.ui_name); it != s_string_values.end () && it->second)
 		{
-			if (auto it = s_string_values.find (binding.ui_name); it != s_string_values.end () && it->second)
+			std::string value = GetCvarString (provider, binding);
+			if (*(it->second) != value)
 			{
-				*(it->second) = GetProvider ()->GetString (cvar_name);
+				*(it->second) = std::move (value);
+				return true;
 			}
-			break;
-		}
 		}
+		break;
 	}
-
-	MarkDirty ();
-	Con_DPrintf ("CvarBindingManager: Synced %zu cvars to UI\n", s_bindings.size ());
+	return false;
 }
 
-bool CvarBindingManager::ShouldIgnoreUIChange ()
+void CvarBindingManager::DirtyBinding (const CvarBinding &binding)
 {
-	return s_ignore_ui_changes;
+	if (!s_model_handle)
+		return;
+	s_model_handle.DirtyVariable (binding.ui_name);
+	if (!binding.enum_labels.empty ())
+		s_model_handle.DirtyVariable (binding.ui_name + "_label");
+	SpikeTrace::NoteDirty (binding.ui_name.c_str ());
 }
 
-void CvarBindingManager::NotifyUIUpdateComplete ()
+void CvarBindingManager::SyncChangedCvars (bool force)
 {
-	if (s_ignore_ui_changes_frames > 0)
+	if (!s_initialized)
+		return;
+
+	ICvarProvider *provider = GetProvider ();
+	const uint32_t change_count = provider->GetChangeCount ();
+	if (!force && change_count == s_synced_change_count)
+		return;
+	s_synced_change_count = change_count;
+
+	int num_dirty = 0;
+	for (auto &pair : s_bindings)
 	{
-		s_ignore_ui_changes_frames--;
-		if (s_ignore_ui_changes_frames == 0)
+		CvarBinding &binding = pair.second;
+		if (CvarHandle cvar = ResolveCvar (provider, binding))
 		{
-			s_ignore_ui_changes = false;
+			const uint32_t cvar_change_count = provider->GetChangeCount (cvar);
+			if (!force && cvar_change_count == binding.synced_change_count)
+				continue;
+			binding.synced_change_count = cvar_change_count;
+		}
+		else if (!force)
+			continue;
+
+		// Only values that differ are dirtied, so a change event the data binding emits
+		// while pushing a value finds the cvar already matching in SyncFromUI.
+		if (PullBinding (binding))
+		{
+			DirtyBinding (binding);
+			++num_dirty;
 		}
 	}
+
+	for (ComputedCvar &computed : s_computed_cvars)
+	{
+		if (!computed.cvar)
+			computed.cvar = provider->FindCvar (computed.cvar_name);
+		if (!computed.cvar)
+			continue;
+		const uint32_t cvar_change_count = provider->GetChangeCount (computed.cvar);
+		if (force || cvar_change_count != computed.synced_change_count)
+		{
+			computed.synced_change_count = cvar_change_count;
+			if (s_model_handle)
+				s_model_handle.DirtyVariable (computed.variable);
+			SpikeTrace::NoteDirty (computed.variable);
+		}
+	}
+
+	if (force)
+		Con_DPrintf ("CvarBindingManager: Synced %zu cvars to UI, %d changed\n", s_bindings.size (), num_dirty);
+}
+
+void CvarBindingManager::SyncToUI ()
+{
+	SyncChangedCvars (true);
+}
+
+void CvarBindingManager::Update ()
+{
+	SyncChangedCvars (false);
 }
 
 void CvarBindingManager::SyncFromUI (const std::string &ui_name)
@@ -888,17 +997,18 @@ void CvarBindingManager::SyncFromUI (const std::string &ui_name)
 		return;
 	}
 
-	const CvarBinding &binding = it->second;
-	const char		  *cvar_name = binding.cvar_name.c_str ();
+	CvarBinding &binding = it->second;
 
+	// A value that already matches the cvar is the echo of a cvar -> UI sync, writing
+	// it back could only lose precision (e.g. an Int binding on a fractional cvar).
 	switch (binding.type)
 	{
 	case CvarType::Float:
 	{
 		auto val_it = s_float_values.find (ui_name);
-		if (val_it != s_float_values.end () && val_it->second)
+		if (val_it != s_float_values.end () && val_it->second && *(val_it->second) != GetCvarFloat (GetProvider (), binding))
 		{
-			GetProvider ()->SetFloat (cvar_name, *(val_it->second));
+			SetCvarFloat (GetProvider (), binding, *(val_it->second));
 		}
 		break;
 	}
@@ -907,7 +1017,7 @@ void CvarBindingManager::SyncFromUI (const std::string &ui_name)
 	case CvarType::Enum:
 	{
 		auto val_it = s_int_values.find (ui_name);
-		if (val_it != s_int_values.end () && val_it->second)
+		if (val_it != s_int_values.end () && val_it->second && *(val_it->second) != GetCvarInt (GetProvider (), binding))
 		{
 			if (IsInvertMouseBinding (binding.ui_name))
 			{
@@ -915,13 +1025,13 @@ void CvarBindingManager::SyncFromUI (const std::string &ui_name)
 			}
 			else if (IsPackedColorBinding (ui_name))
 			{
-				int packed = static_cast<int> (GetProvider ()->GetFloat (cvar_name));
+				int packed = static_cast<int> (GetCvarFloat (GetProvider (), binding));
 				int new_packed = RepackColor (packed, *(val_it->second), ui_name);
-				GetProvider ()->SetFloat (cvar_name, static_cast<float> (new_packed));
+				SetCvarFloat (GetProvider (), binding, static_cast<float> (new_packed));
 			}
 			else
 			{
-				GetProvider ()->SetFloat (cvar_name, static_cast<float> (*(val_it->second)));
+				SetCvarFloat (GetProvider (), binding, static_cast<float> (*(val_it->second)));
 			}
 		}
 		break;
@@ -929,9 +1039,9 @@ void CvarBindingManager::SyncFromUI (const std::string &ui_name)
 	case CvarType::String:
 	{
 		auto val_it = s_string_values.find (ui_name);
-		if (val_it != s_string_values.end () && val_it->second)
+		if (val_it != s_string_values.end () && val_it->second && *(val_it->second) != GetCvarString (GetProvider (), binding))
 		{
-			GetProvider ()->SetString (cvar_name, val_it->second->c_str ());
+			SetCvarString (GetProvider (), binding, *(val_it->second));
 		}
 		break;
 	}
@@ -964,6 +1074,7 @@ void CvarBindingManager::MarkDirty ()
 	if (s_initialized && s_model_handle)
 	{
 		s_model_handle.DirtyAllVariables ();
+		SpikeTrace::NoteDirty ("cvars.*");
 	}
 }
 
@@ -999,7 +1110,8 @@ void CvarBindingManager::SetFloatValue (const std::string &ui_name, float value)
 		*(it->second) = value;
 	}
 	SyncFromUI (ui_name);
-	MarkDirty ();
+	if (const CvarBinding *changed = GetBinding (ui_name))
+		DirtyBinding (*changed);
 }
 
 bool CvarBindingManager::GetBoolValue (const std::string &ui_name)
@@ -1020,7 +1132,8 @@ void CvarBindingManager::SetBoolValue (const std::string &ui_name, bool value)
 		*(it->second) = value ? 1 : 0;
 	}
 	SyncFromUI (ui_name);
-	MarkDirty ();
+	if (const CvarBinding *changed = GetBinding (ui_name))
+		DirtyBinding (*changed);
 }
 
 int CvarBindingManager::GetIntValue (const std::string &ui_name)
@@ -1052,7 +1165,8 @@ void CvarBindingManager::SetIntValue (const std::string &ui_name, int value)
 		*(it->second) = value;
 	}
 	SyncFromUI (ui_name);
-	MarkDirty ();
+	if (const CvarBinding *changed = GetBinding (ui_name))
+		DirtyBinding (*changed);
 }
 
 Rml::String CvarBindingManager::GetStringValue (const std::string &ui_name)
@@ -1073,7 +1187,8 @@ void CvarBindingManager::SetStringValue (const std::string &ui_name, const Rml::
 		*(it->second) = value;
 	}
 	SyncFromUI (ui_name);
-	MarkDirty ();
+	if (const CvarBinding *changed = GetBinding (ui_name))
+		DirtyBinding (*changed);
 }
 
 void CvarBindingManager::CycleEnum (const std::string &ui_name, int delta)
@@ -62,9 +62,12 @@ class CvarBindingManager
 	// Register a string cvar
 	static void RegisterString (const char *cvar, const char *ui_name);
 
-	// Sync all cvar values to UI (call when opening menu)
+	// Re-read all bound cvars, dirtying only the values that differ (call when opening menu)
 	static void SyncToUI ();
 
+	// Push cvars that changed since the last sync to the UI, call once per frame
+	static void Update ();
+
 	// Sync a specific UI value back to its cvar (call on UI change event)
 	static void SyncFromUI (const std::string &ui_name);
 
@@ -77,12 +80,6 @@ class CvarBindingManager
 	// Mark the data model as dirty (triggers UI update)
 	static void MarkDirty ();
 
-	// Suppress UI-originated change events during sync to avoid feedback loops.
-	static bool ShouldIgnoreUIChange ();
-
-	// Called after a UI update tick to clear any temporary suppression.
-	static void NotifyUIUpdateComplete ();
-
 	// Check if initialized
 	static bool IsInitialized ();
 
@@ -126,6 +123,11 @@ class CvarBindingManager
 	static void RegisterAllBindings ();
 	static void BindEnumLabel (const char *ui_name);
 
+	// cvar -> UI sync, force re-reads bindings whose change count didn't move
+	static void SyncChangedCvars (bool force);
+	static bool PullBinding (CvarBinding &binding);
+	static void DirtyBinding (const CvarBinding &binding);
+
 	// Common helpers to create-or-update a value pointer and bind it to the data model
 	static void BindOrUpdateInt (const char *ui_name, int value);
 	static void BindOrUpdateFloat (const char *ui_name, float value);
@@ -139,8 +141,7 @@ class CvarBindingManager
 	static std::unordered_map<std::string, std::unique_ptr<Rml::String>> s_string_values;
 	static bool															 s_initialized;
 	static ICvarProvider												*s_provider; // Injected cvar provider
-	static bool															 s_ignore_ui_changes;
-	static int															 s_ignore_ui_changes_frames;
+	static uint32_t														 s_synced_change_count;
 };
 
 } // namespace QRmlUI
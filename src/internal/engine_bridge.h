@@ -13,6 +13,10 @@
 #ifndef QRMLUI_ENGINE_BRIDGE_H
 #define QRMLUI_ENGINE_BRIDGE_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -93,11 +97,12 @@ extern "C"
 	 * pulling in engine headers. Layout must match exactly. */
 	typedef struct _fshandle_t
 	{
-		FILE *file;
-		int	  pak;	  /* is the file read from a pak */
-		long  start;  /* file or data start position */
-		long  length; /* file or data size */
-		long  pos;	  /* current position relative to start */
+		FILE				*file;
+		int					 pak;	 /* is the file read from a pak */
+		long				 start;	 /* file or data start position */
+		long				 length; /* file or data size */
+		long				 pos;	 /* current position relative to start */
+		const unsigned char *memory; /* file data if from a memory backed pak, file is NULL then */
 	} fshandle_t;
 
 	int COM_FOpenFile (const char *filename, FILE **file, unsigned int *path_id);
@@ -112,12 +117,92 @@ extern "C"
 extern __thread int file_from_pak;
 #endif
 
+	/* Read-only whole-file view. Points straight into a memory mapped
+	 * pak when possible, otherwise a private copy. Not '\0'-terminated.
+	 * Must be released with COM_FreeFileView. */
+	const unsigned char *COM_LoadFileView (const char *path, unsigned int *path_id, int *len);
+	void				 COM_FreeFileView (const unsigned char *view);
+
 	size_t FS_fread (void *ptr, size_t size, size_t nmemb, fshandle_t *fh);
 	int	   FS_fseek (fshandle_t *fh, long offset, int whence);
 	long   FS_ftell (fshandle_t *fh);
 	int	   FS_fclose (fshandle_t *fh);
 	long   FS_filelength (fshandle_t *fh);
 
+	/* ── Task system ──────────────────────────────────────────────────── */
+
+	/* Mirrored from tasks.h, the Task_AllocateAndAssign* helpers there
+	 * are static inline and not visible to C++. */
+	typedef uint64_t task_handle_t;
+	typedef void (*task_func_t) (void *);
+
+	task_handle_t Task_Allocate (void);
+	void		  Task_AssignFunc (task_handle_t handle, task_func_t func, void *payload, size_t payload_size);
+	void		  Task_Submit (task_handle_t handle);
+	int /*qboolean*/ Task_Join (task_handle_t handle, uint32_t timeout);
+
+/* TASK_TIMEOUT_INFINITE is SDL_MUTEX_MAXWAIT or -1 depending on the
+ * SDL version, both end up as all bits set in the uint32_t timeout. */
+#define QRMLUI_TASK_TIMEOUT_INFINITE UINT32_MAX
+
+	/* ── Staging uploads ──────────────────────────────────────────────── */
+
+	/* R_StagingAllocate returns with the staging mutex held. Record the
+	 * copy into command_buffer, then bracket the memcpy into the returned
+	 * memory with R_StagingBeginCopy/R_StagingEndCopy. The staging command
+	 * buffer is submitted ahead of the frame in GL_EndRenderingTask. */
+	unsigned char *R_StagingAllocate (int size, int alignment, VkCommandBuffer *command_buffer, VkBuffer *buffer, int *buffer_offset);
+	void		   R_StagingBeginCopy (void);
+	void		   R_StagingEndCopy (void);
+	void		   R_SubmitStagingBuffers (void);
+
+	/* ── Device memory ────────────────────────────────────────────────── */
+
+	/* Images are suballocated from the engine's texture heap, which returns
+	 * NULL if its memory type doesn't fit. Whatever else the pools need goes
+	 * through R_AllocateUIMemory, so vkmemstats and the device totals see it. */
+	typedef struct glheapallocation_s glheapallocation_t;
+	glheapallocation_t *TexMgr_AllocateExternal (const VkMemoryRequirements *memory_requirements, VkDeviceMemory *memory, VkDeviceSize *offset);
+	void				TexMgr_FreeExternal (glheapallocation_t *allocation, VkDeviceSize size);
+	VkDeviceMemory		R_AllocateUIMemory (VkDeviceSize size, uint32_t memory_type_index, bool /*qboolean*/ host);
+	void				R_FreeUIMemory (VkDeviceMemory memory, VkDeviceSize size, bool /*qboolean*/ host);
+
+	/* ── Memory accounting ────────────────────────────────────────────── */
+
+	/* Mirrored from mem.h, mem_tag_t is a plain enum and passes as int.
+	 * Mem_GetTagStats returns NULL past the last tag. Mem_LuaAlloc keeps
+	 * per-state totals in its userdata when it isn't NULL. */
+	typedef struct mem_lua_stats_s
+	{
+		size_t bytes;
+		size_t peak_bytes;
+	} mem_lua_stats_t;
+	int			Mem_SetTag (int tag);
+	void	   *Mem_LuaAlloc (void *ud, void *ptr, size_t osize, size_t nsize);
+	const char *Mem_GetTagStats (int tag, uint64_t *bytes, uint64_t *peak_bytes, uint64_t *allocations);
+
+#define QRMLUI_MEM_TAG_UI 6
+
+	/* ── Frame stats ring ─────────────────────────────────────────────── */
+
+	/* Mirrored from frame_stats.h, frame_stats_series_t is a plain enum and
+	 * passes as int, keep the order in sync. Values copied out are oldest
+	 * first and negative for frames that didn't measure them. */
+	int FrameStats_GetSeries (int series, float *values, int count);
+
+#define QRMLUI_FRAME_STATS_FRAME_MS	  0
+#define QRMLUI_FRAME_STATS_HOST_MS	  1
+#define QRMLUI_FRAME_STATS_SERVER_MS  2
+#define QRMLUI_FRAME_STATS_RENDER_MS  3
+#define QRMLUI_FRAME_STATS_UI_MS	  4
+#define QRMLUI_FRAME_STATS_GPU_MS	  5
+#define QRMLUI_FRAME_STATS_TASKS_BUSY 6
+#define QRMLUI_FRAME_STATS_NET_IN	  7
+#define QRMLUI_FRAME_STATS_NET_OUT	  8
+#define QRMLUI_FRAME_STATS_HEAP_MB	  9
+#define QRMLUI_FRAME_STATS_VRAM_MB	  10
+#define QRMLUI_FRAME_STATS_NUM_SERIES 11
+
 	/* ── Engine-side UI sync callbacks ────────────────────────────────── */
 	/* These are engine functions (guarded by USE_RMLUI in their source
 	 * files) that push data into the RmlUI layer on demand. */
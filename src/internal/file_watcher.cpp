@@ -0,0 +1,265 @@
+/*
+ * vkQuake RmlUI - File Watcher Implementation
+ *
+ * The watch thread never touches RmlUI or the engine, it only bumps a
+ * change counter that the main thread polls once per frame.
+ */
+
+#include "file_watcher.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace QRmlUI
+{
+
+FileWatcher::~FileWatcher ()
+{
+	Stop ();
+}
+
+void FileWatcher::Start (const std::vector<std::string> &directories)
+{
+	Stop ();
+
+	m_directories = directories;
+	SDL_AtomicSet (&m_stop, 0);
+	m_thread = SDL_CreateThread (ThreadMain, "UIFileWatcher", this);
+}
+
+void FileWatcher::Stop ()
+{
+	if (!m_thread)
+		return;
+	SDL_AtomicSet (&m_stop, 1);
+	SDL_WaitThread (m_thread, nullptr);
+	m_thread = nullptr;
+	m_pending = false;
+}
+
+bool FileWatcher::TakeChanges (double now)
+{
+	const int changes = SDL_AtomicGet (&m_changes);
+	if (changes != m_seen_changes)
+	{
+		m_seen_changes = changes;
+		m_pending = true;
+		m_last_change_time = now;
+		return false;
+	}
+	if (!m_pending || now - m_last_change_time < SETTLE_SECONDS)
+		return false;
+	m_pending = false;
+	return true;
+}
+
+int SDLCALL FileWatcher::ThreadMain (void *data)
+{
+	static_cast<FileWatcher *> (data)->Run ();
+	return 0;
+}
+
+void FileWatcher::NotifyChange ()
+{
+	SDL_AtomicAdd (&m_changes, 1);
+}
+
+void FileWatcher::Run ()
+{
+	// Falls back to scanning if the OS notification can't be set up
+	if (!RunNotify ())
+		RunScan ();
+}
+
+#if defined(__linux__)
+
+bool FileWatcher::RunNotify ()
+{
+	const int fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	// inotify is not recursive, every directory of the trees gets its own watch
+	const uint32_t						 mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+	std::unordered_map<int, std::string> watches;
+	auto								 add_watch = [&] (const std::string &directory)
+	{
+		const int wd = inotify_add_watch (fd, directory.c_str (), mask | IN_ONLYDIR);
+		if (wd >= 0)
+			watches[wd] = directory;
+	};
+	for (const std::string &directory : m_directories)
+	{
+		add_watch (directory);
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it (directory, error), end; !error && it != end; it.increment (error))
+			if (it->is_directory (error))
+				add_watch (it->path ().string ());
+	}
+	if (watches.empty ())
+	{
+		close (fd);
+		return false;
+	}
+
+	alignas (struct inotify_event) char buffer[4096];
+	while (!SDL_AtomicGet (&m_stop))
+	{
+		struct pollfd pfd = {fd, POLLIN, 0};
+		if (poll (&pfd, 1, WAIT_MS) <= 0)
+			continue;
+
+		ssize_t length;
+		while ((length = read (fd, buffer, sizeof (buffer))) > 0)
+		{
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const struct inotify_event *event = reinterpret_cast<const struct inotify_event *> (buffer + offset);
+				offset += sizeof (struct inotify_event) + event->len;
+
+				// New directories, e.g. from a checkout, are watched as well
+				if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)) && event->len > 0)
+				{
+					auto it = watches.find (event->wd);
+					if (it != watches.end ())
+						add_watch (it->second + "/" + event->name);
+				}
+				if (event->mask & IN_IGNORED)
+					watches.erase (event->wd);
+			}
+			NotifyChange ();
+		}
+	}
+
+	close (fd);
+	return true;
+}
+
+#elif defined(_WIN32)
+
+bool FileWatcher::RunNotify ()
+{
+	// One overlapped ReadDirectoryChangesW per tree. The notifications themselves are not
+	// parsed, an overflowing buffer still completes the read.
+	struct Watch
+	{
+		HANDLE	   directory;
+		OVERLAPPED overlapped;
+		DWORD	   buffer[1024];
+	};
+	const DWORD		   filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+	std::vector<Watch> watches (m_directories.size ());
+	std::vector<HANDLE> events;
+	auto				issue = [&] (Watch &watch)
+	{ return ReadDirectoryChangesW (watch.directory, watch.buffer, sizeof (watch.buffer), TRUE, filter, nullptr, &watch.overlapped, nullptr) != 0; };
+
+	size_t num_watches = 0;
+	for (const std::string &directory : m_directories)
+	{
+		Watch &watch = watches[num_watches];
+		watch.directory = CreateFileW (
+			std::filesystem::u8path (directory).c_str (), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (watch.directory == INVALID_HANDLE_VALUE)
+			continue;
+		ZeroMemory (&watch.overlapped, sizeof (watch.overlapped));
+		watch.overlapped.hEvent = CreateEventW (nullptr, TRUE, FALSE, nullptr);
+		if (!watch.overlapped.hEvent || !issue (watch))
+		{
+			if (watch.overlapped.hEvent)
+				CloseHandle (watch.overlapped.hEvent);
+			CloseHandle (watch.directory);
+			continue;
+		}
+		events.push_back (watch.overlapped.hEvent);
+		num_watches++;
+	}
+	if (num_watches == 0)
+		return false;
+
+	while (!SDL_AtomicGet (&m_stop))
+	{
+		const DWORD result = WaitForMultipleObjects (static_cast<DWORD> (num_watches), events.data (), FALSE, WAIT_MS);
+		if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + num_watches)
+			continue;
+
+		Watch &watch = watches[result - WAIT_OBJECT_0];
+		DWORD  transferred;
+		GetOverlappedResult (watch.directory, &watch.overlapped, &transferred, FALSE);
+		ResetEvent (watch.overlapped.hEvent);
+		issue (watch);
+		NotifyChange ();
+	}
+
+	for (size_t i = 0; i < num_watches; ++i)
+	{
+		CancelIoEx (watches[i].directory, &watches[i].overlapped);
+		GetOverlappedResult (watches[i].directory, &watches[i].overlapped, nullptr, TRUE);
+		CloseHandle (watches[i].overlapped.hEvent);
+		CloseHandle (watches[i].directory);
+	}
+	return true;
+}
+
+#else
+
+bool FileWatcher::RunNotify ()
+{
+	return false;
+}
+
+#endif
+
+void FileWatcher::RunScan ()
+{
+	// Hash of every path, size and modification time in the trees
+	auto scan = [this] ()
+	{
+		uint64_t hash = 14695981039346656037ull; // FNV-1a
+		auto	 mix = [&hash] (const void *data, size_t size)
+		{
+			for (size_t i = 0; i < size; ++i)
+				hash = (hash ^ static_cast<const unsigned char *> (data)[i]) * 1099511628211ull;
+		};
+		for (const std::string &directory : m_directories)
+		{
+			std::error_code error;
+			for (std::filesystem::recursive_directory_iterator it (directory, error), end; !error && it != end; it.increment (error))
+			{
+				const std::string path = it->path ().string ();
+				const auto		  time = it->last_write_time (error).time_since_epoch ().count ();
+				const uintmax_t	  size = it->is_regular_file (error) ? it->file_size (error) : 0;
+				mix (path.data (), path.size ());
+				mix (&time, sizeof (time));
+				mix (&size, sizeof (size));
+			}
+		}
+		return hash;
+	};
+
+	uint64_t last = scan ();
+	while (!SDL_AtomicGet (&m_stop))
+	{
+		for (int waited = 0; waited < SCAN_MS && !SDL_AtomicGet (&m_stop); waited += WAIT_MS)
+			SDL_Delay (WAIT_MS);
+		const uint64_t current = scan ();
+		if (current != last)
+		{
+			last = current;
+			NotifyChange ();
+		}
+	}
+}
+
+} // namespace QRmlUI
@@ -0,0 +1,70 @@
+/*
+ * vkQuake RmlUI - File Watcher
+ *
+ * Watches directory trees for changes on a background thread, with inotify
+ * on Linux, ReadDirectoryChangesW on Windows and a modification time scan
+ * everywhere else. It only tells that something changed: the file
+ * interface's stamps tell which of the opened UI files it was.
+ */
+
+#ifndef QRMLUI_FILE_WATCHER_H
+#define QRMLUI_FILE_WATCHER_H
+
+#include <SDL.h>
+
+#include <string>
+#include <vector>
+
+namespace QRmlUI
+{
+
+class FileWatcher
+{
+  public:
+	FileWatcher () = default;
+	FileWatcher (const FileWatcher &) = delete;
+	FileWatcher &operator= (const FileWatcher &) = delete;
+	~FileWatcher ();
+
+	// Starts watching the directory trees, replacing an earlier set. Directories that
+	// don't exist are ignored.
+	void Start (const std::vector<std::string> &directories);
+	void Stop ();
+	bool IsRunning () const
+	{
+		return m_thread != nullptr;
+	}
+	const std::vector<std::string> &GetDirectories () const
+	{
+		return m_directories;
+	}
+
+	// True once per burst of changes, when nothing changed for SETTLE_SECONDS.
+	// Editors save in several steps, this keeps them to one reload.
+	bool TakeChanges (double now);
+
+  private:
+	static constexpr double SETTLE_SECONDS = 0.15;
+	static constexpr int	WAIT_MS = 200;	// stop latency of the watch thread
+	static constexpr int	SCAN_MS = 500;	// interval of the modification time scan
+
+	static int SDLCALL ThreadMain (void *data);
+	void			   Run ();
+	bool			   RunNotify ();
+	void			   RunScan ();
+	void			   NotifyChange ();
+
+	std::vector<std::string> m_directories;
+	SDL_Thread				*m_thread = nullptr;
+	SDL_atomic_t			 m_stop{};
+	SDL_atomic_t			 m_changes{}; // bumped by the watch thread
+
+	// Main thread only
+	int	   m_seen_changes = 0;
+	bool   m_pending = false;
+	double m_last_change_time = 0.0;
+};
+
+} // namespace QRmlUI
+
+#endif /* QRMLUI_FILE_WATCHER_H */
@@ -8,6 +8,9 @@
 #include "cvar_binding.h"
 #include "menu_event_handler.h"
 #include "notification_model.h"
+#include "perf_overlay.h"
+#include "spike_trace.h"
+#include "virtual_list.h"
 
 #include "quake_stats.h"
 
@@ -63,12 +66,12 @@ static int ResolveReticleStyle (int active_weapon, ICvarProvider *provider)
 }
 
 // Global game state
-GameState g_game_state;
+GameState	  g_game_state;
+GameStateMask g_game_state_changes = 0;
 
 // Static members
 Rml::DataModelHandle GameDataModel::s_model_handle;
 bool				 GameDataModel::s_initialized = false;
-GameState			 GameDataModel::s_prev_state;
 bool				 GameDataModel::s_first_update = true;
 Rml::String			 GameDataModel::s_prev_gamedir;
 bool				 GameDataModel::s_was_chatting = false;
@@ -82,6 +85,44 @@ static int				s_prev_active_weapon = 0;
 static constexpr double WEAPON_SHOW_DURATION = 0.15;
 static constexpr double FIRE_FLASH_DURATION = 0.30;
 
+// Engine memory accounting (mem.h tags), sampled for the memory debug document
+struct MemTagInfo
+{
+	std::string name;
+	int			kib = 0;
+	int			peak_kib = 0;
+	int			blocks = 0;
+};
+
+static std::vector<MemTagInfo> s_mem_tags;
+static int					   s_mem_total_kib = 0;
+static double				   s_mem_sample_time = 0.0;
+static constexpr double		   MEM_SAMPLE_INTERVAL = 0.5;
+
+// Mods menu rows in view, the window of g_game_state.mods its <virtual-list> shows
+static std::vector<ModInfo>			s_mods_window;
+static std::unique_ptr<VirtualList>	s_mods_list;
+
+static void SampleMemTags ()
+{
+	s_mem_tags.clear ();
+	s_mem_total_kib = 0;
+	uint64_t bytes, peak_bytes, allocations;
+	for (int tag = 0;; ++tag)
+	{
+		const char *name = Mem_GetTagStats (tag, &bytes, &peak_bytes, &allocations);
+		if (!name)
+			break;
+		MemTagInfo info;
+		info.name = name;
+		info.kib = static_cast<int> (bytes / 1024);
+		info.peak_kib = static_cast<int> (peak_bytes / 1024);
+		info.blocks = static_cast<int> (allocations);
+		s_mem_total_kib += info.kib;
+		s_mem_tags.push_back (std::move (info));
+	}
+}
+
 bool GameDataModel::Initialize (Rml::Context *context)
 {
 	if (s_initialized)
@@ -155,7 +196,8 @@ bool GameDataModel::Initialize (Rml::Context *context)
 	constructor.Bind ("deathmatch", &g_game_state.deathmatch);
 	constructor.Bind ("coop", &g_game_state.coop);
 
-	// Bind level info
+	// Bind level info, converted to a string only when the data model evaluates it
+	constructor.RegisterScalar<LevelString> ([] (const LevelString &value, Rml::Variant &variant) { variant = Rml::String (value.c_str ()); });
 	constructor.Bind ("level_name", &g_game_state.level_name);
 	constructor.Bind ("map_name", &g_game_state.map_name);
 
@@ -345,9 +387,20 @@ bool GameDataModel::Initialize (Rml::Context *context)
 	}
 	constructor.RegisterArray<std::vector<ModInfo>> ();
 
-	// Bind mod list and count
+	// Bind mod list and count. The menu binds mods_window, a copy of the rows its
+	// <virtual-list source="mods"> has in view.
 	constructor.Bind ("mods", &g_game_state.mods);
+	constructor.Bind ("mods_window", &s_mods_window);
 	constructor.Bind ("num_mods", &g_game_state.num_mods);
+	s_mods_list = std::make_unique<VirtualList> (
+		"mods",
+		[] (int first, int count)
+		{
+			s_mods_window.assign (g_game_state.mods.begin () + first, g_game_state.mods.begin () + first + count);
+			if (s_model_handle)
+				s_model_handle.DirtyVariable ("mods_window");
+		});
+	s_mods_list->SetSize (static_cast<int> (g_game_state.mods.size ()));
 
 	// Event callback: load a mod
 	constructor.BindEventCallback (
@@ -363,13 +416,28 @@ bool GameDataModel::Initialize (Rml::Context *context)
 			MenuEventHandler::ProcessAction ("load_mod('" + std::string (mod_name.c_str ()) + "')");
 		});
 
+	// Register MemTagInfo struct type for the memory debug document
+	if (auto mem_handle = constructor.RegisterStruct<MemTagInfo> ())
+	{
+		mem_handle.RegisterMember ("name", &MemTagInfo::name);
+		mem_handle.RegisterMember ("kib", &MemTagInfo::kib);
+		mem_handle.RegisterMember ("peak_kib", &MemTagInfo::peak_kib);
+		mem_handle.RegisterMember ("blocks", &MemTagInfo::blocks);
+	}
+	constructor.RegisterArray<std::vector<MemTagInfo>> ();
+
+	constructor.Bind ("mem_tags", &s_mem_tags);
+	constructor.Bind ("mem_total_kib", &s_mem_total_kib);
+
 	// Register notification bindings on the same "game" model
 	NotificationModel::RegisterBindings (constructor);
+	PerfOverlay::RegisterBindings (constructor);
 
 	s_model_handle = constructor.GetModelHandle ();
 
 	// Share the model handle with NotificationModel for selective dirtying
 	NotificationModel::SetModelHandle (s_model_handle);
+	PerfOverlay::SetModelHandle (s_model_handle);
 
 	s_initialized = true;
 
@@ -383,16 +451,21 @@ void GameDataModel::Shutdown ()
 		return;
 
 	NotificationModel::Shutdown ();
+	PerfOverlay::Shutdown ();
 
 	// RmlUI handles cleanup when context is destroyed
 	s_model_handle = Rml::DataModelHandle ();
 	s_initialized = false;
 
 	// Reset diff-tracking state so reinit starts clean
-	s_prev_state = GameState{};
 	s_first_update = true;
 	s_prev_gamedir.clear ();
 	s_was_chatting = false;
+	s_mem_tags.clear ();
+	s_mem_total_kib = 0;
+	s_mem_sample_time = 0.0;
+	s_mods_list.reset ();
+	s_mods_window.clear ();
 
 	Con_DPrintf ("GameDataModel: Shutdown\n");
 }
@@ -402,103 +475,43 @@ void GameDataModel::Update ()
 	if (!s_initialized || !s_model_handle)
 		return;
 
-	// Compare current state against cached previous state.
-	// Only dirty variables that actually changed to avoid per-frame churn.
+	// Expire transient reticle animation flags
+	if (g_game_state.weapon_show && realtime - s_weapon_show_time > WEAPON_SHOW_DURATION)
+		UpdateGameStateField (g_game_state.weapon_show, false, GameStateField::weapon_show, g_game_state_changes);
+	if (g_game_state.fire_flash && realtime - s_fire_flash_time > FIRE_FLASH_DURATION)
+		UpdateGameStateField (g_game_state.fire_flash, false, GameStateField::fire_flash, g_game_state_changes);
+
 	if (s_first_update)
 	{
 		s_first_update = false;
 		s_model_handle.DirtyAllVariables ();
-		s_prev_state = g_game_state;
+		SpikeTrace::NoteDirty ("game.*");
 		return;
 	}
 
-	bool any_dirty = false;
-
-#define DIRTY_IF_CHANGED(field, name)             \
-	if (g_game_state.field != s_prev_state.field) \
-	{                                             \
-		s_model_handle.DirtyVariable (name);      \
-		any_dirty = true;                         \
-	}
-
-	// Core stats
-	DIRTY_IF_CHANGED (health, "health")
-	DIRTY_IF_CHANGED (armor, "armor")
-	DIRTY_IF_CHANGED (ammo, "ammo")
-	DIRTY_IF_CHANGED (active_weapon, "active_weapon")
-
-	// When active_weapon changes, computed funcs also need re-eval
-	if (g_game_state.active_weapon != s_prev_state.active_weapon)
+	// Only dirty variables that were written with a new value to avoid per-frame churn
+	const GameStateMask changes = g_game_state_changes;
+	if (changes != 0)
 	{
-		s_model_handle.DirtyVariable ("weapon_label");
-		s_model_handle.DirtyVariable ("ammo_type_label");
-		s_model_handle.DirtyVariable ("is_axe");
-		s_model_handle.DirtyVariable ("is_shells_weapon");
-		s_model_handle.DirtyVariable ("is_nails_weapon");
-		s_model_handle.DirtyVariable ("is_rockets_weapon");
-		s_model_handle.DirtyVariable ("is_cells_weapon");
-	}
+		for (uint32_t i = 0; i < static_cast<uint32_t> (GameStateField::Count); ++i)
+			if (changes & GameStateBit (static_cast<GameStateField> (i)))
+			{
+				s_model_handle.DirtyVariable (kGameStateFieldNames[i]);
+				SpikeTrace::NoteDirty (kGameStateFieldNames[i]);
+			}
 
-	// Ammo counts
-	DIRTY_IF_CHANGED (shells, "shells")
-	DIRTY_IF_CHANGED (nails, "nails")
-	DIRTY_IF_CHANGED (rockets, "rockets")
-	DIRTY_IF_CHANGED (cells, "cells")
-
-	// Level statistics
-	DIRTY_IF_CHANGED (monsters, "monsters")
-	DIRTY_IF_CHANGED (total_monsters, "total_monsters")
-	DIRTY_IF_CHANGED (secrets, "secrets")
-	DIRTY_IF_CHANGED (total_secrets, "total_secrets")
-
-	// Weapons owned
-	DIRTY_IF_CHANGED (has_shotgun, "has_shotgun")
-	DIRTY_IF_CHANGED (has_super_shotgun, "has_super_shotgun")
-	DIRTY_IF_CHANGED (has_nailgun, "has_nailgun")
-	DIRTY_IF_CHANGED (has_super_nailgun, "has_super_nailgun")
-	DIRTY_IF_CHANGED (has_grenade_launcher, "has_grenade_launcher")
-	DIRTY_IF_CHANGED (has_rocket_launcher, "has_rocket_launcher")
-	DIRTY_IF_CHANGED (has_lightning_gun, "has_lightning_gun")
-
-	// Keys
-	DIRTY_IF_CHANGED (has_key1, "has_key1")
-	DIRTY_IF_CHANGED (has_key2, "has_key2")
-
-	// Powerups
-	DIRTY_IF_CHANGED (has_invisibility, "has_invisibility")
-	DIRTY_IF_CHANGED (has_invulnerability, "has_invulnerability")
-	DIRTY_IF_CHANGED (has_suit, "has_suit")
-	DIRTY_IF_CHANGED (has_quad, "has_quad")
-
-	// Sigils
-	DIRTY_IF_CHANGED (has_sigil1, "has_sigil1")
-	DIRTY_IF_CHANGED (has_sigil2, "has_sigil2")
-	DIRTY_IF_CHANGED (has_sigil3, "has_sigil3")
-	DIRTY_IF_CHANGED (has_sigil4, "has_sigil4")
-
-	// Armor type
-	DIRTY_IF_CHANGED (armor_type, "armor_type")
-
-	// Game state flags
-	DIRTY_IF_CHANGED (intermission, "intermission")
-	DIRTY_IF_CHANGED (intermission_type, "intermission_type")
-	DIRTY_IF_CHANGED (deathmatch, "deathmatch")
-	DIRTY_IF_CHANGED (coop, "coop")
-
-	// Level info (string comparison)
-	DIRTY_IF_CHANGED (level_name, "level_name")
-	DIRTY_IF_CHANGED (map_name, "map_name")
-
-	// Time
-	DIRTY_IF_CHANGED (time_minutes, "time_minutes")
-	DIRTY_IF_CHANGED (time_seconds, "time_seconds")
-
-	// Face state
-	DIRTY_IF_CHANGED (face_index, "face_index")
-	DIRTY_IF_CHANGED (face_pain, "face_pain")
-
-	// Reticle (crosshair)
-	DIRTY_IF_CHANGED (reticle_style, "reticle_style")
+		// When active_weapon changes, computed funcs also need re-eval
+		if (changes & GameStateBit (GameStateField::active_weapon))
+		{
+			s_model_handle.DirtyVariable ("weapon_label");
+			s_model_handle.DirtyVariable ("ammo_type_label");
+			s_model_handle.DirtyVariable ("is_axe");
+			s_model_handle.DirtyVariable ("is_shells_weapon");
+			s_model_handle.DirtyVariable ("is_nails_weapon");
+			s_model_handle.DirtyVariable ("is_rockets_weapon");
+			s_model_handle.DirtyVariable ("is_cells_weapon");
+		}
+	}
 
 	// Chat input (dirty every frame while active, plus one frame after close)
 	{
@@ -508,45 +521,31 @@ void GameDataModel::Update ()
 			s_model_handle.DirtyVariable ("chat_active");
 			s_model_handle.DirtyVariable ("chat_prefix");
 			s_model_handle.DirtyVariable ("chat_text");
-			any_dirty = true;
+			SpikeTrace::NoteDirty ("chat");
 		}
 		s_was_chatting = is_chatting;
 	}
 
-	// Player list (compare count; full array dirtied on any change)
-	DIRTY_IF_CHANGED (num_players, "num_players")
-	if (g_game_state.num_players != s_prev_state.num_players || g_game_state.players != s_prev_state.players)
-	{
-		s_model_handle.DirtyVariable ("players");
-		any_dirty = true;
-	}
-
 	// Game title (gamedir-backed — track changes for mod switch)
 	{
 		const char *g = COM_GetGameNames (0);
-		Rml::String cur_gamedir (g ? g : "");
-		if (cur_gamedir != s_prev_gamedir)
+		const char *cur_gamedir = g ? g : "";
+		if (s_prev_gamedir != cur_gamedir)
 		{
 			s_model_handle.DirtyVariable ("game_title");
+			SpikeTrace::NoteDirty ("game_title");
 			s_prev_gamedir = cur_gamedir;
-			any_dirty = true;
 		}
 	}
 
-	// Expire transient reticle animation flags
-	if (g_game_state.weapon_show && realtime - s_weapon_show_time > WEAPON_SHOW_DURATION)
-		g_game_state.weapon_show = false;
-	if (g_game_state.fire_flash && realtime - s_fire_flash_time > FIRE_FLASH_DURATION)
-		g_game_state.fire_flash = false;
-
-	DIRTY_IF_CHANGED (weapon_show, "weapon_show")
-	DIRTY_IF_CHANGED (fire_flash, "fire_flash")
-	DIRTY_IF_CHANGED (weapon_firing, "weapon_firing")
-
-#undef DIRTY_IF_CHANGED
-
-	(void)any_dirty;
-	s_prev_state = g_game_state;
+	// Memory accounting, a few times a second is plenty for watching growth
+	if (realtime - s_mem_sample_time >= MEM_SAMPLE_INTERVAL)
+	{
+		s_mem_sample_time = realtime;
+		SampleMemTags ();
+		s_model_handle.DirtyVariable ("mem_tags");
+		s_model_handle.DirtyVariable ("mem_total_kib");
+	}
 }
 
 void GameDataModel::MarkAllDirty ()
@@ -554,6 +553,13 @@ void GameDataModel::MarkAllDirty ()
 	if (!s_initialized || !s_model_handle)
 		return;
 	s_model_handle.DirtyAllVariables ();
+	SpikeTrace::NoteDirty ("game.*");
+}
+
+void GameDataModel::RefreshMods ()
+{
+	if (s_mods_list)
+		s_mods_list->SetSize (static_cast<int> (g_game_state.mods.size ()));
 }
 
 void GameDataModel::ResetTransients ()
@@ -599,102 +605,107 @@ extern "C"
 	}
 
 	void GameDataModel_SyncFromQuake (
-		const int *stats, int stats_count, int items, int intermission, int gametype, int maxclients, const char *level_name, const char *map_name,
-		double game_time)
+		const int *stats, int stats_count, unsigned int stats_changed, int items, int intermission, int gametype, int maxclients, const char *level_name,
+		const char *map_name, double game_time)
 	{
 		using namespace QRmlUI;
 
 		if (!stats || stats_count < STAT_ITEMS + 1)
 			return;
 
-		// Sync core stats
-		g_game_state.health = stats[STAT_HEALTH];
-		g_game_state.armor = stats[STAT_ARMOR];
-		g_game_state.ammo = stats[STAT_AMMO];
-		g_game_state.active_weapon = stats[STAT_ACTIVEWEAPON];
+#define SYNC_FIELD(field, value) UpdateGameStateField (g_game_state.field, value, GameStateField::field, g_game_state_changes)
+#define SYNC_STAT(field, stat)        \
+	if (stats_changed & (1u << stat)) \
+		SYNC_FIELD (field, stats[stat])
+
+		// Sync core stats, only the ones the client changed since the last sync
+		SYNC_STAT (health, STAT_HEALTH);
+		SYNC_STAT (armor, STAT_ARMOR);
+		SYNC_STAT (ammo, STAT_AMMO);
+		SYNC_STAT (active_weapon, STAT_ACTIVEWEAPON);
 
 		// Sync ammo counts
-		g_game_state.shells = stats[STAT_SHELLS];
-		g_game_state.nails = stats[STAT_NAILS];
-		g_game_state.rockets = stats[STAT_ROCKETS];
-		g_game_state.cells = stats[STAT_CELLS];
+		SYNC_STAT (shells, STAT_SHELLS);
+		SYNC_STAT (nails, STAT_NAILS);
+		SYNC_STAT (rockets, STAT_ROCKETS);
+		SYNC_STAT (cells, STAT_CELLS);
 
 		// Sync level statistics
-		g_game_state.monsters = stats[STAT_MONSTERS];
-		g_game_state.total_monsters = stats[STAT_TOTALMONSTERS];
-		g_game_state.secrets = stats[STAT_SECRETS];
-		g_game_state.total_secrets = stats[STAT_TOTALSECRETS];
+		SYNC_STAT (monsters, STAT_MONSTERS);
+		SYNC_STAT (total_monsters, STAT_TOTALMONSTERS);
+		SYNC_STAT (secrets, STAT_SECRETS);
+		SYNC_STAT (total_secrets, STAT_TOTALSECRETS);
 
 		// Decode item bitflags for weapons
-		g_game_state.has_shotgun = (items & IT_SHOTGUN) != 0;
-		g_game_state.has_super_shotgun = (items & IT_SUPER_SHOTGUN) != 0;
-		g_game_state.has_nailgun = (items & IT_NAILGUN) != 0;
-		g_game_state.has_super_nailgun = (items & IT_SUPER_NAILGUN) != 0;
-		g_game_state.has_grenade_launcher = (items & IT_GRENADE_LAUNCHER) != 0;
-		g_game_state.has_rocket_launcher = (items & IT_ROCKET_LAUNCHER) != 0;
-		g_game_state.has_lightning_gun = (items & IT_LIGHTNING) != 0;
+		SYNC_FIELD (has_shotgun, (items & IT_SHOTGUN) != 0);
+		SYNC_FIELD (has_super_shotgun, (items & IT_SUPER_SHOTGUN) != 0);
+		SYNC_FIELD (has_nailgun, (items & IT_NAILGUN) != 0);
+		SYNC_FIELD (has_super_nailgun, (items & IT_SUPER_NAILGUN) != 0);
+		SYNC_FIELD (has_grenade_launcher, (items & IT_GRENADE_LAUNCHER) != 0);
+		SYNC_FIELD (has_rocket_launcher, (items & IT_ROCKET_LAUNCHER) != 0);
+		SYNC_FIELD (has_lightning_gun, (items & IT_LIGHTNING) != 0);
 
 		// Decode keys
-		g_game_state.has_key1 = (items & IT_KEY1) != 0;
-		g_game_state.has_key2 = (items & IT_KEY2) != 0;
+		SYNC_FIELD (has_key1, (items & IT_KEY1) != 0);
+		SYNC_FIELD (has_key2, (items & IT_KEY2) != 0);
 
 		// Decode powerups
-		g_game_state.has_invisibility = (items & IT_INVISIBILITY) != 0;
-		g_game_state.has_invulnerability = (items & IT_INVULNERABILITY) != 0;
-		g_game_state.has_suit = (items & IT_SUIT) != 0;
-		g_game_state.has_quad = (items & IT_QUAD) != 0;
+		SYNC_FIELD (has_invisibility, (items & IT_INVISIBILITY) != 0);
+		SYNC_FIELD (has_invulnerability, (items & IT_INVULNERABILITY) != 0);
+		SYNC_FIELD (has_suit, (items & IT_SUIT) != 0);
+		SYNC_FIELD (has_quad, (items & IT_QUAD) != 0);
 
 		// Decode sigils
-		g_game_state.has_sigil1 = (items & IT_SIGIL1) != 0;
-		g_game_state.has_sigil2 = (items & IT_SIGIL2) != 0;
-		g_game_state.has_sigil3 = (items & IT_SIGIL3) != 0;
-		g_game_state.has_sigil4 = (items & IT_SIGIL4) != 0;
+		SYNC_FIELD (has_sigil1, (items & IT_SIGIL1) != 0);
+		SYNC_FIELD (has_sigil2, (items & IT_SIGIL2) != 0);
+		SYNC_FIELD (has_sigil3, (items & IT_SIGIL3) != 0);
+		SYNC_FIELD (has_sigil4, (items & IT_SIGIL4) != 0);
 
 		// Determine armor type from items
 		if (items & IT_ARMOR3)
 		{
-			g_game_state.armor_type = 3; // Red
+			SYNC_FIELD (armor_type, 3); // Red
 		}
 		else if (items & IT_ARMOR2)
 		{
-			g_game_state.armor_type = 2; // Yellow
+			SYNC_FIELD (armor_type, 2); // Yellow
 		}
 		else if (items & IT_ARMOR1)
 		{
-			g_game_state.armor_type = 1; // Green
+			SYNC_FIELD (armor_type, 1); // Green
 		}
 		else
 		{
-			g_game_state.armor_type = 0; // None
+			SYNC_FIELD (armor_type, 0); // None
 		}
 
 		// Game state
-		g_game_state.intermission = (intermission != 0);
-		g_game_state.intermission_type = intermission;
-		g_game_state.deathmatch = (gametype != 0);
-		g_game_state.coop = (gametype == 0 && maxclients > 1);
+		SYNC_FIELD (intermission, (intermission != 0));
+		SYNC_FIELD (intermission_type, intermission);
+		SYNC_FIELD (deathmatch, (gametype != 0));
+		SYNC_FIELD (coop, (gametype == 0 && maxclients > 1));
 
 		// Level info
 		if (level_name)
 		{
-			g_game_state.level_name = level_name;
+			SYNC_FIELD (level_name, level_name);
 		}
 		if (map_name)
 		{
-			g_game_state.map_name = map_name;
+			SYNC_FIELD (map_name, map_name);
 		}
 
 		// Time calculation
 		int total_seconds = static_cast<int> (game_time);
-		g_game_state.time_minutes = total_seconds / 60;
-		g_game_state.time_seconds = total_seconds % 60;
+		SYNC_FIELD (time_minutes, total_seconds / 60);
+		SYNC_FIELD (time_seconds, total_seconds % 60);
 
 		// Detect damage taken (health decreased since last sync).
 		// Threshold of 2 HP filters out megahealth decay (1 HP/sec tick-down)
 		// while catching real damage (minimum 5 HP in Quake).
 		{
 			int drop = s_prev_health - g_game_state.health;
-			g_game_state.face_pain = (drop >= 2 && s_prev_health > 0);
+			SYNC_FIELD (face_pain, (drop >= 2 && s_prev_health > 0));
 			s_prev_health = g_game_state.health;
 		}
 
@@ -702,7 +713,7 @@ extern "C"
 		{
 			if (g_game_state.active_weapon != s_prev_active_weapon && s_prev_active_weapon != 0)
 			{
-				g_game_state.weapon_show = true;
+				SYNC_FIELD (weapon_show, true);
 				s_weapon_show_time = realtime;
 			}
 			s_prev_active_weapon = g_game_state.active_weapon;
@@ -713,38 +724,41 @@ extern "C"
 			int wf = (stats_count > STAT_WEAPONFRAME) ? stats[STAT_WEAPONFRAME] : 0;
 			if (wf != 0 && s_prev_weaponframe == 0)
 			{
-				g_game_state.fire_flash = true;
+				SYNC_FIELD (fire_flash, true);
 				s_fire_flash_time = realtime;
 			}
-			g_game_state.weapon_firing = (wf != 0);
+			SYNC_FIELD (weapon_firing, (wf != 0));
 			s_prev_weaponframe = wf;
 		}
 
 		// Resolve reticle style from crosshair cvar + per-weapon overrides
-		g_game_state.reticle_style = ResolveReticleStyle (g_game_state.active_weapon, CvarBindingManager::GetProvider ());
+		SYNC_FIELD (reticle_style, ResolveReticleStyle (g_game_state.active_weapon, CvarBindingManager::GetProvider ()));
 
 		// Calculate face index based on health
 		int health = g_game_state.health;
 		if (health >= 100)
 		{
-			g_game_state.face_index = 4;
+			SYNC_FIELD (face_index, 4);
 		}
 		else if (health >= 80)
 		{
-			g_game_state.face_index = 3;
+			SYNC_FIELD (face_index, 3);
 		}
 		else if (health >= 60)
 		{
-			g_game_state.face_index = 2;
+			SYNC_FIELD (face_index, 2);
 		}
 		else if (health >= 40)
 		{
-			g_game_state.face_index = 1;
+			SYNC_FIELD (face_index, 1);
 		}
 		else
 		{
-			g_game_state.face_index = 0;
+			SYNC_FIELD (face_index, 0);
 		}
+
+#undef SYNC_STAT
+#undef SYNC_FIELD
 	}
 
 } // extern "C"
@@ -24,6 +24,11 @@ namespace QRmlUI
 // Global game state that gets synced each frame
 extern GameState g_game_state;
 
+// Fields of g_game_state written with a new value since the last UI_Update().
+// Writers flag them with UpdateGameStateField(), UI_Update() clears the mask
+// once GameDataModel and LuaBridge have both seen it.
+extern GameStateMask g_game_state_changes;
+
 class GameDataModel
 {
   public:
@@ -41,6 +46,9 @@ class GameDataModel
 	// Force a dirty check on all variables (call after level load)
 	static void MarkAllDirty ();
 
+	// Rebind the mods menu's visible rows after g_game_state.mods changed
+	static void RefreshMods ();
+
 	// Reset transient animation state (call on disconnect)
 	static void ResetTransients ();
 
@@ -50,7 +58,6 @@ class GameDataModel
   private:
 	static Rml::DataModelHandle s_model_handle;
 	static bool					s_initialized;
-	static GameState			s_prev_state;
 	static bool					s_first_update;
 	static Rml::String			s_prev_gamedir;
 	static bool					s_was_chatting;
@@ -78,12 +85,13 @@ extern "C"
 
 	// Sync from Quake's game state
 	// stats: pointer to cl.stats[] array (MAX_CL_STATS ints)
+	// stats_changed: cl.statsdirty, a bit per stat below 32 written since the last sync
 	// items: cl.items bitfield
 	// gametype: cl.gametype (GAME_COOP=0, GAME_DEATHMATCH=1)
 	// maxclients: cl.maxclients (1=SP, >1=multiplayer)
 	void GameDataModel_SyncFromQuake (
-		const int *stats, int stats_count, int items, int intermission, int gametype, int maxclients, const char *level_name, const char *map_name,
-		double game_time);
+		const int *stats, int stats_count, unsigned int stats_changed, int items, int intermission, int gametype, int maxclients, const char *level_name,
+		const char *map_name, double game_time);
 
 #ifdef __cplusplus
 }
@@ -5,6 +5,9 @@
  *   game   — read-only proxy over a backing table, refreshed each frame
  *   engine — exec(), cvar_get(), cvar_get_number(), cvar_set(), time()
  *
+ * engine.on_frame callbacks are run by a scheduler with a per-frame time
+ * budget and may suspend themselves with engine.wait()/engine.yield().
+ *
  * The 'game' table uses a metatable proxy so scripts can read fields
  * (game.health, game.weapon_label) but writes raise a Lua error.
  */
@@ -22,7 +25,9 @@
 #include <RmlUi/Lua/IncludeLua.h>
 #include <RmlUi/Lua/Interpreter.h>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace QRmlUI
 {
@@ -34,6 +39,13 @@ static lua_State *s_lua = nullptr;
 // Registry reference to the backing table behind the 'game' proxy.
 static int s_game_backing_ref = LUA_NOREF;
 
+// Backing table state, only fields that changed are written again
+static bool		   s_game_synced = false;
+static bool		   s_prev_chat_active = false;
+static int		   s_prev_chat_team = 0;
+static std::string s_prev_game_title;
+static std::string s_prev_chat_text;
+
 // ── engine.* C functions ────────────────────────────────────────────
 
 static int l_engine_exec (lua_State *L)
@@ -79,15 +91,130 @@ static int l_engine_hud_visible (lua_State *L)
 	return 1;
 }
 
+// ── Frame callback scheduler ────────────────────────────────────────
+//
+// Every engine.on_frame callback runs as a coroutine on a thread of its own that is
+// reused between calls. A callback that calls engine.wait()/engine.yield() is
+// resumed where it left off instead of being called again. All callbacks of a
+// frame share ui_lua_budget milliseconds, the ones that did not fit run first on
+// the next frame.
+
+struct FrameCallback
+{
+	std::string name;
+	int			func_ref = LUA_NOREF;
+	int			thread_ref = LUA_NOREF;
+	lua_State  *thread = nullptr;
+	bool		suspended = false; // yielded, resume the thread instead of calling func_ref
+	bool		restart = false;   // replaced or failed while running, drop the thread afterwards
+	double		wake_time = 0.0;   // realtime at which a suspended callback is resumed
+
+	// Cost since the last PrintCallbackStats()
+	double	 sum_ms = 0.0;
+	double	 worst_ms = 0.0;
+	uint32_t calls = 0;
+};
+
+static std::vector<FrameCallback> s_frame_callbacks;
+static size_t					  s_next_frame_callback = 0; // first callback of the next frame
+static size_t					  s_running_callback = SIZE_MAX;
+static lua_State				 *s_running_thread = nullptr;
+static uint32_t					  s_deferred_callbacks = 0; // callbacks pushed to a later frame by the budget
+
+static void ReleaseThread (lua_State *L, FrameCallback &callback)
+{
+	luaL_unref (L, LUA_REGISTRYINDEX, callback.thread_ref);
+	callback.thread_ref = LUA_NOREF;
+	callback.thread = nullptr;
+	callback.suspended = false;
+}
+
+// engine.on_frame(name, fn) -- replaces the callback registered under name,
+// fn = nil removes it
 static int l_engine_on_frame (lua_State *L)
 {
 	const char *name = luaL_checkstring (L, 1);
+	const bool	remove = lua_isnoneornil (L, 2);
+	if (!remove)
+		luaL_checktype (L, 2, LUA_TFUNCTION);
+
+	size_t index = 0;
+	while (index < s_frame_callbacks.size () && s_frame_callbacks[index].name != name)
+		++index;
+	if (index == s_frame_callbacks.size ())
+	{
+		if (remove)
+			return 0;
+		s_frame_callbacks.emplace_back ();
+		s_frame_callbacks.back ().name = name;
+	}
+
+	FrameCallback &callback = s_frame_callbacks[index];
+	luaL_unref (L, LUA_REGISTRYINDEX, callback.func_ref);
+	callback.func_ref = LUA_NOREF;
+	if (!remove)
+	{
+		lua_pushvalue (L, 2);
+		callback.func_ref = luaL_ref (L, LUA_REGISTRYINDEX);
+	}
+
+	// The old function may be suspended in the thread. The running thread is only
+	// anchored by thread_ref, so it is released once it returned or yielded.
+	if (index == s_running_callback)
+		callback.restart = true;
+	else
+		ReleaseThread (L, callback);
+	return 0;
+}
+
+static int YieldFrameCallback (lua_State *L, double wake_time, const char *func)
+{
+	if (L != s_running_thread)
+		return luaL_error (L, "%s: only allowed directly inside an engine.on_frame callback", func);
+	s_frame_callbacks[s_running_callback].wake_time = wake_time;
+	return lua_yield (L, 0);
+}
+
+// engine.wait(seconds) -- suspends the running frame callback
+static int l_engine_wait (lua_State *L)
+{
+	return YieldFrameCallback (L, realtime + luaL_checknumber (L, 1), "engine.wait");
+}
+
+// engine.yield() -- suspends the running frame callback until the next frame
+static int l_engine_yield (lua_State *L)
+{
+	return YieldFrameCallback (L, 0.0, "engine.yield");
+}
+
+// engine.on_change(field, fn [, name]) -- fn(value) runs after a frame wrote a new
+// value to game[field]. Subscribers are keyed by name, or by the function itself,
+// so a script loaded by several documents can register under one name.
+static bool s_has_change_callbacks = false;
+
+static int l_engine_on_change (lua_State *L)
+{
+	const char *field = luaL_checkstring (L, 1);
 	luaL_checktype (L, 2, LUA_TFUNCTION);
+	const bool named = !lua_isnoneornil (L, 3);
+	if (named)
+		luaL_checkstring (L, 3);
 
-	lua_getglobal (L, "_frame_callbacks");
-	lua_pushvalue (L, 2); // copy the function
-	lua_setfield (L, -2, name);
-	lua_pop (L, 1); // pop _frame_callbacks
+	lua_getglobal (L, "_change_callbacks");
+	lua_getfield (L, -1, field);
+	if (!lua_istable (L, -1))
+	{
+		lua_pop (L, 1);
+		lua_newtable (L);
+		lua_pushvalue (L, -1);
+		lua_setfield (L, -3, field);
+	}
+	// stack: _change_callbacks, subscribers
+	lua_pushvalue (L, named ? 3 : 2);
+	lua_pushvalue (L, 2);
+	lua_rawset (L, -3);
+	lua_pop (L, 2);
+	s_has_change_callbacks = true;
 	return 0;
 }
 
@@ -141,24 +268,89 @@ static const char *GetAmmoTypeLabel (int active_weapon)
 
 // ── Table field helpers ─────────────────────────────────────────────
 
-static void SetInt (lua_State *L, const char *key, int val)
+// Keys of the backing table. The GameState fields come first so a
+// GameStateField converts directly, the computed fields follow.
+enum GameKey : uint32_t
+{
+	KEY_WEAPON_LABEL = static_cast<uint32_t> (GameStateField::Count),
+	KEY_AMMO_TYPE_LABEL,
+	KEY_IS_AXE,
+	KEY_IS_SHELLS_WEAPON,
+	KEY_IS_NAILS_WEAPON,
+	KEY_IS_ROCKETS_WEAPON,
+	KEY_IS_CELLS_WEAPON,
+	KEY_GAME_TITLE,
+	KEY_CHAT_ACTIVE,
+	KEY_CHAT_PREFIX,
+	KEY_CHAT_TEXT,
+	NUM_GAME_KEYS
+};
+
+static const char *const kComputedKeyNames[] = {
+	"weapon_label",	   "ammo_type_label", "is_axe",		 "is_shells_weapon", "is_nails_weapon", "is_rockets_weapon",
+	"is_cells_weapon", "game_title",	  "chat_active", "chat_prefix",		 "chat_text",
+};
+static_assert (sizeof (kComputedKeyNames) / sizeof (kComputedKeyNames[0]) == NUM_GAME_KEYS - KEY_WEAPON_LABEL, "kComputedKeyNames out of sync with GameKey");
+
+static const char *GetKeyName (uint32_t key)
+{
+	return key < KEY_WEAPON_LABEL ? kGameStateFieldNames[key] : kComputedKeyNames[key - KEY_WEAPON_LABEL];
+}
+
+// Key strings are created once and kept in the registry, so writing a field
+// doesn't hash and intern its name again
+static int s_key_refs[NUM_GAME_KEYS];
+
+// Keys written by the current Update(), their on_change subscribers run afterwards
+static uint32_t s_changed_keys[NUM_GAME_KEYS];
+static uint32_t s_num_changed_keys = 0;
+
+static void SetValue (lua_State *L, uint32_t key)
+{
+	// stack: backing table, value
+	lua_rawgeti (L, LUA_REGISTRYINDEX, s_key_refs[key]);
+	lua_insert (L, -2);
+	lua_rawset (L, -3);
+	s_changed_keys[s_num_changed_keys++] = key;
+}
+
+static void SetInt (lua_State *L, uint32_t key, int val)
 {
 	lua_pushinteger (L, val);
-	lua_setfield (L, -2, key);
+	SetValue (L, key);
 }
 
-static void SetBool (lua_State *L, const char *key, bool val)
+static void SetBool (lua_State *L, uint32_t key, bool val)
 {
 	lua_pushboolean (L, val ? 1 : 0);
-	lua_setfield (L, -2, key);
+	SetValue (L, key);
 }
 
-static void SetString (lua_State *L, const char *key, const char *val)
+static void SetString (lua_State *L, uint32_t key, const char *val)
 {
 	lua_pushstring (L, val ? val : "");
-	lua_setfield (L, -2, key);
+	SetValue (L, key);
+}
+
+// Overloads for the members in QRMLUI_GAME_STATE_FIELDS
+static void SetField (lua_State *L, GameStateField field, int val)
+{
+	SetInt (L, static_cast<uint32_t> (field), val);
+}
+
+static void SetField (lua_State *L, GameStateField field, bool val)
+{
+	SetBool (L, static_cast<uint32_t> (field), val);
 }
 
+static void SetField (lua_State *L, GameStateField field, const LevelString &val)
+{
+	SetString (L, static_cast<uint32_t> (field), val.c_str ());
+}
+
+// The player list is only bound to the data model, Lua reads num_players
+static void SetField (lua_State *, GameStateField, const std::vector<PlayerInfo> &) {}
+
 // ── Read-only proxy metatable ───────────────────────────────────────
 
 // __index: delegate reads to the backing table (upvalue 1)
@@ -180,37 +372,214 @@ static int l_game_newindex (lua_State *L)
 // The Lua plugin replaces the default event listener instancer, so all
 // onclick="..." attributes are compiled as Lua.  The existing menu
 // documents use action strings like navigate('options'), new_game(),
-// close(), etc.  We register each as a Lua global that reconstructs
-// the action string and routes it through MenuEventHandler.
+// close(), etc.  We register each as a Lua global that hands its
+// action id and arguments straight to MenuEventHandler.
 
 static int l_action_dispatch (lua_State *L)
 {
-	const char *func_name = lua_tostring (L, lua_upvalueindex (1));
-	int			nargs = lua_gettop (L);
+	const ActionId id = static_cast<ActionId> (lua_tointeger (L, lua_upvalueindex (1)));
+	int			   nargs = lua_gettop (L);
+
+	// Two args: e.g. cycle_cvar('name', 1), the delta defaults to 1 like in action strings
+	const std::string arg = nargs >= 1 ? luaL_checkstring (L, 1) : "";
+	const int		  delta = nargs >= 2 ? (int)luaL_checknumber (L, 2) : 1;
+
+	MenuEventHandler::DispatchAction (id, arg, delta);
+	return 0;
+}
+
+// Runs the on_change subscribers of every key Update() wrote
+static void DispatchChangeCallbacks ()
+{
+	lua_getglobal (s_lua, "_change_callbacks");
+	lua_rawgeti (s_lua, LUA_REGISTRYINDEX, s_game_backing_ref);
+	for (uint32_t i = 0; i < s_num_changed_keys; ++i)
+	{
+		// stack: _change_callbacks, backing
+		lua_rawgeti (s_lua, LUA_REGISTRYINDEX, s_key_refs[s_changed_keys[i]]);
+		lua_rawget (s_lua, -3);
+		if (!lua_istable (s_lua, -1))
+		{
+			lua_pop (s_lua, 1);
+			continue;
+		}
+
+		lua_pushnil (s_lua);
+		while (lua_next (s_lua, -2) != 0)
+		{
+			// stack: _change_callbacks, backing, subscribers, key, function
+			lua_rawgeti (s_lua, LUA_REGISTRYINDEX, s_key_refs[s_changed_keys[i]]);
+			lua_rawget (s_lua, -5);
+			if (lua_pcall (s_lua, 1, 0, 0) != 0)
+			{
+				Con_Printf ("LuaBridge: change callback for '%s' error: %s\n", GetKeyName (s_changed_keys[i]), lua_tostring (s_lua, -1));
+				lua_pop (s_lua, 1); // pop error message
+			}
+			// key remains on stack for lua_next
+		}
+		lua_pop (s_lua, 1); // pop subscribers
+	}
+	lua_pop (s_lua, 2); // pop backing, _change_callbacks
+}
+
+static int ResumeThread (lua_State *thread)
+{
+#if LUA_VERSION_NUM >= 504
+	int num_results;
+	return lua_resume (thread, s_lua, 0, &num_results);
+#else
+	return lua_resume (thread, s_lua, 0);
+#endif
+}
+
+// Calls or resumes one frame callback, false if it had nothing to do this frame
+static bool RunFrameCallback (size_t index)
+{
+	FrameCallback &callback = s_frame_callbacks[index];
+	if (callback.suspended ? realtime < callback.wake_time : callback.func_ref == LUA_NOREF)
+		return false;
 
-	std::string action (func_name);
-	if (nargs == 0)
+	if (!callback.thread)
 	{
-		action += "()";
+		callback.thread = lua_newthread (s_lua);
+		callback.thread_ref = luaL_ref (s_lua, LUA_REGISTRYINDEX);
 	}
-	else if (nargs == 1)
+	lua_State *thread = callback.thread;
+	if (!callback.suspended)
+		lua_rawgeti (thread, LUA_REGISTRYINDEX, callback.func_ref);
+
+	s_running_callback = index;
+	s_running_thread = thread;
+	const double start = Sys_DoubleTime ();
+	const int	 status = ResumeThread (thread);
+	const double ms = (Sys_DoubleTime () - start) * 1000.0;
+	s_running_callback = SIZE_MAX;
+	s_running_thread = nullptr;
+
+	// The callback may have registered others, don't use the old reference
+	FrameCallback &ran = s_frame_callbacks[index];
+	ran.sum_ms += ms;
+	ran.worst_ms = std::max (ran.worst_ms, ms);
+	++ran.calls;
+
+	ran.suspended = (status == LUA_YIELD);
+	if (status != LUA_OK && status != LUA_YIELD)
 	{
-		action += "('";
-		action += luaL_checkstring (L, 1);
-		action += "')";
+		Con_Printf ("LuaBridge: frame callback '%s' error: %s\n", ran.name.c_str (), lua_tostring (thread, -1));
+		ran.restart = true; // a thread that raised an error can't be resumed
 	}
 	else
+		lua_settop (thread, 0);
+
+	if (ran.restart)
 	{
-		// Two args: e.g. cycle_cvar('name', 1)
-		action += "('";
-		action += luaL_checkstring (L, 1);
-		action += "', ";
-		action += std::to_string ((int)luaL_checknumber (L, 2));
-		action += ")";
+		ReleaseThread (s_lua, ran);
+		ran.restart = false;
 	}
+	return true;
+}
 
-	MenuEventHandler::ProcessAction (action);
-	return 0;
+static void RunFrameCallbacks ()
+{
+	// Drop removed callbacks, keeping the round robin position
+	size_t kept = 0;
+	for (size_t i = 0; i < s_frame_callbacks.size (); ++i)
+	{
+		if (s_frame_callbacks[i].func_ref == LUA_NOREF && !s_frame_callbacks[i].thread)
+		{
+			if (i < s_next_frame_callback)
+				--s_next_frame_callback;
+			continue;
+		}
+		if (kept != i)
+			s_frame_callbacks[kept] = std::move (s_frame_callbacks[i]);
+		++kept;
+	}
+	s_frame_callbacks.resize (kept);
+
+	// Callbacks registered while running are picked up next frame
+	const size_t count = s_frame_callbacks.size ();
+	if (count == 0)
+		return;
+
+	// At least one callback runs per frame so a slow one can't stall the rest
+	const double budget_ms = Cvar_VariableValue ("ui_lua_budget");
+	const double frame_start = Sys_DoubleTime ();
+	size_t		 index = s_next_frame_callback % count;
+	bool		 ran_any = false;
+	for (size_t i = 0; i < count; ++i, index = (index + 1) % count)
+	{
+		if (ran_any && budget_ms > 0.0 && (Sys_DoubleTime () - frame_start) * 1000.0 >= budget_ms)
+		{
+			s_deferred_callbacks += static_cast<uint32_t> (count - i);
+			break;
+		}
+		ran_any |= RunFrameCallback (index);
+	}
+	s_next_frame_callback = index;
+}
+
+// ── Garbage collection ──────────────────────────────────────────────
+// The collector is stopped and stepped once per frame for up to
+// ui_lua_gc_budget milliseconds, so collection cost is spread over frames
+// instead of landing on whichever allocation crossed the threshold.
+// A new cycle starts once memory doubles since the end of the last one,
+// like the default pause. Falling far behind finishes the cycle regardless
+// of the budget. 0 hands collection back to Lua.
+
+static bool	  s_gc_in_cycle = false;
+static size_t s_gc_live_bytes = 0; // in use when the last cycle ended
+
+// Cost since the last PrintCallbackStats()
+static double	s_gc_sum_ms = 0.0;
+static double	s_gc_worst_ms = 0.0;
+static uint32_t s_gc_cycles = 0;
+
+static size_t GetLuaBytes ()
+{
+	return static_cast<size_t> (lua_gc (s_lua, LUA_GCCOUNT, 0)) * 1024 + static_cast<size_t> (lua_gc (s_lua, LUA_GCCOUNTB, 0));
+}
+
+static void StepGarbageCollector ()
+{
+	const double budget_ms = Cvar_VariableValue ("ui_lua_gc_budget");
+	if (budget_ms <= 0.0)
+	{
+		if (!lua_gc (s_lua, LUA_GCISRUNNING, 0))
+			lua_gc (s_lua, LUA_GCRESTART, 0);
+		s_gc_in_cycle = false;
+		return;
+	}
+	if (lua_gc (s_lua, LUA_GCISRUNNING, 0))
+	{
+		lua_gc (s_lua, LUA_GCSTOP, 0);
+		s_gc_live_bytes = GetLuaBytes ();
+	}
+
+	const size_t bytes = GetLuaBytes ();
+	if (!s_gc_in_cycle)
+	{
+		if (bytes < 2 * s_gc_live_bytes)
+			return;
+		s_gc_in_cycle = true;
+	}
+
+	const bool	 behind = bytes > 4 * s_gc_live_bytes;
+	const double start = Sys_DoubleTime ();
+	double		 ms = 0.0;
+	do
+	{
+		if (lua_gc (s_lua, LUA_GCSTEP, 0))
+		{
+			s_gc_in_cycle = false;
+			s_gc_live_bytes = GetLuaBytes ();
+			++s_gc_cycles;
+		}
+		ms = (Sys_DoubleTime () - start) * 1000.0;
+	} while (s_gc_in_cycle && (behind || ms < budget_ms));
+
+	s_gc_sum_ms += ms;
+	s_gc_worst_ms = std::max (s_gc_worst_ms, ms);
 }
 
 // ── Public API ──────────────────────────────────────────────────────
@@ -223,6 +592,7 @@ void Initialize ()
 		Con_Printf ("LuaBridge::Initialize: No Lua state available\n");
 		return;
 	}
+	s_gc_in_cycle = false;
 
 	// Create the 'engine' table with C functions
 	lua_newtable (s_lua);
@@ -245,14 +615,36 @@ void Initialize ()
 	lua_pushcfunction (s_lua, l_engine_on_frame);
 	lua_setfield (s_lua, -2, "on_frame");
 
+	lua_pushcfunction (s_lua, l_engine_wait);
+	lua_setfield (s_lua, -2, "wait");
+
+	lua_pushcfunction (s_lua, l_engine_yield);
+	lua_setfield (s_lua, -2, "yield");
+
+	lua_pushcfunction (s_lua, l_engine_on_change);
+	lua_setfield (s_lua, -2, "on_change");
+
 	lua_pushcfunction (s_lua, l_engine_hud_visible);
 	lua_setfield (s_lua, -2, "hud_visible");
 
 	lua_setglobal (s_lua, "engine");
 
-	// Create the named frame-callback table
+	// Frame callbacks of a previous Lua state
+	s_frame_callbacks.clear ();
+	s_next_frame_callback = 0;
+	s_deferred_callbacks = 0;
+
+	// field -> {name or function = function}, see l_engine_on_change
 	lua_newtable (s_lua);
-	lua_setglobal (s_lua, "_frame_callbacks");
+	lua_setglobal (s_lua, "_change_callbacks");
+	s_has_change_callbacks = false;
+
+	// Interned key strings for the backing table
+	for (uint32_t key = 0; key < NUM_GAME_KEYS; ++key)
+	{
+		lua_pushstring (s_lua, GetKeyName (key));
+		s_key_refs[key] = luaL_ref (s_lua, LUA_REGISTRYINDEX);
+	}
 
 	// Create the read-only 'game' proxy:
 	//   backing = {}          (stored in Lua registry)
@@ -265,6 +657,9 @@ void Initialize ()
 	// backing table
 	lua_newtable (s_lua);
 	s_game_backing_ref = luaL_ref (s_lua, LUA_REGISTRYINDEX);
+	s_game_synced = false;
+	s_prev_game_title.clear ();
+	s_prev_chat_text.clear ();
 
 	// proxy table
 	lua_newtable (s_lua);
@@ -290,7 +685,7 @@ void Initialize ()
 	// onclick="navigate('options')" etc. work with the Lua instancer.
 	for (int i = 0; i < kActionRegistrySize; i++)
 	{
-		lua_pushstring (s_lua, kActionRegistry[i].name);
+		lua_pushinteger (s_lua, static_cast<int> (kActionRegistry[i].id));
 		lua_pushcclosure (s_lua, l_action_dispatch, 1);
 		lua_setglobal (s_lua, kActionRegistry[i].name);
 	}
@@ -305,130 +700,121 @@ void Update ()
 
 	const auto &gs = g_game_state;
 
-	// Push the backing table onto the stack and populate it
-	lua_rawgeti (s_lua, LUA_REGISTRYINDEX, s_game_backing_ref);
-
-	// Core stats
-	SetInt (s_lua, "health", gs.health);
-	SetInt (s_lua, "armor", gs.armor);
-	SetInt (s_lua, "ammo", gs.ammo);
-	SetInt (s_lua, "active_weapon", gs.active_weapon);
-
-	// Ammo counts
-	SetInt (s_lua, "shells", gs.shells);
-	SetInt (s_lua, "nails", gs.nails);
-	SetInt (s_lua, "rockets", gs.rockets);
-	SetInt (s_lua, "cells", gs.cells);
-
-	// Level statistics
-	SetInt (s_lua, "monsters", gs.monsters);
-	SetInt (s_lua, "total_monsters", gs.total_monsters);
-	SetInt (s_lua, "secrets", gs.secrets);
-	SetInt (s_lua, "total_secrets", gs.total_secrets);
-
-	// Weapons owned
-	SetBool (s_lua, "has_shotgun", gs.has_shotgun);
-	SetBool (s_lua, "has_super_shotgun", gs.has_super_shotgun);
-	SetBool (s_lua, "has_nailgun", gs.has_nailgun);
-	SetBool (s_lua, "has_super_nailgun", gs.has_super_nailgun);
-	SetBool (s_lua, "has_grenade_launcher", gs.has_grenade_launcher);
-	SetBool (s_lua, "has_rocket_launcher", gs.has_rocket_launcher);
-	SetBool (s_lua, "has_lightning_gun", gs.has_lightning_gun);
-
-	// Keys
-	SetBool (s_lua, "has_key1", gs.has_key1);
-	SetBool (s_lua, "has_key2", gs.has_key2);
-
-	// Powerups
-	SetBool (s_lua, "has_invisibility", gs.has_invisibility);
-	SetBool (s_lua, "has_invulnerability", gs.has_invulnerability);
-	SetBool (s_lua, "has_suit", gs.has_suit);
-	SetBool (s_lua, "has_quad", gs.has_quad);
-
-	// Sigils
-	SetBool (s_lua, "has_sigil1", gs.has_sigil1);
-	SetBool (s_lua, "has_sigil2", gs.has_sigil2);
-	SetBool (s_lua, "has_sigil3", gs.has_sigil3);
-	SetBool (s_lua, "has_sigil4", gs.has_sigil4);
-
-	// Armor type
-	SetInt (s_lua, "armor_type", gs.armor_type);
-
-	// Computed fields (parity with GameDataModel)
-	SetString (s_lua, "weapon_label", GetWeaponLabel (gs.active_weapon));
-	SetString (s_lua, "ammo_type_label", GetAmmoTypeLabel (gs.active_weapon));
-	SetBool (s_lua, "is_axe", gs.active_weapon == IT_AXE);
-
-	int w = gs.active_weapon;
-	SetBool (s_lua, "is_shells_weapon", w == 1 || w == 2);
-	SetBool (s_lua, "is_nails_weapon", w == 4 || w == 8);
-	SetBool (s_lua, "is_rockets_weapon", w == 16 || w == 32);
-	SetBool (s_lua, "is_cells_weapon", w == 64);
-
-	// Game state flags
-	SetBool (s_lua, "deathmatch", gs.deathmatch);
-	SetBool (s_lua, "coop", gs.coop);
-	SetBool (s_lua, "intermission", gs.intermission);
-	SetInt (s_lua, "intermission_type", gs.intermission_type);
-
-	// Level info
-	SetString (s_lua, "level_name", gs.level_name.c_str ());
-	SetString (s_lua, "map_name", gs.map_name.c_str ());
-
-	// Game title (from active game directory)
+	// The first update writes every field, later ones only what changed since the last UI_Update()
+	const GameStateMask changes = s_game_synced ? g_game_state_changes : GAME_STATE_ALL_FIELDS;
+	const char		   *game = COM_GetGameNames (0);
+	const char		   *game_title = (game && game[0]) ? game : "QUAKE";
+	const bool			chat_active = (key_dest == key_message);
+	const char		   *chat_buffer = Key_GetChatBuffer ();
+	const char		   *chat_text = chat_buffer ? chat_buffer : "";
+
+	const bool title_changed = !s_game_synced || s_prev_game_title != game_title;
+	const bool chat_changed = !s_game_synced || chat_active != s_prev_chat_active || chat_team != s_prev_chat_team || s_prev_chat_text != chat_text;
+	s_num_changed_keys = 0;
+	if (changes != 0 || title_changed || chat_changed)
 	{
-		const char *game = COM_GetGameNames (0);
-		SetString (s_lua, "game_title", (game && game[0]) ? game : "QUAKE");
-	}
+		// Push the backing table onto the stack and populate it
+		lua_rawgeti (s_lua, LUA_REGISTRYINDEX, s_game_backing_ref);
 
-	// Time
-	SetInt (s_lua, "time_minutes", gs.time_minutes);
-	SetInt (s_lua, "time_seconds", gs.time_seconds);
+#define QRMLUI_LUA_SET_FIELD(field)                     \
+	if (changes & GameStateBit (GameStateField::field)) \
+		SetField (s_lua, GameStateField::field, gs.field);
+		QRMLUI_GAME_STATE_FIELDS (QRMLUI_LUA_SET_FIELD)
+#undef QRMLUI_LUA_SET_FIELD
 
-	// Face animation state
-	SetInt (s_lua, "face_index", gs.face_index);
-	SetBool (s_lua, "face_pain", gs.face_pain);
+		// Computed fields (parity with GameDataModel)
+		if (changes & GameStateBit (GameStateField::active_weapon))
+		{
+			SetString (s_lua, KEY_WEAPON_LABEL, GetWeaponLabel (gs.active_weapon));
+			SetString (s_lua, KEY_AMMO_TYPE_LABEL, GetAmmoTypeLabel (gs.active_weapon));
+			SetBool (s_lua, KEY_IS_AXE, gs.active_weapon == IT_AXE);
+
+			int w = gs.active_weapon;
+			SetBool (s_lua, KEY_IS_SHELLS_WEAPON, w == 1 || w == 2);
+			SetBool (s_lua, KEY_IS_NAILS_WEAPON, w == 4 || w == 8);
+			SetBool (s_lua, KEY_IS_ROCKETS_WEAPON, w == 16 || w == 32);
+			SetBool (s_lua, KEY_IS_CELLS_WEAPON, w == 64);
+		}
 
-	// Reticle state
-	SetInt (s_lua, "reticle_style", gs.reticle_style);
-	SetBool (s_lua, "weapon_show", gs.weapon_show);
-	SetBool (s_lua, "fire_flash", gs.fire_flash);
-	SetBool (s_lua, "weapon_firing", gs.weapon_firing);
+		// Game title (from active game directory)
+		if (title_changed)
+		{
+			SetString (s_lua, KEY_GAME_TITLE, game_title);
+			s_prev_game_title = game_title;
+		}
+
+		// Chat input overlay
+		if (chat_changed)
+		{
+			if (!s_game_synced || chat_active != s_prev_chat_active)
+				SetBool (s_lua, KEY_CHAT_ACTIVE, chat_active);
+			if (!s_game_synced || chat_team != s_prev_chat_team)
+				SetString (s_lua, KEY_CHAT_PREFIX, chat_team ? "say_team:" : "say:");
+			if (!s_game_synced || s_prev_chat_text != chat_text)
+				SetString (s_lua, KEY_CHAT_TEXT, chat_text);
+			s_prev_chat_active = chat_active;
+			s_prev_chat_team = chat_team;
+			s_prev_chat_text = chat_text;
+		}
+		s_game_synced = true;
 
-	// Chat input overlay
-	SetBool (s_lua, "chat_active", key_dest == key_message);
-	SetString (s_lua, "chat_prefix", chat_team ? "say_team:" : "say:");
+		lua_pop (s_lua, 1); // pop backing table
+	}
+
+	if (s_has_change_callbacks && s_num_changed_keys > 0)
+		DispatchChangeCallbacks ();
+
+	RunFrameCallbacks ();
+	StepGarbageCollector ();
+}
+
+void PrintCallbackStats (int frames)
+{
+	const double inv = frames > 0 ? 1.0 / frames : 0.0;
+	if (s_lua)
 	{
-		const char *buf = Key_GetChatBuffer ();
-		SetString (s_lua, "chat_text", buf ? buf : "");
+		// Avg per frame / worst frame, current / peak memory of the state
+		void				  *ud = nullptr;
+		lua_getallocf (s_lua, &ud);
+		const mem_lua_stats_t *stats = static_cast<const mem_lua_stats_t *> (ud);
+		const size_t		   bytes = stats ? stats->bytes : GetLuaBytes ();
+		const size_t		   peak_bytes = stats ? stats->peak_bytes : bytes;
+		Con_Printf (
+			"ui(lua avg1s) gc %.2f/%.2f ms %u cycles mem %u KB peak %u KB\n", s_gc_sum_ms * inv, s_gc_worst_ms, s_gc_cycles, static_cast<unsigned> (bytes / 1024),
+			static_cast<unsigned> (peak_bytes / 1024));
+		s_gc_sum_ms = 0.0;
+		s_gc_worst_ms = 0.0;
+		s_gc_cycles = 0;
 	}
 
-	// Player count
-	SetInt (s_lua, "num_players", gs.num_players);
+	if (s_frame_callbacks.empty ())
+		return;
 
-	lua_pop (s_lua, 1); // pop backing table
+	std::vector<FrameCallback *> callbacks;
+	for (FrameCallback &callback : s_frame_callbacks)
+		if (callback.calls > 0)
+			callbacks.push_back (&callback);
+	std::sort (callbacks.begin (), callbacks.end (), [] (const FrameCallback *a, const FrameCallback *b) { return a->sum_ms > b->sum_ms; });
 
-	// Dispatch named frame callbacks
-	lua_getglobal (s_lua, "_frame_callbacks");
-	lua_pushnil (s_lua);
-	while (lua_next (s_lua, -2) != 0)
+	// Most expensive first, avg per frame / worst single call
+	std::string line;
+	char		 entry[128];
+	for (size_t i = 0; i < callbacks.size () && i < 8; ++i)
 	{
-		// stack: _frame_callbacks, key, function
-		if (lua_isfunction (s_lua, -1))
-		{
-			if (lua_pcall (s_lua, 0, 0, 0) != 0)
-			{
-				Con_Printf ("LuaBridge: frame callback '%s' error: %s\n", lua_tostring (s_lua, -2), lua_tostring (s_lua, -1));
-				lua_pop (s_lua, 1); // pop error message
-			}
-		}
-		else
-		{
-			lua_pop (s_lua, 1); // pop non-function value
-		}
-		// key remains on stack for lua_next
+		snprintf (entry, sizeof (entry), " %s %.2f/%.2f", callbacks[i]->name.c_str (), callbacks[i]->sum_ms * inv, callbacks[i]->worst_ms);
+		line += entry;
+	}
+	if (callbacks.size () > 8)
+		line += " ...";
+	Con_Printf ("ui(lua avg1s) deferred %u callbacks%s\n", s_deferred_callbacks, line.c_str ());
+
+	for (FrameCallback &callback : s_frame_callbacks)
+	{
+		callback.sum_ms = 0.0;
+		callback.worst_ms = 0.0;
+		callback.calls = 0;
 	}
-	lua_pop (s_lua, 1); // pop _frame_callbacks
+	s_deferred_callbacks = 0;
 }
 
 void RunTests ()
@@ -23,6 +23,10 @@ void Initialize ();
 // Call each frame from UI_Update(), after GameDataModel::Update().
 void Update ();
 
+// Print the per-callback cost of engine.on_frame callbacks since the last call,
+// averaged over frames, and reset it. Used by ui_speeds 3.
+void PrintCallbackStats (int frames);
+
 // Run Lua test suite from ui/lua/tests/test_runner.lua.
 // Invoked by the 'lua_test' console command.
 void RunTests ();
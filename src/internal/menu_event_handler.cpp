@@ -60,6 +60,9 @@ namespace QRmlUI
 namespace
 {
 
+// Attribute values built from data bindings could keep adding strings
+constexpr size_t MAX_PARSED_ACTIONS = 1024;
+
 std::string TrimWhitespace (const std::string &value)
 {
 	size_t start = 0;
@@ -139,6 +142,8 @@ ICommandExecutor  *MenuEventHandler::s_executor = nullptr;
 double			   MenuEventHandler::s_last_new_game_time = -1.0;
 double			   MenuEventHandler::s_focus_sound_suppress_until = -1.0;
 
+std::unordered_map<std::string, MenuEventHandler::ParsedActionList> MenuEventHandler::s_parsed_actions;
+
 void MenuEventHandler::SetExecutor (ICommandExecutor *executor)
 {
 	s_executor = executor;
@@ -197,6 +202,7 @@ void MenuEventHandler::Shutdown ()
 	s_key_action.clear ();
 	s_last_new_game_time = -1.0;
 	s_focus_sound_suppress_until = -1.0;
+	s_parsed_actions.clear ();
 	s_initialized = false;
 
 	Con_DPrintf ("MenuEventHandler: Shutdown\n");
@@ -213,6 +219,9 @@ void MenuEventHandler::RegisterWithDocument (Rml::ElementDocument *document)
 		return;
 	}
 
+	// Clicks then only look up what the attribute parsed into
+	ParseDocumentActions (document);
+
 	document->AddEventListener (Rml::EventId::Click, &s_instance, true);
 	// Let data-value controllers update model values before we handle change events.
 	document->AddEventListener (Rml::EventId::Change, &s_instance, false);
@@ -226,6 +235,25 @@ void MenuEventHandler::ProcessAction (const std::string &action)
 	s_instance.ExecuteAction (action);
 }
 
+void MenuEventHandler::ParseDocumentActions (Rml::Element *element)
+{
+	ParsedActionList scratch;
+	for (const auto &attribute : element->GetAttributes ())
+	{
+		const Rml::String &name = attribute.first;
+		bool			   is_action = name.compare (0, 11, "data-event-") == 0;
+#ifndef USE_LUA
+		// Lua builds compile on* attributes as Lua instead
+		is_action = is_action || name.compare (0, 2, "on") == 0 || name == "data-action";
+#endif
+		if (is_action)
+			ParseAction (attribute.second.Get<Rml::String> (), scratch);
+	}
+
+	for (int i = 0; i < element->GetNumChildren (); i++)
+		ParseDocumentActions (element->GetChild (i));
+}
+
 void MenuEventHandler::SetKeyCaptureCallback (KeyCaptureCallback callback)
 {
 	s_key_callback = callback;
@@ -377,99 +405,116 @@ void MenuEventHandler::ExecuteAction (const std::string &action)
 	if (action.empty ())
 		return;
 
+	ParsedActionList scratch;
+	for (const ParsedAction &parsed : ParseAction (action, scratch))
+	{
+		if (parsed.id == ActionId::Unknown)
+		{
+			// Silently ignore data model event callbacks (load_slot, save_slot,
+			// select_mod) that reach here when triggered via data-event-click.
+			Con_DPrintf ("MenuEventHandler: Ignoring unknown action '%s' (data model callback?)\n", parsed.name.c_str ());
+			continue;
+		}
+		DispatchAction (parsed.id, parsed.arg, parsed.delta);
+	}
+}
+
+void MenuEventHandler::DispatchAction (ActionId id, const std::string &arg, int delta)
+{
+	switch (id)
+	{
+	case ActionId::Navigate:
+		s_instance.ActionNavigate (arg);
+		break;
+	case ActionId::Command:
+		s_instance.ActionCommand (arg);
+		break;
+	case ActionId::CvarChanged:
+		s_instance.ActionCvarChanged (arg);
+		break;
+	case ActionId::CycleCvar:
+		s_instance.ActionCycleCvar (arg, delta);
+		break;
+	case ActionId::Close:
+		s_instance.ActionClose ();
+		break;
+	case ActionId::CloseAll:
+		s_instance.ActionCloseAll ();
+		break;
+	case ActionId::Quit:
+		s_instance.ActionQuit ();
+		break;
+	case ActionId::NewGame:
+		s_instance.ActionNewGame ();
+		break;
+	case ActionId::LoadGame:
+		s_instance.ActionLoadGame (arg);
+		break;
+	case ActionId::SaveGame:
+		s_instance.ActionSaveGame (arg);
+		break;
+	case ActionId::BindKey:
+		s_instance.ActionBindKey (arg);
+		break;
+	case ActionId::MainMenu:
+		s_instance.ActionMainMenu ();
+		break;
+	case ActionId::ConnectTo:
+		s_instance.ActionConnectTo (arg);
+		break;
+	case ActionId::HostGame:
+		s_instance.ActionHostGame (arg);
+		break;
+	case ActionId::LoadMod:
+		s_instance.ActionLoadMod (arg);
+		break;
+	case ActionId::Unknown:
+		break;
+	}
+}
+
+const MenuEventHandler::ParsedActionList &MenuEventHandler::ParseAction (const std::string &action, ParsedActionList &scratch)
+{
+	auto it = s_parsed_actions.find (action);
+	if (it != s_parsed_actions.end ())
+		return it->second;
+
+	// A full table is left alone, lists handed out may still be executing
+	ParsedActionList &parsed = s_parsed_actions.size () < MAX_PARSED_ACTIONS ? s_parsed_actions[action] : scratch;
+	parsed.clear ();
 	if (action.find (';') != std::string::npos)
 	{
-		auto actions = SplitActions (action);
-		if (actions.size () > 1)
+		auto calls = SplitActions (action);
+		if (calls.size () > 1)
 		{
-			for (const auto &item : actions)
-			{
-				ExecuteAction (item);
-			}
-			return;
+			for (const auto &call : calls)
+				ParseActionCall (call, parsed);
+			return parsed;
 		}
 	}
+	ParseActionCall (action, parsed);
+	return parsed;
+}
 
-	// Parse action type
-	size_t		paren_pos = action.find ('(');
-	std::string func_name = (paren_pos != std::string::npos) ? action.substr (0, paren_pos) : action;
+void MenuEventHandler::ParseActionCall (const std::string &call, ParsedActionList &out)
+{
+	ParsedAction parsed;
+	size_t		 paren_pos = call.find ('(');
+	parsed.name = (paren_pos != std::string::npos) ? call.substr (0, paren_pos) : call;
+	parsed.delta = 1;
 
-	// Dispatch to handler
-	if (func_name == "navigate")
-	{
-		ActionNavigate (ExtractArg (action));
-	}
-	else if (func_name == "command")
-	{
-		ActionCommand (ExtractArg (action));
-	}
-	else if (func_name == "cvar_changed")
-	{
-		ActionCvarChanged (ExtractArg (action));
-	}
-	else if (func_name == "cycle_cvar")
-	{
-		auto args = ExtractTwoArgs (action);
-		ActionCycleCvar (args.first, args.second);
-	}
-	else if (func_name == "close")
-	{
-		ActionClose ();
-	}
-	else if (func_name == "close_all")
-	{
-		ActionCloseAll ();
-	}
-	else if (func_name == "quit")
-	{
-		ActionQuit ();
-	}
-	else if (func_name == "new_game")
-	{
-		ActionNewGame ();
-	}
-	else if (func_name == "load_game")
-	{
-		ActionLoadGame (ExtractArg (action));
-	}
-	else if (func_name == "save_game")
-	{
-		ActionSaveGame (ExtractArg (action));
-	}
-	else if (func_name == "bind_key")
-	{
-		ActionBindKey (ExtractArg (action));
-	}
-	else if (func_name == "main_menu")
-	{
-		ActionMainMenu ();
-	}
-	else if (func_name == "connect_to")
-	{
-		ActionConnectTo (ExtractArg (action));
-	}
-	else if (func_name == "host_game")
+	const ActionDef *def = FindAction (parsed.name.c_str ());
+	parsed.id = def ? def->id : ActionId::Unknown;
+	if (def && def->arg_type == ActionArgType::StringInt)
 	{
-		ActionHostGame (ExtractArg (action));
-	}
-	else if (func_name == "load_mod")
-	{
-		ActionLoadMod (ExtractArg (action));
-	}
-	else
-	{
-		// Silently ignore data model event callbacks (load_slot, save_slot,
-		// select_mod) that reach here when triggered via data-event-click.
-		// Only warn for truly unknown actions.
-		if (FindAction (func_name.c_str ()) != nullptr)
-		{
-			Con_Printf ("MenuEventHandler: Unhandled registered action '%s'\n", func_name.c_str ());
-		}
-		else
-		{
-			Con_DPrintf ("MenuEventHandler: Ignoring unknown action '%s' (data model callback?)\n", func_name.c_str ());
-		}
+		auto args = ExtractTwoArgs (call);
+		parsed.arg = args.first;
+		parsed.delta = args.second;
 	}
+	else if (def && def->arg_type == ActionArgType::String)
+		parsed.arg = ExtractArg (call);
+
+	out.push_back (std::move (parsed));
 }
 
 std::string MenuEventHandler::ExtractArg (const std::string &action)
@@ -619,11 +664,6 @@ void MenuEventHandler::ActionCvarChanged (const std::string &ui_name)
 	if (ui_name.empty ())
 		return;
 
-	if (CvarBindingManager::ShouldIgnoreUIChange ())
-	{
-		return;
-	}
-
 	Con_DPrintf ("MenuEventHandler: Cvar changed '%s'\n", ui_name.c_str ());
 	CvarBindingManager::SyncFromUI (ui_name);
 }
@@ -28,6 +28,9 @@
 #include <RmlUi/Core.h>
 #include <string>
 #include <functional>
+#include <unordered_map>
+#include <vector>
+#include "action_registry.h"
 #include "../types/command_executor.h"
 
 namespace QRmlUI
@@ -60,6 +63,9 @@ class MenuEventHandler : public Rml::EventListener
 	// Process an action string (can be called directly for testing)
 	static void ProcessAction (const std::string &action);
 
+	// Run an already parsed action, delta is only read by cycle_cvar
+	static void DispatchAction (ActionId id, const std::string &arg, int delta);
+
 	// Set callback for key capture (for key binding menu)
 	static void SetKeyCaptureCallback (KeyCaptureCallback callback);
 
@@ -85,9 +91,26 @@ class MenuEventHandler : public Rml::EventListener
 	MenuEventHandler () = default;
 	~MenuEventHandler () = default;
 
+	// One call of an action string, "a(); b('x')" parses into two
+	struct ParsedAction
+	{
+		ActionId	id;
+		std::string name; // for the log of unknown actions
+		std::string arg;
+		int			delta;
+	};
+	using ParsedActionList = std::vector<ParsedAction>;
+
 	// Parse and execute action string
 	void ExecuteAction (const std::string &action);
 
+	// Parsed form of an action string, parsed on first use and then looked up
+	static const ParsedActionList &ParseAction (const std::string &action, ParsedActionList &scratch);
+	static void					   ParseActionCall (const std::string &call, ParsedActionList &out);
+
+	// Parses the action attributes of a freshly loaded document up front
+	static void ParseDocumentActions (Rml::Element *element);
+
 	// Action handlers
 	void ActionNavigate (const std::string &menu_path);
 	void ActionCommand (const std::string &command);
@@ -118,6 +141,8 @@ class MenuEventHandler : public Rml::EventListener
 	static ICommandExecutor	 *s_executor; // Injected command executor
 	static double			  s_last_new_game_time;
 	static double			  s_focus_sound_suppress_until;
+
+	static std::unordered_map<std::string, ParsedActionList> s_parsed_actions;
 };
 
 } // namespace QRmlUI
@@ -6,10 +6,14 @@
  */
 
 #include "notification_model.h"
+#include "spike_trace.h"
+#include "spsc_ring.h"
 #include "../types/game_state.h"
 
 #include "engine_bridge.h"
 
+#include <cstring>
+
 namespace QRmlUI
 {
 
@@ -35,6 +39,15 @@ bool				 NotificationModel::s_notify_was_fading[NUM_NOTIFY_LINES] = {};
 static Rml::String s_centerprint_text;
 static Rml::String s_notify_text[NUM_NOTIFY_LINES];
 
+// Console lines queued by NotifyPrint, drained once per UI update. Con_Printf
+// serializes the producers, so a burst only costs a copy into the ring per line.
+struct NotifyEntry
+{
+	char   text[256];
+	double time;
+};
+static SpscRing<NotifyEntry, 64> s_notify_ring;
+
 void NotificationModel::RegisterBindings (Rml::DataModelConstructor &constructor)
 {
 	// Centerprint text
@@ -144,6 +157,7 @@ void NotificationModel::Shutdown ()
 		return;
 
 	s_state = NotificationState{};
+	s_notify_ring.Pop (s_notify_ring.Size ());
 	s_centerprint_text.clear ();
 	for (int i = 0; i < NUM_NOTIFY_LINES; i++)
 	{
@@ -162,11 +176,46 @@ void NotificationModel::Shutdown ()
 	Con_DPrintf ("NotificationModel: Shutdown\n");
 }
 
+void NotificationModel::DrainNotify ()
+{
+	// Only the newest lines of a burst survive, each slot is updated and dirtied once
+	const uint32_t count = s_notify_ring.Size ();
+	if (count == 0)
+		return;
+
+	bool touched[NUM_NOTIFY_LINES] = {};
+	for (uint32_t i = count > NUM_NOTIFY_LINES ? count - NUM_NOTIFY_LINES : 0; i < count; i++)
+	{
+		const NotifyEntry &entry = s_notify_ring.Peek (i);
+		const int		   slot = s_state.notify_head;
+		s_state.notify[slot].text = entry.text;
+		s_state.notify[slot].time = entry.time;
+		s_state.notify_head = (slot + 1) % NUM_NOTIFY_LINES;
+		touched[slot] = true;
+	}
+	s_notify_ring.Pop (count);
+
+	for (int slot = 0; slot < NUM_NOTIFY_LINES; slot++)
+	{
+		if (!touched[slot])
+			continue;
+		s_notify_text[slot] = s_state.notify[slot].text;
+		s_notify_was_visible[slot] = true;
+		s_notify_was_fading[slot] = false;
+		s_model_handle.DirtyVariable ("notify_" + std::to_string (slot));
+		s_model_handle.DirtyVariable ("notify_" + std::to_string (slot) + "_visible");
+		s_model_handle.DirtyVariable ("notify_" + std::to_string (slot) + "_fading");
+	}
+	SpikeTrace::NoteDirty ("notify");
+}
+
 void NotificationModel::Update (double real_time)
 {
 	if (!s_initialized || !s_model_handle)
 		return;
 
+	DrainNotify ();
+
 	// Check centerprint visibility transition
 	// During intermission, centerprint never expires (matches legacy behavior)
 	bool cp_active = !s_state.centerprint.empty () && (g_game_state.intermission || real_time < (s_state.centerprint_expire + CENTERPRINT_FLICKER_SECONDS));
@@ -178,6 +227,7 @@ void NotificationModel::Update (double real_time)
 		s_model_handle.DirtyVariable ("centerprint");
 		s_model_handle.DirtyVariable ("centerprint_visible");
 		s_model_handle.DirtyVariable ("centerprint_fading");
+		SpikeTrace::NoteDirty ("centerprint");
 		s_centerprint_was_visible = cp_active;
 		s_centerprint_was_fading = cp_fading;
 	}
@@ -187,6 +237,7 @@ void NotificationModel::Update (double real_time)
 	if (g_game_state.intermission_type >= 2 && !s_state.centerprint.empty ())
 	{
 		s_model_handle.DirtyVariable ("finale_text");
+		SpikeTrace::NoteDirty ("finale_text");
 	}
 
 	// Check notify visibility transitions
@@ -207,6 +258,7 @@ void NotificationModel::Update (double real_time)
 			s_model_handle.DirtyVariable ("notify_" + std::to_string (i));
 			s_model_handle.DirtyVariable ("notify_" + std::to_string (i) + "_visible");
 			s_model_handle.DirtyVariable ("notify_" + std::to_string (i) + "_fading");
+			SpikeTrace::NoteDirty ("notify");
 			s_notify_was_visible[i] = active;
 			s_notify_was_fading[i] = fading;
 		}
@@ -236,6 +288,7 @@ void NotificationModel::CenterPrint (const char *text, double real_time)
 		s_model_handle.DirtyVariable ("centerprint");
 		s_model_handle.DirtyVariable ("centerprint_visible");
 		s_model_handle.DirtyVariable ("centerprint_fading");
+		SpikeTrace::NoteDirty ("centerprint");
 	}
 }
 
@@ -244,32 +297,19 @@ void NotificationModel::NotifyPrint (const char *text, double real_time)
 	if (!s_initialized || !text || !text[0])
 		return;
 
-	// Write into ring buffer at the head position
-	int slot = s_state.notify_head;
-	s_state.notify[slot].text = text;
-	s_state.notify[slot].time = real_time;
+	// A flood faster than the UI updates drops lines until the ring was drained
+	NotifyEntry *entry = s_notify_ring.Reserve ();
+	if (!entry)
+		return;
 
 	// Strip trailing newline for display
-	auto &str = s_state.notify[slot].text;
-	while (!str.empty () && (str.back () == '\n' || str.back () == '\r'))
-	{
-		str.pop_back ();
-	}
-
-	// Update bound string and dirty
-	s_notify_text[slot] = s_state.notify[slot].text;
-	s_notify_was_visible[slot] = true;
-	s_notify_was_fading[slot] = false;
-
-	if (s_model_handle)
-	{
-		s_model_handle.DirtyVariable ("notify_" + std::to_string (slot));
-		s_model_handle.DirtyVariable ("notify_" + std::to_string (slot) + "_visible");
-		s_model_handle.DirtyVariable ("notify_" + std::to_string (slot) + "_fading");
-	}
-
-	// Advance ring buffer
-	s_state.notify_head = (slot + 1) % NUM_NOTIFY_LINES;
+	size_t length = strnlen (text, sizeof (entry->text) - 1);
+	while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r'))
+		length--;
+	memcpy (entry->text, text, length);
+	entry->text[length] = '\0';
+	entry->time = real_time;
+	s_notify_ring.Commit ();
 }
 
 } // namespace QRmlUI
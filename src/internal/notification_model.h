@@ -35,10 +35,13 @@ class NotificationModel
 	// Push a centerprint message
 	static void CenterPrint (const char *text, double real_time);
 
-	// Push a notify message (console line)
+	// Queue a notify message (console line), shown by the next Update(). Lock-free,
+	// callers must be serialized among themselves (Con_Printf holds con_mutex).
 	static void NotifyPrint (const char *text, double real_time);
 
   private:
+	static void DrainNotify ();
+
 	static NotificationState	s_state;
 	static Rml::DataModelHandle s_model_handle;
 	static bool					s_initialized;
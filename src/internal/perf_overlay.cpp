@@ -0,0 +1,361 @@
+/*
+ * vkQuake RmlUI - Performance Overlay Implementation
+ *
+ * Everything is read from the engine's frame stats ring, see frame_stats.h.
+ * The ring is only written between host frames, so the UI update and render
+ * can copy series out of it without locking.
+ */
+
+#include "perf_overlay.h"
+
+#include "engine_bridge.h"
+
+#include <RmlUi/Core/Box.h>
+#include <RmlUi/Core/ComputedValues.h>
+#include <RmlUi/Core/ElementInstancer.h>
+#include <RmlUi/Core/Factory.h>
+#include <RmlUi/Core/Mesh.h>
+#include <RmlUi/Core/Property.h>
+#include <RmlUi/Core/PropertyDefinition.h>
+#include <RmlUi/Core/RenderManager.h>
+#include <RmlUi/Core/StyleSheetSpecification.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+namespace QRmlUI
+{
+
+// Often enough to follow, rarely enough to read
+static constexpr double SAMPLE_INTERVAL = 0.5;
+// Frames the readouts average over
+static constexpr int SAMPLE_FRAMES = 60;
+// Same threshold as the graphs' default spike-factor
+static constexpr float SPIKE_FACTOR = 2.0f;
+
+struct SeriesName
+{
+	const char *name;
+	int			series;
+};
+
+static const SeriesName s_series_names[] = {
+	{"frame", QRMLUI_FRAME_STATS_FRAME_MS},	  {"host", QRMLUI_FRAME_STATS_HOST_MS},	  {"server", QRMLUI_FRAME_STATS_SERVER_MS},
+	{"render", QRMLUI_FRAME_STATS_RENDER_MS}, {"ui", QRMLUI_FRAME_STATS_UI_MS},		  {"gpu", QRMLUI_FRAME_STATS_GPU_MS},
+	{"tasks", QRMLUI_FRAME_STATS_TASKS_BUSY}, {"net_in", QRMLUI_FRAME_STATS_NET_IN},	  {"net_out", QRMLUI_FRAME_STATS_NET_OUT},
+	{"heap", QRMLUI_FRAME_STATS_HEAP_MB},	  {"vram", QRMLUI_FRAME_STATS_VRAM_MB},
+};
+
+enum
+{
+	READOUT_FPS,
+	READOUT_FRAME,
+	READOUT_HOST,
+	READOUT_SERVER,
+	READOUT_RENDER,
+	READOUT_UI,
+	READOUT_GPU,
+	READOUT_TASKS,
+	READOUT_HEAP,
+	READOUT_VRAM,
+	READOUT_NET_IN,
+	READOUT_NET_OUT,
+	READOUT_SPIKES,
+	READOUT_OVERLAY,
+	NUM_READOUTS
+};
+
+// Bound strings — RmlUI binds to these pointers
+struct Readout
+{
+	const char *name;
+	Rml::String value;
+};
+static Readout s_readouts[NUM_READOUTS] = {
+	{"perf_fps"},	{"perf_frame"}, {"perf_host"},	 {"perf_server"},  {"perf_render"}, {"perf_ui"},	 {"perf_gpu"},
+	{"perf_tasks"}, {"perf_heap"},	{"perf_vram"},	 {"perf_net_in"},  {"perf_net_out"}, {"perf_spikes"}, {"perf_overlay"},
+};
+
+static Rml::DataModelHandle s_model_handle;
+static bool					s_visible = false;
+static double				s_sample_time = 0.0;
+static double				s_cost_ms = 0.0;	 // since TakeCostMs
+static double				s_cost_sum_ms = 0.0; // frames since the last sample, for the readout
+static int					s_cost_frames = 0;
+
+static Rml::PropertyId									s_prop_spike_color = Rml::PropertyId::Invalid;
+static Rml::PropertyId									s_prop_budget_color = Rml::PropertyId::Invalid;
+static Rml::ElementInstancerGeneric<ElementFrameGraph> *s_instancer = nullptr;
+
+// Average of the measured values, negative if there were none
+static float Average (const float *values, int count)
+{
+	float sum = 0.0f;
+	int	  measured = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (values[i] >= 0.0f)
+		{
+			sum += values[i];
+			++measured;
+		}
+	}
+	return measured ? (sum / measured) : -1.0f;
+}
+
+// Median of the measured values, 0 if there were none
+static float Median (const float *values, int count, float *scratch)
+{
+	int measured = 0;
+	for (int i = 0; i < count; ++i)
+		if (values[i] >= 0.0f)
+			scratch[measured++] = values[i];
+	if (!measured)
+		return 0.0f;
+	std::nth_element (scratch, scratch + (measured / 2), scratch + measured);
+	return scratch[measured / 2];
+}
+
+static void SetReadout (int readout, const char *format, double value)
+{
+	char text[32];
+	if (value < 0.0)
+		snprintf (text, sizeof (text), "-");
+	else
+		snprintf (text, sizeof (text), format, value);
+	if (s_readouts[readout].value == text)
+		return;
+	s_readouts[readout].value = text;
+	if (s_model_handle)
+		s_model_handle.DirtyVariable (s_readouts[readout].name);
+}
+
+static void SetAverageReadout (int readout, int series, const char *format)
+{
+	float	  values[SAMPLE_FRAMES];
+	const int count = FrameStats_GetSeries (series, values, SAMPLE_FRAMES);
+	SetReadout (readout, format, Average (values, count));
+}
+
+// KiB per second over the frames the readouts average
+static void SetRateReadout (int readout, int series, const float *frame_ms, int frames)
+{
+	float	  values[SAMPLE_FRAMES];
+	const int count = FrameStats_GetSeries (series, values, frames);
+	double	  kib = 0.0, ms = 0.0;
+	for (int i = 0; i < count; ++i)
+	{
+		kib += values[i];
+		ms += frame_ms[i];
+	}
+	SetReadout (readout, "%.1f KiB/s", (ms > 0.0) ? (kib * 1000.0 / ms) : -1.0);
+}
+
+static void SetLatestReadout (int readout, int series, const char *format)
+{
+	float value;
+	SetReadout (readout, format, FrameStats_GetSeries (series, &value, 1) ? value : -1.0);
+}
+
+static void SampleReadouts ()
+{
+	float	  frame_ms[ElementFrameGraph::MAX_SAMPLES];
+	float	  scratch[ElementFrameGraph::MAX_SAMPLES];
+	const int frames = FrameStats_GetSeries (QRMLUI_FRAME_STATS_FRAME_MS, frame_ms, ElementFrameGraph::MAX_SAMPLES);
+
+	// Readouts average the newest frames, at the end of the window
+	const int	 recent = std::min (frames, SAMPLE_FRAMES);
+	const float *recent_ms = frame_ms + (frames - recent);
+	const float	 average_ms = Average (recent_ms, recent);
+	SetReadout (READOUT_FPS, "%.0f", (average_ms > 0.0f) ? (1000.0 / average_ms) : -1.0);
+	SetReadout (READOUT_FRAME, "%.2f ms", average_ms);
+	SetAverageReadout (READOUT_HOST, QRMLUI_FRAME_STATS_HOST_MS, "%.2f ms");
+	SetAverageReadout (READOUT_SERVER, QRMLUI_FRAME_STATS_SERVER_MS, "%.2f ms");
+	SetAverageReadout (READOUT_RENDER, QRMLUI_FRAME_STATS_RENDER_MS, "%.2f ms");
+	SetAverageReadout (READOUT_UI, QRMLUI_FRAME_STATS_UI_MS, "%.2f ms");
+	SetAverageReadout (READOUT_GPU, QRMLUI_FRAME_STATS_GPU_MS, "%.2f ms");
+	SetAverageReadout (READOUT_TASKS, QRMLUI_FRAME_STATS_TASKS_BUSY, "%.0f%%");
+	SetLatestReadout (READOUT_HEAP, QRMLUI_FRAME_STATS_HEAP_MB, "%.1f MiB");
+	SetLatestReadout (READOUT_VRAM, QRMLUI_FRAME_STATS_VRAM_MB, "%.1f MiB");
+	SetRateReadout (READOUT_NET_IN, QRMLUI_FRAME_STATS_NET_IN, recent_ms, recent);
+	SetRateReadout (READOUT_NET_OUT, QRMLUI_FRAME_STATS_NET_OUT, recent_ms, recent);
+
+	// Spikes over the whole graph window, like the bars marked in the frame graph
+	const float median = Median (frame_ms, frames, scratch);
+	int			spikes = 0;
+	for (int i = 0; i < frames; ++i)
+		if (median > 0.0f && frame_ms[i] > SPIKE_FACTOR * median)
+			++spikes;
+	SetReadout (READOUT_SPIKES, "%.0f", spikes);
+
+	SetReadout (READOUT_OVERLAY, "%.3f ms", s_cost_frames ? (s_cost_sum_ms / s_cost_frames) : -1.0);
+	s_cost_sum_ms = 0.0;
+	s_cost_frames = 0;
+}
+
+void PerfOverlay::Initialise ()
+{
+	Rml::StyleSheetSpecification::RegisterProperty ("graph-spike-color", "#ff3333", false, false).AddParser ("color");
+	Rml::StyleSheetSpecification::RegisterProperty ("graph-budget-color", "#ffffff66", false, false).AddParser ("color");
+	s_prop_spike_color = Rml::StyleSheetSpecification::GetPropertyId ("graph-spike-color");
+	s_prop_budget_color = Rml::StyleSheetSpecification::GetPropertyId ("graph-budget-color");
+
+	s_instancer = new Rml::ElementInstancerGeneric<ElementFrameGraph> ();
+	Rml::Factory::RegisterElementInstancer ("frame-graph", s_instancer);
+}
+
+void PerfOverlay::RegisterBindings (Rml::DataModelConstructor &constructor)
+{
+	for (Readout &readout : s_readouts)
+		constructor.Bind (readout.name, &readout.value);
+}
+
+void PerfOverlay::SetModelHandle (Rml::DataModelHandle handle)
+{
+	s_model_handle = handle;
+}
+
+void PerfOverlay::Shutdown ()
+{
+	for (Readout &readout : s_readouts)
+		readout.value.clear ();
+	s_model_handle = Rml::DataModelHandle ();
+	s_visible = false;
+}
+
+void PerfOverlay::Update (double real_time)
+{
+	if (!s_visible || real_time - s_sample_time < SAMPLE_INTERVAL)
+		return;
+	const double start = Sys_DoubleTime ();
+	s_sample_time = real_time;
+	SampleReadouts ();
+	AddCostMs ((Sys_DoubleTime () - start) * 1000.0);
+}
+
+void PerfOverlay::SetVisible (bool visible)
+{
+	s_visible = visible;
+	// Fill the readouts with the first update after showing
+	s_sample_time = -SAMPLE_INTERVAL;
+	s_cost_ms = 0.0;
+	s_cost_sum_ms = 0.0;
+	s_cost_frames = 0;
+}
+
+bool PerfOverlay::IsVisible ()
+{
+	return s_visible;
+}
+
+void PerfOverlay::AddCostMs (double ms)
+{
+	s_cost_ms += ms;
+}
+
+double PerfOverlay::TakeCostMs ()
+{
+	const double ms = s_cost_ms;
+	s_cost_sum_ms += ms;
+	++s_cost_frames;
+	s_cost_ms = 0.0;
+	return ms;
+}
+
+// ──────────────────────────────────────────────────────────────────
+// ElementFrameGraph
+// ──────────────────────────────────────────────────────────────────
+
+static Rml::ColourbPremultiplied GetColorProperty (Rml::Element *element, Rml::PropertyId id, float opacity)
+{
+	const Rml::Property *prop = element->GetProperty (id);
+	return prop ? prop->Get<Rml::Colourb> ().ToPremultiplied (opacity) : Rml::ColourbPremultiplied (255, 255, 255, 255);
+}
+
+static void AddQuad (Rml::Mesh &mesh, float x0, float y0, float x1, float y1, Rml::ColourbPremultiplied color)
+{
+	const int first = static_cast<int> (mesh.vertices.size ());
+	mesh.vertices.push_back (Rml::Vertex{{x0, y0}, color, {0.0f, 0.0f}});
+	mesh.vertices.push_back (Rml::Vertex{{x1, y0}, color, {1.0f, 0.0f}});
+	mesh.vertices.push_back (Rml::Vertex{{x1, y1}, color, {1.0f, 1.0f}});
+	mesh.vertices.push_back (Rml::Vertex{{x0, y1}, color, {0.0f, 1.0f}});
+	const int indices[] = {first, first + 1, first + 2, first, first + 2, first + 3};
+	mesh.indices.insert (mesh.indices.end (), std::begin (indices), std::end (indices));
+}
+
+ElementFrameGraph::ElementFrameGraph (const Rml::String &tag) : Rml::Element (tag) {}
+
+void ElementFrameGraph::OnAttributeChange (const Rml::ElementAttributes &changed_attributes)
+{
+	Rml::Element::OnAttributeChange (changed_attributes);
+	if (changed_attributes.count ("series"))
+	{
+		const Rml::String name = GetAttribute<Rml::String> ("series", "frame");
+		m_series = QRMLUI_FRAME_STATS_FRAME_MS;
+		for (const SeriesName &series : s_series_names)
+			if (name == series.name)
+				m_series = series.series;
+	}
+	m_max = std::max (0.0f, GetAttribute ("max", 0.0f));
+	m_budget = std::max (0.0f, GetAttribute ("budget", 0.0f));
+	m_spike_factor = GetAttribute ("spike-factor", DEFAULT_SPIKE_FACTOR);
+}
+
+void ElementFrameGraph::OnRender ()
+{
+	Rml::RenderManager *rm = GetRenderManager ();
+	const Rml::Vector2f size = GetBox ().GetSize (Rml::BoxArea::Content);
+	if (!rm || size.x <= 0.0f || size.y <= 0.0f)
+		return;
+	const double start = Sys_DoubleTime ();
+
+	float	  values[MAX_SAMPLES];
+	float	  scratch[MAX_SAMPLES];
+	const int count = FrameStats_GetSeries (m_series, values, MAX_SAMPLES);
+	float	  top = m_max;
+	if (top <= 0.0f)
+	{
+		top = m_budget;
+		for (int i = 0; i < count; ++i)
+			top = std::max (top, values[i]);
+	}
+
+	if (top > 0.0f)
+	{
+		const auto					   &computed = GetComputedValues ();
+		const float						opacity = computed.opacity ();
+		const Rml::ColourbPremultiplied bar_color = computed.color ().ToPremultiplied (opacity);
+		const Rml::ColourbPremultiplied spike_color = GetColorProperty (this, s_prop_spike_color, opacity);
+		const float						spike = (m_spike_factor > 0.0f) ? (m_spike_factor * Median (values, count, scratch)) : 0.0f;
+		const float						bar_width = size.x / MAX_SAMPLES;
+
+		// Built where the content box is, the graph moves with its document
+		Rml::Mesh mesh;
+		mesh.vertices.reserve ((count + 1) * 4);
+		mesh.indices.reserve ((count + 1) * 6);
+		for (int i = 0; i < count; ++i)
+		{
+			if (values[i] <= 0.0f)
+				continue;
+			const float x = size.x - ((count - i) * bar_width);
+			const float y = size.y * (1.0f - std::min (values[i] / top, 1.0f));
+			AddQuad (mesh, x, y, x + bar_width, size.y, (spike > 0.0f && values[i] > spike) ? spike_color : bar_color);
+		}
+		if (m_budget > 0.0f && m_budget < top)
+		{
+			const float y = size.y * (1.0f - (m_budget / top));
+			AddQuad (mesh, 0.0f, y, size.x, y + 1.0f, GetColorProperty (this, s_prop_budget_color, opacity));
+		}
+
+		if (!mesh.indices.empty ())
+		{
+			m_geometry = rm->MakeGeometry (std::move (mesh));
+			m_geometry.Render (GetAbsoluteOffset (Rml::BoxArea::Content));
+		}
+	}
+
+	PerfOverlay::AddCostMs ((Sys_DoubleTime () - start) * 1000.0);
+}
+
+} // namespace QRmlUI
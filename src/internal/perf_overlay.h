@@ -0,0 +1,76 @@
+/*
+ * vkQuake RmlUI - Performance Overlay
+ *
+ * ui_perfoverlay shows ui/rml/debug/performance.rml over the game:
+ *   <frame-graph series="frame" max="50" budget="16.7"/> — bars for the last
+ *   frames of one frame stats series, newest on the right. Bars above
+ *   spike-factor times the median of the window use graph-spike-color.
+ *
+ * The readouts are bound on the "game" data model and sampled twice a second
+ * while the overlay is shown. Each graph is a single mesh rebuilt every frame,
+ * small enough for the render interface to stream through its per-frame vertex
+ * ring instead of allocating buffers. Time spent on both is the overlay's own
+ * cost, reported separately as ui_overlay_ms.
+ */
+
+#pragma once
+
+#include <RmlUi/Core/DataModelHandle.h>
+#include <RmlUi/Core/Element.h>
+#include <RmlUi/Core/Geometry.h>
+
+namespace QRmlUI
+{
+
+class PerfOverlay
+{
+  public:
+	// Registers <frame-graph> and its properties, call after Rml::Initialise()
+	static void Initialise ();
+
+	// Register readout bindings on the game data model constructor.
+	// Must be called during GameDataModel::Initialize, before GetModelHandle().
+	static void RegisterBindings (Rml::DataModelConstructor &constructor);
+
+	// Store the model handle (call after GetModelHandle in GameDataModel)
+	static void SetModelHandle (Rml::DataModelHandle handle);
+
+	static void Shutdown ();
+
+	// Sample the readouts while visible. Call each frame from UI_Update.
+	static void Update (double real_time);
+
+	static void SetVisible (bool visible);
+	static bool IsVisible ();
+
+	// Milliseconds spent on the overlay since the last call
+	static void	  AddCostMs (double ms);
+	static double TakeCostMs ();
+};
+
+class ElementFrameGraph : public Rml::Element
+{
+  public:
+	RMLUI_RTTI_DefineWithParent (ElementFrameGraph, Rml::Element)
+
+		explicit ElementFrameGraph (const Rml::String &tag);
+
+	// Last frames a graph shows, 4 vertices a bar plus the budget line stay
+	// under the render interface's 1024 vertex limit for streamed geometry
+	static constexpr int MAX_SAMPLES = 240;
+
+  protected:
+	void OnRender () override;
+	void OnAttributeChange (const Rml::ElementAttributes &changed_attributes) override;
+
+  private:
+	static constexpr float DEFAULT_SPIKE_FACTOR = 2.0f;
+
+	int			  m_series = 0;	  // frame_stats_series_t
+	float		  m_max = 0.0f;	  // top of the graph, 0 scales to the largest sample
+	float		  m_budget = 0.0f; // horizontal line, 0 for none
+	float		  m_spike_factor = DEFAULT_SPIKE_FACTOR;
+	Rml::Geometry m_geometry;
+};
+
+} // namespace QRmlUI
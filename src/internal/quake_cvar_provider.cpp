@@ -7,18 +7,26 @@
 #include "engine_bridge.h"
 
 // cvar_t struct and Cvar_FindVar are engine-internal — only this
-// provider implementation needs the struct layout.
+// provider implementation needs the struct layout. Must match cvar.h
+// up to change_count.
 extern "C"
 {
 	typedef struct cvar_s
 	{
-		const char	*name;
-		const char	*string;
-		unsigned int flags;
-		float		 value;
+		const char	  *name;
+		const char	  *string;
+		unsigned int   flags;
+		float		   value;
+		const char	  *default_string;
+		void		   (*callback) (struct cvar_s *);
+		struct cvar_s *next;
+		uint32_t	   change_count;
 	} cvar_t;
 
-	cvar_t *Cvar_FindVar (const char *var_name);
+	cvar_t	*Cvar_FindVar (const char *var_name);
+	void	 Cvar_SetQuick (cvar_t *var, const char *value);
+	void	 Cvar_SetValueQuick (cvar_t *var, const float value);
+	uint32_t Cvar_ChangeCount (void);
 }
 
 namespace QRmlUI
@@ -56,4 +64,46 @@ bool QuakeCvarProvider::Exists (const std::string &name) const
 	return Cvar_FindVar (name.c_str ()) != nullptr;
 }
 
+// A CvarHandle is the engine's cvar_t *
+static cvar_t *ToCvar (CvarHandle cvar)
+{
+	return const_cast<cvar_t *> (reinterpret_cast<const cvar_t *> (cvar));
+}
+
+CvarHandle QuakeCvarProvider::FindCvar (const std::string &name) const
+{
+	return reinterpret_cast<CvarHandle> (Cvar_FindVar (name.c_str ()));
+}
+
+float QuakeCvarProvider::GetFloat (CvarHandle cvar) const
+{
+	return ToCvar (cvar)->value;
+}
+
+std::string QuakeCvarProvider::GetString (CvarHandle cvar) const
+{
+	const char *str = ToCvar (cvar)->string;
+	return str ? str : "";
+}
+
+void QuakeCvarProvider::SetFloat (CvarHandle cvar, float value)
+{
+	Cvar_SetValueQuick (ToCvar (cvar), value);
+}
+
+void QuakeCvarProvider::SetString (CvarHandle cvar, const std::string &value)
+{
+	Cvar_SetQuick (ToCvar (cvar), value.c_str ());
+}
+
+uint32_t QuakeCvarProvider::GetChangeCount () const
+{
+	return Cvar_ChangeCount ();
+}
+
+uint32_t QuakeCvarProvider::GetChangeCount (CvarHandle cvar) const
+{
+	return ToCvar (cvar)->change_count;
+}
+
 } // namespace QRmlUI
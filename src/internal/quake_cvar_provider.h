@@ -25,6 +25,14 @@ class QuakeCvarProvider : public ICvarProvider
 	void		SetString (const std::string &name, const std::string &value) override;
 	bool		Exists (const std::string &name) const override;
 
+	CvarHandle	FindCvar (const std::string &name) const override;
+	float		GetFloat (CvarHandle cvar) const override;
+	std::string GetString (CvarHandle cvar) const override;
+	void		SetFloat (CvarHandle cvar, float value) override;
+	void		SetString (CvarHandle cvar, const std::string &value) override;
+	uint32_t	GetChangeCount () const override;
+	uint32_t	GetChangeCount (CvarHandle cvar) const override;
+
   private:
 	QuakeCvarProvider () = default;
 };
@@ -1,10 +1,12 @@
 /*
  * vkQuake RmlUI - Quake-Aware File Interface Implementation
  *
- * Uses Quake's virtual filesystem (COM_FOpenFile + FS_* wrappers)
- * for pak file support and correct search path resolution. Falls
- * back to basedir-relative lookup for loose files at the project
- * root (e.g. <basedir>/ui/...) which are outside game directories.
+ * Uses Quake's virtual filesystem (COM_LoadFileView) for pak file
+ * support and correct search path resolution. Files inside memory
+ * mapped paks are read in place without a copy. Falls back to
+ * basedir-relative lookup for loose files at the project root
+ * (e.g. <basedir>/ui/...) which are outside game directories, those
+ * are read whole in a single fread.
  */
 
 #include "quake_file_interface.h"
@@ -12,6 +14,7 @@
 
 #include <cstdio>
 #include <string>
+#include <sys/stat.h>
 
 namespace QRmlUI
 {
@@ -20,61 +23,201 @@ namespace
 
 struct QFileHandle
 {
-	fshandle_t fh;
+	fshandle_t						fh = {}; /* memory backed, fh.memory is the cached data */
+	QuakeFileInterface::CachedFile *file = nullptr;
 };
 
-/* Helper: open a loose file and populate an fshandle_t for it. */
-static Rml::FileHandle OpenLoose (FILE *f)
+static uint64_t HashBytes (const unsigned char *data, size_t length)
 {
-	fseek (f, 0, SEEK_END);
-	long length = ftell (f);
-	fseek (f, 0, SEEK_SET);
+	uint64_t hash = 14695981039346656037ull; // FNV-1a
+	for (size_t i = 0; i < length; ++i)
+		hash = (hash ^ data[i]) * 1099511628211ull;
+	return hash;
+}
 
-	auto *qfh = new QFileHandle;
-	qfh->fh.file = f;
-	qfh->fh.pak = 0;
-	qfh->fh.start = 0;
-	qfh->fh.pos = 0;
-	qfh->fh.length = length;
-	return reinterpret_cast<Rml::FileHandle> (qfh);
+static std::string BasedirPath (const std::string &path)
+{
+	return std::string (com_basedir) + "/" + path;
 }
 
 } // anonymous namespace
 
-Rml::FileHandle QuakeFileInterface::Open (const Rml::String &path)
+QuakeFileInterface::FileStamp QuakeFileInterface::StampFile (const std::string &path)
 {
-	/* 1. Quake VFS: game dirs + pak files (handles mod overrides,
-	 *    pak-embedded assets, and the full engine search order). */
-	FILE *file = nullptr;
-	int	  length = COM_FOpenFile (path.c_str (), &file, nullptr);
-	if (length != -1 && file)
+	FileStamp			 stamp;
+	int					 length = 0;
+	const unsigned char *view = COM_LoadFileView (path.c_str (), nullptr, &length);
+	if (view)
+	{
+		stamp.value = HashBytes (view, static_cast<size_t> (length));
+		stamp.length = length;
+		COM_FreeFileView (view);
+		return stamp;
+	}
+
+	struct stat st;
+	if (com_basedir[0] != '\0' && stat (BasedirPath (path).c_str (), &st) == 0)
+	{
+		stamp.value = static_cast<uint64_t> (st.st_mtime);
+		stamp.length = static_cast<int64_t> (st.st_size);
+		stamp.loose = true;
+	}
+	return stamp;
+}
+
+std::vector<std::string> QuakeFileInterface::CollectChangedFiles ()
+{
+	std::vector<std::string> changed;
+	for (auto &pair : m_stamps)
+	{
+		const FileStamp stamp = StampFile (pair.first);
+		if (stamp == pair.second)
+			continue;
+		pair.second = stamp;
+		changed.push_back (pair.first);
+	}
+	return changed;
+}
+
+QuakeFileInterface::~QuakeFileInterface ()
+{
+	InvalidateCache ();
+}
+
+QuakeFileInterface::CachedFile *QuakeFileInterface::Acquire (const std::string &path)
+{
+	auto found = m_lru_index.find (path);
+	if (found != m_lru_index.end ())
 	{
-		auto *qfh = new QFileHandle;
-		qfh->fh.file = file;
-		qfh->fh.pak = file_from_pak; // capture immediately after COM_FOpenFile
-		qfh->fh.start = ftell (file);
-		qfh->fh.pos = 0;
-		qfh->fh.length = length;
-		return reinterpret_cast<Rml::FileHandle> (qfh);
+		m_lru.splice (m_lru.begin (), m_lru, found->second);
+		CachedFile *file = *found->second;
+		file->refs++;
+		return file;
 	}
 
+	auto *file = new CachedFile;
+	file->path = path;
+
+	/* 1. Quake VFS: game dirs + pak files (handles mod overrides,
+	 *    pak-embedded assets, and the full engine search order). */
+	int length = 0;
+	file->data = COM_LoadFileView (path.c_str (), nullptr, &length);
+	file->length = length;
+
 	/* 2. Basedir-relative: base UI files live at <basedir>/ui/...,
 	 *    which is outside the game search paths (id1/, mod/, etc.). */
-	if (com_basedir[0] != '\0')
+	if (!file->data && com_basedir[0] != '\0')
 	{
-		std::string base_path = std::string (com_basedir) + "/" + path.c_str ();
-		FILE	   *f = fopen (base_path.c_str (), "rb");
+		FILE *f = fopen (BasedirPath (path).c_str (), "rb");
 		if (f)
-			return OpenLoose (f);
+		{
+			fseek (f, 0, SEEK_END);
+			const long size = ftell (f);
+			fseek (f, 0, SEEK_SET);
+			if (size >= 0)
+			{
+				file->loose.resize (static_cast<size_t> (size) + 1); /* never empty, data () stays valid */
+				file->length = static_cast<long> (fread (file->loose.data (), 1, static_cast<size_t> (size), f));
+				file->data = file->loose.data ();
+			}
+			fclose (f);
+		}
+	}
+
+	if (!file->data)
+	{
+		delete file;
+		return nullptr;
+	}
+
+#ifdef QRMLUI_HOT_RELOAD
+	FileStamp &stamp = m_stamps[path];
+	if (file->loose.empty ())
+	{
+		stamp.value = HashBytes (file->data, static_cast<size_t> (file->length));
+		stamp.length = file->length;
+		stamp.loose = false;
+	}
+	else
+		stamp = StampFile (path);
+#endif
+
+	file->refs = 1;
+	if (file->length <= LRU_MAX_FILE_BYTES)
+	{
+		file->in_lru = true;
+		m_lru.push_front (file);
+		m_lru_index[path] = m_lru.begin ();
+		m_lru_bytes += static_cast<size_t> (file->length);
+		TrimCache ();
+	}
+	return file;
+}
+
+void QuakeFileInterface::Release (CachedFile *file)
+{
+	file->refs--;
+	if (file->refs == 0 && !file->in_lru)
+		FreeFile (file);
+}
+
+void QuakeFileInterface::TrimCache ()
+{
+	auto it = m_lru.end ();
+	while (it != m_lru.begin () && (m_lru.size () > LRU_MAX_FILES || m_lru_bytes > LRU_MAX_BYTES))
+	{
+		--it;
+		CachedFile *file = *it;
+		if (file->refs > 0)
+			continue;
+		m_lru_bytes -= static_cast<size_t> (file->length);
+		m_lru_index.erase (file->path);
+		it = m_lru.erase (it);
+		FreeFile (file);
+	}
+}
+
+void QuakeFileInterface::InvalidateCache ()
+{
+	for (CachedFile *file : m_lru)
+	{
+		file->in_lru = false;
+		if (file->refs == 0)
+			FreeFile (file);
 	}
+	m_lru.clear ();
+	m_lru_index.clear ();
+	m_lru_bytes = 0;
+}
+
+void QuakeFileInterface::FreeFile (CachedFile *file)
+{
+	if (file->loose.empty ())
+		COM_FreeFileView (file->data);
+	delete file;
+}
 
-	return 0;
+Rml::FileHandle QuakeFileInterface::Open (const Rml::String &path)
+{
+	CachedFile *file = Acquire (path);
+	if (!file)
+		return 0;
+
+	auto *qfh = new QFileHandle;
+	qfh->fh.file = nullptr;
+	qfh->fh.pak = 0;
+	qfh->fh.start = 0;
+	qfh->fh.pos = 0;
+	qfh->fh.length = file->length;
+	qfh->fh.memory = file->data;
+	qfh->file = file;
+	return reinterpret_cast<Rml::FileHandle> (qfh);
 }
 
 void QuakeFileInterface::Close (Rml::FileHandle file)
 {
 	auto *qfh = reinterpret_cast<QFileHandle *> (file);
-	FS_fclose (&qfh->fh);
+	Release (qfh->file);
 	delete qfh;
 }
 
@@ -2,12 +2,19 @@
  * vkQuake RmlUI - Quake-Aware File Interface
  *
  * Custom Rml::FileInterface that uses Quake's virtual filesystem
- * (COM_FOpenFile + FS_* wrappers) for file I/O. This ensures
+ * (COM_LoadFileView + FS_* wrappers) for file I/O. This ensures
  * correct search path resolution and pak file support.
  *
  * Search order:
- *   1. Quake VFS via COM_FOpenFile (game dirs, pak files)
+ *   1. Quake VFS via COM_LoadFileView (game dirs, pak files)
  *   2. Basedir-relative fallback (loose files at project root)
+ *
+ * Files are always read whole and served from memory. Recently opened
+ * files stay in a small LRU, so documents sharing stylesheets, templates
+ * and images don't search the VFS for them again.
+ *
+ * With QRMLUI_HOT_RELOAD every opened path is stamped, so a reload can
+ * tell which files changed and keep RmlUI's parsed caches for the rest.
  */
 
 #ifndef QRMLUI_QUAKE_FILE_INTERFACE_H
@@ -15,18 +22,77 @@
 
 #include <RmlUi/Core/FileInterface.h>
 
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace QRmlUI
 {
 
 class QuakeFileInterface : public Rml::FileInterface
 {
   public:
+	~QuakeFileInterface () override;
+
 	Rml::FileHandle Open (const Rml::String &path) override;
 	void			Close (Rml::FileHandle file) override;
 	size_t			Read (void *buffer, size_t size, Rml::FileHandle file) override;
 	bool			Seek (Rml::FileHandle file, long offset, int origin) override;
 	size_t			Tell (Rml::FileHandle file) override;
 	size_t			Length (Rml::FileHandle file) override;
+
+	// Paths opened since they were last stamped whose contents or source
+	// changed, e.g. edited on disk or overridden by a new game directory.
+	// Their stamps are updated, so each change is reported once.
+	std::vector<std::string> CollectChangedFiles ();
+
+	// Drops the LRU, e.g. before a reload or after a game dir change. Files
+	// still open are freed when their last handle closes.
+	void InvalidateCache ();
+
+	// Whole file contents, shared by every handle open on the file
+	struct CachedFile
+	{
+		std::string				   path;
+		const unsigned char		  *data = nullptr; // COM_LoadFileView view, or loose.data ()
+		std::vector<unsigned char> loose;		   // contents of a basedir-relative file
+		long					   length = 0;
+		unsigned				   refs = 0;
+		bool					   in_lru = false;
+	};
+
+  private:
+	static constexpr size_t LRU_MAX_FILES = 64;
+	static constexpr size_t LRU_MAX_BYTES = 8 * 1024 * 1024;
+	static constexpr long	LRU_MAX_FILE_BYTES = 512 * 1024; // fonts are copied by RmlUI, don't keep them
+
+	CachedFile *Acquire (const std::string &path);
+	void		Release (CachedFile *file);
+	void		TrimCache ();
+	static void FreeFile (CachedFile *file);
+
+	// Content hash for VFS files, mtime and size for loose files
+	struct FileStamp
+	{
+		uint64_t value = 0;
+		int64_t	 length = -1; // -1: not found
+		bool	 loose = false;
+
+		bool operator== (const FileStamp &o) const
+		{
+			return value == o.value && length == o.length && loose == o.loose;
+		}
+	};
+
+	static FileStamp StampFile (const std::string &path);
+
+	std::unordered_map<std::string, FileStamp> m_stamps;
+
+	std::list<CachedFile *>											   m_lru; // most recently opened first
+	std::unordered_map<std::string, std::list<CachedFile *>::iterator> m_lru_index;
+	size_t															   m_lru_bytes = 0;
 };
 
 } // namespace QRmlUI
@@ -6,8 +6,10 @@
 
 #include "render_interface_vk.h"
 #include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/Dictionary.h>
 #include <RmlUi/Core/FileInterface.h>
 #include <RmlUi/Core/Log.h>
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
@@ -23,18 +25,28 @@ extern "C"
 // Embedded SPIR-V shaders (generated from GLSL)
 #include "rmlui_shaders_embedded.h"
 
+#include "engine_bridge.h"
+
 namespace QRmlUI
 {
 
 RenderInterface_VK::RenderInterface_VK ()
 	: m_config{}, m_current_cmd (VK_NULL_HANDLE), m_viewport_width (0), m_viewport_height (0), m_scissor_enabled (false), m_scissor_rect{},
-	  m_transform_enabled (false), m_frame_draw_calls (0), m_frame_indices (0), m_pipeline_textured (VK_NULL_HANDLE), m_pipeline_layout (VK_NULL_HANDLE),
-	  m_descriptor_pool (VK_NULL_HANDLE), m_texture_set_layout (VK_NULL_HANDLE), m_sampler (VK_NULL_HANDLE), m_white_texture (nullptr),
-	  m_next_geometry_handle (1), m_next_texture_handle (1), m_initialized (false), m_upload_cmd_pool (VK_NULL_HANDLE), m_upload_fence (VK_NULL_HANDLE),
-	  m_upload_fence_pending (false), m_timestamp_query_pool (VK_NULL_HANDLE), m_timestamps_supported (false), m_timestamp_period (0.0f),
-	  m_timestamp_valid_bits (0), m_last_gpu_time_ms (0.0), m_timestamp_frame_index (0), m_garbage_index (0)
+	  m_transform_enabled (false), m_transform_id (0), m_frame_draw_calls (0), m_frame_indices (0), m_frame_compiled_geometry (0),
+	  m_frame_compiled_vertices (0), m_bound_pipeline (VK_NULL_HANDLE),
+	  m_bound_descriptor_set (VK_NULL_HANDLE), m_bound_scissor{}, m_bound_scissor_valid (false), m_bound_vertex_buffer (VK_NULL_HANDLE),
+	  m_bound_index_buffer (VK_NULL_HANDLE), m_bound_push_constants{}, m_bound_push_constants_valid (false), m_batch_descriptor_set (VK_NULL_HANDLE),
+	  m_batch_texture_index (0), m_batch_scissor{}, m_batch_transform_id (0), m_batch_vertices (0), m_batch_indices (0), m_frame_index (0),
+	  m_pipeline_textured (VK_NULL_HANDLE), m_pipeline_shape (VK_NULL_HANDLE), m_pipeline_layout (VK_NULL_HANDLE), m_descriptor_pool (VK_NULL_HANDLE), m_texture_set_layout (VK_NULL_HANDLE),
+	  m_sampler (VK_NULL_HANDLE), m_push_constant_stages (VK_SHADER_STAGE_VERTEX_BIT), m_bindless (false), m_bindless_set (VK_NULL_HANDLE),
+	  m_next_bindless_index (0), m_white_texture (nullptr), m_initialized (false), m_timestamp_query_pool (VK_NULL_HANDLE), m_timestamps_supported (false),
+	  m_timestamp_period (0.0f), m_timestamp_valid_bits (0), m_last_gpu_time_ms (0.0), m_timestamp_frame_index (0), m_garbage_index (0),
+	  m_layer_render_pass (VK_NULL_HANDLE), m_layer_cmd_pool (VK_NULL_HANDLE), m_layer_cmds{}, m_layer_texture (0), m_layer_quad (0), m_layer_width (0),
+	  m_layer_height (0), m_gui_cmd (VK_NULL_HANDLE), m_layer_recording (false), m_layer_draws (0), m_layer_hash (0), m_layer_submit_cmd (VK_NULL_HANDLE),
+	  m_layer_submit_hash (0), m_layer_valid (false), m_layer_contents_hash (0), m_layer_last_draws (0), m_layer_last_hash (0)
 {
 	m_transform = Rml::Matrix4f::Identity ();
+	m_mvp = Rml::Matrix4f::Identity ();
 }
 
 RenderInterface_VK::~RenderInterface_VK ()
@@ -48,6 +60,9 @@ RenderInterface_VK::~RenderInterface_VK ()
 bool RenderInterface_VK::Initialize (const VulkanConfig &config)
 {
 	m_config = config;
+	m_bindless = (config.descriptor_indexing != 0);
+	// The bindless and the shape fragment shaders read push constants
+	m_push_constant_stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
 	if (!CreateDescriptorSetLayout ())
 	{
@@ -80,30 +95,6 @@ bool RenderInterface_VK::Initialize (const VulkanConfig &config)
 	vkGetPhysicalDeviceProperties (m_config.physical_device, &device_props);
 	m_image_pool.Initialize (m_config.device, m_config.memory_properties, device_props.limits.bufferImageGranularity);
 
-	// Create persistent batch upload command pool and fence (L3)
-	{
-		VkCommandPoolCreateInfo pool_ci{};
-		pool_ci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		pool_ci.queueFamilyIndex = m_config.queue_family_index;
-		pool_ci.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-		if (vkCreateCommandPool (m_config.device, &pool_ci, nullptr, &m_upload_cmd_pool) != VK_SUCCESS)
-		{
-			Rml::Log::Message (Rml::Log::LT_ERROR, "Failed to create batch upload command pool");
-			return false;
-		}
-
-		VkFenceCreateInfo fence_ci{};
-		fence_ci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		if (vkCreateFence (m_config.device, &fence_ci, nullptr, &m_upload_fence) != VK_SUCCESS)
-		{
-			Rml::Log::Message (Rml::Log::LT_ERROR, "Failed to create batch upload fence");
-			vkDestroyCommandPool (m_config.device, m_upload_cmd_pool, nullptr);
-			m_upload_cmd_pool = VK_NULL_HANDLE;
-			return false;
-		}
-		m_upload_fence_pending = false;
-	}
-
 	// Create GPU timestamp query pool (L4)
 	m_timestamp_valid_bits = m_config.timestamp_valid_bits;
 	m_timestamp_period = device_props.limits.timestampPeriod;
@@ -133,7 +124,7 @@ bool RenderInterface_VK::Initialize (const VulkanConfig &config)
 		Rml::Log::Message (Rml::Log::LT_ERROR, "Failed to create default white texture");
 		return false;
 	}
-	m_white_texture = m_textures[white_handle];
+	m_white_texture = m_textures.Get (white_handle);
 
 	m_initialized = true;
 	return true;
@@ -144,35 +135,12 @@ void RenderInterface_VK::Shutdown ()
 	if (!m_initialized)
 		return;
 
+	// Texture copies may still sit in an unsubmitted staging command buffer
+	R_SubmitStagingBuffers ();
 	vkDeviceWaitIdle (m_config.device);
 
-	// Flush pending texture uploads (all fences guaranteed signaled after vkDeviceWaitIdle)
-	for (auto &upload : m_pending_uploads)
-	{
-		vkDestroyFence (m_config.device, upload.fence, nullptr);
-		vkDestroyCommandPool (m_config.device, upload.cmd_pool, nullptr);
-		DestroyBuffer (upload.staging_buffer, upload.staging_memory);
-	}
-	m_pending_uploads.clear ();
-
-	// Clean up batch upload resources (L3)
-	for (auto &staged : m_staged_uploads)
-		DestroyBuffer (staged.staging_buffer, staged.staging_memory);
-	m_staged_uploads.clear ();
-	for (auto &pair : m_prev_batch_staging)
-		DestroyBuffer (pair.first, pair.second);
-	m_prev_batch_staging.clear ();
-	if (m_upload_fence != VK_NULL_HANDLE)
-	{
-		vkDestroyFence (m_config.device, m_upload_fence, nullptr);
-		m_upload_fence = VK_NULL_HANDLE;
-	}
-	if (m_upload_cmd_pool != VK_NULL_HANDLE)
-	{
-		vkDestroyCommandPool (m_config.device, m_upload_cmd_pool, nullptr);
-		m_upload_cmd_pool = VK_NULL_HANDLE;
-	}
-	m_upload_fence_pending = false;
+	// Decodes still running reference their jobs, wait for them before freeing
+	FinishTextureDecodes (true);
 
 	// Destroy timestamp query pool (L4)
 	if (m_timestamp_query_pool != VK_NULL_HANDLE)
@@ -182,44 +150,57 @@ void RenderInterface_VK::Shutdown ()
 	}
 	m_timestamps_supported = false;
 
-	// Release all geometries
-	for (auto &pair : m_geometries)
+	DestroyLayer ();
+	if (m_layer_cmd_pool != VK_NULL_HANDLE)
 	{
-		m_buffer_pool.Free (pair.second->vertex_alloc);
-		m_buffer_pool.Free (pair.second->index_alloc);
-		delete pair.second;
+		vkDestroyCommandPool (m_config.device, m_layer_cmd_pool, nullptr);
+		m_layer_cmd_pool = VK_NULL_HANDLE;
 	}
-	m_geometries.clear ();
-
-	// Release all textures
-	for (auto &pair : m_textures)
+	if (m_layer_render_pass != VK_NULL_HANDLE)
 	{
-		DestroyTexture (pair.second);
-		m_image_pool.Free (pair.second->memory_alloc);
-		delete pair.second;
+		vkDestroyRenderPass (m_config.device, m_layer_render_pass, nullptr);
+		m_layer_render_pass = VK_NULL_HANDLE;
 	}
-	m_textures.clear ();
+
+	// Release all geometries
+	m_geometries.ForEachLive (
+		[this] (GeometryData &geometry)
+		{
+			m_buffer_pool.Free (geometry.vertex_alloc);
+			m_buffer_pool.Free (geometry.index_alloc);
+		});
+
+	// Release all textures
+	m_textures.ForEachLive (
+		[this] (TextureData &texture)
+		{
+			DestroyTexture (&texture);
+			m_image_pool.Free (texture.memory_alloc);
+		});
 	m_white_texture = nullptr;
 
 	// Clean up any pending garbage (safe since we called vkDeviceWaitIdle)
 	for (int slot = 0; slot < GARBAGE_SLOTS; ++slot)
 	{
-		for (GeometryData *geometry : m_geometry_garbage[slot])
+		for (uint32_t index : m_geometry_garbage[slot])
 		{
-			m_buffer_pool.Free (geometry->vertex_alloc);
-			m_buffer_pool.Free (geometry->index_alloc);
-			delete geometry;
+			m_buffer_pool.Free (m_geometries[index].vertex_alloc);
+			m_buffer_pool.Free (m_geometries[index].index_alloc);
 		}
 		m_geometry_garbage[slot].clear ();
 
-		for (TextureData *texture : m_texture_garbage[slot])
+		for (uint32_t index : m_texture_garbage[slot])
 		{
-			DestroyTexture (texture);
-			m_image_pool.Free (texture->memory_alloc);
-			delete texture;
+			DestroyTexture (&m_textures[index]);
+			m_image_pool.Free (m_textures[index].memory_alloc);
 		}
 		m_texture_garbage[slot].clear ();
+		m_shape_garbage[slot].clear ();
 	}
+	m_geometries.Clear ();
+	m_textures.Clear ();
+	m_shapes.Clear ();
+	m_batch.clear ();
 
 	// Shutdown pools before destroying pipeline resources
 	m_buffer_pool.Shutdown ();
@@ -238,6 +219,11 @@ void RenderInterface_VK::DestroyPipelines ()
 		vkDestroyPipeline (m_config.device, m_pipeline_textured, nullptr);
 		m_pipeline_textured = VK_NULL_HANDLE;
 	}
+	if (m_pipeline_shape != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline (m_config.device, m_pipeline_shape, nullptr);
+		m_pipeline_shape = VK_NULL_HANDLE;
+	}
 	if (m_pipeline_layout != VK_NULL_HANDLE)
 	{
 		vkDestroyPipelineLayout (m_config.device, m_pipeline_layout, nullptr);
@@ -253,6 +239,9 @@ void RenderInterface_VK::DestroyPipelines ()
 		vkDestroyDescriptorPool (m_config.device, m_descriptor_pool, nullptr);
 		m_descriptor_pool = VK_NULL_HANDLE;
 	}
+	m_bindless_set = VK_NULL_HANDLE;
+	m_free_bindless_indices.clear ();
+	m_next_bindless_index = 0;
 	if (m_texture_set_layout != VK_NULL_HANDLE)
 	{
 		vkDestroyDescriptorSetLayout (m_config.device, m_texture_set_layout, nullptr);
@@ -270,8 +259,31 @@ bool RenderInterface_VK::Reinitialize (const VulkanConfig &config)
 		return Initialize (config);
 	}
 
+	// Nothing but the swap chain changed when the engine kept its render passes,
+	// then the buffer pools, pipelines and the layer stay as they are. A layer of
+	// the wrong size is replaced by BeginLayer.
+	const bool format_changed = (config.color_format != m_config.color_format) || (config.dynamic_rendering != m_config.dynamic_rendering);
+	if (!format_changed && config.render_pass == m_config.render_pass && config.subpass == m_config.subpass &&
+		config.sample_count == m_config.sample_count)
+	{
+		m_config = config;
+		return true;
+	}
+
 	vkDeviceWaitIdle (m_config.device);
 
+	// The layer image and render pass depend on the color format and rendering path,
+	// they are created again by the next frame
+	if (format_changed)
+	{
+		DestroyLayer ();
+		if (m_layer_render_pass != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass (m_config.device, m_layer_render_pass, nullptr);
+			m_layer_render_pass = VK_NULL_HANDLE;
+		}
+	}
+
 	// H2: With dynamic rendering, the pipeline is render-pass-independent.
 	// Only recreate if color_format or sample_count changed.
 	bool need_pipeline_recreate = !config.dynamic_rendering || (config.color_format != m_config.color_format) || (config.sample_count != m_config.sample_count);
@@ -284,6 +296,11 @@ bool RenderInterface_VK::Reinitialize (const VulkanConfig &config)
 			vkDestroyPipeline (m_config.device, m_pipeline_textured, nullptr);
 			m_pipeline_textured = VK_NULL_HANDLE;
 		}
+		if (m_pipeline_shape != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline (m_config.device, m_pipeline_shape, nullptr);
+			m_pipeline_shape = VK_NULL_HANDLE;
+		}
 		if (m_pipeline_layout != VK_NULL_HANDLE)
 		{
 			vkDestroyPipelineLayout (m_config.device, m_pipeline_layout, nullptr);
@@ -307,16 +324,18 @@ bool RenderInterface_VK::Reinitialize (const VulkanConfig &config)
 	return true;
 }
 
-void RenderInterface_VK::BeginFrame (VkCommandBuffer cmd, int width, int height)
+void RenderInterface_VK::StartFrame (int width, int height)
 {
-	assert (m_initialized && "BeginFrame called on uninitialized renderer");
-	assert (m_current_cmd == VK_NULL_HANDLE && "BeginFrame called without EndFrame — nested frames not allowed");
-	assert (cmd != VK_NULL_HANDLE && "BeginFrame called with null command buffer");
-	m_current_cmd = cmd;
 	m_viewport_width = width;
 	m_viewport_height = height;
 	m_frame_draw_calls = 0;
 	m_frame_indices = 0;
+	m_frame_compiled_geometry = 0;
+	m_frame_compiled_vertices = 0;
+	m_frame_index++;
+
+	// Swap in textures whose decode finished, their uploads go out with this frame
+	FinishTextureDecodes (false);
 
 	// Read back previous frame's GPU timestamp results (L4)
 	if (m_timestamps_supported)
@@ -335,12 +354,25 @@ void RenderInterface_VK::BeginFrame (VkCommandBuffer cmd, int width, int height)
 		// VK_NOT_READY on first frame — report 0.0 ms
 	}
 
-	// Set viewport
+	// Reset scissor to full viewport
+	m_scissor_rect = {{0, 0}, {static_cast<uint32_t> (width), static_cast<uint32_t> (height)}};
+	m_scissor_enabled = false;
+
+	// A layer pass the engine never executed left the image undefined
+	if (m_layer_submit_cmd != VK_NULL_HANDLE)
+	{
+		m_layer_submit_cmd = VK_NULL_HANDLE;
+		m_layer_valid = false;
+	}
+}
+
+void RenderInterface_VK::SetViewport (VkCommandBuffer cmd)
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float> (width);
-	viewport.height = static_cast<float> (height);
+	viewport.width = static_cast<float> (m_viewport_width);
+	viewport.height = static_cast<float> (m_viewport_height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 
@@ -352,48 +384,124 @@ void RenderInterface_VK::BeginFrame (VkCommandBuffer cmd, int width, int height)
 	{
 		vkCmdSetViewport (cmd, 0, 1, &viewport);
 	}
+}
 
-	// Reset scissor to full viewport
-	m_scissor_rect = {{0, 0}, {static_cast<uint32_t> (width), static_cast<uint32_t> (height)}};
-	m_scissor_enabled = false;
+void RenderInterface_VK::BeginFrame (VkCommandBuffer cmd, int width, int height)
+{
+	assert (m_initialized && "BeginFrame called on uninitialized renderer");
+	assert (m_current_cmd == VK_NULL_HANDLE && "BeginFrame called without EndFrame — nested frames not allowed");
+	assert (cmd != VK_NULL_HANDLE && "BeginFrame called with null command buffer");
+	m_current_cmd = cmd;
+	StartFrame (width, height);
+	SetViewport (cmd);
+
+	// Record into the layer instead, falls back to drawing straight into cmd
+	m_gui_cmd = cmd;
+	if (Cvar_VariableValue ("ui_layer_cache") != 0.0 && BeginLayer (width, height))
+		m_current_cmd = m_layer_cmds[m_garbage_index];
+	else if (m_layer_texture)
+		DestroyLayer ();
+
+	// The engine may have bound its own state into this command buffer
+	ResetBoundState ();
+	UpdateMvp ();
 }
 
 void RenderInterface_VK::EndFrame ()
 {
 	assert (m_current_cmd != VK_NULL_HANDLE && "EndFrame called without BeginFrame");
 
-	// Flush any batched texture uploads before the frame's command buffers are submitted (L3)
-	FlushPendingUploads ();
+	FlushBatch ();
+
+	if (m_layer_recording)
+	{
+		EndLayer ();
+
+		// A layer frame is composited later by CompositeLayer()
+		if (m_gui_cmd != VK_NULL_HANDLE)
+			DrawLayer (m_gui_cmd);
+	}
 
 	m_current_cmd = VK_NULL_HANDLE;
+	m_gui_cmd = VK_NULL_HANDLE;
 }
 
-void RenderInterface_VK::CollectGarbage ()
+bool RenderInterface_VK::BeginLayerFrame (int width, int height)
 {
-	assert (m_garbage_index >= 0 && m_garbage_index < GARBAGE_SLOTS && "Garbage index out of bounds");
+	assert (m_initialized && "BeginLayerFrame called on uninitialized renderer");
+	assert (m_current_cmd == VK_NULL_HANDLE && "BeginLayerFrame called without EndFrame — nested frames not allowed");
+	if (Cvar_VariableValue ("ui_layer_cache") == 0.0)
+		return false;
 
-	// Poll batch upload fence — free previous batch staging if signaled (L3)
-	if (m_upload_fence_pending && vkGetFenceStatus (m_config.device, m_upload_fence) == VK_SUCCESS)
+	StartFrame (width, height);
+	if (!BeginLayer (width, height))
 	{
-		FreePrevBatchStaging ();
-		m_upload_fence_pending = false;
+		if (m_layer_texture)
+			DestroyLayer ();
+		return false;
 	}
+	m_current_cmd = m_layer_cmds[m_garbage_index];
+	m_gui_cmd = VK_NULL_HANDLE;
 
-	// Poll pending texture uploads — destroy signaled entries
-	for (auto it = m_pending_uploads.begin (); it != m_pending_uploads.end ();)
+	ResetBoundState ();
+	UpdateMvp ();
+	return true;
+}
+
+void RenderInterface_VK::CompositeLayer (VkCommandBuffer cmd)
+{
+	assert (m_current_cmd == VK_NULL_HANDLE && "CompositeLayer called inside a frame");
+	assert (cmd != VK_NULL_HANDLE && "CompositeLayer called with null command buffer");
+	SetViewport (cmd);
+	DrawLayer (cmd);
+	m_current_cmd = VK_NULL_HANDLE;
+}
+
+void RenderInterface_VK::DrawLayer (VkCommandBuffer cmd)
+{
+	// Composite the layer over the engine's GUI, same premultiplied blend the draws used
+	if (m_layer_draws == 0 || !m_layer_texture)
+		return;
+
+	const bool transform_enabled = m_transform_enabled;
+	m_current_cmd = cmd;
+	m_scissor_enabled = false;
+	m_transform_enabled = false;
+	ResetBoundState ();
+	UpdateMvp ();
+	RenderGeometry (m_layer_quad, Rml::Vector2f (0.0f, 0.0f), m_layer_texture);
+	FlushBatch ();
+	m_transform_enabled = transform_enabled;
+	UpdateMvp ();
+}
+
+bool RenderInterface_VK::ReuseLayer ()
+{
+	if (!m_layer_recording || !m_layer_valid || m_layer_last_draws == 0 || m_layer_last_hash != m_layer_contents_hash)
+		return false;
+
+	// Same draws as last frame: EndLayer() sees a matching hash and hands out no pass,
+	// EndFrame() composites the image as is
+	m_layer_draws = m_layer_last_draws;
+	m_layer_hash = m_layer_last_hash;
+	return true;
+}
+
+VkCommandBuffer RenderInterface_VK::TakeLayerCommandBuffer ()
+{
+	VkCommandBuffer cmd = m_layer_submit_cmd;
+	if (cmd != VK_NULL_HANDLE)
 	{
-		if (vkGetFenceStatus (m_config.device, it->fence) == VK_SUCCESS)
-		{
-			vkDestroyFence (m_config.device, it->fence, nullptr);
-			vkDestroyCommandPool (m_config.device, it->cmd_pool, nullptr);
-			DestroyBuffer (it->staging_buffer, it->staging_memory);
-			it = m_pending_uploads.erase (it);
-		}
-		else
-		{
-			++it;
-		}
+		m_layer_submit_cmd = VK_NULL_HANDLE;
+		m_layer_contents_hash = m_layer_submit_hash;
+		m_layer_valid = true;
 	}
+	return cmd;
+}
+
+void RenderInterface_VK::CollectGarbage ()
+{
+	assert (m_garbage_index >= 0 && m_garbage_index < GARBAGE_SLOTS && "Garbage index out of bounds");
 
 	// Toggle to the other slot — resources queued there are from 2+ frames ago
 	// and are now safe to destroy (GPU fence for that frame has been waited on
@@ -401,63 +509,120 @@ void RenderInterface_VK::CollectGarbage ()
 	m_garbage_index = (m_garbage_index + 1) % GARBAGE_SLOTS;
 	assert (m_garbage_index >= 0 && m_garbage_index < GARBAGE_SLOTS);
 
-	// Destroy all geometries in this slot
-	for (GeometryData *geometry : m_geometry_garbage[m_garbage_index])
-	{
-		m_buffer_pool.Free (geometry->vertex_alloc);
-		m_buffer_pool.Free (geometry->index_alloc);
-		delete geometry;
-	}
+	// Transient geometry written in the frames of this slot is reclaimed at once
+	m_buffer_pool.BeginTransientFrame (static_cast<uint32_t> (m_garbage_index));
+
+	// Recycle all geometries in this slot
+	for (uint32_t index : m_geometry_garbage[m_garbage_index])
+		RecycleGeometry (index);
 	m_geometry_garbage[m_garbage_index].clear ();
 
 	// Destroy all textures in this slot
-	for (TextureData *texture : m_texture_garbage[m_garbage_index])
+	for (uint32_t index : m_texture_garbage[m_garbage_index])
 	{
-		DestroyTexture (texture);
-		m_image_pool.Free (texture->memory_alloc);
-		delete texture;
+		DestroyTexture (&m_textures[index]);
+		m_image_pool.Free (m_textures[index].memory_alloc);
+		m_textures.Recycle (index);
 	}
 	m_texture_garbage[m_garbage_index].clear ();
+
+	for (uint32_t index : m_shape_garbage[m_garbage_index])
+		m_shapes.Recycle (index);
+	m_shape_garbage[m_garbage_index].clear ();
 }
 
 void RenderInterface_VK::SetCommandBuffer (VkCommandBuffer cmd)
 {
+	if (cmd == m_current_cmd)
+		return;
+	if (m_current_cmd != VK_NULL_HANDLE)
+		FlushBatch ();
 	m_current_cmd = cmd;
+	ResetBoundState ();
 }
 
 Rml::CompiledGeometryHandle RenderInterface_VK::CompileGeometry (Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices)
 {
 	assert (m_initialized && "CompileGeometry called on uninitialized renderer");
-	auto *geometry = new GeometryData ();
+	Rml::CompiledGeometryHandle handle;
+	GeometryData			   *geometry = m_geometries.Acquire (handle);
+	if (!geometry)
+	{
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Out of geometry handles (%u)", SlotMap<GeometryData>::MAX_SLOTS);
+		return 0;
+	}
+	geometry->num_vertices = static_cast<int> (vertices.size ());
 	geometry->num_indices = static_cast<int> (indices.size ());
+	m_frame_compiled_geometry++;
+	m_frame_compiled_vertices += static_cast<uint32_t> (vertices.size ());
 
-	VkDeviceSize vertex_size = vertices.size () * sizeof (Rml::Vertex);
-	VkDeviceSize index_size = indices.size () * sizeof (int);
-
-	// Allocate vertex buffer from pool
-	if (!m_buffer_pool.Allocate (vertex_size, 16, geometry->vertex_alloc))
+	// Small geometry may get merged with its neighbours, which reads it back on the CPU.
+	// Keep a copy instead of reading the write-combined pool memory. It is only written to
+	// the frame ring until it has proven to be long-lived.
+	if (geometry->num_vertices <= BATCH_MAX_GEOMETRY_VERTICES)
 	{
-		delete geometry;
+		geometry->cpu_vertices.assign (vertices.begin (), vertices.end ());
+		geometry->cpu_indices.assign (indices.begin (), indices.end ());
+		geometry->transient = true;
+	}
+	else if (!UploadGeometry (geometry, vertices.data (), indices.data ()))
+	{
+		RecycleGeometry (m_geometries.Retire (handle));
 		return 0;
 	}
+	return handle;
+}
 
-	// Copy vertex data directly into persistently mapped memory
-	memcpy (geometry->vertex_alloc.mapped_ptr, vertices.data (), vertex_size);
+void RenderInterface_VK::RecycleGeometry (uint32_t index)
+{
+	GeometryData *geometry = &m_geometries[index];
+	m_buffer_pool.Free (geometry->vertex_alloc);
+	m_buffer_pool.Free (geometry->index_alloc);
+	geometry->vertex_alloc = BufferAllocation{};
+	geometry->index_alloc = BufferAllocation{};
+	geometry->num_vertices = 0;
+	geometry->num_indices = 0;
+	geometry->vertex_offset = 0;
+	geometry->first_index = 0;
+	// Keep the capacity, the next small geometry reuses it
+	geometry->cpu_vertices.clear ();
+	geometry->cpu_indices.clear ();
+	geometry->transient = false;
+	geometry->frames_drawn = 0;
+	geometry->last_drawn_frame = 0;
+	m_geometries.Recycle (index);
+}
+
+bool RenderInterface_VK::UploadGeometry (GeometryData *geometry, const Rml::Vertex *vertices, const int *indices)
+{
+	VkDeviceSize vertex_size = geometry->num_vertices * sizeof (Rml::Vertex);
+	VkDeviceSize index_size = geometry->num_indices * sizeof (int);
+
+	// Allocate vertex buffer from pool, with room to move the data to a multiple of the
+	// vertex stride so it can be addressed with vertexOffset from the chunk start
+	if (!m_buffer_pool.Allocate (vertex_size + sizeof (Rml::Vertex), 16, geometry->vertex_alloc))
+	{
+		geometry->vertex_alloc = BufferAllocation{};
+		return false;
+	}
+	const VkDeviceSize vertex_pad = (sizeof (Rml::Vertex) - geometry->vertex_alloc.offset % sizeof (Rml::Vertex)) % sizeof (Rml::Vertex);
 
 	// Allocate index buffer from pool
 	if (!m_buffer_pool.Allocate (index_size, 4, geometry->index_alloc))
 	{
 		m_buffer_pool.Free (geometry->vertex_alloc);
-		delete geometry;
-		return 0;
+		geometry->vertex_alloc = BufferAllocation{};
+		geometry->index_alloc = BufferAllocation{};
+		return false;
 	}
 
-	// Copy index data directly into persistently mapped memory
-	memcpy (geometry->index_alloc.mapped_ptr, indices.data (), index_size);
-
-	Rml::CompiledGeometryHandle handle = m_next_geometry_handle++;
-	m_geometries[handle] = geometry;
-	return handle;
+	// Copy vertex and index data directly into persistently mapped memory
+	memcpy (static_cast<uint8_t *> (geometry->vertex_alloc.mapped_ptr) + vertex_pad, vertices, vertex_size);
+	memcpy (geometry->index_alloc.mapped_ptr, indices, index_size);
+	geometry->vertex_offset = static_cast<int32_t> ((geometry->vertex_alloc.offset + vertex_pad) / sizeof (Rml::Vertex));
+	geometry->first_index = static_cast<uint32_t> (geometry->index_alloc.offset / sizeof (int));
+	geometry->transient = false;
+	return true;
 }
 
 void RenderInterface_VK::RenderGeometry (Rml::CompiledGeometryHandle geometry_handle, Rml::Vector2f translation, Rml::TextureHandle texture_handle)
@@ -466,22 +631,21 @@ void RenderInterface_VK::RenderGeometry (Rml::CompiledGeometryHandle geometry_ha
 	if (m_current_cmd == VK_NULL_HANDLE)
 		return;
 
-	auto geom_it = m_geometries.find (geometry_handle);
-	if (geom_it == m_geometries.end ())
+	GeometryData *geometry = m_geometries.Get (geometry_handle);
+	if (!geometry)
 		return;
 
-	GeometryData *geometry = geom_it->second;
-	TextureData	 *texture = nullptr;
-
-	if (texture_handle)
+	// Geometry that keeps being drawn is moved out of the frame ring. If the
+	// free-list allocation fails it simply stays transient.
+	if (geometry->transient && geometry->last_drawn_frame != m_frame_index)
 	{
-		auto tex_it = m_textures.find (texture_handle);
-		if (tex_it != m_textures.end ())
-		{
-			texture = tex_it->second;
-		}
+		geometry->last_drawn_frame = m_frame_index;
+		if (++geometry->frames_drawn >= TRANSIENT_PROMOTE_FRAMES)
+			UploadGeometry (geometry, geometry->cpu_vertices.data (), geometry->cpu_indices.data ());
 	}
 
+	TextureData *texture = m_textures.Get (texture_handle);
+
 	// Use white texture for untextured geometry — all geometry goes through the
 	// textured pipeline. The untextured pipeline was removed because white-texture
 	// fallback makes it unreachable.
@@ -490,81 +654,283 @@ void RenderInterface_VK::RenderGeometry (Rml::CompiledGeometryHandle geometry_ha
 		texture = m_white_texture;
 	}
 
-	// Bind pipeline (always textured — white texture serves as untextured fallback)
-	auto bind_pipeline = m_config.cmd_bind_pipeline ? m_config.cmd_bind_pipeline : vkCmdBindPipeline;
-	bind_pipeline (m_current_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_textured);
+	const VkRect2D scissor = GetScissor ();
 
-	// Set scissor
-	auto set_scissor = m_config.cmd_set_scissor ? m_config.cmd_set_scissor : vkCmdSetScissor;
-	if (m_scissor_enabled)
+	// Geometry and texture contents never change under a handle, apart from the
+	// descriptor a streaming texture gets once its decode finished. Layer draws are only
+	// captured, EndLayer() records them if the hash says the image changed.
+	if (m_layer_recording)
 	{
-		set_scissor (m_current_cmd, 0, 1, &m_scissor_rect);
+		struct
+		{
+			uint64_t		geometry;
+			uint64_t		texture;
+			VkDescriptorSet descriptor_set;
+			uint32_t		bindless_index;
+			float			translation[2];
+			VkRect2D		scissor;
+		} key;
+		memset (&key, 0, sizeof (key));
+		key.geometry = geometry_handle;
+		key.texture = texture_handle;
+		key.descriptor_set = texture->descriptor_set;
+		key.bindless_index = texture->bindless_index;
+		key.translation[0] = translation.x;
+		key.translation[1] = translation.y;
+		key.scissor = scissor;
+		HashLayer (&key, sizeof (key));
+		m_layer_draws++;
+
+		assert (!m_layer_mvps.empty () && "Layer draw without a transform");
+		m_layer_list.push_back ({geometry, texture, translation, scissor, static_cast<uint32_t> (m_layer_mvps.size () - 1), nullptr});
+		return;
 	}
-	else
+
+	QueueGeometry (geometry, texture, translation, scissor);
+}
+
+VkRect2D RenderInterface_VK::GetScissor () const
+{
+	if (!m_scissor_enabled)
+		return {{0, 0}, {static_cast<uint32_t> (m_viewport_width), static_cast<uint32_t> (m_viewport_height)}};
+	return m_scissor_rect;
+}
+
+void RenderInterface_VK::QueueGeometry (GeometryData *geometry, TextureData *texture, Rml::Vector2f translation, const VkRect2D &scissor)
+{
+	// Queue into the pending batch while texture, scissor and transform stay the same.
+	// Only small geometries are merged, large ones are not worth the copy.
+	const bool mergeable = geometry->num_vertices <= BATCH_MAX_GEOMETRY_VERTICES;
+	if (!m_batch.empty ())
+	{
+		const bool same_state = (m_batch_descriptor_set == texture->descriptor_set) && (m_batch_texture_index == texture->bindless_index) &&
+								(m_batch_transform_id == m_transform_id) && (memcmp (&m_batch_scissor, &scissor, sizeof (scissor)) == 0);
+		const bool fits = mergeable && (m_batch_vertices + geometry->num_vertices <= BATCH_MAX_VERTICES) &&
+						  (m_batch[0].geometry->num_vertices <= BATCH_MAX_GEOMETRY_VERTICES);
+		if (!same_state || !fits)
+			FlushBatch ();
+	}
+
+	if (m_batch.empty ())
+	{
+		m_batch_descriptor_set = texture->descriptor_set;
+		m_batch_texture_index = texture->bindless_index;
+		m_batch_scissor = scissor;
+		m_batch_transform_id = m_transform_id;
+		m_batch_vertices = 0;
+		m_batch_indices = 0;
+	}
+	m_batch.push_back ({geometry, translation});
+	m_batch_vertices += geometry->num_vertices;
+	m_batch_indices += geometry->num_indices;
+}
+
+void RenderInterface_VK::FlushBatch ()
+{
+	if (m_batch.empty ())
+		return;
+	assert (m_current_cmd != VK_NULL_HANDLE && "FlushBatch called outside of a frame");
+
+	// Bind pipeline (always textured — white texture serves as untextured fallback)
+	if (m_bound_pipeline != m_pipeline_textured)
 	{
-		VkRect2D full_scissor = {{0, 0}, {static_cast<uint32_t> (m_viewport_width), static_cast<uint32_t> (m_viewport_height)}};
-		set_scissor (m_current_cmd, 0, 1, &full_scissor);
+		auto bind_pipeline = m_config.cmd_bind_pipeline ? m_config.cmd_bind_pipeline : vkCmdBindPipeline;
+		bind_pipeline (m_current_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_textured);
+		m_bound_pipeline = m_pipeline_textured;
 	}
 
-	// Bind texture descriptor set
-	if (texture && texture->descriptor_set)
+	BindScissor (m_batch_scissor);
+
+	if (m_batch_descriptor_set && m_bound_descriptor_set != m_batch_descriptor_set)
 	{
 		auto bind_desc = m_config.cmd_bind_descriptor_sets ? m_config.cmd_bind_descriptor_sets : vkCmdBindDescriptorSets;
-		bind_desc (m_current_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &texture->descriptor_set, 0, nullptr);
+		bind_desc (m_current_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &m_batch_descriptor_set, 0, nullptr);
+		m_bound_descriptor_set = m_batch_descriptor_set;
 	}
 
-	// Push constants with transform and translation
-	PushConstants push_constants{};
+	// Several geometries or transient ones: one draw from the frame ring. Falls back to
+	// one draw per geometry if no ring memory could be allocated, transient geometry is
+	// dropped for this frame then.
+	const bool use_ring = m_batch.size () >= 2 || m_batch[0].geometry->transient;
+	if (!use_ring || !WriteBatchToStream ())
+	{
+		for (const BatchEntry &entry : m_batch)
+		{
+			GeometryData *geometry = entry.geometry;
+			if (geometry->transient)
+				continue;
+			DrawIndexed (
+				geometry->vertex_alloc.buffer, geometry->index_alloc.buffer, static_cast<uint32_t> (geometry->num_indices), geometry->first_index,
+				geometry->vertex_offset, entry.translation);
+		}
+	}
 
-	// Build orthographic projection matrix
-	float L = 0.0f;
-	float R = static_cast<float> (m_viewport_width);
-	float T = 0.0f;
-	float B = static_cast<float> (m_viewport_height);
+	m_batch.clear ();
+}
 
-	Rml::Matrix4f projection = Rml::Matrix4f::FromRows (
-		{2.0f / (R - L), 0.0f, 0.0f, (R + L) / (L - R)}, {0.0f, 2.0f / (B - T), 0.0f, (T + B) / (T - B)}, {0.0f, 0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f});
+bool RenderInterface_VK::WriteBatchToStream ()
+{
+	// Vertices are placed at a multiple of the vertex stride, indices follow
+	const VkDeviceSize needed = (m_batch_vertices + 1) * sizeof (Rml::Vertex) + m_batch_indices * sizeof (int);
+	BufferAllocation   alloc;
+	if (!m_buffer_pool.AllocateTransient (needed, 4, alloc))
+		return false;
 
-	Rml::Matrix4f mvp = projection;
-	if (m_transform_enabled)
+	const VkDeviceSize vertex_start = alloc.offset;
+	const VkDeviceSize vertex_pad = (sizeof (Rml::Vertex) - vertex_start % sizeof (Rml::Vertex)) % sizeof (Rml::Vertex);
+	const VkDeviceSize index_start = vertex_start + vertex_pad + m_batch_vertices * sizeof (Rml::Vertex);
+	uint8_t			  *base = static_cast<uint8_t *> (alloc.mapped_ptr) - alloc.offset;
+	Rml::Vertex		  *vertices = reinterpret_cast<Rml::Vertex *> (base + vertex_start + vertex_pad);
+	int				  *indices = reinterpret_cast<int *> (base + index_start);
+
+	// Translation is baked into the positions, index values are rebased onto the merged vertices
+	int num_vertices = 0;
+	int num_indices = 0;
+	for (const BatchEntry &entry : m_batch)
 	{
-		mvp = projection * m_transform;
+		const GeometryData *geometry = entry.geometry;
+		for (int i = 0; i < geometry->num_vertices; ++i)
+		{
+			Rml::Vertex vertex = geometry->cpu_vertices[i];
+			vertex.position += entry.translation;
+			vertices[num_vertices + i] = vertex;
+		}
+		for (int i = 0; i < geometry->num_indices; ++i)
+			indices[num_indices + i] = geometry->cpu_indices[i] + num_vertices;
+		num_vertices += geometry->num_vertices;
+		num_indices += geometry->num_indices;
 	}
 
-	memcpy (push_constants.transform, mvp.data (), sizeof (push_constants.transform));
+	DrawIndexed (
+		alloc.buffer, alloc.buffer, static_cast<uint32_t> (num_indices), static_cast<uint32_t> (index_start / sizeof (int)),
+		static_cast<int32_t> ((vertex_start + vertex_pad) / sizeof (Rml::Vertex)), Rml::Vector2f (0.0f, 0.0f));
+	return true;
+}
+
+void RenderInterface_VK::DrawIndexed (
+	VkBuffer vertex_buffer, VkBuffer index_buffer, uint32_t num_indices, uint32_t first_index, int32_t vertex_offset, Rml::Vector2f translation)
+{
+	PushConstants push_constants{};
+	memcpy (push_constants.transform, m_mvp.data (), sizeof (push_constants.transform));
 	push_constants.translation[0] = translation.x;
 	push_constants.translation[1] = translation.y;
+	push_constants.texture_index = m_batch_texture_index;
+	if (!m_bound_push_constants_valid || memcmp (&m_bound_push_constants, &push_constants, sizeof (push_constants)) != 0)
+	{
+		auto push_const = m_config.cmd_push_constants ? m_config.cmd_push_constants : vkCmdPushConstants;
+		push_const (m_current_cmd, m_pipeline_layout, m_push_constant_stages, 0, sizeof (PushConstants), &push_constants);
+		m_bound_push_constants = push_constants;
+		m_bound_push_constants_valid = true;
+	}
 
-	auto push_const = m_config.cmd_push_constants ? m_config.cmd_push_constants : vkCmdPushConstants;
-	push_const (m_current_cmd, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof (PushConstants), &push_constants);
+	BindBuffers (vertex_buffer, index_buffer);
+	auto draw_indexed = m_config.cmd_draw_indexed ? m_config.cmd_draw_indexed : vkCmdDrawIndexed;
+	draw_indexed (m_current_cmd, num_indices, 1, first_index, vertex_offset, 0);
+	m_frame_draw_calls++;
+	m_frame_indices += num_indices;
+}
 
-	// Bind vertex buffer at suballocation offset
-	VkDeviceSize vertex_offset = geometry->vertex_alloc.offset;
-	auto		 bind_vb = m_config.cmd_bind_vertex_buffers ? m_config.cmd_bind_vertex_buffers : vkCmdBindVertexBuffers;
-	bind_vb (m_current_cmd, 0, 1, &geometry->vertex_alloc.buffer, &vertex_offset);
+void RenderInterface_VK::DrawShape (GeometryData *geometry, const ShapeData *shape, Rml::Vector2f translation, const VkRect2D &scissor)
+{
+	FlushBatch ();
 
-	// Bind index buffer at suballocation offset
-	auto bind_ib = m_config.cmd_bind_index_buffer ? m_config.cmd_bind_index_buffer : vkCmdBindIndexBuffer;
-	bind_ib (m_current_cmd, geometry->index_alloc.buffer, geometry->index_alloc.offset, VK_INDEX_TYPE_UINT32);
+	if (m_bound_pipeline != m_pipeline_shape)
+	{
+		auto bind_pipeline = m_config.cmd_bind_pipeline ? m_config.cmd_bind_pipeline : vkCmdBindPipeline;
+		bind_pipeline (m_current_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_shape);
+		m_bound_pipeline = m_pipeline_shape;
+	}
+	BindScissor (scissor);
 
-	// Draw
+	// Every shape draw pushes all of its constants, the next textured draw has to push again
+	ShapePushConstants push_constants{};
+	memcpy (push_constants.transform, m_mvp.data (), sizeof (push_constants.transform));
+	push_constants.translation[0] = translation.x;
+	push_constants.translation[1] = translation.y;
+	memcpy (push_constants.half_size, shape->half_size, sizeof (push_constants.half_size));
+	memcpy (push_constants.color, shape->color, sizeof (push_constants.color));
+	memcpy (push_constants.params, shape->params, sizeof (push_constants.params));
+	memcpy (push_constants.axis, shape->axis, sizeof (push_constants.axis));
+	push_constants.shape = shape->shape;
+	auto push_const = m_config.cmd_push_constants ? m_config.cmd_push_constants : vkCmdPushConstants;
+	push_const (m_current_cmd, m_pipeline_layout, m_push_constant_stages, 0, sizeof (ShapePushConstants), &push_constants);
+	m_bound_push_constants_valid = false;
+
+	BindBuffers (geometry->vertex_alloc.buffer, geometry->index_alloc.buffer);
 	auto draw_indexed = m_config.cmd_draw_indexed ? m_config.cmd_draw_indexed : vkCmdDrawIndexed;
-	draw_indexed (m_current_cmd, geometry->num_indices, 1, 0, 0, 0);
+	draw_indexed (m_current_cmd, static_cast<uint32_t> (geometry->num_indices), 1, geometry->first_index, geometry->vertex_offset, 0);
 	m_frame_draw_calls++;
 	m_frame_indices += static_cast<uint32_t> (geometry->num_indices);
 }
 
+void RenderInterface_VK::BindBuffers (VkBuffer vertex_buffer, VkBuffer index_buffer)
+{
+	// Buffers are bound at the chunk start, draws address into them with vertexOffset/firstIndex
+	if (m_bound_vertex_buffer != vertex_buffer)
+	{
+		const VkDeviceSize zero_offset = 0;
+		auto			   bind_vb = m_config.cmd_bind_vertex_buffers ? m_config.cmd_bind_vertex_buffers : vkCmdBindVertexBuffers;
+		bind_vb (m_current_cmd, 0, 1, &vertex_buffer, &zero_offset);
+		m_bound_vertex_buffer = vertex_buffer;
+	}
+	if (m_bound_index_buffer != index_buffer)
+	{
+		auto bind_ib = m_config.cmd_bind_index_buffer ? m_config.cmd_bind_index_buffer : vkCmdBindIndexBuffer;
+		bind_ib (m_current_cmd, index_buffer, 0, VK_INDEX_TYPE_UINT32);
+		m_bound_index_buffer = index_buffer;
+	}
+}
+
+void RenderInterface_VK::BindScissor (const VkRect2D &scissor)
+{
+	if (!m_bound_scissor_valid || memcmp (&m_bound_scissor, &scissor, sizeof (scissor)) != 0)
+	{
+		auto set_scissor = m_config.cmd_set_scissor ? m_config.cmd_set_scissor : vkCmdSetScissor;
+		set_scissor (m_current_cmd, 0, 1, &scissor);
+		m_bound_scissor = scissor;
+		m_bound_scissor_valid = true;
+	}
+}
+
+void RenderInterface_VK::ResetBoundState ()
+{
+	m_bound_pipeline = VK_NULL_HANDLE;
+	m_bound_descriptor_set = VK_NULL_HANDLE;
+	m_bound_scissor_valid = false;
+	m_bound_vertex_buffer = VK_NULL_HANDLE;
+	m_bound_index_buffer = VK_NULL_HANDLE;
+	m_bound_push_constants_valid = false;
+}
+
+void RenderInterface_VK::UpdateMvp ()
+{
+	// Orthographic projection over the viewport
+	float L = 0.0f;
+	float R = static_cast<float> (m_viewport_width);
+	float T = 0.0f;
+	float B = static_cast<float> (m_viewport_height);
+
+	Rml::Matrix4f projection = Rml::Matrix4f::FromRows (
+		{2.0f / (R - L), 0.0f, 0.0f, (R + L) / (L - R)}, {0.0f, 2.0f / (B - T), 0.0f, (T + B) / (T - B)}, {0.0f, 0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f});
+
+	m_mvp = m_transform_enabled ? projection * m_transform : projection;
+	m_transform_id++;
+	if (m_layer_recording)
+	{
+		HashLayer (m_mvp.data (), sizeof (float) * 16);
+		m_layer_mvps.push_back (m_mvp);
+	}
+}
+
 void RenderInterface_VK::ReleaseGeometry (Rml::CompiledGeometryHandle geometry_handle)
 {
-	auto it = m_geometries.find (geometry_handle);
-	if (it == m_geometries.end ())
+	const uint32_t index = m_geometries.Retire (geometry_handle);
+	if (index == UINT32_MAX)
 		return;
 
-	// Queue for deferred destruction - the geometry may still be referenced
-	// by in-flight command buffers
-	GeometryData *geometry = it->second;
-	m_geometry_garbage[m_garbage_index].push_back (geometry);
-	m_geometries.erase (it);
+	// Queue for deferred recycling - the geometry may still be referenced
+	// by in-flight command buffers or the pending batch
+	m_geometry_garbage[m_garbage_index].push_back (index);
 }
 
 Rml::TextureHandle RenderInterface_VK::LoadTexture (Rml::Vector2i &texture_dimensions, const Rml::String &source)
@@ -577,79 +943,138 @@ Rml::TextureHandle RenderInterface_VK::LoadTexture (Rml::Vector2i &texture_dimen
 		return 0;
 	}
 
-	size_t				   file_size = file_interface->Length (file);
-	std::vector<Rml::byte> file_data (file_size);
-	file_interface->Read (file_data.data (), file_size, file);
+	auto   job = std::make_unique<TextureDecodeJob> ();
+	size_t file_size = file_interface->Length (file);
+	job->file_data.resize (file_size);
+	file_interface->Read (job->file_data.data (), file_size, file);
 	file_interface->Close (file);
 
-	// Use stb_image to decode the image
-	int			   width, height, channels;
-	unsigned char *image_data = stbi_load_from_memory (
-		file_data.data (), static_cast<int> (file_size), &width, &height, &channels, 4 // Force RGBA output
-	);
-
-	if (!image_data)
+	// Only the header is parsed here, RmlUI needs the dimensions for layout right away
+	int width, height, channels;
+	if (!stbi_info_from_memory (job->file_data.data (), static_cast<int> (file_size), &width, &height, &channels))
 	{
-		Rml::Log::Message (Rml::Log::LT_WARNING, "Failed to decode texture: %s (%s)", source.c_str (), stbi_failure_reason ());
+		Rml::Log::Message (Rml::Log::LT_WARNING, "Failed to decode texture header: %s", source.c_str ());
 		return 0;
 	}
-
 	texture_dimensions.x = width;
 	texture_dimensions.y = height;
 
-	// Generate the texture using the decoded image data
-	Rml::TextureHandle handle = GenerateTexture (Rml::Span<const Rml::byte> (image_data, width * height * 4), texture_dimensions);
+	// Hand out a texture that draws with the white texture until the decode is done
+	Rml::TextureHandle handle;
+	TextureData		  *texture = m_textures.Acquire (handle);
+	if (!texture)
+	{
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Out of texture handles (%u)", SlotMap<TextureData>::MAX_SLOTS);
+		return 0;
+	}
+	*texture = TextureData{};
+	texture->dimensions = texture_dimensions;
+	texture->descriptor_set = m_white_texture->descriptor_set;
+	texture->bindless_index = m_white_texture->bindless_index;
+	texture->streaming = true;
+
+	job->handle = handle;
+	job->pixels = nullptr;
+	job->width = 0;
+	job->height = 0;
+	TextureDecodeJob *payload = job.get ();
+	job->task = Task_Allocate ();
+	Task_AssignFunc (job->task, DecodeTextureTask, &payload, sizeof (payload));
+	Task_Submit (job->task);
+	m_decode_jobs.push_back (std::move (job));
+
+	Rml::Log::Message (Rml::Log::LT_DEBUG, "Streaming texture: %s (%dx%d)", source.c_str (), width, height);
+	return handle;
+}
 
-	stbi_image_free (image_data);
+void RenderInterface_VK::DecodeTextureTask (void *payload)
+{
+	TextureDecodeJob *job = *static_cast<TextureDecodeJob **> (payload);
+	int				  channels;
+	job->pixels = stbi_load_from_memory (
+		job->file_data.data (), static_cast<int> (job->file_data.size ()), &job->width, &job->height, &channels, 4 // Force RGBA output
+	);
+}
 
-	if (handle)
+void RenderInterface_VK::FinishTextureDecodes (bool wait)
+{
+	for (auto it = m_decode_jobs.begin (); it != m_decode_jobs.end ();)
 	{
-		Rml::Log::Message (Rml::Log::LT_DEBUG, "Loaded texture: %s (%dx%d)", source.c_str (), width, height);
-	}
+		TextureDecodeJob *job = it->get ();
+		if (!Task_Join (job->task, wait ? QRMLUI_TASK_TIMEOUT_INFINITE : 0))
+		{
+			++it;
+			continue;
+		}
 
-	return handle;
+		// The texture may have been released while decoding, the handle is stale then
+		TextureData *texture = m_textures.Get (job->handle);
+		if (texture && !wait)
+		{
+			if (!job->pixels)
+				Rml::Log::Message (Rml::Log::LT_WARNING, "Failed to decode streamed texture (%dx%d)", texture->dimensions.x, texture->dimensions.y);
+			else if (job->width != texture->dimensions.x || job->height != texture->dimensions.y)
+				Rml::Log::Message (Rml::Log::LT_WARNING, "Streamed texture changed size while decoding");
+			else
+			{
+				// Build the real texture aside, the placeholder stays in use if that fails
+				TextureData loaded{};
+				loaded.dimensions = texture->dimensions;
+				if (CreateTextureResources (&loaded, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT))
+				{
+					UploadTexturePixels (&loaded, job->pixels);
+					*texture = loaded;
+				}
+			}
+		}
+
+		if (job->pixels)
+			stbi_image_free (job->pixels);
+		it = m_decode_jobs.erase (it);
+	}
 }
 
 Rml::TextureHandle RenderInterface_VK::GenerateTexture (Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions)
 {
-	auto *texture = new TextureData ();
+	Rml::TextureHandle handle;
+	TextureData		  *texture = m_textures.Acquire (handle);
+	if (!texture)
+	{
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Out of texture handles (%u)", SlotMap<TextureData>::MAX_SLOTS);
+		return 0;
+	}
+	*texture = TextureData{};
 	texture->dimensions = source_dimensions;
 
-	VkDeviceSize image_size = source_dimensions.x * source_dimensions.y * 4;
-
-	// Create staging buffer
-	VkBuffer	   staging_buffer;
-	VkDeviceMemory staging_memory;
-	staging_buffer =
-		CreateBuffer (image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_memory);
-
-	void *data;
-	vkMapMemory (m_config.device, staging_memory, 0, image_size, 0, &data);
-	memcpy (data, source.data (), image_size);
-	vkUnmapMemory (m_config.device, staging_memory);
+	if (!CreateTextureResources (texture, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT))
+	{
+		m_textures.Discard (handle);
+		return 0;
+	}
+	UploadTexturePixels (texture, source.data ());
+	return handle;
+}
 
+bool RenderInterface_VK::CreateTextureResources (TextureData *texture, VkFormat format, VkImageUsageFlags usage)
+{
 	// Create image
 	VkImageCreateInfo image_info{};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	image_info.imageType = VK_IMAGE_TYPE_2D;
-	image_info.extent.width = source_dimensions.x;
-	image_info.extent.height = source_dimensions.y;
+	image_info.extent.width = texture->dimensions.x;
+	image_info.extent.height = texture->dimensions.y;
 	image_info.extent.depth = 1;
 	image_info.mipLevels = 1;
 	image_info.arrayLayers = 1;
-	image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_info.format = format;
 	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
 	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_info.usage = usage;
 	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
 	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 	if (vkCreateImage (m_config.device, &image_info, nullptr, &texture->image) != VK_SUCCESS)
-	{
-		DestroyBuffer (staging_buffer, staging_memory);
-		delete texture;
-		return 0;
-	}
+		return false;
 
 	// Allocate image memory from pool
 	VkMemoryRequirements mem_reqs;
@@ -658,22 +1083,18 @@ Rml::TextureHandle RenderInterface_VK::GenerateTexture (Rml::Span<const Rml::byt
 	if (!m_image_pool.Allocate (mem_reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture->memory_alloc))
 	{
 		vkDestroyImage (m_config.device, texture->image, nullptr);
-		DestroyBuffer (staging_buffer, staging_memory);
-		delete texture;
-		return 0;
+		return false;
 	}
 
 	vkBindImageMemory (m_config.device, texture->image, texture->memory_alloc.memory, texture->memory_alloc.offset);
 
-	// Create image view and descriptor set BEFORE staging the upload.
-	// Both are host-side operations that don't depend on the GPU transfer.
-	// This ensures that if either fails, no staged/pending upload entry
-	// references the texture — avoiding use-after-free in FlushPendingUploads().
+	// Create image view and descriptor set before staging the upload, so a failure
+	// here never leaves a recorded copy referencing a destroyed image.
 	VkImageViewCreateInfo view_info{};
 	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	view_info.image = texture->image;
 	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	view_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	view_info.format = format;
 	view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	view_info.subresourceRange.baseMipLevel = 0;
 	view_info.subresourceRange.levelCount = 1;
@@ -684,9 +1105,7 @@ Rml::TextureHandle RenderInterface_VK::GenerateTexture (Rml::Span<const Rml::byt
 	{
 		m_image_pool.Free (texture->memory_alloc);
 		vkDestroyImage (m_config.device, texture->image, nullptr);
-		DestroyBuffer (staging_buffer, staging_memory);
-		delete texture;
-		return 0;
+		return false;
 	}
 
 	texture->sampler = m_sampler;
@@ -697,16 +1116,20 @@ Rml::TextureHandle RenderInterface_VK::GenerateTexture (Rml::Span<const Rml::byt
 	desc_alloc_info.descriptorSetCount = 1;
 	desc_alloc_info.pSetLayouts = &m_texture_set_layout;
 
-	if (vkAllocateDescriptorSets (m_config.device, &desc_alloc_info, &texture->descriptor_set) != VK_SUCCESS)
+	// Bindless: no set per texture, just an element of the shared array
+	const bool descriptor_ok = m_bindless ? AllocateBindlessIndex (texture->bindless_index)
+										  : (vkAllocateDescriptorSets (m_config.device, &desc_alloc_info, &texture->descriptor_set) == VK_SUCCESS);
+	if (!descriptor_ok)
 	{
 		vkDestroyImageView (m_config.device, texture->view, nullptr);
 		m_image_pool.Free (texture->memory_alloc);
 		vkDestroyImage (m_config.device, texture->image, nullptr);
-		DestroyBuffer (staging_buffer, staging_memory);
-		delete texture;
-		return 0;
+		return false;
 	}
+	if (m_bindless)
+		texture->descriptor_set = m_bindless_set;
 
+	// The set or array element is new, so no in-flight command buffer can be using it
 	VkDescriptorImageInfo image_desc_info{};
 	image_desc_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	image_desc_info.imageView = texture->view;
@@ -716,110 +1139,64 @@ Rml::TextureHandle RenderInterface_VK::GenerateTexture (Rml::Span<const Rml::byt
 	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	write.dstSet = texture->descriptor_set;
 	write.dstBinding = 0;
-	write.dstArrayElement = 0;
+	write.dstArrayElement = texture->bindless_index;
 	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	write.descriptorCount = 1;
 	write.pImageInfo = &image_desc_info;
 
 	vkUpdateDescriptorSets (m_config.device, 1, &write, 0, nullptr);
+	return true;
+}
 
-	// Batched path: if inside a frame (BeginFrame was called), defer the upload.
-	// Immediate path: if outside a frame (e.g. during Initialize()), submit now.
-	// Image view and descriptor set are already created, so upload failures
-	// only lose pixel data — the texture object remains valid for cleanup.
-	const bool inside_frame = (m_current_cmd != VK_NULL_HANDLE);
-
-	if (inside_frame)
-	{
-		// Stage for batch upload — actual GPU copy happens in FlushPendingUploads()
-		m_staged_uploads.push_back ({texture->image, staging_buffer, staging_memory, source_dimensions});
-	}
-	else
-	{
-		// Legacy immediate submit — used during Initialize() for the white texture
-		VkCommandPoolCreateInfo pool_ci{};
-		pool_ci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		pool_ci.queueFamilyIndex = m_config.queue_family_index;
-		pool_ci.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-
-		VkCommandPool cmd_pool;
-		vkCreateCommandPool (m_config.device, &pool_ci, nullptr, &cmd_pool);
-
-		VkCommandBufferAllocateInfo cmd_alloc_info{};
-		cmd_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		cmd_alloc_info.commandPool = cmd_pool;
-		cmd_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		cmd_alloc_info.commandBufferCount = 1;
-
+void RenderInterface_VK::UploadTexturePixels (TextureData *texture, const Rml::byte *pixels)
+{
+	// Goes through the engine's staging buffers like TexMgr uploads. Staging command
+	// buffers are submitted in order ahead of the frame command buffers by
+	// GL_EndRenderingTask, so the image is ready for the first frame that samples it,
+	// even if the bands end up in different staging buffers, and nothing waits here.
+	const int row_size = texture->dimensions.x * 4;
+	const int band_rows = std::max (1, STAGING_UPLOAD_BAND_SIZE / row_size);
+	const int height = texture->dimensions.y;
+
+	for (int first_row = 0; first_row < height; first_row += band_rows)
+	{
+		const int		rows = std::min (band_rows, height - first_row);
+		const int		size = rows * row_size;
 		VkCommandBuffer cmd;
-		vkAllocateCommandBuffers (m_config.device, &cmd_alloc_info, &cmd);
-
-		VkCommandBufferBeginInfo begin_info{};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer (cmd, &begin_info);
+		VkBuffer		staging_buffer;
+		int				staging_offset;
+		unsigned char  *staging_memory = R_StagingAllocate (size, 4, &cmd, &staging_buffer, &staging_offset);
 
-		ImageBarrier (
-			cmd, texture->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		if (first_row == 0)
+			ImageBarrier (
+				cmd, texture->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
 		VkBufferImageCopy region{};
+		region.bufferOffset = static_cast<VkDeviceSize> (staging_offset);
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		region.imageSubresource.layerCount = 1;
-		region.imageExtent = {static_cast<uint32_t> (source_dimensions.x), static_cast<uint32_t> (source_dimensions.y), 1};
+		region.imageOffset = {0, first_row, 0};
+		region.imageExtent = {static_cast<uint32_t> (texture->dimensions.x), static_cast<uint32_t> (rows), 1};
 		vkCmdCopyBufferToImage (cmd, staging_buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-		ImageBarrier (
-			cmd, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-
-		vkEndCommandBuffer (cmd);
-
-		VkFenceCreateInfo fence_ci{};
-		fence_ci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		VkFence upload_fence;
-		if (vkCreateFence (m_config.device, &fence_ci, nullptr, &upload_fence) != VK_SUCCESS)
-		{
-			vkDestroyCommandPool (m_config.device, cmd_pool, nullptr);
-			DestroyTexture (texture);
-			m_image_pool.Free (texture->memory_alloc);
-			DestroyBuffer (staging_buffer, staging_memory);
-			delete texture;
-			return 0;
-		}
-
-		VkSubmitInfo submit_info{};
-		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &cmd;
-
-		if (vkQueueSubmit (m_config.graphics_queue, 1, &submit_info, upload_fence) != VK_SUCCESS)
-		{
-			vkDestroyFence (m_config.device, upload_fence, nullptr);
-			vkDestroyCommandPool (m_config.device, cmd_pool, nullptr);
-			DestroyTexture (texture);
-			m_image_pool.Free (texture->memory_alloc);
-			DestroyBuffer (staging_buffer, staging_memory);
-			delete texture;
-			return 0;
-		}
+		if (first_row + rows == height)
+			ImageBarrier (
+				cmd, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
-		m_pending_uploads.push_back ({upload_fence, cmd_pool, staging_buffer, staging_memory});
+		R_StagingBeginCopy ();
+		memcpy (staging_memory, pixels + static_cast<size_t> (first_row) * row_size, size);
+		R_StagingEndCopy ();
 	}
-
-	Rml::TextureHandle handle = m_next_texture_handle++;
-	m_textures[handle] = texture;
-	return handle;
 }
 
 void RenderInterface_VK::ReleaseTexture (Rml::TextureHandle texture_handle)
 {
-	auto it = m_textures.find (texture_handle);
-	if (it == m_textures.end ())
+	TextureData *texture = m_textures.Get (texture_handle);
+	if (!texture)
 		return;
 
-	TextureData *texture = it->second;
-
 	// Don't delete the white texture - it's needed for the lifetime of the renderer
 	if (texture == m_white_texture)
 	{
@@ -828,8 +1205,7 @@ void RenderInterface_VK::ReleaseTexture (Rml::TextureHandle texture_handle)
 
 	// Queue for deferred destruction - the texture may still be referenced
 	// by in-flight command buffers
-	m_texture_garbage[m_garbage_index].push_back (texture);
-	m_textures.erase (it);
+	m_texture_garbage[m_garbage_index].push_back (m_textures.Retire (texture_handle));
 }
 
 void RenderInterface_VK::EnableScissorRegion (bool enable)
@@ -857,111 +1233,95 @@ void RenderInterface_VK::SetTransform (const Rml::Matrix4f *transform)
 		m_transform = Rml::Matrix4f::Identity ();
 		m_transform_enabled = false;
 	}
+	UpdateMvp ();
 }
 
-// ── Batch Upload (L3) ─────────────────────────────────────────────────────
+// ── Signed Distance Shapes ────────────────────────────────────────────────
 
-void RenderInterface_VK::FlushPendingUploads ()
+Rml::CompiledShaderHandle RenderInterface_VK::CompileShader (const Rml::String &name, const Rml::Dictionary &parameters)
 {
-	if (m_staged_uploads.empty ())
-		return;
-
-	// Wait for previous batch to complete and free its staging buffers
-	if (m_upload_fence_pending)
-	{
-		vkWaitForFences (m_config.device, 1, &m_upload_fence, VK_TRUE, UINT64_MAX);
-		FreePrevBatchStaging ();
-		m_upload_fence_pending = false;
-	}
-
-	vkResetFences (m_config.device, 1, &m_upload_fence);
-	vkResetCommandPool (m_config.device, m_upload_cmd_pool, 0);
-
-	VkCommandBufferAllocateInfo alloc_info{};
-	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	alloc_info.commandPool = m_upload_cmd_pool;
-	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	alloc_info.commandBufferCount = 1;
+	// Other shaders, e.g. the RCSS gradients, are unsupported like before and not drawn
+	if (name != "sdf-shape")
+		return 0;
 
-	VkCommandBuffer cmd;
-	if (vkAllocateCommandBuffers (m_config.device, &alloc_info, &cmd) != VK_SUCCESS)
+	Rml::CompiledShaderHandle handle;
+	ShapeData				 *shape = m_shapes.Acquire (handle);
+	if (!shape)
 	{
-		Rml::Log::Message (Rml::Log::LT_ERROR, "FlushPendingUploads: vkAllocateCommandBuffers failed");
-		goto flush_fail;
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Out of shape handles (%u)", SlotMap<ShapeData>::MAX_SLOTS);
+		return 0;
 	}
 
-	{
-		VkCommandBufferBeginInfo begin_info{};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		if (vkBeginCommandBuffer (cmd, &begin_info) != VK_SUCCESS)
-		{
-			Rml::Log::Message (Rml::Log::LT_ERROR, "FlushPendingUploads: vkBeginCommandBuffer failed");
-			goto flush_fail;
-		}
-
-		for (auto &staged : m_staged_uploads)
-		{
-			// Barrier: UNDEFINED → TRANSFER_DST_OPTIMAL
-			ImageBarrier (
-				cmd, staged.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-
-			VkBufferImageCopy region{};
-			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.layerCount = 1;
-			region.imageExtent = {static_cast<uint32_t> (staged.dimensions.x), static_cast<uint32_t> (staged.dimensions.y), 1};
-			vkCmdCopyBufferToImage (cmd, staged.staging_buffer, staged.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	const Rml::Vector2f half_size = Rml::Get (parameters, "half_size", Rml::Vector2f (0.0f));
+	const Rml::Vector4f color = Rml::Get (parameters, "color", Rml::Vector4f (0.0f));
+	const Rml::Vector4f params = Rml::Get (parameters, "params", Rml::Vector4f (0.0f));
+	const Rml::Vector2f axis = Rml::Get (parameters, "axis", Rml::Vector2f (0.0f, -1.0f));
+	shape->half_size[0] = half_size.x;
+	shape->half_size[1] = half_size.y;
+	memcpy (shape->color, &color.x, sizeof (shape->color));
+	memcpy (shape->params, &params.x, sizeof (shape->params));
+	shape->axis[0] = axis.x;
+	shape->axis[1] = axis.y;
+	shape->shape = static_cast<uint32_t> (Rml::Get (parameters, "shape", 0));
+	return handle;
+}
 
-			// Barrier: TRANSFER_DST_OPTIMAL → SHADER_READ_ONLY_OPTIMAL
-			ImageBarrier (
-				cmd, staged.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-		}
+void RenderInterface_VK::RenderShader (
+	Rml::CompiledShaderHandle shader_handle, Rml::CompiledGeometryHandle geometry_handle, Rml::Vector2f translation, Rml::TextureHandle texture_handle)
+{
+	(void)texture_handle;
+	if (m_current_cmd == VK_NULL_HANDLE)
+		return;
 
-		if (vkEndCommandBuffer (cmd) != VK_SUCCESS)
-		{
-			Rml::Log::Message (Rml::Log::LT_ERROR, "FlushPendingUploads: vkEndCommandBuffer failed");
-			goto flush_fail;
-		}
+	ShapeData	 *shape = m_shapes.Get (shader_handle);
+	GeometryData *geometry = m_geometries.Get (geometry_handle);
+	if (!shape || !geometry)
+		return;
 
-		VkSubmitInfo submit_info{};
-		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &cmd;
+	// The quad is drawn with its own translation and never merged, so it skips the
+	// transient stage that only the batches read from
+	if (geometry->transient && !UploadGeometry (geometry, geometry->cpu_vertices.data (), geometry->cpu_indices.data ()))
+		return;
 
-		if (vkQueueSubmit (m_config.graphics_queue, 1, &submit_info, m_upload_fence) != VK_SUCCESS)
+	const VkRect2D scissor = GetScissor ();
+	if (m_layer_recording)
+	{
+		struct
 		{
-			Rml::Log::Message (Rml::Log::LT_ERROR, "FlushPendingUploads: vkQueueSubmit failed");
-			goto flush_fail;
-		}
+			uint64_t  geometry;
+			ShapeData shape;
+			float	  translation[2];
+			VkRect2D  scissor;
+		} key;
+		memset (&key, 0, sizeof (key));
+		key.geometry = geometry_handle;
+		key.shape = *shape;
+		key.translation[0] = translation.x;
+		key.translation[1] = translation.y;
+		key.scissor = scissor;
+		HashLayer (&key, sizeof (key));
+		m_layer_draws++;
+
+		assert (!m_layer_mvps.empty () && "Layer draw without a transform");
+		m_layer_list.push_back ({geometry, m_white_texture, translation, scissor, static_cast<uint32_t> (m_layer_mvps.size () - 1), shape});
+		return;
 	}
 
-	// Move staging buffers to prev-batch for deferred cleanup
-	for (auto &staged : m_staged_uploads)
-		m_prev_batch_staging.emplace_back (staged.staging_buffer, staged.staging_memory);
-	m_staged_uploads.clear ();
-	m_upload_fence_pending = true;
-	return;
-
-flush_fail:
-	// On failure the fence was never signaled, so free staging buffers directly
-	// and do NOT set m_upload_fence_pending (would deadlock next frame).
-	// The images themselves are valid — they have memory, views, and descriptors
-	// (thanks to GenerateTexture reorder) but will lack pixel data until
-	// RmlUI regenerates them.
-	for (auto &staged : m_staged_uploads)
-		DestroyBuffer (staged.staging_buffer, staged.staging_memory);
-	m_staged_uploads.clear ();
+	DrawShape (geometry, shape, translation, scissor);
 }
 
-void RenderInterface_VK::FreePrevBatchStaging ()
+void RenderInterface_VK::ReleaseShader (Rml::CompiledShaderHandle shader_handle)
 {
-	for (auto &pair : m_prev_batch_staging)
-		DestroyBuffer (pair.first, pair.second);
-	m_prev_batch_staging.clear ();
+	const uint32_t index = m_shapes.Retire (shader_handle);
+	if (index == UINT32_MAX)
+		return;
+
+	// Layer draws captured this frame may still point at it
+	m_shape_garbage[m_garbage_index].push_back (index);
 }
 
+// ── Batch Upload (L3) ─────────────────────────────────────────────────────
+
 // ── Sync2-Aware Barrier Helper (H1) ──────────────────────────────────────
 
 void RenderInterface_VK::ImageBarrier (
@@ -1038,6 +1398,302 @@ double RenderInterface_VK::GetLastFrameGpuTimeMs () const
 	return m_last_gpu_time_ms;
 }
 
+// ── Offscreen Layer Cache ─────────────────────────────────────────────────
+
+void RenderInterface_VK::HashLayer (const void *data, size_t size)
+{
+	// FNV-1a, only compared against the hash of an earlier frame
+	const uint8_t *bytes = static_cast<const uint8_t *> (data);
+	for (size_t i = 0; i < size; ++i)
+		m_layer_hash = (m_layer_hash ^ bytes[i]) * 0x100000001b3ULL;
+}
+
+bool RenderInterface_VK::CreateLayer (int width, int height)
+{
+	DestroyLayer ();
+
+	if (!m_config.dynamic_rendering && m_layer_render_pass == VK_NULL_HANDLE)
+	{
+		// Compatible with the GUI render pass, so the same pipeline draws into both
+		VkAttachmentDescription attachment{};
+		attachment.format = m_config.color_format;
+		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference color_ref{};
+		color_ref.attachment = 0;
+		color_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &color_ref;
+
+		// The previous GUI pass may still be sampling the layer
+		VkSubpassDependency dependencies[2]{};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo render_pass_info{};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = 1;
+		render_pass_info.pAttachments = &attachment;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+		render_pass_info.dependencyCount = 2;
+		render_pass_info.pDependencies = dependencies;
+
+		if (vkCreateRenderPass (m_config.device, &render_pass_info, nullptr, &m_layer_render_pass) != VK_SUCCESS)
+		{
+			m_layer_render_pass = VK_NULL_HANDLE;
+			return false;
+		}
+	}
+
+	// Only the UI task records into these, one per garbage slot so a buffer is only
+	// reset after the frame that may have executed it has finished
+	if (m_layer_cmd_pool == VK_NULL_HANDLE)
+	{
+		VkCommandPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		pool_info.queueFamilyIndex = m_config.queue_family_index;
+		if (vkCreateCommandPool (m_config.device, &pool_info, nullptr, &m_layer_cmd_pool) != VK_SUCCESS)
+		{
+			m_layer_cmd_pool = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkCommandBufferAllocateInfo cmd_alloc_info{};
+		cmd_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmd_alloc_info.commandPool = m_layer_cmd_pool;
+		cmd_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		cmd_alloc_info.commandBufferCount = GARBAGE_SLOTS;
+		if (vkAllocateCommandBuffers (m_config.device, &cmd_alloc_info, m_layer_cmds) != VK_SUCCESS)
+		{
+			vkDestroyCommandPool (m_config.device, m_layer_cmd_pool, nullptr);
+			m_layer_cmd_pool = VK_NULL_HANDLE;
+			return false;
+		}
+	}
+
+	TextureData *texture = m_textures.Acquire (m_layer_texture);
+	if (!texture)
+		return false;
+	*texture = TextureData{};
+	texture->dimensions = Rml::Vector2i (width, height);
+	if (!CreateTextureResources (texture, m_config.color_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT))
+	{
+		m_textures.Discard (m_layer_texture);
+		m_layer_texture = 0;
+		return false;
+	}
+
+	if (!m_config.dynamic_rendering)
+	{
+		VkFramebufferCreateInfo framebuffer_info{};
+		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebuffer_info.renderPass = m_layer_render_pass;
+		framebuffer_info.attachmentCount = 1;
+		framebuffer_info.pAttachments = &texture->view;
+		framebuffer_info.width = static_cast<uint32_t> (width);
+		framebuffer_info.height = static_cast<uint32_t> (height);
+		framebuffer_info.layers = 1;
+		if (vkCreateFramebuffer (m_config.device, &framebuffer_info, nullptr, &texture->framebuffer) != VK_SUCCESS)
+		{
+			texture->framebuffer = VK_NULL_HANDLE;
+			DestroyLayer ();
+			return false;
+		}
+	}
+
+	// Texel centers line up with the pixels, so the linear sampler returns them unfiltered
+	const float						 w = static_cast<float> (width);
+	const float						 h = static_cast<float> (height);
+	const Rml::ColourbPremultiplied white (255, 255, 255, 255);
+	const Rml::Vertex				 vertices[4] = {
+		 {{0.0f, 0.0f}, white, {0.0f, 0.0f}}, {{w, 0.0f}, white, {1.0f, 0.0f}}, {{w, h}, white, {1.0f, 1.0f}}, {{0.0f, h}, white, {0.0f, 1.0f}}};
+	const int indices[6] = {0, 1, 2, 0, 2, 3};
+	m_layer_quad = CompileGeometry (Rml::Span<const Rml::Vertex> (vertices, 4), Rml::Span<const int> (indices, 6));
+	if (!m_layer_quad)
+	{
+		DestroyLayer ();
+		return false;
+	}
+
+	m_layer_width = width;
+	m_layer_height = height;
+	return true;
+}
+
+void RenderInterface_VK::DestroyLayer ()
+{
+	// Through the garbage slots, the last frames may still sample the layer
+	if (m_layer_texture)
+		ReleaseTexture (m_layer_texture);
+	if (m_layer_quad)
+		ReleaseGeometry (m_layer_quad);
+	m_layer_texture = 0;
+	m_layer_quad = 0;
+	m_layer_width = 0;
+	m_layer_height = 0;
+	m_layer_submit_cmd = VK_NULL_HANDLE;
+	m_layer_valid = false;
+}
+
+bool RenderInterface_VK::BeginLayer (int width, int height)
+{
+	// Pipelines for the GUI render pass are only compatible with subpass 0 of the layer pass
+	if (!m_config.dynamic_rendering && m_config.subpass != 0)
+		return false;
+	if (m_config.dynamic_rendering && (!m_config.cmd_begin_rendering || !m_config.cmd_end_rendering))
+		return false;
+	if ((width != m_layer_width || height != m_layer_height || !m_layer_texture) && !CreateLayer (width, height))
+		return false;
+
+	const VkRect2D render_area = {{0, 0}, {static_cast<uint32_t> (width), static_cast<uint32_t> (height)}};
+	m_layer_recording = true;
+	m_layer_draws = 0;
+	m_layer_hash = 0xcbf29ce484222325ULL;
+	m_layer_list.clear ();
+	m_layer_mvps.clear ();
+	HashLayer (&render_area, sizeof (render_area));
+	return true;
+}
+
+void RenderInterface_VK::EndLayer ()
+{
+	m_layer_recording = false;
+	m_layer_last_draws = m_layer_draws;
+	m_layer_last_hash = m_layer_hash;
+
+	// Nothing to draw leaves the image alone, it is simply not composited. An unchanged
+	// frame reuses the image without recording a single command.
+	if (m_layer_draws > 0 && (!m_layer_valid || m_layer_hash != m_layer_contents_hash))
+	{
+		if (!RecordLayer ())
+		{
+			m_layer_draws = 0;
+			m_layer_last_draws = 0;
+			return;
+		}
+		m_layer_submit_cmd = m_layer_cmds[m_garbage_index];
+		m_layer_submit_hash = m_layer_hash;
+	}
+}
+
+bool RenderInterface_VK::RecordLayer ()
+{
+	TextureData	   *texture = m_textures.Get (m_layer_texture);
+	VkCommandBuffer cmd = m_layer_cmds[m_garbage_index];
+
+	VkCommandBufferInheritanceInfo inheritance_info{};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_info.pInheritanceInfo = &inheritance_info;
+	if (vkBeginCommandBuffer (cmd, &begin_info) != VK_SUCCESS)
+		return false;
+
+	VkClearValue clear_value{};
+	const VkRect2D render_area = {{0, 0}, {static_cast<uint32_t> (m_layer_width), static_cast<uint32_t> (m_layer_height)}};
+	if (m_config.dynamic_rendering)
+	{
+		ImageBarrier (
+			cmd, texture->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+		VkRenderingAttachmentInfoKHR color_attachment{};
+		color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		color_attachment.imageView = texture->view;
+		color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.clearValue = clear_value;
+
+		VkRenderingInfoKHR rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		rendering_info.renderArea = render_area;
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &color_attachment;
+		m_config.cmd_begin_rendering (cmd, &rendering_info);
+	}
+	else
+	{
+		VkRenderPassBeginInfo render_pass_begin_info{};
+		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_begin_info.renderPass = m_layer_render_pass;
+		render_pass_begin_info.framebuffer = texture->framebuffer;
+		render_pass_begin_info.renderArea = render_area;
+		render_pass_begin_info.clearValueCount = 1;
+		render_pass_begin_info.pClearValues = &clear_value;
+		vkCmdBeginRenderPass (cmd, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	// Dynamic state is not inherited by secondary command buffers
+	VkViewport viewport{};
+	viewport.width = static_cast<float> (m_layer_width);
+	viewport.height = static_cast<float> (m_layer_height);
+	viewport.maxDepth = 1.0f;
+	auto set_viewport = m_config.cmd_set_viewport ? m_config.cmd_set_viewport : vkCmdSetViewport;
+	set_viewport (cmd, 0, 1, &viewport);
+
+	// Replay the captured draws through the usual batching
+	const VkCommandBuffer frame_cmd = m_current_cmd;
+	const Rml::Matrix4f	  mvp = m_mvp;
+	uint32_t			  bound_mvp = UINT32_MAX;
+	m_current_cmd = cmd;
+	ResetBoundState ();
+	for (const LayerDraw &draw : m_layer_list)
+	{
+		if (draw.mvp != bound_mvp)
+		{
+			m_mvp = m_layer_mvps[draw.mvp];
+			m_transform_id++;
+			bound_mvp = draw.mvp;
+		}
+		if (draw.shape)
+			DrawShape (draw.geometry, draw.shape, draw.translation, draw.scissor);
+		else
+			QueueGeometry (draw.geometry, draw.texture, draw.translation, draw.scissor);
+	}
+	FlushBatch ();
+	m_current_cmd = frame_cmd;
+	m_mvp = mvp;
+	m_transform_id++;
+	ResetBoundState ();
+
+	if (m_config.dynamic_rendering)
+	{
+		m_config.cmd_end_rendering (cmd);
+		ImageBarrier (
+			cmd, texture->image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+	else
+		vkCmdEndRenderPass (cmd);
+
+	return vkEndCommandBuffer (cmd) == VK_SUCCESS;
+}
+
 // ── Pipeline Creation Dual Path (H2) ─────────────────────────────────────
 
 bool RenderInterface_VK::CreateDescriptorSetLayout ()
@@ -1045,7 +1701,7 @@ bool RenderInterface_VK::CreateDescriptorSetLayout ()
 	VkDescriptorSetLayoutBinding binding{};
 	binding.binding = 0;
 	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	binding.descriptorCount = 1;
+	binding.descriptorCount = m_bindless ? BINDLESS_MAX_TEXTURES : 1;
 	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 	VkDescriptorSetLayoutCreateInfo layout_info{};
@@ -1053,6 +1709,19 @@ bool RenderInterface_VK::CreateDescriptorSetLayout ()
 	layout_info.bindingCount = 1;
 	layout_info.pBindings = &binding;
 
+	// Textures are written while the set is bound in recorded or pending command buffers
+	const VkDescriptorBindingFlagsEXT binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+													  VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info{};
+	binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	binding_flags_info.bindingCount = 1;
+	binding_flags_info.pBindingFlags = &binding_flags;
+	if (m_bindless)
+	{
+		layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		layout_info.pNext = &binding_flags_info;
+	}
+
 	return vkCreateDescriptorSetLayout (m_config.device, &layout_info, nullptr, &m_texture_set_layout) == VK_SUCCESS;
 }
 
@@ -1069,7 +1738,29 @@ bool RenderInterface_VK::CreateDescriptorPool ()
 	pool_info.pPoolSizes = &pool_size;
 	pool_info.maxSets = 1000;
 
-	return vkCreateDescriptorPool (m_config.device, &pool_info, nullptr, &m_descriptor_pool) == VK_SUCCESS;
+	// Bindless: a single set holding the whole texture array, allocated once
+	if (m_bindless)
+	{
+		pool_size.descriptorCount = BINDLESS_MAX_TEXTURES;
+		pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		pool_info.maxSets = 1;
+	}
+
+	if (vkCreateDescriptorPool (m_config.device, &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS)
+		return false;
+
+	if (m_bindless)
+	{
+		VkDescriptorSetAllocateInfo desc_alloc_info{};
+		desc_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		desc_alloc_info.descriptorPool = m_descriptor_pool;
+		desc_alloc_info.descriptorSetCount = 1;
+		desc_alloc_info.pSetLayouts = &m_texture_set_layout;
+		if (vkAllocateDescriptorSets (m_config.device, &desc_alloc_info, &m_bindless_set) != VK_SUCCESS)
+			return false;
+	}
+
+	return true;
 }
 
 bool RenderInterface_VK::CreateSampler ()
@@ -1093,11 +1784,12 @@ bool RenderInterface_VK::CreateSampler ()
 
 bool RenderInterface_VK::CreatePipeline ()
 {
-	// Push constant range for transform matrix and translation
+	// Push constant range for transform matrix and translation, plus the texture index on the bindless path.
+	// Sized for the shape pipeline, which shares the layout.
 	VkPushConstantRange push_constant_range{};
-	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	push_constant_range.stageFlags = m_push_constant_stages;
 	push_constant_range.offset = 0;
-	push_constant_range.size = sizeof (PushConstants);
+	push_constant_range.size = sizeof (ShapePushConstants);
 
 	// Pipeline layout
 	VkPipelineLayoutCreateInfo layout_info{};
@@ -1127,8 +1819,8 @@ bool RenderInterface_VK::CreatePipeline ()
 
 	VkShaderModuleCreateInfo frag_info{};
 	frag_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	frag_info.codeSize = rmlui_frag_spv_len;
-	frag_info.pCode = reinterpret_cast<const uint32_t *> (rmlui_frag_spv);
+	frag_info.codeSize = m_bindless ? rmlui_bindless_frag_spv_len : rmlui_frag_spv_len;
+	frag_info.pCode = reinterpret_cast<const uint32_t *> (m_bindless ? rmlui_bindless_frag_spv : rmlui_frag_spv);
 
 	VkShaderModule frag_module;
 	if (vkCreateShaderModule (m_config.device, &frag_info, nullptr, &frag_module) != VK_SUCCESS)
@@ -1283,71 +1975,75 @@ bool RenderInterface_VK::CreatePipeline ()
 	vkDestroyShaderModule (m_config.device, vert_module, nullptr);
 	vkDestroyShaderModule (m_config.device, frag_module, nullptr);
 
-	return true;
-}
-
-VkBuffer RenderInterface_VK::CreateBuffer (VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory &memory)
-{
-	VkBuffer buffer;
-
-	VkBufferCreateInfo buffer_info{};
-	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	buffer_info.size = size;
-	buffer_info.usage = usage;
-	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-	if (vkCreateBuffer (m_config.device, &buffer_info, nullptr, &buffer) != VK_SUCCESS)
+	// Shape pipeline: same state, signed distance shaders that only read the quad positions
+	vert_info.codeSize = rmlui_shape_vert_spv_len;
+	vert_info.pCode = reinterpret_cast<const uint32_t *> (rmlui_shape_vert_spv);
+	if (vkCreateShaderModule (m_config.device, &vert_info, nullptr, &vert_module) != VK_SUCCESS)
 	{
-		return VK_NULL_HANDLE;
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Failed to create shape vertex shader module");
+		return false;
 	}
-
-	VkMemoryRequirements mem_reqs;
-	vkGetBufferMemoryRequirements (m_config.device, buffer, &mem_reqs);
-
-	VkMemoryAllocateInfo alloc_info{};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = mem_reqs.size;
-	alloc_info.memoryTypeIndex = FindMemoryType (mem_reqs.memoryTypeBits, properties);
-	if (alloc_info.memoryTypeIndex == UINT32_MAX)
+	frag_info.codeSize = rmlui_shape_frag_spv_len;
+	frag_info.pCode = reinterpret_cast<const uint32_t *> (rmlui_shape_frag_spv);
+	if (vkCreateShaderModule (m_config.device, &frag_info, nullptr, &frag_module) != VK_SUCCESS)
 	{
-		Rml::Log::Message (Rml::Log::LT_WARNING, "CreateBuffer: no suitable memory type");
-		vkDestroyBuffer (m_config.device, buffer, nullptr);
-		return VK_NULL_HANDLE;
+		vkDestroyShaderModule (m_config.device, vert_module, nullptr);
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Failed to create shape fragment shader module");
+		return false;
 	}
+	stages[0].module = vert_module;
+	stages[1].module = frag_module;
+	vertex_input.vertexAttributeDescriptionCount = 1;
 
-	if (vkAllocateMemory (m_config.device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+	const VkResult shape_result = vkCreateGraphicsPipelines (m_config.device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline_shape);
+	vkDestroyShaderModule (m_config.device, vert_module, nullptr);
+	vkDestroyShaderModule (m_config.device, frag_module, nullptr);
+	if (shape_result != VK_SUCCESS)
 	{
-		vkDestroyBuffer (m_config.device, buffer, nullptr);
-		return VK_NULL_HANDLE;
+		Rml::Log::Message (Rml::Log::LT_ERROR, "Failed to create shape pipeline");
+		return false;
 	}
 
-	vkBindBufferMemory (m_config.device, buffer, memory, 0);
-	return buffer;
-}
-
-uint32_t RenderInterface_VK::FindMemoryType (uint32_t type_filter, VkMemoryPropertyFlags properties)
-{
-	return FindVulkanMemoryType (m_config.memory_properties, type_filter, properties);
+	return true;
 }
 
-void RenderInterface_VK::DestroyBuffer (VkBuffer buffer, VkDeviceMemory memory)
+bool RenderInterface_VK::AllocateBindlessIndex (uint32_t &index)
 {
-	if (buffer != VK_NULL_HANDLE)
+	if (!m_free_bindless_indices.empty ())
 	{
-		vkDestroyBuffer (m_config.device, buffer, nullptr);
+		index = m_free_bindless_indices.back ();
+		m_free_bindless_indices.pop_back ();
+		return true;
 	}
-	if (memory != VK_NULL_HANDLE)
+	if (m_next_bindless_index < BINDLESS_MAX_TEXTURES)
 	{
-		vkFreeMemory (m_config.device, memory, nullptr);
+		index = m_next_bindless_index++;
+		return true;
 	}
+	Rml::Log::Message (Rml::Log::LT_ERROR, "Out of bindless texture slots (%u)", BINDLESS_MAX_TEXTURES);
+	return false;
 }
 
 void RenderInterface_VK::DestroyTexture (TextureData *texture)
 {
-	if (texture->descriptor_set != VK_NULL_HANDLE)
+	// A texture that never finished streaming only borrowed the white texture's descriptor
+	if (texture->streaming)
+		return;
+	if (m_bindless)
+	{
+		// The array element stays written but unused until the index is handed out again,
+		// which partially bound descriptors allow
+		if (texture->descriptor_set != VK_NULL_HANDLE)
+			m_free_bindless_indices.push_back (texture->bindless_index);
+	}
+	else if (texture->descriptor_set != VK_NULL_HANDLE)
 	{
 		vkFreeDescriptorSets (m_config.device, m_descriptor_pool, 1, &texture->descriptor_set);
 	}
+	if (texture->framebuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyFramebuffer (m_config.device, texture->framebuffer, nullptr);
+	}
 	if (texture->view != VK_NULL_HANDLE)
 	{
 		vkDestroyImageView (m_config.device, texture->view, nullptr);
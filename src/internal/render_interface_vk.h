@@ -11,8 +11,9 @@
 #include <RmlUi/Core/RenderInterface.h>
 #include <vulkan/vulkan.h>
 #include <vector>
-#include <unordered_map>
+#include <memory>
 #include "vk_allocator.h"
+#include "slot_map.h"
 
 // Forward declaration for vkQuake types
 struct cb_context_s;
@@ -47,6 +48,9 @@ struct VulkanConfig
 	// VK_KHR_dynamic_rendering (H2)
 	int dynamic_rendering;
 
+	// VK_EXT_descriptor_indexing with update-after-bind sampled images, enables the bindless texture path
+	int descriptor_indexing;
+
 	// Function pointers from vkQuake's dispatch table
 	PFN_vkCmdBindPipeline		cmd_bind_pipeline;
 	PFN_vkCmdBindDescriptorSets cmd_bind_descriptor_sets;
@@ -57,6 +61,10 @@ struct VulkanConfig
 	PFN_vkCmdPushConstants		cmd_push_constants;
 	PFN_vkCmdSetScissor			cmd_set_scissor;
 	PFN_vkCmdSetViewport		cmd_set_viewport;
+
+	// VK_KHR_dynamic_rendering entry points for the offscreen layer pass, NULL without dynamic rendering
+	PFN_vkCmdBeginRenderingKHR cmd_begin_rendering;
+	PFN_vkCmdEndRenderingKHR   cmd_end_rendering;
 };
 
 class RenderInterface_VK : public Rml::RenderInterface
@@ -80,6 +88,14 @@ class RenderInterface_VK : public Rml::RenderInterface
 	void BeginFrame (VkCommandBuffer cmd, int width, int height);
 	void EndFrame ();
 
+	// Split frame for recording away from the GUI command buffer, e.g. in a task that
+	// runs along the world: BeginLayerFrame() starts a frame drawing into the layer only,
+	// EndFrame() closes it and CompositeLayer() later draws the result into cmd. False if
+	// the layer cache is off or unusable, nothing was started then and the frame has to
+	// go through BeginFrame().
+	bool BeginLayerFrame (int width, int height);
+	void CompositeLayer (VkCommandBuffer cmd);
+
 	// Per-frame render stats (reset in BeginFrame)
 	uint32_t GetFrameDrawCalls () const
 	{
@@ -89,10 +105,28 @@ class RenderInterface_VK : public Rml::RenderInterface
 	{
 		return m_frame_indices;
 	}
+	uint32_t GetFrameCompiledGeometry () const
+	{
+		return m_frame_compiled_geometry;
+	}
+	uint32_t GetFrameCompiledVertices () const
+	{
+		return m_frame_compiled_vertices;
+	}
 
 	// Garbage collection - call after GPU fence wait to safely destroy resources
 	void CollectGarbage ();
 
+	// Secondary command buffer rendering this frame's RmlUI layer, to be executed by the
+	// engine outside of any render pass before the GUI pass. VK_NULL_HANDLE if the layer
+	// from an earlier frame is reused or the layer cache is off. Clears the pending buffer.
+	VkCommandBuffer TakeLayerCommandBuffer ();
+
+	// Composites the previous frame's layer image again instead of drawing, for frames
+	// in which RmlUI was not updated. False if there is no such image, e.g. the layer
+	// cache is off or was resized, then the frame has to be drawn.
+	bool ReuseLayer ();
+
 	// GPU timestamp instrumentation (L4) — called from engine around UI render pass
 	void   WriteBeginTimestamp (VkCommandBuffer primary_cb);
 	void   WriteEndTimestamp (VkCommandBuffer primary_cb);
@@ -116,13 +150,41 @@ class RenderInterface_VK : public Rml::RenderInterface
 
 	void SetTransform (const Rml::Matrix4f *transform) override;
 
+	// Only "sdf-shape" is supported: a signed distance shape drawn over the geometry, which
+	// is expected to be a quad with corners in [-1, 1]. Parameters are "shape" (int),
+	// "half_size" (Vector2f), "color" (premultiplied Vector4f), "params" (Vector4f) and
+	// "axis" (Vector2f), see Shaders/rmlui_shape.frag for their meaning.
+	Rml::CompiledShaderHandle CompileShader (const Rml::String &name, const Rml::Dictionary &parameters) override;
+	void RenderShader (Rml::CompiledShaderHandle shader, Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation, Rml::TextureHandle texture) override;
+	void ReleaseShader (Rml::CompiledShaderHandle shader) override;
+
   private:
 	// Internal geometry data — uses pool-based buffer allocations
+	// vertex_offset/first_index address the data relative to the start of its pool chunk
+	// so consecutive draws from one chunk share the same vertex/index buffer bindings.
+	// Small geometry starts out transient: it only has the CPU copy and is written to the
+	// per frame ring when drawn. Once it was drawn in TRANSIENT_PROMOTE_FRAMES frames it is
+	// considered long-lived and uploaded to the free-list allocator.
 	struct GeometryData
 	{
-		BufferAllocation vertex_alloc;
-		BufferAllocation index_alloc;
-		int				 num_indices;
+		BufferAllocation		 vertex_alloc; // empty while transient
+		BufferAllocation		 index_alloc;
+		int						 num_vertices;
+		int						 num_indices;
+		int32_t					 vertex_offset;
+		uint32_t				 first_index;
+		std::vector<Rml::Vertex> cpu_vertices; // only for geometry small enough to be merged
+		std::vector<int>		 cpu_indices;
+		bool					 transient;
+		uint32_t				 frames_drawn;
+		uint32_t				 last_drawn_frame;
+	};
+
+	// Geometry queued into the pending batch, see FlushBatch()
+	struct BatchEntry
+	{
+		GeometryData *geometry;
+		Rml::Vector2f translation;
 	};
 
 	// Internal texture data — uses pool-based image memory allocations
@@ -132,36 +194,72 @@ class RenderInterface_VK : public Rml::RenderInterface
 		VkImageView			  view;
 		VkSampler			  sampler;
 		ImageMemoryAllocation memory_alloc;
-		VkDescriptorSet		  descriptor_set;
+		VkDescriptorSet		  descriptor_set; // m_bindless_set on the bindless path
+		uint32_t			  bindless_index; // array element in m_bindless_set, 0 otherwise
+		VkFramebuffer		  framebuffer;	  // render targets on the render pass path only
 		Rml::Vector2i		  dimensions;
+		bool				  streaming; // still decoding, borrows the white texture's descriptor
+	};
+
+	// Compiled "sdf-shape" shader. Nothing of it lives on the GPU, the values only end up in
+	// the push constants, so recompiling a shape every frame is cheap.
+	struct ShapeData
+	{
+		float	 half_size[2];
+		float	 color[4];
+		float	 params[4];
+		float	 axis[2];
+		uint32_t shape;
 	};
 
-	// Pending async texture upload — fence tracks GPU completion (legacy immediate path)
-	struct PendingUpload
+	// Draw captured while the layer is recorded, replayed into the layer command buffer
+	// by RecordLayer(). mvp indexes m_layer_mvps.
+	struct LayerDraw
 	{
-		VkFence		   fence;
-		VkCommandPool  cmd_pool;
-		VkBuffer	   staging_buffer;
-		VkDeviceMemory staging_memory;
+		GeometryData *geometry;
+		TextureData	 *texture;
+		Rml::Vector2f translation;
+		VkRect2D	  scissor;
+		uint32_t	  mvp;
+		ShapeData	 *shape; // RenderShader() draw, nullptr for RenderGeometry()
 	};
 
-	// Staged upload — accumulated during GenerateTexture(), flushed in EndFrame()
-	struct StagedUpload
+	// Image file decoded on a task worker for LoadTexture(). The worker only touches
+	// the job, the texture is looked up again by handle once the decode has finished.
+	struct TextureDecodeJob
 	{
-		VkImage		   image;
-		VkBuffer	   staging_buffer;
-		VkDeviceMemory staging_memory;
-		Rml::Vector2i  dimensions;
+		std::vector<Rml::byte> file_data;
+		Rml::TextureHandle	   handle;
+		uint64_t			   task;   // task_handle_t
+		unsigned char		  *pixels; // RGBA, stbi_image_free()
+		int					   width;
+		int					   height;
 	};
 
-	// Push constant data for vertex shader
+	// Push constant data, texture_index is only read by the bindless fragment shader
 	struct PushConstants
 	{
-		float transform[16];
-		float translation[2];
-		float padding[2];
+		float	 transform[16];
+		float	 translation[2];
+		uint32_t texture_index;
+		uint32_t padding;
 	};
 
+	// Push constants of the shape pipeline, a superset of PushConstants that fills the
+	// 128 bytes every device supports. The pipeline layout covers this size.
+	struct ShapePushConstants
+	{
+		float	 transform[16];
+		float	 translation[2];
+		float	 half_size[2];
+		float	 color[4];
+		float	 params[4];
+		float	 axis[2];
+		uint32_t shape;
+		uint32_t padding;
+	};
+	static_assert (sizeof (ShapePushConstants) == 128, "Shape push constants exceed the guaranteed maxPushConstantsSize");
+
 	// Vulkan resource creation helpers
 	bool CreatePipeline ();
 	bool CreateDescriptorPool ();
@@ -169,20 +267,51 @@ class RenderInterface_VK : public Rml::RenderInterface
 	bool CreateSampler ();
 	void DestroyPipelines ();
 
-	// Batch upload helpers
-	void FlushPendingUploads ();
-	void FreePrevBatchStaging ();
+	// Draw batching — RenderGeometry() only queues, draws are recorded on state change
+	void QueueGeometry (GeometryData *geometry, TextureData *texture, Rml::Vector2f translation, const VkRect2D &scissor);
+	void FlushBatch ();
+	bool WriteBatchToStream ();
+	void DrawIndexed (VkBuffer vertex_buffer, VkBuffer index_buffer, uint32_t num_indices, uint32_t first_index, int32_t vertex_offset, Rml::Vector2f translation);
+	void DrawShape (GeometryData *geometry, const ShapeData *shape, Rml::Vector2f translation, const VkRect2D &scissor);
+	void BindBuffers (VkBuffer vertex_buffer, VkBuffer index_buffer);
+	void BindScissor (const VkRect2D &scissor);
+	VkRect2D GetScissor () const;
+	void ResetBoundState ();
+	void UpdateMvp ();
+
+	// Geometry storage
+	void RecycleGeometry (uint32_t index);
+	bool UploadGeometry (GeometryData *geometry, const Rml::Vertex *vertices, const int *indices);
+
+	// Texture creation and streaming
+	bool		CreateTextureResources (TextureData *texture, VkFormat format, VkImageUsageFlags usage);
+	void		UploadTexturePixels (TextureData *texture, const Rml::byte *pixels);
+
+	// Largest single R_StagingAllocate for texture data. Bigger images are copied in row
+	// bands so they never exceed the engine's staging buffer, which would make it flush
+	// and recreate all staging buffers.
+	static constexpr int STAGING_UPLOAD_BAND_SIZE = 4 * 1024 * 1024;
+	void		FinishTextureDecodes (bool wait);
+	static void DecodeTextureTask (void *payload);
 
 	// Sync2-aware barrier helper (H1)
 	void ImageBarrier (
 		VkCommandBuffer cmd, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access,
 		VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage);
 
-	VkBuffer CreateBuffer (VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory &memory);
-	uint32_t FindMemoryType (uint32_t type_filter, VkMemoryPropertyFlags properties);
-
-	void DestroyBuffer (VkBuffer buffer, VkDeviceMemory memory);
+	void StartFrame (int width, int height);
+	void SetViewport (VkCommandBuffer cmd);
 	void DestroyTexture (TextureData *texture);
+	bool AllocateBindlessIndex (uint32_t &index);
+
+	// Offscreen layer cache
+	bool CreateLayer (int width, int height);
+	void DestroyLayer ();
+	bool BeginLayer (int width, int height);
+	void EndLayer ();
+	bool RecordLayer ();
+	void DrawLayer (VkCommandBuffer cmd);
+	void HashLayer (const void *data, size_t size);
 
 	// Configuration from vkQuake
 	VulkanConfig m_config;
@@ -195,24 +324,66 @@ class RenderInterface_VK : public Rml::RenderInterface
 	VkRect2D		m_scissor_rect;
 	Rml::Matrix4f	m_transform;
 	bool			m_transform_enabled;
+	Rml::Matrix4f	m_mvp;			// projection * m_transform, updated in BeginFrame/SetTransform
+	uint32_t		m_transform_id; // bumped whenever m_mvp changes, part of the batch key
 	uint32_t		m_frame_draw_calls;
 	uint32_t		m_frame_indices;
+	uint32_t		m_frame_compiled_geometry;
+	uint32_t		m_frame_compiled_vertices;
+
+	// State last recorded into m_current_cmd, used to elide redundant binds
+	VkPipeline		m_bound_pipeline;
+	VkDescriptorSet m_bound_descriptor_set;
+	VkRect2D		m_bound_scissor;
+	bool			m_bound_scissor_valid;
+	VkBuffer		m_bound_vertex_buffer;
+	VkBuffer		m_bound_index_buffer;
+	PushConstants	m_bound_push_constants;
+	bool			m_bound_push_constants_valid;
+
+	// Pending batch — geometry sharing texture, scissor and transform in submission order.
+	// A single entry is drawn from its compiled buffers, several small entries are
+	// copied into the stream buffer and drawn with one vkCmdDrawIndexed.
+	static constexpr int	BATCH_MAX_GEOMETRY_VERTICES = 1024;
+	static constexpr int	BATCH_MAX_VERTICES = 16384;
+	std::vector<BatchEntry> m_batch;
+	VkDescriptorSet			m_batch_descriptor_set;
+	uint32_t				m_batch_texture_index;
+	VkRect2D				m_batch_scissor;
+	uint32_t				m_batch_transform_id;
+	int						m_batch_vertices;
+	int						m_batch_indices;
+
+	// Frames counted by BeginFrame, used to promote transient geometry
+	static constexpr uint32_t TRANSIENT_PROMOTE_FRAMES = 8;
+	uint32_t				  m_frame_index;
 
 	// Vulkan resources
 	VkPipeline			  m_pipeline_textured;
+	VkPipeline			  m_pipeline_shape; // Shaders/rmlui_shape.*, same layout
 	VkPipelineLayout	  m_pipeline_layout;
 	VkDescriptorPool	  m_descriptor_pool;
 	VkDescriptorSetLayout m_texture_set_layout;
 	VkSampler			  m_sampler;
+	VkShaderStageFlags	  m_push_constant_stages;
+
+	// Bindless path (VK_EXT_descriptor_indexing) — every texture is an element of one
+	// update-after-bind array, selected with texture_index in the push constants.
+	// Indices of destroyed textures are recycled, they went through the garbage slots first.
+	static constexpr uint32_t BINDLESS_MAX_TEXTURES = 1024; // matches Shaders/rmlui_bindless.frag
+	bool					  m_bindless;
+	VkDescriptorSet			  m_bindless_set;
+	std::vector<uint32_t>	  m_free_bindless_indices;
+	uint32_t				  m_next_bindless_index;
 
 	// Default white texture for untextured geometry
 	TextureData *m_white_texture;
 
 	// Resource tracking
-	std::unordered_map<Rml::CompiledGeometryHandle, GeometryData *> m_geometries;
-	std::unordered_map<Rml::TextureHandle, TextureData *>			m_textures;
-	Rml::CompiledGeometryHandle										m_next_geometry_handle;
-	Rml::TextureHandle												m_next_texture_handle;
+	// Released slots are recycled, so GeometryData keeps the capacity of its CPU copies
+	SlotMap<GeometryData> m_geometries;
+	SlotMap<TextureData>  m_textures;
+	SlotMap<ShapeData>	  m_shapes;
 
 	bool m_initialized;
 
@@ -220,15 +391,8 @@ class RenderInterface_VK : public Rml::RenderInterface
 	BufferPool		m_buffer_pool;
 	ImageMemoryPool m_image_pool;
 
-	// Async texture uploads pending GPU completion (legacy immediate path)
-	std::vector<PendingUpload> m_pending_uploads;
-
-	// Batch upload state — accumulates during GenerateTexture(), flushed in EndFrame()
-	std::vector<StagedUpload>						 m_staged_uploads;
-	VkCommandPool									 m_upload_cmd_pool;
-	VkFence											 m_upload_fence;
-	bool											 m_upload_fence_pending;
-	std::vector<std::pair<VkBuffer, VkDeviceMemory>> m_prev_batch_staging;
+	// LoadTexture() decodes in flight, finished ones are swapped in by BeginFrame()
+	std::vector<std::unique_ptr<TextureDecodeJob>> m_decode_jobs;
 
 	// GPU timestamp instrumentation (L4)
 	VkQueryPool m_timestamp_query_pool;
@@ -245,9 +409,36 @@ class RenderInterface_VK : public Rml::RenderInterface
 	// resources survive until the GPU is done with them.
 	static constexpr int GARBAGE_SLOTS = 2;
 	static_assert (GARBAGE_SLOTS >= 2, "Need at least 2 garbage slots for double-buffered frame pipelining");
-	int							m_garbage_index;
-	std::vector<GeometryData *> m_geometry_garbage[GARBAGE_SLOTS];
-	std::vector<TextureData *>	m_texture_garbage[GARBAGE_SLOTS];
+	static_assert (GARBAGE_SLOTS <= BufferPool::MAX_TRANSIENT_SLOTS, "Transient buffer memory is reclaimed per garbage slot");
+	int					  m_garbage_index;
+	std::vector<uint32_t> m_geometry_garbage[GARBAGE_SLOTS]; // retired slot indices
+	std::vector<uint32_t> m_texture_garbage[GARBAGE_SLOTS];
+	std::vector<uint32_t> m_shape_garbage[GARBAGE_SLOTS]; // may still be in m_layer_list
+
+	// Offscreen layer cache (ui_layer_cache). RmlUI draws are captured into m_layer_list
+	// and hashed, then recorded into a secondary command buffer that renders
+	// m_layer_texture. The engine's GUI command buffer only gets one quad sampling the
+	// layer. A frame whose hash matches the layer contents records nothing at all and the
+	// image is reused.
+	VkRenderPass				m_layer_render_pass; // render pass path only
+	VkCommandPool				m_layer_cmd_pool;
+	VkCommandBuffer				m_layer_cmds[GARBAGE_SLOTS];
+	Rml::TextureHandle			m_layer_texture;
+	Rml::CompiledGeometryHandle m_layer_quad;
+	int							m_layer_width;
+	int							m_layer_height;
+	VkCommandBuffer				m_gui_cmd;			  // engine command buffer while the layer is recorded
+	bool						m_layer_recording;	  // m_current_cmd is a layer command buffer
+	uint32_t					m_layer_draws;		  // draws queued this frame
+	uint64_t					m_layer_hash;		  // of the draws queued this frame
+	VkCommandBuffer				m_layer_submit_cmd;	  // taken by the engine, see TakeLayerCommandBuffer()
+	uint64_t					m_layer_submit_hash;  // contents m_layer_submit_cmd renders
+	bool						m_layer_valid;		  // m_layer_contents_hash describes the image
+	uint64_t					m_layer_contents_hash;
+	uint32_t					m_layer_last_draws; // of the previous frame, for ReuseLayer()
+	uint64_t					m_layer_last_hash;
+	std::vector<LayerDraw>		m_layer_list; // draws captured this frame
+	std::vector<Rml::Matrix4f>	m_layer_mvps;
 };
 
 } // namespace QRmlUI
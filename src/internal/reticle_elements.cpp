@@ -1,15 +1,17 @@
 /*
  * vkQuake RmlUI - Reticle Custom Elements Implementation
  *
- * Each primitive reads RCSS custom properties and generates procedural geometry.
- * Color comes from computed image-color + opacity. All geometry is centered
- * in the parent <reticle> container's content box.
+ * Each primitive reads RCSS custom properties into the parameters of a signed
+ * distance shape shader. Color comes from computed image-color + opacity. All
+ * shapes are centered in the parent <reticle> container's content box.
+ * Property changes only recompile the shader, the quad is built once.
  */
 
 #include "reticle_elements.h"
 #include "reticle_geometry.h"
 #include "reticle_plugin.h"
 
+#include <RmlUi/Core/CompiledFilterShader.h>
 #include <RmlUi/Core/ComputedValues.h>
 #include <RmlUi/Core/Element.h>
 #include <RmlUi/Core/Geometry.h>
@@ -67,6 +69,34 @@ static bool HasReticlePropertyChange (const Rml::PropertyIdSet &changed)
 		   changed.Contains (ReticlePlugin::PropStartAngle ()) || changed.Contains (ReticlePlugin::PropEndAngle ());
 }
 
+// Compile the shape shader for the element's current color.
+static Rml::CompiledShader CompileShapeShader (Rml::Element *element, const ReticleShape &shape)
+{
+	Rml::RenderManager *rm = element->GetRenderManager ();
+	if (!rm || shape.half_size.x <= 0.0f)
+		return Rml::CompiledShader ();
+	return rm->CompileShader (RETICLE_SHAPE_SHADER, MakeShapeParameters (shape, GetElementColor (element)));
+}
+
+// Draw the shape over the element's quad, which is only built on first use.
+static void RenderShape (Rml::Element *element, Rml::Geometry &quad, const Rml::CompiledShader &shader)
+{
+	if (!shader)
+		return;
+
+	if (!quad)
+	{
+		Rml::RenderManager *rm = element->GetRenderManager ();
+		if (!rm)
+			return;
+		Rml::Mesh mesh;
+		GenerateShapeQuad (mesh);
+		quad = rm->MakeGeometry (std::move (mesh));
+	}
+
+	quad.Render (GetParentCenter (element), Rml::Texture (), shader);
+}
+
 // ──────────────────────────────────────────────────────────────────
 // ElementReticle — container
 // ──────────────────────────────────────────────────────────────────
@@ -95,38 +125,31 @@ bool ElementReticleDot::GetIntrinsicDimensions (Rml::Vector2f &dimensions, float
 
 void ElementReticleDot::OnResize ()
 {
-	m_geometry_dirty = true;
+	m_shape_dirty = true;
 }
 
 void ElementReticleDot::OnPropertyChange (const Rml::PropertyIdSet &changed)
 {
 	Rml::Element::OnPropertyChange (changed);
 	if (HasReticlePropertyChange (changed) || changed.Contains (Rml::PropertyId::ImageColor) || changed.Contains (Rml::PropertyId::Opacity))
-		m_geometry_dirty = true;
+		m_shape_dirty = true;
 }
 
 void ElementReticleDot::OnRender ()
 {
-	if (m_geometry_dirty)
-		GenerateGeometry ();
+	if (m_shape_dirty)
+		CompileShape ();
 
-	Rml::Vector2f center = GetParentCenter (this);
-	m_geometry.Render (center);
+	RenderShape (this, m_quad, m_shader);
 }
 
-void ElementReticleDot::GenerateGeometry ()
+void ElementReticleDot::CompileShape ()
 {
-	m_geometry_dirty = false;
-
-	float					  radius = ResolveCustomProperty (this, ReticlePlugin::PropRadius (), 2.0f);
-	Rml::ColourbPremultiplied color = GetElementColor (this);
+	m_shape_dirty = false;
 
-	Rml::Mesh mesh = m_geometry.Release (Rml::Geometry::ReleaseMode::ClearMesh);
-	GenerateFilledCircle (mesh, {0.0f, 0.0f}, radius, color);
+	float radius = ResolveCustomProperty (this, ReticlePlugin::PropRadius (), 2.0f);
 
-	Rml::RenderManager *rm = GetRenderManager ();
-	if (rm)
-		m_geometry = rm->MakeGeometry (std::move (mesh));
+	m_shader = CompileShapeShader (this, MakeFilledCircle (radius));
 }
 
 // ──────────────────────────────────────────────────────────────────
@@ -144,49 +167,41 @@ bool ElementReticleLine::GetIntrinsicDimensions (Rml::Vector2f &dimensions, floa
 
 void ElementReticleLine::OnResize ()
 {
-	m_geometry_dirty = true;
+	m_shape_dirty = true;
 }
 
 void ElementReticleLine::OnPropertyChange (const Rml::PropertyIdSet &changed)
 {
 	Rml::Element::OnPropertyChange (changed);
 	if (HasReticlePropertyChange (changed) || changed.Contains (Rml::PropertyId::ImageColor) || changed.Contains (Rml::PropertyId::Opacity))
-		m_geometry_dirty = true;
+		m_shape_dirty = true;
 }
 
 void ElementReticleLine::OnAttributeChange (const Rml::ElementAttributes &changed_attributes)
 {
 	Rml::Element::OnAttributeChange (changed_attributes);
 	if (changed_attributes.count ("angle"))
-		m_geometry_dirty = true;
+		m_shape_dirty = true;
 }
 
 void ElementReticleLine::OnRender ()
 {
-	if (m_geometry_dirty)
-		GenerateGeometry ();
+	if (m_shape_dirty)
+		CompileShape ();
 
-	Rml::Vector2f center = GetParentCenter (this);
-	m_geometry.Render (center);
+	RenderShape (this, m_quad, m_shader);
 }
 
-void ElementReticleLine::GenerateGeometry ()
+void ElementReticleLine::CompileShape ()
 {
-	m_geometry_dirty = false;
+	m_shape_dirty = false;
 
 	float angle = GetAttribute ("angle", 0.0f);
 	float length = ResolveCustomProperty (this, ReticlePlugin::PropLength (), 8.0f);
 	float width = ResolveCustomProperty (this, ReticlePlugin::PropWidth (), 2.0f);
 	float gap = ResolveCustomProperty (this, ReticlePlugin::PropGap (), 3.0f);
 
-	Rml::ColourbPremultiplied color = GetElementColor (this);
-
-	Rml::Mesh mesh = m_geometry.Release (Rml::Geometry::ReleaseMode::ClearMesh);
-	GenerateRotatedRect (mesh, {0.0f, 0.0f}, angle, gap, length, width, color);
-
-	Rml::RenderManager *rm = GetRenderManager ();
-	if (rm)
-		m_geometry = rm->MakeGeometry (std::move (mesh));
+	m_shader = CompileShapeShader (this, MakeRotatedRect (angle, gap, length, width));
 }
 
 // ──────────────────────────────────────────────────────────────────
@@ -204,40 +219,32 @@ bool ElementReticleRing::GetIntrinsicDimensions (Rml::Vector2f &dimensions, floa
 
 void ElementReticleRing::OnResize ()
 {
-	m_geometry_dirty = true;
+	m_shape_dirty = true;
 }
 
 void ElementReticleRing::OnPropertyChange (const Rml::PropertyIdSet &changed)
 {
 	Rml::Element::OnPropertyChange (changed);
 	if (HasReticlePropertyChange (changed) || changed.Contains (Rml::PropertyId::ImageColor) || changed.Contains (Rml::PropertyId::Opacity))
-		m_geometry_dirty = true;
+		m_shape_dirty = true;
 }
 
 void ElementReticleRing::OnRender ()
 {
-	if (m_geometry_dirty)
-		GenerateGeometry ();
+	if (m_shape_dirty)
+		CompileShape ();
 
-	Rml::Vector2f center = GetParentCenter (this);
-	m_geometry.Render (center);
+	RenderShape (this, m_quad, m_shader);
 }
 
-void ElementReticleRing::GenerateGeometry ()
+void ElementReticleRing::CompileShape ()
 {
-	m_geometry_dirty = false;
+	m_shape_dirty = false;
 
 	float radius = ResolveCustomProperty (this, ReticlePlugin::PropRadius (), 10.0f);
 	float stroke = ResolveCustomProperty (this, ReticlePlugin::PropStroke (), 1.5f);
 
-	Rml::ColourbPremultiplied color = GetElementColor (this);
-
-	Rml::Mesh mesh = m_geometry.Release (Rml::Geometry::ReleaseMode::ClearMesh);
-	GenerateRing (mesh, {0.0f, 0.0f}, radius, stroke, color);
-
-	Rml::RenderManager *rm = GetRenderManager ();
-	if (rm)
-		m_geometry = rm->MakeGeometry (std::move (mesh));
+	m_shader = CompileShapeShader (this, MakeRing (radius, stroke));
 }
 
 // ──────────────────────────────────────────────────────────────────
@@ -255,42 +262,34 @@ bool ElementReticleArc::GetIntrinsicDimensions (Rml::Vector2f &dimensions, float
 
 void ElementReticleArc::OnResize ()
 {
-	m_geometry_dirty = true;
+	m_shape_dirty = true;
 }
 
 void ElementReticleArc::OnPropertyChange (const Rml::PropertyIdSet &changed)
 {
 	Rml::Element::OnPropertyChange (changed);
 	if (HasReticlePropertyChange (changed) || changed.Contains (Rml::PropertyId::ImageColor) || changed.Contains (Rml::PropertyId::Opacity))
-		m_geometry_dirty = true;
+		m_shape_dirty = true;
 }
 
 void ElementReticleArc::OnRender ()
 {
-	if (m_geometry_dirty)
-		GenerateGeometry ();
+	if (m_shape_dirty)
+		CompileShape ();
 
-	Rml::Vector2f center = GetParentCenter (this);
-	m_geometry.Render (center);
+	RenderShape (this, m_quad, m_shader);
 }
 
-void ElementReticleArc::GenerateGeometry ()
+void ElementReticleArc::CompileShape ()
 {
-	m_geometry_dirty = false;
+	m_shape_dirty = false;
 
 	float radius = ResolveCustomProperty (this, ReticlePlugin::PropRadius (), 10.0f);
 	float stroke = ResolveCustomProperty (this, ReticlePlugin::PropStroke (), 2.0f);
 	float start_angle = ResolveCustomNumber (this, ReticlePlugin::PropStartAngle (), 0.0f);
 	float end_angle = ResolveCustomNumber (this, ReticlePlugin::PropEndAngle (), 360.0f);
 
-	Rml::ColourbPremultiplied color = GetElementColor (this);
-
-	Rml::Mesh mesh = m_geometry.Release (Rml::Geometry::ReleaseMode::ClearMesh);
-	GenerateArc (mesh, {0.0f, 0.0f}, radius, stroke, start_angle, end_angle, color);
-
-	Rml::RenderManager *rm = GetRenderManager ();
-	if (rm)
-		m_geometry = rm->MakeGeometry (std::move (mesh));
+	m_shader = CompileShapeShader (this, MakeArc (radius, stroke, start_angle, end_angle));
 }
 
 } // namespace QRmlUI
@@ -1,7 +1,8 @@
 /*
  * vkQuake RmlUI - Reticle Custom Elements
  *
- * Custom RmlUI elements for procedural reticle rendering:
+ * Custom RmlUI elements for procedural reticle rendering, drawn as signed
+ * distance shapes over one quad each:
  *   <reticle>       — container, provides coordinate space
  *   <reticle-dot>   — filled circle
  *   <reticle-line>  — rotated rectangle arm
@@ -12,6 +13,7 @@
 #pragma once
 
 #include <RmlUi/Core/Element.h>
+#include <RmlUi/Core/CompiledFilterShader.h>
 #include <RmlUi/Core/Geometry.h>
 
 namespace QRmlUI
@@ -44,9 +46,10 @@ class ElementReticleDot : public Rml::Element
 	bool GetIntrinsicDimensions (Rml::Vector2f &dimensions, float &ratio) override;
 
   private:
-	void		  GenerateGeometry ();
-	Rml::Geometry m_geometry;
-	bool		  m_geometry_dirty = true;
+	void				CompileShape ();
+	Rml::Geometry		m_quad;
+	Rml::CompiledShader m_shader;
+	bool				m_shape_dirty = true;
 };
 
 // Rotated rectangle arm. Direction set via angle="" HTML attribute.
@@ -65,9 +68,10 @@ class ElementReticleLine : public Rml::Element
 	bool GetIntrinsicDimensions (Rml::Vector2f &dimensions, float &ratio) override;
 
   private:
-	void		  GenerateGeometry ();
-	Rml::Geometry m_geometry;
-	bool		  m_geometry_dirty = true;
+	void				CompileShape ();
+	Rml::Geometry		m_quad;
+	Rml::CompiledShader m_shader;
+	bool				m_shape_dirty = true;
 };
 
 // Full ring (circle stroke).
@@ -85,9 +89,10 @@ class ElementReticleRing : public Rml::Element
 	bool GetIntrinsicDimensions (Rml::Vector2f &dimensions, float &ratio) override;
 
   private:
-	void		  GenerateGeometry ();
-	Rml::Geometry m_geometry;
-	bool		  m_geometry_dirty = true;
+	void				CompileShape ();
+	Rml::Geometry		m_quad;
+	Rml::CompiledShader m_shader;
+	bool				m_shape_dirty = true;
 };
 
 // Partial ring (arc).
@@ -105,9 +110,10 @@ class ElementReticleArc : public Rml::Element
 	bool GetIntrinsicDimensions (Rml::Vector2f &dimensions, float &ratio) override;
 
   private:
-	void		  GenerateGeometry ();
-	Rml::Geometry m_geometry;
-	bool		  m_geometry_dirty = true;
+	void				CompileShape ();
+	Rml::Geometry		m_quad;
+	Rml::CompiledShader m_shader;
+	bool				m_shape_dirty = true;
 };
 
 } // namespace QRmlUI
@@ -1,19 +1,21 @@
 /*
  * vkQuake RmlUI - Reticle Geometry Helpers
  *
- * Procedural mesh generation for reticle primitives.
- * Counter-clockwise winding. Untextured (tex_coord = {0,0}).
+ * Signed distance shape parameters for reticle primitives.
+ * Quads get a pixel of margin on each side for the antialiased edge.
  */
 
 #include "reticle_geometry.h"
 
 #include <RmlUi/Core/Mesh.h>
+#include <algorithm>
 #include <cmath>
 
 namespace QRmlUI
 {
 
 static constexpr float PI = 3.14159265358979323846f;
+static constexpr float EDGE_MARGIN = 1.0f;
 
 // Convert degrees to radians, where 0 = up (negative Y), clockwise.
 static float DegToRad (float deg)
@@ -21,131 +23,93 @@ static float DegToRad (float deg)
 	return (deg - 90.0f) * (PI / 180.0f);
 }
 
-static Rml::Vertex MakeVertex (Rml::Vector2f pos, Rml::ColourbPremultiplied color)
+void GenerateShapeQuad (Rml::Mesh &mesh)
 {
-	return Rml::Vertex{pos, color, {0.0f, 0.0f}};
+	const int base = (int)mesh.vertices.size ();
+
+	const Rml::ColourbPremultiplied white (255, 255, 255, 255);
+	mesh.vertices.push_back (Rml::Vertex{{-1.0f, -1.0f}, white, {0.0f, 0.0f}});
+	mesh.vertices.push_back (Rml::Vertex{{1.0f, -1.0f}, white, {1.0f, 0.0f}});
+	mesh.vertices.push_back (Rml::Vertex{{1.0f, 1.0f}, white, {1.0f, 1.0f}});
+	mesh.vertices.push_back (Rml::Vertex{{-1.0f, 1.0f}, white, {0.0f, 1.0f}});
+
+	mesh.indices.push_back (base + 0);
+	mesh.indices.push_back (base + 1);
+	mesh.indices.push_back (base + 2);
+
+	mesh.indices.push_back (base + 0);
+	mesh.indices.push_back (base + 2);
+	mesh.indices.push_back (base + 3);
 }
 
-void GenerateFilledCircle (Rml::Mesh &mesh, Rml::Vector2f center, float radius, Rml::ColourbPremultiplied color, int segments)
+Rml::Dictionary MakeShapeParameters (const ReticleShape &shape, Rml::ColourbPremultiplied color)
 {
-	if (radius <= 0.0f || segments < 3)
-		return;
-
-	const int base = (int)mesh.vertices.size ();
+	Rml::Dictionary parameters;
+	parameters["shape"] = (int)shape.type;
+	parameters["half_size"] = shape.half_size;
+	parameters["color"] = Rml::Vector4f (color.red, color.green, color.blue, color.alpha) * (1.0f / 255.0f);
+	parameters["params"] = shape.params;
+	parameters["axis"] = shape.axis;
+	return parameters;
+}
 
-	// Center vertex
-	mesh.vertices.push_back (MakeVertex (center, color));
-
-	// Perimeter vertices
-	for (int i = 0; i <= segments; ++i)
-	{
-		float		  angle = 2.0f * PI * (float)i / (float)segments;
-		Rml::Vector2f pos = center + Rml::Vector2f (std::cos (angle) * radius, std::sin (angle) * radius);
-		mesh.vertices.push_back (MakeVertex (pos, color));
-	}
-
-	// Triangle fan indices (CCW)
-	for (int i = 0; i < segments; ++i)
-	{
-		mesh.indices.push_back (base);
-		mesh.indices.push_back (base + 1 + i);
-		mesh.indices.push_back (base + 1 + ((i + 1) % (segments + 1)));
-	}
+ReticleShape MakeFilledCircle (float radius)
+{
+	ReticleShape shape;
+	if (radius <= 0.0f)
+		return shape;
+
+	// Inner radius below zero so the distance keeps falling towards the center
+	shape.type = ReticleShapeType::Arc;
+	shape.params = Rml::Vector4f (-radius, radius, PI, 0.0f);
+	shape.axis = Rml::Vector2f (0.0f, -1.0f);
+	shape.half_size = Rml::Vector2f (radius + EDGE_MARGIN);
+	return shape;
 }
 
-void GenerateRing (Rml::Mesh &mesh, Rml::Vector2f center, float radius, float stroke, Rml::ColourbPremultiplied color, int segments)
+ReticleShape MakeRing (float radius, float stroke)
 {
-	GenerateArc (mesh, center, radius, stroke, 0.0f, 360.0f, color, segments);
+	return MakeArc (radius, stroke, 0.0f, 360.0f);
 }
 
-void GenerateArc (
-	Rml::Mesh &mesh, Rml::Vector2f center, float radius, float stroke, float start_angle_deg, float end_angle_deg, Rml::ColourbPremultiplied color,
-	int segments)
+ReticleShape MakeArc (float radius, float stroke, float start_angle_deg, float end_angle_deg)
 {
-	if (radius <= 0.0f || stroke <= 0.0f || segments < 3)
-		return;
+	ReticleShape shape;
+	if (radius <= 0.0f || stroke <= 0.0f)
+		return shape;
 
 	float inner_radius = radius - stroke * 0.5f;
 	float outer_radius = radius + stroke * 0.5f;
-	if (inner_radius < 0.0f)
-		inner_radius = 0.0f;
-
-	float start_rad = DegToRad (start_angle_deg);
-	float end_rad = DegToRad (end_angle_deg);
-	float sweep = end_rad - start_rad;
-
-	// Scale segment count to arc sweep proportion
-	int arc_segments = (int)std::ceil (std::abs (sweep) / (2.0f * PI) * (float)segments);
-	if (arc_segments < 2)
-		arc_segments = 2;
-
-	const int base = (int)mesh.vertices.size ();
-
-	// Generate inner/outer vertex pairs along the arc
-	for (int i = 0; i <= arc_segments; ++i)
-	{
-		float t = (float)i / (float)arc_segments;
-		float angle = start_rad + sweep * t;
-		float cos_a = std::cos (angle);
-		float sin_a = std::sin (angle);
-
-		Rml::Vector2f inner_pos = center + Rml::Vector2f (cos_a * inner_radius, sin_a * inner_radius);
-		Rml::Vector2f outer_pos = center + Rml::Vector2f (cos_a * outer_radius, sin_a * outer_radius);
-
-		mesh.vertices.push_back (MakeVertex (inner_pos, color));
-		mesh.vertices.push_back (MakeVertex (outer_pos, color));
-	}
-
-	// Triangle strip indices (CCW)
-	for (int i = 0; i < arc_segments; ++i)
-	{
-		int i0 = base + i * 2;			 // inner current
-		int o0 = base + i * 2 + 1;		 // outer current
-		int i1 = base + (i + 1) * 2;	 // inner next
-		int o1 = base + (i + 1) * 2 + 1; // outer next
-
-		// Two triangles per segment (CCW)
-		mesh.indices.push_back (i0);
-		mesh.indices.push_back (i1);
-		mesh.indices.push_back (o0);
-
-		mesh.indices.push_back (o0);
-		mesh.indices.push_back (i1);
-		mesh.indices.push_back (o1);
-	}
+	if (inner_radius <= 0.0f)
+		inner_radius = -outer_radius;
+
+	// The arc is symmetric around the axis through its middle, a half sweep of pi or more is a full ring
+	float half_sweep = std::min (std::abs (end_angle_deg - start_angle_deg) * 0.5f * (PI / 180.0f), PI);
+	float mid_rad = DegToRad ((start_angle_deg + end_angle_deg) * 0.5f);
+
+	shape.type = ReticleShapeType::Arc;
+	shape.params = Rml::Vector4f (inner_radius, outer_radius, half_sweep, 0.0f);
+	shape.axis = Rml::Vector2f (std::cos (mid_rad), std::sin (mid_rad));
+	shape.half_size = Rml::Vector2f (outer_radius + EDGE_MARGIN);
+	return shape;
 }
 
-void GenerateRotatedRect (Rml::Mesh &mesh, Rml::Vector2f center, float angle_deg, float gap, float length, float width, Rml::ColourbPremultiplied color)
+ReticleShape MakeRotatedRect (float angle_deg, float gap, float length, float width)
 {
+	ReticleShape shape;
 	if (length <= 0.0f || width <= 0.0f)
-		return;
-
-	// Direction vector (angle_deg: 0 = up, 90 = right)
-	float		  rad = DegToRad (angle_deg);
-	Rml::Vector2f dir (std::cos (rad), std::sin (rad));
-	Rml::Vector2f perp (-dir.y, dir.x); // perpendicular (rotated 90 CCW)
-
-	// Rectangle extends from gap to gap+length along dir, centered on width
-	Rml::Vector2f near_center = center + dir * gap;
-	Rml::Vector2f far_center = center + dir * (gap + length);
-	Rml::Vector2f half_w = perp * (width * 0.5f);
-
-	const int base = (int)mesh.vertices.size ();
-
-	// Four corners (CCW winding)
-	mesh.vertices.push_back (MakeVertex (near_center - half_w, color));
-	mesh.vertices.push_back (MakeVertex (far_center - half_w, color));
-	mesh.vertices.push_back (MakeVertex (far_center + half_w, color));
-	mesh.vertices.push_back (MakeVertex (near_center + half_w, color));
-
-	// Two triangles (CCW)
-	mesh.indices.push_back (base + 0);
-	mesh.indices.push_back (base + 1);
-	mesh.indices.push_back (base + 2);
-
-	mesh.indices.push_back (base + 0);
-	mesh.indices.push_back (base + 2);
-	mesh.indices.push_back (base + 3);
+		return shape;
+
+	// Rectangle extends from gap to gap+length along the direction, centered on width.
+	// The quad stays centered on the reticle, so it has to reach the far corners.
+	float rad = DegToRad (angle_deg);
+	float half_quad = std::abs (gap) + length + width * 0.5f + EDGE_MARGIN;
+
+	shape.type = ReticleShapeType::Box;
+	shape.params = Rml::Vector4f (gap + length * 0.5f, length * 0.5f, width * 0.5f, 0.0f);
+	shape.axis = Rml::Vector2f (std::cos (rad), std::sin (rad));
+	shape.half_size = Rml::Vector2f (half_quad);
+	return shape;
 }
 
 } // namespace QRmlUI
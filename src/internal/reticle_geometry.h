@@ -1,14 +1,15 @@
 /*
  * vkQuake RmlUI - Reticle Geometry Helpers
  *
- * Procedural mesh generation for reticle primitives.
- * All functions append to an existing Rml::Mesh (vertices + indices).
+ * Signed distance shape parameters for reticle primitives. Shapes are drawn by
+ * the UI renderer's "sdf-shape" shader over a unit quad, so animating them only
+ * recompiles the shader parameters and never the geometry.
  */
 
 #pragma once
 
 #include <RmlUi/Core/Types.h>
-#include <RmlUi/Core/Vertex.h>
+#include <RmlUi/Core/Dictionary.h>
 
 namespace Rml
 {
@@ -18,19 +19,42 @@ struct Mesh;
 namespace QRmlUI
 {
 
-// Filled circle (triangle fan) for dot reticles.
-void GenerateFilledCircle (Rml::Mesh &mesh, Rml::Vector2f center, float radius, Rml::ColourbPremultiplied color, int segments = 32);
+// Shape kinds, must match Shaders/rmlui_shape.frag
+enum class ReticleShapeType
+{
+	Arc = 0, // annulus sector, also rings and filled circles
+	Box = 1, // rectangle along an axis through the center
+};
+
+// Parameters of one "sdf-shape" draw, relative to the reticle center
+struct ReticleShape
+{
+	ReticleShapeType type = ReticleShapeType::Arc;
+	Rml::Vector2f	 half_size;	// of the quad around the center, zero for empty shapes
+	Rml::Vector4f	 params;	// see Shaders/rmlui_shape.frag
+	Rml::Vector2f	 axis;
+};
+
+// Name of the UI renderer shader that draws ReticleShape
+static constexpr const char *RETICLE_SHAPE_SHADER = "sdf-shape";
+
+// Unit quad with corners in [-1, 1] the shapes are drawn over.
+void GenerateShapeQuad (Rml::Mesh &mesh);
+
+// Shader parameters for a shape in a premultiplied color.
+Rml::Dictionary MakeShapeParameters (const ReticleShape &shape, Rml::ColourbPremultiplied color);
+
+// Filled circle for dot reticles.
+ReticleShape MakeFilledCircle (float radius);
 
-// Ring (triangle strip) for ring reticles.
-void GenerateRing (Rml::Mesh &mesh, Rml::Vector2f center, float radius, float stroke, Rml::ColourbPremultiplied color, int segments = 32);
+// Ring (full circle stroke) for ring reticles.
+ReticleShape MakeRing (float radius, float stroke);
 
 // Arc (partial ring) for arc reticles. Angles in degrees, 0 = up, clockwise.
-void GenerateArc (
-	Rml::Mesh &mesh, Rml::Vector2f center, float radius, float stroke, float start_angle_deg, float end_angle_deg, Rml::ColourbPremultiplied color,
-	int segments = 32);
+ReticleShape MakeArc (float radius, float stroke, float start_angle_deg, float end_angle_deg);
 
 // Rotated rectangle (line arm radiating from center) for line reticles.
 // angle_deg: direction (0 = up, 90 = right). gap: distance from center to near edge. length: arm length.
-void GenerateRotatedRect (Rml::Mesh &mesh, Rml::Vector2f center, float angle_deg, float gap, float length, float width, Rml::ColourbPremultiplied color);
+ReticleShape MakeRotatedRect (float angle_deg, float gap, float length, float width);
 
 } // namespace QRmlUI
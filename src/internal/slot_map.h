@@ -0,0 +1,132 @@
+/*
+ * vkQuake RmlUI - Generational slot map
+ *
+ * Handle table for RmlUI render resources. Objects are stored in fixed size
+ * blocks so their addresses stay stable and are reused instead of being
+ * new/deleted. A handle encodes the slot index and the slot's generation, so
+ * lookup is an index plus a generation check and stale handles are rejected.
+ */
+
+#ifndef QRMLUI_SLOT_MAP_H
+#define QRMLUI_SLOT_MAP_H
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace QRmlUI
+{
+
+template <typename T> class SlotMap
+{
+  public:
+	// Handle layout: bits [0, INDEX_BITS) hold index + 1 so that 0 is never a valid
+	// handle, the bits above hold the generation. Fits a 32 bit uintptr_t.
+	static constexpr uint32_t INDEX_BITS = 20;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+	static constexpr uint32_t MAX_SLOTS = INDEX_MASK;
+	static constexpr uint32_t BLOCK_SIZE = 256;
+
+	// Takes a free slot and hands out a new handle for it. The object keeps the state
+	// it was recycled with. Returns nullptr if the table is full.
+	T *Acquire (uintptr_t &handle)
+	{
+		uint32_t index;
+		if (!m_free.empty ())
+		{
+			index = m_free.back ();
+			m_free.pop_back ();
+		}
+		else
+		{
+			index = static_cast<uint32_t> (m_slots.size ());
+			if (index >= MAX_SLOTS)
+				return nullptr;
+			if (index % BLOCK_SIZE == 0)
+				m_blocks.emplace_back (new T[BLOCK_SIZE]());
+			m_slots.emplace_back ();
+		}
+
+		Slot &slot = m_slots[index];
+		slot.live = true;
+		handle = (static_cast<uintptr_t> (slot.generation) << INDEX_BITS) | (index + 1);
+		return &(*this)[index];
+	}
+
+	// nullptr for 0, released and stale handles
+	T *Get (uintptr_t handle) const
+	{
+		const uint32_t index = static_cast<uint32_t> (handle & INDEX_MASK) - 1;
+		if (index >= m_slots.size ())
+			return nullptr;
+		const Slot &slot = m_slots[index];
+		if (!slot.live || slot.generation != ((handle >> INDEX_BITS) & GENERATION_MASK))
+			return nullptr;
+		return &m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+	}
+
+	// Invalidates the handle but keeps the object alive until Recycle(), so it can
+	// be destroyed deferred. Returns the slot index, UINT32_MAX for an invalid handle.
+	uint32_t Retire (uintptr_t handle)
+	{
+		if (!Get (handle))
+			return UINT32_MAX;
+		const uint32_t index = static_cast<uint32_t> (handle & INDEX_MASK) - 1;
+		Slot		  &slot = m_slots[index];
+		slot.live = false;
+		slot.generation = (slot.generation + 1) & GENERATION_MASK;
+		return index;
+	}
+
+	// Makes a retired slot available to Acquire() again
+	void Recycle (uint32_t index)
+	{
+		assert (index < m_slots.size () && !m_slots[index].live && "Recycling a live or unknown slot");
+		m_free.push_back (index);
+	}
+
+	// Retire and recycle at once, for objects that never got used
+	void Discard (uintptr_t handle)
+	{
+		const uint32_t index = Retire (handle);
+		if (index != UINT32_MAX)
+			Recycle (index);
+	}
+
+	T &operator[] (uint32_t index)
+	{
+		assert (index < m_slots.size ());
+		return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+	}
+
+	template <typename F> void ForEachLive (F &&func)
+	{
+		for (uint32_t index = 0; index < m_slots.size (); ++index)
+			if (m_slots[index].live)
+				func ((*this)[index]);
+	}
+
+	void Clear ()
+	{
+		m_blocks.clear ();
+		m_slots.clear ();
+		m_free.clear ();
+	}
+
+  private:
+	struct Slot
+	{
+		uint32_t generation = 0;
+		bool	 live = false;
+	};
+
+	std::vector<std::unique_ptr<T[]>> m_blocks;
+	std::vector<Slot>				  m_slots;
+	std::vector<uint32_t>			  m_free;
+};
+
+} // namespace QRmlUI
+
+#endif // QRMLUI_SLOT_MAP_H
@@ -0,0 +1,140 @@
+/*
+ * vkQuake RmlUI - Spike Trace Implementation
+ */
+
+#include "spike_trace.h"
+
+#include "engine_bridge.h"
+
+#include <algorithm>
+
+namespace QRmlUI
+{
+
+bool					SpikeTrace::s_armed = false;
+SpikeTrace::Frame		SpikeTrace::s_current;
+SpikeTrace::Frame		SpikeTrace::s_ring[RING_SIZE];
+size_t					SpikeTrace::s_ring_head = 0;
+size_t					SpikeTrace::s_ring_count = 0;
+
+void SpikeTrace::AddDirty (const char *name)
+{
+	std::vector<std::string> &dirty = s_current.dirty;
+	if (std::find (dirty.begin (), dirty.end (), name) != dirty.end ())
+		return;
+	if (dirty.size () >= MAX_NAMES)
+	{
+		s_current.dropped_names++;
+		return;
+	}
+	dirty.emplace_back (name);
+}
+
+void SpikeTrace::AddEvent (const char *what, const char *detail)
+{
+	if (s_current.events.size () >= MAX_NAMES)
+	{
+		s_current.dropped_names++;
+		return;
+	}
+	std::string event (what);
+	if (detail && *detail)
+	{
+		event += ' ';
+		event += detail;
+	}
+	s_current.events.push_back (std::move (event));
+}
+
+// RmlUI doesn't expose which animations or transitions are running, list the
+// elements that declare one as the candidates.
+void SpikeTrace::CollectAnimated (Rml::Element *element, Frame &frame)
+{
+	const Rml::Property *animation = element->GetProperty (Rml::PropertyId::Animation);
+	const Rml::Property *transition = element->GetProperty (Rml::PropertyId::Transition);
+	const bool			 animated = animation && !animation->Get<Rml::AnimationList> ().empty ();
+	const bool			 transitions = transition && !transition->Get<Rml::TransitionList> ().none;
+	if (animated || transitions)
+	{
+		frame.num_animated++;
+		if (frame.animated.size () < MAX_ANIMATED)
+			frame.animated.push_back (element->GetAddress (false, false) + (animated ? " (animation)" : " (transition)"));
+	}
+	for (int i = 0; i < element->GetNumChildren (); ++i)
+		CollectAnimated (element->GetChild (i), frame);
+}
+
+void SpikeTrace::EndFrame (
+	double threshold_ms, double real_time, const SpikeTraceTimings &timings, Rml::Context *context, uint32_t compiled_geometry, uint32_t compiled_vertices)
+{
+	const bool was_armed = s_armed;
+	s_armed = threshold_ms > 0.0;
+
+	if (was_armed && context && timings.total_ms >= threshold_ms)
+	{
+		Frame &frame = s_ring[s_ring_head];
+		frame = std::move (s_current);
+		frame.real_time = real_time;
+		frame.timings = timings;
+		frame.compiled_geometry = compiled_geometry;
+		frame.compiled_vertices = compiled_vertices;
+		for (int i = 0; i < context->GetNumDocuments (); ++i)
+		{
+			Rml::ElementDocument *doc = context->GetDocument (i);
+			if (!doc || !doc->IsVisible ())
+				continue;
+			frame.documents.push_back (doc->GetSourceURL ());
+			CollectAnimated (doc, frame);
+		}
+		s_ring_head = (s_ring_head + 1) % RING_SIZE;
+		s_ring_count = std::min (s_ring_count + 1, RING_SIZE);
+	}
+
+	s_current = Frame ();
+}
+
+static void PrintNames (const char *label, const std::vector<std::string> &names)
+{
+	if (names.empty ())
+		return;
+	std::string line;
+	for (const std::string &name : names)
+	{
+		if (!line.empty ())
+			line += ", ";
+		line += name;
+	}
+	Con_Printf ("  %-9s %s\n", label, line.c_str ());
+}
+
+void SpikeTrace::Dump ()
+{
+	if (s_ring_count == 0)
+	{
+		Con_Printf ("ui_trace_dump: no spikes recorded%s\n", s_armed ? "" : ", set ui_trace_threshold");
+		return;
+	}
+
+	const size_t first = (s_ring_head + RING_SIZE - s_ring_count) % RING_SIZE;
+	for (size_t i = 0; i < s_ring_count; ++i)
+	{
+		const Frame &frame = s_ring[(first + i) % RING_SIZE];
+		const SpikeTraceTimings &t = frame.timings;
+		Con_Printf (
+			"ui spike at %.3f: %.2f ms total (update %.2f: model %.2f lua %.2f context %.2f, render %.2f) compiled %u geometry / %u vertices\n",
+			frame.real_time, t.total_ms, t.update_ms, t.update_model_ms, t.update_lua_ms, t.update_context_ms, t.render_ms, frame.compiled_geometry,
+			frame.compiled_vertices);
+		PrintNames ("documents", frame.documents);
+		PrintNames ("dirty", frame.dirty);
+		PrintNames ("events", frame.events);
+		if (frame.num_animated)
+		{
+			Con_Printf ("  animated  %u elements\n", frame.num_animated);
+			PrintNames ("", frame.animated);
+		}
+		if (frame.dropped_names)
+			Con_Printf ("  (%u more names dropped)\n", frame.dropped_names);
+	}
+}
+
+} // namespace QRmlUI
@@ -0,0 +1,98 @@
+/*
+ * vkQuake RmlUI - Spike Trace
+ *
+ * Records what a UI frame was doing when it went over ui_trace_threshold:
+ * visible documents, data model variables dirtied since the last frame,
+ * events that invalidate style or layout, animated elements and geometry
+ * compiled. The last few spikes are kept in a ring for ui_trace_dump.
+ */
+
+#ifndef QRMLUI_SPIKE_TRACE_H
+#define QRMLUI_SPIKE_TRACE_H
+
+#include <RmlUi/Core.h>
+
+#include <string>
+#include <vector>
+
+namespace QRmlUI
+{
+
+struct SpikeTraceTimings
+{
+	double total_ms = 0.0;
+	double update_ms = 0.0;
+	double update_model_ms = 0.0;
+	double update_lua_ms = 0.0;
+	double update_context_ms = 0.0;
+	double render_ms = 0.0;
+};
+
+class SpikeTrace
+{
+  public:
+	// Recording is armed while ui_trace_threshold > 0, the Note* calls are
+	// no-ops otherwise.
+	static bool IsArmed ()
+	{
+		return s_armed;
+	}
+
+	// A data model variable was dirtied ("*" for all of them)
+	static void NoteDirty (const char *name)
+	{
+		if (s_armed)
+			AddDirty (name);
+	}
+
+	// Something that invalidates style or layout: a document shown, a class
+	// toggled, the dp ratio changed, ...
+	static void NoteEvent (const char *what, const char *detail)
+	{
+		if (s_armed)
+			AddEvent (what, detail);
+	}
+
+	// Ends the frame. Commits it to the ring when timings.total_ms reached
+	// threshold_ms, then starts collecting the next frame. threshold_ms <= 0
+	// disarms recording.
+	static void EndFrame (
+		double threshold_ms, double real_time, const SpikeTraceTimings &timings, Rml::Context *context, uint32_t compiled_geometry,
+		uint32_t compiled_vertices);
+
+	// Prints the recorded spikes to the console, oldest first
+	static void Dump ();
+
+  private:
+	static constexpr size_t RING_SIZE = 16;
+	static constexpr size_t MAX_NAMES = 64;
+	static constexpr size_t MAX_ANIMATED = 8;
+
+	struct Frame
+	{
+		double					 real_time = 0.0;
+		SpikeTraceTimings		 timings;
+		uint32_t				 compiled_geometry = 0;
+		uint32_t				 compiled_vertices = 0;
+		std::vector<std::string> documents;
+		std::vector<std::string> dirty;
+		std::vector<std::string> events;
+		std::vector<std::string> animated;
+		unsigned				 dropped_names = 0;
+		unsigned				 num_animated = 0;
+	};
+
+	static void AddDirty (const char *name);
+	static void AddEvent (const char *what, const char *detail);
+	static void CollectAnimated (Rml::Element *element, Frame &frame);
+
+	static bool	  s_armed;
+	static Frame  s_current;
+	static Frame  s_ring[RING_SIZE];
+	static size_t s_ring_head;
+	static size_t s_ring_count;
+};
+
+} // namespace QRmlUI
+
+#endif // QRMLUI_SPIKE_TRACE_H
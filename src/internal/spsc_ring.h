@@ -0,0 +1,65 @@
+/*
+ * vkQuake RmlUI - Single producer, single consumer ring
+ *
+ * Fixed capacity lock-free queue for handing small records from engine threads to
+ * the UI update. The producer fills a slot in place and publishes it, the consumer
+ * reads whatever was published since its last visit. Nothing is allocated, a full
+ * ring rejects new records instead of blocking the producer.
+ */
+
+#ifndef QRMLUI_SPSC_RING_H
+#define QRMLUI_SPSC_RING_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace QRmlUI
+{
+
+template <typename T, uint32_t CAPACITY> class SpscRing
+{
+	static_assert ((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+	// Producer: slot to fill, nullptr while the ring is full. Commit() publishes it.
+	T *Reserve ()
+	{
+		const uint32_t head = m_head.load (std::memory_order_relaxed);
+		if (head - m_tail.load (std::memory_order_acquire) >= CAPACITY)
+			return nullptr;
+		return &m_slots[head & (CAPACITY - 1)];
+	}
+
+	void Commit ()
+	{
+		m_head.store (m_head.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer: number of published records, oldest first through Peek()
+	uint32_t Size () const
+	{
+		return m_head.load (std::memory_order_acquire) - m_tail.load (std::memory_order_relaxed);
+	}
+
+	const T &Peek (uint32_t index) const
+	{
+		return m_slots[(m_tail.load (std::memory_order_relaxed) + index) & (CAPACITY - 1)];
+	}
+
+	// Hands the oldest count records back to the producer
+	void Pop (uint32_t count)
+	{
+		m_tail.store (m_tail.load (std::memory_order_relaxed) + count, std::memory_order_release);
+	}
+
+  private:
+	T m_slots[CAPACITY];
+
+	// Apart so the two sides don't share a cache line
+	alignas (64) std::atomic<uint32_t> m_head{0};
+	alignas (64) std::atomic<uint32_t> m_tail{0};
+};
+
+} // namespace QRmlUI
+
+#endif // QRMLUI_SPSC_RING_H
@@ -26,6 +26,9 @@ inline constexpr const char *kHudChat = "ui/rml/hud/chat.rml";
 inline constexpr const char *kScoreboard = "ui/rml/hud/scoreboard.rml";
 inline constexpr const char *kIntermission = "ui/rml/hud/intermission.rml";
 
+/* ── Debug overlays ───────────────────────────────────────────────── */
+inline constexpr const char *kPerfOverlay = "ui/rml/debug/performance.rml";
+
 /* ── Menu prefix (used by ActionNavigate for shorthand names) ─────── */
 inline constexpr const char *kMenuPrefix = "ui/rml/menus/";
 inline constexpr const char *kMenuSuffix = ".rml";
@@ -0,0 +1,137 @@
+/*
+ * vkQuake RmlUI - Virtualized Lists Implementation
+ */
+
+#include "virtual_list.h"
+
+#include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/ElementDocument.h>
+#include <RmlUi/Core/ElementInstancer.h>
+#include <RmlUi/Core/Factory.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace QRmlUI
+{
+
+// Function-local so lists created during static initialization find it
+static std::unordered_map<Rml::String, VirtualList *> &Registry ()
+{
+	static std::unordered_map<Rml::String, VirtualList *> registry;
+	return registry;
+}
+
+static Rml::ElementInstancerGeneric<ElementVirtualList> *s_instancer = nullptr;
+
+VirtualList::VirtualList (const Rml::String &name, WindowCallback on_window) : m_name (name), m_on_window (std::move (on_window))
+{
+	Registry ()[m_name] = this;
+}
+
+VirtualList::~VirtualList ()
+{
+	auto it = Registry ().find (m_name);
+	if (it != Registry ().end () && it->second == this)
+		Registry ().erase (it);
+}
+
+VirtualList *VirtualList::Find (const Rml::String &name)
+{
+	auto it = Registry ().find (name);
+	return it != Registry ().end () ? it->second : nullptr;
+}
+
+bool VirtualList::Clamp ()
+{
+	const int count = std::min (m_requested_count, m_size);
+	const int first = std::max (0, std::min (m_requested_first, m_size - count));
+	if (first == m_first && count == m_count)
+		return false;
+	m_first = first;
+	m_count = count;
+	return true;
+}
+
+void VirtualList::SetSize (int size)
+{
+	m_size = std::max (0, size);
+	Clamp ();
+	m_on_window (m_first, m_count);
+}
+
+void VirtualList::SetWindow (int first, int count)
+{
+	m_requested_first = first;
+	m_requested_count = count;
+	if (Clamp ())
+		m_on_window (m_first, m_count);
+}
+
+ElementVirtualList::ElementVirtualList (const Rml::String &tag) : Rml::Element (tag) {}
+
+void ElementVirtualList::Initialise ()
+{
+	s_instancer = new Rml::ElementInstancerGeneric<ElementVirtualList> ();
+	Rml::Factory::RegisterElementInstancer ("virtual-list", s_instancer);
+}
+
+void ElementVirtualList::OnAttributeChange (const Rml::ElementAttributes &changed_attributes)
+{
+	Rml::Element::OnAttributeChange (changed_attributes);
+	if (changed_attributes.count ("source"))
+		m_source = GetAttribute<Rml::String> ("source", "");
+	if (changed_attributes.count ("overscan"))
+		m_overscan = std::max (0, GetAttribute ("overscan", DEFAULT_OVERSCAN));
+}
+
+void ElementVirtualList::SetSpacerHeight (Rml::Element *spacer, float &current, float height)
+{
+	if (height == current)
+		return;
+	current = height;
+	spacer->SetProperty (Rml::PropertyId::Height, Rml::Property (height, Rml::Unit::PX));
+}
+
+void ElementVirtualList::OnUpdate ()
+{
+	VirtualList *list = VirtualList::Find (m_source);
+	if (!list || !GetOwnerDocument ())
+		return;
+
+	if (!m_top)
+	{
+		Rml::ElementPtr top = GetOwnerDocument ()->CreateElement ("div");
+		Rml::ElementPtr bottom = GetOwnerDocument ()->CreateElement ("div");
+		top->SetProperty (Rml::PropertyId::Display, Rml::Property (Rml::Style::Display::Block));
+		bottom->SetProperty (Rml::PropertyId::Display, Rml::Property (Rml::Style::Display::Block));
+		m_top = InsertBefore (std::move (top), GetFirstChild ());
+		m_bottom = AppendChild (std::move (bottom));
+	}
+
+	// Everything between the spacers is the window laid out last frame
+	float window_height = 0.0f;
+	for (int i = 0; i < GetNumChildren (); ++i)
+	{
+		Rml::Element *child = GetChild (i);
+		if (child != m_top && child != m_bottom)
+			window_height += child->GetOffsetHeight ();
+	}
+	if (m_laid_out_rows > 0 && window_height > 0.0f)
+		m_row_height = window_height / m_laid_out_rows;
+	if (m_row_height <= 0.0f)
+		m_row_height = DEFAULT_ROW_HEIGHT_DP * (GetContext () ? GetContext ()->GetDensityIndependentPixelRatio () : 1.0f);
+
+	const int first_visible = static_cast<int> (GetScrollTop () / m_row_height);
+	const int visible = static_cast<int> (std::ceil (GetClientHeight () / m_row_height)) + 1;
+	list->SetWindow (first_visible - m_overscan, visible + 2 * m_overscan);
+
+	m_laid_out_rows = list->GetCount ();
+
+	const int after = list->GetSize () - list->GetFirst () - list->GetCount ();
+	SetSpacerHeight (m_top, m_top_height, list->GetFirst () * m_row_height);
+	SetSpacerHeight (m_bottom, m_bottom_height, after * m_row_height);
+}
+
+} // namespace QRmlUI
@@ -0,0 +1,102 @@
+/*
+ * vkQuake RmlUI - Virtualized Lists
+ *
+ * Long lists bind a window of their rows instead of all of them:
+ *   <virtual-list source="mods" overscan="4"> — scroll container that keeps
+ *   the rows in view, plus overscan above and below, materialized
+ *
+ * The model owns a VirtualList holding the row count and copies the window's
+ * rows into the array its data-for binds. The window size only changes with
+ * the viewport, so data-for keeps its row elements while scrolling and just
+ * rebinds them. Rows must all be the same height.
+ */
+
+#pragma once
+
+#include <RmlUi/Core/Element.h>
+
+#include <functional>
+
+namespace QRmlUI
+{
+
+class VirtualList
+{
+  public:
+	// Called when the window moves or the rows change, with the rows to bind
+	using WindowCallback = std::function<void (int first, int count)>;
+
+	VirtualList (const Rml::String &name, WindowCallback on_window);
+	~VirtualList ();
+	VirtualList (const VirtualList &) = delete;
+	VirtualList &operator= (const VirtualList &) = delete;
+
+	// By source="" attribute, nullptr if the model hasn't created it
+	static VirtualList *Find (const Rml::String &name);
+
+	// Total row count, e.g. after the list was repopulated. Always rebinds the window.
+	void SetSize (int size);
+	// Requested window, clamped to the rows there are
+	void SetWindow (int first, int count);
+
+	int GetSize () const
+	{
+		return m_size;
+	}
+	int GetFirst () const
+	{
+		return m_first;
+	}
+	int GetCount () const
+	{
+		return m_count;
+	}
+
+  private:
+	// Rows bound before a <virtual-list> has measured its viewport
+	static constexpr int INITIAL_ROWS = 32;
+
+	bool Clamp ();
+
+	Rml::String	   m_name;
+	WindowCallback m_on_window;
+	int			   m_size = 0;
+	int			   m_requested_first = 0;
+	int			   m_requested_count = INITIAL_ROWS;
+	int			   m_first = 0;
+	int			   m_count = 0;
+};
+
+// Scroll container for a VirtualList. Its two spacer children stand in for
+// the rows outside the window, so the scrollbar covers the whole list.
+class ElementVirtualList : public Rml::Element
+{
+  public:
+	RMLUI_RTTI_DefineWithParent (ElementVirtualList, Rml::Element)
+
+		explicit ElementVirtualList (const Rml::String &tag);
+
+	// Registers the <virtual-list> instancer, call after Rml::Initialise()
+	static void Initialise ();
+
+  protected:
+	void OnUpdate () override;
+	void OnAttributeChange (const Rml::ElementAttributes &changed_attributes) override;
+
+  private:
+	static constexpr int   DEFAULT_OVERSCAN = 4;
+	static constexpr float DEFAULT_ROW_HEIGHT_DP = 48.0f;
+
+	void SetSpacerHeight (Rml::Element *spacer, float &current, float height);
+
+	Rml::String	  m_source;
+	int			  m_overscan = DEFAULT_OVERSCAN;
+	Rml::Element *m_top = nullptr;
+	Rml::Element *m_bottom = nullptr;
+	float		  m_top_height = -1.0f;
+	float		  m_bottom_height = -1.0f;
+	float		  m_row_height = 0.0f; // px, measured from the materialized rows
+	int			  m_laid_out_rows = 0;
+};
+
+} // namespace QRmlUI
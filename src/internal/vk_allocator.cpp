@@ -3,7 +3,8 @@
  *
  * FreeListAllocator: pure offset/size bookkeeping with first-fit and coalesce.
  * BufferPool: suballocates HOST_VISIBLE geometry buffers from large chunks.
- * ImageMemoryPool: suballocates DEVICE_LOCAL memory for texture images.
+ * ImageMemoryPool: DEVICE_LOCAL memory for texture images, from the engine's
+ * texture heap or its own pages.
  */
 
 #include "vk_allocator.h"
@@ -180,10 +181,8 @@ void BufferPool::Initialize (VkDevice device, const VkPhysicalDeviceMemoryProper
 	m_chunk_size = chunk_size;
 }
 
-bool BufferPool::CreateChunk ()
+bool BufferPool::CreateChunkBuffer (Chunk &chunk)
 {
-	Chunk chunk;
-
 	VkBufferCreateInfo buffer_info{};
 	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	buffer_info.size = m_chunk_size;
@@ -207,17 +206,14 @@ bool BufferPool::CreateChunk ()
 		return false;
 	}
 
-	VkMemoryAllocateInfo alloc_info{};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = mem_reqs.size;
-	alloc_info.memoryTypeIndex = mem_type;
-
-	if (vkAllocateMemory (m_device, &alloc_info, nullptr, &chunk.memory) != VK_SUCCESS)
+	chunk.memory = R_AllocateUIMemory (mem_reqs.size, mem_type, true);
+	if (chunk.memory == VK_NULL_HANDLE)
 	{
 		Rml::Log::Message (Rml::Log::LT_ERROR, "BufferPool: Failed to allocate chunk memory (%llu bytes)", static_cast<unsigned long long> (mem_reqs.size));
 		vkDestroyBuffer (m_device, chunk.buffer, nullptr);
 		return false;
 	}
+	chunk.memory_size = mem_reqs.size;
 
 	vkBindBufferMemory (m_device, chunk.buffer, chunk.memory, 0);
 
@@ -225,12 +221,36 @@ bool BufferPool::CreateChunk ()
 	if (vkMapMemory (m_device, chunk.memory, 0, m_chunk_size, 0, &chunk.mapped) != VK_SUCCESS)
 	{
 		Rml::Log::Message (Rml::Log::LT_ERROR, "BufferPool: Failed to map chunk memory");
-		vkFreeMemory (m_device, chunk.memory, nullptr);
+		R_FreeUIMemory (chunk.memory, chunk.memory_size, true);
 		vkDestroyBuffer (m_device, chunk.buffer, nullptr);
 		return false;
 	}
 
 	chunk.allocator.Reset (m_chunk_size);
+	return true;
+}
+
+void BufferPool::DestroyChunkBuffer (Chunk &chunk)
+{
+	if (chunk.mapped)
+	{
+		vkUnmapMemory (m_device, chunk.memory);
+	}
+	if (chunk.buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer (m_device, chunk.buffer, nullptr);
+	}
+	if (chunk.memory != VK_NULL_HANDLE)
+	{
+		R_FreeUIMemory (chunk.memory, chunk.memory_size, true);
+	}
+}
+
+bool BufferPool::CreateChunk ()
+{
+	Chunk chunk;
+	if (!CreateChunkBuffer (chunk))
+		return false;
 	m_chunks.push_back (chunk);
 
 	Con_DPrintf ("BufferPool: Created chunk %u (%llu bytes)\n", static_cast<unsigned> (m_chunks.size () - 1), static_cast<unsigned long long> (m_chunk_size));
@@ -292,30 +312,82 @@ void BufferPool::Free (const BufferAllocation &alloc)
 	--m_active_allocations;
 }
 
-void BufferPool::Shutdown ()
+bool BufferPool::AllocateTransient (VkDeviceSize size, VkDeviceSize alignment, BufferAllocation &out)
 {
-	if (m_active_allocations > 0)
+	assert ((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+	if (size > m_chunk_size)
 	{
-		Rml::Log::Message (Rml::Log::LT_WARNING, "BufferPool: Shutdown with %u active allocations", m_active_allocations);
+		Rml::Log::Message (
+			Rml::Log::LT_ERROR, "BufferPool: Transient allocation larger than a chunk (requested %llu bytes, chunk size %llu)",
+			static_cast<unsigned long long> (size), static_cast<unsigned long long> (m_chunk_size));
+		return false;
 	}
 
-	for (auto &chunk : m_chunks)
+	TransientSlot &slot = m_transient_slots[m_transient_slot];
+	for (;;)
 	{
-		if (chunk.mapped)
-		{
-			vkUnmapMemory (m_device, chunk.memory);
-		}
-		if (chunk.buffer != VK_NULL_HANDLE)
+		// Move on to the next chunk of the slot, grow the slot once all are full
+		if (slot.current == slot.chunks.size ())
 		{
-			vkDestroyBuffer (m_device, chunk.buffer, nullptr);
+			Chunk chunk;
+			if (!CreateChunkBuffer (chunk))
+				return false;
+			slot.chunks.push_back (chunk);
+			Con_DPrintf (
+				"BufferPool: Created transient chunk %u for slot %u (%llu bytes)\n", static_cast<unsigned> (slot.chunks.size () - 1), m_transient_slot,
+				static_cast<unsigned long long> (m_chunk_size));
 		}
-		if (chunk.memory != VK_NULL_HANDLE)
+
+		Chunk			  &chunk = slot.chunks[slot.current];
+		const VkDeviceSize offset = (chunk.ring_head + alignment - 1) & ~(alignment - 1);
+		if (offset + size <= m_chunk_size)
 		{
-			vkFreeMemory (m_device, chunk.memory, nullptr);
+			chunk.ring_head = offset + size;
+			out.buffer = chunk.buffer;
+			out.offset = offset;
+			out.size = size;
+			out.mapped_ptr = static_cast<char *> (chunk.mapped) + offset;
+			out.chunk_index = UINT32_MAX;
+			return true;
 		}
+		++slot.current;
+	}
+}
+
+void BufferPool::BeginTransientFrame (uint32_t slot_index)
+{
+	assert (slot_index < MAX_TRANSIENT_SLOTS && "Transient slot out of range");
+	m_transient_slot = slot_index;
+
+	// Everything allocated the last time this slot was active is reclaimed at once
+	TransientSlot &slot = m_transient_slots[slot_index];
+	for (Chunk &chunk : slot.chunks)
+		chunk.ring_head = 0;
+	slot.current = 0;
+}
+
+void BufferPool::Shutdown ()
+{
+	if (m_active_allocations > 0)
+	{
+		Rml::Log::Message (Rml::Log::LT_WARNING, "BufferPool: Shutdown with %u active allocations", m_active_allocations);
+	}
+
+	for (auto &chunk : m_chunks)
+	{
+		DestroyChunkBuffer (chunk);
 	}
 	m_chunks.clear ();
 	m_active_allocations = 0;
+
+	for (TransientSlot &slot : m_transient_slots)
+	{
+		for (Chunk &chunk : slot.chunks)
+			DestroyChunkBuffer (chunk);
+		slot.chunks.clear ();
+		slot.current = 0;
+	}
+	m_transient_slot = 0;
 }
 
 // ---------------------------------------------------------------------------
@@ -336,12 +408,8 @@ bool ImageMemoryPool::CreatePage (uint32_t memory_type_index)
 	Page page;
 	page.memory_type_index = memory_type_index;
 
-	VkMemoryAllocateInfo alloc_info{};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = m_page_size;
-	alloc_info.memoryTypeIndex = memory_type_index;
-
-	if (vkAllocateMemory (m_device, &alloc_info, nullptr, &page.memory) != VK_SUCCESS)
+	page.memory = R_AllocateUIMemory (m_page_size, memory_type_index, false);
+	if (page.memory == VK_NULL_HANDLE)
 	{
 		Rml::Log::Message (
 			Rml::Log::LT_ERROR, "ImageMemoryPool: Failed to allocate page (%llu bytes, mem type %u)", static_cast<unsigned long long> (m_page_size),
@@ -369,18 +437,27 @@ bool ImageMemoryPool::Allocate (const VkMemoryRequirements &mem_reqs, VkMemoryPr
 		return false;
 	}
 
+	// The texture heap only holds optimal tiling images, like ours
+	if (properties == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+	{
+		out.heap_allocation = TexMgr_AllocateExternal (&mem_reqs, &out.memory, &out.offset);
+		if (out.heap_allocation)
+		{
+			out.size = mem_reqs.size;
+			out.page_index = UINT32_MAX;
+			out.dedicated = false;
+			++m_active_allocations;
+			return true;
+		}
+	}
+
 	VkDeviceSize alignment = std::max (mem_reqs.alignment, m_buffer_image_granularity);
 
 	// Oversized images get dedicated allocations
 	if (mem_reqs.size > m_page_size)
 	{
-		VkMemoryAllocateInfo alloc_info{};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = mem_reqs.size;
-		alloc_info.memoryTypeIndex = mem_type;
-
-		VkDeviceMemory memory;
-		if (vkAllocateMemory (m_device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+		VkDeviceMemory memory = R_AllocateUIMemory (mem_reqs.size, mem_type, false);
+		if (memory == VK_NULL_HANDLE)
 		{
 			Rml::Log::Message (
 				Rml::Log::LT_ERROR, "ImageMemoryPool: Failed dedicated allocation (%llu bytes)", static_cast<unsigned long long> (mem_reqs.size));
@@ -447,12 +524,16 @@ bool ImageMemoryPool::Allocate (const VkMemoryRequirements &mem_reqs, VkMemoryPr
 
 void ImageMemoryPool::Free (const ImageMemoryAllocation &alloc)
 {
+	if (alloc.heap_allocation)
+	{
+		TexMgr_FreeExternal (alloc.heap_allocation, alloc.size);
+		--m_active_allocations;
+		return;
+	}
+
 	if (alloc.dedicated)
 	{
-		if (alloc.memory != VK_NULL_HANDLE)
-		{
-			vkFreeMemory (m_device, alloc.memory, nullptr);
-		}
+		R_FreeUIMemory (alloc.memory, alloc.size, false);
 		--m_active_allocations;
 		return;
 	}
@@ -475,7 +556,7 @@ void ImageMemoryPool::Shutdown ()
 	{
 		if (page.memory != VK_NULL_HANDLE)
 		{
-			vkFreeMemory (m_device, page.memory, nullptr);
+			R_FreeUIMemory (page.memory, m_page_size, false);
 		}
 	}
 	m_pages.clear ();
@@ -3,6 +3,8 @@
  *
  * Pool-based memory allocation for RmlUI geometry buffers and texture images.
  * Reduces Vulkan allocation count from O(objects) to O(pool_chunks).
+ * Images live in the engine's texture heap where its memory type fits, all
+ * other memory is allocated through the engine so it shows up in vkmemstats.
  */
 
 #ifndef QRMLUI_VK_ALLOCATOR_H
@@ -13,6 +15,8 @@
 #include <optional>
 #include <cstdint>
 
+struct glheapallocation_s;
+
 namespace QRmlUI
 {
 
@@ -89,6 +93,14 @@ class BufferPool
 	bool Allocate (VkDeviceSize size, VkDeviceSize alignment, BufferAllocation &out);
 	void Free (const BufferAllocation &alloc);
 
+	// Frame ring mode for short-lived data. Allocations are bumped linearly from the
+	// chunks of the current frame slot and never freed individually; the whole slot
+	// is reclaimed by BeginTransientFrame() once the GPU is done with it. Free() ignores them.
+	static constexpr uint32_t MAX_TRANSIENT_SLOTS = 4;
+
+	bool AllocateTransient (VkDeviceSize size, VkDeviceSize alignment, BufferAllocation &out);
+	void BeginTransientFrame (uint32_t slot);
+
 	uint32_t GetChunkCount () const
 	{
 		return static_cast<uint32_t> (m_chunks.size ());
@@ -103,17 +115,29 @@ class BufferPool
 	{
 		VkBuffer		  buffer = VK_NULL_HANDLE;
 		VkDeviceMemory	  memory = VK_NULL_HANDLE;
+		VkDeviceSize	  memory_size = 0;
 		void			 *mapped = nullptr;
 		FreeListAllocator allocator;
+		VkDeviceSize	  ring_head = 0; // transient chunks only
+	};
+
+	struct TransientSlot
+	{
+		std::vector<Chunk> chunks;
+		uint32_t		   current = 0;
 	};
 
 	bool CreateChunk ();
+	bool CreateChunkBuffer (Chunk &chunk);
+	void DestroyChunkBuffer (Chunk &chunk);
 
 	VkDevice						 m_device = VK_NULL_HANDLE;
 	VkPhysicalDeviceMemoryProperties m_mem_props{};
 	VkDeviceSize					 m_chunk_size = DEFAULT_CHUNK_SIZE;
 	std::vector<Chunk>				 m_chunks;
 	uint32_t						 m_active_allocations = 0;
+	TransientSlot					 m_transient_slots[MAX_TRANSIENT_SLOTS];
+	uint32_t						 m_transient_slot = 0;
 };
 
 // ---------------------------------------------------------------------------
@@ -122,11 +146,12 @@ class BufferPool
 
 struct ImageMemoryAllocation
 {
-	VkDeviceMemory memory = VK_NULL_HANDLE;
-	VkDeviceSize   offset = 0;
-	VkDeviceSize   size = 0;
-	uint32_t	   page_index = UINT32_MAX;
-	bool		   dedicated = false; // oversized images get their own allocation
+	VkDeviceMemory			   memory = VK_NULL_HANDLE;
+	VkDeviceSize			   offset = 0;
+	VkDeviceSize			   size = 0;
+	uint32_t				   page_index = UINT32_MAX;
+	bool					   dedicated = false;			  // oversized images get their own allocation
+	struct glheapallocation_s *heap_allocation = nullptr; // in the engine's texture heap
 };
 
 class ImageMemoryPool
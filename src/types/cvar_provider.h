@@ -8,11 +8,17 @@
 #ifndef QRMLUI_PORTS_CVAR_PROVIDER_H
 #define QRMLUI_PORTS_CVAR_PROVIDER_H
 
+#include <cstdint>
 #include <string>
 
 namespace QRmlUI
 {
 
+// Opaque reference to a cvar, resolved once by FindCvar() so repeated access
+// skips the name lookup. Cvars are never unregistered, a handle stays valid.
+struct CvarHandleTag;
+typedef const CvarHandleTag *CvarHandle;
+
 // Interface for cvar operations
 // Implemented by infrastructure layer (QuakeCvarProvider)
 class ICvarProvider
@@ -34,6 +40,20 @@ class ICvarProvider
 
 	// Check if a cvar exists
 	virtual bool Exists (const std::string &name) const = 0;
+
+	// Resolve a cvar handle, nullptr if the cvar doesn't exist
+	virtual CvarHandle FindCvar (const std::string &name) const = 0;
+
+	// Handle based access, the handle must not be nullptr
+	virtual float		GetFloat (CvarHandle cvar) const = 0;
+	virtual std::string GetString (CvarHandle cvar) const = 0;
+	virtual void		SetFloat (CvarHandle cvar, float value) = 0;
+	virtual void		SetString (CvarHandle cvar, const std::string &value) = 0;
+
+	// Change counters, each one bumped whenever a value changes. The global one
+	// covers all cvars so a caller can skip checking its handles when it didn't move.
+	virtual uint32_t GetChangeCount () const = 0;
+	virtual uint32_t GetChangeCount (CvarHandle cvar) const = 0;
 };
 
 } // namespace QRmlUI
@@ -10,6 +10,7 @@
 
 #include <string>
 #include <vector>
+#include "cvar_provider.h"
 
 namespace QRmlUI
 {
@@ -36,6 +37,8 @@ struct CvarBinding
 	int						 num_values = 0; // For enum type
 	std::vector<int>		 enum_values;	 // Optional explicit values for enum
 	std::vector<std::string> enum_labels;	 // Optional display labels for enum
+	CvarHandle				 cvar = nullptr; // Resolved on first sync, the cvar may register after the binding
+	uint32_t				 synced_change_count = 0; // Cvar change count the backing store was last synced at
 };
 
 } // namespace QRmlUI
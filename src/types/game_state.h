@@ -8,12 +8,40 @@
 #ifndef QRMLUI_DOMAIN_GAME_STATE_H
 #define QRMLUI_DOMAIN_GAME_STATE_H
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
 namespace QRmlUI
 {
 
+// Fixed-capacity string stored inline, for the names the engine keeps in char
+// arrays. Syncing one per frame compares in place and never allocates, longer
+// values are truncated.
+template <size_t N> struct InlineString
+{
+	char data[N] = {};
+
+	const char *c_str () const
+	{
+		return data;
+	}
+	bool operator!= (const char *value) const
+	{
+		return strncmp (data, value, N - 1) != 0;
+	}
+	InlineString &operator= (const char *value)
+	{
+		strncpy (data, value, N - 1);
+		data[N - 1] = '\0';
+		return *this;
+	}
+};
+
+// cl.levelname and cl.mapname
+typedef InlineString<128> LevelString;
+
 // Save slot info for load/save menus
 struct SaveSlotInfo
 {
@@ -125,9 +153,9 @@ struct GameState
 	bool deathmatch = false;
 	bool coop = false;
 
-	// Level info
-	std::string level_name;
-	std::string map_name;
+	// Level info, only changes on signon
+	LevelString level_name;
+	LevelString map_name;
 
 	// Time
 	int time_minutes = 0;
@@ -157,6 +185,91 @@ struct GameState
 	int					 num_mods = 0;
 };
 
+// GameState members tracked for change notification, X (field) per member. The
+// member name doubles as the data model and Lua binding name.
+#define QRMLUI_GAME_STATE_FIELDS(X) \
+	X (health)                      \
+	X (armor)                       \
+	X (ammo)                        \
+	X (active_weapon)               \
+	X (shells)                      \
+	X (nails)                       \
+	X (rockets)                     \
+	X (cells)                       \
+	X (monsters)                    \
+	X (total_monsters)              \
+	X (secrets)                     \
+	X (total_secrets)               \
+	X (has_shotgun)                 \
+	X (has_super_shotgun)           \
+	X (has_nailgun)                 \
+	X (has_super_nailgun)           \
+	X (has_grenade_launcher)        \
+	X (has_rocket_launcher)         \
+	X (has_lightning_gun)           \
+	X (has_key1)                    \
+	X (has_key2)                    \
+	X (has_invisibility)            \
+	X (has_invulnerability)         \
+	X (has_suit)                    \
+	X (has_quad)                    \
+	X (has_sigil1)                  \
+	X (has_sigil2)                  \
+	X (has_sigil3)                  \
+	X (has_sigil4)                  \
+	X (armor_type)                  \
+	X (intermission)                \
+	X (intermission_type)           \
+	X (deathmatch)                  \
+	X (coop)                        \
+	X (level_name)                  \
+	X (map_name)                    \
+	X (time_minutes)                \
+	X (time_seconds)                \
+	X (face_index)                  \
+	X (face_pain)                   \
+	X (reticle_style)               \
+	X (weapon_show)                 \
+	X (fire_flash)                  \
+	X (weapon_firing)               \
+	X (players)                     \
+	X (num_players)
+
+enum class GameStateField : uint32_t
+{
+#define QRMLUI_GAME_STATE_ENUM(field) field,
+	QRMLUI_GAME_STATE_FIELDS (QRMLUI_GAME_STATE_ENUM)
+#undef QRMLUI_GAME_STATE_ENUM
+	Count
+};
+
+// One bit per GameStateField
+typedef uint64_t GameStateMask;
+static_assert (static_cast<uint32_t> (GameStateField::Count) <= 64, "GameStateMask has one bit per field");
+
+constexpr GameStateMask GAME_STATE_ALL_FIELDS = ~GameStateMask (0);
+
+constexpr GameStateMask GameStateBit (GameStateField field)
+{
+	return GameStateMask (1) << static_cast<uint32_t> (field);
+}
+
+inline constexpr const char *kGameStateFieldNames[] = {
+#define QRMLUI_GAME_STATE_NAME(field) #field,
+	QRMLUI_GAME_STATE_FIELDS (QRMLUI_GAME_STATE_NAME)
+#undef QRMLUI_GAME_STATE_NAME
+};
+
+// Writes value into member and flags field in changes if it differs
+template <typename T, typename V> inline void UpdateGameStateField (T &member, const V &value, GameStateField field, GameStateMask &changes)
+{
+	if (member != value)
+	{
+		member = value;
+		changes |= GameStateBit (field);
+	}
+}
+
 } // namespace QRmlUI
 
 #endif // QRMLUI_DOMAIN_GAME_STATE_H
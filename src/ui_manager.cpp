@@ -12,18 +12,25 @@
 #include "internal/cvar_binding.h"
 #include "internal/menu_event_handler.h"
 #include "internal/notification_model.h"
+#include "internal/perf_overlay.h"
+#include "internal/spike_trace.h"
 #include "internal/ui_paths.h"
 #include "internal/sdl_key_map.h"
 #include "internal/quake_file_interface.h"
+#ifdef QRMLUI_HOT_RELOAD
+#include "internal/file_watcher.h"
+#endif
 
 #include <RmlUi/Core.h>
 #include <RmlUi/Debugger.h>
 #ifdef USE_LUA
 #include <RmlUi/Lua/Lua.h>
+#include <RmlUi/Lua/IncludeLua.h>
 #include "internal/lua_bridge.h"
 #endif
 
 #include "internal/reticle_plugin.h"
+#include "internal/virtual_list.h"
 
 #include <SDL.h>
 #include <algorithm>
@@ -31,6 +38,7 @@
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <iterator>
 #include <unordered_map>
 #include <set>
 #include <string>
@@ -39,6 +47,7 @@
 
 // vkQuake engine declarations — single source of truth
 #include "internal/engine_bridge.h"
+#include "quake_stats.h"
 
 namespace
 {
@@ -51,6 +60,9 @@ constexpr float	 REFERENCE_WIDTH = 1920.0f;
 constexpr float	 REFERENCE_HEIGHT = 1080.0f;
 constexpr float	 DP_RATIO_MIN = 0.5f;
 constexpr float	 DP_RATIO_MAX = 3.0f;
+// Every dp ratio yields new font pixel sizes, each with its own glyph atlas.
+// Snapping to steps keeps window resizes on the few sizes already built.
+constexpr float	 DP_RATIO_STEP = 0.05f;
 // Tallest menu panel (options_video) is ~850dp. Cap dp_ratio so it fits
 // within this fraction of the viewport height at all window sizes.
 constexpr float	 MAX_MENU_HEIGHT_DP = 850.0f;
@@ -72,6 +84,14 @@ struct UIManagerState
 	int											width = 0;
 	int											height = 0;
 	bool										assets_loaded = false;
+	bool										glyph_prewarm_pending = false;
+
+	// ui_tickrate: frames between UI ticks skip the update and reuse the last layer
+	double last_tick_time = -1.0;
+	bool   tick_skipped = false;
+
+	// ui_menuidle: last input, resize or menu change, an open menu idles after that
+	double menu_activity_time = -1.0;
 
 	// Input & menu stack
 	ui_input_mode_t			 input_mode = UI_INPUT_INACTIVE;
@@ -86,6 +106,7 @@ struct UIManagerState
 	bool		chat_visible = false;
 	bool		scoreboard_visible = false;
 	bool		intermission_visible = false;
+	bool		perf_overlay_visible = false;
 	int			last_intermission = 0;
 
 	// Deferred ops
@@ -109,16 +130,62 @@ struct UIManagerState
 
 	// Frame performance stats (CPU-side)
 	ui_perf_stats_t perf_last{};
+
+#ifdef USE_LUA
+	// Created with the engine allocator so script memory shows up in memstats.
+	// Handed to the Lua plugin, which leaves closing it to us.
+	lua_State		*lua_state = nullptr;
+	mem_lua_stats_t lua_memory{};
+#endif
 };
 
 UIManagerState g_state;
 
+// Charges engine allocations made on behalf of the UI (file loads, uploads)
+// to MEM_TAG_UI for the lifetime of the scope.
+struct MemTagScope
+{
+	int previous;
+	MemTagScope () : previous (Mem_SetTag (QRMLUI_MEM_TAG_UI)) {}
+	~MemTagScope () { Mem_SetTag (previous); }
+};
+
+void CloseLuaState ()
+{
+#ifdef USE_LUA
+	if (g_state.lua_state)
+	{
+		lua_close (g_state.lua_state);
+		g_state.lua_state = nullptr;
+	}
+#endif
+}
+
 bool IsRmlUiEnabled ()
 {
 	// Runtime kill switch controlled by host.c
 	return Cvar_VariableValue ("ui_use_rmlui") != 0.0;
 }
 
+// Keeps an open menu updating for ui_menuidle seconds, long enough for the
+// transitions the change started to finish.
+void NoteMenuActivity ()
+{
+	g_state.menu_activity_time = realtime;
+}
+
+// A menu nobody has touched for ui_menuidle seconds looks the same next frame,
+// unless the game state under it changed or it's waiting on a key to bind.
+bool IsMenuIdle ()
+{
+	const double idle = Cvar_VariableValue ("ui_menuidle");
+	if (idle <= 0.0 || g_state.input_mode != UI_INPUT_MENU_ACTIVE || g_state.menu_activity_time < 0.0)
+		return false;
+	if (g_state.pending_menu_enter || g_state.glyph_prewarm_pending || QRmlUI::g_game_state_changes || QRmlUI::MenuEventHandler::IsCapturingKey ())
+		return false;
+	return realtime - g_state.menu_activity_time >= idle;
+}
+
 bool IsViewportSettledForMenuEnter ()
 {
 	if (g_state.last_resize_time < 0.0)
@@ -187,11 +254,17 @@ void UpdateDpRatio ()
 
 	float dp_ratio = auto_dp * user_scale;
 
+	dp_ratio = std::round (dp_ratio / DP_RATIO_STEP) * DP_RATIO_STEP;
 	if (dp_ratio < DP_RATIO_MIN)
 		dp_ratio = DP_RATIO_MIN;
 	if (dp_ratio > DP_RATIO_MAX)
 		dp_ratio = DP_RATIO_MAX;
 
+	if (dp_ratio != g_state.context->GetDensityIndependentPixelRatio ())
+	{
+		QRmlUI::SpikeTrace::NoteEvent ("dp-ratio", nullptr);
+		g_state.glyph_prewarm_pending = true;
+	}
 	g_state.context->SetDensityIndependentPixelRatio (dp_ratio);
 }
 
@@ -208,6 +281,8 @@ void UpdateFontScale ()
 	if (font_scale == s_last_font_scale)
 		return;
 	s_last_font_scale = font_scale;
+	QRmlUI::SpikeTrace::NoteEvent ("font-scale", nullptr);
+	g_state.glyph_prewarm_pending = true;
 
 	float body_dp = BASE_BODY_FONT_DP * font_scale;
 	char  prop[32];
@@ -239,6 +314,386 @@ bool HasVisibleMenuDocument ()
 	return false;
 }
 
+void CollectFontFaces (Rml::Element *element, std::vector<Rml::FontFaceHandle> &faces)
+{
+	const Rml::FontFaceHandle face = element->GetFontFaceHandle ();
+	if (face && std::find (faces.begin (), faces.end (), face) == faces.end ())
+		faces.push_back (face);
+	for (int i = 0; i < element->GetNumChildren (); ++i)
+		CollectFontFaces (element->GetChild (i), faces);
+}
+
+// Text geometry is only generated when an element renders, which hidden
+// documents never do. Generate the printable ASCII set through the font
+// engine instead, so each face's glyph layer texture is built here and not
+// on the first frame that shows new text at that size.
+void PrewarmGlyphs (const std::vector<Rml::ElementDocument *> &documents)
+{
+	static const char kPrewarmGlyphs[] = " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+
+	std::vector<Rml::FontFaceHandle> faces;
+	for (Rml::ElementDocument *doc : documents)
+		CollectFontFaces (doc, faces);
+
+	Rml::FontEngineInterface *font_engine = Rml::GetFontEngineInterface ();
+	Rml::RenderManager		 *render_manager = g_state.context->GetRenderManager ();
+	if (!font_engine || !render_manager)
+		return;
+
+	for (Rml::FontFaceHandle face : faces)
+	{
+		Rml::TexturedMeshList mesh_list;
+		font_engine->GenerateString (
+			*render_manager, face, 0, kPrewarmGlyphs, Rml::Vector2f (0, 0), Rml::ColourbPremultiplied (255), 1.0f, Rml::TextShapingContext{},
+			mesh_list);
+		for (Rml::TexturedMesh &mesh : mesh_list)
+			mesh.texture.GetDimensions ();
+	}
+}
+
+#ifdef QRMLUI_HOT_RELOAD
+struct UIFileChanges
+{
+	bool any = false;
+	bool stylesheets = false;
+	bool templates = false;
+	bool other = false; // images, fonts, scripts
+};
+
+UIFileChanges CollectUIFileChanges ()
+{
+	UIFileChanges changes;
+	if (!g_state.file_interface)
+		return changes;
+	for (const std::string &path : g_state.file_interface->CollectChangedFiles ())
+	{
+		Con_DPrintf ("UI file changed: %s\n", path.c_str ());
+		const std::string extension = std::filesystem::path (path).extension ().string ();
+		changes.any = true;
+		if (extension == ".rcss")
+			changes.stylesheets = true;
+		else if (extension == ".rml")
+			changes.templates = true;
+		else
+			changes.other = true;
+	}
+	return changes;
+}
+
+// Outside g_state, which is reset by assignment: the watch thread has to be joined
+QRmlUI::FileWatcher s_file_watcher;
+
+using DocumentEntry = std::unordered_map<std::string, Rml::ElementDocument *>::value_type;
+
+// Replaces a document with a fresh load of its file, keeping its visibility
+void ReloadDocument (DocumentEntry &entry)
+{
+	if (g_state.pending_menu_enter == entry.second)
+		g_state.pending_menu_enter = nullptr;
+
+	const bool was_visible = entry.second->IsVisible ();
+	entry.second->Close ();
+	entry.second = g_state.context->LoadDocument (entry.first);
+	if (entry.second)
+	{
+		QRmlUI::MenuEventHandler::RegisterWithDocument (entry.second);
+		if (was_visible)
+			entry.second->Show ();
+	}
+}
+
+std::string NormalUIPath (const std::string &path)
+{
+	return std::filesystem::path (path).lexically_normal ().generic_string ();
+}
+
+// The files a document is built from: itself and, through .rml templates too,
+// every stylesheet, template and script it links.
+void CollectDocumentDependencies (const std::string &path, std::set<std::string> &dependencies)
+{
+	const std::string normal = NormalUIPath (path);
+	if (!dependencies.insert (normal).second || std::filesystem::path (normal).extension () != ".rml")
+		return;
+
+	Rml::String source;
+	if (!Rml::GetFileInterface ()->LoadFile (normal, source))
+		return;
+
+	const std::filesystem::path directory = std::filesystem::path (normal).parent_path ();
+	for (size_t tag = source.find ('<'); tag != Rml::String::npos; tag = source.find ('<', tag + 1))
+	{
+		const char *attribute;
+		if (source.compare (tag + 1, 4, "link") == 0)
+			attribute = "href=\"";
+		else if (source.compare (tag + 1, 6, "script") == 0)
+			attribute = "src=\"";
+		else
+			continue;
+
+		const size_t tag_end = source.find ('>', tag);
+		const size_t start = source.find (attribute, tag);
+		if (start == Rml::String::npos || start > tag_end)
+			continue;
+		const size_t value = start + strlen (attribute);
+		const size_t value_end = source.find ('"', value);
+		if (value_end == Rml::String::npos || value_end > tag_end)
+			continue;
+		CollectDocumentDependencies ((directory / source.substr (value, value_end - value)).string (), dependencies);
+	}
+}
+
+// Watcher-driven reload, limited to the documents built from a changed file.
+// A stylesheet change restyles the document and keeps its DOM state, a
+// template or script change reloads that document alone.
+void ReloadChangedDocuments ()
+{
+	std::set<std::string> changed;
+	for (const std::string &path : g_state.file_interface->CollectChangedFiles ())
+	{
+		Con_DPrintf ("UI file changed: %s\n", path.c_str ());
+		changed.insert (NormalUIPath (path));
+	}
+	if (changed.empty ())
+		return;
+	g_state.file_interface->InvalidateCache ();
+
+	std::vector<std::pair<DocumentEntry *, bool>> affected; // document, full reload
+	std::set<std::string>						  referenced;
+	bool										  templates = false;
+	bool										  stylesheets = false;
+	for (auto &pair : g_state.documents)
+	{
+		if (!pair.second)
+			continue;
+		std::set<std::string> dependencies;
+		CollectDocumentDependencies (pair.first, dependencies);
+
+		bool restyle = false;
+		bool reload = false;
+		for (const std::string &dependency : dependencies)
+		{
+			referenced.insert (dependency);
+			if (!changed.count (dependency))
+				continue;
+			if (std::filesystem::path (dependency).extension () == ".rcss")
+				restyle = true;
+			else
+				reload = true;
+		}
+		if (reload || restyle)
+			affected.emplace_back (&pair, reload);
+		templates = templates || reload;
+		stylesheets = stylesheets || restyle;
+	}
+
+	bool unreferenced = false; // images, fonts
+	for (const std::string &path : changed)
+		unreferenced = unreferenced || !referenced.count (path);
+
+	if (stylesheets)
+		Rml::Factory::ClearStyleSheetCache ();
+	if (templates)
+		Rml::Factory::ClearTemplateCache ();
+	if (unreferenced)
+		Rml::ReleaseTextures ();
+
+	for (const auto &document : affected)
+	{
+		Con_DPrintf ("UI hot reload: %s %s\n", document.second ? "reloading" : "restyling", document.first->first.c_str ());
+		if (document.second)
+			ReloadDocument (*document.first);
+		else
+			document.first->second->ReloadStyleSheet ();
+	}
+	if (!affected.empty ())
+		s_last_font_scale = -1.0f;
+}
+
+// ui_hot_reload: watch the ui directories and reload what changed as it is saved
+void UpdateHotReload ()
+{
+	if (Cvar_VariableValue ("ui_hot_reload") == 0.0)
+	{
+		s_file_watcher.Stop ();
+		return;
+	}
+
+	// The game dir's tree overrides the base one, both can hold UI files
+	std::vector<std::string> directories = {std::string (com_basedir) + "/ui"};
+	if (com_gamedir[0] && strcmp (com_gamedir, com_basedir) != 0)
+		directories.push_back (std::string (com_gamedir) + "/ui");
+	if (!s_file_watcher.IsRunning () || s_file_watcher.GetDirectories () != directories)
+		s_file_watcher.Start (directories);
+
+	if (s_file_watcher.TakeChanges (realtime))
+		ReloadChangedDocuments ();
+}
+#endif
+
+// ── Document benchmark (ui_bench) ─────────────────────────────────────
+
+// Runs over real frames: each document is shown alone for a fixed number of
+// frames while a script owns g_game_state, and the frames' ui_perf_stats_t are
+// collected from UI_EndFrame. The engine stops syncing game state meanwhile.
+struct UIBench
+{
+	bool					 active = false;
+	std::vector<std::string> documents;
+	std::vector<std::string> hidden; // visible before the run, shown again after it
+	size_t					 document = 0;
+	int						 frames = 0;
+	int						 rows = 0;
+	int						 frame = 0;
+	bool					 was_visible = false;
+
+	std::vector<ui_perf_stats_t> samples;
+	uint64_t					 compiled_geometry = 0;
+};
+
+UIBench s_bench;
+
+constexpr int BENCH_DEFAULT_FRAMES = 300;
+constexpr int BENCH_DEFAULT_ROWS = 16;
+
+const char *const kBenchDefaultDocuments[] = {
+	"ui/rml/hud/hud.rml", "ui/rml/hud/scoreboard.rml", "ui/rml/hud/notify.rml", "ui/rml/menus/options.rml", "ui/rml/menus/options_keys.rml",
+};
+
+double BenchPercentile (std::vector<double> &values, double fraction)
+{
+	if (values.empty ())
+		return 0.0;
+	std::sort (values.begin (), values.end ());
+	return values[static_cast<size_t> (fraction * (values.size () - 1) + 0.5)];
+}
+
+void BenchReportPhase (const char *name, double ui_perf_stats_t::*phase)
+{
+	std::vector<double> values;
+	values.reserve (s_bench.samples.size ());
+	for (const ui_perf_stats_t &sample : s_bench.samples)
+		values.push_back (sample.*phase);
+	const double p50 = BenchPercentile (values, 0.5);
+	const double p95 = BenchPercentile (values, 0.95);
+	const double p99 = BenchPercentile (values, 0.99);
+	Con_Printf ("  %-16s %8.3f %8.3f %8.3f %8.3f ms\n", name, p50, p95, p99, values.empty () ? 0.0 : values.back ());
+}
+
+void BenchReportDocument ()
+{
+	double draw_calls = 0.0, triangles = 0.0;
+	for (const ui_perf_stats_t &sample : s_bench.samples)
+	{
+		draw_calls += sample.draw_calls;
+		triangles += sample.triangles;
+	}
+	const double count = std::max (1.0, (double)s_bench.samples.size ());
+
+	Con_Printf ("---- %s (%d frames)\n", s_bench.documents[s_bench.document].c_str (), (int)s_bench.samples.size ());
+	Con_Printf ("  %-16s %8s %8s %8s %8s\n", "phase", "p50", "p95", "p99", "max");
+	BenchReportPhase ("total", &ui_perf_stats_t::total_ms);
+	BenchReportPhase ("update", &ui_perf_stats_t::update_ms);
+	BenchReportPhase ("update model", &ui_perf_stats_t::update_model_ms);
+	BenchReportPhase ("update lua", &ui_perf_stats_t::update_lua_ms);
+	BenchReportPhase ("update context", &ui_perf_stats_t::update_context_ms);
+	BenchReportPhase ("render", &ui_perf_stats_t::render_ms);
+	BenchReportPhase ("end", &ui_perf_stats_t::end_ms);
+	Con_Printf (
+		"  %.1f draws, %.0f triangles, %.2f geometry compiles per frame\n", draw_calls / count, triangles / count, (double)s_bench.compiled_geometry / count);
+}
+
+void BenchShowDocument ()
+{
+	s_bench.samples.clear ();
+	s_bench.compiled_geometry = 0;
+	s_bench.frame = 0;
+	const char *path = s_bench.documents[s_bench.document].c_str ();
+	if (UI_LoadDocument (path))
+		UI_ShowDocument (path, 0);
+}
+
+// Damage bursts, weapon switches and a notify flood, the same sequence every run
+void BenchScriptFrame ()
+{
+	using namespace QRmlUI;
+	static const int weapons[] = {IT_SHOTGUN, IT_SUPER_SHOTGUN, IT_NAILGUN, IT_SUPER_NAILGUN, IT_GRENADE_LAUNCHER, IT_ROCKET_LAUNCHER, IT_LIGHTNING};
+	const int		 frame = s_bench.frame;
+	GameState		&state = g_game_state;
+	GameStateMask	&changes = g_game_state_changes;
+
+	UpdateGameStateField (state.health, 100 - (frame % 60 < 20 ? (frame % 20) * 4 : 0), GameStateField::health, changes);
+	UpdateGameStateField (state.armor, 200 - (frame / 3) % 200, GameStateField::armor, changes);
+	UpdateGameStateField (state.face_pain, frame % 60 < 20, GameStateField::face_pain, changes);
+	UpdateGameStateField (state.active_weapon, weapons[(frame / 45) % std::size (weapons)], GameStateField::active_weapon, changes);
+	UpdateGameStateField (state.weapon_show, frame % 45 < 10, GameStateField::weapon_show, changes);
+	UpdateGameStateField (state.fire_flash, frame % 8 == 0, GameStateField::fire_flash, changes);
+	UpdateGameStateField (state.ammo, 100 - frame % 100, GameStateField::ammo, changes);
+	UpdateGameStateField (state.time_seconds, (frame / 60) % 60, GameStateField::time_seconds, changes);
+	UpdateGameStateField (state.deathmatch, true, GameStateField::deathmatch, changes);
+
+	if (frame == 0)
+	{
+		UpdateGameStateField (state.has_shotgun, true, GameStateField::has_shotgun, changes);
+		UpdateGameStateField (state.has_super_shotgun, true, GameStateField::has_super_shotgun, changes);
+		UpdateGameStateField (state.has_nailgun, true, GameStateField::has_nailgun, changes);
+		UpdateGameStateField (state.has_super_nailgun, true, GameStateField::has_super_nailgun, changes);
+		UpdateGameStateField (state.has_grenade_launcher, true, GameStateField::has_grenade_launcher, changes);
+		UpdateGameStateField (state.has_rocket_launcher, true, GameStateField::has_rocket_launcher, changes);
+		UpdateGameStateField (state.has_lightning_gun, true, GameStateField::has_lightning_gun, changes);
+	}
+
+	// Frag counts shuffle the scoreboard every half second
+	if (frame % 30 == 0)
+	{
+		std::vector<PlayerInfo> players (s_bench.rows);
+		for (int i = 0; i < s_bench.rows; ++i)
+		{
+			players[i].name = "player" + std::to_string (i);
+			players[i].frags = (i * 7 + frame / 30) % (s_bench.rows + 5);
+			players[i].top_color = i % 14;
+			players[i].bottom_color = (i + 3) % 14;
+			players[i].ping = 20 + (i * 13) % 180;
+			players[i].is_local = i == 0;
+		}
+		std::sort (players.begin (), players.end (), [] (const PlayerInfo &a, const PlayerInfo &b) { return a.frags > b.frags; });
+		UpdateGameStateField (state.players, players, GameStateField::players, changes);
+		UpdateGameStateField (state.num_players, s_bench.rows, GameStateField::num_players, changes);
+	}
+
+	if (frame % 4 == 0)
+	{
+		char line[64];
+		snprintf (line, sizeof (line), "bench notify line %d\n", frame / 4);
+		NotificationModel::NotifyPrint (line, realtime);
+	}
+}
+
+void BenchFinish ()
+{
+	for (const std::string &path : s_bench.hidden)
+		UI_ShowDocument (path.c_str (), 0);
+	g_state.visible = s_bench.was_visible;
+	s_bench = UIBench{};
+	QRmlUI::GameDataModel::MarkAllDirty ();
+}
+
+// UI_EndFrame: the frame's stats are final
+void BenchEndFrame ()
+{
+	s_bench.samples.push_back (g_state.perf_last);
+	if (g_state.render_interface)
+		s_bench.compiled_geometry += g_state.render_interface->GetFrameCompiledGeometry ();
+	if (++s_bench.frame < s_bench.frames)
+		return;
+
+	BenchReportDocument ();
+	UI_HideDocument (s_bench.documents[s_bench.document].c_str ());
+	if (++s_bench.document < s_bench.documents.size ())
+		BenchShowDocument ();
+	else
+		BenchFinish ();
+}
+
 } // anonymous namespace
 
 // C API Implementation
@@ -256,6 +711,8 @@ extern "C"
 
 		(void)base_path; // Historically used for engine_base_path; kept for API compat.
 
+		MemTagScope mem_tag;
+
 		// Reset any leftover state in case we reinitialize within the same process.
 		g_state = UIManagerState{};
 
@@ -281,14 +738,19 @@ extern "C"
 			return 0;
 		}
 
-		// Register reticle custom elements (after Rml::Initialise so StyleSheetSpecification is ready)
+		// Register custom elements (after Rml::Initialise so StyleSheetSpecification is ready)
 		QRmlUI::ReticlePlugin::Initialise ();
+		QRmlUI::ElementVirtualList::Initialise ();
+		QRmlUI::PerfOverlay::Initialise ();
 
 #ifdef USE_LUA
 		// Initialize Lua plugin — registers LuaDocument instancer (handles <script> tags)
 		// and LuaEventListenerInstancer (handles inline Lua event handlers).
-		// Passing nullptr lets RmlUI own the lua_State; it is cleaned up in Rml::Shutdown().
-		Rml::Lua::Initialise ();
+		// The state is ours and is closed after Rml::Shutdown().
+		g_state.lua_memory = {};
+		g_state.lua_state = lua_newstate (Mem_LuaAlloc, &g_state.lua_memory);
+		luaL_openlibs (g_state.lua_state);
+		Rml::Lua::Initialise (g_state.lua_state);
 		QRmlUI::LuaBridge::Initialize ();
 		Con_DPrintf ("UI_Init: Lua scripting enabled\n");
 #endif
@@ -299,6 +761,7 @@ extern "C"
 		{
 			Con_Printf ("UI_Init: Failed to create RmlUI context\n");
 			Rml::Shutdown ();
+			CloseLuaState ();
 			return 0;
 		}
 
@@ -434,6 +897,11 @@ extern "C"
 			}
 		}
 		g_state.documents.clear ();
+		g_state.perf_overlay_visible = false;
+
+#ifdef QRMLUI_HOT_RELOAD
+		s_file_watcher.Stop ();
+#endif
 
 		// Shutdown debugger
 		Rml::Debugger::Shutdown ();
@@ -447,6 +915,7 @@ extern "C"
 
 		// Shutdown RmlUI
 		Rml::Shutdown ();
+		CloseLuaState ();
 
 		// Cleanup interfaces
 		g_state.render_interface->Shutdown ();
@@ -521,6 +990,11 @@ extern "C"
 	{
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context)
 			return;
+		MemTagScope mem_tag;
+
+#ifdef QRMLUI_HOT_RELOAD
+		UpdateHotReload ();
+#endif
 
 		// Process pending operations BEFORE rendering can start
 		// This ensures UI state changes happen atomically between frames
@@ -586,6 +1060,20 @@ extern "C"
 	{
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context)
 			return;
+		MemTagScope mem_tag;
+
+		// The HUD's data changes at most at the server's tick rate, it doesn't need a
+		// style/layout pass per rendered frame. Menus stay per frame for input response.
+		// The HUD inertia offset is applied in postprocess.frag and stays per frame too.
+		// An idle menu waits for input, an animation it started or the game state to change.
+		const double tickrate = Cvar_VariableValue ("ui_tickrate");
+		g_state.tick_skipped = tickrate > 0.0 && g_state.input_mode != UI_INPUT_MENU_ACTIVE && g_state.last_tick_time >= 0.0 &&
+							   realtime >= g_state.last_tick_time && realtime - g_state.last_tick_time < 1.0 / tickrate;
+		g_state.tick_skipped = !s_bench.active && (g_state.tick_skipped || IsMenuIdle ());
+		if (g_state.tick_skipped)
+			return;
+		g_state.last_tick_time = realtime;
+
 		double update_start = Sys_DoubleTime ();
 		double phase_start = update_start;
 
@@ -599,8 +1087,14 @@ extern "C"
 		// Note: Pending operations are now processed in UI_ProcessPending()
 		// which is called from the main thread before rendering tasks start.
 
+		// ui_bench stands in for the engine's game state sync
+		if (s_bench.active)
+			BenchScriptFrame ();
+
 		// Update game data model to sync with Quake state
 		QRmlUI::GameDataModel::Update ();
+		// Cvars changed by the console, binds or the engine since the last frame
+		QRmlUI::CvarBindingManager::Update ();
 		phase_end = Sys_DoubleTime ();
 		g_state.perf_last.update_model_ms = (phase_end - phase_start) * 1000.0;
 		phase_start = phase_end;
@@ -615,6 +1109,9 @@ extern "C"
 		g_state.perf_last.update_lua_ms = 0.0;
 #endif
 
+		// Both consumers have seen this frame's changes
+		QRmlUI::g_game_state_changes = 0;
+
 		// Weapon switch flicker — toggle "weapon-switched" class on HUD doc.
 		// The animation itself is defined in hud.rcss (@keyframes weapon-flicker).
 		// Remove the class first to reset, defer re-add by 1 frame so the
@@ -629,6 +1126,7 @@ extern "C"
 				{
 					it->second->SetClass ("weapon-switched", false);
 					it->second->SetClass ("ammo-detail-visible", true);
+					QRmlUI::SpikeTrace::NoteEvent ("class", "-weapon-switched +ammo-detail-visible");
 				}
 				g_state.weapon_flicker_frames = 2;
 				g_state.ammo_detail_frames = 180; // ~3s at 60fps
@@ -644,6 +1142,7 @@ extern "C"
 				if (it != g_state.documents.end () && it->second)
 				{
 					it->second->SetClass ("weapon-switched", true);
+					QRmlUI::SpikeTrace::NoteEvent ("class", "+weapon-switched");
 				}
 			}
 		}
@@ -658,6 +1157,7 @@ extern "C"
 				if (it != g_state.documents.end () && it->second)
 				{
 					it->second->SetClass ("ammo-detail-visible", false);
+					QRmlUI::SpikeTrace::NoteEvent ("class", "-ammo-detail-visible");
 				}
 			}
 		}
@@ -668,6 +1168,7 @@ extern "C"
 
 		// Update notification expiry state
 		QRmlUI::NotificationModel::Update (realtime);
+		QRmlUI::PerfOverlay::Update (realtime);
 		phase_end = Sys_DoubleTime ();
 		g_state.perf_last.update_notify_ms = (phase_end - phase_start) * 1000.0;
 		phase_start = phase_end;
@@ -677,6 +1178,18 @@ extern "C"
 		g_state.perf_last.update_context_ms = (phase_end - phase_start) * 1000.0;
 		phase_start = phase_end;
 
+		// The scale changed last frame and Update() has resolved the new font
+		// sizes, build their glyph atlases for every loaded document at once.
+		if (g_state.glyph_prewarm_pending)
+		{
+			g_state.glyph_prewarm_pending = false;
+			std::vector<Rml::ElementDocument *> documents;
+			for (const auto &pair : g_state.documents)
+				if (pair.second)
+					documents.push_back (pair.second);
+			PrewarmGlyphs (documents);
+		}
+
 		// Apply deferred menu-enter class AFTER Update() has resolved styles.
 		// The delay ensures the document has computed its base state (opacity: 0)
 		// before the class change triggers a transition.  This also lets the menu
@@ -703,6 +1216,8 @@ extern "C"
 					g_state.startup_menu_enter = false;
 				}
 				doc->SetClass ("menu-enter", true);
+				QRmlUI::SpikeTrace::NoteEvent ("class", "+menu-enter");
+				NoteMenuActivity ();
 
 				// Auto-focus the first tabbable element for keyboard navigation.
 				// Suppress the focus sound so it doesn't play on menu open.
@@ -717,8 +1232,6 @@ extern "C"
 			}
 		}
 
-		// Clear any temporary suppression of UI change events after data bindings update.
-		QRmlUI::CvarBindingManager::NotifyUIUpdateComplete ();
 		phase_end = Sys_DoubleTime ();
 		g_state.perf_last.update_post_ms = (phase_end - phase_start) * 1000.0;
 		g_state.perf_last.update_ms = (Sys_DoubleTime () - update_start) * 1000.0;
@@ -728,15 +1241,12 @@ extern "C"
 	{
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context || !g_state.visible)
 			return;
-		double render_start = Sys_DoubleTime ();
-		g_state.context->Render ();
+		MemTagScope mem_tag;
+		double		render_start = Sys_DoubleTime ();
+		// Nothing changed since the last tick, composite its image again if there is one
+		if (!g_state.tick_skipped || !g_state.render_interface || !g_state.render_interface->ReuseLayer ())
+			g_state.context->Render ();
 		g_state.perf_last.render_ms = (Sys_DoubleTime () - render_start) * 1000.0;
-		if (g_state.render_interface)
-		{
-			g_state.perf_last.draw_calls = static_cast<int> (g_state.render_interface->GetFrameDrawCalls ());
-			g_state.perf_last.indices = static_cast<int> (g_state.render_interface->GetFrameIndices ());
-			g_state.perf_last.triangles = g_state.perf_last.indices / 3;
-		}
 	}
 
 	void UI_Resize (int width, int height)
@@ -751,7 +1261,9 @@ extern "C"
 
 		g_state.width = width;
 		g_state.height = height;
+		NoteMenuActivity ();
 		g_state.context->SetDimensions (Rml::Vector2i (width, height));
+		QRmlUI::SpikeTrace::NoteEvent ("resize", nullptr);
 		UpdateCachedDpiScale ();
 		UpdateDpRatio ();
 	}
@@ -768,6 +1280,7 @@ extern "C"
 			return 0;
 		if (!g_state.visible && g_state.menu_stack.empty ())
 			return 0;
+		NoteMenuActivity ();
 
 		Rml::Input::KeyIdentifier rml_key = QRmlUI::TranslateKey (key);
 		int						  modifiers = QRmlUI::GetKeyModifiers ();
@@ -791,6 +1304,7 @@ extern "C"
 			return 0;
 		if (!g_state.visible && g_state.menu_stack.empty ())
 			return 0;
+		NoteMenuActivity ();
 
 		bool consumed = g_state.context->ProcessTextInput (static_cast<Rml::Character> (codepoint));
 		return consumed ? 1 : 0;
@@ -806,6 +1320,7 @@ extern "C"
 			return 0;
 		if (!g_state.visible && g_state.menu_stack.empty ())
 			return 0;
+		NoteMenuActivity ();
 
 		int	 modifiers = QRmlUI::GetKeyModifiers ();
 		bool consumed = g_state.context->ProcessMouseMove (px, py, modifiers);
@@ -818,6 +1333,7 @@ extern "C"
 			return 0;
 		if (!g_state.visible && g_state.menu_stack.empty ())
 			return 0;
+		NoteMenuActivity ();
 
 		int rml_button = 0;
 		switch (button)
@@ -864,6 +1380,7 @@ extern "C"
 			return 0;
 		if (!g_state.visible && g_state.menu_stack.empty ())
 			return 0;
+		NoteMenuActivity ();
 
 		int	 modifiers = QRmlUI::GetKeyModifiers ();
 		bool consumed = g_state.context->ProcessMouseWheel (Rml::Vector2f (x, -y), modifiers);
@@ -877,6 +1394,7 @@ extern "C"
 			Con_Printf ("WARNING: UI_LoadDocument: null path\n");
 			return 0;
 		}
+		MemTagScope mem_tag;
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context)
 			return 0;
 
@@ -953,6 +1471,8 @@ extern "C"
 			{
 				it->second->Show ();
 			}
+			QRmlUI::SpikeTrace::NoteEvent ("show", path);
+			NoteMenuActivity ();
 		}
 	}
 
@@ -970,6 +1490,8 @@ extern "C"
 		if (it != g_state.documents.end () && it->second)
 		{
 			it->second->Hide ();
+			QRmlUI::SpikeTrace::NoteEvent ("hide", path);
+			NoteMenuActivity ();
 		}
 	}
 
@@ -1013,45 +1535,42 @@ extern "C"
 
 	void UI_ReloadDocuments (void)
 	{
+		// Also called on game dir changes, cached files may now be overridden
+		if (g_state.file_interface)
+			g_state.file_interface->InvalidateCache ();
+
 #ifdef QRMLUI_HOT_RELOAD
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context)
 			return;
 
-		Con_DPrintf ("UI_ReloadDocuments: Reloading all documents\n");
-
-		// Clear caches so RmlUI re-reads files from disk
-		Rml::Factory::ClearStyleSheetCache ();
-		Rml::Factory::ClearTemplateCache ();
-		Rml::ReleaseTextures ();
-
 		// Pick up fonts from the new game directory (e.g. mod-specific fonts).
 		// Already-loaded fonts are skipped, so this is safe to call repeatedly.
 		UI_DiscoverFonts ();
 
+		// Only drop the caches whose files changed, stylesheets and templates
+		// that are still current stay parsed across the reload.
+		const UIFileChanges changes = CollectUIFileChanges ();
+		if (!changes.any)
+		{
+			Con_DPrintf ("UI_ReloadDocuments: No UI files changed\n");
+			return;
+		}
+		Con_DPrintf ("UI_ReloadDocuments: Reloading all documents\n");
+		if (changes.stylesheets)
+			Rml::Factory::ClearStyleSheetCache ();
+		if (changes.templates)
+			Rml::Factory::ClearTemplateCache ();
+		if (changes.other)
+			Rml::ReleaseTextures ();
+
 		// Invalidate deferred pointer — documents are about to be replaced.
 		g_state.pending_menu_enter = nullptr;
 		s_last_font_scale = -1.0f;
 
-		// Store visibility state and reload each document
 		for (auto &pair : g_state.documents)
 		{
 			if (pair.second)
-			{
-				bool		was_visible = pair.second->IsVisible ();
-				std::string path = pair.first;
-
-				pair.second->Close ();
-				pair.second = g_state.context->LoadDocument (path);
-
-				if (pair.second)
-				{
-					QRmlUI::MenuEventHandler::RegisterWithDocument (pair.second);
-					if (was_visible)
-					{
-						pair.second->Show ();
-					}
-				}
-			}
+				ReloadDocument (pair);
 		}
 
 		Con_DPrintf ("UI_ReloadDocuments: Done\n");
@@ -1066,6 +1585,12 @@ extern "C"
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context)
 			return;
 
+		if (!CollectUIFileChanges ().stylesheets)
+		{
+			Con_DPrintf ("UI_ReloadStyleSheets: No stylesheets changed\n");
+			return;
+		}
+		g_state.file_interface->InvalidateCache ();
 		Con_DPrintf ("UI_ReloadStyleSheets: Reloading stylesheets\n");
 
 		for (auto &pair : g_state.documents)
@@ -1126,17 +1651,9 @@ extern "C"
 					}
 					g_state.assets_loaded = true;
 
-					// Pre-warm HUD documents: load + one context update while
-					// hidden so the first-use style/layout spike happens here
-					// instead of on the first live gameplay frame.
-					if (g_state.context && UI_LoadDocument (QRmlUI::Paths::kHud))
-					{
-						UI_LoadDocument (QRmlUI::Paths::kHudNotify);
-						UI_LoadDocument (QRmlUI::Paths::kHudCenterprint);
-						UI_LoadDocument (QRmlUI::Paths::kHudChat);
-						g_state.context->Update ();
-						Con_DPrintf ("UI_InitializeVulkan: HUD pre-warmed\n");
-					}
+					// Parse the HUD documents up front, the full pre-warm pass
+					// runs again during every map's signon (UI_PrewarmHUD).
+					UI_PrewarmHUD ();
 				}
 			}
 			else
@@ -1163,6 +1680,29 @@ extern "C"
 		g_state.perf_last.begin_ms = (Sys_DoubleTime () - begin_start) * 1000.0;
 	}
 
+	int UI_BeginLayerFrame (int width, int height)
+	{
+		if (!IsRmlUiEnabled () || !g_state.render_interface)
+			return 0;
+		double begin_start = Sys_DoubleTime ();
+		if (!g_state.render_interface->BeginLayerFrame (width, height))
+			return 0;
+		g_state.perf_last = ui_perf_stats_t{};
+		g_state.perf_last.begin_ms = (Sys_DoubleTime () - begin_start) * 1000.0;
+		return 1;
+	}
+
+	void UI_CompositeLayer (void *cmd)
+	{
+		if (!IsRmlUiEnabled () || !g_state.render_interface)
+			return;
+		double composite_start = Sys_DoubleTime ();
+		g_state.render_interface->CompositeLayer (static_cast<VkCommandBuffer> (cmd));
+		const double composite_ms = (Sys_DoubleTime () - composite_start) * 1000.0;
+		g_state.perf_last.end_ms += composite_ms;
+		g_state.perf_last.total_ms += composite_ms;
+	}
+
 	// Called after UI rendering
 	void UI_EndFrame (void)
 	{
@@ -1171,10 +1711,35 @@ extern "C"
 		double end_start = Sys_DoubleTime ();
 		if (g_state.render_interface)
 		{
+			// Layer draws are only recorded here, and not at all while the layer is unchanged
 			g_state.render_interface->EndFrame ();
+			g_state.perf_last.draw_calls = static_cast<int> (g_state.render_interface->GetFrameDrawCalls ());
+			g_state.perf_last.indices = static_cast<int> (g_state.render_interface->GetFrameIndices ());
+			g_state.perf_last.triangles = g_state.perf_last.indices / 3;
 		}
 		g_state.perf_last.end_ms = (Sys_DoubleTime () - end_start) * 1000.0;
 		g_state.perf_last.total_ms = g_state.perf_last.begin_ms + g_state.perf_last.update_ms + g_state.perf_last.render_ms + g_state.perf_last.end_ms;
+		g_state.perf_last.overlay_ms = QRmlUI::PerfOverlay::IsVisible () ? QRmlUI::PerfOverlay::TakeCostMs () : -1.0;
+
+		QRmlUI::SpikeTraceTimings timings;
+		timings.total_ms = g_state.perf_last.total_ms;
+		timings.update_ms = g_state.perf_last.update_ms;
+		timings.update_model_ms = g_state.perf_last.update_model_ms;
+		timings.update_lua_ms = g_state.perf_last.update_lua_ms;
+		timings.update_context_ms = g_state.perf_last.update_context_ms;
+		timings.render_ms = g_state.perf_last.render_ms;
+		QRmlUI::SpikeTrace::EndFrame (
+			Cvar_VariableValue ("ui_trace_threshold"), realtime, timings, g_state.context,
+			g_state.render_interface ? g_state.render_interface->GetFrameCompiledGeometry () : 0,
+			g_state.render_interface ? g_state.render_interface->GetFrameCompiledVertices () : 0);
+
+		if (s_bench.active)
+			BenchEndFrame ();
+	}
+
+	void UI_DumpSpikeTraces (void)
+	{
+		QRmlUI::SpikeTrace::Dump ();
 	}
 
 	// GPU timestamp instrumentation — primary CB, around UI render pass
@@ -1203,6 +1768,13 @@ extern "C"
 		}
 	}
 
+	void *UI_TakeLayerCommandBuffer (void)
+	{
+		if (!g_state.render_interface)
+			return nullptr;
+		return g_state.render_interface->TakeLayerCommandBuffer ();
+	}
+
 	void UI_GetPerfStats (ui_perf_stats_t *out_stats)
 	{
 		if (!out_stats)
@@ -1232,6 +1804,7 @@ extern "C"
 		}
 		ui_input_mode_t old_mode = g_state.input_mode;
 		g_state.input_mode = mode;
+		NoteMenuActivity ();
 
 		// Automatically manage visibility based on mode
 		if (mode == UI_INPUT_MENU_ACTIVE || mode == UI_INPUT_OVERLAY)
@@ -1344,6 +1917,7 @@ extern "C"
 	{
 		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context || !path)
 			return;
+		MemTagScope mem_tag;
 
 		// Cancel any pending close requests since we're explicitly opening a menu.
 		g_state.pending_escape = false;
@@ -1381,6 +1955,7 @@ extern "C"
 		doc->SetClass ("menu-enter", false);
 		doc->SetClass ("startup-enter", false);
 		doc->Show ();
+		QRmlUI::SpikeTrace::NoteEvent ("show", path);
 		g_state.pending_menu_enter = doc;
 		g_state.pending_menu_enter_frames = MENU_ENTER_DELAY_FRAMES;
 
@@ -1430,6 +2005,84 @@ extern "C"
 		}
 	}
 
+	// ── HUD pre-warm ───────────────────────────────────────────────────
+
+	// Stand-in state for the pre-warm pass: everything owned and nonzero so the
+	// data-if/data-for branches the HUD hides on an empty state get built too.
+	static void FillPrewarmGameState (QRmlUI::GameState &state)
+	{
+		state.health = 100;
+		state.armor = 200;
+		state.armor_type = 3;
+		state.ammo = 100;
+		state.active_weapon = 32; // IT_ROCKET_LAUNCHER
+		state.shells = 100;
+		state.nails = 200;
+		state.rockets = 100;
+		state.cells = 100;
+		state.monsters = 10;
+		state.total_monsters = 100;
+		state.secrets = 1;
+		state.total_secrets = 10;
+		state.has_shotgun = state.has_super_shotgun = state.has_nailgun = state.has_super_nailgun = true;
+		state.has_grenade_launcher = state.has_rocket_launcher = state.has_lightning_gun = true;
+		state.has_key1 = state.has_key2 = true;
+		state.has_invisibility = state.has_invulnerability = state.has_suit = state.has_quad = true;
+		state.has_sigil1 = state.has_sigil2 = state.has_sigil3 = state.has_sigil4 = true;
+		state.intermission = true;
+		state.intermission_type = 1;
+		state.deathmatch = true;
+		state.time_minutes = 10;
+		state.time_seconds = 59;
+		state.players.assign (4, QRmlUI::PlayerInfo{"player", 100, 4, 12, 50, false});
+		state.players[0].is_local = true;
+		state.num_players = static_cast<int> (state.players.size ());
+	}
+
+	void UI_PrewarmHUD (void)
+	{
+		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context || !g_state.assets_loaded)
+			return;
+
+		const double start = Sys_DoubleTime ();
+
+		const char *const hud = g_state.current_hud.empty () ? QRmlUI::Paths::kHud : g_state.current_hud.c_str ();
+		const char *const paths[] = {
+			hud, QRmlUI::Paths::kHudNotify, QRmlUI::Paths::kHudCenterprint, QRmlUI::Paths::kHudChat, QRmlUI::Paths::kScoreboard, QRmlUI::Paths::kIntermission,
+		};
+
+		// UI_LoadDocument leaves new documents hidden and never touches input mode
+		std::vector<Rml::ElementDocument *> documents;
+		for (const char *path : paths)
+		{
+			if (!UI_LoadDocument (path))
+				continue;
+			auto it = g_state.documents.find (path);
+			if (it != g_state.documents.end () && it->second)
+				documents.push_back (it->second);
+		}
+		if (documents.empty ())
+			return;
+
+		// Style, layout and data bindings against a fully populated state
+		const QRmlUI::GameState		saved_state = QRmlUI::g_game_state;
+		const QRmlUI::GameStateMask saved_changes = QRmlUI::g_game_state_changes;
+		FillPrewarmGameState (QRmlUI::g_game_state);
+		QRmlUI::GameDataModel::MarkAllDirty ();
+		g_state.context->Update ();
+
+		PrewarmGlyphs (documents);
+		g_state.glyph_prewarm_pending = false;
+
+		// Hand the real state back, the first live frame refreshes every binding
+		QRmlUI::g_game_state = saved_state;
+		QRmlUI::g_game_state_changes = saved_changes | QRmlUI::GAME_STATE_ALL_FIELDS;
+		QRmlUI::GameDataModel::MarkAllDirty ();
+		g_state.context->Update ();
+
+		Con_DPrintf ("UI_PrewarmHUD: %zu documents in %.2f ms\n", documents.size (), (Sys_DoubleTime () - start) * 1000.0);
+	}
+
 	// ── HUD / Scoreboard / Intermission ────────────────────────────────
 
 	void UI_ShowHUD (const char *hud_document)
@@ -1557,13 +2210,29 @@ extern "C"
 		}
 	}
 
+	void UI_SetPerfOverlay (int visible)
+	{
+		if (!IsRmlUiEnabled () || !g_state.initialized || (visible != 0) == g_state.perf_overlay_visible)
+			return;
+		if (visible)
+		{
+			if (!UI_LoadDocument (QRmlUI::Paths::kPerfOverlay))
+				return;
+			UI_ShowDocument (QRmlUI::Paths::kPerfOverlay, 0);
+		}
+		else
+			UI_HideDocument (QRmlUI::Paths::kPerfOverlay);
+		g_state.perf_overlay_visible = visible != 0;
+		QRmlUI::PerfOverlay::SetVisible (g_state.perf_overlay_visible);
+	}
+
 	// ── Game state synchronization ─────────────────────────────────────
 
 	void UI_SyncGameState (
-		const int *stats, int stats_count, int items, int intermission, int gametype, int maxclients, const char *level_name, const char *map_name,
-		double game_time)
+		const int *stats, int stats_count, unsigned int stats_changed, int items, int intermission, int gametype, int maxclients, const char *level_name,
+		const char *map_name, double game_time)
 	{
-		if (!IsRmlUiEnabled ())
+		if (!IsRmlUiEnabled () || s_bench.active)
 			return;
 		// Ensure OVERLAY mode if HUD is visible and no menu is open
 		if (g_state.hud_visible && !UI_WantsMenuInput ())
@@ -1588,18 +2257,20 @@ extern "C"
 			g_state.last_intermission = intermission;
 		}
 
-		GameDataModel_SyncFromQuake (stats, stats_count, items, intermission, gametype, maxclients, level_name, map_name, game_time);
+		GameDataModel_SyncFromQuake (stats, stats_count, stats_changed, items, intermission, gametype, maxclients, level_name, map_name, game_time);
 	}
 
 	// ── Scoreboard sync ────────────────────────────────────────────────
 
 	void UI_SyncScoreboard (const ui_player_info_t *players, int count)
 	{
-		if (!IsRmlUiEnabled () || !g_state.initialized)
+		if (!IsRmlUiEnabled () || !g_state.initialized || s_bench.active)
 			return;
 
-		QRmlUI::g_game_state.players.clear ();
-		QRmlUI::g_game_state.players.reserve (count);
+		// Built aside so an unchanged scoreboard doesn't dirty the player list
+		static std::vector<QRmlUI::PlayerInfo> synced_players;
+		synced_players.clear ();
+		synced_players.reserve (count);
 
 		for (int i = 0; i < count; i++)
 		{
@@ -1610,9 +2281,14 @@ extern "C"
 			pi.bottom_color = players[i].colors & 0xf;
 			pi.ping = players[i].ping;
 			pi.is_local = players[i].is_local != 0;
-			QRmlUI::g_game_state.players.push_back (pi);
+			synced_players.push_back (pi);
 		}
-		QRmlUI::g_game_state.num_players = count;
+		if (synced_players != QRmlUI::g_game_state.players)
+		{
+			QRmlUI::g_game_state.players.swap (synced_players);
+			QRmlUI::g_game_state_changes |= QRmlUI::GameStateBit (QRmlUI::GameStateField::players);
+		}
+		QRmlUI::UpdateGameStateField (QRmlUI::g_game_state.num_players, count, QRmlUI::GameStateField::num_players, QRmlUI::g_game_state_changes);
 	}
 
 	// ── Notification system ────────────────────────────────────────────
@@ -1671,6 +2347,7 @@ extern "C"
 		}
 
 		QRmlUI::g_game_state.num_mods = count;
+		QRmlUI::GameDataModel::RefreshMods ();
 		QRmlUI::GameDataModel::MarkAllDirty ();
 	}
 
@@ -1714,6 +2391,16 @@ extern "C"
 
 	// ── Lua test harness ──────────────────────────────────────────────
 
+	void UI_PrintLuaCallbackStats (int frames)
+	{
+#ifdef USE_LUA
+		if (g_state.initialized)
+			QRmlUI::LuaBridge::PrintCallbackStats (frames);
+#else
+		(void)frames;
+#endif
+	}
+
 	void UI_RunLuaTests (void)
 	{
 #ifdef USE_LUA
@@ -1728,4 +2415,98 @@ extern "C"
 #endif
 	}
 
+	// ── Benchmarks ────────────────────────────────────────────────────
+
+	void UI_BenchDocuments (int frames, int rows, const char **documents, int num_documents)
+	{
+		if (!IsRmlUiEnabled () || !g_state.initialized || !g_state.context || !g_state.render_interface)
+		{
+			Con_Printf ("ui_bench: RmlUI is not running\n");
+			return;
+		}
+		if (s_bench.active)
+		{
+			Con_Printf ("ui_bench: already running\n");
+			return;
+		}
+
+		s_bench.frames = frames > 0 ? frames : BENCH_DEFAULT_FRAMES;
+		s_bench.rows = rows > 0 ? rows : BENCH_DEFAULT_ROWS;
+		if (num_documents > 0)
+			s_bench.documents.assign (documents, documents + num_documents);
+		else
+			s_bench.documents.assign (std::begin (kBenchDefaultDocuments), std::end (kBenchDefaultDocuments));
+
+		// Each document is measured alone
+		for (const auto &pair : g_state.documents)
+		{
+			if (pair.second && pair.second->IsVisible ())
+			{
+				s_bench.hidden.push_back (pair.first);
+				pair.second->Hide ();
+			}
+		}
+		s_bench.was_visible = g_state.visible;
+		g_state.visible = true;
+		s_bench.active = true;
+		Con_Printf ("ui_bench: %d documents, %d frames each, %d scoreboard rows\n", (int)s_bench.documents.size (), s_bench.frames, s_bench.rows);
+		BenchShowDocument ();
+	}
+
+	void UI_BenchAllocator (void (*report) (const char *name, int64_t ops, double seconds))
+	{
+		using QRmlUI::AllocationResult;
+
+		// Same bookkeeping the UI vertex/index buffers and textures go through, no device needed
+		static const VkDeviceSize CAPACITY = 64ull * 1024ull * 1024ull;
+		const int				  NUM_ALLOCS = 2000;
+		const int				  NUM_ROUNDS = 50;
+
+		std::vector<VkDeviceSize>	  sizes (NUM_ALLOCS);
+		std::vector<AllocationResult> allocations (NUM_ALLOCS);
+		uint32_t					  seed = 0x12345678u;
+		for (int i = 0; i < NUM_ALLOCS; ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			sizes[i] = 64 + (seed >> 8) % (16 * 1024);
+		}
+
+		const double			  frequency = (double)SDL_GetPerformanceFrequency ();
+		QRmlUI::FreeListAllocator allocator;
+		for (int pattern = 0; pattern < 2; ++pattern)
+		{
+			allocator.Reset (CAPACITY);
+			int64_t		   ops = 0;
+			const uint64_t start = SDL_GetPerformanceCounter ();
+			for (int round = 0; round < NUM_ROUNDS; ++round)
+			{
+				for (int i = 0; i < NUM_ALLOCS; ++i)
+				{
+					std::optional<AllocationResult> result = allocator.Allocate (sizes[i], 256);
+					allocations[i] = result ? *result : AllocationResult{0, 0};
+				}
+				ops += NUM_ALLOCS;
+				if (pattern == 1)
+				{
+					// fragments the free list so the first-fit search and coalescing get some work
+					for (int i = 0; i < NUM_ALLOCS; i += 2)
+						if (allocations[i].size)
+							allocator.Free (allocations[i].offset, allocations[i].size);
+					for (int i = 0; i < NUM_ALLOCS; i += 2)
+					{
+						std::optional<AllocationResult> result = allocator.Allocate (sizes[NUM_ALLOCS - 1 - i], 256);
+						allocations[i] = result ? *result : AllocationResult{0, 0};
+					}
+					ops += NUM_ALLOCS;
+				}
+				for (int i = 0; i < NUM_ALLOCS; ++i)
+					if (allocations[i].size)
+						allocator.Free (allocations[i].offset, allocations[i].size);
+				ops += NUM_ALLOCS;
+			}
+			const double seconds = (double)(SDL_GetPerformanceCounter () - start) / frequency;
+			report ((pattern == 0) ? "freelist fill and free in order" : "freelist free every other and refill", ops, seconds);
+		}
+	}
+
 } // extern "C"
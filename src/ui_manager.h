@@ -76,6 +76,7 @@ extern "C"
 	void UI_ShowHUD (const char *hud_document); /* NULL = use default hud.rml */
 	void UI_HideHUD (void);
 	int	 UI_IsHUDVisible (void);
+	void UI_PrewarmHUD (void); /* Load, style and lay out HUD/scoreboard/intermission while hidden */
 
 	/* Scoreboard and intermission overlays */
 	void UI_ShowScoreboard (void);
@@ -83,13 +84,17 @@ extern "C"
 	void UI_ShowIntermission (void);
 	void UI_HideIntermission (void);
 
+	/* Performance overlay (ui_perfoverlay), frame graphs from the frame stats ring */
+	void UI_SetPerfOverlay (int visible);
+
 	/* Reset transient animation state (pain flash, weapon switch) on disconnect */
 	void GameDataModel_ResetTransients (void);
 
-	/* Game state synchronization - call each frame from sbar.c */
+	/* Game state synchronization - called once per frame by SCR_SyncUI. stats_changed
+	 * flags the stats below 32 written since the last call, the others are not read. */
 	void UI_SyncGameState (
-		const int *stats, int stats_count, int items, int intermission, int gametype, int maxclients, const char *level_name, const char *map_name,
-		double game_time);
+		const int *stats, int stats_count, unsigned int stats_changed, int items, int intermission, int gametype, int maxclients, const char *level_name,
+		const char *map_name, double game_time);
 
 	/* Scoreboard player data sync - call when scoreboard is visible */
 	typedef struct
@@ -151,6 +156,7 @@ extern "C"
 		int								 sync2_available;
 		PFN_vkCmdPipelineBarrier2KHR	 cmd_pipeline_barrier_2;
 		int								 dynamic_rendering;
+		int								 descriptor_indexing;
 		PFN_vkCmdBindPipeline			 cmd_bind_pipeline;
 		PFN_vkCmdBindDescriptorSets		 cmd_bind_descriptor_sets;
 		PFN_vkCmdBindVertexBuffers		 cmd_bind_vertex_buffers;
@@ -160,6 +166,8 @@ extern "C"
 		PFN_vkCmdPushConstants			 cmd_push_constants;
 		PFN_vkCmdSetScissor				 cmd_set_scissor;
 		PFN_vkCmdSetViewport			 cmd_set_viewport;
+		PFN_vkCmdBeginRenderingKHR		 cmd_begin_rendering;
+		PFN_vkCmdEndRenderingKHR		 cmd_end_rendering;
 	} ui_vulkan_config_t;
 	void UI_InitializeVulkan (const void *config); /* Takes ui_vulkan_config_t* */
 
@@ -167,6 +175,13 @@ extern "C"
 	void UI_BeginFrame (void *cmd, int width, int height);
 	void UI_EndFrame (void);
 
+	/* Split frame: UI_BeginLayerFrame starts a frame recorded into the cached layer only,
+	 * so UI_Update/UI_Render/UI_EndFrame can run before the GUI command buffer is ready.
+	 * UI_CompositeLayer then draws the result into cmd. Returns 0 when the layer cache is
+	 * off or unusable, the frame has to be drawn through UI_BeginFrame then. */
+	int	 UI_BeginLayerFrame (int width, int height);
+	void UI_CompositeLayer (void *cmd);
+
 	/* GPU timestamp instrumentation — called on primary CB around UI render pass */
 	void UI_WriteBeginTimestamp (void *cmd);
 	void UI_WriteEndTimestamp (void *cmd);
@@ -174,6 +189,10 @@ extern "C"
 	/* Garbage collection - call after GPU fence wait to safely destroy resources */
 	void UI_CollectGarbage (void);
 
+	/* Secondary command buffer rendering the cached RmlUI layer (VkCommandBuffer), NULL when
+	 * the previous layer image is reused. Execute outside of a render pass before the GUI pass. */
+	void *UI_TakeLayerCommandBuffer (void);
+
 	/* UI frame performance stats (CPU timings are in milliseconds) */
 	typedef struct ui_perf_stats_s
 	{
@@ -190,15 +209,30 @@ extern "C"
 		double end_ms;
 		double total_ms;
 		double gpu_ms;
+		double overlay_ms; /* ui_perfoverlay sampling and graphs, included in update_ms and render_ms */
 		int	   draw_calls;
 		int	   indices;
 		int	   triangles;
 	} ui_perf_stats_t;
 	void UI_GetPerfStats (ui_perf_stats_t *out_stats);
 
+	/* Print the frames recorded over ui_trace_threshold (ui_trace_dump) */
+	void UI_DumpSpikeTraces (void);
+
+	/* Print and reset the Lua frame callback costs, averaged over frames (ui_speeds 3) */
+	void UI_PrintLuaCallbackStats (int frames);
+
 	/* Run Lua test suite (lua_test console command) */
 	void UI_RunLuaTests (void);
 
+	/* Show each document alone for frames (0 = default) rendered frames under a scripted game
+	 * state with rows scoreboard players, then print its per-phase percentiles (ui_bench).
+	 * No documents benchmarks the HUD, scoreboard, notify and options documents. */
+	void UI_BenchDocuments (int frames, int rows, const char **documents, int num_documents);
+
+	/* FreeListAllocator microbenchmark (bench freelist), results go through report */
+	void UI_BenchAllocator (void (*report) (const char *name, int64_t ops, double seconds));
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,15 @@ assert_true(t > 0, "engine.time() should be positive")
 suite("engine.on_frame")
 assert_type(engine.on_frame, "function", "engine.on_frame should be a function")
 
+suite("engine.wait / engine.yield")
+assert_type(engine.wait, "function", "engine.wait should be a function")
+assert_type(engine.yield, "function", "engine.yield should be a function")
+assert_error(function() engine.wait(1) end, "engine.wait outside a frame callback should error")
+assert_error(function() engine.yield() end, "engine.yield outside a frame callback should error")
+
+suite("engine.on_change")
+assert_type(engine.on_change, "function", "engine.on_change should be a function")
+
 suite("engine.hud_visible")
 assert_type(engine.hud_visible, "function", "engine.hud_visible should be a function")
 local hv = engine.hud_visible()